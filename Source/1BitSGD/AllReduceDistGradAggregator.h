@@ -12,6 +12,7 @@
 #include "MatrixQuantizerGPU.h"
 #include <future>
 #include "TimerUtility.h"
+#include "PerformanceProfiler.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -39,13 +40,12 @@ class AllReduceDistGradAggregator : public IDistGradAggregator<ElemType>
 public:
     AllReduceDistGradAggregator(const std::shared_ptr<MPIWrapper>& mpi, int nBits, bool zeroThresholdFor1Bit, bool useQuantizationForSelfStripe, bool useAsyncAggregation, int traceLevel, int syncStatsTrace)
         : IDistGradAggregator<ElemType>(mpi), m_numQuantizationBits(nBits), m_zeroThresholdFor1Bit(zeroThresholdFor1Bit), m_useQuantizationForSelfStripe(useQuantizationForSelfStripe),
-        m_traceLevel(traceLevel), m_initialized(false), m_useAsyncAggregation(useAsyncAggregation), m_bufferedGradHeader(nullptr), m_syncStatsTrace(syncStatsTrace), m_iterationCount(0)
+        m_traceLevel(traceLevel), m_initialized(false), m_useAsyncAggregation(useAsyncAggregation), m_bufferedGradHeader(nullptr), m_syncStatsTrace(syncStatsTrace), m_iterationCount(0),
+        m_useGpuDirectExchange(false)
     {}
 
     ~AllReduceDistGradAggregator()
     {
-        for (size_t i = 0; i < m_recvHeaders.size(); ++i)
-            DistGradHeader::Destroy(m_recvHeaders[i]);
 
         if (m_bufferedGradHeader != nullptr)
             DistGradHeader::Destroy(m_bufferedGradHeader);
@@ -73,7 +73,12 @@ public:
         {
             m_initialized = true;
             int deviceId = gradients[0]->GetDeviceId();
-            if (deviceId != CPUDEVICE)
+
+            // With GPUDirect RDMA the quantized matrices stay in device memory and are exchanged from there,
+            // otherwise they are staged through page-locked host buffers
+            m_useGpuDirectExchange = (deviceId != CPUDEVICE) && m_mpi->UseGpuGdr();
+            int quantizedDeviceId = m_useGpuDirectExchange ? deviceId : CPUDEVICE;
+            if ((deviceId != CPUDEVICE) && !m_useGpuDirectExchange)
                 m_allocator.reset(new CUDAPageLockedMemAllocator(deviceId));
 
             for (size_t i = 0; i < gradients.size(); i++)
@@ -85,7 +90,7 @@ public:
                 size_t nRow = gradients[i]->GetNumRows();
                 size_t nCol = gradients[i]->GetNumCols();
                 m_preAggGradQuantizers.push_back(std::unique_ptr<MatrixQuantizer<ElemType>>(new MatrixQuantizer<ElemType>(nRow, nCol, deviceId, m_useAsyncAggregation)));
-                m_gradQuantized.push_back(std::unique_ptr<QuantizedMatrix<ElemType>>(new QuantizedMatrix<ElemType>(nRow, nCol, m_numQuantizationBits, CPUDEVICE, m_allocator.get())));
+                m_gradQuantized.push_back(std::unique_ptr<QuantizedMatrix<ElemType>>(new QuantizedMatrix<ElemType>(nRow, nCol, m_numQuantizationBits, quantizedDeviceId, m_allocator.get())));
 
                 // Determine which stripe of the gradient is this node responsible for
                 Stripe stripe = GetStripeForNode(nCol, MyRank(), NumProc());
@@ -96,7 +101,7 @@ public:
                 {
                     currAggGradQuantizer = new MatrixQuantizer<ElemType>(nRow, stripe.m_numCols, deviceId, m_useAsyncAggregation);
                     for (size_t j = 0; j < NumProc() - 1; ++j)
-                        currRecvGradStripesQuantized.push_back(std::unique_ptr<QuantizedMatrix<ElemType>>(new QuantizedMatrix<ElemType>(nRow, stripe.m_numCols, m_numQuantizationBits, CPUDEVICE, m_allocator.get())));
+                        currRecvGradStripesQuantized.push_back(std::unique_ptr<QuantizedMatrix<ElemType>>(new QuantizedMatrix<ElemType>(nRow, stripe.m_numCols, m_numQuantizationBits, quantizedDeviceId, m_allocator.get())));
                 }
 
                 m_aggGradStripeQuantizers.push_back(std::unique_ptr<MatrixQuantizer<ElemType>>(currAggGradQuantizer));
@@ -111,12 +116,6 @@ public:
                 m_bufferedGradHeader = DistGradHeader::Create(numEvalNodes);
                 m_bufferedGradHeader->Clear();
             }
-
-            if (m_mpi->IsMainNode())
-            {
-                for (size_t i = 0; i < NumProc() - 1; ++i)
-                    m_recvHeaders.push_back(DistGradHeader::Create(numEvalNodes));
-            }
         }
         else if (resetState)
         {
@@ -245,6 +244,8 @@ public:
             aggregationTimer.Start();
         }
 
+        auto profExchange = ProfilerTimeBegin();
+
         size_t numGradMatrices = gradients.size();
 
         if (headerCPU->numSamples == 0)
@@ -320,17 +321,11 @@ public:
             }
         }
 
-        // Initiate receive of the header on the main node
-        std::vector<MPI_Request> recvHeaderRequests(NumProc() - 1);
-        if (m_mpi->IsMainNode())
-        {
-            for (size_t j = 0; j < NumProc() - 1; ++j)
-            {
-                int source = (j >= MyRank()) ? (j + 1) : j;
-                // We use a tag of 'numGradMatrices' for the pre-aggregation header
-                m_mpi->Irecv(m_recvHeaders[j], m_recvHeaders[j]->Size(), MPI_CHAR, source, numGradMatrices, &(recvHeaderRequests[j])) || MpiFail("MPI_Irecv");
-            }
-        }
+        // Initiate the all-reduce of the header, packed into one buffer; it is only waited for once the gradients are exchanged
+        m_packedHeader.resize(headerCPU->PackedSize());
+        headerCPU->Pack(m_packedHeader.data());
+        MPI_Request headerRequest;
+        m_mpi->Iallreduce(MPI_IN_PLACE, m_packedHeader.data(), (int) m_packedHeader.size(), MPI_DOUBLE, MPI_SUM, &headerRequest) || MpiFail("MPI_Iallreduce");
 
         // Asynchronously send stripes of the quantized gradient matrices to the respective nodes that own aggregation of that stripe
         std::vector<std::vector<MPI_Request>> sendGradStripesQuantizedRequests(numGradMatrices);
@@ -377,11 +372,6 @@ public:
             }
         }
 
-        // Send the headers from all nodes but the main node
-        MPI_Request sendHeaderRequest;
-        if (!m_mpi->IsMainNode())
-            m_mpi->Isend(headerCPU, headerCPU->Size(), MPI_CHAR, m_mpi->MainNodeRank(), numGradMatrices, &sendHeaderRequest) || MpiFail("MPI_Isend");
-
         // Wait for the stripes to arrive from each node and unquantize and aggregate
         size_t numReceivesExpected = recvGradStripesQuantizedRequests.size();
         size_t numActualReceives = 0;
@@ -437,25 +427,6 @@ public:
 
         assert(numActualReceives == numReceivesExpected);
 
-        // On the main node wait for the headers to arrive and aggregate
-        if (m_mpi->IsMainNode())
-        {
-            size_t numNodesHeadersReceivedFrom = 0;
-            while (numNodesHeadersReceivedFrom < (NumProc() - 1))
-            {
-                int idx = MPI_UNDEFINED;
-                m_mpi->Waitany(recvHeaderRequests.size(), recvHeaderRequests.data(), &idx, MPI_STATUS_IGNORE) || MpiFail("MPI_Waitany");
-                if (idx == MPI_UNDEFINED)
-                    break;
-
-                numNodesHeadersReceivedFrom++;
-
-                headerCPU->Aggregate(m_recvHeaders[idx], true);
-            }
-
-            assert(numNodesHeadersReceivedFrom == (NumProc() - 1));
-        }
-
         std::vector<std::vector<MPI_Request>> recvAggGradStripesQuantizedRequests(numGradMatrices);
         // Initiate receive of stripes of quantized aggregated gradients from different nodes
         for (size_t i = 0; i < numGradMatrices; ++i)
@@ -478,11 +449,6 @@ public:
             }
         }
 
-        MPI_Request recvAggHeaderRequest;
-        // Initiate receive of the aggregate header
-        if (!m_mpi->IsMainNode())
-            m_mpi->Irecv(headerCPU, headerCPU->Size(), MPI_CHAR, m_mpi->MainNodeRank(), numGradMatrices + 1 + numGradMatrices, &recvAggHeaderRequest) || MpiFail("MPI_Irecv");
-
         // Initiate broadcast of quantized aggregated gradient stripes to all other nodes
         std::vector<std::vector<MPI_Request>> sendAggGradStripeQuantizedRequests(numGradMatrices);
         for (size_t i = 0; i < numGradMatrices; ++i)
@@ -501,18 +467,6 @@ public:
             }
         }
 
-        // Initiate send of the aggregate header from main node
-        std::vector<MPI_Request> sendAggHeaderRequests(NumProc() - 1);
-        if (m_mpi->IsMainNode())
-        {
-            for (size_t j = 0; j < NumProc() - 1; ++j)
-            {
-                int dest = (j >= MyRank()) ? (j + 1) : j;
-                // TODO: Should we use MPI_Bcast instead for better performance
-                m_mpi->Isend(headerCPU, headerCPU->Size(), MPI_CHAR, dest, numGradMatrices + 1 + numGradMatrices, &(sendAggHeaderRequests[j])) || MpiFail("MPI_Isend");
-            }
-        }
-
         // Wait to receive all aggregated stripes and unquantize
         for (size_t i = 0; i < numGradMatrices; ++i)
         {
@@ -521,9 +475,9 @@ public:
             m_preAggGradQuantizers[i]->UnquantizeAsync(*(m_gradQuantized[i]), *(gradients[i]), false);
         }
 
-        // Wait to receive aggregate header
-        if (!m_mpi->IsMainNode())
-            m_mpi->Wait(&recvAggHeaderRequest, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+        // Wait for the aggregate header
+        m_mpi->Wait(&headerRequest, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+        headerCPU->Unpack(m_packedHeader.data());
 
         // Wait for all the unquantizations to finish
         for (size_t i = 0; i < numGradMatrices; ++i)
@@ -545,17 +499,13 @@ public:
                 m_mpi->Waitall(sendGradStripesQuantizedRequests[i].size(), sendGradStripesQuantizedRequests[i].data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
         }
 
-        if (!m_mpi->IsMainNode())
-            m_mpi->Wait(&sendHeaderRequest, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
-
         for (int i = 0; i < sendAggGradStripeQuantizedRequests.size(); ++i)
         {
             if (sendAggGradStripeQuantizedRequests[i].size() > 0)
                 m_mpi->Waitall(sendAggGradStripeQuantizedRequests[i].size(), sendAggGradStripeQuantizedRequests[i].data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
         }
 
-        if (m_mpi->IsMainNode())
-            m_mpi->Waitall(sendAggHeaderRequests.size(), sendAggHeaderRequests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+        ProfilerTimeEnd(profExchange, m_useGpuDirectExchange ? "1-bit Gradient Exchange (GPUDirect RDMA)" : "1-bit Gradient Exchange (host staging)");
 
         if (showSyncPerfStats)
         {
@@ -587,14 +537,19 @@ public:
     }
 
 private:
+    // Allocator of the host buffers of the quantized matrices, if they are staged through host memory
     std::unique_ptr<CUDAPageLockedMemAllocator> m_allocator;
 
+    // Exchange the quantized matrices directly from GPU memory (GPUDirect RDMA)
+    bool m_useGpuDirectExchange;
+
     std::vector<std::unique_ptr<MatrixQuantizer<ElemType>>> m_preAggGradQuantizers;
     std::vector<std::unique_ptr<QuantizedMatrix<ElemType>>> m_gradQuantized;
 
     std::vector<std::unique_ptr<MatrixQuantizer<ElemType>>> m_aggGradStripeQuantizers;
     std::vector<std::vector<std::unique_ptr<QuantizedMatrix<ElemType>>>> m_recvGradStripesQuantized;
-    std::vector<DistGradHeader*> m_recvHeaders;
+    // packed header of the aggregation in flight
+    std::vector<double> m_packedHeader;
 
     // Number of bits that each gradient value is quantized to before communication
     // with other nodes
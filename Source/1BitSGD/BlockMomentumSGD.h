@@ -34,13 +34,27 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         map < wstring, shared_ptr<Matrix<ElemType>>>     m_prevParameters;       // parameters at the last model aggregation point
         map < wstring, shared_ptr<Matrix<ElemType>>>    m_blockLevelSmoothedGradient; 
 
+        // Pipelined aggregation: the all-reduce of a block gradient runs while the next block is trained,
+        // and is applied to the global model (m_prevParameters) at the following sync point.
+        struct PendingBlockGradient
+        {
+            vector<ElemType> m_buffer;
+            MPI_Request m_request;
+            bool m_inFlight = false;
+        };
+        bool m_pipelineAggregation;
+        map < wstring, shared_ptr<Matrix<ElemType>>>    m_blockStartParameters; // local parameters at the last model aggregation point
+        map < wstring, PendingBlockGradient>            m_pendingBlockGradients;
+
     public:
         BlockMomentumSGD(const MPIWrapperPtr& pMPI, size_t reportFreq, DEVICEID_TYPE devID, 
                         bool useNestrovMomentum, bool resetSGDM, 
                         double blockLearningRate, 
-                        double blockMomentumAsTimeConstant, size_t syncPeriod)
+                        double blockMomentumAsTimeConstant, size_t syncPeriod,
+                        bool pipelineAggregation = false)
             :IMASGD<ElemType>(pMPI, reportFreq, devID)
         {
+            m_pipelineAggregation = pipelineAggregation;
             m_syncPeriodPerWorker = syncPeriod / pMPI->NumNodesInUse();
             m_blockMomentumAsTimeConstantPerWorker = blockMomentumAsTimeConstant / pMPI->NumNodesInUse(); 
             m_useNesterovMomentum = useNestrovMomentum;
@@ -75,6 +89,13 @@ namespace Microsoft { namespace MSR { namespace CNTK {
                 {
                     m_prevParameters[name]->SetValue(NodeValue);
                 }
+                if (m_pipelineAggregation)
+                {
+                    assert(!m_pendingBlockGradients[name].m_inFlight);
+                    if (m_blockStartParameters.find(name) == m_blockStartParameters.end())
+                        m_blockStartParameters[name] = make_shared<Matrix<ElemType>>(NodeValue.GetDeviceId());
+                    m_blockStartParameters[name]->SetValue(NodeValue);
+                }
             }
             fprintf(stderr, "Parallel training (%d workers) using BlockMomentumSGD with "
                             "block momentum = %6.4f, "
@@ -83,6 +104,7 @@ namespace Microsoft { namespace MSR { namespace CNTK {
                             "block size per worker = %d samples, "
                             "%s"
                             "%s"
+                            "%s"
                             "\n",
                             (int)m_pMPI->NumNodesInUse(),      
                             BlockMomentumSGD<double>::TimeConstant2Momentum(m_blockMomentumAsTimeConstantPerWorker, m_syncPeriodPerWorker), 
@@ -90,6 +112,7 @@ namespace Microsoft { namespace MSR { namespace CNTK {
                             m_blockLearningRate, 
                             (int)m_syncPeriodPerWorker, 
                             m_useNesterovMomentum ? "using Nesterov-style block momentum, " : "" , 
+                            m_pipelineAggregation ? "pipelining model aggregation with local training, " : "",
                             m_resetSGDMomentumAfterAggregation ? "resetting SGD momentum after sync." : "."
                 );
         }
@@ -98,6 +121,9 @@ namespace Microsoft { namespace MSR { namespace CNTK {
             size_t                                      samplesSinceLastSync) override
         {
             Base::OnEpochEnd(LearnableNodes, smoothedGradients, samplesSinceLastSync);
+            // The aggregation of the last block has been started only; complete it so that all workers end the epoch with the same model.
+            if (m_pipelineAggregation)
+                CompletePendingAggregation(LearnableNodes);
         }
         /*virtual*/ void ModelAggregationProcessing(
             size_t samplesSinceLastSync,
@@ -120,60 +146,42 @@ namespace Microsoft { namespace MSR { namespace CNTK {
             secondsOnCommunication += (float)commTimer.ElapsedSeconds();
             totalSamplesProcessed = nTotalSamples;
 
-            for (auto& pBaseNode : learnableNodes)
+            if (m_pipelineAggregation)
+                PipelinedBlockGradientAggregation(learnableNodes, blockMomentum, secondsOnCommunication);
+            else
             {
-                if (!pBaseNode->IsParameterUpdateRequired())
-                {
-                    continue;
-                }
-                wstring name = pBaseNode->NodeName();
-                // 2 block gradient aggregation 
-                auto pNode = DownCast(pBaseNode);
-                // 2.1. get current model  
-                Matrix<ElemType>& prevWeight = *m_prevParameters[name];               // prev model value 
-                Matrix<ElemType>& currentWeight = pNode->Value();                        // current model 
-                // 2.1.2. subtract it from the previous model                   
-                Matrix<ElemType>  blockGrad(prevWeight.DeepClone());            
-                blockGrad -= currentWeight;                                              // matW becomes local block gradient (of one worker)
-                // 2.1.3. send block gradient over MPI nodes; 
-                unique_ptr<ElemType[]> px(blockGrad.CopyToArray());
-                size_t    nx = blockGrad.GetNumElements();
-                // 2.1.4. inplace sum 
-                commTimer.Restart();
-                m_pMPI->AllReduce(px.get(), nx);
-                commTimer.Stop();
-                secondsOnCommunication += (float)commTimer.ElapsedSeconds();
-                // 2.1.5. global block gradient
-                blockGrad.SetValue(blockGrad.GetNumRows(),
-                                   blockGrad.GetNumCols(),
-                                   blockGrad.GetDeviceId(),
-                                   px.get()
-                                   ); 
-                // 2.2. model update 
+                for (auto& pBaseNode : learnableNodes)
                 {
-                    // alias for better readability 
-                    Matrix<ElemType>& smoothedGradientUpdate = *m_blockLevelSmoothedGradient[name];       // smoothed gradient                   
-                    // 2.2.1 update block level smoothed gradient; 
-                    // This is essentially a first-order infinite impulse response (IIR) filter with the gain (1 - blockMomentum)*m_blockLearningRate:
-                    // smoothedGradientUpdate(t)=blockMomentum * smoothedGradients(t-1) + (1 - blockMomentum)*m_blockLearningRate*blockGrad(t)
-                    Matrix<ElemType>::ScaleAndAdd((ElemType)((1 - blockMomentum)*m_blockLearningRate), blockGrad, (ElemType)blockMomentum, smoothedGradientUpdate); 
-                    // 2.2.2 update parameters; 
-                    currentWeight.SetValue(prevWeight);
-                    currentWeight -= smoothedGradientUpdate;
-                    // 2.2.3 Nesterov Momentum 
-                    // A Nesterov momentum here is to do a partial weight update before calculating the gradient, i.e., 
-                    // (step 1) w(t) <-- w(t) - \eta* v(t) 
-                    // (step 2) g(t+1) <-- forwardbackward on minibatches with initial model as w(t)
-                    // (step 3) v(t+1) <-- \eta*v(t) + (1-\eta)*learningRate*g(t+1)
-                    // (step 4) w(t+1) <-- w(t)-v(t)
-                    // (step 5) t      <-- t+1
-                    // without step 1, this becomes stanard momentum
-                    if (m_useNesterovMomentum)
+                    if (!pBaseNode->IsParameterUpdateRequired())
                     {
-                        Matrix<ElemType>::ScaleAndAdd((ElemType)-blockMomentum, smoothedGradientUpdate, currentWeight);
+                        continue;
                     }
-                    // 2.2.4 update bookkeeping
-                    prevWeight.SetValue(currentWeight);
+                    wstring name = pBaseNode->NodeName();
+                    // 2 block gradient aggregation 
+                    auto pNode = DownCast(pBaseNode);
+                    // 2.1. get current model  
+                    Matrix<ElemType>& prevWeight = *m_prevParameters[name];               // prev model value 
+                    Matrix<ElemType>& currentWeight = pNode->Value();                        // current model 
+                    // 2.1.2. subtract it from the previous model                   
+                    Matrix<ElemType>  blockGrad(prevWeight.DeepClone());            
+                    blockGrad -= currentWeight;                                              // matW becomes local block gradient (of one worker)
+                    // 2.1.3. send block gradient over MPI nodes; 
+                    unique_ptr<ElemType[]> px(blockGrad.CopyToArray());
+                    size_t    nx = blockGrad.GetNumElements();
+                    // 2.1.4. inplace sum 
+                    commTimer.Restart();
+                    m_pMPI->AllReduce(px.get(), nx);
+                    commTimer.Stop();
+                    secondsOnCommunication += (float)commTimer.ElapsedSeconds();
+                    // 2.1.5. global block gradient
+                    blockGrad.SetValue(blockGrad.GetNumRows(),
+                                       blockGrad.GetNumCols(),
+                                       blockGrad.GetDeviceId(),
+                                       px.get()
+                                       ); 
+                    // 2.2. model update 
+                    UpdateGlobalModel(name, blockGrad, blockMomentum);
+                    currentWeight.SetValue(prevWeight);
                 }
             }
             //----------------------------------------
@@ -190,6 +198,109 @@ namespace Microsoft { namespace MSR { namespace CNTK {
             }
         }
 
+    private:
+        // Applies the global block gradient to the global model (m_prevParameters) with block momentum.
+        void UpdateGlobalModel(const wstring& name, const Matrix<ElemType>& blockGrad, ElemType blockMomentum)
+        {
+            // alias for better readability 
+            Matrix<ElemType>& prevWeight = *m_prevParameters[name];                              // prev model value 
+            Matrix<ElemType>& smoothedGradientUpdate = *m_blockLevelSmoothedGradient[name];       // smoothed gradient                   
+            // 2.2.1 update block level smoothed gradient; 
+            // This is essentially a first-order infinite impulse response (IIR) filter with the gain (1 - blockMomentum)*m_blockLearningRate:
+            // smoothedGradientUpdate(t)=blockMomentum * smoothedGradients(t-1) + (1 - blockMomentum)*m_blockLearningRate*blockGrad(t)
+            Matrix<ElemType>::ScaleAndAdd((ElemType)((1 - blockMomentum)*m_blockLearningRate), blockGrad, (ElemType)blockMomentum, smoothedGradientUpdate); 
+            // 2.2.2 update parameters; 
+            prevWeight -= smoothedGradientUpdate;
+            // 2.2.3 Nesterov Momentum 
+            // A Nesterov momentum here is to do a partial weight update before calculating the gradient, i.e., 
+            // (step 1) w(t) <-- w(t) - \eta* v(t) 
+            // (step 2) g(t+1) <-- forwardbackward on minibatches with initial model as w(t)
+            // (step 3) v(t+1) <-- \eta*v(t) + (1-\eta)*learningRate*g(t+1)
+            // (step 4) w(t+1) <-- w(t)-v(t)
+            // (step 5) t      <-- t+1
+            // without step 1, this becomes stanard momentum
+            if (m_useNesterovMomentum)
+            {
+                Matrix<ElemType>::ScaleAndAdd((ElemType)-blockMomentum, smoothedGradientUpdate, prevWeight);
+            }
+        }
+
+        // Waits for the all-reduce of the previous block gradient and applies it to the global model. Returns false if there was none.
+        bool ApplyPendingBlockGradient(const wstring& name, const Matrix<ElemType>& like, ElemType blockMomentum)
+        {
+            auto& pending = m_pendingBlockGradients[name];
+            if (!pending.m_inFlight)
+                return false;
+
+            m_pMPI->Wait(&pending.m_request);
+            pending.m_inFlight = false;
+            Matrix<ElemType> blockGrad(like.GetNumRows(), like.GetNumCols(), pending.m_buffer.data(), like.GetDeviceId());
+            UpdateGlobalModel(name, blockGrad, blockMomentum);
+            return true;
+        }
+
+        // Pipelined version of step 2 of ModelAggregationProcessing(): the block gradient of this block is only sent,
+        // and the one of the previous block, whose all-reduce has been running while this block was trained, is applied.
+        // Every worker continues from the new global model plus its own progress during this block, which is replaced
+        // by the global contribution of the block at the next sync point (one block of staleness).
+        void PipelinedBlockGradientAggregation(const std::list<ComputationNodeBasePtr>& learnableNodes, ElemType blockMomentum, float& secondsOnCommunication)
+        {
+            Timer commTimer;
+            for (auto& pBaseNode : learnableNodes)
+            {
+                if (!pBaseNode->IsParameterUpdateRequired())
+                {
+                    continue;
+                }
+                wstring name = pBaseNode->NodeName();
+                auto pNode = DownCast(pBaseNode);
+                Matrix<ElemType>& prevWeight = *m_prevParameters[name];                  // global model
+                Matrix<ElemType>& blockStart = *m_blockStartParameters[name];            // local model at the beginning of this block
+                Matrix<ElemType>& currentWeight = pNode->Value();                        // current model
+
+                Matrix<ElemType> blockGrad(blockStart.DeepClone());
+                blockGrad -= currentWeight;                                              // local block gradient (of one worker)
+
+                commTimer.Restart();
+                ApplyPendingBlockGradient(name, blockGrad, blockMomentum);
+                commTimer.Stop();
+                secondsOnCommunication += (float)commTimer.ElapsedSeconds();
+
+                // Snapshot the local block gradient and start summing it over the workers.
+                auto& pending = m_pendingBlockGradients[name];
+                pending.m_buffer.resize(blockGrad.GetNumElements());
+                blockGrad.CopySection(blockGrad.GetNumRows(), blockGrad.GetNumCols(), pending.m_buffer.data(), blockGrad.GetNumRows());
+                m_pMPI->AllReduceAsync(pending.m_buffer.data(), pending.m_buffer.size(), &pending.m_request);
+                pending.m_inFlight = true;
+
+                currentWeight.SetValue(prevWeight);
+                currentWeight -= blockGrad;
+                blockStart.SetValue(currentWeight);
+            }
+        }
+
+        // Completes the all-reduces still in flight, after which the local models equal the global model.
+        void CompletePendingAggregation(const std::list<ComputationNodeBasePtr>& learnableNodes)
+        {
+            ElemType blockMomentum = (ElemType)BlockMomentumSGD<double>::TimeConstant2Momentum(m_blockMomentumAsTimeConstantPerWorker, m_syncPeriodPerWorker);
+            for (auto& pBaseNode : learnableNodes)
+            {
+                if (!pBaseNode->IsParameterUpdateRequired())
+                {
+                    continue;
+                }
+                wstring name = pBaseNode->NodeName();
+                auto pNode = DownCast(pBaseNode);
+                Matrix<ElemType>& currentWeight = pNode->Value();
+                if (ApplyPendingBlockGradient(name, currentWeight, blockMomentum))
+                {
+                    currentWeight.SetValue(*m_prevParameters[name]);
+                    m_blockStartParameters[name]->SetValue(currentWeight);
+                }
+            }
+        }
+
+    public:
         /*virtual*/ void SaveToCheckPoint(File& fstream) override
         {
             if (m_pMPI->IsMainNode())
@@ -0,0 +1,233 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "Basics.h"
+#include "MPIWrapper.h"
+#include "CNTKLibrary.h"
+#include "Utils.h"
+#include "DistributedCommunicator.h"
+
+namespace CNTK
+{
+    //
+    // A communicator that aggregates only the largest entries of the gradients (top-k sparsification).
+    // Every worker adds its residual to the gradient, selects the k = density * size entries of the largest
+    // magnitude and keeps everything else as the new residual (error feedback), so that nothing is lost but only delayed.
+    // The selected (index, value) pairs of all workers are exchanged with an all-gather and summed locally.
+    //
+    // The residuals are owned by the caller, see QuantizedDataParallelDistributedLearner; the stripe residuals
+    // of the quantized aggregation are not used.
+    //
+    class SparsifiedMPICommunicatorImpl final : public MPICommunicatorImpl, public QuantizedDistributedCommunicator
+    {
+        using Base = MPICommunicatorImpl;
+
+        template<class T> using vector = std::vector<T>;
+        template<class T> using shared_ptr = std::shared_ptr<T>;
+        template<class T> using unordered_set = std::unordered_set<T>;
+
+        template<class T> using Matrix = Microsoft::MSR::CNTK::Matrix<T>;
+
+    public:
+        explicit SparsifiedMPICommunicatorImpl(double density)
+            : m_density(density)
+        {
+            if (!(density > 0 && density <= 1))
+                InvalidArgument("SparsifiedMPICommunicator: density (%g) must be in (0, 1].", density);
+        }
+
+        void QuantizedAggregateInPlace(
+            std::vector<NDArrayViewPtr>& inValues,
+            std::vector<NDArrayViewPtr>& valueQuantizationResidues,
+            std::vector<NDArrayViewPtr>& stripeQuantizationResidues,
+            const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers) override
+        {
+            QuantizedAggregate(
+                inValues, valueQuantizationResidues, stripeQuantizationResidues,
+                inValues, valueQuantizationResidues, stripeQuantizationResidues,
+                sendToWorkers);
+        }
+
+        // A collective communication API to perform sparsified aggregation of values across all workers of this communicator
+        void QuantizedAggregate(
+            const vector<NDArrayViewPtr>& inValues,
+            const vector<NDArrayViewPtr>& valueQuantizationResidues,
+            const vector<NDArrayViewPtr>& stripeQuantizationResidues,
+            vector<NDArrayViewPtr>& aggregatedOutputs,
+            vector<NDArrayViewPtr>& newQuantizationResidues,
+            vector<NDArrayViewPtr>& newStripeQuantizationResidues,
+            const unordered_set<DistributedWorkerDescriptor>& sendToWorkers) override
+        {
+            CheckWorkers(sendToWorkers);
+
+            if (Workers().size() == 1) // No need to aggregate anything.
+            {
+                aggregatedOutputs = inValues;
+                newQuantizationResidues = valueQuantizationResidues;
+                newStripeQuantizationResidues = stripeQuantizationResidues;
+                return;
+            }
+
+            if (inValues.empty())
+                return;
+
+            DataType dataType = inValues.front()->GetDataType();
+            for (const auto& v : inValues)
+            {
+                if (v->GetDataType() != dataType)
+                    RuntimeError("Currently values of different types are not supported for sparsified aggregation.");
+            }
+
+            if (dataType == DataType::Float)
+                SparsifiedAggregate<float>(inValues, valueQuantizationResidues, aggregatedOutputs, newQuantizationResidues);
+            else if (dataType == DataType::Double)
+                SparsifiedAggregate<double>(inValues, valueQuantizationResidues, aggregatedOutputs, newQuantizationResidues);
+            else
+                LogicError("Unexpected type value.");
+
+            newStripeQuantizationResidues = stripeQuantizationResidues;
+        }
+
+        // Redefining inherited members.
+        // TODO: Use using and virtual inheritance after switching to VS2015.
+        const std::unordered_set<DistributedWorkerDescriptor>& Workers() const override { return Base::Workers(); }
+        const DistributedWorkerDescriptor& CurrentWorker() const override { return Base::CurrentWorker(); }
+        DistributedCommunicatorPtr SubGroup(const std::unordered_set<DistributedWorkerDescriptor>& g) const override { return Base::SubGroup(g); }
+        void Concatenate(
+            const std::vector<ValuePtr>& in,
+            std::vector<ValuePtr>& out,
+            const std::unordered_set<DistributedWorkerDescriptor>& w) override
+        {
+            Base::Concatenate(in, out, w);
+        }
+
+        void AggregateInPlace(
+            const std::vector<NDArrayViewPtr>& values,
+            const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers) override
+        {
+            Base::AggregateInPlace(values, sendToWorkers);
+        }
+
+        void Aggregate(
+            const std::vector<NDArrayViewPtr>& values,
+            std::vector<NDArrayViewPtr>& outputValues,
+            const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers) override
+        {
+            Base::Aggregate(values, outputValues, sendToWorkers);
+        }
+
+        void Barrier() override
+        {
+            Base::Barrier();
+        }
+
+        virtual void Concatenate(
+            const std::vector<NDArrayViewPtr>& input,
+            std::vector<NDArrayViewPtr>& output,
+            const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers) override
+        {
+            Base::Concatenate(input, output, sendToWorkers);
+        }
+
+        virtual void Gather(
+            const Dictionary& input,
+            std::vector<DictionaryPtr>& output,
+            const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers) override
+        {
+            Base::Gather(input, output, sendToWorkers);
+        }
+
+    private:
+        // Number of the entries of a value of the given size that are sent by every worker.
+        size_t NumSelected(size_t size) const
+        {
+            return std::min(size, std::max<size_t>(1, (size_t)std::ceil(m_density * size)));
+        }
+
+        template<class ElemType>
+        void SparsifiedAggregate(
+            const vector<NDArrayViewPtr>& inValues,
+            const vector<NDArrayViewPtr>& formalValueQuantizationResidues,
+            vector<NDArrayViewPtr>& aggregatedOutputs,
+            vector<NDArrayViewPtr>& newQuantizationResidues)
+        {
+            const size_t numWorkers = Workers().size();
+
+            auto valueQuantizationResidues = formalValueQuantizationResidues;
+            if (valueQuantizationResidues.empty())
+                valueQuantizationResidues.resize(inValues.size());
+            if (newQuantizationResidues.empty())
+                newQuantizationResidues.resize(inValues.size());
+            if (inValues.size() != valueQuantizationResidues.size() || inValues.size() != newQuantizationResidues.size())
+                LogicError("Number of aggregated values should be equal number of quantized residuals.");
+
+            auto& buffers = GetBuffers((ElemType*)nullptr);
+            buffers.m_selectedIndices.resize(inValues.size());
+            buffers.m_selectedValues.resize(inValues.size());
+            buffers.m_gatheredIndices.resize(inValues.size());
+            buffers.m_gatheredValues.resize(inValues.size());
+
+            // Select the entries to send and start exchanging them; the selection of a value overlaps the exchange of the previous ones.
+            vector<MPI_Request> requests(2 * inValues.size());
+            for (size_t i = 0; i < inValues.size(); ++i)
+            {
+                // Make sure none of the values are sparse - we currently do not support aggregation of sparse matrices
+                if (inValues[i]->GetStorageFormat() != StorageFormat::Dense)
+                    RuntimeError("Aggregation for sparse matrices is currently not supported!");
+
+                auto value = GetMatrix<ElemType>(inValues[i]);
+                if (!valueQuantizationResidues[i])
+                {
+                    auto residual = MakeSharedObject<NDArrayView>(AsDataType<ElemType>(), inValues[i]->Shape(), inValues[i]->Device());
+                    GetWritableMatrix<ElemType>(residual)->SetValue(0);
+                    valueQuantizationResidues[i] = residual;
+                }
+                if (!newQuantizationResidues[i])
+                    newQuantizationResidues[i] = MakeSharedObject<NDArrayView>(AsDataType<ElemType>(), inValues[i]->Shape(), inValues[i]->Device());
+
+                // The new residual is the error-compensated gradient minus the entries that are sent.
+                auto residual = GetWritableMatrix<ElemType>(newQuantizationResidues[i]);
+                residual->AssignSumOf(*value, *GetMatrix<ElemType>(valueQuantizationResidues[i]));
+
+                size_t k = NumSelected(value->GetNumElements());
+                residual->ExtractTopKMagnitudes(k, buffers.m_selectedIndices[i], buffers.m_selectedValues[i]);
+
+                buffers.m_gatheredIndices[i].resize(k * numWorkers);
+                buffers.m_gatheredValues[i].resize(k * numWorkers);
+                m_mpi->AllGatherAsync(buffers.m_selectedIndices[i].data(), k, buffers.m_gatheredIndices[i].data(), k, &requests[2 * i]);
+                m_mpi->AllGatherAsync(buffers.m_selectedValues[i].data(), k, buffers.m_gatheredValues[i].data(), k, &requests[2 * i + 1]);
+            }
+
+            m_mpi->WaitAll(requests);
+
+            // Sum up the entries of all workers.
+            for (size_t i = 0; i < inValues.size(); ++i)
+            {
+                auto output = GetWritableMatrix<ElemType>(aggregatedOutputs[i]);
+                output->SetValue(0);
+                output->ScatterAddValues(buffers.m_gatheredIndices[i], buffers.m_gatheredValues[i]);
+            }
+        }
+
+        // Host buffers of the exchange, kept between the calls to avoid reallocations.
+        template<class ElemType>
+        struct Buffers
+        {
+            vector<vector<int>> m_selectedIndices;
+            vector<vector<ElemType>> m_selectedValues;
+            vector<vector<int>> m_gatheredIndices;
+            vector<vector<ElemType>> m_gatheredValues;
+        };
+
+        Buffers<float>& GetBuffers(float*) { return m_floatBuffers; }
+        Buffers<double>& GetBuffers(double*) { return m_doubleBuffers; }
+
+        double m_density;
+        Buffers<float> m_floatBuffers;
+        Buffers<double> m_doubleBuffers;
+    };
+}
@@ -62,6 +62,12 @@ template <typename ElemType>
 void DoWriteWordAndClassInfo(const ConfigParameters& config);
 template <typename ElemType>
 void DoTopologyPlot(const ConfigParameters& config);
+template <typename ElemType>
+void DoConvertMLF(const ConfigParameters& config);
+template <typename ElemType>
+void DoConvertCBF(const ConfigParameters& config);
+template <typename ElemType>
+void DoConvertCTF(const ConfigParameters& config);
 
 // special purpose (SpecialPurposeActions.cpp)
 template <typename ElemType>
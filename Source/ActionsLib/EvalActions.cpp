@@ -257,9 +257,19 @@ void DoWriteOutput(const ConfigParameters& config)
     {
         wstring outputPath = config(L"outputPath");
         bool writeSequenceKey = config(L"writeSequenceKey", false);
-        WriteFormattingOptions formattingOptions(config);
-        bool nodeUnitTest = config(L"nodeUnitTest", "false");
-        writer.WriteOutput(testDataReader, mbSize[0], outputPath, outputNodeNamesVector, formattingOptions, epochSize, nodeUnitTest, writeSequenceKey);
+        wstring outputFormat = config(L"outputFormat", L"text");
+        if (outputFormat == L"binary")
+        {
+            writer.WriteBinaryOutput(testDataReader, mbSize[0], outputPath, outputNodeNamesVector, epochSize, writeSequenceKey);
+        }
+        else if (outputFormat == L"text")
+        {
+            WriteFormattingOptions formattingOptions(config);
+            bool nodeUnitTest = config(L"nodeUnitTest", "false");
+            writer.WriteOutput(testDataReader, mbSize[0], outputPath, outputNodeNamesVector, formattingOptions, epochSize, nodeUnitTest, writeSequenceKey);
+        }
+        else
+            InvalidArgument("write command: outputFormat must be 'text' or 'binary'");
     }
     else
         InvalidArgument("write command: You must specify either 'writer'or 'outputPath'");
@@ -185,6 +185,10 @@ ComputationNetworkPtr GetModelFromConfig(const ConfigRecordType& config, const w
         net->CompileNetwork();
     }
 
+    // for evaluation only: fold batch normalization into the convolutions and products before it
+    if (config(L"foldBatchNormalization", false))
+        net->FoldBatchNormalization({});
+
     return net;
 }
 
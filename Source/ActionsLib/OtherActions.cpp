@@ -112,6 +112,84 @@ void DoCreateLabelMap(const ConfigParameters& config)
 template void DoCreateLabelMap<float>(const ConfigParameters& config);
 template void DoCreateLabelMap<double>(const ConfigParameters& config);
 
+// ===========================================================================
+// DoConvertMLF() - implements CNTK "convertMLF" command
+// Converts text MLF files ("mlfFile" or "mlfFileList") into the binary MLF "outputFile" read by
+// HTKMLFBinaryDeserializer. State names are mapped by the state list "labelMappingFile" if given,
+// otherwise class ids are read from the fourth column. With "verify" (default), the binary MLF is
+// read back and compared with the text MLF after the conversion.
+// ===========================================================================
+
+template <typename ElemType>
+void DoConvertMLF(const ConfigParameters& config)
+{
+    typedef void (*ConvertMLFToBinaryProc)(const ConfigParameters& config);
+
+    // The conversion lives with the MLF deserializers; the module stays loaded, as for the readers.
+    static Plugin plugin;
+    std::string module = config(L"module", "Cntk.Deserializers.HTK");
+    auto convert = (ConvertMLFToBinaryProc)plugin.Load(module, "ConvertMLFToBinary");
+
+    auto start = std::chrono::system_clock::now();
+    convert(config);
+    auto elapsed = std::chrono::system_clock::now() - start;
+    fprintf(stderr, "convertMLF: %.1f seconds elapsed\n", std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() / 1000.0);
+}
+
+template void DoConvertMLF<float>(const ConfigParameters& config);
+template void DoConvertMLF<double>(const ConfigParameters& config);
+
+// ===========================================================================
+// DoConvertCBF() - implements CNTK "convertCBF" command
+// Re-encodes the CNTK binary format file "inputFile" as "outputFile" with the chunk data compressed by
+// "compression" ("zlib" by default, or "none") at "compressionLevel". With "verify" (default), the chunks
+// of both files are compared after the conversion.
+// ===========================================================================
+
+template <typename ElemType>
+void DoConvertCBF(const ConfigParameters& config)
+{
+    typedef void (*ConvertCBFProc)(const ConfigParameters& config);
+
+    static Plugin plugin;
+    std::string module = config(L"module", "Cntk.Deserializers.Binary");
+    auto convert = (ConvertCBFProc)plugin.Load(module, "ConvertCBF");
+
+    auto start = std::chrono::system_clock::now();
+    convert(config);
+    auto elapsed = std::chrono::system_clock::now() - start;
+    fprintf(stderr, "convertCBF: %.1f seconds elapsed\n", std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() / 1000.0);
+}
+
+template void DoConvertCBF<float>(const ConfigParameters& config);
+template void DoConvertCBF<double>(const ConfigParameters& config);
+
+// ===========================================================================
+// DoConvertCTF() - implements CNTK "convertCTF" command
+// Converts the CNTK text format file "file" into the CNTK binary format file "outputFile". The config is
+// that of CNTKTextFormatDeserializer ("input", "chunkSizeInBytes", "numParserThreads", ...), a chunk of
+// the text file becomes a chunk of the binary file. An input is stored in its "binaryFormat" ("dense" or
+// "sparse", its "format" by default) with the chunk "compression" ("none" by default, or "zlib").
+// ===========================================================================
+
+template <typename ElemType>
+void DoConvertCTF(const ConfigParameters& config)
+{
+    typedef void (*ConvertCTFToCBFProc)(const ConfigParameters& config);
+
+    static Plugin plugin;
+    std::string module = config(L"module", "Cntk.Deserializers.Binary");
+    auto convert = (ConvertCTFToCBFProc)plugin.Load(module, "ConvertCTFToCBF");
+
+    auto start = std::chrono::system_clock::now();
+    convert(config);
+    auto elapsed = std::chrono::system_clock::now() - start;
+    fprintf(stderr, "convertCTF: %.1f seconds elapsed\n", std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() / 1000.0);
+}
+
+template void DoConvertCTF<float>(const ConfigParameters& config);
+template void DoConvertCTF<double>(const ConfigParameters& config);
+
 // ===========================================================================
 // DoParameterSVD() - implements CNTK "SVD" command
 // ===========================================================================
@@ -74,6 +74,16 @@ shared_ptr<C> CreateObject(const ConfigParameters& config, const wchar_t* id)
     return make_shared<C>(objConfig);                           // old CNTK config specifies a dictionary which then must be explicitly instantiated
 }
 
+// text identifying the training data, which keys the precompute cache of SGD
+static wstring GetDataConfigKey(const ScriptableObjects::IConfigRecord&)
+{
+    return L""; // not available for BrainScript, where the 'preComputeCacheKey' option of SGD identifies the data
+}
+static wstring GetDataConfigKey(const ConfigParameters& config)
+{
+    return config.Exists(L"reader") ? ToFixedWStringFromMultiByte(string(config(L"reader"))) : L"";
+}
+
 template <class ConfigRecordType, typename ElemType>
 void DoTrain(const ConfigRecordType& config)
 {
@@ -123,6 +133,7 @@ void DoTrain(const ConfigRecordType& config)
         cvDataReader = CreateObject<DataReader>(config, L"cvReader");
 
     optimizer->InitMPI(MPIWrapper::GetInstance());
+    optimizer->SetPreComputeDataKey(GetDataConfigKey(config));
     optimizer->Train(net, deviceId, dataReader.get(), cvDataReader.get(), startEpoch, loadNetworkFromCheckpoint);
 }
 
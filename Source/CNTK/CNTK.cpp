@@ -14,6 +14,7 @@
 
 #include "Basics.h"
 #include "Globals.h"
+#include "Constants.h"
 #include "Actions.h"
 #include "ComputationNetwork.h"
 #include "ComputationNode.h"
@@ -23,7 +24,10 @@
 #include "NDLNetworkBuilder.h"
 #include "ModelEditLanguage.h"
 #include "CPUMatrix.h" // used for SetNumThreads()
+#include "NumaPolicy.h"
+#include "CuDnnAlgorithmCache.h"
 #include "CommonMatrix.h"
+#include "CUDAPageLockedMemAllocator.h"
 #include "SGD.h"
 #include "MPIWrapper.h"
 #include "EnvironmentUtil.h"
@@ -117,6 +121,38 @@ void ForceDeterministicAlgorithmsOnCPU()
     CPUMatrix<float /*any type will do*/>::SetCompatibleMode();
 }
 
+// 'numaPolicy' places the CPU matrices and reader buffers on the NUMA nodes, and pins the math threads to match.
+// With nodeLocal, 'numaNode' selects the node (default: by the local MPI rank), e.g. to confine each worker to one socket.
+void SetNumaPolicy(const wstring& policy, int node)
+{
+    NumaPolicyKind kind = NumaPolicy::Parse(policy);
+    if (kind == NumaPolicyKind::None)
+        return;
+    NumaPolicy::Set(kind, node);
+    LOGPRINTF(stderr, "Using NUMA policy '%ls' on %d NUMA nodes.\n", policy.c_str(), (int)NumaPolicy::GetNumNodes());
+}
+
+// 'hugePages' (none, transparent or explicit) backs the CPU matrices and reader buffers of at least 'hugePagesMinBytes' with
+// huge pages, which cuts the TLB misses over multi-GB parameters and chunk buffers.
+void SetHugePages(const wstring& kind, size_t minBytes)
+{
+    HugePageKind hugePageKind = HugePages::Parse(kind);
+    if (hugePageKind == HugePageKind::None)
+        return;
+    HugePages::Set(hugePageKind, minBytes);
+    LOGPRINTF(stderr, "Using %ls huge pages for CPU buffers of at least %zu bytes.\n", kind.c_str(), minBytes);
+}
+
+// 'cudnnAlgorithmCache' keeps the convolution algorithms found by the cuDNN autotuner in a file, for restarts and for the other
+// workers, of which only rank 0 writes it. With 'cudnnAutotuning=false' geometries that are not in the file are not benchmarked.
+void SetCuDnnAlgorithmCache(const wstring& path, bool tune, const shared_ptr<MPIWrapper>& mpi)
+{
+    if (path.empty())
+        return;
+    CuDnnAlgorithmCache::Set(path, /*writable=*/!mpi || mpi->CurrentNodeRank() == 0, tune);
+    LOGPRINTF(stderr, "Using the cuDNN algorithm cache '%ls'%s.\n", path.c_str(), tune ? "" : " without autotuning");
+}
+
 #ifndef CPUONLY
 // abort execution is GPU is not supported (e.g. compute capability not supported)
 void CheckSupportForGpu(DEVICEID_TYPE deviceId)
@@ -223,6 +259,18 @@ bool DispatchThisAction(const string &thisAction, const ConfigParameters &comman
     {
         DoCreateLabelMap<ElemType>(commandParams);
     }
+    else if (thisAction == "convertMLF")
+    {
+        DoConvertMLF<ElemType>(commandParams);
+    }
+    else if (thisAction == "convertCBF")
+    {
+        DoConvertCBF<ElemType>(commandParams);
+    }
+    else if (thisAction == "convertCTF")
+    {
+        DoConvertCTF<ElemType>(commandParams);
+    }
     else if (thisAction == "writeWordAndClass")
     {
         DoWriteWordAndClassInfo<ElemType>(commandParams);
@@ -273,6 +321,14 @@ void DoCommands(const ConfigParameters& config, const shared_ptr<MPIWrapper>& mp
         {
             LOGPRINTF(stderr, "Using %d CPU threads.\n", numCPUThreads);
         }
+
+        wstring numaPolicy = config(L"numaPolicy", L"none");
+        int numaNode = config(L"numaNode", -1);
+        SetNumaPolicy(numaPolicy, numaNode);
+
+        wstring hugePages = config(L"hugePages", L"none");
+        size_t hugePagesMinBytes = config(L"hugePagesMinBytes", (size_t)HugePages::DefaultMinBytes);
+        SetHugePages(hugePages, hugePagesMinBytes);
     }
 
     bool progressTracing = config(L"progressTracing", false);
@@ -537,8 +593,21 @@ int wmainWithBS(int argc, wchar_t* argv[]) // called from wmain which is a wrapp
 
     Globals::SetShareNodeValueMatrices(config(L"shareNodeValueMatrices", true));
     Globals::SetGradientAccumulationOptimization(config(L"optimizeGradientAccumulation", true));
+    Globals::SetActivationRecomputation(config(L"recomputeActivations", false));
+    Globals::SetGPUGraphCapture(config(L"captureGPUGraphs", false));
+    Globals::SetMultiStreamExecution(config(L"multiStreamExecution", false));
+    Globals::SetNumExecutionStreams(config(L"numExecutionStreams", (size_t)4));
+    Globals::SetInterOpParallelism(config(L"interOpParallelism", false));
+    Globals::SetFileWriteBlockSize(config(L"fileWriteBlockSizeInMB", (size_t)(DEFAULT_FILE_WRITE_BLOCK_SIZE_IN_BYTES >> 20)) << 20);
+    wstring compiledNetworkCacheDir = config(L"compiledNetworkCacheDir", L"");
+    ComputationNetwork::SetCompiledStructureCacheDirectory(compiledNetworkCacheDir);
 
     TracingGPUMemoryAllocator::SetTraceLevel(config(L"traceGPUMemoryAllocations", 0));
+    TracingGPUMemoryAllocator::SetCachingEnabled(config(L"cacheGPUMemoryAllocations", false));
+    TracingGPUMemoryAllocator::SetCacheLimitInMBs(config(L"gpuMemoryCacheLimitInMB", (size_t)0));
+    CUDAPageLockedMemAllocator::SetCacheLimitInMBs(config(L"pinnedMemoryCacheLimitInMB", (size_t)1024));
+    wstring cudnnAlgorithmCache = config(L"cudnnAlgorithmCache", L"");
+    SetCuDnnAlgorithmCache(cudnnAlgorithmCache, config(L"cudnnAutotuning", true), mpi);
 
     // logging
     wstring logpath = config(L"stderr", L"");
@@ -571,6 +640,14 @@ int wmainWithBS(int argc, wchar_t* argv[]) // called from wmain which is a wrapp
         numCPUThreads = CPUMatrix<float /*any will do*/>::SetNumThreads(numCPUThreads);
         if (numCPUThreads > 0)
             LOGPRINTF(stderr, "Using %d CPU threads.\n", numCPUThreads);
+
+        wstring numaPolicy = config(L"numaPolicy", L"none");
+        int numaNode = config(L"numaNode", -1);
+        SetNumaPolicy(numaPolicy, numaNode);
+
+        wstring hugePages = config(L"hugePages", L"none");
+        size_t hugePagesMinBytes = config(L"hugePagesMinBytes", (size_t)HugePages::DefaultMinBytes);
+        SetHugePages(hugePages, hugePagesMinBytes);
     }
 
     bool progressTracing = config(L"progressTracing", false);
@@ -689,8 +766,21 @@ int wmainOldCNTKConfig(int argc, wchar_t* argv[])
 
     Globals::SetShareNodeValueMatrices(config(L"shareNodeValueMatrices", true));
     Globals::SetGradientAccumulationOptimization(config(L"optimizeGradientAccumulation", true));
+    Globals::SetActivationRecomputation(config(L"recomputeActivations", false));
+    Globals::SetGPUGraphCapture(config(L"captureGPUGraphs", false));
+    Globals::SetMultiStreamExecution(config(L"multiStreamExecution", false));
+    Globals::SetNumExecutionStreams(config(L"numExecutionStreams", (size_t)4));
+    Globals::SetInterOpParallelism(config(L"interOpParallelism", false));
+    Globals::SetFileWriteBlockSize(config(L"fileWriteBlockSizeInMB", (size_t)(DEFAULT_FILE_WRITE_BLOCK_SIZE_IN_BYTES >> 20)) << 20);
+    wstring compiledNetworkCacheDir = config(L"compiledNetworkCacheDir", L"");
+    ComputationNetwork::SetCompiledStructureCacheDirectory(compiledNetworkCacheDir);
 
     TracingGPUMemoryAllocator::SetTraceLevel(config(L"traceGPUMemoryAllocations", 0));
+    TracingGPUMemoryAllocator::SetCachingEnabled(config(L"cacheGPUMemoryAllocations", false));
+    TracingGPUMemoryAllocator::SetCacheLimitInMBs(config(L"gpuMemoryCacheLimitInMB", (size_t)0));
+    CUDAPageLockedMemAllocator::SetCacheLimitInMBs(config(L"pinnedMemoryCacheLimitInMB", (size_t)1024));
+    wstring cudnnAlgorithmCache = config(L"cudnnAlgorithmCache", L"");
+    SetCuDnnAlgorithmCache(cudnnAlgorithmCache, config(L"cudnnAutotuning", true), mpi);
 
     if (logpath != L"")
     {
@@ -88,6 +88,7 @@ namespace CNTK
         Float16 = 4,
         Int8 = 5,
         Int16 = 6,
+        BFloat16 = 7, // So far only used internally; there is no public type for its elements.
 
         /* TODO:
         Bit,
@@ -141,6 +142,8 @@ namespace CNTK
             return "Int8";
         else if (dataType == DataType::Int16)
             return "Int16";
+        else if (dataType == DataType::BFloat16)
+            return "BFloat16";
         else
             LogicError("Unknown DataType.");
     }
@@ -157,6 +160,8 @@ namespace CNTK
             return sizeof(int8_t);
         else if (dataType == DataType::Int16)
             return sizeof(int16_t);
+        else if (dataType == DataType::BFloat16)
+            return sizeof(uint16_t);
         else
             LogicError("Unknown DataType.");
     }
@@ -670,6 +675,7 @@ namespace CNTK
         friend class BlockMomentumDistributedLearner;
         friend class Internal::VariableResolver;
         friend class Trainer;
+        friend class BeamSearchDecoderImpl;
 
         template <typename T, typename ...CtorArgTypes>
         friend inline std::shared_ptr<T> MakeSharedObject(CtorArgTypes&& ...ctorArgs);
@@ -872,6 +878,11 @@ namespace CNTK
         ///
         CNTK_API bool IsSliceView();
 
+        ///
+        /// Returns a boolean indicating if the elements of 'this' view are contiguous in memory, i.e. 'this' view is not a strided slice.
+        ///
+        CNTK_API bool IsContiguous() const;
+
         // TODO: The set methods should be offered in template from
         ///
         /// Fill 'this' NDArrayView with the specified value. The underlying DataType of 'this' view should be DataType::Float.
@@ -927,9 +938,18 @@ namespace CNTK
         ///
         /// Creates a new NDArrayView which is an alias of a slice of 'this' view; i.e. a new view over the underlying data
         /// corresponding to the specified slice of 'this' view.
+        /// A slice that is not contiguous in memory is a strided view, which is read and written without copying the data
+        /// by CopyFrom() and the TensorView kernels; it is only copied when a contiguous buffer is needed. It has no DataBuffer()
+        /// and cannot be reshaped by AsShape(), but DeepClone() yields a contiguous copy.
         ///
         CNTK_API NDArrayViewPtr SliceView(const std::vector<size_t>& startOffset, const std::vector<size_t>& extent, bool readOnly = false) const;
 
+        ///
+        /// Creates a new NDArrayView which is an alias of a strided slice of 'this' view, with 'extent' elements along each axis
+        /// taken every 'strides' elements from 'startOffset'. Missing trailing strides are 1.
+        ///
+        CNTK_API NDArrayViewPtr SliceView(const std::vector<size_t>& startOffset, const std::vector<size_t>& extent, const std::vector<size_t>& strides, bool readOnly = false) const;
+
         ///
         /// Creates a new NDArrayView which is an alias of 'this' view but with a new shape.
         ///
@@ -3161,6 +3181,15 @@ namespace CNTK
         /// ONNX support limited subset of CNTK.
         ///
         ONNX,
+
+        ///
+        /// CNTK version 2 format with the parameter values stored as an aligned blob after the graph. When loaded to
+        /// the CPU, parameters are read-only views over a shared mapping of the file: loading does not copy them,
+        /// and processes that load the same file share the memory. On any device, a parameter is only read from
+        /// the file when its value is first used, so parameters of unused parts of the model are never loaded.
+        /// Function::Load detects this format by itself.
+        ///
+        CNTKv2MemoryMapped,
     };
 
 
@@ -3209,6 +3238,71 @@ namespace CNTK
         return nullptr;
     };
 
+    ///
+    /// What Function::Prepare() prepared for each of the expected shapes of its arguments, in the order they were given.
+    ///
+    struct FunctionPreparationReport
+    {
+        struct Entry
+        {
+            std::unordered_map<Variable, NDShape> argumentShapes; // the shapes of the values of the arguments, including their dynamic axes
+            double coldMs;                       // the first forward pass, which compiled the network and chose and allocated what it needed
+            double warmMs;                       // a second forward pass, as requests of these shapes are served from now on
+            uint64_t numStorageAllocations;      // matrix storage allocations of the first forward pass
+            uint64_t numWarmStorageAllocations;  // those of the second one, which are 0 once the network is prepared
+        };
+
+        std::vector<Entry> entries;
+        size_t numNetworkVariants; // distinct shapes of the samples, each of which needs its own compiled network
+        bool allVariantsKept;      // false if there are more of them than Internal::GetMaxNumCompiledNetworksPerFunction() keeps
+        double totalMs;
+    };
+
+    ///
+    /// Interface that a native user-defined Function may implement in addition to deriving from Function, to be computed by the network
+    /// directly on the buffers that its node preallocated on the device, instead of through Values passed to Function::Forward and Function::Backward.
+    /// An input or output with dynamic axes is the NDArrayView of the whole minibatch (or of the time step within a recurrent loop), with the
+    /// shape of its samples followed by the number of columns of the minibatch in the packed layout of the network; the outputs have the
+    /// columns of the inputs. The outputs must not have free dimensions, otherwise the Function is computed through its Values.
+    /// The buffers are only valid during the call. 'computeStream' is the CUDA stream (cudaStream_t) that the network computes on, or null on the CPU;
+    /// work launched on it needs no synchronization.
+    ///
+    class DeviceBufferUserFunction
+    {
+    public:
+        virtual ~DeviceBufferUserFunction() {}
+
+        ///
+        /// Computes the 'outputs' of the Function, one per Outputs(), from its 'inputs', one per Inputs().
+        ///
+        virtual void ForwardOnDevice(const std::vector<NDArrayViewPtr>& inputs, const std::vector<NDArrayViewPtr>& outputs, void* computeStream, bool isTraining) = 0;
+
+        ///
+        /// Backpropagates the 'outputGradients' to the 'inputGradients' that are not null, which may be only some of the inputs needing a gradient
+        /// per call. The gradient is assigned to inputGradients[i] if overwriteInputGradients[i], otherwise it is added to it.
+        /// 'inputs' and 'outputs' are the values of the forward pass, null where declared as unused below, and so are the gradients of the outputs that need none.
+        ///
+        virtual void BackwardOnDevice(const std::vector<NDArrayViewPtr>& inputs, const std::vector<NDArrayViewPtr>& outputs,
+                                      const std::vector<NDArrayViewPtr>& outputGradients, const std::vector<NDArrayViewPtr>& inputGradients,
+                                      const std::vector<bool>& overwriteInputGradients, void* computeStream) = 0;
+
+        ///
+        /// Returns false if BackwardOnDevice does not read the outputs, so that the network can reuse their buffers before backpropagation.
+        ///
+        virtual bool OutputsUsedInBackward() const { return true; }
+
+        ///
+        /// Returns false if BackwardOnDevice does not read the value of the input 'inputIndex', so that the network can reuse its buffer before backpropagation.
+        ///
+        virtual bool InputUsedInBackward(size_t /*inputIndex*/) const { return true; }
+
+        ///
+        /// Returns true if the gradient of the input 'inputIndex' may be computed in place of the gradient of the first output, e.g. for an elementwise Function
+        /// whose first output has the shape of the input. The network then backpropagates into the same buffer for both.
+        ///
+        virtual bool InputGradientInPlace(size_t /*inputIndex*/) const { return false; }
+    };
+
     ///
     /// Represents a function (optionally differentiable w.r.t. its inputs)
     /// A Function denotes a symbolic computation with zero or more input arguments and one or more outputs.
@@ -3376,6 +3470,27 @@ namespace CNTK
                                std::unordered_map<Variable, ValuePtr>& outputs,
                                const DeviceDescriptor& computeDevice = DeviceDescriptor::UseDefaultDevice());
 
+        ///
+        /// Prepares 'this' Function for serving requests whose arguments have the given shapes, so that the first requests are
+        /// not slower than the later ones: each entry of 'argumentShapes' holds the shape of the value of every argument, including
+        /// its dynamic axes, e.g. the sample shape followed by the batch size, or by the sequence length and the number of sequences.
+        /// Values of zeros of these shapes (all-zero sparse values for sparse arguments) are evaluated twice for the 'outputs'
+        /// (all outputs if empty), which compiles a network for every distinct shape of the samples and plans its memory, chooses
+        /// the algorithms of the convolutions, and grows the memory allocator to what these requests need. The largest shapes are
+        /// evaluated first, so that the smaller ones fit into the memory they allocated. Must not be called while 'this' Function
+        /// is being evaluated.
+        ///
+        CNTK_API FunctionPreparationReport Prepare(const std::vector<std::unordered_map<Variable, NDShape>>& argumentShapes,
+                                                   const std::unordered_set<Variable>& outputs = {},
+                                                   const DeviceDescriptor& computeDevice = DeviceDescriptor::UseDefaultDevice());
+
+        ///
+        /// Prepares 'this' Function, whose arguments must have fully defined sample shapes, for batches of each of the 'batchSizes':
+        /// of that many samples, or for arguments with a sequence axis, of that many sequences of 'sequenceLength' samples.
+        ///
+        CNTK_API FunctionPreparationReport Prepare(const std::vector<size_t>& batchSizes, size_t sequenceLength = 1,
+                                                   const DeviceDescriptor& computeDevice = DeviceDescriptor::UseDefaultDevice());
+
         ///
         /// Clones 'this' Function. The parameters of the Function are either cloned, shared or frozen as specified by the parameterCloneMethod argument and
         /// any variable replacements requested are applied in the cloned Function instance.
@@ -3607,9 +3722,12 @@ namespace CNTK
 
         ///
         /// Save this Function graph into a model file.
+        /// For the ONNX format, 'optimizeONNXGraph' simplifies the exported graph for inference (removes redundant
+        /// Transposes and Reshapes, folds BatchNormalization into Conv and fuses MatMul+Add into Gemm), and
+        /// 'onnxDataType' DataType::Float16 converts the float tensors of the exported model to float16.
         ///
         CNTK_API void Save(const std::wstring& filepath, ModelFormat format = ModelFormat::CNTKv2,
-            bool useExternalFilesToStoreParameters = false);
+            bool useExternalFilesToStoreParameters = false, bool optimizeONNXGraph = false, DataType onnxDataType = DataType::Unknown);
 
         ///
         /// Restore the models parameters (in-place) from a model file
@@ -3713,29 +3831,54 @@ namespace CNTK
             PreorderTraverseFunctions(rootFunction, visitedFunctions, functor, traverseInsideBlockFunction);
         }
 
-        // Recursively traverses the Function graph underlying the 'rootFunction' invoking the provided functor for all visited nodes in the graph.
+        // Traverses the Function graph underlying the 'rootFunction' depth-first, invoking the provided functor for all visited nodes in the graph.
+        // The traversal keeps its own stack, so that the depth of the graph is not limited by the call stack, and reads the
+        // inputs of the primitive Functions in place.
         template <typename FunctionType>
         static void PreorderTraverseFunctions(const FunctionPtr& rootFunction, std::unordered_set<FunctionPtr>& visitedFunctions, const FunctionType& functor, bool traverseInsideBlockFunction = false)
         {
-            visitedFunctions.insert(rootFunction);
-            functor(rootFunction);
-
-            if (rootFunction->IsComposite())
-                PreorderTraverseFunctions(rootFunction->RootFunction(), visitedFunctions, functor, traverseInsideBlockFunction);
-            else
+            struct Frame
             {
-                if (traverseInsideBlockFunction && rootFunction->IsBlock())
-                    PreorderTraverseFunctions(rootFunction->BlockRoot(), visitedFunctions, functor, traverseInsideBlockFunction);
-
-                std::vector<Variable> rootFunctionInputs = rootFunction->Inputs();
-                for (const auto& rootInput : rootFunctionInputs)
+                FunctionPtr m_function;
+                FunctionPtr m_nested; // the root of a composite, or of the inside of a block, which is traversed before the inputs
+                size_t m_nextInput;
+            };
+
+            std::vector<Frame> frames;
+            auto visit = [&](const FunctionPtr& function) {
+                visitedFunctions.insert(function);
+                functor(function);
+
+                FunctionPtr nested;
+                if (function->IsComposite())
+                    nested = function->RootFunction();
+                else if (traverseInsideBlockFunction && function->IsBlock())
+                    nested = function->BlockRoot();
+                frames.push_back(Frame{ function, std::move(nested), 0 });
+            };
+
+            visit(rootFunction);
+            while (!frames.empty())
+            {
+                auto& frame = frames.back();
+                if (frame.m_nested)
                 {
-                    if (rootInput.IsOutput() && visitedFunctions.find(rootInput.Owner()) == visitedFunctions.end())
+                    FunctionPtr nested = std::move(frame.m_nested);
+                    frame.m_nested = nullptr;
+                    visit(nested);
+                }
+                else if (!frame.m_function->IsComposite() && frame.m_nextInput < frame.m_function->m_inputs.size())
+                {
+                    const auto& input = frame.m_function->m_inputs[frame.m_nextInput++];
+                    if (input.IsOutput())
                     {
-                        const auto& function = rootInput.Owner();
-                        PreorderTraverseFunctions(function, visitedFunctions, functor, traverseInsideBlockFunction);
+                        FunctionPtr owner = input.Owner();
+                        if (visitedFunctions.find(owner) == visitedFunctions.end())
+                            visit(owner);
                     }
                 }
+                else
+                    frames.pop_back();
             }
         }
 
@@ -4663,6 +4806,7 @@ namespace CNTK
 
     ///
     /// Create an instance of the CNTK built-in ROI pooling operation on specified tensor input operands with the specified output shape
+    /// PoolingType::Average selects ROI align, which averages bilinearly interpolated points of bins that are not quantized.
     ///
     CNTK_API FunctionPtr ROIPooling(const Variable& operand,
                                     const Variable& rois,
@@ -4724,6 +4868,17 @@ namespace CNTK
                                             bool disableRegularization = false,
                                             const std::wstring& name = L"");
 
+    ///
+    /// Create an instance of the layer normalization operation, which normalizes each sample of the 'operand' to zero mean and
+    /// unit variance over all its elements, and then scales and shifts it elementwise by 'scale' and 'bias'. 'scale' and 'bias'
+    /// have as many elements as the samples of 'operand', and take its shape if theirs is not known.
+    ///
+    CNTK_API FunctionPtr LayerNormalization(const Variable& operand,
+                                            const Variable& scale,
+                                            const Variable& bias,
+                                            double epsilon = 0.00001,
+                                            const std::wstring& name = L"");
+
     //
     // Local response normalization as described in http://papers.nips.cc/paper/4824-imagenet-classification-with-deep-convolutional-neural-networks 
     //
@@ -5085,6 +5240,21 @@ namespace CNTK
         TrainingParameterSchedule<double> gaussianNoiseInjectionStdDev = 0.0;
         double gradientClippingThresholdPerSample = std::numeric_limits<double>::infinity();
         bool gradientClippingWithTruncation = true;
+        // scales down the gradients of all parameters together whenever their global norm exceeds this threshold (per sample)
+        double gradientClippingGlobalNormThresholdPerSample = std::numeric_limits<double>::infinity();
+        // with sparse (e.g. embedding) gradients, makes the Adam learners update only the smoothed gradients and the values
+        // of the columns present in the gradients, like the momentum learners always do
+        bool lazySparseUpdates = false;
+        // with lazy sparse updates, decays the smoothed gradients of a column for the minibatches that did not update it
+        // when it is next updated, so that they match the dense updates
+        bool lazySparseUpdateDecayCatchUp = false;
+        // zeroes this fraction of the blocks of blockPruningRows x blockPruningColumns elements of each weight matrix
+        // (the first axis of a parameter by the others), those with the smallest L1 norms, after every update.
+        // The blocks are chosen anew whenever the scheduled value changes, so it can be raised gradually.
+        // See Internal::EnableCPUBlockSparseInference() for evaluating the pruned weights.
+        TrainingParameterSchedule<double> blockPruningSparsity = 0.0;
+        size_t blockPruningRows = 4;
+        size_t blockPruningColumns = 1;
 
         Dictionary dictOptions;
     };
@@ -5115,6 +5285,11 @@ namespace CNTK
         /// A special value that can be used for the minibatchSize to indicate that the reference minibatch size is not specified.
         ///
         CNTK_API static const size_t IgnoredMinibatchSize;
+        ///
+        /// Keys of the loss scale of mixed-precision training and of whether the last update was skipped because of it.
+        ///
+        CNTK_API static const std::wstring LossScaleKey;
+        CNTK_API static const std::wstring GradientOverflowKey;
 
     public:
         //
@@ -5210,6 +5385,18 @@ namespace CNTK
         CNTK_API void SetMinibatchSize(std::size_t minibatchSize) { GetOptions().Add(MinibatchSizeKey, minibatchSize); }
         CNTK_API std::size_t GetMinibatchSize() const { return GetOptions().GetOrElse(MinibatchSizeKey, IgnoredMinibatchSize); }
 
+        ///
+        /// With loss scaling (mixed-precision training, see Trainer::SetDynamicLossScaling()), the gradients passed to Update()
+        /// are those of the loss multiplied by this factor, which keeps small fp16 gradients from flushing to zero during backprop.
+        /// Update() then divides the gradients by it before using them, or skips the update of all parameters if any gradient
+        /// has overflowed (is infinite or NaN), which HasGradientOverflow() reports afterwards. Once a loss scale has been set,
+        /// that check is done even if it is 1. Only the built-in learners implement this, see SupportsLossScaling().
+        ///
+        CNTK_API virtual void SetLossScale(double lossScale) { GetOptions().Add(LossScaleKey, lossScale); }
+        CNTK_API virtual double GetLossScale() const { return GetOptions().GetOrElse(LossScaleKey, 1.0); }
+        CNTK_API virtual bool HasGradientOverflow() const { return GetOptions().GetOrElse(GradientOverflowKey, false); }
+        virtual bool SupportsLossScaling() const { return false; }
+
         CNTK_API void SetLearningRateSchedule(const LearningRateSchedule& learningRateSchedule) { m_learningRateSchedule = learningRateSchedule; }
         CNTK_API const LearningRateSchedule& GetLearningRateSchedule() const { return m_learningRateSchedule; }
 
@@ -5313,6 +5500,30 @@ namespace CNTK
                                     bool adamax = false,
                                     AdditionalLearningOptions additionalOptions = AdditionalLearningOptions());
 
+    ///
+    /// Create an instance of the LARS learner (layer-wise adaptive rate scaling, You et al. 2017): momentum SGD with the
+    /// learning rate of each parameter scaled by the ratio of the norm of the parameter to the norm of its gradient.
+    ///
+    CNTK_API LearnerPtr LARSLearner(const std::vector<Parameter>& parameters,
+                                    const LearningRateSchedule& learningRateSchedule,
+                                    const MomentumSchedule& momentumSchedule,
+                                    bool unitGain = DefaultUnitGainValue(),
+                                    double trustCoefficient = 0.001,
+                                    double epsilon = 1e-8,
+                                    AdditionalLearningOptions additionalOptions = AdditionalLearningOptions());
+
+    ///
+    /// Create an instance of the LAMB learner (layer-wise adaptive moments, You et al. 2019): Adam with the update of each
+    /// parameter scaled by the ratio of the norm of the parameter to the norm of the update.
+    ///
+    CNTK_API LearnerPtr LAMBLearner(const std::vector<Parameter>& parameters,
+                                    const LearningRateSchedule& learningRateSchedule,
+                                    const MomentumSchedule& momentumSchedule,
+                                    bool unitGain = DefaultUnitGainValue(),
+                                    const MomentumSchedule& varianceMomentumSchedule = DefaultVarianceMomentum,
+                                    double epsilon = 1e-6,
+                                    AdditionalLearningOptions additionalOptions = AdditionalLearningOptions());
+
     ///
     /// Create an instance of the CNTK built-in AdaGrad learner.
     ///
@@ -5394,6 +5605,12 @@ namespace CNTK
             m_learner->ResetSmoothedGradients();
         }
 
+        // the learner of the local parameters applies the loss scale, after the aggregation of the gradients
+        void SetLossScale(double lossScale) override { m_learner->SetLossScale(lossScale); }
+        double GetLossScale() const override { return m_learner->GetLossScale(); }
+        bool HasGradientOverflow() const override { return m_learner->HasGradientOverflow(); }
+        bool SupportsLossScaling() const override { return m_learner->SupportsLossScaling(); }
+
         //
         // Returns the total number of samples needed for warmup.
         // After reaching this number of samples the learner switches to the distributed mode.
@@ -5606,6 +5823,285 @@ namespace CNTK
     ///
     CNTK_API EvaluatorPtr CreateEvaluator(const FunctionPtr& evaluationFunction, const std::vector<ProgressWriterPtr>& progressWriters = {});
 
+    ///
+    /// Statistics of the requests served by a BatchingEvaluator.
+    ///
+    struct BatchingEvaluatorStatistics
+    {
+        size_t numRequests;          // requests evaluated so far
+        size_t numBatches;           // forward passes these requests were merged into
+        double p50QueueingLatencyMs; // median time a request waited for its batch to start, over the recent requests
+        double p99QueueingLatencyMs;
+    };
+
+    ///
+    /// BatchingEvaluator evaluates a model for requests that arrive concurrently, e.g. from the threads of a server.
+    /// Instead of running one forward pass per request, the pending requests are merged into one minibatch, which
+    /// is evaluated once the batch is full, or when the oldest request has waited for the maximum wait time. The
+    /// outputs are then split back into the requests. Each request is a batch of one or more sequences (or samples)
+    /// for each of the arguments of the model.
+    ///
+    class BatchingEvaluator : public std::enable_shared_from_this<BatchingEvaluator>
+    {
+    public:
+        ///
+        /// Evaluates the 'outputs' of the model for the 'arguments' of one request, which must contain a value for
+        /// every argument of the model, all with the same number of sequences. Blocks until the batch the request
+        /// was merged into has been evaluated. May be called from any number of threads at the same time.
+        /// A null value in 'outputs' is replaced by a new value; otherwise the output is copied into the given value.
+        ///
+        virtual void Evaluate(const std::unordered_map<Variable, ValuePtr>& arguments, std::unordered_map<Variable, ValuePtr>& outputs) = 0;
+
+        ///
+        /// Statistics of the requests served so far.
+        ///
+        virtual BatchingEvaluatorStatistics Statistics() const = 0;
+
+        ///
+        /// The model that is evaluated.
+        ///
+        virtual FunctionPtr Model() const = 0;
+
+        virtual ~BatchingEvaluator() {}
+    };
+
+    ///
+    /// Construct a BatchingEvaluator for 'model', which merges up to 'maxBatchSize' sequences into one forward pass on
+    /// 'device', and waits at most 'maxWaitMicroseconds' for further requests once a request is pending.
+    ///
+    CNTK_API BatchingEvaluatorPtr CreateBatchingEvaluator(const FunctionPtr& model, const DeviceDescriptor& device, size_t maxBatchSize, size_t maxWaitMicroseconds);
+
+    ///
+    /// The stream on which the contexts of an EvaluatorPool issue their GPU work.
+    ///
+    enum class EvaluationStreamPriority
+    {
+        ///
+        /// The work is issued on the default stream of the device, with the other work of the process.
+        ///
+        Shared,
+
+        ///
+        /// Each context has a stream of its own, with the lowest priority of the device, e.g. for batch scoring.
+        ///
+        Low,
+
+        ///
+        /// Each context has a stream of its own, with the highest priority of the device: its kernels are scheduled ahead
+        /// of the pending kernels of the other streams, e.g. for latency critical requests next to batch scoring.
+        ///
+        High,
+    };
+
+    ///
+    /// EvaluatorPool evaluates a model for many threads with a few evaluation contexts. Each context is a clone of
+    /// the model with its own compiled network, i.e. its own activations, served by its own worker thread; the
+    /// contexts on one device share the storage of the Parameters and Constants. Requests are queued, and the next
+    /// free context takes the oldest one, so that the memory for activations grows with the number of contexts
+    /// rather than with the number of calling threads.
+    ///
+    class EvaluatorPool : public std::enable_shared_from_this<EvaluatorPool>
+    {
+    public:
+        ///
+        /// Queues the evaluation of the 'outputs' of the model for the 'arguments', which are keyed by the Variables of
+        /// Model(). Both maps must stay alive until Wait() has returned for the returned ticket.
+        /// A null value in 'outputs' is replaced by a new value; otherwise the output is copied into the given value.
+        ///
+        virtual size_t Submit(const std::unordered_map<Variable, ValuePtr>& arguments, std::unordered_map<Variable, ValuePtr>& outputs) = 0;
+
+        ///
+        /// Blocks until the request of 'ticket' has been evaluated, and rethrows its error if it failed.
+        /// Each ticket is waited for exactly once.
+        ///
+        virtual void Wait(size_t ticket) = 0;
+
+        ///
+        /// Submits a request and waits for it.
+        ///
+        void Evaluate(const std::unordered_map<Variable, ValuePtr>& arguments, std::unordered_map<Variable, ValuePtr>& outputs)
+        {
+            Wait(Submit(arguments, outputs));
+        }
+
+        ///
+        /// Number of evaluation contexts.
+        ///
+        virtual size_t NumContexts() const = 0;
+
+        ///
+        /// The model that is evaluated.
+        ///
+        virtual FunctionPtr Model() const = 0;
+
+        ///
+        /// Replaces the values of Parameters and Constants of Model(), given by their uid; the others keep their values.
+        /// Each value must have the shape and data type of the one it replaces. The values are first copied to the devices
+        /// of the pool while the contexts keep serving; then the requests being evaluated finish, and the values are copied
+        /// into the storage of the contexts before any further request is evaluated, so that each request sees either the
+        /// old or the new values. The compiled networks, their memory and the cuDNN algorithms are kept, except for networks
+        /// simplified by Internal::EnableInferenceGraphOptimization(), which hold values computed from the Parameters.
+        /// Parameters and Constants of Model() on one of the devices are updated themselves.
+        ///
+        virtual void UpdateParameters(const std::unordered_map<std::wstring, NDArrayViewPtr>& values) = 0;
+
+        ///
+        /// Replaces the values of the Parameters of Model() by those of the Parameters of 'source' with the same uid, e.g. a
+        /// retrained version of the model loaded by Function::Load(), and likewise the values of the Constants that both have.
+        ///
+        void UpdateParameters(const FunctionPtr& source)
+        {
+            std::unordered_set<std::wstring> constants;
+            for (const auto& constant : Model()->Constants())
+                constants.insert(constant.Uid());
+
+            std::unordered_map<std::wstring, NDArrayViewPtr> values;
+            for (const auto& parameter : source->Parameters())
+                values[parameter.Uid()] = parameter.Value();
+            for (const auto& constant : source->Constants())
+            {
+                if (constants.find(constant.Uid()) != constants.end())
+                    values[constant.Uid()] = constant.Value();
+            }
+            UpdateParameters(values);
+        }
+
+        virtual ~EvaluatorPool() {}
+    };
+
+    ///
+    /// Construct an EvaluatorPool for 'model' with 'numContextsPerDevice' contexts on each of the 'devices'.
+    /// With 'maxBatchSize' > 0, the activations of each context are allocated ahead for batches of that many
+    /// samples, so that they do not grow while serving. With 'pinToNumaNodes', the worker threads of the contexts
+    /// (and the threads they start) are pinned round-robin to the NUMA nodes. With a 'streamPriority' other than
+    /// Shared, the contexts on GPUs issue their kernels, cuBLAS, cuDNN and cuSPARSE calls and the copies of their
+    /// inputs and outputs on streams of their own, with that priority.
+    ///
+    CNTK_API EvaluatorPoolPtr CreateEvaluatorPool(const FunctionPtr& model, const std::vector<DeviceDescriptor>& devices, size_t numContextsPerDevice, size_t maxBatchSize = 0, bool pinToNumaNodes = false,
+                                                  EvaluationStreamPriority streamPriority = EvaluationStreamPriority::Shared);
+
+    ///
+    /// A stream of a StreamingEvaluator, e.g. the audio of one speaker: the state that the PastValue recurrences of
+    /// the model carry over from the frames the stream has been fed so far. The state stays on the device of the evaluator.
+    ///
+    class StreamContext
+    {
+    public:
+        ///
+        /// Number of frames the stream has been fed since it was created or reset.
+        ///
+        virtual size_t NumFrames() const = 0;
+
+        ///
+        /// Starts the stream over: its next chunk begins a new sequence. Must not be called during an evaluation of the stream.
+        ///
+        virtual void Reset() = 0;
+
+        virtual ~StreamContext() {}
+    };
+
+    ///
+    /// StreamingEvaluator evaluates a recurrent model chunk by chunk, for low-latency inference on streams whose
+    /// sequences arrive a few frames at a time. Each chunk continues the sequence of its stream: the PastValue
+    /// recurrences of the model see the frames of the earlier chunks, as if the whole sequence had been evaluated at
+    /// once. The chunks of many streams are evaluated in one forward pass, with the state of each stream implanted
+    /// into its parallel sequence of the minibatch. Models that look into the future (FutureValue) cannot be streamed.
+    ///
+    class StreamingEvaluator : public std::enable_shared_from_this<StreamingEvaluator>
+    {
+    public:
+        ///
+        /// Creates a new stream, whose first chunk begins a sequence.
+        ///
+        virtual StreamContextPtr CreateStream() = 0;
+
+        ///
+        /// Evaluates the next chunk of each of the 'streams', which must be distinct streams of this evaluator, in one forward
+        /// pass. 'chunks[i]' holds the frames of the chunk of 'streams[i]', a value of one sequence for every argument of the
+        /// model, and 'outputs[i]' receives its outputs, each as a value of one sequence. A null value in 'outputs[i]' is
+        /// replaced by a new value; otherwise the output is copied into the given value. May be called from many threads at
+        /// the same time; the calls are evaluated one after the other.
+        ///
+        virtual void Evaluate(const std::vector<StreamContextPtr>& streams,
+                              const std::vector<std::unordered_map<Variable, ValuePtr>>& chunks,
+                              std::vector<std::unordered_map<Variable, ValuePtr>>& outputs) = 0;
+
+        ///
+        /// Evaluates the next chunk of one stream.
+        ///
+        void Evaluate(const StreamContextPtr& stream, const std::unordered_map<Variable, ValuePtr>& chunk, std::unordered_map<Variable, ValuePtr>& outputs)
+        {
+            std::vector<std::unordered_map<Variable, ValuePtr>> streamOutputs = { outputs };
+            Evaluate({ stream }, { chunk }, streamOutputs);
+            outputs = std::move(streamOutputs.front());
+        }
+
+        ///
+        /// The model that is evaluated.
+        ///
+        virtual FunctionPtr Model() const = 0;
+
+        virtual ~StreamingEvaluator() {}
+    };
+
+    ///
+    /// Construct a StreamingEvaluator for 'model' on 'device'. The evaluator works on its own clone of the model, which
+    /// shares the Parameters, so that evaluating 'model' directly is not affected by the state of the streams.
+    ///
+    CNTK_API StreamingEvaluatorPtr CreateStreamingEvaluator(const FunctionPtr& model, const DeviceDescriptor& device);
+
+    ///
+    /// Options of a BeamSearchDecoder.
+    ///
+    struct BeamSearchOptions
+    {
+        size_t beamWidth = 4;                      // hypotheses kept for each sentence
+        size_t maxLength = 100;                    // tokens decoded at most for a hypothesis, including the end token
+        double lengthNormalizationExponent = 0.0;  // the final hypotheses are ranked by score / length^exponent
+    };
+
+    ///
+    /// A decoded hypothesis: the tokens after the start token, ending with the end token if the hypothesis finished,
+    /// and the sum of the log probabilities of the tokens, normalized by the length.
+    ///
+    struct BeamSearchHypothesis
+    {
+        std::vector<size_t> tokens;
+        double score;
+    };
+
+    ///
+    /// BeamSearchDecoder decodes sequences by running a step function once per output token, for the beams of a batch
+    /// of sentences at once. The step function maps the previous token, the states and any further inputs (e.g. the
+    /// encoded source sentence) to the log probabilities of the next token and the next states. The scores, the states
+    /// and the log probabilities stay on the device: the best candidates of each sentence are selected there, and the
+    /// states are reordered there to follow the beams they were selected from. Only the indices of the selected
+    /// candidates are copied to the host in each step.
+    ///
+    class BeamSearchDecoder : public std::enable_shared_from_this<BeamSearchDecoder>
+    {
+    public:
+        ///
+        /// Decodes the sentences whose 'inputs' are given: a batch of samples for every argument of the step function
+        /// other than the token input, all with the same number of samples, one per sentence. The values of the state
+        /// arguments are the initial states. Returns the hypotheses of each sentence, best first.
+        ///
+        virtual std::vector<std::vector<BeamSearchHypothesis>> Decode(const std::unordered_map<Variable, ValuePtr>& inputs) = 0;
+
+        virtual ~BeamSearchDecoder() {}
+    };
+
+    ///
+    /// Construct a BeamSearchDecoder for 'stepFunction', whose arguments must only have the batch axis. 'tokenInput' is
+    /// the argument that takes the index of the previous token, as a value of shape [1]; 'logProbabilities' is the output
+    /// with the log probabilities of the next token, of shape [vocabulary size]. 'states' maps each state argument to the
+    /// output that is its value for the next step. Decoding starts with 'startToken', and a hypothesis is finished once
+    /// it has emitted 'endToken'.
+    ///
+    CNTK_API BeamSearchDecoderPtr CreateBeamSearchDecoder(const FunctionPtr& stepFunction, const Variable& tokenInput, const Variable& logProbabilities,
+                                                          const std::unordered_map<Variable, Variable>& states, size_t startToken, size_t endToken,
+                                                          const DeviceDescriptor& device, const BeamSearchOptions& options = BeamSearchOptions());
+
     enum class DataUnit : unsigned int
     {
         ///Indiciate that the frequency of action is counted by sweep.
@@ -5651,8 +6147,15 @@ namespace CNTK
 
         ///
         /// Checkpoint the model and other Trainer state at the specified file location
+        /// With 'inBackground', the state is copied to the CPU right away, but serialized and written to the files by a background
+        /// thread while training continues. Only one checkpoint is written at a time; the next one waits for the previous.
+        ///
+        CNTK_API void SaveCheckpoint(const std::wstring& filePath, Dictionary externalState = Dictionary(), bool inBackground = false);
+
+        ///
+        /// Blocks until the checkpoint being written in the background, if any, is on disk. Rethrows the error if writing it failed.
         ///
-        CNTK_API void SaveCheckpoint(const std::wstring& filePath, Dictionary externalState = Dictionary());
+        CNTK_API void WaitForCheckpoint();
 
         ///
         /// Restore the model and trainer state from a previously saved model and checkpoint from the specified file location
@@ -5699,6 +6202,34 @@ namespace CNTK
         ///
         CNTK_API size_t TotalNumberOfUnitsSeen(DataUnit unit = DataUnit::Sample) const;
 
+        ///
+        /// Mixed-precision training: dynamic loss scaling. The gradient of the loss is scaled by LossScale() in backprop, so that
+        /// small fp16 gradients do not flush to zero, and the learners divide the parameter gradients by it again (see
+        /// Learner::SetLossScale()). When a gradient overflows, the learners skip the update and the loss scale is halved;
+        /// after 'growthInterval' updates without overflow it is doubled.
+        ///
+        CNTK_API void SetDynamicLossScaling(bool enable, double initialLossScale = 65536.0, size_t growthInterval = 2000);
+
+        ///
+        /// The current loss scale, 1 unless dynamic loss scaling is enabled.
+        ///
+        double LossScale() const { return m_lossScale; }
+
+        ///
+        /// Gradient accumulation, to train with minibatches that are too large for the device: each TrainMinibatch() call runs forward
+        /// and backward on its minibatch, adding the gradients to those of the previous calls in the gradient buffers of the network,
+        /// and only every 'numMinibatchesPerUpdate'-th call updates the parameters (and aggregates the gradients across distributed
+        /// workers) as if with one minibatch of all their samples. The loss and evaluation criterion are reported to the progress
+        /// writers, and returned by PreviousMinibatchLossAverage() etc., for the whole update. 1, the default, disables it. A checkpoint
+        /// does not include the gradients of an update in progress.
+        ///
+        CNTK_API void SetGradientAccumulation(size_t numMinibatchesPerUpdate);
+
+        ///
+        /// The number of TrainMinibatch() calls per update of the parameters, see SetGradientAccumulation().
+        ///
+        size_t NumMinibatchesPerUpdate() const { return m_numMinibatchesPerUpdate; }
+
         ///
         /// Writes the summary of training progress and resets the accumulators.
         ///
@@ -5709,6 +6240,8 @@ namespace CNTK
         ///
         CNTK_API virtual void PrintNodeTiming();
 
+        CNTK_API virtual ~Trainer();
+
     private:
         template <typename T1, typename ...CtorArgTypes>
         friend std::shared_ptr<T1> MakeSharedObject(CtorArgTypes&& ...ctorArgs);
@@ -5728,9 +6261,12 @@ namespace CNTK
 
         bool TrainLocalMinibatch(const std::unordered_map<Variable, ValuePtr>& arguments, std::unordered_map<Variable, ValuePtr>& outputsToFetch, bool sweepEnd, const DeviceDescriptor& computeDevice);
         bool TrainDistributedMinibatch(const std::unordered_map<Variable, ValuePtr>& arguments, std::unordered_map<Variable, ValuePtr>& outputsToFetch, bool sweepEnd, const DeviceDescriptor& computeDevice);
+        void AdjustLossScale();
+        bool AccumulateMinibatch(const std::unordered_map<Variable, ValuePtr>& arguments, std::unordered_map<Variable, ValuePtr>& outputsToFetch, bool sweepEnd, const DeviceDescriptor& computeDevice);
+        bool EndGradientAccumulation(std::unordered_map<Parameter, NDArrayViewPtr>& gradients);
 
         void Save(const std::wstring& modelFilePath, const std::vector<DictionaryValue>& learnerState,
-            const Dictionary& externalState, const Dictionary& distributedState = {});
+            const Dictionary& externalState, const Dictionary& distributedState = {}, bool inBackground = false);
 
         void UpdateTrainingProgress(size_t numSamples, const ValuePtr& loss, const ValuePtr& evalCriterion, const DeviceDescriptor& computeDevice);
         void AddProgressWriters(const std::vector<ProgressWriterPtr>& progressWriters);
@@ -5754,6 +6290,24 @@ namespace CNTK
         AccumulatorPtr m_aggregatedTrainingEvalCriterionValue;
 
         size_t m_prevDistributedTotalNumSamples;
+
+        bool   m_dynamicLossScaling;
+        double m_lossScale;
+        size_t m_lossScaleGrowthInterval;
+        size_t m_numUpdatesWithoutOverflow;
+
+        // Gradient accumulation, see SetGradientAccumulation(): the minibatches and samples accumulated so far for the next update,
+        // the gradients of the parameters (in the network, holding the sum), and the sums of the loss and evaluation criterion
+        size_t m_numMinibatchesPerUpdate;
+        size_t m_numAccumulatedMinibatches;
+        size_t m_numAccumulatedSamples;
+        bool   m_accumulatedSweepEnd;
+        std::unordered_map<Parameter, NDArrayViewPtr> m_accumulatedGradients;
+        AccumulatorPtr m_accumulatedTrainingLossValue;
+        AccumulatorPtr m_accumulatedTrainingEvalCriterionValue;
+
+        std::future<void> m_pendingCheckpoint; // the checkpoint being written in the background
+        bool m_checkpointedInBackground;
     };
 
     ///
@@ -6131,6 +6685,20 @@ namespace CNTK
         std::unordered_map<StreamInformation, std::pair<NDArrayViewPtr, NDArrayViewPtr>>& computedMeanAndVariances,
         const DeviceDescriptor& device = DeviceDescriptor::CPUDevice());
 
+    ///
+    /// Same as above, reading at most about 'maxNumSamples' samples (MinibatchSource::InfinitelyRepeat for all the data).
+    /// With a 'communicator', each worker reads its partition of the data on its own 'device', and the statistics of
+    /// all workers are merged once at the end; all workers get the same results. With a 'statisticsFile', the
+    /// statistics are loaded from it if it holds them for the same streams and sample budget, and are otherwise
+    /// computed and written to it, so that later runs do not need to read the data again.
+    ///
+    CNTK_API void ComputeInputPerDimMeansAndInvStdDevs(const MinibatchSourcePtr& minibatchSource,
+        std::unordered_map<StreamInformation, std::pair<NDArrayViewPtr, NDArrayViewPtr>>& computedMeanAndVariances,
+        const DeviceDescriptor& device,
+        size_t maxNumSamples,
+        const DistributedCommunicatorPtr& communicator = nullptr,
+        const std::wstring& statisticsFile = L"");
+
     ///
     /// Set the process-wide setting for maximum number of CPU threads to be used by any individual compute operation
     /// Note that this is a per compute operation limit and if the user performs multiple compute operations concurrently
@@ -6271,6 +6839,13 @@ namespace CNTK
     ///
     CNTK_API QuantizedDistributedCommunicatorPtr QuantizedMPICommunicator(bool zeroThresholdFor1Bit, bool useQuantizationForSelfStripe, size_t numQuantizationBits);
 
+    ///
+    /// Distributed communicator that aggregates only the 'density' fraction of the largest (by magnitude) gradient entries
+    /// of every worker and carries the rest over to the next aggregation (top-k sparsification with error feedback).
+    /// To be used with CreateQuantizedDataParallelDistributedLearner(), which keeps the residuals.
+    ///
+    CNTK_API QuantizedDistributedCommunicatorPtr SparsifiedMPICommunicator(double density);
+
     ///
     /// Cross validation configuration
     ///
@@ -6311,19 +6886,22 @@ namespace CNTK
         /// checkpointFrequencyInSamples: frequency in samples when to perform checkpointing.
         /// restoreFromCheckpointIfExists: if flag is set, the training session will try to restore before training.
         /// preserveAllCheckpoints: if flag is set, all checkpoints will be preserved.
+        /// saveInBackground: if flag is set, checkpoints are written by a background thread while training continues.
         ///
         CNTK_API CheckpointConfig(
             const std::wstring& checkPointFileName,
             size_t checkpointFrequency = std::numeric_limits<size_t>::max(),
             DataUnit checkpointFrequencyUnit = DataUnit::Sample,
             bool restoreFromCheckpointIfExists = true,
-            bool preserveAllCheckpoints = false);
+            bool preserveAllCheckpoints = false,
+            bool saveInBackground = false);
 
     private:
         friend class TrainingSession;
         const std::wstring m_fileName;
         const bool m_restore;
         const bool m_preserveAll;
+        const bool m_inBackground;
         const size_t m_frequency;
         const DataUnit m_frequencyUnit;
     };
@@ -6511,6 +7089,9 @@ namespace CNTK
         /// The firstUpdatesToWrite arguments only apply on arithemetic schedule. If specified, the first
         /// 'firstUpdatesToWrite' updates will be written explicitly before using an arithmetic schedule.
         ///
+        /// The loss and metric of an update accumulated on a GPU are read back without waiting for the device,
+        /// so the update is written at the next update or summary.
+        ///
         // TODO: Encapsulate (freq, firstToWrite) as an update schedule type.
         CNTK_API ProgressWriter(size_t trainingUpdateWriteFrequency, size_t trainingFirstUpdatesToWrite,
                                 size_t testUpdateWriteFrequency, size_t testFirstUpdatesToWrite,
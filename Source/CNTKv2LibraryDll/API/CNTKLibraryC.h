@@ -208,7 +208,9 @@ typedef struct CNTK_Value
 } CNTK_Value;
 
 //
-// Represents a value.
+// Evaluates the outputs of the model for a sequence of the inputs. The input buffers are used in place, without
+// copying them, unless the model is on a GPU. If *outputValues is not null, the outputs are written into
+// the preallocated buffers it points to; otherwise *outputValues is set to newly allocated values.
 //
 CNTK_API CNTK_StatusCode CNTK_EvaluateSequence(CNTK_ModelHandle model,
     /*[in]*/const CNTK_Variable* inputs,
@@ -219,6 +221,170 @@ CNTK_API CNTK_StatusCode CNTK_EvaluateSequence(CNTK_ModelHandle model,
     /*[in]*/uint32_t numOutputs,
     /*[in/out]*/CNTK_Value** outputValues);
 
+//
+// Evaluates like CNTK_EvaluateSequence, with the data of all values in caller-owned buffers on bufferDevice,
+// e.g. GPU memory or page-locked host memory. The input buffers are used in place and are not modified;
+// they are only copied if bufferDevice is not the device of the model. The outputs are written into the
+// preallocated outputValues, which are required, without intermediate host buffers.
+// The buffers must stay valid until the call returns.
+//
+// Parameters:
+//     bufferDevice [in]: device of the data of inputValues and outputValues. Null means the CPU.
+//
+CNTK_API CNTK_StatusCode CNTK_EvaluateSequenceOnDevice(CNTK_ModelHandle model,
+    /*[in]*/const CNTK_Variable* inputs,
+    /*[in]*/const CNTK_Value* inputValues,
+    /*[in]*/const bool* inputResetFlags,
+    /*[in]*/uint32_t numInputs,
+    /*[in]*/const CNTK_Variable* outputs,
+    /*[in]*/uint32_t numOutputs,
+    /*[in]*/const CNTK_DeviceDescriptor* bufferDevice,
+    /*[in/out]*/CNTK_Value* outputValues);
+
+//
+// Loads a model like CNTK_LoadModel, for serving: CNTK_EvaluateSequence may be called on the resulting handle
+// from many threads at the same time, and the sequences of concurrent calls are merged into one minibatch.
+// The minibatch is evaluated once it holds maxBatchSize sequences, or when the oldest call has waited for
+// maxWaitMicroseconds. CNTK_CloneModel of the handle returns a batching model with the same settings.
+// Since the state of a recurrence is not kept for a caller from one minibatch to the next, each call
+// must pass complete sequences, i.e. all inputResetFlags must be true.
+//
+// Parameters:
+//     modelFilePath [in]: a null-terminated path to a CNTK model file
+//     device [in]: device descriptor.
+//     maxBatchSize [in]: maximum number of sequences that are evaluated together
+//     maxWaitMicroseconds [in]: maximum time a call waits for further calls
+//     model [out]: the resulting loaded model
+//
+CNTK_API CNTK_StatusCode CNTK_LoadBatchingModel(
+    /*[in]*/ const char* modelFilePath,
+    /*[in]*/ const CNTK_DeviceDescriptor* device,
+    /*[in]*/ uint32_t maxBatchSize,
+    /*[in]*/ uint32_t maxWaitMicroseconds,
+    /*[out]*/ CNTK_ModelHandle* model);
+
+//
+// Loads a model like CNTK_LoadModel, for serving many threads: CNTK_EvaluateSequence may be called on the
+// resulting handle from any number of threads at the same time. The calls are served by numContexts evaluation
+// contexts, which share the parameters of the model, so that the memory for activations does not grow with
+// the number of calling threads. CNTK_CloneModel of the handle returns a pooled model with the same settings.
+//
+// Parameters:
+//     modelFilePath [in]: a null-terminated path to a CNTK model file
+//     device [in]: device descriptor.
+//     numContexts [in]: number of calls that are evaluated at the same time
+//     model [out]: the resulting loaded model
+//
+CNTK_API CNTK_StatusCode CNTK_LoadPooledModel(
+    /*[in]*/ const char* modelFilePath,
+    /*[in]*/ const CNTK_DeviceDescriptor* device,
+    /*[in]*/ uint32_t numContexts,
+    /*[out]*/ CNTK_ModelHandle* model);
+
+//
+// Statistics of the calls served by a batching model. Counterpart of CNTK::BatchingEvaluatorStatistics.
+//
+typedef struct CNTK_BatchingStatistics
+{
+    uint64_t numRequests;        // Number of evaluated calls
+    uint64_t numBatches;         // Number of minibatches these calls were merged into
+    double p50QueueingLatencyMs; // Median time a call waited for its minibatch to start, over the recent calls
+    double p99QueueingLatencyMs; // 99th percentile of that time
+} CNTK_BatchingStatistics;
+
+//
+// Gets the statistics of a model loaded by CNTK_LoadBatchingModel.
+//
+// Parameters:
+//    model [in]: batching model
+//    statistics [out]: statistics of the calls served so far
+//
+CNTK_API CNTK_StatusCode CNTK_GetBatchingStatistics(
+    /*[in]*/ CNTK_ModelHandle model,
+    /*[out]*/ CNTK_BatchingStatistics* statistics);
+
+//
+// What CNTK_PrepareModel prepared. Counterpart of CNTK::FunctionPreparationReport.
+//
+typedef struct CNTK_PreparationReport
+{
+    uint32_t numShapes;                 // Number of prepared input shapes
+    uint32_t numNetworkVariants;        // Number of compiled networks these shapes need
+    bool allVariantsKept;               // Whether all of them are kept, otherwise some are rebuilt when the shape changes
+    uint64_t numStorageAllocations;     // Storage allocations of the first evaluations of all shapes
+    uint64_t numWarmStorageAllocations; // Those of the second evaluations, which a prepared model does not need
+    double maxColdMs;                   // Longest first evaluation of a shape
+    double maxWarmMs;                   // Longest second evaluation of a shape
+    double totalMs;                     // Time taken by the preparation
+} CNTK_PreparationReport;
+
+//
+// Prepares the model for serving minibatches of the given numbers of sequences of the given length, before the first
+// call to CNTK_EvaluateSequence: builds the networks of these shapes, and chooses their algorithms and allocates
+// their memory by evaluating them, see CNTK::Function::Prepare. Must not be called while the model is evaluated.
+//
+// Parameters:
+//    model [in]: model to prepare; a model loaded by CNTK_LoadPooledModel cannot be prepared
+//    batchSizes [in]: numbers of sequences of the expected minibatches
+//    numBatchSizes [in]: number of batch sizes
+//    sequenceLength [in]: length of the sequences of the sequence inputs
+//    report [out]: what was prepared, can be null
+//
+CNTK_API CNTK_StatusCode CNTK_PrepareModel(
+    /*[in]*/ CNTK_ModelHandle model,
+    /*[in]*/ const uint32_t* batchSizes,
+    /*[in]*/ uint32_t numBatchSizes,
+    /*[in]*/ uint32_t sequenceLength,
+    /*[out]*/ CNTK_PreparationReport* report);
+
+//
+// A stream of a model: a sequence that is evaluated chunk by chunk, e.g. the audio of one speaker.
+// Counterpart of CNTK::StreamContext.
+//
+typedef void* CNTK_StreamHandle;
+
+//
+// Creates a stream of the model for CNTK_EvaluateStreams. The state that the recurrences of the model carry
+// over from one chunk of the stream to the next stays on the device of the model.
+//
+// Parameters:
+//    model [in]: model that evaluates the stream
+//    stream [out]: the new stream, whose first chunk begins a sequence
+//
+CNTK_API CNTK_StatusCode CNTK_CreateStream(
+    /*[in]*/ CNTK_ModelHandle model,
+    /*[out]*/ CNTK_StreamHandle* stream);
+
+//
+// Evaluates the next chunk of each of the streams in one forward pass, continuing the sequence of each stream.
+// inputValues holds numInputs values for each stream, one stream after the other, each with the frames of the
+// chunk of its stream; *outputValues holds numOutputs values for each stream in the same order. If *outputValues
+// is not null, the outputs are written into the preallocated buffers it points to; otherwise *outputValues is set
+// to newly allocated values. The streams must have been created for the model, and must not be used by
+// other calls at the same time.
+//
+CNTK_API CNTK_StatusCode CNTK_EvaluateStreams(CNTK_ModelHandle model,
+    /*[in]*/const CNTK_StreamHandle* streams,
+    /*[in]*/uint32_t numStreams,
+    /*[in]*/const CNTK_Variable* inputs,
+    /*[in]*/const CNTK_Value* inputValues,
+    /*[in]*/uint32_t numInputs,
+    /*[in]*/const CNTK_Variable* outputs,
+    /*[in]*/uint32_t numOutputs,
+    /*[in/out]*/CNTK_Value** outputValues);
+
+//
+// Starts the stream over: its next chunk begins a new sequence.
+//
+CNTK_API CNTK_StatusCode CNTK_ResetStream(
+    /*[in]*/ CNTK_StreamHandle stream);
+
+//
+// Releases all resources associated with the stream, including its state on the device.
+//
+CNTK_API void CNTK_ReleaseStream(
+    /*[in]*/ CNTK_StreamHandle stream);
+
 //
 // Auxiliary functions.
 //
@@ -210,6 +210,12 @@ namespace CNTK {
         ///
         virtual ChunkPtr GetChunk(ChunkIdType chunkId) = 0;
 
+        ///
+        /// Hints that the given chunks will be requested soon, in this order. Deserializers that read
+        /// from slow (e.g. remote) storage can start fetching their data. Does nothing by default.
+        ///
+        virtual void WillNeedChunks(const std::vector<ChunkIdType>& /*chunkIds*/) {}
+
         virtual ~DataDeserializer() = default;
 
     protected:
@@ -31,6 +31,7 @@
 #include <stdarg.h>
 #include <assert.h>
 #include <atomic>
+#include <functional>
 #include <type_traits>
 #include <unordered_set>
 #include <unordered_map>
@@ -214,6 +215,21 @@ namespace CNTK
     class Evaluator;
     typedef std::shared_ptr<Evaluator> EvaluatorPtr;
 
+    class BatchingEvaluator;
+    typedef std::shared_ptr<BatchingEvaluator> BatchingEvaluatorPtr;
+
+    class EvaluatorPool;
+    typedef std::shared_ptr<EvaluatorPool> EvaluatorPoolPtr;
+
+    class BeamSearchDecoder;
+    typedef std::shared_ptr<BeamSearchDecoder> BeamSearchDecoderPtr;
+
+    class StreamContext;
+    typedef std::shared_ptr<StreamContext> StreamContextPtr;
+
+    class StreamingEvaluator;
+    typedef std::shared_ptr<StreamingEvaluator> StreamingEvaluatorPtr;
+
     class Trainer;
     typedef std::shared_ptr<Trainer> TrainerPtr;
 
@@ -269,6 +285,16 @@ namespace CNTK
         // This is meant for debugging purposes only and is very likely to be deprecated in the future.
         CNTK_API void SaveAsLegacyModel(const FunctionPtr& rootFunction, const std::wstring& modelFile);
 
+        // A copy of 'rootFunction' for inference, in which each BatchNormalization that follows a Convolution or Times
+        // (optionally plus a bias) is folded into the weights and bias of the latter, using its running statistics.
+        // The copy has its own Parameters and Constants.
+        CNTK_API FunctionPtr FoldBatchNormalization(const FunctionPtr& rootFunction);
+
+        // A copy of 'rootFunction' for inference, in which the embedding tables that are only used by a lookup (a Times
+        // with sparse one-hot input, or a Gather) are stored as Int8 codes with a scale and offset per embedding, or as
+        // Float16 values ('storageType'), and dequantized as they are looked up. The lookups become QuantizedLookupTable Functions.
+        CNTK_API FunctionPtr QuantizeEmbeddings(const FunctionPtr& rootFunction, DataType storageType);
+
         CNTK_API size_t NewUniqueId();
 
         CNTK_API size_t GenerateRandomSeed(bool perWorkerLocalValue = false);
@@ -292,6 +318,36 @@ namespace CNTK
 
         CNTK_API void SetGPUMemoryAllocationTraceLevel(int traceLevel);
 
+        // Caching of GPU device memory: freed buffers are kept per device and stream and reused by later allocations.
+        CNTK_API void EnableGPUMemoryCaching(bool enable);
+        CNTK_API void SetGPUMemoryCacheLimitInMBs(size_t limitInMBs);
+        CNTK_API void EmptyGPUMemoryCache(int deviceId);
+
+        // What the caching allocator of a GPU holds, see GetGPUMemoryTelemetry(). The byte counts are of the memory reserved on
+        // the device; the peaks are since the start of the process or the last ResetGPUMemoryPeaks(), e.g. at the start of an epoch.
+        // The blocks in use are attributed to "parameters", "gradients", "activations", "workspace", "readerBuffers" and "other".
+        struct GPUMemoryTelemetry
+        {
+            size_t bytesInUse = 0;
+            size_t bytesRequested = 0;   // the part of bytesInUse that was asked for, the rest is rounding
+            size_t bytesCached = 0;      // idle blocks kept for reuse
+            size_t peakBytesInUse = 0;
+            size_t peakBytesReserved = 0; // of bytesInUse + bytesCached
+            double fragmentation = 0;    // fraction of the reserved bytes that were not asked for
+            double cacheHitRate = 0;
+            std::unordered_map<std::wstring, size_t> bytesInUseByCategory;
+            std::unordered_map<std::wstring, size_t> peakBytesInUseByCategory;
+        };
+
+        // All zero unless GPU memory caching is enabled, since the allocator only tracks the blocks it hands out.
+        CNTK_API GPUMemoryTelemetry GetGPUMemoryTelemetry(int deviceId);
+        CNTK_API void ResetGPUMemoryPeaks(int deviceId);
+
+        // Caching of page-locked host memory (reader and aggregation staging buffers), shared by all devices.
+        // The limit bounds the idle cached bytes (default 1024 MB); 0 disables the caching.
+        CNTK_API void SetPinnedMemoryCacheLimitInMBs(size_t limitInMBs);
+        CNTK_API void EmptyPinnedMemoryCache();
+
         CNTK_API void SetMathLibTraceLevel(int traceLevel);
 
         CNTK_API void ForceDeterministicAlgorithms();
@@ -315,18 +371,145 @@ namespace CNTK
         CNTK_API void EnableGradientAccumulationOptimization();
         CNTK_API void DisableGradientAccumulationOptimization();
 
+        // Gradient checkpointing: keep only about sqrt(N) forward values of the N nodes of a network and recompute the others during backprop.
+        CNTK_API void EnableActivationRecomputation();
+        CNTK_API void DisableActivationRecomputation();
+
         static const uint64_t DefaultProfilerBufferSize = 32 * 1024 * 1024;
         CNTK_API void StartProfiler(const std::wstring& profilerDir = L"profiler", bool profilerSyncGpu = false, size_t profilerBufferSize = DefaultProfilerBufferSize);
         CNTK_API void EnableProfiler();
         CNTK_API void DisableProfiler();
         CNTK_API void StopProfiler();
 
+        // Number and total time in seconds of the training and reader stages profiled since StartProfiler(), by their
+        // names in the summary report (e.g. L"Gradient Aggregation"). Empty if the profiler is not started.
+        CNTK_API std::unordered_map<std::wstring, std::pair<size_t, double>> GetProfiledTimes();
+
+        // Memory in use on a GPU, by all processes; 0 for the CPU.
+        CNTK_API size_t GetUsedDeviceMemoryInMB(const DeviceDescriptor& device);
+
         CNTK_API void EnableNodeTiming();
         CNTK_API void DisableNodeTimeing();
 
         CNTK_API void EnableCPUEvalOptimization();
         CNTK_API void DisableCPUEvalOptimization();
 
+        // Evaluates the products of Parameters or Constants with dense data on the CPU in int8 (with float scales per row of the
+        // weights and per sample), for float and double models. The weights are quantized on first use after enabling this.
+        CNTK_API void EnableCPUInt8Inference();
+        CNTK_API void DisableCPUInt8Inference();
+
+        // Evaluates the products of Parameters or Constants with dense data on the CPU in block sparse format, for the weights
+        // with at most the fraction maxDensity of nonzero blocks of blockRows x blockCols elements, e.g. those pruned in blocks of
+        // the same size by a learner (see AdditionalLearningOptions::blockPruningSparsity). Int8 inference takes precedence.
+        // The weights are converted on first use after enabling this.
+        CNTK_API void EnableCPUBlockSparseInference(size_t blockRows = 4, size_t blockCols = 1, double maxDensity = 0.3);
+        CNTK_API void DisableCPUBlockSparseInference();
+
+        // Computes a bias, inference-mode batch normalization and/or ReLU following a convolution as part of the convolution
+        // when evaluating on the CPU (enabled by default). Takes effect for Functions that are evaluated for the first time afterwards.
+        CNTK_API void EnableForwardPropFusion();
+        CNTK_API void DisableForwardPropFusion();
+
+        // Evaluates trees of elementwise operations (e.g. the gate computations of an LSTM) in a single pass over the
+        // elements, without materializing the intermediate results, during inference (enabled by default). Takes effect
+        // for Functions that are evaluated for the first time afterwards.
+        CNTK_API void EnableElementwiseFusion();
+        CNTK_API void DisableElementwiseFusion();
+
+        // Records the GPU work of the forward and backward passes into CUDA graphs and replays them for later minibatches
+        // with the same layout, to save the launch overhead of the many small kernels (disabled by default). Only the
+        // forward and backward passes are recorded, not the parameter updates.
+        CNTK_API void EnableGPUGraphCapture();
+        CNTK_API void DisableGPUGraphCapture();
+
+        // Issues the independent branches of a network (e.g. the towers of a multi-tower model) on up to 'numStreams' GPU
+        // streams during the forward pass, so that their kernels can run concurrently (disabled by default). The number
+        // of streams applies to networks whose memory has not been allocated yet, i.e. set it before the first evaluation.
+        CNTK_API void EnableMultiStreamExecution(size_t numStreams = 4);
+        CNTK_API void DisableMultiStreamExecution();
+
+        // Evaluates the independent nodes of a network (e.g. the embeddings of many sparse features) at the same time on
+        // the CPU during inference, each with a number of threads by its cost (disabled by default).
+        CNTK_API void EnableInterOpParallelism();
+        CNTK_API void DisableInterOpParallelism();
+
+        // Simplifies the network of a Function that is evaluated without a backward pass (disabled by default): batch
+        // normalization is folded into the convolution or product before it (see FoldBatchNormalization()), equal
+        // elementwise subexpressions are computed once, subgraphs that only depend on Constants are computed ahead of the
+        // first evaluation, and nodes that do not feed the requested outputs are dropped. The network is rebuilt when the
+        // value of one of its Parameters or Constants changes.
+        CNTK_API void EnableInferenceGraphOptimization();
+        CNTK_API void DisableInferenceGraphOptimization();
+
+        // Updates the dense float and double parameters of a learner (momentum SGD, AdaGrad, FSAdaGrad, Adam) together instead
+        // of one by one, which on the GPU takes a few kernel launches per minibatch for all of them (enabled by default).
+        // Learners with gradient clipping, L1 regularization or noise injection always update the parameters one by one.
+        CNTK_API void EnableMultiTensorLearnerUpdates();
+        CNTK_API void DisableMultiTensorLearnerUpdates();
+
+        // Runs the recurrences of OptimizedRNNStack with the recurrent weights kept on chip across the time steps, which cuts
+        // the latency per frame for a few sequences: on the GPU with the persistent algorithm of cuDNN (float and half, compute
+        // capability 6.0 and later), on the CPU in one parallel pass over all steps in which every thread keeps its part of the
+        // weights in its cache. Applies to the layers whose recurrent weights fit; the others run as before.
+        CNTK_API void EnablePersistentRNN();
+        CNTK_API void DisablePersistentRNN();
+
+        // Trains a model whose Parameters are spread over several GPUs as a pipeline (disabled by default): each node is
+        // computed on the device of the Parameters it reads, the others after the latest of their inputs, and activations
+        // and gradients are copied asynchronously between the devices. The stages are ordered by the first use of their
+        // devices. Splitting a minibatch into several calls of TrainMinibatch() bounds the memory of the activations.
+        CNTK_API void EnablePipelineParallelism();
+        CNTK_API void DisablePipelineParallelism();
+
+        // Lets a Function that is only evaluated keep up to this many networks, for different sets of requested outputs
+        // and shapes of the free dimensions of its arguments, so that alternating between a few of them does not rebuild
+        // the network each time (default 1). The networks share the Parameters but each has its own intermediate values.
+        CNTK_API void SetMaxNumCompiledNetworksPerFunction(size_t maxNumNetworks);
+        CNTK_API size_t GetMaxNumCompiledNetworksPerFunction();
+
+        // Places large CPU buffers on the NUMA nodes and pins the math threads to match, see NumaPolicy.h in the Math library.
+        // 'policy' is one of "none", "interleave", "nodeLocal", "firstTouch"; 'numaNode' selects the node for "nodeLocal"
+        // (-1: by the local MPI rank), e.g. to confine each of several evaluator processes on a host to its own socket.
+        // Call this after SetMaxNumCPUThreads().
+        CNTK_API void SetNumaPolicy(const std::wstring& policy, int numaNode = -1);
+
+        // Backs the CPU matrices and reader buffers of at least 'minBytes' with huge pages, see HugePages in NumaPolicy.h.
+        // 'kind' is one of "none", "transparent", "explicit"; explicit huge pages must be reserved on the host, else the
+        // transparent ones are used. Takes effect for the buffers allocated afterwards.
+        CNTK_API void SetHugePages(const std::wstring& kind, size_t minBytes = 2 * 1024 * 1024);
+        // The bytes of CPU buffers in mappings of explicit huge pages, and those of the process that the kernel backs with
+        // transparent huge pages (Linux only).
+        CNTK_API size_t GetExplicitHugePageBytes();
+        CNTK_API size_t GetTransparentHugePageBytes();
+
+        // Keeps the convolution algorithms found by the cuDNN autotuner in the given file, so that restarted processes and
+        // the other workers of a job reuse them instead of benchmarking every layer again. Typically only one worker should
+        // write the file ('writable'). Without 'autotune', geometries that are not in the file use the cuDNN heuristics.
+        // An empty path disables the cache.
+        CNTK_API void SetCuDnnAlgorithmCache(const std::wstring& path, bool writable = true, bool autotune = true);
+
+        // Shares the dense Parameters and Constants of a model on a GPU between the processes of a host through CUDA IPC, so
+        // that several serving processes keep one copy of them on the device. The owner moves the values of its model into
+        // one device buffer and publishes its handle in the file 'descriptorPath'; publishing again under the same path (e.g.
+        // an updated model) makes a new version. The other processes map the current version into their copy of the model
+        // (loaded from the same file, so the uids match) as read-only values. Both calls must precede the first evaluation
+        // of the model. The owner keeps the buffer of a version while a process has it mapped, and frees the buffers of
+        // older versions once the models using them are gone, on the next call of these functions; since all buffers are
+        // freed when the owner exits, it must outlive the other processes.
+        // Returns the published version.
+        CNTK_API size_t PublishSharedParameters(const ::CNTK::FunctionPtr& model, const std::wstring& descriptorPath);
+        // Returns the number of Parameters and Constants matched by uid, shape and data type; the others keep their own values.
+        CNTK_API size_t MapSharedParameters(const ::CNTK::FunctionPtr& model, const std::wstring& descriptorPath, const DeviceDescriptor& device);
+        // The current version published under 'descriptorPath', 0 if none, e.g. to map an update into a newly loaded model.
+        CNTK_API size_t GetSharedParametersVersion(const std::wstring& descriptorPath);
+        // Stops publishing under 'descriptorPath' (for the owner) and frees or unmaps the buffers that are no longer used.
+        CNTK_API void ReleaseSharedParameters(const std::wstring& descriptorPath);
+
+        // Number of buffers allocated for the storage of matrices and NDArrayViews on any device since the process started.
+        // After a warm-up, repeated evaluations of a Function with the same shapes into the same output Values leave it unchanged.
+        CNTK_API uint64_t GetNumStorageAllocations();
+
         CNTK_API void SetMPIPackThreshold(size_t packThesholdInBytes);
         CNTK_API size_t GetMPIPackThreshold();
 
@@ -370,6 +553,10 @@ namespace CNTK
         /// It also provides an option to serialize the model being trained, so that it can also be visualized.
         /// The class is NOT thread-safe: it is assumed that only one thread is using each instance.
         ///
+        /// With 'writeInBackground', the records are built and written by a background thread, in batches, so that the
+        /// calling (training) thread does neither serialization nor file I/O. Images and histograms of data on a GPU are
+        /// then copied on the device, and only the background thread waits for the GPU to read them.
+        ///
         class TensorBoardFileWriter final
         {
         public:
@@ -378,18 +565,18 @@ namespace CNTK
             /// An optional model argument allows serializing the model as well, so that it can be visualized
             /// in an external tool.
             ///
-            CNTK_API explicit TensorBoardFileWriter(const std::wstring& dir, const FunctionPtr& modelToVisualize = nullptr);
+            CNTK_API explicit TensorBoardFileWriter(const std::wstring& dir, const FunctionPtr& modelToVisualize = nullptr, bool writeInBackground = false);
 
             ///
             /// Construct a TensorBoardFileWriter to log metrics as files in the given directory.
             /// An network argument allows serializing the model as well, so that it can be visualized in an external tool.
             ///
-            CNTK_API explicit TensorBoardFileWriter(const std::wstring& dir, const ::Microsoft::MSR::CNTK::ComputationNetworkPtr& modelToVisualize = nullptr);
+            CNTK_API explicit TensorBoardFileWriter(const std::wstring& dir, const ::Microsoft::MSR::CNTK::ComputationNetworkPtr& modelToVisualize = nullptr, bool writeInBackground = false);
 
             ///
             /// Destruct the TensorBoardFileWriter and close any open files.
             ///
-            CNTK_API ~TensorBoardFileWriter() { Close(); }
+            CNTK_API ~TensorBoardFileWriter();
 
             ///
             /// Record a value of some metric at a particular step.
@@ -398,6 +585,12 @@ namespace CNTK
             ///
             CNTK_API void WriteValue(const std::wstring& name, float value, uint64_t step);
 
+            ///
+            /// Record the GetGPUMemoryTelemetry() of a device at a particular step, in MB, as values named
+            /// "gpu<deviceId>/memory/<statistic>" and "gpu<deviceId>/memory/<category>".
+            ///
+            CNTK_API void WriteGPUMemoryTelemetry(int deviceId, uint64_t step);
+
 #ifndef CNTK_UWP // doesn't support UWP due to compatibablity of opencv libs
             ///
             /// Record an image for a CNTK NDArrayViewPtr at a particular step.
@@ -405,8 +598,28 @@ namespace CNTK
             CNTK_API void WriteImage(const std::wstring& name, NDArrayViewPtr NDPtr, uint64_t step);
 #endif
 
+            ///
+            /// Record a histogram of the values of a float or double tensor (e.g. the weights or gradients of a parameter)
+            /// at a particular step, in the buckets of SetHistogramBucketLimits(). The counts and the statistics are
+            /// computed on the device of the tensor, which sends back only them.
+            ///
+            CNTK_API void WriteHistogram(const std::wstring& name, const NDArrayViewPtr& data, uint64_t step);
+
+            ///
+            /// Record the histograms of the values of all parameters of a model, named "<parameter name>/value", at every
+            /// 'frequency'-th step.
+            ///
+            CNTK_API void WriteParameterHistograms(const FunctionPtr& model, uint64_t step, uint64_t frequency = 1);
+
+            ///
+            /// The ascending limits of the buckets of WriteHistogram(); bucket i holds the values in (limits[i-1], limits[i]],
+            /// and a last bucket those above all limits. By default, the exponential buckets of TensorFlow.
+            ///
+            CNTK_API void SetHistogramBucketLimits(const std::vector<double>& bucketLimits);
+
             ///
             /// Flushes any outstanding records to disk. Returns true on success, false otherwise.
+            /// With 'writeInBackground', waits for the background thread to write the records written so far.
             ///
             CNTK_API bool Flush();
 
@@ -417,10 +630,18 @@ namespace CNTK
             CNTK_API bool Close();
 
         private:
+            class BackgroundWriter;
+
             void Init();
             void WriteModel();
             void WriteRecord(const std::string& data);
             void WriteVersion(time_t time);
+            void Post(std::function<void()>&& write); // runs 'write' now, or on the background thread
+            bool FlushFile();
+            bool CloseFile();
+#ifndef CNTK_UWP
+            void WriteImageRecord(const std::wstring& name, const NDArrayViewPtr& imageData, uint64_t step, time_t wallTime);
+#endif
 
             // Disable copy-construction and assignment.
             TensorBoardFileWriter(const TensorBoardFileWriter& other) = delete;
@@ -430,7 +651,54 @@ namespace CNTK
             const std::wstring m_dir;
             FILE* m_file;
             std::wstring m_fileName;
+            std::unique_ptr<BackgroundWriter> m_background;
+            std::vector<double> m_bucketLimits;
+            std::unordered_map<std::wstring, NDArrayViewPtr> m_deviceBucketLimits; // m_bucketLimits by device and data type
+        };
+
+#ifndef CNTK_UWP // doesn't support UWP due to compatibablity of opencv libs
+        ///
+        /// ImageFileWriter encodes the images of minibatches (e.g. the output of a segmentation model) and writes them
+        /// to files on a pool of worker threads, so that the calling thread only takes a snapshot of the data.
+        /// The images waiting to be written take at most 'maxQueuedBytes' (at least one batch); Write() blocks until
+        /// there is room. Data on a GPU is snapshotted on the device and copied to the host by a worker.
+        /// The class is NOT thread-safe: it is assumed that only one thread is using each instance.
+        ///
+        class ImageFileWriter final
+        {
+        public:
+            ///
+            /// Construct an ImageFileWriter with 'numThreads' workers, by default one per core.
+            ///
+            CNTK_API explicit ImageFileWriter(size_t numThreads = 0, size_t maxQueuedBytes = 256 * 1024 * 1024);
+
+            ///
+            /// Waits for the outstanding images, errors are ignored.
+            ///
+            CNTK_API ~ImageFileWriter();
+
+            ///
+            /// Writes the images of a float or double batch of shape [width x height x channels x N], the layout of
+            /// the image reader, to N files. The values are in [0, 255], the channels are 1 (gray), 3 (BGR) or 4 (BGRA).
+            /// The format is given by the extension of each path (.png, .jpg, .jpeg). 'quality' is the JPEG quality (0-100)
+            /// or the PNG compression level (0-9), -1 for the defaults (95 and 3).
+            ///
+            CNTK_API void Write(const NDArrayViewPtr& images, const std::vector<std::wstring>& paths, int quality = -1);
+
+            ///
+            /// Waits for the images written so far. Throws if encoding or writing any of them failed since the last call.
+            ///
+            CNTK_API void Flush();
+
+        private:
+            class WorkerPool;
+
+            ImageFileWriter(const ImageFileWriter& other) = delete;
+            ImageFileWriter& operator=(const ImageFileWriter& other) = delete;
+
+            std::unique_ptr<WorkerPool> m_workers;
         };
+#endif
 
         // SWIG callback wrapper for the UDF deserialization.
         class UDFDeserializeCallbackWrapper
@@ -134,6 +134,18 @@ namespace CNTK
     {
         // Functions from this namespace should not be used directly.
 
+        //
+        // A node on the explicit stack of the depth-first traversals below, which do not recurse,
+        // so that the depth of the graph is not limited by the size of the call stack.
+        //
+        template<class TNode>
+        struct TraversalFrame
+        {
+            TNode m_node;
+            std::vector<TNode> m_predecessors;
+            size_t m_next;
+        };
+
         //
         // Function performs post-order traversal of the graph and returns
         // collected nodes.
@@ -141,13 +153,26 @@ namespace CNTK
         template<class TNode>
         static void PostOrderTraversalImpl(const DirectedGraph<TNode>& graph, const TNode& node, std::set<TNode>& visited, std::list<TNode>& result)
         {
-            if (visited.find(node) != visited.end())
+            if (!visited.insert(node).second)
                 return;
 
-            visited.insert(node);
-            for (const auto& p : graph.Predecessors(node))
-                PostOrderTraversalImpl(graph, p, visited, result);
-            result.push_back(node);
+            std::vector<TraversalFrame<TNode>> frames;
+            frames.push_back(TraversalFrame<TNode>{ node, graph.Predecessors(node), 0 });
+            while (!frames.empty())
+            {
+                auto& frame = frames.back();
+                if (frame.m_next < frame.m_predecessors.size())
+                {
+                    TNode predecessor = frame.m_predecessors[frame.m_next++];
+                    if (visited.insert(predecessor).second)
+                        frames.push_back(TraversalFrame<TNode>{ predecessor, graph.Predecessors(predecessor), 0 });
+                }
+                else
+                {
+                    result.push_back(std::move(frame.m_node));
+                    frames.pop_back();
+                }
+            }
         }
 
         //
@@ -166,88 +191,113 @@ namespace CNTK
         };
 
         //
-        // Recursive implementation of the Tarjan algorithm for finding all stronly connected
-        // components.
+        // Implementation of the Tarjan algorithm for finding all stronly connected
+        // components, starting at 'root'. The depth-first search keeps its own stack.
         //
         template<class TNode>
         void StrongComponentsImpl(
             const DirectedGraph<TNode>& graph,
-            const TNode& node,
+            const TNode& root,
             std::stack<TNode>& nodeStack,
             int& index,
             std::map<TNode, Internal::StrongComponentNodeState>& state,
             std::vector<StrongComponent<TNode>>& strongComponents)
         {
-            assert(!state[node].m_visited);
-
-            // set the index (in order of visitation)
-            // Each node is assigned a unique integer m_index, which numbers the nodes consecutively in the order in which they are discovered.
-            state[node].m_index = index;
-            state[node].m_minIndex = index;
-            index++;
-
-            state[node].m_visited = true;
-
-            // The nodes are placed on the stack in the order in which they are visited.
-            // When the depth-first search recursively explores a node 'node' and its descendants,
-            // those nodes are not all necessarily popped from the stack when this recursive call returns.
-            // The crucial invariant property is that a node remains on the stack after exploration if and only if it has a path to some node earlier on the stack.
-            // At the end of the call that explores 'node' and its descendants, we know whether 'node' itself has a path to any node earlier on the stack.
-            // If so, the call returns, leaving 'node' on the stack to preserve the stack invariant.
-            // If not, then 'node' must be the root of its strongly connected component, which consists of 'node' together with any later nodes on the stack
-            // (such nodes all have paths back to 'node' but not to any earlier node,
-            // because if they had paths to earlier nodes then 'node' would also have paths to earlier nodes which is false).
-            // This entire component is then popped from the stack and returned, again preserving the invariant. [Wikipedia]
-            nodeStack.push(node);
-            state[node].m_inStack = true;
-
-            // set m_minIndex to min over m_minIndex of children
-            // m_minIndex (lowlink in Tarjan's notation) represents (roughly speaking) the smallest index of any node known to be reachable from 'node', including 'node' itself. [Wikipedia]
-            for (const auto& predecessor : graph.Predecessors(node))
-            {
-                if (!state[predecessor].m_visited)
-                {
-                    // predecessor w has not yet been visited; recurse on it
-                    StrongComponentsImpl(graph, predecessor, nodeStack, index, state, strongComponents);
-                    state[node].m_minIndex = std::min(state[node].m_minIndex, state[predecessor].m_minIndex);
-                }
-                else if (state[predecessor].m_inStack)
-                {
-                    // successor w is in stack S and hence in the current SCC
-                    // NOTE! This line is actually different from the BS algorithm
-                    state[node].m_minIndex = std::min(state[node].m_minIndex, state[predecessor].m_index);
-                }
-            }
+            assert(!state[root].m_visited);
 
-            // if 'node' is a root node, then we closed a loop.
-            // 'node' must be left on the stack if m_minIndex < m_index,
-            // whereas it must be removed as the root of a strongly connected component if m_minIndex == m_index.
-            // m_minIndex is computed during the depth-first search from 'node' (above), as this finds the nodes that are reachable from 'node'. [Wikipedia]
-            assert(state[node].m_minIndex <= state[node].m_index);
-            if (state[node].m_minIndex == state[node].m_index) // m_minIndex is still equal to m_index, as we set it at the start of this function: we closed a loop
+            // The references into 'state' stay valid as it grows.
+            std::vector<TraversalFrame<TNode>> frames;
+            std::vector<StrongComponentNodeState*> frameStates;
+            auto visit = [&](const TNode& node)
+            {
+                auto& nodeState = state[node];
+
+                // set the index (in order of visitation)
+                // Each node is assigned a unique integer m_index, which numbers the nodes consecutively in the order in which they are discovered.
+                nodeState.m_index = index;
+                nodeState.m_minIndex = index;
+                index++;
+
+                nodeState.m_visited = true;
+
+                // The nodes are placed on the stack in the order in which they are visited.
+                // When the depth-first search explores a node 'node' and its descendants,
+                // those nodes are not all necessarily popped from the stack when its exploration ends.
+                // The crucial invariant property is that a node remains on the stack after exploration if and only if it has a path to some node earlier on the stack.
+                // At the end of the exploration of 'node' and its descendants, we know whether 'node' itself has a path to any node earlier on the stack.
+                // If so, 'node' is left on the stack to preserve the stack invariant.
+                // If not, then 'node' must be the root of its strongly connected component, which consists of 'node' together with any later nodes on the stack
+                // (such nodes all have paths back to 'node' but not to any earlier node,
+                // because if they had paths to earlier nodes then 'node' would also have paths to earlier nodes which is false).
+                // This entire component is then popped from the stack and returned, again preserving the invariant. [Wikipedia]
+                nodeStack.push(node);
+                nodeState.m_inStack = true;
+
+                frames.push_back(TraversalFrame<TNode>{ node, graph.Predecessors(node), 0 });
+                frameStates.push_back(&nodeState);
+            };
+
+            visit(root);
+            while (!frames.empty())
             {
-                // gather the list of all nodes in this loop
-                std::vector<TNode> nestedNodes;
+                auto& frame = frames.back();
+                auto& nodeState = *frameStates.back();
 
-                for (;;)
+                // set m_minIndex to min over m_minIndex of children
+                // m_minIndex (lowlink in Tarjan's notation) represents (roughly speaking) the smallest index of any node known to be reachable from 'node', including 'node' itself. [Wikipedia]
+                if (frame.m_next < frame.m_predecessors.size())
                 {
-                    TNode current = nodeStack.top();
-                    nodeStack.pop();
-
-                    state[current].m_inStack = false;
-                    nestedNodes.push_back(current);
-
-                    if (current == node) // hit our starting point: done
-                        break;
+                    TNode predecessor = frame.m_predecessors[frame.m_next++];
+                    auto& predecessorState = state[predecessor];
+                    if (!predecessorState.m_visited)
+                    {
+                        // predecessor w has not yet been visited; explore it, its m_minIndex is taken when it is done
+                        visit(predecessor);
+                    }
+                    else if (predecessorState.m_inStack)
+                    {
+                        // successor w is in stack S and hence in the current SCC
+                        // NOTE! This line is actually different from the BS algorithm
+                        nodeState.m_minIndex = std::min(nodeState.m_minIndex, predecessorState.m_index);
+                    }
+                    continue;
                 }
 
-                // not a real loop. In degenerate situation it could be that the delay
-                // feeds directly into itself though, but then its still just returns the same value
-                // so can be evaluated in a topological sort order.
-                if (nestedNodes.size() <= 1)
-                    return;
+                // if 'node' is a root node, then we closed a loop.
+                // 'node' must be left on the stack if m_minIndex < m_index,
+                // whereas it must be removed as the root of a strongly connected component if m_minIndex == m_index.
+                // m_minIndex is computed during the depth-first search from 'node' (above), as this finds the nodes that are reachable from 'node'. [Wikipedia]
+                const TNode node = std::move(frame.m_node);
+                const int minIndex = nodeState.m_minIndex;
+                assert(nodeState.m_minIndex <= nodeState.m_index);
+                if (nodeState.m_minIndex == nodeState.m_index) // m_minIndex is still equal to m_index, as we set it at the start: we closed a loop
+                {
+                    // gather the list of all nodes in this loop
+                    std::vector<TNode> nestedNodes;
+
+                    for (;;)
+                    {
+                        TNode current = nodeStack.top();
+                        nodeStack.pop();
+
+                        state[current].m_inStack = false;
+                        nestedNodes.push_back(current);
+
+                        if (current == node) // hit our starting point: done
+                            break;
+                    }
+
+                    // not a real loop. In degenerate situation it could be that the delay
+                    // feeds directly into itself though, but then its still just returns the same value
+                    // so can be evaluated in a topological sort order.
+                    if (nestedNodes.size() > 1)
+                        strongComponents.emplace_back(std::move(nestedNodes));
+                }
 
-                strongComponents.emplace_back(std::move(nestedNodes));
+                frames.pop_back();
+                frameStates.pop_back();
+                if (!frameStates.empty())
+                    frameStates.back()->m_minIndex = std::min(frameStates.back()->m_minIndex, minIndex);
             }
         }
 
@@ -262,7 +312,7 @@ namespace CNTK
             std::vector<TNode>& result,
             TNode node,
             const DirectedGraph<TNode>& graph,
-            const StrongComponent<TNode>& component,
+            const std::set<TNode>& component,
             std::function<bool(const TNode&)> delay)
         {
             if (visited.find(node) != visited.end())
@@ -281,7 +331,7 @@ namespace CNTK
             {
                 for (const auto& p : graph.Predecessors(node))
                 {
-                    if (component.Contains(p))
+                    if (component.find(p) != component.end())
                         LoopEvaluationSort(visited, nodesOnThePathFromRoot, result, p, graph, component, delay);
                 }
             }
@@ -342,7 +392,8 @@ namespace CNTK
             // Get all nodes that only have a delay child, these
             // will become new roots for evaluation.
             const auto& nestedNodes = component.Nodes();
-            std::set<TNode> newRoots(nestedNodes.begin(), nestedNodes.end());
+            const std::set<TNode> members(nestedNodes.begin(), nestedNodes.end()); // for lookups, Contains() is linear
+            std::set<TNode> newRoots(members);
             for (const auto& node : nestedNodes)
             {
                 if (delay(node))
@@ -350,7 +401,7 @@ namespace CNTK
 
                 for (const auto& predecessor : graph.Predecessors(node))
                 {
-                    if (component.Contains(predecessor))
+                    if (members.find(predecessor) != members.end())
                         newRoots.erase(predecessor);
                 }
             }
@@ -367,7 +418,7 @@ namespace CNTK
                     continue;
 
                 std::set<TNode> checkInfinity;
-                Internal::LoopEvaluationSort(visited, checkInfinity, reordered, root, graph, component, delay);
+                Internal::LoopEvaluationSort(visited, checkInfinity, reordered, root, graph, members, delay);
             }
 
             // Update the component.
@@ -392,8 +443,13 @@ namespace CNTK
         // Prepare additional structure that contains the number of nodes per
         // component.
         std::map<decltype(strongComponents.begin()), size_t> componentToNodeCount;
+        std::map<TNode, decltype(strongComponents.begin())> nodeToComponent;
         for (auto i = strongComponents.begin(); i != strongComponents.end(); ++i)
+        {
             componentToNodeCount.insert(std::make_pair(i, i->Nodes().size()));
+            for (const auto& node : i->Nodes())
+                nodeToComponent.insert(std::make_pair(node, i));
+        }
 
         // Strong components should already be sorted in a proper evaluation order.
         // The whole strong component gets evaluated on its last node position in the global
@@ -402,9 +458,8 @@ namespace CNTK
         result.reserve(nodes.size());
         for (const auto& node : nodes)
         {
-            auto component = std::find_if(strongComponents.begin(), strongComponents.end(),
-                [&node](const StrongComponent<TNode>& c) { return c.Contains(node); });
-            if (component == strongComponents.end())
+            auto nodeComponent = nodeToComponent.find(node);
+            if (nodeComponent == nodeToComponent.end())
             {
                 result.push_back(node);
             }
@@ -412,6 +467,7 @@ namespace CNTK
             {
                 // Check if the last node of the component in the global topological
                 // sort order. If that is the case, insert all nodes of the component.
+                auto component = nodeComponent->second;
                 assert(componentToNodeCount[component] > 0);
                 if (--componentToNodeCount[component] == 0)
                     result.insert(result.end(), component->Nodes().begin(), component->Nodes().end());
@@ -12,6 +12,7 @@
 #include <functional>
 #include <codecvt>
 #include <locale>
+#include <mutex>
 
 #include "CNTKLibrary.h"
 #include "CNTKLibraryC.h"
@@ -109,7 +110,8 @@ namespace CNTK
             uint32_t numInputs,
             const CNTK_Variable* outputs,
             uint32_t numOutputs,
-            CNTK_Value** outputValues) = 0;
+            CNTK_Value** outputValues,
+            const DeviceDescriptor& bufferDevice) = 0;
         virtual ~EvaluatorWrapper() {}
 
     protected:
@@ -166,13 +168,103 @@ namespace CNTK
             uint32_t numInputs,
             const CNTK_Variable* outputs,
             uint32_t numOutputs,
-            CNTK_Value** outputValues) override;
+            CNTK_Value** outputValues,
+            const DeviceDescriptor& bufferDevice) override;
+
+        // Prepares the model for minibatches of the given numbers of sequences, see Function::Prepare().
+        virtual FunctionPreparationReport Prepare(const std::vector<size_t>& batchSizes, size_t sequenceLength)
+        {
+            return m_func->Prepare(batchSizes, sequenceLength, m_device);
+        }
+
+        // Streams of the model, see StreamingEvaluator; the evaluator is created with the first stream.
+        StreamContextPtr CreateStream();
+
+        // Evaluates the next chunk of each stream, see CNTK_EvaluateStreams().
+        void EvaluateStreams(
+            const std::vector<StreamContextPtr>& streams,
+            const CNTK_Variable* inputs,
+            const CNTK_Value* inputValues,
+            uint32_t numInputs,
+            const CNTK_Variable* outputs,
+            uint32_t numOutputs,
+            CNTK_Value** outputValues);
+
+    protected:
+        // Runs the forward pass of EvaluateSequence().
+        virtual void Evaluate(const std::unordered_map<Variable, ValuePtr>& inputs, std::unordered_map<Variable, ValuePtr>& outputs)
+        {
+            m_func->Evaluate(inputs, outputs, m_device);
+        }
 
-    private:
         FunctionPtr m_func;
         DeviceDescriptor m_device;
+
+    private:
+        std::pair<Variable, ValuePtr> PrepareInput(const CNTK_Variable& input, const CNTK_Value& inputValue, bool resetFlag, const DeviceDescriptor& bufferDevice);
+        std::pair<Variable, ValuePtr> PrepareOutput(const CNTK_Variable& output, const CNTK_Value* buffer, const DeviceDescriptor& bufferDevice);
+        static CNTK_Value ToNewValue(const ValuePtr& value);
+
         std::unordered_map<std::string, Variable> m_arguments;
         std::unordered_map<std::string, Variable> m_outputs;
+
+        std::mutex m_streamingMutex;
+        StreamingEvaluatorPtr m_streaming;
+    };
+
+    //
+    // An evaluator of the C interface whose EvaluateSequence() may be called from many threads at the same time;
+    // the sequences of concurrent calls are evaluated together, see BatchingEvaluator.
+    //
+    class BatchingEvaluatorWrapper : public CNTKEvaluatorWrapper
+    {
+    public:
+        BatchingEvaluatorWrapper(const char* modelFilePath, const CNTK_DeviceDescriptor* device, uint32_t maxBatchSize, uint32_t maxWaitMicroseconds);
+        BatchingEvaluatorWrapper(FunctionPtr model, DeviceDescriptor device, uint32_t maxBatchSize, uint32_t maxWaitMicroseconds);
+
+        std::unique_ptr<EvaluatorWrapper> Clone(CNTK_ParameterCloningMethod method, bool flatten) override;
+
+        BatchingEvaluatorStatistics Statistics() const { return m_evaluator->Statistics(); }
+
+    protected:
+        void Evaluate(const std::unordered_map<Variable, ValuePtr>& inputs, std::unordered_map<Variable, ValuePtr>& outputs) override
+        {
+            m_evaluator->Evaluate(inputs, outputs);
+        }
+
+    private:
+        uint32_t m_maxBatchSize;
+        uint32_t m_maxWaitMicroseconds;
+        BatchingEvaluatorPtr m_evaluator;
+    };
+
+    //
+    // An evaluator of the C interface whose EvaluateSequence() may be called from many threads at the same time;
+    // the calls are served by a few evaluation contexts that share the parameters, see EvaluatorPool.
+    //
+    class PooledEvaluatorWrapper : public CNTKEvaluatorWrapper
+    {
+    public:
+        PooledEvaluatorWrapper(const char* modelFilePath, const CNTK_DeviceDescriptor* device, uint32_t numContexts);
+        PooledEvaluatorWrapper(FunctionPtr model, DeviceDescriptor device, uint32_t numContexts);
+
+        std::unique_ptr<EvaluatorWrapper> Clone(CNTK_ParameterCloningMethod method, bool flatten) override;
+
+        // The contexts of the pool evaluate clones of the model, which preparing the model would not prepare.
+        FunctionPreparationReport Prepare(const std::vector<size_t>& /*batchSizes*/, size_t /*sequenceLength*/) override
+        {
+            InvalidArgument("A model loaded by CNTK_LoadPooledModel cannot be prepared.");
+        }
+
+    protected:
+        void Evaluate(const std::unordered_map<Variable, ValuePtr>& inputs, std::unordered_map<Variable, ValuePtr>& outputs) override
+        {
+            m_pool->Evaluate(inputs, outputs);
+        }
+
+    private:
+        uint32_t m_numContexts;
+        EvaluatorPoolPtr m_pool;
     };
 }
 
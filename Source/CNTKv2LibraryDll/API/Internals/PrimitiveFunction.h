@@ -122,6 +122,8 @@ namespace CNTK
         { PrimitiveOpType::Tan, L"Tan" },
         { PrimitiveOpType::Atan, L"Atan" },
         { PrimitiveOpType::ConvolutionSequenceShape, L"ConvolutionSequenceShape" },
+        { PrimitiveOpType::LayerNormalization, L"LayerNormalization" },
+        { PrimitiveOpType::QuantizedLookupTable, L"QuantizedLookupTable" },
     };
 
     inline const std::wstring& PrimitiveOpTypeName(PrimitiveOpType opType)
@@ -684,6 +686,33 @@ namespace CNTK
             return UnaryElementwiseOpOutputShape(mainOperandShape);
         }
 
+        // scale and bias have as many elements as the operand, and infer its shape
+        static NDShape LayerNormalizationOutputShape(std::vector<Variable>& operands, bool inferDimensions)
+        {
+            NDShape mainOperandShape = operands[0].Shape();
+            for (size_t i = 1; i < operands.size(); i++)
+            {
+                if (!operands[i].DynamicAxes().empty())
+                    InvalidArgument("LayerNormalization: Input[%d] '%S' must not have a dynamic axis.", (int)i, operands[i].AsString().c_str());
+
+                auto paramShape = operands[i].Shape();
+                if (inferDimensions && paramShape.HasInferredDimension() && !mainOperandShape.HasUnboundDimension())
+                {
+                    paramShape = mainOperandShape;
+                    std::vector<std::pair<Variable, NDShape>> newParamShape = { { operands[i], paramShape } };
+                    UpdateOperandShapes(newParamShape);
+                }
+
+                if (!paramShape.HasUnboundDimension() && !mainOperandShape.HasUnboundDimension() && (paramShape.TotalSize() != mainOperandShape.TotalSize()))
+                    InvalidArgument("LayerNormalization: Input[%d] shape '%S' must have as many elements as the operand shape '%S'.",
+                                    (int)i,
+                                    paramShape.AsString().c_str(),
+                                    mainOperandShape.AsString().c_str());
+            }
+
+            return UnaryElementwiseOpOutputShape(mainOperandShape);
+        }
+
         // TODO: Reconcile this with the ComputationNode::Validate functionality in core CNTK to avoid duplication of inference logic
         // Returns a pair of determined output variables and a bool indicating if any input operand shape was modified
         static DataType GetOutputDataType(PrimitiveOpType op, std::vector<Variable>& inputs, bool inferDimensions);
@@ -732,7 +761,9 @@ namespace CNTK
         // Version 22: Add StraightThrough
         // Version 23: Add Tan and Atan.
         // Version 24: Add ConvolutionSequenceShape.
-        static const size_t s_serializationVersion = 24;
+        // Version 25: Add LayerNormalization.
+        // Version 26: Add QuantizedLookupTable.
+        static const size_t s_serializationVersion = 26;
     };
 
     std::vector<DictionaryValue> GetInputUids(const Function& f);
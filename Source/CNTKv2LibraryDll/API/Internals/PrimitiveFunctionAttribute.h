@@ -138,6 +138,9 @@ namespace CNTK
         CNTK_API static const std::wstring AttributeNameCustomOp;
         CNTK_API static const std::wstring AttributeNameTransposeLeftOperand;
         CNTK_API static const std::wstring AttributeNameTransposeRightOperand;
+        CNTK_API static const std::wstring AttributeNameQuantizedTable;
+        CNTK_API static const std::wstring AttributeNameQuantizedTableScalesAndOffsets;
+        CNTK_API static const std::wstring AttributeNameIndexInput;
 
         CNTK_API static const std::vector<std::wstring> s_rngStateAttributes;
     };
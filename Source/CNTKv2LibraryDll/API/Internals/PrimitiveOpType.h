@@ -107,6 +107,8 @@ namespace CNTK
         Tan = 95,
         Atan = 96,
         ConvolutionSequenceShape = 97,
+        LayerNormalization = 98,
+        QuantizedLookupTable = 99,
         // New op types should only be appended to the end of this list 
         UnknownOP
         // and UnknownOP should always be last.
@@ -282,6 +282,38 @@ namespace CNTK
                     opType = PrimitiveOpType::PackedIndex;
                 else if (node->OperationName() == OperationNameOf(GatherPackedNode))
                     opType = PrimitiveOpType::GatherPacked;
+                else if (node->OperationName() == OperationNameOf(GatherNode))
+                {
+                    // the node's axis is a 0-based static axis index, like the one of Gather; -1 is its default
+                    auto axis = node->As<GatherNode<ElementType>>()->Axis();
+                    if (axis != -1)
+                        primitiveFunctionConfigParameters[PrimitiveFunctionAttribute::AttributeNameAxis] = Axis(axis);
+                    opType = PrimitiveOpType::Gather;
+                }
+                else if (node->OperationName() == OperationNameOf(QuantizedLookupTableNode))
+                {
+                    auto lookupNode = node->As<QuantizedLookupTableNode<ElementType>>();
+                    NDShape tableShape = { lookupNode->EmbeddingDim(), lookupNode->TableSize() };
+                    NDArrayViewPtr table;
+                    if (lookupNode->UsesHalf())
+                    {
+                        std::unique_ptr<half[]> codes(lookupNode->HalfCodes().CopyToArray());
+                        table = NDArrayView(DataType::Float16, tableShape, codes.get(), tableShape.TotalSize() * sizeof(half), DeviceDescriptor::CPUDevice()).DeepClone();
+                    }
+                    else
+                    {
+                        std::unique_ptr<char[]> codes(lookupNode->Int8Codes().CopyToArray());
+                        table = NDArrayView(DataType::Int8, tableShape, codes.get(), tableShape.TotalSize(), DeviceDescriptor::CPUDevice()).DeepClone();
+                    }
+                    std::unique_ptr<ElementType[]> scalesAndOffsets(lookupNode->ScalesAndOffsets().CopyToArray());
+                    NDShape scalesAndOffsetsShape = { 2, lookupNode->TableSize() };
+                    auto scalesAndOffsetsView = NDArrayView(AsDataType<ElementType>(), scalesAndOffsetsShape, scalesAndOffsets.get(), scalesAndOffsetsShape.TotalSize() * sizeof(ElementType), DeviceDescriptor::CPUDevice()).DeepClone();
+
+                    primitiveFunctionConfigParameters[PrimitiveFunctionAttribute::AttributeNameIndexInput] = lookupNode->IndexInput();
+                    primitiveFunctionConfigParameters[PrimitiveFunctionAttribute::AttributeNameQuantizedTable] = *table;
+                    primitiveFunctionConfigParameters[PrimitiveFunctionAttribute::AttributeNameQuantizedTableScalesAndOffsets] = *scalesAndOffsetsView;
+                    opType = PrimitiveOpType::QuantizedLookupTable;
+                }
                 else if (node->OperationName() == OperationNameOf(ScatterPackedNode))
                     opType = PrimitiveOpType::ScatterPacked;
                 else if (node->OperationName() == OperationNameOf(TimesNode))
@@ -459,6 +491,11 @@ namespace CNTK
 
                     opType = PrimitiveOpType::BatchNormalization;
                 }
+                else if (node->OperationName() == OperationNameOf(LayerNormalizationNode))
+                {
+                    primitiveFunctionConfigParameters[PrimitiveFunctionAttribute::AttributeNameEpsilon] = node->As<LayerNormalizationNode<ElementType>>()->Epsilon();
+                    opType = PrimitiveOpType::LayerNormalization;
+                }
                 else if (node->OperationName() == OperationNameOf(ClipNode))
                     opType = PrimitiveOpType::Clip;
                 else if (node->OperationName() == OperationNameOf(IfNode))
@@ -691,6 +728,86 @@ namespace CNTK
             computationNetwork->Save(modelFile);
         }
 
+        FunctionPtr FoldBatchNormalization(const FunctionPtr& rootFunction)
+        {
+            CompositeFunction* compositeFunction = dynamic_cast<CompositeFunction*>(rootFunction.get());
+            if (compositeFunction == nullptr)
+                InvalidArgument("FoldBatchNormalization: Primitive (i.e. non-composite) Function '%S' cannot be transformed.", rootFunction->AsString().c_str());
+
+            compositeFunction->UpdateInternalState();
+
+            DeviceDescriptor device = DeviceDescriptor::CPUDevice();
+            auto parameters = compositeFunction->Parameters();
+            if (!parameters.empty())
+                device = parameters.front().Value()->Device();
+
+            // The transformation is done on a computation network with mangled names like for SaveAsLegacyModel(), so that
+            // the Function converted back from it retains the Uids and names of the original one.
+            ComputationNetworkPtr computationNetwork;
+            std::unordered_map<Variable, ComputationNodeBasePtr> variableToNodeMap;
+            DataType dataType = rootFunction->Outputs()[0].GetDataType();
+            switch (dataType)
+            {
+            case DataType::Float:
+                std::tie(computationNetwork, variableToNodeMap) = CompositeFunction::CreateComputationNetwork<float>(rootFunction, device, {}, {}, {}, /*useMangledNamesForComputationNodes =*/ true);
+                break;
+            case DataType::Double:
+                std::tie(computationNetwork, variableToNodeMap) = CompositeFunction::CreateComputationNetwork<double>(rootFunction, device, {}, {}, {}, /*useMangledNamesForComputationNodes =*/ true);
+                break;
+            default:
+                LogicError("FoldBatchNormalization: Function '%S' has unsupported DataType %s.", rootFunction->AsString().c_str(), DataTypeName(dataType));
+            }
+
+            std::vector<ComputationNodeBasePtr> outputNodes;
+            for (const auto& output : rootFunction->Outputs())
+                outputNodes.push_back(variableToNodeMap.at(output));
+
+            if (computationNetwork->FoldBatchNormalization(outputNodes) == 0)
+                return rootFunction;
+            return ConvertFromLegacyModel(computationNetwork);
+        }
+
+        FunctionPtr QuantizeEmbeddings(const FunctionPtr& rootFunction, DataType storageType)
+        {
+            if (storageType != DataType::Int8 && storageType != DataType::Float16)
+                InvalidArgument("QuantizeEmbeddings: Unsupported storage DataType %s, expected Int8 or Float16.", DataTypeName(storageType));
+
+            CompositeFunction* compositeFunction = dynamic_cast<CompositeFunction*>(rootFunction.get());
+            if (compositeFunction == nullptr)
+                InvalidArgument("QuantizeEmbeddings: Primitive (i.e. non-composite) Function '%S' cannot be transformed.", rootFunction->AsString().c_str());
+
+            compositeFunction->UpdateInternalState();
+
+            DeviceDescriptor device = DeviceDescriptor::CPUDevice();
+            auto parameters = compositeFunction->Parameters();
+            if (!parameters.empty())
+                device = parameters.front().Value()->Device();
+
+            // as FoldBatchNormalization()
+            ComputationNetworkPtr computationNetwork;
+            std::unordered_map<Variable, ComputationNodeBasePtr> variableToNodeMap;
+            DataType dataType = rootFunction->Outputs()[0].GetDataType();
+            switch (dataType)
+            {
+            case DataType::Float:
+                std::tie(computationNetwork, variableToNodeMap) = CompositeFunction::CreateComputationNetwork<float>(rootFunction, device, {}, {}, {}, /*useMangledNamesForComputationNodes =*/ true);
+                break;
+            case DataType::Double:
+                std::tie(computationNetwork, variableToNodeMap) = CompositeFunction::CreateComputationNetwork<double>(rootFunction, device, {}, {}, {}, /*useMangledNamesForComputationNodes =*/ true);
+                break;
+            default:
+                LogicError("QuantizeEmbeddings: Function '%S' has unsupported DataType %s.", rootFunction->AsString().c_str(), DataTypeName(dataType));
+            }
+
+            std::vector<ComputationNodeBasePtr> outputNodes;
+            for (const auto& output : rootFunction->Outputs())
+                outputNodes.push_back(variableToNodeMap.at(output));
+
+            if (computationNetwork->QuantizeEmbeddings(outputNodes, /*useHalf =*/ storageType == DataType::Float16) == 0)
+                return rootFunction;
+            return ConvertFromLegacyModel(computationNetwork);
+        }
+
         LegacyModelDataType DetectLegacyModelDataType(const std::wstring& modelFile)
         {
             File fstream(modelFile, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead);
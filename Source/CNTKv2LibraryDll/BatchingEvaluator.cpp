@@ -0,0 +1,285 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// BatchingEvaluator.cpp -- merges concurrent evaluation requests into minibatches
+//
+
+#include "stdafx.h"
+#include "CNTKLibrary.h"
+#include "Utils.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+namespace CNTK
+{
+    using namespace std;
+
+    class BatchingEvaluatorImpl final : public BatchingEvaluator
+    {
+        typedef chrono::steady_clock Clock;
+
+        // A request lives on the stack of the calling thread, which blocks until 'done' is set.
+        struct Request
+        {
+            vector<vector<NDArrayViewPtr>> arguments; // the sequences of each argument, in the order of m_arguments
+            unordered_map<Variable, ValuePtr>* outputs;
+            size_t numSequences;
+            Clock::time_point enqueued;
+            promise<void> done;
+        };
+
+        static const size_t numLatenciesKept = 10000; // the percentiles are over this many of the last requests
+
+    public:
+        BatchingEvaluatorImpl(const FunctionPtr& model, const DeviceDescriptor& device, size_t maxBatchSize, size_t maxWaitMicroseconds)
+            : m_model(model), m_device(device), m_maxBatchSize(max<size_t>(maxBatchSize, 1)), m_maxWait(maxWaitMicroseconds),
+              m_numQueuedSequences(0), m_stopping(false), m_numRequests(0), m_numBatches(0)
+        {
+            if (!m_model)
+                InvalidArgument("BatchingEvaluator: The model is not allowed to be null.");
+
+            m_arguments = m_model->Arguments();
+            for (const auto& argument : m_arguments)
+            {
+                if (argument.DynamicAxes().empty())
+                    InvalidArgument("BatchingEvaluator: Argument '%S' has no batch axis, so requests for it cannot be batched.", argument.AsString().c_str());
+            }
+
+            m_worker = thread([this]() { Run(); });
+        }
+
+        ~BatchingEvaluatorImpl()
+        {
+            {
+                lock_guard<mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_pending.notify_all();
+            m_worker.join(); // after the queued requests have been evaluated
+        }
+
+        void Evaluate(const unordered_map<Variable, ValuePtr>& arguments, unordered_map<Variable, ValuePtr>& outputs) override
+        {
+            if (outputs.empty())
+                InvalidArgument("BatchingEvaluator: A request must ask for at least one output.");
+            if (arguments.size() != m_arguments.size())
+                InvalidArgument("BatchingEvaluator: A request has values for %d variables, but the model has %d arguments.", (int)arguments.size(), (int)m_arguments.size());
+
+            // Splitting the values into sequences happens on the calling thread, so requests are validated before
+            // they can fail a whole batch. The sequences must be complete, since the state of a recurrence is not
+            // kept for a request from one batch to the next.
+            Request request;
+            request.outputs = &outputs;
+            request.numSequences = 0;
+            for (const auto& argument : m_arguments)
+            {
+                auto value = arguments.find(argument);
+                if (value == arguments.end() || !value->second)
+                    InvalidArgument("BatchingEvaluator: A request has no value for argument '%S'.", argument.AsString().c_str());
+
+                auto sequences = value->second->UnpackVariableValue(argument, m_device);
+                for (const auto& sequence : sequences)
+                {
+                    if (sequence->GetDataType() != argument.GetDataType() ||
+                        (!argument.Shape().HasUnboundDimension() && sequence->Shape().SubShape(0, argument.Shape().Rank()) != argument.Shape()))
+                        InvalidArgument("BatchingEvaluator: The value of argument '%S' has shape '%S', which does not match the argument.",
+                                        argument.AsString().c_str(), value->second->Shape().AsString().c_str());
+                }
+
+                if (request.arguments.empty())
+                    request.numSequences = sequences.size();
+                else if (request.numSequences != sequences.size())
+                    InvalidArgument("BatchingEvaluator: The values of the arguments of a request have different numbers of sequences (%d and %d).",
+                                    (int)request.numSequences, (int)sequences.size());
+                request.arguments.push_back(move(sequences));
+            }
+            if (request.numSequences == 0)
+                InvalidArgument("BatchingEvaluator: A request must contain at least one sequence.");
+
+            auto done = request.done.get_future();
+            request.enqueued = Clock::now();
+            {
+                lock_guard<mutex> lock(m_mutex);
+                if (m_stopping)
+                    RuntimeError("BatchingEvaluator: Evaluate() was called while the evaluator is destroyed.");
+                m_queue.push_back(&request);
+                m_numQueuedSequences += request.numSequences;
+            }
+            m_pending.notify_one();
+
+            done.get(); // rethrows the error if the batch failed
+        }
+
+        BatchingEvaluatorStatistics Statistics() const override
+        {
+            lock_guard<mutex> lock(m_statisticsMutex);
+            BatchingEvaluatorStatistics statistics{ m_numRequests, m_numBatches, 0, 0 };
+            if (!m_latencies.empty())
+            {
+                auto latencies = m_latencies;
+                auto percentile = [&latencies](double p)
+                {
+                    auto nth = latencies.begin() + (size_t)(p * (latencies.size() - 1));
+                    nth_element(latencies.begin(), nth, latencies.end());
+                    return *nth;
+                };
+                statistics.p50QueueingLatencyMs = percentile(0.5);
+                statistics.p99QueueingLatencyMs = percentile(0.99);
+            }
+            return statistics;
+        }
+
+        FunctionPtr Model() const override
+        {
+            return m_model;
+        }
+
+    private:
+        // the worker: collects the next batch, and evaluates it
+        void Run()
+        {
+            unique_lock<mutex> lock(m_mutex);
+            for (;;)
+            {
+                m_pending.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+                if (m_queue.empty())
+                    return;
+
+                // wait for further requests until the batch is full, or until the oldest request has waited long enough
+                auto deadline = m_queue.front()->enqueued + m_maxWait;
+                m_pending.wait_until(lock, deadline, [this]() { return m_stopping || m_numQueuedSequences >= m_maxBatchSize; });
+
+                // a request that is larger than the maximum batch size is evaluated by itself
+                vector<Request*> batch;
+                size_t numSequences = 0;
+                while (!m_queue.empty() && (batch.empty() || numSequences + m_queue.front()->numSequences <= m_maxBatchSize))
+                {
+                    batch.push_back(m_queue.front());
+                    numSequences += m_queue.front()->numSequences;
+                    m_numQueuedSequences -= m_queue.front()->numSequences;
+                    m_queue.pop_front();
+                }
+
+                lock.unlock();
+                EvaluateBatch(batch);
+                lock.lock();
+            }
+        }
+
+        void EvaluateBatch(const vector<Request*>& batch)
+        {
+            RecordStatistics(batch);
+            try
+            {
+                // merge the sequences of all requests
+                unordered_map<Variable, ValuePtr> arguments;
+                for (size_t i = 0; i < m_arguments.size(); i++)
+                {
+                    vector<NDArrayViewPtr> sequences;
+                    for (auto request : batch)
+                        sequences.insert(sequences.end(), request->arguments[i].begin(), request->arguments[i].end());
+                    arguments[m_arguments[i]] = Pack(m_arguments[i], sequences);
+                }
+
+                unordered_map<Variable, ValuePtr> outputs;
+                for (auto request : batch)
+                {
+                    for (const auto& output : *request->outputs)
+                        outputs[output.first] = nullptr;
+                }
+
+                m_model->Evaluate(arguments, outputs, m_device);
+
+                // split the outputs, in the same order
+                size_t totalNumSequences = 0;
+                for (auto request : batch)
+                    totalNumSequences += request->numSequences;
+                for (const auto& output : outputs)
+                {
+                    auto sequences = output.second->UnpackVariableValue(output.first, m_device);
+                    if (sequences.size() != totalNumSequences)
+                        RuntimeError("BatchingEvaluator: Output '%S' has %d sequences for %d sequences of the arguments, so it cannot be split into the requests.",
+                                     output.first.AsString().c_str(), (int)sequences.size(), (int)totalNumSequences);
+
+                    size_t begin = 0;
+                    for (auto request : batch)
+                    {
+                        auto requestOutput = request->outputs->find(output.first);
+                        if (requestOutput != request->outputs->end())
+                        {
+                            auto value = Pack(output.first, vector<NDArrayViewPtr>(sequences.begin() + begin, sequences.begin() + begin + request->numSequences));
+                            if (requestOutput->second)
+                                requestOutput->second->CopyFrom(*value);
+                            else
+                                requestOutput->second = value;
+                        }
+                        begin += request->numSequences;
+                    }
+                }
+            }
+            catch (...)
+            {
+                auto error = current_exception();
+                for (auto request : batch)
+                    request->done.set_exception(error);
+                return;
+            }
+
+            for (auto request : batch)
+                request->done.set_value();
+        }
+
+        // Creates the value of 'variable' for a batch of sequences. Without a sequence axis, the samples are the columns.
+        ValuePtr Pack(const Variable& variable, const vector<NDArrayViewPtr>& sequences) const
+        {
+            auto sampleShape = sequences.front()->Shape().SubShape(0, variable.Shape().Rank());
+            auto value = Value::Create(sampleShape, sequences, {}, m_device, /*readOnly =*/ false, /*createNewCopy =*/ true);
+            if (variable.DynamicAxes().size() < 2)
+                value = MakeSharedObject<Value>(value->Data()->AsShape(sampleShape.AppendShape({ sequences.size() })));
+            return value;
+        }
+
+        void RecordStatistics(const vector<Request*>& batch)
+        {
+            auto now = Clock::now();
+            lock_guard<mutex> lock(m_statisticsMutex);
+            for (auto request : batch)
+            {
+                double latency = chrono::duration<double, milli>(now - request->enqueued).count();
+                if (m_latencies.size() < numLatenciesKept)
+                    m_latencies.push_back(latency);
+                else
+                    m_latencies[m_numRequests % numLatenciesKept] = latency;
+                m_numRequests++;
+            }
+            m_numBatches++;
+        }
+
+        const FunctionPtr m_model;
+        const DeviceDescriptor m_device;
+        const size_t m_maxBatchSize;
+        const chrono::microseconds m_maxWait;
+        vector<Variable> m_arguments;
+
+        mutex m_mutex; // for the members below
+        condition_variable m_pending;
+        deque<Request*> m_queue;
+        size_t m_numQueuedSequences;
+        bool m_stopping;
+
+        mutable mutex m_statisticsMutex; // for the statistics
+        size_t m_numRequests;
+        size_t m_numBatches;
+        vector<double> m_latencies; // in ms, a ring buffer once full
+
+        thread m_worker;
+    };
+
+    BatchingEvaluatorPtr CreateBatchingEvaluator(const FunctionPtr& model, const DeviceDescriptor& device, size_t maxBatchSize, size_t maxWaitMicroseconds)
+    {
+        return MakeSharedObject<BatchingEvaluatorImpl>(model, device, maxBatchSize, maxWaitMicroseconds);
+    }
+}
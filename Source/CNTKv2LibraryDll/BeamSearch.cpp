@@ -0,0 +1,258 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// BeamSearch.cpp -- beam search decoding with a step function, keeping the beams on the device
+//
+
+#include "stdafx.h"
+#include "CNTKLibrary.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace CNTK
+{
+    using namespace std;
+
+    class BeamSearchDecoderImpl final : public BeamSearchDecoder
+    {
+        // the score of a beam that does not exist yet, and the offset of the tokens a finished beam cannot emit
+        static constexpr double impossibleScore = -1e30;
+
+    public:
+        BeamSearchDecoderImpl(const FunctionPtr& stepFunction, const Variable& tokenInput, const Variable& logProbabilities,
+                              const unordered_map<Variable, Variable>& states, size_t startToken, size_t endToken,
+                              const DeviceDescriptor& device, const BeamSearchOptions& options)
+            : m_stepFunction(stepFunction), m_tokenInput(tokenInput), m_logProbabilities(logProbabilities), m_states(states),
+              m_startToken(startToken), m_endToken(endToken), m_device(device), m_options(options)
+        {
+            if (!m_stepFunction)
+                InvalidArgument("BeamSearchDecoder: The step function is not allowed to be null.");
+            if (m_options.beamWidth == 0 || m_options.maxLength == 0)
+                InvalidArgument("BeamSearchDecoder: The beam width and the maximum length must be positive.");
+
+            auto outputs = m_stepFunction->Outputs();
+            auto isOutput = [&outputs](const Variable& var) { return find(outputs.begin(), outputs.end(), var) != outputs.end(); };
+            if (!isOutput(m_logProbabilities) || m_logProbabilities.Shape().Rank() != 1)
+                InvalidArgument("BeamSearchDecoder: The log probabilities '%S' must be an output of the step function with a shape of rank 1.", m_logProbabilities.AsString().c_str());
+            m_vocabularySize = m_logProbabilities.Shape()[0];
+            if (m_startToken >= m_vocabularySize || m_endToken >= m_vocabularySize)
+                InvalidArgument("BeamSearchDecoder: The start and end tokens must be less than the vocabulary size %d.", (int)m_vocabularySize);
+
+            auto dataType = m_logProbabilities.GetDataType();
+            if (dataType != DataType::Float && dataType != DataType::Double)
+                InvalidArgument("BeamSearchDecoder: Only float and double step functions are supported.");
+
+            bool foundTokenInput = false;
+            for (const auto& argument : m_stepFunction->Arguments())
+            {
+                if (argument.DynamicAxes().size() != 1 || argument.DynamicAxes()[0] != Axis::DefaultBatchAxis())
+                    InvalidArgument("BeamSearchDecoder: Argument '%S' of the step function must only have the batch axis.", argument.AsString().c_str());
+                if (argument.GetDataType() != dataType || argument.IsSparse())
+                    InvalidArgument("BeamSearchDecoder: Argument '%S' of the step function must be dense, with the data type of the log probabilities.", argument.AsString().c_str());
+
+                if (argument == m_tokenInput)
+                    foundTokenInput = true;
+                else
+                    m_arguments.push_back(argument);
+            }
+            if (!foundTokenInput || m_tokenInput.Shape().TotalSize() != 1)
+                InvalidArgument("BeamSearchDecoder: The token input '%S' must be an argument of the step function of shape [1].", m_tokenInput.AsString().c_str());
+
+            for (const auto& state : m_states)
+            {
+                if (find(m_arguments.begin(), m_arguments.end(), state.first) == m_arguments.end() || !isOutput(state.second))
+                    InvalidArgument("BeamSearchDecoder: State '%S' must map an argument of the step function other than the token input to one of its outputs.", state.first.AsString().c_str());
+                if (state.first.Shape() != state.second.Shape())
+                    InvalidArgument("BeamSearchDecoder: The state argument '%S' and its next value '%S' differ in shape.", state.first.AsString().c_str(), state.second.AsString().c_str());
+            }
+        }
+
+        vector<vector<BeamSearchHypothesis>> Decode(const unordered_map<Variable, ValuePtr>& inputs) override
+        {
+            if (m_logProbabilities.GetDataType() == DataType::Float)
+                return Decode<float>(inputs);
+            else
+                return Decode<double>(inputs);
+        }
+
+    private:
+        template <typename ElemType>
+        vector<vector<BeamSearchHypothesis>> Decode(const unordered_map<Variable, ValuePtr>& inputs)
+        {
+            const auto deviceId = AsCNTKImplDeviceId(m_device);
+
+            // all inputs are batches of one sample per sentence
+            size_t numSentences = m_arguments.empty() ? 1 : 0;
+            vector<NDArrayViewPtr> inputData;
+            for (const auto& argument : m_arguments)
+            {
+                auto input = inputs.find(argument);
+                if (input == inputs.end() || !input->second)
+                    InvalidArgument("BeamSearchDecoder: No value was given for argument '%S' of the step function.", argument.AsString().c_str());
+                auto mask = input->second->Mask();
+                if (mask && mask->MaskedCount() > 0)
+                    InvalidArgument("BeamSearchDecoder: The value of argument '%S' must be a batch of samples without a mask.", argument.AsString().c_str());
+
+                auto data = input->second->Data();
+                size_t numSamples = data->Shape().TotalSize() / argument.Shape().TotalSize();
+                if (numSamples * argument.Shape().TotalSize() != data->Shape().TotalSize() || numSamples == 0 || (numSentences != 0 && numSamples != numSentences))
+                    InvalidArgument("BeamSearchDecoder: The values of the inputs must have the same positive number of samples, one per sentence.");
+                numSentences = numSamples;
+
+                inputData.push_back(data->Device() == m_device ? data : data->DeepClone(m_device, /*readOnly =*/ true));
+            }
+
+            // Beam k of sentence n is column n * K + k of the batch the step function runs on. The arguments are
+            // replicated into this batch; the states are then replaced after every step.
+            const size_t K = m_options.beamWidth, V = m_vocabularySize;
+            const size_t numBeams = K * numSentences;
+            vector<ElemType> hostGatherIndices(numBeams);
+            for (size_t j = 0; j < numBeams; j++)
+                hostGatherIndices[j] = (ElemType)(j / K);
+            Matrix<ElemType> gatherIndices(deviceId);
+            gatherIndices.SetValue(1, numBeams, deviceId, hostGatherIndices.data());
+
+            unordered_map<Variable, ValuePtr> arguments;
+            unordered_map<Variable, shared_ptr<Matrix<ElemType>>> argumentMatrices;
+            auto addArgument = [&](const Variable& argument)
+            {
+                auto buffer = MakeSharedObject<NDArrayView>(AsDataType<ElemType>(), argument.Shape().AppendShape({ numBeams }), m_device);
+                arguments[argument] = MakeSharedObject<Value>(buffer);
+                argumentMatrices[argument] = buffer->template GetWritableMatrix<ElemType>(VariableRowColSplitPoint(argument));
+            };
+            for (size_t i = 0; i < m_arguments.size(); i++)
+            {
+                addArgument(m_arguments[i]);
+                auto input = inputData[i]->GetMatrix<ElemType>(VariableRowColSplitPoint(m_arguments[i]));
+                argumentMatrices[m_arguments[i]]->DoGatherColumnsOf(0, gatherIndices, *input, 1);
+            }
+            addArgument(m_tokenInput);
+            auto& tokenMatrix = *argumentMatrices[m_tokenInput];
+            vector<ElemType> hostTokens(numBeams, (ElemType)m_startToken);
+            tokenMatrix.SetValue(1, numBeams, deviceId, hostTokens.data());
+
+            // Only beam 0 of each sentence exists at the start, so that the first step does not select the same
+            // hypothesis K times.
+            vector<ElemType> hostScores(numBeams, (ElemType)impossibleScore);
+            for (size_t n = 0; n < numSentences; n++)
+                hostScores[n * K] = 0;
+            Matrix<ElemType> scores(deviceId);
+            scores.SetValue(1, numBeams, deviceId, hostScores.data());
+
+            // A finished beam keeps its score by emitting the end token again, at no cost: its candidates are
+            // the offsets below instead of the log probabilities.
+            vector<ElemType> hostEndTokenOffsets(V, (ElemType)impossibleScore);
+            hostEndTokenOffsets[m_endToken] = 0;
+            Matrix<ElemType> endTokenOffsets(deviceId);
+            endTokenOffsets.SetValue(V, 1, deviceId, hostEndTokenOffsets.data());
+            Matrix<ElemType> finished(1, numBeams, deviceId), notFinished(1, numBeams, deviceId);
+            finished.SetValue(0);
+            notFinished.SetValue(1);
+
+            Matrix<ElemType> candidates(V, numBeams, deviceId);
+            Matrix<ElemType> topIndices(deviceId), topValues(deviceId);
+            vector<ElemType> hostTopIndices(numBeams), hostFinished(numBeams);
+            vector<size_t> lengths(numBeams, 0), newLengths(numBeams);
+            vector<char> isFinished(numBeams, 0), newIsFinished(numBeams);
+            vector<vector<size_t>> backPointers, emittedTokens; // of each step and beam, on the host
+
+            unordered_map<Variable, ValuePtr> outputs;
+            for (size_t t = 0; t < m_options.maxLength && find(isFinished.begin(), isFinished.end(), 0) != isFinished.end(); t++)
+            {
+                outputs.clear();
+                outputs[m_logProbabilities] = nullptr;
+                for (const auto& state : m_states)
+                    outputs[state.second] = nullptr;
+                m_stepFunction->Forward(arguments, outputs, m_device);
+
+                // candidates(v, j) = score of beam j extended by token v
+                auto logProbabilities = outputs.at(m_logProbabilities)->Data()->GetMatrix<ElemType>(VariableRowColSplitPoint(m_logProbabilities));
+                candidates.SetValue(*logProbabilities);
+                candidates.RowElementMultiplyWith(notFinished);
+                Matrix<ElemType>::MultiplyAndAdd(endTokenOffsets, false, finished, false, candidates);
+                Matrix<ElemType>::ScaleAndAdd(1, scores, candidates);
+
+                // the best K candidates of each sentence, over the candidates of all its beams
+                candidates.Reshaped(V * K, numSentences).VectorMax(topIndices, topValues, true, (int)K);
+                scores.SetValue(topValues.Reshaped(1, numBeams));
+                topIndices.CopySection(K, numSentences, hostTopIndices.data(), K);
+
+                backPointers.emplace_back(numBeams);
+                emittedTokens.emplace_back(numBeams);
+                for (size_t j = 0; j < numBeams; j++)
+                {
+                    size_t candidate = (size_t)hostTopIndices[j];
+                    size_t source = (j / K) * K + candidate / V;
+                    size_t token = candidate % V;
+                    backPointers.back()[j] = source;
+                    emittedTokens.back()[j] = token;
+                    newIsFinished[j] = isFinished[source] || token == m_endToken;
+                    newLengths[j] = isFinished[source] ? lengths[source] : lengths[source] + 1;
+                    hostGatherIndices[j] = (ElemType)source;
+                    hostTokens[j] = (ElemType)token;
+                    hostFinished[j] = newIsFinished[j] ? 1 : 0;
+                }
+                swap(isFinished, newIsFinished);
+                swap(lengths, newLengths);
+
+                // the next step continues from the selected candidates
+                gatherIndices.SetValue(1, numBeams, deviceId, hostGatherIndices.data());
+                tokenMatrix.SetValue(1, numBeams, deviceId, hostTokens.data());
+                finished.SetValue(1, numBeams, deviceId, hostFinished.data());
+                notFinished.SetValue(1);
+                notFinished -= finished;
+                for (const auto& state : m_states)
+                {
+                    auto next = outputs.at(state.second)->Data()->GetMatrix<ElemType>(VariableRowColSplitPoint(state.second));
+                    argumentMatrices[state.first]->DoGatherColumnsOf(0, gatherIndices, *next, 1);
+                }
+            }
+
+            // follow the back pointers from the final beams
+            scores.CopySection(1, numBeams, hostScores.data(), 1);
+            vector<vector<BeamSearchHypothesis>> hypotheses(numSentences);
+            for (size_t j = 0; j < numBeams; j++)
+            {
+                if (hostScores[j] <= impossibleScore / 2) // there were fewer candidates than beams
+                    continue;
+
+                BeamSearchHypothesis hypothesis;
+                hypothesis.tokens.resize(lengths[j]);
+                for (size_t t = backPointers.size(), beam = j; t-- > 0; beam = backPointers[t][beam])
+                {
+                    if (t < lengths[j]) // a finished beam has repeated its end token since
+                        hypothesis.tokens[t] = emittedTokens[t][beam];
+                }
+                hypothesis.score = hostScores[j];
+                if (m_options.lengthNormalizationExponent != 0 && lengths[j] > 0)
+                    hypothesis.score /= pow((double)lengths[j], m_options.lengthNormalizationExponent);
+                hypotheses[j / K].push_back(move(hypothesis));
+            }
+            for (auto& sentence : hypotheses)
+                stable_sort(sentence.begin(), sentence.end(), [](const BeamSearchHypothesis& a, const BeamSearchHypothesis& b) { return a.score > b.score; });
+            return hypotheses;
+        }
+
+        FunctionPtr m_stepFunction;
+        Variable m_tokenInput;
+        Variable m_logProbabilities;
+        unordered_map<Variable, Variable> m_states;
+        vector<Variable> m_arguments; // of the step function, other than the token input
+        size_t m_vocabularySize;
+        size_t m_startToken;
+        size_t m_endToken;
+        DeviceDescriptor m_device;
+        BeamSearchOptions m_options;
+    };
+
+    BeamSearchDecoderPtr CreateBeamSearchDecoder(const FunctionPtr& stepFunction, const Variable& tokenInput, const Variable& logProbabilities,
+                                                 const unordered_map<Variable, Variable>& states, size_t startToken, size_t endToken,
+                                                 const DeviceDescriptor& device, const BeamSearchOptions& options)
+    {
+        return MakeSharedObject<BeamSearchDecoderImpl>(stepFunction, tokenInput, logProbabilities, states, startToken, endToken, device, options);
+    }
+}
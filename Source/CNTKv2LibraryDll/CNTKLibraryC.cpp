@@ -167,10 +167,187 @@ CNTK_StatusCode CNTK_EvaluateSequence(CNTK_ModelHandle model,
     {
         ((EvaluatorWrapper*)model)->EvaluateSequence(
             inputs, inputValues, inputResetFlags,
-            numInputs, outputs, numOutputs, outputValues);
+            numInputs, outputs, numOutputs, outputValues, DeviceDescriptor::CPUDevice());
     });
 }
 
+CNTK_StatusCode CNTK_EvaluateSequenceOnDevice(CNTK_ModelHandle model,
+    const CNTK_Variable* inputs,
+    const CNTK_Value* inputValues,
+    const bool* inputResetFlags,
+    uint32_t numInputs,
+    const CNTK_Variable* outputs,
+    uint32_t numOutputs,
+    const CNTK_DeviceDescriptor* bufferDevice,
+    CNTK_Value* outputValues)
+{
+    if (model == CNTK_INVALID_MODEL_HANDLE)
+        return StatusCode(CNTK_INVALID_MODEL_HANDLE, "Invalid model handle");
+
+    if (!outputValues)
+        return StatusCode(CNTK_ERROR_NULL_POINTER, "'outputValues' parameter is not allowed to be null");
+
+    return ExceptionCatcher::Call(
+    [&]()
+    {
+        ((EvaluatorWrapper*)model)->EvaluateSequence(
+            inputs, inputValues, inputResetFlags,
+            numInputs, outputs, numOutputs, &outputValues, GetDeviceDescriptor(bufferDevice));
+    });
+}
+
+CNTK_StatusCode CNTK_LoadBatchingModel(const char* modelFilePath, const CNTK_DeviceDescriptor* device, uint32_t maxBatchSize, uint32_t maxWaitMicroseconds, CNTK_ModelHandle* handle)
+{
+    if (!handle)
+        return StatusCode(CNTK_ERROR_NULL_POINTER, "'handle' parameter is not allowed to be null");
+
+    if (!modelFilePath)
+        return StatusCode(CNTK_ERROR_NULL_POINTER, "'modelFilePath' parameter is not allowed to be null");
+
+    *handle = nullptr;
+    return ExceptionCatcher::Call([&]() { *handle = new BatchingEvaluatorWrapper(modelFilePath, device, maxBatchSize, maxWaitMicroseconds); });
+}
+
+CNTK_StatusCode CNTK_LoadPooledModel(const char* modelFilePath, const CNTK_DeviceDescriptor* device, uint32_t numContexts, CNTK_ModelHandle* handle)
+{
+    if (!handle)
+        return StatusCode(CNTK_ERROR_NULL_POINTER, "'handle' parameter is not allowed to be null");
+
+    if (!modelFilePath)
+        return StatusCode(CNTK_ERROR_NULL_POINTER, "'modelFilePath' parameter is not allowed to be null");
+
+    *handle = nullptr;
+    return ExceptionCatcher::Call([&]() { *handle = new PooledEvaluatorWrapper(modelFilePath, device, numContexts); });
+}
+
+CNTK_StatusCode CNTK_GetBatchingStatistics(CNTK_ModelHandle model, CNTK_BatchingStatistics* statistics)
+{
+    if (model == CNTK_INVALID_MODEL_HANDLE)
+        return StatusCode(CNTK_INVALID_MODEL_HANDLE, "Invalid model handle");
+
+    if (!statistics)
+        return StatusCode(CNTK_ERROR_NULL_POINTER, "'statistics' parameter is not allowed to be null");
+
+    return ExceptionCatcher::Call(
+    [&]()
+    {
+        auto batching = dynamic_cast<BatchingEvaluatorWrapper*>((EvaluatorWrapper*)model);
+        if (!batching)
+            InvalidArgument("The model has not been loaded by CNTK_LoadBatchingModel.");
+
+        auto s = batching->Statistics();
+        statistics->numRequests = s.numRequests;
+        statistics->numBatches = s.numBatches;
+        statistics->p50QueueingLatencyMs = s.p50QueueingLatencyMs;
+        statistics->p99QueueingLatencyMs = s.p99QueueingLatencyMs;
+    });
+}
+
+CNTK_StatusCode CNTK_PrepareModel(CNTK_ModelHandle model, const uint32_t* batchSizes, uint32_t numBatchSizes, uint32_t sequenceLength, CNTK_PreparationReport* report)
+{
+    if (model == CNTK_INVALID_MODEL_HANDLE)
+        return StatusCode(CNTK_INVALID_MODEL_HANDLE, "Invalid model handle");
+
+    if (!batchSizes && numBatchSizes > 0)
+        return StatusCode(CNTK_ERROR_NULL_POINTER, "'batchSizes' parameter is not allowed to be null");
+
+    return ExceptionCatcher::Call(
+    [&]()
+    {
+        auto wrapper = dynamic_cast<CNTKEvaluatorWrapper*>((EvaluatorWrapper*)model);
+        if (!wrapper)
+            InvalidArgument("The model cannot be prepared.");
+
+        auto r = wrapper->Prepare(vector<size_t>(batchSizes, batchSizes + numBatchSizes), sequenceLength);
+        if (!report)
+            return;
+
+        memset(report, 0, sizeof(*report));
+        report->numShapes = (uint32_t)r.entries.size();
+        report->numNetworkVariants = (uint32_t)r.numNetworkVariants;
+        report->allVariantsKept = r.allVariantsKept;
+        report->totalMs = r.totalMs;
+        for (const auto& entry : r.entries)
+        {
+            report->numStorageAllocations += entry.numStorageAllocations;
+            report->numWarmStorageAllocations += entry.numWarmStorageAllocations;
+            report->maxColdMs = max(report->maxColdMs, entry.coldMs);
+            report->maxWarmMs = max(report->maxWarmMs, entry.warmMs);
+        }
+    });
+}
+
+CNTK_StatusCode CNTK_CreateStream(CNTK_ModelHandle model, CNTK_StreamHandle* stream)
+{
+    if (model == CNTK_INVALID_MODEL_HANDLE)
+        return StatusCode(CNTK_INVALID_MODEL_HANDLE, "Invalid model handle");
+
+    if (!stream)
+        return StatusCode(CNTK_ERROR_NULL_POINTER, "'stream' parameter is not allowed to be null");
+
+    *stream = nullptr;
+    return ExceptionCatcher::Call(
+    [&]()
+    {
+        auto wrapper = dynamic_cast<CNTKEvaluatorWrapper*>((EvaluatorWrapper*)model);
+        if (!wrapper)
+            InvalidArgument("The model does not support streams.");
+
+        *stream = new StreamContextPtr(wrapper->CreateStream());
+    });
+}
+
+CNTK_StatusCode CNTK_EvaluateStreams(CNTK_ModelHandle model,
+    const CNTK_StreamHandle* streams,
+    uint32_t numStreams,
+    const CNTK_Variable* inputs,
+    const CNTK_Value* inputValues,
+    uint32_t numInputs,
+    const CNTK_Variable* outputs,
+    uint32_t numOutputs,
+    CNTK_Value** outputValues)
+{
+    if (model == CNTK_INVALID_MODEL_HANDLE)
+        return StatusCode(CNTK_INVALID_MODEL_HANDLE, "Invalid model handle");
+
+    if (!streams)
+        return StatusCode(CNTK_ERROR_NULL_POINTER, "'streams' parameter is not allowed to be null");
+
+    if (!outputValues)
+        return StatusCode(CNTK_ERROR_NULL_POINTER, "'outputValues' parameter is not allowed to be null");
+
+    return ExceptionCatcher::Call(
+    [&]()
+    {
+        auto wrapper = dynamic_cast<CNTKEvaluatorWrapper*>((EvaluatorWrapper*)model);
+        if (!wrapper)
+            InvalidArgument("The model does not support streams.");
+
+        std::vector<StreamContextPtr> contexts;
+        for (uint32_t i = 0; i < numStreams; ++i)
+        {
+            if (!streams[i])
+                InvalidArgument("Stream %d is null.", (int)i);
+            contexts.push_back(*(StreamContextPtr*)streams[i]);
+        }
+
+        wrapper->EvaluateStreams(contexts, inputs, inputValues, numInputs, outputs, numOutputs, outputValues);
+    });
+}
+
+CNTK_StatusCode CNTK_ResetStream(CNTK_StreamHandle stream)
+{
+    if (!stream)
+        return StatusCode(CNTK_ERROR_INVALID_HANDLE, "Invalid stream handle");
+
+    return ExceptionCatcher::Call([&]() { (*(StreamContextPtr*)stream)->Reset(); });
+}
+
+void CNTK_ReleaseStream(CNTK_StreamHandle stream)
+{
+    delete (StreamContextPtr*)stream;
+}
+
 void CNTK_ReleaseArray(void* array)
 {
     // No destructor will be called!
@@ -11,6 +11,9 @@
 #include <memory>
 #include <algorithm>
 #include <CPUMatrix.h> // For CPUMatrix::SetNumThreads
+#include <NumaPolicy.h>
+#include <CuDnnAlgorithmCache.h>
+#include <CUDAPageLockedMemAllocator.h>
 #include <thread>
 #include "GPUMatrix.h"
 #include "Globals.h"
@@ -171,6 +174,16 @@ namespace CNTK
             Microsoft::MSR::CNTK::Globals::SetGradientAccumulationOptimization(/* enable = */ false);
         }
 
+        void EnableActivationRecomputation()
+        {
+            Microsoft::MSR::CNTK::Globals::SetActivationRecomputation(/* enable = */ true);
+        }
+
+        void DisableActivationRecomputation()
+        {
+            Microsoft::MSR::CNTK::Globals::SetActivationRecomputation(/* enable = */ false);
+        }
+
         void StartProfiler(const wstring& profilerDir, bool profilerSyncGpu, size_t profilerBufferSize)
         {
 #ifndef CNTK_UWP
@@ -210,6 +223,38 @@ namespace CNTK
 #endif
         }
 
+        std::unordered_map<std::wstring, std::pair<size_t, double>> GetProfiledTimes()
+        {
+            std::unordered_map<std::wstring, std::pair<size_t, double>> times;
+#ifndef CNTK_UWP
+            for (int eventId = 0; eventId < Microsoft::MSR::CNTK::profilerEvtMax; ++eventId)
+            {
+                std::string description;
+                int count;
+                double seconds;
+                if (!Microsoft::MSR::CNTK::ProfilerGetTimeEventTotals(eventId, description, count, seconds) || count == 0)
+                    continue;
+
+                // the leading underscores only indent the summary report
+                description.erase(0, description.find_first_not_of('_'));
+                times[Microsoft::MSR::CNTK::ToFixedWStringFromMultiByte(description)] = std::make_pair((size_t)count, seconds);
+            }
+#endif
+            return times;
+        }
+
+        size_t GetUsedDeviceMemoryInMB(const DeviceDescriptor& device)
+        {
+            if (device.Type() != DeviceKind::GPU)
+                return 0;
+#ifdef CPUONLY
+            return 0;
+#else
+            auto freeAndTotal = Microsoft::MSR::CNTK::TracingGPUMemoryAllocator::GetFreeAndTotalMemoryInMBs(AsCNTKImplDeviceId(device));
+            return freeAndTotal.second - freeAndTotal.first;
+#endif
+        }
+
         void EnableNodeTiming()
         {
             Microsoft::MSR::CNTK::Globals::SetNodeTiming(true);
@@ -224,17 +269,176 @@ namespace CNTK
         {
             // optimization is only for float
             int flags = Microsoft::MSR::CNTK::CPUMatrix<float>::GetOptimizationFlags();
-            flags |= Microsoft::MSR::CNTK::CPUMatrix<float>::OPT_EVAL_WITH_MKL;
-            Microsoft::MSR::CNTK::CPUMatrix<float>::SetOptimizationFlags(Microsoft::MSR::CNTK::CPUMatrix<float>::OPT_EVAL_WITH_MKL);
+            flags |= Microsoft::MSR::CNTK::CPUMatrix<float>::OPT_EVAL_WITH_MKL | Microsoft::MSR::CNTK::CPUMatrix<float>::OPT_EVAL_WITH_SIMD;
+            Microsoft::MSR::CNTK::CPUMatrix<float>::SetOptimizationFlags(flags);
         }
 
         void DisableCPUEvalOptimization()
         {
             int flags = Microsoft::MSR::CNTK::CPUMatrix<float>::GetOptimizationFlags();
-            flags &= ~Microsoft::MSR::CNTK::CPUMatrix<float>::OPT_EVAL_WITH_MKL;
+            flags &= ~(Microsoft::MSR::CNTK::CPUMatrix<float>::OPT_EVAL_WITH_MKL | Microsoft::MSR::CNTK::CPUMatrix<float>::OPT_EVAL_WITH_SIMD);
             Microsoft::MSR::CNTK::CPUMatrix<float>::SetOptimizationFlags(flags);
         }
 
+        void EnableCPUInt8Inference()
+        {
+            Microsoft::MSR::CNTK::Globals::SetInt8Inference(true);
+        }
+
+        void DisableCPUInt8Inference()
+        {
+            Microsoft::MSR::CNTK::Globals::SetInt8Inference(false);
+        }
+
+        void EnableCPUBlockSparseInference(size_t blockRows, size_t blockCols, double maxDensity)
+        {
+            if (blockRows == 0 || blockCols == 0)
+                InvalidArgument("EnableCPUBlockSparseInference: The block size %d x %d is invalid.", (int)blockRows, (int)blockCols);
+            if (maxDensity < 0 || maxDensity > 1)
+                InvalidArgument("EnableCPUBlockSparseInference: The maximum density %f is not in [0, 1].", maxDensity);
+            Microsoft::MSR::CNTK::Globals::SetBlockSparseInference(true, blockRows, blockCols, maxDensity);
+        }
+
+        void DisableCPUBlockSparseInference()
+        {
+            Microsoft::MSR::CNTK::Globals::SetBlockSparseInference(false);
+        }
+
+        void EnableForwardPropFusion()
+        {
+            Microsoft::MSR::CNTK::Globals::SetForwardPropFusion(true);
+        }
+
+        void DisableForwardPropFusion()
+        {
+            Microsoft::MSR::CNTK::Globals::SetForwardPropFusion(false);
+        }
+
+        void EnableElementwiseFusion()
+        {
+            Microsoft::MSR::CNTK::Globals::SetElementwiseFusion(true);
+        }
+
+        void DisableElementwiseFusion()
+        {
+            Microsoft::MSR::CNTK::Globals::SetElementwiseFusion(false);
+        }
+
+        void EnableGPUGraphCapture()
+        {
+            Microsoft::MSR::CNTK::Globals::SetGPUGraphCapture(true);
+        }
+
+        void DisableGPUGraphCapture()
+        {
+            Microsoft::MSR::CNTK::Globals::SetGPUGraphCapture(false);
+        }
+
+        void EnableMultiStreamExecution(size_t numStreams)
+        {
+            if (numStreams == 0)
+                InvalidArgument("EnableMultiStreamExecution: The number of streams must be positive.");
+            Microsoft::MSR::CNTK::Globals::SetNumExecutionStreams(numStreams);
+            Microsoft::MSR::CNTK::Globals::SetMultiStreamExecution(true);
+        }
+
+        void DisableMultiStreamExecution()
+        {
+            Microsoft::MSR::CNTK::Globals::SetMultiStreamExecution(false);
+        }
+
+        void EnableInterOpParallelism()
+        {
+            Microsoft::MSR::CNTK::Globals::SetInterOpParallelism(true);
+        }
+
+        void DisableInterOpParallelism()
+        {
+            Microsoft::MSR::CNTK::Globals::SetInterOpParallelism(false);
+        }
+
+        void EnableInferenceGraphOptimization()
+        {
+            Microsoft::MSR::CNTK::Globals::SetInferenceGraphOptimization(true);
+        }
+
+        void DisableInferenceGraphOptimization()
+        {
+            Microsoft::MSR::CNTK::Globals::SetInferenceGraphOptimization(false);
+        }
+
+        void EnableMultiTensorLearnerUpdates()
+        {
+            Microsoft::MSR::CNTK::Globals::SetMultiTensorLearnerUpdates(true);
+        }
+
+        void DisableMultiTensorLearnerUpdates()
+        {
+            Microsoft::MSR::CNTK::Globals::SetMultiTensorLearnerUpdates(false);
+        }
+
+        void EnablePersistentRNN()
+        {
+            Microsoft::MSR::CNTK::Globals::SetPersistentRNN(true);
+        }
+
+        void DisablePersistentRNN()
+        {
+            Microsoft::MSR::CNTK::Globals::SetPersistentRNN(false);
+        }
+
+        void EnablePipelineParallelism()
+        {
+            Microsoft::MSR::CNTK::Globals::SetPipelineParallelism(true);
+        }
+
+        void DisablePipelineParallelism()
+        {
+            Microsoft::MSR::CNTK::Globals::SetPipelineParallelism(false);
+        }
+
+        void SetMaxNumCompiledNetworksPerFunction(size_t maxNumNetworks)
+        {
+            if (maxNumNetworks == 0)
+                InvalidArgument("SetMaxNumCompiledNetworksPerFunction: A Function needs to be able to keep at least one network.");
+            Microsoft::MSR::CNTK::Globals::SetMaxNumCompiledNetworks(maxNumNetworks);
+        }
+
+        size_t GetMaxNumCompiledNetworksPerFunction()
+        {
+            return Microsoft::MSR::CNTK::Globals::GetMaxNumCompiledNetworks();
+        }
+
+        void SetNumaPolicy(const std::wstring& policy, int numaNode)
+        {
+            Microsoft::MSR::CNTK::NumaPolicy::Set(Microsoft::MSR::CNTK::NumaPolicy::Parse(policy), numaNode);
+        }
+
+        void SetHugePages(const std::wstring& kind, size_t minBytes)
+        {
+            Microsoft::MSR::CNTK::HugePages::Set(Microsoft::MSR::CNTK::HugePages::Parse(kind), minBytes);
+        }
+
+        size_t GetExplicitHugePageBytes()
+        {
+            return Microsoft::MSR::CNTK::HugePages::GetStats().explicitBytes;
+        }
+
+        size_t GetTransparentHugePageBytes()
+        {
+            return Microsoft::MSR::CNTK::HugePages::GetStats().transparentBackedBytes;
+        }
+
+        void SetCuDnnAlgorithmCache(const std::wstring& path, bool writable, bool autotune)
+        {
+            Microsoft::MSR::CNTK::CuDnnAlgorithmCache::Set(path, writable, autotune);
+        }
+
+        uint64_t GetNumStorageAllocations()
+        {
+            return Microsoft::MSR::CNTK::GetNumMatrixStorageAllocations();
+        }
+
         void SetMPIPackThreshold(size_t packThesholdInBytes)
         {
             Microsoft::MSR::CNTK::Globals::SetMPIPackThreshold(packThesholdInBytes);
@@ -583,6 +787,57 @@ namespace CNTK
             Microsoft::MSR::CNTK::TracingGPUMemoryAllocator::SetTraceLevel(traceLevel);
         }
 
+        void EnableGPUMemoryCaching(bool enable)
+        {
+            Microsoft::MSR::CNTK::TracingGPUMemoryAllocator::SetCachingEnabled(enable);
+        }
+
+        void SetGPUMemoryCacheLimitInMBs(size_t limitInMBs)
+        {
+            Microsoft::MSR::CNTK::TracingGPUMemoryAllocator::SetCacheLimitInMBs(limitInMBs);
+        }
+
+        void EmptyGPUMemoryCache(int deviceId)
+        {
+            Microsoft::MSR::CNTK::TracingGPUMemoryAllocator::EmptyCache(deviceId);
+        }
+
+        GPUMemoryTelemetry GetGPUMemoryTelemetry(int deviceId)
+        {
+            using namespace Microsoft::MSR::CNTK;
+            auto stats = TracingGPUMemoryAllocator::GetCacheStats(deviceId);
+
+            GPUMemoryTelemetry telemetry;
+            telemetry.bytesInUse = stats.bytesInUse;
+            telemetry.bytesRequested = stats.bytesRequested;
+            telemetry.bytesCached = stats.bytesCached;
+            telemetry.peakBytesInUse = stats.peakBytesInUse;
+            telemetry.peakBytesReserved = stats.peakBytesReserved;
+            telemetry.fragmentation = stats.Fragmentation();
+            telemetry.cacheHitRate = stats.HitRate();
+            for (int i = 0; i < (int)GPUMemoryCategory::Count; i++)
+            {
+                telemetry.bytesInUseByCategory[GPUMemoryCategoryName((GPUMemoryCategory)i)] = stats.bytesInUseByCategory[i];
+                telemetry.peakBytesInUseByCategory[GPUMemoryCategoryName((GPUMemoryCategory)i)] = stats.peakBytesInUseByCategory[i];
+            }
+            return telemetry;
+        }
+
+        void ResetGPUMemoryPeaks(int deviceId)
+        {
+            Microsoft::MSR::CNTK::TracingGPUMemoryAllocator::ResetPeakStats(deviceId);
+        }
+
+        void SetPinnedMemoryCacheLimitInMBs(size_t limitInMBs)
+        {
+            Microsoft::MSR::CNTK::CUDAPageLockedMemAllocator::SetCacheLimitInMBs(limitInMBs);
+        }
+
+        void EmptyPinnedMemoryCache()
+        {
+            Microsoft::MSR::CNTK::CUDAPageLockedMemAllocator::EmptyCache();
+        }
+
         void SetMathLibTraceLevel(int traceLevel)
         {
             Microsoft::MSR::CNTK::SetMathLibTraceLevel(traceLevel);
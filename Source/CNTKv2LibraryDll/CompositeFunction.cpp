@@ -25,6 +25,7 @@
 #include "SpecialPurposeNodes.h"
 #include "SequenceReshapeNodes.h"
 #include "UserDefinedFunction.h"
+#include "ThreadPool.h"
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -32,6 +33,7 @@ namespace CNTK
 {
     /*static*/ const std::wstring CompositeFunction::CompositeFunctionOpName = L"CompositeFunctionOpName";
     /*static*/ std::atomic<unsigned int> CompositeFunction::s_nextAutoGeneratedDynamicAxis(0);
+    /*static*/ std::atomic<size_t> CompositeFunction::s_graphStructureVersion(0);
 
     static const std::wstring s_compositeFunctionTypeValue = L"CompositeFunction";
 
@@ -439,6 +441,81 @@ namespace CNTK
         }
     }
 
+    // Gradient accumulation: a parameter whose gradient matrix is reused by its consumer holds the gradient of the consumer
+    // after backprop, so the sum so far is kept aside in 'sum', and added back afterwards.
+    template <typename ElementType>
+    static void KeepGradientAside(const ComputationNodeBasePtr& node, std::shared_ptr<MatrixBase>& sum)
+    {
+        const auto& gradient = dynamic_cast<ComputationNode<ElementType>*>(&*node)->Gradient();
+        auto typedSum = std::dynamic_pointer_cast<Matrix<ElementType>>(sum);
+        if (!typedSum)
+        {
+            typedSum = std::make_shared<Matrix<ElementType>>(gradient.GetDeviceId());
+            sum = typedSum;
+        }
+        typedSum->AssignValuesOf(gradient);
+    }
+
+    template <typename ElementType>
+    static void AddGradientKeptAside(const ComputationNodeBasePtr& node, const std::shared_ptr<MatrixBase>& sum)
+    {
+        dynamic_cast<ComputationNode<ElementType>*>(&*node)->Gradient() += *std::dynamic_pointer_cast<Matrix<ElementType>>(sum);
+    }
+
+    static void KeepGradientAside(DataType dataType, const ComputationNodeBasePtr& node, std::shared_ptr<MatrixBase>& sum)
+    {
+        switch (dataType)
+        {
+        case DataType::Float:
+            return KeepGradientAside<float>(node, sum);
+        case DataType::Double:
+            return KeepGradientAside<double>(node, sum);
+        case DataType::Float16:
+            return KeepGradientAside<half>(node, sum);
+        default:
+            LogicError("Unsupported data type");
+        }
+    }
+
+    static void AddGradientKeptAside(DataType dataType, const ComputationNodeBasePtr& node, const std::shared_ptr<MatrixBase>& sum)
+    {
+        switch (dataType)
+        {
+        case DataType::Float:
+            return AddGradientKeptAside<float>(node, sum);
+        case DataType::Double:
+            return AddGradientKeptAside<double>(node, sum);
+        case DataType::Float16:
+            return AddGradientKeptAside<half>(node, sum);
+        default:
+            LogicError("Unsupported data type");
+        }
+    }
+
+    // A TopK of the Softmax of a vector is computed by a TopKNode on the input of the Softmax, which selects the largest
+    // inputs and only computes their probabilities. The Softmax itself then only runs if its output is used elsewhere.
+    static bool IsTopKOfSoftmax(Function* function, Variable& softmaxInput)
+    {
+        PrimitiveFunction* primitiveFunction = dynamic_cast<PrimitiveFunction*>(function);
+        if (!primitiveFunction || (primitiveFunction->OpType() != PrimitiveOpType::TopK))
+            return false;
+
+        auto topKInput = function->Inputs()[0];
+        if (!topKInput.IsOutput())
+            return false;
+        PrimitiveFunction* softmaxFunction = dynamic_cast<PrimitiveFunction*>(topKInput.Owner().get());
+        if (!softmaxFunction || (softmaxFunction->OpType() != PrimitiveOpType::Softmax))
+            return false;
+
+        // the Softmax normalizes the whole sample, which is the axis of the TopK only for vectors
+        auto input = softmaxFunction->Inputs()[0];
+        if (input.Shape().IsUnknown() || (input.Shape().Rank() != 1) || (input.GetDataType() != topKInput.GetDataType()))
+            return false;
+
+        softmaxInput = input;
+        return true;
+    }
+
     // Recursively create a sub-network of ComputationNode instances corresponding to the graph of Functions
     // underlying the specified 'variable' and return the ComputationNode instance that corresponds to the
     // top level 'variable'
@@ -485,7 +562,8 @@ namespace CNTK
                 computationNodePtr->SetLearningRateMultiplier(0.0);
 
             NDArrayViewPtr value = variable.IsConstant() ? Constant(variable).Value() : Parameter(variable).Value();
-            std::shared_ptr<const MatrixBase> valueMatrix = variable.IsConstant() ? value->GetMatrixBase() : value->GetWritableMatrixBase();
+            // A read-only Parameter (e.g. loaded from a memory-mapped model file) is linked as is; it can be evaluated but not learned.
+            std::shared_ptr<const MatrixBase> valueMatrix = (variable.IsConstant() || value->IsReadOnly()) ? value->GetMatrixBase() : value->GetWritableMatrixBase();
 
             if (variable.IsParameter() || (valueMatrix->GetDeviceId() == network->GetDeviceId()))
             {
@@ -664,6 +742,35 @@ namespace CNTK
             return mappingVariable;
     }
 
+    // Copies the quantized table of a QuantizedLookupTable Function, int8 or float16 codes and their scales and offsets, into its node.
+    template <typename ElementType>
+    static void SetQuantizedTable(QuantizedLookupTableNode<ElementType>& node, const NDArrayView& codes, const NDArrayView& scalesAndOffsets)
+    {
+        const auto& shape = codes.Shape();
+        if (shape.Rank() != 2 || scalesAndOffsets.Shape().TotalSize() != 2 * shape[1])
+            LogicError("QuantizedLookupTable: The table of shape '%S' does not match its scales and offsets of shape '%S'.", shape.AsString().c_str(), scalesAndOffsets.Shape().AsString().c_str());
+
+        auto hostScalesAndOffsets = scalesAndOffsets.DeepClone(DeviceDescriptor::CPUDevice(), /*readOnly=*/ true);
+        std::vector<ElementType> scalesAndOffsetsData(hostScalesAndOffsets->Shape().TotalSize());
+        for (size_t i = 0; i < scalesAndOffsetsData.size(); i++)
+        {
+            if (hostScalesAndOffsets->GetDataType() == DataType::Float)
+                scalesAndOffsetsData[i] = (ElementType)hostScalesAndOffsets->DataBuffer<float>()[i];
+            else if (hostScalesAndOffsets->GetDataType() == DataType::Double)
+                scalesAndOffsetsData[i] = (ElementType)hostScalesAndOffsets->DataBuffer<double>()[i];
+        }
+        if (hostScalesAndOffsets->GetDataType() != DataType::Float && hostScalesAndOffsets->GetDataType() != DataType::Double)
+            LogicError("QuantizedLookupTable: Unsupported DataType %s of the scales and offsets.", DataTypeName(hostScalesAndOffsets->GetDataType()));
+
+        auto hostCodes = codes.DeepClone(DeviceDescriptor::CPUDevice(), /*readOnly=*/ true);
+        if (hostCodes->GetDataType() == DataType::Int8)
+            node.SetQuantizedTable(shape[0], shape[1], reinterpret_cast<const char*>(hostCodes->DataBuffer<int8_t>()), scalesAndOffsetsData.data());
+        else if (hostCodes->GetDataType() == DataType::Float16)
+            node.SetQuantizedTable(shape[0], shape[1], reinterpret_cast<const half*>(hostCodes->DataBuffer<float16>()), scalesAndOffsetsData.data());
+        else
+            LogicError("QuantizedLookupTable: Unsupported DataType %s of the table, expected Int8 or Float16.", DataTypeName(hostCodes->GetDataType()));
+    }
+
     template<typename ElementType>
     /*static*/ ComputationNodeBasePtr CompositeFunction::CreateComputationNode(const Variable& variable,
                                                                                Function* function,
@@ -804,7 +911,8 @@ namespace CNTK
                 case PrimitiveOpType::TopK:
                 {
                     auto k = functionConfig[PrimitiveFunctionAttribute::AttributeNameNumItems].Value<size_t>();
-                    ASSIGN_NEW_NODE(TopKNode, network->GetDeviceId(), internalNodeName, k);
+                    Variable softmaxInput;
+                    ASSIGN_NEW_NODE(TopKNode, network->GetDeviceId(), internalNodeName, k, IsTopKOfSoftmax(function, softmaxInput));
                     break;
                 }
                 case PrimitiveOpType::StableSigmoid:
@@ -1030,8 +1138,16 @@ namespace CNTK
                     break;
                 }
                 case PrimitiveOpType::Gather:
-                    ASSIGN_NEW_NODE(GatherNode, network->GetDeviceId(), internalNodeName);
+                {
+                    int axisIndex = -1;
+                    if (functionConfig.Contains(PrimitiveFunctionAttribute::AttributeNameAxis))
+                    {
+                        auto axis = functionConfig[PrimitiveFunctionAttribute::AttributeNameAxis].Value<Axis>();
+                        axisIndex = NormalizeStaticAxis(axis, functionInputs[1].Shape()).StaticAxisIndex();
+                    }
+                    ASSIGN_NEW_NODE(GatherNode, network->GetDeviceId(), internalNodeName, axisIndex);
                     break;
+                }
                 case PrimitiveOpType::ToBatch:
                 {
                     ASSIGN_NEW_NODE(ToBatchAxisNode, network->GetDeviceId(), internalNodeName);
@@ -1261,6 +1377,21 @@ namespace CNTK
                     ASSIGN_NEW_NODE(BatchNormalizationNode, network->GetDeviceId(), internalNodeName, spatial, normalizationTimeConstant, blendTimeConstant, epsilon, !useCuDNNEngine, disableRegularization, ImageLayoutKind::CHW);
                     break;
                 }
+                case PrimitiveOpType::LayerNormalization:
+                {
+                    auto epsilon = functionConfig[PrimitiveFunctionAttribute::AttributeNameEpsilon].Value<double>();
+                    ASSIGN_NEW_NODE(LayerNormalizationNode, network->GetDeviceId(), internalNodeName, epsilon);
+                    break;
+                }
+                case PrimitiveOpType::QuantizedLookupTable:
+                {
+                    auto indexInput = functionConfig[PrimitiveFunctionAttribute::AttributeNameIndexInput].Value<bool>();
+                    auto node = New<QuantizedLookupTableNode<ElementType>>(network->GetDeviceId(), internalNodeName, indexInput);
+                    SetQuantizedTable(*node, functionConfig[PrimitiveFunctionAttribute::AttributeNameQuantizedTable].Value<NDArrayView>(),
+                                      functionConfig[PrimitiveFunctionAttribute::AttributeNameQuantizedTableScalesAndOffsets].Value<NDArrayView>());
+                    computationNodePtr = node;
+                    break;
+                }
                 case PrimitiveOpType::Combine:
                     // This operation is just a no-op and is a means to combine multiple functions to create a single Function
                     // whose outputs are a union of the outputs of the Functions being combined.
@@ -1463,15 +1594,24 @@ namespace CNTK
 
         // Create the nodes corresponding to the inputs
         std::vector<std::shared_ptr<ComputationNodeBase>> inputNodes;
-        for (auto& inputVar : functionInputs)
+        Variable softmaxInput;
+        if (IsTopKOfSoftmax(function, softmaxInput))
+        {
+            inputNodes.push_back(GetNode(softmaxInput, network, builder, fullyDefinedArgumentsMap, variableToNodeMap, isVariableRootMap, inputsToExcludeGradientsFor, useMangledNamesForComputationNodes));
+            isVariableRootMap[softmaxInput] = false;
+        }
+        else
         {
-            // If the inputVar is a constant and not the right DataType let's coerce it to the right type
-            // except for FP16 that mismatch is needed (e.g. BatchNorm stats in FP16 need to be FP32)
-            if (inputVar.IsConstant() && (nonConstInputDataType != DataType::Unknown) && (nonConstInputDataType != DataType::Float16) && (inputVar.GetDataType() != nonConstInputDataType))
-                inputVar = Constant(inputVar).CloneAs(nonConstInputDataType);
+            for (auto& inputVar : functionInputs)
+            {
+                // If the inputVar is a constant and not the right DataType let's coerce it to the right type
+                // except for FP16 that mismatch is needed (e.g. BatchNorm stats in FP16 need to be FP32)
+                if (inputVar.IsConstant() && (nonConstInputDataType != DataType::Unknown) && (nonConstInputDataType != DataType::Float16) && (inputVar.GetDataType() != nonConstInputDataType))
+                    inputVar = Constant(inputVar).CloneAs(nonConstInputDataType);
 
-            auto baseNodePtr = GetNode(inputVar, network, builder, fullyDefinedArgumentsMap, variableToNodeMap, isVariableRootMap, inputsToExcludeGradientsFor, useMangledNamesForComputationNodes);
-            inputNodes.push_back((baseNodePtr != nullptr) ? baseNodePtr : nullptr);
+                auto baseNodePtr = GetNode(inputVar, network, builder, fullyDefinedArgumentsMap, variableToNodeMap, isVariableRootMap, inputsToExcludeGradientsFor, useMangledNamesForComputationNodes);
+                inputNodes.push_back((baseNodePtr != nullptr) ? baseNodePtr : nullptr);
+            }
         }
 
         BlockFunction* blockFunction = dynamic_cast<BlockFunction*>(function);
@@ -1704,6 +1844,30 @@ namespace CNTK
         if ((m_computationNetwork != nullptr) && (m_currentBackpropRoots.empty() && !backpropRoots.empty()))
             PurgeComputationNetwork();
 
+        // For inference, switch to (or make room for) the network for these outputs and argument shapes, if a few are kept
+        if (allocateNetworkMatrices && backpropRoots.empty() && m_currentBackpropRoots.empty() && (Microsoft::MSR::CNTK::Globals::GetMaxNumCompiledNetworks() > 1))
+        {
+            auto argumentShapes = FullyDefinedArgumentShapes();
+            bool isCurrentNetworkSuitable = (m_computationNetwork != nullptr) && (argumentShapes == m_networkArgumentShapes) &&
+                std::all_of(outputs.begin(), outputs.end(), [this](const Variable& output) { return m_allNetworkRoots.find(output) != m_allNetworkRoots.end(); });
+            if (!isCurrentNetworkSuitable)
+                SwitchNetworkVariant(device, outputs, argumentShapes);
+        }
+
+        // A network that was optimized for inference only computes the outputs it was built for, and holds copies of
+        // the values that it computed from Parameters and Constants; rebuild it if either no longer fits.
+        if ((m_computationNetwork != nullptr) && m_networkOptimizedForInference)
+        {
+            bool isOutdated = std::any_of(outputs.begin(), outputs.end(), [this](const Variable& output) { return m_allNetworkRoots.find(output) == m_allNetworkRoots.end(); });
+            for (const auto& timeStampRecord : m_lastRecordedTimeStamps)
+            {
+                const auto& variable = timeStampRecord.first;
+                isOutdated |= (m_refVariables.find(variable) == m_refVariables.end()) && (variable.CurrentValueTimeStamp() > timeStampRecord.second);
+            }
+            if (isOutdated)
+                PurgeComputationNetwork();
+        }
+
         if (m_computationNetwork != nullptr)
         {
             // TODO: We should either invalidate and readapt the network if the backpropRoots change compared to what was specified when the network
@@ -1800,19 +1964,77 @@ namespace CNTK
             if (!m_currentBackpropRoots.empty())
                 backpropRootNode = m_variableToNodeMap.at(*m_currentBackpropRoots.begin());
 
-            // Now recursively traverse the network in a top-down fashion
-            auto rootFunction = RootFunction();
-            auto rootFunctionOutputs = rootFunction->RawOutputs();
-            m_allNetworkRoots.insert(rootFunctionOutputs.begin(), rootFunctionOutputs.end());
-            std::vector<ComputationNodeBasePtr> forwardRootNodes;
-            for (auto rootOutput : rootFunctionOutputs)
-                forwardRootNodes.push_back(m_variableToNodeMap.at(rootOutput));
-
             std::vector<ComputationNodeBasePtr> forwardOutputNodes;
             m_allNetworkRoots.insert(outputs.begin(), outputs.end());
             for (auto output : outputs)
                 forwardOutputNodes.push_back(m_variableToNodeMap.at(output));
 
+            // Simplify the network down to the requested outputs when it is only evaluated. The Constants that are
+            // assigned to are not constant for that purpose.
+            if (m_currentBackpropRoots.empty() && Microsoft::MSR::CNTK::Globals::ShouldOptimizeInferenceGraphs())
+            {
+                std::set<ComputationNodeBasePtr> constantNodes;
+                for (const auto& variableToNode : m_variableToNodeMap)
+                {
+                    if (variableToNode.first.IsConstant() && (m_refVariables.find(variableToNode.first) == m_refVariables.end()))
+                        constantNodes.insert(variableToNode.second);
+                }
+                m_computationNetwork->OptimizeForInference(forwardOutputNodes, constantNodes);
+                m_computationNetwork->SetEvalTimeStampsOutdatedWithRegardToAll();
+                m_networkOptimizedForInference = true;
+            }
+
+            // Now recursively traverse the network in a top-down fashion
+            std::vector<ComputationNodeBasePtr> forwardRootNodes;
+            if (m_networkOptimizedForInference)
+                forwardRootNodes = forwardOutputNodes;
+            else
+            {
+                auto rootFunction = RootFunction();
+                auto rootFunctionOutputs = rootFunction->RawOutputs();
+                m_allNetworkRoots.insert(rootFunctionOutputs.begin(), rootFunctionOutputs.end());
+                for (auto rootOutput : rootFunctionOutputs)
+                    forwardRootNodes.push_back(m_variableToNodeMap.at(rootOutput));
+            }
+
+            // Pipeline parallelism: Parameters on several devices split the network into stages on them. The Parameters
+            // stay where they are, since their values are shared with the learners.
+            if (backpropRootNode && Microsoft::MSR::CNTK::Globals::ShouldUsePipelineParallelism())
+            {
+                std::set<ComputationNodeBasePtr> parameterNodes;
+                for (const auto& variableToNode : m_variableToNodeMap)
+                {
+                    if (variableToNode.first.IsParameter())
+                        parameterNodes.insert(variableToNode.second);
+                }
+                std::vector<DEVICEID_TYPE> stageDevices;
+                std::vector<ComputationNodeBasePtr> stagedParameterNodes;
+                std::vector<size_t> stages;
+                for (const auto& node : m_computationNetwork->GetEvalOrder(backpropRootNode))
+                {
+                    if (parameterNodes.find(node) == parameterNodes.end())
+                        continue;
+                    const DEVICEID_TYPE parameterDevice = node->ValuePtr()->GetDeviceId();
+                    const size_t stage = std::find(stageDevices.begin(), stageDevices.end(), parameterDevice) - stageDevices.begin();
+                    if (stage == stageDevices.size())
+                        stageDevices.push_back(parameterDevice);
+                    stagedParameterNodes.push_back(node);
+                    stages.push_back(stage);
+                }
+                if (stageDevices.size() > 1)
+                {
+                    for (size_t i = 0; i < stagedParameterNodes.size(); i++)
+                    {
+                        stagedParameterNodes[i]->MoveToDevice(stageDevices[stages[i]]); // the node on the device of its value, e.g. for the gradient
+                        stagedParameterNodes[i]->SetPipelineStage((int)stages[i]);
+                    }
+                    std::vector<ComputationNodeBasePtr> rootNodes(forwardRootNodes);
+                    rootNodes.insert(rootNodes.end(), forwardOutputNodes.begin(), forwardOutputNodes.end());
+                    rootNodes.push_back(backpropRootNode);
+                    m_computationNetwork->PlacePipelineStages(stageDevices, rootNodes, parameterNodes);
+                }
+            }
+
             m_computationNetwork->AllocateAllMatrices(forwardRootNodes, forwardOutputNodes, backpropRootNode);
             m_networkMatricesAllocated = allocateNetworkMatrices;
         }
@@ -1829,21 +2051,92 @@ namespace CNTK
             }
         }
 
+        m_networkArgumentShapes = FullyDefinedArgumentShapes();
         return m_computationNetwork;
     }
 
+    std::unordered_map<Variable, NDShape> CompositeFunction::FullyDefinedArgumentShapes() const
+    {
+        std::unordered_map<Variable, NDShape> argumentShapes;
+        for (const auto& fullyDefinedArgument : m_fullyDefinedArgumentsMap)
+            argumentShapes.insert({ fullyDefinedArgument.first, fullyDefinedArgument.second.Shape() });
+        return argumentShapes;
+    }
+
+    // Keeps the current network (if it is set up for inference) among m_networkVariants, and brings back the most recently
+    // used one that computes 'outputs' for 'argumentShapes' on 'device'. Without one, there is no current network after
+    // this, and GetComputationNetwork() builds it. The networks share the Parameters and Constants; each records their
+    // time stamps, so a network that comes back recomputes what depends on values that changed meanwhile.
+    // Note: The Dropout rates and random seeds set in the meantime are not applied to the networks that are kept;
+    // the former do not matter for inference, and the random operations of each network continue their own sequence.
+    void CompositeFunction::SwitchNetworkVariant(const DeviceDescriptor& device, const std::unordered_set<Variable>& outputs, const std::unordered_map<Variable, NDShape>& argumentShapes)
+    {
+        if ((m_computationNetwork != nullptr) && m_networkMatricesAllocated)
+        {
+            NetworkVariant current;
+            current.m_computationNetwork = std::move(m_computationNetwork);
+            current.m_variableToNodeMap = std::move(m_variableToNodeMap);
+            current.m_argumentShapes = std::move(m_networkArgumentShapes);
+            current.m_allNetworkRoots = std::move(m_allNetworkRoots);
+            current.m_lastRecordedTimeStamps = std::move(m_lastRecordedTimeStamps);
+            current.m_inputsExcludedFromGradientComputation = std::move(m_inputsExcludedFromGradientComputation);
+            current.m_valueConversionStorage = std::move(m_valueConversionStorage);
+            current.m_networkOptimizedForInference = m_networkOptimizedForInference;
+            m_networkVariants.push_front(std::move(current));
+        }
+        PurgeComputationNetwork();
+        m_allNetworkRoots.clear();
+
+        auto variant = std::find_if(m_networkVariants.begin(), m_networkVariants.end(), [&](const NetworkVariant& variant)
+        {
+            return (AsDeviceDescriptor(variant.m_computationNetwork->GetDeviceId()) == device) && (variant.m_argumentShapes == argumentShapes) &&
+                std::all_of(outputs.begin(), outputs.end(), [&variant](const Variable& output) { return variant.m_allNetworkRoots.find(output) != variant.m_allNetworkRoots.end(); });
+        });
+        if (variant != m_networkVariants.end())
+        {
+            m_computationNetwork = std::move(variant->m_computationNetwork);
+            m_variableToNodeMap = std::move(variant->m_variableToNodeMap);
+            m_networkArgumentShapes = std::move(variant->m_argumentShapes);
+            m_allNetworkRoots = std::move(variant->m_allNetworkRoots);
+            m_lastRecordedTimeStamps = std::move(variant->m_lastRecordedTimeStamps);
+            m_inputsExcludedFromGradientComputation = std::move(variant->m_inputsExcludedFromGradientComputation);
+            m_valueConversionStorage = std::move(variant->m_valueConversionStorage);
+            m_networkOptimizedForInference = variant->m_networkOptimizedForInference;
+            m_networkMatricesAllocated = true;
+            m_networkVariants.erase(variant);
+        }
+
+        // the current network counts against the limit
+        auto maxNumVariants = Microsoft::MSR::CNTK::Globals::GetMaxNumCompiledNetworks() - 1;
+        while (m_networkVariants.size() > maxNumVariants)
+            m_networkVariants.pop_back();
+    }
+
     template <typename ElementType>
-    /*static*/ void CompositeFunction::PopulateComputationNodeValue(const std::pair<Variable, ValuePtr>& variableValue, ComputationNodeBasePtr& computationNode, std::unordered_map<MBLayoutPtr, Variable>& layoutsPopulated)
+    /*static*/ void CompositeFunction::PopulateComputationNodeValue(const std::pair<Variable, ValuePtr>& variableValue, ComputationNodeBasePtr& computationNode, std::unordered_map<MBLayoutPtr, Variable>& layoutsPopulated, ValueConversionStorage* storage /*= nullptr*/)
     {
+        // With scratch storage, data that needs to be rearranged into the packed layout is gathered directly into the node's matrix
+        auto& nodeDataPtr = computationNode->As<ComputationNode<ElementType>>()->ValuePtrRef();
+        std::shared_ptr<Matrix<ElementType>> outputMatrixStorage, tempIndicesStorage;
+        if (storage)
+        {
+            if (nodeDataPtr->GetDeviceId() == AsCNTKImplDeviceId(variableValue.second->Device()))
+                outputMatrixStorage = nodeDataPtr;
+            tempIndicesStorage = storage->Get<ElementType>(storage->indices, AsCNTKImplDeviceId(variableValue.second->Device()));
+            if (!storage->layout)
+                storage->layout = std::make_shared<MBLayout>();
+        }
+
         NDShape inferredVariableShape;
-        std::pair<std::shared_ptr<const Matrix<ElementType>>, MBLayoutPtr> CNTKMatrixAndMBLayout = Utils::GetCNTKImplMatrixAndMBLayoutFromValueObject<ElementType>(variableValue.first, variableValue.second, &inferredVariableShape);
+        std::pair<std::shared_ptr<const Matrix<ElementType>>, MBLayoutPtr> CNTKMatrixAndMBLayout = Utils::GetCNTKImplMatrixAndMBLayoutFromValueObject<ElementType>(variableValue.first, variableValue.second, &inferredVariableShape, outputMatrixStorage, tempIndicesStorage, storage ? storage->layout : nullptr);
         if (!VariableShapeMatchesNodeShape(inferredVariableShape, computationNode->GetSampleLayout()))
             CNTK::LogicError("CompositeFunction::Forward: Inferred shape '%S' of Variable '%S' does not match the corresponding computation node shape '%s'.",
                              inferredVariableShape.AsString().c_str(), variableValue.first.AsString().c_str(), ((std::string)computationNode->GetSampleLayout()).c_str());
 
         // Switch the node matrix to the right matrix type
-        auto& nodeData = computationNode->As<ComputationNode<ElementType>>()->Value();
-        nodeData.AssignValuesOf(*CNTKMatrixAndMBLayout.first);
+        auto& nodeData = *nodeDataPtr;
+        if (CNTKMatrixAndMBLayout.first.get() != &nodeData)
+            nodeData.AssignValuesOf(*CNTKMatrixAndMBLayout.first);
 
         auto layout = CNTKMatrixAndMBLayout.second;
         auto& nodeLayout = computationNode->GetMBLayout();
@@ -1853,7 +2146,9 @@ namespace CNTK
         {
             if (layoutsPopulated.find(nodeLayout) == layoutsPopulated.end())
             {
-                nodeLayout->CopyFrom(layout);
+                // An unchanged layout keeps its cached column masks
+                if (!storage || (*nodeLayout != *layout))
+                    nodeLayout->CopyFrom(layout);
                 layoutsPopulated.insert({ nodeLayout, variableValue.first });
             }
             else
@@ -1926,13 +2221,13 @@ namespace CNTK
             switch (argumentValue->GetDataType())
             {
             case DataType::Float:
-                PopulateComputationNodeValue<float>({ argument, argumentValue }, argumentComputationNode, layoutsPopulated);
+                PopulateComputationNodeValue<float>({ argument, argumentValue }, argumentComputationNode, layoutsPopulated, &m_valueConversionStorage[argument]);
                 break;
             case DataType::Double:
-                PopulateComputationNodeValue<double>({ argument, argumentValue }, argumentComputationNode, layoutsPopulated);
+                PopulateComputationNodeValue<double>({ argument, argumentValue }, argumentComputationNode, layoutsPopulated, &m_valueConversionStorage[argument]);
                 break;
             case DataType::Float16:
-                PopulateComputationNodeValue<half>({ argument, argumentValue }, argumentComputationNode, layoutsPopulated);
+                PopulateComputationNodeValue<half>({ argument, argumentValue }, argumentComputationNode, layoutsPopulated, &m_valueConversionStorage[argument]);
                 break;
             default:
                 LogicError("Function '%S' Forward: Unsupported DataType %s.", AsString().c_str(), DataTypeName(argumentValue->GetDataType()));
@@ -1987,7 +2282,7 @@ namespace CNTK
         }
     }
 
-    /*static*/ void CompositeFunction::GetNodeOutputOrGradient(Variable var, ValuePtr& varValue, Microsoft::MSR::CNTK::ComputationNodeBasePtr& computationNode, bool getGradient)
+    /*static*/ void CompositeFunction::GetNodeOutputOrGradient(Variable var, ValuePtr& varValue, Microsoft::MSR::CNTK::ComputationNodeBasePtr& computationNode, bool getGradient, ValueConversionStorage* storage /*= nullptr*/)
     {
         auto varShape = GetVariableShape(var.Shape(), computationNode->GetSampleLayout());
         auto valueShape = PackedValue::GetUnpackedShape(varShape, var.DynamicAxes(), computationNode->GetMBLayout());
@@ -2009,7 +2304,7 @@ namespace CNTK
             if (varValue == nullptr)
                 nodeValue = MakeSharedObject<PackedValue>(varShape, var.DynamicAxes(), std::make_shared<Matrix<float>>(matrix.AsReference()), layout, /*readOnly =*/ false);
             else
-                nodeValue = Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<float>(var, computationNode, matrix, layout);
+                nodeValue = Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<float>(var, computationNode, matrix, layout, /*readOnly =*/ true, storage);
             break;
         }
         case DataType::Double:
@@ -2018,7 +2313,7 @@ namespace CNTK
             if (varValue == nullptr)
                 nodeValue = MakeSharedObject<PackedValue>(varShape, var.DynamicAxes(), std::make_shared<Matrix<double>>(matrix.AsReference()), layout, /*readOnly =*/ false);
             else
-                nodeValue = Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<double>(var, computationNode, matrix, layout);
+                nodeValue = Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<double>(var, computationNode, matrix, layout, /*readOnly =*/ true, storage);
             break;
         }
         case DataType::Float16:
@@ -2027,7 +2322,7 @@ namespace CNTK
             if (varValue == nullptr)
                 nodeValue = MakeSharedObject<PackedValue>(varShape, var.DynamicAxes(), std::make_shared<Matrix<half>>(matrix.AsReference()), layout, /*readOnly =*/ false);
             else
-                nodeValue = Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<half>(var, computationNode, matrix, layout);
+                nodeValue = Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<half>(var, computationNode, matrix, layout, /*readOnly =*/ true, storage);
             break;
         }
         default:
@@ -2049,7 +2344,7 @@ namespace CNTK
             auto& valuePtr = outputVarValuePair.second;
             auto node = m_variableToNodeMap.at(outputVarValuePair.first);
             bool noValueStrorageProvided = (valuePtr == nullptr);
-            GetNodeOutputOrGradient(outputVarValuePair.first, valuePtr, node, false /*getGradient*/);
+            GetNodeOutputOrGradient(outputVarValuePair.first, valuePtr, node, false /*getGradient*/, noValueStrorageProvided ? nullptr : &m_valueConversionStorage[outputVarValuePair.first]);
 
             auto packedVarValue = std::dynamic_pointer_cast<PackedValue>(valuePtr);
             if (noValueStrorageProvided && packedVarValue && packedVarValue->IsPacked())
@@ -2124,6 +2419,9 @@ namespace CNTK
                                                             const std::unordered_set<Variable>& outputsToRetainBackwardStateFor,
                                                             const std::unordered_set<Variable>& inputsToExcludeGradientsFor)
     {
+        // concurrent Forward() calls (e.g. on clones in an inference server) share the CPU thread budget
+        Microsoft::MSR::CNTK::ComputeThreadShare threadShare;
+
         // Validate arguments and outputs
         if (outputs.empty())
             InvalidArgument("At least one output has to be specified when calling Forward method of the Function '%S'.", this->AsString().c_str());
@@ -2237,6 +2535,9 @@ namespace CNTK
 
         ScopedNetworkOperationMode modeGuard(m_computationNetwork, outputsToRetainBackwardStateFor.empty() ? NetworkOperationMode::inferring : NetworkOperationMode::training);
 
+        if (m_beforeForwardProp)
+            m_beforeForwardProp(*m_computationNetwork);
+
         m_computationNetwork->ForwardProp(outputsToEvaluate);
 
         // Call PostForwardAndBackProp after ForwardProp only in evaluation mode.
@@ -2265,6 +2566,8 @@ namespace CNTK
                                                  const std::unordered_map<Variable, ValuePtr>& rootGradientValues,
                                                  std::unordered_map<Variable, ValuePtr>& backPropagatedGradientValuesForInputs)
     {
+        Microsoft::MSR::CNTK::ComputeThreadShare threadShare;
+
         auto backpropState = dynamic_cast<const CNTKBackPropState*>(state.get());
         if (backpropState == nullptr)
             InvalidArgument("Function '%S' Backward: Invalid backprop state passed.", AsString().c_str());
@@ -2289,6 +2592,31 @@ namespace CNTK
         for (auto rootGradientVarValuePair : rootGradientValues)
             m_computationNetwork->ZeroInputGradients(m_variableToNodeMap.at(rootGradientVarValuePair.first));
 
+        // With gradient accumulation, the parameters keep their gradients from the previous Backward, and backprop adds to them
+        std::vector<Variable> parametersWithGradientsAside;
+        if (m_accumulateParameterGradients)
+        {
+            if (m_gradientAccumulationNetwork.lock() != m_computationNetwork)
+                LogicError("Function '%S' Backward: Cannot accumulate the parameter gradients, since the network has been rebuilt after the previous Backward call.", AsString().c_str());
+
+            for (const auto& gradientVarValuePair : backPropagatedGradientValuesForInputs)
+            {
+                const auto& var = gradientVarValuePair.first;
+                if (!var.IsParameter() || (m_variableToNodeMap.find(var) == m_variableToNodeMap.end()))
+                    continue;
+
+                const auto& node = m_variableToNodeMap.at(var);
+                if (node->ParentGradientReused())
+                {
+                    KeepGradientAside(var.GetDataType(), node, m_parameterGradientSums[var]);
+                    parametersWithGradientsAside.push_back(var);
+                }
+                else
+                    node->KeepGradient();
+            }
+        }
+        m_gradientAccumulationNetwork = m_computationNetwork;
+
         // Feed data into the arguments of the network
         PopulateNetworkGradients(rootGradientValues);
 
@@ -2298,6 +2626,9 @@ namespace CNTK
         auto rootComputationNodePtr = m_variableToNodeMap.at(rootGradientValues.begin()->first);
         m_computationNetwork->GetNestedNetwork(rootComputationNodePtr)->Backprop(FrameRange(nullptr), true, true);
 
+        for (const auto& var : parametersWithGradientsAside)
+            AddGradientKeptAside(var.GetDataType(), m_variableToNodeMap.at(var), m_parameterGradientSums.at(var));
+
         GetNetworkGradients(backPropagatedGradientValuesForInputs);
 
         if (m_currentOutputsToEvaluate.size() > 0)
@@ -47,18 +47,28 @@ namespace CNTK
         friend class Trainer;
         friend class CompositeMinibatchSource;
         friend class PackedValue;
+        friend class StreamingEvaluatorImpl;
 
         template <typename T, typename ...CtorArgTypes>
         friend inline std::shared_ptr<T> MakeSharedObject(CtorArgTypes&& ...ctorArgs);
 
         friend void Internal::SaveAsLegacyModel(const FunctionPtr& rootFunction, const std::wstring& modelFile);
+        friend FunctionPtr Internal::FoldBatchNormalization(const FunctionPtr& rootFunction);
+        friend FunctionPtr Internal::QuantizeEmbeddings(const FunctionPtr& rootFunction, DataType storageType);
 
         friend void ComputeInputPerDimMeansAndInvStdDevs(const MinibatchSourcePtr& minibatchSource,
                                                          std::unordered_map<StreamInformation, std::pair<NDArrayViewPtr, NDArrayViewPtr>>& computedMeanAndInvStdDevs,
-                                                         const DeviceDescriptor& device /*= DeviceDescriptor::CPUDevice()*/);
+                                                         const DeviceDescriptor& device,
+                                                         size_t maxNumSamples,
+                                                         const DistributedCommunicatorPtr& communicator,
+                                                         const std::wstring& statisticsFile);
 
         static std::atomic<unsigned int> s_nextAutoGeneratedDynamicAxis;
 
+        // Changes whenever the structure of a Function graph changes, which only happens by replacing placeholders.
+        // The inputs determined for the composites are cached for the version they were determined at.
+        static std::atomic<size_t> s_graphStructureVersion;
+
         static const std::wstring CompositeFunctionOpName;
 
     public:
@@ -153,38 +163,61 @@ namespace CNTK
             TraverseVariables(rootFunction, visitedFunctions, functor, pythonOperandOrder, preOrder);
         }
 
-        // Recursively traverses the Function graph underlying the 'rootFunction' invoking the provided functor for all visited nodes in the graph.
+        // Traverses the Function graph underlying the 'rootFunction' depth-first, invoking the provided functor for all visited nodes in the graph.
+        // The traversal keeps its own stack, so that the depth of the graph is not limited by the call stack. The inputs of the
+        // primitive Functions are read in place, unless they are needed in the python operand order.
         template <typename FunctionType>
         static void TraverseVariables(const FunctionPtr& rootFunction, std::unordered_set<FunctionPtr>& visitedFunctions, const FunctionType& functor, bool pythonOperandOrder, bool preOrder)
         {
-            visitedFunctions.insert(rootFunction);
-            auto rootFunctionOutputs = rootFunction->InitOutputs();
-
-            if (preOrder)
+            struct Frame
             {
-                for (const auto& rootOutput : rootFunctionOutputs)
-                    functor(rootOutput);
-            }
+                FunctionPtr m_function;
+                bool m_inputsInPlace;
+                std::vector<Variable> m_inputs; // only used if the inputs can not be read in place
+                size_t m_nextInput;
+            };
+
+            std::vector<Frame> frames;
+            auto visit = [&](const FunctionPtr& function) {
+                visitedFunctions.insert(function);
+                const auto& outputs = function->InitOutputs();
+                if (preOrder)
+                {
+                    for (const auto& output : outputs)
+                        functor(output);
+                }
+
+                bool inputsInPlace = !pythonOperandOrder && !function->IsComposite();
+                frames.push_back(Frame{ function, inputsInPlace, inputsInPlace ? std::vector<Variable>() : function->Inputs(pythonOperandOrder), 0 });
+            };
 
-            auto rootFunctionInputs = rootFunction->Inputs(pythonOperandOrder);
-            for (const auto& rootInput : rootFunctionInputs)
+            visit(rootFunction);
+            while (!frames.empty())
             {
-                if (rootInput.IsOutput())
+                auto& frame = frames.back();
+                const auto& inputs = frame.m_inputsInPlace ? frame.m_function->m_inputs : frame.m_inputs;
+                if (frame.m_nextInput < inputs.size())
                 {
-                    if (visitedFunctions.find(rootInput.Owner()) == visitedFunctions.end())
+                    const auto& input = inputs[frame.m_nextInput++];
+                    if (input.IsOutput())
                     {
-                        const auto& function = rootInput.Owner();
-                        TraverseVariables(function, visitedFunctions, functor, pythonOperandOrder, preOrder);
+                        FunctionPtr owner = input.Owner();
+                        if (visitedFunctions.find(owner) == visitedFunctions.end())
+                            visit(owner);
                     }
+                    else
+                        functor(input);
                 }
                 else
-                    functor(rootInput);
-            }
+                {
+                    if (!preOrder)
+                    {
+                        for (const auto& output : frame.m_function->RawOutputs())
+                            functor(output);
+                    }
 
-            if (!preOrder)
-            {
-                for (const auto& rootOutput : rootFunctionOutputs)
-                    functor(rootOutput);
+                    frames.pop_back();
+                }
             }
         }
 
@@ -223,14 +256,25 @@ namespace CNTK
 
         CompositeFunction(const FunctionPtr& rootFunction, std::unordered_set<FunctionPtr>&& allPrimitiveFunctions, const std::wstring& name, const std::wstring& uid = Internal::GenerateUid(L"CompositeFunction"))
             : Function({}, Dictionary(), rootFunction, name, uid),
-            m_allPrimitiveFunctions(std::move(allPrimitiveFunctions)), m_networkMatricesAllocated(false)
+            m_allPrimitiveFunctions(std::move(allPrimitiveFunctions)), m_networkMatricesAllocated(false), m_networkOptimizedForInference(false),
+            m_accumulateParameterGradients(false)
         {}
 
         std::vector<Variable> DetermineInputs(bool pythonOperandOrder = false) const
         {
-            const auto& root = RootFunction();
-            std::unordered_set<FunctionPtr> visitedFunctions;
-            return DetermineInputs(root, visitedFunctions, pythonOperandOrder);
+            std::lock_guard<std::recursive_mutex> lock(m_cachedInputsMutex);
+            auto& cachedInputs = m_cachedInputs[pythonOperandOrder ? 1 : 0];
+            size_t graphStructureVersion = s_graphStructureVersion;
+            if (!cachedInputs.m_valid || cachedInputs.m_graphStructureVersion != graphStructureVersion)
+            {
+                const auto& root = RootFunction();
+                std::unordered_set<FunctionPtr> visitedFunctions;
+                cachedInputs.m_inputs = DetermineInputs(root, visitedFunctions, pythonOperandOrder);
+                cachedInputs.m_graphStructureVersion = graphStructureVersion;
+                cachedInputs.m_valid = true;
+            }
+
+            return cachedInputs.m_inputs;
         }
 
          // Recursively traverses the Function graph and populates the provided set of functions.
@@ -272,6 +316,10 @@ namespace CNTK
         // dictionary into the function graph.
         void SetInternalState(const Dictionary& state);
 
+        // Gradient accumulation across minibatches: if set, Backward() adds the gradients of the parameters to those that
+        // the previous Backward() left in the network, instead of overwriting them.
+        void SetAccumulateParameterGradients(bool accumulate) { m_accumulateParameterGradients = accumulate; }
+
         // Copy state info from source function graph into 'this' function graph.
         // Both graphs must be equivalent.
         void CopyState(const CompositeFunction& source);
@@ -320,14 +368,14 @@ namespace CNTK
                                                                     bool useMangledNamesForComputationNodes);
 
         template <typename ElementType>
-        static void PopulateComputationNodeValue(const std::pair<Variable, ValuePtr>& variableValue, Microsoft::MSR::CNTK::ComputationNodeBasePtr& computationNode, std::unordered_map< Microsoft::MSR::CNTK::MBLayoutPtr, Variable>& layoutsPopulated);
+        static void PopulateComputationNodeValue(const std::pair<Variable, ValuePtr>& variableValue, Microsoft::MSR::CNTK::ComputationNodeBasePtr& computationNode, std::unordered_map< Microsoft::MSR::CNTK::MBLayoutPtr, Variable>& layoutsPopulated, ValueConversionStorage* storage = nullptr);
         void PopulateNetworkInputs(const std::unordered_map<Variable, ValuePtr>& arguments);
 
         template <typename ElementType>
         static void PopulateComputationNodeGradient(const std::pair<Variable, ValuePtr>& variableGradient, Microsoft::MSR::CNTK::ComputationNodeBasePtr& computationNode);
         void PopulateNetworkGradients(const std::unordered_map<Variable, ValuePtr>& gradients);
 
-        static void GetNodeOutputOrGradient(Variable var, ValuePtr& varValue, Microsoft::MSR::CNTK::ComputationNodeBasePtr& computationNode, bool getGradient);
+        static void GetNodeOutputOrGradient(Variable var, ValuePtr& varValue, Microsoft::MSR::CNTK::ComputationNodeBasePtr& computationNode, bool getGradient, ValueConversionStorage* storage = nullptr);
         void GetNetworkOutputs(std::unordered_map<Variable, ValuePtr>& outputs);
         void GetNetworkGradients(std::unordered_map<Variable, ValuePtr>& gradients);
 
@@ -359,9 +407,15 @@ namespace CNTK
             m_lastRecordedTimeStamps.clear();
 
             m_networkMatricesAllocated = false;
+            m_networkOptimizedForInference = false;
             m_computationNetwork = nullptr;
+            m_valueConversionStorage.clear();
+            m_networkArgumentShapes.clear();
         }
 
+        std::unordered_map<Variable, NDShape> FullyDefinedArgumentShapes() const;
+        void SwitchNetworkVariant(const DeviceDescriptor& device, const std::unordered_set<Variable>& outputs, const std::unordered_map<Variable, NDShape>& argumentShapes);
+
         void RecordRefVariableUpdates()
         {
             for (auto refVar : m_refVariables)
@@ -387,9 +441,17 @@ namespace CNTK
 
         Microsoft::MSR::CNTK::ComputationNetworkPtr m_computationNetwork;
 
+        // If set, called by Forward() with the network it is about to evaluate, once the arguments are fed in;
+        // a StreamingEvaluator implants the recurrent state of its streams here
+        std::function<void(Microsoft::MSR::CNTK::ComputationNetwork&)> m_beforeForwardProp;
+
         // Map to keep track of any references to network output/gradient storage handed out so far
         std::vector<PackedValueWeakPtr> m_existingNetworkStorageReferences;
 
+        // Scratch buffers for the arguments and the preallocated outputs of Forward(), so that repeated calls with
+        // the same shapes do not allocate
+        std::unordered_map<Variable, ValueConversionStorage> m_valueConversionStorage;
+
         // The backpropRoots specified in the most recent 'Forward' call on 'this' Function.
         // This indicates for which of its roots has 'this' Function retained required intermediate 
         // states from the previos Forward call to be able to backpropagate gradients backwards from in
@@ -405,14 +467,52 @@ namespace CNTK
 
         std::unordered_set<Variable> m_refVariables;
 
+        // The inputs of 'this' Function, in the internal and in the python operand order, as last determined
+        // by DetermineInputs(); Inputs() is called often and determining them traverses the whole graph.
+        struct CachedInputs
+        {
+            bool m_valid = false;
+            size_t m_graphStructureVersion = 0;
+            std::vector<Variable> m_inputs;
+        };
+        mutable CachedInputs m_cachedInputs[2];
+        mutable std::recursive_mutex m_cachedInputsMutex;
+
         bool m_networkMatricesAllocated;
 
+        // Whether m_computationNetwork was simplified by ComputationNetwork::OptimizeForInference() for m_allNetworkRoots
+        bool m_networkOptimizedForInference;
+
         std::unordered_set<Variable> m_allNetworkRoots;
 
         std::unordered_map<Variable, size_t> m_lastRecordedTimeStamps;
 
         std::unordered_set<Variable> m_inputsExcludedFromGradientComputation;
 
+        // The shapes of the free dimensions of the arguments that m_computationNetwork was set up for
+        std::unordered_map<Variable, NDShape> m_networkArgumentShapes;
+
+        // See SetAccumulateParameterGradients(). The network of the previous Backward(), which holds the sums so far, and
+        // the sums of the parameters whose gradient matrix is reused by their consumer, which are kept aside during backprop.
+        bool m_accumulateParameterGradients;
+        std::weak_ptr<Microsoft::MSR::CNTK::ComputationNetwork> m_gradientAccumulationNetwork;
+        std::unordered_map<Variable, std::shared_ptr<Microsoft::MSR::CNTK::MatrixBase>> m_parameterGradientSums;
+
+        // A network of 'this' Function for inference that is kept while one for other outputs or argument shapes is
+        // evaluated, see SwitchNetworkVariant()
+        struct NetworkVariant
+        {
+            Microsoft::MSR::CNTK::ComputationNetworkPtr m_computationNetwork;
+            std::unordered_map<Variable, Microsoft::MSR::CNTK::ComputationNodeBasePtr> m_variableToNodeMap;
+            std::unordered_map<Variable, NDShape> m_argumentShapes;
+            std::unordered_set<Variable> m_allNetworkRoots;
+            std::unordered_map<Variable, size_t> m_lastRecordedTimeStamps;
+            std::unordered_set<Variable> m_inputsExcludedFromGradientComputation;
+            std::unordered_map<Variable, ValueConversionStorage> m_valueConversionStorage;
+            bool m_networkOptimizedForInference;
+        };
+        std::list<NetworkVariant> m_networkVariants; // most recently used first
+
         // Version history:
         // 1 -- initial version.
         // 2 -- add support for stateful functions (with corresponding nodes inheriting from RngUser).
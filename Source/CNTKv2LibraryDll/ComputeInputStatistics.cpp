@@ -7,16 +7,86 @@
 #include "CNTKLibrary.h"
 #include "Utils.h"
 #include "CompositeFunction.h"
+#include <algorithm>
 #include <tuple>
 #include "ComputationNetworkBuilder.h"
+#include "fileutil.h"
 
 using namespace Microsoft::MSR::CNTK;
 
 namespace CNTK
 {
+    // The statistics file holds the accumulated sums of the precompute nodes (see IPreComputeNode::GetAccumulatedSums()),
+    // as the precompute cache of SGD, under a key that identifies the streams and the sample budget.
+    static std::wstring GetStatisticsKey(const std::vector<StreamInformation>& streams, size_t maxNumSamples)
+    {
+        std::wstring key = maxNumSamples == MinibatchSource::InfinitelyRepeat ? L"all data\n" : msra::strfun::wstrprintf(L"%d samples\n", (int)maxNumSamples);
+        for (const auto& stream : streams)
+            key += stream.m_name + L" " + stream.m_sampleLayout.AsString() + (stream.m_storageFormat == StorageFormat::Dense ? L" dense\n" : L" sparse\n");
+        return key;
+    }
+
+    static bool TryLoadStatistics(const std::wstring& statisticsFile, const std::wstring& key, std::vector<double>& sums)
+    {
+        if (!fexists(statisticsFile))
+            return false;
+
+        File fstream(statisticsFile, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead);
+        std::wstring fileKey;
+        fstream.GetMarker(FileMarker::fileMarkerBeginSection, L"BInputStatistics");
+        fstream >> fileKey;
+        if (fileKey != key)
+        {
+            fprintf(stderr, "ComputeInputPerDimMeansAndInvStdDevs: Ignoring '%ls', which holds statistics of different streams or samples.\n", statisticsFile.c_str());
+            return false;
+        }
+        fstream >> sums;
+        fstream.GetMarker(FileMarker::fileMarkerEndSection, L"EInputStatistics");
+        return true;
+    }
+
+    static void SaveStatistics(const std::wstring& statisticsFile, const std::wstring& key, const std::vector<double>& sums)
+    {
+        // written to a temporary file first, so that an interrupted run leaves no partial file
+        std::wstring tempFileName = statisticsFile + L".tmp";
+        {
+            File fstream(tempFileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsWrite);
+            fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BInputStatistics");
+            fstream << key;
+            fstream << sums;
+            fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EInputStatistics");
+            fstream.Flush();
+        }
+
+        _wunlink(statisticsFile.c_str());
+        renameOrDie(tempFileName, statisticsFile);
+    }
+
+    // Sums 'values' over all workers of 'communicator', in place.
+    static void AggregateSums(const DistributedCommunicatorPtr& communicator, std::vector<double>& values)
+    {
+        if (values.empty())
+            return;
+        auto view = MakeSharedObject<NDArrayView>(DataType::Double, NDShape{ values.size() }, DeviceDescriptor::CPUDevice());
+        std::copy(values.begin(), values.end(), view->WritableDataBuffer<double>());
+        communicator->AggregateInPlace({ view }, communicator->Workers());
+        const double* aggregated = view->DataBuffer<double>();
+        std::copy(aggregated, aggregated + values.size(), values.begin());
+    }
+
     void ComputeInputPerDimMeansAndInvStdDevs(const MinibatchSourcePtr& minibatchSource,
                                               std::unordered_map<StreamInformation, std::pair<NDArrayViewPtr, NDArrayViewPtr>>& computedMeanAndInvStdDevs,
                                               const DeviceDescriptor& device /*= DeviceDescriptor::CPUDevice()*/)
+    {
+        ComputeInputPerDimMeansAndInvStdDevs(minibatchSource, computedMeanAndInvStdDevs, device, MinibatchSource::InfinitelyRepeat);
+    }
+
+    void ComputeInputPerDimMeansAndInvStdDevs(const MinibatchSourcePtr& minibatchSource,
+                                              std::unordered_map<StreamInformation, std::pair<NDArrayViewPtr, NDArrayViewPtr>>& computedMeanAndInvStdDevs,
+                                              const DeviceDescriptor& device,
+                                              size_t maxNumSamples,
+                                              const DistributedCommunicatorPtr& communicator /*= nullptr*/,
+                                              const std::wstring& statisticsFile /*= L""*/)
     {
         typedef std::shared_ptr<ComputationNode<float>> ComputationNodePtr;
         const auto& minibatchSourceStreams = minibatchSource->StreamInfos();
@@ -31,12 +101,17 @@ namespace CNTK
         std::unordered_map<StreamInformation, ComputationNodeBasePtr> streamToMeanNodeMap;
         std::unordered_map<StreamInformation, ComputationNodeBasePtr> streamToInvStdDevNodeMap;
 
-        size_t totalSizePerSample = 0;
+        // The streams in the same order on all workers and in all runs, which is the order of the sums of their statistics.
+        std::vector<StreamInformation> streams;
         for (auto& currentStreamKV : computedMeanAndInvStdDevs)
+            streams.push_back(currentStreamKV.first);
+        std::sort(streams.begin(), streams.end(), [](const StreamInformation& a, const StreamInformation& b) { return a.m_name < b.m_name; });
+
+        size_t totalSizePerSample = 0;
+        for (auto& currentStreamInfo : streams)
         {
-            auto currentStreamInfo = currentStreamKV.first;
             if (minibatchSourceStreams.find(currentStreamInfo) == minibatchSourceStreams.end())
-                InvalidArgument("Stream '%S' for which mean and variance are to be computed, is not supported by the specified minibatchSource.", currentStreamKV.first.AsString().c_str());
+                InvalidArgument("Stream '%S' for which mean and variance are to be computed, is not supported by the specified minibatchSource.", currentStreamInfo.AsString().c_str());
 
             if (currentStreamInfo.m_elementType != DataType::Float)
                 LogicError("ComputeInputPerDimMeansAndInvStdDevs: Stream '%S' has unsupported DataType; only DataType::Float is currently supported by the CNTK built-in composite MinibatchSource.",
@@ -77,21 +152,85 @@ namespace CNTK
         for (auto & preComputeNode : preComputeNodes)
             dynamic_pointer_cast<IPreComputeNode>(preComputeNode)->MarkComputed(false /*begin accumulating*/);
 
-        std::unordered_map<MBLayoutPtr, Variable> layoutsPopulated;
-        const size_t maxMinibatchDataSize = (1 << 27); // 128 MB
-        const size_t minibatchSize = maxMinibatchDataSize / totalSizePerSample;
-        for (;;)
+        std::vector<ComputationNodeBasePtr> statisticsNodes;
+        for (auto& currentStreamInfo : streams)
         {
-            auto minibatchData = minibatchSource->GetNextMinibatch(minibatchSize, device);
-            if (minibatchData.empty())
-                break;
+            statisticsNodes.push_back(streamToMeanNodeMap[currentStreamInfo]);
+            statisticsNodes.push_back(streamToInvStdDevNodeMap[currentStreamInfo]);
+        }
+
+        const size_t numWorkers = communicator ? communicator->Workers().size() : 1;
+        const size_t workerRank = communicator ? communicator->CurrentWorker().m_globalRank : 0;
+        const bool isMainWorker = !communicator || communicator->CurrentWorker().IsMain();
+
+        // The statistics file is only used if all workers find it.
+        auto key = GetStatisticsKey(streams, maxNumSamples);
+        std::vector<double> sums;
+        bool loaded = !statisticsFile.empty() && TryLoadStatistics(statisticsFile, key, sums);
+        if (!statisticsFile.empty() && communicator)
+        {
+            std::vector<double> numWorkersWithStatistics(1, loaded ? 1.0 : 0.0);
+            AggregateSums(communicator, numWorkersWithStatistics);
+            loaded = numWorkersWithStatistics[0] == numWorkers;
+        }
+
+        if (!loaded)
+        {
+            sums.clear();
+
+            // Each worker reads its share of the sample budget from its partition of the data. The per-dim moments of the
+            // minibatches are merged into the accumulators of the precompute nodes on the device (see InvStdDevNode).
+            const size_t maxNumLocalSamples = maxNumSamples == MinibatchSource::InfinitelyRepeat ? maxNumSamples : (maxNumSamples + numWorkers - 1) / numWorkers;
+            size_t numLocalSamples = 0;
 
-            for (auto& currentStreamKV : computedMeanAndInvStdDevs)
-                CompositeFunction::PopulateComputationNodeValue<float>({ streamToDummyInputVariableMap[currentStreamKV.first], minibatchData[currentStreamKV.first].data }, streamToInputNodeMap[currentStreamKV.first], layoutsPopulated);
+            std::unordered_map<MBLayoutPtr, Variable> layoutsPopulated;
+            const size_t maxMinibatchDataSize = (1 << 27); // 128 MB
+            const size_t minibatchSize = maxMinibatchDataSize / totalSizePerSample;
+            while (numLocalSamples < maxNumLocalSamples)
+            {
+                // the minibatch size is the one of all workers together
+                size_t requestedSize = minibatchSize;
+                if (maxNumLocalSamples != MinibatchSource::InfinitelyRepeat)
+                    requestedSize = std::min(requestedSize, (maxNumLocalSamples - numLocalSamples) * numWorkers);
+
+                auto minibatchData = minibatchSource->GetNextMinibatch(/*minibatchSizeInSequences =*/ 0, requestedSize, numWorkers, workerRank, device);
+                if (minibatchData.empty())
+                    break;
+
+                size_t numMinibatchSamples = 0;
+                for (auto& currentStreamInfo : streams)
+                {
+                    const auto& data = minibatchData[currentStreamInfo];
+                    CompositeFunction::PopulateComputationNodeValue<float>({ streamToDummyInputVariableMap[currentStreamInfo], data.data }, streamToInputNodeMap[currentStreamInfo], layoutsPopulated);
+                    numMinibatchSamples = std::max(numMinibatchSamples, data.numberOfSamples);
+                }
 
-            ComputationNetwork::BumpEvalTimeStamp(allInputNodes);
+                ComputationNetwork::BumpEvalTimeStamp(allInputNodes);
 
-            computationNetwork->ForwardProp(preComputeNodes);
+                computationNetwork->ForwardProp(preComputeNodes);
+                numLocalSamples += numMinibatchSamples;
+            }
+
+            // one merge of the statistics of all workers
+            if (communicator || !statisticsFile.empty())
+            {
+                for (auto& node : statisticsNodes)
+                    dynamic_pointer_cast<IPreComputeNode>(node)->GetAccumulatedSums(sums);
+            }
+            if (communicator)
+                AggregateSums(communicator, sums);
+
+            if (!statisticsFile.empty() && isMainWorker)
+                SaveStatistics(statisticsFile, key, sums);
+        }
+
+        if (loaded || communicator)
+        {
+            const double* nodeSums = sums.data();
+            for (auto& node : statisticsNodes)
+                dynamic_pointer_cast<IPreComputeNode>(node)->SetAccumulatedSums(nodeSums);
+            if (nodeSums != sums.data() + sums.size())
+                RuntimeError("ComputeInputPerDimMeansAndInvStdDevs: The statistics file '%ls' does not match the streams.", statisticsFile.c_str());
         }
 
         // finalize
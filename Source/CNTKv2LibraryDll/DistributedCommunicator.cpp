@@ -414,8 +414,11 @@ namespace CNTK
                 {
                     // We know we're On GPU
 
-                    // cast float to half
+                    // cast float to half, scaled by 1/numWorkers so that the sum does not overflow the half range
+                    // where a single value does not
+                    auto numWorkers = (float)m_mpi->NumNodesInUse();
                     auto inputMatrix = inputValue->GetWritableMatrix<float>();
+                    Microsoft::MSR::CNTK::Matrix<float>::Scale(1.0f / numWorkers, *inputMatrix);
                     m_intermediateGPUBuffers[i]->CastAssignValuesOf(*inputMatrix);
 
                     half* dataBufferHalf = m_intermediateGPUBuffers[i]->Data();
@@ -424,8 +427,12 @@ namespace CNTK
                     AllReduceDataHalf(dataBufferHalf, dataBufferHalf, numElements,
                         &allReduceRequests, (inputValue->Device() == DeviceDescriptor::CPUDevice()));
 
-                    // cast half to float
-                    inputMatrix->CastAssignValuesOf(*m_intermediateGPUBuffers[i]);
+                    // cast half to float into the output and undo the scaling, also on the input if it is not aggregated in place
+                    auto outputMatrix = outputValue->GetWritableMatrix<float>();
+                    outputMatrix->CastAssignValuesOf(*m_intermediateGPUBuffers[i]);
+                    Microsoft::MSR::CNTK::Matrix<float>::Scale(numWorkers, *outputMatrix);
+                    if (outputMatrix->Data() != inputMatrix->Data())
+                        Microsoft::MSR::CNTK::Matrix<float>::Scale(numWorkers, *inputMatrix);
                 }
                 else
                 {
@@ -0,0 +1,385 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// EvaluatorPool.cpp -- a few evaluation contexts that serve the requests of many threads
+//
+
+#include "stdafx.h"
+#include "CNTKLibrary.h"
+#include "Utils.h"
+#include "NumaPolicy.h"
+#include "GPUStreamContext.h"
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+namespace CNTK
+{
+    using namespace std;
+
+    class EvaluatorPoolImpl final : public EvaluatorPool
+    {
+        struct Request
+        {
+            const unordered_map<Variable, ValuePtr>* arguments;
+            unordered_map<Variable, ValuePtr>* outputs;
+            promise<void> done;
+        };
+
+        struct Context
+        {
+            FunctionPtr model;                            // a clone that shares the Parameters and Constants of its device
+            DeviceDescriptor device;
+            unordered_map<Variable, Variable> variables; // the arguments and outputs of the pool's model -> those of 'model'
+            unique_ptr<Microsoft::MSR::CNTK::GPUStreamContext> streamContext; // the stream of the worker, if it has its own
+            thread worker;
+
+            Context(const FunctionPtr& model, const DeviceDescriptor& device) : model(model), device(device) {}
+
+            const Variable& Corresponding(const Variable& variable) const
+            {
+                auto corresponding = variables.find(variable);
+                if (corresponding == variables.end())
+                    InvalidArgument("EvaluatorPool: '%S' is neither an argument nor an output of the model.", variable.AsString().c_str());
+                return corresponding->second;
+            }
+        };
+
+    public:
+        EvaluatorPoolImpl(const FunctionPtr& model, const vector<DeviceDescriptor>& devices, size_t numContextsPerDevice, size_t maxBatchSize, bool pinToNumaNodes,
+                          EvaluationStreamPriority streamPriority)
+            : m_model(model), m_maxBatchSize(maxBatchSize), m_pinToNumaNodes(pinToNumaNodes), m_streamPriority(streamPriority), m_stopping(false), m_updating(false), m_numBusy(0), m_nextTicket(0)
+        {
+            if (!m_model)
+                InvalidArgument("EvaluatorPool: The model is not allowed to be null.");
+            if (devices.empty() || numContextsPerDevice == 0)
+                InvalidArgument("EvaluatorPool: Requires at least one device and one context per device.");
+
+            for (const auto& device : devices)
+            {
+                m_deviceVariables.push_back({ device, {} });
+                auto deviceModel = OnDevice(m_model, device, m_deviceVariables.back().variables);
+                for (size_t i = 0; i < numContextsPerDevice; i++)
+                {
+                    m_contexts.push_back(unique_ptr<Context>(new Context(deviceModel->Clone(ParameterCloningMethod::Share), device)));
+                    Map(m_model->Arguments(), m_contexts.back()->model->Arguments(), m_contexts.back()->variables);
+                    Map(m_model->Outputs(), m_contexts.back()->model->Outputs(), m_contexts.back()->variables);
+                }
+            }
+
+            // The contexts are prepared on their threads, so that with pinning, their activations are on their nodes.
+            vector<future<void>> ready;
+            for (size_t i = 0; i < m_contexts.size(); i++)
+            {
+                auto started = make_shared<promise<void>>();
+                ready.push_back(started->get_future());
+                m_contexts[i]->worker = thread([this, i, started]() { Run(i, *started); });
+            }
+
+            exception_ptr error;
+            for (auto& r : ready)
+            {
+                try
+                {
+                    r.get();
+                }
+                catch (...)
+                {
+                    if (!error)
+                        error = current_exception();
+                }
+            }
+            if (error)
+            {
+                Stop();
+                rethrow_exception(error);
+            }
+        }
+
+        ~EvaluatorPoolImpl()
+        {
+            Stop();
+        }
+
+        size_t Submit(const unordered_map<Variable, ValuePtr>& arguments, unordered_map<Variable, ValuePtr>& outputs) override
+        {
+            unique_ptr<Request> request(new Request{ &arguments, &outputs, {} });
+            size_t ticket;
+            {
+                lock_guard<mutex> lock(m_mutex);
+                if (m_stopping)
+                    RuntimeError("EvaluatorPool: Submit() was called while the pool is destroyed.");
+                ticket = m_nextTicket++;
+                m_results[ticket] = request->done.get_future();
+                m_queue.push_back(move(request));
+            }
+            m_pending.notify_one();
+            return ticket;
+        }
+
+        void Wait(size_t ticket) override
+        {
+            future<void> result;
+            {
+                lock_guard<mutex> lock(m_mutex);
+                auto r = m_results.find(ticket);
+                if (r == m_results.end())
+                    InvalidArgument("EvaluatorPool: Unknown ticket %d, or it has been waited for already.", (int)ticket);
+                result = move(r->second);
+                m_results.erase(r);
+            }
+            result.get();
+        }
+
+        size_t NumContexts() const override
+        {
+            return m_contexts.size();
+        }
+
+        FunctionPtr Model() const override
+        {
+            return m_model;
+        }
+
+        void UpdateParameters(const unordered_map<wstring, NDArrayViewPtr>& values) override
+        {
+            lock_guard<mutex> updateLock(m_updateMutex); // one update at a time
+
+            for (const auto& value : values)
+            {
+                const auto& variables = m_deviceVariables.front().variables;
+                auto variable = variables.find(value.first);
+                if (variable == variables.end())
+                    InvalidArgument("EvaluatorPool: '%S' is the uid of neither a Parameter nor a Constant of the model.", value.first.c_str());
+                if (!value.second || value.second->Shape() != variable->second.Shape() || value.second->GetDataType() != variable->second.GetDataType())
+                    InvalidArgument("EvaluatorPool: The new value of '%S' does not have its shape '%S' and data type '%s'.",
+                                    variable->second.AsString().c_str(), variable->second.Shape().AsString().c_str(), DataTypeName(variable->second.GetDataType()));
+            }
+
+            // The new values are copied to each device next to the ones in use, while the contexts keep serving.
+            vector<pair<Variable, NDArrayViewPtr>> staged;
+            for (const auto& device : m_deviceVariables)
+            {
+                for (const auto& value : values)
+                    staged.push_back({ device.variables.at(value.first), value.second->DeepClone(device.device, /*readOnly =*/ true) });
+            }
+
+            // The requests being evaluated finish, and no other starts until the staged values have been copied into the
+            // storage that the compiled networks of the contexts use. The copies are queued after the work of the contexts
+            // on their devices, since the streams of the contexts synchronize with the default stream.
+            {
+                unique_lock<mutex> lock(m_mutex);
+                m_updating = true;
+                m_idle.wait(lock, [this]() { return m_numBusy == 0; });
+            }
+            exception_ptr error;
+            try
+            {
+                // The Constants are updated in place even if their values are read only, as the networks do with the
+                // running statistics of batch normalization.
+                for (const auto& value : staged)
+                {
+                    if (value.first.IsParameter())
+                    {
+                        Parameter parameter(value.first);
+                        parameter.Value()->Alias(/*readOnly =*/ false)->CopyFrom(*value.second);
+                        parameter.RecordValueUpdate();
+                    }
+                    else
+                    {
+                        Constant constant(value.first);
+                        constant.Value()->Alias(/*readOnly =*/ false)->CopyFrom(*value.second);
+                        constant.RecordValueUpdate();
+                    }
+                }
+            }
+            catch (...)
+            {
+                error = current_exception();
+            }
+            {
+                lock_guard<mutex> lock(m_mutex);
+                m_updating = false;
+            }
+            m_pending.notify_all();
+            if (error)
+                rethrow_exception(error);
+        }
+
+    private:
+        // The Parameters and Constants that the contexts on a device use, by the uid of those of the pool's model
+        struct DeviceVariables
+        {
+            DeviceDescriptor device;
+            unordered_map<wstring, Variable> variables;
+        };
+
+        // 'model' with its Parameters and Constants on 'device', sharing them if they already are
+        static FunctionPtr OnDevice(const FunctionPtr& model, const DeviceDescriptor& device, unordered_map<wstring, Variable>& variables)
+        {
+            unordered_map<Variable, Variable> replacements;
+            for (const auto& parameter : model->Parameters())
+            {
+                Variable deviceParameter = parameter;
+                if (parameter.Value()->Device() != device)
+                {
+                    deviceParameter = Parameter(parameter.Value()->DeepClone(device, /*readOnly =*/ false), parameter.Name());
+                    replacements.insert({ parameter, deviceParameter });
+                }
+                variables.insert({ parameter.Uid(), deviceParameter });
+            }
+            for (const auto& constant : model->Constants())
+            {
+                Variable deviceConstant = constant;
+                if (constant.Value()->Device() != device)
+                {
+                    deviceConstant = Constant(constant.Value()->DeepClone(device, /*readOnly =*/ true), constant.Name());
+                    replacements.insert({ constant, deviceConstant });
+                }
+                variables.insert({ constant.Uid(), deviceConstant });
+            }
+            return replacements.empty() ? model : model->Clone(ParameterCloningMethod::Share, replacements);
+        }
+
+        // cloning keeps the order of the arguments and outputs
+        static void Map(const vector<Variable>& variables, const vector<Variable>& clonedVariables, unordered_map<Variable, Variable>& map)
+        {
+            if (variables.size() != clonedVariables.size())
+                LogicError("EvaluatorPool: The clone of the model has %d arguments or outputs instead of %d.", (int)clonedVariables.size(), (int)variables.size());
+            for (size_t i = 0; i < variables.size(); i++)
+                map[variables[i]] = clonedVariables[i];
+        }
+
+        void Run(size_t index, promise<void>& started)
+        {
+            using Microsoft::MSR::CNTK::GPUStreamContext;
+            using Microsoft::MSR::CNTK::GPUStreamContextScope;
+
+            auto& context = *m_contexts[index];
+            unique_ptr<GPUStreamContextScope> streamScope; // everything the worker issues on the GPU goes to the stream of its context
+            try
+            {
+                if (m_pinToNumaNodes)
+                    Microsoft::MSR::CNTK::NumaPolicy::PinCurrentThread(index);
+                if (m_streamPriority != EvaluationStreamPriority::Shared && context.device.Type() == DeviceKind::GPU)
+                {
+                    int deviceId = (int)context.device.Id(), lowest, highest;
+                    GPUStreamContext::GetPriorityRange(deviceId, lowest, highest);
+                    context.streamContext.reset(new GPUStreamContext(deviceId, m_streamPriority == EvaluationStreamPriority::High ? highest : lowest));
+                    streamScope.reset(new GPUStreamContextScope(*context.streamContext));
+                }
+                WarmUp(context);
+            }
+            catch (...)
+            {
+                started.set_exception(current_exception());
+                return;
+            }
+            started.set_value();
+
+            unique_lock<mutex> lock(m_mutex);
+            for (;;)
+            {
+                // no request starts while the values of the parameters are switched, see UpdateParameters()
+                m_pending.wait(lock, [this]() { return !m_updating && (m_stopping || !m_queue.empty()); });
+                if (m_queue.empty())
+                    return;
+
+                auto request = move(m_queue.front());
+                m_queue.pop_front();
+                m_numBusy++;
+                lock.unlock();
+                try
+                {
+                    Evaluate(context, *request);
+                    request->done.set_value();
+                }
+                catch (...)
+                {
+                    request->done.set_exception(current_exception());
+                }
+                lock.lock();
+                if (--m_numBusy == 0)
+                    m_idle.notify_all();
+            }
+        }
+
+        // evaluates a batch of zeros of the maximum size, which allocates the activations
+        void WarmUp(Context& context) const
+        {
+            if (m_maxBatchSize == 0)
+                return;
+
+            unordered_map<Variable, ValuePtr> arguments;
+            for (const auto& argument : context.model->Arguments())
+            {
+                if (argument.Shape().HasUnboundDimension() || argument.IsSparse() || argument.DynamicAxes().empty())
+                    return; // the size of the activations is not known ahead
+                auto batchShape = argument.DynamicAxes().size() > 1 ? NDShape({ 1, m_maxBatchSize }) : NDShape({ m_maxBatchSize });
+                auto zeros = MakeSharedObject<NDArrayView>(0.0, argument.GetDataType(), argument.Shape().AppendShape(batchShape), context.device, /*readOnly =*/ true);
+                arguments[argument] = MakeSharedObject<Value>(zeros);
+            }
+
+            unordered_map<Variable, ValuePtr> outputs;
+            for (const auto& output : context.model->Outputs())
+                outputs[output] = nullptr;
+            context.model->Evaluate(arguments, outputs, context.device);
+        }
+
+        static void Evaluate(const Context& context, Request& request)
+        {
+            unordered_map<Variable, ValuePtr> arguments;
+            for (const auto& argument : *request.arguments)
+                arguments[context.Corresponding(argument.first)] = argument.second;
+
+            unordered_map<Variable, ValuePtr> outputs;
+            for (const auto& output : *request.outputs)
+                outputs[context.Corresponding(output.first)] = output.second;
+
+            context.model->Evaluate(arguments, outputs, context.device);
+
+            for (auto& output : *request.outputs)
+                output.second = outputs.at(context.Corresponding(output.first));
+        }
+
+        // lets the workers finish the queued requests, and joins them
+        void Stop()
+        {
+            {
+                lock_guard<mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_pending.notify_all();
+            for (auto& context : m_contexts)
+            {
+                if (context->worker.joinable())
+                    context->worker.join();
+            }
+        }
+
+        const FunctionPtr m_model;
+        const size_t m_maxBatchSize;
+        const bool m_pinToNumaNodes;
+        const EvaluationStreamPriority m_streamPriority;
+        vector<DeviceVariables> m_deviceVariables;
+        vector<unique_ptr<Context>> m_contexts;
+        mutex m_updateMutex;
+
+        mutex m_mutex; // for the members below
+        condition_variable m_pending;
+        condition_variable m_idle; // m_numBusy dropped to 0
+        deque<unique_ptr<Request>> m_queue;
+        unordered_map<size_t, future<void>> m_results; // by ticket, until waited for
+        bool m_stopping;
+        bool m_updating;
+        size_t m_numBusy; // workers evaluating a request
+        size_t m_nextTicket;
+    };
+
+    EvaluatorPoolPtr CreateEvaluatorPool(const FunctionPtr& model, const vector<DeviceDescriptor>& devices, size_t numContextsPerDevice, size_t maxBatchSize, bool pinToNumaNodes,
+                                         EvaluationStreamPriority streamPriority)
+    {
+        return MakeSharedObject<EvaluatorPoolImpl>(model, devices, numContextsPerDevice, maxBatchSize, pinToNumaNodes, streamPriority);
+    }
+}
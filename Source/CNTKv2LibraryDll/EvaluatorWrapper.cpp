@@ -46,6 +46,64 @@ namespace CNTK
         return GetVariableInfo(m_func->Outputs(), outputs, numOutputs);
     }
 
+    // The caller's buffer is wrapped read-only, and only copied if it is not on the device of the model.
+    pair<Variable, ValuePtr> CNTKEvaluatorWrapper::PrepareInput(const CNTK_Variable& input, const CNTK_Value& inputValue, bool resetFlag, const DeviceDescriptor& bufferDevice)
+    {
+        auto var = m_arguments.find(input.name);
+        if (var == m_arguments.end())
+            InvalidArgument("Unexpected argument.");
+
+        auto inputShape = ToNDShape(inputValue.shape);
+        auto sampleShape = inputShape.SubShape(0, var->second.Shape().Rank());
+        if (sampleShape.TotalSize() == 0 || inputShape.TotalSize() % sampleShape.TotalSize() != 0)
+            InvalidArgument("The shape '%S' of the value of argument '%s' is not a sequence of samples of shape '%S'.",
+                inputShape.AsString().c_str(), input.name, sampleShape.AsString().c_str());
+
+        NDArrayViewPtr data = MakeSharedObject<NDArrayView>(DataType::Float, sampleShape.AppendShape({ inputShape.TotalSize() / sampleShape.TotalSize() }),
+            (const void*)inputValue.data, inputShape.TotalSize() * sizeof(float), bufferDevice);
+        if (bufferDevice != m_device)
+            data = data->DeepClone(m_device, /*readOnly =*/ true);
+        return{ var->second, Value::Create(sampleShape, { data }, { resetFlag }, m_device, /*readOnly =*/ true) };
+    }
+
+    // A null 'buffer' asks for a new value; otherwise the output is written into the preallocated buffer.
+    pair<Variable, ValuePtr> CNTKEvaluatorWrapper::PrepareOutput(const CNTK_Variable& output, const CNTK_Value* buffer, const DeviceDescriptor& bufferDevice)
+    {
+        auto var = m_outputs.find(output.name);
+        if (var == m_outputs.end())
+            InvalidArgument("Unexpected output.");
+
+        ValuePtr value = nullptr;
+        if (buffer != nullptr)
+        {
+            auto shape = ToNDShape(buffer->shape);
+            NDShape maskShape = shape.SubShape(var->second.Shape().Rank(), shape.Rank());
+            auto data = make_shared<NDArrayView>(DataType::Float, shape, buffer->data, shape.TotalSize() * sizeof(float), bufferDevice);
+            value = make_shared<Value>(data, make_shared<NDMask>(maskShape));
+        }
+        return{ var->second, value };
+    }
+
+    // Copies 'value' into a newly allocated CNTK_Value, which the caller releases with CNTK_CleanValue().
+    CNTK_Value CNTKEvaluatorWrapper::ToNewValue(const ValuePtr& value)
+    {
+        // Making sure with cleaners we do not leak anything on exception.
+        CNTK_Value v{ {0, 0}, 0 };
+        unique_ptr<CNTK_Value, decltype(&CNTK_CleanValue)> valCleaner(&v, CNTK_CleanValue);
+        v.shape = FromNDShape(value->Shape());
+        auto size = value->Shape().TotalSize();
+        v.data = new float[size];
+        auto data = value->Data();
+        if (value->Device().Type() == DeviceKind::GPU)
+        {
+            data = std::make_shared<NDArrayView>(DataType::Float, data->Shape(), DeviceDescriptor::CPUDevice());
+            data->CopyFrom(*(value->Data()));
+        }
+        std::copy(data->DataBuffer<float>(), data->DataBuffer<float>() + size, v.data);
+        valCleaner.release();
+        return v;
+    }
+
     void CNTKEvaluatorWrapper::EvaluateSequence(
         const CNTK_Variable* inputs,
         const CNTK_Value* inputValues,
@@ -53,45 +111,26 @@ namespace CNTK
         uint32_t numInputs,
         const CNTK_Variable* outputs,
         uint32_t numOutputs,
-        CNTK_Value** outputValues)
+        CNTK_Value** outputValues,
+        const DeviceDescriptor& bufferDevice)
     {
         // Prepare inputs.
         unordered_map<Variable, ValuePtr> preparedInputs;
         for (uint32_t i = 0; i < numInputs; ++i)
         {
-            auto var = m_arguments.find(inputs[i].name);
-            if (var == m_arguments.end())
-                InvalidArgument("Unexpected argument.");
-
-            auto inputValue = inputValues[i];
-            auto inputShape = ToNDShape(inputValue.shape);
-
-            // TODO: Avoid copying.
-            preparedInputs[var->second] =
-                Value::CreateSequence(inputShape.SubShape(0, var->second.Shape().Rank()), std::vector<float>(inputValue.data, inputValue.data + inputShape.TotalSize()), inputResetFlags[i], m_device);
+            auto input = PrepareInput(inputs[i], inputValues[i], inputResetFlags[i], bufferDevice);
+            preparedInputs[input.first] = input.second;
         }
 
         // Prepare outputs.
         unordered_map<Variable, ValuePtr> preparedOutputs;
         for (uint32_t i = 0; i < numOutputs; ++i)
         {
-            auto var = m_outputs.find(outputs[i].name);
-            if (var == m_outputs.end())
-                InvalidArgument("Unexpected output.");
-
-            ValuePtr value = nullptr;
-            if (*outputValues != nullptr) // Buffer has been preallocated.
-            {
-                auto buffer = *outputValues[i];
-                auto shape = ToNDShape(buffer.shape);
-                NDShape maskShape = shape.SubShape(var->second.Shape().Rank(), shape.Rank());
-                auto data = make_shared<NDArrayView>(DataType::Float, shape, buffer.data, shape.TotalSize() * sizeof(float), DeviceDescriptor::CPUDevice());
-                value = make_shared<Value>(data, make_shared<NDMask>(maskShape));
-            }
-            preparedOutputs[var->second] = value;
+            auto output = PrepareOutput(outputs[i], *outputValues != nullptr ? &(*outputValues)[i] : nullptr, bufferDevice);
+            preparedOutputs[output.first] = output.second;
         }
 
-        m_func->Evaluate(preparedInputs, preparedOutputs, m_device);
+        Evaluate(preparedInputs, preparedOutputs);
 
         if (preparedOutputs.size() != numOutputs)
             RuntimeError("Number of evaluated outputs '%d' does not match passed value '%d'.",
@@ -113,25 +152,62 @@ namespace CNTK
             if (varToValue == preparedOutputs.end())
                 RuntimeError("Could not retrieve ouput for variable '%s'", outputs[i].name);
 
-            auto value = varToValue->second;
-
-            {
-                // Making sure with cleaners we do not leak anything on exception.
-                CNTK_Value v{ {0, 0}, 0 };
-                unique_ptr<CNTK_Value, decltype(&CNTK_CleanValue)> valCleaner(&v, CNTK_CleanValue);
-                v.shape = FromNDShape(value->Shape());
-                auto size = value->Shape().TotalSize();
-                v.data = new float[size];
-                auto data = value->Data();
-                if (value->Device().Type() == DeviceKind::GPU)
-                {
-                    data = std::make_shared<NDArrayView>(DataType::Float, data->Shape(), DeviceDescriptor::CPUDevice());
-                    data->CopyFrom(*(value->Data()));
-                }
-                std::copy(data->DataBuffer<float>(), data->DataBuffer<float>() + size, v.data);
-                result.get()[i] = v;
-                valCleaner.release();
-            }
+            result.get()[i] = ToNewValue(varToValue->second);
+        }
+
+        *outputValues = result.release();
+    }
+
+    StreamContextPtr CNTKEvaluatorWrapper::CreateStream()
+    {
+        lock_guard<mutex> lock(m_streamingMutex);
+        if (!m_streaming)
+            m_streaming = CreateStreamingEvaluator(m_func, m_device);
+        return m_streaming->CreateStream();
+    }
+
+    void CNTKEvaluatorWrapper::EvaluateStreams(
+        const vector<StreamContextPtr>& streams,
+        const CNTK_Variable* inputs,
+        const CNTK_Value* inputValues,
+        uint32_t numInputs,
+        const CNTK_Variable* outputs,
+        uint32_t numOutputs,
+        CNTK_Value** outputValues)
+    {
+        StreamingEvaluatorPtr streaming;
+        {
+            lock_guard<mutex> lock(m_streamingMutex);
+            streaming = m_streaming;
+        }
+        if (!streaming)
+            InvalidArgument("No stream has been created for the model.");
+
+        // The values of a stream are consecutive; whether a chunk begins a sequence is kept by its stream.
+        auto numStreams = (uint32_t)streams.size();
+        vector<unordered_map<Variable, ValuePtr>> chunks(numStreams), streamOutputs(numStreams);
+        for (uint32_t s = 0; s < numStreams; ++s)
+        {
+            for (uint32_t i = 0; i < numInputs; ++i)
+                chunks[s].insert(PrepareInput(inputs[i], inputValues[s * numInputs + i], true, DeviceDescriptor::CPUDevice()));
+            for (uint32_t i = 0; i < numOutputs; ++i)
+                streamOutputs[s].insert(PrepareOutput(outputs[i], *outputValues != nullptr ? &(*outputValues)[s * numOutputs + i] : nullptr, DeviceDescriptor::CPUDevice()));
+        }
+
+        streaming->Evaluate(streams, chunks, streamOutputs);
+
+        if (*outputValues != nullptr)
+            return;
+
+        // Copy to outputs if none was provided.
+        size_t numValues = (size_t)numStreams * numOutputs;
+        auto arrayValueCleaner = std::bind(CleanAndDestroyValues, _1, numValues);
+        unique_ptr<CNTK_Value, decltype(arrayValueCleaner)> result(new CNTK_Value[numValues], arrayValueCleaner);
+        memset(result.get(), 0, sizeof(CNTK_Value) * numValues);
+        for (uint32_t s = 0; s < numStreams; ++s)
+        {
+            for (uint32_t i = 0; i < numOutputs; ++i)
+                result.get()[s * numOutputs + i] = ToNewValue(streamOutputs[s].at(m_outputs.at(outputs[i].name)));
         }
 
         *outputValues = result.release();
@@ -146,4 +222,42 @@ namespace CNTK
             cloned = m_func->Clone(ToNative(method));
         return unique_ptr<EvaluatorWrapper>(new CNTKEvaluatorWrapper(cloned, m_device));
     }
+
+    BatchingEvaluatorWrapper::BatchingEvaluatorWrapper(FunctionPtr model, DeviceDescriptor device, uint32_t maxBatchSize, uint32_t maxWaitMicroseconds)
+        : CNTKEvaluatorWrapper(model, device), m_maxBatchSize(maxBatchSize), m_maxWaitMicroseconds(maxWaitMicroseconds),
+          m_evaluator(CreateBatchingEvaluator(model, device, maxBatchSize, maxWaitMicroseconds))
+    {}
+
+    BatchingEvaluatorWrapper::BatchingEvaluatorWrapper(const char* modelFilePath, const CNTK_DeviceDescriptor* device, uint32_t maxBatchSize, uint32_t maxWaitMicroseconds) :
+        BatchingEvaluatorWrapper(Function::Load(StringToWString(modelFilePath), GetDeviceDescriptor(device)), GetDeviceDescriptor(device), maxBatchSize, maxWaitMicroseconds)
+    {}
+
+    unique_ptr<EvaluatorWrapper> BatchingEvaluatorWrapper::Clone(CNTK_ParameterCloningMethod method, bool flatten)
+    {
+        FunctionPtr cloned;
+        if (flatten)
+            cloned = m_func->CloneFlattened(ToNative(method));
+        else
+            cloned = m_func->Clone(ToNative(method));
+        return unique_ptr<EvaluatorWrapper>(new BatchingEvaluatorWrapper(cloned, m_device, m_maxBatchSize, m_maxWaitMicroseconds));
+    }
+
+    PooledEvaluatorWrapper::PooledEvaluatorWrapper(FunctionPtr model, DeviceDescriptor device, uint32_t numContexts)
+        : CNTKEvaluatorWrapper(model, device), m_numContexts(numContexts),
+          m_pool(CreateEvaluatorPool(model, { device }, numContexts))
+    {}
+
+    PooledEvaluatorWrapper::PooledEvaluatorWrapper(const char* modelFilePath, const CNTK_DeviceDescriptor* device, uint32_t numContexts) :
+        PooledEvaluatorWrapper(Function::Load(StringToWString(modelFilePath), GetDeviceDescriptor(device)), GetDeviceDescriptor(device), numContexts)
+    {}
+
+    unique_ptr<EvaluatorWrapper> PooledEvaluatorWrapper::Clone(CNTK_ParameterCloningMethod method, bool flatten)
+    {
+        FunctionPtr cloned;
+        if (flatten)
+            cloned = m_func->CloneFlattened(ToNative(method));
+        else
+            cloned = m_func->Clone(ToNative(method));
+        return unique_ptr<EvaluatorWrapper>(new PooledEvaluatorWrapper(cloned, m_device, m_numContexts));
+    }
 }
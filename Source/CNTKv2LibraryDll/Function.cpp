@@ -10,9 +10,11 @@
 #include "CompositeFunction.h"
 #include "BlockFunction.h"
 #include "Utils.h"
+#include "Serialization.h"
 #include "UserFunctionFactory.h"
 #include "TrainingNodes.h"
 #include "proto/onnx/ONNX.h"
+#include <chrono>
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -470,6 +472,110 @@ namespace CNTK
         Forward(arguments, outputs, computeDevice, {});
     }
 
+    // Evaluates the 'outputs' for zeros of the given shapes and returns the time it took, including copying the outputs
+    // to the host, which waits for the device. The storage allocations of the evaluation itself are returned in 'numAllocations'.
+    static double EvaluateZeros(Function& function, const std::unordered_map<Variable, NDShape>& argumentShapes, const std::unordered_set<Variable>& outputsToEvaluate,
+                                const DeviceDescriptor& computeDevice, uint64_t& numAllocations)
+    {
+        std::unordered_map<Variable, ValuePtr> arguments;
+        for (const auto& argumentShape : argumentShapes)
+        {
+            const auto& argument = argumentShape.first;
+            auto zeros = argument.IsSparse() ? MakeSharedObject<NDArrayView>(argument.GetDataType(), StorageFormat::SparseCSC, argumentShape.second, computeDevice)
+                                             : MakeSharedObject<NDArrayView>(0.0, argument.GetDataType(), argumentShape.second, computeDevice, /*readOnly =*/ true);
+            arguments[argument] = MakeSharedObject<Value>(zeros);
+        }
+
+        std::unordered_map<Variable, ValuePtr> outputs;
+        for (const auto& output : outputsToEvaluate)
+            outputs[output] = nullptr;
+
+        auto start = std::chrono::steady_clock::now();
+        auto allocationsBefore = GetNumMatrixStorageAllocations();
+        function.Evaluate(arguments, outputs, computeDevice);
+        numAllocations = GetNumMatrixStorageAllocations() - allocationsBefore;
+        for (const auto& output : outputs)
+            output.second->Data()->DeepClone(DeviceDescriptor::CPUDevice());
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    FunctionPreparationReport Function::Prepare(const std::vector<std::unordered_map<Variable, NDShape>>& argumentShapes,
+                                                const std::unordered_set<Variable>& outputs /*= {}*/,
+                                                const DeviceDescriptor& computeDevice /*= DeviceDescriptor::UseDefaultDevice()*/)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto arguments = Arguments();
+        std::unordered_set<Variable> outputsToEvaluate = outputs;
+        if (outputsToEvaluate.empty())
+        {
+            for (const auto& output : Outputs())
+                outputsToEvaluate.insert(output);
+        }
+
+        FunctionPreparationReport report;
+        std::vector<std::unordered_map<Variable, NDShape>> sampleShapes; // of each network variant
+        std::vector<std::pair<size_t, size_t>> entriesBySize;            // (total size of the arguments, entry)
+        for (size_t i = 0; i < argumentShapes.size(); i++)
+        {
+            const auto& entryShapes = argumentShapes[i];
+            std::unordered_map<Variable, NDShape> entrySampleShapes;
+            size_t totalSize = 0;
+            for (const auto& argument : arguments)
+            {
+                auto argumentShape = entryShapes.find(argument);
+                if (argumentShape == entryShapes.end())
+                    InvalidArgument("Function::Prepare: The shapes of entry %d do not include the argument '%S' of Function '%S'.",
+                                    (int)i, argument.AsString().c_str(), AsString().c_str());
+                const auto& shape = argumentShape->second;
+                entrySampleShapes[argument] = shape.SubShape(0, std::min(argument.Shape().Rank(), shape.Rank()));
+                totalSize += shape.TotalSize();
+            }
+            if (std::find(sampleShapes.begin(), sampleShapes.end(), entrySampleShapes) == sampleShapes.end())
+                sampleShapes.push_back(std::move(entrySampleShapes));
+
+            report.entries.push_back({ entryShapes, 0, 0, 0, 0 });
+            entriesBySize.push_back({ totalSize, i });
+        }
+        report.numNetworkVariants = sampleShapes.size();
+        report.allVariantsKept = report.numNetworkVariants <= std::max<size_t>(Globals::GetMaxNumCompiledNetworks(), 1);
+
+        std::stable_sort(entriesBySize.begin(), entriesBySize.end(), [](const std::pair<size_t, size_t>& a, const std::pair<size_t, size_t>& b) { return a.first > b.first; });
+        for (const auto& entryBySize : entriesBySize)
+        {
+            auto& entry = report.entries[entryBySize.second];
+            entry.coldMs = EvaluateZeros(*this, entry.argumentShapes, outputsToEvaluate, computeDevice, entry.numStorageAllocations);
+            entry.warmMs = EvaluateZeros(*this, entry.argumentShapes, outputsToEvaluate, computeDevice, entry.numWarmStorageAllocations);
+        }
+
+        report.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return report;
+    }
+
+    FunctionPreparationReport Function::Prepare(const std::vector<size_t>& batchSizes, size_t sequenceLength /*= 1*/,
+                                                const DeviceDescriptor& computeDevice /*= DeviceDescriptor::UseDefaultDevice()*/)
+    {
+        std::vector<std::unordered_map<Variable, NDShape>> argumentShapes;
+        for (auto batchSize : batchSizes)
+        {
+            std::unordered_map<Variable, NDShape> shapes;
+            for (const auto& argument : Arguments())
+            {
+                if (argument.Shape().HasUnboundDimension())
+                    InvalidArgument("Function::Prepare: The shape of the argument '%S' of Function '%S' is not fully defined; specify the shapes of its values instead.",
+                                    argument.AsString().c_str(), AsString().c_str());
+
+                if (argument.DynamicAxes().empty())
+                    shapes[argument] = argument.Shape();
+                else if (argument.DynamicAxes().size() > 1)
+                    shapes[argument] = argument.Shape().AppendShape({ sequenceLength, batchSize });
+                else
+                    shapes[argument] = argument.Shape().AppendShape({ batchSize });
+            }
+            argumentShapes.push_back(std::move(shapes));
+        }
+        return Prepare(argumentShapes, {}, computeDevice);
+    }
+
     void Function::Save(std::vector<unsigned char> &vectorBuf)
     {
         Dictionary model = Serialize();
@@ -482,8 +588,12 @@ namespace CNTK
         vectorBuf.assign(s.begin(), s.end());
     }
 
-    void Function::Save(const std::wstring& filepath, ModelFormat format, bool useExternalFilesToStoreParameters)
+    void Function::Save(const std::wstring& filepath, ModelFormat format, bool useExternalFilesToStoreParameters,
+                        bool optimizeONNXGraph, DataType onnxDataType)
     {
+        if (format != ModelFormat::ONNX && (optimizeONNXGraph || onnxDataType != DataType::Unknown))
+            fprintf(stderr, "Warning: optimizeONNXGraph and onnxDataType only apply to ONNX format.");
+
         switch (format)
         {
         case ModelFormat::CNTKv2:
@@ -499,7 +609,15 @@ namespace CNTK
 
         case ModelFormat::ONNX:
         {
-            ONNXFormat::Save(RootFunction(), filepath, useExternalFilesToStoreParameters);
+            ONNXFormat::Save(RootFunction(), filepath, useExternalFilesToStoreParameters, optimizeONNXGraph, onnxDataType);
+            break;
+        }
+
+        case ModelFormat::CNTKv2MemoryMapped:
+        {
+            if (useExternalFilesToStoreParameters)
+                fprintf(stderr, "Warning: useExternalFilesToStoreParameters only applies to ONNX format.");
+            SaveMemoryMapped(Serialize(), filepath);
             break;
         }
         }
@@ -510,7 +628,11 @@ namespace CNTK
         switch (format)
         {
         case ModelFormat::CNTKv2:
+        case ModelFormat::CNTKv2MemoryMapped:
         {
+            if (IsMemoryMappedModel(filepath))
+                return Function::Deserialize(LoadMemoryMapped(filepath), computeDevice);
+
             auto stream = GetFstream(filepath, true);
             if (!Internal::IsLegacyModel(*stream))
             {
@@ -567,6 +689,12 @@ namespace CNTK
 
     void Function::Restore(const std::wstring& filepath)
     {
+        if (IsMemoryMappedModel(filepath))
+        {
+            RestoreFromCheckpoint(LoadMemoryMapped(filepath));
+            return;
+        }
+
         auto stream = GetFstream(filepath, true);
         if (!Internal::IsLegacyModel(*stream))
         {
@@ -650,7 +778,7 @@ namespace CNTK
     Variable GetCorrespondingOutputVariableFromClone(const Variable& cloneeOutput, const FunctionPtr& cloneeFunction, const FunctionPtr& clonedFunction)
     {
         size_t outputVarIndex = 0;
-        for (auto output : cloneeFunction->RawOutputs())
+        for (const auto& output : cloneeFunction->RawOutputs())
         {
             if (output == cloneeOutput)
                 break;
@@ -679,6 +807,7 @@ namespace CNTK
         std::unordered_set<const Function*> visitedFunctions;
         std::unordered_set<Variable> replacedPlaceholders;
         ReplacePlaceholdersInPlace(placeholderReplacements, visitedFunctions, replacedPlaceholders);
+        CompositeFunction::s_graphStructureVersion++;
 
         // Validate/update the output shapes, data types etc. to reflect any changes in inputs due to placeholder replacements
         RootFunction()->ValidateOrUpdateOutputs();
@@ -740,22 +869,59 @@ namespace CNTK
         std::unordered_map<Variable, Variable>& placeholderReplacements,
         std::function<FunctionPtr(const FunctionPtr&, const std::vector<Variable>&)> clone)
     {
-        if (cloneMap.find(clonee.get()) != cloneMap.end())
-            LogicError("Function::Clone: Cloning an already visited Function '%S'.", clonee->AsString().c_str());
+        // The Functions are cloned depth-first, in the order of their inputs, keeping a stack of the Functions whose
+        // inputs are being cloned rather than recursing, so that the depth of the graph is not limited by the call stack.
+        struct Frame
+        {
+            FunctionPtr m_clonee;
+            std::vector<Variable> m_clonedInputs;
+        };
 
-        cloneMap[clonee.get()] = nullptr;
+        std::vector<Frame> frames;
+        auto enter = [&cloneMap, &frames](const FunctionPtr& function) {
+            if (cloneMap.find(function.get()) != cloneMap.end())
+                LogicError("Function::Clone: Cloning an already visited Function '%S'.", function->AsString().c_str());
 
-        std::unordered_map<Variable, Variable> cloneeToClonedInputMap;
-        std::vector<Variable> inputs;
-        auto cloneeInputs = clonee->Inputs();
-        for (auto cloneeInput : cloneeInputs)
+            assert(!function->IsComposite());
+            cloneMap[function.get()] = nullptr;
+            frames.push_back(Frame{ function, std::vector<Variable>() });
+            frames.back().m_clonedInputs.reserve(function->m_inputs.size());
+        };
+
+        // The placeholders created for the outputs of the Functions being cloned, by the output
+        std::unordered_map<Variable, Variable> placeholdersForOutputs;
+        for (const auto& placeholderReplacement : placeholderReplacements)
+            placeholdersForOutputs.insert({ placeholderReplacement.second, placeholderReplacement.first });
+
+        enter(clonee);
+        for (;;)
         {
+            auto& frame = frames.back();
+            const auto& cloneeInputs = frame.m_clonee->m_inputs;
+            if (frame.m_clonedInputs.size() == cloneeInputs.size())
+            {
+                FunctionPtr clonedFunction = clone(frame.m_clonee, frame.m_clonedInputs);
+                cloneMap[frame.m_clonee.get()] = clonedFunction;
+                FunctionPtr clonedClonee = frame.m_clonee;
+                frames.pop_back();
+                if (frames.empty())
+                    return clonedFunction;
+
+                // The parent is waiting on an output of the Function just cloned
+                auto& parent = frames.back();
+                const auto& cloneeInput = parent.m_clonee->m_inputs[parent.m_clonedInputs.size()];
+                parent.m_clonedInputs.push_back(GetCorrespondingOutputVariableFromClone(cloneeInput, clonedClonee, clonedFunction));
+                continue;
+            }
+
+            const auto& cloneeInput = cloneeInputs[frame.m_clonedInputs.size()];
             Variable clonedInput;
             if (replacements.find(cloneeInput) != replacements.end())
             {
                 auto replacement = replacements.at(cloneeInput);
                 clonedInput = PlaceholderLike(replacement);
                 placeholderReplacements[clonedInput] = replacement;
+                placeholdersForOutputs.insert({ replacement, clonedInput });
             }
             else
             {
@@ -815,38 +981,32 @@ namespace CNTK
                         if (cloneMap.at(cloneeInput.Owner().get()) == nullptr)
                         {
                             // See if we already created a placeholder for this already visited Function's output
-                            auto existingPlaceholderReplacement = std::find_if(placeholderReplacements.begin(), placeholderReplacements.end(), [cloneeInput](const std::pair<Variable, Variable>& placeholderReplacement) {
-                                return (placeholderReplacement.second == cloneeInput);
-                            });
-
-                            if (existingPlaceholderReplacement == placeholderReplacements.end())
+                            auto existingPlaceholderReplacement = placeholdersForOutputs.find(cloneeInput);
+                            if (existingPlaceholderReplacement == placeholdersForOutputs.end())
                             {
                                 //we need to carry the shape information to the new placeholder otherwise, deep chained recurrence with reshaping ops will fail (e.g. expand_dims);
                                 //however, we can not carry over the dynamic axis, as the placeholder might be replaced with different dynamic axes
                                 clonedInput = PlaceholderVariable(cloneeInput.Shape());
                                 placeholderReplacements[clonedInput] = cloneeInput;
+                                placeholdersForOutputs.insert({ cloneeInput, clonedInput });
                             }
                             else
-                                clonedInput = existingPlaceholderReplacement->first;
+                                clonedInput = existingPlaceholderReplacement->second;
                         }
                         else
                             clonedInput = GetCorrespondingOutputVariableFromClone(cloneeInput, cloneeInput.Owner(), cloneMap.at(cloneeInput.Owner().get()));
                     }
                     else
                     {
-                        auto clonedFunction = Clone(cloneeInput.Owner(), parameterCloneMethod, replacements, cloneMap, leafVariablesCloneMap, placeholderReplacements, clone);
-                        clonedInput = GetCorrespondingOutputVariableFromClone(cloneeInput, cloneeInput.Owner(), clonedFunction);
+                        // Clone the owner first, the input is taken from its clone when it is done
+                        enter(cloneeInput.Owner());
+                        continue;
                     }
                 }
             }
 
-            inputs.push_back(clonedInput);
-            cloneeToClonedInputMap.insert({cloneeInput, clonedInput});
+            frame.m_clonedInputs.push_back(clonedInput);
         }
-
-        FunctionPtr clonedFunction = clone(clonee, inputs);
-        cloneMap[clonee.get()] = clonedFunction;
-        return clonedFunction;
     }
 
     FunctionPtr Function::CloneFunction(const FunctionPtr& clonee, const std::vector<Variable>& clonedInputs)
@@ -2270,7 +2430,9 @@ namespace CNTK
         if (!axis.IsStaticAxis())
             LogicError("Gather operation only supports a single static axis.");
 
-        if (axis.StaticAxisIndex() == -1)
+        // The Gather node indexes any static axis of the reference directly. For indices of rank 1, this is the same as
+        // swapping the axis to the end, gathering along it, and swapping the indices back into its place.
+        if (axis.StaticAxisIndex() == -1 || (!indices.Shape().IsUnknown() && indices.Shape().Rank() == 1))
             return BinaryOp(PrimitiveOpType::Gather, indices, reference, std::move(additionalProperties), name);
         else
         {
@@ -2771,6 +2933,15 @@ namespace CNTK
             name);
     }
 
+    FunctionPtr LayerNormalization(const Variable& operand, const Variable& scale, const Variable& bias, double epsilon, const std::wstring& name)
+    {
+        auto additionalProperties = Dictionary();
+        additionalProperties[PrimitiveFunctionAttribute::AttributeNameEpsilon] = epsilon;
+
+        std::vector<Variable> operands = { operand, scale, bias };
+        return AsComposite(MakeSharedObject<PrimitiveFunction>(PrimitiveOpType::LayerNormalization, operands, std::move(additionalProperties), name), name);
+    }
+
     FunctionPtr LocalResponseNormalization(const Variable& operand, size_t depthRadius, double bias, double alpha, double beta, const std::wstring& name)
     {
         auto additionalProperties = Dictionary();
@@ -3142,8 +3313,17 @@ namespace CNTK
         FunctionPtr ReduceElements(const Variable& operand, const std::wstring& reductionOpName, bool keepReducedDimensions, const std::wstring& name)
         {
             auto operandPlaceholder = PlaceholderVariable(L"operand");
-            auto unpackedSequence = Unpack(operandPlaceholder, ReductionIdentityValue(reductionOpName), /*suppressMaskOutput =*/ true, name);
-            auto reductionResult = Internal::ReduceElements(unpackedSequence, reductionOpName, Axis(-1), keepReducedDimensions);
+            FunctionPtr reductionResult;
+            if (!keepReducedDimensions && IsDirectSequenceAxisReduction(reductionOpName))
+            {
+                // reduce the sequences in place, from their packed representation
+                reductionResult = Internal::ReduceElements(operandPlaceholder, reductionOpName, Axis::OperandSequenceAxis(), /*keepReducedDimensions =*/ false);
+            }
+            else
+            {
+                auto unpackedSequence = Unpack(operandPlaceholder, ReductionIdentityValue(reductionOpName), /*suppressMaskOutput =*/ true, name);
+                reductionResult = Internal::ReduceElements(unpackedSequence, reductionOpName, Axis(-1), keepReducedDimensions);
+            }
 
             return AsBlock(std::move(reductionResult), { { operandPlaceholder, operand } }, L"Sequence::ReduceElements", name);
         }
@@ -3323,7 +3503,7 @@ namespace CNTK
                 (axis == Axis::AllStaticAxes()) ||
                 (axis == Axis::AllAxes()) ||
                 (axis == Axis::DefaultBatchAxis()) ||
-                ((reductionOpName == PrimitiveFunctionAttribute::InternalSumReductionOpName) && (axis == Axis::OperandSequenceAxis())))
+                ((axis == Axis::OperandSequenceAxis()) && IsDirectSequenceAxisReduction(reductionOpName)))
             {
                 auto additionalProperties = Dictionary();
                 additionalProperties[PrimitiveFunctionAttribute::AttributeNameAxis] = axis;
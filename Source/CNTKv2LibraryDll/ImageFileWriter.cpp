@@ -0,0 +1,265 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "CNTKLibrary.h"
+
+#ifndef CNTK_UWP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "Basics.h"
+#include "fileutil.h"
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace CNTK
+{
+    namespace Internal
+    {
+        // EncodeImage() of the DelayLoadedExtensions plugin, see ImageWriter.h.
+        typedef bool (*EncodeImageFunction)(const void* matrix, DataType dtype, int height, int width, int depth, bool planar,
+                                            const char* extension, int quality, std::vector<unsigned char>& buffer);
+
+        static EncodeImageFunction GetEncodeImage()
+        {
+            // The plugin stays loaded as long as the function is used.
+            static Microsoft::MSR::CNTK::Plugin plugin;
+            static EncodeImageFunction encodeImage = (EncodeImageFunction)plugin.Load(L"ImageWriter", "EncodeImage");
+            return encodeImage;
+        }
+
+        static std::string GetImageExtension(const std::wstring& path)
+        {
+            auto dot = path.find_last_of(L'.');
+            auto separator = path.find_last_of(L"/\\");
+            if (dot == std::wstring::npos || (separator != std::wstring::npos && dot < separator))
+                return std::string();
+
+            std::string extension;
+            for (auto c : path.substr(dot))
+                extension.push_back((char)tolower((int)c));
+            return extension;
+        }
+
+        // A batch handed to Write(). Its memory is accounted for until all of its images have been written.
+        struct ImageBatch
+        {
+            NDArrayViewPtr m_snapshot; // on the device of the data
+            NDArrayViewPtr m_host;     // copied from the snapshot by the first worker that needs it
+            std::once_flag m_copied;
+            size_t m_numBytes;
+            size_t m_width, m_height, m_channels;
+            std::atomic<size_t> m_numRemaining;
+        };
+
+        struct ImageTask
+        {
+            std::shared_ptr<ImageBatch> m_batch;
+            size_t m_index;
+            std::wstring m_path;
+            int m_quality;
+        };
+
+        // Encodes and writes images on threads of its own, since the tasks block on file I/O and would hold up
+        // the compute work of the shared thread pool.
+        class ImageFileWriter::WorkerPool
+        {
+        public:
+            WorkerPool(size_t numThreads, size_t maxQueuedBytes)
+                : m_maxQueuedBytes(maxQueuedBytes), m_queuedBytes(0), m_numBusy(0), m_stop(false)
+            {
+                for (size_t i = 0; i < numThreads; i++)
+                    m_threads.emplace_back([this] { Run(); });
+            }
+
+            ~WorkerPool()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_stop = true;
+                }
+                m_wakeUp.notify_all();
+                for (auto& thread : m_threads)
+                    thread.join();
+            }
+
+            void Post(const std::shared_ptr<ImageBatch>& batch, std::vector<ImageTask>&& tasks)
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                // A caller that writes faster than the workers waits here; a batch bigger than the bound is taken alone.
+                m_done.wait(lock, [this, &batch] { return m_queuedBytes == 0 || m_queuedBytes + batch->m_numBytes <= m_maxQueuedBytes; });
+                m_queuedBytes += batch->m_numBytes;
+                for (auto& task : tasks)
+                    m_queue.push_back(std::move(task));
+                m_wakeUp.notify_all();
+            }
+
+            // Waits for the images posted so far. Returns the first error since the last call, if any.
+            std::string Drain()
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_done.wait(lock, [this] { return m_queue.empty() && m_numBusy == 0; });
+                std::string error;
+                error.swap(m_error);
+                return error;
+            }
+
+        private:
+            void Run()
+            {
+                for (;;)
+                {
+                    ImageTask task;
+                    {
+                        std::unique_lock<std::mutex> lock(m_mutex);
+                        m_wakeUp.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+                        if (m_queue.empty())
+                            return;
+
+                        task = std::move(m_queue.front());
+                        m_queue.pop_front();
+                        m_numBusy++;
+                    }
+
+                    std::string error;
+                    try
+                    {
+                        WriteImage(task);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        error = e.what();
+                    }
+
+                    bool isBatchDone = --task.m_batch->m_numRemaining == 0;
+
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if (!error.empty() && m_error.empty())
+                        m_error = error;
+                    if (isBatchDone)
+                        m_queuedBytes -= task.m_batch->m_numBytes;
+                    m_numBusy--;
+                    m_done.notify_all();
+                }
+            }
+
+            static void WriteImage(const ImageTask& task)
+            {
+                auto& batch = *task.m_batch;
+                std::call_once(batch.m_copied, [&batch]()
+                {
+                    batch.m_host = batch.m_snapshot->Device() == DeviceDescriptor::CPUDevice() ?
+                        batch.m_snapshot : batch.m_snapshot->DeepClone(DeviceDescriptor::CPUDevice(), /*readOnly=*/ true);
+                    batch.m_snapshot = nullptr;
+                });
+
+                size_t imageSize = batch.m_width * batch.m_height * batch.m_channels;
+                auto dtype = batch.m_host->GetDataType();
+                const void* data = dtype == DataType::Float ?
+                    (const void*)(batch.m_host->DataBuffer<float>() + task.m_index * imageSize) :
+                    (const void*)(batch.m_host->DataBuffer<double>() + task.m_index * imageSize);
+
+                std::vector<unsigned char> buffer;
+                auto extension = GetImageExtension(task.m_path);
+                if (!GetEncodeImage()(data, dtype, (int)batch.m_height, (int)batch.m_width, (int)batch.m_channels, /*planar=*/true,
+                                      extension.c_str(), task.m_quality, buffer))
+                    RuntimeError("ImageFileWriter: Encoding '%ls' failed.", task.m_path.c_str());
+
+                FILE* f = fopenOrDie(task.m_path, L"wb");
+                try
+                {
+                    fwriteOrDie(buffer, f);
+                }
+                catch (...)
+                {
+                    fclose(f);
+                    throw;
+                }
+                fcloseOrDie(f);
+            }
+
+            const size_t m_maxQueuedBytes;
+            std::mutex m_mutex;
+            std::condition_variable m_wakeUp; // the queue or m_stop changed
+            std::condition_variable m_done;   // an image was written
+            std::deque<ImageTask> m_queue;
+            size_t m_queuedBytes; // of the batches with images still to write
+            size_t m_numBusy;     // workers writing an image
+            bool m_stop;
+            std::string m_error;  // first error since the last Drain()
+            std::vector<std::thread> m_threads;
+        };
+
+        ImageFileWriter::ImageFileWriter(size_t numThreads, size_t maxQueuedBytes)
+        {
+            if (numThreads == 0)
+                numThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+            GetEncodeImage(); // fail early if the plugin is missing
+            m_workers.reset(new WorkerPool(numThreads, maxQueuedBytes));
+        }
+
+        ImageFileWriter::~ImageFileWriter()
+        {
+            m_workers->Drain();
+        }
+
+        void ImageFileWriter::Write(const NDArrayViewPtr& images, const std::vector<std::wstring>& paths, int quality)
+        {
+            if (images == nullptr)
+                InvalidArgument("ImageFileWriter: The images must not be null.");
+
+            auto dtype = images->GetDataType();
+            if (dtype != DataType::Float && dtype != DataType::Double)
+                InvalidArgument("ImageFileWriter: Unsupported data type '%s', only float and double images can be written.", DataTypeName(dtype));
+
+            const auto& shape = images->Shape();
+            if (shape.Rank() != 3 && shape.Rank() != 4)
+                InvalidArgument("ImageFileWriter: The images have shape '%S', expected [width x height x channels x N].", shape.AsString().c_str());
+
+            size_t channels = shape[2];
+            if (channels != 1 && channels != 3 && channels != 4)
+                InvalidArgument("ImageFileWriter: Images with %d channels cannot be written, expected 1, 3 or 4.", (int)channels);
+
+            size_t numImages = shape.Rank() == 4 ? shape[3] : 1;
+            if (paths.size() != numImages)
+                InvalidArgument("ImageFileWriter: %d paths given for %d images.", (int)paths.size(), (int)numImages);
+
+            if (numImages == 0)
+                return;
+
+            auto batch = std::make_shared<ImageBatch>();
+            batch->m_width = shape[0];
+            batch->m_height = shape[1];
+            batch->m_channels = channels;
+            batch->m_numBytes = shape.TotalSize() * DataTypeSize(dtype);
+            batch->m_numRemaining = numImages;
+            // The caller may overwrite the data right away; the copy to the host is left to a worker.
+            batch->m_snapshot = images->DeepClone(images->Device(), /*readOnly=*/ true);
+
+            std::vector<ImageTask> tasks;
+            tasks.reserve(numImages);
+            for (size_t i = 0; i < numImages; i++)
+                tasks.push_back(ImageTask{ batch, i, paths[i], quality });
+
+            m_workers->Post(batch, std::move(tasks));
+        }
+
+        void ImageFileWriter::Flush()
+        {
+            auto error = m_workers->Drain();
+            if (!error.empty())
+                RuntimeError("%s", error.c_str());
+        }
+    }
+}
+
+#endif // !CNTK_UWP
@@ -8,6 +8,8 @@
 #include "TensorView.h"
 #include "Utils.h"
 #include "Serialization.h"
+#include "Globals.h"
+#include "BlockSparseOperations.h"
 
 #define DISPATCH_TO_TYPED_UPDATE_FUNCTION                                                                     \
     switch (gradientValue->GetDataType())                                                                     \
@@ -36,6 +38,8 @@ using namespace std;
 namespace CNTK
 {
     CNTK_API const std::wstring Learner::MinibatchSizeKey = L"MinibatchSize";
+    CNTK_API const std::wstring Learner::LossScaleKey = L"LossScale";
+    CNTK_API const std::wstring Learner::GradientOverflowKey = L"GradientOverflow";
     ///
     /// A special value that can be used for the minibatchSize to indicate that the reference minibatch size is not specified.
     ///
@@ -91,6 +95,55 @@ namespace CNTK
         }
     }
 
+    // Checks a gradient for overflow, or divides it by the loss scale. Sparse gradients are not checked.
+    template <typename ElementType>
+    /*static*/ bool LearnerBase::UnscaleGradient(const NDArrayViewPtr& gradientValue, double lossScale, bool checkOnly)
+    {
+        const auto& gradientMatrix = GetWritableMatrix<ElementType>(gradientValue);
+        if (checkOnly)
+        {
+            if (gradientMatrix->GetMatrixType() != MatrixType::DENSE || gradientMatrix->IsEmpty())
+                return true;
+            // the sum is finite unless an element is not (or the sum itself overflows, which is rare and as well a reason to scale down)
+            Matrix<ElementType> sum(gradientMatrix->GetDeviceId());
+            sum.AssignSumOfElements(*gradientMatrix);
+            return std::isfinite((double)sum.Get00Element());
+        }
+        if (lossScale != 1)
+            Matrix<ElementType>::Scale(ElementType(1 / lossScale), *gradientMatrix);
+        return true;
+    }
+
+    bool LearnerBase::UnscaleGradients(const std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues, double lossScale) const
+    {
+        // all are checked before any is changed, since the update is skipped as a whole
+        for (bool checkOnly : { true, false })
+        {
+            for (const auto& parameter : Parameters())
+            {
+                const auto& gradientValue = gradientValues.at(parameter);
+                bool isFinite;
+                switch (gradientValue->GetDataType())
+                {
+                case DataType::Float:
+                    isFinite = UnscaleGradient<float>(gradientValue, lossScale, checkOnly);
+                    break;
+                case DataType::Double:
+                    isFinite = UnscaleGradient<double>(gradientValue, lossScale, checkOnly);
+                    break;
+                case DataType::Float16:
+                    isFinite = UnscaleGradient<half>(gradientValue, lossScale, checkOnly);
+                    break;
+                default:
+                    LogicError("Unsupported DataType %s", DataTypeName(gradientValue->GetDataType()));
+                }
+                if (!isFinite)
+                    return false;
+            }
+        }
+        return true;
+    }
+
     /*static*/ void LearnerBase::Print(const NDArrayViewPtr& value, const char* msg)
     {
         switch (value->GetDataType())
@@ -159,10 +212,11 @@ namespace CNTK
     {
         const auto& gradientMatrix = gradientValue->GetWritableMatrix<ElementType>();
 
-        // get mean gradient if needed
-        if (IsCompatibleMode())
+        // get mean gradient if needed, and clip the global norm of the gradients
+        const double gradientScale = GradientScale(actualMBSize);
+        if (gradientScale != 1.0)
         {
-            Matrix<ElementType>::Scale((ElementType)1.0 / actualMBSize, *gradientMatrix);
+            Matrix<ElementType>::Scale((ElementType)gradientScale, *gradientMatrix);
         }
 
         // clipping gradients to prevent outliers
@@ -179,7 +233,7 @@ namespace CNTK
     }
 
     // Performs additional postprocessing after the update method has been executed
-    // (noise injection and L1 regularization specified by the additional learning parameters).
+    // (noise injection, L1 regularization and block pruning specified by the additional learning parameters).
     template <typename ElementType>
     void LearnerBase::PostProcess(const Parameter& parameter, const NDArrayViewPtr& gradientValue, size_t actualMBSize) const
     {
@@ -205,6 +259,31 @@ namespace CNTK
             const auto weight = learningRate * m_additionalOptions.l1RegularizationWeight * (IsCompatibleMode() ? 1 : actualMBSize);
             parameterValue->GetWritableMatrix<ElementType>()->InplaceSoftThreshold(ElementType(weight));
         }
+
+        // block pruning: the blocks of the weights with the smallest L1 norms are zeroed after every update,
+        // with the mask computed anew whenever the scheduled sparsity changes
+        const auto blockPruningSparsity = GetCurrentTrainingParameterValue(m_additionalOptions.blockPruningSparsity);
+        if (blockPruningSparsity > 0 && parameterMatrix->GetNumRows() > 1 && parameterMatrix->GetNumCols() > 1)
+        {
+            auto& mask = m_blockPruningMasks[parameter];
+            if (!mask.second || mask.first != blockPruningSparsity)
+            {
+                const size_t rows = parameterMatrix->GetNumRows();
+                const size_t cols = parameterMatrix->GetNumCols();
+                const auto values = parameterValue->DeepClone(DeviceDescriptor::CPUDevice(), /*readOnly=*/true);
+                const auto* valueBuffer = GetMatrix<ElementType>(values)->Data();
+                vector<double> doubleValues(rows * cols), doubleMask(rows * cols);
+                for (size_t i = 0; i < doubleValues.size(); i++)
+                    doubleValues[i] = static_cast<double>(valueBuffer[i]);
+                BlockPruningMask(rows, cols, doubleValues.data(), m_additionalOptions.blockPruningRows, m_additionalOptions.blockPruningColumns,
+                                 blockPruningSparsity, doubleMask.data());
+
+                vector<ElementType> maskValues(doubleMask.begin(), doubleMask.end());
+                NDArrayView maskView(AsDataType<ElementType>(), parameterValue->Shape(), maskValues.data(), maskValues.size() * sizeof(ElementType), DeviceDescriptor::CPUDevice());
+                mask = make_pair(blockPruningSparsity, maskView.DeepClone(parameterValue->Device(), /*readOnly=*/true));
+            }
+            parameterMatrix->ElementMultiplyWith(*GetMatrix<ElementType>(mask.second));
+        }
     }
 
     template <typename ElementType>
@@ -218,7 +297,8 @@ namespace CNTK
                              AdditionalLearningOptions additionalOptions)
                              : Learner(parameters, learningRateSchedule, additionalOptions),
                              m_noiseInjectionSeed(Internal::GenerateRandomSeed()),
-                             m_masterParameterUpdated(false)
+                             m_masterParameterUpdated(false),
+                             m_globalGradientClippingScale(1.0)
     {
         if (parameters.empty())
             InvalidArgument("The parameters list specified to a Learner must not be empty.");
@@ -300,11 +380,30 @@ namespace CNTK
         if (trainingSampleCount == 0)
             InvalidArgument("Learner::Update() cannot perform an update with an empty minibatch.");
 
+        // With loss scaling, an overflow skips the update, including the minibatch and sample counts of the schedules.
+        // Learning has not stopped though.
+        if (GetOptions().Contains(LossScaleKey))
+        {
+            const bool overflow = !UnscaleGradients(gradientValues, GetLossScale());
+            GetOptions()[GradientOverflowKey] = overflow;
+            if (overflow)
+                return true;
+        }
+
         UpdateOnMinibatch(trainingSampleCount);
 
+        m_globalGradientClippingScale = GlobalGradientClippingScale(gradientValues, trainingSampleCount);
+
+        PrepareParameterUpdates(gradientValues, trainingSampleCount);
+
+        const auto updatedParameters = UpdateMultiTensor(gradientValues, trainingSampleCount);
+
         bool needUpdateMasterParameter = !m_masterParameterUpdated;
         for (const auto& parameter : Parameters())
         {
+            if (updatedParameters.find(parameter) != updatedParameters.end())
+                continue;
+
             const auto& smoothedGradientValue = m_smoothedGradientValues.at(parameter);
             const auto& gradientValue = gradientValues.at(parameter);
 
@@ -351,6 +450,8 @@ namespace CNTK
 #endif
         }
 
+        CompleteParameterUpdates(trainingSampleCount);
+
         if (needUpdateMasterParameter)
         {
             m_masterParameterUpdated = true;
@@ -390,6 +491,184 @@ namespace CNTK
         paramRef.RecordValueUpdate();
     }
 
+    unordered_set<Parameter> LearnerBase::UpdateMultiTensor(const unordered_map<Parameter, NDArrayViewPtr>& gradientValues, size_t trainingSampleCount)
+    {
+        unordered_set<Parameter> updatedParameters;
+
+        // gradient clipping, L1 regularization, noise injection and block pruning are applied per parameter
+        MultiTensorUpdateParameters<double> update;
+        if (!Globals::ShouldUseMultiTensorLearnerUpdates() ||
+            m_additionalOptions.gradientClippingThresholdPerSample != numeric_limits<double>::infinity() ||
+            m_additionalOptions.l1RegularizationWeight > 0 ||
+            GetCurrentTrainingParameterValue(m_additionalOptions.gaussianNoiseInjectionStdDev) > 0 ||
+            GetCurrentTrainingParameterValue(m_additionalOptions.blockPruningSparsity) > 0 ||
+            !GetMultiTensorUpdate(trainingSampleCount, update))
+            return updatedParameters;
+
+        // the mean gradient and the L2 regularizer of PreProcess()
+        update.gradientScale = GradientScale(trainingSampleCount);
+        if (m_additionalOptions.l2RegularizationWeight > 0)
+            update.l2RegularizationWeight = m_additionalOptions.l2RegularizationWeight * (IsCompatibleMode() ? 1 : trainingSampleCount);
+
+        // the dense float and double parameters, grouped by data type and device
+        vector<vector<Parameter>> groups;
+        for (const auto& parameter : Parameters())
+        {
+            const auto& parameterValue = parameter.Value();
+            const auto& gradientValue = gradientValues.at(parameter);
+            const auto dataType = parameter.GetDataType();
+            if ((dataType != DataType::Float && dataType != DataType::Double) || parameterValue->IsSparse() || gradientValue->IsSparse() ||
+                gradientValue->GetDataType() != dataType || gradientValue->Device() != parameterValue->Device())
+                continue;
+
+            auto group = find_if(groups.begin(), groups.end(), [&](const vector<Parameter>& g)
+            {
+                return g.front().GetDataType() == dataType && g.front().Value()->Device() == parameterValue->Device();
+            });
+            if (group == groups.end())
+                groups.push_back({ parameter });
+            else
+                group->push_back(parameter);
+        }
+
+        for (const auto& group : groups)
+        {
+            if (group.front().GetDataType() == DataType::Float)
+                UpdateMultiTensor<float>(update, group, gradientValues);
+            else
+                UpdateMultiTensor<double>(update, group, gradientValues);
+
+            for (const auto& parameter : group)
+            {
+                updatedParameters.insert(parameter);
+                auto paramRef = parameter;
+                paramRef.RecordValueUpdate();
+            }
+        }
+
+        return updatedParameters;
+    }
+
+    template <typename ElementType>
+    void LearnerBase::UpdateMultiTensor(const MultiTensorUpdateParameters<double>& update, const vector<Parameter>& parameters,
+                                        const unordered_map<Parameter, NDArrayViewPtr>& gradientValues)
+    {
+        MultiTensorUpdateParameters<ElementType> typedUpdate;
+        typedUpdate.kind = update.kind;
+        typedUpdate.gradientScale = ElementType(update.gradientScale);
+        typedUpdate.l2RegularizationWeight = ElementType(update.l2RegularizationWeight);
+        typedUpdate.learningRate = ElementType(update.learningRate);
+        typedUpdate.momentum = ElementType(update.momentum);
+        typedUpdate.unitGainFactor = ElementType(update.unitGainFactor);
+        typedUpdate.varianceMomentum = ElementType(update.varianceMomentum);
+        typedUpdate.varianceScale = ElementType(update.varianceScale);
+        typedUpdate.epsilon = ElementType(update.epsilon);
+        typedUpdate.adamax = update.adamax;
+
+        vector<shared_ptr<const Matrix<ElementType>>> matrices; // keeps the matrices alive during the update
+        vector<Matrix<ElementType>*> parameterMatrices, smoothedGradientMatrices;
+        vector<const Matrix<ElementType>*> gradientMatrices;
+        for (const auto& parameter : parameters)
+        {
+            const auto& parameterMatrix = GetWritableMatrix<ElementType>(parameter.Value());
+            const auto& gradientMatrix = GetMatrix<ElementType>(gradientValues.at(parameter));
+            const auto& smoothedGradientMatrix = GetWritableMatrix<ElementType>(m_smoothedGradientValues.at(parameter));
+            parameterMatrices.push_back(parameterMatrix.get());
+            gradientMatrices.push_back(gradientMatrix.get());
+            smoothedGradientMatrices.push_back(smoothedGradientMatrix.get());
+            matrices.insert(matrices.end(), { parameterMatrix, gradientMatrix, smoothedGradientMatrix });
+        }
+
+        Matrix<ElementType>::MultiTensorUpdate(typedUpdate, parameterMatrices, gradientMatrices, smoothedGradientMatrices);
+    }
+
+    double LearnerBase::GlobalGradientClippingScale(const unordered_map<Parameter, NDArrayViewPtr>& gradientValues, size_t trainingSampleCount) const
+    {
+        const double threshold = m_additionalOptions.gradientClippingGlobalNormThresholdPerSample;
+        if (threshold == numeric_limits<double>::infinity())
+            return 1.0;
+
+        // With data parallel training the gradients are aggregated before the update, so the norm is the same on all workers.
+        vector<NDArrayViewPtr> gradients;
+        for (const auto& parameter : Parameters())
+            gradients.push_back(gradientValues.at(parameter));
+        double sumOfSquares = 0;
+        for (auto sum : SumsOfSquares(gradients))
+            sumOfSquares += sum;
+
+        // when using compatible mode, the norm is the one of the mean gradient, otherwise the threshold is scaled up
+        const double norm = sqrt(sumOfSquares) * (IsCompatibleMode() ? 1.0 / trainingSampleCount : 1.0);
+        const double maxNorm = IsCompatibleMode() ? threshold : threshold * trainingSampleCount;
+        return norm > maxNorm ? maxNorm / norm : 1.0;
+    }
+
+    /*static*/ vector<double> LearnerBase::SumsOfSquares(const vector<NDArrayViewPtr>& values)
+    {
+        // the indices of the dense float and double values, grouped by data type and device; the others are reduced one by one
+        vector<double> sums(values.size());
+        vector<vector<size_t>> groups;
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            const auto& value = values[i];
+            const auto dataType = value->GetDataType();
+            if ((dataType == DataType::Float || dataType == DataType::Double) && !value->IsSparse())
+            {
+                auto group = find_if(groups.begin(), groups.end(), [&](const vector<size_t>& g)
+                {
+                    return values[g.front()]->GetDataType() == dataType && values[g.front()]->Device() == value->Device();
+                });
+                if (group == groups.end())
+                    groups.push_back({ i });
+                else
+                    group->push_back(i);
+                continue;
+            }
+
+            double norm;
+            switch (dataType)
+            {
+            case DataType::Float:
+                norm = GetMatrix<float>(value)->FrobeniusNorm();
+                break;
+            case DataType::Double:
+                norm = GetMatrix<double>(value)->FrobeniusNorm();
+                break;
+            case DataType::Float16:
+                norm = GetMatrix<half>(value)->FrobeniusNorm();
+                break;
+            default:
+                LogicError("Unsupported DataType %s", DataTypeName(dataType));
+            }
+            sums[i] = norm * norm;
+        }
+
+        for (const auto& group : groups)
+        {
+            if (values[group.front()]->GetDataType() == DataType::Float)
+                SumsOfSquares<float>(values, group, sums);
+            else
+                SumsOfSquares<double>(values, group, sums);
+        }
+        return sums;
+    }
+
+    template <typename ElementType>
+    /*static*/ void LearnerBase::SumsOfSquares(const vector<NDArrayViewPtr>& values, const vector<size_t>& indices, vector<double>& sums)
+    {
+        vector<shared_ptr<const Matrix<ElementType>>> matrices; // keeps the matrices alive during the reduction
+        vector<const Matrix<ElementType>*> group;
+        for (auto i : indices)
+        {
+            matrices.push_back(GetMatrix<ElementType>(values[i]));
+            group.push_back(matrices.back().get());
+        }
+
+        vector<ElementType> groupSums;
+        Matrix<ElementType>::MultiTensorSumsOfSquares(group, groupSums);
+        for (size_t i = 0; i < indices.size(); i++)
+            sums[indices[i]] = (double)groupSums[i];
+    }
+
     string LearnerBase::LearnerType() const
     {
         return Typename(this);
@@ -567,13 +846,16 @@ namespace CNTK
     {
         ReportTrainingParameterValue(m_momentumSchedule, L"Momentum");
 
+        int currentTimestamp = 0;
+        int* timestamps = LazySparseTimestamps(parameter, gradientValue, smoothedGradientValue, trainingSampleCount, currentTimestamp);
+
         switch (gradientValue->GetDataType())
         {
         case DataType::Float:
-            Update<float>(parameter, gradientValue, smoothedGradientValue, trainingSampleCount);
+            Update<float>(parameter, gradientValue, smoothedGradientValue, trainingSampleCount, timestamps, currentTimestamp);
             break;
         case DataType::Double:
-            Update<double>(parameter, gradientValue, smoothedGradientValue, trainingSampleCount);
+            Update<double>(parameter, gradientValue, smoothedGradientValue, trainingSampleCount, timestamps, currentTimestamp);
             break;
         case DataType::Float16:
             UpdateHalf(parameter, gradientValue, smoothedGradientValue, trainingSampleCount);
@@ -583,9 +865,101 @@ namespace CNTK
         }
     }
 
+    // As for AdaDelta, the timestamps of the lazy sparse updates are periodically reset, after bringing all the columns up to date.
+    /* static */ const int LearnerMomentumSGD::s_SyncInterval = 1 << 20;
+
+    int* LearnerMomentumSGD::LazySparseTimestamps(const Parameter& parameter, const NDArrayViewPtr& gradientValue,
+                                                  const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount, int& currentTimestamp)
+    {
+        currentTimestamp = 0;
+        if (!m_additionalOptions.lazySparseUpdateDecayCatchUp || !gradientValue->IsSparse() ||
+            (gradientValue->GetDataType() != DataType::Float && gradientValue->GetDataType() != DataType::Double))
+            return nullptr;
+
+        // The timestamp of a column is the time of its last update (0 meaning that it is up to date at time 0),
+        // and the current time is incremented with each update of the parameter.
+        auto search = m_lastUpdateTime.find(parameter);
+        if (search == m_lastUpdateTime.end())
+        {
+            // NDArrayView only supports Float and Double and the following assert prevents surprises in non-standard platforms
+            static_assert(sizeof(int) <= sizeof(float), "Buffer for timestamps is not big enough on this platform");
+            const auto numCols = (gradientValue->GetDataType() == DataType::Float) ?
+                GetMatrix<float>(gradientValue)->GetNumCols() : GetMatrix<double>(gradientValue)->GetNumCols();
+            const auto view = MakeSharedObject<NDArrayView>(float(0.0), NDShape({ numCols }), gradientValue->Device());
+            search = m_lastUpdateTime.emplace(make_pair(parameter, view)).first;
+            m_currentTime[parameter] = 0;
+        }
+        int* timestamps = reinterpret_cast<int*>(const_cast<float*>(search->second->DataBuffer<float>()));
+
+        if (m_currentTime[parameter] >= LearnerMomentumSGD::s_SyncInterval)
+            FlushLazySparseState(parameter, timestamps);
+
+        double decay, secondDecay;
+        LazySparseDecays(trainingSampleCount, decay, secondDecay);
+        m_lastDecays[parameter] = make_pair(decay, secondDecay);
+        currentTimestamp = ++m_currentTime[parameter];
+        return timestamps;
+    }
+
+    // Decays the columns of the smoothed gradients of the parameter as the dense updates would have since their last updates,
+    // with the decays of the last update, and resets the timestamps and the current time to 0.
+    void LearnerMomentumSGD::FlushLazySparseState(const Parameter& parameter, int* timestamps)
+    {
+        const int currentTimestamp = m_currentTime[parameter];
+        if (currentTimestamp == 0)
+            return;
+
+        const auto& decays = m_lastDecays.at(parameter);
+        const auto& smoothedGradientValue = m_smoothedGradientValues.at(parameter);
+        if (parameter.GetDataType() == DataType::Float)
+        {
+            const auto numCols = GetMatrix<float>(parameter.Value())->GetNumCols();
+            GetWritableMatrix<float>(smoothedGradientValue)->LazyDecayFlushState(numCols, (float)decays.first, (float)decays.second, timestamps, currentTimestamp);
+        }
+        else if (parameter.GetDataType() == DataType::Double)
+        {
+            const auto numCols = GetMatrix<double>(parameter.Value())->GetNumCols();
+            GetWritableMatrix<double>(smoothedGradientValue)->LazyDecayFlushState(numCols, decays.first, decays.second, timestamps, currentTimestamp);
+        }
+        else
+            LogicError("Unexpected parameter data type");
+
+        m_currentTime[parameter] = 0;
+    }
+
+    /*virtual*/ Dictionary LearnerMomentumSGD::CreateCheckpoint() /*override*/
+    {
+        // Before checkpointing we need to sync the state so that the lazy sparse updates are transparent to the user
+        for (const auto& kv : m_lastUpdateTime)
+            FlushLazySparseState(kv.first, reinterpret_cast<int*>(const_cast<float*>(kv.second->DataBuffer<float>())));
+        return LearnerBase::CreateCheckpoint();
+    }
+
+    /*virtual*/ void LearnerMomentumSGD::RestoreFromCheckpoint(const Dictionary& checkpoint) /*override*/
+    {
+        LearnerBase::RestoreFromCheckpoint(checkpoint);
+        // The restored smoothed gradients are up to date in all columns.
+        for (const auto& kv : m_lastUpdateTime)
+        {
+            m_currentTime[kv.first] = 0;
+            kv.second->SetValue(0.0f);
+        }
+    }
+
+    /*virtual*/ void LearnerMomentumSGD::ResetSmoothedGradients() /*override*/
+    {
+        LearnerBase::ResetSmoothedGradients();
+        for (const auto& kv : m_lastUpdateTime)
+        {
+            m_currentTime[kv.first] = 0;
+            kv.second->SetValue(0.0f);
+        }
+    }
+
     template <typename ElementType>
     void LearnerMomentumSGD::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, 
-                                    const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const
+                                    const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount,
+                                    int* timestamps, int currentTimestamp) const
     {
         GET_WRITABLE_MATRICES;
         /*
@@ -618,7 +992,18 @@ namespace CNTK
         const auto momentum = ElementType(MomentumValueForMB(trainingSampleCount));
         const auto unitGainFactor = UnitGainFactor<ElementType>(trainingSampleCount);
         parameterMatrix->MomentumSGDUpdate(*gradientMatrix, *smoothedGradientMatrix,
-                                           learningRate, momentum, unitGainFactor);
+                                           learningRate, momentum, unitGainFactor, timestamps, currentTimestamp);
+    }
+
+    /*virtual*/ bool LearnerMomentumSGD::GetMultiTensorUpdate(size_t trainingSampleCount, MultiTensorUpdateParameters<double>& update) const /*override*/
+    {
+        ReportTrainingParameterValue(m_momentumSchedule, L"Momentum");
+
+        update.kind = MultiTensorUpdateKind::MomentumSGD;
+        update.learningRate = LearningRate(trainingSampleCount);
+        update.momentum = MomentumValueForMB(trainingSampleCount);
+        update.unitGainFactor = UnitGainFactor<double>(trainingSampleCount);
+        return true;
     }
 
     void LearnerMomentumSGD::UpdateHalf(const Parameter& parameter, const NDArrayViewPtr& gradientValue,
@@ -732,6 +1117,17 @@ namespace CNTK
         Matrix<ElementType>::ScaleAndAdd(ElementType(-learningRate / aveMultiplier), *gradientMatrix, *parameterMatrix);
     }
 
+    /*virtual*/ bool LearnerAdaGrad::GetMultiTensorUpdate(size_t trainingSampleCount, MultiTensorUpdateParameters<double>& update) const /*override*/
+    {
+        // the average multiplier is a reduction over each parameter
+        if (m_needAveMultiplier)
+            return false;
+
+        update.kind = MultiTensorUpdateKind::AdaGrad;
+        update.learningRate = LearningRate(trainingSampleCount);
+        return true;
+    }
+
     LearnerAdaDelta::LearnerAdaDelta(
         const std::vector<Parameter>& parameters,
         const LearningRateSchedule& learningRateSchedule,
@@ -888,20 +1284,20 @@ namespace CNTK
 
     /*virtual*/ Dictionary LearnerFSAdaGrad::CreateCheckpoint() /*override*/
     {
-        auto dict = LearnerBase::CreateCheckpoint();
+        auto dict = LearnerMomentumSGD::CreateCheckpoint();
         dict[smoothedCountKey] = m_smoothedCount;
         return dict;
     }
 
     /*virtual*/ void LearnerFSAdaGrad::RestoreFromCheckpoint(const Dictionary& checkpoint) /*override*/
     {
-        LearnerBase::RestoreFromCheckpoint(checkpoint);
+        LearnerMomentumSGD::RestoreFromCheckpoint(checkpoint);
         m_smoothedCount = checkpoint[smoothedCountKey].Value<double>();
     }
 
     /*virtual*/ void LearnerFSAdaGrad::ResetSmoothedGradients() /*override*/
     {
-        LearnerBase::ResetSmoothedGradients();
+        LearnerMomentumSGD::ResetSmoothedGradients();
         m_smoothedCount = 0.0;
     }
 
@@ -940,6 +1336,17 @@ namespace CNTK
                                                 momentum, varMomentum, unitGainFactor);
     }
 
+    /*virtual*/ bool LearnerFSAdaGrad::GetMultiTensorUpdate(size_t trainingSampleCount, MultiTensorUpdateParameters<double>& update) const /*override*/
+    {
+        update.kind = MultiTensorUpdateKind::FSAdaGrad;
+        update.learningRate = LearningRate(trainingSampleCount);
+        update.momentum = MomentumValueForMB(trainingSampleCount);
+        update.unitGainFactor = UnitGainFactor<double>(trainingSampleCount);
+        update.varianceMomentum = VarianceMomentumValueForMB(trainingSampleCount);
+        update.varianceScale = m_targetAdagradAvDenom_x_sqrtAdagradSqrFrames;
+        return true;
+    }
+
     LearnerAdam::LearnerAdam(const vector<Parameter>& parameters,
         const LearningRateSchedule& learningRateSchedule,
         const MomentumSchedule& momentumSchedule,
@@ -966,20 +1373,20 @@ namespace CNTK
 
     /*virtual*/ Dictionary LearnerAdam::CreateCheckpoint() /*override*/
     {
-        auto dict = LearnerBase::CreateCheckpoint();
+        auto dict = LearnerMomentumSGD::CreateCheckpoint();
         dict[smoothedCountKey] = m_smoothedCount;
         return dict;
     }
 
     /*virtual*/ void LearnerAdam::RestoreFromCheckpoint(const Dictionary& checkpoint) /*override*/
     {
-        LearnerBase::RestoreFromCheckpoint(checkpoint);
+        LearnerMomentumSGD::RestoreFromCheckpoint(checkpoint);
         m_smoothedCount = checkpoint[smoothedCountKey].Value<double>();
     }
 
     /*virtual*/ void LearnerAdam::ResetSmoothedGradients() /*override*/
     {
-        LearnerBase::ResetSmoothedGradients();
+        LearnerMomentumSGD::ResetSmoothedGradients();
         m_smoothedCount = 0.0;
     }
 
@@ -991,12 +1398,29 @@ namespace CNTK
     /*virtual*/ void LearnerAdam::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue,
         const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) /*override*/
     {
-        DISPATCH_TO_TYPED_UPDATE_FUNCTION;
+        int currentTimestamp = 0;
+        int* timestamps = m_additionalOptions.lazySparseUpdates ?
+            LazySparseTimestamps(parameter, gradientValue, smoothedGradientValue, trainingSampleCount, currentTimestamp) : nullptr;
+
+        switch (gradientValue->GetDataType())
+        {
+        case DataType::Float:
+            Update<float>(parameter, gradientValue, smoothedGradientValue, trainingSampleCount, timestamps, currentTimestamp);
+            break;
+        case DataType::Double:
+            Update<double>(parameter, gradientValue, smoothedGradientValue, trainingSampleCount, timestamps, currentTimestamp);
+            break;
+        case DataType::Float16:
+            Update<half>(parameter, gradientValue, smoothedGradientValue, trainingSampleCount);
+            break;
+        default:
+            NOT_IMPLEMENTED;
+        }
     }
 
     template <typename ElementType>
     void LearnerAdam::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue,
-        const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const
+        const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount, int* timestamps, int currentTimestamp) const
     {
         GET_WRITABLE_MATRICES;
 
@@ -1007,7 +1431,168 @@ namespace CNTK
         const auto varMomentum = VarianceMomentumValueForMB(trainingSampleCount);
 
         smoothedGradientMatrix->AdamUpdate(*gradientMatrix, *parameterMatrix, m_smoothedCount, learningRate,
+                                           momentum, varMomentum, (ElementType)m_epsilon, unitGainFactor, m_adamax,
+                                           m_additionalOptions.lazySparseUpdates, timestamps, currentTimestamp);
+    }
+
+    /*virtual*/ bool LearnerAdam::GetMultiTensorUpdate(size_t trainingSampleCount, MultiTensorUpdateParameters<double>& update) const /*override*/
+    {
+        update.kind = MultiTensorUpdateKind::Adam;
+        update.learningRate = LearningRate(trainingSampleCount);
+        update.momentum = MomentumValueForMB(trainingSampleCount);
+        update.unitGainFactor = UnitGainFactor<double>(trainingSampleCount);
+        update.varianceMomentum = VarianceMomentumValueForMB(trainingSampleCount);
+        update.epsilon = m_epsilon;
+        update.adamax = m_adamax;
+
+        // the bias correction of Matrix::AdamUpdate()
+        const double meanCorrection = 1 - pow(update.momentum, m_smoothedCount);
+        update.varianceScale = m_adamax ? 1 / meanCorrection : sqrt(1 - pow(update.varianceMomentum, m_smoothedCount)) / meanCorrection;
+        return true;
+    }
+
+    // LARS and LAMB only support float and double parameters, since they do not keep a master copy of float16 parameters
+    static void VerifyLayerwiseAdaptiveParameters(const vector<Parameter>& parameters, const char* learnerName)
+    {
+        for (const auto& parameter : parameters)
+        {
+            if (parameter.GetDataType() != DataType::Float && parameter.GetDataType() != DataType::Double)
+                InvalidArgument("%s learner: Parameter '%S' has unsupported DataType %s; only float and double parameters are supported.",
+                                learnerName, parameter.AsString().c_str(), DataTypeName(parameter.GetDataType()));
+        }
+    }
+
+    LearnerLARS::LearnerLARS(const vector<Parameter>& parameters,
+                             const LearningRateSchedule& learningRateSchedule,
+                             const MomentumSchedule& momentumSchedule,
+                             bool unitGain,
+                             double trustCoefficient,
+                             double epsilon,
+                             AdditionalLearningOptions additionalOptions)
+                             : LearnerMomentumSGD(parameters, learningRateSchedule, momentumSchedule, unitGain, additionalOptions, 1),
+                             m_trustCoefficient(trustCoefficient), m_epsilon(epsilon)
+    {
+        if (m_trustCoefficient <= 0.0)
+            InvalidArgument("LARS trust coefficient should be positive. You are trying to set it to %g.", m_trustCoefficient);
+        if (m_epsilon < 0.0)
+            InvalidArgument("Epsilon should be non-negative. You are trying to set it to %g.", m_epsilon);
+
+        VerifyLayerwiseAdaptiveParameters(parameters, "LARS");
+    }
+
+    /*virtual*/ void LearnerLARS::PrepareParameterUpdates(const unordered_map<Parameter, NDArrayViewPtr>& gradientValues, size_t trainingSampleCount) /*override*/
+    {
+        // the norms of all parameters and gradients in one reduction
+        const auto& parameters = Parameters();
+        vector<NDArrayViewPtr> values;
+        for (const auto& parameter : parameters)
+            values.push_back(parameter.Value());
+        for (const auto& parameter : parameters)
+            values.push_back(gradientValues.at(parameter));
+        const auto sumsOfSquares = SumsOfSquares(values);
+
+        const double gradientScale = GradientScale(trainingSampleCount);
+        const double l2RegularizationWeight = m_additionalOptions.l2RegularizationWeight * (IsCompatibleMode() ? 1 : trainingSampleCount);
+        for (size_t i = 0; i < parameters.size(); i++)
+        {
+            const double parameterNorm = sqrt(sumsOfSquares[i]);
+            const double gradientNorm = gradientScale * sqrt(sumsOfSquares[parameters.size() + i]);
+            m_trustRatios[parameters[i]] = (parameterNorm > 0 && gradientNorm > 0) ?
+                m_trustCoefficient * parameterNorm / (gradientNorm + l2RegularizationWeight * parameterNorm + m_epsilon) : 1.0;
+        }
+    }
+
+    /*virtual*/ void LearnerLARS::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue,
+                                         const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) /*override*/
+    {
+        DISPATCH_TO_TYPED_UPDATE_FUNCTION;
+    }
+
+    template <typename ElementType>
+    void LearnerLARS::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue,
+                             const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const
+    {
+        GET_WRITABLE_MATRICES;
+
+        // the local learning rate is applied before the momentum
+        const auto learningRate = ElementType(LearningRate(trainingSampleCount) * m_trustRatios.at(parameter));
+        const auto momentum = ElementType(MomentumValueForMB(trainingSampleCount));
+        const auto unitGainFactor = UnitGainFactor<ElementType>(trainingSampleCount);
+        parameterMatrix->MomentumSGDUpdate(*gradientMatrix, *smoothedGradientMatrix,
+                                           learningRate, momentum, unitGainFactor);
+    }
+
+    LearnerLAMB::LearnerLAMB(const vector<Parameter>& parameters,
+                             const LearningRateSchedule& learningRateSchedule,
+                             const MomentumSchedule& momentumSchedule,
+                             bool unitGain,
+                             const MomentumSchedule& varianceMomentumSchedule,
+                             double epsilon,
+                             AdditionalLearningOptions additionalOptions)
+                             : LearnerAdam(parameters, learningRateSchedule, momentumSchedule, unitGain, varianceMomentumSchedule,
+                                           epsilon, /*adamax =*/ false, additionalOptions)
+    {
+        VerifyLayerwiseAdaptiveParameters(parameters, "LAMB");
+
+        for (const auto& parameter : parameters)
+            m_updates.emplace(parameter, AllocateSmoothedGradientFor(parameter, 1));
+    }
+
+    /*virtual*/ void LearnerLAMB::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue,
+                                         const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) /*override*/
+    {
+        DISPATCH_TO_TYPED_UPDATE_FUNCTION;
+    }
+
+    template <typename ElementType>
+    void LearnerLAMB::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue,
+                             const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const
+    {
+        GET_WRITABLE_MATRICES;
+        const auto& updateMatrix = GetWritableMatrix<ElementType>(m_updates.at(parameter));
+
+        const auto momentum = MomentumValueForMB(trainingSampleCount);
+        const auto unitGainFactor = UnitGainFactor<ElementType>(trainingSampleCount);
+        const auto varMomentum = VarianceMomentumValueForMB(trainingSampleCount);
+
+        // the update of Adam for a learning rate of 1, as the difference of a copy of the parameter before and after it;
+        // the parameter itself is updated by CompleteParameterUpdates()
+        updateMatrix->SetValue(*parameterMatrix);
+        smoothedGradientMatrix->AdamUpdate(*gradientMatrix, *updateMatrix, m_smoothedCount, /*learnRatePerSample =*/ 1.0,
                                            momentum, varMomentum, (ElementType)m_epsilon, unitGainFactor, m_adamax);
+        Matrix<ElementType>::ScaleAndAdd(ElementType(1), *parameterMatrix, ElementType(-1), *updateMatrix);
+    }
+
+    /*virtual*/ void LearnerLAMB::CompleteParameterUpdates(size_t trainingSampleCount) /*override*/
+    {
+        // the norms of all parameters and updates in one reduction
+        const auto& parameters = Parameters();
+        vector<NDArrayViewPtr> values;
+        for (const auto& parameter : parameters)
+            values.push_back(parameter.Value());
+        for (const auto& parameter : parameters)
+            values.push_back(m_updates.at(parameter));
+        const auto sumsOfSquares = SumsOfSquares(values);
+
+        const double learningRate = LearningRate(trainingSampleCount);
+        for (size_t i = 0; i < parameters.size(); i++)
+        {
+            const double parameterNorm = sqrt(sumsOfSquares[i]);
+            const double updateNorm = sqrt(sumsOfSquares[parameters.size() + i]);
+            const double trustRatio = (parameterNorm > 0 && updateNorm > 0) ? parameterNorm / updateNorm : 1.0;
+            if (parameters[i].GetDataType() == DataType::Float)
+                ApplyUpdate<float>(parameters[i], learningRate * trustRatio);
+            else
+                ApplyUpdate<double>(parameters[i], learningRate * trustRatio);
+        }
+    }
+
+    template <typename ElementType>
+    void LearnerLAMB::ApplyUpdate(const Parameter& parameter, double learningRate) const
+    {
+        const auto& parameterMatrix = GetWritableMatrix<ElementType>(parameter.Value());
+        const auto& updateMatrix = GetMatrix<ElementType>(m_updates.at(parameter));
+        Matrix<ElementType>::ScaleAndAdd(ElementType(-learningRate), *updateMatrix, *parameterMatrix);
     }
 
     LearnerRMSProp::LearnerRMSProp(const vector<Parameter>& parameters,
@@ -1152,6 +1737,28 @@ namespace CNTK
         return MakeSharedObject<LearnerAdam>(parameters, learningRateSchedule, momentumSchedule, unitGain, varianceMomentumSchedule, epsilon, adamax, additionalOptions);
     }
 
+    LearnerPtr LARSLearner(const vector<Parameter>& parameters,
+                           const LearningRateSchedule& learningRateSchedule,
+                           const MomentumSchedule& momentumSchedule,
+                           bool unitGain, /*=true*/
+                           double trustCoefficient, /*= 0.001*/
+                           double epsilon, /*= 1e-8*/
+                           AdditionalLearningOptions additionalOptions /*= AdditionalLearningOptions()*/)
+    {
+        return MakeSharedObject<LearnerLARS>(parameters, learningRateSchedule, momentumSchedule, unitGain, trustCoefficient, epsilon, additionalOptions);
+    }
+
+    LearnerPtr LAMBLearner(const vector<Parameter>& parameters,
+                           const LearningRateSchedule& learningRateSchedule,
+                           const MomentumSchedule& momentumSchedule,
+                           bool unitGain, /*=true*/
+                           const MomentumSchedule& varianceMomentumSchedule, /*= MomentumAsTimeConstantSchedulePerSample(2 * 3600 * 100)*/
+                           double epsilon, /*= 1e-6*/
+                           AdditionalLearningOptions additionalOptions /*= AdditionalLearningOptions()*/)
+    {
+        return MakeSharedObject<LearnerLAMB>(parameters, learningRateSchedule, momentumSchedule, unitGain, varianceMomentumSchedule, epsilon, additionalOptions);
+    }
+
     LearnerPtr AdaGradLearner(const vector<Parameter>& parameters,
                               const LearningRateSchedule& learningRateSchedule,
                               bool needAveMultiplier /*= true*/,
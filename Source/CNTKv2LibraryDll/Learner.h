@@ -7,6 +7,7 @@
 
 #include "stdafx.h"
 #include "CNTKLibrary.h"
+#include "CommonMatrix.h"
 #include <numeric>
 #include <functional>
 
@@ -31,6 +32,8 @@ namespace CNTK
 
         virtual void SetNeedToUpdateMasterParameter() override { m_masterParameterUpdated = false; }
 
+        virtual bool SupportsLossScaling() const override { return true; }
+
     protected:
         LearnerBase(const std::vector<Parameter>& parameters,
             const LearningRateSchedule& learningRateSchedule,
@@ -43,8 +46,28 @@ namespace CNTK
         // Allows derived class may override this to perform per-minibatch update actions
         virtual void UpdateOnMinibatch(size_t /*trainingSampleCount*/) {}
 
+        // Allow derived classes to act on all parameters of a minibatch, right before and right after they are updated one by one
+        // (e.g. with reductions over all of them, see SumsOfSquares()).
+        virtual void PrepareParameterUpdates(const std::unordered_map<Parameter, NDArrayViewPtr>& /*gradientValues*/, size_t /*trainingSampleCount*/) {}
+        virtual void CompleteParameterUpdates(size_t /*trainingSampleCount*/) {}
+
+        // Allows derived classes to update all their dense float and double parameters together (see Matrix::MultiTensorUpdate()):
+        // returns true after filling in the update for the current minibatch. The gradient scale and the L2 regularization
+        // weight are filled in by LearnerBase.
+        virtual bool GetMultiTensorUpdate(size_t /*trainingSampleCount*/, Microsoft::MSR::CNTK::MultiTensorUpdateParameters<double>& /*update*/) const { return false; }
+
         std::string LearnerType() const;
 
+        // Returns the factor by which PreProcess() scales the gradients: 1/minibatchSize in compatible mode, and global norm clipping.
+        double GradientScale(size_t minibatchSize) const
+        {
+            return (IsCompatibleMode() ? 1.0 / minibatchSize : 1.0) * m_globalGradientClippingScale;
+        }
+
+        // Returns the sum of the squares of the elements of each of the values. The dense float and double values of a device
+        // are reduced together, with a single transfer of the results (see Matrix::MultiTensorSumsOfSquares()).
+        static std::vector<double> SumsOfSquares(const std::vector<NDArrayViewPtr>& values);
+
         // Returns current learning rate.
         double LearningRate(size_t minibatchSize) const
         {
@@ -83,8 +106,13 @@ namespace CNTK
 
         bool m_masterParameterUpdated; // whether the master copy of parameters are updated
 
+        double m_globalGradientClippingScale; // the factor by which global norm clipping scales the gradients of the current minibatch
+
         mutable size_t m_noiseInjectionSeed;
 
+        // the block pruning mask of each parameter, with the sparsity it was computed for, see PostProcess()
+        mutable std::unordered_map<Parameter, std::pair<double, NDArrayViewPtr>> m_blockPruningMasks;
+
         // The following four static protected methods expose private methods of NDArrayView class
         // (which declares LearnerBase as friend class), so that they are available to subclasses.
         template <typename ElementType>
@@ -108,7 +136,7 @@ namespace CNTK
         void PreProcess(const NDArrayViewPtr& parameterValue, const NDArrayViewPtr& gradientValue, size_t actualMBSize) const;
 
         // Performs additional postprocessing after the update method has been executed
-        // (noise injection and L1 regularization specified by the additional learning parameters).
+        // (noise injection, L1 regularization and block pruning specified by the additional learning parameters).
         template <typename ElementType>
         void PostProcess(const Parameter& parameter, const NDArrayViewPtr& gradientValue, size_t actualMBSize) const;
 
@@ -125,8 +153,25 @@ namespace CNTK
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount);
 
+        // Updates the parameters that can be updated together (see GetMultiTensorUpdate()) and returns them.
+        std::unordered_set<Parameter> UpdateMultiTensor(const std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues, size_t trainingSampleCount);
+        template <typename ElementType>
+        void UpdateMultiTensor(const Microsoft::MSR::CNTK::MultiTensorUpdateParameters<double>& update, const std::vector<Parameter>& parameters,
+                               const std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues);
+
+        // Returns the factor by which the gradients are scaled so that their global norm does not exceed
+        // AdditionalLearningOptions::gradientClippingGlobalNormThresholdPerSample.
+        double GlobalGradientClippingScale(const std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues, size_t trainingSampleCount) const;
+        template <typename ElementType>
+        static void SumsOfSquares(const std::vector<NDArrayViewPtr>& values, const std::vector<size_t>& indices, std::vector<double>& sums);
+
         // TODO: make these functions friends of NDViewArray and move to Utils?
         static bool HasNan(const NDArrayViewPtr& value, const char* name);
+
+        // divides the gradients by the loss scale (see Learner::SetLossScale()); false if any of them has overflowed
+        bool UnscaleGradients(const std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues, double lossScale) const;
+        template <typename ElementType>
+        static bool UnscaleGradient(const NDArrayViewPtr& gradientValue, double lossScale, bool checkOnly);
         static void Print(const NDArrayViewPtr& value, const char* msg);
 
         // Version history:
@@ -180,14 +225,23 @@ namespace CNTK
             return MomentumValueForMB(m_momentumSchedule, minibatchSize);
         }
 
+        virtual Dictionary CreateCheckpoint() override;
+
+        virtual void RestoreFromCheckpoint(const Dictionary& checkpoint) override;
+
+        virtual void ResetSmoothedGradients() override;
+
     protected:
         virtual void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) override;
 
         template <typename ElemType>
-        void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
+        void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount,
+                    int* timestamps = nullptr, int currentTimestamp = 0) const;
 
         void UpdateHalf(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
 
+        virtual bool GetMultiTensorUpdate(size_t trainingSampleCount, Microsoft::MSR::CNTK::MultiTensorUpdateParameters<double>& update) const override;
+
         // returns current per-minibatch momentum value from the provided schedule.
         double MomentumValueForMB(const MomentumSchedule& schedule, size_t minibatchSize) const;
 
@@ -209,9 +263,33 @@ namespace CNTK
             return UseUnitGainMomentum() ? ElementType(1.0) - momentum : ElementType(1.0);
         }
 
+        // With sparse gradients only the columns present in the gradients are updated. With lazySparseUpdateDecayCatchUp,
+        // the smoothed gradients of a column are decayed for the minibatches that missed it when it is next updated, which
+        // needs a timestamp per column; like for AdaDelta, all columns are brought up to date once every s_SyncInterval updates
+        // and before checkpointing. Returns the timestamps of a float or double parameter with a sparse gradient, or null.
+        int* LazySparseTimestamps(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue,
+                                  size_t trainingSampleCount, int& currentTimestamp);
+
+        // returns the per-minibatch decays of the first and second halves (if any) of the smoothed gradients
+        virtual void LazySparseDecays(size_t trainingSampleCount, double& decay, double& secondDecay) const
+        {
+            decay = MomentumValueForMB(trainingSampleCount);
+            secondDecay = 1.0;
+        }
+
     private:
+        static const int s_SyncInterval;
+
+        void FlushLazySparseState(const Parameter& parameter, int* timestamps);
+
         MomentumSchedule m_momentumSchedule;
         bool m_unitGain;
+
+        // the timestamps and the current time of the parameters with lazily updated sparse gradients,
+        // and the decays of their last updates, which are used to bring all the columns up to date
+        std::unordered_map<Parameter, NDArrayViewPtr> m_lastUpdateTime;
+        std::unordered_map<Parameter, int> m_currentTime;
+        std::unordered_map<Parameter, std::pair<double, double>> m_lastDecays;
     };
 
     // Nesterov's accelerated SGDLearnerBase descent. 
@@ -233,6 +311,8 @@ namespace CNTK
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
         void UpdateHalf(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
+
+        virtual bool GetMultiTensorUpdate(size_t /*trainingSampleCount*/, Microsoft::MSR::CNTK::MultiTensorUpdateParameters<double>& /*update*/) const override { return false; }
     };
 
     class LearnerAdaGrad : public LearnerBase
@@ -250,6 +330,8 @@ namespace CNTK
 
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
+
+        virtual bool GetMultiTensorUpdate(size_t trainingSampleCount, Microsoft::MSR::CNTK::MultiTensorUpdateParameters<double>& update) const override;
     };
 
     class LearnerAdaDelta : public LearnerBase
@@ -309,6 +391,8 @@ namespace CNTK
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
 
+        virtual bool GetMultiTensorUpdate(size_t trainingSampleCount, Microsoft::MSR::CNTK::MultiTensorUpdateParameters<double>& update) const override;
+
     private:
         static const double s_targetAdagradAvDenom;
         double m_targetAdagradAvDenom_x_sqrtAdagradSqrFrames;
@@ -348,9 +432,17 @@ namespace CNTK
         virtual void UpdateOnMinibatch(size_t trainingSampleCount) override;
 
         template <typename ElementType>
-        void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
+        void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount,
+                    int* timestamps = nullptr, int currentTimestamp = 0) const;
 
-    private:
+        virtual bool GetMultiTensorUpdate(size_t trainingSampleCount, Microsoft::MSR::CNTK::MultiTensorUpdateParameters<double>& update) const override;
+
+        // the smoothed gradients hold the variance followed by the momentum
+        virtual void LazySparseDecays(size_t trainingSampleCount, double& decay, double& secondDecay) const override
+        {
+            decay = VarianceMomentumValueForMB(trainingSampleCount);
+            secondDecay = MomentumValueForMB(trainingSampleCount);
+        }
 
         // returns current per-minibatch variance momentum value.
         double VarianceMomentumValueForMB(size_t minibatchSize) const
@@ -365,6 +457,67 @@ namespace CNTK
         bool m_adamax;
     };
 
+    // Layer-wise adaptive rate scaling (LARS): momentum SGD with the learning rate of each parameter w scaled by the trust ratio
+    // trustCoefficient * ||w|| / (||g|| + l2RegularizationWeight * ||w|| + epsilon), where g is the gradient of w as weighted by PreProcess().
+    // The norms of all parameters and gradients are computed together before the parameters are updated.
+    class LearnerLARS : public LearnerMomentumSGD
+    {
+    public:
+        LearnerLARS(const std::vector<Parameter>& parameters,
+                    const LearningRateSchedule& learningRateSchedule,
+                    const MomentumSchedule& momentumSchedule,
+                    bool unitGain,
+                    double trustCoefficient,
+                    double epsilon,
+                    AdditionalLearningOptions additionalOptions);
+
+    protected:
+        virtual void PrepareParameterUpdates(const std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues, size_t trainingSampleCount) override;
+
+        virtual void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) override;
+
+        template <typename ElementType>
+        void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
+
+        virtual bool GetMultiTensorUpdate(size_t /*trainingSampleCount*/, Microsoft::MSR::CNTK::MultiTensorUpdateParameters<double>& /*update*/) const override { return false; }
+
+    private:
+        double m_trustCoefficient;
+        double m_epsilon;
+        std::unordered_map<Parameter, double> m_trustRatios; // of the current minibatch
+    };
+
+    // Layer-wise adaptive moments (LAMB): Adam with the update r of each parameter w scaled by the trust ratio ||w|| / ||r||.
+    // The updates are computed one by one, and the parameters are updated together once the norms of all of them are known.
+    class LearnerLAMB : public LearnerAdam
+    {
+    public:
+        LearnerLAMB(const std::vector<Parameter>& parameters,
+                    const LearningRateSchedule& learningRateSchedule,
+                    const MomentumSchedule& momentumSchedule,
+                    bool unitGain,
+                    const MomentumSchedule& varianceMomentumSchedule,
+                    double epsilon,
+                    AdditionalLearningOptions additionalOptions);
+
+    protected:
+        virtual void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) override;
+
+        template <typename ElementType>
+        void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
+
+        virtual void CompleteParameterUpdates(size_t trainingSampleCount) override;
+
+        template <typename ElementType>
+        void ApplyUpdate(const Parameter& parameter, double learningRate) const;
+
+        virtual bool GetMultiTensorUpdate(size_t /*trainingSampleCount*/, Microsoft::MSR::CNTK::MultiTensorUpdateParameters<double>& /*update*/) const override { return false; }
+
+    private:
+        // the Adam updates of the current minibatch for a learning rate of 1, which are not part of the checkpoints
+        std::unordered_map<Parameter, NDArrayViewPtr> m_updates;
+    };
+
     class LearnerRMSProp : public LearnerBase
     {
     public:
@@ -412,6 +565,9 @@ namespace CNTK
         //virtual bool Update(std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues, size_t trainingSampleCount, bool sweepEnd = false) override;
         virtual bool Update(std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues, size_t trainingSampleCount, bool sweepEnd) override;
 
+        // the update function gets the gradients as they are
+        virtual bool SupportsLossScaling() const override { return false; }
+
     private:
         void ValidateInput(const std::vector<Parameter>& parameters, const std::vector<Variable>& gradients, FunctionPtr updateFunc);
 
@@ -311,6 +311,10 @@ namespace CNTK
 
     /*virtual*/ Dictionary CompositeMinibatchSource::GetCheckpointState() const /*override*/
     {
+        // A restored state that is not applied yet.
+        if (m_state.IsInitialized())
+            return m_state.Get();
+
         auto state = m_shim->GetState();
         Dictionary result;
         for (const auto& p : state)
@@ -323,10 +327,9 @@ namespace CNTK
 
     /*virtual*/ void CompositeMinibatchSource::RestoreFromCheckpoint(const Dictionary& checkpoint) /*override*/
     {
-        m_shim->SetState(ToMap(checkpoint));
-
         // Need to reinitialize, we also have to remember the current position because StartEpoch
-        // effectively resets it.
+        // effectively resets it. The state is only set after StartEpoch: setting it here as well would
+        // make the randomizer replay the sweep up to the position twice.
         // TODO: Remove call to StartEpoch - this API is legacy.
         m_state = checkpoint;
         m_epochEndReached = false;
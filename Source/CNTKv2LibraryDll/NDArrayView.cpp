@@ -79,6 +79,8 @@ namespace CNTK
             return AllocateTensorView<double>(viewShape, device, dataBuffer, bufferSizeInBytes);
         case DataType::Float16:
             return AllocateTensorView<half>(viewShape, device, dataBuffer, bufferSizeInBytes);
+        case DataType::BFloat16:
+            return AllocateTensorView<bfloat16>(viewShape, device, dataBuffer, bufferSizeInBytes);
         case DataType::Int8:
             return AllocateTensorView<char>(viewShape, device, dataBuffer, bufferSizeInBytes);
         case DataType::Int16:
@@ -119,6 +121,8 @@ namespace CNTK
             return AllocateTensorView<double>(viewShape, storageType, device, numNonZeroValues);
         case DataType::Float16:
             return AllocateTensorView<half>(viewShape, storageType, device, numNonZeroValues);
+        case DataType::BFloat16:
+            return AllocateTensorView<bfloat16>(viewShape, storageType, device, numNonZeroValues);
         case DataType::Int8:
             return AllocateTensorView<char>(viewShape, storageType, device, numNonZeroValues);
         case DataType::Int16:
@@ -129,6 +133,63 @@ namespace CNTK
         }
     }
 
+    // Returns true if the elements of a TensorShape are laid out contiguously in column-major order,
+    // i.e. the shape is not a strided slice of its storage object
+    static bool IsDense(const TensorShape& shape)
+    {
+        ptrdiff_t stride = 1;
+        for (size_t k = 0; k < shape.GetRank(); ++k)
+        {
+            if ((shape[k] != 1) && (shape.GetStrides()[k] != stride))
+                return false;
+
+            stride *= (ptrdiff_t)shape[k];
+        }
+
+        return true;
+    }
+
+    // Creates a strided view over the storage object of 'tensorView', taking every strides[i]-th element in [startOffset[i], endOffset[i]) along axis i.
+    // The trailing axes beyond the rank of the slice are dropped, except for the padding to rank 2 of all TensorViews of an NDArrayView.
+    template <typename V1ElemType>
+    static TensorView<V1ElemType>* NewStridedSliceView(const TensorView<V1ElemType>& tensorView, const std::vector<size_t>& startOffset, const std::vector<size_t>& endOffset, const std::vector<size_t>& strides, size_t sliceRank)
+    {
+        auto sliceShape = tensorView.GetShape();
+        for (size_t i = 0; i < startOffset.size(); ++i)
+            sliceShape.NarrowTo(i, startOffset[i], endOffset[i], ((endOffset[i] - startOffset[i]) > 1) ? (int)strides[i] : 1);
+
+        SmallVector<bool> dimsToDrop(sliceShape.GetRank(), false);
+        for (size_t k = std::max<size_t>(2, sliceRank); k < sliceShape.GetRank(); ++k)
+            dimsToDrop[k] = true;
+
+        sliceShape.DropDimsInPlace(dimsToDrop);
+        return new TensorView<V1ElemType>(tensorView, sliceShape);
+    }
+
+    // Copies a strided TensorView into a new dense storage object on the same device, for the readers that need a Matrix
+    template <typename V1ElemType>
+    static TensorView<V1ElemType> DenseCopyOf(const TensorView<V1ElemType>& tensorView)
+    {
+        TensorShape denseShape(tensorView.GetShape().GetDims());
+        auto matrix = std::make_shared<Matrix<V1ElemType>>(denseShape.GetNumElements(), 1, tensorView.GetSOBPtr()->GetDeviceId());
+        TensorView<V1ElemType> denseView(matrix, denseShape);
+        denseView.AssignCopyOf(tensorView);
+        return denseView;
+    }
+
+    // Strided slices are not created for the integer types
+    template <>
+    TensorView<char> DenseCopyOf(const TensorView<char>&)
+    {
+        LogicError("NDArrayView: Strided views of DataType Int8 are not supported.");
+    }
+
+    template <>
+    TensorView<short> DenseCopyOf(const TensorView<short>&)
+    {
+        LogicError("NDArrayView: Strided views of DataType Int16 are not supported.");
+    }
+
     NDArrayView::NDArrayView(CNTK::DataType dataType, const NDShape& viewShape, void* dataBuffer, size_t bufferSizeInBytes, const DeviceDescriptor& device, bool readOnly/* = false*/)
         : NDArrayView(dataType, device, StorageFormat::Dense, viewShape, readOnly, AllocateTensorView(dataType, viewShape, device, dataBuffer, bufferSizeInBytes))
     {
@@ -161,6 +222,12 @@ namespace CNTK
                 sparseMatrix->SetMatrixFromCSCFormat(colStarts, rowIndices, (const half*)nonZeroValues, numNonZeroValues, sparseMatrix->GetNumRows(), sparseMatrix->GetNumCols());
                 break;
             }
+            case DataType::BFloat16:
+            {
+                auto sparseMatrix = GetWritableMatrix<bfloat16>(1);
+                sparseMatrix->SetMatrixFromCSCFormat(colStarts, rowIndices, (const bfloat16*)nonZeroValues, numNonZeroValues, sparseMatrix->GetNumRows(), sparseMatrix->GetNumCols());
+                break;
+            }
             case DataType::Int8:
             {
                 auto sparseMatrix = GetWritableMatrix<char>(1);
@@ -197,6 +264,9 @@ namespace CNTK
             case DataType::Float16:
                 delete GetTensorView<half>();
                 break;
+            case DataType::BFloat16:
+                delete GetTensorView<bfloat16>();
+                break;
             case DataType::Int8:
                 delete GetTensorView<char>();
                 break;
@@ -223,6 +293,14 @@ namespace CNTK
             SetValue((double)value);
         else if (GetDataType() == DataType::Float16)
             SetValue((float16)value);
+        else if (GetDataType() == DataType::BFloat16)
+        {
+            // there is no public bfloat16 type, so its scalars are only set from float
+            if (IsSparse())
+                LogicError("NDArrayView::SetValue: Setting a NDArrayView contents to a scalar is only allowed for objects with dense storage format.");
+
+            GetWritableMatrix<bfloat16>()->SetValue((bfloat16)value);
+        }
         else
         {
             if (IsSparse())
@@ -258,6 +336,9 @@ namespace CNTK
 
     bool NDArrayView::IsSliceView()
     {
+        if (!IsContiguous())
+            return true;
+
         switch (m_dataType)
         {
         case DataType::Float:
@@ -275,6 +356,11 @@ namespace CNTK
             auto currentMatrix = GetMatrix<half>();
             return currentMatrix->IsView();
         }
+        case DataType::BFloat16:
+        {
+            auto currentMatrix = GetMatrix<bfloat16>();
+            return currentMatrix->IsView();
+        }
         case DataType::Int8:
         {
             auto currentMatrix = GetMatrix<char>();
@@ -342,13 +428,26 @@ namespace CNTK
     template <typename V1ElemType>
     std::shared_ptr<const Matrix<V1ElemType>> NDArrayView::GetMatrix(size_t rowColSplitPoint/* = AutoSelectRowColSplitPoint*/) const
     {
-        return GetMatrixImpl<V1ElemType>(GetTensorView<V1ElemType>(), rowColSplitPoint);
+        auto tensorView = GetTensorView<V1ElemType>();
+
+        // A strided slice is materialized only here, for the readers that need a Matrix
+        if (!IsDense(tensorView->GetShape()))
+        {
+            auto denseView = DenseCopyOf<V1ElemType>(*tensorView);
+            return GetMatrixImpl<V1ElemType>(&denseView, rowColSplitPoint);
+        }
+
+        return GetMatrixImpl<V1ElemType>(tensorView, rowColSplitPoint);
     }
 
     template <typename V1ElemType>
     std::shared_ptr<Matrix<V1ElemType>> NDArrayView::GetWritableMatrix(size_t rowColSplitPoint/* = AutoSelectRowColSplitPoint*/)
     {
-        return GetMatrixImpl<V1ElemType>(GetWritableTensorView<V1ElemType>(), rowColSplitPoint);
+        auto tensorView = GetWritableTensorView<V1ElemType>();
+        if (!IsDense(tensorView->GetShape()))
+            InvalidArgument("NDArrayView::GetWritableMatrix: A strided NDArrayView (shape = %S) cannot be written as a Matrix; use CopyFrom() to write it.", Shape().AsString().c_str());
+
+        return GetMatrixImpl<V1ElemType>(tensorView, rowColSplitPoint);
     }
 
     std::shared_ptr<const MatrixBase> NDArrayView::GetMatrixBase(size_t rowColSplitPoint/* = AutoSelectRowColSplitPoint*/) const
@@ -356,15 +455,17 @@ namespace CNTK
         switch (m_dataType)
         {
         case DataType::Float:
-            return GetMatrixImpl<float>(GetTensorView<float>(), rowColSplitPoint);
+            return GetMatrix<float>(rowColSplitPoint);
         case DataType::Double:
-            return GetMatrixImpl<double>(GetTensorView<double>(), rowColSplitPoint);
+            return GetMatrix<double>(rowColSplitPoint);
         case DataType::Float16:
-            return GetMatrixImpl<half>(GetTensorView<half>(), rowColSplitPoint);
+            return GetMatrix<half>(rowColSplitPoint);
+        case DataType::BFloat16:
+            return GetMatrix<bfloat16>(rowColSplitPoint);
         case DataType::Int8:
-            return GetMatrixImpl<char>(GetTensorView<char>(), rowColSplitPoint);
+            return GetMatrix<char>(rowColSplitPoint);
         case DataType::Int16:
-            return GetMatrixImpl<short>(GetTensorView<short>(), rowColSplitPoint);
+            return GetMatrix<short>(rowColSplitPoint);
         default:
             LogicError("Unknown m_dataType %d", (int)m_dataType);
         }
@@ -376,21 +477,48 @@ namespace CNTK
         switch (m_dataType)
         {
         case DataType::Float:
-            return GetMatrixImpl<float>(GetWritableTensorView<float>(), rowColSplitPoint);
+            return GetWritableMatrix<float>(rowColSplitPoint);
         case DataType::Double:
-            return GetMatrixImpl<double>(GetWritableTensorView<double>(), rowColSplitPoint);
+            return GetWritableMatrix<double>(rowColSplitPoint);
         case DataType::Float16:
-            return GetMatrixImpl<half>(GetWritableTensorView<half>(), rowColSplitPoint);
+            return GetWritableMatrix<half>(rowColSplitPoint);
+        case DataType::BFloat16:
+            return GetWritableMatrix<bfloat16>(rowColSplitPoint);
         case DataType::Int8:
-            return GetMatrixImpl<char>(GetWritableTensorView<char>(), rowColSplitPoint);
+            return GetWritableMatrix<char>(rowColSplitPoint);
         case DataType::Int16:
-            return GetMatrixImpl<short>(GetWritableTensorView<short>(), rowColSplitPoint);
+            return GetWritableMatrix<short>(rowColSplitPoint);
         default:
             LogicError("Unknown m_dataType %d", (int)m_dataType);
         }
         return nullptr;
     }
 
+    bool NDArrayView::IsContiguous() const
+    {
+        if (IsSparse())
+            return true;
+
+        switch (m_dataType)
+        {
+        case DataType::Float:
+            return IsDense(GetTensorView<float>()->GetShape());
+        case DataType::Double:
+            return IsDense(GetTensorView<double>()->GetShape());
+        case DataType::Float16:
+            return IsDense(GetTensorView<half>()->GetShape());
+        case DataType::BFloat16:
+            return IsDense(GetTensorView<bfloat16>()->GetShape());
+        case DataType::Int8:
+            return IsDense(GetTensorView<char>()->GetShape());
+        case DataType::Int16:
+            return IsDense(GetTensorView<short>()->GetShape());
+        default:
+            LogicError("NDArrayView::IsContiguous: Unsupported DataType %s", DataTypeName(m_dataType));
+            break;
+        }
+    }
+
     template <typename V1ElemType>
     const TensorView<V1ElemType>* NDArrayView::GetTensorView() const
     {
@@ -435,6 +563,13 @@ namespace CNTK
             newMatrix->AssignValuesOf(*thisMatrix);
             break;
         }
+        case DataType::BFloat16:
+        {
+            auto newMatrix = newView->GetWritableMatrix<bfloat16>();
+            auto thisMatrix = GetMatrix<bfloat16>();
+            newMatrix->AssignValuesOf(*thisMatrix);
+            break;
+        }
         case DataType::Int8:
         {
             auto newMatrix = newView->GetWritableMatrix<char>();
@@ -467,6 +602,39 @@ namespace CNTK
         if (IsReadOnly())
             RuntimeError("NDArrayView::CopyFrom: Cannot modify contents of a readonly NDArrayView.");
 
+        if (!IsContiguous())
+        {
+            // Write through the strided view into the data it aliases
+            if (source.IsSparse())
+                InvalidArgument("NDArrayView::CopyFrom: Cannot copy a sparse NDArrayView into a strided NDArrayView.");
+
+            NDArrayViewPtr sourceOnThisDevice;
+            if (source.Device() != Device())
+                sourceOnThisDevice = source.DeepClone(Device(), /*readOnly=*/ true);
+
+            const NDArrayView& sourceView = sourceOnThisDevice ? *sourceOnThisDevice : source;
+            switch (m_dataType)
+            {
+            case DataType::Float:
+                GetWritableTensorView<float>()->AssignCopyOf(*sourceView.GetTensorView<float>());
+                break;
+            case DataType::Double:
+                GetWritableTensorView<double>()->AssignCopyOf(*sourceView.GetTensorView<double>());
+                break;
+            case DataType::Float16:
+                GetWritableTensorView<half>()->AssignCopyOf(*sourceView.GetTensorView<half>());
+                break;
+            case DataType::BFloat16:
+                GetWritableTensorView<bfloat16>()->AssignCopyOf(*sourceView.GetTensorView<bfloat16>());
+                break;
+            default:
+                LogicError("NDArrayView::CopyFrom: Unsupported DataType %s for a strided NDArrayView", DataTypeName(m_dataType));
+                break;
+            }
+
+            return;
+        }
+
         switch (m_dataType)
         {
         case DataType::Float:
@@ -490,6 +658,13 @@ namespace CNTK
             destMatrix->AssignValuesOf(*sourceMatrix);
             break;
         }
+        case DataType::BFloat16:
+        {
+            auto sourceMatrix = source.GetMatrix<bfloat16>();
+            auto destMatrix = GetWritableMatrix<bfloat16>();
+            destMatrix->AssignValuesOf(*sourceMatrix);
+            break;
+        }
         case DataType::Int8:
         {
             auto sourceMatrix = source.GetMatrix<char>();
@@ -524,6 +699,9 @@ namespace CNTK
         case DataType::Float16:
             tensorView = new TensorView<half>(*(GetTensorView<half>()));
             break;
+        case DataType::BFloat16:
+            tensorView = new TensorView<bfloat16>(*(GetTensorView<bfloat16>()));
+            break;
         case DataType::Int8:
             tensorView = new TensorView<char>(*(GetTensorView<char>()));
             break;
@@ -539,6 +717,11 @@ namespace CNTK
     }
 
     NDArrayViewPtr NDArrayView::SliceView(const std::vector<size_t>& startOffset, const std::vector<size_t>& extent, bool readOnly) const
+    {
+        return SliceView(startOffset, extent, std::vector<size_t>(), readOnly);
+    }
+
+    NDArrayViewPtr NDArrayView::SliceView(const std::vector<size_t>& startOffset, const std::vector<size_t>& extent, const std::vector<size_t>& strides, bool readOnly) const
     {
         auto rank = Shape().Rank();
         if (startOffset.size() != rank)
@@ -550,25 +733,70 @@ namespace CNTK
         if (std::find(extent.begin(), extent.end(), 0) != extent.end())
             InvalidArgument("NDArrayView::SliceView: Specified slice extent is zero along at least one of the axes.");
 
+        if (strides.size() > rank)
+            InvalidArgument("NDArrayView::SliceView: Dimensionality (%d) of the specified slice strides exceeds the rank (%d) of this NDArrayView.", (int)strides.size(), (int)rank);
+
+        if (std::find(strides.begin(), strides.end(), 0) != strides.end())
+            InvalidArgument("NDArrayView::SliceView: Specified slice stride is zero along at least one of the axes.");
+
+        // A slice that is not contiguous in memory becomes a strided view over the same data
+        bool isContiguousSlice = IsContiguous();
         bool anyPrevAxisSliced = false;
         NDShape sliceViewShape(extent);
+        std::vector<size_t> sliceStrides(rank, 1);
+        std::copy(strides.begin(), strides.end(), sliceStrides.begin());
         std::vector<size_t> endOffset(rank);
         for (size_t i = 0; i < rank; ++i)
         {
             if ((i < sliceViewShape.Rank()) && (sliceViewShape[i] == NDShape::InferredDimension))
-                sliceViewShape[i] = Shape()[i] - startOffset[i];
+                sliceViewShape[i] = (Shape()[i] - startOffset[i] + sliceStrides[i] - 1) / sliceStrides[i];
 
-            endOffset[i] = startOffset[i] + ((i < sliceViewShape.Rank()) ? sliceViewShape[i] : 1);
-
-            if (anyPrevAxisSliced && ((endOffset[i] - startOffset[i]) != 1))
-                InvalidArgument("NDArrayView::SliceView: Cannot create a slice which is not contiguous in memory. "
+            size_t sliceExtent = (i < sliceViewShape.Rank()) ? sliceViewShape[i] : 1;
+            endOffset[i] = startOffset[i] + (sliceExtent - 1) * sliceStrides[i] + 1;
+            if (endOffset[i] > Shape()[i])
+                InvalidArgument("NDArrayView::SliceView: The slice exceeds the bounds of this NDArrayView along axis %d. "
                                 "This NDArrayView shape = %S, slice offset = %S, slice extent = %S.",
-                                 Shape().AsString().c_str(), NDShape(startOffset).AsString().c_str(), NDShape(extent).AsString().c_str());
+                                (int)i, Shape().AsString().c_str(), NDShape(startOffset).AsString().c_str(), NDShape(extent).AsString().c_str());
+
+            if ((anyPrevAxisSliced && (sliceExtent != 1)) || ((sliceStrides[i] != 1) && (sliceExtent != 1)))
+                isContiguousSlice = false;
 
             bool isCurrentAxisSliced = (startOffset[i] != 0) || (endOffset[i] != Shape()[i]);
             anyPrevAxisSliced = anyPrevAxisSliced || isCurrentAxisSliced;
         }
 
+        if (!isContiguousSlice)
+        {
+            void* stridedTensorView = nullptr;
+            if (!IsSparse())
+            {
+                switch (m_dataType)
+                {
+                case DataType::Float:
+                    stridedTensorView = NewStridedSliceView<float>(*GetTensorView<float>(), startOffset, endOffset, sliceStrides, sliceViewShape.Rank());
+                    break;
+                case DataType::Double:
+                    stridedTensorView = NewStridedSliceView<double>(*GetTensorView<double>(), startOffset, endOffset, sliceStrides, sliceViewShape.Rank());
+                    break;
+                case DataType::Float16:
+                    stridedTensorView = NewStridedSliceView<half>(*GetTensorView<half>(), startOffset, endOffset, sliceStrides, sliceViewShape.Rank());
+                    break;
+                case DataType::BFloat16:
+                    stridedTensorView = NewStridedSliceView<bfloat16>(*GetTensorView<bfloat16>(), startOffset, endOffset, sliceStrides, sliceViewShape.Rank());
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            if (stridedTensorView == nullptr)
+                InvalidArgument("NDArrayView::SliceView: Cannot create a slice which is not contiguous in memory of a sparse or integer NDArrayView. "
+                                "This NDArrayView shape = %S, slice offset = %S, slice extent = %S.",
+                                 Shape().AsString().c_str(), NDShape(startOffset).AsString().c_str(), NDShape(extent).AsString().c_str());
+
+            return MakeSharedObject<NDArrayView>(GetDataType(), Device(), GetStorageFormat(), sliceViewShape, IsReadOnly() || readOnly, stridedTensorView);
+        }
+
         auto flatBufferOffset = AsTensorShape(Shape()).Locate(startOffset);
         auto sliceViewMatrixDims = GetMatrixDimensions(sliceViewShape);
         assert((flatBufferOffset % sliceViewMatrixDims.first) == 0);
@@ -615,6 +843,19 @@ namespace CNTK
             tensorView = new TensorView<half>(slicedMatrixView, AsTensorViewShape(sliceViewShape));
             break;
         }
+        case DataType::BFloat16:
+        {
+            auto currentMatrix = GetMatrix<bfloat16>();
+            std::pair<size_t, size_t> currentMatrixDims = { currentMatrix->GetNumRows(), currentMatrix->GetNumCols() };
+            std::shared_ptr<Matrix<bfloat16>> slicedMatrixView;
+            if (sliceViewMatrixDims.first != currentMatrixDims.first)
+                slicedMatrixView = make_shared<Matrix<bfloat16>>(currentMatrix->Reshaped(1, currentMatrix->GetNumElements()).ColumnSlice(flatBufferOffset, sliceViewShape.TotalSize()));
+            else
+                slicedMatrixView = make_shared<Matrix<bfloat16>>(currentMatrix->ColumnSlice(sliceMatrixColumnOffset, sliceViewMatrixDims.second));
+
+            tensorView = new TensorView<bfloat16>(slicedMatrixView, AsTensorViewShape(sliceViewShape));
+            break;
+        }
         case DataType::Int8:
         {
             auto currentMatrix = GetMatrix<char>();
@@ -664,6 +905,9 @@ namespace CNTK
                             (int)newShape.TotalSize(), newShape.AsString().c_str());
         }
 
+        if (!IsContiguous())
+            InvalidArgument("NDArrayView::AsShape: A strided NDArrayView (shape = %S) cannot be reshaped; DeepClone() it to get a contiguous copy.", Shape().AsString().c_str());
+
         auto newTensorShape = AsTensorViewShape(newShape);
         void* tensorView = nullptr;
         switch (m_dataType)
@@ -677,6 +921,9 @@ namespace CNTK
         case DataType::Float16:
             tensorView = new TensorView<half>(*(GetTensorView<half>()), newTensorShape);
             break;
+        case DataType::BFloat16:
+            tensorView = new TensorView<bfloat16>(*(GetTensorView<bfloat16>()), newTensorShape);
+            break;
         case DataType::Int8:
             tensorView = new TensorView<char>(*(GetTensorView<char>()), newTensorShape);
             break;
@@ -725,6 +972,9 @@ namespace CNTK
         if (IsSparse())
             InvalidArgument("The stroage format of 'this' NDArrayView is sparse. Please use SparseDataBuffers().");
 
+        if (!IsContiguous())
+            InvalidArgument("NDArrayView::DataBuffer: A strided NDArrayView (shape = %S) has no contiguous data buffer; DeepClone() it to get a contiguous copy.", Shape().AsString().c_str());
+
         // First make sure that the underlying matrix is on the right device
         auto matrix = GetMatrix<V1ElemType>();
         matrix->TransferToDeviceIfNotThere(AsCNTKImplDeviceId(m_device), true);
@@ -965,6 +1215,13 @@ namespace CNTK
             matrix->CollapseDataLocation();
             break;
         }
+        case DataType::BFloat16:
+        {
+            auto matrix = GetMatrix<bfloat16>();
+            matrix->TransferFromDeviceToDevice(matrix->GetDeviceId(), AsCNTKImplDeviceId(device), /*isBeingMoved = */ true, /*emptyTransfer =*/ false, /*updatePreferredDevice =*/ true);
+            matrix->CollapseDataLocation();
+            break;
+        }
         case DataType::Int8:
         {
             auto matrix = GetMatrix<char>();
@@ -1103,6 +1360,8 @@ namespace CNTK
             scalar = static_cast<ElementType>(*(cpuData->DataBuffer<double>()));
         else if (scalarData->GetDataType() == DataType::Float16)
             scalar = static_cast<ElementType>(*(cpuData->DataBuffer<float16>()));
+        else if (scalarData->GetDataType() == DataType::BFloat16)
+            scalar = static_cast<ElementType>((float)*(cpuData->GetMatrix<bfloat16>()->Data()));
         else if (scalarData->GetDataType() == DataType::Int8)
             scalar = static_cast<ElementType>(*(cpuData->DataBuffer<char>()));
         else if (scalarData->GetDataType() == DataType::Int16)
@@ -1143,6 +1402,7 @@ namespace CNTK
     template CNTK_API const TensorView<float>* NDArrayView::GetTensorView<float>() const;
     template CNTK_API const TensorView<double>* NDArrayView::GetTensorView<double>() const;
     template CNTK_API const TensorView<half>* NDArrayView::GetTensorView<half>() const;
+    template CNTK_API const TensorView<bfloat16>* NDArrayView::GetTensorView<bfloat16>() const;
     template CNTK_API const TensorView<char>* NDArrayView::GetTensorView<char>() const;
     template CNTK_API const TensorView<short>* NDArrayView::GetTensorView<short>() const;
 
@@ -1167,17 +1427,20 @@ namespace CNTK
     template std::shared_ptr<const Matrix<float>> NDArrayView::GetMatrix(size_t rowColSplitPoint/* = AutoSelectRowColSplitPoint*/) const;
     template std::shared_ptr<const Matrix<double>> NDArrayView::GetMatrix(size_t rowColSplitPoint/* = AutoSelectRowColSplitPoint*/) const;
     template std::shared_ptr<const Matrix<half>> NDArrayView::GetMatrix(size_t rowColSplitPoint/* = AutoSelectRowColSplitPoint*/) const;
+    template std::shared_ptr<const Matrix<bfloat16>> NDArrayView::GetMatrix(size_t rowColSplitPoint/* = AutoSelectRowColSplitPoint*/) const;
     template std::shared_ptr<const Matrix<char>> NDArrayView::GetMatrix(size_t rowColSplitPoint/* = AutoSelectRowColSplitPoint*/) const;
     template std::shared_ptr<const Matrix<short>> NDArrayView::GetMatrix(size_t rowColSplitPoint/* = AutoSelectRowColSplitPoint*/) const;
 
     template std::shared_ptr<Matrix<float>> NDArrayView::GetWritableMatrix<float>(size_t rowColSplitPoint/* = AutoSelectRowColSplitPoint*/);
     template std::shared_ptr<Matrix<double>> NDArrayView::GetWritableMatrix<double>(size_t rowColSplitPoint/* = AutoSelectRowColSplitPoint*/);
     template std::shared_ptr<Matrix<half>> NDArrayView::GetWritableMatrix<half>(size_t rowColSplitPoint/* = AutoSelectRowColSplitPoint*/);
+    template std::shared_ptr<Matrix<bfloat16>> NDArrayView::GetWritableMatrix<bfloat16>(size_t rowColSplitPoint/* = AutoSelectRowColSplitPoint*/);
     template std::shared_ptr<Matrix<char>> NDArrayView::GetWritableMatrix<char>(size_t rowColSplitPoint/* = AutoSelectRowColSplitPoint*/);
     template std::shared_ptr<Matrix<short>> NDArrayView::GetWritableMatrix<short>(size_t rowColSplitPoint/* = AutoSelectRowColSplitPoint*/);
     template TensorView<float>* NDArrayView::GetWritableTensorView<float>();
     template TensorView<double>* NDArrayView::GetWritableTensorView<double>();
     template TensorView<half>* NDArrayView::GetWritableTensorView<half>();
+    template TensorView<bfloat16>* NDArrayView::GetWritableTensorView<bfloat16>();
     template TensorView<char>* NDArrayView::GetWritableTensorView<char>();
     template TensorView<short>* NDArrayView::GetWritableTensorView<short>();
 
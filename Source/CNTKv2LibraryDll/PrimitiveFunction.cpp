@@ -775,10 +775,19 @@ namespace CNTK
                             assert(m_inputs.size() == 2);
                             auto inputShape1 = m_inputs[0].Shape();
                             auto inputShape2 = m_inputs[1].Shape();
-                            auto inputDim2 = inputShape2.Dimensions();
-                            inputDim2.pop_back();
-                            outputShape = NDShape(inputDim2);
+                            size_t axisIndex = inputShape2.Rank() - 1;
+                            if (m_attributes.Contains(PrimitiveFunctionAttribute::AttributeNameAxis))
+                            {
+                                auto axis = NormalizeStaticAxis(m_attributes[PrimitiveFunctionAttribute::AttributeNameAxis].Value<Axis>(), inputShape2);
+                                if (!axis.IsStaticAxis() || axis.StaticAxisIndex() < 0 || axis.StaticAxisIndex() >= (int)inputShape2.Rank())
+                                    InvalidArgument("Function '%S': Gather axis '%S' is not a static axis of the reference of shape '%S'.",
+                                                    AsString().c_str(), axis.AsString().c_str(), inputShape2.AsString().c_str());
+                                axisIndex = axis.StaticAxisIndex();
+                            }
+                            // the indexed axis of the reference is replaced by the shape of the indices
+                            outputShape = inputShape2.SubShape(0, axisIndex);
                             outputShape = outputShape.AppendShape(inputShape1);
+                            outputShape = outputShape.AppendShape(inputShape2.SubShape(axisIndex + 1));
                             break;
                         }
                         case PrimitiveOpType::ToBatch:
@@ -1039,6 +1048,31 @@ namespace CNTK
                             outputShape = BatchNormalizationOutputShape(m_inputs, spatial, true);
                             break;
                         }
+                        case PrimitiveOpType::LayerNormalization:
+                        {
+                            assert(m_inputs.size() == 3);
+                            outputShape = LayerNormalizationOutputShape(m_inputs, true);
+                            break;
+                        }
+                        case PrimitiveOpType::QuantizedLookupTable:
+                        {
+                            assert(m_inputs.size() == 1);
+                            // the table is [embeddingDim x tableSize]
+                            auto tableShape = m_attributes[PrimitiveFunctionAttribute::AttributeNameQuantizedTable].Value<NDArrayView>().Shape();
+                            auto inputShape = m_inputs[0].Shape();
+                            if (m_attributes[PrimitiveFunctionAttribute::AttributeNameIndexInput].Value<bool>())
+                                outputShape = tableShape.SubShape(0, 1).AppendShape(inputShape);
+                            else if (inputShape.HasUnboundDimension())
+                                outputShape = { NDShape::InferredDimension };
+                            else
+                            {
+                                if (inputShape.TotalSize() % tableShape[1] != 0)
+                                    InvalidArgument("Function '%S': The input shape '%S' is not a multiple of the table size %d.",
+                                                    AsString().c_str(), inputShape.AsString().c_str(), (int)tableShape[1]);
+                                outputShape = { tableShape[0] * (inputShape.TotalSize() / tableShape[1]) };
+                            }
+                            break;
+                        }
                         case PrimitiveOpType::GatherPacked:
                         {
                             bool sourceHasDynamicAxis = !m_inputs[0].DynamicAxes().empty();
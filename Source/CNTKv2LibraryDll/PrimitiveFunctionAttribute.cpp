@@ -123,6 +123,9 @@ namespace CNTK
     /*static*/ const std::wstring PrimitiveFunctionAttribute::AttributeNameCustomOp = L"customOp";
     /*static*/ const std::wstring PrimitiveFunctionAttribute::AttributeNameTransposeLeftOperand = L"transA";
     /*static*/ const std::wstring PrimitiveFunctionAttribute::AttributeNameTransposeRightOperand = L"transB";
+    /*static*/ const std::wstring PrimitiveFunctionAttribute::AttributeNameQuantizedTable = L"quantizedTable";
+    /*static*/ const std::wstring PrimitiveFunctionAttribute::AttributeNameQuantizedTableScalesAndOffsets = L"quantizedTableScalesAndOffsets";
+    /*static*/ const std::wstring PrimitiveFunctionAttribute::AttributeNameIndexInput = L"indexInput";
 
     /*static*/ const std::vector<std::wstring> PrimitiveFunctionAttribute::s_rngStateAttributes =
                    { PrimitiveFunctionAttribute::AttributeNameRngSeed,
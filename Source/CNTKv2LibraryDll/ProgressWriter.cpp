@@ -6,30 +6,110 @@
 #include "stdafx.h"
 #include "CNTKLibrary.h"
 #include "Utils.h"
+#include "DataTransferer.h"
+#include "CUDAPageLockedMemAllocator.h"
 
 #include <chrono>
+#include <functional>
 
 namespace CNTK
 {
+    using namespace Microsoft::MSR::CNTK;
+
+    // Reads an accumulated scalar back from the device without blocking the host. The value is snapshot on the compute
+    // stream, and the snapshot is copied into page-locked memory on a separate stream, so the host only waits for the
+    // copy when it needs the result, by which time the next training update has been queued.
+    // Values in CPU memory, and of other data types than float and double, are read at once.
+    class AsyncScalarReader
+    {
+    public:
+        AsyncScalarReader() : m_value(0), m_isPending(false), m_pinnedBuffer(nullptr, [](void*) {}) {}
+
+        void Start(const ValuePtr& value)
+        {
+            m_isPending = false;
+            const auto& data = value->Data();
+            auto device = data->Device();
+            auto dataType = data->GetDataType();
+            if (device.Type() == DeviceKind::CPU || (dataType != DataType::Float && dataType != DataType::Double))
+            {
+                m_value = value->AsScalar<double>();
+                return;
+            }
+
+            if (!m_snapshot || m_snapshot->Device() != device || m_snapshot->GetDataType() != dataType || m_snapshot->Shape() != data->Shape())
+            {
+                int deviceId = (int)device.Id();
+                m_snapshot = MakeSharedObject<NDArrayView>(dataType, data->Shape(), device);
+                m_pinnedBuffer = std::unique_ptr<void, std::function<void(void*)>>(
+                    CUDAPageLockedMemAllocator::Malloc(DataTypeSize(dataType) * data->Shape().TotalSize(), deviceId),
+                    [deviceId](void* p) { CUDAPageLockedMemAllocator::Free(p, deviceId); });
+                m_transferer = CreatePrefetchDataTransferer(deviceId);
+            }
+
+            m_snapshot->CopyFrom(*data);
+            m_transferer->RecordComputeStreamSyncPoint();
+            m_transferer->WaitForSyncPointOnFetchStreamAsync();
+            if (dataType == DataType::Float)
+                m_transferer->CopyGPUToCPUAsync(m_snapshot->DataBuffer<float>(), m_snapshot->Shape().TotalSize(), sizeof(float), m_pinnedBuffer.get());
+            else
+                m_transferer->CopyGPUToCPUAsync(m_snapshot->DataBuffer<double>(), m_snapshot->Shape().TotalSize(), sizeof(double), m_pinnedBuffer.get());
+            m_transferer->RecordGPUToCPUCopy();
+            m_isPending = true;
+        }
+
+        bool IsPending() const
+        {
+            return m_isPending;
+        }
+
+        double Get()
+        {
+            if (m_isPending)
+            {
+                m_transferer->WaitForCopyGPUToCPU();
+                if (m_snapshot->GetDataType() == DataType::Float)
+                    m_value = *static_cast<const float*>(m_pinnedBuffer.get());
+                else
+                    m_value = *static_cast<const double*>(m_pinnedBuffer.get());
+                m_isPending = false;
+            }
+            return m_value;
+        }
+
+    private:
+        double m_value;
+        bool m_isPending;
+        NDArrayViewPtr m_snapshot;
+        std::unique_ptr<void, std::function<void(void*)>> m_pinnedBuffer;
+        DataTransfererPtr m_transferer;
+    };
+
     class ProgressWriter::Impl
     {
     public:
+        typedef std::function<void(const std::pair<size_t, size_t>&, const std::pair<size_t, size_t>&,
+                                   const std::pair<double, double>&, const std::pair<double, double>&)> OnWriteUpdateFunc;
+
         Impl(size_t updateWriteFrequency, size_t firstUpdatesToWrite)
             : m_frequency(updateWriteFrequency), m_firstN(firstUpdatesToWrite),
-            m_totalUpdates(0), m_totalSummaries(0)
+            m_totalUpdates(0), m_totalSummaries(0),
+            m_hasPendingUpdate(false), m_pendingHasLoss(false), m_pendingHasMetric(false)
         {
             Reset();
         }
 
-        template<typename OnWriteUpdateFunc>
         void Update(size_t samples, const ValuePtr& accumulatedLoss, const ValuePtr& accumulatedMetric,
-                    OnWriteUpdateFunc callback)
+                    const OnWriteUpdateFunc& callback)
         {
             if (samples == 0)
             {
                 return;
             }
 
+            // The write started at the previous update has had a whole update to complete.
+            WritePendingUpdate();
+
             m_samples.second += samples;
             m_updates.second++;
             m_totalUpdates++;
@@ -39,22 +119,31 @@ namespace CNTK
                 // Time to output the accumulated updates.
                 // Note that we take snapshot of the accumulated loss/metric only when we want to write.
                 // We do it this way on purpose, since accumulated loss/metric may be stored on a GPU
-                // and we want to minimize the number of GPU->CPU data transfers.
+                // and we want to minimize the number of GPU->CPU data transfers. A snapshot on a GPU
+                // is read back asynchronously, and written at the next update or summary, so the host
+                // does not wait for the device.
                 if (accumulatedLoss)
                 {
-                    m_loss.second = accumulatedLoss->AsScalar<double>();
+                    m_lossReader.Start(accumulatedLoss);
                 }
 
                 if (accumulatedMetric)
                 {
-                    m_metric.second = accumulatedMetric->AsScalar<double>();
+                    m_metricReader.Start(accumulatedMetric);
                 }
 
-                callback(m_samples, m_updates, m_loss, m_metric);
+                m_pendingSamples = m_samples;
+                m_pendingUpdates = m_updates;
+                m_pendingCallback = callback;
+                m_pendingHasLoss = accumulatedLoss != nullptr;
+                m_pendingHasMetric = accumulatedMetric != nullptr;
+                m_hasPendingUpdate = true;
+                if (!m_lossReader.IsPending() && !m_metricReader.IsPending())
+                {
+                    WritePendingUpdate();
+                }
 
                 // Reset the window.
-                m_loss.first = m_loss.second;
-                m_metric.first = m_metric.second;
                 m_samples.first = m_samples.second;
                 m_updates.first = m_updates.second;
             }
@@ -64,6 +153,8 @@ namespace CNTK
         void WriteSummary(const ValuePtr& accumulatedLoss, const ValuePtr& accumulatedMetric,
                           OnWriteSummaryFunc callback)
         {
+            WritePendingUpdate();
+
             if (accumulatedLoss && m_samples.second > 0)
             {
                 m_loss.second = accumulatedLoss->AsScalar<double>();
@@ -89,6 +180,31 @@ namespace CNTK
         }
 
     private:
+        // Writes the update whose loss/metric are being read back, if any.
+        void WritePendingUpdate()
+        {
+            if (!m_hasPendingUpdate)
+            {
+                return;
+            }
+
+            m_hasPendingUpdate = false;
+            if (m_pendingHasLoss)
+            {
+                m_loss.second = m_lossReader.Get();
+            }
+
+            if (m_pendingHasMetric)
+            {
+                m_metric.second = m_metricReader.Get();
+            }
+
+            m_pendingCallback(m_pendingSamples, m_pendingUpdates, m_loss, m_metric);
+
+            m_loss.first = m_loss.second;
+            m_metric.first = m_metric.second;
+        }
+
         bool ShouldWriteUpdate(size_t update) const
         {
             if (m_frequency == 0)
@@ -123,6 +239,16 @@ namespace CNTK
         size_t m_totalUpdates;
         size_t m_totalSummaries;
         std::chrono::time_point<std::chrono::high_resolution_clock> m_lastResetTime;
+
+        // The update written once its loss/metric have been read back.
+        AsyncScalarReader m_lossReader;
+        AsyncScalarReader m_metricReader;
+        bool m_hasPendingUpdate;
+        bool m_pendingHasLoss;
+        bool m_pendingHasMetric;
+        std::pair<size_t, size_t> m_pendingSamples;
+        std::pair<size_t, size_t> m_pendingUpdates;
+        OnWriteUpdateFunc m_pendingCallback;
     };
 
     ProgressWriter::ProgressWriter(size_t trainingUpdateWriteFrequency, size_t trainingFirstUpdatesToWrite,
@@ -6,11 +6,16 @@
 #include "stdafx.h"
 #include "CNTKLibrary.h"
 #include "Utils.h"
+#include "Serialization.h"
+#include "MemoryMappedFile.h"
+#include "fileutil.h"
 #include <istream>
 #include <ostream>
 #include <string>
 #include <vector>
 #include <limits>
+#include <mutex>
+#include <sys/stat.h>
 
 #ifdef _MSC_VER
 #include <io.h>
@@ -31,6 +36,28 @@ namespace CNTK
     static const uint32 MAGIC_NUMBER = 0x636e746bU;
     static const uint32 BLOCK_SIZE = 8 << 10; // 8Kb;
 
+    // A model file of the memory-mapped format starts with a header, followed by the metadata protobuf: a Dictionary
+    // whose NDArrayViews carry, in place of their values, the 8-byte offset of their data within the data section.
+    // The data section starts at a page boundary and holds the raw (native endian) values of the NDArrayViews,
+    // each aligned to MAPPED_TENSOR_ALIGNMENT bytes, so that they can be used directly from a mapping of the file.
+    static const uint32 MAPPED_MAGIC_NUMBER = 0x6d746e63U; // "cntm"
+    static const uint32 MAPPED_FORMAT_VERSION = 1;
+    static const size_t MAPPED_DATA_ALIGNMENT = 4096;
+    static const size_t MAPPED_TENSOR_ALIGNMENT = 64;
+
+    struct MappedModelHeader
+    {
+        uint32 magic;
+        uint32 version;
+        uint64 metadataSize;
+        uint64 dataOffset;
+    };
+
+    static inline size_t AlignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
     static void SetUTF8Locale()
     {
 #ifndef _MSC_VER
@@ -124,6 +151,10 @@ namespace CNTK
         friend class Dictionary;
         friend class DictionaryValue;
 
+        friend void SaveMemoryMapped(const Dictionary& dictionary, const std::wstring& filePath);
+        friend Dictionary LoadMemoryMapped(const std::wstring& filePath);
+        friend void PrefetchMemoryMappedData(const NDArrayView& view);
+
         Serializer(const Dictionary& dict);
         Serializer(const DictionaryValue& dict);
 
@@ -158,6 +189,10 @@ namespace CNTK
 
         bool ReadNDArrayViewData(io::ZeroCopyInputStream& input);
 
+        void WriteMapped(const std::wstring& filename);
+        bool ReadMapped(const MemoryMappedFilePtr& file, Dictionary& dict);
+        NDArrayView* CreateFromMapping(const proto::NDArrayView& src, DataType dataType, StorageFormat storageFormat, const NDShape& shape);
+
         size_t GetTotalByteSize()
         {
             return m_byteSize + m_proto->ByteSizeLong();
@@ -336,6 +371,25 @@ namespace CNTK
             }
         }
 
+        static const void* RawDataBuffer(const NDArrayView& src)
+        {
+            switch (src.GetDataType())
+            {
+            case DataType::Float:
+                return src.DataBuffer<float>();
+            case DataType::Double:
+                return src.DataBuffer<double>();
+            case DataType::Float16:
+                return src.DataBuffer<float16>();
+            case DataType::Int8:
+                return src.DataBuffer<int8_t>();
+            case DataType::Int16:
+                return src.DataBuffer<int16_t>();
+            default:
+                LogicError("Unsupported DataType %s", DataTypeName(src.GetDataType()));
+            }
+        }
+
         static void CopyInt8Data(const std::string& src, NDArrayView* dst)
         {
             auto size = src.length();
@@ -349,6 +403,10 @@ namespace CNTK
         Message* m_proto;
         std::vector<std::pair<NDArrayView*, proto::NDArrayView*>> m_arrayViews;
         size_t m_byteSize {0};
+
+        // Set while reading a file of the memory-mapped format.
+        const MemoryMappedFile* m_mappedFile {nullptr};
+        size_t m_mappedDataOffset {0};
     };
 
 
@@ -536,6 +594,9 @@ namespace CNTK
         std::unique_ptr<NDShape> shape(CreateFromProto(src.shape()));
         auto dataType = FromProtoType(src.data_type());
         auto storageFormat = FromProtoType(src.storage_format());
+        if (m_mappedFile != nullptr)
+            return CreateFromMapping(src, dataType, storageFormat, *shape);
+
         NDArrayView* dst = new NDArrayView(dataType, storageFormat, *shape, DeviceDescriptor::CPUDevice());
 
         if (dataType == DataType::Float)
@@ -576,6 +637,24 @@ namespace CNTK
         return dst;
     }
 
+    NDArrayView* Serializer::CreateFromMapping(const proto::NDArrayView& src, DataType dataType, StorageFormat storageFormat, const NDShape& shape)
+    {
+        const auto& reference = src.bytes_value().value();
+        uint64 offset = 0;
+        if (storageFormat != StorageFormat::Dense || reference.size() != sizeof(offset))
+            RuntimeError("NDArrayView of the memory-mapped model file does not reference its data.");
+        memcpy(&offset, reference.data(), sizeof(offset));
+
+        auto dataSize = m_mappedFile->Size() - m_mappedDataOffset;
+        auto byteSize = shape.TotalSize() * DataTypeSize(dataType);
+        if (offset % MAPPED_TENSOR_ALIGNMENT != 0 || offset > dataSize || byteSize > dataSize - offset)
+            RuntimeError("NDArrayView data (offset %zu, %zu bytes) lies outside of the memory-mapped model file.", (size_t)offset, byteSize);
+
+        // The view is read-only, so the pages of the mapping are shared with every other process that maps this file.
+        void* data = const_cast<char*>(m_mappedFile->Data() + m_mappedDataOffset + offset);
+        return new NDArrayView(dataType, shape, data, byteSize, DeviceDescriptor::CPUDevice(), /*readOnly =*/ true);
+    }
+
     proto::Vector* Serializer::CreateProto(const std::vector<DictionaryValue>& src, Arena* arena)
     {
         proto::Vector* dst = (arena != nullptr) ? 
@@ -778,6 +857,92 @@ namespace CNTK
 #endif
     }
 
+    void Serializer::WriteMapped(const std::wstring& filename)
+    {
+        // Replace the values of the NDArrayViews with the offsets of their data. The size of the metadata
+        // does not depend on the offsets, as all of them are stored in 8 bytes.
+        uint64 offset = 0;
+        for (auto& pair : m_arrayViews)
+        {
+            const auto& src = *(pair.first);
+            if (src.GetStorageFormat() != StorageFormat::Dense)
+                InvalidArgument("Only dense NDArrayViews can be saved in the memory-mapped format.");
+
+            offset = AlignUp(offset, MAPPED_TENSOR_ALIGNMENT);
+            pair.second->mutable_bytes_value()->set_value(&offset, sizeof(offset));
+            offset += src.Shape().TotalSize() * DataTypeSize(src.GetDataType());
+        }
+
+        std::string metadata;
+        if (!m_proto->SerializeToString(&metadata))
+            RuntimeError("Failed to serialize the metadata of the memory-mapped model file (%ls).", filename.c_str());
+
+        MappedModelHeader header;
+        header.magic = MAPPED_MAGIC_NUMBER;
+        header.version = MAPPED_FORMAT_VERSION;
+        header.metadataSize = metadata.size();
+        header.dataOffset = AlignUp(sizeof(header) + metadata.size(), MAPPED_DATA_ALIGNMENT);
+
+        // Write to a temporary file that then replaces the target, so that processes that still
+        // have the previous version of the file mapped keep seeing consistent contents.
+        auto temporaryFilename = filename + L".tmp";
+        {
+            auto stream = GetFstream(temporaryFilename, false);
+            std::vector<char> padding(MAPPED_DATA_ALIGNMENT, 0);
+
+            stream->write(reinterpret_cast<const char*>(&header), sizeof(header));
+            stream->write(metadata.data(), metadata.size());
+            stream->write(padding.data(), header.dataOffset - sizeof(header) - metadata.size());
+
+            size_t position = 0;
+            for (auto& pair : m_arrayViews)
+            {
+                NDArrayViewPtr cpuView;
+                const NDArrayView* src = pair.first;
+                if (src->Device() != DeviceDescriptor::CPUDevice())
+                {
+                    cpuView = src->DeepClone(DeviceDescriptor::CPUDevice(), /*readOnly =*/ true);
+                    src = cpuView.get();
+                }
+
+                auto aligned = AlignUp(position, MAPPED_TENSOR_ALIGNMENT);
+                stream->write(padding.data(), aligned - position);
+                auto byteSize = src->Shape().TotalSize() * DataTypeSize(src->GetDataType());
+                stream->write(static_cast<const char*>(RawDataBuffer(*src)), byteSize);
+                position = aligned + byteSize;
+            }
+
+            stream->flush();
+            if (stream->fail())
+                RuntimeError("Failed to write the memory-mapped model file (%ls).", temporaryFilename.c_str());
+        }
+        renameOrDie(temporaryFilename, filename);
+    }
+
+    bool Serializer::ReadMapped(const MemoryMappedFilePtr& file, Dictionary& dict)
+    {
+        MappedModelHeader header;
+        if (file->Size() < sizeof(header))
+            return false;
+        memcpy(&header, file->Data(), sizeof(header));
+        if (header.magic != MAPPED_MAGIC_NUMBER || header.version != MAPPED_FORMAT_VERSION ||
+            header.metadataSize > INT_MAX || header.dataOffset < sizeof(header) + header.metadataSize || header.dataOffset > file->Size())
+            return false;
+
+        m_mappedFile = file.get();
+        m_mappedDataOffset = header.dataOffset;
+        m_proto = Arena::CreateMessage<proto::Dictionary>(&m_arena);
+
+        io::ArrayInputStream input(file->Data() + sizeof(header), (int)header.metadataSize);
+        io::CodedInputStream codedInput(&input);
+        codedInput.SetTotalBytesLimit(INT_MAX, INT_MAX);
+        if (!m_proto->ParseFromCodedStream(&codedInput) || !codedInput.ConsumedEntireMessage())
+            return false;
+
+        Copy(*dynamic_cast<proto::Dictionary*>(m_proto), dict);
+        return true;
+    }
+
     bool ParseMessage(io::ZeroCopyInputStream& input, Message& msg)
     {
         uint32 prefix = 0, limit = INT_MAX;;
@@ -925,4 +1090,68 @@ namespace CNTK
             RuntimeError("Failed to parse DictionaryValue from file (%ls).", filename.c_str());
         return dictionaryValue;
     }
+
+    // The NDArrayViews created over a mapping do not own it, so the mappings of the memory-mapped model files are
+    // kept until the process exits. Loading the same (unmodified) file again reuses its mapping.
+    static std::mutex s_mappedModelFilesMutex;
+    static std::unordered_map<std::wstring, MemoryMappedFilePtr> s_mappedModelFiles;
+
+    static MemoryMappedFilePtr GetMappedModelFile(const std::wstring& filePath)
+    {
+        std::wstring key = filePath;
+#ifdef _MSC_VER
+        struct _stat64 status;
+        if (_wstat64(filePath.c_str(), &status) == 0)
+#else
+        struct stat status;
+        if (stat(wtocharpath(filePath.c_str()).c_str(), &status) == 0)
+#endif
+            key += L"|" + std::to_wstring(status.st_ino) + L"|" + std::to_wstring(status.st_size) + L"|" + std::to_wstring(status.st_mtime);
+
+        std::lock_guard<std::mutex> lock(s_mappedModelFilesMutex);
+        auto& file = s_mappedModelFiles[key];
+        if (!file)
+            file = std::make_shared<MemoryMappedFile>(filePath);
+        return file;
+    }
+
+    void PrefetchMemoryMappedData(const NDArrayView& view)
+    {
+        if (view.Device() != DeviceDescriptor::CPUDevice() || view.GetStorageFormat() != StorageFormat::Dense)
+            return;
+
+        // Pages of the mapping are otherwise read one at a time on first access, as the mapping is set up for random access.
+        auto data = static_cast<const char*>(Serializer::RawDataBuffer(view));
+        auto size = view.Shape().TotalSize() * DataTypeSize(view.GetDataType());
+        std::lock_guard<std::mutex> lock(s_mappedModelFilesMutex);
+        for (const auto& file : s_mappedModelFiles)
+        {
+            if (data >= file.second->Data() && data < file.second->Data() + file.second->Size())
+            {
+                file.second->WillNeed(data - file.second->Data(), size);
+                return;
+            }
+        }
+    }
+
+    bool IsMemoryMappedModel(const std::wstring& filePath)
+    {
+        auto stream = GetFstream(filePath, true);
+        uint32 magic = 0;
+        stream->read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        return stream->gcount() == sizeof(magic) && magic == MAPPED_MAGIC_NUMBER;
+    }
+
+    void SaveMemoryMapped(const Dictionary& dictionary, const std::wstring& filePath)
+    {
+        Serializer(dictionary).WriteMapped(filePath);
+    }
+
+    Dictionary LoadMemoryMapped(const std::wstring& filePath)
+    {
+        Dictionary dictionary;
+        if (!Serializer().ReadMapped(GetMappedModelFile(filePath), dictionary))
+            RuntimeError("Failed to parse memory-mapped model file (%ls).", filePath.c_str());
+        return dictionary;
+    }
 }
@@ -109,4 +109,16 @@ namespace CNTK
 
         return version;
     }
+
+    // The memory-mapped model format: the Dictionary is saved as protobuf without the values of its NDArrayViews,
+    // which follow as an aligned blob. On load, the NDArrayViews are read-only CPU views over a shared read-only
+    // mapping of the file, so loading does not copy the data and processes loading the same file share its pages.
+    bool IsMemoryMappedModel(const std::wstring& filePath);
+
+    void SaveMemoryMapped(const Dictionary& dictionary, const std::wstring& filePath);
+
+    Dictionary LoadMemoryMapped(const std::wstring& filePath);
+
+    // Asks the OS to start reading the pages under the view, if it is a view over a memory-mapped model file.
+    void PrefetchMemoryMappedData(const NDArrayView& view);
 }
@@ -0,0 +1,341 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// SharedParameters.cpp -- Parameters and Constants on a GPU shared by the processes of a host through CUDA IPC
+//
+
+#include "stdafx.h"
+#include "CNTKLibrary.h"
+#include "Utils.h"
+#include "GPUIpcBuffer.h"
+#include "fileutil.h"
+#include <mutex>
+#include <unordered_set>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <errno.h>
+#endif
+
+namespace CNTK
+{
+    using namespace std;
+    using namespace Microsoft::MSR::CNTK;
+
+    // The descriptor published under a path is a Dictionary with the handle of the device buffer of the current version
+    // and the offsets of the values in it by uid. A process that maps a version leaves a lease file next to the
+    // descriptor ("<descriptor>.<version>.<process id>.lease") for as long as it has it mapped, which tells the owner
+    // that it must not free the buffer yet.
+    static const wchar_t* versionKey = L"version";
+    static const wchar_t* ownerProcessIdKey = L"ownerProcessId";
+    static const wchar_t* deviceIdKey = L"deviceId";
+    static const wchar_t* handleKey = L"handle";
+    static const wchar_t* sizeKey = L"size";
+    static const wchar_t* valuesKey = L"values";
+    static const wchar_t* uidKey = L"uid";
+    static const wchar_t* dataTypeKey = L"dataType";
+    static const wchar_t* shapeKey = L"shape";
+    static const wchar_t* offsetKey = L"offset";
+
+    static const size_t sharedValueAlignment = 256;
+
+    // A buffer of one version that this process allocated or mapped, and the views over it that it handed out.
+    // It is freed (or closed) once the views are gone, and for an owner, once no other process leases it.
+    struct SharedParameterBuffer
+    {
+        wstring descriptorPath;
+        size_t version;
+        shared_ptr<GPUIpcBuffer> buffer;
+        vector<weak_ptr<NDArrayView>> views;
+        wstring leasePath; // empty for the owner
+    };
+
+    static mutex s_sharedParameterBuffersMutex;
+    static vector<shared_ptr<SharedParameterBuffer>> s_sharedParameterBuffers;
+    static unordered_set<wstring> s_publishedDescriptors; // by this process
+
+    static bool IsProcessAlive(size_t processId)
+    {
+#ifdef _WIN32
+        HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)processId);
+        if (!process)
+            return GetLastError() == ERROR_ACCESS_DENIED;
+        bool isAlive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+        CloseHandle(process);
+        return isAlive;
+#else
+        return kill((pid_t)processId, 0) == 0 || errno == EPERM;
+#endif
+    }
+
+    static pair<wstring, wstring> SplitPath(const wstring& path)
+    {
+        auto separator = path.find_last_of(L"/\\");
+        if (separator == wstring::npos)
+            return make_pair(wstring(L"."), path);
+        return make_pair(path.substr(0, separator), path.substr(separator + 1));
+    }
+
+    static wstring LeasePath(const wstring& descriptorPath, size_t version, size_t processId)
+    {
+        return descriptorPath + L"." + to_wstring(version) + L"." + to_wstring(processId) + L".lease";
+    }
+
+    // Whether a process other than this one has the version mapped; removes the leases of processes that died.
+    static bool IsLeasedByOtherProcess(const wstring& descriptorPath, size_t version)
+    {
+        auto directoryAndName = SplitPath(descriptorPath);
+        auto prefix = directoryAndName.second + L"." + to_wstring(version) + L".";
+        const wstring suffix = L".lease";
+        bool isLeased = false;
+        for (const auto& file : msra::files::get_all_files_from_directory(directoryAndName.first))
+        {
+            if (file.size() <= prefix.size() + suffix.size() || file.compare(0, prefix.size(), prefix) != 0 ||
+                file.compare(file.size() - suffix.size(), suffix.size(), suffix) != 0)
+                continue;
+
+            size_t processId = wcstoull(file.substr(prefix.size(), file.size() - prefix.size() - suffix.size()).c_str(), nullptr, 10);
+            if (IsProcessAlive(processId))
+                isLeased = true;
+            else
+                _wunlink((directoryAndName.first + L"/" + file).c_str());
+        }
+        return isLeased;
+    }
+
+    // Call with s_sharedParameterBuffersMutex held.
+    static void ReleaseUnusedSharedParameterBuffers()
+    {
+        auto isUnused = [](const shared_ptr<SharedParameterBuffer>& entry) {
+            if (any_of(entry->views.begin(), entry->views.end(), [](const weak_ptr<NDArrayView>& view) { return !view.expired(); }))
+                return false;
+            // the current version of a descriptor that this process still publishes stays available for mapping
+            bool isOwner = entry->buffer->IsOwner();
+            if (isOwner && (s_publishedDescriptors.find(entry->descriptorPath) != s_publishedDescriptors.end()) &&
+                (Internal::GetSharedParametersVersion(entry->descriptorPath) == entry->version))
+                return false;
+            return !isOwner || !IsLeasedByOtherProcess(entry->descriptorPath, entry->version);
+        };
+
+        for (auto entry = s_sharedParameterBuffers.begin(); entry != s_sharedParameterBuffers.end();)
+        {
+            if (isUnused(*entry))
+            {
+                if (!(*entry)->leasePath.empty())
+                    _wunlink((*entry)->leasePath.c_str());
+                entry = s_sharedParameterBuffers.erase(entry);
+            }
+            else
+                ++entry;
+        }
+    }
+
+    static vector<Variable> ParametersAndConstants(const FunctionPtr& model)
+    {
+        vector<Variable> variables;
+        for (const auto& parameter : model->Parameters())
+            variables.push_back(parameter);
+        for (const auto& constant : model->Constants())
+            variables.push_back(constant);
+        return variables;
+    }
+
+    static bool IsShareable(const Variable& variable)
+    {
+        auto dataType = variable.GetDataType();
+        return !variable.IsSparse() && (dataType == DataType::Float || dataType == DataType::Double || dataType == DataType::Float16);
+    }
+
+    static wstring HandleToString(const GPUIpcHandle& handle)
+    {
+        static const wchar_t* digits = L"0123456789abcdef";
+        wstring hex;
+        for (auto byte : handle.m_bytes)
+        {
+            hex += digits[((unsigned char)byte) >> 4];
+            hex += digits[((unsigned char)byte) & 15];
+        }
+        return hex;
+    }
+
+    static GPUIpcHandle HandleFromString(const wstring& hex)
+    {
+        if (hex.size() != 2 * GPUIpcHandle::Size)
+            RuntimeError("The CUDA IPC handle of the shared parameters is invalid.");
+        auto digit = [](wchar_t c) { return (c >= L'a') ? (c - L'a' + 10) : (c - L'0'); };
+        GPUIpcHandle handle;
+        for (size_t i = 0; i < GPUIpcHandle::Size; i++)
+            handle.m_bytes[i] = (char)((digit(hex[2 * i]) << 4) | digit(hex[2 * i + 1]));
+        return handle;
+    }
+
+    namespace Internal
+    {
+        size_t GetSharedParametersVersion(const wstring& descriptorPath)
+        {
+            if (!fexists(descriptorPath))
+                return 0;
+            return Dictionary::Load(descriptorPath)[versionKey].Value<size_t>();
+        }
+
+        size_t PublishSharedParameters(const FunctionPtr& model, const wstring& descriptorPath)
+        {
+            lock_guard<mutex> lock(s_sharedParameterBuffersMutex);
+
+            // lay the values out in one buffer
+            vector<pair<Variable, size_t>> variablesAndOffsets;
+            size_t size = 0;
+            DeviceDescriptor device = DeviceDescriptor::CPUDevice();
+            for (const auto& variable : ParametersAndConstants(model))
+            {
+                if (!IsShareable(variable))
+                    continue;
+                auto valueDevice = variable.IsParameter() ? Parameter(variable).Value()->Device() : Constant(variable).Value()->Device();
+                if (valueDevice.Type() != DeviceKind::GPU)
+                    InvalidArgument("PublishSharedParameters: '%S' is not on a GPU; only GPU values can be shared.", variable.AsString().c_str());
+                if (!variablesAndOffsets.empty() && (valueDevice != device))
+                    InvalidArgument("PublishSharedParameters: The values of the model are on more than one device.");
+                device = valueDevice;
+
+                size = (size + sharedValueAlignment - 1) / sharedValueAlignment * sharedValueAlignment;
+                variablesAndOffsets.push_back(make_pair(variable, size));
+                size += variable.Shape().TotalSize() * DataTypeSize(variable.GetDataType());
+            }
+            if (variablesAndOffsets.empty())
+                InvalidArgument("PublishSharedParameters: The model has no dense Parameters or Constants to share.");
+
+            // move the values into the buffer, so that the owner does not keep a second copy
+            auto entry = make_shared<SharedParameterBuffer>();
+            entry->descriptorPath = descriptorPath;
+            entry->version = GetSharedParametersVersion(descriptorPath) + 1;
+            entry->buffer = GPUIpcBuffer::Allocate(AsCNTKImplDeviceId(device), size);
+
+            vector<DictionaryValue> values;
+            for (const auto& variableAndOffset : variablesAndOffsets)
+            {
+                const auto& variable = variableAndOffset.first;
+                auto data = static_cast<char*>(entry->buffer->Data()) + variableAndOffset.second;
+                auto byteSize = variable.Shape().TotalSize() * DataTypeSize(variable.GetDataType());
+                auto view = MakeSharedObject<NDArrayView>(variable.GetDataType(), variable.Shape(), data, byteSize, device, /*readOnly =*/ false);
+                view->CopyFrom(*(variable.IsParameter() ? Parameter(variable).Value() : Constant(variable).Value()));
+                Utils::SetValueStorage(variable, view);
+                entry->views.push_back(view);
+
+                Dictionary value;
+                value[uidKey] = variable.Uid();
+                value[dataTypeKey] = (size_t)variable.GetDataType();
+                value[shapeKey] = variable.Shape();
+                value[offsetKey] = variableAndOffset.second;
+                values.push_back(value);
+            }
+
+            Dictionary descriptor;
+            descriptor[versionKey] = entry->version;
+            descriptor[ownerProcessIdKey] = (size_t)GetCurrentProcessId();
+            descriptor[deviceIdKey] = (size_t)device.Id();
+            descriptor[handleKey] = HandleToString(entry->buffer->GetHandle());
+            descriptor[sizeKey] = size;
+            descriptor[valuesKey] = values;
+
+            // replace the previous version at once, so that readers see either one or the other
+            auto temporaryPath = descriptorPath + L".tmp";
+            descriptor.Save(temporaryPath);
+            renameOrDie(temporaryPath, descriptorPath);
+
+            s_sharedParameterBuffers.push_back(entry);
+            s_publishedDescriptors.insert(descriptorPath);
+            ReleaseUnusedSharedParameterBuffers();
+            return entry->version;
+        }
+
+        size_t MapSharedParameters(const FunctionPtr& model, const wstring& descriptorPath, const DeviceDescriptor& device)
+        {
+            if (device.Type() != DeviceKind::GPU)
+                InvalidArgument("MapSharedParameters: Shared parameters can only be mapped on a GPU.");
+
+            lock_guard<mutex> lock(s_sharedParameterBuffersMutex);
+            ReleaseUnusedSharedParameterBuffers();
+
+            if (!fexists(descriptorPath))
+                RuntimeError("MapSharedParameters: No parameters are published under '%S'.", descriptorPath.c_str());
+            auto descriptor = Dictionary::Load(descriptorPath);
+            auto version = descriptor[versionKey].Value<size_t>();
+            auto ownerProcessId = descriptor[ownerProcessIdKey].Value<size_t>();
+            auto size = descriptor[sizeKey].Value<size_t>();
+
+            // a version that this process already has (e.g. it is the owner) is not mapped again
+            shared_ptr<SharedParameterBuffer> entry;
+            for (const auto& existing : s_sharedParameterBuffers)
+            {
+                if (existing->descriptorPath == descriptorPath && existing->version == version && existing->buffer->GetDeviceId() == AsCNTKImplDeviceId(device))
+                    entry = existing;
+            }
+            if (!entry)
+            {
+                if (ownerProcessId == (size_t)GetCurrentProcessId())
+                    RuntimeError("MapSharedParameters: Version %zu of '%S' was published by this process for another device.", version, descriptorPath.c_str());
+
+                entry = make_shared<SharedParameterBuffer>();
+                entry->descriptorPath = descriptorPath;
+                entry->version = version;
+                // lease the version before mapping it, so that the owner does not free it in between
+                entry->leasePath = LeasePath(descriptorPath, version, GetCurrentProcessId());
+                {
+                    auto lease = GetFstream(entry->leasePath, /*readOnly =*/ false);
+                    *lease << ownerProcessId;
+                }
+                if (GetSharedParametersVersion(descriptorPath) != version)
+                {
+                    _wunlink(entry->leasePath.c_str());
+                    RuntimeError("MapSharedParameters: The parameters published under '%S' were updated while mapping them; try again.", descriptorPath.c_str());
+                }
+                try
+                {
+                    entry->buffer = GPUIpcBuffer::Open(AsCNTKImplDeviceId(device), HandleFromString(descriptor[handleKey].Value<wstring>()), size);
+                }
+                catch (...)
+                {
+                    _wunlink(entry->leasePath.c_str());
+                    throw;
+                }
+                s_sharedParameterBuffers.push_back(entry);
+            }
+
+            unordered_map<wstring, const Dictionary*> valuesByUid;
+            const auto& values = descriptor[valuesKey].Value<vector<DictionaryValue>>();
+            for (const auto& value : values)
+                valuesByUid[value.Value<Dictionary>()[uidKey].Value<wstring>()] = &value.Value<Dictionary>();
+
+            size_t numMapped = 0;
+            for (const auto& variable : ParametersAndConstants(model))
+            {
+                auto value = valuesByUid.find(variable.Uid());
+                if (value == valuesByUid.end() || !IsShareable(variable) ||
+                    (*value->second)[dataTypeKey].Value<size_t>() != (size_t)variable.GetDataType() ||
+                    (*value->second)[shapeKey].Value<NDShape>() != variable.Shape())
+                    continue;
+
+                auto byteSize = variable.Shape().TotalSize() * DataTypeSize(variable.GetDataType());
+                auto offset = (*value->second)[offsetKey].Value<size_t>();
+                if (offset + byteSize > size)
+                    RuntimeError("MapSharedParameters: The value of '%S' lies outside of the shared buffer.", variable.AsString().c_str());
+
+                auto data = static_cast<char*>(entry->buffer->Data()) + offset;
+                auto view = MakeSharedObject<NDArrayView>(variable.GetDataType(), variable.Shape(), data, byteSize, device, /*readOnly =*/ true);
+                Utils::SetValueStorage(variable, view);
+                entry->views.push_back(view);
+                numMapped++;
+            }
+            return numMapped;
+        }
+
+        void ReleaseSharedParameters(const wstring& descriptorPath)
+        {
+            lock_guard<mutex> lock(s_sharedParameterBuffersMutex);
+            if (s_publishedDescriptors.erase(descriptorPath) > 0)
+                _wunlink(descriptorPath.c_str());
+            ReleaseUnusedSharedParameterBuffers();
+        }
+    }
+}
@@ -0,0 +1,244 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// StreamingEvaluator.cpp -- evaluates recurrent models chunk by chunk, keeping the state of each stream on the device
+//
+
+#include "stdafx.h"
+#include "CNTKLibrary.h"
+#include "CompositeFunction.h"
+#include "Utils.h"
+
+namespace CNTK
+{
+    using namespace std;
+    using namespace Microsoft::MSR::CNTK;
+
+    class StreamContextImpl final : public StreamContext
+    {
+    public:
+        explicit StreamContextImpl(const StreamingEvaluator* owner) : m_owner(owner), m_numFrames(0) {}
+
+        size_t NumFrames() const override
+        {
+            return m_numFrames;
+        }
+
+        void Reset() override
+        {
+            m_numFrames = 0;
+            m_states.clear();
+        }
+
+        const StreamingEvaluator* const m_owner;
+        size_t m_numFrames;
+        map<wstring, NodeStatePtr> m_states; // what each stateful node of the network carries over, by node name
+    };
+
+    class StreamingEvaluatorImpl final : public StreamingEvaluator
+    {
+    public:
+        StreamingEvaluatorImpl(const FunctionPtr& model, const DeviceDescriptor& device)
+            : m_model(model), m_device(device)
+        {
+            if (!m_model)
+                InvalidArgument("StreamingEvaluator: The model is not allowed to be null.");
+
+            for (const auto& argument : m_model->Arguments())
+            {
+                if (argument.DynamicAxes().size() < 2)
+                    InvalidArgument("StreamingEvaluator: Argument '%S' has no sequence axis, so it cannot be fed chunk by chunk.", argument.AsString().c_str());
+            }
+
+            // Our own network, so that the state we implant does not interfere with evaluations of 'model' itself.
+            // Cloning keeps the order of the arguments and outputs.
+            m_clone = AsComposite(m_model)->Clone(ParameterCloningMethod::Share);
+            m_composite = dynamic_cast<CompositeFunction*>(m_clone.get());
+            if (!m_composite)
+                LogicError("StreamingEvaluator: The clone of the model is not a composite Function.");
+
+            Map(m_model->Arguments(), m_clone->Arguments());
+            Map(m_model->Outputs(), m_clone->Outputs());
+        }
+
+        StreamContextPtr CreateStream() override
+        {
+            return MakeSharedObject<StreamContextImpl>(this);
+        }
+
+        void Evaluate(const vector<StreamContextPtr>& streams,
+                      const vector<unordered_map<Variable, ValuePtr>>& chunks,
+                      vector<unordered_map<Variable, ValuePtr>>& outputs) override
+        {
+            if (streams.empty())
+                InvalidArgument("StreamingEvaluator: At least one stream must be evaluated.");
+            if (chunks.size() != streams.size() || outputs.size() != streams.size())
+                InvalidArgument("StreamingEvaluator: %d streams are evaluated with %d chunks and %d maps of outputs.", (int)streams.size(), (int)chunks.size(), (int)outputs.size());
+
+            vector<StreamContextImpl*> contexts;
+            for (const auto& stream : streams)
+            {
+                auto context = dynamic_cast<StreamContextImpl*>(stream.get());
+                if (!context || context->m_owner != this)
+                    InvalidArgument("StreamingEvaluator: A stream was not created by this evaluator.");
+                if (find(contexts.begin(), contexts.end(), context) != contexts.end())
+                    InvalidArgument("StreamingEvaluator: A stream is evaluated twice in the same call.");
+                contexts.push_back(context);
+            }
+
+            lock_guard<mutex> lock(m_mutex);
+
+            // one sequence per stream, which continues the sequence of the stream's previous chunk
+            vector<bool> sequenceStartFlags;
+            for (auto context : contexts)
+                sequenceStartFlags.push_back(context->m_numFrames == 0);
+
+            vector<size_t> numFrames;
+            unordered_map<Variable, ValuePtr> arguments;
+            for (const auto& argument : m_model->Arguments())
+            {
+                vector<NDArrayViewPtr> sequences;
+                for (size_t i = 0; i < chunks.size(); i++)
+                {
+                    auto value = chunks[i].find(argument);
+                    if (value == chunks[i].end() || !value->second)
+                        InvalidArgument("StreamingEvaluator: The chunk of stream %d has no value for argument '%S'.", (int)i, argument.AsString().c_str());
+
+                    auto chunkSequences = value->second->UnpackVariableValue(argument, m_device);
+                    if (chunkSequences.size() != 1)
+                        InvalidArgument("StreamingEvaluator: The value of argument '%S' for stream %d holds %d sequences instead of one.",
+                                        argument.AsString().c_str(), (int)i, (int)chunkSequences.size());
+
+                    auto length = chunkSequences.front()->Shape().SubShape(argument.Shape().Rank()).TotalSize();
+                    if (numFrames.size() == i)
+                        numFrames.push_back(length);
+                    else if (numFrames[i] != length)
+                        InvalidArgument("StreamingEvaluator: The values of the arguments for stream %d have different numbers of frames (%d and %d).", (int)i, (int)numFrames[i], (int)length);
+                    sequences.push_back(chunkSequences.front());
+                }
+
+                auto sampleShape = sequences.front()->Shape().SubShape(0, argument.Shape().Rank());
+                arguments[m_variables.at(argument)] = Value::Create(sampleShape, sequences, sequenceStartFlags, m_device, /*readOnly =*/ true, /*createNewCopy =*/ true);
+            }
+
+            // All outputs are evaluated, so that every stateful node of the network steps forward.
+            unordered_map<Variable, ValuePtr> networkOutputs;
+            for (const auto& output : m_clone->Outputs())
+                networkOutputs[output] = nullptr;
+
+            m_composite->m_beforeForwardProp = [&contexts](ComputationNetwork& network)
+            {
+                for (const auto& node : StatefulNodes(network))
+                {
+                    vector<NodeStatePtr> states;
+                    for (auto context : contexts)
+                    {
+                        auto state = context->m_states.find(node.first);
+                        states.push_back(state != context->m_states.end() ? state->second : nullptr);
+                    }
+                    node.second->ImportSequenceStates(states);
+                }
+            };
+            try
+            {
+                m_clone->Evaluate(arguments, networkOutputs, m_device);
+            }
+            catch (...)
+            {
+                m_composite->m_beforeForwardProp = nullptr;
+                throw;
+            }
+            m_composite->m_beforeForwardProp = nullptr;
+
+            // The sequence ids of the minibatch are the indices of the streams.
+            vector<map<wstring, NodeStatePtr>> states(contexts.size());
+            for (const auto& node : StatefulNodes(*m_composite->m_computationNetwork))
+            {
+                for (size_t i = 0; i < contexts.size(); i++)
+                {
+                    auto previous = contexts[i]->m_states.find(node.first);
+                    states[i][node.first] = node.second->ExportSequenceState(i, previous != contexts[i]->m_states.end() ? previous->second : nullptr);
+                }
+            }
+
+            // split the outputs into the streams
+            for (const auto& output : m_model->Outputs())
+            {
+                const auto& networkOutput = m_variables.at(output);
+                vector<NDArrayViewPtr> sequences;
+                for (size_t i = 0; i < outputs.size(); i++)
+                {
+                    auto streamOutput = outputs[i].find(output);
+                    if (streamOutput == outputs[i].end())
+                        continue;
+
+                    if (sequences.empty())
+                    {
+                        sequences = networkOutputs.at(networkOutput)->UnpackVariableValue(networkOutput, m_device);
+                        if (sequences.size() != contexts.size())
+                            RuntimeError("StreamingEvaluator: Output '%S' has %d sequences for %d streams, so it cannot be split into the streams.",
+                                         output.AsString().c_str(), (int)sequences.size(), (int)contexts.size());
+                    }
+
+                    auto value = Pack(output, sequences[i]);
+                    if (streamOutput->second)
+                        streamOutput->second->CopyFrom(*value);
+                    else
+                        streamOutput->second = value;
+                }
+            }
+
+            for (size_t i = 0; i < contexts.size(); i++)
+            {
+                contexts[i]->m_numFrames += numFrames[i];
+                contexts[i]->m_states = move(states[i]);
+            }
+        }
+
+        FunctionPtr Model() const override
+        {
+            return m_model;
+        }
+
+    private:
+        static map<wstring, IStatefulNode*> StatefulNodes(const ComputationNetwork& network)
+        {
+            map<wstring, IStatefulNode*> statefulNodes;
+            for (const auto& node : network.GetNodesWithType<IStatefulNode>())
+                statefulNodes[node->GetName()] = dynamic_cast<IStatefulNode*>(node.get());
+            return statefulNodes;
+        }
+
+        void Map(const vector<Variable>& variables, const vector<Variable>& clonedVariables)
+        {
+            if (variables.size() != clonedVariables.size())
+                LogicError("StreamingEvaluator: The clone of the model has %d arguments or outputs instead of %d.", (int)clonedVariables.size(), (int)variables.size());
+            for (size_t i = 0; i < variables.size(); i++)
+                m_variables[variables[i]] = clonedVariables[i];
+        }
+
+        // Creates the value of one sequence of 'variable'. Without a sequence axis, the samples are the columns.
+        ValuePtr Pack(const Variable& variable, const NDArrayViewPtr& sequence) const
+        {
+            auto sampleShape = sequence->Shape().SubShape(0, variable.Shape().Rank());
+            auto value = Value::Create(sampleShape, { sequence }, {}, m_device, /*readOnly =*/ false, /*createNewCopy =*/ true);
+            if (variable.DynamicAxes().size() < 2)
+                value = MakeSharedObject<Value>(value->Data()->AsShape(sampleShape.AppendShape({ 1 })));
+            return value;
+        }
+
+        const FunctionPtr m_model;
+        const DeviceDescriptor m_device;
+        FunctionPtr m_clone;
+        CompositeFunction* m_composite;
+        unordered_map<Variable, Variable> m_variables; // the arguments and outputs of m_model -> those of m_clone
+
+        mutex m_mutex; // one evaluation at a time
+    };
+
+    StreamingEvaluatorPtr CreateStreamingEvaluator(const FunctionPtr& model, const DeviceDescriptor& device)
+    {
+        return MakeSharedObject<StreamingEvaluatorImpl>(model, device);
+    }
+}
@@ -44,7 +44,18 @@ namespace CNTK
           m_distributed(false),
           m_aggregatedTrainingLossValue(std::make_shared<Accumulator>()),
           m_aggregatedTrainingEvalCriterionValue(),
-          m_prevDistributedTotalNumSamples(0)
+          m_prevDistributedTotalNumSamples(0),
+          m_dynamicLossScaling(false),
+          m_lossScale(1),
+          m_lossScaleGrowthInterval(0),
+          m_numUpdatesWithoutOverflow(0),
+          m_numMinibatchesPerUpdate(1),
+          m_numAccumulatedMinibatches(0),
+          m_numAccumulatedSamples(0),
+          m_accumulatedSweepEnd(false),
+          m_accumulatedTrainingLossValue(std::make_shared<Accumulator>()),
+          m_accumulatedTrainingEvalCriterionValue(std::make_shared<Accumulator>()),
+          m_checkpointedInBackground(false)
     {
         std::vector<Variable> combinedFunctionArgs;
         if (m_model) // model is optional, since it may not be adding any information on top of lossFunction
@@ -166,8 +177,10 @@ namespace CNTK
             TrainDistributedMinibatch(GetInputs(arguments), outputsToFetch, IsAtSweepEnd(arguments), computeDevice);
 
         // TODO: exclude updating progress writers from profiling?
-        UpdateTrainingProgress(m_prevMinibatchNumSamples, m_prevMinibatchAggregateTrainingLossValue,
-                               m_prevMinibatchAggregateEvalCriterionValue, computeDevice);
+        // With gradient accumulation, the progress is updated with all minibatches of an update at once.
+        if (m_numAccumulatedMinibatches == 0)
+            UpdateTrainingProgress(m_prevMinibatchNumSamples, m_prevMinibatchAggregateTrainingLossValue,
+                                   m_prevMinibatchAggregateEvalCriterionValue, computeDevice);
         return result;
     }
 
@@ -188,31 +201,46 @@ namespace CNTK
             TrainDistributedMinibatch(arguments, outputsToFetch, isSweepEndInArguments, computeDevice);
 
         // TODO: exclude updating progress writers from profiling?
-        UpdateTrainingProgress(m_prevMinibatchNumSamples, m_prevMinibatchAggregateTrainingLossValue,
-                               m_prevMinibatchAggregateEvalCriterionValue, computeDevice);
+        // With gradient accumulation, the progress is updated with all minibatches of an update at once.
+        if (m_numAccumulatedMinibatches == 0)
+            UpdateTrainingProgress(m_prevMinibatchNumSamples, m_prevMinibatchAggregateTrainingLossValue,
+                                   m_prevMinibatchAggregateEvalCriterionValue, computeDevice);
         return result;
     }
 
     bool Trainer::TrainLocalMinibatch(const std::unordered_map<Variable, ValuePtr>& arguments, std::unordered_map<Variable, ValuePtr>& outputsToFetch, bool sweepEnd, const DeviceDescriptor& computeDevice /*= DeviceDescriptor::UseDefaultDevice()*/)
     {
-        bool emptyMinibatch = arguments.empty() || (arguments.begin()->second == nullptr);
-        if (emptyMinibatch) // Nothing to train with.
+        std::unordered_map<Parameter, NDArrayViewPtr> gradients;
+        if (m_numMinibatchesPerUpdate > 1)
         {
-            m_prevMinibatchNumSamples = 0;
-            return false;
+            if (!AccumulateMinibatch(arguments, outputsToFetch, sweepEnd, computeDevice))
+                return true; // the update is due after more minibatches
+            sweepEnd = m_accumulatedSweepEnd;
+            if (!EndGradientAccumulation(gradients))
+                return false;
         }
+        else
+        {
+            bool emptyMinibatch = arguments.empty() || (arguments.begin()->second == nullptr);
+            if (emptyMinibatch) // Nothing to train with.
+            {
+                m_prevMinibatchNumSamples = 0;
+                return false;
+            }
 
-        std::unordered_map<Variable, ValuePtr> parameterGradients;
-        ExecuteForwardBackward(arguments, outputsToFetch, computeDevice, parameterGradients);
+            std::unordered_map<Variable, ValuePtr> parameterGradients;
+            ExecuteForwardBackward(arguments, outputsToFetch, computeDevice, parameterGradients);
+            for (const auto& parameter : m_learnerParameters)
+                gradients[parameter] = parameterGradients[parameter]->Data();
+        }
 
 #ifndef  CNTK_UWP
         auto profWeights = Microsoft::MSR::CNTK::ScopeProfile(Microsoft::MSR::CNTK::profilerEvtMainWeights);
 #endif
 
-        std::unordered_map<Parameter, NDArrayViewPtr> gradients;
-        for (const auto& parameter : m_learnerParameters)
-            gradients[parameter] = parameterGradients[parameter]->Data();
-        return m_parameterLearners->Update(gradients, m_prevMinibatchNumSamples, sweepEnd);
+        bool updated = m_parameterLearners->Update(gradients, m_prevMinibatchNumSamples, sweepEnd);
+        AdjustLossScale();
+        return updated;
     }
 
     bool Trainer::TrainDistributedMinibatch(const std::unordered_map<Variable, ValuePtr>& arguments, std::unordered_map<Variable, ValuePtr>& outputsToFetch, bool sweepEnd, const DeviceDescriptor& computeDevice /*= DeviceDescriptor::UseDefaultDevice()*/)
@@ -221,6 +249,16 @@ namespace CNTK
         gradients.reserve(m_learnerParameters.size());
 
         bool emptyMinibatch = arguments.empty() || (arguments.begin()->second == nullptr);
+        bool accumulated = (m_numMinibatchesPerUpdate > 1);
+        if (accumulated)
+        {
+            // all workers make the same number of calls, so they aggregate the gradients of their updates together
+            if (!AccumulateMinibatch(arguments, outputsToFetch, sweepEnd, computeDevice))
+                return true;
+            sweepEnd = m_accumulatedSweepEnd;
+            emptyMinibatch = !EndGradientAccumulation(gradients);
+        }
+
         NDArrayViewPtr trainingLoss = nullptr;
         NDArrayViewPtr evalCriterion = nullptr;
         if (emptyMinibatch)
@@ -233,6 +271,11 @@ namespace CNTK
             trainingLoss = MakeSharedObject<NDArrayView>(0, (m_aggregatedLossFunction ? m_aggregatedLossFunction->Output().GetDataType() : DataType::Float), NDShape{}, computeDevice);
             evalCriterion = MakeSharedObject<NDArrayView>(0, (m_aggregatedEvaluationFunction ? m_aggregatedEvaluationFunction->Output().GetDataType() : DataType::Float), NDShape{}, computeDevice);
         }
+        else if (accumulated)
+        {
+            trainingLoss = m_prevMinibatchAggregateTrainingLossValue->Data();
+            evalCriterion = m_prevMinibatchAggregateEvalCriterionValue->Data();
+        }
         else
         {
             // Get gradients after forward/backward pass.
@@ -251,6 +294,7 @@ namespace CNTK
 
         MinibatchInfo info{ arguments.empty(), sweepEnd, m_prevMinibatchNumSamples, trainingLoss, evalCriterion };
         bool updated = m_parameterLearners->Update(gradients, info);
+        AdjustLossScale();
 
         // Here we update m_prevMinibatchNumSamples with aggregated value in the
         // case of distributed learner.
@@ -277,6 +321,120 @@ namespace CNTK
         return updated;
     }
 
+    void Trainer::SetGradientAccumulation(size_t numMinibatchesPerUpdate)
+    {
+        if (numMinibatchesPerUpdate == 0)
+            InvalidArgument("Trainer::SetGradientAccumulation: The number of minibatches per update must be positive.");
+        if (m_numAccumulatedMinibatches != 0)
+            InvalidArgument("Trainer::SetGradientAccumulation: Cannot be changed while the gradients of %d minibatches are accumulated for the next update.", (int)m_numAccumulatedMinibatches);
+
+        m_numMinibatchesPerUpdate = numMinibatchesPerUpdate;
+    }
+
+    // Runs forward and backward on one of the minibatches of an update with gradient accumulation, adding its gradients to those
+    // of the previous ones in the gradient buffers of the network. Returns true if the update is due with this minibatch.
+    bool Trainer::AccumulateMinibatch(const std::unordered_map<Variable, ValuePtr>& arguments, std::unordered_map<Variable, ValuePtr>& outputsToFetch, bool sweepEnd, const DeviceDescriptor& computeDevice)
+    {
+        bool emptyMinibatch = arguments.empty() || (arguments.begin()->second == nullptr);
+        if (emptyMinibatch)
+            m_prevMinibatchNumSamples = 0;
+        else
+        {
+            auto compositeFunction = std::dynamic_pointer_cast<CompositeFunction>(m_combinedTrainingFunction);
+            if (compositeFunction == nullptr)
+                RuntimeError("Combined training function is not a CompositeFunction.");
+
+            // the first minibatch with samples overwrites the gradients left from the previous update
+            std::unordered_map<Variable, ValuePtr> parameterGradients;
+            compositeFunction->SetAccumulateParameterGradients(m_numAccumulatedSamples > 0);
+            auto resetAccumulation = Microsoft::MSR::CNTK::MakeScopeExit([&compositeFunction]() { compositeFunction->SetAccumulateParameterGradients(false); });
+            ExecuteForwardBackward(arguments, outputsToFetch, computeDevice, parameterGradients);
+            for (const auto& parameter : m_learnerParameters)
+                m_accumulatedGradients[parameter] = parameterGradients[parameter]->Data();
+
+            if (m_numAccumulatedSamples == 0)
+            {
+                m_accumulatedTrainingLossValue->Reset();
+                m_accumulatedTrainingEvalCriterionValue->Reset();
+            }
+            m_accumulatedTrainingLossValue->Update(m_prevMinibatchAggregateTrainingLossValue, computeDevice);
+            if (m_aggregatedEvaluationFunction)
+                m_accumulatedTrainingEvalCriterionValue->Update(m_prevMinibatchAggregateEvalCriterionValue, computeDevice);
+            m_numAccumulatedSamples += m_prevMinibatchNumSamples;
+        }
+
+        m_accumulatedSweepEnd |= sweepEnd;
+        return (++m_numAccumulatedMinibatches == m_numMinibatchesPerUpdate);
+    }
+
+    // Ends the gradient accumulation of an update: the previous minibatch becomes the union of its minibatches, and their
+    // gradients are returned in 'gradients'. Returns false if they had no samples.
+    bool Trainer::EndGradientAccumulation(std::unordered_map<Parameter, NDArrayViewPtr>& gradients)
+    {
+        bool hasSamples = (m_numAccumulatedSamples > 0);
+        m_prevMinibatchNumSamples = m_numAccumulatedSamples;
+        if (hasSamples)
+        {
+            gradients = m_accumulatedGradients;
+            m_prevMinibatchAggregateTrainingLossValue = m_accumulatedTrainingLossValue;
+            if (m_aggregatedEvaluationFunction)
+                m_prevMinibatchAggregateEvalCriterionValue = m_accumulatedTrainingEvalCriterionValue;
+        }
+
+        m_numAccumulatedMinibatches = 0;
+        m_numAccumulatedSamples = 0;
+        m_accumulatedSweepEnd = false;
+        return hasSamples;
+    }
+
+    void Trainer::SetDynamicLossScaling(bool enable, double initialLossScale, size_t growthInterval)
+    {
+        if (enable && !(initialLossScale >= 1 && initialLossScale <= 65536 * 256))
+            InvalidArgument("Trainer::SetDynamicLossScaling: The initial loss scale must be between 1 and 2^24, but is %f.", initialLossScale);
+        if (enable && growthInterval == 0)
+            InvalidArgument("Trainer::SetDynamicLossScaling: The growth interval must be positive.");
+        if (enable)
+        {
+            for (const auto& learner : m_parameterLearners->ParameterLearners())
+                if (!learner->SupportsLossScaling())
+                    InvalidArgument("Trainer::SetDynamicLossScaling: Not supported by learner of type '%s'.", typeid(*learner).name());
+        }
+
+        m_dynamicLossScaling = enable;
+        m_lossScale = enable ? initialLossScale : 1;
+        m_lossScaleGrowthInterval = growthInterval;
+        m_numUpdatesWithoutOverflow = 0;
+        for (auto& learner : m_parameterLearners->ParameterLearners())
+            learner->SetLossScale(m_lossScale);
+    }
+
+    // Called after the learners have updated with the gradients of m_lossScale times the loss: halves the loss scale if
+    // a learner skipped its update since a gradient overflowed, and doubles it after m_lossScaleGrowthInterval updates without.
+    // The learners make this decision after distributed aggregation, so all workers agree on it.
+    void Trainer::AdjustLossScale()
+    {
+        if (!m_dynamicLossScaling)
+            return;
+
+        bool overflow = false;
+        for (const auto& learner : m_parameterLearners->ParameterLearners())
+            overflow |= learner->HasGradientOverflow();
+
+        const double maxLossScale = 65536.0 * 256; // so that a long run without overflow cannot grow it without bound
+        if (overflow)
+        {
+            m_lossScale = std::max(1.0, m_lossScale / 2);
+            m_numUpdatesWithoutOverflow = 0;
+        }
+        else if (++m_numUpdatesWithoutOverflow >= m_lossScaleGrowthInterval)
+        {
+            m_lossScale = std::min(maxLossScale, m_lossScale * 2);
+            m_numUpdatesWithoutOverflow = 0;
+        }
+        for (auto& learner : m_parameterLearners->ParameterLearners())
+            learner->SetLossScale(m_lossScale);
+    }
+
     void Trainer::UpdateTrainingProgress(size_t numSamples, const ValuePtr& loss, const ValuePtr& evalCriterion,
                                          const DeviceDescriptor& computeDevice)
     {
@@ -329,6 +487,10 @@ namespace CNTK
         {
             m_aggregatedTrainingEvalCriterionValue->Reset();
         }
+
+        // the time of the nodes over the same period as the summary
+        if (Microsoft::MSR::CNTK::Globals::ShouldEnableNodeTiming())
+            PrintNodeTiming();
     }
 
     void Trainer::AddProgressWriters(const std::vector<ProgressWriterPtr>& progressWriters)
@@ -382,12 +544,13 @@ namespace CNTK
 
         DataType aggregateDataType = m_aggregatedLossFunction->Output().GetDataType();
 
+        // with loss scaling the learners divide the gradients by the same factor again, see AdjustLossScale()
         if (aggregateDataType == DataType::Float)
-            m_rootGradientValue->Data()->SetValue(1.0f);
+            m_rootGradientValue->Data()->SetValue((float)m_lossScale);
         else if (aggregateDataType == DataType::Double)
-            m_rootGradientValue->Data()->SetValue(1.0);
+            m_rootGradientValue->Data()->SetValue(m_lossScale);
         else if (aggregateDataType == DataType::Float16)
-            m_rootGradientValue->Data()->SetValue(float16(1.0));
+            m_rootGradientValue->Data()->SetValue(float16((float)m_lossScale));
         else
             RuntimeError("DataType %s is not supported for root gradients", DataTypeName(aggregateDataType));
 
@@ -405,12 +568,28 @@ namespace CNTK
         return modelFilePath + checkpointExt;
     }
 
-    void Trainer::SaveCheckpoint(const std::wstring& modelFilePath, Dictionary externalState)
+    Trainer::~Trainer()
     {
+        try
+        {
+            WaitForCheckpoint();
+        }
+        catch (const std::exception& e)
+        {
+            fprintf(stderr, "Trainer: Writing the last checkpoint failed: %s\n", e.what());
+        }
+    }
+
+    void Trainer::SaveCheckpoint(const std::wstring& modelFilePath, Dictionary externalState, bool inBackground)
+    {
+        // Parameters and learner state of different checkpoints are never held in memory at the same time.
+        WaitForCheckpoint();
+        m_checkpointedInBackground |= inBackground;
+
         auto learnersState = m_parameterLearners->CreateCheckpoint();
 
         if (!m_distributed)
-            return Save(modelFilePath, learnersState, externalState);
+            return Save(modelFilePath, learnersState, externalState, {}, inBackground);
 
         auto compositeFunction = dynamic_cast<CompositeFunction*>(m_combinedTrainingFunction.get());
 
@@ -432,38 +611,66 @@ namespace CNTK
         }
 
         if (communicator->CurrentWorker().IsMain())
-            Save(modelFilePath, learnersState, externalState, aggregatedState);
+            Save(modelFilePath, learnersState, externalState, aggregatedState, inBackground);
 
         // all workers need to sync up after saving model to avoid read-after-write hazard
         // i.e. one worker is in the middle of write while another tries to read
-        communicator->Barrier();
+        // In the background, this is done before reading instead, see RestoreFromCheckpoint().
+        if (!inBackground)
+            communicator->Barrier();
     }
 
-    void Trainer::Save(const std::wstring& modelFilePath, const std::vector<DictionaryValue>& learnerState, const Dictionary& externalState, const Dictionary& distributedState)
+    void Trainer::WaitForCheckpoint()
     {
-        std::wstring tempModelFile = modelFilePath + L".tmp";
-        Dictionary state;
-        state[versionPropertyName] = trainerCheckpointVersion;
-        state[learnersPropertyName] = learnerState;
-        state[externalStatePropertyName] = externalState;
-        state[distributedStatePropertyName] = distributedState;
+        if (m_pendingCheckpoint.valid())
+            m_pendingCheckpoint.get(); // rethrows
+    }
 
-        m_combinedTrainingFunction->Save(tempModelFile);
-        std::wstring trainerStateCheckpointFilePath = GetTrainerStateCheckpointFilePath(modelFilePath);
-        std::wstring tempCheckpointFile = trainerStateCheckpointFilePath + L".tmp";
+    void Trainer::Save(const std::wstring& modelFilePath, const std::vector<DictionaryValue>& learnerState, const Dictionary& externalState, const Dictionary& distributedState, bool inBackground)
+    {
+        auto state = std::make_shared<Dictionary>();
+        (*state)[versionPropertyName] = trainerCheckpointVersion;
+        (*state)[learnersPropertyName] = learnerState;
+        (*state)[externalStatePropertyName] = externalState;
+        (*state)[distributedStatePropertyName] = distributedState;
 
-        state.Save(tempCheckpointFile);
+        // Serializing copies the parameter values to the CPU, so what remains to be done no longer depends on the training.
+        auto model = std::make_shared<Dictionary>(m_combinedTrainingFunction->Serialize());
 
-        // The return value is ignored here.
-        _wunlink(modelFilePath.c_str());
-        _wunlink(trainerStateCheckpointFilePath.c_str());
+        auto write = [modelFilePath, model, state]()
+        {
+            std::wstring tempModelFile = modelFilePath + L".tmp";
+            {
+                auto stream = GetFstream(tempModelFile, false);
+                *stream << *model;
+                stream->flush();
+            }
+            std::wstring trainerStateCheckpointFilePath = GetTrainerStateCheckpointFilePath(modelFilePath);
+            std::wstring tempCheckpointFile = trainerStateCheckpointFilePath + L".tmp";
 
-        renameOrDie(tempModelFile, modelFilePath);
-        renameOrDie(tempCheckpointFile, trainerStateCheckpointFilePath);
+            state->Save(tempCheckpointFile);
+
+            // The return value is ignored here.
+            _wunlink(modelFilePath.c_str());
+            _wunlink(trainerStateCheckpointFilePath.c_str());
+
+            renameOrDie(tempModelFile, modelFilePath);
+            renameOrDie(tempCheckpointFile, trainerStateCheckpointFilePath);
+        };
+
+        if (inBackground)
+            m_pendingCheckpoint = std::async(std::launch::async, write);
+        else
+            write();
     }
 
     Dictionary Trainer::RestoreFromCheckpoint(const std::wstring& modelFilePath)
     {
+        // A checkpoint written in the background must be complete before anybody reads it.
+        WaitForCheckpoint();
+        if (m_distributed && m_checkpointedInBackground)
+            MPICommunicator()->Barrier();
+
         // Restore the model's parameters
         m_combinedTrainingFunction->Restore(modelFilePath);
 
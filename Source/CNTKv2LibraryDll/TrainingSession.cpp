@@ -35,8 +35,10 @@ namespace CNTK
         size_t checkpointFrequency,
         DataUnit checkpointFrequencyUnit,
         bool restoreFromCheckpointIfExists,
-        bool preserveAllCheckpoints) :
+        bool preserveAllCheckpoints,
+        bool saveInBackground) :
         m_preserveAll(preserveAllCheckpoints),
+        m_inBackground(saveInBackground),
         m_restore(restoreFromCheckpointIfExists),
         m_fileName(checkPointFileName),
         m_frequency(checkpointFrequency),
@@ -262,6 +264,9 @@ namespace CNTK
 
         // Perform testing according to the test config.
         Test(computeDevice);
+
+        // The last checkpoint must be on disk when training returns.
+        Trainer()->WaitForCheckpoint();
     }
 
     // TODO: Possibly expose a limiting counter on the number of samples for validation.
@@ -415,8 +420,8 @@ namespace CNTK
         wstring checkpointFile = m_checkpoint.m_fileName;
         if (m_checkpoint.m_preserveAll)
             checkpointFile += std::to_wstring(currentIndex);
-        Trainer()->SaveCheckpoint(checkpointFile, externalState);
-        OnCheckpointEnd(currentIndex);
+        Trainer()->SaveCheckpoint(checkpointFile, externalState, m_checkpoint.m_inBackground);
+        OnCheckpointEnd(currentIndex); // in the background, the files may still be being written
     }
 
     void TrainingSession::SaveFinalCheckpoint()
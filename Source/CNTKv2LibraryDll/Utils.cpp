@@ -19,6 +19,7 @@
 #include "RecurrentNodes.h"
 #include "Value.h"
 #include "CompositeFunction.h"
+#include "Variable.h"
 
 using namespace std;
 using namespace Microsoft::MSR::CNTK;
@@ -558,6 +559,31 @@ namespace CNTK
         return std::pair<size_t, size_t>(maxNumTimeSteps, numSequences);
     }
 
+    /*static*/ void Utils::SetValueStorage(const Variable& var, const NDArrayViewPtr& value)
+    {
+        if (!(var.IsParameter() || var.IsConstant()))
+            LogicError("Variable '%S' SetValueStorage(): Can only be invoked on a Parameter or Constant variable.", var.AsString().c_str());
+        if ((var.GetDataType() != value->GetDataType()) || (AsTensorShape(var.Shape()) != AsTensorShape(value->Shape())))
+            LogicError("Variable '%S' SetValueStorage(): The storage (%S) does not match the data type or shape of the variable.", var.AsString().c_str(), value->Shape().AsString().c_str());
+
+        auto& fields = *var.m_dataFields;
+        bool alreadySet = false;
+        if (fields.m_initValueFlag)
+        {
+            // a lazily initialized variable is never initialized, as in Variable::SetValue()
+            std::call_once(*fields.m_initValueFlag, [&fields, &value, &alreadySet] {
+                fields.m_value = value;
+                fields.m_valueInitializer = nullptr;
+                fields.m_valueInitializationDevice = nullptr;
+                fields.m_valueInitializationView = nullptr;
+                alreadySet = true;
+            });
+        }
+        if (!alreadySet)
+            fields.m_value = value;
+        fields.m_valueTimeStamp++;
+    }
+
     /*static*/ void Utils::VerifyVariableValueCompatibility(const Variable& var, const ValuePtr& value, NDShape* inferredVarShape)
     {
         // TODO: This is a temporary debugging aid and should be removed after the functionality to late bind
@@ -676,7 +702,8 @@ namespace CNTK
     template <typename ElementType>
     std::pair<std::shared_ptr<const Matrix<ElementType>>, MBLayoutPtr> Utils::GetCNTKImplMatrixAndMBLayoutFromValueObject(const Variable& var, const ValuePtr& value, NDShape* inferredVarShape,
                                                                                                                           const std::shared_ptr<Matrix<ElementType>>& outputMatrixStorage,
-                                                                                                                          const std::shared_ptr<Matrix<ElementType>>& tempIndicesStorage)
+                                                                                                                          const std::shared_ptr<Matrix<ElementType>>& tempIndicesStorage,
+                                                                                                                          const MBLayoutPtr& layoutStorage /*= nullptr*/)
     {
         VerifyVariableValueCompatibility(var, value, inferredVarShape);
 
@@ -684,13 +711,23 @@ namespace CNTK
             LogicError("The specified ElementType %s does not match the Value object's DataType %s for Variable '%S'",
                         typeid(ElementType).name(), DataTypeName(value->GetDataType()), var.AsString().c_str());
 
-        auto CreateLayoutWithUnitBatchSizeAndSequenceLength = []() {
-            auto layout = std::make_shared<MBLayout>();
+        // The layout storage is reinitialized by the Init*() calls below, which keeps its buffers if they are large enough
+        auto NewLayout = [&layoutStorage]() {
+            return layoutStorage ? layoutStorage : std::make_shared<MBLayout>();
+        };
+
+        auto CreateLayoutWithUnitBatchSizeAndSequenceLength = [&NewLayout]() {
+            auto layout = NewLayout();
             layout->InitAsFrameMode(1);
             return layout;
         };
 
         auto packedValue = dynamic_cast<PackedValue*>(value.get());
+
+        // Sequences packed by Value::Create are packed for a sequence axis; a variable without one reads them unpacked
+        if (packedValue && packedValue->IsPacked() && packedValue->IsCreatedFromSequences() && (var.DynamicAxes().size() != packedValue->DynamicAxes().size()))
+            packedValue->Unpack();
+
         if (packedValue && packedValue->IsPacked())
         {
             auto packedMatrixAndLayout = packedValue->PackedData<ElementType>();
@@ -715,7 +752,7 @@ namespace CNTK
         {
             // The data need not be shuffled
             std::shared_ptr<const Matrix<ElementType>> matrixData = value->Data()->GetMatrix<ElementType>(VariableRowColSplitPoint(var));
-            auto layout = std::make_shared<MBLayout>();
+            auto layout = NewLayout();
             if (!mask)
             {
                 if (maxNumTimeSteps == 1)
@@ -749,7 +786,7 @@ namespace CNTK
 
             bool hasTruncatedSequences = std::find_if(sequenceBeginIndices.begin(), sequenceBeginIndices.end(), [](const ptrdiff_t& val) { return (val < 0); }) != sequenceBeginIndices.end();
 
-            auto layout = std::make_shared<MBLayout>();
+            auto layout = NewLayout();
             std::vector<std::pair<size_t, size_t>> placement;
             if (!hasTruncatedSequences)
             {
@@ -830,9 +867,9 @@ namespace CNTK
     }
 
     template <typename ElementType>
-    ValuePtr Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout(const NDShape& sampleShape, const std::vector<Axis>& sampleDynamicAxes, const Matrix<ElementType>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/)
+    ValuePtr Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout(const NDShape& sampleShape, const std::vector<Axis>& sampleDynamicAxes, const Matrix<ElementType>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/, ValueConversionStorage* storage /*= nullptr*/)
     {
-        auto CreateMask = [](const MBLayoutPtr& layout, const DeviceDescriptor& device) {
+        auto CreateMask = [storage](const MBLayoutPtr& layout, const DeviceDescriptor& device) {
             std::vector<bool> sequenceBeginFlags;
             std::vector<size_t> sequenceLengths;
             std::vector<size_t> sequencesShorterThanLongestSequence;
@@ -874,7 +911,19 @@ namespace CNTK
             NDMaskPtr mask;
             if (maskNeeded)
             {
-                mask = MakeSharedObject<NDMask>(NDShape({ maxNumTimeSteps, numSequences }), DeviceDescriptor::CPUDevice());
+                NDShape maskShape({ maxNumTimeSteps, numSequences });
+                if (storage && storage->mask && (storage->mask->Shape() == maskShape))
+                {
+                    mask = storage->mask;
+                    mask->Clear();
+                }
+                else
+                {
+                    mask = MakeSharedObject<NDMask>(maskShape, DeviceDescriptor::CPUDevice());
+                    if (storage)
+                        storage->mask = mask;
+                }
+
                 for (size_t i = 0; i < numSequences; ++i)
                     if (sequenceBeginFlags[i])
                         mask->MarkSequenceBegin({ 0, i });
@@ -892,14 +941,30 @@ namespace CNTK
             mask = CreateMask(layout, AsDeviceDescriptor(matrix.GetDeviceId()));
 
         // Reshuffle to data to unpack and uninterleave the CNTK form packed data
-        auto unpackedTensorView = ComputationNode<ElementType>::Unpack(AsTensorShape(sampleShape), matrix, layout, /*batchMajor=*/ false, /*gapPadValue=*/ nullptr);
+        std::shared_ptr<Matrix<ElementType>> unpackedDataStorage, tempIndicesStorage;
+        if (storage)
+        {
+            unpackedDataStorage = storage->Get<ElementType>(storage->data, matrix.GetDeviceId());
+            tempIndicesStorage = storage->Get<ElementType>(storage->indices, matrix.GetDeviceId());
+        }
+        auto unpackedTensorView = ComputationNode<ElementType>::Unpack(AsTensorShape(sampleShape), matrix, layout, unpackedDataStorage, tempIndicesStorage, /*tempMaskStorage=*/ nullptr, /*batchMajor=*/ false, /*gapPadValue=*/ nullptr);
         auto dataShape = PackedValue::GetUnpackedShape(sampleShape, sampleDynamicAxes, layout);
         auto data = MakeSharedObject<NDArrayView>(AsDataType<ElementType>(), AsDeviceDescriptor(matrix.GetDeviceId()), AsStorageFormat(matrix.GetFormat()), dataShape, readOnly, new TensorView<ElementType>(unpackedTensorView, AsTensorViewShape(dataShape)));
         return MakeSharedObject<Value>(data, mask);
     }
 
     template <typename ElementType>
-    ValuePtr Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout(const Variable& var, const ComputationNodeBasePtr& computationNode, const Matrix<ElementType>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/)
+    NDArrayViewPtr Utils::GetNDArrayViewAliasOfCNTKImplMatrix(const NDShape& viewShape, const Matrix<ElementType>& matrix, bool readOnly)
+    {
+        if (viewShape.TotalSize() != matrix.GetNumElements())
+            LogicError("The shape '%S' of the NDArrayView does not match the %zu elements of the Matrix it aliases.", viewShape.AsString().c_str(), matrix.GetNumElements());
+
+        auto tensorView = new TensorView<ElementType>(std::make_shared<Matrix<ElementType>>(matrix.AsReference()), AsTensorViewShape(viewShape));
+        return MakeSharedObject<NDArrayView>(AsDataType<ElementType>(), AsDeviceDescriptor(matrix.GetDeviceId()), AsStorageFormat(matrix.GetFormat()), viewShape, readOnly, tensorView);
+    }
+
+    template <typename ElementType>
+    ValuePtr Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout(const Variable& var, const ComputationNodeBasePtr& computationNode, const Matrix<ElementType>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/, ValueConversionStorage* storage /*= nullptr*/)
     {
         if (var.DynamicAxes().size() > 2)
             LogicError("More than 2 dynamic axes for a variable '%S' is currently unsupported", var.AsString().c_str());
@@ -914,7 +979,7 @@ namespace CNTK
         if (computationNode)
             varShape = GetVariableShape(var.Shape(), computationNode->GetSampleLayout());
 
-        return GetValueObjectFromCNTKImplMatrixAndMBLayout(varShape, var.DynamicAxes(), matrix, layout, readOnly);
+        return GetValueObjectFromCNTKImplMatrixAndMBLayout(varShape, var.DynamicAxes(), matrix, layout, readOnly, storage);
     }
 
     template <typename SrcType, typename DstType>
@@ -961,6 +1026,17 @@ namespace CNTK
     template Variable Utils::ConvertVariableType<float, float16>(const Variable& stat, bool reverseShape, const DeviceDescriptor& computeDevice);
     template Variable Utils::ConvertVariableType<float16, float>(const Variable& stat, bool reverseShape, const DeviceDescriptor& computeDevice);
 
+    template <typename ElementType>
+    NDArrayViewPtr Utils::HistogramOf(const NDArrayViewPtr& data, const NDArrayViewPtr& bucketLimits)
+    {
+        NDArrayViewPtr histogram = MakeSharedObject<NDArrayView>(AsDataType<ElementType>(), StorageFormat::Dense, NDShape({ bucketLimits->Shape().TotalSize() + 5 }), data->Device());
+        histogram->GetWritableMatrix<ElementType>()->AssignHistogramOf(*data->GetMatrix<ElementType>(), *bucketLimits->GetMatrix<ElementType>());
+        return histogram;
+    }
+
+    template NDArrayViewPtr Utils::HistogramOf<float>(const NDArrayViewPtr& data, const NDArrayViewPtr& bucketLimits);
+    template NDArrayViewPtr Utils::HistogramOf<double>(const NDArrayViewPtr& data, const NDArrayViewPtr& bucketLimits);
+
     std::vector<Axis> GetSqueezableAxes(const NDShape& inputShape)
     {
         std::vector<Axis> axes;
@@ -1068,6 +1144,13 @@ namespace CNTK
         return ReduceElementsNode<double>::NeutralValue(reductionOpEnumValue);
     }
 
+    bool IsDirectSequenceAxisReduction(const std::wstring& reductionOpName)
+    {
+        auto reductionOpEnumValue = ReduceElementsNode<double>::ReductionOpEnumValue(reductionOpName);
+        return (reductionOpEnumValue == ElementWiseOperator::opSum) || (reductionOpEnumValue == ElementWiseOperator::opLogSum) ||
+               (reductionOpEnumValue == ElementWiseOperator::opMin) || (reductionOpEnumValue == ElementWiseOperator::opMax);
+    }
+
     template void DictionaryValue::AllocateDataPtr<NDShape>(const NDShape& value);
     template void DictionaryValue::AllocateDataPtr<Axis>(const Axis& value);
     template void DictionaryValue::AllocateDataPtr<vector<DictionaryValue>>(const vector<DictionaryValue>& value);
@@ -1260,13 +1343,17 @@ namespace CNTK
     template std::pair<std::shared_ptr<const Matrix<double>>, MBLayoutPtr> Utils::GetCNTKImplMatrixAndMBLayoutFromValueObject<double>(const Variable& var, const ValuePtr& value, NDShape* inferredVarShape);
     template std::pair<std::shared_ptr<const Matrix<half>>, MBLayoutPtr> Utils::GetCNTKImplMatrixAndMBLayoutFromValueObject<half>(const Variable& var, const ValuePtr& value, NDShape* inferredVarShape);
 
-    template ValuePtr Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<float>(const NDShape& sampleShape, const std::vector<Axis>& sampleDynamicAxes, const Matrix<float>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/);
-    template ValuePtr Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<double>(const NDShape& sampleShape, const std::vector<Axis>& sampleDynamicAxes, const Matrix<double>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/);
-    template ValuePtr Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<half>(const NDShape& sampleShape, const std::vector<Axis>& sampleDynamicAxes, const Matrix<half>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/);
+    template NDArrayViewPtr Utils::GetNDArrayViewAliasOfCNTKImplMatrix<float>(const NDShape& viewShape, const Matrix<float>& matrix, bool readOnly);
+    template NDArrayViewPtr Utils::GetNDArrayViewAliasOfCNTKImplMatrix<double>(const NDShape& viewShape, const Matrix<double>& matrix, bool readOnly);
+    template NDArrayViewPtr Utils::GetNDArrayViewAliasOfCNTKImplMatrix<half>(const NDShape& viewShape, const Matrix<half>& matrix, bool readOnly);
+
+    template ValuePtr Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<float>(const NDShape& sampleShape, const std::vector<Axis>& sampleDynamicAxes, const Matrix<float>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/, ValueConversionStorage* storage /*= nullptr*/);
+    template ValuePtr Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<double>(const NDShape& sampleShape, const std::vector<Axis>& sampleDynamicAxes, const Matrix<double>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/, ValueConversionStorage* storage /*= nullptr*/);
+    template ValuePtr Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<half>(const NDShape& sampleShape, const std::vector<Axis>& sampleDynamicAxes, const Matrix<half>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/, ValueConversionStorage* storage /*= nullptr*/);
 
-    template ValuePtr Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<float>(const Variable& var, const ComputationNodeBasePtr& computationNode, const Matrix<float>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/);
-    template ValuePtr Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<double>(const Variable& var, const ComputationNodeBasePtr& computationNode, const Matrix<double>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/);
-    template ValuePtr Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<half>(const Variable& var, const ComputationNodeBasePtr& computationNode, const Matrix<half>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/);
+    template ValuePtr Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<float>(const Variable& var, const ComputationNodeBasePtr& computationNode, const Matrix<float>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/, ValueConversionStorage* storage /*= nullptr*/);
+    template ValuePtr Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<double>(const Variable& var, const ComputationNodeBasePtr& computationNode, const Matrix<double>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/, ValueConversionStorage* storage /*= nullptr*/);
+    template ValuePtr Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<half>(const Variable& var, const ComputationNodeBasePtr& computationNode, const Matrix<half>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/, ValueConversionStorage* storage /*= nullptr*/);
 
     void Accumulator::Update(const ValuePtr& delta, const DeviceDescriptor& device)
     {
@@ -29,6 +29,30 @@ namespace CNTK
             NOT_IMPLEMENTED;
     }
 
+    //
+    // Scratch buffers for converting between the Value of a Variable and the packed layout of its ComputationNode,
+    // kept by the caller from one conversion to the next so that converting the same shapes again does not allocate.
+    //
+    struct ValueConversionStorage
+    {
+        std::shared_ptr<Microsoft::MSR::CNTK::MatrixBase> data;    // the rearranged data
+        std::shared_ptr<Microsoft::MSR::CNTK::MatrixBase> indices; // the gather or scatter indices
+        NDMaskPtr mask;
+        Microsoft::MSR::CNTK::MBLayoutPtr layout;                  // the layout built for the Value
+
+        template <typename ElementType>
+        std::shared_ptr<Microsoft::MSR::CNTK::Matrix<ElementType>> Get(std::shared_ptr<Microsoft::MSR::CNTK::MatrixBase>& scratch, DEVICEID_TYPE deviceId)
+        {
+            auto matrix = std::dynamic_pointer_cast<Microsoft::MSR::CNTK::Matrix<ElementType>>(scratch);
+            if (!matrix || (matrix->GetDeviceId() != deviceId))
+            {
+                matrix = std::make_shared<Microsoft::MSR::CNTK::Matrix<ElementType>>(deviceId);
+                scratch = matrix;
+            }
+            return matrix;
+        }
+    };
+
     template <typename T>
     inline bool IsObjectExpired(std::weak_ptr<T> ptrToObject)
     {
@@ -621,6 +645,9 @@ namespace CNTK
 
     double ReductionIdentityValue(const std::wstring& reductionOpName);
 
+    // Whether ReduceElements can reduce the sequence axis of its operand directly, without unpacking the sequences first.
+    bool IsDirectSequenceAxisReduction(const std::wstring& reductionOpName);
+
     // Helper class to manage a collection of learners.
     class Learners
     {
@@ -686,11 +713,16 @@ namespace CNTK
         }
         static void VerifyVariableValueCompatibility(const Variable& var, const ValuePtr& value, NDShape* inferredVarShape = nullptr);
 
+        // Makes 'value' (of the same shape and data type) the storage of the Parameter or Constant 'var', without copying it,
+        // e.g. a view over device memory shared with other processes. Networks compiled before keep the previous storage.
+        static void SetValueStorage(const Variable& var, const NDArrayViewPtr& value);
+
         template <typename ElementType>
         static std::pair<std::shared_ptr<const Microsoft::MSR::CNTK::Matrix<ElementType>>, Microsoft::MSR::CNTK::MBLayoutPtr>
         GetCNTKImplMatrixAndMBLayoutFromValueObject(const Variable& var, const ValuePtr& value, NDShape* inferredVarShape,
                                                     const std::shared_ptr<Microsoft::MSR::CNTK::Matrix<ElementType>>& outputMatrixStorage,
-                                                    const std::shared_ptr<Microsoft::MSR::CNTK::Matrix<ElementType>>& tempIndicesStorage);
+                                                    const std::shared_ptr<Microsoft::MSR::CNTK::Matrix<ElementType>>& tempIndicesStorage,
+                                                    const Microsoft::MSR::CNTK::MBLayoutPtr& layoutStorage = nullptr);
 
         template <typename ElementType>
         static std::pair<std::shared_ptr<const Microsoft::MSR::CNTK::Matrix<ElementType>>, Microsoft::MSR::CNTK::MBLayoutPtr>
@@ -701,13 +733,22 @@ namespace CNTK
         }
 
         template <typename ElementType>
-        static ValuePtr GetValueObjectFromCNTKImplMatrixAndMBLayout(const NDShape& sampleShape, const std::vector<Axis>& sampleDynamicAxes, const Microsoft::MSR::CNTK::Matrix<ElementType>& matrix, const Microsoft::MSR::CNTK::MBLayoutPtr& layout, bool readOnly = true);
+        static ValuePtr GetValueObjectFromCNTKImplMatrixAndMBLayout(const NDShape& sampleShape, const std::vector<Axis>& sampleDynamicAxes, const Microsoft::MSR::CNTK::Matrix<ElementType>& matrix, const Microsoft::MSR::CNTK::MBLayoutPtr& layout, bool readOnly = true, ValueConversionStorage* storage = nullptr);
 
         template <typename ElementType>
-        static ValuePtr GetValueObjectFromCNTKImplMatrixAndMBLayout(const Variable& var, const Microsoft::MSR::CNTK::ComputationNodeBasePtr& computationNode, const Microsoft::MSR::CNTK::Matrix<ElementType>& matrix, const Microsoft::MSR::CNTK::MBLayoutPtr& layout, bool readOnly = true);
+        static ValuePtr GetValueObjectFromCNTKImplMatrixAndMBLayout(const Variable& var, const Microsoft::MSR::CNTK::ComputationNodeBasePtr& computationNode, const Microsoft::MSR::CNTK::Matrix<ElementType>& matrix, const Microsoft::MSR::CNTK::MBLayoutPtr& layout, bool readOnly = true, ValueConversionStorage* storage = nullptr);
         
+        // Returns an NDArrayView of 'viewShape' over the data of 'matrix', without copying it
+        template <typename ElementType>
+        static NDArrayViewPtr GetNDArrayViewAliasOfCNTKImplMatrix(const NDShape& viewShape, const Microsoft::MSR::CNTK::Matrix<ElementType>& matrix, bool readOnly);
+
         template <typename SrcType, typename DstType>
         static Variable ConvertVariableType(const Variable& stat, bool reverseShape = false, const DeviceDescriptor& computeDevice = DeviceDescriptor::UseDefaultDevice());
+
+        // The Matrix::AssignHistogramOf() of 'data' for the 'bucketLimits' on its device, computed there:
+        // the bucket counts followed by the sum, sum of squares, minimum and maximum of the finite values.
+        template <typename ElementType>
+        static NDArrayViewPtr HistogramOf(const NDArrayViewPtr& data, const NDArrayViewPtr& bucketLimits);
     };
 
     template <typename Container>
@@ -761,4 +802,11 @@ namespace CNTK
     {
         return DataType::Float16;
     }
+
+    // so is bfloat16
+    template<>
+    inline DataType AsDataType<bfloat16>()
+    {
+        return DataType::BFloat16;
+    }
 }
@@ -17,6 +17,7 @@
 #include "CommonMatrix.h"
 #include "CPUSparseMatrix.h"
 #include "RecurrentNodes.h"
+#include "CUDAPageLockedMemAllocator.h"
 
 namespace CNTK
 {
@@ -136,6 +137,74 @@ namespace CNTK
         std::copy(currentSequencePaddedColStarts.begin(), currentSequencePaddedColStarts.end(), std::back_inserter(colStarts));
     }
 
+    //
+    // Packs dense sequences on the CPU, which all begin in this minibatch, into the layout in which a network reads them,
+    // so that the Value is fed to the network as it is instead of being padded here and gathered again on the device.
+    // The sequences are copied into their columns in parallel, into page-locked memory for a GPU, from which the
+    // packed data is copied to the device at once.
+    //
+    template <typename ElementType>
+    static ValuePtr CreatePackedValue(const NDShape& sampleShape, const std::vector<NDArrayViewPtr>& sequences, const std::vector<size_t>& sequenceLengths, const DeviceDescriptor& device, bool readOnly)
+    {
+        using namespace Microsoft::MSR::CNTK;
+
+        auto numSequences = sequences.size();
+        std::vector<MBLayout::SequenceInfo> sequenceInfos;
+        sequenceInfos.reserve(numSequences);
+        for (size_t i = 0; i < numSequences; ++i)
+            sequenceInfos.push_back({ i, SIZE_MAX, 0, sequenceLengths[i] });
+
+        auto layout = std::make_shared<MBLayout>();
+        std::vector<std::pair<size_t, size_t>> placement;
+        std::vector<size_t> rowAllocations;
+        layout->InitAsPackedSequences(sequenceInfos, placement, rowAllocations);
+
+        auto sampleSize = sampleShape.TotalSize();
+        auto numParallelSequences = layout->GetNumParallelSequences();
+        auto deviceId = AsCNTKImplDeviceId(device);
+        std::shared_ptr<Matrix<ElementType>> matrix;
+        std::unique_ptr<ElementType, std::function<void(ElementType*)>> pinnedBuffer;
+        ElementType* buffer;
+        if (deviceId == CPUDEVICE)
+        {
+            matrix = std::make_shared<Matrix<ElementType>>(sampleSize, layout->GetNumCols(), CPUDEVICE);
+            buffer = matrix->Data();
+        }
+        else
+        {
+            pinnedBuffer = std::unique_ptr<ElementType, std::function<void(ElementType*)>>(
+                (ElementType*)CUDAPageLockedMemAllocator::Malloc(sampleSize * layout->GetNumCols() * sizeof(ElementType), deviceId),
+                [deviceId](ElementType* p) { CUDAPageLockedMemAllocator::Free(p, deviceId); });
+            buffer = pinnedBuffer.get();
+        }
+
+        // The gaps are masked, but zeroed so that the data does not depend on what the memory held before
+        for (const auto& sequence : layout->GetAllSequences())
+        {
+            if (sequence.seqId != GAP_SEQUENCE_ID)
+                continue;
+
+            for (size_t t = (size_t)std::max<ptrdiff_t>(0, sequence.tBegin); t < std::min(sequence.tEnd, layout->GetNumTimeSteps()); ++t)
+                std::fill_n(buffer + ((t * numParallelSequences) + sequence.s) * sampleSize, sampleSize, (ElementType)0);
+        }
+
+        // Each sequence has its own columns, so the sequences are copied in parallel
+        auto totalNumElements = layout->GetNumCols() * sampleSize;
+#pragma omp parallel for schedule(dynamic) if ((numSequences > 1) && (totalNumElements > 0x10000))
+        for (int i = 0; i < (int)numSequences; ++i)
+        {
+            const ElementType* sequenceBuffer = sequences[i]->DataBuffer<ElementType>();
+            size_t parallelSequenceIdx = placement[i].first;
+            size_t startIdxInParallelSequence = placement[i].second;
+            for (size_t j = 0; j < sequenceLengths[i]; ++j)
+                std::copy_n(sequenceBuffer + (j * sampleSize), sampleSize, buffer + ((((startIdxInParallelSequence + j) * numParallelSequences) + parallelSequenceIdx) * sampleSize));
+        }
+
+        if (!matrix)
+            matrix = std::make_shared<Matrix<ElementType>>(sampleSize, layout->GetNumCols(), buffer, deviceId);
+        return MakeSharedObject<PackedValue>(sampleShape, Axis::DefaultInputVariableDynamicAxes(), matrix, layout, readOnly, /*isCreatedFromSequences =*/ true);
+    }
+
     /*static*/ ValuePtr Value::Create(const NDShape& sampleShape, const std::vector<NDArrayViewPtr>& sequences, const std::vector<bool>& sequenceStartFlags, const DeviceDescriptor& device, bool readOnly, bool createNewCopy)
     {
         auto numSequences = sequences.size();
@@ -186,6 +255,19 @@ namespace CNTK
         }
 
         bool isDataSparse = sequences[0]->IsSparse();
+
+        // Several dense sequences that all begin here, as the sequences of a minibatch usually do, are packed right away
+        bool allSequencesBegin = sequenceStartFlags.empty() ||
+                                 ((sequenceStartFlags.size() == numSequences) && (std::find(sequenceStartFlags.begin(), sequenceStartFlags.end(), false) == sequenceStartFlags.end()));
+        bool anyEmptySequence = std::find(sequenceLengths.begin(), sequenceLengths.end(), 0) != sequenceLengths.end();
+        if ((numSequences > 1) && (maxSequenceLength > 1) && !isDataSparse && allSequencesBegin && !anyEmptySequence)
+        {
+            if (dataType == DataType::Float)
+                return CreatePackedValue<float>(fullyDefinedSampleShape, sequences, sequenceLengths, device, readOnly);
+            else if (dataType == DataType::Double)
+                return CreatePackedValue<double>(fullyDefinedSampleShape, sequences, sequenceLengths, device, readOnly);
+        }
+
         NDMaskPtr deviceValueMask = CreateMask(sequenceLengths, sequenceStartFlags, DeviceDescriptor::CPUDevice());
 
         NDArrayViewPtr valueData;
@@ -657,7 +739,7 @@ namespace CNTK
 
     void PackedValue::Unpack() const
     {
-        if (m_packedDataLayout && (m_packedDataLayout->GetNumTimeSteps() != 1) && (m_packedDataLayout->GetNumSequences() != 1) && Internal::IsAutomaticUnpackingOfPackedValuesDisabled())
+        if (m_packedDataLayout && (m_packedDataLayout->GetNumTimeSteps() != 1) && (m_packedDataLayout->GetNumSequences() != 1) && !m_isCreatedFromSequences && Internal::IsAutomaticUnpackingOfPackedValuesDisabled())
             LogicError("PackedValue::Unpack: Automatic unpacking of PackedValue objects is disabled");
 
         if (m_isPacked)
@@ -20,8 +20,8 @@ namespace CNTK
 
     public:
         template <typename ElementType>
-        PackedValue(const NDShape& sampleShape, const std::vector<Axis>& sampleDynamicAxes, const std::shared_ptr<Microsoft::MSR::CNTK::Matrix<ElementType>>& packedDataMatrix, const std::shared_ptr<Microsoft::MSR::CNTK::MBLayout>& packedDataLayout, bool isReadOnly)
-            : Value(nullptr), m_isPacked(true), m_sampleShape(sampleShape), m_sampleDynamicAxes(sampleDynamicAxes), m_packedData(nullptr), m_packedDataLayout(packedDataLayout), m_isReadOnly(isReadOnly)
+        PackedValue(const NDShape& sampleShape, const std::vector<Axis>& sampleDynamicAxes, const std::shared_ptr<Microsoft::MSR::CNTK::Matrix<ElementType>>& packedDataMatrix, const std::shared_ptr<Microsoft::MSR::CNTK::MBLayout>& packedDataLayout, bool isReadOnly, bool isCreatedFromSequences = false)
+            : Value(nullptr), m_isPacked(true), m_sampleShape(sampleShape), m_sampleDynamicAxes(sampleDynamicAxes), m_packedData(nullptr), m_packedDataLayout(packedDataLayout), m_isReadOnly(isReadOnly), m_isCreatedFromSequences(isCreatedFromSequences)
         {
             NDShape packedMatrixShape({ packedDataMatrix->GetNumRows(), packedDataMatrix->GetNumCols() });
             auto tensorView = new Microsoft::MSR::CNTK::TensorView<ElementType>(packedDataMatrix, AsTensorViewShape(packedMatrixShape));
@@ -33,6 +33,10 @@ namespace CNTK
 
         bool IsPacked() const { return m_isPacked; }
 
+        // Whether the value was packed by Value::Create from the sequences of the user, rather than taken from a network or a reader.
+        // Such a value is unpacked whenever its data is read, even if automatic unpacking is disabled.
+        bool IsCreatedFromSequences() const { return m_isCreatedFromSequences; }
+
         void Unpack() const;
 
         void Erase() override
@@ -97,20 +101,30 @@ namespace CNTK
                     packedLayoutCopy = std::make_shared<Microsoft::MSR::CNTK::MBLayout>();
                     packedLayoutCopy->CopyFrom(m_packedDataLayout);
                 }
-                return MakeSharedObject<PackedValue>(m_sampleShape, m_sampleDynamicAxes, m_packedData->DeepClone(readOnly), packedLayoutCopy, readOnly);
+                return MakeSharedObject<PackedValue>(m_sampleShape, m_sampleDynamicAxes, m_packedData->DeepClone(readOnly), packedLayoutCopy, readOnly, m_isCreatedFromSequences);
             }
             else
                 return Value::DeepClone(readOnly);
         }
 
-        ValuePtr Alias(bool /*readOnly = false*/) const override
+        ValuePtr Alias(bool readOnly = false) const override
         {
-            LogicError("Value::Alias is currently unsupported for PackedValue objects.");
+            if (!m_isCreatedFromSequences)
+                LogicError("Value::Alias is currently unsupported for PackedValue objects.");
+
+            if (m_isPacked)
+                return MakeSharedObject<PackedValue>(m_sampleShape, m_sampleDynamicAxes, m_packedData->Alias(readOnly), m_packedDataLayout, readOnly, m_isCreatedFromSequences);
+            else
+                return Value::Alias(readOnly);
         }
 
-        void CopyFrom(const Value& /*source*/) override
+        void CopyFrom(const Value& source) override
         {
-            LogicError("Value::CopyFrom is currently unsupported for PackedValue objects");
+            if (!m_isCreatedFromSequences)
+                LogicError("Value::CopyFrom is currently unsupported for PackedValue objects");
+
+            // the data is unpacked before it is overwritten
+            Value::CopyFrom(source);
         }
 
         template <typename ElementType>
@@ -147,8 +161,8 @@ namespace CNTK
         }
 
     private:
-        PackedValue(const NDShape& sampleShape, const std::vector<Axis>& sampleDynamicAxes, const NDArrayViewPtr& packedData, const std::shared_ptr<Microsoft::MSR::CNTK::MBLayout>& packedDataLayout, bool isReadOnly)
-            : Value(nullptr), m_isPacked(true), m_sampleShape(sampleShape), m_sampleDynamicAxes(sampleDynamicAxes), m_packedData(packedData), m_packedDataLayout(packedDataLayout), m_isReadOnly(isReadOnly)
+        PackedValue(const NDShape& sampleShape, const std::vector<Axis>& sampleDynamicAxes, const NDArrayViewPtr& packedData, const std::shared_ptr<Microsoft::MSR::CNTK::MBLayout>& packedDataLayout, bool isReadOnly, bool isCreatedFromSequences)
+            : Value(nullptr), m_isPacked(true), m_sampleShape(sampleShape), m_sampleDynamicAxes(sampleDynamicAxes), m_packedData(packedData), m_packedDataLayout(packedDataLayout), m_isReadOnly(isReadOnly), m_isCreatedFromSequences(isCreatedFromSequences)
         {
             // Determine unpacked shape
             m_unpackedShape = GetUnpackedShape(sampleShape, sampleDynamicAxes, packedDataLayout);
@@ -156,6 +170,7 @@ namespace CNTK
 
     private:
         bool m_isReadOnly;
+        bool m_isCreatedFromSequences;
         NDShape m_sampleShape;
         std::vector<Axis> m_sampleDynamicAxes;
         NDShape m_unpackedShape;
@@ -125,9 +125,20 @@ namespace CNTK
         {
             std::call_once(*m_dataFields->m_initValueFlag, [=]{
                 assert(m_dataFields->m_value == nullptr);
-                assert(m_dataFields->m_valueInitializer);
+                assert(m_dataFields->m_valueInitializer || m_dataFields->m_valueInitializationView);
                 assert(m_dataFields->m_valueInitializationDevice);
 
+                if (m_dataFields->m_valueInitializationView)
+                {
+                    const auto& view = m_dataFields->m_valueInitializationView;
+                    const auto& device = *m_dataFields->m_valueInitializationDevice;
+                    PrefetchMemoryMappedData(*view);
+                    m_dataFields->m_value = (view->Device() == device) ? view->Alias(/*readOnly =*/ true) : view->DeepClone(device, /*readOnly =*/ false);
+                    m_dataFields->m_valueInitializationView = nullptr;
+                    m_dataFields->m_valueInitializationDevice = nullptr;
+                    return;
+                }
+
                 switch (GetDataType())
                 {
                 case DataType::Float:
@@ -187,6 +198,7 @@ namespace CNTK
                 m_dataFields->m_value = value->DeepClone(*m_dataFields->m_valueInitializationDevice, false);
                 m_dataFields->m_valueInitializer = nullptr;
                 m_dataFields->m_valueInitializationDevice = nullptr;
+                m_dataFields->m_valueInitializationView = nullptr;
                 alreadySet = true;
             });
         }
@@ -261,10 +273,25 @@ namespace CNTK
 
         if (m_valueInitializer)
             clone->SetValueInitialization(*m_valueInitializer, *m_valueInitializationDevice);
+        else if (m_valueInitializationView)
+            clone->SetValueInitialization(m_valueInitializationView, *m_valueInitializationDevice);
 
         return clone;
     }
 
+    void VariableFields::SetValueInitialization(const NDArrayViewPtr& initializationView, const DeviceDescriptor& device)
+    {
+        if (m_value != nullptr)
+            LogicError("Variable '%S': Value initialization view cannot be set if a value already exists", AsString().c_str());
+
+        if (!initializationView->IsReadOnly())
+            LogicError("Variable '%S': Value initialization view must be read-only", AsString().c_str());
+
+        m_initValueFlag.reset(new std::once_flag());
+        m_valueInitializationView = initializationView;
+        m_valueInitializationDevice.reset(new DeviceDescriptor(device));
+    }
+
     void VariableFields::SetValueInitialization(const ParameterInitializer& initializationConfig, const DeviceDescriptor& device)
     {
         if (m_value != nullptr)
@@ -405,6 +432,7 @@ namespace CNTK
     /*static*/ NDArrayViewPtr Variable::CreateValueFromParameterInitializer(const NDShape& shape, const ParameterInitializer& initConfig, const DeviceDescriptor& device)
     {
         auto dataType = AsDataType<ElementType>();
+        Microsoft::MSR::CNTK::GPUMemoryCategoryScope memoryCategory(Microsoft::MSR::CNTK::GPUMemoryCategory::Parameters);
         auto value = MakeSharedObject<NDArrayView>(dataType, shape, device);
         auto valueMatrix = value->template GetWritableMatrix<ElementType>();
         auto initializerType = initConfig[InitializerTypeAttributeName].Value<std::wstring>();
@@ -546,6 +574,18 @@ namespace CNTK
         {
             auto& value = dict[valueKey].Value<NDArrayView>();
 
+            // A read-only value is a view over a memory-mapped model file, whose contents do not change.
+            // It is placed on the device when first used, so that the data of unused parameters is never read.
+            if (value.IsReadOnly())
+            {
+                Variable var(shape, kind, dataType, nullptr, needsGradient, dynamicAxis, isSparse, name, uid);
+                var.m_dataFields->SetValueInitialization(value.Alias(/*readOnly =*/ true), device);
+                if (var.IsParameter())
+                    return Parameter(var);
+                else
+                    return Constant(var);
+            }
+
             // TODO: this copying here is redundant, value should be moved from the dictionary to the variable.
             // Also, the correct device should be used upfront when deserializing NDArrayView.
             Variable var(shape, kind, dataType, value.DeepClone(device, value.IsReadOnly()), needsGradient, dynamicAxis, isSparse, name, uid);
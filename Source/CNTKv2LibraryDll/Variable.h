@@ -23,6 +23,7 @@ namespace CNTK
         NDArrayViewPtr m_value;
         std::unique_ptr<ParameterInitializer> m_valueInitializer;
         std::unique_ptr<DeviceDescriptor> m_valueInitializationDevice;
+        NDArrayViewPtr m_valueInitializationView;
         bool m_needsGradient;
         std::wstring m_name;
         std::vector<Axis> m_dynamicAxes;
@@ -68,6 +69,9 @@ namespace CNTK
 
         CNTK_API void SetValueInitialization(const ParameterInitializer& initializationConfig, const DeviceDescriptor& device);
 
+        // Defers the placement of an immutable (read-only) view on the device to the first access of the value.
+        void SetValueInitialization(const NDArrayViewPtr& initializationView, const DeviceDescriptor& device);
+
     private:
         // Disallow copy and move construction and assignment
         VariableFields(const VariableFields&) = delete; VariableFields& operator=(const VariableFields& other) = delete; VariableFields(VariableFields&&) = delete; VariableFields& operator=(VariableFields&&) = delete;
@@ -2043,7 +2043,7 @@ std::vector<int64_t> CNTKToONNXHelper::ToINTS(const std::vector<int>& shape,
 bool IsUnSupportedLayerNormalization(const FunctionPtr src)
 {
     std::string cntkOpName = ToLegacyString(ToUTF8(src->OpName()));
-    return cntkOpName == "LayerNormalization" && src->Output().HasSequenceAxis();
+    return src->IsBlock() && cntkOpName == "LayerNormalization" && src->Output().HasSequenceAxis();
 }
 
 bool CNTKToONNXHelper::CheckCorrectTransposeAxisToSkipForSequenceAxisOpWrapper(FunctionPtr currentOp)
@@ -7355,6 +7355,27 @@ onnxruntime::Node* CNTKToONNXHelper::AddNode(const FunctionPtr& src, onnxruntime
                 node = &graph->AddNode(nodeName, ToOPName(src), "", orderedInputs, outputs);
             }
         }
+        else if (src->OpName() == L"LayerNormalization" && !src->IsBlock())
+        {
+            // The LayerNormalization primitive (operand, scale, bias) normalizes each sample over its static axes. It is exported as
+            // MeanVarianceNormalization over the axes after the dynamic ones, followed by the scale and the bias. As for the
+            // LayerNormalization layer below, epsilon cannot be exported.
+            const Variable& operand = src->Inputs()[0];
+            onnx::TypeProto operandArgType = ToTypeProto(operand.Shape(), operand.HasBatchAxis(), operand.HasSequenceAxis());
+            UpdateONNXType(operand.GetDataType(), operandArgType);
+            onnxruntime::NodeArg &mvnTensorOutputArg = graph->GetOrCreateNodeArg(nodeName + string("_mvn_output0"), &operandArgType);
+            onnxruntime::Node* mvnNode = &graph->AddNode(nodeName + string("_MVN"), "MeanVarianceNormalization",
+                                                         "", {inputs[0]}, {&mvnTensorOutputArg});
+            std::vector<int64_t> axes;
+            size_t numDynamicAxes = (operand.HasBatchAxis() ? 1 : 0) + (operand.HasSequenceAxis() ? 1 : 0);
+            size_t operandRank = ToINTS(operandArgType).size();
+            for (size_t i = numDynamicAxes; i < operandRank; ++i) axes.push_back(static_cast<int64_t>(i));
+            mvnNode->AddAttribute("axes", axes);
+
+            onnxruntime::NodeArg &mulTensorOutputArg = graph->GetOrCreateNodeArg(nodeName + string("_mul_output0"), &operandArgType);
+            graph->AddNode(nodeName + string("_mul"), "Mul", "", {&mvnTensorOutputArg, inputs[1]}, {&mulTensorOutputArg});
+            node = &graph->AddNode(nodeName + string("_add"), "Add", "", {&mulTensorOutputArg, inputs[2]}, outputs);
+        }
         else if (src->OpName() == L"LayerNormalization")
         {
             // Special handling of LayerNormalization to use MeanVarianceNormalization (and not reduce_mean op).
@@ -11,6 +11,7 @@
 #include "ONNX.h"
 #include "CNTKToONNX.h"
 #include "ONNXToCNTK.h"
+#include "ONNXGraphOptimizer.h"
 #include "Utils.h"
 
 #include <iostream>
@@ -92,11 +93,31 @@ void ONNXFormat::InitializeLotusIR()
     });
 }
 
-void ONNXFormat::Save(const FunctionPtr& src, const std::wstring& filepath, bool useExternalFilesToStoreParameters)
+void ONNXFormat::Save(const FunctionPtr& src, const std::wstring& filepath, bool useExternalFilesToStoreParameters,
+    bool optimizeGraph, DataType dataType)
 {
     InitializeLotusIR();
 
-    auto model = CNTKToONNX::CreateModel(src, filepath, useExternalFilesToStoreParameters);
+    if (dataType != DataType::Unknown && dataType != DataType::Float16)
+        InvalidArgument("ONNX export: only DataType::Float16 can be requested for the exported model, not '%s'.", DataTypeName(dataType));
+    if (dataType == DataType::Float16 && useExternalFilesToStoreParameters)
+        InvalidArgument("ONNX export: float16 conversion does not support storing the parameters in external files.");
+
+    std::shared_ptr<onnxruntime::Model> model = CNTKToONNX::CreateModel(src, filepath, useExternalFilesToStoreParameters);
+    if (optimizeGraph || dataType == DataType::Float16)
+    {
+        onnx::ModelProto modelProto = model->ToProto();
+        if (optimizeGraph)
+            ONNXGraphOptimizer::Optimize(modelProto);
+        if (dataType == DataType::Float16)
+            ONNXGraphOptimizer::ConvertToFloat16(modelProto);
+
+        // loading the rewritten model resolves and checks its graph again
+        onnxruntime::common::Status status = onnxruntime::Model::Load(modelProto, model);
+        if (!status.IsOK())
+            LogicError("ONNX export: the optimized model is invalid: '%s'", status.ErrorMessage().c_str());
+    }
+
 #ifdef _WIN32
     onnxruntime::Model::Save(*model, filepath);
 #else
@@ -118,6 +139,15 @@ FunctionPtr ONNXFormat::Load(const std::wstring& filepath, const DeviceDescripto
     if (!loadStatus.IsOK())
         LogicError("Failed to load model: '%s'", loadStatus.ErrorMessage().c_str());
 
+    // the same simplifications as on export, e.g. of the Transposes and Reshapes around the sequence and batch axes
+    onnx::ModelProto modelProto = model->ToProto();
+    if (ONNXGraphOptimizer::Optimize(modelProto))
+    {
+        loadStatus = onnxruntime::Model::Load(modelProto, model);
+        if (!loadStatus.IsOK())
+            LogicError("Failed to load model: the optimized model is invalid: '%s'", loadStatus.ErrorMessage().c_str());
+    }
+
     FunctionPtr cntkFunction = ONNXToCNTK::CreateGraph(&model->MainGraph(), computeDevice, ToLegacyString(ToUTF8(filepath)));
     return cntkFunction;
 }
@@ -14,7 +14,8 @@ namespace CNTK
     class ONNXFormat
     {
     public:
-        static void Save(const FunctionPtr& src, const std::wstring& filepath, bool useExternalFilesToStoreParameters = false);
+        static void Save(const FunctionPtr& src, const std::wstring& filepath, bool useExternalFilesToStoreParameters = false,
+            bool optimizeGraph = false, DataType dataType = DataType::Unknown);
         static FunctionPtr Load(const std::wstring& filepath, const DeviceDescriptor& computeDevice = DeviceDescriptor::UseDefaultDevice());
     private:
         static void InitializeLotusIR();
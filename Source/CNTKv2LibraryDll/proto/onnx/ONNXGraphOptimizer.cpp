@@ -0,0 +1,652 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "core/graph/onnx_protobuf.h"
+
+#include "ONNXGraphOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace CNTK;
+using namespace onnx;
+
+namespace
+{
+    const AttributeProto* FindAttribute(const NodeProto& node, const std::string& name)
+    {
+        for (const auto& attribute : node.attribute())
+            if (attribute.name() == name)
+                return &attribute;
+        return nullptr;
+    }
+
+    size_t NumElements(const TensorProto& tensor)
+    {
+        size_t count = 1;
+        for (auto dim : tensor.dims())
+            count *= (size_t)dim;
+        return count;
+    }
+
+    // Reads the values of a float tensor that is stored in the model; false if it is in an external file
+    bool GetFloatValues(const TensorProto& tensor, std::vector<float>& values)
+    {
+        if (tensor.data_type() != TensorProto_DataType_FLOAT || tensor.data_location() == TensorProto_DataLocation_EXTERNAL)
+            return false;
+
+        size_t count = NumElements(tensor);
+        if (tensor.float_data_size() > 0)
+            values.assign(tensor.float_data().begin(), tensor.float_data().end());
+        else if (tensor.raw_data().size() == count * sizeof(float))
+        {
+            values.resize(count);
+            if (count > 0)
+                memcpy(values.data(), tensor.raw_data().data(), count * sizeof(float));
+        }
+        else
+            return false;
+        return values.size() == count;
+    }
+
+    void SetFloatValues(TensorProto& tensor, const std::vector<float>& values)
+    {
+        tensor.clear_float_data();
+        tensor.set_raw_data(values.data(), values.size() * sizeof(float));
+    }
+
+    bool GetInt64Values(const TensorProto& tensor, std::vector<int64_t>& values)
+    {
+        if (tensor.data_type() != TensorProto_DataType_INT64 || tensor.data_location() == TensorProto_DataLocation_EXTERNAL)
+            return false;
+
+        size_t count = NumElements(tensor);
+        if (tensor.int64_data_size() > 0)
+            values.assign(tensor.int64_data().begin(), tensor.int64_data().end());
+        else if (tensor.raw_data().size() == count * sizeof(int64_t))
+        {
+            values.resize(count);
+            if (count > 0)
+                memcpy(values.data(), tensor.raw_data().data(), count * sizeof(int64_t));
+        }
+        else
+            return false;
+        return values.size() == count;
+    }
+
+    // Collects the names that the nodes of a subgraph read, which may be values of the enclosing graph.
+    void CollectSubgraphInputs(const NodeProto& node, std::unordered_set<std::string>& names)
+    {
+        auto collect = [&names](const GraphProto& subgraph) {
+            for (const auto& subgraphNode : subgraph.node())
+            {
+                for (const auto& input : subgraphNode.input())
+                    names.insert(input);
+                CollectSubgraphInputs(subgraphNode, names);
+            }
+        };
+        for (const auto& attribute : node.attribute())
+        {
+            if (attribute.has_g())
+                collect(attribute.g());
+            for (const auto& subgraph : attribute.graphs())
+                collect(subgraph);
+        }
+    }
+
+    //
+    // Applies the rewrites to one graph. Each sweep visits the nodes once, in their topological order; a node that
+    // was changed in a sweep is not matched again before the next one, so the index of producers and consumers
+    // only needs to be rebuilt between sweeps.
+    //
+    class GraphRewriter
+    {
+    public:
+        GraphRewriter(GraphProto& graph, int64_t opsetVersion)
+            : m_graph(graph), m_opsetVersion(opsetVersion)
+        {
+        }
+
+        bool Sweep()
+        {
+            BuildIndex();
+
+            bool changed = false;
+            for (int i = 0; i < m_graph.node_size(); i++)
+            {
+                if (m_removed[i] || m_touched[i])
+                    continue;
+
+                const std::string& opType = m_graph.node(i).op_type();
+                if (opType == "Identity")
+                    changed |= EliminateIdentity(i);
+                else if (opType == "Transpose")
+                    changed |= EliminateTranspose(i);
+                else if (opType == "Reshape")
+                    changed |= EliminateReshape(i);
+                else if (opType == "BatchNormalization")
+                    changed |= FoldConvBatchNormalization(i);
+                else if (opType == "MatMul")
+                    changed |= FuseMatMulAdd(i);
+            }
+
+            if (changed)
+                Compact();
+            return changed;
+        }
+
+        // Removes the initializers (and their graph inputs) that no node reads anymore.
+        void RemoveUnusedInitializers()
+        {
+            BuildIndex();
+
+            std::unordered_set<std::string> unused;
+            for (const auto& initializer : m_graph.initializer())
+            {
+                if (m_consumers.find(initializer.name()) == m_consumers.end() && m_keptNames.find(initializer.name()) == m_keptNames.end())
+                    unused.insert(initializer.name());
+            }
+            if (unused.empty())
+                return;
+
+            google::protobuf::RepeatedPtrField<TensorProto> initializers;
+            for (auto& initializer : *m_graph.mutable_initializer())
+                if (unused.find(initializer.name()) == unused.end())
+                    initializers.Add()->Swap(&initializer);
+            m_graph.mutable_initializer()->Swap(&initializers);
+
+            google::protobuf::RepeatedPtrField<ValueInfoProto> inputs;
+            for (auto& input : *m_graph.mutable_input())
+                if (unused.find(input.name()) == unused.end())
+                    inputs.Add()->Swap(&input);
+            m_graph.mutable_input()->Swap(&inputs);
+        }
+
+    private:
+        void BuildIndex()
+        {
+            m_producers.clear();
+            m_consumers.clear();
+            m_initializers.clear();
+            m_types.clear();
+            m_keptNames.clear();
+            m_removed.assign(m_graph.node_size(), false);
+            m_touched.assign(m_graph.node_size(), false);
+
+            for (int i = 0; i < m_graph.node_size(); i++)
+            {
+                const NodeProto& node = m_graph.node(i);
+                for (const auto& output : node.output())
+                    m_producers[output] = i;
+                for (const auto& input : node.input())
+                    if (!input.empty())
+                        m_consumers[input].push_back(i);
+                CollectSubgraphInputs(node, m_keptNames);
+            }
+
+            for (auto& initializer : *m_graph.mutable_initializer())
+                m_initializers[initializer.name()] = &initializer;
+            for (const auto& output : m_graph.output())
+            {
+                m_keptNames.insert(output.name());
+                m_types[output.name()] = &output.type();
+            }
+            for (const auto& input : m_graph.input())
+                m_types[input.name()] = &input.type();
+            for (const auto& valueInfo : m_graph.value_info())
+                m_types[valueInfo.name()] = &valueInfo.type();
+        }
+
+        void Compact()
+        {
+            google::protobuf::RepeatedPtrField<NodeProto> nodes;
+            for (int i = 0; i < m_graph.node_size(); i++)
+                if (!m_removed[i])
+                    nodes.Add()->Swap(m_graph.mutable_node(i));
+            m_graph.mutable_node()->Swap(&nodes);
+        }
+
+        bool IsKept(const std::string& name) const
+        {
+            return m_keptNames.find(name) != m_keptNames.end();
+        }
+
+        // The node that produces 'name' if it is read by 'consumer' only and can be removed, otherwise -1.
+        int SoleProducer(const std::string& name, int consumer) const
+        {
+            auto producer = m_producers.find(name);
+            if (producer == m_producers.end() || m_removed[producer->second] || m_touched[producer->second] || IsKept(name))
+                return -1;
+            auto consumers = m_consumers.find(name);
+            if (consumers == m_consumers.end() || consumers->second.size() != 1 || consumers->second[0] != consumer)
+                return -1;
+            return producer->second;
+        }
+
+        TensorProto* Initializer(const NodeProto& node, int inputIndex) const
+        {
+            if (inputIndex >= node.input_size())
+                return nullptr;
+            auto initializer = m_initializers.find(node.input(inputIndex));
+            return initializer == m_initializers.end() ? nullptr : initializer->second;
+        }
+
+        bool IsReadBy(const std::string& name, int node) const
+        {
+            auto consumers = m_consumers.find(name);
+            return consumers != m_consumers.end() && consumers->second.size() == 1 && consumers->second[0] == node && !IsKept(name);
+        }
+
+        // The dimensions of a value, false if its rank is unknown. Dimensions that are not static are -1.
+        bool GetShape(const std::string& name, std::vector<int64_t>& dims) const
+        {
+            auto type = m_types.find(name);
+            if (type == m_types.end() || !type->second->has_tensor_type() || !type->second->tensor_type().has_shape())
+                return false;
+            dims.clear();
+            for (const auto& dim : type->second->tensor_type().shape().dim())
+                dims.push_back(dim.has_dim_value() ? dim.dim_value() : -1);
+            return true;
+        }
+
+        int ElementType(const std::string& name) const
+        {
+            auto type = m_types.find(name);
+            if (type == m_types.end() || !type->second->has_tensor_type())
+                return TensorProto_DataType_UNDEFINED;
+            return type->second->tensor_type().elem_type();
+        }
+
+        // Makes the readers of 'from' read 'to' instead.
+        void Bypass(const std::string& from, const std::string& to)
+        {
+            auto consumers = m_consumers.find(from);
+            if (consumers == m_consumers.end())
+                return;
+            for (int consumer : consumers->second)
+            {
+                NodeProto* node = m_graph.mutable_node(consumer);
+                for (int k = 0; k < node->input_size(); k++)
+                    if (node->input(k) == from)
+                        node->set_input(k, to);
+                m_consumers[to].push_back(consumer);
+            }
+            m_consumers.erase(from);
+        }
+
+        void Remove(int node)
+        {
+            m_removed[node] = true;
+        }
+
+        std::string UniqueName(const std::string& hint) const
+        {
+            std::string name = hint;
+            for (int suffix = 1; m_producers.count(name) || m_initializers.count(name) || m_types.count(name); suffix++)
+                name = hint + "_" + std::to_string(suffix);
+            return name;
+        }
+
+        bool EliminateIdentity(int i)
+        {
+            const NodeProto& node = m_graph.node(i);
+            if (node.input_size() != 1 || node.output_size() != 1 || IsKept(node.output(0)))
+                return false;
+
+            Bypass(node.output(0), node.input(0));
+            Remove(i);
+            return true;
+        }
+
+        bool EliminateTranspose(int i)
+        {
+            NodeProto& node = *m_graph.mutable_node(i);
+            const AttributeProto* perm = FindAttribute(node, "perm");
+            if (!perm || node.input_size() != 1)
+                return false;
+
+            std::vector<int64_t> permutation(perm->ints().begin(), perm->ints().end());
+            auto isIdentity = [](const std::vector<int64_t>& p) {
+                for (size_t k = 0; k < p.size(); k++)
+                    if (p[k] != (int64_t)k)
+                        return false;
+                return true;
+            };
+
+            if (isIdentity(permutation))
+            {
+                if (IsKept(node.output(0)))
+                    return false;
+                Bypass(node.output(0), node.input(0));
+                Remove(i);
+                return true;
+            }
+
+            int p = SoleProducer(node.input(0), i);
+            if (p < 0 || m_graph.node(p).op_type() != "Transpose")
+                return false;
+            const NodeProto& first = m_graph.node(p);
+            const AttributeProto* firstPerm = FindAttribute(first, "perm");
+            if (!firstPerm || firstPerm->ints_size() != (int)permutation.size())
+                return false;
+
+            // y[k] = x[firstPerm[perm[k]]]
+            std::vector<int64_t> composed(permutation.size());
+            for (size_t k = 0; k < permutation.size(); k++)
+            {
+                if (permutation[k] < 0 || permutation[k] >= (int64_t)permutation.size())
+                    return false;
+                composed[k] = firstPerm->ints((int)permutation[k]);
+            }
+
+            if (isIdentity(composed))
+            {
+                if (IsKept(node.output(0)))
+                    return false;
+                Bypass(node.output(0), first.input(0));
+                Remove(i);
+            }
+            else
+            {
+                node.set_input(0, first.input(0));
+                m_consumers[first.input(0)].push_back(i);
+                for (auto& attribute : *node.mutable_attribute())
+                {
+                    if (attribute.name() == "perm")
+                    {
+                        attribute.clear_ints();
+                        for (auto axis : composed)
+                            attribute.add_ints(axis);
+                    }
+                }
+                m_touched[i] = true;
+            }
+            Remove(p);
+            return true;
+        }
+
+        bool EliminateReshape(int i)
+        {
+            NodeProto& node = *m_graph.mutable_node(i);
+
+            // a Reshape to the shape of its input does nothing
+            std::vector<int64_t> inputShape, outputShape;
+            if (!IsKept(node.output(0)) && GetShape(node.input(0), inputShape) && GetShape(node.output(0), outputShape) &&
+                inputShape == outputShape && std::find(inputShape.begin(), inputShape.end(), -1) == inputShape.end())
+            {
+                Bypass(node.output(0), node.input(0));
+                Remove(i);
+                return true;
+            }
+
+            // a Reshape of a Reshape only needs the input of the first one, unless it copies dimensions of it (0 in the shape)
+            int p = SoleProducer(node.input(0), i);
+            if (p < 0 || m_graph.node(p).op_type() != "Reshape")
+                return false;
+
+            std::vector<int64_t> shape;
+            const AttributeProto* shapeAttribute = FindAttribute(node, "shape");
+            if (shapeAttribute)
+                shape.assign(shapeAttribute->ints().begin(), shapeAttribute->ints().end());
+            else
+            {
+                TensorProto* shapeTensor = Initializer(node, 1);
+                if (!shapeTensor || !GetInt64Values(*shapeTensor, shape))
+                    return false;
+            }
+            if (std::find(shape.begin(), shape.end(), 0) != shape.end())
+                return false;
+
+            const std::string& input = m_graph.node(p).input(0);
+            node.set_input(0, input);
+            m_consumers[input].push_back(i);
+            m_touched[i] = true;
+            Remove(p);
+            return true;
+        }
+
+        // Conv (x, W, B) followed by BatchNormalization (scale, bias, mean, var) with constant parameters is
+        // Conv (x, W * s, (B - mean) * s + bias) with s = scale / sqrt(var + epsilon) per output channel.
+        bool FoldConvBatchNormalization(int i)
+        {
+            const NodeProto& batchNorm = m_graph.node(i);
+            for (int k = 1; k < batchNorm.output_size(); k++)
+                if (!batchNorm.output(k).empty())
+                    return false; // computes the statistics (training mode)
+            const AttributeProto* spatial = FindAttribute(batchNorm, "spatial");
+            if (spatial && spatial->i() != 1)
+                return false;
+            const AttributeProto* epsilonAttribute = FindAttribute(batchNorm, "epsilon");
+            float epsilon = epsilonAttribute ? epsilonAttribute->f() : 1e-5f;
+
+            int c = SoleProducer(batchNorm.input(0), i);
+            if (c < 0 || m_graph.node(c).op_type() != "Conv" || m_graph.node(c).output_size() != 1)
+                return false;
+            NodeProto& conv = *m_graph.mutable_node(c);
+
+            TensorProto* weights = Initializer(conv, 1);
+            TensorProto* bias = conv.input_size() > 2 && !conv.input(2).empty() ? Initializer(conv, 2) : nullptr;
+            if (!weights || weights->dims_size() < 1 || !IsReadBy(weights->name(), c) || (conv.input_size() > 2 && !conv.input(2).empty() && (!bias || !IsReadBy(bias->name(), c))))
+                return false;
+
+            std::vector<float> scale, shift, mean, variance, w, b;
+            TensorProto* parameters[] = { Initializer(batchNorm, 1), Initializer(batchNorm, 2), Initializer(batchNorm, 3), Initializer(batchNorm, 4) };
+            for (auto parameter : parameters)
+                if (!parameter)
+                    return false;
+            if (!GetFloatValues(*parameters[0], scale) || !GetFloatValues(*parameters[1], shift) || !GetFloatValues(*parameters[2], mean) ||
+                !GetFloatValues(*parameters[3], variance) || !GetFloatValues(*weights, w))
+                return false;
+
+            const size_t numChannels = (size_t)weights->dims(0);
+            if (numChannels == 0 || scale.size() != numChannels || shift.size() != numChannels || mean.size() != numChannels || variance.size() != numChannels)
+                return false;
+            if (bias)
+            {
+                if (!GetFloatValues(*bias, b) || b.size() != numChannels)
+                    return false;
+            }
+            else
+                b.assign(numChannels, 0.0f);
+
+            const size_t channelSize = w.size() / numChannels;
+            for (size_t o = 0; o < numChannels; o++)
+            {
+                float s = scale[o] / sqrt(variance[o] + epsilon);
+                for (size_t k = 0; k < channelSize; k++)
+                    w[o * channelSize + k] *= s;
+                b[o] = (b[o] - mean[o]) * s + shift[o];
+            }
+            SetFloatValues(*weights, w);
+
+            if (!bias)
+            {
+                bias = m_graph.add_initializer();
+                bias->set_name(UniqueName(weights->name() + "_bias"));
+                bias->set_data_type(TensorProto_DataType_FLOAT);
+                bias->add_dims((int64_t)numChannels);
+                m_initializers[bias->name()] = bias;
+
+                // models of IR version 3 also list the initializers among the graph inputs
+                for (const auto& input : m_graph.input())
+                {
+                    if (input.name() == weights->name())
+                    {
+                        ValueInfoProto* biasInput = m_graph.add_input();
+                        biasInput->set_name(bias->name());
+                        auto tensorType = biasInput->mutable_type()->mutable_tensor_type();
+                        tensorType->set_elem_type(TensorProto_DataType_FLOAT);
+                        tensorType->mutable_shape()->add_dim()->set_dim_value((int64_t)numChannels);
+                        break;
+                    }
+                }
+
+                while (conv.input_size() < 2)
+                    conv.add_input("");
+                if (conv.input_size() == 2)
+                    conv.add_input(bias->name());
+                else
+                    conv.set_input(2, bias->name());
+            }
+            SetFloatValues(*bias, b);
+
+            conv.set_output(0, batchNorm.output(0));
+            m_producers[batchNorm.output(0)] = c;
+            m_touched[c] = true;
+            Remove(i);
+            return true;
+        }
+
+        // MatMul (A, B) followed by Add of a constant bias C, with A a matrix and B a constant matrix, is Gemm (A, B, C)
+        bool FuseMatMulAdd(int i)
+        {
+            NodeProto& matMul = *m_graph.mutable_node(i);
+            std::vector<int64_t> shape;
+            int elementType = ElementType(matMul.input(0));
+            if (!GetShape(matMul.input(0), shape) || shape.size() != 2 ||
+                (elementType != TensorProto_DataType_FLOAT && elementType != TensorProto_DataType_FLOAT16 && elementType != TensorProto_DataType_DOUBLE))
+                return false;
+
+            TensorProto* weights = Initializer(matMul, 1);
+            if (!weights || weights->dims_size() != 2)
+                return false;
+            const int64_t numOutputs = weights->dims(1);
+
+            auto consumers = m_consumers.find(matMul.output(0));
+            if (IsKept(matMul.output(0)) || consumers == m_consumers.end() || consumers->second.size() != 1)
+                return false;
+            int a = consumers->second[0];
+            if (m_removed[a] || m_touched[a] || m_graph.node(a).op_type() != "Add" || m_graph.node(a).input_size() != 2)
+                return false;
+            const NodeProto& add = m_graph.node(a);
+            if (FindAttribute(add, "broadcast") || FindAttribute(add, "axis"))
+                return false; // the legacy broadcasting of Add is not that of Gemm
+
+            int biasIndex = add.input(0) == matMul.output(0) ? 1 : 0;
+            TensorProto* bias = Initializer(add, biasIndex);
+            if (!bias || bias->dims_size() < 1 || bias->dims_size() > 2 || bias->dims(bias->dims_size() - 1) != numOutputs ||
+                (bias->dims_size() == 2 && bias->dims(0) != 1))
+                return false;
+
+            matMul.set_op_type("Gemm");
+            matMul.add_input(bias->name());
+            matMul.set_output(0, add.output(0));
+            if (m_opsetVersion < 7)
+            {
+                AttributeProto* broadcast = matMul.add_attribute();
+                broadcast->set_name("broadcast");
+                broadcast->set_type(AttributeProto_AttributeType_INT);
+                broadcast->set_i(1);
+            }
+            m_consumers[bias->name()].push_back(i);
+            m_producers[add.output(0)] = i;
+            m_touched[i] = true;
+            Remove(a);
+            return true;
+        }
+
+        GraphProto& m_graph;
+        int64_t m_opsetVersion;
+
+        std::unordered_map<std::string, int> m_producers;
+        std::unordered_map<std::string, std::vector<int>> m_consumers;
+        std::unordered_map<std::string, TensorProto*> m_initializers;
+        std::unordered_map<std::string, const TypeProto*> m_types;
+        std::unordered_set<std::string> m_keptNames; // graph outputs and values read by subgraphs
+        std::vector<bool> m_removed;
+        std::vector<bool> m_touched;
+    };
+
+    void ConvertTypeToFloat16(TypeProto& type)
+    {
+        if (type.has_tensor_type() && type.tensor_type().elem_type() == TensorProto_DataType_FLOAT)
+            type.mutable_tensor_type()->set_elem_type(TensorProto_DataType_FLOAT16);
+        if (type.has_sequence_type())
+            ConvertTypeToFloat16(*type.mutable_sequence_type()->mutable_elem_type());
+        if (type.has_map_type())
+            ConvertTypeToFloat16(*type.mutable_map_type()->mutable_value_type());
+    }
+
+    void ConvertTensorToFloat16(TensorProto& tensor)
+    {
+        if (tensor.data_type() != TensorProto_DataType_FLOAT)
+            return;
+
+        std::vector<float> values;
+        if (!GetFloatValues(tensor, values))
+            CNTK::InvalidArgument("ONNX float16 export: the float tensor '%s' cannot be converted, its values are stored in an external file.", tensor.name().c_str());
+
+        std::vector<uint16_t> halfValues(values.size());
+        for (size_t k = 0; k < values.size(); k++)
+        {
+            float16 h(values[k]);
+            memcpy(&halfValues[k], &h, sizeof(uint16_t));
+        }
+        tensor.clear_float_data();
+        tensor.set_data_type(TensorProto_DataType_FLOAT16);
+        tensor.set_raw_data(halfValues.data(), halfValues.size() * sizeof(uint16_t));
+    }
+
+    void ConvertGraphToFloat16(GraphProto& graph)
+    {
+        for (auto& initializer : *graph.mutable_initializer())
+            ConvertTensorToFloat16(initializer);
+        for (auto& input : *graph.mutable_input())
+            ConvertTypeToFloat16(*input.mutable_type());
+        for (auto& output : *graph.mutable_output())
+            ConvertTypeToFloat16(*output.mutable_type());
+        for (auto& valueInfo : *graph.mutable_value_info())
+            ConvertTypeToFloat16(*valueInfo.mutable_type());
+
+        for (auto& node : *graph.mutable_node())
+        {
+            for (auto& attribute : *node.mutable_attribute())
+            {
+                if (attribute.has_t())
+                    ConvertTensorToFloat16(*attribute.mutable_t());
+                for (auto& tensor : *attribute.mutable_tensors())
+                    ConvertTensorToFloat16(tensor);
+                if (attribute.has_g())
+                    ConvertGraphToFloat16(*attribute.mutable_g());
+                for (auto& subgraph : *attribute.mutable_graphs())
+                    ConvertGraphToFloat16(subgraph);
+
+                // the element type of Cast and of the generator ops (RandomNormal, EyeLike, ...)
+                if ((attribute.name() == "to" || attribute.name() == "dtype") && attribute.type() == AttributeProto_AttributeType_INT &&
+                    attribute.i() == TensorProto_DataType_FLOAT)
+                    attribute.set_i(TensorProto_DataType_FLOAT16);
+            }
+        }
+    }
+
+    int64_t DefaultOpsetVersion(const ModelProto& model)
+    {
+        for (const auto& opset : model.opset_import())
+            if (opset.domain().empty() || opset.domain() == "ai.onnx")
+                return opset.version();
+        return 1;
+    }
+}
+
+bool ONNXGraphOptimizer::Optimize(ModelProto& model)
+{
+    GraphRewriter rewriter(*model.mutable_graph(), DefaultOpsetVersion(model));
+
+    bool changed = false;
+    while (rewriter.Sweep())
+        changed = true;
+
+    if (changed)
+        rewriter.RemoveUnusedInitializers();
+    return changed;
+}
+
+void ONNXGraphOptimizer::ConvertToFloat16(ModelProto& model)
+{
+    ConvertGraphToFloat16(*model.mutable_graph());
+}
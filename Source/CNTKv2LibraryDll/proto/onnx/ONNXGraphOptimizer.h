@@ -0,0 +1,37 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "stdafx.h"
+#include "CNTKLibrary.h"
+
+namespace onnx
+{
+    class ModelProto;
+}
+
+namespace CNTK
+{
+    class ONNXGraphOptimizer
+    {
+    public:
+        //
+        // Simplifies the main graph of an ONNX model for inference, in place: removes Identity nodes,
+        // identity and inverse Transpose pairs and chained Reshapes (e.g. those the exporter emits around
+        // the sequence and batch axes), folds BatchNormalization into the preceding Conv and fuses
+        // MatMul+Add into Gemm when the weights are initializers. The names of the graph inputs and
+        // outputs are kept. Returns whether the graph was changed.
+        //
+        static bool Optimize(onnx::ModelProto& model);
+
+        //
+        // Converts all float tensors of an ONNX model to float16: the initializers, constants,
+        // the types of the graph inputs, outputs and values, and the targets of Cast nodes.
+        // Initializers stored in external files are not supported.
+        //
+        static void ConvertToFloat16(onnx::ModelProto& model);
+    };
+}
@@ -3008,6 +3008,25 @@ FunctionPtr ONNXToCNTKHelper::CreateFunction(const Node *node, const std::vector
 
         return MeanVarianceNormalization(inputOperand0, acrossChannels, /*normalizeVariance=*/ true, ToFixedWStringFromMultiByte(node->Name()));
     }
+    else if (onnxOpName == "LayerNormalization")
+    {
+        // CNTK normalizes each sample over all its static axes. The ONNX op normalizes over the axes from 'axis' to the last one,
+        // which, in the reversed CNTK order, must be all the static axes of the input.
+        int64_t axis = GetNamedAttributeAsInt64(node, "axis", (size_t)-1);
+        double epsilon = static_cast<double>(GetNamedAttributeAsFloat(node, "epsilon", 0.00001f));
+        int64_t staticRank = static_cast<int64_t>(inputOperand0.Shape().Rank());
+        int64_t onnxRank = staticRank + static_cast<int64_t>(inputOperand0.DynamicAxes().size());
+        if (axis < 0)
+            axis += onnxRank;
+        if (axis < 0 || onnxRank - axis != staticRank)
+            LogicError("LayerNormalization: cntk supports only normalizing over all the static axes of the input. Other axes combinations are not supported");
+        if (inputs.size() < 2)
+            LogicError("LayerNormalization: the Scale input is required.");
+
+        // The bias is optional in ONNX.
+        Variable bias = inputs.size() > 2 ? inputs[2] : Constant(inputs[1].Shape(), inputs[1].GetDataType(), 0.0);
+        return LayerNormalization(inputOperand0, inputs[1], bias, epsilon, ToFixedWStringFromMultiByte(node->Name()));
+    }
     else if (onnxOpName == "Identity")
     {
         FunctionPtr cntkFunction = Alias(inputs[0], ToFixedWStringFromMultiByte(node->Name()));
@@ -6,12 +6,19 @@
 #include "stdafx.h"
 #include "CNTKLibraryInternals.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <condition_variable>
 #include <cstdint>
 #include <cstring>
 #include <ctime>
+#include <deque>
 #include <iomanip>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
 #pragma warning(push)
 #pragma warning(disable : 4244 4245)
@@ -76,18 +83,129 @@ namespace CNTK
             return record;
         }
 
-        TensorBoardFileWriter::TensorBoardFileWriter(const std::wstring& dir, const FunctionPtr& modelToVisualize)
+        // Runs the writes of a TensorBoardFileWriter on a thread of its own. The writes that are queued while the
+        // thread is busy are run as one batch, which is followed by a single flush of the file.
+        class TensorBoardFileWriter::BackgroundWriter
+        {
+        public:
+            explicit BackgroundWriter(TensorBoardFileWriter& owner)
+                : m_owner(owner), m_stop(false), m_busy(false), m_success(true), m_thread([this] { Run(); })
+            {
+            }
+
+            ~BackgroundWriter()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_stop = true;
+                }
+                m_wakeUp.notify_all();
+                m_thread.join();
+            }
+
+            void Post(std::function<void()>&& write)
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                // A caller that writes faster than the disk waits here, rather than piling up records without bound.
+                m_done.wait(lock, [this] { return m_queue.size() < MaxQueueLength; });
+                m_queue.push_back(std::move(write));
+                m_wakeUp.notify_one();
+            }
+
+            // Waits for the writes posted so far. Returns false if any write failed since the last call.
+            bool Drain()
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_done.wait(lock, [this] { return m_queue.empty() && !m_busy; });
+                bool success = m_success;
+                m_success = true;
+                return success;
+            }
+
+        private:
+            static const size_t MaxQueueLength = 4096;
+
+            void Run()
+            {
+                std::vector<std::function<void()>> batch;
+                for (;;)
+                {
+                    {
+                        std::unique_lock<std::mutex> lock(m_mutex);
+                        m_busy = false;
+                        m_done.notify_all();
+                        m_wakeUp.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+                        if (m_queue.empty())
+                            return;
+
+                        batch.assign(std::make_move_iterator(m_queue.begin()), std::make_move_iterator(m_queue.end()));
+                        m_queue.clear();
+                        m_busy = true;
+                        m_done.notify_all(); // room in the queue
+                    }
+
+                    bool success = true;
+                    for (auto& write : batch)
+                    {
+                        try
+                        {
+                            write();
+                        }
+                        catch (const std::exception& e)
+                        {
+                            fprintf(stderr, "TensorBoardFileWriter: Writing a record in the background failed: %s\n", e.what());
+                            success = false;
+                        }
+                    }
+                    batch.clear();
+
+                    if (m_owner.m_file != NULL && !m_owner.FlushFile())
+                        success = false;
+
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_success = m_success && success;
+                }
+            }
+
+            TensorBoardFileWriter& m_owner;
+            std::mutex m_mutex;
+            std::condition_variable m_wakeUp; // the queue or m_stop changed
+            std::condition_variable m_done;   // the queue shrank or the thread became idle
+            std::deque<std::function<void()>> m_queue;
+            bool m_stop;
+            bool m_busy;    // running a batch
+            bool m_success; // no write failed since the last Drain()
+            std::thread m_thread;
+        };
+
+        TensorBoardFileWriter::TensorBoardFileWriter(const std::wstring& dir, const FunctionPtr& modelToVisualize, bool writeInBackground)
             : m_model(modelToVisualize),
             m_dir(dir),
             m_file(NULL),
             m_fileName()
         {
+            if (writeInBackground)
+                m_background.reset(new BackgroundWriter(*this));
         }
 
         TensorBoardFileWriter::TensorBoardFileWriter(const std::wstring& dir,
-                                                     const ::Microsoft::MSR::CNTK::ComputationNetworkPtr& modelToVisualize)
-            : TensorBoardFileWriter(dir, ConvertFromLegacyModel(modelToVisualize))
+                                                     const ::Microsoft::MSR::CNTK::ComputationNetworkPtr& modelToVisualize,
+                                                     bool writeInBackground)
+            : TensorBoardFileWriter(dir, ConvertFromLegacyModel(modelToVisualize), writeInBackground)
+        {
+        }
+
+        TensorBoardFileWriter::~TensorBoardFileWriter()
+        {
+            Close();
+        }
+
+        void TensorBoardFileWriter::Post(std::function<void()>&& write)
         {
+            if (m_background)
+                m_background->Post(std::move(write));
+            else
+                write();
         }
 
         void TensorBoardFileWriter::Init()
@@ -114,16 +232,149 @@ namespace CNTK
 
         void TensorBoardFileWriter::WriteValue(const std::wstring& name, float value, uint64_t step)
         {
-            tensorflow::Event event;
-            event.set_step(step);
-            event.set_wall_time(static_cast<double>(std::time(0)));
+            const auto wallTime = std::time(0);
+            Post([this, name, value, step, wallTime]()
+            {
+                tensorflow::Event event;
+                event.set_step(step);
+                event.set_wall_time(static_cast<double>(wallTime));
 
-            tensorflow::Summary* summary = event.mutable_summary();
-            tensorflow::Summary::Value* summaryValue = summary->add_value();
-            summaryValue->set_tag(ToLegacyString(ToUTF8(name)));
-            summaryValue->set_simple_value(value);
+                tensorflow::Summary* summary = event.mutable_summary();
+                tensorflow::Summary::Value* summaryValue = summary->add_value();
+                summaryValue->set_tag(ToLegacyString(ToUTF8(name)));
+                summaryValue->set_simple_value(value);
 
-            WriteRecord(Serialize(event));
+                WriteRecord(Serialize(event));
+            });
+        }
+
+        // The data to write later on the background thread. A copy on the same device does not wait for a GPU.
+        static NDArrayViewPtr Snapshot(const NDArrayViewPtr& data, bool inBackground)
+        {
+            return inBackground ? data->DeepClone(data->Device(), /*readOnly=*/ false) : data;
+        }
+
+        static NDArrayViewPtr OnCPU(const NDArrayViewPtr& data)
+        {
+            return data->Device() == DeviceDescriptor::CPUDevice() ? data : data->DeepClone(DeviceDescriptor::CPUDevice(), /*readOnly=*/ false);
+        }
+
+        void TensorBoardFileWriter::SetHistogramBucketLimits(const std::vector<double>& bucketLimits)
+        {
+            if (bucketLimits.empty())
+                InvalidArgument("TensorBoardFileWriter: Histograms need at least one bucket limit.");
+            if (!std::is_sorted(bucketLimits.begin(), bucketLimits.end()) ||
+                std::adjacent_find(bucketLimits.begin(), bucketLimits.end()) != bucketLimits.end())
+                InvalidArgument("TensorBoardFileWriter: The bucket limits of histograms must be ascending.");
+
+            m_bucketLimits = bucketLimits;
+            m_deviceBucketLimits.clear();
+        }
+
+        // Reads the result of Utils::HistogramOf(), which the GPU may still be computing.
+        template <typename ElementType>
+        static void ReadHistogram(const NDArrayViewPtr& deviceHistogram, std::vector<double>& histogram)
+        {
+            auto copy = deviceHistogram->DeepClone(DeviceDescriptor::CPUDevice(), /*readOnly=*/ true);
+            const ElementType* buffer = copy->DataBuffer<ElementType>();
+            histogram.assign(buffer, buffer + copy->Shape().TotalSize());
+        }
+
+        void TensorBoardFileWriter::WriteHistogram(const std::wstring& name, const NDArrayViewPtr& data, uint64_t step)
+        {
+            if (!data)
+                InvalidArgument("TensorBoardFileWriter: The data of histogram '%S' is null.", name.c_str());
+            const DataType dtype = data->GetDataType();
+            if (dtype != DataType::Float && dtype != DataType::Double)
+                InvalidArgument("TensorBoardFileWriter: Histogram '%S' of data type %s is not supported.", name.c_str(), DataTypeName(dtype));
+
+            if (m_bucketLimits.empty())
+                m_bucketLimits = DefaultHistogramBucketLimits();
+
+            // the bucket limits are copied to each device once
+            auto& bucketLimits = m_deviceBucketLimits[data->Device().AsString() + L"/" + std::to_wstring((int)dtype)];
+            if (!bucketLimits)
+            {
+                NDShape shape({ m_bucketLimits.size() });
+                if (dtype == DataType::Float)
+                {
+                    std::vector<float> limits(m_bucketLimits.begin(), m_bucketLimits.end());
+                    bucketLimits = NDArrayView(dtype, shape, limits.data(), limits.size() * sizeof(float), DeviceDescriptor::CPUDevice()).DeepClone(data->Device(), /*readOnly=*/ true);
+                }
+                else
+                    bucketLimits = NDArrayView(dtype, shape, m_bucketLimits.data(), m_bucketLimits.size() * sizeof(double), DeviceDescriptor::CPUDevice()).DeepClone(data->Device(), /*readOnly=*/ true);
+            }
+
+            // One pass over the data on its device, queued behind the work that computes it. The few numbers of the result
+            // are read back on the background thread, if any, so that the caller does not wait for the device.
+            const auto deviceHistogram = dtype == DataType::Float ? Utils::HistogramOf<float>(data, bucketLimits) : Utils::HistogramOf<double>(data, bucketLimits);
+            const auto wallTime = std::time(0);
+            const auto& limits = m_bucketLimits;
+            Post([this, name, deviceHistogram, limits, step, dtype, wallTime]()
+            {
+                std::vector<double> result;
+                if (dtype == DataType::Float)
+                    ReadHistogram<float>(deviceHistogram, result);
+                else
+                    ReadHistogram<double>(deviceHistogram, result);
+                const size_t numBuckets = limits.size() + 1;
+
+                tensorflow::Event event;
+                event.set_step(step);
+                event.set_wall_time(static_cast<double>(wallTime));
+                tensorflow::Summary::Value* summaryValue = event.mutable_summary()->add_value();
+                summaryValue->set_tag(ToLegacyString(ToUTF8(name)));
+                tensorflow::HistogramProto* histogram = summaryValue->mutable_histo();
+
+                double num = 0;
+                for (size_t i = 0; i < numBuckets; i++)
+                    num += result[i];
+                histogram->set_min(num > 0 ? result[numBuckets + 2] : 0);
+                histogram->set_max(num > 0 ? result[numBuckets + 3] : 0);
+                histogram->set_num(num);
+                histogram->set_sum(result[numBuckets]);
+                histogram->set_sum_squares(result[numBuckets + 1]);
+                // As TensorFlow does, of a run of empty buckets only the last one is kept, since it spans the whole run.
+                for (size_t i = 0; i < numBuckets; i++)
+                {
+                    if (result[i] <= 0 && i + 1 < numBuckets && result[i + 1] <= 0)
+                        continue;
+                    histogram->add_bucket_limit(i < limits.size() ? limits[i] : DBL_MAX);
+                    histogram->add_bucket(result[i]);
+                }
+
+                WriteRecord(Serialize(event));
+            });
+        }
+
+        void TensorBoardFileWriter::WriteParameterHistograms(const FunctionPtr& model, uint64_t step, uint64_t frequency)
+        {
+            if (!model)
+                InvalidArgument("TensorBoardFileWriter: The model to write the parameter histograms of is null.");
+            if (frequency == 0)
+                InvalidArgument("TensorBoardFileWriter: The frequency of the parameter histograms must be positive.");
+            if (step % frequency != 0)
+                return;
+
+            for (const auto& parameter : model->Parameters())
+                WriteHistogram((parameter.Name().empty() ? parameter.Uid() : parameter.Name()) + L"/value", parameter.Value(), step);
+        }
+
+        void TensorBoardFileWriter::WriteGPUMemoryTelemetry(int deviceId, uint64_t step)
+        {
+            const auto telemetry = GetGPUMemoryTelemetry(deviceId);
+            const std::wstring prefix = L"gpu" + std::to_wstring(deviceId) + L"/memory/";
+            const float bytesPerMB = 1 << 20;
+
+            WriteValue(prefix + L"inUseMB", telemetry.bytesInUse / bytesPerMB, step);
+            WriteValue(prefix + L"cachedMB", telemetry.bytesCached / bytesPerMB, step);
+            WriteValue(prefix + L"peakInUseMB", telemetry.peakBytesInUse / bytesPerMB, step);
+            WriteValue(prefix + L"peakReservedMB", telemetry.peakBytesReserved / bytesPerMB, step);
+            WriteValue(prefix + L"fragmentation", (float)telemetry.fragmentation, step);
+            for (const auto& category : telemetry.bytesInUseByCategory)
+                WriteValue(prefix + category.first + L"MB", category.second / bytesPerMB, step);
+            for (const auto& category : telemetry.peakBytesInUseByCategory)
+                WriteValue(prefix + category.first + L"PeakMB", category.second / bytesPerMB, step);
         }
 
         void TensorBoardFileWriter::WriteModel()
@@ -185,8 +436,19 @@ namespace CNTK
         void TensorBoardFileWriter::WriteImage(const std::wstring& name, NDArrayViewPtr imageData, uint64_t step)
         {
             assert(imageData != nullptr);
+            const auto snapshot = Snapshot(imageData, m_background != nullptr);
+            const auto wallTime = std::time(0);
+            Post([this, name, snapshot, step, wallTime]()
+            {
+                WriteImageRecord(name, OnCPU(snapshot), step, wallTime);
+            });
+        }
+
+        void TensorBoardFileWriter::WriteImageRecord(const std::wstring& name, const NDArrayViewPtr& imageData, uint64_t step, time_t wallTime)
+        {
             tensorflow::Event event;
-            event.set_wall_time(static_cast<double>(std::time(0)));
+            event.set_step(step);
+            event.set_wall_time(static_cast<double>(wallTime));
             tensorflow::Summary* summary = event.mutable_summary();
 
             std::vector<size_t> dimensions = imageData->Shape().Dimensions();
@@ -252,6 +514,22 @@ namespace CNTK
         }
 
         bool TensorBoardFileWriter::Flush()
+        {
+            // the background thread flushes after each batch
+            if (m_background)
+                return m_background->Drain() && m_file != NULL;
+            return FlushFile();
+        }
+
+        bool TensorBoardFileWriter::Close()
+        {
+            bool success = true;
+            if (m_background)
+                success = m_background->Drain(); // after which the background thread leaves the file alone
+            return CloseFile() && success;
+        }
+
+        bool TensorBoardFileWriter::FlushFile()
         {
             if (m_file == NULL)
             {
@@ -267,14 +545,14 @@ namespace CNTK
             return true;
         }
 
-        bool TensorBoardFileWriter::Close()
+        bool TensorBoardFileWriter::CloseFile()
         {
             if (m_file == NULL)
             {
                 return false;
             }
 
-            bool success = Flush();
+            bool success = FlushFile();
             if (fclose(m_file))
             {
                 fprintf(stderr,
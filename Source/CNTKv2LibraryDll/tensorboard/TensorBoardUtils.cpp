@@ -263,6 +263,20 @@ namespace CNTK
             }
         }
 
+        std::vector<double> DefaultHistogramBucketLimits()
+        {
+            std::vector<double> positive;
+            for (double limit = 1e-12; limit < 1e20; limit *= 1.1)
+                positive.push_back(limit);
+
+            std::vector<double> limits(positive.rbegin(), positive.rend());
+            for (auto& limit : limits)
+                limit = -limit;
+            limits.push_back(0);
+            limits.insert(limits.end(), positive.begin(), positive.end());
+            return limits;
+        }
+
     #ifndef CNTK_UWP
 
         void WriteImageToBuffer(void* matrix, DataType dtype, int height, int width, int depth, std::vector<unsigned char>& buffer)
@@ -22,6 +22,12 @@ namespace CNTK
         ///
         void CreateTensorBoardGraph(const FunctionPtr& src, tensorflow::GraphDef& dst);
 
+        ///
+        /// The default bucket limits of TensorBoard histograms, as in TensorFlow: 1e-12 * 1.1^k up to 1e20, mirrored for
+        /// the negative values around 0.
+        ///
+        std::vector<double> DefaultHistogramBucketLimits();
+
     #ifndef CNTK_UWP
         void WriteImageToBuffer(void* matrix, DataType dtype, int height, int width, int depth, std::vector<unsigned char>& buffer);
     #endif // !CNTK_UWP
@@ -48,6 +48,9 @@ int bestGPUDummy = 42; // put something into this CPP, as to avoid a linker warn
 
 #include <memory>
 #include "CrossProcessMutex.h"
+#include "GpuTopology.h"
+#include "MPIWrapper.h"
+#include "NumaPolicy.h"
 
 // ---------------------------------------------------------------------------
 // BestGpu class
@@ -114,6 +117,7 @@ public:
     static const int RequeryDevices = -2;                                                     // Requery refreshing statistics and picking the same number as last query
     static const int MininumCCMajorForGpu = 3;                                                // cntk supports GPUs with Compute Capability > 3.0
     std::vector<int> GetDevices(int number = AllDevices, BestGpuFlags flags = bestGpuNormal); // get multiple devices
+    int GetDeviceForRankOnHost(size_t rankOnHost, size_t numRanksOnHost, BestGpuFlags flags);  // place one of several ranks of a host
     std::vector<ProcessorData *> GetProcessorData();
     std::shared_ptr<CrossProcessMutex> GetDeviceLock(int deviceId);
 
@@ -156,7 +160,12 @@ static DEVICEID_TYPE SelectDevice(DEVICEID_TYPE deviceId, bool bLockGPU, const i
                 s_bestGpu->DisallowUnsupportedDevices();
             }
 
-            s_bestDeviceId = (DEVICEID_TYPE)s_bestGpu->GetDevice(BestGpuFlags(bLockGPU ? (bestGpuAvoidSharing | bestGpuExclusiveLock) : bestGpuAvoidSharing));
+            BestGpuFlags flags = BestGpuFlags(bLockGPU ? (bestGpuAvoidSharing | bestGpuExclusiveLock) : bestGpuAvoidSharing);
+            auto mpi = MPIWrapper::GetInstance();
+            if (mpi && mpi->NumNodesOnCurrentHost() > 1)
+                s_bestDeviceId = (DEVICEID_TYPE)s_bestGpu->GetDeviceForRankOnHost(mpi->CurrentNodeRankOnHost(), mpi->NumNodesOnCurrentHost(), flags);
+            else
+                s_bestDeviceId = (DEVICEID_TYPE)s_bestGpu->GetDevice(flags);
             // TODO: Do we need to hold this pointer at all? We will only query it once. Or is it used to hold lock to a GPU?
         }
         // already chosen
@@ -616,6 +625,50 @@ std::vector<int> BestGpu::GetDevices(int number, BestGpuFlags p_bestFlags)
     return best; // return the array of the best GPUs
 }
 
+// GetDeviceForRankOnHost - Place one of several MPI ranks of this host on a GPU
+// The allowed GPUs are ordered in the shortest ring through their NVLink and PCIe connections, and the ranks take them
+// in this order, so that the neighbors in the NCCL rings, which follow the ranks, are the closest GPUs. Each rank also
+// pins its threads to the NUMA node of its GPU, unless a 'numaPolicy' was given. Without enough available GPUs, or
+// without NVML, this falls back to picking the best GPU by its score.
+int BestGpu::GetDeviceForRankOnHost(size_t rankOnHost, size_t numRanksOnHost, BestGpuFlags flags)
+{
+    std::vector<int> candidates;
+    std::vector<nvmlDevice_t> devices;
+    if (m_nvmlData)
+    {
+        for (ProcessorData* pd : m_procData)
+        {
+            nvmlDevice_t device;
+            if (DeviceAllowed(pd->deviceId) && GetNvmlDevice(pd->deviceId, &device))
+            {
+                candidates.push_back(pd->deviceId);
+                devices.push_back(device);
+            }
+        }
+    }
+    if (candidates.size() < numRanksOnHost)
+        return GetDevice(flags);
+
+    std::vector<size_t> ring = GpuRingOrder(devices);
+    int deviceId = candidates[ring[rankOnHost]];
+    if (!LockDevice(deviceId, /*trial=*/(flags & bestGpuExclusiveLock) == 0))
+    {
+        fprintf(stderr, "Device selection: GPU %d of rank %d on this host is locked, picking the best available GPU instead.\n", deviceId, (int)rankOnHost);
+        return GetDevice(flags);
+    }
+    m_lastCount = 1;
+
+    std::string order;
+    for (size_t i : ring)
+        order += " " + std::to_string(candidates[i]);
+    int numaNode = GpuNumaNode(deviceId);
+    fprintf(stderr, "Device selection: GPUs of this host in ring order:%s; rank %d on this host uses GPU %d (NUMA node %d).\n",
+            order.c_str(), (int)rankOnHost, deviceId, numaNode);
+    if (numaNode >= 0 && !NumaPolicy::IsActive())
+        NumaPolicy::PinCurrentThread((size_t)numaNode);
+    return deviceId;
+}
+
 // disallow devices wich don't comply with compute capability restriction when cntk runs with deviceId = 'auto'
 void BestGpu::DisallowUnsupportedDevices()
 {
@@ -12,6 +12,7 @@
 #define FORMAT_SPECIALIZE // to get the specialized version of the format routines
 #include "File.h"
 #include "Config.h"
+#include "Globals.h"
 #include <string>
 #include <stdint.h>
 #include <locale>
@@ -31,7 +32,6 @@
 #endif
 
 #define PCLOSE_ERROR -1
-#define WRITE_BUFFER_SIZE (1024 * 1024)
 
 #include <boost/algorithm/string.hpp>
 #include "half.hpp"
@@ -674,10 +674,17 @@ int File::EndOfLineOrEOF(bool skip)
         return false;
 }
 
-// Buffer write stream
+// Buffer write stream in blocks of Globals::GetFileWriteBlockSize(), so that the many small writes of a model
+// reach the file system as few large ones. Payloads larger than the buffer are written through directly.
+// The buffer is ours, as not all C runtimes honor the size for a buffer they allocate themselves.
+// Must be called before the first read or write.
 int File::Setvbuf()
 {
-    return setvbuf(this->m_file, NULL, _IOFBF, WRITE_BUFFER_SIZE);
+    const size_t bufferSize = Globals::GetFileWriteBlockSize();
+    if (bufferSize == 0) // keep the default buffering of the C runtime
+        return 0;
+    m_buffer.reset(new char[bufferSize]);
+    return setvbuf(m_file, m_buffer.get(), _IOFBF, bufferSize);
 }
 
 // Get a marker from the file
@@ -16,7 +16,27 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
     std::atomic<bool> Globals::m_enableShareNodeValueMatrices(true);
     std::atomic<bool> Globals::m_optimizeGradientAccumulation(true);
+    std::atomic<bool> Globals::m_enableActivationRecomputation(false);
     std::atomic<bool> Globals::m_enableNodeTiming(false);
     std::atomic<bool> Globals::m_useV2Aggregator(false);
+    std::atomic<bool> Globals::m_enableInt8Inference(false);
+    std::atomic<std::size_t> Globals::m_int8InferenceGeneration(0);
+    std::atomic<bool> Globals::m_enableBlockSparseInference(false);
+    std::atomic<std::size_t> Globals::m_blockSparseInferenceGeneration(0);
+    std::atomic<std::size_t> Globals::m_blockSparseRows(4);
+    std::atomic<std::size_t> Globals::m_blockSparseCols(1);
+    std::atomic<double> Globals::m_blockSparseMaxDensity(0.3);
+    std::atomic<bool> Globals::m_enableForwardPropFusion(true);
+    std::atomic<bool> Globals::m_enableElementwiseFusion(true);
+    std::atomic<bool> Globals::m_enableGPUGraphCapture(false);
+    std::atomic<bool> Globals::m_enableMultiStreamExecution(false);
+    std::atomic<std::size_t> Globals::m_numExecutionStreams(4);
+    std::atomic<bool> Globals::m_enableInterOpParallelism(false);
+    std::atomic<bool> Globals::m_enableInferenceGraphOptimization(false);
+    std::atomic<bool> Globals::m_enableMultiTensorLearnerUpdates(true);
+    std::atomic<bool> Globals::m_enablePersistentRNN(false);
+    std::atomic<bool> Globals::m_enablePipelineParallelism(false);
     std::atomic<std::size_t> Globals::m_mpiPackThresholdInBytes(DEFAULT_PACK_THRESHOLD_SIZE_IN_BYTES);
+    std::atomic<std::size_t> Globals::m_fileWriteBlockSizeInBytes(DEFAULT_FILE_WRITE_BLOCK_SIZE_IN_BYTES);
+    std::atomic<std::size_t> Globals::m_maxNumCompiledNetworks(1);
 }}}
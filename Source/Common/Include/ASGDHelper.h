@@ -6,6 +6,7 @@
 
 #include <list>
 #include "ComputationNetwork.h"
+#include "MPIWrapper.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -22,6 +23,16 @@ enum class AdjustLearningRateAtBeginning : int
     Staircase = (1 << 1), // using staircased adjustment, learning rate will from 0 to learningRatesPerMB every adjustNbMinibatch
 };
 
+// -----------------------------------------------------------------------
+// class ASGDBackend
+//       Parameter server behind the ASGDHelper interface.
+// -----------------------------------------------------------------------
+enum class ASGDBackend : int
+{
+    Native = 0,     // default, parameter server sharded over the MPI ranks, see MPIASGDHelper
+    Multiverso = 1, // requires building with Multiverso (ASGD_PARALLEL_SUPPORT)
+};
+
 template<class ElemType = float>
 class ASGDHelper
 {
@@ -62,6 +73,10 @@ ASGDHelper<ElemType>* NewASGDHelper(
     double adjustCoef = 0.2,                                                 // see in DecayCoefficient()
     size_t adjustPerMinibatches = 600,                                       //
     int traceLevel = 0,                                                      // log level
-    int syncPerfStats = 0);                                                  // shown perf data every syncPerfStats
+    int syncPerfStats = 0,                                                   // shown perf data every syncPerfStats
+    const MPIWrapperPtr& mpi = nullptr,                                      // MPI communicator of the workers, required by the native backend
+    ASGDBackend backend = ASGDBackend::Native,                               // parameter server implementation
+    int maxStaleness = -1,                                                   // native backend: max pushes a worker may be ahead of the slowest one, -1 for no bound
+    bool useFp16Deltas = false);                                             // native backend: send the model deltas in half precision
 
 }}}
@@ -5,52 +5,81 @@
 
 #pragma once
 
-#include <stack>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
-#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
 // -----------------------------------------------------------------------
-// conc_stack -- very simple version of thread-safe stack. Add other functions as needed.
+// conc_stack -- lock-free stack, used to recycle objects between threads (e.g. buffers). Add other functions as needed.
 // Kept in a separate header because it pulls in some large headers that are not super-commonly needed otherwise.
+//
+// Two Treiber stacks share the nodes: one of the nodes that hold an item, one of the free nodes. A head is the number
+// of its top node tagged with the count of its changes, so that a single 64-bit compare-and-swap also fails if the top
+// node was popped and pushed again in between (ABA). Nodes are only freed with the stack, which keeps it safe to read
+// the link of a node that another thread has popped meanwhile. They are allocated in chunks of doubling size, as
+// needed, so their number is the largest number of items the stack held at once.
 // -----------------------------------------------------------------------
 
 template <typename T>
 class conc_stack
 {
 public:
-    typedef typename std::stack<T>::value_type value_type;
+    typedef T value_type;
 
     conc_stack()
+        : m_items(Tagged(None, 0)), m_freeNodes(Tagged(None, 0)), m_numNodes(0)
     {
+        for (auto& chunk : m_chunks)
+            chunk.store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~conc_stack()
+    {
+        for (uint32_t index = Pop(m_items); index != None; index = Pop(m_items))
+            At(index).Value().~value_type();
+        for (auto& chunk : m_chunks)
+            delete[] chunk.load(std::memory_order_relaxed);
     }
 
     value_type pop_or_create(std::function<value_type()> factory)
     {
-        {
-            std::lock_guard<std::mutex> g(m_locker);
-            if (m_stack.size() != 0)
-            {
-                auto res = std::move(m_stack.top());
-                m_stack.pop();
-                return res;
-            }
-        }
+        uint32_t index = Pop(m_items);
+        if (index == None)
+            return factory();
 
-        return factory();
+        Node& node = At(index);
+        auto res = std::move(node.Value());
+        node.Value().~value_type();
+        Push(m_freeNodes, index);
+        return res;
     }
 
     void push(const value_type& item)
     {
-        std::lock_guard<std::mutex> g(m_locker);
-        m_stack.push(item);
+        uint32_t index = AcquireNode();
+        try
+        {
+            new (&At(index).m_storage) value_type(item);
+        }
+        catch (...)
+        {
+            Push(m_freeNodes, index);
+            throw;
+        }
+        Push(m_items, index);
     }
 
     void push(value_type&& item)
     {
-        std::lock_guard<std::mutex> g(m_locker);
-        m_stack.push(std::forward<value_type>(item));
+        uint32_t index = AcquireNode();
+        new (&At(index).m_storage) value_type(std::forward<value_type>(item));
+        Push(m_items, index);
     }
 
 public:
@@ -60,7 +89,90 @@ public:
     conc_stack& operator=(conc_stack&&) = delete;
 
 private:
-    std::stack<value_type> m_stack;
-    std::mutex m_locker;
+    struct Node
+    {
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type m_storage; // the item, while the node is on m_items
+        std::atomic<uint32_t> m_next;
+
+        value_type& Value() { return *reinterpret_cast<value_type*>(&m_storage); }
+    };
+
+    static const uint32_t None = UINT32_MAX;
+    static const uint32_t FirstChunkSize = 16;
+    static const size_t NumChunks = 29; // enough for all 32-bit node numbers
+
+    static uint64_t Tagged(uint32_t index, uint32_t tag) { return ((uint64_t)tag << 32) | index; }
+    static uint32_t Index(uint64_t head) { return (uint32_t)head; }
+    static uint32_t Tag(uint64_t head) { return (uint32_t)(head >> 32); }
+
+    // chunk c holds the nodes [FirstChunkSize * (2^c - 1), FirstChunkSize * (2^(c+1) - 1))
+    static size_t ChunkOf(uint32_t index)
+    {
+        uint64_t q = (uint64_t)index / FirstChunkSize + 1;
+        size_t chunk = 0;
+        while (q >>= 1)
+            chunk++;
+        return chunk;
+    }
+
+    static uint64_t ChunkStart(size_t chunk) { return (uint64_t)FirstChunkSize * ((1ull << chunk) - 1); }
+
+    Node& At(uint32_t index) const
+    {
+        size_t chunk = ChunkOf(index);
+        return m_chunks[chunk].load(std::memory_order_acquire)[index - ChunkStart(chunk)];
+    }
+
+    uint32_t Pop(std::atomic<uint64_t>& head)
+    {
+        uint64_t top = head.load(std::memory_order_acquire);
+        for (;;)
+        {
+            uint32_t index = Index(top);
+            if (index == None)
+                return None;
+            // if the node is popped meanwhile, the link is stale, but then the tag has changed and the exchange fails
+            uint32_t next = At(index).m_next.load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(top, Tagged(next, Tag(top) + 1), std::memory_order_acq_rel, std::memory_order_acquire))
+                return index;
+        }
+    }
+
+    void Push(std::atomic<uint64_t>& head, uint32_t index)
+    {
+        Node& node = At(index);
+        uint64_t top = head.load(std::memory_order_relaxed);
+        do
+        {
+            node.m_next.store(Index(top), std::memory_order_relaxed);
+        } while (!head.compare_exchange_weak(top, Tagged(index, Tag(top) + 1), std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    // a free node, or a new one, allocating its chunk if this is the chunk's first node
+    uint32_t AcquireNode()
+    {
+        uint32_t index = Pop(m_freeNodes);
+        if (index != None)
+            return index;
+
+        index = m_numNodes.fetch_add(1, std::memory_order_relaxed);
+        if (index == None)
+            throw std::bad_alloc();
+
+        size_t chunk = ChunkOf(index);
+        if (m_chunks[chunk].load(std::memory_order_acquire) == nullptr)
+        {
+            Node* nodes = new Node[(size_t)FirstChunkSize << chunk];
+            Node* expected = nullptr;
+            if (!m_chunks[chunk].compare_exchange_strong(expected, nodes, std::memory_order_acq_rel))
+                delete[] nodes; // another thread has allocated it
+        }
+        return index;
+    }
+
+    std::atomic<uint64_t> m_items;
+    std::atomic<uint64_t> m_freeNodes;
+    std::atomic<uint32_t> m_numNodes;
+    mutable std::atomic<Node*> m_chunks[NumChunks];
 };
 } } }
@@ -355,6 +355,31 @@ public:
     // resetRNN - flags whether to reset memory cells of RNN. 
     //
     virtual void ForwardPass(const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& output, bool resetRNN) = 0;
+
+    //
+    // ForwardPassBatch - Evaluate several independent requests in a single forward pass.
+    // Every request is one sequence, passed in the same layout as the inputs of ForwardPass(); the requests may
+    // have different lengths. The internal input buffers are kept across calls, so requests of the same shapes
+    // cause no reallocation.
+    // inputs - [request] vector of input buffers, one for every input as given by GetInputLayouts()
+    // outputs - [request] vector of output buffers. Each must be sized to fit the output schema for its request.
+    // resetRNN - flags whether to reset memory cells of RNN at the beginning of every request.
+    //
+    virtual void ForwardPassBatch(const std::vector<Values<ElemType>>& inputs, std::vector<Values<ElemType>>& outputs, bool resetRNN) = 0;
+
+    //
+    // Same as above, but takes references to static arrays instead of std::vector
+    //
+    virtual void ForwardPassBatch(const std::vector<ValueRefs<ElemType>>& inputs, std::vector<ValueRefs<ElemType>>& outputs, bool resetRNN) = 0;
+
+    //
+    // CloneSharingParameters - create another evaluator of the same network. The clone shares the parameters with
+    // this instance, but keeps its own internal state, so that several threads can evaluate at the same time, one
+    // instance each, without loading the model more than once.
+    // The clone needs its own StartForwardEvaluation() call, and it must be released by its Destroy(). The
+    // parameters stay valid until all instances that share them are destroyed.
+    //
+    virtual IEvaluateModelExtended<ElemType>* CloneSharingParameters() = 0;
 };
 
 template <typename ElemType>
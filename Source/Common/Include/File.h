@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <string>
 #include <vector>
+#include <memory>
 #include <stdint.h>
 #ifdef _WIN32
 #ifndef NOMINMAX
@@ -102,6 +103,7 @@ private:
     bool m_pcloseNeeded; // was opened with popen(), use pclose() when destructing
     bool m_seekable;     // this stream is seekable
     int m_options;       // FileOptions ored togther
+    std::unique_ptr<char[]> m_buffer; // stdio buffer installed by Setvbuf(); must outlive m_file
     void Init(const wchar_t* filename, int fileOptions);
 
 public:
@@ -168,6 +170,20 @@ public:
     File& operator<<(const std::wstring& val);
     File& operator<<(const std::string& val);
     File& operator<<(FileMarker marker);
+
+    // put an array of basic types; binary files take it in a single write rather than value by value
+    template <typename T>
+    File& WriteValues(const T* data, size_t count)
+    {
+        if (IsTextBased())
+        {
+            for (size_t i = 0; i < count; i++)
+                fputText(m_file, data[i]);
+        }
+        else if (count > 0)
+            fwriteOrDie(data, sizeof(T), count, m_file);
+        return *this;
+    }
     File& PutMarker(FileMarker marker, size_t count);
     File& PutMarker(FileMarker marker, const std::string& section);
     File& PutMarker(FileMarker marker, const std::wstring& section);
@@ -196,6 +212,20 @@ public:
         return *this;
     }
 
+    // get an array of basic types; binary files are read in a single read rather than value by value
+    template <typename T>
+    File& ReadValues(T* data, size_t count)
+    {
+        if (IsTextBased())
+        {
+            for (size_t i = 0; i < count; i++)
+                fgetText(m_file, data[i]);
+        }
+        else if (count > 0)
+            freadOrDie(data, sizeof(T), count, m_file);
+        return *this;
+    }
+
     void WriteString(const char* str, int size = 0);                   // zero terminated strings use size=0
     void ReadString(char* str, int size);                              // read up to size bytes, or a zero terminator (or space in text mode)
     void WriteString(const wchar_t* str, int size = 0);                // zero terminated strings use size=0
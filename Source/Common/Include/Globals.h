@@ -28,9 +28,88 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         static void SetShareNodeValueMatrices(bool enable) { m_enableShareNodeValueMatrices = enable; }
         static bool ShouldEnableShareNodeValueMatrices() { return m_enableShareNodeValueMatrices; }
 
+        // Drop forward values during the forward pass and recompute them segment by segment during backprop ('gradient checkpointing').
+        // Requires node value sharing; see ComputationNetwork::PlanActivationRecomputation().
+        static void SetActivationRecomputation(bool enable) { m_enableActivationRecomputation = enable; }
+        static bool ShouldRecomputeActivations() { return m_enableActivationRecomputation && m_enableShareNodeValueMatrices; }
+
         static void SetNodeTiming(bool enable) { m_enableNodeTiming = enable; }
         static bool ShouldEnableNodeTiming() { return m_enableNodeTiming; }
 
+        // Int8 products of constant weights with dense data on the CPU during inference, see TimesNodeBase::GetQuantizedMultiplier().
+        // Every time it is enabled the weights are quantized anew, to pick up changes to their values.
+        static void SetInt8Inference(bool enable) { if (enable) m_int8InferenceGeneration++; m_enableInt8Inference = enable; }
+        static bool ShouldUseInt8Inference() { return m_enableInt8Inference; }
+        static std::size_t GetInt8InferenceGeneration() { return m_int8InferenceGeneration; }
+        // Block sparse products of constant weights with dense data on the CPU during inference, for the weights whose fraction
+        // of nonzero blocks of blockRows x blockCols elements is at most maxDensity (e.g. after block pruning in the learners),
+        // see TimesNodeBase::GetQuantizedMultiplier(). Every time it is enabled the weights are converted anew.
+        static void SetBlockSparseInference(bool enable, std::size_t blockRows = 4, std::size_t blockCols = 1, double maxDensity = 0.3)
+        {
+            if (enable)
+            {
+                m_blockSparseRows = blockRows;
+                m_blockSparseCols = blockCols;
+                m_blockSparseMaxDensity = maxDensity;
+                m_blockSparseInferenceGeneration++;
+            }
+            m_enableBlockSparseInference = enable;
+        }
+        static bool ShouldUseBlockSparseInference() { return m_enableBlockSparseInference; }
+        static std::size_t GetBlockSparseInferenceGeneration() { return m_blockSparseInferenceGeneration; }
+        static std::size_t GetBlockSparseRows() { return m_blockSparseRows; }
+        static std::size_t GetBlockSparseCols() { return m_blockSparseCols; }
+        static double GetBlockSparseMaxDensity() { return m_blockSparseMaxDensity; }
+        // Computation of the nodes that follow a convolution (bias, batch normalization, ReLU) together with it, when the
+        // network is evaluated on the CPU for inference, see ComputationNetwork::FuseForwardProp().
+        static void SetForwardPropFusion(bool enable) { m_enableForwardPropFusion = enable; }
+        static bool ShouldFuseForwardProp() { return m_enableForwardPropFusion; }
+        // Evaluation of trees of elementwise nodes (e.g. the gates of an LSTM) in a single pass over the elements
+        // during inference, see ComputationNetwork::FuseElementwise().
+        static void SetElementwiseFusion(bool enable) { m_enableElementwiseFusion = enable; }
+        static bool ShouldFuseElementwise() { return m_enableElementwiseFusion; }
+        // Recording of the GPU work of ForwardProp() and Backprop() into CUDA graphs, which are replayed for later
+        // minibatches of the same layout, see ComputationNetwork::RunCapturedOnGPU().
+        static void SetGPUGraphCapture(bool enable) { m_enableGPUGraphCapture = enable; }
+        static bool ShouldCaptureGPUGraphs() { return m_enableGPUGraphCapture; }
+        // Concurrent execution of the independent branches of a network on a few GPU streams during forward prop, see
+        // ComputationNetwork::ForwardPropConcurrently(). The number of streams applies to the plans built afterwards.
+        static void SetMultiStreamExecution(bool enable) { m_enableMultiStreamExecution = enable; }
+        static bool ShouldUseMultipleStreams() { return m_enableMultiStreamExecution && m_numExecutionStreams > 1; }
+        static void SetNumExecutionStreams(std::size_t numStreams) { m_numExecutionStreams = numStreams; }
+        static std::size_t GetNumExecutionStreams() { return m_numExecutionStreams; }
+        // Concurrent execution of the independent nodes of a network on the ThreadPool during inference on the CPU, each
+        // with a number of OpenMP threads by its cost, see ComputationNetwork::ForwardPropConcurrently().
+        static void SetInterOpParallelism(bool enable) { m_enableInterOpParallelism = enable; }
+        static bool ShouldUseInterOpParallelism() { return m_enableInterOpParallelism; }
+        // Simplification of the networks that V2 functions build for inference (common subexpressions, constant folding,
+        // dead nodes), see ComputationNetwork::OptimizeForInference().
+        static void SetInferenceGraphOptimization(bool enable) { m_enableInferenceGraphOptimization = enable; }
+        static bool ShouldOptimizeInferenceGraphs() { return m_enableInferenceGraphOptimization; }
+        // Number of networks a V2 function that is only evaluated keeps for different requested outputs and argument
+        // shapes, see CompositeFunction::SwitchNetworkVariant().
+        static void SetMaxNumCompiledNetworks(std::size_t maxNumNetworks) { m_maxNumCompiledNetworks = maxNumNetworks; }
+        static std::size_t GetMaxNumCompiledNetworks() { return m_maxNumCompiledNetworks; }
+
+        // Recurrences of OptimizedRNNStack with the recurrent weights kept on chip across the time steps, for the latency of
+        // small minibatches; see CuDnnRNN::MayUsePersistentAlgorithm() and CPURNNExecutor::MayRunPersistent().
+        static void SetPersistentRNN(bool enable) { m_enablePersistentRNN = enable; }
+        static bool ShouldUsePersistentRNN() { return m_enablePersistentRNN; }
+
+        // Update of all the dense parameters of a V2 learner together, with a few GPU kernel launches per minibatch instead
+        // of several per parameter, see LearnerBase::UpdateMultiTensor().
+        static void SetMultiTensorLearnerUpdates(bool enable) { m_enableMultiTensorLearnerUpdates = enable; }
+        static bool ShouldUseMultiTensorLearnerUpdates() { return m_enableMultiTensorLearnerUpdates; }
+
+        // Pipeline parallelism in V2 training: the Parameters of a network on several devices split it into stages on
+        // them, see ComputationNetwork::PlacePipelineStages().
+        static void SetPipelineParallelism(bool enable) { m_enablePipelineParallelism = enable; }
+        static bool ShouldUsePipelineParallelism() { return m_enablePipelineParallelism; }
+
+        // Size of the blocks in which models, checkpoints and outputs are written; large blocks for network file systems.
+        static void SetFileWriteBlockSize(std::size_t blockSizeInBytes) { m_fileWriteBlockSizeInBytes = blockSizeInBytes; }
+        static std::size_t GetFileWriteBlockSize() { return m_fileWriteBlockSizeInBytes; }
+
         static void SetMPIPackThreshold(std::size_t packThreholdInBytes) { m_mpiPackThresholdInBytes = packThreholdInBytes; }
         static std::size_t GetMPIPackThreshold() { return m_mpiPackThresholdInBytes; }
     private:
@@ -39,8 +118,28 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         static std::atomic<bool> m_enableShareNodeValueMatrices;
         static std::atomic<bool> m_forceConstantRandomSeed;
         static std::atomic<bool> m_optimizeGradientAccumulation;
+        static std::atomic<bool> m_enableActivationRecomputation;
         static std::atomic<bool> m_enableNodeTiming;
         static std::atomic<bool> m_useV2Aggregator;
+        static std::atomic<bool> m_enableInt8Inference;
+        static std::atomic<std::size_t> m_int8InferenceGeneration;
+        static std::atomic<bool> m_enableBlockSparseInference;
+        static std::atomic<std::size_t> m_blockSparseInferenceGeneration;
+        static std::atomic<std::size_t> m_blockSparseRows;
+        static std::atomic<std::size_t> m_blockSparseCols;
+        static std::atomic<double> m_blockSparseMaxDensity;
+        static std::atomic<bool> m_enableForwardPropFusion;
+        static std::atomic<bool> m_enableElementwiseFusion;
+        static std::atomic<bool> m_enableGPUGraphCapture;
+        static std::atomic<bool> m_enableMultiStreamExecution;
+        static std::atomic<bool> m_enableInterOpParallelism;
+        static std::atomic<bool> m_enableInferenceGraphOptimization;
+        static std::atomic<bool> m_enableMultiTensorLearnerUpdates;
+        static std::atomic<bool> m_enablePersistentRNN;
+        static std::atomic<bool> m_enablePipelineParallelism;
+        static std::atomic<std::size_t> m_numExecutionStreams;
         static std::atomic<std::size_t> m_mpiPackThresholdInBytes;
+        static std::atomic<std::size_t> m_fileWriteBlockSizeInBytes;
+        static std::atomic<std::size_t> m_maxNumCompiledNetworks;
     };
 }}}
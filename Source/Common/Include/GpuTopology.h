@@ -0,0 +1,138 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// GpuTopology.h -- how the GPUs of a host are connected, from NVML: the order in which they form the shortest ring,
+// used both to place the MPI ranks of a host on GPUs (BestGpu) and to order the ranks of the NCCL rings (NcclComm).
+// NVML must have been initialized by the caller.
+//
+
+#pragma once
+
+#ifndef CPUONLY
+
+#include <cuda_runtime.h>
+#include <nvml.h>
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Distance of two GPUs: 0 if an NVLink connects them, otherwise 1 + the NVML topology level of their closest common
+// ancestor (same board, PCIe switch, several switches, host bridge, CPU socket, across sockets). NVML_TOPOLOGY_SYSTEM + 1
+// if it cannot be queried, which degrades the ring order to the given order.
+inline int GpuDistance(nvmlDevice_t a, nvmlDevice_t b)
+{
+    nvmlPciInfo_t pciB;
+    if (nvmlDeviceGetPciInfo(b, &pciB) != NVML_SUCCESS)
+        return NVML_TOPOLOGY_SYSTEM + 1;
+
+    for (unsigned int link = 0; link < NVML_NVLINK_MAX_LINKS; link++)
+    {
+        nvmlEnableState_t isActive;
+        nvmlPciInfo_t remote;
+        if (nvmlDeviceGetNvLinkState(a, link, &isActive) != NVML_SUCCESS || isActive != NVML_FEATURE_ENABLED)
+            continue;
+        if (nvmlDeviceGetNvLinkRemotePciInfo(a, link, &remote) == NVML_SUCCESS && strcmp(remote.busId, pciB.busId) == 0)
+            return 0;
+    }
+
+    nvmlGpuTopologyLevel_t level;
+    if (nvmlDeviceGetTopologyCommonAncestor(a, b, &level) != NVML_SUCCESS)
+        return NVML_TOPOLOGY_SYSTEM + 1;
+    return 1 + (int)level;
+}
+
+// Returns the indices of 'devices' in the order of a short ring through them: nearest neighbors from the first one,
+// then improved by reversing segments (2-opt) while that shortens the ring. A host has few GPUs, so this is cheap.
+// All callers that pass the same devices in the same order get the same ring.
+inline std::vector<size_t> GpuRingOrder(const std::vector<nvmlDevice_t>& devices)
+{
+    const size_t n = devices.size();
+    std::vector<std::vector<int>> distance(n, std::vector<int>(n, 0));
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < n; j++)
+            if (i != j)
+                distance[i][j] = GpuDistance(devices[i], devices[j]);
+
+    std::vector<size_t> ring;
+    std::vector<bool> visited(n, false);
+    for (size_t k = 0; k < n; k++)
+    {
+        size_t next = SIZE_MAX;
+        for (size_t j = 0; j < n; j++)
+        {
+            if (!visited[j] && (next == SIZE_MAX || (k > 0 && distance[ring.back()][j] < distance[ring.back()][next])))
+                next = j;
+        }
+        visited[next] = true;
+        ring.push_back(next);
+    }
+
+    for (bool improved = n > 3; improved;)
+    {
+        improved = false;
+        for (size_t i = 0; i + 2 < n; i++)
+        {
+            for (size_t j = i + 2; j < n; j++)
+            {
+                // replace the edges (i, i+1) and (j, j+1) by (i, j) and (i+1, j+1)
+                size_t a = ring[i], b = ring[i + 1], c = ring[j], d = ring[(j + 1) % n];
+                if (a == d)
+                    continue;
+                if (distance[a][c] + distance[b][d] < distance[a][b] + distance[c][d])
+                {
+                    std::reverse(ring.begin() + i + 1, ring.begin() + j + 1);
+                    improved = true;
+                }
+            }
+        }
+    }
+    return ring;
+}
+
+// Returns the NVML handle of a CUDA device, matched by its PCI bus id since the two may enumerate GPUs differently.
+inline bool GetNvmlDevice(int deviceId, nvmlDevice_t* device)
+{
+    char busId[NVML_DEVICE_PCI_BUS_ID_BUFFER_SIZE];
+    if (cudaDeviceGetPCIBusId(busId, (int)sizeof(busId), deviceId) != cudaSuccess)
+        return false;
+    return nvmlDeviceGetHandleByPciBusId(busId, device) == NVML_SUCCESS;
+}
+
+// Returns the NUMA node closest to a CUDA device, or -1 if unknown (e.g. on Windows, or a host with a single node).
+inline int GpuNumaNode(int deviceId)
+{
+#ifdef _WIN32
+    (void)deviceId;
+    return -1;
+#else
+    char busId[NVML_DEVICE_PCI_BUS_ID_BUFFER_SIZE];
+    if (cudaDeviceGetPCIBusId(busId, (int)sizeof(busId), deviceId) != cudaSuccess)
+        return -1;
+    std::string path = "/sys/bus/pci/devices/";
+    for (const char* p = busId; *p; p++)
+        path += (char)tolower(*p);
+    path += "/numa_node";
+
+    int node = -1;
+    FILE* f = fopen(path.c_str(), "r");
+    if (f)
+    {
+        if (fscanf(f, "%d", &node) != 1)
+            node = -1;
+        fclose(f);
+    }
+    return node;
+#endif
+}
+
+}}}
+
+#endif
@@ -27,11 +27,13 @@ typedef void *MPI_Comm;
 typedef enum _MPI_Datatype { MPI_CHAR, MPI_INT, MPI_FLOAT, MPI_DOUBLE, MPI_UNSIGNED, MPI_LONG_LONG_INT } MPI_Datatype;
 
 #define MPI_IN_PLACE          ((void*)(int)-1)
+#define MPI_MAX               ((MPI_Op)0x58000001)
 #define MPI_SUM               ((MPI_Op)0x58000003)
 
 #define MPI_STATUSES_IGNORE  (MPI_Status*)1
 #define MPI_STATUS_IGNORE    (MPI_Status*)1
 #define MPI_UNDEFINED        (-32766)
+#define MPI_REQUEST_NULL     ((MPI_Request)0x2c000000)
 
 typedef int MPI_Op;
 typedef int MPI_Request;
@@ -90,6 +92,12 @@ public:
     virtual size_t MainNodeRank() const = 0;
     virtual bool IsMultiHost() const = 0;
 
+    // host topology of the nodes in use; hosts are numbered in the order of their lowest rank
+    virtual size_t NumHosts() const = 0;
+    virtual size_t CurrentHostIndex() const = 0;
+    virtual size_t NumNodesOnCurrentHost() const = 0;
+    virtual size_t CurrentNodeRankOnHost() const = 0; // rank among the nodes on this host
+
     // Use GPUDirect RDMA support
     virtual bool UseGpuGdr() = 0;
 
@@ -101,6 +109,8 @@ public:
     virtual int Wait(MPI_Request* request, MPI_Status* status) = 0;
     virtual int Waitany(int count, MPI_Request array_of_requests[], int* index, MPI_Status* status) = 0;
     virtual int Waitall(int count, MPI_Request array_of_requests[], MPI_Status array_of_statuses[]) = 0;
+    virtual int Test(MPI_Request* request, int* flag, MPI_Status* status) = 0;
+    virtual int Testany(int count, MPI_Request array_of_requests[], int* index, int* flag, MPI_Status* status) = 0;
     virtual int Isend(const void* buf, int count, MPI_Datatype datatype, int dest, int tag, /*MPI_Comm comm,*/ MPI_Request* request) = 0;
     virtual int Recv(void* buf, int count, MPI_Datatype datatype, int source, int tag, /*MPI_Comm comm,*/ MPI_Status* status) = 0;
     virtual int Irecv(void* buf, int count, MPI_Datatype datatype, int source, int tag, /*MPI_Comm comm,*/ MPI_Request* request) = 0;
@@ -157,6 +167,7 @@ public:
     virtual void AllGather(const float *sendData, size_t numSendElements, float *receiveData, size_t numRecvElements) const = 0;
     virtual void AllGather(const double *sendData, size_t numSendElements, double *receiveData, size_t numRecvElements) const = 0;
     virtual void Allgather(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount, MPI_Datatype recvtype) const = 0;
+    virtual void Allgatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, const int recvcounts[], const int displs[], MPI_Datatype recvtype) const = 0;
 
     virtual void Gather(const size_t *sendData, size_t numSendElements, size_t *receiveData, size_t numRecvElements, size_t rootRank) const = 0;
     virtual void Gather(const int *sendData, size_t numSendElements, int *receiveData, size_t numRecvElements, size_t rootRank) const = 0;
@@ -140,6 +140,10 @@ struct MBLayout
         m_timeStepHasGap = other->m_timeStepHasGap;
 
         m_columnsValidityMask.SetValue(other->m_columnsValidityMask);
+        {
+            std::lock_guard<std::mutex> lock(other->m_delayedFramesMutex);
+            m_delayedFrames = other->m_delayedFrames; // (immutable, so the copy can share them)
+        }
         m_writable = other->m_writable;
         m_rightSplice = other->m_rightSplice;
 
@@ -167,6 +171,8 @@ struct MBLayout
         m_timeStepHasGap = std::move(other->m_timeStepHasGap);
 
         m_columnsValidityMask = std::move(other->m_columnsValidityMask);
+        m_delayedFrames = std::move(other->m_delayedFrames);
+        other->m_delayedFrames.clear();
         m_writable = other->m_writable;
         m_rightSplice = other->m_rightSplice;
 
@@ -192,6 +198,7 @@ public:
             m_timeStepHasGap.assign(m_numTimeSteps, false);
         }
         m_columnsValidityMask.Resize(0, 0); // invalidate
+        m_delayedFrames.clear();
         // reset state
         m_numFramesDeclared = 0;
         m_numGapFrames = 0;
@@ -326,6 +333,16 @@ public:
 
     const Matrix<char>& GetColumnsValidityMask(DEVICEID_TYPE deviceId) const;
 
+    // The frames (s,t) that cannot take their value from (s,t+timeOffset) because that lies beyond the start or end of
+    // their sequence, or because they are gaps; see DelayedValueNodeBase::BeginForwardProp().
+    struct DelayedFrames
+    {
+        std::vector<char> m_invalid;     // [t * S + s] 1 if frame (s,t) is invalid
+        std::vector<bool> m_anySeqValid; // [t] whether any frame of time step t is valid
+        std::vector<bool> m_allSeqValid; // [t] whether all frames of time step t are valid
+    };
+    std::shared_ptr<const DelayedFrames> GetDelayedFrames(ptrdiff_t timeOffset) const;
+
     // compare whether two layouts are the same
     bool operator==(const MBLayout& other) const
     {
@@ -638,6 +655,10 @@ private:
     // and 0 indicates invalid (aka MinibatchPackingFlags::NoInput)
     mutable Matrix<char> m_columnsValidityMask;
 
+    // Cached results of GetDelayedFrames(), [timeOffset]; shared by all nodes on this layout and by its copies
+    mutable std::map<ptrdiff_t, std::shared_ptr<const DelayedFrames>> m_delayedFrames;
+    mutable std::mutex m_delayedFramesMutex;
+
     // A boolean flag indicating whether the MBLayout can be further modified
     // When it's value is false, no set operations are allowed on the MBLayout.
     // Meant to guard in lazy creation of m_columnsValidityMask.
@@ -943,7 +964,6 @@ inline size_t MBLayout::GetActualNumSamples() const { return m_numFramesDeclared
 // return m_columnsValidityMask(,), which is lazily created here upon first call
 // only called from MaskMissingColumnsTo()
 // Update: also called from GatherNode::BackpropToNonLooping(). 
-// TODO: Can probably be faster by using the sequence array directly.
 // TODO: Or should we just blast m_distanceToStart to GPU, and maks based on that? It is small compared to features.
 inline const Matrix<char>& MBLayout::GetColumnsValidityMask(DEVICEID_TYPE deviceId) const
 {
@@ -954,26 +974,20 @@ inline const Matrix<char>& MBLayout::GetColumnsValidityMask(DEVICEID_TYPE device
         assert(HasGaps() || m_rightSplice != 0); // must only be called if there are gaps
         Lock();
 
-        // Determine indices of all invalid columns in the minibatch
-        // TODO: This can be done more efficiently by using m_sequences[].
+        // Determine indices of all invalid columns in the minibatch, from the gaps in the sequence array
         size_t nT = GetNumTimeSteps();
         size_t nS = GetNumParallelSequences();
 
         std::vector<char> columnsValidityMask(nT * nS, 1); // form the mask in a CPU-side STL vector first
         size_t gapsFound = 0;
-        for (size_t t = 0; t < nT; t++)
+        for (const auto& seq : m_sequences)
         {
-            FrameRange fr(nullptr, t);
-            if (IsGap(fr))
+            if (seq.seqId != GAP_SEQUENCE_ID)
+                continue;
+            for (size_t t = (size_t)max(seq.tBegin, (ptrdiff_t)0); t < min(seq.tEnd, nT); t++)
             {
-                for (size_t s = 0; s < nS; s++)
-                {
-                    if (IsGap(fr.Sequence(s)))
-                    {
-                        columnsValidityMask[(t * nS) + s] = 0;
-                        gapsFound++;
-                    }
-                }
+                columnsValidityMask[(t * nS) + seq.s] = 0;
+                gapsFound++;
             }
         }
         assert(gapsFound == m_numGapFrames); // sanity check
@@ -985,6 +999,48 @@ inline const Matrix<char>& MBLayout::GetColumnsValidityMask(DEVICEID_TYPE device
     return m_columnsValidityMask;
 }
 
+// return the DelayedFrames for 'timeOffset', which are determined from the sequence array upon first call
+// This is the same per-frame test as IsBeyondStartOrEnd(fr.WithTimeOffset(timeOffset).Sequence(s)) || IsGap(fr.Sequence(s)),
+// done once for all the DelayedValueNodes that step through this layout by the same offset.
+inline std::shared_ptr<const MBLayout::DelayedFrames> MBLayout::GetDelayedFrames(ptrdiff_t timeOffset) const
+{
+    std::lock_guard<std::mutex> lock(m_delayedFramesMutex);
+    auto& delayedFrames = m_delayedFrames[timeOffset];
+    if (!delayedFrames)
+    {
+        Lock();
+
+        const size_t nT = GetNumTimeSteps();
+        const size_t nS = GetNumParallelSequences();
+        auto result = std::make_shared<DelayedFrames>();
+        result->m_invalid.assign(nT * nS, 0);
+        for (const auto& seq : m_sequences)
+        {
+            for (size_t t = (size_t)max(seq.tBegin, (ptrdiff_t)0); t < min(seq.tEnd, nT); t++)
+            {
+                const ptrdiff_t tDelayed = (ptrdiff_t)t + timeOffset;
+                if (seq.seqId == GAP_SEQUENCE_ID || tDelayed < seq.tBegin || tDelayed >= (ptrdiff_t)seq.tEnd)
+                    result->m_invalid[(t * nS) + seq.s] = 1;
+            }
+        }
+
+        result->m_anySeqValid.assign(nT, false);
+        result->m_allSeqValid.assign(nT, true);
+        for (size_t t = 0; t < nT; t++)
+        {
+            for (size_t s = 0; s < nS; s++)
+            {
+                if (result->m_invalid[(t * nS) + s])
+                    result->m_allSeqValid[t] = false;
+                else
+                    result->m_anySeqValid[t] = true;
+            }
+        }
+        delayedFrames = result;
+    }
+    return delayedFrames;
+}
+
 // class for defining an iteration over a sequence, forward and backward
 // One day, we may also have nested structures. For those, FrameRangeIterations will be able to be instantiated from FrameRange objects to loop over their nested dimension.
 class FrameRangeIteration
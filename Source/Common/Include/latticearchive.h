@@ -20,6 +20,7 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <memory>
 #include <algorithm> // for find()
 #include "simplesenonehmm.h"
 #include "Matrix.h"
@@ -453,6 +454,7 @@ public:
     // This will go away one we updated all code to use the new data structures.
     void rebuildedges(bool haszerotokenedges /*pass true for broken spunit that may have reduced edges to 0 entries*/)
     {
+        cachedindex.reset(); // the edges change
         // deal with broken (zero-token) edges
         std::vector<bool> isendworkaround;
         if (haszerotokenedges)
@@ -558,22 +560,141 @@ public:
     };
 
 private:
-    struct edgealignments // struct to return alignments using an efficient long-vector storage
+    // structureindex -- bookkeeping of the alignment and forward-backward passes that only depends on the lattice structure
+    // It is built on first use and kept with the lattice, so that further passes over the utterance (e.g. in later epochs,
+    // while the lattice stays loaded) do not rebuild it.
+    struct structureindex
     {
-        std::vector<unsigned int> alignoffsets;    // [j] index of first alignment in allalignments; one extra element for length of last entry
-        std::vector<unsigned short> allalignments; // all alignments concatenated
-    public:
-        edgealignments(const lattice& L)
+        std::vector<unsigned int> alignoffsets;                  // [j] index of first alignment of edge j; one extra element for length of last entry
+        std::vector<size_t> batchsizeforward;                    // sizes of the runs of edges without data dependency, for the forward launches
+        std::vector<size_t> batchsizebackward;                   // same for the backward launches
+        const msra::asr::simplesenonehmm* backptrhset = nullptr; // model that backptroffsets[] was built for
+        std::vector<size_t> backptroffsets;                      // [j] index of first /sil/ backpointer of edge j; one extra element for overall size
+        size_t numsilstates = 0;                                 // per sil hmm
+    };
+    mutable std::shared_ptr<structureindex> cachedindex;
+
+    const structureindex& getstructureindex() const
+    {
+        if (!cachedindex)
         {
+            auto index = std::make_shared<structureindex>();
             size_t alignbufsize = 0;
-            alignoffsets.resize(L.edges.size() + 1); // one extra element so we can determine the length of last entry
-            foreach_index (j, L.edges)
+            index->alignoffsets.resize(edges.size() + 1); // one extra element so we can determine the length of last entry
+            foreach_index (j, edges)
             {
-                alignoffsets[j] = (unsigned int) alignbufsize;
-                size_t edgenumframes = L.nodes[L.edges[j].E].t - L.nodes[L.edges[j].S].t;
+                index->alignoffsets[j] = (unsigned int) alignbufsize;
+                size_t edgenumframes = nodes[edges[j].E].t - nodes[edges[j].S].t;
                 alignbufsize += edgenumframes;
             }
-            alignoffsets[L.edges.size()] = (unsigned int) alignbufsize; // (TODO: remove if not actually needed)
+            index->alignoffsets[edges.size()] = (unsigned int) alignbufsize; // (TODO: remove if not actually needed)
+
+            // batch sizes for the kernel launches of parallelforwardbackwardlattice()
+            if (!edges.empty())
+            {
+                size_t endindexforward = edges[0].E;
+                size_t countbatchforward = 0;
+                size_t endindexbackward = edges.back().S;
+                size_t countbatchbackward = 0;
+                foreach_index (j, edges)
+                {
+                    if (edges[j].S < endindexforward)
+                        countbatchforward++; // note: we don't check forward because the order of end node is assured.
+                    else
+                    {
+                        index->batchsizeforward.push_back(countbatchforward);
+                        countbatchforward = 1;
+                        endindexforward = edges[j].E;
+                    }
+                    const size_t backj = edges.size() - 1 - j;
+                    if (edges[backj].E > endindexbackward)
+                    {
+                        countbatchbackward++;
+                        if (endindexbackward < edges[backj].S)
+                            endindexbackward = edges[backj].S;
+                    }
+                    else
+                    {
+                        index->batchsizebackward.push_back(countbatchbackward);
+                        countbatchbackward = 1;
+                        endindexbackward = edges[backj].S;
+                    }
+                }
+                index->batchsizeforward.push_back(countbatchforward);
+                index->batchsizebackward.push_back(countbatchbackward);
+            }
+            cachedindex = index;
+        }
+        return *cachedindex;
+    }
+
+    // same, including the /sil/ backpointer offsets for 'hset'
+    const structureindex& getstructureindex(const msra::asr::simplesenonehmm& hset, int verbosity) const
+    {
+        getstructureindex();
+        auto& index = *cachedindex;
+        if (index.backptrhset == &hset)
+            return index;
+
+        size_t edgeswithsilence = 0; // (diagnostics only: number of edges with at least one /sil/)
+        size_t backptrbufsize = 0;   // number of entries in buffer for silence backpointer array, used as cursor as we build it
+
+        index.backptroffsets.resize(edges.size() + 1); // +1, so that the final entry determines the overall size of the allocated buffer
+        const size_t silUnitId = hset.gethmmid("sil");
+        index.numsilstates = hset.gethmm(silUnitId).getnumstates();
+        foreach_index (j, edges)
+        {
+            // for each edge, determine if it needs a backpointer buffer for silence
+            // Multiple /sil/ in the same edge will share the same buffer, so we need to know the max length.
+            const auto& aligntokens = getaligninfo(j); // get alignment tokens
+            index.backptroffsets[j] = backptrbufsize;  // buffer for this edge begins here
+            size_t maxsilframes = 0;                   // max #frames--we allocate this many for this edge
+            size_t numsilunits = 0;                    // number of /sil/ units in this edge
+            foreach_index (a, aligntokens)
+            {
+                if (aligntokens[a].unit == silUnitId)
+                {
+                    numsilunits++;                            // count
+                    if (aligntokens[a].frames > maxsilframes) // determine max #frames
+                        maxsilframes = aligntokens[a].frames;
+                }
+            }
+#if 1 // multiple /sil/ -> log this (as we are not sure whether this is actually proper--probably it is)
+            if (numsilunits > 1)
+            {
+                if (verbosity)
+                {
+                    fprintf(stderr, "backpointers: lattice '%S', edge %d has %d /sil/ phonemes\n", getkey(), j, (int) numsilunits);
+                    fprintf(stderr, "alignments: :");
+                    foreach_index (a, aligntokens)
+                    {
+                        const auto& unit = aligntokens[a];
+                        const auto& hmm = hset.gethmm(unit.unit);
+                        fprintf(stderr, "%s,%.2f:", hmm.getname(), unit.frames / 100.0f);
+                    }
+                    fprintf(stderr, "\n");
+                }
+            }
+#endif
+            if (numsilunits > 0)
+                edgeswithsilence++; // (for diagnostics message only)
+            backptrbufsize += maxsilframes * index.numsilstates;
+        }
+        index.backptroffsets[edges.size()] = backptrbufsize; // (TODO: remove if not actually needed)
+        if (verbosity)
+            fprintf(stderr, "backpointers: %.1f%% edges have at least one /sil/ unit inside\n", 100.0f * ((float) edgeswithsilence / edges.size()));
+        index.backptrhset = &hset;
+        return index;
+    }
+
+    struct edgealignments // struct to return alignments using an efficient long-vector storage
+    {
+        const std::vector<unsigned int>& alignoffsets; // [j] index of first alignment in allalignments; one extra element for length of last entry
+        std::vector<unsigned short> allalignments;    // all alignments concatenated
+    public:
+        edgealignments(const lattice& L)
+            : alignoffsets(L.getstructureindex().alignoffsets)
+        {
         }
         // edgealignments[j][t] is the senone at frame offset t in edge j
         array_ref<unsigned short> operator[](size_t j)
@@ -616,62 +737,17 @@ private:
 
     struct backpointers
     {
-        std::vector<size_t> backptroffsets;         // TODO: we could change this to 'unsigned int' to save some transfer time
+        const std::vector<size_t>& backptroffsets;  // TODO: we could change this to 'unsigned int' to save some transfer time
         std::vector<unsigned short> backptrstorage; // CPU-side versions use this as the traceback buffer; CUDA code has its CUDA-side buffer
         size_t numofstates;                         // per sil hmm
         int verbosity;
 
     public:
         backpointers(const lattice& L, const msra::asr::simplesenonehmm& hset, int verbosity = 0)
-            : numofstates(0)
+            : backptroffsets(L.getstructureindex(hset, verbosity).backptroffsets),
+              numofstates(L.getstructureindex(hset, verbosity).numsilstates),
+              verbosity(verbosity)
         {
-            size_t edgeswithsilence = 0; // (diagnostics only: number of edges with at least one /sil/)
-            size_t backptrbufsize = 0;   // number of entries in buffer for silence backpointer array, used as cursor as we build it
-
-            backptroffsets.resize(L.edges.size() + 1); // +1, so that the final entry determines the overall size of the allocated buffer
-            const size_t silUnitId = hset.gethmmid("sil");
-            numofstates = hset.gethmm(silUnitId).getnumstates();
-            foreach_index (j, L.edges)
-            {
-                // for each edge, determine if it needs a backpointer buffer for silence
-                // Multiple /sil/ in the same edge will share the same buffer, so we need to know the max length.
-                const auto& aligntokens = L.getaligninfo(j); // get alignment tokens
-                backptroffsets[j] = backptrbufsize;          // buffer for this edge begins here
-                size_t maxsilframes = 0;                     // max #frames--we allocate this many for this edge
-                size_t numsilunits = 0;                      // number of /sil/ units in this edge
-                foreach_index (a, aligntokens)
-                {
-                    if (aligntokens[a].unit == silUnitId)
-                    {
-                        numsilunits++;                            // count
-                        if (aligntokens[a].frames > maxsilframes) // determine max #frames
-                            maxsilframes = aligntokens[a].frames;
-                    }
-                }
-#if 1 // multiple /sil/ -> log this (as we are not sure whether this is actually proper--probably it is)
-                if (numsilunits > 1)
-                {
-                    if (verbosity)
-                    {
-                        fprintf(stderr, "backpointers: lattice '%S', edge %d has %d /sil/ phonemes\n", L.getkey(), j, (int) numsilunits);
-                        fprintf(stderr, "alignments: :");
-                        foreach_index (a, aligntokens)
-                        {
-                            const auto& unit = aligntokens[a];
-                            const auto& hmm = hset.gethmm(unit.unit);
-                            fprintf(stderr, "%s,%.2f:", hmm.getname(), unit.frames / 100.0f);
-                        }
-                        fprintf(stderr, "\n");
-                    }
-                }
-#endif
-                if (numsilunits > 0)
-                    edgeswithsilence++; // (for diagnostics message only)
-                backptrbufsize += maxsilframes * numofstates;
-            }
-            backptroffsets[L.edges.size()] = backptrbufsize; // (TODO: remove if not actually needed)
-            if (verbosity)
-                fprintf(stderr, "backpointers: %.1f%% edges have at least one /sil/ unit inside\n", 100.0f * ((float) edgeswithsilence / L.edges.size()));
         }
         // CUDA support
         const std::vector<size_t>& getbackptroffsets() const
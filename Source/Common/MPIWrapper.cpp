@@ -5,6 +5,7 @@
 #include "Include/Basics.h"
 #include "Include/MPIWrapper.h"
 #include "Include/EnvironmentUtil.h"
+#include <algorithm>
 
 #if HAS_MPI
 #pragma comment(lib, "msmpi.lib")
@@ -30,10 +31,23 @@ class MPIWrapperMpi : public MPIWrapper
     int m_numMPINodes;
     size_t m_numNodesInUse;
     bool m_multiHost;
+    size_t m_numHosts;
+    size_t m_hostIndex;
+    size_t m_numNodesOnHost;
+    size_t m_rankOnHost;
 
     // MPI communicator that reflects the current subset selection
     MPI_Comm m_currentComm;
 
+    // Sums of float and double values use the built-in all-reduce below instead of MPI_Allreduce (CNTK_MPI_NATIVE_ALLREDUCE=1).
+    // Its messages are exchanged on a duplicate of the communicator, so that they never match the ones of other exchanges.
+    bool m_useNativeAllReduce;
+    MPI_Comm m_nativeAllReduceComm;
+
+    // Messages from this size on are reduced with the ring all-reduce, in segments of the given size; smaller ones with recursive doubling.
+    static const size_t s_ringAllReduceMinBytes = 256 * 1024;
+    static const size_t s_ringAllReduceSegmentBytes = 1024 * 1024;
+
     // MPI_Init() is loading the msmpi.dll. Failing to load the dll will terminate the
     // application.
     int MPI_Init_DL();
@@ -61,6 +75,11 @@ private:
 
     void RequestNodes(const char *msg, size_t requestednodes = SIZE_MAX /*default: all*/);
 
+    bool UseNativeAllReduce(size_t numElements, MPI_Op op) const;
+    template <class ElemType> void NativeAllReduce(ElemType* sendData, ElemType* receiveData, size_t numElements) const;
+    template <class ElemType> void RingAllReduce(ElemType* data, size_t numElements) const;
+    template <class ElemType> void RecursiveDoublingAllReduce(ElemType* data, size_t numElements) const;
+
 public:
 
     size_t NumNodesInUse() const;
@@ -71,6 +90,10 @@ public:
     bool UsingAllNodes() const;
     size_t MainNodeRank() const;
     bool IsMultiHost() const;
+    size_t NumHosts() const;
+    size_t CurrentHostIndex() const;
+    size_t NumNodesOnCurrentHost() const;
+    size_t CurrentNodeRankOnHost() const;
 
     // Use GPUDirect RDMA support
     virtual bool UseGpuGdr() override;
@@ -83,6 +106,8 @@ public:
     virtual int Wait(MPI_Request* request, MPI_Status* status);
     virtual int Waitany(int count, MPI_Request array_of_requests[], int* index, MPI_Status* status);
     virtual int Waitall(int count, MPI_Request array_of_requests[], MPI_Status array_of_statuses[]);
+    virtual int Test(MPI_Request* request, int* flag, MPI_Status* status);
+    virtual int Testany(int count, MPI_Request array_of_requests[], int* index, int* flag, MPI_Status* status);
     virtual int Isend(const void* buf, int count, MPI_Datatype datatype, int dest, int tag, /*MPI_Comm comm,*/ MPI_Request* request);
     virtual int Recv(void* buf, int count, MPI_Datatype datatype, int source, int tag, /*MPI_Comm comm,*/ MPI_Status* status);
     virtual int Irecv(void* buf, int count, MPI_Datatype datatype, int source, int tag, /*MPI_Comm comm,*/ MPI_Request* request);
@@ -132,6 +157,7 @@ public:
     virtual void AllGather(const float *sendData, size_t numSendElements, float *receiveData, size_t numRecvElements) const;
     virtual void AllGather(const double *sendData, size_t numSendElements, double *receiveData, size_t numRecvElements) const;
     virtual void Allgather(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount, MPI_Datatype recvtype) const;
+    virtual void Allgatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, const int recvcounts[], const int displs[], MPI_Datatype recvtype) const;
 
     virtual void Gather(const size_t *sendData, size_t numSendElements, size_t *receiveData, size_t numRecvElements, size_t rootRank) const;
     virtual void Gather(const int *sendData, size_t numSendElements, int *receiveData, size_t numRecvElements, size_t rootRank) const;
@@ -169,6 +195,10 @@ public:
     bool UsingAllNodes() const;
     size_t MainNodeRank() const;
     bool IsMultiHost() const;
+    size_t NumHosts() const;
+    size_t CurrentHostIndex() const;
+    size_t NumNodesOnCurrentHost() const;
+    size_t CurrentNodeRankOnHost() const;
     // Use GPUDirect RDMA
     virtual bool UseGpuGdr() override;
 
@@ -180,6 +210,8 @@ public:
     virtual int Wait(MPI_Request* request, MPI_Status* status);
     virtual int Waitany(int count, MPI_Request array_of_requests[], int* index, MPI_Status* status);
     virtual int Waitall(int count, MPI_Request array_of_requests[], MPI_Status array_of_statuses[]);
+    virtual int Test(MPI_Request* request, int* flag, MPI_Status* status);
+    virtual int Testany(int count, MPI_Request array_of_requests[], int* index, int* flag, MPI_Status* status);
     virtual int Isend(const void* buf, int count, MPI_Datatype datatype, int dest, int tag, /*MPI_Comm comm,*/ MPI_Request* request);
     virtual int Recv(void* buf, int count, MPI_Datatype datatype, int source, int tag, /*MPI_Comm comm,*/ MPI_Status* status);
     virtual int Irecv(void* buf, int count, MPI_Datatype datatype, int source, int tag, /*MPI_Comm comm,*/ MPI_Request* request);
@@ -224,6 +256,7 @@ public:
     virtual void AllGatherAsync(const float *sendData, size_t numSendElements, float *receiveData, size_t numRecvElements, MPI_Request* request) const;
     virtual void AllGatherAsync(const double *sendData, size_t numSendElements, double *receiveData, size_t numRecvElements, MPI_Request* request) const;
     virtual void Allgather(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount, MPI_Datatype recvtype) const;
+    virtual void Allgatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, const int recvcounts[], const int displs[], MPI_Datatype recvtype) const;
 
     virtual void AllGather(const size_t *sendData, size_t numSendElements, size_t *receiveData, size_t numRecvElements) const;
     virtual void AllGather(const int *sendData, size_t numSendElements, int *receiveData, size_t numRecvElements) const;
@@ -373,7 +406,7 @@ MPI_Datatype MPIWrapper::GetDataType(size_t *)
 int MPIWrapperMpi::s_myRank = -1;
 
 MPIWrapperMpi::MPIWrapperMpi()
-    : m_currentComm(MPI_COMM_WORLD)
+    : m_currentComm(MPI_COMM_WORLD), m_useNativeAllReduce(false)
 {
     static bool initialized = false;
     if (initialized)
@@ -392,6 +425,10 @@ MPIWrapperMpi::MPIWrapperMpi()
     MPI_Comm_size(MPI_COMM_WORLD, &m_numMPINodes);
     m_numNodesInUse = m_numMPINodes;
     m_multiHost = true;
+    m_numHosts = 1;
+    m_hostIndex = 0;
+    m_numNodesOnHost = 1;
+    m_rankOnHost = 0;
 
     // Verify that the environment variable used by GetTotalNumberOfMPINodes()  
     // matches what the MPI API says.
@@ -409,6 +446,18 @@ MPIWrapperMpi::MPIWrapperMpi()
     // by default we use all of them
     RequestNodes("MPIWrapperMpi");
 
+#pragma warning(push)
+#pragma warning(disable : 4996) // getenv
+    const char* nativeAllReduce = getenv("CNTK_MPI_NATIVE_ALLREDUCE");
+#pragma warning(pop)
+    if (nativeAllReduce != nullptr && atoi(nativeAllReduce) != 0)
+    {
+        MPI_Comm_dup(m_currentComm, &m_nativeAllReduceComm) || MpiFail("MPIWrapperMpi: MPI_Comm_dup");
+        m_useNativeAllReduce = true;
+        fprintf(stderr, "MPIWrapperMpi: using the native ring/recursive doubling all-reduce for float and double sums\n");
+        fflush(stderr);
+    }
+
     if (GetMathLibTraceLevel() > 0)
     {
         if (m_numMPINodes > 1)
@@ -579,6 +628,28 @@ void MPIWrapperMpi::RequestNodes(const char *msg, size_t requestednodes /*defaul
         }
     }
 
+    // Group the ranks by host name, e.g. for hierarchical reductions (see NcclComm).
+    std::vector<size_t> hostOfRank(m_numNodesInUse);
+    m_numHosts = 0;
+    for (size_t i = 0; i < m_numNodesInUse; i++)
+    {
+        size_t j = 0;
+        while (j < i && strcmp(allNames + i*nameMax, allNames + j*nameMax) != 0)
+            j++;
+        hostOfRank[i] = (j < i) ? hostOfRank[j] : m_numHosts++;
+    }
+
+    const size_t myRank = CurrentNodeRank();
+    m_hostIndex = 0;
+    m_numNodesOnHost = 1;
+    m_rankOnHost = 0;
+    if (myRank < m_numNodesInUse) // (not idle)
+    {
+        m_hostIndex = hostOfRank[myRank];
+        m_numNodesOnHost = std::count(hostOfRank.begin(), hostOfRank.end(), m_hostIndex);
+        m_rankOnHost = std::count(hostOfRank.begin(), hostOfRank.begin() + myRank, m_hostIndex);
+    }
+
     fprintf(stderr, "requestnodes [%s]: using %d out of %d MPI nodes on %s (%d requested); we (%d) are %s\n",
         msg, (int)m_numNodesInUse, (int)m_numMPINodes, m_multiHost ? "multiple hosts" : "a single host",
         (int)requestednodes, (int)CurrentNodeRank(), IsIdle() ? "out (idle)" : "in (participating)");
@@ -590,6 +661,26 @@ bool MPIWrapperMpi::IsMultiHost() const
     return m_multiHost;
 }
 
+size_t MPIWrapperMpi::NumHosts() const
+{
+    return m_numHosts;
+}
+
+size_t MPIWrapperMpi::CurrentHostIndex() const
+{
+    return m_hostIndex;
+}
+
+size_t MPIWrapperMpi::NumNodesOnCurrentHost() const
+{
+    return m_numNodesOnHost;
+}
+
+size_t MPIWrapperMpi::CurrentNodeRankOnHost() const
+{
+    return m_rankOnHost;
+}
+
 MPI_Comm MPIWrapperMpi::Communicator() const
 {
     return m_currentComm;
@@ -626,6 +717,16 @@ int MPIWrapperMpi::Waitall(int count, MPI_Request array_of_requests[], MPI_Statu
     return MPI_Waitall(count, array_of_requests, array_of_statuses);
 }
 
+int MPIWrapperMpi::Test(MPI_Request* request, int* flag, MPI_Status* status)
+{
+    return MPI_Test(request, flag, status);
+}
+
+int MPIWrapperMpi::Testany(int count, MPI_Request array_of_requests[], int* index, int* flag, MPI_Status* status)
+{
+    return MPI_Testany(count, array_of_requests, index, flag, status);
+}
+
 int MPIWrapperMpi::Isend(const void* buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Request* request)
 {
     return MPI_Isend(buf, count, datatype, dest, tag, m_currentComm, request);
@@ -760,6 +861,173 @@ void MPIWrapperMpi::AllReduce(float* sendData, size_t numElements, MPI_Op op) co
     AllReduce(static_cast<float*>(MPI_IN_PLACE), sendData, numElements, op);
 }
 
+// -----------------------------------------------------------------------
+// native all-reduce
+// MPI_Allreduce of some MPI implementations is a reduce followed by a broadcast, which makes the root
+// the bottleneck for large gradients. The ring all-reduce instead sends 2 (N-1)/N times the data from every node,
+// split into segments so that the summation of a segment overlaps the transfers of the next ones.
+// Small messages are latency-bound and use recursive doubling (log N exchanges of the whole message).
+// Both compute the sums in the same order on all nodes, so that all of them get the same bits.
+// Like MPI collectives, the calls must be made in the same order by all nodes, and not concurrently.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+static void SumInto(ElemType* accumulator, const ElemType* values, size_t numElements)
+{
+    for (size_t i = 0; i < numElements; i++)
+        accumulator[i] += values[i];
+}
+
+bool MPIWrapperMpi::UseNativeAllReduce(size_t numElements, MPI_Op op) const
+{
+    return m_useNativeAllReduce && op == MPI_SUM && UsingAllNodes() && m_numNodesInUse > 1 && numElements > 0;
+}
+
+template <class ElemType>
+void MPIWrapperMpi::NativeAllReduce(ElemType* sendData, ElemType* receiveData, size_t numElements) const
+{
+    if (sendData != static_cast<ElemType*>(MPI_IN_PLACE) && sendData != receiveData)
+        memcpy(receiveData, sendData, numElements * sizeof(ElemType));
+
+    if (numElements * sizeof(ElemType) < s_ringAllReduceMinBytes || numElements < m_numNodesInUse)
+        RecursiveDoublingAllReduce(receiveData, numElements);
+    else
+        RingAllReduce(receiveData, numElements);
+}
+
+// Reduce-scatter followed by an all-gather around the ring of nodes: in step s, node r receives chunk (r - s - 1) from
+// its left neighbour, adds it to its own (first N-1 steps) or stores it (last N-1 steps), and forwards it to its right neighbour.
+// After the reduce-scatter, node r owns the complete sum of chunk (r + 1).
+template <class ElemType>
+void MPIWrapperMpi::RingAllReduce(ElemType* data, size_t numElements) const
+{
+    const size_t numNodes = m_numNodesInUse;
+    const size_t rank = m_myRank;
+    const int left = (int)((rank + numNodes - 1) % numNodes);
+    const int right = (int)((rank + 1) % numNodes);
+    const MPI_Datatype dataType = GetDataType(data);
+    const size_t segmentSize = std::max<size_t>(1, s_ringAllReduceSegmentBytes / sizeof(ElemType));
+
+    auto chunkBegin = [&](size_t chunk) { return numElements * chunk / numNodes; };
+    auto chunkSize = [&](size_t chunk) { return chunkBegin(chunk + 1) - chunkBegin(chunk); };
+    auto numSegments = [&](size_t chunk) { return (chunkSize(chunk) + segmentSize - 1) / segmentSize; };
+    auto segmentLength = [&](size_t chunk, size_t segment) { return std::min(segmentSize, chunkSize(chunk) - segment * segmentSize); };
+
+    // the last chunk is the largest one
+    std::vector<ElemType> incoming(chunkSize(numNodes - 1));
+
+    // Segments are sent as soon as they are complete; the tag identifies the segment within its chunk.
+    std::vector<std::vector<MPI_Request>> sendRequests(numNodes);
+    auto sendSegment = [&](size_t chunk, size_t segment)
+    {
+        sendRequests[chunk].push_back(MPI_Request());
+        MPI_Isend(data + chunkBegin(chunk) + segment * segmentSize, (int)segmentLength(chunk, segment), dataType,
+                  right, (int)segment, m_nativeAllReduceComm, &sendRequests[chunk].back()) || MpiFail("RingAllReduce: MPI_Isend");
+    };
+    auto waitForSends = [&](size_t chunk)
+    {
+        if (!sendRequests[chunk].empty())
+            MPI_Waitall((int)sendRequests[chunk].size(), sendRequests[chunk].data(), MPI_STATUSES_IGNORE) || MpiFail("RingAllReduce: MPI_Waitall");
+        sendRequests[chunk].clear();
+    };
+
+    for (size_t segment = 0; segment < numSegments(rank); segment++)
+        sendSegment(rank, segment);
+
+    std::vector<MPI_Request> recvRequests;
+    const size_t numSteps = 2 * (numNodes - 1);
+    for (size_t step = 0; step < numSteps; step++)
+    {
+        const bool reduce = step < numNodes - 1;
+        const size_t chunk = (rank + 2 * numNodes - step - 1) % numNodes;
+
+        // The all-gather receives straight into the chunk, which must not be sent from anymore.
+        // Only the sends of this chunk are waited for: they were received in earlier steps of the right neighbour.
+        if (!reduce)
+            waitForSends(chunk);
+
+        ElemType* target = reduce ? incoming.data() : data + chunkBegin(chunk);
+        recvRequests.assign(numSegments(chunk), MPI_Request());
+        for (size_t segment = 0; segment < recvRequests.size(); segment++)
+        {
+            MPI_Irecv(target + segment * segmentSize, (int)segmentLength(chunk, segment), dataType,
+                      left, (int)segment, m_nativeAllReduceComm, &recvRequests[segment]) || MpiFail("RingAllReduce: MPI_Irecv");
+        }
+
+        for (size_t i = 0; i < recvRequests.size(); i++)
+        {
+            int segment;
+            MPI_Waitany((int)recvRequests.size(), recvRequests.data(), &segment, MPI_STATUS_IGNORE) || MpiFail("RingAllReduce: MPI_Waitany");
+
+            if (reduce)
+                SumInto(data + chunkBegin(chunk) + segment * segmentSize, incoming.data() + segment * segmentSize, segmentLength(chunk, segment));
+
+            if (step + 1 < numSteps)
+                sendSegment(chunk, segment);
+        }
+    }
+
+    for (size_t chunk = 0; chunk < numNodes; chunk++)
+        waitForSends(chunk);
+}
+
+// Nodes exchange their partial sums with the node whose rank differs in one bit, for every bit.
+// With a node count that is not a power of two, the nodes beyond the largest power of two first hand their values
+// to a neighbour, and get the result from it at the end.
+template <class ElemType>
+void MPIWrapperMpi::RecursiveDoublingAllReduce(ElemType* data, size_t numElements) const
+{
+    const int numNodes = (int)m_numNodesInUse;
+    const int rank = m_myRank;
+    const MPI_Datatype dataType = GetDataType(data);
+    const int count = (int)numElements;
+
+    std::vector<ElemType> incoming(numElements);
+
+    int numPow2Nodes = 1;
+    while (2 * numPow2Nodes <= numNodes)
+        numPow2Nodes *= 2;
+    const int numExtraNodes = numNodes - numPow2Nodes;
+
+    // among the first 2 * numExtraNodes ranks, the even ones hand their values to the odd ones and sit out the exchanges
+    int virtualRank;
+    if (rank < 2 * numExtraNodes)
+    {
+        if (rank % 2 == 0)
+        {
+            MPI_Send(data, count, dataType, rank + 1, 0, m_nativeAllReduceComm) || MpiFail("RecursiveDoublingAllReduce: MPI_Send");
+            virtualRank = -1;
+        }
+        else
+        {
+            MPI_Recv(incoming.data(), count, dataType, rank - 1, 0, m_nativeAllReduceComm, MPI_STATUS_IGNORE) || MpiFail("RecursiveDoublingAllReduce: MPI_Recv");
+            SumInto(data, incoming.data(), numElements);
+            virtualRank = rank / 2;
+        }
+    }
+    else
+        virtualRank = rank - numExtraNodes;
+
+    if (virtualRank >= 0)
+    {
+        for (int mask = 1; mask < numPow2Nodes; mask <<= 1)
+        {
+            const int virtualPeer = virtualRank ^ mask;
+            const int peer = (virtualPeer < numExtraNodes) ? (2 * virtualPeer + 1) : (virtualPeer + numExtraNodes);
+            MPI_Sendrecv(data, count, dataType, peer, 0, incoming.data(), count, dataType, peer, 0, m_nativeAllReduceComm, MPI_STATUS_IGNORE) || MpiFail("RecursiveDoublingAllReduce: MPI_Sendrecv");
+            SumInto(data, incoming.data(), numElements);
+        }
+    }
+
+    if (rank < 2 * numExtraNodes)
+    {
+        if (rank % 2 == 0)
+            MPI_Recv(data, count, dataType, rank + 1, 0, m_nativeAllReduceComm, MPI_STATUS_IGNORE) || MpiFail("RecursiveDoublingAllReduce: MPI_Recv");
+        else
+            MPI_Send(data, count, dataType, rank - 1, 0, m_nativeAllReduceComm) || MpiFail("RecursiveDoublingAllReduce: MPI_Send");
+    }
+}
+
 void MPIWrapperMpi::AllReduce(size_t* sendData, size_t* receiveData, size_t numElements, MPI_Op op) const
 {
     MPI_Allreduce(sendData, receiveData, (int)numElements, GetDataType(sendData), op, Communicator()) || MpiFail("Allreduce: MPI_Allreduce");
@@ -772,11 +1040,23 @@ void MPIWrapperMpi::AllReduce(int* sendData, int* receiveData, size_t numElement
 
 void MPIWrapperMpi::AllReduce(double* sendData, double* receiveData, size_t numElements, MPI_Op op) const
 {
+    if (UseNativeAllReduce(numElements, op))
+    {
+        NativeAllReduce(sendData, receiveData, numElements);
+        return;
+    }
+
     MPI_Allreduce(sendData, receiveData, (int)numElements, GetDataType(sendData), op, Communicator()) || MpiFail("Allreduce: MPI_Allreduce");
 }
 
 void MPIWrapperMpi::AllReduce(float* sendData, float* receiveData, size_t numElements, MPI_Op op) const
 {
+    if (UseNativeAllReduce(numElements, op))
+    {
+        NativeAllReduce(sendData, receiveData, numElements);
+        return;
+    }
+
     MPI_Allreduce(sendData, receiveData, (int)numElements, GetDataType(sendData), op, Communicator()) || MpiFail("Allreduce: MPI_Allreduce");
 }
 
@@ -884,6 +1164,11 @@ void MPIWrapperMpi::Allgather(const void* sendbuf, int sendcount, MPI_Datatype s
     MPI_Allgather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, Communicator()) || MpiFail("AllReduceAsync: MPI_Allgather");
 }
 
+void MPIWrapperMpi::Allgatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, const int recvcounts[], const int displs[], MPI_Datatype recvtype) const
+{
+    MPI_Allgatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, Communicator()) || MpiFail("Allgatherv: MPI_Allgatherv");
+}
+
 void MPIWrapperMpi::Gather(const size_t *sendData, size_t numSendElements, size_t *receiveData, size_t numRecvElements, size_t rootRank) const
 {
     MPI_Gather(sendData, (int)numSendElements, GetDataType(receiveData), receiveData, (int)numRecvElements, GetDataType(receiveData), (int)rootRank, Communicator()) || MpiFail("AllReduceAsync: MPI_Gather");
@@ -973,6 +1258,26 @@ bool MPIWrapperEmpty::IsMultiHost() const
     return false;
 }
 
+size_t MPIWrapperEmpty::NumHosts() const
+{
+    return 1;
+}
+
+size_t MPIWrapperEmpty::CurrentHostIndex() const
+{
+    return 0;
+}
+
+size_t MPIWrapperEmpty::NumNodesOnCurrentHost() const
+{
+    return 1;
+}
+
+size_t MPIWrapperEmpty::CurrentNodeRankOnHost() const
+{
+    return 0;
+}
+
 bool MPIWrapperEmpty::UseGpuGdr()
 {
     return false;
@@ -1009,6 +1314,16 @@ int MPIWrapperEmpty::Waitall(int count, MPI_Request array_of_requests[], MPI_Sta
     return MPI_UNDEFINED;
 }
 
+int MPIWrapperEmpty::Test(MPI_Request* request, int* flag, MPI_Status* status)
+{
+    return MPI_UNDEFINED;
+}
+
+int MPIWrapperEmpty::Testany(int count, MPI_Request array_of_requests[], int* index, int* flag, MPI_Status* status)
+{
+    return MPI_UNDEFINED;
+}
+
 int MPIWrapperEmpty::Isend(const void* buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Request* request)
 {
     return MPI_UNDEFINED;
@@ -1212,6 +1527,10 @@ void MPIWrapperEmpty::Allgather(const void* sendbuf, int sendcount, MPI_Datatype
 {
 }
 
+void MPIWrapperEmpty::Allgatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, const int recvcounts[], const int displs[], MPI_Datatype recvtype) const
+{
+}
+
 void MPIWrapperEmpty::Gather(const size_t *sendData, size_t numSendElements, size_t *receiveData, size_t numRecvElements, size_t rootRank) const
 {
 }
@@ -86,15 +86,56 @@ void ComputationNetwork::ClearNetwork()
     m_pMBLayoutOfNetwork->Init(1, 0);
 }
 
+// Prints what the nodes accumulated since the last call while Globals::ShouldEnableNodeTiming(), most expensive first,
+// and resets it. 'shared' is the number of other nodes that use the same value/gradient matrix of the MatrixPool.
 void ComputationNetwork::PrintNodeTiming()
 {
+    vector<pair<ComputationNodeBasePtr, NodeTimingStatistics>> nodes;
+    map<const void*, int> numUsers; // of each value and gradient matrix
+    double totalSeconds = 0;
     for (auto& iter : m_nameToNodeMap)
     {
-        auto nodePtr = iter.second->As<ComputationNode<float>>();
-        if (nodePtr)
-        {
-            nodePtr->PrintForwardBackwardTime();
-        }
+        NodeTimingStatistics statistics;
+        if (!iter.second->GetTimingStatistics(statistics))
+            continue;
+
+        nodes.push_back(make_pair(iter.second, statistics));
+        if (statistics.value)
+            numUsers[statistics.value]++;
+        if (statistics.gradient)
+            numUsers[statistics.gradient]++;
+        totalSeconds += statistics.forwardSeconds + statistics.backwardSeconds;
+        iter.second->ResetTiming();
+    }
+    if (nodes.empty())
+        return;
+
+    sort(nodes.begin(), nodes.end(), [](const pair<ComputationNodeBasePtr, NodeTimingStatistics>& a, const pair<ComputationNodeBasePtr, NodeTimingStatistics>& b)
+    {
+        return a.second.forwardSeconds + a.second.backwardSeconds > b.second.forwardSeconds + b.second.backwardSeconds;
+    });
+
+    fprintf(stderr, "\nNode timing (GPU time for the nodes on a GPU), %d nodes, %.3fs in total:\n", (int)nodes.size(), totalSeconds);
+    fprintf(stderr, "%-30s %-22s %6s %6s %12s %12s %10s %6s %6s %10s %10s %8s\n",
+            "node", "operation", "fwd#", "bwd#", "fwd avg[ms]", "bwd avg[ms]", "total[s]", "%", "cum%", "value[MB]", "grad[MB]", "shared");
+    double cumulativeSeconds = 0;
+    for (const auto& node : nodes)
+    {
+        const auto& statistics = node.second;
+        double seconds = statistics.forwardSeconds + statistics.backwardSeconds;
+        cumulativeSeconds += seconds;
+        auto shared = [&numUsers](const void* matrix) { return matrix ? numUsers[matrix] - 1 : 0; };
+        fprintf(stderr, "%-30ls %-22ls %6d %6d %12.4f %12.4f %10.4f %6.2f %6.2f %10.3f %10.3f %4d/%-3d%s\n",
+                node.first->NodeName().c_str(), node.first->OperationName().c_str(),
+                statistics.forwardCount, statistics.backwardCount,
+                statistics.forwardCount == 0 ? 0 : 1000 * statistics.forwardSeconds / statistics.forwardCount,
+                statistics.backwardCount == 0 ? 0 : 1000 * statistics.backwardSeconds / statistics.backwardCount,
+                seconds,
+                totalSeconds == 0 ? 0 : 100 * seconds / totalSeconds,
+                totalSeconds == 0 ? 0 : 100 * cumulativeSeconds / totalSeconds,
+                statistics.valueBytes / 1e6, statistics.gradientBytes / 1e6,
+                shared(statistics.value), shared(statistics.gradient),
+                statistics.onGPU ? "" : " (CPU)");
     }
 }
 
@@ -514,6 +555,7 @@ bool ComputationNetwork::IsTypicalCriterionNode(ComputationNodeBasePtr nodePtr)
         nodePtr->OperationName() == OperationNameOf(LatticeSequenceWithSoftmaxNode) ||
         nodePtr->OperationName() == OperationNameOf(CrossEntropyNode) ||
         nodePtr->OperationName() == OperationNameOf(ClassBasedCrossEntropyWithSoftmaxNode) ||
+        nodePtr->OperationName() == OperationNameOf(SampledCrossEntropyWithSoftmaxNode) ||
         nodePtr->OperationName() == OperationNameOf(ClassificationErrorNode) ||
         nodePtr->OperationName() == OperationNameOf(ForwardBackwardNode) ||
 #ifdef COMING_SOON
@@ -664,6 +706,24 @@ template <class ElemType>
     }
 }
 
+template <class ElemType>
+/*static*/ void ComputationNetwork::SetBatchNormalizationSyncGroupSize(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, size_t syncGroupSize)
+{
+    auto batchNormalizationNodes = net->GetNodesWithType(OperationNameOf(BatchNormalizationNode), criterionNode);
+    if (batchNormalizationNodes.size() == 0)
+        return;
+
+    if (syncGroupSize == 0)
+        fprintf(stderr, "Setting batch normalization to use the statistics of all workers.\n");
+    else if (syncGroupSize != 1)
+        fprintf(stderr, "Setting batch normalization to use the statistics of groups of %d workers.\n", (int)syncGroupSize);
+    for (auto& nodeIter : batchNormalizationNodes)
+    {
+        auto node = dynamic_pointer_cast<BatchNormalizationNode<ElemType>>(nodeIter);
+        node->SetSyncGroupSize(syncGroupSize);
+    }
+}
+
 //set sequence training parameters, e.g. smoothing weight, frame drop threshhold
 template <class ElemType>
 void ComputationNetwork::SetSeqParam(ComputationNetworkPtr net,
@@ -1578,6 +1638,7 @@ template void ComputationNetwork::Read<float>(const wstring& fileName);
 template void ComputationNetwork::ReadPersistableParameters<float>(size_t modelVersion, File& fstream, bool create);
 template void ComputationNetwork::PerformSVDecomposition<float>(const map<wstring, float>& SVDConfig, size_t alignedsize);
 template /*static*/ void ComputationNetwork::SetBatchNormalizationTimeConstants<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double normalizationTimeConstant, double& prevNormalizationTimeConstant, double blendTimeConstant, double& prevBlendTimeConstant);
+template /*static*/ void ComputationNetwork::SetBatchNormalizationSyncGroupSize<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, size_t syncGroupSize);
 template void ComputationNetwork::SetSeqParam<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr criterionNode, const double& hsmoothingWeight, const double& frameDropThresh, const bool& doreferencealign,
                                                      const double& amf, const double& lmf, const double& wp, const double& bMMIfactor, const bool& sMBR);
 template void ComputationNetwork::SaveToDbnFile<float>(ComputationNetworkPtr net, const std::wstring& fileName) const;
@@ -1587,6 +1648,7 @@ template void ComputationNetwork::Read<double>(const wstring& fileName);
 template void ComputationNetwork::ReadPersistableParameters<double>(size_t modelVersion, File& fstream, bool create);
 template void ComputationNetwork::PerformSVDecomposition<double>(const map<wstring, float>& SVDConfig, size_t alignedsize);
 template /*static*/ void ComputationNetwork::SetBatchNormalizationTimeConstants<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double normalizationTimeConstant, double& prevNormalizationTimeConstant, double blendTimeConstant, double& prevBlendTimeConstant);
+template /*static*/ void ComputationNetwork::SetBatchNormalizationSyncGroupSize<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, size_t syncGroupSize);
 template void ComputationNetwork::SetSeqParam<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr criterionNode, const double& hsmoothingWeight, const double& frameDropThresh, const bool& doreferencealign,
                                                       const double& amf, const double& lmf, const double& wp, const double& bMMIfactor, const bool& sMBR);
 template void ComputationNetwork::SaveToDbnFile<double>(ComputationNetworkPtr net, const std::wstring& fileName) const;
@@ -1596,6 +1658,7 @@ template void ComputationNetwork::Read<half>(const wstring& fileName);
 template void ComputationNetwork::ReadPersistableParameters<half>(size_t modelVersion, File& fstream, bool create);
 template void ComputationNetwork::PerformSVDecomposition<half>(const map<wstring, float>& SVDConfig, size_t alignedsize);
 template /*static*/ void ComputationNetwork::SetBatchNormalizationTimeConstants<half>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double normalizationTimeConstant, double& prevNormalizationTimeConstant, double blendTimeConstant, double& prevBlendTimeConstant);
+template /*static*/ void ComputationNetwork::SetBatchNormalizationSyncGroupSize<half>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, size_t syncGroupSize);
 template void ComputationNetwork::SetSeqParam<half>(ComputationNetworkPtr net, const ComputationNodeBasePtr criterionNode, const double& hsmoothingWeight, const double& frameDropThresh, const bool& doreferencealign,
     const double& amf, const double& lmf, const double& wp, const double& bMMIfactor, const bool& sMBR);
 template void ComputationNetwork::SaveToDbnFile<half>(ComputationNetworkPtr net, const std::wstring& fileName) const;
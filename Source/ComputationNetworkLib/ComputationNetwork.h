@@ -148,7 +148,11 @@ public:
     void PostForwardAndBackProp(const ComputationNodeBasePtr rootNode);
 
     // main entry point for backprop
-    void Backprop(const ComputationNodeBasePtr rootNode);
+    // If given, 'callback' is invoked for every top-level node right after its backprop. Since nodes are visited
+    // in reverse evaluation order, the gradient of a leaf (e.g. a LearnableParameter) is final once it is passed
+    // to the callback; this allows to e.g. start aggregating it while backprop continues.
+    typedef std::function<void(const ComputationNodeBasePtr&)> BackpropCallback;
+    void Backprop(const ComputationNodeBasePtr rootNode, const BackpropCallback& callback = nullptr);
 
     template <class NODESET> // version that takes multiple nodes
     void TravserseInSortedGlobalEvalOrder(const NODESET& nodes, const std::function<void(const ComputationNodeBasePtr&)>& action)
@@ -183,6 +187,8 @@ public:
     template <class NODESET> // version that takes multiple nodes
     void ForwardProp(const NODESET& nodes)
     {
+        if (ForwardPropConcurrently(std::vector<ComputationNodeBasePtr>(nodes.begin(), nodes.end())))
+            return;
         TravserseInSortedGlobalEvalOrder(nodes, [](const ComputationNodeBasePtr& node) {
             PARTraversalFlowControlNode::ForwardProp(node, FrameRange(nullptr));
         });
@@ -252,7 +258,8 @@ public:
     void ValidateNetwork();
 
 private:
-    size_t ValidateNodes(list<ComputationNodeBasePtr> nodes, bool isFirstPass, bool isFinalValidationPass);
+    struct ValidationState;
+    size_t ValidateNodes(const list<ComputationNodeBasePtr>& nodes, bool isFirstPass, bool isFinalValidationPass, ValidationState* state = nullptr);
     bool ValidateNode(ComputationNodeBasePtr node, bool isFinalValidationPass) const;
     void MarkValueNonSharableNodes();
     void ChangeNodeInputs(ComputationNodeBasePtr fromNode, ComputationNodeBasePtr toNode);
@@ -268,12 +275,30 @@ private:
 public:
     void AllocateAllMatrices(const std::vector<ComputationNodeBasePtr>& evalRootNodes, const std::vector<ComputationNodeBasePtr>& outValueRootNodes, ComputationNodeBasePtr trainRootNode);
 
+    // pipeline parallelism: place consecutive stages of the network on the given devices
+    void PlacePipelineStages(const std::vector<DEVICEID_TYPE>& stageDevices, const std::vector<ComputationNodeBasePtr>& rootNodes,
+                             const std::set<ComputationNodeBasePtr>& fixedNodes = std::set<ComputationNodeBasePtr>());
+
     // From the set of nodes extract all nodes which are used as accumulator nodes.
     std::set<ComputationNodeBasePtr> ExtractNodesWhichAccumulateResult(std::set<ComputationNodeBasePtr> nodes);
 
 private:
+    void FuseForwardProp(const std::vector<ComputationNodeBasePtr>& forwardPropRoots);
+    void FuseElementwise(const std::vector<ComputationNodeBasePtr>& forwardPropRoots);
     void PrintMemorySharingStructure(const std::vector<ComputationNodeBasePtr>& nodes);
     void ReleaseMatricesAfterEvalForChildren(ComputationNodeBasePtr n, std::unordered_map<ComputationNodeBasePtr, std::unordered_set<ComputationNodeBasePtr>>& parentsMap);
+    void PlanActivationRecomputation(const ComputationNodeBasePtr& trainRootNode,
+                                     const std::unordered_map<ComputationNodeBasePtr, std::unordered_set<ComputationNodeBasePtr>>& parentsMap,
+                                     std::unordered_map<ComputationNodeBasePtr, bool>& outputValueNeededDuringBackProp);
+    bool RunCapturedOnGPU(const ComputationNodeBasePtr& rootNode, bool backprop, const std::function<void()>& pass);
+    void AnalyzeForwardPropDependencies(const std::vector<ComputationNodeBasePtr>& nodes,
+                                        std::vector<std::vector<size_t>>& inputs, std::vector<std::vector<size_t>>& predecessors);
+    struct ForwardPropPlan;
+    bool ForwardPropConcurrently(const std::vector<ComputationNodeBasePtr>& rootNodes);
+    void ForwardPropOnStreams(ForwardPropPlan& plan);
+    static void PlanForwardPropWavefronts(ForwardPropPlan& plan, const std::vector<std::vector<size_t>>& inputs, const std::vector<std::vector<size_t>>& predecessors);
+    void ForwardPropWavefront(ForwardPropPlan& plan, size_t index);
+    void ForwardPropOnThreadPool(const ForwardPropPlan& plan);
 
 public:
     // -----------------------------------------------------------------------
@@ -283,10 +308,19 @@ public:
     void FormNestedNetwork(const ComputationNodeBasePtr& rootNode);
     ComputationNodeBasePtr GetNestedNetwork(const ComputationNodeBasePtr& rootNode);
 
+    // Sets the directory in which CompileNetwork() caches the roots, eval order and loops of the networks it compiles.
+    // Empty (the default) disables the cache.
+    static void SetCompiledStructureCacheDirectory(const std::wstring& directory);
+
 private:
     // The method below determines evaluation order, which is tricky in presence of recurrent loops.
     void FormRecurrentLoops();
 
+    std::wstring GetCompiledStructureCachePath() const;
+    void SaveCompiledStructure(const std::wstring& path) const;
+    bool TryLoadCompiledStructure(const std::wstring& path);
+    static std::wstring s_compiledStructureCacheDirectory;
+
 public:
     // -----------------------------------------------------------------------
     // evaluation: traversal
@@ -315,16 +349,37 @@ public:
         else // this creates a subset of the global eval order of all nodes that rootNode depends on
         {
             auto rawTraversalForRoot = ::CNTK::PostOrderTraversal(graph, { rootNode });// traverse to find the set (we ignore the order)
-            set<ComputationNodeBasePtr> rawSet(rawTraversalForRoot.begin(), rawTraversalForRoot.end());
-            for (const auto& node : GetEvalOrder(nullptr)) // iterate over global one and pull out everything that is included in the set for rootNode
+            // bring them into the order of the global one, by their positions in it rather than by a pass over all of it
+            const auto& globalPositions = GetGlobalEvalOrderPositions();
+            std::vector<std::pair<size_t, ComputationNodeBasePtr>> positionedNodes;
+            positionedNodes.reserve(rawTraversalForRoot.size());
+            for (const auto& node : rawTraversalForRoot)
             {
-                if (rawSet.find(node) != rawSet.end())
-                    evalOrder.push_back(node);
+                auto position = globalPositions.find(node.get());
+                if (position != globalPositions.end())
+                    positionedNodes.push_back(std::make_pair(position->second, node));
             }
+            std::sort(positionedNodes.begin(), positionedNodes.end(), [](const std::pair<size_t, ComputationNodeBasePtr>& a, const std::pair<size_t, ComputationNodeBasePtr>& b) { return a.first < b.first; });
+            for (const auto& positionedNode : positionedNodes)
+                evalOrder.push_back(positionedNode.second);
         }
+        if (!rootNode)
+            m_globalEvalOrderPositions.clear();
         m_evalOrders[rootNode] = evalOrder;
     }
 
+    // position of every node in GetEvalOrder(nullptr), built once for the global eval order
+    const std::unordered_map<const ComputationNodeBase*, size_t>& GetGlobalEvalOrderPositions()
+    {
+        if (m_globalEvalOrderPositions.empty())
+        {
+            size_t position = 0;
+            for (const auto& node : GetEvalOrder(nullptr))
+                m_globalEvalOrderPositions[node.get()] = position++;
+        }
+        return m_globalEvalOrderPositions;
+    }
+
     template <typename ContainerType>
     std::vector<ComputationNodeBasePtr> SortByGlobalEvalOrder(const ContainerType& nodesToSort)
     {
@@ -333,11 +388,19 @@ public:
             sortedEvalOrder.assign(nodesToSort.cbegin(), nodesToSort.cend());
         else
         {
-            const std::list<ComputationNodeBasePtr>& allNodesEvalOrder = GetEvalOrder(nullptr);
-            for (auto& node : allNodesEvalOrder)
+            const auto& globalPositions = GetGlobalEvalOrderPositions();
+            std::vector<std::pair<size_t, ComputationNodeBasePtr>> positionedNodes;
+            for (const auto& node : nodesToSort)
+            {
+                auto position = globalPositions.find(node.get());
+                if (position != globalPositions.end())
+                    positionedNodes.push_back(std::make_pair(position->second, node));
+            }
+            std::sort(positionedNodes.begin(), positionedNodes.end(), [](const std::pair<size_t, ComputationNodeBasePtr>& a, const std::pair<size_t, ComputationNodeBasePtr>& b) { return a.first < b.first; });
+            for (size_t i = 0; i < positionedNodes.size(); i++)
             {
-                if (std::find(nodesToSort.cbegin(), nodesToSort.cend(), node) != nodesToSort.cend())
-                    sortedEvalOrder.push_back(node);
+                if (i == 0 || positionedNodes[i].first != positionedNodes[i - 1].first) // each node once
+                    sortedEvalOrder.push_back(positionedNodes[i].second);
             }
         }
 
@@ -349,6 +412,8 @@ public:
     void UpdateEvalOrder(const ComputationNodeBasePtr& rootNode, const std::list<ComputationNodeBasePtr>& nodes)
     {
         GetEvalOrder(rootNode); // verify that there is already an entry for rootNode
+        if (!rootNode)
+            m_globalEvalOrderPositions.clear();
         m_evalOrders[rootNode] = nodes;
     }
 
@@ -474,6 +539,10 @@ public:
     void AddFeatureNode(ComputationNodeBasePtr featureNode);
     //ComputationNodeBasePtr RemoveFeatureNode(ComputationNodeBasePtr featureNode);
     void SetLearnableNodesBelowLearningRateMultiplier(const float learningRateMultiplier, const ComputationNodeBasePtr& rootNode = nullptr);
+    size_t FoldBatchNormalization(const std::vector<ComputationNodeBasePtr>& outputNodes);
+    size_t FuseBatchNormalizationRelu(const std::vector<ComputationNodeBasePtr>& keepNodes);
+    size_t QuantizeEmbeddings(const std::vector<ComputationNodeBasePtr>& keepNodes, bool useHalf);
+    void OptimizeForInference(const std::vector<ComputationNodeBasePtr>& outputNodes, const std::set<ComputationNodeBasePtr>& constantNodes);
 
     // -----------------------------------------------------------------------
     // node access
@@ -544,6 +613,9 @@ public:
                                                    double normalizationTimeConstant, double& prevNormalizationTimeConstant,
                                                    double blendTimeConstant, double& prevBlendTimeConstant);
 
+    template <class ElemType>
+    static void SetBatchNormalizationSyncGroupSize(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, size_t syncGroupSize);
+
     template <class ElemType>
     static void SetSeqParam(ComputationNetworkPtr net,
                             const ComputationNodeBasePtr criterionNode,
@@ -1135,6 +1207,8 @@ protected:
         virtual void BeginForwardProp() override;
         virtual void ForwardProp(const FrameRange&) override;
         virtual void EndForwardProp() override;
+        // one time step of ForwardProp(), also used when stepping several loops together (see ForwardPropWavefront())
+        void ForwardPropStep(const FrameRange& t);
         virtual void BeginBackprop() override;
         virtual void BackpropTo(const size_t inputIndex, const FrameRange&) override
         {
@@ -1212,6 +1286,25 @@ protected:
         // There is currently no other constructor for inner nested PAR-traversed sub-networks, but there will be.
         PARTraversalFlowControlNode(const std::vector<shared_ptr<SEQTraversalFlowControlNode>>& recurrentInfo, const std::list<ComputationNodeBasePtr>& allNodes);
         // Base::m_nestedNodes contains all top-level nodes, in evaluation order
+        const std::vector<ComputationNodeBasePtr>& GetNestedNodes() const { return m_nestedNodes; }
+
+        // activation recomputation, see ComputationNetwork::PlanActivationRecomputation()
+        // The plan maps the last node of each segment to the nodes of that segment whose values are recomputed, in evaluation order.
+        typedef std::map<ComputationNodeBasePtr, std::vector<ComputationNodeBasePtr>> RecomputationPlan;
+        void SetRecomputationPlan(const RecomputationPlan& plan);
+        void RequestRecomputationBuffersForSegment(const ComputationNodeBasePtr& segmentEnd, MatrixPool& matrixPool);
+        void ReleaseRecomputationBuffer(const ComputationNodeBasePtr& node, MatrixPool& matrixPool);
+
+        // see ComputationNetwork::Backprop()
+        void SetBackpropCallback(const BackpropCallback& callback) { m_backpropCallback = callback; }
+
+    private:
+        static void Recompute(const ComputationNodeBasePtr& node, const FrameRange& fr);
+
+        RecomputationPlan m_recomputationPlan;
+        std::set<ComputationNodeBasePtr> m_recomputedNodes; // all nodes in m_recomputationPlan
+
+        BackpropCallback m_backpropCallback;
     };
 
 public:
@@ -1275,8 +1368,16 @@ private:
 
     // cached network iterations
     std::map<const ComputationNodeBasePtr, std::list<ComputationNodeBasePtr>> m_evalOrders; // [out node] flat depth-first traversal starting from out node
+    std::unordered_map<const ComputationNodeBase*, size_t> m_globalEvalOrderPositions;      // [node] position in m_evalOrders[nullptr], see GetGlobalEvalOrderPositions()
     std::map<const ComputationNodeBasePtr, ComputationNodeBasePtr> m_nestedNetworks;        // [out node] network rewritten as recursive traveral, potentially optimized; execution plan
 
+    // [out node, backprop] GPU graphs of ForwardProp() and Backprop(), see RunCapturedOnGPU()
+    struct CapturedPass;
+    std::map<std::pair<ComputationNodeBasePtr, bool>, std::shared_ptr<CapturedPass>> m_capturedPasses;
+
+    // [out nodes] concurrent execution of ForwardProp(), see ForwardPropConcurrently()
+    std::map<std::vector<ComputationNodeBasePtr>, std::shared_ptr<ForwardPropPlan>> m_forwardPropPlans;
+
     // cached quick-access list for inputs and parameters
     std::map<const ComputationNodeBasePtr, std::list<ComputationNodeBasePtr>> m_inputValues;         // [out node] -> all input nodes feeding into out node
     std::map<const ComputationNodeBasePtr, std::list<ComputationNodeBasePtr>> m_learnableParameters; // [out node] -> all parameter nodes feeding into out node
@@ -11,6 +11,9 @@
 #include "RecurrentNodes.h"
 #include <string>
 #include <set>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
 
 using namespace std;
 
@@ -124,4 +127,256 @@ static int DetermineLoopDirection(const std::vector<ComputationNodeBasePtr>& nes
     return steppingDirection;
 }
 
+// -----------------------------------------------------------------------
+// on-disk cache of the network structure, see CompileNetwork()
+//
+// For very large networks, finding the roots, the global evaluation order and the recurrent loops takes a good part
+// of the startup. If a cache directory is set, the results are stored there under a hash of everything they depend
+// on--the nodes, their operations, inputs and tags--and are read back by later processes compiling the same network.
+// Shapes and the memory plan are not cached; they depend on the state of the nodes and are always determined anew.
+// -----------------------------------------------------------------------
+
+/*static*/ wstring ComputationNetwork::s_compiledStructureCacheDirectory;
+
+/*static*/ void ComputationNetwork::SetCompiledStructureCacheDirectory(const wstring& directory)
+{
+    s_compiledStructureCacheDirectory = directory;
+}
+
+static const size_t compiledStructureCacheVersion = 1;
+
+// FNV-1a hash
+static void HashInto(uint64_t& hash, const void* data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= ((const unsigned char*)data)[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+static void HashInto(uint64_t& hash, const wstring& s)
+{
+    HashInto(hash, s.c_str(), (s.size() + 1) * sizeof(wchar_t)); // include the terminator, to separate the strings
+}
+
+// returns an empty path if caching is disabled, or for networks with missing inputs, which validation reports
+wstring ComputationNetwork::GetCompiledStructureCachePath() const
+{
+    if (s_compiledStructureCacheDirectory.empty())
+        return wstring();
+
+    uint64_t hash = 14695981039346656037ull;
+    const size_t versions[] = { compiledStructureCacheVersion, CURRENT_CNTK_MODEL_VERSION };
+    HashInto(hash, versions, sizeof(versions));
+    for (const auto& iter : m_nameToNodeMap) // (sorted by name)
+    {
+        const auto& node = iter.second;
+        HashInto(hash, node->NodeName());
+        HashInto(hash, node->OperationName());
+        const int flags[] = { node->RequiresPreCompute(), GetRecurrenceSteppingDirection(node), (int)node->GetNumInputs() };
+        HashInto(hash, flags, sizeof(flags));
+        for (const auto& input : node->GetInputs())
+        {
+            if (!input)
+                return wstring();
+            HashInto(hash, input->NodeName());
+        }
+    }
+    for (const auto* group : { &m_criterionNodes, &m_evaluationNodes, &m_outputNodes })
+    {
+        for (const auto& node : *group)
+            HashInto(hash, node->NodeName());
+        HashInto(hash, wstring(L"|"));
+    }
+
+    return s_compiledStructureCacheDirectory + L"/" + msra::strfun::wstrprintf(L"%016llx.cnet", (unsigned long long)hash);
+}
+
+// write m_allRoots, the global eval order and m_allSEQNodes as determined by FormRecurrentLoops()
+// Failures are only reported, since the cache is not needed for anything but speed.
+void ComputationNetwork::SaveCompiledStructure(const wstring& path) const
+{
+    try
+    {
+        // Processes compiling the same network at the same time each write their own file; the rename is atomic.
+        let tmpPath = path + msra::strfun::wstrprintf(L".%llx.tmp", (unsigned long long)chrono::steady_clock::now().time_since_epoch().count());
+        {
+            File fstream(tmpPath, FileOptions::fileOptionsBinary | FileOptions::fileOptionsWrite);
+            fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BCompiledStructure");
+            fstream << compiledStructureCacheVersion;
+
+            fstream << m_allRoots.size();
+            for (const auto& node : m_allRoots)
+                fstream << node->NodeName();
+
+            const auto& evalOrder = GetEvalOrder(nullptr);
+            fstream << evalOrder.size();
+            for (const auto& node : evalOrder)
+                fstream << node->NodeName();
+
+            fstream << m_allSEQNodes.size();
+            for (const auto& loop : m_allSEQNodes)
+            {
+                fstream << loop->m_sourceNode->NodeName() << loop->m_steppingDirection << loop->m_nestedNodes.size();
+                for (const auto& node : loop->m_nestedNodes)
+                    fstream << node->NodeName();
+            }
+
+            fstream.PutMarker(FileMarker::fileMarkerEndSection, L"ECompiledStructure");
+        }
+        renameOrDie(tmpPath, path);
+    }
+    catch (const exception& e)
+    {
+        fprintf(stderr, "WARNING: The network structure could not be cached in %ls: %s\n", path.c_str(), e.what());
+    }
+}
+
+// counterpart of SaveCompiledStructure(), in place of DetermineSetOfAllRoots(), FormEvalOrder(nullptr) and FormRecurrentLoops()
+// Returns false, leaving the network untouched, if there is no usable cache file.
+bool ComputationNetwork::TryLoadCompiledStructure(const wstring& path)
+{
+    if (!fexists(path))
+        return false;
+
+    try
+    {
+        File fstream(path, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead);
+        fstream.GetMarker(FileMarker::fileMarkerBeginSection, L"BCompiledStructure");
+        size_t version;
+        fstream >> version;
+        if (version != compiledStructureCacheVersion)
+            return false;
+
+        let readNode = [&]()
+        {
+            wstring name;
+            fstream >> name;
+            auto iter = m_nameToNodeMap.find(name);
+            if (iter == m_nameToNodeMap.end())
+                RuntimeError("Node '%ls' does not exist.", name.c_str());
+            return iter->second;
+        };
+
+        size_t numRoots;
+        fstream >> numRoots;
+        vector<ComputationNodeBasePtr> allRoots;
+        for (size_t i = 0; i < numRoots; i++)
+            allRoots.push_back(readNode());
+
+        size_t numNodes;
+        fstream >> numNodes;
+        list<ComputationNodeBasePtr> evalOrder;
+        for (size_t i = 0; i < numNodes; i++)
+            evalOrder.push_back(readNode());
+
+        size_t numLoops;
+        fstream >> numLoops;
+        vector<shared_ptr<SEQTraversalFlowControlNode>> allSEQNodes;
+        for (size_t i = 0; i < numLoops; i++)
+        {
+            auto loop = make_shared<SEQTraversalFlowControlNode>((int)i, readNode());
+            size_t numNestedNodes;
+            fstream >> loop->m_steppingDirection >> numNestedNodes;
+            for (size_t k = 0; k < numNestedNodes; k++)
+                loop->m_nestedNodes.push_back(readNode());
+            allSEQNodes.push_back(loop);
+        }
+
+        fstream.GetMarker(FileMarker::fileMarkerEndSection, L"ECompiledStructure");
+
+        m_allRoots = move(allRoots);
+        m_evalOrders[nullptr] = move(evalOrder);
+        m_globalEvalOrderPositions.clear();
+        m_allSEQNodes = move(allSEQNodes);
+        for (const auto& loop : m_allSEQNodes)
+            for (const auto& node : loop->m_nestedNodes)
+                node->m_isPartOfLoop = true;
+        return true;
+    }
+    catch (const exception& e)
+    {
+        fprintf(stderr, "WARNING: Ignoring the cached network structure %ls: %s\n", path.c_str(), e.what());
+        return false;
+    }
+}
+
+// -----------------------------------------------------------------------
+// dependencies for concurrent forward prop, see ForwardPropConcurrently()
+//
+// Besides reading the values of their inputs, nodes depend on each other through memory sharing: a node whose value
+// or temporary matrix reuses a matrix of the MatrixPool must not write it before the previous owner of the matrix and
+// the nodes that read the previous owner's value are done. These become predecessors of the node.
+// -----------------------------------------------------------------------
+
+// 'nodes' are top-level nodes in evaluation order, i.e. PAR nodes and SEQTraversalFlowControlNodes.
+// 'inputs[i]' and 'predecessors[i]' receive the indices of the earlier nodes that node i depends on.
+void ComputationNetwork::AnalyzeForwardPropDependencies(const std::vector<ComputationNodeBasePtr>& nodes,
+                                                        std::vector<std::vector<size_t>>& inputs, std::vector<std::vector<size_t>>& predecessors)
+{
+    const size_t none = (size_t)-1;
+
+    // index of the top-level node that computes each node; the members of a loop map to its SEQTraversalFlowControlNode
+    unordered_map<const void*, size_t> indexOf;
+    vector<vector<ComputationNodeBasePtr>> membersOf(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        const auto& node = nodes[i];
+        if (node->Is<SEQTraversalFlowControlNode>())
+            membersOf[i] = node->As<SEQTraversalFlowControlNode>()->m_nestedNodes;
+        else
+        {
+            membersOf[i].push_back(node);
+            // the root of a fused elementwise tree reads the inputs of the whole tree
+            if (const auto& fusion = node->GetElementwiseFusion())
+                membersOf[i].insert(membersOf[i].end(), fusion->GetFusedNodes().begin(), fusion->GetFusedNodes().end());
+        }
+        indexOf[node.get()] = i;
+        for (const auto& member : membersOf[i])
+            indexOf.insert(make_pair(member.get(), i));
+    }
+
+    inputs.assign(nodes.size(), vector<size_t>());
+    vector<vector<size_t>> consumers(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        for (const auto& member : membersOf[i])
+        {
+            for (const auto& input : member->GetInputs())
+            {
+                auto iter = indexOf.find(input.get());
+                if (iter == indexOf.end() || iter->second == i || find(inputs[i].begin(), inputs[i].end(), iter->second) != inputs[i].end())
+                    continue;
+                inputs[i].push_back(iter->second);
+                consumers[iter->second].push_back(i);
+            }
+        }
+    }
+
+    predecessors.assign(nodes.size(), vector<size_t>());
+    for (const auto& owners : m_matrixPool.GetSharedMemoryOwners())
+    {
+        size_t previous = none;
+        for (auto owner : owners)
+        {
+            auto iter = indexOf.find(owner);
+            if (iter == indexOf.end())
+                continue; // not evaluated as part of these nodes
+            size_t current = iter->second;
+            if (previous != none && previous != current)
+            {
+                if (previous < current)
+                    predecessors[current].push_back(previous);
+                for (auto consumer : consumers[previous])
+                {
+                    if (consumer < current)
+                        predecessors[current].push_back(consumer);
+                }
+            }
+            previous = current;
+        }
+    }
+}
+
 }}}
@@ -96,6 +96,8 @@ public:
                                           const ComputationNodePtr runMean, const ComputationNodePtr runVariance, const ComputationNodePtr runSampleCount,
                                           bool spatial = false, double normalizationTimeConstant = 0, double blendTimeConstant = 0, double epsilon = 1e-5, bool useCntkEngine = true,
                                           bool disableRegularization = false, ImageLayoutKind imageLayoutKind = ImageLayoutKind::CHW, const std::wstring nodeName = L"");
+    ComputationNodePtr LayerNormalization(const ComputationNodePtr input, const ComputationNodePtr scale, const ComputationNodePtr bias,
+                                          double epsilon = 1e-5, const std::wstring nodeName = L"");
     ComputationNodePtr Convolution(const ComputationNodePtr weight,
                                    const ComputationNodePtr inputValues,
                                    const size_t kernelWidth, const size_t kernelHeight, const size_t outputChannels,
@@ -202,6 +204,10 @@ public:
     ComputationNodePtr RowRepeat(const ComputationNodePtr a, const size_t num_repeat, const std::wstring nodeName = L"");
     ComputationNodePtr RowSlice(const ComputationNodePtr a, const size_t start_index, const size_t num_rows, const std::wstring nodeName = L"");
     ComputationNodePtr RowStack(const std::vector<ComputationNodePtr> pinputs, const std::wstring nodeName = L"");
+    // samplingWeights may be null for the log-uniform distribution
+    ComputationNodePtr SampledCrossEntropyWithSoftmax(const ComputationNodePtr label, const ComputationNodePtr input, const ComputationNodePtr weights, const ComputationNodePtr bias,
+                                                      const ComputationNodePtr samplingWeights, size_t sizeOfSampledSet, const std::wstring nodeName = L"");
+    ComputationNodePtr ScaledDotProductAttention(const ComputationNodePtr query, const ComputationNodePtr key, const ComputationNodePtr value, double scale = 0, size_t blockSize = 64, const std::wstring nodeName = L"");
 #ifdef COMING_SOON
     ComputationNodePtr SequenceDecoder(const ComputationNodePtr label, const ComputationNodePtr prediction, const ComputationNodePtr pairscore, const std::wstring nodeName = L"");
 #endif
@@ -10,9 +10,17 @@
 #include "ComputationNetwork.h"
 #include "InputAndParamNodes.h"
 #include "TrainingNodes.h"
+#include "ReshapingNodes.h"
+#include "ConvolutionalNodes.h"
+#include "LinearAlgebraNodes.h"
+#include "NonlinearityNodes.h"
 #include <string>
 #include <vector>
 #include <list>
+#include <map>
+#include <set>
+#include <tuple>
+#include <typeinfo>
 
 using namespace std;
 
@@ -367,4 +375,587 @@ void ComputationNetwork::SetLearnableNodesBelowLearningRateMultiplier(const floa
     }
 }
 
+// -----------------------------------------------------------------------
+// folding of batch normalization for inference
+// -----------------------------------------------------------------------
+
+// the elements of a matrix, in CPU memory
+template <class ElemType>
+static vector<double> CopyToVector(const Matrix<ElemType>& matrix)
+{
+    unique_ptr<ElemType[]> data(matrix.CopyToArray());
+    vector<double> result(matrix.GetNumElements());
+    for (size_t i = 0; i < result.size(); i++)
+        result[i] = (double)data[i];
+    return result;
+}
+
+// a LearnableParameter with the given values, which is not learned
+// 'numRows' and 'numCols' are the dimensions of its matrix if they must match another one, else 0.
+template <class ElemType>
+static ComputationNodeBasePtr NewFoldedParameter(DEVICEID_TYPE deviceId, const wstring& name, const TensorShape& shape, const vector<double>& values, size_t numRows = 0, size_t numCols = 0)
+{
+    auto parameter = New<LearnableParameter<ElemType>>(deviceId, name, shape);
+    ComputationNodeBasePtr(parameter)->SetLearningRateMultiplier(0);
+    vector<ElemType> data(values.size());
+    for (size_t i = 0; i < values.size(); i++)
+        data[i] = (ElemType)values[i];
+    auto& value = parameter->Value();
+    value.SetValue(numRows ? numRows : value.GetNumRows(), numCols ? numCols : value.GetNumCols(), deviceId, data.data());
+    return parameter;
+}
+
+// the weights and bias of 'product' (a ConvolutionNode or TimesNode whose weights are its first input), plus 'bias'
+// (a LearnableParameter or nullptr) with the inference transform of 'batchNorm' applied to them
+// Returns false if the transform cannot be folded into them, e.g. since it is not per output map of a convolution.
+template <class ElemType>
+static bool FoldBatchNormalizationInto(const ComputationNodeBasePtr& batchNorm, const ComputationNodeBasePtr& product, const ComputationNodeBasePtr& bias,
+                                       ComputationNodeBasePtr& foldedWeights, ComputationNodeBasePtr& foldedBias)
+{
+    auto batchNormNode = dynamic_pointer_cast<BatchNormalizationNode<ElemType>>(batchNorm);
+    auto weights = dynamic_pointer_cast<ComputationNode<ElemType>>(product->Input(0));
+    auto convolution = dynamic_pointer_cast<ConvolutionNode<ElemType>>(product);
+    if (!batchNormNode || batchNormNode->ReluOutput() || !weights || (!convolution && !dynamic_pointer_cast<TimesNode<ElemType>>(product)) ||
+        weights->Value().GetMatrixType() != DENSE || (bias && (!bias->Is<ComputationNode<ElemType>>() || bias->ValuePtr()->GetMatrixType() != DENSE)))
+        return false;
+
+    // the output elements that share a scale and shift: the elements of a map if spatial, else each element
+    const auto& outputShape = product->GetSampleLayout();
+    const size_t rank = outputShape.GetRank();
+    const size_t numOutputs = outputShape.GetNumElements();
+    const bool spatial = batchNormNode->Spatial();
+    if (rank == 0 || (spatial && batchNormNode->GetImageLayoutKind() != ImageLayoutKind::CHW))
+        return false;
+    const size_t numMaps = spatial ? outputShape[rank - 1] : numOutputs;
+    const size_t mapSize = numOutputs / numMaps;
+    if (batchNorm->Input(1)->GetSampleLayout().GetNumElements() != numMaps)
+        return false;
+
+    // each map of a convolution has its contiguous kernel, see ConvolutionEngine::ForwardFused(); the rows of the weights of a product are its outputs
+    const auto& weightsValue = weights->Value();
+    const size_t numWeights = weightsValue.GetNumElements();
+    if (convolution)
+    {
+        const auto sharing = convolution->Sharing();
+        if (!spatial || convolution->Transpose() || convolution->ImageLayout() != ImageLayoutKind::CHW ||
+            find(sharing.begin(), sharing.end(), false) != sharing.end() || numWeights % numMaps != 0)
+            return false;
+    }
+    else if (numWeights % numOutputs != 0)
+        return false;
+
+    // the bias is either per map or per output element
+    const bool biasPerMap = spatial && (!bias || (bias->GetSampleLayout().GetRank() == rank && bias->GetSampleLayout()[rank - 1] == numMaps && bias->GetSampleLayout().GetNumElements() == numMaps));
+    if (bias && !biasPerMap && bias->GetSampleLayout() != outputShape)
+        return false;
+
+    vector<double> scale, shift;
+    batchNormNode->GetInferenceScaleAndShift(scale, shift);
+
+    vector<double> weightValues = CopyToVector(weightsValue);
+    for (size_t i = 0; i < numWeights; i++)
+        weightValues[i] *= scale[convolution ? i / (numWeights / numMaps) : (i % numOutputs) / mapSize];
+
+    const size_t numBiases = biasPerMap ? numMaps : numOutputs;
+    vector<double> biasValues = bias ? CopyToVector(bias->As<ComputationNode<ElemType>>()->Value()) : vector<double>(numBiases, 0);
+    for (size_t i = 0; i < numBiases; i++)
+    {
+        const size_t map = biasPerMap ? i : i / mapSize;
+        biasValues[i] = biasValues[i] * scale[map] + shift[map];
+    }
+    TensorShape biasShape = outputShape;
+    if (biasPerMap)
+    {
+        SmallVector<size_t> dims(rank, 1);
+        dims[rank - 1] = numMaps;
+        biasShape = TensorShape(dims);
+    }
+
+    const auto deviceId = product->GetDeviceId();
+    foldedWeights = NewFoldedParameter<ElemType>(deviceId, batchNorm->NodeName() + L".foldedWeights", weights->GetSampleLayout(), weightValues, weightsValue.GetNumRows(), weightsValue.GetNumCols());
+    foldedBias = NewFoldedParameter<ElemType>(deviceId, batchNorm->NodeName() + L".foldedBias", biasShape, biasValues);
+    return true;
+}
+
+// FoldBatchNormalization() -- folds the inference transform of BatchNormalization nodes into the weights and bias of the
+// ConvolutionNode or TimesNode before them, i.e. BN(W * x) becomes W' * x + b', and BN(W * x + b) becomes W' * x + b'.
+// The BatchNormalization node is replaced by a PlusNode of the same name. This only holds for inference, in which the
+// running statistics are used. Nodes in 'outputNodes' or in a node group, and nodes whose values feed other nodes as
+// well, are kept. Returns the number of folded nodes; the network is recompiled if there is any.
+size_t ComputationNetwork::FoldBatchNormalization(const std::vector<ComputationNodeBasePtr>& outputNodes)
+{
+    VerifyIsCompiled("FoldBatchNormalization");
+
+    set<ComputationNodeBasePtr> keep(outputNodes.begin(), outputNodes.end());
+    for (const auto& group : GetAllNodeGroups())
+        keep.insert(group->begin(), group->end());
+    map<ComputationNodeBasePtr, size_t> numConsumers;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        for (const auto& input : iter.second->GetInputs())
+            numConsumers[input]++;
+    }
+    auto isOnlyUsedBy = [&](const ComputationNodeBasePtr& node) { return numConsumers[node] == 1 && keep.find(node) == keep.end(); };
+    auto isParameter = [](const ComputationNodeBasePtr& node) { return node->OperationName() == OperationNameOf(LearnableParameter) && !node->HasMBLayout(); };
+
+    vector<ComputationNodeBasePtr> batchNorms;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        if (iter.second->OperationName() == OperationNameOf(BatchNormalizationNode) && keep.find(iter.second) == keep.end())
+            batchNorms.push_back(iter.second);
+    }
+
+    vector<ComputationNodeBasePtr> replacedParameters;
+    size_t numFolded = 0;
+    for (const auto& batchNorm : batchNorms)
+    {
+        // BN(product(W, x)) or BN(Plus(product(W, x), b))
+        ComputationNodeBasePtr product = batchNorm->Input(0), plus, bias;
+        size_t biasIndex = 0;
+        if (product->OperationName() == OperationNameOf(PlusNode) && isOnlyUsedBy(product))
+        {
+            for (biasIndex = 0; biasIndex < 2 && !isParameter(product->Input(biasIndex)); biasIndex++)
+                ;
+            if (biasIndex == 2)
+                continue;
+            plus = product;
+            bias = plus->Input(biasIndex);
+            product = plus->Input(1 - biasIndex);
+        }
+        if ((product->OperationName() != OperationNameOf(ConvolutionNode) && product->OperationName() != OperationNameOf(TimesNode)) ||
+            !isOnlyUsedBy(product) || !isParameter(product->Input(0)) || product->IsPartOfLoop())
+            continue;
+
+        ComputationNodeBasePtr foldedWeights, foldedBias;
+        if (!FoldBatchNormalizationInto<float>(batchNorm, product, bias, foldedWeights, foldedBias) &&
+            !FoldBatchNormalizationInto<double>(batchNorm, product, bias, foldedWeights, foldedBias) &&
+            !FoldBatchNormalizationInto<half>(batchNorm, product, bias, foldedWeights, foldedBias))
+            continue;
+        if (NodeNameExists(foldedWeights->NodeName()) || NodeNameExists(foldedBias->NodeName()))
+            continue;
+
+        replacedParameters.push_back(product->Input(0));
+        if (bias)
+            replacedParameters.push_back(bias);
+        for (size_t i = 1; i < batchNorm->GetNumInputs(); i++)
+            replacedParameters.push_back(batchNorm->Input(i));
+
+        AddNodeToNet(foldedWeights);
+        AddNodeToNet(foldedBias);
+        product->SetInput(0, foldedWeights);
+        RemoveNodeFromNet(batchNorm);
+        if (plus)
+            plus->SetInput(biasIndex, foldedBias);
+        else
+        {
+            // takes the place of the BatchNormalization node, including its name
+            if (product->Is<ComputationNode<float>>())
+                plus = New<PlusNode<float>>(product->GetDeviceId(), batchNorm->NodeName());
+            else if (product->Is<ComputationNode<double>>())
+                plus = New<PlusNode<double>>(product->GetDeviceId(), batchNorm->NodeName());
+            else
+                plus = New<PlusNode<half>>(product->GetDeviceId(), batchNorm->NodeName());
+            plus->AttachInputs({ product, foldedBias });
+            AddNodeToNet(plus);
+        }
+        ChangeNodeInputs(batchNorm, plus);
+        batchNorm->DetachInputs();
+
+        if (TraceLevel() > 0)
+            fprintf(stderr, "FoldBatchNormalization: %ls %ls operation is folded into %ls %ls operation.\n",
+                    batchNorm->NodeName().c_str(), batchNorm->OperationName().c_str(), product->NodeName().c_str(), product->OperationName().c_str());
+        numFolded++;
+    }
+    if (numFolded == 0)
+        return 0;
+
+    // drop the parameters that nothing uses anymore
+    numConsumers.clear();
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        for (const auto& input : iter.second->GetInputs())
+            numConsumers[input]++;
+    }
+    for (const auto& parameter : replacedParameters)
+    {
+        if (numConsumers[parameter] == 0 && keep.find(parameter) == keep.end() && NodeNameExists(parameter->NodeName()))
+            RemoveNodeFromNet(parameter);
+    }
+
+    CompileNetwork();
+    return numFolded;
+}
+
+// sets 'batchNorm' to output max(0, BN(x)); returns false if it is not a BatchNormalizationNode<ElemType> or already does
+template <class ElemType>
+static bool FuseReluInto(const ComputationNodeBasePtr& batchNorm)
+{
+    auto batchNormNode = dynamic_pointer_cast<BatchNormalizationNode<ElemType>>(batchNorm);
+    if (!batchNormNode || batchNormNode->ReluOutput())
+        return false;
+    batchNormNode->SetReluOutput(true);
+    return true;
+}
+
+// FuseBatchNormalizationRelu() -- fuses a RectifiedLinear node that is the only consumer of a BatchNormalization node
+// into it, which then computes both in one pass, in training as well as in inference (see BatchNormEngine). The
+// BatchNormalization node takes the place of the RectifiedLinear node, including its name. Nodes in 'keepNodes' or in
+// a node group are kept. Returns the number of fused nodes; the network is recompiled if there is any.
+size_t ComputationNetwork::FuseBatchNormalizationRelu(const std::vector<ComputationNodeBasePtr>& keepNodes)
+{
+    VerifyIsCompiled("FuseBatchNormalizationRelu");
+
+    set<ComputationNodeBasePtr> keep(keepNodes.begin(), keepNodes.end());
+    for (const auto& group : GetAllNodeGroups())
+        keep.insert(group->begin(), group->end());
+    map<ComputationNodeBasePtr, vector<ComputationNodeBasePtr>> consumers;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        for (const auto& input : iter.second->GetInputs())
+            consumers[input].push_back(iter.second);
+    }
+
+    vector<pair<ComputationNodeBasePtr, ComputationNodeBasePtr>> fusions; // (BatchNormalization, RectifiedLinear)
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        const auto& batchNorm = iter.second;
+        if (batchNorm->OperationName() != OperationNameOf(BatchNormalizationNode) || keep.find(batchNorm) != keep.end())
+            continue;
+        const auto& batchNormConsumers = consumers[batchNorm];
+        if (batchNormConsumers.size() == 1 && batchNormConsumers[0]->OperationName() == OperationNameOf(RectifiedLinearNode) &&
+            keep.find(batchNormConsumers[0]) == keep.end())
+            fusions.push_back(make_pair(batchNorm, batchNormConsumers[0]));
+    }
+
+    size_t numFused = 0;
+    for (const auto& fusion : fusions)
+    {
+        const auto& batchNorm = fusion.first;
+        const auto& relu = fusion.second;
+        if (!FuseReluInto<float>(batchNorm) && !FuseReluInto<double>(batchNorm) && !FuseReluInto<half>(batchNorm))
+            continue;
+
+        const wstring batchNormName = batchNorm->NodeName();
+        RemoveNodeFromNet(relu);
+        ChangeNodeInputs(relu, batchNorm);
+        relu->DetachInputs();
+        RenameNode(batchNorm, relu->NodeName());
+
+        if (TraceLevel() > 0)
+            fprintf(stderr, "FuseBatchNormalizationRelu: %ls %ls operation is fused into %ls %ls operation, which takes its name.\n",
+                    relu->NodeName().c_str(), relu->OperationName().c_str(), batchNormName.c_str(), batchNorm->OperationName().c_str());
+        numFused++;
+    }
+    if (numFused == 0)
+        return 0;
+
+    CompileNetwork();
+    return numFused;
+}
+
+// -----------------------------------------------------------------------
+// quantization of embeddings for inference
+// -----------------------------------------------------------------------
+
+// a QuantizedLookupTableNode that takes the place of 'lookup', including its name, with the quantized value of 'table'
+// Returns nullptr if they are not ComputationNode<ElemType>.
+template <class ElemType>
+static ComputationNodeBasePtr NewQuantizedLookupTable(const ComputationNodeBasePtr& lookup, const ComputationNodeBasePtr& table, bool indexInput, bool useHalf)
+{
+    auto tableNode = dynamic_pointer_cast<ComputationNode<ElemType>>(table);
+    if (!tableNode || !lookup->Is<ComputationNode<ElemType>>() || tableNode->Value().GetMatrixType() != DENSE)
+        return nullptr;
+    auto quantized = New<QuantizedLookupTableNode<ElemType>>(lookup->GetDeviceId(), lookup->NodeName(), indexInput);
+    quantized->SetTable(tableNode->Value(), useHalf);
+    return quantized;
+}
+
+// QuantizeEmbeddings() -- replaces the lookups into embedding tables by QuantizedLookupTableNodes, which hold the table
+// as int8 codes with a scale and offset per embedding, or as half values with 'useHalf', and dequantize the embeddings
+// as they look them up. The lookups are LookupTableNodes, TimesNodes of a [dim x V] table and a sparse one-hot input
+// of dim V, and GatherNodes along the last axis of a [dim x V] table. The table must be a LearnableParameter that
+// nothing else uses, since it is removed. Nodes in 'keepNodes' or in a node group, and lookups in loops, are kept.
+// This only holds for inference. Returns the number of replaced lookups; the network is recompiled if there is any.
+size_t ComputationNetwork::QuantizeEmbeddings(const std::vector<ComputationNodeBasePtr>& keepNodes, bool useHalf)
+{
+    VerifyIsCompiled("QuantizeEmbeddings");
+
+    set<ComputationNodeBasePtr> keep(keepNodes.begin(), keepNodes.end());
+    for (const auto& group : GetAllNodeGroups())
+        keep.insert(group->begin(), group->end());
+    map<ComputationNodeBasePtr, size_t> numConsumers;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        for (const auto& input : iter.second->GetInputs())
+            numConsumers[input]++;
+    }
+    auto isTable = [&](const ComputationNodeBasePtr& node)
+    {
+        return node->OperationName() == OperationNameOf(LearnableParameter) && !node->HasMBLayout() && node->GetSampleLayout().GetRank() == 2 &&
+               numConsumers[node] == 1 && keep.find(node) == keep.end();
+    };
+
+    // (lookup, table, input of the quantized lookup, whether the input are indices)
+    vector<tuple<ComputationNodeBasePtr, ComputationNodeBasePtr, ComputationNodeBasePtr, bool>> lookups;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        const auto& node = iter.second;
+        if (keep.find(node) != keep.end() || node->IsPartOfLoop())
+            continue;
+        const auto& operation = node->OperationName();
+        if (operation == OperationNameOf(LookupTableNode) && isTable(node->Input(0)))
+            lookups.push_back(make_tuple(node, node->Input(0), node->Input(1), false));
+        else if (operation == OperationNameOf(TimesNode) && isTable(node->Input(0)))
+        {
+            // only a product with one-hot vectors is a lookup; the inputs from readers of word ids are sparse
+            const auto& input = node->Input(1);
+            const auto& tableLayout = node->Input(0)->GetSampleLayout();
+            if (input->GetSampleLayout().GetRank() == 1 && input->GetSampleLayout()[0] == tableLayout[1] &&
+                node->GetSampleLayout().GetRank() == 1 && node->GetSampleLayout()[0] == tableLayout[0] &&
+                input->ValuePtr()->GetMatrixType() == SPARSE)
+                lookups.push_back(make_tuple(node, node->Input(0), input, false));
+        }
+        else if (operation == OperationNameOf(GatherNode) && isTable(node->Input(1)))
+        {
+            int axis = node->Is<GatherNode<float>>() ? node->As<GatherNode<float>>()->Axis() :
+                       node->Is<GatherNode<double>>() ? node->As<GatherNode<double>>()->Axis() : 0;
+            if (axis == -1 || axis == 1)
+                lookups.push_back(make_tuple(node, node->Input(1), node->Input(0), true));
+        }
+    }
+
+    vector<ComputationNodeBasePtr> replacedParameters;
+    size_t numQuantized = 0;
+    for (const auto& lookupEntry : lookups)
+    {
+        ComputationNodeBasePtr lookup, table, input;
+        bool indexInput;
+        tie(lookup, table, input, indexInput) = lookupEntry;
+
+        auto quantized = NewQuantizedLookupTable<float>(lookup, table, indexInput, useHalf);
+        if (!quantized)
+            quantized = NewQuantizedLookupTable<double>(lookup, table, indexInput, useHalf);
+        if (!quantized)
+            quantized = NewQuantizedLookupTable<half>(lookup, table, indexInput, useHalf);
+        if (!quantized)
+            continue;
+
+        RemoveNodeFromNet(lookup);
+        quantized->AttachInputs({ input });
+        AddNodeToNet(quantized);
+        ChangeNodeInputs(lookup, quantized);
+        lookup->DetachInputs();
+        replacedParameters.push_back(table);
+
+        if (TraceLevel() > 0)
+            fprintf(stderr, "QuantizeEmbeddings: %ls %ls operation is replaced by a %ls operation with a %ls table of [%d x %d].\n",
+                    lookup->NodeName().c_str(), lookup->OperationName().c_str(), quantized->OperationName().c_str(),
+                    useHalf ? L"half" : L"int8", (int)table->GetSampleLayout()[0], (int)table->GetSampleLayout()[1]);
+        numQuantized++;
+    }
+    if (numQuantized == 0)
+        return 0;
+
+    // the tables were only used by the lookups
+    for (const auto& parameter : replacedParameters)
+        RemoveNodeFromNet(parameter);
+
+    CompileNetwork();
+    return numQuantized;
+}
+
+// -----------------------------------------------------------------------
+// graph optimization for inference
+// -----------------------------------------------------------------------
+
+// whether two nodes with the same inputs compute the same value
+// Only nodes whose operation is fully described by their type and output shape qualify: elementwise operations
+// (see IElementwiseNode) and reshapes.
+static bool ComputesSameValue(const ComputationNodeBasePtr& a, const ComputationNodeBasePtr& b)
+{
+    if (typeid(*a) != typeid(*b) || a->GetSampleLayout() != b->GetSampleLayout() || a->GetMBLayout() != b->GetMBLayout())
+        return false;
+    auto elementwiseA = dynamic_cast<const IElementwiseNode*>(a.get());
+    auto elementwiseB = dynamic_cast<const IElementwiseNode*>(b.get());
+    if (elementwiseA && elementwiseB)
+        return elementwiseA->GetElementwiseOperator() == elementwiseB->GetElementwiseOperator();
+    return a->OperationName() == OperationNameOf(ReshapeNode);
+}
+
+// a LearnableParameter that holds the current value of 'node', which must be dense and without MBLayout
+template <class ElemType>
+static ComputationNodeBasePtr NewFoldedConstant(const ComputationNodeBasePtr& node, const wstring& name)
+{
+    auto typedNode = dynamic_pointer_cast<ComputationNode<ElemType>>(node);
+    if (!typedNode)
+        return nullptr;
+    auto folded = New<LearnableParameter<ElemType>>(node->GetDeviceId(), name, node->GetSampleLayout());
+    ComputationNodeBasePtr(folded)->SetLearningRateMultiplier(0);
+    auto& value = folded->Value();
+    const size_t numRows = value.GetNumRows();
+    const size_t numCols = value.GetNumCols();
+    value.SetValue(typedNode->Value());
+    value.Reshape(numRows, numCols);
+    return folded;
+}
+
+// OptimizeForInference() -- simplifies a compiled network that is only used to compute 'outputNodes':
+//  - batch normalization is folded into the weights before it, see FoldBatchNormalization().
+//  - common subexpressions: a node that computes the same as an earlier one from the same inputs (see
+//    ComputesSameValue()) is replaced by the earlier one.
+//  - constant folding: a subgraph that only depends on 'constantNodes' (the leaves whose values never change) is
+//    evaluated once and replaced by a LearnableParameter that holds its value.
+//  - dead nodes: non-leaf nodes that do not feed the outputs are removed from the network.
+// Only deterministic nodes outside of loops and without MBLayout are folded or merged (see IsForwardPropRecomputable()),
+// and the output nodes themselves are kept. Removed nodes are detached and no longer part of the network, so that
+// the caller must no longer use them. The network is recompiled.
+void ComputationNetwork::OptimizeForInference(const std::vector<ComputationNodeBasePtr>& outputNodes, const std::set<ComputationNodeBasePtr>& constantNodes)
+{
+    VerifyIsCompiled("OptimizeForInference");
+    FoldBatchNormalization(outputNodes);
+    const set<ComputationNodeBasePtr> outputs(outputNodes.begin(), outputNodes.end());
+    const auto& evalOrder = GetEvalOrder(nullptr); // all nodes, inputs first (except for the delayed inputs of loops)
+
+    // common subexpressions
+    // The candidates are keyed by their inputs, which are already replaced by their representatives.
+    map<ComputationNodeBasePtr, ComputationNodeBasePtr> replacements;
+    auto replaceInputs = [&replacements](const ComputationNodeBasePtr& node)
+    {
+        for (size_t i = 0; i < node->GetNumInputs(); i++)
+        {
+            auto iter = replacements.find(node->Input(i));
+            if (iter != replacements.end())
+                node->SetInput(i, iter->second);
+        }
+    };
+    map<vector<ComputationNodeBasePtr>, vector<ComputationNodeBasePtr>> candidates;
+    size_t numMerged = 0;
+    for (const auto& node : evalOrder)
+    {
+        replaceInputs(node);
+        if (node->IsLeaf() || node->IsPartOfLoop() || !node->IsForwardPropRecomputable() || outputs.find(node) != outputs.end())
+            continue;
+        auto& sameInputs = candidates[node->GetInputs()];
+        auto iter = find_if(sameInputs.begin(), sameInputs.end(), [&node](const ComputationNodeBasePtr& other) { return ComputesSameValue(node, other); });
+        if (iter != sameInputs.end())
+        {
+            replacements[node] = *iter;
+            numMerged++;
+        }
+        else
+            sameInputs.push_back(node);
+    }
+    for (const auto& node : evalOrder) // the delayed inputs of loops come later in the order
+        replaceInputs(node);
+
+    // constant folding
+    // The roots of the constant subgraphs are the constant nodes that feed a non-constant one.
+    set<ComputationNodeBasePtr> isConstant;
+    vector<ComputationNodeBasePtr> constantSubgraphs; // constant non-leaf nodes, inputs first
+    set<ComputationNodeBasePtr> foldRoots;
+    for (const auto& node : evalOrder)
+    {
+        if (replacements.find(node) != replacements.end())
+            continue;
+        bool constant;
+        if (node->IsLeaf())
+            constant = constantNodes.find(node) != constantNodes.end();
+        else
+        {
+            constant = !node->IsPartOfLoop() && !node->HasMBLayout() && node->IsForwardPropRecomputable() && outputs.find(node) == outputs.end();
+            for (const auto& input : node->GetInputs())
+                constant &= isConstant.find(input) != isConstant.end();
+        }
+        if (constant)
+        {
+            isConstant.insert(node);
+            if (!node->IsLeaf())
+                constantSubgraphs.push_back(node);
+        }
+        else
+        {
+            for (const auto& input : node->GetInputs())
+            {
+                if (!input->IsLeaf() && isConstant.find(input) != isConstant.end())
+                    foldRoots.insert(input);
+            }
+        }
+    }
+
+    size_t numFolded = 0;
+    if (!foldRoots.empty())
+    {
+        // evaluate all constant subgraphs at once, with their own matrices
+        MatrixPool matrixPool;
+        for (const auto& node : constantSubgraphs)
+            node->RequestMatricesBeforeForwardProp(matrixPool);
+        matrixPool.OptimizedMemoryAllocation();
+
+        const auto previousMode = Environment().SetOperationMode(NetworkOperationMode::inferring);
+        SetEvalTimeStampsOutdatedWithRegardToAll();
+        try
+        {
+            for (const auto& node : constantSubgraphs)
+                PARTraversalFlowControlNode::ForwardProp(node, FrameRange(nullptr));
+        }
+        catch (...)
+        {
+            Environment().SetOperationMode(previousMode);
+            throw;
+        }
+        Environment().SetOperationMode(previousMode);
+
+        for (const auto& root : foldRoots)
+        {
+            if (root->ValuePtr()->GetMatrixType() != DENSE)
+                continue;
+            const wstring name = root->NodeName() + L".folded";
+            ComputationNodeBasePtr folded;
+            if (!(folded = NewFoldedConstant<float>(root, name)) && !(folded = NewFoldedConstant<double>(root, name)))
+                folded = NewFoldedConstant<half>(root, name);
+            if (!folded || NodeNameExists(name))
+                continue;
+            AddNodeToNet(folded);
+            ChangeNodeInputs(root, folded);
+            numFolded++;
+        }
+    }
+
+    // dead nodes
+    // Leaves are kept, since the caller may still feed or update them.
+    set<ComputationNodeBasePtr> needed;
+    vector<ComputationNodeBasePtr> toVisit(outputNodes.begin(), outputNodes.end());
+    while (!toVisit.empty())
+    {
+        auto node = toVisit.back();
+        toVisit.pop_back();
+        if (!needed.insert(node).second)
+            continue;
+        for (const auto& input : node->GetInputs())
+            toVisit.push_back(input);
+    }
+    vector<ComputationNodeBasePtr> deadNodes;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        if (needed.find(iter.second) == needed.end() && !iter.second->IsLeaf())
+            deadNodes.push_back(iter.second);
+    }
+    for (const auto& groupIter : GetAllNodeGroups())
+    {
+        auto& group = *groupIter;
+        group.erase(remove_if(group.begin(), group.end(), [&needed](const ComputationNodeBasePtr& node) { return !node->IsLeaf() && needed.find(node) == needed.end(); }), group.end());
+    }
+    for (const auto& node : deadNodes)
+    {
+        node->DetachInputs();
+        RemoveNodeFromNet(node);
+    }
+
+    if (TraceLevel() > 0)
+        fprintf(stderr, "\nOptimizeForInference: %d common subexpressions merged, %d constant subgraphs folded, %d nodes removed.\n",
+                (int)numMerged, (int)numFolded, (int)deadNodes.size());
+
+    CompileNetwork();
+}
+
 }}}
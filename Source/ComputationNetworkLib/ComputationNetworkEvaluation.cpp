@@ -11,13 +11,21 @@
 #include "RecurrentNodes.h"
 #include "InputAndParamNodes.h"
 #include "LinearAlgebraNodes.h"
+#include "NonlinearityNodes.h"
+#include "ReshapingNodes.h"
 #include "SpecialPurposeNodes.h"
+#include "TrainingNodes.h"
+#include "GPUGraph.h"
+#include "GPUStreamPool.h"
+#include "StreamSchedule.h"
+#include "ThreadPool.h"
 #include <string>
 #include <vector>
 #include <list>
 #include <set>
 #include <algorithm>
 #include <map>
+#include <cmath>
 
 using namespace std;
 
@@ -40,9 +48,16 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 void ComputationNetwork::ForwardProp(const ComputationNodeBasePtr rootNode)
 {
     VerifyIsCompiled("ForwardProp");
+    GPUMemoryCategoryScope memoryCategory(GPUMemoryCategory::Activations); // the values are allocated lazily
 
     // traverse all nodes in the pre-determined evaluation order
-    GetNestedNetwork(rootNode)->ForwardProp(FrameRange(nullptr));
+    auto forwardProp = [&]()
+    {
+        if (!ForwardPropConcurrently(std::vector<ComputationNodeBasePtr>{ rootNode }))
+            GetNestedNetwork(rootNode)->ForwardProp(FrameRange(nullptr));
+    };
+    if (!RunCapturedOnGPU(rootNode, /*backprop=*/false, forwardProp))
+        forwardProp();
 }
 
 void ComputationNetwork::PostForwardAndBackProp(const ComputationNodeBasePtr rootNode)
@@ -73,20 +88,490 @@ static bool SetRootGradientToScalarOne(ComputationNodeBasePtr nodep)
 //  - ForwardProp() for eval nodes
 //  - ForwardProp() for the training criterion (which will reuse computation results from the previous step)
 //  - Backprop() for the training criterion
-void ComputationNetwork::Backprop(const ComputationNodeBasePtr rootNode) // training criterion to compute the gradients for
+void ComputationNetwork::Backprop(const ComputationNodeBasePtr rootNode, const BackpropCallback& callback) // training criterion to compute the gradients for
 {
     if (!Environment().IsTraining())
         LogicError("Backprop: Requires network is to be in training mode.");
+    GPUMemoryCategoryScope memoryCategory(GPUMemoryCategory::Gradients); // the gradients are allocated lazily
+
+    auto backprop = [&]()
+    {
+        // initialize root gradient with a scalar value of 1.0
+        if (!SetRootGradientToScalarOne<float>(rootNode) && !SetRootGradientToScalarOne<double>(rootNode))
+            LogicError("Backprop: Training criterion is neither ComputationNode<float> nor ComputationNode<double>.");
+
+        // reset all gradients below rootNode to zero (actually, internally, this is lazy, but we don't care here)
+        ZeroInputGradients(rootNode);
+
+        // backpropagate through the network
+        auto network = dynamic_pointer_cast<PARTraversalFlowControlNode>(GetNestedNetwork(rootNode));
+        network->SetBackpropCallback(callback);
+        auto resetCallback = MakeScopeExit([&network]() { network->SetBackpropCallback(nullptr); });
+        network->Backprop(FrameRange(nullptr), true, true);
+    };
+    // the callback does host-side work in between (e.g. aggregation of the gradients), which a replay would skip
+    if (callback || !RunCapturedOnGPU(rootNode, /*backprop=*/true, backprop))
+        backprop();
+}
+
+// -----------------------------------------------------------------------
+// GPU graph capture -- the GPU work of ForwardProp() or Backprop() of a root is recorded into a GPUGraph (a CUDA
+// graph) and replayed for later minibatches, which saves the launch overhead of the many small kernels when the
+// minibatches are small. Enabled with Globals::SetGPUGraphCapture().
+//
+// A replay issues the same kernels with the same arguments as the recording. This is only correct if the MBLayouts
+// equal those at recording time, the value and gradient matrices are still in the same place, and the nodes have no
+// side effects besides their outputs: no random numbers and no state such as running statistics, which is also
+// what activation recomputation requires (see IsForwardPropRecomputable()). For forward prop, the same nodes must be
+// out of date; the time stamps of the nodes that were evaluated while recording are bumped on replay.
+//
+// The first run of a signature is not recorded but run on the graph stream, which performs the lazy allocations and
+// fills the allocation cache of that stream. The second run is recorded. Work that cannot be recorded (e.g. a
+// synchronous copy from the host) makes the recording fail; then the time stamps are restored and the pass is run
+// again without recording. After a few failures the signature is run normally until it changes.
+// Node timing (Globals::SetNodeTiming()) also runs the passes normally, since a replay does not time the nodes.
+// -----------------------------------------------------------------------
+
+struct ComputationNetwork::CapturedPass
+{
+    static const size_t MaxFailures = 3;
+
+    bool canCapture = false;          // all nodes can be replayed
+    std::vector<MBLayoutPtr> layouts; // copies of the layouts of the recorded run
+    std::vector<size_t> buffers;      // addresses and sizes of the value (and gradient) matrices of the recorded run
+    std::vector<bool> outOfDate;      // forward prop: the nodes that had to be evaluated in the recorded run
+    std::vector<bool> evaluated;      // forward prop: the nodes whose time stamp was bumped by the recorded run
+    std::unique_ptr<GPUGraph> graph;
+    size_t numRuns = 0;
+    size_t numFailures = 0;
+};
+
+// appends the buffers of a node to a signature; false if the node is not of this type or not dense on the GPU
+template <class ElemType>
+static bool AppendGPUBuffers(const ComputationNodeBasePtr& nodep, bool withGradient, std::vector<size_t>& buffers)
+{
+    auto node = dynamic_pointer_cast<ComputationNode<ElemType>>(nodep);
+    if (!node)
+        return false;
+    for (const auto& matrix : { node->ValuePtrRef(), withGradient ? node->GradientPtrRef() : nullptr })
+    {
+        if (!matrix)
+        {
+            buffers.insert(buffers.end(), { 0, 0, 0 });
+            continue;
+        }
+        if (matrix->GetMatrixType() != MatrixType::DENSE || matrix->GetDeviceId() < 0)
+            return false;
+        buffers.insert(buffers.end(), { (size_t)matrix->Data(), matrix->GetNumRows(), matrix->GetNumCols() });
+    }
+    return true;
+}
+
+// Runs 'pass' (ForwardProp() or Backprop() of 'rootNode') through a GPUGraph, see above. Returns false if it was
+// not run, because capturing is disabled or not possible for this network.
+bool ComputationNetwork::RunCapturedOnGPU(const ComputationNodeBasePtr& rootNode, bool backprop, const std::function<void()>& pass)
+{
+    if (!Globals::ShouldCaptureGPUGraphs() || GetDeviceId() < 0 || Globals::ShouldRecomputeActivations() || Globals::ShouldEnableNodeTiming())
+        return false;
+
+    const auto& evalOrder = GetEvalOrder(rootNode);
+    auto& captured = m_capturedPasses[make_pair(rootNode, backprop)];
+    if (!captured)
+    {
+        captured = make_shared<CapturedPass>();
+        captured->canCapture = GPUGraph::IsSupported();
+        for (const auto& node : evalOrder)
+        {
+            if (captured->canCapture && (dynamic_pointer_cast<IRngUser>(node) || !node->IsForwardPropRecomputable() || node->GetDeviceId() != GetDeviceId()))
+            {
+                fprintf(stderr, "RunCapturedOnGPU: %ls of %ls %ls operation is not captured because of %ls %ls operation.\n",
+                        backprop ? L"Backprop" : L"ForwardProp", rootNode->NodeName().c_str(), rootNode->OperationName().c_str(),
+                        node->NodeName().c_str(), node->OperationName().c_str());
+                captured->canCapture = false;
+            }
+        }
+    }
+    if (!captured->canCapture)
+        return false;
+
+    // the signature of this run
+    std::vector<MBLayoutPtr> layouts;
+    std::vector<size_t> buffers;
+    std::vector<bool> outOfDate;
+    std::set<ComputationNodeBasePtr> outOfDateNodes;
+    for (const auto& node : evalOrder)
+    {
+        const auto& layout = node->GetMBLayout();
+        if (layout && find(layouts.begin(), layouts.end(), layout) == layouts.end())
+            layouts.push_back(layout);
+        if (!AppendGPUBuffers<float>(node, backprop, buffers) && !AppendGPUBuffers<double>(node, backprop, buffers) && !AppendGPUBuffers<half>(node, backprop, buffers))
+            return false; // e.g. sparse input data
+        if (!backprop)
+        {
+            bool isOutOfDate = node->IsOutOfDateWrtInputs();
+            for (const auto& input : node->GetInputs())
+                isOutOfDate |= outOfDateNodes.find(input) != outOfDateNodes.end();
+            if (isOutOfDate)
+                outOfDateNodes.insert(node);
+            outOfDate.push_back(isOutOfDate);
+        }
+    }
+
+    bool isSameSignature = layouts.size() == captured->layouts.size() && buffers == captured->buffers && outOfDate == captured->outOfDate;
+    for (size_t i = 0; isSameSignature && i < layouts.size(); i++)
+        isSameSignature = *layouts[i] == *captured->layouts[i];
+    if (!isSameSignature)
+    {
+        captured->layouts.clear();
+        for (const auto& layout : layouts)
+        {
+            captured->layouts.push_back(make_shared<MBLayout>());
+            captured->layouts.back()->CopyFrom(layout);
+        }
+        captured->buffers = move(buffers);
+        captured->outOfDate = move(outOfDate);
+        captured->graph.reset(new GPUGraph(GetDeviceId()));
+        captured->numRuns = 0;
+        captured->numFailures = 0;
+    }
+
+    if (captured->graph->IsCaptured())
+    {
+        captured->graph->Replay();
+        size_t i = 0;
+        for (const auto& node : evalOrder) // in order, so that each node stays newer than its inputs
+            if (!backprop && captured->evaluated[i++])
+                node->BumpEvalTimeStamp();
+        return true;
+    }
+    if (captured->numFailures >= CapturedPass::MaxFailures)
+        return false;
+    if (captured->numRuns++ == 0)
+    {
+        captured->graph->Run(pass);
+        return true;
+    }
+
+    std::vector<TimeStamp> timeStamps(evalOrder.size());
+    size_t i = 0;
+    for (const auto& node : evalOrder)
+        static_cast<const TimeStamp&>(*node).CopyTo(timeStamps[i++]); // (ComputationNodeBase::CopyTo() hides it)
+
+    if (captured->graph->Capture(pass))
+    {
+        captured->evaluated.clear();
+        i = 0;
+        for (const auto& node : evalOrder)
+            captured->evaluated.push_back(node->GetEvalTimeStamp() != timeStamps[i++].GetEvalTimeStamp());
+        if (TraceLevel() > 0)
+            fprintf(stderr, "RunCapturedOnGPU: Captured %ls of %ls %ls operation.\n",
+                    backprop ? L"Backprop" : L"ForwardProp", rootNode->NodeName().c_str(), rootNode->OperationName().c_str());
+        return true;
+    }
+
+    // nothing was executed: undo the evaluation and run again
+    i = 0;
+    for (const auto& node : evalOrder)
+        timeStamps[i++].CopyTo(*node);
+    if (++captured->numFailures == CapturedPass::MaxFailures)
+        fprintf(stderr, "RunCapturedOnGPU: WARNING: Giving up capturing %ls of %ls %ls operation for the current minibatch layout.\n",
+                backprop ? L"Backprop" : L"ForwardProp", rootNode->NodeName().c_str(), rootNode->OperationName().c_str());
+    captured->graph->Run(pass);
+    return true;
+}
+
+// -----------------------------------------------------------------------
+// concurrent forward prop -- the independent branches of a network are evaluated at the same time:
+//  - on the GPU, they are issued on a few GPU streams (e.g. the towers of an Inception block or of a two-tower model),
+//    so that their small kernels can run side by side. Enabled with Globals::SetMultiStreamExecution().
+//  - during inference on the CPU, the nodes are run by the ThreadPool as soon as the nodes they depend on are done
+//    (e.g. the embeddings of many sparse features), each with a number of OpenMP threads by its cost. Enabled with
+//    Globals::SetInterOpParallelism().
+//
+// Both work on the top-level nodes of the roots (PAR nodes and SEQTraversalFlowControlNodes), with the dependencies
+// found by AnalyzeForwardPropDependencies().
+//
+// On the GPU, consecutive recurrent loops such as the layers of a stacked LSTM are also run as a wavefront (see
+// PlanWavefronts()): a loop steps one time step behind the loop it reads, on another stream, together with the
+// frame-local nodes in between, so that layer l at time t+1 overlaps layer l+1 at time t. The projections of the
+// inputs of a loop stay outside of it, as regular nodes computed for all frames at once, unless they read another
+// loop of the wavefront.
+// -----------------------------------------------------------------------
+
+struct ComputationNetwork::ForwardPropPlan
+{
+    std::vector<ComputationNodeBasePtr> nodes; // top-level nodes in evaluation order
+    DEVICEID_TYPE deviceId = CPUDEVICE;
+    bool canRunConcurrently = false;
+    std::vector<std::vector<size_t>> dependencies; // inputs and predecessors of each node
+    StreamSchedule streamSchedule;
+    std::shared_ptr<GPUStreamPool> streamPool; // created on first use
+    std::vector<Wavefront> wavefronts;
+    std::vector<int> wavefrontAt; // index of the wavefront that starts at each node, or -1
+    std::vector<std::shared_ptr<GPUStreamPool>> wavefrontStreamPools; // created on first use
+};
+
+// whether a node only reads the frames of its inputs that it computes, so that it can be run one time step at a time
+// along with the loops around it
+static bool IsFrameLocal(const ComputationNodeBasePtr& node)
+{
+    if (!node->HasMBLayout() || node->IsPartOfLoop())
+        return false;
+    for (const auto& input : node->GetInputs())
+    {
+        if (input->HasMBLayout() && input->GetMBLayout() != node->GetMBLayout())
+            return false;
+    }
+    const auto& operation = node->OperationName();
+    return dynamic_cast<IElementwiseNode*>(node.get()) ||
+           operation == OperationNameOf(TimesNode) ||
+           operation == OperationNameOf(SoftmaxNode) ||
+           operation == OperationNameOf(LogSoftmaxNode) ||
+           operation == OperationNameOf(RowStackNode);
+}
+
+/*static*/ void ComputationNetwork::PlanForwardPropWavefronts(ForwardPropPlan& plan, const std::vector<std::vector<size_t>>& inputs, const std::vector<std::vector<size_t>>& predecessors)
+{
+    const auto& nodes = plan.nodes;
+    std::vector<bool> isLoop(nodes.size()), isSteppable(nodes.size());
+    std::vector<int> layoutOf(nodes.size(), -1), directionOf(nodes.size(), 0);
+    std::map<const MBLayout*, int> layoutIds;
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        const auto& node = nodes[i];
+        isLoop[i] = node->Is<SEQTraversalFlowControlNode>();
+        isSteppable[i] = !isLoop[i] && IsFrameLocal(node);
+        const auto& layout = isLoop[i] ? node->As<SEQTraversalFlowControlNode>()->m_nestedNodes[0]->GetMBLayout() : node->GetMBLayout();
+        if (layout)
+            layoutOf[i] = layoutIds.insert(make_pair(layout.get(), (int)layoutIds.size())).first->second;
+        if (isLoop[i])
+            directionOf[i] = node->As<SEQTraversalFlowControlNode>()->m_steppingDirection;
+    }
+    plan.wavefronts = PlanWavefronts(inputs, predecessors, isLoop, isSteppable, layoutOf, directionOf);
+    plan.wavefrontAt.assign(nodes.size(), -1);
+    plan.wavefrontStreamPools.resize(plan.wavefronts.size());
+    for (size_t i = 0; i < plan.wavefronts.size(); i++)
+        plan.wavefrontAt[plan.wavefronts[i].stages.front().loop] = (int)i;
+}
+
+bool ComputationNetwork::ForwardPropConcurrently(const std::vector<ComputationNodeBasePtr>& rootNodes)
+{
+    // the dependencies through memory sharing are only known once the matrices are allocated
+    if ((!Globals::ShouldUseMultipleStreams() && !Globals::ShouldUseInterOpParallelism()) || !AreMatricesAllocated() || rootNodes.empty())
+        return false;
+
+    auto key = rootNodes;
+    std::sort(key.begin(), key.end());
+    auto& plan = m_forwardPropPlans[key];
+    if (!plan)
+    {
+        plan = make_shared<ForwardPropPlan>();
+        TravserseInSortedGlobalEvalOrder(rootNodes, [&plan](const ComputationNodeBasePtr& node) { plan->nodes.push_back(node); });
+
+        // all nodes must be on the same device, and the CPU-only forward-prop fusion is not supported
+        plan->deviceId = rootNodes.front()->GetDeviceId();
+        plan->canRunConcurrently = true;
+        for (const auto& rootNode : rootNodes)
+        {
+            for (const auto& node : GetEvalOrder(rootNode))
+                plan->canRunConcurrently &= node->GetDeviceId() == plan->deviceId && !node->GetForwardPropFusedInto();
+        }
+        if (plan->canRunConcurrently)
+        {
+            std::vector<std::vector<size_t>> inputs, predecessors;
+            AnalyzeForwardPropDependencies(plan->nodes, inputs, predecessors);
+            if (plan->deviceId >= 0)
+            {
+                plan->streamSchedule = PlanStreamSchedule(inputs, predecessors, Globals::GetNumExecutionStreams());
+                if (TraceLevel() > 0 && plan->streamSchedule.IsConcurrent())
+                    fprintf(stderr, "\nMulti-stream execution: %d nodes of %ls %ls operation are issued on %d streams with %d events.\n",
+                            (int)plan->streamSchedule.steps.size(), rootNodes.front()->NodeName().c_str(), rootNodes.front()->OperationName().c_str(),
+                            (int)plan->streamSchedule.numStreams, (int)plan->streamSchedule.numEvents);
+
+                PlanForwardPropWavefronts(*plan, inputs, predecessors);
+                for (const auto& wavefront : plan->wavefronts)
+                {
+                    if (TraceLevel() > 0)
+                        fprintf(stderr, "Multi-stream execution: %d loops from %ls of %ls %ls operation are stepped as a wavefront.\n",
+                                (int)wavefront.stages.size(), plan->nodes[wavefront.stages.front().loop]->NodeName().c_str(),
+                                rootNodes.front()->NodeName().c_str(), rootNodes.front()->OperationName().c_str());
+                }
+            }
+            plan->dependencies = std::move(inputs);
+            for (size_t i = 0; i < plan->dependencies.size(); i++)
+                plan->dependencies[i].insert(plan->dependencies[i].end(), predecessors[i].begin(), predecessors[i].end());
+        }
+    }
+
+    if (!plan->canRunConcurrently)
+        return false;
+    if (plan->deviceId >= 0)
+    {
+        if (!Globals::ShouldUseMultipleStreams() || (!plan->streamSchedule.IsConcurrent() && plan->wavefronts.empty()))
+            return false;
+        ForwardPropOnStreams(*plan);
+    }
+    else
+    {
+        // training keeps the sequential order, e.g. for the random numbers of dropout
+        if (!Globals::ShouldUseInterOpParallelism() || !Environment().IsInferring() || ThreadPool::Get().GetNumWorkers() == 0)
+            return false;
+        ForwardPropOnThreadPool(*plan);
+    }
+    return true;
+}
+
+// The host still visits the nodes in evaluation order, apart from the nodes without dependencies, which come first;
+// so time stamps and other host-side state are updated as in sequential execution. Backprop stays on the current
+// stream, which waits for all streams at the end.
+void ComputationNetwork::ForwardPropOnStreams(ForwardPropPlan& plan)
+{
+    const auto& schedule = plan.streamSchedule;
+    if (!plan.streamPool)
+        plan.streamPool = make_shared<GPUStreamPool>(plan.deviceId, schedule.numStreams, schedule.numEvents);
+
+    for (auto leaf : schedule.leaves)
+        PARTraversalFlowControlNode::ForwardProp(plan.nodes[leaf], FrameRange(nullptr));
+
+    auto& streamPool = *plan.streamPool;
+    streamPool.Begin();
+    try
+    {
+        for (const auto& step : schedule.steps)
+        {
+            streamPool.Select(step.stream);
+            for (auto event : step.waits)
+                streamPool.WaitEvent(event);
+            // the later members of a wavefront are up to date once its first loop is done, and are skipped
+            if (plan.wavefrontAt[step.node] >= 0)
+                ForwardPropWavefront(plan, (size_t)plan.wavefrontAt[step.node]);
+            else
+                PARTraversalFlowControlNode::ForwardProp(plan.nodes[step.node], FrameRange(nullptr));
+            if (step.event >= 0)
+                streamPool.RecordEvent((size_t)step.event);
+        }
+    }
+    catch (...)
+    {
+        try
+        {
+            streamPool.End();
+        }
+        catch (...)
+        {
+        }
+        throw;
+    }
+    streamPool.End();
+}
+
+static void ForwardPropFrame(const ComputationNodeBasePtr& node, const FrameRange& t);
+static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient);
+
+// Issues the stages of a wavefront time step by time step, stage k on stream k of its own pool, after waiting for
+// stage k-1 at the same time step. The members are begun and ended like in PAR traversal; their time stamps are
+// bumped again at the end, in evaluation order, since the stepping interleaves them.
+void ComputationNetwork::ForwardPropWavefront(ForwardPropPlan& plan, size_t index)
+{
+    const auto& stages = plan.wavefronts[index].stages;
+    const auto& firstLoop = plan.nodes[stages.front().loop];
+    if (!firstLoop->IsOutOfDateWrtInputs())
+        return PARTraversalFlowControlNode::ForwardProp(firstLoop, FrameRange(nullptr));
+
+    auto& streamPool = plan.wavefrontStreamPools[index];
+    if (!streamPool)
+        streamPool = make_shared<GPUStreamPool>(plan.deviceId, std::min(stages.size(), Globals::GetNumExecutionStreams()), stages.size());
+
+    std::vector<ComputationNodeBasePtr> members;
+    for (const auto& stage : stages)
+    {
+        for (auto node : stage.steppedNodes)
+            members.push_back(plan.nodes[node]);
+        members.push_back(plan.nodes[stage.loop]);
+    }
+    for (const auto& node : members)
+    {
+        if (!node->IsElementwiseFused())
+            node->BeginForwardProp();
+    }
 
-    // initialize root gradient with a scalar value of 1.0
-    if (!SetRootGradientToScalarOne<float>(rootNode) && !SetRootGradientToScalarOne<double>(rootNode))
-        LogicError("Backprop: Training criterion is neither ComputationNode<float> nor ComputationNode<double>.");
+    FrameRangeIteration range(firstLoop->As<SEQTraversalFlowControlNode>()->m_nestedNodes[0]->GetMBLayout(), firstLoop->As<SEQTraversalFlowControlNode>()->m_steppingDirection);
+    streamPool->Begin();
+    try
+    {
+        for (auto t = range.begin(); t != range.end(); t++)
+        {
+            for (size_t k = 0; k < stages.size(); k++)
+            {
+                streamPool->Select(k % streamPool->GetNumStreams());
+                if (k > 0)
+                    streamPool->WaitEvent(k - 1);
+                for (auto node : stages[k].steppedNodes)
+                    ForwardPropFrame(plan.nodes[node], t);
+                plan.nodes[stages[k].loop]->As<SEQTraversalFlowControlNode>()->ForwardPropStep(t);
+                streamPool->RecordEvent(k);
+            }
+        }
+    }
+    catch (...)
+    {
+        try
+        {
+            streamPool->End();
+        }
+        catch (...)
+        {
+        }
+        throw;
+    }
+    streamPool->End();
 
-    // reset all gradients below rootNode to zero (actually, internally, this is lazy, but we don't care here)
-    ZeroInputGradients(rootNode);
+    for (const auto& node : members)
+    {
+        if (!node->IsElementwiseFused())
+            node->EndForwardProp();
+        if (node->Is<SEQTraversalFlowControlNode>())
+        {
+            for (const auto& nestedNode : node->As<SEQTraversalFlowControlNode>()->m_nestedNodes)
+            {
+                nestedNode->BumpEvalTimeStamp();
+                if (nestedNode->HasEnvironmentPtr() && nestedNode->Environment().ShouldDumpNode())
+                    DumpNode(nestedNode, /*dumpGradient=*/false);
+            }
+        }
+        else if (node->HasEnvironmentPtr() && node->Environment().ShouldDumpNode())
+            DumpNode(node, /*dumpGradient=*/false);
+        node->BumpEvalTimeStamp();
+    }
+}
 
-    // backpropagate through the network
-    GetNestedNetwork(rootNode)->Backprop(FrameRange(nullptr), true, true);
+// estimated work of a node, in elements of its output
+static size_t ForwardPropCost(const ComputationNodeBasePtr& node)
+{
+    return node->GetSampleLayout().GetNumElements() * (node->HasMBLayout() ? node->GetMBLayout()->GetNumCols() : 1);
+}
+
+// The nodes run as tasks of the ThreadPool. A node gets one thread per 'elementsPerThread' elements of its output, but
+// not more than its share of the thread budget among the nodes running at the time it starts. A loop runs with the
+// full share, since its steps are sequential.
+void ComputationNetwork::ForwardPropOnThreadPool(const ForwardPropPlan& plan)
+{
+    const size_t elementsPerThread = 1 << 15;
+    const size_t budget = ComputeThreadShare::GetShare();
+    std::atomic<size_t> numRunning(0);
+    ThreadPool::Get().RunTaskGraph(plan.dependencies, [&](size_t i)
+    {
+        const auto& node = plan.nodes[i];
+        const size_t share = std::max<size_t>(1, budget / ++numRunning);
+        size_t numThreads = share;
+        if (!node->Is<SEQTraversalFlowControlNode>())
+            numThreads = std::min(share, std::max<size_t>(1, ForwardPropCost(node) / elementsPerThread));
+        {
+            ComputeThreadLimit limit(numThreads);
+            PARTraversalFlowControlNode::ForwardProp(node, FrameRange(nullptr));
+        }
+        numRunning--; // after a failure, the remaining nodes are skipped anyway
+    });
 }
 
 void ComputationNetwork::FormNestedNetwork(const ComputationNodeBasePtr& rootNode)
@@ -145,9 +630,21 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
 {
     if (node->IsOutOfDateWrtInputs())
     {
+        // the root of a fused elementwise tree computes this node along with its own value (see FuseElementwise())
+        if (node->IsElementwiseFused())
+        {
+            node->BumpEvalTimeStamp();
+            return;
+        }
+
         node->BeginForwardProp();
         node->BeginTiming(false /*backward*/);
-        node->ForwardProp(fr.WithLayout(node->GetMBLayout()));
+        // skip nodes whose value an input has already computed along with its own (see FuseForwardProp())
+        auto fusedInto = node->GetForwardPropFusedInto();
+        if (const auto& fusion = node->GetElementwiseFusion())
+            fusion->ForwardProp(fr.WithLayout(node->GetMBLayout()));
+        else if (!fusedInto || !fusedInto->HasComputedFusedNodes())
+            node->ForwardProp(fr.WithLayout(node->GetMBLayout()));
         node->EndTiming(false /*backward*/);
         node->EndForwardProp();
 
@@ -185,6 +682,17 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
     {
         auto& node = *pnode;
 
+        // entering a recomputation segment: recompute the values that were dropped after forward prop
+        if (!m_recomputationPlan.empty())
+        {
+            auto segment = m_recomputationPlan.find(node);
+            if (segment != m_recomputationPlan.end())
+            {
+                for (auto& recomputedNode : segment->second)
+                    Recompute(recomputedNode, fr);
+            }
+        }
+
         node->BeginBackprop();
         node->BeginTiming(true /*backward*/);
         node->Backprop(fr.WithLayout(node->GetMBLayout()), true /*childrenInThisLoop*/, true /*childrenInOuterLoop*/);
@@ -194,8 +702,54 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
         // Extreme Tracing, part 2/4
         if (node->HasEnvironmentPtr() && node->Environment().ShouldDumpNode() && node->NeedsGradient())
             DumpNode(node, /*dumpGradient=*/true);
+
+        // all consumers of a recomputed value come later in evaluation order, so it is no longer needed;
+        // hand the forward-prop buffer back to the node
+        if (!m_recomputedNodes.empty() && m_recomputedNodes.find(node) != m_recomputedNodes.end())
+            node->SwapRecomputedValue();
+
+        if (m_backpropCallback)
+            m_backpropCallback(node);
     }
 }
+
+// run ForwardProp() once more, into the node's recomputation buffer
+// Unlike ForwardProp(node, fr), this does not check or bump time stamps, since the inputs have not changed.
+/*static*/ void ComputationNetwork::PARTraversalFlowControlNode::Recompute(const ComputationNodeBasePtr& node, const FrameRange& fr)
+{
+    GPUMemoryCategoryScope memoryCategory(GPUMemoryCategory::Activations);
+    node->SwapRecomputedValue();
+    node->BeginForwardProp();
+    node->BeginTiming(false /*backward*/);
+    node->ForwardProp(fr.WithLayout(node->GetMBLayout()));
+    node->EndTiming(false /*backward*/);
+    node->EndForwardProp();
+}
+
+void ComputationNetwork::PARTraversalFlowControlNode::SetRecomputationPlan(const RecomputationPlan& plan)
+{
+    m_recomputationPlan = plan;
+    m_recomputedNodes.clear();
+    for (const auto& segment : m_recomputationPlan)
+        m_recomputedNodes.insert(segment.second.begin(), segment.second.end());
+}
+
+// MatrixPool simulation counterpart of the recomputation in Backprop(): buffers are requested when backprop enters
+// a segment, and each is released once its node has been backpropagated
+void ComputationNetwork::PARTraversalFlowControlNode::RequestRecomputationBuffersForSegment(const ComputationNodeBasePtr& segmentEnd, MatrixPool& matrixPool)
+{
+    auto segment = m_recomputationPlan.find(segmentEnd);
+    if (segment == m_recomputationPlan.end())
+        return;
+    for (auto& recomputedNode : segment->second)
+        recomputedNode->RequestMatricesBeforeRecomputation(matrixPool);
+}
+
+void ComputationNetwork::PARTraversalFlowControlNode::ReleaseRecomputationBuffer(const ComputationNodeBasePtr& node, MatrixPool& matrixPool)
+{
+    if (m_recomputedNodes.find(node) != m_recomputedNodes.end())
+        node->ReleaseMatricesAfterRecomputation(matrixPool);
+}
 /*virtual*/ void ComputationNetwork::PARTraversalFlowControlNode::RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) /*override*/
 {
 }
@@ -264,7 +818,8 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
 
     // tell all that loop is about to commence
     for (auto& node : m_nestedNodes)
-        node->BeginForwardProp();
+        if (!node->IsElementwiseFused())
+            node->BeginForwardProp();
 }
 
 // evaluation of a SEQTraversalFlowControlNode FlowControlNode
@@ -282,15 +837,7 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
     // if we implement an according FrameRangeIteration.
     FrameRangeIteration range(GetMBLayout(), m_steppingDirection);
     for (auto t = range.begin(); t != range.end(); t++)
-    {
-        for (auto& node : m_nestedNodes)
-        {
-            node->BeginTiming(false /*backward*/);
-            node->ForwardProp(t);
-            node->EndTiming(false /*backward*/);
-            node->BumpEvalTimeStamp();
-        }
-    }
+        ForwardPropStep(t);
 
     // Extreme Tracing, part 3/4
     for (auto& node : m_nestedNodes)
@@ -302,11 +849,33 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
     }
 }
 
+// runs a node for a single time step
+static void ForwardPropFrame(const ComputationNodeBasePtr& node, const FrameRange& t)
+{
+    if (!node->IsElementwiseFused()) // else computed by the root of its tree, see FuseElementwise()
+    {
+        node->BeginTiming(false /*backward*/);
+        if (const auto& fusion = node->GetElementwiseFusion())
+            fusion->ForwardProp(t);
+        else
+            node->ForwardProp(t);
+        node->EndTiming(false /*backward*/);
+    }
+    node->BumpEvalTimeStamp();
+}
+
+void ComputationNetwork::SEQTraversalFlowControlNode::ForwardPropStep(const FrameRange& t)
+{
+    for (auto& node : m_nestedNodes)
+        ForwardPropFrame(node, t);
+}
+
 /*virtual*/ void ComputationNetwork::SEQTraversalFlowControlNode::EndForwardProp() /*override*/
 {
     // tell all that loop is done  --e.g. PastValueNode will capture its state for BPTT processing
     for (auto& node : m_nestedNodes)
-        node->EndForwardProp();
+        if (!node->IsElementwiseFused())
+            node->EndForwardProp();
 }
 
 // called before first iteration step of ComputeGradient()
@@ -480,6 +1049,7 @@ void ComputationNetwork::InvalidateCompiledNetwork()
     m_allSEQNodes.clear();
     m_evalOrders.clear();
     m_nestedNetworks.clear();
+    m_forwardPropPlans.clear();
     m_inputValues.clear();
     m_learnableParameters.clear();
 }
@@ -504,8 +1074,26 @@ void ComputationNetwork::CompileNetwork()
     // Or just invalidate it again, which is easier and safer.
     InvalidateCompiledNetwork();
 
+    // time the steps, which dominate the startup of very large networks
+    vector<pair<const char*, double>> stepTimes;
+    auto stepStart = chrono::steady_clock::now();
+    let endStep = [&](const char* step)
+    {
+        auto now = chrono::steady_clock::now();
+        stepTimes.push_back(make_pair(step, chrono::duration<double>(now - stepStart).count()));
+        stepStart = now;
+    };
+
+    // The roots, the global eval order and the loops depend on the structure only, and may have been cached by an earlier run.
+    let cachePath = GetCompiledStructureCachePath();
+    let isStructureCached = !cachePath.empty() && TryLoadCompiledStructure(cachePath);
+    if (isStructureCached && TraceLevel() > 0)
+        fprintf(stderr, "\nUsing the cached network structure %ls.\n", cachePath.c_str());
+
     // all steps below have to be repeated for all root nodes (=nodes without parents and PreComputeNodes)
-    DetermineSetOfAllRoots();
+    if (!isStructureCached)
+        DetermineSetOfAllRoots();
+    endStep("roots");
 
     if (TraceLevel() > 0)
     {
@@ -519,7 +1107,9 @@ void ComputationNetwork::CompileNetwork()
 
     // STEP: Create a depth-first tree-traversal order through complete graph.
     // TODO: Do not cache this before reordering; get list & pass to FormRecurrentLoops() which reorders it, then store it (such that GetEvalOrder(nullptr) is always valid w.r.t. loops).
-    FormEvalOrder(nullptr);
+    if (!isStructureCached)
+        FormEvalOrder(nullptr);
+    endStep("eval order");
 
     // STEP: Form the m_inputValues and m_learnableParameters sets for the entire network.
     // Needed for ResetMBLayouts() below.
@@ -532,7 +1122,13 @@ void ComputationNetwork::CompileNetwork()
     ResetMBLayouts();
 
     // STEP: Discover nested loops.
-    FormRecurrentLoops();
+    if (!isStructureCached)
+    {
+        FormRecurrentLoops();
+        if (!cachePath.empty())
+            SaveCompiledStructure(cachePath);
+    }
+    endStep("loops");
 
     // STEP: Create loop-corrected depth-first traversals and cached input/parameter sets for every actual root node.
     for (auto& root : m_allRoots)
@@ -540,13 +1136,16 @@ void ComputationNetwork::CompileNetwork()
         FormEvalOrder(root);
         CollectInputAndLearnableParameters(root);
     }
+    endStep("eval orders of roots");
 
     // STEP: Form nested structure of PAR and SEQ traversal nodes.
     for (auto& node : m_allRoots)
         FormNestedNetwork(node);
+    endStep("nested networks");
 
     // STEP: Infer node dimensions.
     ValidateNetwork();
+    endStep("validation");
 
     // STEP: Optimize the network.
     // :)
@@ -555,7 +1154,12 @@ void ComputationNetwork::CompileNetwork()
     ResetEvalTimeStamps(); // invalidate all m_value fields. Really belongs into StartEvaluateMinibatchLoop()
 
     if (TraceLevel() > 0)
-        fprintf(stderr, "\nPost-processing network complete.\n\n");
+    {
+        fprintf(stderr, "\nPost-processing network complete (%d nodes):", (int)m_nameToNodeMap.size());
+        for (const auto& stepTime : stepTimes)
+            fprintf(stderr, " %s %.3fs%s", stepTime.first, stepTime.second, &stepTime == &stepTimes.back() ? "" : ",");
+        fprintf(stderr, ".\n\n");
+    }
 
     m_isCompiled = true;
 }
@@ -672,6 +1276,18 @@ void ComputationNetwork::ResetMBLayouts()
 // validation
 // -----------------------------------------------------------------------
 
+// what the non-final passes of ValidateNetwork() know about the nodes of the global eval order, by position in it
+// A node is validated again only if it was not valid, or an input changed after the node was last validated.
+struct ComputationNetwork::ValidationState
+{
+    std::vector<size_t> lastValidated; // stamp of the last ValidateNode() of the node
+    std::vector<size_t> lastChanged;   // stamp of the last ValidateNode() that changed the node
+    std::vector<char> valid;
+    size_t stamp;
+
+    ValidationState(size_t numNodes) : lastValidated(numNodes, 0), lastChanged(numNodes, 0), valid(numNodes, false), stamp(0) {}
+};
+
 // validate sub-network needed to evalute a specific output node
 // This calls Validate() on every node in evaluation order (allowing to propagate things forwards through the net).
 // This is called lazily but once only per node until next ClearCache().
@@ -695,13 +1311,15 @@ void ComputationNetwork::ValidateNetwork()
     //    Keep going through the list until all nodes have been validated and all inputs have been validated as well.
     //  - validate (final)              // final means consistency checks
     //    Fail if any change during this stage.
+    // After the first pass, only the nodes that were not valid or whose inputs changed since are validated again.
+    ValidationState state(nodes.size());
     size_t pass = 1;
     size_t toValidate = nodes.size();
     while (toValidate > 0)
     {
         if (TraceLevel() > 0)
         fprintf(stderr, "\nValidating network. %d nodes to process in pass %d.\n\n", (int) toValidate, (int) pass);
-        toValidate = ValidateNodes(nodes, /*isFirstPass=*/pass == 1, false /*isFinalValidationPass*/);
+        toValidate = ValidateNodes(nodes, /*isFirstPass=*/pass == 1, false /*isFinalValidationPass*/, &state);
         pass++;
     }
     if (TraceLevel() > 0)
@@ -796,12 +1414,28 @@ bool ComputationNetwork::ValidateNode(ComputationNodeBasePtr node, bool isFinalV
 
 // perform one pass of validation over the topologically-sorted node set
 // returns how many nodes either could not yet be validated yet or have changed and thus must be redone
-size_t ComputationNetwork::ValidateNodes(list<ComputationNodeBasePtr> nodes, bool isFirstPass, bool isFinalValidationPass)
+// With a 'state', 'nodes' must be the global eval order, and nodes whose inputs have not changed since they were valid are skipped.
+size_t ComputationNetwork::ValidateNodes(const list<ComputationNodeBasePtr>& nodes, bool isFirstPass, bool isFinalValidationPass, ValidationState* state)
 {
+    const auto& positions = GetGlobalEvalOrderPositions();
     size_t todo = 0;
+    size_t position = (size_t)-1;
     for (auto& node : nodes)
     {
+        position++;
         const auto& children = node->GetInputs();
+        if (state && state->valid[position])
+        {
+            bool inputsChanged = false;
+            for (auto& child : children)
+            {
+                auto childPosition = positions.find(child.get());
+                inputsChanged |= childPosition == positions.end() || state->lastChanged[childPosition->second] > state->lastValidated[position];
+            }
+            if (!inputsChanged)
+                continue;
+        }
+
         const bool isLeaf = node->IsLeaf();
         // only validate a node if it has at least one child
         bool hasVisitedChild = false;
@@ -850,7 +1484,28 @@ size_t ComputationNetwork::ValidateNodes(list<ComputationNodeBasePtr> nodes, boo
                 LogicError("ValidateSubNetwork: %ls %ls operation in final validation although not all children were visited?", node->NodeName().c_str(), node->OperationName().c_str());
             // if all children valid then
             valid = (allChildrenVisited && unchanged) || isLeaf;
+
+            if (state)
+            {
+                state->lastValidated[position] = ++state->stamp;
+                if (!unchanged)
+                {
+                    // The change may also have been to the inputs, so they are validated again as well.
+                    state->lastChanged[position] = state->stamp;
+                    for (auto& child : children)
+                    {
+                        auto childPosition = positions.find(child.get());
+                        if (childPosition != positions.end())
+                        {
+                            state->lastChanged[childPosition->second] = state->stamp;
+                            state->valid[childPosition->second] = false;
+                        }
+                    }
+                }
+            }
         }
+        if (state)
+            state->valid[position] = valid;
         // count those that we need to redo
         if (!valid)
             todo++;
@@ -885,8 +1540,8 @@ void ComputationNetwork::MarkValueNonSharableNodes()
         // for bakcpropagation and thus reusing them within the network is not possible as 
         // we do not control when the user actually releases the input/output Matrices that
         // they may have help in the backprop state returned from the UDF's forward pass.
-        bool isUserDefinedV2FunctionNode = (node->OperationName() == L"UserDefinedV2Function");
-        if (isUserDefinedV2FunctionNode)
+        // UDFs computed on the buffers of their node only use them during the call, so they are shared as planned.
+        if (node->HoldsValuesExternally())
         {
             node->MarkValueNonSharable();
             for (auto input : inputs)
@@ -1025,6 +1680,13 @@ void ComputationNetwork::PrintMemorySharingStructure(const vector<ComputationNod
 
     fprintf(stderr, "\nMemory Sharing: Out of %d matrices, %d are shared as %d, and %d are not shared.\n", (int)numMatrices, (int)(numMatrices - numUnshared), (int)numShared, (int)numUnshared);
 
+    const auto& plan = m_matrixPool.GetMemoryPlanSummary();
+    if (plan.naivePeak > 0)
+        fprintf(stderr, "\nMemory Plan: minibatch-scaled matrices need %d elements per sample without sharing, %d as shared (%.1f%%), "
+                        "%d with offset planning (%.1f%%); the liveness lower bound is %d.\n",
+                (int)plan.naivePeak, (int)plan.sharedPeak, 100.0 * plan.sharedPeak / plan.naivePeak,
+                (int)plan.plannedPeak, 100.0 * plan.plannedPeak / plan.naivePeak, (int)plan.lowerBound);
+
     fprintf(stderr, "\nHere are the ones that share memory:\n"); 
     for (const auto& item : memSharingStructure)
     {
@@ -1057,6 +1719,420 @@ void ComputationNetwork::PrintMemorySharingStructure(const vector<ComputationNod
 }
 
 
+// Forward-prop fusion for inference: nodes that implement IForwardPropFusable (e.g. convolutions on the CPU) take over
+// the forward prop of the chain of nodes that consume their output, if each link is the only consumer of the previous
+// one and the intermediate values are not needed otherwise. The value of the last fused node is written before its
+// turn in the evaluation order, so it must not be shared with other nodes.
+// Without roots (networks that are trained) any previous fusion is undone.
+void ComputationNetwork::FuseForwardProp(const std::vector<ComputationNodeBasePtr>& forwardPropRoots)
+{
+    // the longest chains that nodes currently fuse (e.g. bias and ReLU)
+    const size_t maxChainLength = 3;
+
+    // consumers of each node within the evaluated part of the network
+    std::vector<ComputationNodeBasePtr> nodes;
+    std::unordered_map<ComputationNodeBasePtr, std::vector<ComputationNodeBasePtr>> consumers;
+    std::unordered_set<ComputationNodeBasePtr> visited;
+    for (auto& root : forwardPropRoots)
+    {
+        for (const auto& node : GetEvalOrder(root))
+        {
+            if (!visited.insert(node).second)
+                continue;
+            nodes.push_back(node);
+            for (const auto& input : node->GetInputs())
+                consumers[input].push_back(node);
+        }
+    }
+    const std::set<ComputationNodeBasePtr> roots(forwardPropRoots.begin(), forwardPropRoots.end());
+
+    for (const auto& node : GetAllNodes())
+    {
+        node->SetForwardPropFusedInto(nullptr);
+        if (auto fusable = dynamic_cast<IForwardPropFusable*>(node.get()))
+            fusable->FuseForwardProp({});
+    }
+    if (!Globals::ShouldFuseForwardProp())
+        return;
+
+    for (const auto& node : nodes)
+    {
+        auto fusable = dynamic_cast<IForwardPropFusable*>(node.get());
+        if (!fusable || node->IsPartOfLoop() || node->GetForwardPropFusedInto())
+            continue;
+
+        std::vector<ComputationNodeBasePtr> chain;
+        for (auto last = node; chain.size() < maxChainLength && roots.find(last) == roots.end();)
+        {
+            const auto& lastConsumers = consumers[last];
+            if (lastConsumers.size() != 1 || lastConsumers[0]->IsPartOfLoop())
+                break;
+            last = lastConsumers[0];
+            chain.push_back(last);
+        }
+        if (chain.empty())
+            continue;
+
+        const size_t numFused = fusable->FuseForwardProp(chain);
+        for (size_t i = 0; i < numFused; i++)
+        {
+            chain[i]->SetForwardPropFusedInto(fusable);
+            if (TraceLevel() > 0)
+                fprintf(stderr, "FuseForwardProp: %ls %ls operation is computed by %ls %ls operation.\n",
+                        chain[i]->NodeName().c_str(), chain[i]->OperationName().c_str(), node->NodeName().c_str(), node->OperationName().c_str());
+        }
+        if (numFused > 0)
+            chain[numFused - 1]->MarkValueNonSharable();
+    }
+}
+
+// forward prop of a tree of elementwise nodes in a single ElementwiseProgram, see FuseElementwise()
+template <class ElemType>
+class ElementwiseFusion : public IElementwiseFusion
+{
+public:
+    ElementwiseFusion(ComputationNode<ElemType>* root, const std::vector<ComputationNodeBasePtr>& fusedNodes,
+                      const std::vector<ComputationNodeBasePtr>& inputs, const ElementwiseProgram& program)
+        : m_root(root), m_fusedNodes(fusedNodes), m_inputs(inputs), m_program(program)
+    {
+    }
+
+    const std::vector<ComputationNodeBasePtr>& /*IElementwiseFusion::*/GetFusedNodes() const override { return m_fusedNodes; }
+
+    void /*IElementwiseFusion::*/ForwardProp(const FrameRange& fr) override
+    {
+        std::vector<Matrix<ElemType>> slices; // of the inputs with an MBLayout; the others are broadcast as a whole
+        slices.reserve(m_inputs.size());
+        std::vector<const Matrix<ElemType>*> inputValues;
+        bool fuse = !m_root->Environment().IsTraining() && m_root->Value().GetMatrixType() == DENSE;
+        for (const auto& input : m_inputs)
+        {
+            auto& node = *input->As<ComputationNode<ElemType>>();
+            fuse &= node.Value().GetMatrixType() == DENSE;
+            if (!fuse)
+                break;
+            if (node.HasMBLayout())
+            {
+                slices.push_back(node.ValueFor(fr));
+                inputValues.push_back(&slices.back());
+            }
+            else
+                inputValues.push_back(&node.Value());
+        }
+
+        if (fuse)
+        {
+            Matrix<ElemType> sliceOutputValue = m_root->ValueFor(fr);
+            sliceOutputValue.ElementwiseProgramOp(0, inputValues, m_program, 1);
+        }
+        else // e.g. sparse inputs: the nodes one by one, which allocates the values of the fused ones
+        {
+            for (const auto& node : m_fusedNodes)
+            {
+                node->BeginForwardProp();
+                node->ForwardProp(fr);
+                node->EndForwardProp();
+            }
+            m_root->ForwardProp(fr);
+        }
+    }
+
+private:
+    ComputationNode<ElemType>* m_root; // not owned, the root owns this
+    std::vector<ComputationNodeBasePtr> m_fusedNodes;
+    std::vector<ComputationNodeBasePtr> m_inputs; // register i of the program holds m_inputs[i]
+    ElementwiseProgram m_program;
+};
+
+template <class ElemType>
+static bool HasElemType(const ComputationNodeBasePtr& node)
+{
+    return node->Is<ComputationNode<ElemType>>();
+}
+
+// Elementwise fusion for inference: trees of elementwise nodes (IElementwiseNode, e.g. the gates of an LSTM) of
+// identical shapes are computed by their root in a single pass over the elements, without the intermediate values,
+// which are never allocated. The other nodes of a tree must be consumed only by their parent in it. The inputs of a
+// tree must have the shape of the root or be broadcast from a tensor without MBLayout of one sample or one element.
+// Without roots (networks that are trained) any previous fusion is undone.
+void ComputationNetwork::FuseElementwise(const std::vector<ComputationNodeBasePtr>& forwardPropRoots)
+{
+    // consumers of each node within the evaluated part of the network
+    std::vector<ComputationNodeBasePtr> nodes;
+    std::unordered_map<ComputationNodeBasePtr, std::vector<ComputationNodeBasePtr>> consumers;
+    std::unordered_set<ComputationNodeBasePtr> visited;
+    for (auto& root : forwardPropRoots)
+    {
+        for (const auto& node : GetEvalOrder(root))
+        {
+            if (!visited.insert(node).second)
+                continue;
+            nodes.push_back(node);
+            for (const auto& input : node->GetInputs())
+                consumers[input].push_back(node);
+        }
+    }
+    const std::set<ComputationNodeBasePtr> roots(forwardPropRoots.begin(), forwardPropRoots.end());
+
+    for (const auto& node : GetAllNodes())
+    {
+        node->SetElementwiseFusion(nullptr);
+        node->SetElementwiseFused(false);
+    }
+    if (!Globals::ShouldFuseElementwise())
+        return;
+
+    // from the last node backwards, so that trees are found from their roots
+    for (auto iter = nodes.rbegin(); iter != nodes.rend(); ++iter)
+    {
+        const auto& root = *iter;
+        auto sameElemType = [&root](const ComputationNodeBasePtr& node)
+        {
+            return HasElemType<float>(node) ? HasElemType<float>(root) : HasElemType<double>(node) ? HasElemType<double>(root) : HasElemType<half>(node) && HasElemType<half>(root);
+        };
+        const auto loop = root->IsPartOfLoop() ? FindInRecurrentLoops(m_allSEQNodes, root) : nullptr;
+        // a node computed like the root, whose inputs all can be read by the program
+        auto isElementwise = [&](const ComputationNodeBasePtr& node)
+        {
+            if (!dynamic_cast<IElementwiseNode*>(node.get()) || node->IsElementwiseFused() || node->GetForwardPropFusedInto() || node->NeedsDynamicValidation() ||
+                !node->HasMBLayout() || node->GetMBLayout() != root->GetMBLayout() || node->GetSampleLayout() != root->GetSampleLayout() || !sameElemType(node) ||
+                node->IsPartOfLoop() != root->IsPartOfLoop() || (loop && FindInRecurrentLoops(m_allSEQNodes, node) != loop))
+                return false;
+            for (const auto& input : node->GetInputs())
+            {
+                if (!sameElemType(input))
+                    return false;
+                const auto& inputShape = input->GetSampleLayout();
+                if (input->HasMBLayout() ? input->GetMBLayout() != root->GetMBLayout() || inputShape != root->GetSampleLayout()
+                                         : inputShape != root->GetSampleLayout() && inputShape.GetNumElements() != 1)
+                    return false;
+            }
+            return true;
+        };
+        if (!isElementwise(root))
+            continue;
+
+        // grow the tree from the root, without exceeding the size of a program
+        std::vector<ComputationNodeBasePtr> tree(1, root); // each node before its inputs in the tree
+        std::set<ComputationNodeBasePtr> inTree(tree.begin(), tree.end());
+        for (size_t i = 0; i < tree.size(); i++)
+        {
+            for (const auto& input : tree[i]->GetInputs())
+            {
+                if (tree.size() < ElementwiseProgram::MaxInstructions && inTree.find(input) == inTree.end() && roots.find(input) == roots.end() &&
+                    consumers[input].size() == 1 && isElementwise(input))
+                {
+                    tree.push_back(input);
+                    inTree.insert(input);
+                }
+            }
+        }
+        if (tree.size() < 2)
+            continue;
+
+        // the program: the inputs of the tree in registers, then the nodes, each after its inputs
+        std::vector<ComputationNodeBasePtr> inputs;
+        std::map<ComputationNodeBasePtr, size_t> inputRegisters;
+        for (const auto& node : tree)
+            for (const auto& input : node->GetInputs())
+                if (inTree.find(input) == inTree.end() && inputRegisters.insert(make_pair(input, inputs.size())).second)
+                    inputs.push_back(input);
+        if (inputs.size() > ElementwiseProgram::MaxInputs)
+            continue;
+
+        ElementwiseProgram program;
+        program.numInputs = inputs.size();
+        std::map<ComputationNodeBasePtr, size_t> registers = inputRegisters;
+        std::vector<ComputationNodeBasePtr> fusedNodes(tree.rbegin(), tree.rend() - 1); // without the root at tree[0]
+        auto emit = [&](const ComputationNodeBasePtr& node)
+        {
+            auto& instruction = program.instructions[program.numInstructions];
+            instruction.op = dynamic_cast<IElementwiseNode*>(node.get())->GetElementwiseOperator();
+            for (size_t i = 0; i < 3; i++)
+                instruction.args[i] = (unsigned char)(i < node->GetNumInputs() ? registers[node->GetInputs()[i]] : 0);
+            registers[node] = program.numInputs + program.numInstructions++;
+        };
+        for (const auto& node : fusedNodes)
+            emit(node);
+        emit(root);
+
+        std::shared_ptr<IElementwiseFusion> fusion;
+        if (HasElemType<float>(root))
+            fusion = make_shared<ElementwiseFusion<float>>(root->As<ComputationNode<float>>(), fusedNodes, inputs, program);
+        else if (HasElemType<double>(root))
+            fusion = make_shared<ElementwiseFusion<double>>(root->As<ComputationNode<double>>(), fusedNodes, inputs, program);
+        else
+            fusion = make_shared<ElementwiseFusion<half>>(root->As<ComputationNode<half>>(), fusedNodes, inputs, program);
+        root->SetElementwiseFusion(fusion);
+        for (const auto& node : fusedNodes)
+        {
+            node->SetElementwiseFused(true);
+            node->MarkValueNonSharable(); // not from the pool, since it is never resized
+        }
+        if (TraceLevel() > 0)
+            fprintf(stderr, "FuseElementwise: %d nodes with %d inputs are computed by %ls %ls operation.\n",
+                    (int)tree.size(), (int)inputs.size(), root->NodeName().c_str(), root->OperationName().c_str());
+    }
+}
+
+// Pipeline parallelism: splits the network into stages, and places stage s on device stageDevices[s], so that a model
+// that does not fit into the memory of one GPU can be trained on several.
+//  - Nodes can be assigned to stages through SetPipelineStage(). Any other node is placed in the latest stage of its
+//    inputs, a leaf in the earliest stage of the nodes that read it.
+//  - If no node is assigned, the evaluation order is cut into stages of about equal cost, counted in the elements of
+//    the node values and of the parameters.
+//  - A recurrent loop is not split; it is placed in the stage of its first node.
+//  - The roots, which the trainer reads, and the leaves other than learnable parameters, which the reader writes, stay on
+//    their device. So do the nodes in 'fixedNodes', e.g. parameters whose values are shared with a learner.
+// Where a node reads an input from another device, a DeviceTransferNode is inserted, which copies the value and, back,
+// the gradient asynchronously between the GPUs.
+// The stages run one after the other. A minibatch can be split into micro-batches through the subminibatches of SGD,
+// which limits the memory of the activations, but they do not overlap across the stages, since a node holds the value
+// of one micro-batch at a time.
+// This must be called after CompileNetwork() and before AllocateAllMatrices(); it recompiles the network.
+void ComputationNetwork::PlacePipelineStages(const std::vector<DEVICEID_TYPE>& stageDevices, const std::vector<ComputationNodeBasePtr>& rootNodes,
+                                             const std::set<ComputationNodeBasePtr>& fixedNodes)
+{
+    VerifyIsCompiled("PlacePipelineStages");
+    if (AreMatricesAllocated())
+        LogicError("PlacePipelineStages: Must be called before the matrices of the network are allocated.");
+    if (stageDevices.empty())
+        return;
+    const size_t numStages = stageDevices.size();
+
+    // the nodes in evaluation order, and the consumers of each
+    std::vector<ComputationNodeBasePtr> nodes;
+    std::unordered_map<ComputationNodeBasePtr, std::vector<ComputationNodeBasePtr>> consumers;
+    std::unordered_set<ComputationNodeBasePtr> visited;
+    for (const auto& root : rootNodes)
+    {
+        for (const auto& node : GetEvalOrder(root))
+        {
+            if (!visited.insert(node).second)
+                continue;
+            nodes.push_back(node);
+            for (const auto& input : node->GetInputs())
+                consumers[input].push_back(node);
+        }
+    }
+    const std::set<ComputationNodeBasePtr> roots(rootNodes.begin(), rootNodes.end());
+    auto staysOnItsDevice = [&](const ComputationNodeBasePtr& node)
+    {
+        return roots.find(node) != roots.end() || fixedNodes.find(node) != fixedNodes.end() ||
+               (node->IsLeaf() && node->OperationName() != OperationNameOf(LearnableParameter));
+    };
+
+    // assign the stages
+    const bool isAnnotated = std::any_of(nodes.begin(), nodes.end(), [](const ComputationNodeBasePtr& node) { return node->GetPipelineStage() >= 0; });
+    std::unordered_map<ComputationNodeBasePtr, size_t> stages;
+    std::map<std::shared_ptr<SEQTraversalFlowControlNode>, size_t> loopStages;
+    double totalCost = 0;
+    std::unordered_map<ComputationNodeBasePtr, double> costs;
+    if (!isAnnotated)
+    {
+        std::unordered_set<ComputationNodeBasePtr> countedParameters;
+        for (const auto& node : nodes)
+        {
+            if (node->IsLeaf())
+                continue;
+            double cost = (double)node->GetSampleLayout().GetNumElements();
+            for (const auto& input : node->GetInputs())
+                if (input->OperationName() == OperationNameOf(LearnableParameter) && countedParameters.insert(input).second)
+                    cost += (double)input->GetSampleLayout().GetNumElements();
+            costs[node] = cost;
+            totalCost += cost;
+        }
+    }
+    double costSoFar = 0;
+    for (const auto& node : nodes)
+    {
+        if (node->IsLeaf())
+        {
+            if (node->GetPipelineStage() >= 0)
+                stages[node] = (size_t)node->GetPipelineStage();
+            continue;
+        }
+        size_t stage = 0;
+        if (node->GetPipelineStage() >= 0)
+            stage = (size_t)node->GetPipelineStage();
+        else if (isAnnotated)
+        {
+            for (const auto& input : node->GetInputs())
+            {
+                auto iter = stages.find(input);
+                if (iter != stages.end())
+                    stage = max(stage, iter->second);
+            }
+        }
+        else if (totalCost > 0) // the stage in which the middle of the node's cost falls
+        {
+            const double cost = costs[node];
+            stage = min(numStages - 1, (size_t)((costSoFar + cost / 2) * numStages / totalCost));
+            costSoFar += cost;
+        }
+        if (node->IsPartOfLoop())
+            stage = loopStages.insert(make_pair(FindInRecurrentLoops(m_allSEQNodes, node), stage)).first->second;
+        if (stage >= numStages)
+            InvalidArgument("PlacePipelineStages: %ls %ls operation is assigned to stage %d, but there are only %d stages.",
+                            node->NodeName().c_str(), node->OperationName().c_str(), (int)stage, (int)numStages);
+        stages[node] = stage;
+    }
+    for (const auto& node : nodes)
+    {
+        if (!node->IsLeaf() || stages.find(node) != stages.end())
+            continue;
+        size_t stage = numStages - 1;
+        for (const auto& consumer : consumers[node])
+            stage = min(stage, stages.at(consumer));
+        stages[node] = stage;
+    }
+
+    // move the nodes, then connect each input on another device through a transfer node, one per input and device
+    for (const auto& node : nodes)
+    {
+        const DEVICEID_TYPE deviceId = stageDevices[stages.at(node)];
+        if (!staysOnItsDevice(node) && node->GetDeviceId() != deviceId)
+            node->MoveToDevice(deviceId);
+    }
+    std::map<std::pair<ComputationNodeBasePtr, DEVICEID_TYPE>, ComputationNodeBasePtr> transfers;
+    for (const auto& node : nodes)
+    {
+        for (size_t i = 0; i < node->GetNumInputs(); i++)
+        {
+            const auto input = node->Input(i);
+            const DEVICEID_TYPE deviceId = node->GetDeviceId();
+            if (input->GetDeviceId() == deviceId)
+                continue;
+            auto& transfer = transfers[make_pair(input, deviceId)];
+            if (!transfer)
+            {
+                const std::wstring name = input->NodeName() + L".toDevice" + std::to_wstring(deviceId);
+                if (HasElemType<float>(input))
+                    transfer = New<DeviceTransferNode<float>>(deviceId, name);
+                else if (HasElemType<double>(input))
+                    transfer = New<DeviceTransferNode<double>>(deviceId, name);
+                else
+                    transfer = New<DeviceTransferNode<half>>(deviceId, name);
+                AddNodeToNetAndAttachInputs(transfer, { input });
+            }
+            node->SetInput(i, transfer);
+        }
+    }
+
+    if (TraceLevel() > 0)
+    {
+        std::vector<size_t> numNodes(numStages, 0);
+        for (const auto& node : nodes)
+            numNodes[stages.at(node)]++;
+        for (size_t stage = 0; stage < numStages; stage++)
+            fprintf(stderr, "PlacePipelineStages: stage %d has %d nodes on device %d.\n", (int)stage, (int)numNodes[stage], (int)stageDevices[stage]);
+        fprintf(stderr, "PlacePipelineStages: %d transfers between devices.\n", (int)transfers.size());
+    }
+
+    InvalidateCompiledNetwork();
+    CompileNetwork();
+}
+
 // this function will need to be called before actual validation and execution to
 // predetermine how to share matrices to reduce memory usage.
 // TODO: find a simple topological order and allocateEvalMatrices on that order directly
@@ -1089,6 +2165,11 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
 
     bool performingBackPropagation = (trainRootNode != nullptr);
 
+    // Fused nodes leave intermediate values undefined, which backprop may need. This must come before the value
+    // sharing is determined though.
+    FuseForwardProp(performingBackPropagation ? std::vector<ComputationNodeBasePtr>() : forwardPropRoots);
+    FuseElementwise(performingBackPropagation ? std::vector<ComputationNodeBasePtr>() : forwardPropRoots);
+
     // Create a composite Eval order with the specified nodes as roots
     // For each node determine parents and whether the output of the
     // node is needed during back propagation
@@ -1120,6 +2201,10 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
         }
     }
 
+    // decide which forward values to drop and recompute during backprop; this updates outputValueNeededDuringBackProp
+    if (performingBackPropagation)
+        PlanActivationRecomputation(trainRootNode, parentsMap, outputValueNeededDuringBackProp);
+
     // gradient reuse maps
     std::unordered_map<MatrixPool::AliasNodePtr, std::unordered_set<MatrixPool::AliasNodePtr>> gradientReuseChildrenMap;
     std::unordered_map<MatrixPool::AliasNodePtr, MatrixPool::AliasNodePtr> gradientReuseParentMap;
@@ -1165,6 +2250,7 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
             for (auto& loopNode : seqTraversalFlowControlNode->m_nestedNodes)
                 loopNode->SetOutputNeededDuringBackprop(outputValueNeededDuringBackProp[loopNode]);
 
+            m_matrixPool.SetRequestOwner(node.get());
             seqTraversalFlowControlNode->RequestMatricesBeforeForwardProp(m_matrixPool);
 
             for (auto& loopNode : seqTraversalFlowControlNode->m_nestedNodes)
@@ -1173,12 +2259,14 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
         else
         {
             node->SetOutputNeededDuringBackprop(outputValueNeededDuringBackProp[node]);
+            m_matrixPool.SetRequestOwner(node.get());
             node->RequestMatricesBeforeForwardProp(m_matrixPool);
             // we only release matrices for the children since the root node's information will be used
             // and should not be shared with others
             ReleaseMatricesAfterEvalForChildren(node, parentsMap);
         }
     });
+    m_matrixPool.SetRequestOwner(nullptr);
 
     if (trainRootNode != nullptr)
     {
@@ -1240,6 +2328,8 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
         // we need to call it here since we always compute gradients for children and root node is not children of other node
         trainRootNode->RequestMatricesBeforeBackprop(m_matrixPool);
 
+        auto trainNetwork = GetNestedNetwork(trainRootNode)->As<PARTraversalFlowControlNode>();
+
         for (auto iter = backPropNodes.rbegin(); iter != backPropNodes.rend(); iter++) // for gradient computation, traverse in reverse order
         {
             auto n = *iter;
@@ -1249,6 +2339,8 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
                 shared_ptr<SEQTraversalFlowControlNode> recInfo = FindInRecurrentLoops(m_allSEQNodes, n);
                 if (completedGradient.insert(recInfo).second)
                 {
+                    trainNetwork->RequestRecomputationBuffersForSegment(recInfo, m_matrixPool);
+
                     // SEQ mode: allocate all in loop first, then deallocate again
                     // TODO: next step: use PARTraversalFlowControlNode::AllocateGradientMatricesForInputs() and ReleaseMatricesAfterBackprop()...
                     // BUGBUG: naw, ^^ would not work! Wrong order! Need to rethink this. Need to make AllocateEvalMatrices() and AllocateGradientMatrices() the virtual functions.
@@ -1260,10 +2352,12 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
             else
             {
                 // PAR mode: we can allocate and immediately deallocate one by one
+                trainNetwork->RequestRecomputationBuffersForSegment(n, m_matrixPool);
                 n->AllocateGradientMatricesForInputs(m_matrixPool);
                 // Root node's information will be used and should not be shared with others, also it's small (1x1)
                 if ((n != trainRootNode) && n->NeedsGradient())
                     n->ReleaseMatricesAfterBackprop(m_matrixPool);
+                trainNetwork->ReleaseRecomputationBuffer(n, m_matrixPool);
             }
         }
     }
@@ -1271,6 +2365,9 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
     m_matrixPool.OptimizedMemoryAllocation(); 
     m_areMatricesAllocated = true;
 
+    // the plans for concurrent forward prop depend on which nodes share memory
+    m_forwardPropPlans.clear();
+
     // TO DO: At the time of AllocateAllMatrices we don't know the minibatch size. In theory one may allocate memory again once we start to receive
     // data from the reader (and the minibatch size is known). For some problems, minibatch size can change constantly, and there needs to be a 
     // tradeoff in deciding how frequent to run optimized memory allocation. For now, we do it only once at the very beginning for speed concerns. 
@@ -1283,16 +2380,141 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
         PrintMemorySharingStructure(GetAllNodes());
 }
 
+// Activation recomputation ("gradient checkpointing")
+// The PAR-traversed nodes of the training criterion are cut into segments. Within a segment, only the values of the
+// checkpoint nodes are kept for backprop as usual. The others are handed back to the pool as soon as forward prop no
+// longer needs them, and are recomputed when backprop enters the segment, into buffers that only live until the node
+// itself has been backpropagated. With a checkpoint every sqrt(N) of the N candidate nodes, about 2 sqrt(N) values are
+// held during backprop instead of N, at the cost of roughly one extra forward pass.
+// Nodes may also be selected one by one through SetRecomputeDuringBackprop(); then segments end at the next kept node.
+// Recurrent loops and nodes that cannot be recomputed (see IsForwardPropRecomputable()) are always kept.
+void ComputationNetwork::PlanActivationRecomputation(const ComputationNodeBasePtr& trainRootNode,
+                                                     const std::unordered_map<ComputationNodeBasePtr, std::unordered_set<ComputationNodeBasePtr>>& parentsMap,
+                                                     std::unordered_map<ComputationNodeBasePtr, bool>& outputValueNeededDuringBackProp)
+{
+    auto trainNetwork = GetNestedNetwork(trainRootNode)->As<PARTraversalFlowControlNode>();
+    trainNetwork->SetRecomputationPlan(PARTraversalFlowControlNode::RecomputationPlan());
+    if (!Globals::ShouldEnableShareNodeValueMatrices()) // without value sharing, nothing is given back after forward prop
+        return;
+
+    const bool automatic = Globals::ShouldRecomputeActivations();
+    const auto& nestedNodes = trainNetwork->GetNestedNodes();
+
+    // position of each node in the PAR traversal; all nodes of a recurrent loop share the position of the loop
+    std::unordered_map<ComputationNodeBasePtr, size_t> positions;
+    for (size_t i = 0; i < nestedNodes.size(); i++)
+    {
+        positions[nestedNodes[i]] = i;
+        if (nestedNodes[i]->Is<SEQTraversalFlowControlNode>())
+        {
+            for (auto& loopNode : nestedNodes[i]->As<SEQTraversalFlowControlNode>()->m_nestedNodes)
+                positions[loopNode] = i;
+        }
+    }
+
+    // candidates are nodes whose value is kept for backprop and could be recomputed instead
+    auto isCandidate = [&](const ComputationNodeBasePtr& node)
+    {
+        auto needed = outputValueNeededDuringBackProp.find(node);
+        return !node->Is<SEQTraversalFlowControlNode>() && node != trainRootNode &&
+               needed != outputValueNeededDuringBackProp.end() && needed->second &&
+               node->IsValueSharable() && !node->IsValueSparse() && node->IsForwardPropRecomputable();
+    };
+    const size_t numCandidates = std::count_if(nestedNodes.begin(), nestedNodes.end(), isCandidate);
+    if (numCandidates == 0)
+        return;
+    const size_t checkpointInterval = (size_t)ceil(sqrt((double)numCandidates));
+
+    // assign segments; a segment ends with a kept candidate (its checkpoint)
+    std::vector<size_t> segmentOf(nestedNodes.size());
+    std::vector<bool> dropped(nestedNodes.size(), false);
+    size_t segment = 0;
+    size_t candidatesInSegment = 0;
+    for (size_t i = 0; i < nestedNodes.size(); i++)
+    {
+        segmentOf[i] = segment;
+        if (!isCandidate(nestedNodes[i]))
+            continue;
+        dropped[i] = (automatic && ++candidatesInSegment < checkpointInterval) || nestedNodes[i]->IsRecomputeDuringBackpropRequested();
+        if (!dropped[i])
+        {
+            segment++;
+            candidatesInSegment = 0;
+        }
+    }
+
+    // A recomputed value is only available while backprop is inside its segment, hence all consumers must be there, too.
+    for (size_t i = 0; i < nestedNodes.size(); i++)
+    {
+        if (!dropped[i])
+            continue;
+        auto parents = parentsMap.find(nestedNodes[i]);
+        if (parents == parentsMap.end())
+            dropped[i] = false;
+        else
+        {
+            for (const auto& parent : parents->second)
+            {
+                auto position = positions.find(parent); // parents outside the criterion's graph read the value after forward prop
+                if (position == positions.end() || segmentOf[position->second] != segmentOf[i])
+                    dropped[i] = false;
+            }
+        }
+    }
+
+    // Create the plan. Values of the inputs that the recomputation reads from outside the dropped set must now be kept.
+    PARTraversalFlowControlNode::RecomputationPlan plan;
+    std::unordered_set<ComputationNodeBasePtr> droppedNodes;
+    for (size_t i = 0; i < nestedNodes.size(); i++)
+    {
+        if (dropped[i])
+            droppedNodes.insert(nestedNodes[i]);
+    }
+    for (size_t i = 0; i < nestedNodes.size(); i++)
+    {
+        if (!dropped[i])
+            continue;
+        const auto& node = nestedNodes[i];
+        size_t segmentEnd = i;
+        while (segmentEnd + 1 < nestedNodes.size() && segmentOf[segmentEnd + 1] == segmentOf[i])
+            segmentEnd++;
+        plan[nestedNodes[segmentEnd]].push_back(node);
+
+        outputValueNeededDuringBackProp[node] = false;
+        for (const auto& input : node->GetInputs())
+        {
+            if (droppedNodes.find(input) == droppedNodes.end())
+                outputValueNeededDuringBackProp[input] = true;
+        }
+    }
+    trainNetwork->SetRecomputationPlan(plan);
+
+    if (TraceLevel() > 0)
+        fprintf(stderr, "\nActivation recomputation: %d of %d node values are recomputed during backprop, in %d segments.\n",
+                (int)droppedNodes.size(), (int)numCandidates, (int)plan.size());
+}
+
 void ComputationNetwork::ReleaseMatricesAfterEvalForChildren(ComputationNodeBasePtr n, std::unordered_map<ComputationNodeBasePtr, std::unordered_set<ComputationNodeBasePtr>>& parentsMap)
 {
-    for (int i = 0; i < n->GetNumInputs(); i++)
+    // The nodes of a fused elementwise tree are computed by its root, so their inputs are in use until then.
+    if (n->IsElementwiseFused())
+        return;
+    std::vector<ComputationNodeBasePtr> consumers;
+    if (const auto& fusion = n->GetElementwiseFusion())
+        consumers = fusion->GetFusedNodes();
+    consumers.push_back(n);
+
+    for (const auto& consumer : consumers)
     {
-        ComputationNodeBasePtr pNode = n->GetInputs()[i];
-        if (!parentsMap[pNode].empty())
+        for (int i = 0; i < consumer->GetNumInputs(); i++)
         {
-            parentsMap[pNode].erase(n);
-            if (parentsMap[pNode].empty())
-                pNode->ReleaseMatricesAfterForwardProp(m_matrixPool);
+            ComputationNodeBasePtr pNode = consumer->GetInputs()[i];
+            if (!parentsMap[pNode].empty())
+            {
+                parentsMap[pNode].erase(consumer);
+                if (parentsMap[pNode].empty())
+                    pNode->ReleaseMatricesAfterForwardProp(m_matrixPool);
+            }
         }
     }
 }
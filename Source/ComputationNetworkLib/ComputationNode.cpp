@@ -9,6 +9,7 @@
 #include "InputAndParamNodes.h"
 #include "ComputationNetworkBuilder.h" // TODO: We should only pull in NewComputationNodeFromConfig(). Nodes should not know about network at large.
 #include "TensorShape.h"
+#include <cstdarg>
 
 #ifndef  CNTK_UWP
 #include "PerformanceProfiler.h"
@@ -281,6 +282,49 @@ template<class ElemType>
     broadcastTo.DoGatherColumnsOf(beta, *gatherIdxMatrix, dataToBroadcast, 1);
 }
 
+// Computes the DoGatherColumnsOf() indices that convert between the packed columns of 'layout' and the unpacked ones,
+// which hold the time steps of each sequence in consecutive columns, padded to the longest sequence, i.e. the
+// order of Unpack() with batchMajor=false. With 'toPacked', the indices are for gathering into the packed columns,
+// otherwise for gathering into the unpacked ones. Target columns that have no source (gaps resp. padding) get index -1,
+// and 'hasUnmappedColumns' tells whether there are any.
+// Returns true if the two orders are the same, so that the data can be used as it is, without any gather.
+template <class ElemType>
+/*static*/ bool ComputationNode<ElemType>::GetUnpackingColumnIndices(const MBLayoutPtr& layout, bool toPacked, std::vector<ElemType>& columnIndices, bool& hasUnmappedColumns)
+{
+    size_t maxNumTimeSteps = layout->GetNumTimeSteps();
+    size_t numParallelSequences = layout->GetNumParallelSequences();
+    size_t numPackedColumns = layout->GetNumCols();
+    size_t numUnpackedColumns = layout->GetNumSequences() * maxNumTimeSteps;
+
+    columnIndices.assign(toPacked ? numPackedColumns : numUnpackedColumns, (ElemType)-1);
+    size_t numMapped = 0;
+    bool isIdentity = (numPackedColumns == numUnpackedColumns);
+    size_t i = 0;
+    for (const auto& sequenceInfo : layout->GetAllSequences())
+    {
+        if (sequenceInfo.seqId == GAP_SEQUENCE_ID)
+            continue;
+
+        size_t sequenceBegin = (size_t)std::max<ptrdiff_t>(0, sequenceInfo.tBegin);
+        size_t sequenceEnd   = std::min(maxNumTimeSteps, sequenceInfo.tEnd);
+        for (size_t t = 0; t < sequenceEnd - sequenceBegin; t++)
+        {
+            size_t packedIdx   = (sequenceBegin + t) * numParallelSequences + sequenceInfo.s;
+            size_t unpackedIdx = (i * maxNumTimeSteps) + t;
+            if (toPacked)
+                columnIndices[packedIdx] = (ElemType)unpackedIdx;
+            else
+                columnIndices[unpackedIdx] = (ElemType)packedIdx;
+            isIdentity = isIdentity && (packedIdx == unpackedIdx);
+            numMapped++;
+        }
+        i++;
+    }
+
+    hasUnmappedColumns = (numMapped != columnIndices.size());
+    return isIdentity && !hasUnmappedColumns;
+}
+
 /*static*/ const std::wstring ComputationNodeBase::DefaultDynamicAxisName = L"*";
 /*static*/ const std::wstring ComputationNodeBase::DefaultNoSequenceAxisName = L"__noSequenceAxis";
 
@@ -786,6 +830,15 @@ template <class ElemType>
     auto& timing = m_timing[phase];
     timing.beginTime = std::chrono::system_clock::now();
     timing.count++;
+
+    // On a GPU, the wall-clock time is mostly the time to launch the kernels, so the GPU time is measured as well.
+    timing.gpuTiming = m_value && m_value->GetDeviceId() >= 0;
+    if (timing.gpuTiming)
+    {
+        if (!timing.gpuTimer || timing.gpuTimer->GetDeviceId() != m_value->GetDeviceId())
+            timing.gpuTimer = make_shared<GPUEventTimer>(m_value->GetDeviceId());
+        timing.gpuTimer->Start();
+    }
 #ifndef  CNTK_UWP
     timing.profilerId = ProfilerTimeBegin();
 #endif
@@ -799,6 +852,9 @@ template <class ElemType>
     int phase = (backward ? (int)TimingPhase_Backward : (int)TimingPhase_Forward);
     auto& timing = m_timing[phase];
     timing.duration += (std::chrono::system_clock::now() - timing.beginTime);
+    if (timing.gpuTiming)
+        timing.gpuTimer->Stop();
+    timing.gpuTiming = false;
 
 #ifndef  CNTK_UWP
     // the order must match enum
@@ -818,22 +874,36 @@ template <class ElemType>
 #endif
 }
 
-template<class ElemType>
-void ComputationNode<ElemType>::PrintForwardBackwardTime()
+template <class ElemType>
+/*virtual*/ bool ComputationNode<ElemType>::GetTimingStatistics(NodeTimingStatistics& statistics) const
 {
-    if (GetInputs().size() == 0) return;
-
-    auto& forwardCount = m_timing[TimingPhase_Forward].count;
-    auto forwardDuration = m_timing[TimingPhase_Forward].duration.count();
-    auto& backwardCount = m_timing[TimingPhase_Backward].count;
-    auto backwardDuration = m_timing[TimingPhase_Backward].duration.count();
-    fprintf(stderr, "%-30S forward avg %07fs, backward avg %07fs (fwd# %d|bwd# %d)\n",
-        m_nodeName.c_str(),
-        forwardCount == 0 ? 0 : forwardDuration / forwardCount,
-        backwardCount == 0 ? 0 : backwardDuration / backwardCount,
-        forwardCount,
-        backwardCount);
+    const auto& forward = m_timing[TimingPhase_Forward];
+    const auto& backward = m_timing[TimingPhase_Backward];
+    if (forward.count == 0 && backward.count == 0)
+        return false;
+
+    statistics = NodeTimingStatistics();
+    statistics.forwardCount = forward.count;
+    statistics.backwardCount = backward.count;
+    statistics.onGPU = forward.gpuTimer || backward.gpuTimer;
+    statistics.forwardSeconds = forward.gpuTimer ? forward.gpuTimer->ElapsedSeconds() : forward.duration.count();
+    statistics.backwardSeconds = backward.gpuTimer ? backward.gpuTimer->ElapsedSeconds() : backward.duration.count();
+    if (m_value)
+    {
+        statistics.value = m_value.get();
+        statistics.valueBytes = m_value->BufferSize();
+    }
+    if (m_gradient)
+    {
+        statistics.gradient = m_gradient.get();
+        statistics.gradientBytes = m_gradient->BufferSize();
+    }
+    return true;
+}
 
+template <class ElemType>
+/*virtual*/ void ComputationNode<ElemType>::ResetTiming()
+{
     for (auto& timing : m_timing)
         timing.Reset();
 }
@@ -859,6 +929,30 @@ template <class ElemType>
     }
 }
 
+// like sprintf() but appends to 'buffer'
+static void AppendFormatted(string& buffer, const char* format, ...)
+{
+    char local[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(local, sizeof(local), format, args);
+    va_end(args);
+    if (length < 0)
+        LogicError("AppendFormatted: Invalid format string '%s'.", format);
+    if (length < (int)sizeof(local))
+    {
+        buffer.append(local, length);
+        return;
+    }
+
+    auto offset = buffer.size();
+    buffer.resize(offset + length + 1);
+    va_start(args, format);
+    vsnprintf(&buffer[offset], length + 1, format, args);
+    va_end(args);
+    buffer.resize(offset + length);
+}
+
 // write out the content of a node in formatted/readable form
 // 'transpose' means print one row per sample (non-transposed is one column per sample).
 // 'isSparse' will print all non-zero values as one row (non-transposed, which makes sense for one-hot) or column (transposed).
@@ -907,9 +1001,37 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f,
     bool sequencePrologueHasSeqKey = sequencePrologue.find("%k") != sequencePrologue.npos;
     bool sampleSeparatorHasSeqKey = sampleSeparator.find("%k") != sampleSeparator.npos;
 
-    for (size_t s = 0; s < sequences.size(); s++)
+    // output it according to our format specification
+    auto formatChar = valueFormatString.back();
+    if (isCategoryLabel && formatChar == 's') // verify label dimension
+    {
+        if (outputValues.GetNumRows() != labelMapping.size() &&
+            sampleLayout[0] != labelMapping.size()) // if we match the first dim then use that
+        {
+            static size_t warnings = 0;
+            if (warnings++ < 5)
+                fprintf(stderr, "write: Row dimension %d does not match number of entries %d in labelMappingFile, not using mapping\n", (int)matRows, (int)labelMapping.size());
+            valueFormatString.back() = 'u'; // this is a fallback
+            formatChar = valueFormatString.back();
+        }
+    }
+
+    // The sequences are formatted in parallel, each into a buffer of its own, and the buffers are written in order.
+    // The keys are looked up beforehand, since the lookup of the reader is not meant to be called concurrently.
+    vector<string> keys(sequences.size());
+    if (getKeyById && (sequencePrologueHasSeqKey || sampleSeparatorHasSeqKey))
+    {
+        for (size_t s = 0; s < sequences.size(); s++)
+            if (sequences[s].seqId != GAP_SEQUENCE_ID)
+                keys[s] = getKeyById(sequences[s].seqId);
+    }
+    vector<string> formattedSequences(sequences.size());
+
+#pragma omp parallel for schedule(dynamic) if (sequences.size() > 1)
+    for (int s = 0; s < (int)sequences.size(); s++)
     {
         const auto& seqInfo = sequences[s];
+        auto& out = formattedSequences[s];
         if (seqInfo.seqId == GAP_SEQUENCE_ID) // nothing in gaps to print
             continue;
         let tBegin = seqInfo.tBegin >= 0     ? seqInfo.tBegin : 0;
@@ -958,32 +1080,18 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f,
         if (getKeyById)
         {
             if (sequencePrologueHasSeqKey)
-                seqProl = msra::strfun::ReplaceAll<std::string>(seqProl, "%k", getKeyById(seqInfo.seqId));
+                seqProl = msra::strfun::ReplaceAll<std::string>(seqProl, "%k", keys[s]);
             if (sampleSeparatorHasSeqKey)
-                sampleSep = msra::strfun::ReplaceAll<std::string>(sampleSep, "%k", getKeyById(seqInfo.seqId));
+                sampleSep = msra::strfun::ReplaceAll<std::string>(sampleSep, "%k", keys[s]);
         }
 
         if (s > 0)
-            fprintfOrDie(f, "%s", sequenceSeparator.c_str());
+            AppendFormatted(out, "%s", sequenceSeparator.c_str());
 
-        fprintfOrDie(f, "%s", seqProl.c_str());
+        AppendFormatted(out, "%s", seqProl.c_str());
 
-        // output it according to our format specification
-        auto formatChar = valueFormatString.back();
         if (isCategoryLabel) // if is category then find the max value and output its index (possibly mapped to a string)
         {
-            if (formatChar == 's') // verify label dimension
-            {
-                if (outputValues.GetNumRows() != labelMapping.size() &&
-                    sampleLayout[0] != labelMapping.size()) // if we match the first dim then use that
-                {
-                    static size_t warnings = 0;
-                    if (warnings++ < 5)
-                        fprintf(stderr, "write: Row dimension %d does not match number of entries %d in labelMappingFile, not using mapping\n", (int)seqRows, (int)labelMapping.size());
-                    valueFormatString.back() = 'u'; // this is a fallback
-                    formatChar = valueFormatString.back();
-                }
-            }
             // update the matrix in-place from one-hot (or max) to index
             // find the max in each column
             for (size_t j = 0; j < seqCols; j++) // loop over all time steps of the sequence
@@ -1009,11 +1117,11 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f,
             if (formatChar == 'f') // print as real number
             {
                 if (dval == 0) dval = fabs(dval);    // clear the sign of a negative 0, which are produced inconsistently between CPU and GPU
-                fprintfOrDie(f, valueFormatString.c_str(), dval);
+                AppendFormatted(out, valueFormatString.c_str(), dval);
             }
             else if (formatChar == 'u') // print category as integer index
             {
-                fprintfOrDie(f, valueFormatString.c_str(), (unsigned int)dval);
+                AppendFormatted(out, valueFormatString.c_str(), (unsigned int)dval);
             }
             else if (formatChar == 's') // print category as a label string
             {
@@ -1022,7 +1130,7 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f,
                     uval %= labelMapping.size();
                 assert(uval < labelMapping.size());
                 const char * sval = labelMapping[uval].c_str();
-                fprintfOrDie(f, valueFormatString.c_str(), sval);
+                AppendFormatted(out, valueFormatString.c_str(), sval);
             }
         };
         // bounds for printing
@@ -1045,21 +1153,21 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f,
                     if (dval == 0) // only print non-0 values
                         continue;
                     if (numPrinted++ > 0)
-                        fprintfOrDie(f, "%s", transpose ? sampleSeparator.c_str() : elementSeparator.c_str());
+                        AppendFormatted(out, "%s", transpose ? sampleSeparator.c_str() : elementSeparator.c_str());
                     if (dval != 1.0 || formatChar != 'f') // hack: we assume that we are either one-hot or never precisely hitting 1.0
                         print(dval);
                     size_t row = transpose ? i : j;
                     size_t col = transpose ? j : i;
                     for (size_t k = 0; k < sampleLayout.size(); k++)
                     {
-                        fprintfOrDie(f, "%c%d", k == 0 ? '[' : ',', row % sampleLayout[k]);
+                        AppendFormatted(out, "%c%d", k == 0 ? '[' : ',', row % sampleLayout[k]);
                         if (sampleLayout[k] == labelMapping.size()) // annotate index with label if dimensions match (which may misfire once in a while)
-                            fprintfOrDie(f, "=%s", labelMapping[row % sampleLayout[k]].c_str());
+                            AppendFormatted(out, "=%s", labelMapping[row % sampleLayout[k]].c_str());
                         row /= sampleLayout[k];
                     }
                     if (seqInfo.GetNumTimeSteps() > 1)
-                        fprintfOrDie(f, ";%d", col);
-                    fprintfOrDie(f, "]");
+                        AppendFormatted(out, ";%d", col);
+                    AppendFormatted(out, "]");
                 }
             }
         }
@@ -1080,34 +1188,34 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f,
                     }
                     absSum += absSumLocal;
                 }
-                fprintfOrDie(f, "absSum: %f", absSum);
+                AppendFormatted(out, "absSum: %f", absSum);
             }
             else
             {
                 for (size_t j = 0; j < jend; j++) // loop over output rows     --BUGBUG: row index is 'i'!! Rename these!!
                 {
                     if (j > 0)
-                        fprintfOrDie(f, "%s", sampleSep.c_str());
+                        AppendFormatted(out, "%s", sampleSep.c_str());
                     if (j == jstop && jstop < jend - 1) // if jstop == jend-1 we may as well just print the value instead of '...'
                     {
-                        fprintfOrDie(f, "...+%d", (int)(jend - jstop)); // 'nuff said
+                        AppendFormatted(out, "...+%d", (int)(jend - jstop)); // 'nuff said
                         break;
                     }
                     // inject sample tensor index if we are printing row-wise and it's a tensor
                     if (!transpose && sampleLayout.size() > 1 && !isCategoryLabel) // each row is a different sample dimension
                     {
                         for (size_t k = 0; k < sampleLayout.size(); k++)
-                            fprintfOrDie(f, "%c%d", k == 0 ? '[' : ',', (int)((j / sampleLayout.GetStrides()[k])) % sampleLayout[k]);
-                        fprintfOrDie(f, "]\t");
+                            AppendFormatted(out, "%c%d", k == 0 ? '[' : ',', (int)((j / sampleLayout.GetStrides()[k])) % sampleLayout[k]);
+                        AppendFormatted(out, "]\t");
                     }
                     // print a row of values
                     for (size_t i = 0; i < iend; i++) // loop over elements
                     {
                         if (i > 0)
-                            fprintfOrDie(f, "%s", elementSeparator.c_str());
+                            AppendFormatted(out, "%s", elementSeparator.c_str());
                         if (i == istop && istop < iend - 1)
                         {
-                            fprintfOrDie(f, "...+%d", (int)(iend - istop));
+                            AppendFormatted(out, "...+%d", (int)(iend - istop));
                             break;
                         }
                         double dval = seqData[i * istride + j * jstride];
@@ -1116,8 +1224,14 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f,
                 }
             }
         }
-        fprintfOrDie(f, "%s", sequenceEpilogue.c_str());
+        AppendFormatted(out, "%s", sequenceEpilogue.c_str());
     } // end loop over sequences
+
+    for (const auto& out : formattedSequences)
+    {
+        if (!out.empty())
+            fwriteOrDie(out.data(), sizeof(char), out.size(), f);
+    }
     fflushOrDie(f);
 }
 
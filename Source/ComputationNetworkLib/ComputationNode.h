@@ -11,6 +11,7 @@
 #include "Sequences.h"
 #include "TensorShape.h"
 #include "MatrixPool.h"
+#include "GPUEventTimer.h"
 #include "ComputationEnvironment.h"
 #include "Globals.h"
 
@@ -62,7 +63,8 @@
 #define CNTK_MODEL_VERSION_29 29 // Expose StopGradient in BS
 #define CNTK_MODEL_VERSION_30 30 // LatticeWithSequenceSoftmax node
 #define CNTK_MODEL_VERSION_31 31 // Cast node
-#define CURRENT_CNTK_MODEL_VERSION CNTK_MODEL_VERSION_31
+#define CNTK_MODEL_VERSION_32 32 // ReLU fused into BatchNormalization node
+#define CURRENT_CNTK_MODEL_VERSION CNTK_MODEL_VERSION_32
 
 // helper mode for debugging
 // If TRACK_GAP_NANS is defined then initialize layout gaps to NaN and do NaN checks. Also do detailed logging of node computations.
@@ -162,6 +164,13 @@ struct /*interface*/ IStatefulNode
     typedef std::shared_ptr<INodeState> NodeStatePtr;
     virtual NodeStatePtr ExportState() = 0;
     virtual void ImportState(const NodeStatePtr& state) = 0;
+
+    // For streaming evaluation, where each sequence of a minibatch continues a stream of its own:
+    // ImportSequenceStates() prepares the next minibatch, whose parallel sequence s continues the stream that left
+    // states[s] behind (null if it begins a new one), and ExportSequenceState() returns the state that sequence 'seqId'
+    // of the last minibatch leaves behind, given the state its stream had before ('previous', null for a new stream).
+    virtual void ImportSequenceStates(const std::vector<NodeStatePtr>& states) = 0;
+    virtual NodeStatePtr ExportSequenceState(UniqueSequenceId seqId, const NodeStatePtr& previous) = 0;
 };
 typedef IStatefulNode::NodeStatePtr NodeStatePtr;
 
@@ -179,6 +188,66 @@ enum class ParentGradientOptimization
 
 class ComputationNetwork;
 class ComputationNodeBase;
+
+// =======================================================================
+// IForwardPropFusable -- interface implemented by ComputationNodes that can compute the nodes consuming their
+// output along with their own forward prop, e.g. a convolution followed by a bias and a ReLU
+// =======================================================================
+
+struct IForwardPropFusable
+{
+    // Offers a chain of consumers (the first one is the only consumer of this node, each further one the only
+    // consumer of the previous one). Returns the number of leading ones this node will compute from now on: its
+    // ForwardProp() then writes the value of the last of them, whose own ForwardProp() is skipped like that of the
+    // others, and leaves the values of this node and the others undefined. An empty chain undoes the fusion.
+    // See ComputationNetwork::FuseForwardProp().
+    virtual size_t FuseForwardProp(const std::vector<std::shared_ptr<ComputationNodeBase>>& consumers) = 0;
+
+    // whether the last ForwardProp() has computed the fused nodes (it may not, e.g. in training mode)
+    virtual bool HasComputedFusedNodes() const = 0;
+};
+
+// =======================================================================
+// IElementwiseNode -- interface implemented by ComputationNodes whose forward prop applies a single
+// ElementWiseOperator to their inputs (with broadcasting), e.g. Plus or Sigmoid
+// =======================================================================
+
+struct IElementwiseNode
+{
+    virtual ElementWiseOperator GetElementwiseOperator() const = 0;
+};
+
+// =======================================================================
+// IElementwiseFusion -- the forward prop of a tree of elementwise nodes in a single pass over the elements, which
+// the root of the tree performs instead of its own. The other nodes of the tree are skipped and their values are
+// never allocated. See ComputationNetwork::FuseElementwise().
+// =======================================================================
+
+struct IElementwiseFusion
+{
+    virtual ~IElementwiseFusion() {}
+
+    // computes the value of the root (falls back to computing the nodes one by one if the inputs are not suitable)
+    virtual void ForwardProp(const FrameRange& fr) = 0;
+
+    // the nodes of the tree other than the root, each after its inputs
+    virtual const std::vector<std::shared_ptr<ComputationNodeBase>>& GetFusedNodes() const = 0;
+};
+
+// what a node accumulates while Globals::ShouldEnableNodeTiming(), see ComputationNetwork::PrintNodeTiming()
+struct NodeTimingStatistics
+{
+    int forwardCount = 0;
+    int backwardCount = 0;
+    double forwardSeconds = 0; // GPU time for nodes on a GPU, wall-clock time otherwise
+    double backwardSeconds = 0;
+    bool onGPU = false;
+    size_t valueBytes = 0;
+    size_t gradientBytes = 0;
+    const void* value = nullptr; // the matrices, to find the nodes that share them through the MatrixPool
+    const void* gradient = nullptr;
+};
+
 struct ComputationNetworkOwnedNodeState
 {
     friend class ComputationNetwork;
@@ -213,6 +282,17 @@ struct ComputationNetworkOwnedNodeState
     virtual void MarkValueSharable() { m_valueSharable = true; }
     bool IsValueSharable() const { return m_valueSharable; }
 
+    // the node that computes this node's value as part of its own forward prop, if any; see IForwardPropFusable
+    void SetForwardPropFusedInto(IForwardPropFusable* node) { m_forwardPropFusedInto = node; }
+    IForwardPropFusable* GetForwardPropFusedInto() const { return m_forwardPropFusedInto; }
+
+    // the fused forward prop of the elementwise tree rooted at this node, if any, or whether this node is computed by
+    // the root of such a tree; see IElementwiseFusion
+    void SetElementwiseFusion(const std::shared_ptr<IElementwiseFusion>& fusion) { m_elementwiseFusion = fusion; }
+    const std::shared_ptr<IElementwiseFusion>& GetElementwiseFusion() const { return m_elementwiseFusion; }
+    void SetElementwiseFused(bool fused) { m_elementwiseFused = fused; }
+    bool IsElementwiseFused() const { return m_elementwiseFused; }
+
     // tracing flags
     // Enable to print the value of the function-value matrix in somewhat readable format.
     // These are public since you are meant to set these flags manually in the debugger or temporarily poke into them from code as needed.
@@ -235,6 +315,11 @@ protected:                // TODO: should be fully encapsulated here
 
     ParentGradientOptimization m_parentGradientOptimization; // flag indicating whether the parent of this node overwrites the gradient of this node instead of accumulating to it
 
+    IForwardPropFusable* m_forwardPropFusedInto = nullptr; // not owned; an input (or input of an input...) of this node
+
+    std::shared_ptr<IElementwiseFusion> m_elementwiseFusion; // only at the root of a fused tree
+    bool m_elementwiseFused = false;                         // at the other nodes of the tree
+
 private:
     bool m_isPartOfLoop; // true if this loop is part of a recurrent loop
 
@@ -314,7 +399,7 @@ public:
     // -----------------------------------------------------------------------
 
     ComputationNodeBase(DEVICEID_TYPE deviceId, const wstring& name) :
-        m_deviceId(deviceId), m_outputNeededDuringBackprop(true), m_learningRateMultiplier(0),
+        m_deviceId(deviceId), m_outputNeededDuringBackprop(true), m_recomputeDuringBackprop(false), m_pipelineStage(-1), m_learningRateMultiplier(0),
         m_gradientInitializedBy(nullptr),
         m_nodeName(name == L"" ? CreateUniqNodeName() : name), m_isValueSparse(false)
     {
@@ -339,6 +424,8 @@ public:
         {
             node->m_deviceId = m_deviceId;
             node->m_learningRateMultiplier = m_learningRateMultiplier;
+            node->m_recomputeDuringBackprop = m_recomputeDuringBackprop;
+            node->m_pipelineStage = m_pipelineStage;
             node->m_nodeName = newName;
 
             node->m_sampleLayout = m_sampleLayout;
@@ -675,6 +762,10 @@ public:
     virtual double Get00Element() const = 0;
     virtual MatrixBasePtr ValuePtr() const = 0; // for use in readers that pass the agnostic object around
 
+    // node timing, see BeginTiming(); false for nodes that are not timed
+    virtual bool GetTimingStatistics(NodeTimingStatistics&) const { return false; }
+    virtual void ResetTiming() {}
+
     // TODO: two sets of functions, choose one
     const std::wstring& NodeName() const { return m_nodeName; }
     std::wstring GetName() const { return m_nodeName; }
@@ -693,6 +784,10 @@ public:
 
     virtual bool ForceDynamicValidation() const { return false; }
 
+    // true if the values of the inputs and the output of this node may be held on to outside of the network, e.g. by a user-defined Function,
+    // so that they cannot be shared with other nodes
+    virtual bool HoldsValuesExternally() const { return false; }
+
     void SetLearningRateMultiplier(float f) 
     { 
         if (f < 0)
@@ -817,6 +912,13 @@ public:
         }
     }
 
+    // mark the gradient as initialized, so that the next backprop adds to it instead of zeroing or overwriting it
+    // This accumulates the gradients of parameters across minibatches. It must not be shared with the parent's (ParentGradientReused()).
+    void /*ComputationNodeBase::*/ KeepGradient()
+    {
+        m_gradientInitializedBy = this;
+    }
+
     // -----------------------------------------------------------------------
     // masking
     // -----------------------------------------------------------------------
@@ -847,6 +949,34 @@ public:
         return !Globals::ShouldEnableShareNodeValueMatrices() || m_outputNeededDuringBackprop; 
     }
 
+    // Activation recomputation (gradient checkpointing): rather than keeping the output value from forward prop
+    // until backprop, it is handed back to the pool after forward prop and recomputed right before backprop needs it.
+    // This is only correct if ForwardProp() can be run a second time with identical results and no side effects,
+    // which excludes nodes that draw random numbers, update state such as running statistics, or return forward-only
+    // temporaries to the pool after forward prop. Such nodes must override this to return false.
+    virtual bool IsForwardPropRecomputable() const
+    {
+        return !IsLeaf() && !RequiresPreCompute() && !dynamic_cast<const IStatefulNode*>(this);
+    }
+
+    // explicit per-node request; honored for qualifying nodes even if Globals::ShouldRecomputeActivations() is off
+    void SetRecomputeDuringBackprop(bool f) { m_recomputeDuringBackprop = f; }
+    bool IsRecomputeDuringBackpropRequested() const { return m_recomputeDuringBackprop; }
+
+    // Pipeline parallelism: the stage the node is assigned to, see ComputationNetwork::PlacePipelineStages(); -1 if not annotated
+    void SetPipelineStage(int stage) { m_pipelineStage = stage; }
+    int GetPipelineStage() const { return m_pipelineStage; }
+
+    // Places the node on another device, before the network's matrices are allocated. Matrices that already exist move
+    // along. Nodes that hold objects for their device, such as convolution engines, release them to recreate them on
+    // the next validation.
+    virtual void MoveToDevice(DEVICEID_TYPE deviceId) { m_deviceId = deviceId; }
+
+    // the buffer that holds the recomputed value during backprop; implemented by ComputationNode<ElemType>
+    virtual void RequestMatricesBeforeRecomputation(MatrixPool& matrixPool) {}
+    virtual void ReleaseMatricesAfterRecomputation(MatrixPool& matrixPool) {}
+    virtual void SwapRecomputedValue() {} // exchanges Value() with the recomputation buffer
+
     // -----------------------------------------------------------------------
     // helpers for network traversal
     // -----------------------------------------------------------------------
@@ -980,6 +1110,8 @@ protected:
     float m_learningRateMultiplier;    // update parameters? Only used for LearnableParameters.    --TODO: Should we make this a member of LearnableParameters actually? And require a type cast? Currently it is read out for all leaves.
     const ComputationNodeBase* m_gradientInitializedBy; // indicates which node initialized the gradient matrix
     bool m_outputNeededDuringBackprop; // indicates whether the output value of the node is needed during backprop
+    bool m_recomputeDuringBackprop;    // user asked to recompute the output value during backprop instead of keeping it
+    int m_pipelineStage;               // pipeline stage the user assigned the node to, or -1
 };
 typedef ComputationNodeBase::ComputationNodeBasePtr ComputationNodeBasePtr;
 
@@ -1395,7 +1527,8 @@ public:
         }
     }
 
-    void PrintForwardBackwardTime();
+    virtual bool /*ComputationNodeBase::*/ GetTimingStatistics(NodeTimingStatistics& statistics) const override;
+    virtual void /*ComputationNodeBase::*/ ResetTiming() override;
 
 protected:
 
@@ -1559,6 +1692,9 @@ public:
                                   const FrameRange& targetFrameRange,
                                   const std::shared_ptr<Matrix<ElemType>>& tempIndicesStorage);
 
+    // DoGatherColumnsOf() indices between the packed columns of 'layout' and their unpacked, sequence-major order (as Unpack() with batchMajor=false)
+    static bool GetUnpackingColumnIndices(const MBLayoutPtr& layout, bool toPacked, std::vector<ElemType>& columnIndices, bool& hasUnmappedColumns);
+
     // -----------------------------------------------------------------------
     // accessors for value and gradient
     // -----------------------------------------------------------------------
@@ -1840,6 +1976,8 @@ public:
         matrixInfo.insert(make_pair(ValuePtr().get(), NodeName() + L" : " + Microsoft::MSR::CNTK::ToFixedWStringFromMultiByte(ShapeDescription())));
         if (GradientPtr())
             matrixInfo.insert(make_pair(GradientPtr().get(), NodeName() + L" : " + Microsoft::MSR::CNTK::ToFixedWStringFromMultiByte(ShapeDescription()) + L" (gradient)"));
+        if (m_recomputedValue)
+            matrixInfo.insert(make_pair(m_recomputedValue.get(), NodeName() + L" : " + Microsoft::MSR::CNTK::ToFixedWStringFromMultiByte(ShapeDescription()) + L" (recomputed)"));
         return matrixInfo;
     }
 
@@ -1925,6 +2063,39 @@ public:
         }
     }
 
+    virtual bool IsForwardPropRecomputable() const override
+    {
+        return Base::IsForwardPropRecomputable() && !dynamic_cast<const MultiOutputNode<ElemType>*>(this); // only the first output would be recomputed
+    }
+
+    // The recomputed value lives in its own buffer, which is only held while the node's segment is being backpropagated.
+    // Value() keeps pointing to the forward-prop buffer, which has long been reused by other nodes at that point.
+    virtual void RequestMatricesBeforeRecomputation(MatrixPool& matrixPool) override
+    {
+        RequestMatrixFromPool(m_recomputedValue, matrixPool, m_sampleLayout.GetNumElements(), HasMBLayout());
+    }
+
+    virtual void ReleaseMatricesAfterRecomputation(MatrixPool& matrixPool) override
+    {
+        ReleaseMatrixToPool(m_recomputedValue, matrixPool);
+    }
+
+    virtual void SwapRecomputedValue() override
+    {
+        if (!m_recomputedValue)
+            LogicError("SwapRecomputedValue: %ls %ls operation has no recomputation buffer.", NodeName().c_str(), OperationName().c_str());
+        m_value.swap(m_recomputedValue);
+    }
+
+    virtual void MoveToDevice(DEVICEID_TYPE deviceId) override
+    {
+        Base::MoveToDevice(deviceId);
+        if (m_value)
+            m_value->TransferToDeviceIfNotThere(deviceId, /*isBeingMoved=*/true);
+        if (m_gradient)
+            m_gradient->TransferToDeviceIfNotThere(deviceId, /*isBeingMoved=*/true);
+    }
+
     void CreateValueMatrixIfNull()
     {
         CreateMatrixIfNull(m_value);
@@ -2170,6 +2341,7 @@ public:
 protected:
 
     shared_ptr<Matrix<ElemType>> m_value, m_gradient;
+    shared_ptr<Matrix<ElemType>> m_recomputedValue; // only allocated if the value is recomputed during backprop, see SwapRecomputedValue()
 
     static std::map<size_t, std::map<size_t, shared_ptr<Matrix<ElemType>>>> s_constOnes;
 
@@ -2189,11 +2361,15 @@ protected:
         std::chrono::duration<float> duration = std::chrono::duration<float>(0);
         long long profilerId;
         std::string profilerName;
+        std::shared_ptr<GPUEventTimer> gpuTimer; // for nodes on a GPU, created on first use
+        bool gpuTiming = false;                  // between BeginTiming() and EndTiming() of a node on a GPU
 
         void Reset()
         {
             duration = std::chrono::duration<float>(0);
             count = 0;
+            if (gpuTimer)
+                gpuTimer->Reset();
         }
     } m_timing[TimingPhase_Total];
 };
@@ -2362,6 +2538,11 @@ struct IPreComputeNode
     // call this with 'false' at start and with 'true' at end
     // This is used for resetting and updating from accumulators.
     virtual void MarkComputed(const bool hasComputed) = 0;
+    // Distributed precomputation: while accumulating, append the statistics accumulated so far as numbers
+    // whose sums over all workers are the statistics of all their data...
+    virtual void GetAccumulatedSums(std::vector<double>& sums) const = 0;
+    // ...and replace the accumulators by those sums, consuming the numbers appended by GetAccumulatedSums().
+    virtual void SetAccumulatedSums(const double*& sums) = 0;
 };
 
 // =======================================================================
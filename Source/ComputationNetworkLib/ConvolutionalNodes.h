@@ -9,6 +9,8 @@
 #include "Matrix.h"
 #include "ComputationNode.h"
 #include "ConvolutionEngine.h"
+#include "InputAndParamNodes.h"
+#include "TrainingNodes.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -44,7 +46,14 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 //     - for hidden layer: dimension of activation vector for each pixel
 //  - K = output channels = dimension of activation vector for each pixel (also called N by NVidia, inconsistently)
 //
-// For ND-convolution/pooling only second format ('cudnn') is supported.
+// ND-convolution/pooling supports the second format ('cudnn') and, on GPU with cuDNN, "HWC" as channels-last:
+//
+//     - input :   [C  x W  x H      x T]   (NHWC, same as the legacy mode)
+//     - output :  [K  x W' x H'     x T]
+//     - filter :  [C  x W" x H"  x K    ]  (KHWC; unlike the legacy mode, K is the outermost dimension)
+//
+// where the kernel shape and the reduction rank are still given in 'cudnn' order. Channels-last lets cuDNN use
+// its tensor core kernels, and a stack of such convolutions, poolings and batch normalizations needs no transposes.
 //
 template <class ElemType>
 class ConvolutionNodeBase : public ComputationNode<ElemType>
@@ -167,6 +176,7 @@ public:
     TensorShape UpperPad() const { return m_upperPad; }
     bool Transpose() const { return m_transpose; }
     TensorShape OutputShape() const { return m_outputShape; }
+    ImageLayoutKind ImageLayout() const { return m_imageLayout; }
     size_t MaxTempMemSizeInSamples() const { return m_maxTempMemSizeInSamples; }
     PoolKind PoolingKind() const { return m_poolKind; }
     bool CeilOutDim() const { return m_ceilOutDim; }
@@ -252,7 +262,21 @@ protected:
             Base::NeedsDynamicValidation(), isFinalValidationPass);
     }
 
+    virtual void MoveToDevice(DEVICEID_TYPE deviceId) override
+    {
+        Base::MoveToDevice(deviceId);
+        m_convEng.reset(); // recreated on the next validation or forward prop
+    }
+
 protected:
+    // Engines for the ND syntax. Its channels-last layout is not the one of the legacy engine.
+    ConvolutionEngineKind NDEngines() const
+    {
+        if (m_imageLayout == ImageLayoutKind::HWC)
+            return (ConvolutionEngineKind)((int)ConvolutionEngineKind::All & ~(int)ConvolutionEngineKind::Legacy);
+        return ConvolutionEngineKind::All;
+    }
+
     TensorShape m_kernelShape;
     TensorShape m_mapCount;
     TensorShape m_stride;
@@ -465,7 +489,7 @@ public:
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class ConvolutionNode : public ConvolutionNodeBaseExtended<ElemType>, public TransformerNode
+class ConvolutionNode : public ConvolutionNodeBaseExtended<ElemType>, public TransformerNode, public IForwardPropFusable
 {
     typedef ConvolutionNodeBaseExtended<ElemType> Base; UsingConvolutionBaseNodeMembers;
     static const std::wstring TypeName() { return L"Convolution"; }
@@ -508,7 +532,16 @@ public:
         Matrix<ElemType> sliceOutputValue = ValueFor(fr);
         const Matrix<ElemType>& input0 = InputRef(0).ValueAsMatrix();
         Matrix<ElemType> sliceInput1Value = InputRef(1).ValueFor(fr);
-        if (!m_transpose)
+        m_computedFusedNodes = false;
+        if (m_fusedOutput && fr.IsAllFrames() && !Environment().IsTraining())
+        {
+            // compute the fused nodes right into the value of the last one, see FuseForwardProp()
+            Matrix<ElemType>& fusedOutputValue = m_fusedOutput->Value();
+            fusedOutputValue.Resize(sliceOutputValue.GetNumRows(), sliceOutputValue.GetNumCols());
+            m_convEng->ForwardFused(sliceInput1Value, input0, fusedOutputValue, *m_tempMatrixForward, GetFusedEpilogue());
+            m_computedFusedNodes = true;
+        }
+        else if (!m_transpose)
             m_convEng->Forward(sliceInput1Value, input0, sliceOutputValue, *m_tempMatrixForward);
         else
         {
@@ -596,6 +629,9 @@ public:
         else
         {
             inputShape = GetInputSampleLayout(inputIdx);
+            // ConvolveGeometry uses CHW, the channels-last tensors are converted to and from it.
+            if (m_imageLayout == ImageLayoutKind::HWC)
+                inputShape = ImageDimensions(inputShape, ImageLayoutKind::HWC).AsTensorShape(ImageLayoutKind::CHW);
             // infer reduction dimensions if not given
             InferReductionDims(inputShape, inputShape);
             if (!m_transpose)
@@ -676,7 +712,7 @@ public:
                                                                    m_sharing, m_autoPad, m_lowerPad, m_upperPad, m_dilation, false, m_groups);
                 m_convEng = ConvolutionEngine<ElemType>::Create(geometry, m_deviceId, m_imageLayout,
                                                                 m_maxTempMemSizeInSamples, m_poolKind,
-                                                                ConvolutionEngineKind::All, NodeName(), Globals::ShouldForceDeterministicAlgorithms(),
+                                                                m_convolution2D ? ConvolutionEngineKind::All : this->NDEngines(), NodeName(), Globals::ShouldForceDeterministicAlgorithms(),
                                                                 false, recomputeConvGeometry);
             }
 
@@ -708,6 +744,82 @@ public:
         }
     }
 
+    // Fuses a following bias (Plus of a Parameter with one value per output map), BatchNormalization (spatial,
+    // in inference mode) and/or ReLU, on the CPU; see ConvolutionEpilogue.
+    size_t /*IForwardPropFusable::*/FuseForwardProp(const std::vector<ComputationNodeBasePtr>& consumers) override
+    {
+        m_fusedOutput = nullptr;
+        m_fusedBias = nullptr;
+        m_fusedBatchNorm = nullptr;
+        m_fusedRelu = false;
+        m_fusedInputs.clear();
+        m_computedFusedNodes = false;
+
+        const auto& outputShape = GetSampleLayout();
+        if (consumers.empty() || m_transpose || m_deviceId != CPUDEVICE || m_imageLayout != ImageLayoutKind::CHW || outputShape.GetRank() == 0 ||
+            find(m_sharing.begin(), m_sharing.end(), false) != m_sharing.end())
+            return 0;
+
+        const size_t rank = outputShape.GetRank();
+        const size_t mapCount = outputShape[rank - 1];
+        if (m_convEng->Geometry()->KernelCount() != mapCount)
+            return 0;
+        auto isElementwise = [&](const ComputationNodeBasePtr& node)
+        {
+            return node->GetSampleLayout() == outputShape && node->GetMBLayout() == GetMBLayout() && node->Is<ComputationNode<ElemType>>();
+        };
+
+        size_t numFused = 0;
+        const auto& first = consumers[0];
+        if (first->OperationName() == L"Plus" && isElementwise(first))
+        {
+            ComputationNodeBasePtr bias = first->Input(0).get() == this ? first->Input(1) : first->Input(0);
+            const auto& biasShape = bias->GetSampleLayout();
+            // a value per map, which is broadcast over the other dimensions
+            if (bias->OperationName() == L"LearnableParameter" && !bias->HasMBLayout() && bias->Is<ComputationNode<ElemType>>() &&
+                biasShape.GetRank() == rank && biasShape[rank - 1] == mapCount && biasShape.GetNumElements() == mapCount)
+            {
+                m_fusedBias = bias;
+                m_fusedInputs.push_back(bias);
+                numFused++;
+            }
+        }
+        else if (auto batchNorm = dynamic_pointer_cast<BatchNormalizationNode<ElemType>>(first))
+        {
+            if (isElementwise(first) && batchNorm->Spatial() && batchNorm->GetImageLayoutKind() == ImageLayoutKind::CHW &&
+                first->Input(1)->GetSampleLayout().GetNumElements() == mapCount)
+            {
+                m_fusedBatchNorm = batchNorm.get();
+                m_fusedRelu = batchNorm->ReluOutput();
+                for (size_t i = 1; i < first->GetNumInputs(); i++)
+                    m_fusedInputs.push_back(first->Input(i));
+                numFused++;
+            }
+        }
+        if (numFused < consumers.size() && consumers[numFused]->OperationName() == L"RectifiedLinear" && isElementwise(consumers[numFused]))
+        {
+            m_fusedRelu = true;
+            numFused++;
+        }
+
+        if (numFused > 0)
+            m_fusedOutput = consumers[numFused - 1]->As<ComputationNode<ElemType>>();
+        return numFused;
+    }
+
+    bool /*IForwardPropFusable::*/HasComputedFusedNodes() const override { return m_computedFusedNodes; }
+
+    // The fused nodes are skipped, so this must be evaluated again when their other inputs change.
+    bool IsOutOfDateWrtInputs() const override
+    {
+        if (Base::IsOutOfDateWrtInputs())
+            return true;
+        for (const auto& input : m_fusedInputs)
+            if (!input->IsOlderThan(*this))
+                return true;
+        return false;
+    }
+
     void RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) override
     {
         Base::RequestMatricesBeforeForwardProp(matrixPool);
@@ -734,6 +846,30 @@ public:
     }
 
 private:
+    ConvolutionEpilogue<ElemType> GetFusedEpilogue()
+    {
+        ConvolutionEpilogue<ElemType> epilogue;
+        if (m_fusedBias)
+            epilogue.shift = m_fusedBias->As<ComputationNode<ElemType>>()->Value().Data();
+        else if (m_fusedBatchNorm)
+        {
+            m_fusedBatchNorm->GetInferenceScaleAndShift(m_fusedScale, m_fusedShift);
+            epilogue.scale = m_fusedScale.data();
+            epilogue.shift = m_fusedShift.data();
+        }
+        epilogue.relu = m_fusedRelu;
+        return epilogue;
+    }
+
+    // forward-prop fusion, see FuseForwardProp(); the nodes are owned by the network
+    ComputationNode<ElemType>* m_fusedOutput = nullptr; // the last fused node
+    ComputationNodeBasePtr m_fusedBias;
+    BatchNormalizationNode<ElemType>* m_fusedBatchNorm = nullptr;
+    bool m_fusedRelu = false;
+    std::vector<ComputationNodeBasePtr> m_fusedInputs; // the other inputs of the fused nodes
+    std::vector<ElemType> m_fusedScale, m_fusedShift;
+    bool m_computedFusedNodes = false;
+
     using TransformerNode::m_transforms;
     using ConvolutionNodeBase<ElemType>::ComputeFilterTransform;
 
@@ -960,7 +1096,7 @@ private:
 // output: Pooled ROIs  [PW x PH x C x roisPerImage x N]
 // where PW = Pooled Width, PH = Pooled Height, C = Channels, N = Batch Size
 //
-// See http://arxiv.org/abs/1504.08083
+// See http://arxiv.org/abs/1504.08083; average pooling is ROI align, see https://arxiv.org/abs/1703.06870
 // -----------------------------------------------------------------------
 template <class ElemType>
 class ROIPoolingNode : public ComputationNode<ElemType>, public NumInputs<2>
@@ -1009,7 +1145,9 @@ public:
     // every ROI, it treats the subset of the image specified by that
     // ROI as a full image and does max pooling over that subset,
     // using whatever window size will correspond to an output of
-    // [Pooled Width x Pooled Height x Channels]. Hence,
+    // [Pooled Width x Pooled Height x Channels]. Average pooling is ROI
+    // align instead: the ROI and its bins are not quantized, and each bin
+    // averages bilinearly interpolated points. Hence,
     // the output tensor is [PW x PH x C x roisPerImage x N]
     // An example validation output looks like this:
     // Validating --> z.roiOut = ROIPooling (z.conv5Out.conv5.y, rois) : [61 x 61 x 256 x *], [4 x 64 x *] -> [6 x 6 x 256 x 64 x *]
@@ -1034,12 +1172,16 @@ public:
         size_t outW = m_roiOutputShape[0];
         size_t outH = m_roiOutputShape[1];
 
-        m_tempMatrix->Resize(outW * outH * numChannels * roisPerImage, inputSlice.GetNumCols());
+        // all ROIs of the minibatch are pooled at once
         if (m_poolKind == PoolKind::Max)
+        {
+            m_tempMatrix->Resize(outW * outH * numChannels * roisPerImage, inputSlice.GetNumCols());
             inputSlice.MaxROIPoolingForward(roisPerImage, inputSlice.GetNumCols(),
                 numChannels, inputW, inputH, outW, outH, ROIs, outputSlice, *m_tempMatrix, m_spatialScale);
+        }
         else
-            LogicError("Average ROI pooling is not supported.");
+            inputSlice.AverageROIAlignForward(roisPerImage, inputSlice.GetNumCols(),
+                numChannels, inputW, inputH, outW, outH, ROIs, outputSlice, m_spatialScale);
     }
 
     // similar to usual MaxPooling backpropagation. Send gradients
@@ -1069,7 +1211,8 @@ public:
             pooledGrad.MaxROIPoolingBackward(roisPerImage, inputSlice.GetNumCols(), numChannels,
                 inputW, inputH, m_roiOutputShape[0], m_roiOutputShape[1], roiData, inputGrad, *m_tempMatrix, m_spatialScale);
         else
-            LogicError("Average ROI pooling is not supported.");
+            pooledGrad.AverageROIAlignBackward(roisPerImage, inputSlice.GetNumCols(), numChannels,
+                inputW, inputH, m_roiOutputShape[0], m_roiOutputShape[1], roiData, inputGrad, m_spatialScale);
     }
 
     void Save(File& fstream) const override
@@ -1218,21 +1361,19 @@ public:
         Base::Validate(isFinalValidationPass);
         InferMBLayoutFromInputsForStandardCase(isFinalValidationPass);
 
-        if (m_imageLayout != ImageLayoutKind::CHW)
-        {
-            InvalidArgument(
-                "%ls %ls supports only cuDNN (CHW) data layout. "
-                "Please specify imageLayout=\"cudnn\" in %ls node in your script "
-                "and make sure input data layout is CHW", NodeName().c_str(), OperationName().c_str(), NodeName().c_str());
-        }
-
-        const auto& inputShape = GetInputSampleLayout(0);
+        auto inputShape = GetInputSampleLayout(0);
+        // ConvolveGeometry uses CHW, the channels-last tensors are converted to and from it.
+        if (m_imageLayout == ImageLayoutKind::HWC)
+            inputShape = ImageDimensions(inputShape, ImageLayoutKind::HWC).AsTensorShape(ImageLayoutKind::CHW);
 
         // infer reduction dimensions if not given
         InferReductionDims(inputShape, TensorShape());
 
         auto outDims = this->ComputeOutputShape(inputShape, TensorShape(1), m_ceilOutDim, isFinalValidationPass);
-        SetDims(outDims, HasMBLayout());
+        if (m_imageLayout == ImageLayoutKind::CHW)
+            SetDims(outDims, HasMBLayout());
+        else
+            SetDims(ImageDimensions(outDims, ImageLayoutKind::CHW).AsTensorShape(m_imageLayout), HasMBLayout());
         if (isFinalValidationPass)
         {
             bool recomputeConvGeometry = (m_convEng == nullptr) ? false : // For first minibatch, this flag must be false, so initial mem allocation can happen.
@@ -1243,7 +1384,7 @@ public:
                                                                    m_sharing, m_autoPad, m_lowerPad, m_upperPad, TensorShape(1), m_ceilOutDim);
                 m_convEng = ConvolutionEngine<ElemType>::Create(geometry, m_deviceId, m_imageLayout,
                                                                 m_maxTempMemSizeInSamples, m_poolKind,
-                                                                ConvolutionEngineKind::All, NodeName(), Globals::ShouldForceDeterministicAlgorithms(),
+                                                                this->NDEngines(), NodeName(), Globals::ShouldForceDeterministicAlgorithms(),
                                                                 m_poolIncludePad, recomputeConvGeometry);
             }
         }
@@ -1586,6 +1727,12 @@ protected:
         m_upperPad    = TensorShape(0);
     }
 
+    virtual void MoveToDevice(DEVICEID_TYPE deviceId) override
+    {
+        Base::MoveToDevice(deviceId);
+        m_convEng.reset(); // recreated by Validate()
+    }
+
 protected:
     size_t m_windowWidth, m_windowHeight;
     size_t m_horizontalSubsample, m_verticalSubsample;
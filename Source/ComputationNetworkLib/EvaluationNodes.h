@@ -467,6 +467,7 @@ template class NDCG1EvalNode<double>;
 // The returned error is computed as: EditDistance(s1,s2) * length(s1') / length(s1)
 //
 // Just like ClassificationError and other evaluation nodes, when used as an evaluation criterion, the SGD process will aggregate all values over an epoch and report the average, i.e. the error rate.
+// The distances are computed by Matrix::AssignEditDistances() on the device of the inputs, all sequences of the minibatch in parallel.
 // Primary objective of this node is for error evaluation of CTC training, see formula (1) in "Connectionist Temporal Classification: Labelling Unsegmented
 // Sequence Data with Recurrent Neural Networks", ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
 template<class ElemType>
@@ -579,113 +580,39 @@ public:
     ElemType ComputeEditDistanceError(Matrix<ElemType>& firstSeq, const Matrix<ElemType> & secondSeq, MBLayoutPtr pMBLayout, 
         float subPen, float delPen, float insPen, bool squashInputs, const vector<size_t>& tokensToIgnore)
     {
-        std::vector<int> firstSeqVec, secondSeqVec;
-
-        // Edit distance between subsequences
-        Matrix<float> grid(CPUDEVICE);
-        
-        // Number of insertions between subsequences
-        Matrix<float> insMatrix(CPUDEVICE);
-        
-        //Number of deletions between subsequences
-        Matrix<float> delMatrix(CPUDEVICE);
-
-        // Number of substitutions between subsequences
-        Matrix<float> subMatrix(CPUDEVICE);
-
-        float del, ins, sub;
-        ElemType wrongSampleNum = 0.0;
-        size_t totalSampleNum = 0, totalframeNum = 0;
-        size_t sequenceStartFrame = 0;
-
+        std::vector<size_t> uttToChanInd, uttBeginFrame, uttFrameNum;
+        size_t totalframeNum = 0;
         for (const auto& sequence : pMBLayout->GetAllSequences())
         {
             if (sequence.seqId == GAP_SEQUENCE_ID)
                 continue;
 
             auto numFrames = pMBLayout->GetNumSequenceFramesInCurrentMB(sequence);
+            if (numFrames == 0)
+                continue;
 
-            if (numFrames > 0)
-            {
-                totalframeNum += numFrames;
-
-                auto columnIndices = pMBLayout->GetColumnIndices(sequence);
-
-                ExtractSampleSequence(firstSeq, columnIndices, squashInputs, tokensToIgnore, firstSeqVec);
-                ExtractSampleSequence(secondSeq, columnIndices, squashInputs, tokensToIgnore, secondSeqVec);
-
-                //calculate edit distance
-                size_t firstSize = firstSeqVec.size();
-                size_t secondSize = secondSeqVec.size();
-                if (Base::HasEnvironmentPtr() && Base::Environment().IsV2Library())
-                    totalSampleNum += secondSize;
-                else 
-                    totalSampleNum += firstSize;
-
-                grid.Resize(firstSize + 1, secondSize + 1);
-                insMatrix.Resize(firstSize + 1, secondSize + 1);
-                delMatrix.Resize(firstSize + 1, secondSize + 1);
-                subMatrix.Resize(firstSize + 1, secondSize + 1);
-                insMatrix.SetValue(0.0f);
-                delMatrix.SetValue(0.0f);
-                subMatrix.SetValue(0.0f);
-
-                for (size_t i = 0; i < firstSize + 1; i++)
-                {
-                    grid(i, 0) = (float)(i * delPen);
-                    delMatrix(i, 0) = (float)i;
-                }
-
-                for (size_t j = 0; j < secondSize + 1; j++)
-                {
-                    grid(0, j) = (float)(j * insPen);
-                    insMatrix(0, j) = (float)j;
-                }
-                for (size_t i = 1; i < firstSize + 1; i++)
-                {
-                    for (size_t j = 1; j < secondSize + 1; j++)
-                    {
-                        if (firstSeqVec[i - 1] == secondSeqVec[j - 1])
-                        {
-                            grid(i, j) = grid(i - 1, j - 1);
-                            insMatrix(i, j) = insMatrix(i - 1, j - 1);
-                            delMatrix(i, j) = delMatrix(i - 1, j - 1);
-                            subMatrix(i, j) = subMatrix(i - 1, j - 1);
-                        }
-                        else
-                        {
-                            del = grid(i - 1, j) + delPen; //deletion 
-                            ins = grid(i, j - 1) + insPen;  //insertion
-                            sub = grid(i - 1, j - 1) + subPen; //substitution 
-                            if (sub <= del && sub <= ins)
-                            {
-                                insMatrix(i, j) = insMatrix(i - 1, j - 1);
-                                delMatrix(i, j) = delMatrix(i - 1, j - 1);
-                                subMatrix(i, j) = subMatrix(i - 1, j - 1) + 1.0f;
-                                grid(i, j) = sub;
-                            }
-                            else if (del < ins)
-                            {
-                                insMatrix(i, j) = insMatrix(i - 1, j);
-                                subMatrix(i, j) = subMatrix(i - 1, j);
-                                delMatrix(i, j) = delMatrix(i - 1, j) + 1.0f;
-                                grid(i, j) = del;
-                            }
-                            else
-                            {
-                                delMatrix(i, j) = delMatrix(i, j - 1);
-                                subMatrix(i, j) = subMatrix(i, j - 1);
-                                insMatrix(i, j) = insMatrix(i, j - 1) + 1.0f;
-                                grid(i, j) = ins;
-                            }
-                        }
-                    }
-                }
+            uttToChanInd.push_back(sequence.s);
+            uttBeginFrame.push_back((size_t)max(sequence.tBegin, (ptrdiff_t)0));
+            uttFrameNum.push_back(numFrames);
+            totalframeNum += numFrames;
+        }
 
-                wrongSampleNum += insMatrix(firstSize, secondSize) + delMatrix(firstSize, secondSize) + subMatrix(firstSize, secondSize);
+        ElemType wrongSampleNum = 0.0;
+        size_t totalSampleNum = 0;
+        if (!uttFrameNum.empty())
+        {
+            // The sequences are aligned on the device of the labels, in parallel; only the number of edits and the lengths come back.
+            Matrix<ElemType> distances(firstSeq.GetDeviceId());
+            distances.AssignEditDistances(firstSeq, secondSeq, uttToChanInd, uttBeginFrame, uttFrameNum, pMBLayout->GetNumParallelSequences(),
+                                          subPen, delPen, insPen, squashInputs, tokensToIgnore);
+            std::unique_ptr<ElemType[]> result(distances.CopyToArray());
+
+            bool isV2Library = Base::HasEnvironmentPtr() && Base::Environment().IsV2Library();
+            for (size_t i = 0; i < uttFrameNum.size(); i++)
+            {
+                wrongSampleNum += result[3 * i];
+                totalSampleNum += (size_t)result[3 * i + (isV2Library ? 2 : 1)];
             }
-
-            sequenceStartFrame += numFrames;
         }
 
         return (ElemType)(wrongSampleNum * totalframeNum / totalSampleNum);
@@ -725,42 +652,6 @@ private:
     float m_delPen;
     float m_insPen;
     std::vector<size_t> m_tokensToIgnore;
-
-    // Clear out_SampleSeqVec and extract a vector of samples from the matrix into out_SampleSeqVec.
-    static void ExtractSampleSequence(const Matrix<ElemType>& firstSeq, vector<size_t>& columnIndices, bool squashInputs, const vector<size_t>& tokensToIgnore, std::vector<int>& out_SampleSeqVec)
-    {
-        out_SampleSeqVec.clear();
-
-        // Get the first element in the sequence
-        size_t lastId = (int)firstSeq(0, columnIndices[0]);
-        if (std::find(tokensToIgnore.begin(), tokensToIgnore.end(), lastId) == tokensToIgnore.end())
-            out_SampleSeqVec.push_back(lastId);
-
-        // Remaining elements
-        if (squashInputs)
-        {
-            //squash sequences of identical samples
-            for (size_t i = 1; i < columnIndices.size(); i++)
-            {
-                size_t refId = (int)firstSeq(0, columnIndices[i]);
-                if (lastId != refId)
-                {
-                    lastId = refId;
-                    if (std::find(tokensToIgnore.begin(), tokensToIgnore.end(), refId) == tokensToIgnore.end())
-                        out_SampleSeqVec.push_back(refId);
-                }
-            }
-        }
-        else
-        {
-            for (size_t i = 1; i < columnIndices.size(); i++)
-            {
-                auto refId = (int)firstSeq(0, columnIndices[i]);
-                if (std::find(tokensToIgnore.begin(), tokensToIgnore.end(), refId) == tokensToIgnore.end())
-                    out_SampleSeqVec.push_back(refId);
-            }
-        }
-    }
 };
 
 template class EditDistanceErrorNode<float>;
@@ -987,7 +878,6 @@ public:
         // to-do, shift more than 1 to support muliple sentences per minibatch
         int iNumPos = pos_scores.GetNumCols();
         int iNumLab = pos_scores.GetNumRows();
-        size_t iTmp = 0;
 
         // need to have
         alpha.Resize(iNumLab, iNumPos);
@@ -995,8 +885,11 @@ public:
 
         for (int t = 0; t < iNumPos; t++)
         {
+            // the labels of a position only depend on the previous position
+#pragma omp parallel for
             for (int k = 0; k < iNumLab; k++)
             {
+                size_t iTmp = 0;
                 ElemType fTmp = (ElemType) LZERO;
                 if (t > 1)
                 {
@@ -10,6 +10,7 @@
 #include "Globals.h"     // for ShouldForceConstantRandomSeed()
 
 #include <string>
+#include <algorithm>
 
 //
 // Note: Some template specializations have not been implemented in this file.
@@ -26,6 +27,7 @@ template <class ElemType>
 void LearnableParameter<ElemType>::InitShape(const TensorShape& shape)
 {
     SetDims(shape, false);
+    GPUMemoryCategoryScope memoryCategory(GPUMemoryCategory::Parameters);
     UpdateFunctionValuesSize(); // this allocates the matrix
     Value().Invalidate();
 }
@@ -698,4 +700,530 @@ template class LearnableParameter<float>;
 template class LearnableParameter<double>;
 template class LearnableParameter<half>;
 
+// -----------------------------------------------------------------------
+// CachedLookupTableNode (cache, input)
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+/*virtual*/ void CachedLookupTableNode<ElemType>::Validate(bool isFinalValidationPass) /*override*/
+{
+    Base::Validate(isFinalValidationPass);
+    m_pMBLayout = Input(1)->GetMBLayout();
+
+    if (isFinalValidationPass)
+    {
+        if (!HasMBLayout())
+            InvalidArgument("%ls %ls operation can only operate on minibatches.", NodeName().c_str(), OperationName().c_str());
+        if (Input(0)->HasMBLayout())
+            InvalidArgument("%ls %ls operation requires its cache to be a parameter, not minibatch data.", NodeName().c_str(), OperationName().c_str());
+        if (m_tableSize == 0 || Input(1)->GetSampleMatrixNumRows() % m_tableSize != 0)
+            InvalidArgument("%ls %ls operation: The input dimension %d is not a multiple of the table size %d.",
+                            NodeName().c_str(), OperationName().c_str(), (int)Input(1)->GetSampleMatrixNumRows(), (int)m_tableSize);
+        // the slots are passed to the gather and scatter of columns as ElemType values, which must represent them exactly
+        if (Input(0)->GetAsMatrixNumCols() > (1ull << std::numeric_limits<ElemType>::digits))
+            InvalidArgument("%ls %ls operation: The cache has %d slots, more than the %d supported for this element type.",
+                            NodeName().c_str(), OperationName().c_str(), (int)Input(0)->GetAsMatrixNumCols(), (int)(1ull << std::numeric_limits<ElemType>::digits));
+    }
+
+    size_t wordsInEachSample = m_tableSize > 0 ? max(WordsInEachSample(), (size_t)1) : 1;
+    SetDims(TensorShape(Input(0)->GetAsMatrixNumRows() * wordsInEachSample), true);
+
+    if (isFinalValidationPass)
+    {
+        size_t embeddingDim = Input(0)->GetAsMatrixNumRows();
+        if (m_table.IsEmpty())
+        {
+            m_table.Resize(embeddingDim, m_tableSize);
+            ElemType range = (ElemType)(0.05 * m_initValueScale);
+            m_table.SetUniformRandomValue(-range, range, m_randomSeed);
+        }
+        else if (m_table.GetNumRows() != embeddingDim || m_table.GetNumCols() != m_tableSize)
+            InvalidArgument("%ls %ls operation: The table [%d x %d] does not match the cache [%d x %d].", NodeName().c_str(), OperationName().c_str(),
+                            (int)m_table.GetNumRows(), (int)m_table.GetNumCols(), (int)embeddingDim, (int)Input(0)->GetAsMatrixNumCols());
+    }
+}
+
+template <class ElemType>
+void CachedLookupTableNode<ElemType>::ResetCache()
+{
+    size_t numSlots = NumSlots();
+    m_rowOfSlot.assign(numSlots, NoRow);
+    m_slotOfRow.clear();
+    m_slotFrequency.assign(numSlots, 0);
+    m_slotLastUse.assign(numSlots, 0);
+    m_numLookups = 0;
+    InputRef(0).Value().SetValue(0); // columns are loaded into slots by adding them, which is exact for columns of 0
+}
+
+template <class ElemType>
+static Matrix<ElemType> SlotIndices(const vector<size_t>& slots, DEVICEID_TYPE deviceId)
+{
+    vector<ElemType> indices(slots.begin(), slots.end());
+    return Matrix<ElemType>(1, indices.size(), indices.data(), deviceId);
+}
+
+// gathers the columns of the given slots into 'columns', on the device of the cache, and copies those that hold a row to the table
+template <class ElemType>
+void CachedLookupTableNode<ElemType>::WriteBack(const vector<size_t>& slots, const Matrix<ElemType>& slotIndices, Matrix<ElemType>& columns) const
+{
+    size_t embeddingDim = m_table.GetNumRows();
+    columns.DoGatherColumnsOf(0, slotIndices, InputRef(0).Value(), 1);
+
+    vector<ElemType> hostColumns(embeddingDim * slots.size());
+    columns.CopySection(embeddingDim, slots.size(), hostColumns.data(), embeddingDim);
+    ElemType* table = m_table.Data();
+#pragma omp parallel for
+    for (long i = 0; i < (long)slots.size(); i++)
+    {
+        size_t row = m_rowOfSlot[slots[i]];
+        if (row != NoRow)
+            memcpy(table + row * embeddingDim, &hostColumns[i * embeddingDim], embeddingDim * sizeof(ElemType));
+    }
+}
+
+template <class ElemType>
+void CachedLookupTableNode<ElemType>::WriteBackCachedRows() const
+{
+    vector<size_t> slots;
+    for (size_t slot = 0; slot < m_rowOfSlot.size(); slot++)
+    {
+        if (m_rowOfSlot[slot] != NoRow)
+            slots.push_back(slot);
+    }
+    if (slots.empty())
+        return;
+
+    const auto& cache = InputRef(0).Value();
+    Matrix<ElemType> columns(cache.GetDeviceId());
+    WriteBack(slots, SlotIndices<ElemType>(slots, cache.GetDeviceId()), columns);
+}
+
+// Loads the given rows, none of which is cached, into the slots that this minibatch does not look up: the empty slots first,
+// then those of the least frequently used rows, which are written back to the table before.
+template <class ElemType>
+void CachedLookupTableNode<ElemType>::AssignSlots(const vector<size_t>& rows)
+{
+    if (rows.empty())
+        return;
+
+    size_t numSlots = NumSlots();
+    vector<size_t> slots;
+    for (size_t slot = 0; slot < numSlots; slot++)
+    {
+        if (m_slotLastUse[slot] != m_numMinibatches)
+            slots.push_back(slot);
+    }
+    if (slots.size() < rows.size())
+        RuntimeError("%ls %ls operation: The minibatch looks up %d distinct rows, more than the %d slots of the cache.",
+                     NodeName().c_str(), OperationName().c_str(), (int)(numSlots - slots.size() + rows.size()), (int)numSlots);
+
+    if (slots.size() > rows.size())
+    {
+        auto frequency = [this](size_t slot) { return m_rowOfSlot[slot] == NoRow ? -1.0 : m_slotFrequency[slot]; };
+        nth_element(slots.begin(), slots.begin() + rows.size(), slots.end(), [&](size_t a, size_t b) { return frequency(a) < frequency(b); });
+        slots.resize(rows.size());
+    }
+
+    // Each transfer between host and device is a single one of all the columns, which are gathered from and scattered to
+    // the slots on the device. Scatters add, so the evicted columns are first subtracted, which zeroes them exactly.
+    auto& cache = InputRef(0).Value();
+    size_t embeddingDim = cache.GetNumRows();
+    Matrix<ElemType> slotIndices = SlotIndices<ElemType>(slots, cache.GetDeviceId());
+    Matrix<ElemType> evictedColumns(cache.GetDeviceId());
+    WriteBack(slots, slotIndices, evictedColumns);
+    cache.DoScatterColumnsOf(1, slotIndices, evictedColumns, -1, /*idxHaveDups=*/false);
+
+    vector<ElemType> hostColumns(embeddingDim * rows.size());
+    const ElemType* table = m_table.Data();
+#pragma omp parallel for
+    for (long i = 0; i < (long)rows.size(); i++)
+        memcpy(&hostColumns[i * embeddingDim], table + rows[i] * embeddingDim, embeddingDim * sizeof(ElemType));
+    Matrix<ElemType> loadedColumns(embeddingDim, rows.size(), hostColumns.data(), cache.GetDeviceId());
+    cache.DoScatterColumnsOf(1, slotIndices, loadedColumns, 1, /*idxHaveDups=*/false);
+
+    for (size_t i = 0; i < slots.size(); i++)
+    {
+        size_t slot = slots[i];
+        if (m_rowOfSlot[slot] != NoRow)
+            m_slotOfRow.erase(m_rowOfSlot[slot]);
+        m_rowOfSlot[slot] = rows[i];
+        m_slotOfRow[rows[i]] = slot;
+        m_slotFrequency[slot] = 0;
+        m_slotLastUse[slot] = m_numMinibatches;
+    }
+}
+
+template <class ElemType>
+/*virtual*/ void CachedLookupTableNode<ElemType>::ForwardPropNonLooping() /*override*/
+{
+    const auto& input = InputRef(1).Value();
+    if (input.GetMatrixType() != SPARSE || input.GetFormat() != matrixFormatSparseCSC)
+        InvalidArgument("%ls %ls operation requires a sparse input, e.g. of one-hot word vectors.", NodeName().c_str(), OperationName().c_str());
+    if (m_rowOfSlot.size() != NumSlots())
+        ResetCache();
+    m_numMinibatches++;
+
+    vector<CPUSPARSE_INDEX_TYPE> colStarts, inputRows;
+    vector<ElemType> values;
+    input.GetMatrixFromCSCFormat(colStarts, inputRows, values);
+
+    // keep the cached rows of this minibatch and load the others
+    vector<size_t> missingRows;
+    for (auto inputRow : inputRows)
+    {
+        size_t row = (size_t)inputRow % m_tableSize;
+        auto iter = m_slotOfRow.find(row);
+        if (iter != m_slotOfRow.end())
+            m_slotLastUse[iter->second] = m_numMinibatches;
+        else
+            missingRows.push_back(row);
+    }
+    sort(missingRows.begin(), missingRows.end());
+    missingRows.erase(unique(missingRows.begin(), missingRows.end()), missingRows.end());
+    AssignSlots(missingRows);
+
+    // remap the input to the slots; word w of input column j becomes column j * wordsInEachSample + w
+    size_t wordsInEachSample = WordsInEachSample();
+    size_t numColumns = input.GetNumCols() * wordsInEachSample;
+    size_t nz = inputRows.size();
+    vector<size_t> columnOf(nz);
+    vector<CPUSPARSE_INDEX_TYPE> slotColStarts(numColumns + 1, 0);
+    for (size_t j = 0; j < input.GetNumCols(); j++)
+    {
+        for (size_t k = colStarts[j]; k < colStarts[j + 1]; k++)
+        {
+            columnOf[k] = j * wordsInEachSample + inputRows[k] / m_tableSize;
+            slotColStarts[columnOf[k] + 1]++;
+        }
+    }
+    for (size_t j = 0; j < numColumns; j++)
+        slotColStarts[j + 1] += slotColStarts[j];
+
+    vector<CPUSPARSE_INDEX_TYPE> slotRows(nz);
+    vector<ElemType> slotValues(nz);
+    vector<CPUSPARSE_INDEX_TYPE> next(slotColStarts.begin(), slotColStarts.end() - 1);
+    for (size_t k = 0; k < nz; k++)
+    {
+        size_t slot = m_slotOfRow[(size_t)inputRows[k] % m_tableSize];
+        auto pos = next[columnOf[k]]++;
+        slotRows[pos] = (CPUSPARSE_INDEX_TYPE)slot;
+        slotValues[pos] = values[k];
+        m_slotFrequency[slot]++;
+    }
+
+    // age the frequencies, so that rows that were hot a while ago can be evicted
+    m_numLookups += nz;
+    if (m_numLookups >= 8 * NumSlots())
+    {
+        for (auto& frequency : m_slotFrequency)
+            frequency /= 2;
+        m_numLookups = 0;
+    }
+
+    const auto& cache = InputRef(0).Value();
+    if (!m_slotInput)
+        m_slotInput = make_shared<Matrix<ElemType>>(0, 0, cache.GetDeviceId(), SPARSE, matrixFormatSparseCSC);
+    m_slotInput->SetMatrixFromCSCFormat(slotColStarts.data(), slotRows.data(), slotValues.data(), nz, NumSlots(), numColumns);
+
+    auto value = Value().Reshaped(cache.GetNumRows(), numColumns);
+    value.AssignProductOf(cache, false, *m_slotInput, false);
+}
+
+template <class ElemType>
+/*virtual*/ void CachedLookupTableNode<ElemType>::BackpropToNonLooping(size_t inputIndex) /*override*/
+{
+    if (inputIndex != 0) // no gradient for the input, which is data
+        return;
+
+    // as for DENSE * SPARSE in TimesNode, the gradient of the cache is a SparseBlockCol matrix, of the slots of this minibatch
+    auto& currentCacheGradient = InputRef(0).Gradient();
+    if (InputRef(0).GetPreferredGradientMatrixType() == UNDETERMINED && currentCacheGradient.GetMatrixType() == DENSE)
+    {
+        InputRef(0).GradientPtrRef() = make_shared<Matrix<ElemType>>(currentCacheGradient.GetNumRows(), currentCacheGradient.GetNumCols(),
+                                                                     currentCacheGradient.GetPreferredDeviceId(), SPARSE, MatrixFormat::matrixFormatSparseBlockCol);
+        InputRef(0).SetPreferredGradientMatrixType(SPARSE);
+    }
+
+    MaskMissingGradientColumnsToZero(FrameRange(GetMBLayout()));
+    auto gradient = Gradient().Reshaped(InputRef(0).Value().GetNumRows(), m_slotInput->GetNumCols());
+    Matrix<ElemType>::MultiplyAndAdd(gradient, false, *m_slotInput, true, InputRef(0).Gradient());
+}
+
+template <class ElemType>
+/*virtual*/ void CachedLookupTableNode<ElemType>::Save(File& fstream) const /*override*/
+{
+    Base::Save(fstream);
+    WriteBackCachedRows();
+    fstream << m_tableSize << m_initValueScale << (size_t)m_randomSeed;
+    fstream << m_table;
+}
+
+template <class ElemType>
+/*virtual*/ void CachedLookupTableNode<ElemType>::Load(File& fstream, size_t modelVersion) /*override*/
+{
+    Base::Load(fstream, modelVersion);
+    size_t randomSeed;
+    fstream >> m_tableSize >> m_initValueScale >> randomSeed;
+    m_randomSeed = (unsigned long)randomSeed;
+    fstream >> m_table;
+    // the table is current, so the loaded cache is not used
+    m_rowOfSlot.clear();
+    m_slotOfRow.clear();
+}
+
+template <class ElemType>
+/*virtual*/ void CachedLookupTableNode<ElemType>::CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const /*override*/
+{
+    Base::CopyTo(nodeP, newName, flags);
+    if (flags & CopyNodeFlags::copyNodeValue)
+    {
+        auto node = dynamic_pointer_cast<CachedLookupTableNode<ElemType>>(nodeP);
+        node->m_tableSize = m_tableSize;
+        node->m_initValueScale = m_initValueScale;
+        node->m_randomSeed = m_randomSeed;
+        // the copy gets its own cache parameter, so it starts from the current table with an empty cache
+        WriteBackCachedRows();
+        node->m_table.SetValue(m_table);
+        node->m_rowOfSlot.clear();
+        node->m_slotOfRow.clear();
+    }
+}
+
+template class CachedLookupTableNode<float>;
+template class CachedLookupTableNode<double>;
+
+// -----------------------------------------------------------------------
+// QuantizedLookupTableNode (input)
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+/*virtual*/ void QuantizedLookupTableNode<ElemType>::Validate(bool isFinalValidationPass) /*override*/
+{
+    Base::Validate(isFinalValidationPass);
+    m_pMBLayout = Input(0)->GetMBLayout();
+
+    if (isFinalValidationPass)
+    {
+        if (m_tableSize == 0)
+            InvalidArgument("%ls %ls operation has no table.", NodeName().c_str(), OperationName().c_str());
+        if (!m_indexInput && Input(0)->GetSampleMatrixNumRows() % m_tableSize != 0)
+            InvalidArgument("%ls %ls operation: The input dimension %d is not a multiple of the table size %d.",
+                            NodeName().c_str(), OperationName().c_str(), (int)Input(0)->GetSampleMatrixNumRows(), (int)m_tableSize);
+        // the columns are gathered by ElemType indices, which must represent them exactly
+        const int digits = std::is_same<ElemType, half>::value ? 11 : std::numeric_limits<ElemType>::digits;
+        if (m_tableSize > (1ull << digits))
+            InvalidArgument("%ls %ls operation: The table has %d columns, more than the %d supported for this element type.",
+                            NodeName().c_str(), OperationName().c_str(), (int)m_tableSize, (int)(1ull << digits));
+    }
+
+    if (m_indexInput)
+    {
+        // as GatherNode, the indices are replaced by the columns they index
+        const auto& inputDims = Input(0)->GetSampleLayout().GetDims();
+        SmallVector<size_t> dims(1, m_embeddingDim);
+        dims.append(inputDims.begin(), inputDims.end());
+        SetDims(TensorShape(dims), HasMBLayout());
+    }
+    else
+    {
+        size_t wordsInEachSample = m_tableSize > 0 ? max(Input(0)->GetSampleMatrixNumRows() / m_tableSize, (size_t)1) : 1;
+        SetDims(TensorShape(m_embeddingDim * wordsInEachSample), HasMBLayout());
+    }
+}
+
+// Word w of input column j gives the index of output column j * wordsInEachSample + w, the row of its one-hot vector
+// (values other than 1 are taken as 1). Words without a nonzero, e.g. in gaps, give -1, i.e. a column of 0.
+template <class ElemType>
+void QuantizedLookupTableNode<ElemType>::AssignIndicesOfOneHotInput(const Matrix<ElemType>& input)
+{
+    size_t wordsInEachSample = input.GetNumRows() / m_tableSize;
+    vector<ElemType> indices(input.GetNumCols() * wordsInEachSample, (ElemType)-1);
+    if (input.GetMatrixType() == SPARSE && input.GetFormat() == matrixFormatSparseCSC)
+    {
+        vector<CPUSPARSE_INDEX_TYPE> colStarts, rows;
+        vector<ElemType> values;
+        input.GetMatrixFromCSCFormat(colStarts, rows, values);
+        for (size_t j = 0; j < input.GetNumCols(); j++)
+        {
+            for (size_t k = colStarts[j]; k < colStarts[j + 1]; k++)
+                indices[j * wordsInEachSample + rows[k] / m_tableSize] = (ElemType)(rows[k] % m_tableSize);
+        }
+    }
+    else
+    {
+        // a dense one-hot input is scanned on the host
+        unique_ptr<ElemType[]> data(input.CopyToArray());
+        const size_t numRows = input.GetNumRows();
+#pragma omp parallel for
+        for (long j = 0; j < (long)input.GetNumCols(); j++)
+        {
+            for (size_t i = 0; i < numRows; i++)
+            {
+                if ((float)data[j * numRows + i] != 0)
+                    indices[j * wordsInEachSample + i / m_tableSize] = (ElemType)(i % m_tableSize);
+            }
+        }
+    }
+    m_indices.SetValue(1, indices.size(), m_deviceId, indices.data());
+}
+
+template <class ElemType>
+/*virtual*/ void QuantizedLookupTableNode<ElemType>::ForwardPropNonLooping() /*override*/
+{
+    auto& input = InputRef(0).Value();
+    auto gather = [this](const Matrix<ElemType>& indices)
+    {
+        auto output = Value().Reshaped(m_embeddingDim, indices.GetNumCols());
+        if (m_useHalf)
+            output.AssignDequantizedColumnsOf(indices, m_halfCodes, m_scalesAndOffsets);
+        else
+            output.AssignDequantizedColumnsOf(indices, m_int8Codes, m_scalesAndOffsets);
+    };
+
+    if (m_indexInput)
+    {
+        if (input.GetMatrixType() != DENSE)
+            InvalidArgument("%ls %ls operation requires dense indices.", NodeName().c_str(), OperationName().c_str());
+        gather(input.Reshaped(1, input.GetNumElements()));
+    }
+    else
+    {
+        AssignIndicesOfOneHotInput(input);
+        gather(m_indices);
+    }
+}
+
+template <class ElemType>
+void QuantizedLookupTableNode<ElemType>::SetTable(const Matrix<ElemType>& table, bool useHalf)
+{
+    const size_t embeddingDim = table.GetNumRows();
+    const size_t tableSize = table.GetNumCols();
+    unique_ptr<ElemType[]> values(table.CopyToArray());
+    vector<ElemType> scalesAndOffsets(2 * tableSize);
+
+    if (useHalf)
+    {
+        vector<half> codes(embeddingDim * tableSize);
+#pragma omp parallel for
+        for (long j = 0; j < (long)tableSize; j++)
+        {
+            for (size_t i = 0; i < embeddingDim; i++)
+                codes[j * embeddingDim + i] = half((float)values[j * embeddingDim + i]);
+            scalesAndOffsets[2 * j] = 1;
+            scalesAndOffsets[2 * j + 1] = 0;
+        }
+        SetQuantizedTable(embeddingDim, tableSize, codes.data(), scalesAndOffsets.data());
+        return;
+    }
+
+    // code c stands for c * scale + offset; -128 and 127 stand for the smallest and the largest value of the column
+    vector<char> codes(embeddingDim * tableSize);
+#pragma omp parallel for
+    for (long j = 0; j < (long)tableSize; j++)
+    {
+        const ElemType* column = values.get() + j * embeddingDim;
+        double minValue = embeddingDim > 0 ? (double)column[0] : 0, maxValue = minValue;
+        for (size_t i = 1; i < embeddingDim; i++)
+        {
+            minValue = min(minValue, (double)column[i]);
+            maxValue = max(maxValue, (double)column[i]);
+        }
+        double scale = maxValue > minValue ? (maxValue - minValue) / 255 : 1;
+        double offset = minValue + 128 * scale;
+        for (size_t i = 0; i < embeddingDim; i++)
+        {
+            double code = round(((double)column[i] - offset) / scale);
+            codes[j * embeddingDim + i] = (char)(int)max(-128.0, min(127.0, code));
+        }
+        scalesAndOffsets[2 * j] = (ElemType)scale;
+        scalesAndOffsets[2 * j + 1] = (ElemType)offset;
+    }
+    SetQuantizedTable(embeddingDim, tableSize, codes.data(), scalesAndOffsets.data());
+}
+
+template <class ElemType>
+void QuantizedLookupTableNode<ElemType>::SetQuantizedTable(size_t embeddingDim, size_t tableSize, const char* int8Codes, const ElemType* scalesAndOffsets)
+{
+    m_useHalf = false;
+    m_embeddingDim = embeddingDim;
+    m_tableSize = tableSize;
+    m_int8Codes.SetValue(embeddingDim, tableSize, m_deviceId, const_cast<char*>(int8Codes));
+    m_halfCodes = Matrix<half>(m_deviceId);
+    m_scalesAndOffsets.SetValue(2, tableSize, m_deviceId, const_cast<ElemType*>(scalesAndOffsets));
+}
+
+template <class ElemType>
+void QuantizedLookupTableNode<ElemType>::SetQuantizedTable(size_t embeddingDim, size_t tableSize, const half* halfCodes, const ElemType* scalesAndOffsets)
+{
+    m_useHalf = true;
+    m_embeddingDim = embeddingDim;
+    m_tableSize = tableSize;
+    m_halfCodes.SetValue(embeddingDim, tableSize, m_deviceId, const_cast<half*>(halfCodes));
+    m_int8Codes = Matrix<char>(m_deviceId);
+    m_scalesAndOffsets.SetValue(2, tableSize, m_deviceId, const_cast<ElemType*>(scalesAndOffsets));
+}
+
+template <class ElemType>
+/*virtual*/ void QuantizedLookupTableNode<ElemType>::Save(File& fstream) const /*override*/
+{
+    Base::Save(fstream);
+    fstream << m_indexInput << m_useHalf << m_embeddingDim << m_tableSize;
+    if (m_useHalf)
+    {
+        // as the bits of the half values
+        unique_ptr<half[]> codes(m_halfCodes.CopyToArray());
+        fstream.WriteValues(reinterpret_cast<const unsigned short*>(codes.get()), m_embeddingDim * m_tableSize);
+    }
+    else
+    {
+        unique_ptr<char[]> codes(m_int8Codes.CopyToArray());
+        fstream.WriteValues(codes.get(), m_embeddingDim * m_tableSize);
+    }
+    fstream << m_scalesAndOffsets;
+}
+
+template <class ElemType>
+/*virtual*/ void QuantizedLookupTableNode<ElemType>::Load(File& fstream, size_t modelVersion) /*override*/
+{
+    Base::Load(fstream, modelVersion);
+    bool useHalf;
+    size_t embeddingDim, tableSize;
+    fstream >> m_indexInput >> useHalf >> embeddingDim >> tableSize;
+    vector<half> halfCodes(useHalf ? embeddingDim * tableSize : 0);
+    vector<char> int8Codes(useHalf ? 0 : embeddingDim * tableSize);
+    if (useHalf)
+        fstream.ReadValues(reinterpret_cast<unsigned short*>(halfCodes.data()), halfCodes.size());
+    else
+        fstream.ReadValues(int8Codes.data(), int8Codes.size());
+    Matrix<ElemType> scalesAndOffsets(CPUDEVICE);
+    fstream >> scalesAndOffsets;
+    unique_ptr<ElemType[]> scalesAndOffsetsData(scalesAndOffsets.CopyToArray());
+
+    if (useHalf)
+        SetQuantizedTable(embeddingDim, tableSize, halfCodes.data(), scalesAndOffsetsData.get());
+    else
+        SetQuantizedTable(embeddingDim, tableSize, int8Codes.data(), scalesAndOffsetsData.get());
+}
+
+template <class ElemType>
+/*virtual*/ void QuantizedLookupTableNode<ElemType>::CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const /*override*/
+{
+    Base::CopyTo(nodeP, newName, flags);
+    if (flags & CopyNodeFlags::copyNodeValue)
+    {
+        auto node = dynamic_pointer_cast<QuantizedLookupTableNode<ElemType>>(nodeP);
+        node->m_indexInput = m_indexInput;
+        node->m_useHalf = m_useHalf;
+        node->m_embeddingDim = m_embeddingDim;
+        node->m_tableSize = m_tableSize;
+        node->m_int8Codes.SetValue(m_int8Codes);
+        node->m_halfCodes.SetValue(m_halfCodes);
+        node->m_scalesAndOffsets.SetValue(m_scalesAndOffsets);
+    }
+}
+
+template class QuantizedLookupTableNode<float>;
+template class QuantizedLookupTableNode<double>;
+template class QuantizedLookupTableNode<half>;
+
 }}}
@@ -11,6 +11,8 @@
 #include "Matrix.h"
 
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -731,6 +733,163 @@ public:
 template class LookupTableNode<float>;
 template class LookupTableNode<double>;
 
+// -----------------------------------------------------------------------
+// CachedLookupTableNode (cache, input)
+// An embedding whose table is too large for the device. The full table, one column of the embedding dimension per row
+// of the input, is kept in host memory by this node; input 0 is a parameter [embeddingDim x numSlots] on the device
+// that caches the rows that are looked up most frequently. The input is the same as for LookupTableNode, a sparse
+// stack of wordsInEachSample one-hot vectors of tableSize rows each.
+//
+// Each minibatch, the table rows it looks up that are not in the cache are copied into the slots whose rows are
+// used least frequently, after these rows have been written back to the host. The output is then the product of
+// the cache with the input remapped to the slots, so that the gradient of the cache is a row-sparse SparseBlockCol
+// matrix of the slots used, which the learners apply as to any embedding. While a row is cached, the cache is its
+// current value; the host copy is brought up to date when the row is evicted and when the model is saved.
+//
+// Any optimizer state, e.g. momentum, is kept by the learners per slot, so a row that is loaded into a slot
+// continues from the state of the slot's previous row. The cache must not be an input of other nodes, and since the
+// rows of a slot differ between workers, it cannot be shared by data-parallel training.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class CachedLookupTableNode : public ComputationNodeNonLooping<ElemType>, public NumInputs<2>
+{
+    typedef ComputationNodeNonLooping<ElemType> Base; UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"CachedLookupTable"; }
+
+public:
+    CachedLookupTableNode(DEVICEID_TYPE deviceId, const wstring& name, size_t tableSize = 0, double initValueScale = 1, unsigned long randomSeed = 1)
+        : Base(deviceId, name), m_tableSize(tableSize), m_initValueScale(initValueScale), m_randomSeed(randomSeed), m_table(CPUDEVICE), m_numLookups(0), m_numMinibatches(0)
+    {
+    }
+    CachedLookupTableNode(const ScriptableObjects::IConfigRecordPtr configp)
+        : CachedLookupTableNode(configp->Get(L"deviceId"), L"<placeholder>", configp->Get(L"tableSize"),
+                                configp->Exists(L"initValueScale") ? (double)configp->Get(L"initValueScale") : 1.0,
+                                configp->Exists(L"randomSeed") ? (unsigned long)(size_t)configp->Get(L"randomSeed") : 1)
+    {
+        AttachInputsFromConfig(configp, this->GetExpectedNumInputs());
+    }
+
+    virtual void /*ComputationNodeNonLooping::*/ ForwardPropNonLooping() override;
+    virtual void /*ComputationNodeNonLooping::*/ BackpropToNonLooping(size_t inputIndex) override;
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
+
+    virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override;
+
+    virtual void Save(File& fstream) const override;
+    virtual void Load(File& fstream, size_t modelVersion) override;
+    virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override;
+
+    // the table, including the rows that are cached; for inspection, e.g. by tests
+    const Matrix<ElemType>& GetTable() const
+    {
+        WriteBackCachedRows();
+        return m_table;
+    }
+
+protected:
+    static const size_t NoRow = SIZE_MAX;
+
+    size_t WordsInEachSample() const { return Input(1)->GetSampleMatrixNumRows() / m_tableSize; }
+    size_t NumSlots() const { return InputRef(0).Value().GetNumCols(); }
+    void ResetCache();
+    void AssignSlots(const std::vector<size_t>& rows);
+    void WriteBack(const std::vector<size_t>& slots, const Matrix<ElemType>& slotIndices, Matrix<ElemType>& columns) const;
+    void WriteBackCachedRows() const;
+
+    size_t m_tableSize;                      // the number of rows of each one-hot vector of the input
+    double m_initValueScale;                 // the table is initialized uniformly in [-0.05, 0.05] * m_initValueScale
+    unsigned long m_randomSeed;
+    mutable Matrix<ElemType> m_table;        // [embeddingDim x m_tableSize] on the host; cached rows are brought up to date on write-back
+
+    std::vector<size_t> m_rowOfSlot;         // the table row in each slot of the cache, or NoRow
+    std::unordered_map<size_t, size_t> m_slotOfRow;
+    std::vector<double> m_slotFrequency;     // the number of lookups of each slot's row since it was loaded, halved as it ages
+    std::vector<size_t> m_slotLastUse;       // the minibatch that last looked up each slot's row
+    size_t m_numLookups;                     // since the frequencies were last halved
+    size_t m_numMinibatches;
+    shared_ptr<Matrix<ElemType>> m_slotInput; // the input of the last minibatch, remapped to [numSlots x (numColumns * wordsInEachSample)]
+};
+
+// -----------------------------------------------------------------------
+// QuantizedLookupTableNode (input)
+// An embedding for inference whose table [embeddingDim x tableSize] is owned by this node in a quantized form, a
+// quarter (int8) or half (half) of the size of a float table. Each column of the table, the embedding of one row of
+// the input, is stored as int8 codes with its own scale and offset, (code * scale + offset) giving the value, or as
+// half values (scale 1 and offset 0). The columns looked up are dequantized as they are gathered, so the table is
+// never expanded. The quantized table is saved with the model.
+//
+// With 'indexInput', the input holds table column indices, as the first input of GatherNode, and the output is
+// [embeddingDim x inputSampleShape]. Otherwise it is the input of LookupTableNode, a stack of wordsInEachSample
+// one-hot vectors of tableSize rows each, preferably sparse, and the output is [embeddingDim * wordsInEachSample].
+//
+// Nodes are created from a LookupTableNode, or a GatherNode or TimesNode over an embedding parameter, by
+// ComputationNetwork::QuantizeEmbeddings(). There is no gradient.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class QuantizedLookupTableNode : public ComputationNodeNonLooping<ElemType>, public NumInputs<1>
+{
+    typedef ComputationNodeNonLooping<ElemType> Base; UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"QuantizedLookupTable"; }
+
+public:
+    QuantizedLookupTableNode(DEVICEID_TYPE deviceId, const wstring& name, bool indexInput = true)
+        : Base(deviceId, name), m_indexInput(indexInput), m_useHalf(false), m_embeddingDim(0), m_tableSize(0),
+          m_int8Codes(deviceId), m_halfCodes(deviceId), m_scalesAndOffsets(deviceId), m_indices(deviceId)
+    {
+    }
+    // The table is only set by QuantizeEmbeddings() or loaded with the model; a node created from a config has none.
+    QuantizedLookupTableNode(const ScriptableObjects::IConfigRecordPtr configp)
+        : QuantizedLookupTableNode(configp->Get(L"deviceId"), L"<placeholder>", configp->Exists(L"indexInput") ? (bool)configp->Get(L"indexInput") : true)
+    {
+        AttachInputsFromConfig(configp, this->GetExpectedNumInputs());
+    }
+
+    virtual void /*ComputationNodeNonLooping::*/ ForwardPropNonLooping() override;
+    virtual void /*ComputationNodeNonLooping::*/ BackpropToNonLooping(size_t /*inputIndex*/) override {} // inference only
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
+
+    virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override;
+
+    virtual void Save(File& fstream) const override;
+    virtual void Load(File& fstream, size_t modelVersion) override;
+    virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override;
+
+    // Quantizes 'table' [embeddingDim x tableSize] per column, to int8 codes with a scale and offset that map the
+    // smallest and largest value of the column to -128 and 127, or to half.
+    void SetTable(const Matrix<ElemType>& table, bool useHalf);
+    // Sets the quantized table directly, e.g. from a model in another format; 'codes' are int8 values or half values,
+    // column by column, and 'scalesAndOffsets' the scale and offset of each column.
+    void SetQuantizedTable(size_t embeddingDim, size_t tableSize, const char* int8Codes, const ElemType* scalesAndOffsets);
+    void SetQuantizedTable(size_t embeddingDim, size_t tableSize, const half* halfCodes, const ElemType* scalesAndOffsets);
+
+    bool IndexInput() const { return m_indexInput; }
+    bool UsesHalf() const { return m_useHalf; }
+    size_t EmbeddingDim() const { return m_embeddingDim; }
+    size_t TableSize() const { return m_tableSize; }
+    const Matrix<char>& Int8Codes() const { return m_int8Codes; }
+    const Matrix<half>& HalfCodes() const { return m_halfCodes; }
+    const Matrix<ElemType>& ScalesAndOffsets() const { return m_scalesAndOffsets; }
+
+protected:
+    // the table column of each output column, or -1 for none, from a one-hot input
+    void AssignIndicesOfOneHotInput(const Matrix<ElemType>& input);
+
+    bool m_indexInput;
+    bool m_useHalf;
+    size_t m_embeddingDim;
+    size_t m_tableSize;
+    Matrix<char> m_int8Codes;            // [m_embeddingDim x m_tableSize], if !m_useHalf
+    Matrix<half> m_halfCodes;            // [m_embeddingDim x m_tableSize], if m_useHalf
+    Matrix<ElemType> m_scalesAndOffsets; // [2 x m_tableSize]
+    Matrix<ElemType> m_indices;          // [1 x (numColumns * wordsInEachSample)], for a one-hot input
+};
+
 // -----------------------------------------------------------------------
 // ConstantNode
 // -----------------------------------------------------------------------
@@ -131,4 +131,317 @@ void EpochAccumulatorNode<ElemType>::Reset()
 
 template class EpochAccumulatorNode<float>;
 template class EpochAccumulatorNode<double>;
-template class EpochAccumulatorNode<half>;
\ No newline at end of file
+template class EpochAccumulatorNode<half>;
+// -----------------------------------------------------------------------
+// ScaledDotProductAttentionNode (query, key, value)
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+ScaledDotProductAttentionNode<ElemType>::ScaledDotProductAttentionNode(DEVICEID_TYPE deviceId, const wstring& name, double scale, size_t blockSize)
+    : Base(deviceId, name), m_scale(scale), m_blockSize(blockSize), m_gradientsComputedYet(false)
+{
+    if (m_blockSize == 0)
+        InvalidArgument("%ls: blockSize must be positive.", NodeDescription().c_str());
+}
+
+template <class ElemType>
+ScaledDotProductAttentionNode<ElemType>::ScaledDotProductAttentionNode(const Microsoft::MSR::ScriptableObjects::IConfigRecordPtr configp)
+    : ScaledDotProductAttentionNode(configp->Get(L"deviceId"), L"<placeholder>", configp->Get(L"scale"), configp->Get(L"blockSize"))
+{
+    AttachInputsFromConfig(configp, this->GetExpectedNumInputs());
+}
+
+// Returns a view of the columns [begin, begin + numColumns) of a matrix.
+template <class ElemType>
+static TensorView<ElemType> ColumnsView(const shared_ptr<Matrix<ElemType>>& matrix, size_t begin, size_t numColumns)
+{
+    auto shape = TensorShape(matrix->GetNumRows(), matrix->GetNumCols());
+    shape.NarrowTo(1, begin, begin + numColumns);
+    return TensorView<ElemType>(matrix, shape);
+}
+
+template <class ElemType>
+void ScaledDotProductAttentionNode<ElemType>::PackSequences()
+{
+    let& queryLayout = InputRef(0).GetMBLayout();
+    let& keyLayout = InputRef(1).GetMBLayout();
+    for (let& layout : { queryLayout, keyLayout })
+    {
+        if (layout->HasSequenceBeyondBegin() || layout->HasSequenceBeyondEnd())
+            LogicError("%ls: %s node cannot attend over truncated sequences.", NodeDescription().c_str(), typeid(*this).name());
+    }
+
+    std::vector<const MBLayout::SequenceInfo*> keySequences;
+    for (let& sequence : keyLayout->GetAllSequences())
+    {
+        if (sequence.seqId != GAP_SEQUENCE_ID)
+            keySequences.push_back(&sequence);
+    }
+
+    std::vector<ElemType> queryIndices, keyIndices;
+    m_sequences.clear();
+    for (let& sequence : queryLayout->GetAllSequences())
+    {
+        if (sequence.seqId == GAP_SEQUENCE_ID)
+            continue;
+        if (m_sequences.size() == keySequences.size())
+            InvalidArgument("%ls: The query has more sequences than the key and value (%d).", NodeDescription().c_str(), (int)keySequences.size());
+
+        let& keySequence = *keySequences[m_sequences.size()];
+        m_sequences.push_back(SequencePair{ queryIndices.size(), sequence.GetNumTimeSteps(), keyIndices.size(), keySequence.GetNumTimeSteps() });
+        for (auto column : queryLayout->GetColumnIndices(sequence))
+            queryIndices.push_back((ElemType)column);
+        for (auto column : keyLayout->GetColumnIndices(keySequence))
+            keyIndices.push_back((ElemType)column);
+    }
+
+    if (m_sequences.size() != keySequences.size())
+        InvalidArgument("%ls: The query has %d sequences, but the key and value have %d.", NodeDescription().c_str(), (int)m_sequences.size(), (int)keySequences.size());
+
+    m_queryIndices->SetValue(1, queryIndices.size(), m_deviceId, queryIndices.data());
+    m_keyIndices->SetValue(1, keyIndices.size(), m_deviceId, keyIndices.data());
+}
+
+template <class ElemType>
+bool ScaledDotProductAttentionNode<ElemType>::HasSequenceWithoutKeys() const
+{
+    return std::any_of(m_sequences.begin(), m_sequences.end(), [](const SequencePair& sequence) { return sequence.m_numKeys == 0; });
+}
+
+template <class ElemType>
+ElemType ScaledDotProductAttentionNode<ElemType>::GetScale() const
+{
+    return (ElemType)(m_scale != 0 ? m_scale : 1 / sqrt((double)Input(1)->GetSampleLayout().GetNumElements()));
+}
+
+template <class ElemType>
+void ScaledDotProductAttentionNode<ElemType>::ForwardPropNonLooping()
+{
+    m_gradientsComputedYet = false;
+    Value().SetValue(0); // gaps, and queries with no keys to attend to
+
+    PackSequences();
+    if (m_queryIndices->GetNumCols() == 0 || m_keyIndices->GetNumCols() == 0)
+        return;
+
+    m_packedQuery->DoGatherColumnsOf(0, *m_queryIndices, InputRef(0).Value(), 1);
+    m_packedKey->DoGatherColumnsOf(0, *m_keyIndices, InputRef(1).Value(), 1);
+    m_packedValue->DoGatherColumnsOf(0, *m_keyIndices, InputRef(2).Value(), 1);
+    m_packedOutput->Resize(m_packedValue->GetNumRows(), m_packedQuery->GetNumCols());
+    m_logSumExp->Resize(1, m_packedQuery->GetNumCols());
+
+    if (HasSequenceWithoutKeys())
+        m_packedOutput->SetValue(0);
+
+    let scale = GetScale();
+    for (let& sequence : m_sequences)
+    {
+        if (sequence.m_numKeys > 0)
+            ForwardSequence(sequence, scale);
+    }
+
+    Value().DoScatterColumnsOf(1, *m_queryIndices, *m_packedOutput, 1, /*idxHaveDups=*/false);
+}
+
+template <class ElemType>
+void ScaledDotProductAttentionNode<ElemType>::ForwardSequence(const SequencePair& sequence, ElemType scale)
+{
+    let query = ColumnsView(m_packedQuery, sequence.m_queryBegin, sequence.m_numQueries);
+    auto output = ColumnsView(m_packedOutput, sequence.m_queryBegin, sequence.m_numQueries);
+    auto logSumExp = ColumnsView(m_logSumExp, sequence.m_queryBegin, sequence.m_numQueries);
+    m_queryStatistic->Resize(1, sequence.m_numQueries);
+    auto blockLogSumExp = ColumnsView(m_queryStatistic, 0, sequence.m_numQueries);
+
+    for (size_t begin = 0; begin < sequence.m_numKeys; begin += m_blockSize)
+    {
+        let numKeys = std::min(m_blockSize, sequence.m_numKeys - begin);
+        let key = ColumnsView(m_packedKey, sequence.m_keyBegin + begin, numKeys);
+        let value = ColumnsView(m_packedValue, sequence.m_keyBegin + begin, numKeys);
+        m_scores->Resize(numKeys, sequence.m_numQueries);
+        auto scores = ColumnsView(m_scores, 0, sequence.m_numQueries);
+
+        // scores = scale * key^T * query, and their log-sum-exp over the keys of the block
+        scores.AssignMatrixProductOf(false, key, true, query, false, scale);
+        blockLogSumExp.DoUnaryOpOf(0, scores, 1, ElementWiseOperator::opCopy, ElementWiseOperator::opLogSum);
+
+        // fold the block into the running log-sum-exp and rescale the output accumulated so far to it
+        let isFirstBlock = begin == 0;
+        if (!isFirstBlock)
+        {
+            blockLogSumExp.AssignLogSumOf(logSumExp, blockLogSumExp);
+            output.AssignElementwiseProductWithExpOfDiffOf(output, logSumExp, blockLogSumExp);
+        }
+        logSumExp.AssignCopyOf(blockLogSumExp);
+
+        // output += value * softmax weights of the block
+        scores.AssignDifferenceOf(scores, logSumExp);
+        scores.AssignExpOf(scores);
+        output.DoMatrixProductOf(isFirstBlock ? 0 : 1, false, value, false, scores, false, 1);
+    }
+}
+
+template <class ElemType>
+void ScaledDotProductAttentionNode<ElemType>::BackpropToNonLooping(size_t inputIndex)
+{
+    if (m_queryIndices->GetNumCols() == 0 || m_keyIndices->GetNumCols() == 0)
+        return;
+
+    // all gradients come out of the same pass over the blocks, so compute them at the first call
+    if (!m_gradientsComputedYet)
+    {
+        m_packedOutputGradient->DoGatherColumnsOf(0, *m_queryIndices, Gradient(), 1);
+        m_packedQueryGradient->Resize(*m_packedQuery);
+        m_packedKeyGradient->Resize(*m_packedKey);
+        m_packedValueGradient->Resize(*m_packedValue);
+        if (HasSequenceWithoutKeys())
+            m_packedQueryGradient->SetValue(0);
+
+        let scale = GetScale();
+        for (let& sequence : m_sequences)
+        {
+            if (sequence.m_numKeys > 0)
+                BackpropSequence(sequence, scale);
+        }
+        m_gradientsComputedYet = true;
+    }
+
+    let& packedGradient = inputIndex == 0 ? *m_packedQueryGradient : inputIndex == 1 ? *m_packedKeyGradient : *m_packedValueGradient;
+    let& indices = inputIndex == 0 ? *m_queryIndices : *m_keyIndices;
+    InputRef(inputIndex).Gradient().DoScatterColumnsOf(1, indices, packedGradient, 1, /*idxHaveDups=*/false);
+}
+
+template <class ElemType>
+void ScaledDotProductAttentionNode<ElemType>::BackpropSequence(const SequencePair& sequence, ElemType scale)
+{
+    let query = ColumnsView(m_packedQuery, sequence.m_queryBegin, sequence.m_numQueries);
+    let output = ColumnsView(m_packedOutput, sequence.m_queryBegin, sequence.m_numQueries);
+    let outputGradient = ColumnsView(m_packedOutputGradient, sequence.m_queryBegin, sequence.m_numQueries);
+    let logSumExp = ColumnsView(m_logSumExp, sequence.m_queryBegin, sequence.m_numQueries);
+    auto queryGradient = ColumnsView(m_packedQueryGradient, sequence.m_queryBegin, sequence.m_numQueries);
+
+    // delta = sum over the rows of outputGradient .* output, the gradient of the softmax normalization
+    m_queryStatistic->Resize(1, sequence.m_numQueries);
+    auto delta = ColumnsView(m_queryStatistic, 0, sequence.m_numQueries);
+    delta.AssignElementwiseProductOf(outputGradient, output);
+
+    for (size_t begin = 0; begin < sequence.m_numKeys; begin += m_blockSize)
+    {
+        let numKeys = std::min(m_blockSize, sequence.m_numKeys - begin);
+        let key = ColumnsView(m_packedKey, sequence.m_keyBegin + begin, numKeys);
+        let value = ColumnsView(m_packedValue, sequence.m_keyBegin + begin, numKeys);
+        auto keyGradient = ColumnsView(m_packedKeyGradient, sequence.m_keyBegin + begin, numKeys);
+        auto valueGradient = ColumnsView(m_packedValueGradient, sequence.m_keyBegin + begin, numKeys);
+        m_scores->Resize(numKeys, sequence.m_numQueries);
+        m_scoresGradient->Resize(numKeys, sequence.m_numQueries);
+        auto weights = ColumnsView(m_scores, 0, sequence.m_numQueries);
+        auto scoresGradient = ColumnsView(m_scoresGradient, 0, sequence.m_numQueries);
+
+        // recompute the softmax weights of the block
+        weights.AssignMatrixProductOf(false, key, true, query, false, scale);
+        weights.AssignDifferenceOf(weights, logSumExp);
+        weights.AssignExpOf(weights);
+
+        // valueGradient = outputGradient * weights^T
+        valueGradient.AssignMatrixProductOf(false, outputGradient, false, weights, true);
+
+        // scoresGradient = weights .* (value^T * outputGradient - delta)
+        scoresGradient.AssignMatrixProductOf(false, value, true, outputGradient, false);
+        scoresGradient.AssignDifferenceOf(scoresGradient, delta);
+        scoresGradient.AssignElementwiseProductOf(scoresGradient, weights);
+
+        // queryGradient += scale * key * scoresGradient, keyGradient = scale * query * scoresGradient^T
+        queryGradient.DoMatrixProductOf(begin == 0 ? 0 : 1, false, key, false, scoresGradient, false, scale);
+        keyGradient.AssignMatrixProductOf(false, query, false, scoresGradient, true, scale);
+    }
+}
+
+template <class ElemType>
+void ScaledDotProductAttentionNode<ElemType>::Validate(bool isFinalValidationPass)
+{
+    ComputationNodeBase::Validate(isFinalValidationPass);
+
+    // the output is a value for each query
+    m_pMBLayout = Input(0)->GetMBLayout();
+    if (isFinalValidationPass)
+    {
+        if (!Input(0)->HasMBLayout() || !Input(1)->HasMBLayout())
+            InvalidArgument("%ls %ls operation requires the query, key and value to be sequences.", NodeName().c_str(), OperationName().c_str());
+        if (Input(1)->GetMBLayout() != Input(2)->GetMBLayout())
+            InvalidArgument("%ls %ls operation requires the key and value to have the same dynamic axis.", NodeName().c_str(), OperationName().c_str());
+        if (Input(0)->GetSampleLayout().GetNumElements() != Input(1)->GetSampleLayout().GetNumElements())
+            InvalidArgument("%ls %ls operation requires the query and key to have the same dimension, but they are [%s] and [%s].", NodeName().c_str(), OperationName().c_str(),
+                            string(Input(0)->GetSampleLayout()).c_str(), string(Input(1)->GetSampleLayout()).c_str());
+        if (Input(0)->IsValueSparse() || Input(1)->IsValueSparse() || Input(2)->IsValueSparse())
+            InvalidArgument("%ls %ls operation does not support sparse inputs.", NodeName().c_str(), OperationName().c_str());
+    }
+
+    SetDims(Input(2)->GetSampleLayout(), HasMBLayout());
+}
+
+template <class ElemType>
+void ScaledDotProductAttentionNode<ElemType>::CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const
+{
+    Base::CopyTo(nodeP, newName, flags);
+    if (flags & CopyNodeFlags::copyNodeValue)
+    {
+        auto node = nodeP->As<ScaledDotProductAttentionNode<ElemType>>();
+        node->m_scale = m_scale;
+        node->m_blockSize = m_blockSize;
+    }
+}
+
+template <class ElemType>
+void ScaledDotProductAttentionNode<ElemType>::Save(File& fstream) const
+{
+    Base::Save(fstream);
+    fstream << m_scale;
+    fstream << m_blockSize;
+}
+
+template <class ElemType>
+void ScaledDotProductAttentionNode<ElemType>::Load(File& fstream, size_t modelVersion)
+{
+    Base::Load(fstream, modelVersion);
+    fstream >> m_scale;
+    fstream >> m_blockSize;
+}
+
+template <class ElemType>
+void ScaledDotProductAttentionNode<ElemType>::RequestMatricesBeforeForwardProp(MatrixPool& matrixPool)
+{
+    Base::RequestMatricesBeforeForwardProp(matrixPool);
+    RequestMatrixFromPool(m_queryIndices, matrixPool, 1, HasMBLayout());
+    RequestMatrixFromPool(m_keyIndices, matrixPool, 1, InputRef(1).HasMBLayout());
+    RequestMatrixFromPool(m_packedQuery, matrixPool, InputRef(0).GetSampleLayout().GetNumElements(), HasMBLayout());
+    RequestMatrixFromPool(m_packedKey, matrixPool, InputRef(1).GetSampleLayout().GetNumElements(), InputRef(1).HasMBLayout());
+    RequestMatrixFromPool(m_packedValue, matrixPool, InputRef(2).GetSampleLayout().GetNumElements(), InputRef(2).HasMBLayout());
+    RequestMatrixFromPool(m_packedOutput, matrixPool, GetSampleLayout().GetNumElements(), HasMBLayout());
+    RequestMatrixFromPool(m_logSumExp, matrixPool, 1, HasMBLayout());
+    RequestMatrixFromPool(m_scores, matrixPool, m_blockSize, HasMBLayout());
+    RequestMatrixFromPool(m_queryStatistic, matrixPool, 1, HasMBLayout());
+}
+
+template <class ElemType>
+void ScaledDotProductAttentionNode<ElemType>::RequestMatricesBeforeBackprop(MatrixPool& matrixPool)
+{
+    Base::RequestMatricesBeforeBackprop(matrixPool);
+    RequestMatrixFromPool(m_scoresGradient, matrixPool, m_blockSize, HasMBLayout(), /*isWorkSpace=*/true);
+    RequestMatrixFromPool(m_packedOutputGradient, matrixPool, GetSampleLayout().GetNumElements(), HasMBLayout());
+    RequestMatrixFromPool(m_packedQueryGradient, matrixPool, InputRef(0).GetSampleLayout().GetNumElements(), HasMBLayout());
+    RequestMatrixFromPool(m_packedKeyGradient, matrixPool, InputRef(1).GetSampleLayout().GetNumElements(), InputRef(1).HasMBLayout());
+    RequestMatrixFromPool(m_packedValueGradient, matrixPool, InputRef(2).GetSampleLayout().GetNumElements(), InputRef(2).HasMBLayout());
+}
+
+template <class ElemType>
+void ScaledDotProductAttentionNode<ElemType>::ReleaseMatricesAfterBackprop(MatrixPool& matrixPool)
+{
+    Base::ReleaseMatricesAfterBackprop(matrixPool);
+    for (auto matrix : { &m_queryIndices, &m_keyIndices, &m_packedQuery, &m_packedKey, &m_packedValue, &m_packedOutput, &m_logSumExp,
+                         &m_scores, &m_queryStatistic, &m_scoresGradient, &m_packedOutputGradient,
+                         &m_packedQueryGradient, &m_packedKeyGradient, &m_packedValueGradient })
+        ReleaseMatrixToPool(*matrix, matrixPool);
+}
+
+template class ScaledDotProductAttentionNode<float>;
+template class ScaledDotProductAttentionNode<double>;
+template class ScaledDotProductAttentionNode<half>;
@@ -21,6 +21,7 @@
 #include <assert.h>
 #include <set>
 #include "Quantizers.h"
+#include "BlockSparseOperations.h"
 #include "InputAndParamNodes.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -30,7 +31,7 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class PlusNode : public BinaryElementWiseNode<ElemType>
+class PlusNode : public BinaryElementWiseNode<ElemType>, public IElementwiseNode
 {
     typedef BinaryElementWiseNode<ElemType> Base; UsingBinaryElementwiseNodeBaseMembers;
     static const std::wstring TypeName() { return L"Plus"; }
@@ -51,6 +52,8 @@ public:
         result.AssignSumOf(input0, input1);
     }
 
+    ElementWiseOperator /*IElementwiseNode::*/GetElementwiseOperator() const override { return ElementWiseOperator::opSum; }
+
     virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override
     {
         size_t rank = DetermineElementwiseTensorRank();
@@ -235,7 +238,7 @@ template class PowNode<half>;
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class MinusNode : public BinaryElementWiseNode<ElemType>
+class MinusNode : public BinaryElementWiseNode<ElemType>, public IElementwiseNode
 {
     typedef BinaryElementWiseNode<ElemType> Base; UsingBinaryElementwiseNodeBaseMembers;
     static const std::wstring TypeName() { return L"Minus"; }
@@ -256,6 +259,8 @@ public:
         result.AssignDifferenceOf(input0, input1);
     }
 
+    ElementWiseOperator /*IElementwiseNode::*/GetElementwiseOperator() const override { return ElementWiseOperator::opDifference; }
+
     virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override
     {
         size_t rank = DetermineElementwiseTensorRank();
@@ -299,7 +304,7 @@ template class MinusNode<half>;
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class ElementTimesNode : public BinaryElementWiseNode<ElemType>
+class ElementTimesNode : public BinaryElementWiseNode<ElemType>, public IElementwiseNode
 {
     typedef BinaryElementWiseNode<ElemType> Base;
     UsingBinaryElementwiseNodeBaseMembers;
@@ -320,6 +325,8 @@ public:
         ForwardPropImpl(*this, fr, true/*allowBroadcast*/);
     }
 
+    ElementWiseOperator /*IElementwiseNode::*/GetElementwiseOperator() const override { return ElementWiseOperator::opElementwiseProduct; }
+
     virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override
     {
         BackpropToImpl(*this, inputIndex, fr, true/*allowBroadcast*/);
@@ -393,7 +400,7 @@ public:
 
 public:
     TimesNodeBase(DEVICEID_TYPE deviceId, const wstring& name, size_t outputRank = 1, int inferInputRankToMap = NoInferredInputRank)
-        : Base(deviceId, name), m_outputRank(outputRank), m_inferInputRankToMap(inferInputRankToMap), m_beingUnrolled(false)
+        : Base(deviceId, name), m_outputRank(outputRank), m_inferInputRankToMap(inferInputRankToMap), m_beingUnrolled(false), m_int8Generation(0), m_blockSparseGeneration(0)
     {
     }
 
@@ -555,7 +562,16 @@ private:
         const Matrix<ElemType>& mat0 = unpackedInput[0].GetSOB();
         const Matrix<ElemType>& mat1 = unpackedInput[1].GetSOB();
 
-        // unroll in the batch axis, we may use batched GEMM in future
+        // one batched GEMM over the b* sequences, each an (m x (k * s*)) x ((k * s*) x 1) product
+        if (mat0.GetMatrixType() == DENSE)
+        {
+            Matrix<ElemType> mat0Batch = SequencesAsBatch(mat0, maxNumTimeSteps, numSequences); // (m * k * s*) x b*
+            Matrix<ElemType> mat1Batch = SequencesAsBatch(mat1, maxNumTimeSteps, numSequences); // (k * s*) x b*
+            Matrix<ElemType>::BatchMatMul(0, mat0Batch, false, (int)m, mat1Batch, false, 1, Value(), true);
+            return;
+        }
+
+        // sparse left operand: unroll in the batch axis
         for (int s = 0; s < numSequences; s++)
         {
             Matrix<ElemType> mat0Slice = mat0.ColumnSlice(s * maxNumTimeSteps, maxNumTimeSteps); // (m * k) x s*
@@ -568,6 +584,14 @@ private:
         }
     }
 
+    // views the unpacked D x (s* x b*) columns of a matrix as (D * s*) x b*, with one column per sequence for BatchMatMul()
+    static Matrix<ElemType> SequencesAsBatch(const Matrix<ElemType>& unpacked, size_t maxNumTimeSteps, size_t numSequences)
+    {
+        Matrix<ElemType> batch = unpacked.ColumnSlice(0, maxNumTimeSteps * numSequences);
+        batch.Reshape(unpacked.GetNumRows() * maxNumTimeSteps, numSequences);
+        return batch;
+    }
+
     void BackpropTo_ReduceSequenceAxis(size_t inputIndex)
     {
         auto input0MBLayout = InputRef(0).GetMBLayout();
@@ -604,14 +628,24 @@ private:
             Matrix<ElemType> tempGradientUnpacked(m * k, maxNumTimeSteps * numSequences, InputRef(inputIndex).GetDeviceId());
             Matrix<ElemType>& inputGradientUnpacked = unpacked[inputIndex] ? tempGradientUnpacked : InputRef(inputIndex).Gradient();
 
-            for (int s = 0; s < numSequences; s++)
+            if (inputGradientUnpacked.GetMatrixType() == DENSE)
             {
-                Matrix<ElemType> inputGradientSlice = inputGradientUnpacked.ColumnSlice(s * maxNumTimeSteps, maxNumTimeSteps); // (m * k) x s*
-                inputGradientSlice.Reshape(m, k * maxNumTimeSteps); // m x (k * s*)
-                Matrix<ElemType> inputValueSlice = unpackedInputValue.ColumnSlice(s * maxNumTimeSteps, maxNumTimeSteps); // k x s*
-                inputValueSlice.Reshape(k * maxNumTimeSteps, 1); // (k * s*) x 1
-                Matrix<ElemType> gradientSlice = Gradient().ColumnSlice(s, 1); // m x 1
-                Matrix<ElemType>::MultiplyAndWeightedAdd(1, gradientSlice, false, inputValueSlice, true, unpacked[inputIndex] ? (ElemType)0 : beta, inputGradientSlice);
+                // one batched GEMM, for each sequence (m x 1) x (1 x (k * s*))
+                Matrix<ElemType> inputGradientBatch = SequencesAsBatch(inputGradientUnpacked, maxNumTimeSteps, numSequences); // (m * k * s*) x b*
+                Matrix<ElemType> inputValueBatch = SequencesAsBatch(unpackedInputValue, maxNumTimeSteps, numSequences);       // (k * s*) x b*
+                Matrix<ElemType>::BatchMatMul(unpacked[inputIndex] ? (ElemType)0 : beta, Gradient(), false, (int)m, inputValueBatch, true, (int)(k * maxNumTimeSteps), inputGradientBatch, true);
+            }
+            else
+            {
+                for (int s = 0; s < numSequences; s++)
+                {
+                    Matrix<ElemType> inputGradientSlice = inputGradientUnpacked.ColumnSlice(s * maxNumTimeSteps, maxNumTimeSteps); // (m * k) x s*
+                    inputGradientSlice.Reshape(m, k * maxNumTimeSteps); // m x (k * s*)
+                    Matrix<ElemType> inputValueSlice = unpackedInputValue.ColumnSlice(s * maxNumTimeSteps, maxNumTimeSteps); // k x s*
+                    inputValueSlice.Reshape(k * maxNumTimeSteps, 1); // (k * s*) x 1
+                    Matrix<ElemType> gradientSlice = Gradient().ColumnSlice(s, 1); // m x 1
+                    Matrix<ElemType>::MultiplyAndWeightedAdd(1, gradientSlice, false, inputValueSlice, true, unpacked[inputIndex] ? (ElemType)0 : beta, inputGradientSlice);
+                }
             }
 
             if (unpacked[inputIndex])
@@ -622,14 +656,24 @@ private:
             Matrix<ElemType> tempGradientUnpacked(k, maxNumTimeSteps * numSequences, InputRef(inputIndex).GetDeviceId());
             Matrix<ElemType>& inputGradientUnpacked = unpacked[inputIndex] ? tempGradientUnpacked : InputRef(inputIndex).Gradient();
 
-            for (int s = 0; s < numSequences; s++)
+            if (unpackedInputValue.GetMatrixType() == DENSE)
             {
-                Matrix<ElemType> inputGradientSlice = inputGradientUnpacked.ColumnSlice(s * maxNumTimeSteps, maxNumTimeSteps); // k x s*
-                inputGradientSlice.Reshape(k * maxNumTimeSteps, 1); // (k * s*) x 1
-                Matrix<ElemType> inputValueSlice = unpackedInputValue.ColumnSlice(s * maxNumTimeSteps, maxNumTimeSteps); // (m * k) x s*
-                inputValueSlice.Reshape(m, k * maxNumTimeSteps); // m x (k * s*)
-                Matrix<ElemType> gradientSlice = Gradient().ColumnSlice(s, 1); // m x 1
-                Matrix<ElemType>::MultiplyAndWeightedAdd(1, inputValueSlice, true, gradientSlice, false, unpacked[inputIndex] ? (ElemType)0 : beta, inputGradientSlice);
+                // one batched GEMM, for each sequence ((k * s*) x m) x (m x 1)
+                Matrix<ElemType> inputGradientBatch = SequencesAsBatch(inputGradientUnpacked, maxNumTimeSteps, numSequences); // (k * s*) x b*
+                Matrix<ElemType> inputValueBatch = SequencesAsBatch(unpackedInputValue, maxNumTimeSteps, numSequences);       // (m * k * s*) x b*
+                Matrix<ElemType>::BatchMatMul(unpacked[inputIndex] ? (ElemType)0 : beta, inputValueBatch, true, (int)(k * maxNumTimeSteps), Gradient(), false, 1, inputGradientBatch, true);
+            }
+            else
+            {
+                for (int s = 0; s < numSequences; s++)
+                {
+                    Matrix<ElemType> inputGradientSlice = inputGradientUnpacked.ColumnSlice(s * maxNumTimeSteps, maxNumTimeSteps); // k x s*
+                    inputGradientSlice.Reshape(k * maxNumTimeSteps, 1); // (k * s*) x 1
+                    Matrix<ElemType> inputValueSlice = unpackedInputValue.ColumnSlice(s * maxNumTimeSteps, maxNumTimeSteps); // (m * k) x s*
+                    inputValueSlice.Reshape(m, k * maxNumTimeSteps); // m x (k * s*)
+                    Matrix<ElemType> gradientSlice = Gradient().ColumnSlice(s, 1); // m x 1
+                    Matrix<ElemType>::MultiplyAndWeightedAdd(1, inputValueSlice, true, gradientSlice, false, unpacked[inputIndex] ? (ElemType)0 : beta, inputGradientSlice);
+                }
             }
             
             if (unpacked[inputIndex])
@@ -713,7 +757,61 @@ public:
         auto input0 = OneSampleTensorFor(0,  /*gradient=*/false, fr.AllowBroadcast());
         auto input1 = OneSampleTensorFor(1,  /*gradient=*/false, fr.AllowBroadcast());
         auto output = OneSampleTensorFor(-1, /*gradient=*/false, fr);
-        output.AssignMatrixProductOf(false/*transC*/, input0, m_transpose/*transA*/, input1, false/*transB*/, 1.0f, this->m_pQuantizedMultiplier);
+        output.AssignMatrixProductOf(false/*transC*/, input0, m_transpose/*transA*/, input1, false/*transB*/, 1.0f, GetQuantizedMultiplier());
+    }
+
+    // The multiplier for the product in ForwardProp(): the one of QuantizedTimesNode if any, else the int8 one if
+    // Globals::ShouldUseInt8Inference() is set, else the block sparse one if Globals::ShouldUseBlockSparseInference() is set
+    // and the weights are sparse enough, if this is a product of weights with dense data on the CPU during inference.
+    shared_ptr<QuantizedMultiplier<ElemType>> GetQuantizedMultiplier()
+    {
+        if (m_pQuantizedMultiplier)
+            return m_pQuantizedMultiplier;
+
+        bool canUseWeightMultiplier = !m_transpose &&
+                                      Base::HasEnvironmentPtr() && Base::Environment().IsInferring() &&
+                                      dynamic_pointer_cast<LearnableParameter<ElemType>>(Input(0)) &&
+                                      InputRef(0).Value().GetDeviceId() == CPUDEVICE &&
+                                      InputRef(0).Value().GetMatrixType() == DENSE && InputRef(1).Value().GetMatrixType() == DENSE;
+        if (!canUseWeightMultiplier)
+            return nullptr;
+
+        if (Globals::ShouldUseInt8Inference())
+        {
+            // the weights are quantized again each time int8 inference is enabled
+            if (!m_int8Multiplier || m_int8Generation != Globals::GetInt8InferenceGeneration())
+            {
+                m_int8Multiplier = NewInt8QuantizedMultiplier<ElemType>();
+                m_int8Generation = Globals::GetInt8InferenceGeneration();
+            }
+            return m_int8Multiplier;
+        }
+
+        if (Globals::ShouldUseBlockSparseInference())
+        {
+            // the density of the weights is measured again each time block sparse inference is enabled,
+            // and the dense product is kept for the weights that are not sparse enough
+            if (m_blockSparseGeneration != Globals::GetBlockSparseInferenceGeneration())
+            {
+                m_blockSparseGeneration = Globals::GetBlockSparseInferenceGeneration();
+                m_blockSparseMultiplier = NewBlockSparseMultiplier<ElemType>(Globals::GetBlockSparseRows(), Globals::GetBlockSparseCols());
+                if (m_blockSparseMultiplier)
+                {
+                    // the weights as the [m x k] matrix of the product, with the first m_outputRank dimensions as rows
+                    const auto& weights = InputRef(0).Value();
+                    const auto& shape = InputRef(0).GetSampleLayout();
+                    size_t m = 1;
+                    for (size_t i = 0; i < m_outputRank && i < shape.GetRank(); i++)
+                        m *= shape[i];
+                    size_t k = m == 0 ? 0 : weights.GetNumElements() / m;
+                    if (k == 0 || m * k != weights.GetNumElements() ||
+                        m_blockSparseMultiplier->Prepare((int)m, (int)k, weights.Data()) > Globals::GetBlockSparseMaxDensity())
+                        m_blockSparseMultiplier = nullptr;
+                }
+            }
+            return m_blockSparseMultiplier;
+        }
+        return nullptr;
     }
 
     virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override
@@ -1050,6 +1148,9 @@ public:
         ReleaseReduceSequenceAxisMatricesIfNeeded(matrixPool);
     }
 
+    // the sequence-axis reduction temporaries are handed back to the pool right after forward prop
+    bool IsForwardPropRecomputable() const override { return !ReduceSequenceAxis() && Base::IsForwardPropRecomputable(); }
+
     void RequestMatricesBeforeBackprop(MatrixPool& matrixPool) override
     {
         Base::RequestMatricesBeforeBackprop(matrixPool);
@@ -1073,6 +1174,10 @@ private:
     int m_inferInputRankToMap;  // -1 (not specified) or says how to expand shape of W, to keep this many mapping dims
     bool m_beingUnrolled;
     std::once_flag m_unrollWarningOnceFlag;
+    shared_ptr<QuantizedMultiplier<ElemType>> m_int8Multiplier; // see GetQuantizedMultiplier()
+    size_t m_int8Generation;
+    shared_ptr<BlockSparseMultiplier<ElemType>> m_blockSparseMultiplier; // see GetQuantizedMultiplier(), nullptr if the weights are dense
+    size_t m_blockSparseGeneration;
 
     bool ReduceSequenceAxis() const { return m_inferInputRankToMap == ReduceSequenceAxisWithoutInferredInputRank; }
 
@@ -1940,6 +2045,96 @@ void AggregateAccumulatorValuesAndUpdateEvaluation(
     shared_ptr<MPIWrapper> mpi,
     size_t packThresholdSizeInBytes = (size_t)DEFAULT_PACK_THRESHOLD_SIZE_IN_BYTES);
 
+// -----------------------------------------------------------------------
+// ScaledDotProductAttentionNode (query, key, value)
+// Attention of each query over the keys of its sequence. For the n-th sequence of the query,
+//   output[:, t] = value_n * softmax(scale * key_n^T * query[:, t])
+// where key_n and value_n are the n-th sequences of key and value. Key and value share a dynamic axis;
+// it may differ from the one of the query, in which case the sequences are paired by their order in the minibatch.
+// 'scale' defaults to 1/sqrt(dimension of query and key).
+// The score matrix of a sequence is never materialized. The keys are processed in blocks of 'blockSize'
+// against all queries of the sequence, keeping a running log-sum-exp per query that rescales the partial
+// output (online softmax). Backprop recomputes the scores of each block from the final log-sum-exp.
+// Memory is thus O(T * blockSize) per sequence instead of O(T^2).
+// The sequences must not be truncated.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class ScaledDotProductAttentionNode : public ComputationNodeNonLooping<ElemType>, public NumInputs<3>
+{
+    typedef ComputationNodeNonLooping<ElemType> Base; UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"ScaledDotProductAttention"; }
+
+public:
+    ScaledDotProductAttentionNode(DEVICEID_TYPE deviceId, const wstring& name, double scale = 0, size_t blockSize = 64);
+
+    ScaledDotProductAttentionNode(const ScriptableObjects::IConfigRecordPtr configp);
+
+    virtual void /*ComputationNodeNonLooping::*/ ForwardPropNonLooping() override;
+
+    virtual void /*ComputationNodeNonLooping::*/ BackpropToNonLooping(size_t inputIndex) override;
+
+    // backprop uses the packed copies of the inputs and output made in forward prop
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
+
+    virtual void Validate(bool isFinalValidationPass) override;
+
+    virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override;
+
+    virtual void Save(File& fstream) const override;
+    virtual void Load(File& fstream, size_t modelVersion) override;
+
+    virtual void RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) override;
+    virtual void RequestMatricesBeforeBackprop(MatrixPool& matrixPool) override;
+    virtual void ReleaseMatricesAfterBackprop(MatrixPool& matrixPool) override;
+
+    double Scale() const { return m_scale; }
+    size_t BlockSize() const { return m_blockSize; }
+
+private:
+    // A pair of a query sequence and the key/value sequence it attends to, as columns of the packed matrices.
+    struct SequencePair
+    {
+        size_t m_queryBegin;
+        size_t m_numQueries;
+        size_t m_keyBegin;
+        size_t m_numKeys;
+    };
+
+    // Pairs the sequences of the minibatch and builds the indices that pack each of them into consecutive columns.
+    void PackSequences();
+
+    bool HasSequenceWithoutKeys() const;
+    ElemType GetScale() const;
+
+    void ForwardSequence(const SequencePair& sequence, ElemType scale);
+    void BackpropSequence(const SequencePair& sequence, ElemType scale);
+
+    double m_scale;     // 0 means 1/sqrt(dimension of the key)
+    size_t m_blockSize; // number of keys per block
+
+    std::vector<SequencePair> m_sequences;
+    bool m_gradientsComputedYet;
+
+    // packing indices, and the inputs and output packed sequence by sequence
+    shared_ptr<Matrix<ElemType>> m_queryIndices;
+    shared_ptr<Matrix<ElemType>> m_keyIndices;
+    shared_ptr<Matrix<ElemType>> m_packedQuery;
+    shared_ptr<Matrix<ElemType>> m_packedKey;
+    shared_ptr<Matrix<ElemType>> m_packedValue;
+    shared_ptr<Matrix<ElemType>> m_packedOutput;
+    shared_ptr<Matrix<ElemType>> m_logSumExp; // of the scores of each query, transfers data between forward prop and backprop
+    // the rest are temporaries, values don't need to be maintained
+    shared_ptr<Matrix<ElemType>> m_scores;    // [blockSize x numQueries] of a block of keys
+    shared_ptr<Matrix<ElemType>> m_scoresGradient;
+    shared_ptr<Matrix<ElemType>> m_queryStatistic; // [1 x numQueries]
+    shared_ptr<Matrix<ElemType>> m_packedOutputGradient;
+    shared_ptr<Matrix<ElemType>> m_packedQueryGradient;
+    shared_ptr<Matrix<ElemType>> m_packedKeyGradient;
+    shared_ptr<Matrix<ElemType>> m_packedValueGradient;
+};
+
 // -----------------------------------------------------------------------
 // EpochAccumulatorNode calculates mean values of all samples used in forward pass.
 // During training, mean sample value is calculated in each epoch. Value of the node will contain mean sample value of
@@ -9,9 +9,11 @@
 #include <stdexcept>
 #include <vector>
 #include <set>
+#include <map>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <tuple>
 #include <algorithm>
 #include <stdlib.h>
 
@@ -32,8 +34,9 @@ struct MemRequestInfo
     int allocStep;                              // at what step counter memory allocation is requested 
     int releaseStep;                            // at what step counter memory release is requested  
     int memoryId;                               // integer indexing the memory buffer ID 
-    MemRequestInfo(DEVICEID_TYPE deviceId, shared_ptr<Matrix<ElemType>>*pMatrixPtr, size_t matrixSize, bool mbScale, bool isWorkSpace, int allocStep)
-        :deviceId(deviceId), matrixSize(matrixSize), mbScale(mbScale), isWorkSpace(isWorkSpace), allocStep(allocStep), releaseStep(INT_MAX), memoryId(-1)
+    const void* owner;                          // node whose forward prop requested the memory, see MatrixPool::SetRequestOwner()
+    MemRequestInfo(DEVICEID_TYPE deviceId, shared_ptr<Matrix<ElemType>>*pMatrixPtr, size_t matrixSize, bool mbScale, bool isWorkSpace, int allocStep, const void* owner = nullptr)
+        :deviceId(deviceId), matrixSize(matrixSize), mbScale(mbScale), isWorkSpace(isWorkSpace), allocStep(allocStep), releaseStep(INT_MAX), memoryId(-1), owner(owner)
     {
         pMatrixPtrs.push_back(pMatrixPtr);
     }
@@ -61,6 +64,112 @@ struct MemAllocInfo
     }
 };
 
+// MemoryPlanSummary -- peak memory of one pool as estimated by different sharing strategies.
+// Sizes are in elements, using the size estimates given to RequestAllocate(). Only requests that
+// scale with the minibatch size are included (in elements per sample), since those dominate memory
+// and their absolute size is not known when the plan is made.
+struct MemoryPlanSummary
+{
+    size_t naivePeak = 0;   // no sharing at all: sum of all request sizes
+    size_t sharedPeak = 0;  // whole-matrix sharing as done by MatrixPool: sum over shared matrices of their largest user
+    size_t plannedPeak = 0; // offset-based interval packing into a single arena (see PlanMemoryOffsets())
+    size_t lowerBound = 0;  // maximum over time of the bytes that are live at the same time
+
+    MemoryPlanSummary& operator+=(const MemoryPlanSummary& other)
+    {
+        naivePeak += other.naivePeak;
+        sharedPeak += other.sharedPeak;
+        plannedPeak += other.plannedPeak;
+        lowerBound += other.lowerBound;
+        return *this;
+    }
+};
+
+// lifetime of one memory request; steps are inclusive on both ends, as in MatrixPool::CheckOverlap()
+struct MemoryLifetime
+{
+    int allocStep;
+    int releaseStep;
+    size_t size;
+
+    bool Overlaps(const MemoryLifetime& other) const { return allocStep <= other.releaseStep && releaseStep >= other.allocStep; }
+};
+
+// offset-based memory planning: treat the requests as intervals in time and place them into a single
+// arena such that requests that are alive at the same time do not overlap in memory.
+// Requests are placed from largest to smallest, each into the tightest gap (best fit) left between the
+// already placed requests it overlaps with in time, or on top of them if no gap is large enough.
+// Returns the arena size; 'offsets' receives the offset of each request.
+inline size_t PlanMemoryOffsets(const vector<MemoryLifetime>& requests, vector<size_t>& offsets)
+{
+    vector<size_t> order(requests.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&requests](size_t a, size_t b) { return requests[a].size > requests[b].size; });
+
+    offsets.assign(requests.size(), 0);
+    vector<size_t> placed;
+    size_t arenaSize = 0;
+    for (auto i : order)
+    {
+        const auto& request = requests[i];
+
+        // collect the memory ranges of all placed requests that are alive at the same time, sorted by offset
+        vector<pair<size_t, size_t>> conflicts;
+        for (auto j : placed)
+        {
+            if (request.Overlaps(requests[j]))
+                conflicts.push_back(make_pair(offsets[j], offsets[j] + requests[j].size));
+        }
+        std::sort(conflicts.begin(), conflicts.end());
+
+        size_t bestOffset = SIZE_MAX;
+        size_t bestGap = SIZE_MAX;
+        size_t end = 0; // end of the occupied memory seen so far
+        for (const auto& range : conflicts)
+        {
+            if (range.first > end)
+            {
+                size_t gap = range.first - end;
+                if (gap >= request.size && gap < bestGap)
+                {
+                    bestGap = gap;
+                    bestOffset = end;
+                }
+            }
+            end = max(end, range.second);
+        }
+        if (bestOffset == SIZE_MAX) // no gap fits: put it on top
+            bestOffset = end;
+
+        offsets[i] = bestOffset;
+        arenaSize = max(arenaSize, bestOffset + request.size);
+        placed.push_back(i);
+    }
+    return arenaSize;
+}
+
+// largest sum of sizes of requests alive at the same step; no plan can do better than this
+inline size_t ComputeMemoryLowerBound(const vector<MemoryLifetime>& requests)
+{
+    // sweep over alloc (+size) and release (-size) events; releases happen after the step they are marked with
+    vector<pair<int64_t, int64_t>> events;
+    for (const auto& request : requests)
+    {
+        events.push_back(make_pair((int64_t)request.allocStep * 2, (int64_t)request.size));
+        events.push_back(make_pair((int64_t)request.releaseStep * 2 + 1, -(int64_t)request.size));
+    }
+    std::sort(events.begin(), events.end());
+
+    int64_t live = 0, peak = 0;
+    for (const auto& event : events)
+    {
+        live += event.second;
+        peak = max(peak, live);
+    }
+    return (size_t)peak;
+}
+
 // MatrixPool -- class to support memory sharing
 // Despite the gather general name of this class, it is specifically designed to support the memory sharing of ComputationNodes.
 // Note: see #define SUPRESS_MEMSHARING below as for how to temporarily disable memory sharing altogether, for debugging
@@ -75,6 +184,7 @@ protected:
     vector<MemRequestInfo<half>> m_memRequestInfoHalfVec;
     set<DEVICEID_TYPE> m_deviceIDSet; 
     int m_stepCounter; 
+    AliasNodePtr m_requestOwner = nullptr;
 
     template <class ElemType>
     vector<MemRequestInfo<ElemType>>& GetMemRequestInfoVec();
@@ -95,15 +205,22 @@ protected:
     unordered_map<AliasNodePtr, AliasInfo> m_aliasGroups;
     unordered_map<AliasNodePtr, AliasNodePtr> m_aliasLookup;
 
+    MemoryPlanSummary m_memoryPlanSummary;
+
 public:
 
     void Reset()
     {
         m_stepCounter = 0;
+        m_requestOwner = nullptr;
         m_aliasGroups.clear();
         m_aliasLookup.clear();
+        m_memoryPlanSummary = MemoryPlanSummary();
     };
 
+    // peak memory estimates of the last OptimizedMemoryAllocation(), summed over devices and element types
+    const MemoryPlanSummary& GetMemoryPlanSummary() const { return m_memoryPlanSummary; }
+
     template <class ElemType>
     MemRequestInfo<ElemType>* GetMemInfo(shared_ptr<Matrix<ElemType>> *pMatrixPtr)
     {
@@ -138,7 +255,7 @@ public:
     void RequestAllocate(DEVICEID_TYPE deviceId, shared_ptr<Matrix<ElemType>>*pMatrixPtr, size_t matrixSize, bool mbScale, bool isWorkSpace)
     {
         vector<MemRequestInfo<ElemType>>& memInfoVec = GetMemRequestInfoVec<ElemType>(); 
-        MemRequestInfo<ElemType> memInfo(deviceId, pMatrixPtr, matrixSize, mbScale, isWorkSpace, m_stepCounter);
+        MemRequestInfo<ElemType> memInfo(deviceId, pMatrixPtr, matrixSize, mbScale, isWorkSpace, m_stepCounter, m_requestOwner);
         memInfoVec.push_back(memInfo); 
         m_deviceIDSet.insert(deviceId); 
         m_stepCounter++; 
@@ -147,6 +264,21 @@ public:
         *pMatrixPtr = make_shared<Matrix<ElemType>>(deviceId);
     }
 
+    // The node on whose behalf the following requests are made (nullptr: none). Set while simulating forward prop,
+    // so that multi-stream execution can order the nodes that share memory, see GetSharedMemoryOwners().
+    void SetRequestOwner(AliasNodePtr node) { m_requestOwner = node; }
+
+    // After OptimizedMemoryAllocation(): for each matrix shared by requests with an owner, the owners in the order
+    // of their requests. An owner writes the matrix first, after the previous user is done with it.
+    vector<vector<AliasNodePtr>> GetSharedMemoryOwners() const
+    {
+        vector<vector<AliasNodePtr>> owners;
+        GetSharedMemoryOwnersFunc(m_memRequestInfoFloatVec, owners);
+        GetSharedMemoryOwnersFunc(m_memRequestInfoDoubleVec, owners);
+        GetSharedMemoryOwnersFunc(m_memRequestInfoHalfVec, owners);
+        return owners;
+    }
+
     void OptimizedMemoryAllocation()
     {
         // MatrixPool is not templated, so we call both float and double versions here 
@@ -228,6 +360,28 @@ public:
     }
 
 private: 
+    template <class ElemType>
+    static void GetSharedMemoryOwnersFunc(const vector<MemRequestInfo<ElemType>>& memInfoVec, vector<vector<AliasNodePtr>>& owners)
+    {
+        // (device, workspace, memoryId) -> (alloc step, owner)
+        map<std::tuple<DEVICEID_TYPE, bool, int>, vector<pair<int, AliasNodePtr>>> requestsByMatrix;
+        for (const auto& memInfo : memInfoVec)
+        {
+            if (memInfo.memoryId >= 0 && memInfo.owner)
+                requestsByMatrix[std::make_tuple(memInfo.deviceId, memInfo.isWorkSpace, memInfo.memoryId)].push_back(make_pair(memInfo.allocStep, memInfo.owner));
+        }
+        for (auto& matrix : requestsByMatrix)
+        {
+            if (matrix.second.size() < 2)
+                continue;
+            std::sort(matrix.second.begin(), matrix.second.end());
+            vector<AliasNodePtr> matrixOwners;
+            for (const auto& request : matrix.second)
+                matrixOwners.push_back(request.second);
+            owners.push_back(move(matrixOwners));
+        }
+    }
+
     bool CheckOverlap(pair<int, int>occ, vector<pair<int, int>>&occVec)
     {
         bool bRet = false;
@@ -247,6 +401,33 @@ private:
         return bRet;
     }
 
+    // compare the sharing found by OptimizedMemoryAllocationFunc() with the offset-planned arena and the lower bound
+    template <class ElemType>
+    MemoryPlanSummary ComputeMemoryPlanSummary(const vector<MemRequestInfo<ElemType>>& memInfoVec, DEVICEID_TYPE devId, bool wsFlag)
+    {
+        MemoryPlanSummary summary;
+        vector<MemoryLifetime> lifetimes;
+        map<int, size_t> sharedSizes; // memoryId -> size of the largest request sharing it
+        for (const auto& memInfo : memInfoVec)
+        {
+            if (memInfo.deviceId != devId || memInfo.isWorkSpace != wsFlag || !memInfo.mbScale)
+                continue;
+
+            lifetimes.push_back(MemoryLifetime{ memInfo.allocStep, memInfo.releaseStep, memInfo.matrixSize });
+            summary.naivePeak += memInfo.matrixSize;
+            auto& sharedSize = sharedSizes[memInfo.memoryId];
+            sharedSize = max(sharedSize, memInfo.matrixSize);
+        }
+
+        for (const auto& sharedSize : sharedSizes)
+            summary.sharedPeak += sharedSize.second;
+
+        vector<size_t> offsets;
+        summary.plannedPeak = PlanMemoryOffsets(lifetimes, offsets);
+        summary.lowerBound = ComputeMemoryLowerBound(lifetimes);
+        return summary;
+    }
+
     template <class ElemType>
     void OptimizedMemoryAllocationFunc()
     {
@@ -368,6 +549,8 @@ private:
                     }
                 }
 
+                m_memoryPlanSummary += ComputeMemoryPlanSummary(memInfoVec, devId, wsFlag);
+
                 // now assign the actual pointers 
                 for (int i = 0; i < memoryCounter; i++)
                 {
@@ -37,7 +37,7 @@ enum GradientOperationType
 };
 
 template <class ElemType, ElementWiseOperator opForward, ElementWiseOperator opBackward, GradientOperationType opType>
-class UnaryElementWiseWithOpCodeNodeBase : public ComputationNode<ElemType>, public NumInputs<1>, public IdentityTransformerNode
+class UnaryElementWiseWithOpCodeNodeBase : public ComputationNode<ElemType>, public NumInputs<1>, public IdentityTransformerNode, public IElementwiseNode
 {
     typedef ComputationNode<ElemType> Base;
     UsingComputationNodeMembers;
@@ -56,6 +56,8 @@ public:
         result.DoUnaryOpOf(0, input, 1, opForward, opSum);
     }
 
+    ElementWiseOperator /*IElementwiseNode::*/GetElementwiseOperator() const override { return opForward; }
+
     virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override
     {
         assert(inputIndex == 0), inputIndex;
@@ -456,6 +458,8 @@ template class HardmaxNode<half>;
 
 
 
+// TopK (input, k) -- the k largest values along the first axis and their indices
+// With 'softmax', this is TopK (Softmax (input), k), where only the probabilities of the selected values are computed.
 template <class ElemType>
 class TopKNode : public ComputationNode<ElemType>, public MultiOutputNode<ElemType>, public NumInputs<1>
 {
@@ -463,20 +467,38 @@ class TopKNode : public ComputationNode<ElemType>, public MultiOutputNode<ElemTy
     static const std::wstring TypeName() { return L"TopK"; }
 
 public:
-    TopKNode(DEVICEID_TYPE deviceId, const wstring& name) : Base(deviceId, name), MultiOutputNode<ElemType>(2) {}
-    TopKNode(DEVICEID_TYPE deviceId, const wstring& name, size_t k)
-        : Base(deviceId, name), MultiOutputNode<ElemType>(2), m_k(k) {}
+    TopKNode(DEVICEID_TYPE deviceId, const wstring& name) : Base(deviceId, name), MultiOutputNode<ElemType>(2), m_softmax(false) {}
+    TopKNode(DEVICEID_TYPE deviceId, const wstring& name, size_t k, bool softmax = false)
+        : Base(deviceId, name), MultiOutputNode<ElemType>(2), m_k(k), m_softmax(softmax) {}
 
     virtual void RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) override
     {
         Base::RequestMatricesBeforeForwardProp(matrixPool);
         RequestMatrixFromPool(m_sortedIndices, matrixPool);
+        if (m_softmax)
+            RequestMatrixFromPool(m_logSumExp, matrixPool);
+    }
+
+    virtual void RequestMatricesBeforeBackprop(MatrixPool& matrixPool) override
+    {
+        Base::RequestMatricesBeforeBackprop(matrixPool);
+        if (m_softmax)
+        {
+            RequestMatrixFromPool(m_softmaxGradient, matrixPool);
+            RequestMatrixFromPool(m_softmaxGradientSum, matrixPool);
+        }
     }
 
     virtual void ReleaseMatricesAfterBackprop(MatrixPool& matrixPool) override
     {
         Base::ReleaseMatricesAfterBackprop(matrixPool);
         ReleaseMatrixToPool(m_sortedIndices, matrixPool);
+        if (m_softmax)
+        {
+            ReleaseMatrixToPool(m_logSumExp, matrixPool);
+            ReleaseMatrixToPool(m_softmaxGradient, matrixPool);
+            ReleaseMatrixToPool(m_softmaxGradientSum, matrixPool);
+        }
     }
 
     virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override
@@ -494,7 +516,10 @@ public:
 
         auto&& topkOutput = outputValuePtrRef->Reshaped(m_k, outputValuePtrRef->GetNumElements() / m_k);
         auto&& topkInput = inputValuePtrRef->Reshaped(dim, inputValuePtrRef->GetNumElements() / dim);
-        topkInput.VectorMax(*m_sortedIndices, topkOutput, true, m_k);
+        if (m_softmax)
+            topkInput.VectorTopKSoftmax(*m_sortedIndices, topkOutput, *m_logSumExp, m_k);
+        else
+            topkInput.VectorMax(*m_sortedIndices, topkOutput, true, m_k);
         this->m_outputsValue[1]->SetValue(m_sortedIndices->Reshaped(outputValuePtrRef->GetNumRows(), outputValuePtrRef->GetNumCols()));
     }
 
@@ -511,8 +536,30 @@ public:
         auto&& outputGradient = this->template GradientPtrRef();
 #endif
 
+        // With the softmax, the gradient of input j is p_j (g_j - sum_i g_i p_i), where the g_i p_i of the selected
+        // values are scattered like the gradient above, and the sum is spread over all inputs with their probabilities.
+        if (m_softmax)
+        {
+            auto dim = Input(0)->GetSampleLayout().GetDimPadded(0);
+            auto numCols = outputGradient->GetNumElements() / m_k;
+            TensorView<ElemType> outputGradientTensor(outputGradient, TensorShape(m_k, numCols));
+            TensorView<ElemType> outputValueTensor(ValuePtr(), TensorShape(m_k, numCols));
+            m_softmaxGradient->Resize(m_k, numCols);
+            m_softmaxGradientSum->Resize(1, numCols);
+            TensorView<ElemType> softmaxGradientTensor(m_softmaxGradient, TensorShape(m_k, numCols));
+            TensorView<ElemType> softmaxGradientSumTensor(m_softmaxGradientSum, TensorShape(1, numCols));
+            softmaxGradientTensor.AssignElementwiseProductOf(outputGradientTensor, outputValueTensor);
+            softmaxGradientSumTensor.AssignElementwiseProductOf(outputGradientTensor, outputValueTensor); // reduces over the k values
+
+            TensorView<ElemType> inputGradientTensor(inputGradient, TensorShape(dim, numCols));
+            TensorView<ElemType> inputValueTensor(Input(0)->ValuePtr(), TensorShape(dim, numCols));
+            TensorView<ElemType> logSumExpTensor(m_logSumExp, TensorShape(1, numCols));
+            inputGradientTensor.DoElementwiseProductWithExpOfDiffOf(/*beta=*/1, softmaxGradientSumTensor, inputValueTensor, logSumExpTensor, /*alpha=*/-1);
+        }
+
+        auto&& scatteredGradient = m_softmax ? m_softmaxGradient : outputGradient;
         auto&& reshapedInputGradient = inputGradient->Reshaped(1, inputGradient->GetNumElements());
-        auto&& reshapedOutputGradient = outputGradient->Reshaped(1, outputGradient->GetNumElements());
+        auto&& reshapedOutputGradient = scatteredGradient->Reshaped(1, scatteredGradient->GetNumElements());
 
         // The indices take values between 0 and the dimension of the axis over which we compute the top k
         // Since the matrix class lacks a scatter that can handle indices arising from gather operations 
@@ -533,8 +580,9 @@ public:
         reshapedInputGradient.DoScatterColumnsOf(ElemType(1), m_sortedIndices->Reshaped(1, m_sortedIndices->GetNumElements()), reshapedOutputGradient, ElemType(1), /*idxHaveDups*/ false);
     }
 
-    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
-    virtual bool InputUsedInComputingInputNodesGradients(size_t childIndex) const override { return false; }
+    // the softmax gradient needs the probabilities and the input
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return m_softmax; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t childIndex) const override { return m_softmax; }
 
     virtual void Validate(bool isFinalValidationPass) override
     {
@@ -555,7 +603,11 @@ public:
 private:
     shared_ptr<Matrix<ElemType>> m_sortedIndices;
     shared_ptr<Matrix<ElemType>> m_steps;
+    shared_ptr<Matrix<ElemType>> m_logSumExp;          // of each column, for the gradient of the softmax
+    shared_ptr<Matrix<ElemType>> m_softmaxGradient;    // g_i p_i of the selected values
+    shared_ptr<Matrix<ElemType>> m_softmaxGradientSum; // sum_i g_i p_i of each column
     size_t m_k;
+    bool m_softmax;
 };
 
 template class TopKNode<float>;
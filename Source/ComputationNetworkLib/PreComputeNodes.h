@@ -193,13 +193,30 @@ public:
 protected:
     size_t m_numSamples; // (SIZE_MAX while outside accumulation state)
     bool IsAccumulating() const { return m_numSamples != SIZE_MAX; }
+
+    // host copies of accumulators, for GetAccumulatedSums() and SetAccumulatedSums()
+    static std::vector<ElemType> CopyToHost(const Matrix<ElemType>& m)
+    {
+        std::vector<ElemType> values(m.GetNumElements());
+        if (!values.empty())
+            m.CopySection(m.GetNumRows(), m.GetNumCols(), values.data(), m.GetNumRows());
+        return values;
+    }
+
+    static void CopyFromHost(Matrix<ElemType>& m, std::vector<ElemType>& values)
+    {
+        if (!values.empty())
+            m.SetValue(m.GetNumRows(), m.GetNumCols(), m.GetDeviceId(), values.data());
+    }
 };
 
 #define UsingMeanInvStdDevNodeBaseNodeMembers \
     ComputationNodeBoilerplate;               \
     UsingPreComputedNodeMembers;              \
     using Base::m_numSamples;                 \
-    using Base::IsAccumulating
+    using Base::IsAccumulating;               \
+    using Base::CopyToHost;                   \
+    using Base::CopyFromHost
 
 // -----------------------------------------------------------------------
 // MeanNode (features)
@@ -248,6 +265,29 @@ public:
 
         UpdateRunningAverage(InputRef(0), mean, m_numSamples);
     }
+
+    // [n, n * mean]
+    virtual void /*IPreComputeNode::*/ GetAccumulatedSums(std::vector<double>& sums) const override
+    {
+        if (!IsAccumulating())
+            LogicError("%ls %ls operation: GetAccumulatedSums() called while not accumulating.", NodeName().c_str(), OperationName().c_str());
+
+        sums.push_back((double) m_numSamples);
+        for (auto mean : CopyToHost(Value()))
+            sums.push_back(m_numSamples * (double) mean);
+    }
+
+    virtual void /*IPreComputeNode::*/ SetAccumulatedSums(const double*& sums) override
+    {
+        if (!IsAccumulating())
+            LogicError("%ls %ls operation: SetAccumulatedSums() called while not accumulating.", NodeName().c_str(), OperationName().c_str());
+
+        m_numSamples = (size_t) *sums++;
+        std::vector<ElemType> mean(Value().GetNumElements());
+        for (auto& m : mean)
+            m = (ElemType) (m_numSamples ? *sums++ / m_numSamples : *sums++);
+        CopyFromHost(Value(), mean);
+    }
 };
 
 template class MeanNode<float>;
@@ -348,6 +388,42 @@ public:
         m_numSamples += InputRef(0).GetMBLayout()->GetActualNumSamples();
     }
 
+    // [n, n * mean, n * (var + mean^2)], i.e. the sums of the samples and of their squares.
+    // The per-worker moments are accumulated incrementally as above and only combined in double precision.
+    virtual void /*IPreComputeNode::*/ GetAccumulatedSums(std::vector<double>& sums) const override
+    {
+        if (!IsAccumulating())
+            LogicError("%ls %ls operation: GetAccumulatedSums() called while not accumulating.", NodeName().c_str(), OperationName().c_str());
+
+        auto mean = CopyToHost(*m_mean);
+        auto var  = CopyToHost(*m_var);
+        sums.push_back((double) m_numSamples);
+        for (auto m : mean)
+            sums.push_back(m_numSamples * (double) m);
+        for (size_t i = 0; i < var.size(); i++)
+            sums.push_back(m_numSamples * ((double) var[i] + (double) mean[i] * mean[i]));
+    }
+
+    virtual void /*IPreComputeNode::*/ SetAccumulatedSums(const double*& sums) override
+    {
+        if (!IsAccumulating())
+            LogicError("%ls %ls operation: SetAccumulatedSums() called while not accumulating.", NodeName().c_str(), OperationName().c_str());
+
+        m_numSamples = (size_t) *sums++;
+        double n = m_numSamples ? (double) m_numSamples : 1.0;
+        std::vector<double> mean(m_mean->GetNumElements());
+        std::vector<ElemType> newMean(mean.size()), newVar(mean.size());
+        for (size_t i = 0; i < mean.size(); i++)
+        {
+            mean[i] = *sums++ / n;
+            newMean[i] = (ElemType) mean[i];
+        }
+        for (size_t i = 0; i < mean.size(); i++)
+            newVar[i] = (ElemType) std::max(0.0, *sums++ / n - mean[i] * mean[i]);
+        CopyFromHost(*m_mean, newMean);
+        CopyFromHost(*m_var, newVar);
+    }
+
     virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
     {
         Base::CopyTo(nodeP, newName, flags);
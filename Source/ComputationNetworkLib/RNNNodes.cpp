@@ -102,6 +102,7 @@ void OptimizedRNNStackNode<ElemType>::ForwardProp(const FrameRange& fr)
 {
     // The parameters are stored in a column matrix
     Matrix<ElemType>& paramW = InputRef(0).Value();
+    m_rnnAttributes.m_persistent = Globals::ShouldUsePersistentRNN();
 
     MBLayoutPtr mb = GetMBLayout();
     if (m_rnnAttributes.IsSpatialRecurrence())
@@ -142,6 +143,17 @@ void OptimizedRNNStackNode<ElemType>::ForwardProp(const FrameRange& fr)
         shapeXT = TensorShape(InputRef(1).GetTensorSliceFor(SIZE_MAX, fr));
         shapeYT = TensorShape(          GetTensorSliceFor(SIZE_MAX, fr));
 
+        // If the minibatch is already laid out the way CuDnn can read it, run on it in place.
+        // m_transposedOutput then only holds the RNN state for the backward pass.
+        vector<int> sequenceLengths;
+        m_unpacked = MayUseUnpackedLayout() && GetUnpackedSequenceLengths(sequenceLengths);
+        if (m_unpacked)
+        {
+            m_transposedOutput->RNNForwardUnpacked(InputRef(1).Value(), paramW, this->Value(), shapeXT[0], shapeYT[0], sequenceLengths, m_rnnAttributes, *m_reserve, *m_workspace);
+            m_BackwardDataCalledYet = false;
+            return;
+        }
+
         // This changes the data from "minibatch paking" in InputRef(0).Value() to "dense CuDNN packing" in m_transposedInput
         this->PackSequencesForCuDNN(InputRef(1).Value(), *m_transposedInput, numSequencesForFrame);
 
@@ -159,6 +171,10 @@ void OptimizedRNNStackNode<ElemType>::BackpropTo(const size_t inputIndex, const
 {
     MBLayoutPtr mb = this->GetMBLayout();
 
+    // the CPU implementation (CPURNNExecutor) only evaluates
+    if (m_deviceId == CPUDEVICE)
+        RuntimeError("%ls: Training is only implemented on the GPU, models can be evaluated on the CPU.", NodeDescription().c_str());
+
     // ensure BackwardData is the first method called, as required by CuDnn API
     if (!m_BackwardDataCalledYet)
     {
@@ -171,22 +187,33 @@ void OptimizedRNNStackNode<ElemType>::BackpropTo(const size_t inputIndex, const
             m_transposedDOutput->Resize(this->Gradient());
             TransposeHelper(this->GradientPtr(), this->GetTensorSliceFor(SIZE_MAX, fr), m_transposedDOutput, shapeYT);
         }
-        else
+        else if (!m_unpacked)
         {
             m_transposedDOutput->DoGatherColumnsOf(0.0, *(this->m_packingIndex), this->Gradient(), 1.0);
         }
 
-        // Ensure enough space for the result
-        m_transposedDInput->Resize(InputRef(1).GetSampleLayout().GetNumElements(), m_transposedDOutput->GetNumCols());
+        if (m_unpacked)
+        {
+            m_transposedDInput->Resize(InputRef(1).GetSampleLayout().GetNumElements(), this->Gradient().GetNumCols());
+            m_transposedOutput->RNNBackwardDataUnpacked(this->Value(), this->Gradient(), paramW, *m_transposedDInput, m_rnnAttributes, *m_reserve, *m_workspace);
+        }
+        else
+        {
+            // Ensure enough space for the result
+            m_transposedDInput->Resize(InputRef(1).GetSampleLayout().GetNumElements(), m_transposedDOutput->GetNumCols());
 
-        // Do the work
-        m_transposedOutput->RNNBackwardData(*m_transposedDOutput, paramW, *m_transposedDInput, m_rnnAttributes, *m_reserve, *m_workspace);
+            // Do the work
+            m_transposedOutput->RNNBackwardData(*m_transposedDOutput, paramW, *m_transposedDInput, m_rnnAttributes, *m_reserve, *m_workspace);
+        }
         m_BackwardDataCalledYet = true;
     }
     if (inputIndex == 0) // parameters
     {
         Matrix<ElemType>& paramDW = InputRef(0).Gradient();
-        m_transposedOutput->RNNBackwardWeights(*m_transposedInput, *m_transposedOutput, paramDW, m_rnnAttributes, *m_reserve, *m_workspace);
+        if (m_unpacked)
+            m_transposedOutput->RNNBackwardWeights(InputRef(1).Value(), this->Value(), paramDW, m_rnnAttributes, *m_reserve, *m_workspace);
+        else
+            m_transposedOutput->RNNBackwardWeights(*m_transposedInput, *m_transposedOutput, paramDW, m_rnnAttributes, *m_reserve, *m_workspace);
     }
     else if (inputIndex == 1) // data
     {
@@ -196,6 +223,10 @@ void OptimizedRNNStackNode<ElemType>::BackpropTo(const size_t inputIndex, const
             TensorShape tmp;
             TransposeHelper(m_transposedDInput, shapeXT, InputRef(1).GradientPtr(), tmp);
         }
+        else if (m_unpacked)
+        {
+            InputRef(1).Gradient() += *m_transposedDInput;
+        }
         else
         {
             InputRef(1).Gradient().DoScatterColumnsOf(1.0, *(this->m_packingIndex), *m_transposedDInput, 1.0, /*idxHaveDups*/ false);
@@ -258,6 +289,24 @@ void OptimizedRNNStackNode<ElemType>::Validate(bool isFinalValidationPass)
     }
 };
 
+template<class ElemType>
+bool OptimizedRNNStackNode<ElemType>::GetUnpackedSequenceLengths(vector<int>& sequenceLengths) const
+{
+    MBLayoutPtr mb = this->GetMBLayout();
+    sequenceLengths.assign(mb->GetNumParallelSequences(), 0);
+    for (const auto& seq : mb->GetAllSequences())
+    {
+        if (seq.seqId == GAP_SEQUENCE_ID)
+            continue;
+        // a sequence that does not start at the first frame, or does not fit, needs packing
+        if (seq.tBegin != 0 || seq.tEnd > mb->GetNumTimeSteps() || sequenceLengths[seq.s] != 0)
+            return false;
+        sequenceLengths[seq.s] = (int)seq.GetNumTimeSteps();
+    }
+    // CuDnn does not accept empty sequences
+    return all_of(sequenceLengths.begin(), sequenceLengths.end(), [](int length) { return length > 0; });
+}
+
 template<class ElemType>
 void OptimizedRNNStackNode<ElemType>::PackSequencesForCuDNN(const Matrix<ElemType>& src, Matrix<ElemType>& dst, vector<size_t>& numSequencesForFrame2)
 {
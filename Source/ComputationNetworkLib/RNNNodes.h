@@ -80,8 +80,10 @@ public:
         ReleaseMatrixToPool(m_packingIndex, matrixPool);
     }
 
-    virtual bool OutputUsedInComputingInputNodesGradients() const { return false; }
-    virtual bool InputUsedInComputingInputNodesGradients(size_t childIndex) const { return 0 == childIndex; }
+    // When CuDnn can read the minibatch in place (see GetUnpackedSequenceLengths()), the backward pass reads the input and output
+    // rather than packed copies of them.
+    virtual bool OutputUsedInComputingInputNodesGradients() const { return MayUseUnpackedLayout(); }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t childIndex) const { return 0 == childIndex || (1 == childIndex && MayUseUnpackedLayout()); }
     RnnAttributes Attributes() const { return m_rnnAttributes; }
 
 protected:
@@ -102,9 +104,15 @@ private:
     void PackSequencesForCuDNN(const Matrix<ElemType>& src, Matrix<ElemType>& dst, vector<size_t>& numSequencesForFrame);
     void UnpackSequencesFromCuDNN(const Matrix<ElemType>& src, Matrix<ElemType>& dst);
 
+    bool MayUseUnpackedLayout() const { return !m_rnnAttributes.IsSpatialRecurrence() && Matrix<ElemType>::IsRNNUnpackedLayoutSupported(m_deviceId); }
+    // If every parallel sequence of the minibatch holds a single sequence that starts at its first frame, returns true and the
+    // lengths of the sequences; CuDnn then reads and writes the minibatch in place, without packing.
+    bool GetUnpackedSequenceLengths(vector<int>& sequenceLengths) const;
+
     RnnAttributes m_rnnAttributes;
 
     bool m_legacySwapInputsPending = false; // to support an internal legacy version
+    bool m_unpacked = false;                // whether the last ForwardProp() ran on the minibatch in place
 };
 
 }}}
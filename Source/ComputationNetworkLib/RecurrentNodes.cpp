@@ -172,55 +172,26 @@ template<class ElemType, int direction>
         m_pMBLayout->MoveFrom(newMBLayout);
     }
 
-    m_inputInvalidMatrix->SetValue(0);
-
     // --- create the mask for invalid sequences
     // The mask stores for every time step of every sequence whether that location is invalid; that is, when
     //  - the delayed time crosses a boundary, or
     //  - the current time is in a gap
     // Forward and backprop will exclude invalid frames.
+    // The MBLayout determines these once for all nodes stepping by the same offset; the mask only needs to be moved to
+    // the GPU if they are not the same as in the previous call (same layout, and the same content copied into it).
     // TODO: in forward, we don't actually care if we propagate into a gap; could avoid a few unnecessary conditional copies towards the end
-    m_inputAnySeqValid.assign(GetNumTimeSteps(), false); // start with assumptions which we update in the loop below
-    m_inputAllSeqValid.assign(GetNumTimeSteps(), true);
-    m_inputInvalidMatrixTemp.assign(m_inputInvalidMatrix->GetNumCols(), 0);
-
-    let S = GetNumParallelSequences();
-    int dir = direction; // (this avoids a 'conditional expression is constant' warning)
-    FrameRangeIteration range(m_pMBLayout, -dir);
-    for (auto fr = range.begin(); fr != range.end(); fr++)
+    let delayedFrames = m_pMBLayout->GetDelayedFrames(direction * (ptrdiff_t)m_timeStep);
+    if (delayedFrames != m_delayedFrames || m_inputInvalidMatrix->GetNumCols() != delayedFrames->m_invalid.size())
     {
-        let t = fr.t();
-        FrameRange frDelayed = fr.WithTimeOffset(direction * m_timeStep);
-
-        // first check in bulk for the frame--if all frames are good (most frequent case), take the quick path
-        if (!m_pMBLayout->IsBeyondStartOrEnd(frDelayed) &&
-            !m_pMBLayout->IsGap(fr))
-        {
-            m_inputAnySeqValid[t] = true;                  // no special case: just copy all
-            assert(m_inputAllSeqValid[t]);
-            continue;
-        }
-
-        // determine each sequence for the current frame that has a boundary condition or is a gap:
-        for (size_t s = 0; s < S; s++)
-        {
-            // source frame is either invalid or valid (or target frame is a gap, in which case we consider everything valid)
-            if (!m_pMBLayout->IsBeyondStartOrEnd(frDelayed.Sequence(s)) &&
-                !m_pMBLayout->IsGap(fr.Sequence(s)))
-            {
-                m_inputAnySeqValid[t] = true;
-            }
-            else
-            {
-                m_inputAllSeqValid[t] = false;
-                let j = fr.t() * S + s;
-                m_inputInvalidMatrixTemp[j] = 1; // invalid: exclude this in copy/backprop
-            }
-        }
+        m_inputAnySeqValid = delayedFrames->m_anySeqValid;
+        m_inputAllSeqValid = delayedFrames->m_allSeqValid;
+        m_inputInvalidMatrixTemp.resize(delayedFrames->m_invalid.size());
+        for (size_t j = 0; j < m_inputInvalidMatrixTemp.size(); j++)
+            m_inputInvalidMatrixTemp[j] = delayedFrames->m_invalid[j] ? (ElemType)1 : (ElemType)0;
+        // move to GPU
+        m_inputInvalidMatrix->SetValue(1, m_inputInvalidMatrixTemp.size(), m_deviceId, m_inputInvalidMatrixTemp.data(), matrixFlagNormal);
+        m_delayedFrames = delayedFrames;
     }
-    // move to GPU
-    // TODO: move this to the MBLayout where this can be done together with the creation of the other mask and is likely to further improve performance.
-    m_inputInvalidMatrix->SetValue(1, m_inputInvalidMatrixTemp.size(), m_deviceId, m_inputInvalidMatrixTemp.data(), matrixFlagNormal);
 
     // --- create the packed index in case of per-sequence initial state
     // In this case, we use Gather() to select the respective columns from the input state.
@@ -591,6 +562,96 @@ template<class ElemType, int direction>
         LogicError("Unrecognized direction in DelayedValueNodeBase");
 }
 
+// The state of a stream is the last m_timeStep frames of the input: a [D x m_timeStep] matrix on our device, and a
+// layout of one sequence that ends at m_timeStep and begins at m_timeStep - (number of frames of the stream so far).
+// The begin is not clipped, since the first of the delay nodes patches it into the shared layout for all of them.
+template<class ElemType, int direction>
+/*virtual*/ void DelayedValueNodeBase<ElemType, direction>::/*IStatefulNode::*/ ImportSequenceStates(const vector<NodeStatePtr>& states) /*override*/
+{
+    int dir = direction; // (this avoids a 'conditional expression is constant' warning)
+    if (dir != -1)
+        InvalidArgument("%ls %ls operation cannot be evaluated chunk by chunk, since it looks into the future.", NodeName().c_str(), OperationName().c_str());
+
+    // lay the states out as the end of a previous minibatch of m_timeStep steps, for BeginForwardProp() and ForwardProp()
+    let S = states.size();
+    let T = (size_t)m_timeStep;
+    if (!m_delayedActivationMBLayout)
+        m_delayedActivationMBLayout = make_shared<MBLayout>();
+    m_delayedActivationMBLayout->Init(S, T);
+    m_delayedValue->Resize(GetSampleMatrixNumRows(), T * S);
+    m_delayedValue->SetValue(0);
+    auto stateLayout = make_shared<MBLayout>();
+    for (size_t s = 0; s < S; s++)
+    {
+        if (!states[s]) // the stream begins in the next minibatch
+        {
+            m_delayedActivationMBLayout->AddGap(s, 0, T);
+            continue;
+        }
+
+        DelayedNodeStatePtr pState = dynamic_pointer_cast<DelayedValueNodeState<ElemType>>(states[s]);
+        if (!pState || pState->IsEmpty())
+            LogicError("Expecting the state of a stream after downcasting");
+
+        pState->ExportDelayedMBLayout(stateLayout);
+        let& frames = pState->ExportCachedActivity();
+        if (frames.GetNumRows() != m_delayedValue->GetNumRows() || frames.GetNumCols() != T)
+            LogicError("%ls %ls operation: The state of a stream has dimensions [%d x %d] instead of [%d x %d].", NodeName().c_str(), OperationName().c_str(),
+                       (int)frames.GetNumRows(), (int)frames.GetNumCols(), (int)m_delayedValue->GetNumRows(), (int)T);
+        for (size_t t = 0; t < T; t++)
+            m_delayedValue->SetColumnSlice(frames.ColumnSlice(t, 1), t * S + s, 1);
+        m_delayedActivationMBLayout->AddSequence(s, s, stateLayout->GetAllSequences().front().tBegin, T);
+    }
+}
+
+template<class ElemType, int direction>
+/*virtual*/ NodeStatePtr DelayedValueNodeBase<ElemType, direction>::/*IStatefulNode::*/ ExportSequenceState(UniqueSequenceId seqId, const NodeStatePtr& previous) /*override*/
+{
+    if (!m_delayedActivationMBLayout || m_delayedValue->IsEmpty())
+        LogicError("%ls %ls operation: ExportSequenceState() was called before the node was evaluated.", NodeName().c_str(), OperationName().c_str());
+
+    let& layout = *m_delayedActivationMBLayout;
+    let& seq = layout.FindSequence(seqId);
+    let S = layout.GetNumParallelSequences();
+    let T = (ptrdiff_t)m_timeStep;
+
+    // the frames of the sequence in the last minibatch, and how many frames its stream had before them
+    let tBegin = max<ptrdiff_t>(seq.tBegin, 0);
+    let numFrames = (ptrdiff_t)seq.tEnd - tBegin;
+    DelayedNodeStatePtr pPrevious = seq.tBegin < 0 ? dynamic_pointer_cast<DelayedValueNodeState<ElemType>>(previous) : nullptr;
+    MBLayoutPtr previousLayout;
+    ptrdiff_t numPreviousFrames = 0;
+    if (pPrevious && !pPrevious->IsEmpty())
+    {
+        previousLayout = make_shared<MBLayout>();
+        pPrevious->ExportDelayedMBLayout(previousLayout);
+        numPreviousFrames = T - previousLayout->GetAllSequences().front().tBegin;
+    }
+    else
+        pPrevious = nullptr;
+
+    // keep the last m_timeStep frames; those before the begin of the stream are never read
+    Matrix<ElemType> frames(m_delayedValue->GetNumRows(), m_timeStep, m_deviceId);
+    frames.SetValue(0);
+    for (ptrdiff_t j = 0; j < T; j++)
+    {
+        let k = numFrames - T + j; // relative to the first frame of the last minibatch
+        if (k >= 0)
+            frames.SetColumnSlice(m_delayedValue->ColumnSlice((tBegin + k) * S + seq.s, 1), j, 1);
+        else if (pPrevious)
+            frames.SetColumnSlice(pPrevious->ExportCachedActivity().ColumnSlice(T + k, 1), j, 1);
+    }
+
+    auto stateLayout = make_shared<MBLayout>();
+    stateLayout->Init(1, m_timeStep);
+    stateLayout->AddSequence(0, 0, T - (numPreviousFrames + numFrames), m_timeStep);
+
+    auto pState = make_shared<DelayedValueNodeState<ElemType>>(m_deviceId);
+    pState->CacheState(frames);
+    pState->CacheDelayedMBLayout(stateLayout);
+    return pState;
+}
+
 // instantiate the classes that derive from the above
 template class PastValueNode<float>;
 template class PastValueNode<double>;
@@ -73,6 +73,8 @@ public:
     virtual int /*IRecurrentNode::*/ GetRecurrenceSteppingDirection() const override { return -direction; }
     virtual NodeStatePtr /*IStatefulNode::*/ ExportState() override;
     virtual void /*IStatefulNode::*/ ImportState(const NodeStatePtr& pImportedState) override;
+    virtual void /*IStatefulNode::*/ ImportSequenceStates(const std::vector<NodeStatePtr>& states) override;
+    virtual NodeStatePtr /*IStatefulNode::*/ ExportSequenceState(UniqueSequenceId seqId, const NodeStatePtr& previous) override;
     int TimeStep() const { return m_timeStep; }
     ElemType InitialActivationValue() const { return m_initialStateValue; }
 
@@ -84,6 +86,7 @@ protected:
 
     vector<ElemType> m_inputInvalidMatrixTemp;              // [j] CPU-side buffer for constructing the mask matrix
     vector<bool> m_inputAnySeqValid, m_inputAllSeqValid;    // [t] denotes whether there are any valid frames at a time step, and if all are valid
+    shared_ptr<const MBLayout::DelayedFrames> m_delayedFrames; // what m_inputInvalidMatrix and the above were last set from
 
     shared_ptr<Matrix<ElemType>> m_initialStateValueMatrix; // potentially GPU-side versions
     shared_ptr<Matrix<ElemType>> m_inputInvalidMatrix;      // [0,j] contains 1 if matrix column belongs to an frame with boundary condition or a gap frame
@@ -116,17 +116,23 @@ template <class ElemType>
 
         GetMBLayout()->InitAsFrameMode(inputMBLayout->GetNumSequences());
         UpdateFunctionValuesSize();
+
+        // Reduce all sequences in one go, reading them straight from the packed input. Gaps are never touched.
+        UpdateSequenceSegments();
+        const Matrix<ElemType>* input = &InputRef(0).Value();
+        if (input->GetMatrixType() != DENSE)
+        {
+            m_tempDenseInput->SwitchToMatrixType(DENSE, matrixFormatDense, /*keepValues=*/false);
+            m_tempDenseInput->AssignValuesOf(*input);
+            input = m_tempDenseInput.get();
+        }
+        Value().AssignSegmentedReductionOf(*input, *m_sequenceSegments, inputMBLayout->GetNumParallelSequences(), m_reductionOp, /*average=*/IsMean());
+        return;
     }
+
     // get the args
     size_t rank = DetermineElementwiseTensorRank();
-    TensorView<ElemType> input;
-    if (ReduceSequenceAxis())
-    {
-        ElemType gapPadValue = NeutralValue(m_reductionOp);
-        input = ComputationNode<ElemType>::Unpack(GetSampleLayout(), InputRef(0).Value(), InputRef(0).GetMBLayout(), m_tempUnpackedData, m_tempScatterIndices, m_tempMask, /*batchMajor=*/ true, &gapPadValue);
-    }
-    else
-        input = InputRef(0).ValueTensorFor(rank, frInput);
+    auto input = InputRef(0).ValueTensorFor(rank, frInput);
 
     auto result = ReduceAllAxes() ? TensorView<ElemType>(ValuePtr(), GetSampleLayout()) : ValueTensorFor(rank, fr);
 
@@ -154,9 +160,16 @@ template <class ElemType>
     bool accumulateGradient = !InputRef(inputIndex).IsGradientInitializedBy(this);
     if (ReduceSequenceAxis())
     {
-        // Broadcast along the sequence
-        auto result = ValueFor(fr);
-        ComputationNode<ElemType>::BroadcastToPacked(Gradient(), GetMBLayout(), /*beta =*/ accumulateGradient ? (ElemType)1 : (ElemType)0, InputRef(0).Gradient(), FrameRange(InputRef(0).GetMBLayout()), m_tempGatherIndices);
+        // Broadcast along the sequence, using the segments of the forward pass
+        const Matrix<ElemType>* input = &InputRef(0).Value();
+        Matrix<ElemType> denseInput(input->GetDeviceId());
+        if (InputUsedInComputingInputNodesGradients(0) && input->GetMatrixType() != DENSE)
+        {
+            denseInput.AssignValuesOf(*input);
+            input = &denseInput;
+        }
+        InputRef(0).Gradient().DoSegmentedReductionGradientOf(/*beta =*/ accumulateGradient ? (ElemType)1 : (ElemType)0, Gradient(), *input, Value(), *m_sequenceSegments,
+                                                              InputRef(0).GetMBLayout()->GetNumParallelSequences(), m_reductionOp, /*average=*/IsMean());
     }
     else
     {
@@ -269,6 +282,27 @@ template <class ElemType>
     LogicError("Should not get here.");
 }
 
+// describe the sequences of the input as segments of its packed columns: column j of m_sequenceSegments holds the
+// first column and the length of the j-th sequence of the layout, which is also the j-th column of the result
+template <class ElemType>
+void ReduceElementsNode<ElemType>::UpdateSequenceSegments()
+{
+    auto inputMBLayout = InputRef(0).GetMBLayout();
+    std::vector<ElemType> segments;
+    segments.reserve(2 * inputMBLayout->GetNumSequences());
+    for (const auto& sequenceInfo : inputMBLayout->GetAllSequences())
+    {
+        if (sequenceInfo.seqId == GAP_SEQUENCE_ID)
+            continue;
+        segments.push_back((ElemType)inputMBLayout->GetColumnIndex(sequenceInfo, 0));
+        segments.push_back((ElemType)sequenceInfo.GetNumTimeSteps());
+    }
+
+    if (!m_sequenceSegments)
+        m_sequenceSegments = std::make_shared<Matrix<ElemType>>(m_deviceId);
+    m_sequenceSegments->SetValue(2, segments.size() / 2, m_deviceId, segments.data());
+}
+
 // map the operation specified as a string to an ElementWiseOperator value.
 template <class ElemType>
 void ReduceElementsNode<ElemType>::ValidateOp()
@@ -293,8 +327,9 @@ template <class ElemType>
         if (isFinalValidationPass && !Input(0)->HasMBLayout())
             InvalidArgument("%ls %ls operation can perform sequence axis reduction only on minibatch data (which have a layout).", NodeName().c_str(), OperationName().c_str());
 
-        if ((m_operation != L"Sum") && (m_operation != L"Plus"))
-            InvalidArgument("%ls %ls operation can perform sequence axis reduction only for the 'sum' reduction operation, specified operation %ls.", NodeName().c_str(), OperationName().c_str(), m_operation.c_str());
+        if ((m_reductionOp != ElementWiseOperator::opSum) && (m_reductionOp != ElementWiseOperator::opLogSum) &&
+            (m_reductionOp != ElementWiseOperator::opMin) && (m_reductionOp != ElementWiseOperator::opMax))
+            InvalidArgument("%ls %ls operation can perform sequence axis reduction only for the 'sum', 'mean', 'logsum', 'max' and 'min' reduction operations, specified operation %ls.", NodeName().c_str(), OperationName().c_str(), m_operation.c_str());
 
         if (!m_pMBLayout)
         {
@@ -206,6 +206,8 @@ template class ReshapeNode<double>;
 // ReduceElements (op, axis=, input)
 // Reduces (e.g. sums up) all elements in each sample (column) of the input.
 // The optional axis can be 0 (meaning all elements) or a specific axis.
+// When reducing the sequence axis, each sequence is reduced straight from the packed minibatch,
+// using the sequence boundaries of the MBLayout (Sum, Mean, LogSum, Max and Min).
 // Allowed operations:
 //  - "Sum"
 //  - "LogSum"
@@ -328,29 +330,17 @@ public:
     void RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) override
     {
         Base::RequestMatricesBeforeForwardProp(matrixPool);
-        m_tempMask = std::make_shared<Matrix<char>>(Base::m_deviceId);
-        RequestMatrixFromPool(m_tempScatterIndices, matrixPool, 1, HasMBLayout());
-        RequestMatrixFromPool(m_tempUnpackedData, matrixPool, GetSampleLayout().GetNumElements(), HasMBLayout());
+        RequestMatrixFromPool(m_tempDenseInput, matrixPool, GetSampleLayout().GetNumElements(), HasMBLayout());
     }
 
     void ReleaseMatricesAfterForwardProp(MatrixPool& matrixPool) override
     {
         Base::ReleaseMatricesAfterForwardProp(matrixPool);
-        ReleaseMatrixToPool(m_tempScatterIndices, matrixPool);
-        ReleaseMatrixToPool(m_tempUnpackedData, matrixPool);
+        ReleaseMatrixToPool(m_tempDenseInput, matrixPool);
     }
 
-    void RequestMatricesBeforeBackprop(MatrixPool& matrixPool) override
-    {
-        Base::RequestMatricesBeforeBackprop(matrixPool);
-        RequestMatrixFromPool(m_tempGatherIndices, matrixPool, 1, InputRef(0).HasMBLayout());
-    }
-
-    void ReleaseMatricesAfterBackprop(MatrixPool& matrixPool) override
-    {
-        Base::ReleaseMatricesAfterBackprop(matrixPool);
-        ReleaseMatrixToPool(m_tempGatherIndices, matrixPool);
-    }
+    // the temporaries above are handed back to the pool right after forward prop
+    bool IsForwardPropRecomputable() const override { return false; }
 
     std::wstring ReductionOpName() const { return m_operation; }
     const std::vector<int>& ReductionAxis() const { return m_axes; }
@@ -367,6 +357,8 @@ private:
     bool ReduceSequenceAxis() const { return Contains(m_axes, CNTKInternalIdxValueForSequenceAxis); }
     bool ReduceBatchAxis() const { return Contains(m_axes, CNTKInternalIdxValueForBatchAxis); }
 
+    void UpdateSequenceSegments();
+
 private:
     // operation attributes
     std::vector<int> m_axes;
@@ -377,10 +369,9 @@ private:
     ElementWiseOperator m_reductionOp; // the reduction operation mapped to our internal opCode
     ElemType m_scale;                  // 1 or, for Mean, 1/number of elements we are reducing over
 
-    shared_ptr<Matrix<ElemType>> m_tempGatherIndices;
-    shared_ptr<Matrix<char>> m_tempMask;
-    shared_ptr<Matrix<ElemType>> m_tempScatterIndices;
-    shared_ptr<Matrix<ElemType>> m_tempUnpackedData;
+    // first column and length of each input sequence, for the sequence axis reduction; kept from forward to backprop
+    shared_ptr<Matrix<ElemType>> m_sequenceSegments;
+    shared_ptr<Matrix<ElemType>> m_tempDenseInput;
 };
 
 // -----------------------------------------------------------------------
@@ -506,6 +497,9 @@ public:
         ReleaseMatrixToPool(m_tempGatherIndices, matrixPool);
     }
 
+    // the temporaries above are handed back to the pool right after forward prop
+    bool IsForwardPropRecomputable() const override { return false; }
+
     void RequestMatricesBeforeBackprop(MatrixPool& matrixPool) override
     {
         Base::RequestMatricesBeforeBackprop(matrixPool);
@@ -2063,7 +2057,9 @@ class GatherNode : public ComputationNodeNonLooping<ElemType>, public NumInputs<
     }
 
 public:
-    GatherNode(DEVICEID_TYPE deviceId, const wstring& name) : Base(deviceId, name)
+    // 'axis' is the 0-based axis of the right operand that is indexed; negative values count from the end,
+    // so the default -1 gathers along its last axis.
+    GatherNode(DEVICEID_TYPE deviceId, const wstring& name, int axis = -1) : Base(deviceId, name), m_axis(axis)
     {
     }
 
@@ -2071,21 +2067,11 @@ public:
     {
         auto& indices = InputRef(0);
         auto& target = InputRef(1);
-        const auto& targetSampleLayout = Input(1)->GetSampleLayout();
-        const auto& targetDims = targetSampleLayout.GetDims();
-        if (targetDims.size() == 0)
-        {
-            LogicError("%ls operation's right operand must have at least 1 dim", OperationName().c_str());
-        }
-
-        size_t row_elements = 1;
-        for (int i = 0; i < targetDims.size() - 1; i++)
-        {
-            row_elements *= targetDims[i];
-        }
+        size_t innerElements, outerElements;
+        GetTargetSplit(innerElements, outerElements);
 
         auto& output = Value();
-        output.GatherFromTarget(indices.Value(), target.Value(), row_elements);
+        output.GatherFromTarget(indices.Value(), target.Value(), innerElements, outerElements);
     }
 
     virtual void BackpropToNonLooping(size_t inputIndex) override
@@ -2093,30 +2079,31 @@ public:
         if (inputIndex == 1) //only right operand need calculate gradient
         {
             let&  indices = InputRef(0).Value();
-            auto& sourceGradient = InputRef(1).Gradient();
             auto& outputGradient = Gradient();
-            const auto& sampleLayout = InputRef(1).GetSampleLayout();
-            const auto& dims = sampleLayout.GetDims();
-
-            if (dims.size() == 0)
-            {
-                LogicError("%ls operation's right operand must have at least 1 dim", OperationName().c_str());
-            }
-
-            size_t row_elements = 1;
-            for (int i = 0; i < dims.size() - 1; i++)
+            size_t row_elements, outer_elements;
+            GetTargetSplit(row_elements, outer_elements);
+
+            // Gathering the columns of a parameter, e.g. of an embedding by word ids, only has gradients for the columns
+            // that were gathered. As for DENSE * SPARSE in TimesNode, the gradient is then allocated as a SparseBlockCol
+            // matrix, whose blocks are those columns; a dense product into the same gradient switches it back to dense.
+            auto& currentSourceGradient = InputRef(1).Gradient();
+            if (InputRef(1).IsLeaf() && InputRef(1).GetPreferredGradientMatrixType() == UNDETERMINED && outer_elements == 1 &&
+                currentSourceGradient.GetMatrixType() == DENSE && currentSourceGradient.GetNumRows() == row_elements)
             {
-                row_elements *= dims[i];
+                InputRef(1).GradientPtrRef() = std::make_shared<Matrix<ElemType>>(currentSourceGradient.GetNumRows(), currentSourceGradient.GetNumCols(),
+                                                                                  currentSourceGradient.GetPreferredDeviceId(), SPARSE, MatrixFormat::matrixFormatSparseBlockCol);
+                InputRef(1).SetPreferredGradientMatrixType(SPARSE);
             }
+            auto& sourceGradient = InputRef(1).Gradient();
 
             if (InputRef(0).HasMBLayout())
             {
                 const auto& indicesMask = InputRef(0).GetMBLayout()->GetColumnsValidityMask(indices.GetDeviceId());
-                sourceGradient.ScatterToIndices(outputGradient, indices, row_elements, &indicesMask);
+                sourceGradient.ScatterToIndices(outputGradient, indices, row_elements, outer_elements, &indicesMask);
             }
             else
             {
-                sourceGradient.ScatterToIndices(outputGradient, indices, row_elements);
+                sourceGradient.ScatterToIndices(outputGradient, indices, row_elements, outer_elements);
             }
         }
         else
@@ -2148,16 +2135,67 @@ public:
 
         const auto& inputSampleLayout2 = Input(1)->GetSampleLayout();
         const auto& inputDims2 = inputSampleLayout2.GetDims();
+        size_t axis = GetAxisIndex();
 
+        // the indexed axis of the right operand is replaced by the dims of the indices
         SmallVector<size_t> dims;
-        dims.append(inputDims2.begin(), inputDims2.end() - 1);//pop the last dim of right operand
+        dims.append(inputDims2.begin(), inputDims2.begin() + axis);
         dims.append(inputDims1.begin(), inputDims1.end());
+        dims.append(inputDims2.begin() + axis + 1, inputDims2.end());
         auto sampleLayout = TensorShape(dims);
 
         SetDims(sampleLayout, HasMBLayout());
     }
 
+    virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
+    {
+        Base::CopyTo(nodeP, newName, flags);
+        if (flags & CopyNodeFlags::copyNodeValue)
+        {
+            auto node = dynamic_pointer_cast<GatherNode<ElemType>>(nodeP);
+            node->m_axis = m_axis;
+        }
+    }
+
+    // The model format has no axis for Gather, which then is always the last one. Gathers along other axes are
+    // only created by the V2 library, whose own format stores the axis.
+    virtual void Save(File& fstream) const override
+    {
+        if (m_axis != -1)
+            RuntimeError("%ls operation: A gather along axis %d cannot be saved in the legacy model format.", OperationName().c_str(), m_axis);
+        Base::Save(fstream);
+    }
+
+    int Axis() const { return m_axis; }
+
 protected:
+    // the indexed axis as an index into the dims of the right operand
+    size_t GetAxisIndex() const
+    {
+        const auto& dims = Input(1)->GetSampleLayout().GetDims();
+        int rank = (int)dims.size();
+        int axis = m_axis < 0 ? rank + m_axis : m_axis;
+        if (rank == 0)
+            LogicError("%ls operation's right operand must have at least 1 dim", OperationName().c_str());
+        if (axis < 0 || axis >= rank)
+            InvalidArgument("%ls operation's axis %d is out of range for a right operand of rank %d.", OperationName().c_str(), m_axis, rank);
+        return (size_t)axis;
+    }
+
+    // splits the right operand into [innerElements x dims[axis] x outerElements]
+    void GetTargetSplit(size_t& innerElements, size_t& outerElements) const
+    {
+        const auto& dims = InputRef(1).GetSampleLayout().GetDims();
+        size_t axis = GetAxisIndex();
+        innerElements = 1;
+        for (size_t i = 0; i < axis; i++)
+            innerElements *= dims[i];
+        outerElements = 1;
+        for (size_t i = axis + 1; i < dims.size(); i++)
+            outerElements *= dims[i];
+    }
+
+    int m_axis;
 };
 
 template class GatherNode<float>;
@@ -69,11 +69,36 @@ public:
     {
         if (inputIndex == 0)
         {
+            bool assignGradient = InputRef(inputIndex).IsGradientInitializedBy(this);
+            if ((Gradient().GetMatrixType() == DENSE) && (InputRef(inputIndex).Gradient().GetMatrixType() == DENSE))
+            {
+                // The input gradient is our gradient in unpacked order. Use it as it is where the orders agree, else gather it in one go.
+                std::vector<ElemType> columnIndices;
+                bool hasPadding;
+                bool isInPackedOrder = ComputationNode<ElemType>::GetUnpackingColumnIndices(m_pMBLayout, /*toPacked=*/false, columnIndices, hasPadding);
+                auto inputGradient = InputRef(inputIndex).Gradient().Reshaped(Gradient().GetNumRows(), columnIndices.size());
+                if (isInPackedOrder)
+                {
+                    if (assignGradient)
+                        inputGradient.AssignValuesOf(Gradient());
+                    else
+                        inputGradient += Gradient();
+                }
+                else
+                {
+                    m_tempColumnIndices->SetValue(1, columnIndices.size(), Gradient().GetDeviceId(), columnIndices.data());
+                    if (assignGradient && hasPadding)
+                        inputGradient.SetValue(0);
+                    inputGradient.DoGatherColumnsOf(/*beta=*/assignGradient ? 0 : 1, *m_tempColumnIndices, Gradient(), /*alpha=*/1);
+                }
+                return;
+            }
+
             ElemType gapPadValue = 0;
-            auto gradient = ComputationNode<ElemType>::Unpack(GetSampleLayout(), Gradient(), m_pMBLayout, m_tempUnpackedData, m_tempScatterIndices, std::shared_ptr<Matrix<char>>(nullptr), /*batchMajor=*/ false, &gapPadValue);
+            auto gradient = ComputationNode<ElemType>::Unpack(GetSampleLayout(), Gradient(), m_pMBLayout, m_tempUnpackedData, m_tempColumnIndices, std::shared_ptr<Matrix<char>>(nullptr), /*batchMajor=*/ false, &gapPadValue);
             auto inputGradient = InputRef(inputIndex).GradientTensorFor(InputRef(inputIndex).GetSampleLayout().GetRank(), FrameRange(InputRef(inputIndex).GetMBLayout()));
 
-            if (InputRef(inputIndex).IsGradientInitializedBy(this))
+            if (assignGradient)
                 inputGradient.AssignCopyOf(gradient);
             else
                 inputGradient.AddCopyOf(gradient);
@@ -126,23 +151,26 @@ public:
         ReleaseMatrixToPool(m_tempGatherIndices, matrixPool);
     }
 
+    // the temporaries above are handed back to the pool right after forward prop
+    bool IsForwardPropRecomputable() const override { return false; }
+
     void RequestMatricesBeforeBackprop(MatrixPool& matrixPool) override
     {
         Base::RequestMatricesBeforeBackprop(matrixPool);
-        RequestMatrixFromPool(m_tempScatterIndices, matrixPool, 1, HasMBLayout());
+        RequestMatrixFromPool(m_tempColumnIndices, matrixPool, 1, HasMBLayout());
         RequestMatrixFromPool(m_tempUnpackedData, matrixPool, InputRef(0).GetSampleLayout().GetNumElements(), InputRef(0).HasMBLayout());
     }
 
     void ReleaseMatricesAfterBackprop(MatrixPool& matrixPool) override
     {
         Base::ReleaseMatricesAfterBackprop(matrixPool);
-        ReleaseMatrixToPool(m_tempScatterIndices, matrixPool);
+        ReleaseMatrixToPool(m_tempColumnIndices, matrixPool);
         ReleaseMatrixToPool(m_tempUnpackedData, matrixPool);
     }
 
 private:
     shared_ptr<Matrix<ElemType>> m_tempGatherIndices;
-    shared_ptr<Matrix<ElemType>> m_tempScatterIndices;
+    shared_ptr<Matrix<ElemType>> m_tempColumnIndices;
     shared_ptr<Matrix<ElemType>> m_tempUnpackedData;
 };
 
@@ -334,9 +362,30 @@ public:
         // Directly unpack into Value() matrix
         auto valueMatrixNumRows = outputValuePtrRef->GetNumRows();
         auto valueMatrixNumCols = outputValuePtrRef->GetNumCols();
-        auto unpackedInput = ComputationNode<ElemType>::Unpack(InputRef(0).GetSampleLayout(), InputRef(0).Value(), InputRef(0).GetMBLayout(), outputValuePtrRef, m_tempScatterIndices, m_tempMask, /*batchMajor=*/ false, &m_paddingValue);
-        if (unpackedInput.GetSOBPtr() != outputValuePtrRef)
-            Value().AssignValuesOf(*unpackedInput.GetSOBPtr());
+        let& inputValue = InputRef(0).Value();
+        if (inputValue.GetMatrixType() == DENSE)
+        {
+            // Where the packed columns are already in unpacked order, this is a plain copy. Else all columns are gathered in one go.
+            std::vector<ElemType> columnIndices;
+            bool hasPadding;
+            bool isInPackedOrder = ComputationNode<ElemType>::GetUnpackingColumnIndices(inputMBLayout, /*toPacked=*/false, columnIndices, hasPadding);
+            Value().Reshape(inputValue.GetNumRows(), columnIndices.size());
+            if (isInPackedOrder)
+                Value().AssignValuesOf(inputValue);
+            else
+            {
+                m_tempColumnIndices->SetValue(1, columnIndices.size(), inputValue.GetDeviceId(), columnIndices.data());
+                if (hasPadding)
+                    Value().SetValue(m_paddingValue);
+                Value().DoGatherColumnsOf(/*beta=*/0, *m_tempColumnIndices, inputValue, /*alpha=*/1);
+            }
+        }
+        else
+        {
+            auto unpackedInput = ComputationNode<ElemType>::Unpack(InputRef(0).GetSampleLayout(), inputValue, InputRef(0).GetMBLayout(), outputValuePtrRef, m_tempColumnIndices, m_tempMask, /*batchMajor=*/ false, &m_paddingValue);
+            if (unpackedInput.GetSOBPtr() != outputValuePtrRef)
+                Value().AssignValuesOf(*unpackedInput.GetSOBPtr());
+        }
 
         Value().Reshape(valueMatrixNumRows, valueMatrixNumCols);
 
@@ -366,6 +415,24 @@ public:
 
     virtual void /*ComputationNodeNonLooping::*/ BackpropToNonLooping(size_t inputIndex) override
     {
+        let& inMBLayout = InputRef(0).GetMBLayout();
+        if ((Gradient().GetMatrixType() == DENSE) && (InputRef(0).Gradient().GetMatrixType() == DENSE))
+        {
+            // Add our gradient to the packed input gradient, directly where the orders agree, else gathered in one go.
+            std::vector<ElemType> columnIndices;
+            bool hasGaps;
+            bool isInPackedOrder = ComputationNode<ElemType>::GetUnpackingColumnIndices(inMBLayout, /*toPacked=*/true, columnIndices, hasGaps);
+            auto& inputGradient = InputRef(0).Gradient();
+            auto gradient = Gradient().Reshaped(inputGradient.GetNumRows(), Gradient().GetNumElements() / inputGradient.GetNumRows());
+            if (isInPackedOrder)
+                inputGradient += gradient;
+            else
+            {
+                m_tempGatherIndices->SetValue(1, columnIndices.size(), inputGradient.GetDeviceId(), columnIndices.data());
+                inputGradient.DoGatherColumnsOf(/*beta=*/1, *m_tempGatherIndices, gradient, /*alpha=*/1);
+            }
+            return;
+        }
 
         auto numSequences = GetMBLayout()->GetNumSequences();
         auto gradientSampleLayout = GetSampleLayout();
@@ -380,7 +447,6 @@ public:
             new TensorView<ElemType>(GradientPtr(), gradientDataTensorShape));
 
         std::vector<size_t> sequenceLengths(numSequences);
-        let& inMBLayout = InputRef(0).GetMBLayout();
         let& inputSequences = inMBLayout->GetAllSequences();
         size_t j = 0;
         for (size_t i = 0; i < inputSequences.size(); i++)
@@ -453,15 +519,18 @@ public:
     {
         Base::RequestMatricesBeforeForwardProp(matrixPool);
         m_tempMask = std::make_shared<Matrix<char>>(Base::m_deviceId);
-        RequestMatrixFromPool(m_tempScatterIndices, matrixPool, 1, HasMBLayout());
+        RequestMatrixFromPool(m_tempColumnIndices, matrixPool, 1, HasMBLayout());
     }
 
     void ReleaseMatricesAfterForwardProp(MatrixPool& matrixPool) override
     {
         Base::ReleaseMatricesAfterForwardProp(matrixPool);
-        ReleaseMatrixToPool(m_tempScatterIndices, matrixPool);
+        ReleaseMatrixToPool(m_tempColumnIndices, matrixPool);
     }
 
+    // the temporaries above are handed back to the pool right after forward prop
+    bool IsForwardPropRecomputable() const override { return false; }
+
     void RequestMatricesBeforeBackprop(MatrixPool& matrixPool) override
     {
         Base::RequestMatricesBeforeBackprop(matrixPool);
@@ -498,7 +567,7 @@ private:
     bool m_suppressMaskOutput;
 
     shared_ptr<Matrix<char>> m_tempMask;
-    shared_ptr<Matrix<ElemType>> m_tempScatterIndices;
+    shared_ptr<Matrix<ElemType>> m_tempColumnIndices;
     shared_ptr<Matrix<ElemType>> m_tempGatherIndices;
     shared_ptr<Matrix<ElemType>> m_tempPackedGradientData;
 };
@@ -1088,7 +1088,7 @@ public:
         else if (inputIndex == 1)
         {
             FrameRange frameRange(InputRef(0).GetMBLayout());
-            BackpropToRight(*m_softmaxOfRight, InputRef(inputIndex).Gradient(), Gradient(), *m_CTCposterior);
+            BackpropToRight(*m_logSoftmaxOfRight, InputRef(inputIndex).Gradient(), Gradient(), *m_CTCposterior);
             InputRef(inputIndex).MaskMissingGradientColumnsToZero(frameRange);
         }
         else
@@ -1111,23 +1111,39 @@ public:
 #endif
     }
 
-    void BackpropToRight(const Matrix<ElemType>& softmaxOfRight, Matrix<ElemType>& inputGradientValues, const Matrix<ElemType>& gradientValues,
+    void BackpropToRight(const Matrix<ElemType>& logSoftmaxOfRight, Matrix<ElemType>& inputGradientValues, const Matrix<ElemType>& gradientValues,
         const Matrix<ElemType> &CTCposterior)
     {
 #if DUMPOUTPUT
-        softmaxOfRight.Print("ForwardBackwardNode Partial-softmaxOfRight");
+        logSoftmaxOfRight.Print("ForwardBackwardNode Partial-logSoftmaxOfRight");
         inputFunctionValues.Print("ForwardBackwardNode Partial-inputFunctionValues");
         gradientValues.Print("ForwardBackwardNode Partial-gradientValues");
         inputGradientValues.Print("ForwardBackwardNode Partial-Right-in");
 #endif  
-        // inputGradientValues+= gradientValues*(softmaxOfRight - CTCposterior)
-        Matrix<ElemType>::AddScaledDifference(gradientValues, softmaxOfRight, CTCposterior, inputGradientValues); 
+        // inputGradientValues+= gradientValues*(softmaxOfRight - CTCposterior), in one pass, without storing the softmax
+        inputGradientValues.ElementwiseProgramOp(1, { &logSoftmaxOfRight, &CTCposterior, &gradientValues }, GradientProgram(), 1);
 
 #if DUMPOUTPUT
         inputGradientValues.Print("ForwardBackwardNode Partial-Right");
 #endif
     }
 
+    // exp(logSoftmaxOfRight) - CTCposterior, times the gradient of the criterion
+    static const ElementwiseProgram& GradientProgram()
+    {
+        static const ElementwiseProgram program = []
+        {
+            ElementwiseProgram p;
+            p.numInputs = 3;
+            p.numInstructions = 3;
+            p.instructions[0] = { opExp, { 0, 0, 0 } };
+            p.instructions[1] = { opDifference, { 3, 1, 0 } };
+            p.instructions[2] = { opElementwiseProduct, { 4, 2, 0 } };
+            return p;
+        }();
+        return program;
+    }
+
     virtual bool OutputUsedInComputingInputNodesGradients() const override
     {
         return false;
@@ -1136,11 +1152,9 @@ public:
     virtual void ForwardPropNonLooping() override
     {
         m_logSoftmaxOfRight->AssignLogSoftmaxOf(InputRef(1).Value(), true);
-        m_softmaxOfRight->SetValue(*m_logSoftmaxOfRight);
-        m_softmaxOfRight->InplaceExp();
 
-        m_CTCposterior->SwitchToMatrixType(m_softmaxOfRight->GetMatrixType(), m_softmaxOfRight->GetFormat(), false);
-        m_CTCposterior->Resize(m_softmaxOfRight->GetNumRows(), m_softmaxOfRight->GetNumCols());
+        m_CTCposterior->SwitchToMatrixType(m_logSoftmaxOfRight->GetMatrixType(), m_logSoftmaxOfRight->GetFormat(), false);
+        m_CTCposterior->Resize(m_logSoftmaxOfRight->GetNumRows(), m_logSoftmaxOfRight->GetNumCols());
 
         FrameRange fr(InputRef(0).GetMBLayout());
         InputRef(0).ValueFor(fr).VectorMax(*m_maxIndexes, *m_maxValues, true);
@@ -1185,7 +1199,6 @@ public:
             auto node = dynamic_pointer_cast<ForwardBackwardNode<ElemType>>(nodeP);
 
             node->m_logSoftmaxOfRight->SetValue(*m_logSoftmaxOfRight);
-            node->m_softmaxOfRight->SetValue(*m_softmaxOfRight);
             node->m_CTCposterior->SetValue(*m_CTCposterior);
             node->m_maxIndexes->SetValue(*m_maxIndexes);
             node->m_maxValues->SetValue(*m_maxValues);
@@ -1198,7 +1211,6 @@ public:
     {
         Base::RequestMatricesBeforeForwardProp(matrixPool);
         RequestMatrixFromPool(m_logSoftmaxOfRight, matrixPool);
-        RequestMatrixFromPool(m_softmaxOfRight, matrixPool);
         RequestMatrixFromPool(m_CTCposterior, matrixPool);
         RequestMatrixFromPool(m_maxIndexes, matrixPool);
         RequestMatrixFromPool(m_maxValues, matrixPool);
@@ -1208,7 +1220,6 @@ public:
     {
         Base::ReleaseMatricesAfterBackprop(matrixPool);
         ReleaseMatrixToPool(m_logSoftmaxOfRight, matrixPool);
-        ReleaseMatrixToPool(m_softmaxOfRight, matrixPool);
         ReleaseMatrixToPool(m_CTCposterior, matrixPool);
         ReleaseMatrixToPool(m_maxIndexes, matrixPool);
         ReleaseMatrixToPool(m_maxValues, matrixPool);
@@ -1243,7 +1254,6 @@ public:
 protected:
     virtual bool NodeDoesItsOwnCustomizedMissingColumnsMasking() { return true; }
     shared_ptr<Matrix<ElemType>> m_logSoftmaxOfRight;
-    shared_ptr<Matrix<ElemType>> m_softmaxOfRight;
     shared_ptr<Matrix<ElemType>> m_CTCposterior;
     shared_ptr<Matrix<ElemType>> m_maxIndexes;
     shared_ptr<Matrix<ElemType>> m_maxValues;
@@ -1306,6 +1316,64 @@ public:
 template class StopGradientNode<float>;
 template class StopGradientNode<double>;
 
+// -----------------------------------------------------------------------
+// DeviceTransferNode (input)
+// Outputs its input, which lives on another device, and adds its gradient to the input's gradient.
+// ComputationNetwork::PlacePipelineStages() inserts it between pipeline stages. The copies between GPUs are
+// asynchronous to the host, and the work queued next on the receiving device waits for them.
+// -----------------------------------------------------------------------
+template <class ElemType>
+class DeviceTransferNode : public UnaryElementWiseNode<ElemType>
+{
+    typedef UnaryElementWiseNode<ElemType> Base;
+    UsingUnaryElementwiseNodeBaseMembers;
+    static const std::wstring TypeName() { return L"DeviceTransfer"; }
+public:
+    DeclareConstructorFromConfigWithNumInputs(DeviceTransferNode);
+    DeviceTransferNode(DEVICEID_TYPE deviceId, const wstring& name)
+        : Base(deviceId, name)
+    {
+    }
+
+    virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override
+    {
+        auto result = ValueFor(fr);
+        Transfer(InputRef(0).ValueFor(fr), result, /*add=*/false);
+    }
+
+    virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override
+    {
+        auto inputGradient = InputRef(0).GradientFor(fr);
+        Transfer(GradientFor(fr), inputGradient, /*add=*/true);
+    }
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
+
+private:
+    // AssignValuesOf() does not copy between GPUs, so the source is staged in a copy that is moved to the target's device
+    static void Transfer(const Matrix<ElemType>& from, Matrix<ElemType>& to, bool add)
+    {
+        if (from.GetDeviceId() == to.GetDeviceId())
+        {
+            if (add)
+                to += from;
+            else
+                to.AssignValuesOf(from);
+            return;
+        }
+        Matrix<ElemType> staged = from.DeepClone();
+        staged.TransferFromDeviceToDeviceAsync(staged.GetDeviceId(), to.GetDeviceId(), /*isBeingMoved=*/true);
+        if (add)
+            to += staged;
+        else
+            to.AssignValuesOf(staged);
+    }
+};
+
+template class DeviceTransferNode<float>;
+template class DeviceTransferNode<double>;
+
 // -----------------------------------------------------------------------
 // AssignNode (RefInput, Input)
 // -----------------------------------------------------------------------
@@ -0,0 +1,194 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// StreamSchedule.h -- assignment of the nodes of a PAR-traversed network to concurrent GPU streams
+//
+
+#pragma once
+
+#include "Basics.h"
+#include <vector>
+#include <algorithm>
+#include <stddef.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// StreamSchedule -- how the nodes of a network (in evaluation order) are issued on a few GPU streams.
+// The nodes without inputs are issued first, on the current stream, before any other stream is forked off it.
+// Each other node is issued on its stream after waiting for the events of the nodes on other streams that it
+// depends on; a node records its event if any later node waits for it.
+struct StreamSchedule
+{
+    struct Step
+    {
+        size_t node;               // index in evaluation order
+        size_t stream;             // 0 is the current stream
+        std::vector<size_t> waits; // events to wait for before issuing the node
+        int event;                 // event to record after the node, or -1
+    };
+
+    std::vector<size_t> leaves; // nodes without dependencies, in evaluation order
+    std::vector<Step> steps;    // all other nodes, in evaluation order
+    size_t numStreams = 0;      // number of streams used
+    size_t numEvents = 0;
+
+    bool IsConcurrent() const { return numStreams > 1; }
+};
+
+// Greedy assignment of chains to streams. A node continues the stream of its first input that is still the last
+// node on its stream, so that chains of nodes stay on one stream without events. Other nodes, i.e. the first node
+// of each branch, start on the stream with the fewest nodes. Waits that an earlier wait of the same stream already
+// covers are left out.
+// 'inputs[i]' are the nodes whose values node i reads. 'predecessors[i]' are further nodes that must have completed
+// before node i is issued, e.g. the users of a memory buffer that node i reuses. Both must come before i.
+inline StreamSchedule PlanStreamSchedule(const std::vector<std::vector<size_t>>& inputs,
+                                         const std::vector<std::vector<size_t>>& predecessors,
+                                         size_t maxNumStreams)
+{
+    const size_t numNodes = inputs.size();
+    const size_t none = (size_t)-1;
+    maxNumStreams = std::max<size_t>(maxNumStreams, 1);
+
+    StreamSchedule schedule;
+    std::vector<bool> isLeaf(numNodes);
+    for (size_t i = 0; i < numNodes; i++)
+    {
+        isLeaf[i] = inputs[i].empty() && (predecessors.size() <= i || predecessors[i].empty());
+        if (isLeaf[i])
+            schedule.leaves.push_back(i);
+    }
+
+    std::vector<size_t> streamOf(numNodes, none);
+    std::vector<size_t> positionOf(numNodes, 0); // 1-based position of the node on its stream
+    std::vector<size_t> stepOf(numNodes, none);
+    std::vector<size_t> lastOnStream(maxNumStreams, none);
+    std::vector<size_t> numOnStream(maxNumStreams, 0);
+    std::vector<std::vector<size_t>> covered(maxNumStreams, std::vector<size_t>(maxNumStreams, 0)); // [s][t]: position on t that s has waited for
+
+    for (size_t i = 0; i < numNodes; i++)
+    {
+        if (isLeaf[i])
+            continue;
+
+        // continue the chain of an input, or start a new one
+        size_t stream = none;
+        for (auto input : inputs[i])
+        {
+            if (!isLeaf[input] && lastOnStream[streamOf[input]] == input)
+            {
+                stream = streamOf[input];
+                break;
+            }
+        }
+        if (stream == none)
+            stream = std::min_element(numOnStream.begin(), numOnStream.end()) - numOnStream.begin();
+
+        StreamSchedule::Step step{ i, stream, {}, -1 };
+        auto addWait = [&](size_t dependency)
+        {
+            if (dependency >= i)
+                LogicError("PlanStreamSchedule: Node %d depends on node %d, which does not come before it.", (int)i, (int)dependency);
+            if (isLeaf[dependency] || streamOf[dependency] == stream || positionOf[dependency] <= covered[stream][streamOf[dependency]])
+                return;
+            auto& dependencyStep = schedule.steps[stepOf[dependency]];
+            if (dependencyStep.event < 0)
+                dependencyStep.event = (int)schedule.numEvents++;
+            step.waits.push_back((size_t)dependencyStep.event);
+            covered[stream][streamOf[dependency]] = positionOf[dependency];
+        };
+        for (auto input : inputs[i])
+            addWait(input);
+        if (i < predecessors.size())
+        {
+            for (auto predecessor : predecessors[i])
+                addWait(predecessor);
+        }
+
+        streamOf[i] = stream;
+        positionOf[i] = ++numOnStream[stream];
+        lastOnStream[stream] = i;
+        stepOf[i] = schedule.steps.size();
+        schedule.steps.push_back(step);
+        schedule.numStreams = std::max(schedule.numStreams, stream + 1);
+    }
+    return schedule;
+}
+
+// Wavefront -- consecutive recurrent loops that are stepped together, a stage per loop, e.g. the layers of a stacked
+// LSTM. At each time step, stage k runs the frame-local nodes between loop k-1 and loop k, then a step of loop k, on
+// its own stream after waiting for stage k-1 at the same time step; so stage k at time t overlaps stage k-1 at t+1.
+struct Wavefront
+{
+    struct Stage
+    {
+        std::vector<size_t> steppedNodes; // frame-local nodes between the previous loop and this one, in evaluation order
+        size_t loop;                      // index of the loop in evaluation order
+    };
+    std::vector<Stage> stages; // at least two
+};
+
+// Finds the wavefronts among the top-level nodes in evaluation order. 'isLoop[i]' tells the loops, 'isSteppable[i]' the
+// other nodes that can run one time step at a time, i.e. that only read one frame of their inputs. 'layoutOf[i]' and
+// 'directionOf[i]' identify the MBLayout and stepping direction; all members of a wavefront have the same ones (the
+// direction only matters for loops). A wavefront is a run of consecutive nodes, apart from nodes without dependencies,
+// which are computed up front: it starts at a loop, and may only depend on nodes before that loop, on its own
+// members, and on nodes without dependencies. Memory reuse ('predecessors') of a later member may only refer to
+// nodes before the wavefront, since its steps overlap with those of the earlier stages.
+inline std::vector<Wavefront> PlanWavefronts(const std::vector<std::vector<size_t>>& inputs,
+                                             const std::vector<std::vector<size_t>>& predecessors,
+                                             const std::vector<bool>& isLoop, const std::vector<bool>& isSteppable,
+                                             const std::vector<int>& layoutOf, const std::vector<int>& directionOf)
+{
+    const size_t numNodes = inputs.size();
+    auto isLeaf = [&](size_t i) { return inputs[i].empty() && (predecessors.size() <= i || predecessors[i].empty()); };
+
+    std::vector<Wavefront> wavefronts;
+    for (size_t first = 0; first < numNodes; first++)
+    {
+        if (!isLoop[first])
+            continue;
+
+        Wavefront wavefront;
+        wavefront.stages.push_back(Wavefront::Stage{ {}, first });
+        std::vector<bool> isMember(numNodes, false);
+        isMember[first] = true;
+        std::vector<size_t> stepped;
+        size_t last = first;
+        for (size_t i = first + 1; i < numNodes; i++)
+        {
+            if (isLeaf(i))
+                continue;
+            if ((!isLoop[i] && !isSteppable[i]) || layoutOf[i] != layoutOf[first] || (isLoop[i] && directionOf[i] != directionOf[first]))
+                break;
+            bool canJoin = true;
+            for (auto input : inputs[i])
+                canJoin &= input < first || isMember[input] || isLeaf(input);
+            if (i < predecessors.size())
+            {
+                for (auto predecessor : predecessors[i])
+                    canJoin &= predecessor < first || isLeaf(predecessor);
+            }
+            if (!canJoin)
+                break;
+
+            isMember[i] = true;
+            if (isLoop[i])
+            {
+                wavefront.stages.push_back(Wavefront::Stage{ std::move(stepped), i });
+                stepped.clear();
+                last = i;
+            }
+            else
+                stepped.push_back(i);
+        }
+        if (wavefront.stages.size() > 1)
+        {
+            wavefronts.push_back(std::move(wavefront));
+            first = last; // the frame-local nodes after the last loop are left to the regular traversal
+        }
+    }
+    return wavefronts;
+}
+
+}}}
@@ -0,0 +1,203 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "TensorParallelNodes.h"
+#include "MPIWrapper.h"
+#include "NcclComm.h"
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// TensorParallelGroup
+// -----------------------------------------------------------------------
+
+/*static*/ size_t TensorParallelGroup::NumShards()
+{
+    auto mpi = MPIWrapper::GetInstance();
+    return mpi ? mpi->NumNodesInUse() : 1;
+}
+
+/*static*/ size_t TensorParallelGroup::ShardIndex()
+{
+    auto mpi = MPIWrapper::GetInstance();
+    return mpi ? mpi->CurrentNodeRank() : 0;
+}
+
+// the communicator of a GPU, created when it first reduces; creating it is collective, as is every reduction
+static NcclComm& NcclCommFor(DEVICEID_TYPE deviceId, const MPIWrapperPtr& mpi)
+{
+    static std::mutex mutex;
+    static std::map<DEVICEID_TYPE, std::unique_ptr<NcclComm>> comms;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& comm = comms[deviceId];
+    if (!comm)
+        comm.reset(new NcclComm(deviceId, mpi));
+    return *comm;
+}
+
+template <class ElemType>
+static void AllReduce(Matrix<ElemType>& data, MPI_Op op)
+{
+    auto mpi = MPIWrapper::GetInstance();
+    if (!mpi || mpi->NumNodesInUse() == 1 || data.IsEmpty())
+        return;
+
+    if (data.GetDeviceId() == CPUDEVICE)
+    {
+        mpi->AllReduce(data.Data(), data.GetNumElements(), op);
+        return;
+    }
+
+    auto& nccl = NcclCommFor(data.GetDeviceId(), mpi);
+    if (nccl.IsSupported())
+    {
+        // on the compute stream, which orders it with the kernels that produce and use the data
+        nccl.AllReduceOnComputeStream(data.Data(), data.GetNumElements(), op);
+    }
+    else
+    {
+        unique_ptr<ElemType[]> buffer(data.CopyToArray());
+        mpi->AllReduce(buffer.get(), data.GetNumElements(), op);
+        data.SetValue(data.GetNumRows(), data.GetNumCols(), data.GetDeviceId(), buffer.get());
+    }
+}
+
+template <class ElemType>
+/*static*/ void TensorParallelGroup::AllReduceSum(Matrix<ElemType>& data)
+{
+    AllReduce(data, MPI_SUM);
+}
+
+template <class ElemType>
+/*static*/ void TensorParallelGroup::AllReduceMax(Matrix<ElemType>& data)
+{
+    AllReduce(data, MPI_MAX);
+}
+
+template void TensorParallelGroup::AllReduceSum<float>(Matrix<float>& data);
+template void TensorParallelGroup::AllReduceSum<double>(Matrix<double>& data);
+template void TensorParallelGroup::AllReduceMax<float>(Matrix<float>& data);
+template void TensorParallelGroup::AllReduceMax<double>(Matrix<double>& data);
+
+template class TensorParallelCopyNode<float>;
+template class TensorParallelCopyNode<double>;
+
+template class TensorParallelSumNode<float>;
+template class TensorParallelSumNode<double>;
+
+// -----------------------------------------------------------------------
+// TensorParallelCrossEntropyWithSoftmaxNode
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+/*virtual*/ void TensorParallelCrossEntropyWithSoftmaxNode<ElemType>::ForwardPropNonLooping() /*override*/
+{
+    FrameRange fr(InputRef(0).GetMBLayout());
+    size_t numRows = InputRef(1).Value().GetNumRows();
+    size_t numCols = InputRef(1).Value().GetNumCols();
+    TensorView<ElemType> prediction(InputRef(1).ValuePtr(), TensorShape(numRows, numCols));
+    TensorView<ElemType> logSoftmax(m_logSoftmaxOfRight, TensorShape(numRows, numCols));
+    TensorView<ElemType> softmax(m_softmaxOfRight, TensorShape(numRows, numCols));
+    TensorView<ElemType> logSumExp(m_logSumExpOfRight, TensorShape(1, numCols));
+    TensorView<ElemType> sumExp(m_sumExpOfRight, TensorShape(1, numCols));
+
+    // the max over all shards keeps the exponentials in range
+    logSumExp.DoUnaryOpOf(0, prediction, 1, ElementWiseOperator::opCopy, ElementWiseOperator::opMax);
+    TensorParallelGroup::AllReduceMax(*m_logSumExpOfRight);
+    softmax.AssignDifferenceOf(prediction, logSumExp);
+    m_softmaxOfRight->InplaceExp();
+    sumExp.DoUnaryOpOf(0, softmax, 1, ElementWiseOperator::opCopy, ElementWiseOperator::opSum);
+    TensorParallelGroup::AllReduceSum(*m_sumExpOfRight);
+    m_sumExpOfRight->InplaceLog();
+    *m_logSumExpOfRight += *m_sumExpOfRight;
+
+    // Note that we need both log and non-log for gradient computation.
+    logSoftmax.AssignDifferenceOf(prediction, logSumExp);
+    m_softmaxOfRight->SetValue(*m_logSoftmaxOfRight);
+    m_softmaxOfRight->InplaceExp();
+    // flatten all gaps to zero, such that gaps will contribute zero to the sum
+    MaskMissingColumnsToZero(*m_logSoftmaxOfRight, InputRef(1).GetMBLayout(), fr);
+
+    // reduce over all frames and all shards
+    AssignShardOfLabels(InputRef(0).MaskedValueFor(fr));
+    Value().AssignInnerProductOfMatrices(*m_shardLabels, *m_logSoftmaxOfRight);
+    TensorParallelGroup::AllReduceSum(Value());
+    Value() *= -1;
+#if NANCHECK
+    Value().HasNan("TensorParallelCrossEntropyWithSoftmax");
+#endif
+}
+
+template <class ElemType>
+/*virtual*/ void TensorParallelCrossEntropyWithSoftmaxNode<ElemType>::BackpropToNonLooping(size_t inputIndex) /*override*/
+{
+    // each shard only has the log-softmax of its own rows, hence the gradient of its own rows of the labels
+    if (inputIndex == 0)
+        InvalidArgument("%ls %ls operation does not compute the gradient of the labels.", NodeName().c_str(), OperationName().c_str());
+
+    FrameRange fr(InputRef(0).GetMBLayout());
+    auto gradient = InputRef(1).GradientFor(fr);
+    Matrix<ElemType>::AddScaledDifference(Gradient(), *m_softmaxOfRight, *m_shardLabels, gradient);
+}
+
+template <class ElemType>
+/*virtual*/ void TensorParallelCrossEntropyWithSoftmaxNode<ElemType>::Validate(bool isFinalValidationPass) /*override*/
+{
+    Base::Validate(isFinalValidationPass);
+    m_pMBLayout = nullptr; // this node does not hold mini-batch data
+
+    if (isFinalValidationPass)
+    {
+        if (!Input(0)->HasMBLayout() || !Input(1)->HasMBLayout())
+            LogicError("%ls: Expected MBLayout in both inputs.", NodeDescription().c_str());
+        if (Input(0)->GetSampleLayout().GetRank() > 1 || Input(1)->GetSampleLayout().GetRank() > 1)
+            InvalidArgument("%ls: The labels and the prediction must be vectors.", NodeDescription().c_str());
+
+        size_t numClasses = Input(0)->GetSampleMatrixNumRows();
+        size_t numShardClasses = Input(1)->GetSampleMatrixNumRows();
+        if (numShardClasses * TensorParallelGroup::NumShards() != numClasses)
+            InvalidArgument("%ls: The %d classes of the labels are not split evenly into the %d classes of each of the %d shards.",
+                            NodeDescription().c_str(), (int)numClasses, (int)numShardClasses, (int)TensorParallelGroup::NumShards());
+    }
+    SetDims(TensorShape::Scalar(Environment().IsV2Library()), false);
+}
+
+template <class ElemType>
+void TensorParallelCrossEntropyWithSoftmaxNode<ElemType>::AssignShardOfLabels(const Matrix<ElemType>& labels)
+{
+    size_t numShardRows = m_logSoftmaxOfRight->GetNumRows();
+    size_t firstRow = TensorParallelGroup::ShardIndex() * numShardRows;
+    if (labels.GetMatrixType() != SPARSE)
+    {
+        m_shardLabels->AssignRowSliceValuesOf(labels, firstRow, numShardRows);
+        return;
+    }
+
+    // the sparse labels only have a few non-zeros per column, which are scattered on the host
+    vector<CPUSPARSE_INDEX_TYPE> colStarts, rowIndices;
+    vector<ElemType> values;
+    labels.GetMatrixFromCSCFormat(colStarts, rowIndices, values);
+    size_t numCols = labels.GetNumCols();
+    vector<ElemType> shardLabels(numShardRows * numCols, 0);
+    for (size_t j = 0; j < numCols; j++)
+    {
+        for (auto k = colStarts[j]; k < colStarts[j + 1]; k++)
+        {
+            size_t row = (size_t)rowIndices[k];
+            if (row >= firstRow && row < firstRow + numShardRows)
+                shardLabels[j * numShardRows + row - firstRow] = values[k];
+        }
+    }
+    m_shardLabels->SetValue(numShardRows, numCols, m_shardLabels->GetDeviceId(), shardLabels.data());
+}
+
+template class TensorParallelCrossEntropyWithSoftmaxNode<float>;
+template class TensorParallelCrossEntropyWithSoftmaxNode<double>;
+
+}}}
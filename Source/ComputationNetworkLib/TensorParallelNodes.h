@@ -0,0 +1,205 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Nodes for tensor (intra-layer) model parallelism: a large TimesNode layer is split across the ranks of MPI,
+// each rank holding one shard of its weight.
+//
+// A column-sharded layer (each rank holds some output rows of the weight) is
+//     h_shard = Times (W_shard, TensorParallelCopy (x))
+// whose partial outputs can go on elementwise, and into a row-sharded layer (each rank holds some input columns)
+//     y = TensorParallelSum (Times (V_shard, h_shard))
+// A column-sharded output layer goes straight into TensorParallelCrossEntropyWithSoftmax, which never gathers
+// the full logits.
+//
+// All ranks must see the same minibatch and hold the same replicated parameters. Data-parallel gradient
+// aggregation across the same ranks is not supported.
+//
+
+#pragma once
+
+#include "Basics.h"
+#include "ComputationNode.h"
+#include "Matrix.h"
+#include "TensorView.h"
+
+#include <memory>
+#include <string>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// TensorParallelGroup -- the ranks over which tensor-parallel layers are sharded, one shard per rank of MPI.
+// Without MPI there is a single shard, and the reductions do nothing.
+// The reductions are done on the GPU with NCCL where it is available, otherwise through host memory with MPI.
+// NCCL reductions are queued on the compute stream without the host waiting for them.
+// -----------------------------------------------------------------------
+
+class TensorParallelGroup
+{
+public:
+    static size_t NumShards();
+    static size_t ShardIndex();
+
+    // in-place reductions over all shards
+    template <class ElemType>
+    static void AllReduceSum(Matrix<ElemType>& data);
+    template <class ElemType>
+    static void AllReduceMax(Matrix<ElemType>& data);
+};
+
+// -----------------------------------------------------------------------
+// TensorParallelCopyNode (input)
+// Outputs its input, which is replicated on all shards, to a column-sharded layer. Every shard computes
+// a partial gradient of the input, so the gradient is summed over the shards.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class TensorParallelCopyNode : public UnaryElementWiseNode<ElemType>
+{
+    typedef UnaryElementWiseNode<ElemType> Base;
+    UsingUnaryElementwiseNodeBaseMembers;
+    static const std::wstring TypeName() { return L"TensorParallelCopy"; }
+public:
+    DeclareConstructorFromConfigWithNumInputs(TensorParallelCopyNode);
+    TensorParallelCopyNode(DEVICEID_TYPE deviceId, const wstring& name)
+        : Base(deviceId, name)
+    {
+    }
+
+    virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override
+    {
+        ValueFor(fr).AssignValuesOf(InputRef(0).ValueFor(fr));
+    }
+
+    virtual void /*ComputationNode::*/ BackpropTo(const size_t /*inputIndex*/, const FrameRange& fr) override
+    {
+        // the gradient of this node is not used otherwise, so it is reduced in place
+        auto gradient = GradientFor(fr);
+        TensorParallelGroup::AllReduceSum(gradient);
+        InputRef(0).GradientFor(fr) += gradient;
+    }
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
+};
+
+// -----------------------------------------------------------------------
+// TensorParallelSumNode (partialInput)
+// Sums the partial outputs of a row-sharded layer over the shards. The sum is replicated, and so is its gradient,
+// which is passed through.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class TensorParallelSumNode : public UnaryElementWiseNode<ElemType>
+{
+    typedef UnaryElementWiseNode<ElemType> Base;
+    UsingUnaryElementwiseNodeBaseMembers;
+    static const std::wstring TypeName() { return L"TensorParallelSum"; }
+public:
+    DeclareConstructorFromConfigWithNumInputs(TensorParallelSumNode);
+    TensorParallelSumNode(DEVICEID_TYPE deviceId, const wstring& name)
+        : Base(deviceId, name)
+    {
+    }
+
+    virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override
+    {
+        auto result = ValueFor(fr);
+        result.AssignValuesOf(InputRef(0).ValueFor(fr));
+        TensorParallelGroup::AllReduceSum(result);
+    }
+
+    virtual void /*ComputationNode::*/ BackpropTo(const size_t /*inputIndex*/, const FrameRange& fr) override
+    {
+        InputRef(0).GradientFor(fr) += GradientFor(fr);
+    }
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
+};
+
+// -----------------------------------------------------------------------
+// TensorParallelCrossEntropyWithSoftmaxNode (labels, shardPrediction)
+// CrossEntropyWithSoftmax of logits that are split by rows across the shards: with C classes and N shards,
+// shardPrediction holds the C/N logits [shard * C/N, (shard + 1) * C/N) of this shard, and labels all C classes.
+// calculates: -sum(labels_i * (prediction_i - logSumExp(prediction)))
+// The log-sum-exp of each column is reduced from the max and the sum of the exponentials of each shard,
+// and the inner product with the labels from the products of each shard, so only [1 x T] rows and the
+// scalar result are exchanged. The gradient of each shard only needs its own logits and labels.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class TensorParallelCrossEntropyWithSoftmaxNode : public ComputationNodeNonLooping /*ComputationNode*/<ElemType>, public NumInputs<2>
+{
+    typedef ComputationNodeNonLooping<ElemType> Base; UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"TensorParallelCrossEntropyWithSoftmax"; }
+
+public:
+    DeclareConstructorFromConfigWithNumInputs(TensorParallelCrossEntropyWithSoftmaxNode);
+    TensorParallelCrossEntropyWithSoftmaxNode(DEVICEID_TYPE deviceId, const wstring& name)
+        : Base(deviceId, name)
+    {
+    }
+
+    virtual void BackpropToNonLooping(size_t inputIndex) override;
+    virtual void /*ComputationNodeNonLooping::*/ ForwardPropNonLooping() override;
+    virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override;
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
+
+    virtual void UpdateFunctionMBSize() override
+    {
+        m_logSoftmaxOfRight->Resize(Input(1)->Value());
+        m_softmaxOfRight->Resize(*m_logSoftmaxOfRight);
+        m_logSumExpOfRight->Resize(1, m_logSoftmaxOfRight->GetNumCols());
+        m_sumExpOfRight->Resize(*m_logSumExpOfRight);
+        m_shardLabels->Resize(*m_logSoftmaxOfRight);
+    }
+
+    virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
+    {
+        Base::CopyTo(nodeP, newName, flags);
+        if (flags & CopyNodeFlags::copyNodeValue)
+        {
+            auto node = dynamic_pointer_cast<TensorParallelCrossEntropyWithSoftmaxNode<ElemType>>(nodeP);
+            node->m_logSoftmaxOfRight->SetValue(*m_logSoftmaxOfRight);
+            node->m_softmaxOfRight->SetValue(*m_softmaxOfRight);
+        }
+    }
+
+    // request matrices needed to do node function value evaluation
+    virtual void RequestMatricesBeforeForwardProp(MatrixPool& matrixPool)
+    {
+        Base::RequestMatricesBeforeForwardProp(matrixPool);
+        RequestMatrixFromPool(m_logSoftmaxOfRight, matrixPool);
+        RequestMatrixFromPool(m_softmaxOfRight, matrixPool);
+        RequestMatrixFromPool(m_logSumExpOfRight, matrixPool);
+        RequestMatrixFromPool(m_sumExpOfRight, matrixPool);
+        RequestMatrixFromPool(m_shardLabels, matrixPool);
+    }
+
+    // release gradient and temp matrices that no longer needed after all the children's gradients are computed.
+    virtual void ReleaseMatricesAfterBackprop(MatrixPool& matrixPool)
+    {
+        Base::ReleaseMatricesAfterBackprop(matrixPool);
+        ReleaseMatrixToPool(m_logSoftmaxOfRight, matrixPool);
+        ReleaseMatrixToPool(m_softmaxOfRight, matrixPool);
+        ReleaseMatrixToPool(m_logSumExpOfRight, matrixPool);
+        ReleaseMatrixToPool(m_sumExpOfRight, matrixPool);
+        ReleaseMatrixToPool(m_shardLabels, matrixPool);
+    }
+
+protected:
+    // assigns the rows of this shard of the labels, which may be sparse, to the dense m_shardLabels
+    void AssignShardOfLabels(const Matrix<ElemType>& labels);
+
+    shared_ptr<Matrix<ElemType>> m_logSoftmaxOfRight; // [C/N x T]
+    shared_ptr<Matrix<ElemType>> m_softmaxOfRight;    // [C/N x T]
+    shared_ptr<Matrix<ElemType>> m_logSumExpOfRight;  // [1 x T], over all shards
+    shared_ptr<Matrix<ElemType>> m_sumExpOfRight;     // [1 x T], temp
+    shared_ptr<Matrix<ElemType>> m_shardLabels;       // [C/N x T]
+};
+
+}}}
@@ -4,6 +4,7 @@
 //
 
 #include "TrainingNodes.h"
+#include "TensorParallelNodes.h"
 #include <boost/random/uniform_real_distribution.hpp>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -307,6 +308,328 @@ template class RandomSampleInclusionFrequencyNode<float>;
 template class RandomSampleInclusionFrequencyNode<double>;
 template class RandomSampleInclusionFrequencyNode<half>;
 
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::Save(File& fstream) const
+{
+    Base::Save(fstream);
+    fstream << m_sizeOfSampledSet;
+    RngUser::Save(fstream);
+}
+
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::Load(File& fstream, size_t modelVersion)
+{
+    Base::Load(fstream, modelVersion);
+    fstream >> m_sizeOfSampledSet;
+    RngUser::Load(fstream, modelVersion);
+}
+
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const
+{
+    Base::CopyTo(nodeP, newName, flags);
+    if (flags & CopyNodeFlags::copyNodeValue)
+    {
+        auto node = dynamic_pointer_cast<SampledCrossEntropyWithSoftmaxNode<ElemType>>(nodeP);
+        node->m_sizeOfSampledSet = m_sizeOfSampledSet;
+        node->SetRngState(GetRngSeed(), GetRngOffset());
+    }
+}
+
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::Validate(bool isFinalValidationPass)
+{
+    Base::Validate(isFinalValidationPass);
+    m_pMBLayout = nullptr; // this node does not hold mini-batch data
+
+    const size_t numInputs = GetNumInputs();
+    if (numInputs != 4 && numInputs != 5)
+        InvalidArgument("%ls %ls operation requires 4 or 5 inputs: labels, input, weights, bias and optionally the sampling weights.", NodeName().c_str(), OperationName().c_str());
+
+    if (isFinalValidationPass)
+    {
+        if (!Input(0)->HasMBLayout() || !Input(1)->HasMBLayout() || Input(2)->HasMBLayout() || Input(3)->HasMBLayout() || (numInputs == 5 && Input(4)->HasMBLayout()))
+            LogicError("%ls %ls operation requires the labels and the input to be minibatches, and the weights, the bias and the sampling weights to have no dynamic axis.",
+                       NodeName().c_str(), OperationName().c_str());
+        if (Input(0)->GetMBLayout() != Input(1)->GetMBLayout() && *Input(0)->GetMBLayout() != *Input(1)->GetMBLayout())
+            LogicError("%ls %ls operation requires the labels and the input to have the same dynamic axis.", NodeName().c_str(), OperationName().c_str());
+
+        const size_t numClasses = Input(0)->GetSampleMatrixNumRows();
+        if (Input(2)->GetAsMatrixNumRows() != Input(1)->GetSampleMatrixNumRows() || Input(2)->GetAsMatrixNumCols() != numClasses)
+            InvalidArgument("%ls %ls operation requires the weights to be [%d x %d], the input dimension times the number of classes.",
+                            NodeName().c_str(), OperationName().c_str(), (int)Input(1)->GetSampleMatrixNumRows(), (int)numClasses);
+        if (Input(3)->GetSampleLayout().GetNumElements() != numClasses || (numInputs == 5 && Input(4)->GetSampleLayout().GetNumElements() != numClasses))
+            InvalidArgument("%ls %ls operation requires the bias and the sampling weights to have one element per class.", NodeName().c_str(), OperationName().c_str());
+        if (m_sizeOfSampledSet == 0)
+            InvalidArgument("%ls %ls operation requires sizeOfSampledSet to be positive.", NodeName().c_str(), OperationName().c_str());
+        // the class ids go through the element type
+        if (std::is_same<ElemType, half>::value && numClasses > 2048)
+            InvalidArgument("%ls %ls operation supports at most 2048 classes in half precision.", NodeName().c_str(), OperationName().c_str());
+    }
+
+    SetDims(TensorShape(1), false);
+}
+
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::UpdateSamplingDistribution()
+{
+    if (GetNumInputs() < 5 || (!m_samplingProbabilities.empty() && InputRef(4).GetEvalTimeStamp() == m_samplingWeightsTimeStamp))
+        return;
+
+    const Matrix<ElemType>& samplingWeights = InputRef(4).ValueAsMatrix();
+    const size_t numClasses = samplingWeights.GetNumElements();
+    std::unique_ptr<ElemType[]> weights(samplingWeights.CopyToArray());
+    double sumOfWeights = 0;
+    for (size_t k = 0; k < numClasses; k++)
+    {
+        if (weights[k] < 0)
+            InvalidArgument("Sampling weights contain negative number %f.", (float)weights[k]);
+        sumOfWeights += (double)weights[k];
+    }
+    if (sumOfWeights <= 0)
+        InvalidArgument("%ls %ls operation requires the sampling weights not to be all zero.", NodeName().c_str(), OperationName().c_str());
+
+    // Each of the numClasses columns has the probability 1 / numClasses and holds at most two classes: columns of
+    // classes with less than the average probability are filled up with a class with more.
+    m_samplingProbabilities.resize(numClasses);
+    m_aliasThresholds.resize(numClasses);
+    m_aliases.resize(numClasses);
+    std::vector<size_t> small, large;
+    for (size_t k = 0; k < numClasses; k++)
+    {
+        m_samplingProbabilities[k] = weights[k] / sumOfWeights;
+        m_aliasThresholds[k] = m_samplingProbabilities[k] * numClasses;
+        m_aliases[k] = k;
+        (m_aliasThresholds[k] < 1 ? small : large).push_back(k);
+    }
+    while (!small.empty() && !large.empty())
+    {
+        size_t less = small.back();
+        size_t more = large.back();
+        small.pop_back();
+        m_aliases[less] = more;
+        m_aliasThresholds[more] -= 1 - m_aliasThresholds[less];
+        if (m_aliasThresholds[more] < 1)
+        {
+            large.pop_back();
+            small.push_back(more);
+        }
+    }
+    // the remaining columns are full, up to rounding
+    for (size_t k : small)
+        m_aliasThresholds[k] = 1;
+    for (size_t k : large)
+        m_aliasThresholds[k] = 1;
+
+    m_samplingWeightsTimeStamp = InputRef(4).GetEvalTimeStamp();
+}
+
+template <class ElemType>
+double SampledCrossEntropyWithSoftmaxNode<ElemType>::SamplingProbability(size_t classId, size_t numClasses) const
+{
+    if (!m_samplingProbabilities.empty())
+        return m_samplingProbabilities[classId];
+    else
+        return log1p(1.0 / (classId + 1)) / log1p((double)numClasses);
+}
+
+template <class ElemType>
+std::vector<size_t> SampledCrossEntropyWithSoftmaxNode<ElemType>::DrawSamples(size_t numClasses)
+{
+    boost::random::uniform_real_distribution<double> r(0, 1);
+    CPURNGHandle* cpuRNGHandle = dynamic_cast<CPURNGHandle*>(&GetRNGHandle(CPUDEVICE));
+    const double logRange = log1p((double)numClasses);
+
+    std::vector<size_t> samples(m_sizeOfSampledSet);
+    for (auto& sample : samples)
+    {
+        double randomValue = r(cpuRNGHandle->Generator());
+        if (m_samplingProbabilities.empty())
+        {
+            // inverse of the cumulative log-uniform distribution log(k + 1) / log(numClasses + 1)
+            sample = std::min((size_t)exp(randomValue * logRange) - 1, numClasses - 1);
+        }
+        else
+        {
+            // a column of the alias table, and the fraction within it to choose between its class and its alias
+            double column = randomValue * numClasses;
+            size_t k = std::min((size_t)column, numClasses - 1);
+            sample = column - k < m_aliasThresholds[k] ? k : m_aliases[k];
+        }
+    }
+    UpdateRngOffset(GetRngOffset() + m_sizeOfSampledSet);
+    return samples;
+}
+
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::ForwardPropNonLooping()
+{
+    FrameRange fr(InputRef(0).GetMBLayout());
+    const auto& labels = InputRef(0).ValueFor(fr);
+    const auto& input = InputRef(1).ValueFor(fr);
+    const auto& weights = InputRef(2).ValueAsMatrix();
+    const size_t numClasses = weights.GetNumCols();
+    const size_t numFrames = input.GetNumCols();
+    const size_t numSamples = m_sizeOfSampledSet;
+    const size_t numCandidates = numFrames + numSamples;
+    const DEVICEID_TYPE deviceId = input.GetDeviceId();
+
+    m_isSampled = Environment().IsTraining();
+    m_gradientValid = false;
+    if (!m_isSampled)
+    {
+        // the full cross entropy with softmax, for evaluation
+        m_logits->AssignProductOf(weights, true, input, false);
+        Matrix<ElemType>::ScaleAndAdd(1, InputRef(3).ValueAsMatrix(), *m_logits);
+        m_logits->InplaceLogSoftmax(true);
+        MaskMissingColumnsToZero(*m_logits, InputRef(1).GetMBLayout(), fr);
+        Value().AssignInnerProductOfMatrices(InputRef(0).MaskedValueFor(fr), *m_logits);
+        Value() *= -1;
+        return;
+    }
+
+    // class ids of the labels, as the product of the row vector 0, 1, 2, ... with the one-hot labels
+    if (m_classIds->GetNumCols() != numClasses)
+    {
+        std::vector<ElemType> classIds(numClasses);
+        for (size_t k = 0; k < numClasses; k++)
+            classIds[k] = (ElemType)k;
+        m_classIds->SetValue(1, numClasses, deviceId, classIds.data());
+    }
+    m_labelIds->AssignProductOf(*m_classIds, false, labels, false);
+    std::unique_ptr<ElemType[]> labelIds(m_labelIds->CopyToArray());
+
+    // the candidates are the labels and the samples; their logits are corrected by -log(expected count in the samples)
+    UpdateSamplingDistribution();
+    const std::vector<size_t> samples = DrawSamples(numClasses);
+    std::vector<CPUSPARSE_INDEX_TYPE> columnStarts(numCandidates + 1), rowIndices(numCandidates);
+    std::vector<ElemType> ones(numCandidates, 1), corrections(numCandidates), sampleIds(numSamples);
+    for (size_t j = 0; j < numCandidates; j++)
+    {
+        size_t classId;
+        if (j < numFrames)
+        {
+            classId = (size_t)((float)labelIds[j] + 0.5f); // gaps have class 0, they are masked below
+            if (classId >= numClasses)
+                InvalidArgument("%ls %ls operation requires one-hot labels.", NodeName().c_str(), OperationName().c_str());
+        }
+        else
+        {
+            classId = samples[j - numFrames];
+            sampleIds[j - numFrames] = (ElemType)classId;
+        }
+        columnStarts[j] = (CPUSPARSE_INDEX_TYPE)j;
+        rowIndices[j] = (CPUSPARSE_INDEX_TYPE)classId;
+        corrections[j] = (ElemType)-log(std::max(numSamples * SamplingProbability(classId, numClasses), 1e-30));
+    }
+    columnStarts[numCandidates] = (CPUSPARSE_INDEX_TYPE)numCandidates;
+
+    if (m_selection->GetDeviceId() != deviceId)
+        m_selection = make_shared<Matrix<ElemType>>(0, 0, deviceId, SPARSE, matrixFormatSparseCSC);
+    m_selection->SetMatrixFromCSCFormat(columnStarts.data(), rowIndices.data(), ones.data(), numCandidates, numClasses, numCandidates);
+    m_sampleIds->SetValue(numSamples, 1, deviceId, sampleIds.data());
+    m_candidateValues->SetValue(1, numCandidates, deviceId, corrections.data());
+    Matrix<ElemType>::MultiplyAndWeightedAdd(1, InputRef(3).ValueAsMatrix().Reshaped(1, numClasses), false, *m_selection, false, 1, *m_candidateValues);
+
+    // logits of the labels and of the samples
+    m_gatheredWeights->AssignProductOf(weights, false, *m_selection, false);
+    auto labelLogits = m_candidateValues->ColumnSlice(0, numFrames);
+    Matrix<ElemType> labelLogitCorrections = labelLogits.DeepClone();
+    Matrix<ElemType>::InnerProduct(input, m_gatheredWeights->ColumnSlice(0, numFrames), labelLogits, true);
+    labelLogits += labelLogitCorrections;
+
+    m_sampledLogits->AssignProductOf(m_gatheredWeights->ColumnSlice(numFrames, numSamples), true, input, false);
+    Matrix<ElemType>::ScaleAndAdd(1, m_candidateValues->ColumnSlice(numFrames, numSamples).Reshaped(numSamples, 1), *m_sampledLogits);
+
+    // remove the samples that hit the label of the frame
+    TensorView<ElemType>(m_sampledLogits, TensorShape(numSamples, numFrames))
+        .DoBinaryOpOf(1, TensorView<ElemType>(m_sampleIds, TensorShape(numSamples, 1)), TensorView<ElemType>(m_labelIds, TensorShape(1, numFrames)),
+                      (ElemType)-10000, ElementWiseOperator::opEqual, ElementWiseOperator::opSum);
+
+    // log softmax over the label and the samples of each frame
+    m_logits->Resize(numSamples + 1, numFrames);
+    m_logits->AssignToRowSliceValuesOf(labelLogits, 0, 1);
+    m_logits->AssignToRowSliceValuesOf(*m_sampledLogits, 1, numSamples);
+    m_logits->InplaceLogSoftmax(true);
+    MaskMissingColumnsToZero(*m_logits, InputRef(1).GetMBLayout(), fr);
+
+    labelLogits.AssignRowSliceValuesOf(*m_logits, 0, 1);
+    Value().AssignSumOfElements(labelLogits);
+    Value() *= -1;
+}
+
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::BackpropToNonLooping(size_t inputIndex)
+{
+    if (!m_isSampled)
+        LogicError("%ls %ls operation computes gradients only for the sampled criterion in training.", NodeName().c_str(), OperationName().c_str());
+    if (inputIndex == 0 || inputIndex == 4)
+        LogicError("%ls %ls operation has no gradient for the labels and the sampling weights.", NodeName().c_str(), OperationName().c_str());
+
+    FrameRange fr(InputRef(0).GetMBLayout());
+    const size_t numFrames = m_logits->GetNumCols();
+    const size_t numSamples = m_sizeOfSampledSet;
+    auto labelGradient = m_candidateValues->ColumnSlice(0, numFrames);
+    if (!m_gradientValid)
+    {
+        // gradient of the criterion w.r.t. the logits: softmax - 1 for the labels and softmax for the samples, times the output gradient
+        labelGradient.AssignRowSliceValuesOf(*m_logits, 0, 1);
+        labelGradient.InplaceExp();
+        labelGradient += (ElemType)-1;
+        m_sampledLogits->AssignRowSliceValuesOf(*m_logits, 1, numSamples);
+        m_sampledLogits->InplaceExp();
+        Matrix<ElemType>::Scale(Gradient(), labelGradient);
+        Matrix<ElemType>::Scale(Gradient(), *m_sampledLogits);
+        MaskMissingColumnsToZero(labelGradient, InputRef(1).GetMBLayout(), fr);
+        MaskMissingColumnsToZero(*m_sampledLogits, InputRef(1).GetMBLayout(), fr);
+
+        // sums over the frames for the samples, so that the candidates have one gradient each
+        Matrix<ElemType> sampleGradientSums = m_candidateValues->ColumnSlice(numFrames, numSamples).Reshaped(numSamples, 1);
+        Matrix<ElemType>::VectorSum(*m_sampledLogits, sampleGradientSums, false);
+        m_gradientValid = true;
+    }
+
+    if (inputIndex == 1) // input
+    {
+        // label weights .* label gradient + sample weights * sample gradient; only this gradient uses the weights, so they are scaled in place
+        auto inputGradient = InputRef(1).GradientFor(fr);
+        auto labelWeights = m_gatheredWeights->ColumnSlice(0, numFrames);
+        labelWeights.RowElementMultiplyWith(labelGradient);
+        inputGradient += labelWeights;
+        Matrix<ElemType>::MultiplyAndWeightedAdd(1, m_gatheredWeights->ColumnSlice(numFrames, numSamples), false, *m_sampledLogits, false, 1, inputGradient);
+    }
+    else if (inputIndex == 2) // weights
+    {
+        // [input .* label gradient, input * sample gradient^T] * selection^T, which only has the columns of the candidates
+        const auto& input = InputRef(1).ValueFor(fr);
+        m_candidateGradient->Resize(input.GetNumRows(), numFrames + numSamples);
+        auto labelPart = m_candidateGradient->ColumnSlice(0, numFrames);
+        labelPart.SetValue(input);
+        labelPart.RowElementMultiplyWith(labelGradient);
+        auto samplePart = m_candidateGradient->ColumnSlice(numFrames, numSamples);
+        Matrix<ElemType>::MultiplyAndWeightedAdd(1, input, false, *m_sampledLogits, true, 0, samplePart);
+
+        // as for Times with a sparse right operand, the gradient is sparse block-column (see TimesNodeBase::BackpropTo())
+        if (InputRef(2).GetPreferredGradientMatrixType() == UNDETERMINED && InputRef(2).Gradient().GetMatrixType() == DENSE)
+        {
+            auto& currentGradient = InputRef(2).Gradient();
+            InputRef(2).GradientPtrRef() = std::make_shared<Matrix<ElemType>>(currentGradient.GetNumRows(), currentGradient.GetNumCols(),
+                                                                              currentGradient.GetPreferredDeviceId(), SPARSE, MatrixFormat::matrixFormatSparseBlockCol);
+            InputRef(2).SetPreferredGradientMatrixType(SPARSE);
+        }
+        Matrix<ElemType>::MultiplyAndWeightedAdd(1, *m_candidateGradient, false, *m_selection, true, 1, InputRef(2).Gradient());
+    }
+    else if (inputIndex == 3) // bias, as a row vector
+    {
+        auto biasGradient = InputRef(3).GradientAsMatrix().Reshaped(1, InputRef(3).GetSampleLayout().GetNumElements());
+        Matrix<ElemType>::MultiplyAndWeightedAdd(1, *m_candidateValues, false, *m_selection, true, 1, biasGradient);
+    }
+}
+
+template class SampledCrossEntropyWithSoftmaxNode<float>;
+template class SampledCrossEntropyWithSoftmaxNode<double>;
+template class SampledCrossEntropyWithSoftmaxNode<half>;
+
 template<class ElemType>
 void DropoutNode<ElemType>::Save(File& fstream) const
 {
@@ -341,8 +664,164 @@ template class DropoutNode<float>;
 template class DropoutNode<double>;
 template class DropoutNode<half>;
 
+// The shapes in which the [D x N] data and the [C] statistics of a batch normalization broadcast against each other:
+// [D/C x C x N] and [1 x C x 1], or for channels last [C x D/C x N] and [C x 1 x 1]. C = D if not spatial.
+static void GetBatchNormalizationShapes(size_t dim, size_t numCols, size_t numStats, bool channelsLast, TensorShape& dataShape, TensorShape& statShape)
+{
+    size_t mapSize = dim / numStats;
+    dataShape = channelsLast ? TensorShape(numStats, mapSize, numCols) : TensorShape(mapSize, numStats, numCols);
+    statShape = channelsLast ? TensorShape(numStats, 1, 1) : TensorShape(1, numStats, 1);
+}
+
+template <class ElemType>
+static TensorView<ElemType> TensorViewOf(const Matrix<ElemType>& data, const TensorShape& shape)
+{
+    return TensorView<ElemType>(make_shared<Matrix<ElemType>>(data.AsReference()), shape);
+}
+
+template <class ElemType>
+size_t BatchNormalizationNode<ElemType>::SyncGroupColumn(size_t numStats, size_t& numColumns) const
+{
+    size_t numRanks = TensorParallelGroup::NumShards();
+    size_t groupSize = (m_syncGroupSize == 0 || m_syncGroupSize > numRanks) ? numRanks : m_syncGroupSize;
+    numColumns = numStats * ((numRanks + groupSize - 1) / groupSize);
+    return numStats * (TensorParallelGroup::ShardIndex() / groupSize);
+}
+
+template <class ElemType>
+void BatchNormalizationNode<ElemType>::ForwardPropSynchronized(const Matrix<ElemType>& in, const Matrix<StatType>& scale, const Matrix<StatType>& bias, double expAvgFactor,
+                                                               Matrix<StatType>& runMean, Matrix<StatType>& runVariance, Matrix<ElemType>& out)
+{
+    const size_t numStats = scale.GetNumElements();
+    TensorShape dataShape, statShape, vectorShape(numStats);
+    GetBatchNormalizationShapes(in.GetNumRows(), in.GetNumCols(), numStats, m_spatial && m_imageLayoutKind != CHW, dataShape, statShape);
+    auto x = TensorViewOf(in, dataShape);
+
+    // this worker's sums go into the columns of its group, which are reduced over all workers in one go
+    size_t numColumns;
+    size_t column = SyncGroupColumn(3, numColumns);
+    m_syncStats.Resize(numStats, numColumns);
+    m_syncStats.SetValue(0);
+    Matrix<StatType> sum          = m_syncStats.ColumnSlice(column,     1);
+    Matrix<StatType> sumOfSquares = m_syncStats.ColumnSlice(column + 1, 1);
+    Matrix<StatType> count        = m_syncStats.ColumnSlice(column + 2, 1);
+    TensorViewOf(sum, statShape).AssignCopyOf(x); // (reduces over the axes along which the statistics broadcast)
+    TensorViewOf(sumOfSquares, statShape).AssignSqrOf(x);
+    count.SetValue((StatType)(in.GetNumElements() / numStats));
+    TensorParallelGroup::AllReduceSum(m_syncStats);
+
+    // the mean and the biased variance of the group normalize the data
+    m_savedMean->Resize(numStats, 1);
+    m_savedInvStdDev->Resize(numStats, 1);
+    auto mean     = TensorViewOf(*m_savedMean, vectorShape);
+    auto variance = TensorViewOf(sumOfSquares, vectorShape);
+    auto sumT     = TensorViewOf(sum, vectorShape);
+    auto countT   = TensorViewOf(count, vectorShape);
+    mean.AssignElementwiseQuotientOf(sumT, countT);
+    variance.AssignElementwiseQuotientOf(variance, countT);
+    variance.AddSqrOf(mean, -1);
+    variance.AssignLinearRectifierOf(variance); // (the difference may round to below 0)
+
+    // the running variance is unbiased, like that of the engines
+    if (expAvgFactor > 0)
+    {
+        TensorViewOf(runMean, vectorShape).DoCopyOf((StatType)(1 - expAvgFactor), mean, (StatType)expAvgFactor);
+        Matrix<StatType>& besselCorrection = sum; // count / (count - 1)
+        besselCorrection.AssignValuesOf(count);
+        besselCorrection += (StatType)-1;
+        besselCorrection.InplaceTruncateBottom(1);
+        sumT.AssignElementwiseQuotientOf(countT, sumT);
+        TensorViewOf(runVariance, vectorShape).DoElementwiseProductOf((StatType)(1 - expAvgFactor), variance, sumT, (StatType)expAvgFactor);
+    }
+
+    sumOfSquares += (StatType)m_epsilon;
+    auto invStdDev = TensorViewOf(*m_savedInvStdDev, vectorShape);
+    invStdDev.AssignSqrtOf(variance);
+    invStdDev.AssignReciprocalOf(invStdDev);
+
+    // out = in * factor + offset, with factor = scale * invStdDev and offset = bias - mean * factor
+    Matrix<StatType>& factor = sum;
+    Matrix<StatType>& offset = count;
+    TensorViewOf(factor, vectorShape).AssignElementwiseProductOf(TensorViewOf(scale, vectorShape), invStdDev);
+    TensorViewOf(offset, vectorShape).AssignElementwiseProductOf(mean, TensorViewOf(factor, vectorShape));
+    TensorViewOf(offset, vectorShape).AssignDifferenceOf(TensorViewOf(bias, vectorShape), TensorViewOf(offset, vectorShape));
+    auto y = TensorViewOf(out, dataShape);
+    y.AssignElementwiseProductOf(x, TensorViewOf(factor, statShape));
+    y.AddCopyOf(TensorViewOf(offset, statShape));
+}
+
+template <class ElemType>
+void BatchNormalizationNode<ElemType>::BackpropToSynchronized(const Matrix<ElemType>& in, const Matrix<ElemType>& outGrad, bool computeInputGrad, Matrix<ElemType>& inGrad,
+                                                              const Matrix<StatType>& scale, bool accumulateInputGrad)
+{
+    const size_t numStats = scale.GetNumElements();
+    TensorShape dataShape, statShape, vectorShape(numStats);
+    GetBatchNormalizationShapes(in.GetNumRows(), in.GetNumCols(), numStats, m_spatial && m_imageLayoutKind != CHW, dataShape, statShape);
+    auto x  = TensorViewOf(in, dataShape);
+    auto dy = TensorViewOf(outGrad, dataShape);
+
+    // The gradients of scale and bias only sum over the samples of this worker, since SGD sums them over the workers.
+    // dScale = sum(outGrad * normalized), with normalized = (in - mean) * invStdDev
+    m_dDataDummy->Resize(in);
+    auto centered = TensorViewOf(*m_dDataDummy, dataShape);
+    centered.AssignDifferenceOf(x, TensorViewOf(*m_savedMean, statShape));
+    m_dScale->Resize(scale);
+    m_dBias->Resize(scale);
+    auto dScale = TensorViewOf(*m_dScale, statShape);
+    dScale.AssignElementwiseProductOf(dy, centered);
+    dScale.AssignElementwiseProductOf(dScale, TensorViewOf(*m_savedInvStdDev, statShape));
+    TensorViewOf(*m_dBias, statShape).AssignCopyOf(dy);
+    if (!computeInputGrad)
+        return;
+
+    // inGrad = scale * invStdDev * (outGrad - mean(outGrad) - normalized * mean(outGrad * normalized)), with the means over the group
+    size_t numColumns;
+    size_t column = SyncGroupColumn(3, numColumns);
+    m_syncStats.Resize(numStats, numColumns);
+    m_syncStats.SetValue(0);
+    Matrix<StatType> meanOfGrad    = m_syncStats.ColumnSlice(column,     1);
+    Matrix<StatType> meanOfProduct = m_syncStats.ColumnSlice(column + 1, 1);
+    Matrix<StatType> count         = m_syncStats.ColumnSlice(column + 2, 1);
+    meanOfGrad.AssignValuesOf(*m_dBias);
+    meanOfProduct.AssignValuesOf(*m_dScale);
+    count.SetValue((StatType)(in.GetNumElements() / numStats));
+    TensorParallelGroup::AllReduceSum(m_syncStats);
+
+    auto invStdDev = TensorViewOf(*m_savedInvStdDev, vectorShape);
+    auto countT    = TensorViewOf(count, vectorShape);
+    TensorViewOf(meanOfGrad, vectorShape).AssignElementwiseQuotientOf(TensorViewOf(meanOfGrad, vectorShape), countT);
+    TensorViewOf(meanOfProduct, vectorShape).AssignElementwiseQuotientOf(TensorViewOf(meanOfProduct, vectorShape), countT);
+    TensorViewOf(meanOfProduct, vectorShape).AssignElementwiseProductOf(TensorViewOf(meanOfProduct, vectorShape), invStdDev); // (times the invStdDev of normalized)
+    Matrix<StatType>& factor = count;
+    TensorViewOf(factor, vectorShape).AssignElementwiseProductOf(TensorViewOf(scale, vectorShape), invStdDev);
+
+    centered.AssignElementwiseProductOf(centered, TensorViewOf(meanOfProduct, statShape));
+    centered.AssignDifferenceOf(dy, centered);
+    centered.AssignDifferenceOf(centered, TensorViewOf(meanOfGrad, statShape));
+    TensorViewOf(inGrad, dataShape).DoElementwiseProductOf(accumulateInputGrad ? 1 : 0, centered, TensorViewOf(factor, statShape), 1);
+}
+
+// the statistics of half are in float, which TensorView does not mix; IsSynchronized() is never true for half
+template <>
+void BatchNormalizationNode<half>::ForwardPropSynchronized(const Matrix<half>&, const Matrix<float>&, const Matrix<float>&, double,
+                                                           Matrix<float>&, Matrix<float>&, Matrix<half>&)
+{
+    LogicError("%ls: synchronized batch normalization is not implemented for half precision.", NodeName().c_str());
+}
+
+template <>
+void BatchNormalizationNode<half>::BackpropToSynchronized(const Matrix<half>&, const Matrix<half>&, bool, Matrix<half>&,
+                                                          const Matrix<float>&, bool)
+{
+    LogicError("%ls: synchronized batch normalization is not implemented for half precision.", NodeName().c_str());
+}
+
 template class BatchNormalizationNode<float>;
 template class BatchNormalizationNode<double>;
 template class BatchNormalizationNode<half>;
 
+template class LayerNormalizationNode<float>;
+template class LayerNormalizationNode<double>;
+template class LayerNormalizationNode<half>;
+
 }}}
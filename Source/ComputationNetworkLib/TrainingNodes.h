@@ -465,6 +465,8 @@ template class MatrixL1RegNode<double>;
 // -----------------------------------------------------------------------
 // LambdaRankNode (gain, prediction, queryId)
 // Check "From RankNet to LambdaRank to LambdaMART: An Overview" for details.
+// The ranking, the NDCG and the lambdas are computed on the device of the inputs, all queries of the minibatch in parallel,
+// see Matrix::AssignLambdaRankRanks() and Matrix::AddLambdaRankGradient().
 // -----------------------------------------------------------------------
 
 template <class ElemType>
@@ -488,66 +490,12 @@ public:
     {
         FrameRange fr(Input(0)->GetMBLayout());
 
-        if (inputIndex == 1 &&  // right derivative
-            m_numberOfUrlPairs > 0)   // 
+        if (inputIndex == 1) // right derivative
         {
+            // for each pair of urls of a query with different gains, with i the one with the higher gain:
+            // lambda = -sigma / (1 + exp(sigma * (si - sj))) * |delta NDCG|, added to the gradient of i and subtracted from that of j
             auto gradient = Input(1)->GradientFor(fr);
-
-            // sigma * (si - sj)
-            *m_pairwiseDifferences *= m_sigma;
-            // exp(sigma * (si - sj))
-            m_lambdas->AssignExpOf(*m_pairwiseDifferences);
-            // 1 + exp(sigma * (si - sj))
-            *m_lambdas += 1;
-            // 1 / (1 + exp(sigma * (si - sj)))
-            m_lambdas->AssignElementInverseOf(*m_lambdas);
-            // -sigma/(1+exp(sigma*(si - sj)))
-            m_lambdas->AssignProductOf(-m_sigma, *m_lambdas);
-
-            // Get the update of weight.
-            const Matrix<ElemType>& lambdas = *m_lambdas;
-            m_weightUpdate->SetValue(gradient);
-            size_t pairsCount = 0;
-            ElemType discountI, discountJ;
-            ElemType gainI;
-            ElemType lambdaIJ;
-            for (auto qu : m_queryUrls)
-            {
-                ElemType idealMetric = qu.m_idealMetric;
-                for (typename std::vector<Url>::iterator itUrlI = qu.m_urls.begin(); itUrlI != qu.m_urls.end(); itUrlI++)
-                {
-                    Url& UrlI = *itUrlI;
-                    size_t k = UrlI.m_K;
-                    discountI = m_logWeights[UrlI.m_rank];
-                    gainI = UrlI.m_gain;
-                    if (k == 0) continue;
-                    for (typename std::vector<Url>::iterator itUrlJ = itUrlI + 1; itUrlJ <= itUrlI + k; itUrlJ++)
-                    {
-                        Url& UrlJ = *itUrlJ;
-                        discountJ = m_logWeights[UrlJ.m_rank];
-                        if (abs(gainI - UrlJ.m_gain) < (ElemType)0.0000001)
-                        {
-                            continue;
-                        }
-
-                        // delta DCG
-                        lambdaIJ = (gainI - UrlJ.m_gain) * (discountI - discountJ) / (discountI * discountJ);
-
-                        // |delta NDCG|
-                        lambdaIJ = (idealMetric == (ElemType)0.0 ? (ElemType) 0.0 : (ElemType)abs(lambdaIJ / idealMetric));
-
-                        // Combine lambda
-                        lambdaIJ = lambdas(0, pairsCount++) * lambdaIJ;
-
-                        // Assign to gradient
-                        (*m_weightUpdate)(0, UrlI.m_id) += lambdaIJ;
-                        (*m_weightUpdate)(0, UrlJ.m_id) -= lambdaIJ;
-                        
-                    }
-                }
-            }
-
-            gradient.SetValue(*m_weightUpdate);
+            Matrix<ElemType>::AddLambdaRankGradient(Input(0)->ValueFor(fr), Input(1)->ValueFor(fr), *m_ranks, *m_metrics, m_queryBegins, m_sigma, gradient);
         }
     }
 
@@ -556,35 +504,6 @@ public:
         return false;
     }
 
-    virtual void UpdateFunctionMBSize() override
-    {
-        UpdateCounts();
-
-        // clean up first
-        if (!m_queryUrls.empty()) m_queryUrls.clear();
-        if (!m_urlSorter.empty()) m_urlSorter.clear();
-        if (!m_logWeights.empty()) m_logWeights.clear();
-
-        m_pairwiseDifferences->Resize(1, m_numberOfUrlPairs);
-        m_lambdas->Resize(1, m_numberOfUrlPairs);
-
-        m_urlGain0->Resize(1, m_numberOfQueryUrls);
-        m_urlGain1->Resize(1, m_numberOfQueryUrls);
-        m_urlDiscount0->Resize(1, m_numberOfQueryUrls);
-        m_urlDiscount1->Resize(1, m_numberOfQueryUrls);
-
-        // keep one additional space to avoid pointer moving out
-        m_urlSorter.resize(m_maxNumberOfUrlsPerQuery + 1);
-        
-        // prepared lookup table
-        m_logWeights.resize(m_maxNumberOfUrlsPerQuery);
-        size_t i = 0;
-        for (typename std::vector<ElemType>::iterator it = m_logWeights.begin(); it != m_logWeights.end(); it++, i++)
-        {
-            *it = (ElemType) log(2.0 + i);
-        }
-    }
-
     virtual void /*ComputationNodeNonLooping::*/ ForwardPropNonLooping() override
     {
         // Inputs:
@@ -593,6 +512,7 @@ public:
         //      2. query id (used to separate urls belonging to different queries)
         // 
         // Following is an example: two queries (0 and 1) and 6 urls (three for each).
+        // Urls are pre-sorted in descending order of gains within their query.
         // 31,  0.9,    0
         // 7,   0.3,    0
         // 0,   0.0,    0
@@ -601,129 +521,32 @@ public:
         // 0,   0.3,    1
         FrameRange fr(Input(0)->GetMBLayout());
 
-        // Construct matrices for further computation.
         const Matrix<ElemType>& gains = Input(0)->ValueFor(fr);
         const Matrix<ElemType>& preds = Input(1)->ValueFor(fr);
-        const Matrix<ElemType>& queryIds = Input(2)->ValueFor(fr);
-
-        // Iterate through all samples
         size_t numberOfSamples = gains.GetNumCols();
-        QueryUrls aqu;
-        int previousQueryId = -1;
-        int numberOfQueries = 0;
 
-        // Iterate all samples and populate m_queryUrls table. 
-        for (size_t i = 0; i < numberOfSamples; i++)
+        UpdateQueries(Input(2)->ValueFor(fr));
+        size_t numberOfQueries = m_queryBegins.size() - 1;
+        if (numberOfQueries == 0)
         {
-            int queryId = (int)queryIds(0, i);
-            // Samples are grouped by queries. Find all the urls 
-            // belonging to each individual query.
-            if (queryId != previousQueryId)
-            {
-                m_queryUrls.push_back(aqu);
-                numberOfQueries++;
-                previousQueryId = queryId;
-            }
-
-            // Get the last QueryUrls and add the Url.
-            QueryUrls& qu = m_queryUrls.back();
-            Url u(i, qu.m_urls.size(), preds(0, i), gains(0, i));
-            qu.m_urls.push_back(u);
+            LogicError("In %ls %ls numberOfQueries==0, check your data.", NodeName().c_str(), OperationName().c_str());
         }
 
-        // Update K (number of url pairs that have smaller or equal gain), rk (rank of 
-        // score in descending order) and m_pairwiseDifferences (save for gradient 
-        // computation).
-        size_t pairCount = 0;
-        for (auto &qu : m_queryUrls)
-        {
-            std::vector<Url>& urls = qu.m_urls;
-            size_t numberOfUrls = urls.size();
-            // Urls are pre-sorted in descending order of gains.
-            ElemType minGain = urls[numberOfUrls - 1].m_gain;
-            for (size_t j = 0; j < urls.size(); j++)
-            {
-                if (urls[j].m_gain > minGain)
-                {
-                    size_t numberOfPairs = numberOfUrls - j - 1;
-                    urls[j].m_K = numberOfPairs;
-                    if (numberOfPairs > 0)
-                    {
-                        for (size_t k = 0; k < numberOfPairs; k++)
-                        {
-                            (*m_pairwiseDifferences)(0, pairCount++) = urls[j].m_score - urls[j + 1 + k].m_score;
-                        }
-                    }
-                }
-                // Skip urls with gain equal to min (0).
-                else 
-                {
-                    urls[j].m_K = 0;
-                }
-            }
-
-            typename std::vector<Url>::iterator its = m_urlSorter.begin(), it = urls.begin();
-            typename std::vector<Url>::iterator its0 = its;
-            its = std::copy(it, urls.end(), its);
-            std::sort(its0, its);
-            // Set the sorted rk order to each url and 
-            // the urls are still in the original order
-            int rk = 0;
-            for (it = its0; it != its; it++)
-            {
-                urls[it->m_rank0].m_rank = rk++;
-            }
-        }
+        // Rank the urls of each query by score, and compute the DCG of that ranking and the ideal one.
+        m_ranks->AssignLambdaRankRanks(gains, preds, m_queryBegins, *m_metrics);
 
-        // Compute ir metric.
-        size_t sampleCount = 0;
-        for (const auto &qu: m_queryUrls)
-        {
-            for (const auto &url : qu.m_urls)
-            {
-                (*m_urlGain0)(0, sampleCount) = url.m_gain;
-                (*m_urlGain1)(0, sampleCount) = url.m_gain;
-                (*m_urlDiscount0)(0, sampleCount) = (ElemType)url.m_rank0;
-                (*m_urlDiscount1)(0, sampleCount) = (ElemType)url.m_rank;
-                sampleCount++;
-            }
-        }
-        
-        // log(2+rank)
-        *m_urlDiscount0 += 2.0;
-        m_urlDiscount0->InplaceLog();
-        *m_urlDiscount1 += 2.0;
-        m_urlDiscount1->InplaceLog();
-        // gain/log(2+rank)
-        m_urlGain0->AssignElementDivisionOf(*m_urlGain0, *m_urlDiscount0);
-        m_urlGain1->AssignElementDivisionOf(*m_urlGain1, *m_urlDiscount1);
-
-        // Aggregate at query level.
-        const Matrix<ElemType>& urlDiscountedGain0 = *m_urlGain0;
-        const Matrix<ElemType>& urlDiscountedGain1 = *m_urlGain1;
+        // Compute ir metric, from the only values that come back from the device.
+        std::unique_ptr<ElemType[]> metrics(m_metrics->CopyToArray());
         ElemType irMetricValue = 0.0;
-        for (auto &qu : m_queryUrls)
+        for (size_t q = 0; q < numberOfQueries; q++)
         {
-            qu.m_idealMetric = 0.0;
-            qu.m_metric = 0.0;
-
-            for (const auto &url : qu.m_urls)
-            {
-                qu.m_idealMetric += urlDiscountedGain0(0, url.m_id);
-                qu.m_metric += urlDiscountedGain1(0, url.m_id);
-            }
-
-            if (qu.m_idealMetric != 0.0)
+            ElemType idealMetric = metrics[2 * q];
+            if (idealMetric != 0.0)
             {
-                irMetricValue += (qu.m_metric / qu.m_idealMetric);
+                irMetricValue += (metrics[2 * q + 1] / idealMetric);
             }
         }
 
-        if (numberOfQueries == 0)
-        {
-            LogicError("In %ls %ls numberOfQueries==0, check your data.", NodeName().c_str(), OperationName().c_str());
-        }
-
         // to make up the reporting
         irMetricValue = (1.0f - irMetricValue / numberOfQueries) * 100 * numberOfSamples;
         Value().SetValue(irMetricValue);
@@ -749,17 +572,9 @@ public:
         if (flags & CopyNodeFlags::copyNodeValue)
         {
             auto node = dynamic_pointer_cast<LambdaRankNode<ElemType>>(nodeP);
-            node->m_pairwiseDifferences->SetValue(*m_pairwiseDifferences);
-            node->m_lambdas->SetValue(*m_lambdas);
-            node->m_weightUpdate->SetValue(*m_weightUpdate);
-            node->m_urlGain0->SetValue(*m_urlGain0);
-            node->m_urlGain1->SetValue(*m_urlGain1);
-            node->m_urlDiscount0->SetValue(*m_urlDiscount0);
-            node->m_urlDiscount1->SetValue(*m_urlDiscount1);
-
-            node->m_queryUrls = m_queryUrls;
-            node->m_urlSorter = m_urlSorter;
-            node->m_logWeights = m_logWeights;
+            node->m_ranks->SetValue(*m_ranks);
+            node->m_metrics->SetValue(*m_metrics);
+            node->m_queryBegins = m_queryBegins;
         }
     }
 
@@ -767,154 +582,50 @@ public:
     virtual void RequestMatricesBeforeForwardProp(MatrixPool& matrixPool)
     {
         Base::RequestMatricesBeforeForwardProp(matrixPool);
-        RequestMatrixFromPool(m_pairwiseDifferences, matrixPool);
-        RequestMatrixFromPool(m_lambdas, matrixPool);
-        RequestMatrixFromPool(m_weightUpdate, matrixPool);
-        RequestMatrixFromPool(m_urlGain0, matrixPool);
-        RequestMatrixFromPool(m_urlGain1, matrixPool);
-        RequestMatrixFromPool(m_urlDiscount0, matrixPool);
-        RequestMatrixFromPool(m_urlDiscount1, matrixPool);
+        RequestMatrixFromPool(m_ranks, matrixPool);
+        RequestMatrixFromPool(m_metrics, matrixPool);
     }
 
     // release gradient and temp matrices that no longer needed after all the children's gradients are computed.
     virtual void ReleaseMatricesAfterBackprop(MatrixPool& matrixPool)
     {
         Base::ReleaseMatricesAfterBackprop(matrixPool);
-        ReleaseMatrixToPool(m_pairwiseDifferences, matrixPool);
-        ReleaseMatrixToPool(m_lambdas, matrixPool);
-        ReleaseMatrixToPool(m_weightUpdate, matrixPool);
-        ReleaseMatrixToPool(m_urlGain0, matrixPool);
-        ReleaseMatrixToPool(m_urlGain1, matrixPool);
-        ReleaseMatrixToPool(m_urlDiscount0, matrixPool);
-        ReleaseMatrixToPool(m_urlDiscount1, matrixPool);
-        
-        // is this the right place?  it was not called after bp.
-        m_queryUrls.clear();
-        m_urlSorter.clear();
-        m_logWeights.clear();
+        ReleaseMatrixToPool(m_ranks, matrixPool);
+        ReleaseMatrixToPool(m_metrics, matrixPool);
     }
 
 protected:
 
-    void UpdateCounts()
+    // Finds the urls of each query. Samples are grouped by queries, a query starts where the query id changes.
+    void UpdateQueries(const Matrix<ElemType>& queryIds)
     {
-        FrameRange fr(Input(0)->GetMBLayout());
-        const Matrix<ElemType>& gains = Input(0)->ValueFor(fr);
-        const Matrix<ElemType>& queryIds = Input(2)->ValueFor(fr);
-        const size_t numberOfQueryUrls = gains.GetNumCols();
-        int previousQueryId = -1;
-
-        // Number of urls we have seen for the current query
-        size_t numberOfUrls = 0;
+        // one copy of the ids instead of a transfer per sample
+        size_t numberOfQueryUrls = queryIds.GetNumCols();
+        std::unique_ptr<ElemType[]> ids(numberOfQueryUrls > 0 ? queryIds.CopyToArray() : nullptr);
 
-        // Number of urls that have gains greater than 0 for the current query 
-        size_t numberOfUrlsWithNonZeroGain = 0;
-        size_t numberOfUrlPairs = 0;
-        size_t maxNumberOfUrlsPerQuery = 0;
+        m_queryBegins.clear();
+        int previousQueryId = -1;
         for (size_t i = 0; i < numberOfQueryUrls; i++)
         {
-            int queryId = (int)queryIds(0, i);
-            ElemType gain = gains(0, i);
-            if (queryId != previousQueryId)
+            int queryId = (int)ids[i];
+            if (queryId != previousQueryId || i == 0)
             {
-                // Ignore pairs between urls with zero gains.
-                numberOfUrlPairs += (2 * numberOfUrls - 1 - numberOfUrlsWithNonZeroGain) * numberOfUrlsWithNonZeroGain / 2;
-                if (numberOfUrls > maxNumberOfUrlsPerQuery)
-                {
-                    maxNumberOfUrlsPerQuery = numberOfUrls;
-                }
-
-                // New query
-                numberOfUrls = 0;
-                numberOfUrlsWithNonZeroGain = 0;
+                m_queryBegins.push_back(i);
                 previousQueryId = queryId;
             }
-            
-            numberOfUrls++;
-            if (gain > 0)
-            {
-                numberOfUrlsWithNonZeroGain++;
-            }
-        }
-
-        // Add last query.
-        {
-            numberOfUrlPairs += (2 * numberOfUrls - 1 - numberOfUrlsWithNonZeroGain) * numberOfUrlsWithNonZeroGain / 2;
-            if (numberOfUrls > maxNumberOfUrlsPerQuery)
-            {
-                maxNumberOfUrlsPerQuery = numberOfUrls;
-            }
         }
-
-        m_numberOfQueryUrls = numberOfQueryUrls;
-        m_numberOfUrlPairs = numberOfUrlPairs;
-        m_maxNumberOfUrlsPerQuery = maxNumberOfUrlsPerQuery;
+        m_queryBegins.push_back(numberOfQueryUrls);
     }
 
-    struct Url
-    {
-        Url()
-        {
-            m_id = 0;
-            m_rank0 = 0;
-            m_rank = 0;
-            m_score = (ElemType)0;
-            m_gain = (ElemType)0;
-            m_K = 0;
-        }
-
-        Url(int id, int rk0, ElemType sc, ElemType gn) : m_id(id), m_rank0(rk0), m_rank(0), m_score(sc), m_gain(gn), m_K(0) {}
-
-        int m_id;           // sample id
-        int m_rank0;        // original rank based on label
-        int m_rank;         // rank based on s in the associated query
-        ElemType m_score;   // score
-        ElemType m_gain;    // gain
-        int m_K;            // the pair index
-        bool operator < (const Url &url) const {
-            // tie breaking
-            if (m_score == url.m_score || std::isnan(m_score) || std::isnan(url.m_score))
-            {
-                return m_gain < url.m_gain;
-            }
-
-            return m_score > url.m_score;
-        }
-    };
-
-    struct QueryUrls
-    {
-        ElemType m_idealMetric;  // the ideal NDCG
-        ElemType m_metric;   // NDCG based on the current scores
-
-        std::vector<Url> m_urls;
-    };
-
-    // master data structure
-    std::list<QueryUrls> m_queryUrls;
-    // buffer for sorting
-    std::vector<Url> m_urlSorter;
-    // lookup table for position based weights
-    std::vector<ElemType> m_logWeights;
-
-    size_t m_numberOfQueryUrls;
-    size_t m_numberOfUrlPairs;
-    size_t m_maxNumberOfUrlsPerQuery;
+    // first url of each query, followed by the number of urls
+    std::vector<size_t> m_queryBegins;
 
     ElemType m_sigma;
-    // Score differences between url pairs
-    shared_ptr<Matrix<ElemType>> m_pairwiseDifferences;
-    // 1/(1+exp(sigma*(si - sj)))
-    shared_ptr<Matrix<ElemType>> m_lambdas;
-    
-    // update of weight matrix
-    shared_ptr<Matrix<ElemType>> m_weightUpdate;
-    
-    // store the gains and position discounts
-    shared_ptr<Matrix<ElemType>> m_urlGain0;
-    shared_ptr<Matrix<ElemType>> m_urlGain1;
-    shared_ptr<Matrix<ElemType>> m_urlDiscount0;
-    shared_ptr<Matrix<ElemType>> m_urlDiscount1;
+
+    // rank of each url by score within its query
+    shared_ptr<Matrix<ElemType>> m_ranks;
+    // ideal DCG and DCG of the ranking by score of each query
+    shared_ptr<Matrix<ElemType>> m_metrics;
 };
 
 template class LambdaRankNode<float>;
@@ -1367,6 +1078,8 @@ public:
     virtual void /*ComputationNode::*/ BackpropToNonLooping(size_t inputIndex) override {} // This node does not propagate gradients.
     virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override;
     virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    // a second ForwardProp() would draw different samples
+    virtual bool IsForwardPropRecomputable() const override { return false; }
     virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false;}
     virtual void /*ComputationNode::*/ ForwardPropNonLooping() override{}
     virtual bool GetAllowDuplicates() const { return m_allowDuplicates; }
@@ -1456,6 +1169,114 @@ private:
     double EstimateNumberOfTries();
 };
 
+// -----------------------------------------------------------------------
+// SampledCrossEntropyWithSoftmaxNode (labels, input, weights, bias [, samplingWeights], sizeOfSampledSet)
+// Sampled softmax criterion over a large number of classes, a training replacement for
+// CrossEntropyWithSoftmax (labels, Times (weights, input, transpose) + bias)
+// [S. Jean et al., On Using Very Large Target Vocabulary for Neural Machine Translation, 2015].
+//  - Input(0) [numClasses x T] one-hot labels, usually sparse
+//  - Input(1) [inputDim x T] input
+//  - Input(2) [inputDim x numClasses] weights; the column of a class is its output embedding
+//  - Input(3) [numClasses] bias
+//  - Input(4) [numClasses] optional sampling weights >= 0. Without it, the classes are drawn from the log-uniform
+//    distribution p(k) = log((k + 2) / (k + 1)) / log(numClasses + 1), which assumes that they are sorted by decreasing frequency.
+// Each minibatch draws sizeOfSampledSet classes with replacement, from an alias table for the sampling weights. The softmax
+// of each frame is taken over its label and the samples, with the logits corrected by -log(expected count of the class
+// in the samples), and with the samples that hit the label of the frame removed. The weights of the labels and the samples
+// are gathered by one product with a sparse selection matrix, which also gives a sparse block-column weight gradient.
+// When not training, the node computes the full cross entropy with softmax.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class SampledCrossEntropyWithSoftmaxNode : public ComputationNodeNonLooping<ElemType>, public RngUser
+{
+    typedef ComputationNodeNonLooping<ElemType> Base; UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"SampledCrossEntropyWithSoftmax"; }
+
+public:
+    SampledCrossEntropyWithSoftmaxNode(DEVICEID_TYPE deviceId, const wstring& name, size_t sizeOfSampledSet = 0)
+        : Base(deviceId, name), m_sizeOfSampledSet(sizeOfSampledSet), m_samplingWeightsTimeStamp(0), m_isSampled(false), m_gradientValid(false),
+          m_classIds(make_shared<Matrix<ElemType>>(deviceId)),
+          m_labelIds(make_shared<Matrix<ElemType>>(deviceId)),
+          m_sampleIds(make_shared<Matrix<ElemType>>(deviceId)),
+          m_candidateValues(make_shared<Matrix<ElemType>>(deviceId)),
+          m_selection(make_shared<Matrix<ElemType>>(0, 0, deviceId, SPARSE, matrixFormatSparseCSC))
+    {
+        SetRngState(CreateUniqId());
+    }
+
+    SampledCrossEntropyWithSoftmaxNode(const ScriptableObjects::IConfigRecordPtr configp)
+        : SampledCrossEntropyWithSoftmaxNode(configp->Get(L"deviceId"), L"<placeholder>", configp->Get(L"sizeOfSampledSet"))
+    {
+        AttachInputsFromConfig(configp);
+    }
+
+    virtual void Save(File& fstream) const override;
+    virtual void Load(File& fstream, size_t modelVersion) override;
+    virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override;
+
+    virtual void /*ComputationNode::*/ BackpropToNonLooping(size_t inputIndex) override;
+    virtual void /*ComputationNodeNonLooping::*/ ForwardPropNonLooping() override;
+    virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override;
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    // a second ForwardProp() would draw different samples
+    virtual bool IsForwardPropRecomputable() const override { return false; }
+
+    size_t GetNumSamples() const { return m_sizeOfSampledSet; }
+
+    virtual void RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) override
+    {
+        Base::RequestMatricesBeforeForwardProp(matrixPool);
+        RequestMatrixFromPool(m_logits, matrixPool);
+        RequestMatrixFromPool(m_sampledLogits, matrixPool);
+        RequestMatrixFromPool(m_gatheredWeights, matrixPool);
+    }
+
+    virtual void RequestMatricesBeforeBackprop(MatrixPool& matrixPool) override
+    {
+        Base::RequestMatricesBeforeBackprop(matrixPool);
+        RequestMatrixFromPool(m_candidateGradient, matrixPool);
+    }
+
+    virtual void ReleaseMatricesAfterBackprop(MatrixPool& matrixPool) override
+    {
+        Base::ReleaseMatricesAfterBackprop(matrixPool);
+        ReleaseMatrixToPool(m_logits, matrixPool);
+        ReleaseMatrixToPool(m_sampledLogits, matrixPool);
+        ReleaseMatrixToPool(m_gatheredWeights, matrixPool);
+        ReleaseMatrixToPool(m_candidateGradient, matrixPool);
+    }
+
+private:
+    // Rebuilds the alias table [M. Vose, A Linear Algorithm for Generating Random Numbers with a Given Distribution, 1991]
+    // when the sampling weights have changed.
+    void UpdateSamplingDistribution();
+    double SamplingProbability(size_t classId, size_t numClasses) const;
+    std::vector<size_t> DrawSamples(size_t numClasses);
+
+    size_t m_sizeOfSampledSet;
+
+    // sampling distribution; all empty for the log-uniform distribution
+    std::vector<double> m_samplingProbabilities;
+    std::vector<double> m_aliasThresholds; // class k is drawn from column k if the fraction within the column is below this, else its alias
+    std::vector<size_t> m_aliases;
+    uint64_t m_samplingWeightsTimeStamp;   // of Input(4) when the table was built
+
+    bool m_isSampled;     // the last ForwardProp() computed the sampled criterion
+    bool m_gradientValid; // m_sampledLogits and m_candidateValues hold the gradients of the logits
+
+    shared_ptr<Matrix<ElemType>> m_classIds;        // [1 x numClasses] 0, 1, 2, ...
+    shared_ptr<Matrix<ElemType>> m_labelIds;        // [1 x T] class ids of the labels
+    shared_ptr<Matrix<ElemType>> m_sampleIds;       // [S x 1] class ids of the samples
+    shared_ptr<Matrix<ElemType>> m_candidateValues; // [1 x (T + S)] logit corrections, label logits, then gradient sums of the candidates
+    shared_ptr<Matrix<ElemType>> m_selection;       // sparse [numClasses x (T + S)] one-hot columns of the candidates: the labels, then the samples
+    shared_ptr<Matrix<ElemType>> m_logits;          // [(1 + S) x T] log softmax over the label (row 0) and the samples of each frame
+    shared_ptr<Matrix<ElemType>> m_sampledLogits;   // [S x T] sampled logits, then their gradient
+    shared_ptr<Matrix<ElemType>> m_gatheredWeights; // [inputDim x (T + S)] weights of the candidates
+    shared_ptr<Matrix<ElemType>> m_candidateGradient; // [inputDim x (T + S)] gradient of the candidate weights
+};
+
 // -----------------------------------------------------------------------
 // ClassBasedCrossEntropyWithSoftmaxNode (labeldata(.,t), inputdata(.,t), embeddingMatrix, clsProbBeforeSoftmaxData(.,t))
 //  - Input(0) [4 x T] label in dense matrix in
@@ -1486,16 +1307,21 @@ public:
     ClassBasedCrossEntropyWithSoftmaxNode(DEVICEID_TYPE deviceId, const wstring& name)
         : Base(deviceId, name),
           m_logSoftmax(deviceId),
-          m_softMax(deviceId),
+          m_targets(deviceId),
           m_grdToSoftMaxInput(deviceId),
           m_clsLogSoftmax(deviceId),
-          m_clsSoftmax(deviceId)
+          m_clsSoftmax(deviceId),
+          m_clsTargets(deviceId),
+          m_clsObjective(deviceId),
+          m_sortedColumns(deviceId),
+          m_sortedInput(deviceId),
+          m_sortedGradient(deviceId)
     {
     }
 
 private:
-    // iterate over a large workspace that contains all class-conditioned probs concatenated
-    // 'sz' is the offset into that vector. We will iterate over these vectors at a few places. Always use this same boilerplate code.
+    // iterate over the frames of the minibatch that are not gaps, in the order of the columns of the label data.
+    // 'sz' is the offset of the frame's class-conditioned probs in a vector that concatenates them in that order.
     template<class F>
     size_t ForColumnsWithClass(const F& op)
     {
@@ -1524,6 +1350,25 @@ private:
         return sz;
     }
 
+    // The frames that share a class, i.e. a range of words, are consecutive in m_sortedInput. Their class-conditioned
+    // probs form a [numWords x numSamples] block of the packed vectors, starting at 'm_offset'.
+    struct ClassGroup
+    {
+        size_t m_firstWord;
+        size_t m_numWords;
+        size_t m_firstSample; // in m_sortedInput
+        size_t m_numSamples;
+        size_t m_offset;
+    };
+
+    // view of the block of a packed vector that belongs to a group
+    static Matrix<ElemType> GroupSlice(const Matrix<ElemType>& packed, const ClassGroup& group)
+    {
+        Matrix<ElemType> block = packed.ColumnSlice(group.m_offset, group.m_numWords * group.m_numSamples);
+        block.Reshape(group.m_numWords, group.m_numSamples);
+        return block;
+    }
+
     // compute gradients to input observations, the weights to the observations, and the class log posterior probabilities
     virtual void BackpropToNonLooping(size_t inputIndex) override
     {
@@ -1531,70 +1376,122 @@ private:
         if (inputIndex != 1 && inputIndex != 2 && inputIndex != 3)
             InvalidArgument("ClassCrossEntropyWithSoftmaxNode criterion only takes with respect to input, weight to the input and class log posterior probability.");
 
+        FrameRange fr(InputRef(LABELDATA).GetMBLayout());
+        if (inputIndex == 3)
+        {
+            Matrix<ElemType> grd = InputRef(CLASSPROBINDATA).GradientFor(fr);
+            Matrix<ElemType>::AddScaledDifference(Gradient(), m_clsSoftmax, m_clsTargets, grd);
+            return;
+        }
+
+        if (m_classGroups.empty())
+            return;
+
         ComputeSoftMaxPartial(); // Note: Flag m_needRecomputeGradientToSoftmaxInput guards so that this computes only once.
 
-        ForColumnsWithClass([&](size_t /*s*/, size_t /*t*/, const FrameRange& fr, size_t /*y_t*/, size_t c_t, size_t sz, size_t lft_bnd, size_t nbr_wrd)
+        // one product per class, over all the frames of the class
+        const Matrix<ElemType>& weights = InputRef(EMBEDDINGMATRIX).ValueAsMatrix();
+        if (inputIndex == 1)
         {
-            // compute prb - 1 and prb
-            Matrix<ElemType> weightForClass = InputRef(EMBEDDINGMATRIX).ValueAsMatrix().ColumnSlice(lft_bnd, nbr_wrd);
-            Matrix<ElemType> obs = InputRef(INPUTDATA).ValueFor(fr); // hidden activation vector for current word token
-            Matrix<ElemType> grd_to_soft_max_input = m_grdToSoftMaxInput.ColumnSlice(sz, nbr_wrd);
-
-            switch (inputIndex)
+            // gradient to input, in the sorted order, then scattered back to the frames
+            m_sortedGradient.Resize(m_sortedInput.GetNumRows(), m_sortedInput.GetNumCols());
+            for (const auto& group : m_classGroups)
             {
-                case 1:
-                {
-                    // gradient to input
-                    Matrix<ElemType> grd_t = InputRef(INPUTDATA).GradientFor(fr);
-                    Matrix<ElemType>::MultiplyAndAdd(weightForClass, false, grd_to_soft_max_input, true, grd_t);
-                    break;
-                }
-                case 2:
-                {
-                    // gradient to input weight
-                    Matrix<ElemType> grd_to_wgt_t = InputRef(EMBEDDINGMATRIX).GradientAsMatrix().ColumnSlice(lft_bnd, nbr_wrd);
-                    Matrix<ElemType>::MultiplyAndAdd(obs, false, grd_to_soft_max_input, false, grd_to_wgt_t);
-                    break;
-                }
-                case 3:
-                {
-                    Matrix<ElemType> grd_t = InputRef(CLASSPROBINDATA).GradientFor(fr);
-                    grd_t.AssignValuesOf(InputRef(CLASSPROBINDATA).DataFor(m_clsSoftmax, fr));
-                    ComputeCEPartialToSoftmaxInputs(grd_t, Gradient(), c_t);
-                    break;
-                }
+                Matrix<ElemType> grd_t = m_sortedGradient.ColumnSlice(group.m_firstSample, group.m_numSamples);
+                Matrix<ElemType>::Multiply(weights.ColumnSlice(group.m_firstWord, group.m_numWords), false, GroupSlice(m_grdToSoftMaxInput, group), false, grd_t);
             }
-        });
+            Matrix<ElemType> grd = InputRef(INPUTDATA).GradientFor(fr);
+            grd.DoScatterColumnsOf(1, m_sortedColumns, m_sortedGradient, 1, /*idxHaveDups=*/ false);
+        }
+        else
+        {
+            // gradient to input weight
+            for (const auto& group : m_classGroups)
+            {
+                Matrix<ElemType> grd_to_wgt_t = InputRef(EMBEDDINGMATRIX).GradientAsMatrix().ColumnSlice(group.m_firstWord, group.m_numWords);
+                Matrix<ElemType>::MultiplyAndAdd(m_sortedInput.ColumnSlice(group.m_firstSample, group.m_numSamples), false, GroupSlice(m_grdToSoftMaxInput, group), true, grd_to_wgt_t);
+            }
+        }
     }
 
     virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
 
 private:
-    void ComputeCEPartialToSoftmaxInputs(Matrix<ElemType>& inputGradientValues, Matrix<ElemType>& gradientValues, size_t y_t)
-    {
-        Matrix<ElemType>::MinusOneAt(inputGradientValues, y_t);
-        Matrix<ElemType>::Scale(gradientValues, inputGradientValues);
-    }
-
     // gradient of cross entropy w.r.t. to input to softmax
     void ComputeSoftMaxPartial()
     {
         if (m_needRecomputeGradientToSoftmaxInput)
         {
-            m_grdToSoftMaxInput.Resize(1, m_totalNbrWords); // buffer that contains a concatenation of class-conditional values
-
-            ForColumnsWithClass([&](size_t /*s*/, size_t /*t*/, const FrameRange& /*fr*/, size_t y_t, size_t /*c_t*/, size_t sz, size_t lft_bnd, size_t nbr_wrd)
-            {
-                Matrix<ElemType> softMax = m_softMax.ColumnSlice(sz, nbr_wrd);
+            m_grdToSoftMaxInput.AssignExpOf(m_logSoftmax);
+            m_grdToSoftMaxInput -= m_targets;
+            Matrix<ElemType>::Scale(Gradient(), m_grdToSoftMaxInput);
 
-                size_t idx_in_class = y_t - lft_bnd;
-                ComputeCEPartialToSoftmaxInputs(softMax, Gradient(), idx_in_class);
+            m_needRecomputeGradientToSoftmaxInput = false;
+        }
+    }
 
-                m_grdToSoftMaxInput.ColumnSlice(sz, nbr_wrd).AssignValuesOf(softMax);
-            });
+    // Groups the frames of the minibatch by class and gathers their hidden activations in that order into m_sortedInput,
+    // and sets the one-hot targets of the words (m_targets) and the classes (m_clsTargets).
+    void SortFramesByClass()
+    {
+        struct Frame
+        {
+            size_t m_firstWord;
+            size_t m_numWords;
+            size_t m_wordInClass;
+            size_t m_class;
+            size_t m_column;
+        };
+        std::vector<Frame> frames;
+        const size_t nS = Input(LABELDATA)->GetNumParallelSequences();
+        ForColumnsWithClass([&](size_t s, size_t t, const FrameRange& /*fr*/, size_t y_t, size_t c_t, size_t /*sz*/, size_t lft_bnd, size_t nbr_wrd)
+        {
+            if (nbr_wrd == 0)
+                LogicError("ClassBasedCrossEntropyWithSoftmax: Encountered a class of size 0.");
+            if (y_t < lft_bnd || y_t >= lft_bnd + nbr_wrd)
+                LogicError("ClassBasedCrossEntropyWithSoftmax: Word index out of bounds of class-member index range (word not a class member).");
+            if (c_t >= m_nbrCls)
+                LogicError("ClassBasedCrossEntropyWithSoftmax: Class index out of bounds.");
+            frames.push_back(Frame{ lft_bnd, nbr_wrd, y_t - lft_bnd, c_t, t * nS + s });
+        });
+        std::stable_sort(frames.begin(), frames.end(), [](const Frame& a, const Frame& b)
+        {
+            return a.m_firstWord != b.m_firstWord ? a.m_firstWord < b.m_firstWord : a.m_numWords < b.m_numWords;
+        });
 
-            m_needRecomputeGradientToSoftmaxInput = false;
+        m_classGroups.clear();
+        m_segmentOffsets.assign(1, 0);
+        std::vector<ElemType> sortedColumns;
+        std::vector<int> targets, clsTargets;
+        for (size_t k = 0; k < frames.size(); k++)
+        {
+            const Frame& frame = frames[k];
+            if (m_classGroups.empty() || m_classGroups.back().m_firstWord != frame.m_firstWord || m_classGroups.back().m_numWords != frame.m_numWords)
+                m_classGroups.push_back(ClassGroup{ frame.m_firstWord, frame.m_numWords, k, 0, (size_t)m_segmentOffsets.back() });
+            m_classGroups.back().m_numSamples++;
+
+            size_t offset = m_segmentOffsets.back();
+            if (offset + frame.m_numWords > INT_MAX || frame.m_column * m_nbrCls + frame.m_class > INT_MAX)
+                RuntimeError("ClassBasedCrossEntropyWithSoftmax: The minibatch is too large.");
+            targets.push_back((int)(offset + frame.m_wordInClass));
+            m_segmentOffsets.push_back((int)(offset + frame.m_numWords));
+            clsTargets.push_back((int)(frame.m_column * m_nbrCls + frame.m_class));
+            sortedColumns.push_back((ElemType)frame.m_column);
         }
+        m_totalNbrWords = m_segmentOffsets.back();
+
+        m_clsTargets.Resize(m_clsLogSoftmax);
+        m_clsTargets.SetValue(0);
+        m_clsTargets.ScatterAddValues(clsTargets, std::vector<ElemType>(clsTargets.size(), 1));
+        if (frames.empty())
+            return;
+
+        m_targets.Resize(1, m_totalNbrWords);
+        m_targets.SetValue(0);
+        m_targets.ScatterAddValues(targets, std::vector<ElemType>(targets.size(), 1));
+
+        m_sortedColumns.SetValue(1, sortedColumns.size(), m_deviceId, sortedColumns.data());
+        m_sortedInput.DoGatherColumnsOf(0, m_sortedColumns, InputRef(INPUTDATA).ValueFor(FrameRange(InputRef(INPUTDATA).GetMBLayout())), 1);
     }
 
 public:
@@ -1604,71 +1501,47 @@ public:
     }
 
     // -sum(left_i * log(softmax_i(right)))
+    // The frames are grouped by class, so that the logits of each class are a single product over its frames,
+    // and the softmaxes over the words of the classes are done together, over the concatenated logits.
     virtual void /*ComputationNodeNonLooping::*/ ForwardPropNonLooping() override
     {
         // get the label matrix to CPU, ideally in location=BOTH state
         InputRef(LABELDATA).Value().TransferToDeviceIfNotThere(CPUDEVICE, /*ismoved =*/ false/*means: BOTH state OK*/, /*emptyTransfer =*/ false, /*updatePreferredDevice =*/ false);
 
         auto& functionValues = Value();
-
-        const size_t hdSize = InputRef(INPUTDATA).GetSampleMatrixNumRows();
         assert(m_nbrCls == InputRef(CLASSPROBINDATA).GetSampleMatrixNumRows());
 
-        // compute the class posteriors
+        // compute the class posteriors; the gaps do not contribute
+        FrameRange fr(InputRef(LABELDATA).GetMBLayout());
         m_clsLogSoftmax.SetValue(InputRef(CLASSPROBINDATA).Value());
         m_clsLogSoftmax.InplaceLogSoftmax(true);   // log
         m_clsSoftmax.AssignExpOf(m_clsLogSoftmax); // non-log
+        MaskMissingColumnsToZero(m_clsLogSoftmax, InputRef(LABELDATA).GetMBLayout(), fr);
+        MaskMissingColumnsToZero(m_clsSoftmax, InputRef(LABELDATA).GetMBLayout(), fr);
 
-        // create a large workspace to contain all class-conditioned probs concatenated
-        m_totalNbrWords = ForColumnsWithClass([](size_t /*s*/, size_t /*t*/, const FrameRange& /*fr*/, size_t y_t, size_t /*c_t*/, size_t /*sz*/, size_t lft_bnd, size_t nbr_wrd)
-        {
-            if (nbr_wrd == 0)
-                LogicError("ClassBasedCrossEntropyWithSoftmax: Encountered a class of size 0.");
-            if (y_t < lft_bnd || y_t >= lft_bnd + nbr_wrd)
-                LogicError("ClassBasedCrossEntropyWithSoftmax: Word index out of bounds of class-member index range (word not a class member).");
-        });
-        // now m_totalNbrWords = total size of concatenated vector
+        SortFramesByClass();
 
-        // buffer to hold the concatenated class-conditioned prob vectors
-        m_softMax.Resize(1, m_totalNbrWords);
-        m_logSoftmax.Resize(1, m_totalNbrWords);
+        // add the class log posterior probabilities
+        functionValues.AssignInnerProductOfMatrices(m_clsTargets, m_clsLogSoftmax);
 
-        // accumulate objective
-        functionValues.SetValue(0);
-        ForColumnsWithClass([&](size_t s, size_t t, const FrameRange& fr, size_t y_t, size_t c_t, size_t sz, size_t lft_bnd, size_t nbr_wrd)
+        if (!m_classGroups.empty())
         {
-            // now get views of various arrays that correspond to the index range of words belonging to this class
-
-            // get hidden vectors for the words in this class
-            Matrix<ElemType> weightForClass = InputRef(EMBEDDINGMATRIX).ValueAsMatrix().ColumnSlice(lft_bnd, nbr_wrd); // [hdSize x nbr_wrd]
-
-            // buffer to hold the class-conditional distribution
-            Matrix<ElemType> softMax_t = m_softMax.ColumnSlice(sz, nbr_wrd); // TODO: declare these outside of the loop to avoid the malloc
-            Matrix<ElemType> logSoftMax_t = m_logSoftmax.ColumnSlice(sz, nbr_wrd);
-
-            Matrix<ElemType> obs = InputRef(INPUTDATA).ValueFor(fr); // hidden activation vector for current word token
-
-            // multiply hidden activation with weight matrix (the slice of the weight matrix for the range of class members)
-            // TODO: can we use 'true' here instead? Above transposition hack won't work with row slices. 'obs' not used elsewhere
-            obs.Reshape(1, hdSize);                                                                                // transpose it (make it a column vector)
-            logSoftMax_t.AssignProductOf(obs /*(1 x hdSize)*/, false, weightForClass /*hdSize x nbr_wrd*/, false); // -> 1 x nbr_word
-
-            // log softmax(W x_t)
-            logSoftMax_t.InplaceLogSoftmax(false);
-
-            // and non-log version
-            softMax_t.SetValue(logSoftMax_t);
-            softMax_t.InplaceExp();
-            // we now have a column vector of class-conditional probabilities over the class members
+            // multiply hidden activations with the slices of the weight matrix for the ranges of class members
+            const Matrix<ElemType>& weights = InputRef(EMBEDDINGMATRIX).ValueAsMatrix(); // [hdSize x vocab_size]
+            m_logSoftmax.Resize(1, m_totalNbrWords);
+            for (const auto& group : m_classGroups)
+            {
+                Matrix<ElemType> logSoftMax_t = GroupSlice(m_logSoftmax, group); // [nbr_wrd x frames of the class]
+                Matrix<ElemType>::Multiply(weights.ColumnSlice(group.m_firstWord, group.m_numWords), true, m_sortedInput.ColumnSlice(group.m_firstSample, group.m_numSamples), false, logSoftMax_t);
+            }
 
-            // add  the word's class-conditional log posterior
-            size_t idx_in_class = y_t - lft_bnd;
-            Matrix<ElemType>::AddElementToElement(logSoftMax_t, 0, idx_in_class, functionValues, 0, 0); // (1x1)
+            // log softmax(W x_t) over the class members of each frame
+            m_logSoftmax.InplaceSegmentedLogSoftmax(m_segmentOffsets);
 
-            // add the class log posterior probability (for backprop)
-            auto clsLogSoftmax_t = InputRef(CLASSPROBINDATA).DataFor(m_clsLogSoftmax, fr);
-            Matrix<ElemType>::AddElementToElement(clsLogSoftmax_t, c_t, 0, functionValues, 0, 0); // (1x1)
-        });
+            // add the words' class-conditional log posteriors
+            m_clsObjective.AssignInnerProductOfMatrices(m_targets, m_logSoftmax);
+            functionValues += m_clsObjective;
+        }
 
         functionValues *= (-1);
 
@@ -1699,18 +1572,26 @@ public:
     }
 
 protected:
+    // class-conditioned log probs of all frames concatenated, in the order of m_sortedInput
     Matrix<ElemType> m_logSoftmax;
-    Matrix<ElemType> m_softMax;
+    Matrix<ElemType> m_targets; // one-hot words, in the layout of m_logSoftmax
 
     Matrix<ElemType> m_clsLogSoftmax;
     Matrix<ElemType> m_clsSoftmax;
+    Matrix<ElemType> m_clsTargets;   // one-hot classes, in the layout of m_clsLogSoftmax
+    Matrix<ElemType> m_clsObjective;
 
-    // gradient of cross entropy with respect to the input of softmax
-    // a 1 row by \sum_t m_nbrWordsInEachTime[t] vector
-    // one slice of size m_nbrWordsInEachTime[t] saves the input to softmax for word y_t
+    // gradient of cross entropy with respect to the input of softmax, in the layout of m_logSoftmax
     Matrix<ElemType> m_grdToSoftMaxInput;
     bool m_needRecomputeGradientToSoftmaxInput;
 
+    // the hidden activations, and their gradient, of the frames that are not gaps, sorted by class
+    Matrix<ElemType> m_sortedColumns; // [1 x frames] column of each sorted frame in the minibatch
+    Matrix<ElemType> m_sortedInput;
+    Matrix<ElemType> m_sortedGradient;
+    std::vector<ClassGroup> m_classGroups;
+    std::vector<int> m_segmentOffsets; // start of the class-conditioned probs of each sorted frame, then their end
+
     size_t m_nbrCls;
     size_t m_totalNbrWords;
 };
@@ -2227,6 +2108,8 @@ protected:
 // -----------------------------------------------------------------------
 // DropoutNode (input) -- perform drop-out
 // Output is scaled such that no post-scaling is necessary.
+// The mask is not stored: it is drawn from a counter-based generator at (seed, offset of the minibatch + element
+// index), so the forward and backward kernels regenerate it while applying it, see Matrix::DropoutOp().
 // -----------------------------------------------------------------------
 template <class ElemType>
 class DropoutNode : public ComputationNode<ElemType>, public NumInputs<1>, public DropoutNodeBase, public RngUser
@@ -2257,20 +2140,22 @@ public:
         if (InputRef(0).IsGradientInitializedBy(this))
         {
             if (IsEnabled())
-                sliceInput0Grad.AssignElementProductOf(sliceOutputGrad, DataFor(*m_maskOfDropout, fr));
+                sliceInput0Grad.DropoutOp(0, sliceOutputGrad, GetDropoutRate(), GetRngSeed(), MaskOffsetFor(fr));
             else
                 sliceInput0Grad.AssignValuesOf(sliceOutputGrad);
         }
         else
         {
             if (IsEnabled())
-                sliceInput0Grad.AddElementProductOf(sliceOutputGrad, DataFor(*m_maskOfDropout, fr));
+                sliceInput0Grad.DropoutOp(1, sliceOutputGrad, GetDropoutRate(), GetRngSeed(), MaskOffsetFor(fr));
             else
                 sliceInput0Grad += sliceOutputGrad;
         }
     }
 
     virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    // a second ForwardProp() within the same minibatch regenerates the same mask
+    virtual bool IsForwardPropRecomputable() const override { return true; }
     virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
     virtual ParentGradientOptimization ImplementsGradientOptimization(const ComputationNodeBase* /*input*/) const
     {
@@ -2280,9 +2165,8 @@ public:
     virtual void UpdateFunctionMBSize() override
     {
         Base::UpdateFunctionMBSize();
-        // resize temporaries to their proper size
-        if (IsEnabled())
-            m_maskOfDropout->Resize(Input(0)->Value());
+        // the mask of the new minibatch is drawn by its first ForwardProp()
+        m_isMaskOffsetPending = true;
     }
 
     virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override
@@ -2296,12 +2180,15 @@ public:
         }
         else
         {
-            // determine drop-out mask for this minibatch
-            auto sliceMask = DataFor(*m_maskOfDropout, fr);
-            sliceMask.SetUniformRandomMask((ElemType)GetDropoutRate(), (ElemType)(1.0 / (1.0 - GetDropoutRate())) /*pre-scaled*/, GetRNGHandle());
-            // apply dropout mask
-            sliceOutputValue.AssignElementProductOf(sliceMask, sliceInput0Value);
-            UpdateRngOffset(GetRngOffset() + sliceMask.GetNumElements());
+            // reserve the random numbers of the whole minibatch, so that each frame has its own part of them
+            if (m_isMaskOffsetPending)
+            {
+                m_maskOffset = GetRngOffset();
+                UpdateRngOffset(m_maskOffset + Value().GetNumElements());
+                m_isMaskOffsetPending = false;
+            }
+            // apply the pre-scaled dropout mask
+            sliceOutputValue.DropoutOp(0, sliceInput0Value, GetDropoutRate(), GetRngSeed(), MaskOffsetFor(fr));
         }
     }
 
@@ -2310,11 +2197,6 @@ public:
         ValidateUnaryMap(isFinalValidationPass);
     }
 
-    RNGHandle& GetRNGHandle()
-    {
-        return RngUser::GetRNGHandle(ValuePtr()->GetDeviceId());
-    }
-
     virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
     {
         Base::CopyTo(nodeP, newName, flags);
@@ -2323,25 +2205,21 @@ public:
             auto node = dynamic_pointer_cast<DropoutNode<ElemType>>(nodeP);
             node->SetDropoutRate(GetDropoutRate());
             node->SetRngState(GetRngSeed(), GetRngOffset());
-            node->m_maskOfDropout = m_maskOfDropout;
+            node->m_maskOffset = m_maskOffset;
+            node->m_isMaskOffsetPending = m_isMaskOffsetPending;
         }
     }
-    // request matrices needed to do node function value evaluation
-    virtual void RequestMatricesBeforeForwardProp(MatrixPool& matrixPool)
-    {
-        Base::RequestMatricesBeforeForwardProp(matrixPool);
-        RequestMatrixFromPool(m_maskOfDropout, matrixPool);
-    }
 
-    // release gradient and temp matrices that no longer needed after all the children's gradients are computed.
-    virtual void ReleaseMatricesAfterBackprop(MatrixPool& matrixPool)
+private:
+    // offset of the random numbers of the first element of the frame range, in the sequence of the seed
+    uint64_t MaskOffsetFor(const FrameRange& fr) const
     {
-        Base::ReleaseMatricesAfterBackprop(matrixPool);
-        ReleaseMatrixToPool(m_maskOfDropout, matrixPool);
+        const auto& value = Value();
+        return m_maskOffset + ColumnRangeWithMBLayoutFor(value.GetNumCols(), fr, GetMBLayout()).first * value.GetNumRows();
     }
 
-private:
-    shared_ptr<Matrix<ElemType>> m_maskOfDropout;
+    uint64_t m_maskOffset = 0;         // offset of the random numbers of the current minibatch
+    bool m_isMaskOffsetPending = true; // the mask of the current minibatch is not drawn yet
 };
 
 // -----------------------------------------------------------------------
@@ -2385,7 +2263,9 @@ private:
 // * epsilon is a conditioner constant used in computing inverse standard deviation
 // * useCntkEngine is a Boolean flag that specifies which batch normalization implementation to use: CNTK or cuDNN-based.
 // * disableRegularization is a Boolean flag that specifies this batch normalization node turns off regularization or not.
-// * imageLayout is the image layout. Only cudnn is supported at present.
+// * imageLayout is the image layout. HWC (channels-last) is supported for spatial normalization with the cuDNN engine only.
+// In data-parallel training, SGD's batchNormalizationSyncGroupSize normalizes the minibatches of groups of workers by
+// their joint statistics (see SetSyncGroupSize()), for when each worker's share of a minibatch is small.
 // -----------------------------------------------------------------------
 template <class ElemType>
 class BatchNormalizationNode : public ComputationNodeNonLooping<ElemType>, public IFreezable,
@@ -2410,8 +2290,10 @@ public:
                            double epsilon = 0, bool useCntkEngine = true, bool disableRegularization = false, ImageLayoutKind imageLayoutKind = ImageLayoutKind::CHW) :
         Base(deviceId, name), m_spatial(spatial), m_normTimeConst(normalizationTimeConstant), m_blendTimeConst(blendTimeConstant),
         m_epsilon(epsilon), m_useCntkEngine(useCntkEngine), m_disableRegularization(disableRegularization), m_imageLayoutKind(imageLayoutKind),
+        m_reluOutput(false),
         m_runCountUntied(0),
         m_one(1, 1, deviceId),
+        m_syncStats(deviceId),
         m_convertRunningVariancePending(false)
     {
         m_one.SetValue((StatType)1); // (constant value used for GPU-side update of runCount)
@@ -2443,6 +2325,7 @@ public:
 #endif
         fstream << m_epsilon;
         fstream << m_useCntkEngine;
+        fstream << m_reluOutput;
     }
 
     void Load(File& fstream, size_t modelVersion) override
@@ -2471,6 +2354,8 @@ public:
                 fstream >> mbCount; // converted below
             fstream >> m_epsilon;
             fstream >> m_useCntkEngine;
+            if (modelVersion >= CNTK_MODEL_VERSION_32)
+                fstream >> m_reluOutput;
         }
         else
         {
@@ -2548,6 +2433,7 @@ public:
             node->m_epsilon               = m_epsilon;
             node->m_useCntkEngine         = m_useCntkEngine;
             node->m_disableRegularization = m_disableRegularization;
+            node->m_reluOutput            = m_reluOutput;
         }
     }
 
@@ -2687,12 +2573,19 @@ public:
         // produced and BackpropToNonLooping() may not be called. In
         // non-inference (training) mode, saved statistics must be produced.
         bool inferenceOnly = !Environment().IsTraining();
-        m_bnEng->Forward(/*in=*/ sliceInputValue, scale, bias,   // (in)
-                         inferenceOnly, expAvgFactor, blendFactor,
-                         runMean, runVariance,                   // (in/out) running estimates, updated from the current MB mean/variance
-                         /*out=*/ sliceOutputValue,              // (out) batch-normalized output value
-                         m_epsilon,
-                         *m_savedMean, *m_savedInvStdDev);       // (out) actual interpolated mean/stddev values. Note: unused/empty for blendFactor==1 for CNTK engine
+        if (!inferenceOnly && IsSynchronized(blendFactor))
+        {
+            ForwardPropSynchronized(sliceInputValue, scale, bias, expAvgFactor, runMean, runVariance, sliceOutputValue);
+            if (m_reluOutput)
+                sliceOutputValue.InplaceTruncateBottom(0);
+        }
+        else
+            m_bnEng->Forward(/*in=*/ sliceInputValue, scale, bias,   // (in)
+                             inferenceOnly, expAvgFactor, blendFactor,
+                             runMean, runVariance,                   // (in/out) running estimates, updated from the current MB mean/variance
+                             /*out=*/ sliceOutputValue,              // (out) batch-normalized output value
+                             m_epsilon,
+                             *m_savedMean, *m_savedInvStdDev);       // (out) actual interpolated mean/stddev values. Note: unused/empty for blendFactor==1 for CNTK engine
 
         // and update the denominator
         if (expAvgFactor != 0 || blendFactor != 1)
@@ -2740,13 +2633,24 @@ public:
 
             // Compute all derivatives in one step. Save derivatives with respect to scale and bias in temp matrices.
             // TODO: Move this out. Follow the same pattern as the RNN node. But can't without requiring another buffer.
-            m_bnEng->Backward(sliceInputValue, sliceOutputGrad, // (in)  input from below, gradient from above
-                              sliceInputGrad,                   // (out) gradient for data input goes here  --TODO: Check if cudnn engine adds the gradient, or just overwrites (BUGBUG). CNTK engine is OK.
-                              scale,                            // (in)  out of scale and bias, only scale is needed in gradient propagation
-                              blendFactor,                      // (in)  smoothing weight for running stats (1=use only running stats)
-                              *m_savedMean, *m_savedInvStdDev,  // (in)  saved mean/invstddev values used in ForwardProp()
-                              *m_dScale, *m_dBias,              // (out) gradients for scale and bias
-                              !Input(DATA)->IsGradientInitializedBy(this)); // whether data gradient should be accumulated
+            // with a fused ReLU, the output masks the gradient from above
+            auto sliceOutputValue = ValueFor(fr);
+            if (IsSynchronized(blendFactor))
+            {
+                if (m_reluOutput)
+                    sliceOutputGrad.ElementMultiplyWith(Matrix<ElemType>(sliceOutputValue.GetDeviceId()).AssignLinearRectifierDerivativeOf(sliceOutputValue));
+                BackpropToSynchronized(sliceInputValue, sliceOutputGrad, needsInputGradient, sliceInputGrad, scale,
+                                       !Input(DATA)->IsGradientInitializedBy(this));
+            }
+            else
+                m_bnEng->Backward(sliceInputValue, sliceOutputGrad, // (in)  input from below, gradient from above
+                                  sliceInputGrad,                   // (out) gradient for data input goes here  --TODO: Check if cudnn engine adds the gradient, or just overwrites (BUGBUG). CNTK engine is OK.
+                                  scale,                            // (in)  out of scale and bias, only scale is needed in gradient propagation
+                                  blendFactor,                      // (in)  smoothing weight for running stats (1=use only running stats)
+                                  *m_savedMean, *m_savedInvStdDev,  // (in)  saved mean/invstddev values used in ForwardProp()
+                                  *m_dScale, *m_dBias,              // (out) gradients for scale and bias
+                                  !Input(DATA)->IsGradientInitializedBy(this), // whether data gradient should be accumulated
+                                  &bias, &sliceOutputValue);        // (in)  bias and output, used only by a fused ReLU
 
             m_gradientValid = true;
         }
@@ -2771,7 +2675,10 @@ public:
         // No derivatives with respect to running mean and variance.
     }
 
-    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    // a fused ReLU is differentiated by its output
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return m_reluOutput; }
+    // ForwardProp() updates the running statistics in training mode
+    virtual bool IsForwardPropRecomputable() const override { return false; }
 
     virtual ParentGradientOptimization ImplementsGradientOptimization(const ComputationNodeBase* input) const
     {
@@ -2815,7 +2722,8 @@ public:
             auto paramLayout = this->template TypedInput<StatType>(i)->GetSampleLayout();
             if (paramLayout.GetRank() == 2 && paramLayout[0] == 0 && paramLayout[1] == 1 && inputLayout.GetNumElements() > 0) // [0 x 1]
             {
-                size_t total = m_spatial ? inputLayout.GetDims().back() : inputLayout.GetNumElements();
+                size_t numChannels = m_imageLayoutKind == CHW ? inputLayout.GetDims().back() : inputLayout[0];
+                size_t total = m_spatial ? numChannels : inputLayout.GetNumElements();
                 Input(i)->ValidateInferInputDimsFrom(TensorShape(total, 1));
             }
         }
@@ -2868,14 +2776,6 @@ public:
                     InvalidArgument("%ls: Input[RUN_COUNT] must be a vector of 1 element without dynamic axis.", NodeDescription().c_str());
                 RunCount(); // cache the shared value into the local cache, for 0 checks
             }
-            if (m_spatial && m_imageLayoutKind != CHW)
-            {
-                InvalidArgument(
-                    "%ls %ls currently supports only cuDNN (CHW) data layout. " 
-                    "Please specify imageLayout=\"cudnn\" in BatchNormalization node in your NDL/BrainScript "
-                    "and make sure your input data layout is CHW", NodeName().c_str(), OperationName().c_str());
-            }
-
             if (!m_useCntkEngine)
             {
                 // Fallback to cntk engine on CPU device if cuDnn is not available,
@@ -2898,6 +2798,15 @@ public:
                 }
             }
 
+            // The channels-last (HWC) layout is only implemented by the cuDNN engine.
+            if (m_spatial && m_imageLayoutKind != CHW && m_useCntkEngine)
+            {
+                InvalidArgument(
+                    "%ls %ls supports HWC data layout only with the cuDNN engine on a GPU. "
+                    "Please specify imageLayout=\"cudnn\" or useCntkEngine=false in BatchNormalization node in your NDL/BrainScript "
+                    "and make sure your input data layout matches", NodeName().c_str(), OperationName().c_str());
+            }
+
             double cudnnMinEps = 1e-5; // CUDNN_BN_MIN_EPSILON
             if (!m_useCntkEngine && m_epsilon < cudnnMinEps) 
                 fprintf(stderr, "\nWARNING: cuDNN batch normalization requires epsilon >= %e. Epsilon will be reset to that value.\n", cudnnMinEps);
@@ -2909,7 +2818,7 @@ public:
             {
                 auto shape = GetSampleLayout();
                 m_bnEng = BatchNormEngine<ElemType, StatType>::Create(m_deviceId, shape, m_spatial, m_imageLayoutKind,
-                                                            m_useCntkEngine ? BatchNormEngineKind::Cntk : BatchNormEngineKind::CuDnn);
+                                                            m_useCntkEngine ? BatchNormEngineKind::Cntk : BatchNormEngineKind::CuDnn, m_reluOutput);
             }
 
             if (m_disableRegularization)
@@ -2955,6 +2864,17 @@ public:
             m_blendTimeConst = blendTimeConstant;
     }
 
+    // Sets the number of consecutive ranks of MPI whose minibatches are normalized together in training, from SGD:
+    // 1 (the default) normalizes each worker's minibatch by its own statistics, 0 all workers' minibatches by
+    // the statistics over all of them. Not saved with the model.
+    void SetSyncGroupSize(size_t syncGroupSize)
+    {
+        if (syncGroupSize != 1 && std::is_same<ElemType, half>::value)
+            InvalidArgument("%ls: synchronized batch normalization is not implemented for half precision.", NodeName().c_str());
+        m_syncGroupSize = syncGroupSize;
+    }
+    size_t SyncGroupSize() const { return m_syncGroupSize; }
+
     // called from CloneFunction(..., parameters="constant")
     // Once called, this node is put into inference mode.
     virtual void FreezeParameters() override // from IFreezable
@@ -2987,8 +2907,83 @@ public:
     double Epsilon() const { return m_epsilon; }
     bool UseCNTKEngine() const { return m_useCntkEngine; }
     bool DisableRegularization() const { return m_disableRegularization; }
+    ImageLayoutKind GetImageLayoutKind() const { return m_imageLayoutKind; }
+
+    // Whether the output is max(0, BN(x)), with the ReLU that follows batch normalization computed in the same pass.
+    // See ComputationNetwork::FuseBatchNormalizationRelu(). The network must be validated again after a change.
+    bool ReluOutput() const { return m_reluOutput; }
+    void SetReluOutput(bool reluOutput)
+    {
+        m_reluOutput = reluOutput;
+        m_bnEng.reset();
+    }
+
+    // The transform of inference mode as out = in * scale + shift, with one scale and shift per element of the
+    // parameters (per map if spatial), for computing it as part of a preceding node. Parameters on a GPU are copied
+    // to the CPU first.
+    template <class T>
+    void GetInferenceScaleAndShift(std::vector<T>& scale, std::vector<T>& shift) const
+    {
+        if (m_convertRunningVariancePending)
+            LogicError("%ls: Failed to convert running variance until forward prop", NodeName().c_str());
+
+        std::unique_ptr<StatType[]> copies[4];
+        auto data = [&](size_t input) -> const StatType*
+        {
+            const Matrix<StatType>& value = this->template TypedInput<StatType>(input)->Value();
+            if (value.GetDeviceId() == CPUDEVICE)
+                return value.Data();
+            copies[input - SCALE].reset(value.CopyToArray());
+            return copies[input - SCALE].get();
+        };
+        const StatType* scaleValue  = data(SCALE);
+        const StatType* biasValue   = data(BIAS);
+        const StatType* runMean     = data(RUN_MEAN);
+        const StatType* runVariance = data(RUN_VAR);
+
+        const size_t n = this->template TypedInput<StatType>(SCALE)->Value().GetNumElements();
+        scale.resize(n);
+        shift.resize(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            // same as CPUMatrix::BatchNormalizationForward() with blendFactor = 1
+            StatType factor = scaleValue[i] / (StatType)sqrt(runVariance[i] + m_epsilon);
+            scale[i] = (T)factor;
+            shift[i] = (T)(biasValue[i] - runMean[i] * factor);
+        }
+    }
+
+    virtual void MoveToDevice(DEVICEID_TYPE deviceId) override
+    {
+        Base::MoveToDevice(deviceId);
+        m_one.TransferToDeviceIfNotThere(deviceId, /*isBeingMoved=*/true);
+        m_syncStats.TransferToDeviceIfNotThere(deviceId, /*isBeingMoved=*/true);
+        m_bnEng.reset(); // recreated by Validate()
+    }
 
 private:
+    // Whether the statistics of this minibatch are reduced over the sync group, see SetSyncGroupSize().
+    // That is only needed if they are used, and only implemented for using no running statistics.
+    bool IsSynchronized(double blendFactor) const
+    {
+        if (m_syncGroupSize == 1 || blendFactor == 1)
+            return false;
+        if (blendFactor != 0)
+            InvalidArgument("%ls: synchronized batch normalization requires a blend time constant of 0 or infinity.", NodeName().c_str());
+        return true;
+    }
+
+    // The forward and backward pass with the statistics of the sync group, computed here instead of by m_bnEng:
+    // they are reduced as the sum, the sum of squares and the count of the samples of each group, and in the
+    // backward pass as the sums of the output gradient and of its product with the normalized input.
+    void ForwardPropSynchronized(const Matrix<ElemType>& in, const Matrix<StatType>& scale, const Matrix<StatType>& bias, double expAvgFactor,
+                                 Matrix<StatType>& runMean, Matrix<StatType>& runVariance, Matrix<ElemType>& out);
+    void BackpropToSynchronized(const Matrix<ElemType>& in, const Matrix<ElemType>& outGrad, bool computeInputGrad, Matrix<ElemType>& inGrad,
+                                const Matrix<StatType>& scale, bool accumulateInputGrad);
+
+    // the columns of m_syncStats that hold the statistics of this worker's group, and their total number
+    size_t SyncGroupColumn(size_t numStats, size_t& numColumns) const;
+
     // Old versioning - do not use. Do not remove until we're sure there are no old models around.
     struct VersionInfo
     {
@@ -3037,6 +3032,8 @@ private:
     bool m_disableRegularization;
     // Layout (e.g. CHW).
     ImageLayoutKind m_imageLayoutKind;
+    // Whether a ReLU is fused into the output.
+    bool m_reluOutput;
 
     // --- working variables
 
@@ -3067,7 +3064,206 @@ private:
 
     std::unique_ptr<BatchNormEngine<ElemType, StatType>> m_bnEng;
 
+    // Number of ranks over which the statistics are reduced, see SetSyncGroupSize(), and the [C x 3 * #groups]
+    // buffer in which that is done: every group reduces into its own columns, all but this worker's are 0.
+    size_t m_syncGroupSize = 1;
+    Matrix<StatType> m_syncStats;
+
     bool m_convertRunningVariancePending;
 };
 
+template <>
+void BatchNormalizationNode<half>::ForwardPropSynchronized(const Matrix<half>& in, const Matrix<float>& scale, const Matrix<float>& bias, double expAvgFactor,
+                                                           Matrix<float>& runMean, Matrix<float>& runVariance, Matrix<half>& out);
+template <>
+void BatchNormalizationNode<half>::BackpropToSynchronized(const Matrix<half>& in, const Matrix<half>& outGrad, bool computeInputGrad, Matrix<half>& inGrad,
+                                                          const Matrix<float>& scale, bool accumulateInputGrad);
+
+// -----------------------------------------------------------------------
+// LayerNormalizationNode (input, scale, bias, epsilon=1e-5)
+//
+// Implements layer normalization as described in:
+// Layer Normalization [J. L. Ba, J. R. Kiros, G. E. Hinton]
+//
+// Each sample is normalized over all its elements, then scaled and shifted elementwise:
+//   output = scale .* (input - mean(input)) / sqrt(var(input) + epsilon) + bias
+// The mean and variance of each sample are computed in a single pass over it, and the gradients for the input,
+// the scale and the bias in a single backward pass. scale and bias have as many elements as a sample of the input,
+// and infer the sample layout of the input if they do not have dimensions.
+// -----------------------------------------------------------------------
+template <class ElemType>
+class LayerNormalizationNode : public ComputationNodeNonLooping<ElemType>, public NumInputs<3>
+{
+    typedef ComputationNodeNonLooping<ElemType> Base; UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"LayerNormalization"; }
+
+    // inputs
+    static const size_t DATA  = 0;
+    static const size_t SCALE = 1;
+    static const size_t BIAS  = 2;
+public:
+    LayerNormalizationNode(DEVICEID_TYPE deviceId, const wstring& name, double epsilon = 1e-5) :
+        Base(deviceId, name), m_epsilon(epsilon)
+    {
+    }
+    LayerNormalizationNode(const ScriptableObjects::IConfigRecordPtr configp) :
+        LayerNormalizationNode(configp->Get(L"deviceId"), L"<placeholder>", configp->Get(L"epsilon"))
+    {
+        AttachInputsFromConfig(configp, this->GetExpectedNumInputs());
+    }
+
+    void Save(File& fstream) const override
+    {
+        Base::Save(fstream);
+        fstream << m_epsilon;
+    }
+
+    void Load(File& fstream, size_t modelVersion) override
+    {
+        Base::Load(fstream, modelVersion);
+        fstream >> m_epsilon;
+    }
+
+    void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
+    {
+        Base::CopyTo(nodeP, newName, flags);
+        if (flags & CopyNodeFlags::copyNodeValue)
+        {
+            auto node = dynamic_pointer_cast<LayerNormalizationNode<ElemType>>(nodeP);
+            node->m_epsilon = m_epsilon;
+        }
+    }
+
+    virtual void /*ComputationNodeNonLooping::*/ ForwardPropNonLooping() override
+    {
+        FrameRange fr(Input(DATA)->GetMBLayout());
+
+        // Gaps are masked, so that they do not contribute to the gradients of scale and bias.
+        Matrix<ElemType> sliceInputValue  = AsColumns(Input(DATA)->MaskedValueFor(fr));
+        Matrix<ElemType> sliceOutputValue = AsColumns(ValueFor(fr));
+        sliceInputValue.LayerNormalizationForward(Input(SCALE)->Value(), Input(BIAS)->Value(), m_epsilon,
+                                                  sliceOutputValue, *m_savedMean, *m_savedInvStdDev);
+
+        // gradient is as of now invalid
+        m_gradientValid = false;
+    }
+
+    virtual void BackpropToNonLooping(size_t inputIndex) override
+    {
+        FrameRange fr(Input(DATA)->GetMBLayout());
+
+        // The gradients of all inputs are computed in one step, the ones of scale and bias are kept for the subsequent calls.
+        if (inputIndex == DATA || !m_gradientValid)
+        {
+            Matrix<ElemType> sliceOutputGrad = AsColumns(MaskedGradientFor(fr));
+            Matrix<ElemType> sliceInputValue = AsColumns(Input(DATA)->MaskedValueFor(fr));
+
+            // If DATA receives no gradient, its gradient is computed into a dummy.
+            bool needsInputGradient = (inputIndex == DATA);
+            if (needsInputGradient && m_gradientValid)
+                LogicError("BackpropTo: Layer-normalization data gradient must be requested before all others.");
+            if (!needsInputGradient)
+                m_dDataDummy->Resize(sliceInputValue);
+            Matrix<ElemType> sliceInputGrad = needsInputGradient ? AsColumns(Input(DATA)->GradientFor(fr)) : m_dDataDummy->AsReference();
+
+            sliceOutputGrad.LayerNormalizationBackward(sliceInputValue, sliceInputGrad, Input(SCALE)->Value(),
+                                                       *m_savedMean, *m_savedInvStdDev, *m_dScale, *m_dBias);
+            m_gradientValid = true;
+        }
+        if (inputIndex == SCALE)
+        {
+            assert(m_gradientValid);
+            Input(SCALE)->Gradient() += *m_dScale;
+        }
+        else if (inputIndex == BIAS)
+        {
+            assert(m_gradientValid);
+            Input(BIAS)->Gradient() += *m_dBias;
+        }
+    }
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t childIndex) const override { return childIndex != BIAS; }
+
+    void Validate(bool isFinalValidationPass) override
+    {
+        Base::Validate(isFinalValidationPass);
+        InferMBLayoutFromInputsForStandardCase(isFinalValidationPass);
+
+        SetDims(Input(DATA));
+
+        const auto& inputLayout = Input(DATA)->GetSampleLayout();
+        for (size_t i = SCALE; i <= BIAS; i++)
+        {
+            if (Input(i)->GetSampleLayout().GetNumElements() == 0 && inputLayout.GetNumElements() > 0)
+                Input(i)->ValidateInferInputDimsFrom(inputLayout);
+        }
+
+        if (isFinalValidationPass)
+        {
+            if (Input(DATA)->IsValueSparse())
+                InvalidArgument("%ls: The input of LayerNormalization cannot be sparse.", NodeDescription().c_str());
+            if (inputLayout.GetNumElements() == 0)
+                InvalidArgument("%ls: The input of LayerNormalization must have a known, non-empty sample layout.", NodeDescription().c_str());
+            for (size_t i = SCALE; i <= BIAS; i++)
+            {
+                if (Input(i)->HasMBLayout())
+                    InvalidArgument("%ls: Input[%d] has a dynamic axis. LayerNormalization parameters cannot have that.", NodeDescription().c_str(), (int)i);
+                if (Input(i)->GetSampleLayout().GetNumElements() != inputLayout.GetNumElements())
+                    InvalidArgument("%ls: Input[%d] must have as many elements as a sample of the input, %d, but has %d.", NodeDescription().c_str(),
+                                    (int)i, (int)inputLayout.GetNumElements(), (int)Input(i)->GetSampleLayout().GetNumElements());
+            }
+            if (m_epsilon < 0)
+                InvalidArgument("%ls %ls requires epsilon to be >= 0.", NodeName().c_str(), OperationName().c_str());
+        }
+    }
+
+    void RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) override
+    {
+        Base::RequestMatricesBeforeForwardProp(matrixPool);
+        RequestMatrixFromPool(m_savedMean, matrixPool);
+        RequestMatrixFromPool(m_savedInvStdDev, matrixPool);
+    }
+
+    void RequestMatricesBeforeBackprop(MatrixPool& matrixPool) override
+    {
+        Base::RequestMatricesBeforeBackprop(matrixPool);
+        RequestMatrixFromPool(m_dDataDummy, matrixPool);
+        RequestMatrixFromPool(m_dScale, matrixPool);
+        RequestMatrixFromPool(m_dBias, matrixPool);
+    }
+
+    void ReleaseMatricesAfterBackprop(MatrixPool& matrixPool) override
+    {
+        Base::ReleaseMatricesAfterBackprop(matrixPool);
+        ReleaseMatrixToPool(m_savedMean, matrixPool);
+        ReleaseMatrixToPool(m_savedInvStdDev, matrixPool);
+        ReleaseMatrixToPool(m_dDataDummy, matrixPool);
+        ReleaseMatrixToPool(m_dScale, matrixPool);
+        ReleaseMatrixToPool(m_dBias, matrixPool);
+    }
+
+    double Epsilon() const { return m_epsilon; }
+
+private:
+    // The samples as the columns of a matrix, also for an input without dynamic axis, whose matrix has the leading dimension as rows.
+    Matrix<ElemType> AsColumns(const Matrix<ElemType>& m) const
+    {
+        size_t sampleSize = GetSampleLayout().GetNumElements();
+        return m.Reshaped(sampleSize, m.GetNumElements() / sampleSize);
+    }
+
+    double m_epsilon;
+
+    // Mean and inverse standard deviation of each sample, computed in ForwardProp() and used in the gradient computation.
+    shared_ptr<Matrix<ElemType>> m_savedMean;
+    shared_ptr<Matrix<ElemType>> m_savedInvStdDev;
+    // Temp buffers for the derivatives, carrying the scale and bias derivatives from the first call of BackpropTo() to the subsequent ones.
+    shared_ptr<Matrix<ElemType>> m_dDataDummy;
+    shared_ptr<Matrix<ElemType>> m_dScale;
+    shared_ptr<Matrix<ElemType>> m_dBias;
+
+    bool m_gradientValid = false;
+};
+
 }}}
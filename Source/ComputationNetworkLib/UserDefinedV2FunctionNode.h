@@ -7,6 +7,7 @@
 #include "Basics.h"
 #include "ComputationNode.h"
 #include "Matrix.h"
+#include "GPUMatrix.h"
 #include "CNTKLibrary.h"
 #include "Utils.h"
 
@@ -20,6 +21,8 @@ class OutputMultiplexerNode;
 // Proxy ComputationNode type for a V2 user-defined custom Function, instances
 // of which can be part of a CNTK computation network.
 // The actual implementation of the operation itself is external to the CNTK engine.
+// A UDF that implements ::CNTK::DeviceBufferUserFunction is computed directly on
+// the matrices of this node and its inputs, without Values.
 // -----------------------------------------------------------------------
 template <class ElemType>
 class UserDefinedV2FunctionNode final : public ComputationNode<ElemType>, public MultiOutputNode<ElemType>
@@ -35,6 +38,55 @@ public:
     {
         if (!m_externalFunction)
             LogicError("UserDefinedV2FunctionNode ctor should never be called with externalFunction == nullptr");
+
+        // The buffers of the outputs are allocated before the UDF is called, so their shapes must be known
+        if (!ForceDynamicValidation())
+            m_deviceBufferFunction = dynamic_cast<::CNTK::DeviceBufferUserFunction*>(m_externalFunction.get());
+    }
+
+    virtual bool HoldsValuesExternally() const override { return m_deviceBufferFunction == nullptr; }
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override
+    {
+        return !m_deviceBufferFunction || m_deviceBufferFunction->OutputsUsedInBackward();
+    }
+
+    virtual bool InputUsedInComputingInputNodesGradients(size_t childIndex) const override
+    {
+        return !m_deviceBufferFunction || m_deviceBufferFunction->InputUsedInBackward(childIndex);
+    }
+
+    // The gradients of the inputs are assigned by a UDF computed on the buffers, and computed in place of the gradient of this node if it declares so
+    virtual ParentGradientOptimization ImplementsGradientOptimization(const ComputationNodeBase* input) const override
+    {
+        if (!m_deviceBufferFunction)
+            return ParentGradientOptimization::None;
+
+        size_t i;
+        for (i = 0; i < GetNumInputs(); i++)
+        {
+            if (Input(i).get() == input) break;
+        }
+        if (i == GetNumInputs())
+            LogicError("Cannot find input.");
+
+        bool inPlace = m_deviceBufferFunction->InputGradientInPlace(i) && (input->GetSampleLayout() == GetSampleLayout()) && (input->GetMBLayout() == GetMBLayout());
+        return inPlace ? ParentGradientOptimization::Reuse : ParentGradientOptimization::Overwrite;
+    }
+
+    virtual void UpdateFunctionMBSize() override
+    {
+        Base::UpdateFunctionMBSize();
+
+        // The other outputs are only resized by the UDF computed on Values
+        if (m_deviceBufferFunction)
+        {
+            for (size_t i = 1; i < this->m_outputsValue.size(); ++i)
+            {
+                if (this->m_outputsValue[i])
+                    this->m_outputsValue[i]->Resize(this->m_outputsShape[i].GetNumElements(), Value().GetNumCols());
+            }
+        }
     }
 
     virtual bool ForceDynamicValidation() const override
@@ -57,6 +109,20 @@ public:
         // using OutputMultiplexerNode when creating the computation network.
         this->m_outputsValue[0] = m_value;
 
+        if (m_deviceBufferFunction)
+        {
+            std::vector<::CNTK::NDArrayViewPtr> inputs(GetNumInputs());
+            for (size_t i = 0; i < inputs.size(); ++i)
+                inputs[i] = InputBufferFor(InputRef(i).Value(), i, fr, /*readOnly=*/ true);
+
+            std::vector<::CNTK::NDArrayViewPtr> outputs(this->m_outputsValue.size());
+            for (size_t i = 0; i < outputs.size(); ++i)
+                outputs[i] = OutputBufferFor(*this->m_outputsValue[i], i, fr, /*readOnly=*/ false);
+
+            m_deviceBufferFunction->ForwardOnDevice(inputs, outputs, ComputeStream(), Environment().IsTraining());
+            return;
+        }
+
         // Get the arguments of the external function
         auto arguments = m_externalFunction->Arguments();
         std::unordered_map<::CNTK::Variable, ::CNTK::ValuePtr> argumentValues;
@@ -190,6 +256,9 @@ public:
     // PAR Mode is a single invocation for the whole gradient matrix.
     virtual void BackpropTo(const size_t inputIndex, const FrameRange& fr) override
     {
+        if (m_deviceBufferFunction)
+            return BackpropToOnDeviceBuffers(inputIndex, fr);
+
         if (m_currentBackpropStatePtr == nullptr)
             return;
 
@@ -422,8 +491,76 @@ public:
     }
 
 private:
+    // Backpropagates to the input 'inputIndex' through a UDF computed on the buffers.
+    // The array of the input gradients only holds that of this input.
+    void BackpropToOnDeviceBuffers(const size_t inputIndex, const FrameRange& fr)
+    {
+        this->m_outputsGradient[0] = m_gradient;
+
+        auto outputVariables = m_externalFunction->Outputs();
+        std::vector<::CNTK::NDArrayViewPtr> outputs(this->m_outputsValue.size()), outputGradients(this->m_outputsGradient.size());
+        for (size_t i = 0; i < outputs.size(); ++i)
+        {
+            if (OutputUsedInComputingInputNodesGradients())
+                outputs[i] = OutputBufferFor(*this->m_outputsValue[i], i, fr, /*readOnly=*/ true);
+
+            if (outputVariables[i].NeedsGradient() && this->m_outputsGradient[i])
+                outputGradients[i] = OutputBufferFor(*this->m_outputsGradient[i], i, fr, /*readOnly=*/ true);
+        }
+
+        std::vector<::CNTK::NDArrayViewPtr> inputs(GetNumInputs()), inputGradients(GetNumInputs());
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            if (InputUsedInComputingInputNodesGradients(i))
+                inputs[i] = InputBufferFor(InputRef(i).Value(), i, fr, /*readOnly=*/ true);
+        }
+
+        inputGradients[inputIndex] = InputBufferFor(InputRef(inputIndex).Gradient(), inputIndex, fr, /*readOnly=*/ false);
+        std::vector<bool> overwriteInputGradients(GetNumInputs(), false);
+        overwriteInputGradients[inputIndex] = Input(inputIndex)->ParentGradientOptimized();
+
+        m_deviceBufferFunction->BackwardOnDevice(inputs, outputs, outputGradients, inputGradients, overwriteInputGradients, ComputeStream());
+    }
+
+    // Returns an NDArrayView over the columns of the frame range in 'data', which is the value or gradient of the input 'inputIndex':
+    // of the shape of its samples followed by the number of columns if it has an MBLayout
+    ::CNTK::NDArrayViewPtr InputBufferFor(Matrix<ElemType>& data, size_t inputIndex, const FrameRange& fr, bool readOnly)
+    {
+        auto& input = InputRef(inputIndex);
+        FrameRange inputFr = fr.IsAllFrames() ? fr.WithLayout(input.GetMBLayout()) : fr;
+        auto dataForFrame = input.DataFor(data, inputFr);
+        return DeviceBufferOf(dataForFrame, input.GetSampleLayout(), input.HasMBLayout(), readOnly);
+    }
+
+    // Returns an NDArrayView over the columns of the frame range in 'data', which is the value or gradient of the output 'outputIndex'
+    ::CNTK::NDArrayViewPtr OutputBufferFor(Matrix<ElemType>& data, size_t outputIndex, const FrameRange& fr, bool readOnly)
+    {
+        auto dataForFrame = DataFor(data, fr);
+        return DeviceBufferOf(dataForFrame, this->m_outputsShape[outputIndex], this->m_outputsMBLayout[outputIndex] != nullptr, readOnly);
+    }
+
+    static ::CNTK::NDArrayViewPtr DeviceBufferOf(const Matrix<ElemType>& data, const TensorShape& sampleLayout, bool hasMBLayout, bool readOnly)
+    {
+        auto viewShape = ::CNTK::AsNDShape(sampleLayout);
+        if (hasMBLayout)
+            viewShape = viewShape.AppendShape({ data.GetNumCols() });
+
+        return ::CNTK::Utils::GetNDArrayViewAliasOfCNTKImplMatrix(viewShape, data, readOnly);
+    }
+
+    // The CUDA stream that the network computes on, or null on the CPU
+    void* ComputeStream() const
+    {
+#ifndef CPUONLY
+        if (m_deviceId != CPUDEVICE)
+            return GetStream();
+#endif
+        return nullptr;
+    }
+
     ::CNTK::FunctionPtr m_externalFunction;
     ::CNTK::BackPropStatePtr m_currentBackpropStatePtr;
+    ::CNTK::DeviceBufferUserFunction* m_deviceBufferFunction = nullptr; // m_externalFunction if it is computed on the buffers of this node
 };
 
 template class UserDefinedV2FunctionNode<float>;
@@ -25,15 +25,57 @@ extern "C" IMAGEWRITER_API void EncodeImageAsPNG(void* matrix, ::CNTK::DataType
     assert(&buffer != nullptr);
     assert(dtype == ::CNTK::DataType::Float || dtype == ::CNTK::DataType::Double);
 
-    int cvDataType = dtype == ::CNTK::DataType::Float ? CV_32FC(depth) : CV_64FC(depth);
-    cv::Mat source = cv::Mat(height, width, cvDataType, matrix);
-    std::vector<int> parameters = std::vector<int>(2);
-    parameters[0] = CV_IMWRITE_PNG_COMPRESSION;
-    parameters[1] = 3; //default(3)  0-9
-
-    if (!imencode(".png", source, buffer, parameters)) {
+    if (!EncodeImage(matrix, dtype, height, width, depth, /*planar=*/false, ".png", -1, buffer)) {
         fprintf(stderr, "ImageWriter: PNG encoding failed.");
     }
 }
 
+extern "C" IMAGEWRITER_API bool EncodeImage(const void* matrix, ::CNTK::DataType dtype, int height, int width, int depth, bool planar,
+                                            const char* extension, int quality, std::vector<unsigned char>& buffer)
+{
+    assert(matrix != nullptr);
+    if (dtype != ::CNTK::DataType::Float && dtype != ::CNTK::DataType::Double)
+        return false;
+
+    int elementType = dtype == ::CNTK::DataType::Float ? CV_32F : CV_64F;
+    void* data = const_cast<void*>(matrix);
+
+    // The codecs take 8 bit images, the conversion saturates.
+    cv::Mat image;
+    if (planar && depth > 1)
+    {
+        size_t planeSize = (size_t)height * width * (dtype == ::CNTK::DataType::Float ? sizeof(float) : sizeof(double));
+        std::vector<cv::Mat> planes;
+        for (int c = 0; c < depth; c++)
+            planes.push_back(cv::Mat(height, width, CV_MAKETYPE(elementType, 1), static_cast<char*>(data) + c * planeSize).clone());
+        cv::Mat merged;
+        cv::merge(planes, merged);
+        merged.convertTo(image, CV_8U);
+    }
+    else
+        cv::Mat(height, width, CV_MAKETYPE(elementType, depth), data).convertTo(image, CV_8U);
+
+    std::string format(extension);
+    std::vector<int> parameters;
+    if (format == ".png")
+    {
+        parameters.push_back(CV_IMWRITE_PNG_COMPRESSION);
+        parameters.push_back(quality >= 0 ? quality : 3); //default(3)  0-9
+    }
+    else if (format == ".jpg" || format == ".jpeg")
+    {
+        parameters.push_back(CV_IMWRITE_JPEG_QUALITY);
+        parameters.push_back(quality >= 0 ? quality : 95); //default(95)  0-100
+    }
+
+    try
+    {
+        return cv::imencode(format, image, buffer, parameters);
+    }
+    catch (const cv::Exception&)
+    {
+        return false; // e.g. an unknown extension
+    }
+}
+
 } } }
@@ -33,4 +33,11 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
     extern "C" IMAGEWRITER_API void EncodeImageAsPNG(void* matrix, ::CNTK::DataType dtype, int height, int width, int depth, std::vector<unsigned char>& buffer);
 
+    // Encodes a float or double image with values in [0, 255] (saturated) in the format of 'extension' (".png", ".jpg").
+    // The image is interleaved (height x width x depth, depth fastest), or with 'planar' depth planes of height x width,
+    // which is the layout of the image reader. 'quality' is the JPEG quality (0-100) or the PNG compression level (0-9),
+    // or -1 for the default. Returns false if the image could not be encoded. May be called from several threads.
+    extern "C" IMAGEWRITER_API bool EncodeImage(const void* matrix, ::CNTK::DataType dtype, int height, int width, int depth, bool planar,
+                                                const char* extension, int quality, std::vector<unsigned char>& buffer);
+
 } } }
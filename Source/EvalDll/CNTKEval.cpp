@@ -27,6 +27,7 @@
 #include "InputAndParamNodes.h"
 #include "latticearchive.h"
 #include <limits>
+#include <algorithm>
 #include "RecurrentNodes.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -264,6 +265,10 @@ void CNTKEvalExtended<ElemType>::StartForwardEvaluation(const std::vector<wstrin
     this->m_net->AllocateAllMatrices({}, m_outputNodes, nullptr);
     this->m_net->StartEvaluateMinibatchLoop(m_outputNodes);
     m_inputMatrices = DataReaderHelpers::RetrieveInputMatrices(m_inputNodes);
+    m_inputLayouts.clear();
+    m_packedValues.resize(m_inputNodes.size());
+    m_packedIndices.resize(m_inputNodes.size());
+    m_packedColIndices.resize(m_inputNodes.size());
 
     for (const auto& node : m_outputNodes)
     {
@@ -307,69 +312,158 @@ VariableSchema CNTKEvalExtended<ElemType>::GetInputSchema() const
 
 template<typename ElemType>
 template<template<typename> class ValueContainer>
-void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<ValueBuffer<ElemType, ValueContainer> >& inputs, std::vector<ValueBuffer<ElemType, ValueContainer> >& outputs, bool resetRNN)
+size_t CNTKEvalExtended<ElemType>::GetNumSamples(const ComputationNodeBasePtr& inputNode, const ValueBuffer<ElemType, ValueContainer>& buffer, MatrixType type, size_t numRows)
+{
+    if (buffer.m_buffer.data() == nullptr)
+        RuntimeError("Input %ls: Buffer is not allocated.", inputNode->GetName().c_str());
+    if (type == MatrixType::DENSE)
+    {
+        if (buffer.m_buffer.size() % numRows != 0)
+            RuntimeError("Input %ls: Expected input data to be a multiple of %" PRIu64 ", but it is %" PRIu64 ".", 
+                         inputNode->GetName().c_str(), numRows, buffer.m_buffer.size());
+        if (buffer.m_buffer.size() == 0)
+            RuntimeError("Input %ls: Expected at least one element.", inputNode->GetName().c_str());
+    }
+    else if (type == MatrixType::SPARSE)
+    {
+        if (buffer.m_colIndices.data() == nullptr)
+            RuntimeError("Input %ls: Due to sparse input format, expected colIndices array, but was nullptr.", inputNode->GetName().c_str());
+        if (buffer.m_indices.data() == nullptr)
+            RuntimeError("Input %ls: Due to sparse input format, expected Indices array, but was nullptr.", inputNode->GetName().c_str());
+        if (buffer.m_colIndices.size() < 2)
+            RuntimeError("Input %ls: Expected at least one element (2 entries in colIndices array).", inputNode->GetName().c_str());
+        if (buffer.m_colIndices[0] != 0)
+            RuntimeError("Input %ls: First element of column indices must be 0", inputNode->GetName().c_str());
+        if (buffer.m_colIndices[buffer.m_colIndices.size() - 1] != buffer.m_indices.size())
+            RuntimeError("Input %ls: Last element of column indices must be equal to the size of indices (%ld), but was %d", 
+                         inputNode->GetName().c_str(), buffer.m_indices.size(), 
+                         buffer.m_colIndices[buffer.m_colIndices.size() - 1]);
+    }
+
+    int numCols = type == MatrixType::DENSE ? buffer.m_buffer.size() / numRows : buffer.m_colIndices.size() - 1;
+    if (numCols < 1)
+        RuntimeError("Input: the number of column must be greater than or equal to 1.");
+    return numCols;
+}
+
+// Sets up the MBLayout of an input for one sequence per request. Inputs on the same dynamic axis share their MBLayout,
+// which is only rebuilt when the lengths of the sequences change.
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::SetInputLayout(const ComputationNodeBasePtr& inputNode, const std::vector<size_t>& lengths, bool resetRNN,
+                                                std::map<const MBLayout*, std::vector<size_t>>& layoutsOfThisPass)
+{
+    auto pMBLayout = inputNode->GetMBLayout();
+    auto previous = layoutsOfThisPass.find(pMBLayout.get());
+    if (previous != layoutsOfThisPass.end())
+    {
+        if (previous->second != lengths)
+            RuntimeError("Input %ls: The inputs on the same dynamic axis must have the same number of samples in every request.", inputNode->GetName().c_str());
+        return;
+    }
+    layoutsOfThisPass[pMBLayout.get()] = lengths;
+
+    auto& cached = m_inputLayouts[pMBLayout.get()];
+    if (cached.first == lengths && cached.second == resetRNN)
+        return;
+
+    const size_t numTimeSteps = *std::max_element(lengths.begin(), lengths.end());
+    pMBLayout->Init(lengths.size(), numTimeSteps);
+    for (size_t r = 0; r < lengths.size(); ++r)
+    {
+        // SentinelValueIndicatingUnspecifedSequenceBeginIdx is used to specify the lower bound of look-back step of recurrent nodes
+        pMBLayout->AddSequence(r, r, resetRNN ? 0 : SentinelValueIndicatingUnspecifedSequenceBeginIdx, lengths[r]);
+        if (lengths[r] < numTimeSteps)
+            pMBLayout->AddGap(r, lengths[r], numTimeSteps);
+    }
+    cached = make_pair(lengths, resetRNN);
+}
+
+template<typename ElemType>
+template<template<typename> class ValueContainer>
+void CNTKEvalExtended<ElemType>::ForwardPassRequests(const std::vector<const Buffers<ValueContainer>*>& requests, const std::vector<Buffers<ValueContainer>*>& results, bool resetRNN)
 {
     if (!m_started)
         RuntimeError("ForwardPass() called before StartForwardEvaluation()");
 
-    if (inputs.size() != (size_t)std::distance(m_inputMatrices.begin(), m_inputMatrices.end()))
-        RuntimeError("Expected %d inputs, but got %d.", (int)std::distance(m_inputMatrices.begin(), m_inputMatrices.end()), (int)inputs.size());
+    const size_t numInputs = (size_t)std::distance(m_inputMatrices.begin(), m_inputMatrices.end());
+    for (size_t r = 0; r < requests.size(); ++r)
+    {
+        if (requests[r]->size() != numInputs)
+            RuntimeError("Expected %d inputs, but got %d.", (int)numInputs, (int)requests[r]->size());
 
-    if (outputs.size() != m_outputNodes.size())
-        RuntimeError("Expected %d outputs, but got %d.", (int)m_outputNodes.size(), (int)outputs.size());
+        if (results[r]->size() != m_outputNodes.size())
+            RuntimeError("Expected %d outputs, but got %d.", (int)m_outputNodes.size(), (int)results[r]->size());
+    }
 
+    const size_t numRequests = requests.size();
+    std::map<const MBLayout*, std::vector<size_t>> layoutsOfThisPass;
     size_t i = 0;
     for (auto& inputNode : m_inputNodes)
     {
-        // const cast: The matrix class takes this over without copying and could theoretically change the contents,
-        // though it doesn't in this case.
-        auto& buffer = const_cast<ValueBuffer<ElemType, ValueContainer>&>(inputs[i]);
         auto matrix = dynamic_pointer_cast<Matrix<ElemType>>(inputNode->ValuePtr());
         auto type = matrix->GetMatrixType();
         size_t numRows = inputNode->GetSampleLayout().GetNumElements();
 
-        if (buffer.m_buffer.data() == nullptr)
-            RuntimeError("Input %ls: Buffer is not allocated.", m_inputNodes[i]->GetName().c_str());
-        if (type == MatrixType::DENSE)
-        {
-            if (buffer.m_buffer.size() % numRows != 0)
-                RuntimeError("Input %ls: Expected input data to be a multiple of %" PRIu64 ", but it is %" PRIu64 ".", 
-                             m_inputNodes[i]->GetName().c_str(), numRows, buffer.m_buffer.size());
-            if (buffer.m_buffer.size() == 0)
-                RuntimeError("Input %ls: Expected at least one element.", m_inputNodes[i]->GetName().c_str());
-        }
-        else if (type == MatrixType::SPARSE)
+        std::vector<size_t> lengths(numRequests);
+        for (size_t r = 0; r < numRequests; ++r)
+            lengths[r] = GetNumSamples(inputNode, (*requests[r])[i], type, numRows);
+        SetInputLayout(inputNode, lengths, resetRNN, layoutsOfThisPass);
+
+        if (numRequests == 1)
         {
-            if (buffer.m_colIndices.data() == nullptr)
-                RuntimeError("Input %ls: Due to sparse input format, expected colIndices array, but was nullptr.", m_inputNodes[i]->GetName().c_str());
-            if (buffer.m_indices.data() == nullptr)
-                RuntimeError("Input %ls: Due to sparse input format, expected Indices array, but was nullptr.", m_inputNodes[i]->GetName().c_str());
-            if (buffer.m_colIndices.size() < 2)
-                RuntimeError("Input %ls: Expected at least one element (2 entries in colIndices array).", m_inputNodes[i]->GetName().c_str());
-            if (buffer.m_colIndices[0] != 0)
-                RuntimeError("Input %ls: First element of column indices must be 0", m_inputNodes[i]->GetName().c_str());
-            if (buffer.m_colIndices[buffer.m_colIndices.size() - 1] != buffer.m_indices.size())
-                RuntimeError("Input %ls: Last element of column indices must be equal to the size of indices (%ld), but was %d", 
-                             m_inputNodes[i]->GetName().c_str(), buffer.m_indices.size(), 
-                             buffer.m_colIndices[buffer.m_colIndices.size() - 1]);
+            // const cast: The matrix class takes this over without copying and could theoretically change the contents,
+            // though it doesn't in this case.
+            auto& buffer = const_cast<ValueBuffer<ElemType, ValueContainer>&>((*requests[0])[i]);
+            size_t numCols = lengths[0];
+            if (type == MatrixType::DENSE)
+                matrix->SetValue(numRows, numCols, matrix->GetDeviceId(), buffer.m_buffer.data(), matrixFlagNormal);
+            else if (type == MatrixType::SPARSE)
+            {
+                // In the sparse case the m_data layout is identical to CUDA's CSC layout
+                // (see http://docs.nvidia.com/cuda/cusparse/#compressed-sparse-column-format-csc).
+                matrix->SetMatrixFromCSCFormat(buffer.m_colIndices.data(), buffer.m_indices.data(), buffer.m_buffer.data(),
+                                               buffer.m_buffer.size(), numRows, numCols);
+            }
         }
-
-        int numCols = type == MatrixType::DENSE ? buffer.m_buffer.size() / numRows : buffer.m_colIndices.size() - 1;
-        if (numCols < 1)
-            RuntimeError("Input: the number of column must be greater than or equal to 1.");
-        inputNode->GetMBLayout()->Init(1, numCols);
-        
-        // SentinelValueIndicatingUnspecifedSequenceBeginIdx is used to specify the lower bound of look-back step of recurrent nodes
-        inputNode->GetMBLayout()->AddSequence(0, 0, resetRNN ? 0 : SentinelValueIndicatingUnspecifedSequenceBeginIdx, numCols);
-
-        if (type == MatrixType::DENSE)
-            matrix->SetValue(numRows, numCols, matrix->GetDeviceId(), buffer.m_buffer.data(), matrixFlagNormal);
-        else if (type == MatrixType::SPARSE)
+        else
         {
-            // In the sparse case the m_data layout is identical to CUDA's CSC layout
-            // (see http://docs.nvidia.com/cuda/cusparse/#compressed-sparse-column-format-csc).
-            matrix->SetMatrixFromCSCFormat(buffer.m_colIndices.data(), buffer.m_indices.data(), buffer.m_buffer.data(),
-                                           buffer.m_buffer.size(), numRows, numCols);
+            // interleave the requests: sample t of request r goes into column t * numRequests + r, gaps stay empty
+            const size_t numTimeSteps = *std::max_element(lengths.begin(), lengths.end());
+            const size_t numCols = numTimeSteps * numRequests;
+            auto& values = m_packedValues[i];
+            if (type == MatrixType::DENSE)
+            {
+                values.assign(numRows * numCols, 0);
+                for (size_t r = 0; r < numRequests; ++r)
+                {
+                    const auto& buffer = (*requests[r])[i];
+                    for (size_t t = 0; t < lengths[r]; ++t)
+                        std::copy(buffer.m_buffer.data() + t * numRows, buffer.m_buffer.data() + (t + 1) * numRows, values.begin() + (t * numRequests + r) * numRows);
+                }
+                matrix->SetValue(numRows, numCols, matrix->GetDeviceId(), values.data(), matrixFlagNormal);
+            }
+            else if (type == MatrixType::SPARSE)
+            {
+                auto& indices = m_packedIndices[i];
+                auto& colIndices = m_packedColIndices[i];
+                values.clear();
+                indices.clear();
+                colIndices.assign(1, 0);
+                for (size_t t = 0; t < numTimeSteps; ++t)
+                {
+                    for (size_t r = 0; r < numRequests; ++r)
+                    {
+                        const auto& buffer = (*requests[r])[i];
+                        if (t < lengths[r])
+                        {
+                            values.insert(values.end(), buffer.m_buffer.data() + buffer.m_colIndices[t], buffer.m_buffer.data() + buffer.m_colIndices[t + 1]);
+                            indices.insert(indices.end(), buffer.m_indices.data() + buffer.m_colIndices[t], buffer.m_indices.data() + buffer.m_colIndices[t + 1]);
+                        }
+                        colIndices.push_back((int)indices.size());
+                    }
+                }
+                matrix->SetMatrixFromCSCFormat(colIndices.data(), indices.data(), values.data(), values.size(), numRows, numCols);
+            }
         }
 
         ++i;
@@ -391,25 +485,81 @@ void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<ValueBuffer<Elem
         }
 
         const auto& seq = pMBLayout->GetAllSequences();
-        if (seq.size() != 1)
-            RuntimeError("Only 1 output sequence supported by this API");
+        size_t numElements = outputMatrix->GetNumElements();
+        if (numRequests == 1)
+        {
+            if (seq.size() != 1)
+                RuntimeError("Only 1 output sequence supported by this API");
 
-        ValueContainer<ElemType>& vec = outputs[i2].m_buffer;
+            ValueContainer<ElemType>& vec = (*results[0])[i2].m_buffer;
 
-        size_t numElements = outputMatrix->GetNumElements();
+            if (vec.capacity() < numElements)
+            {
+                // Bad luck - we can't reallocate memory of an external object at this point.
+                RuntimeError("Not enough space in output buffer for output '%ls'.", node->GetName().c_str());
+            }
 
-        if (vec.capacity() < numElements)
-        {
-            // Bad luck - we can't reallocate memory of an external object at this point.
-            RuntimeError("Not enough space in output buffer for output '%ls'.", node->GetName().c_str());
+            vec.resize(numElements);
+            ElemType* data = const_cast<ElemType*>(vec.data());
+            outputMatrix->CopyToArray(data, numElements);
+            continue;
         }
 
-        vec.resize(numElements);
-        ElemType* data = const_cast<ElemType*>(vec.data());
+        // split the columns of the output into the requests, by the sequence ids assigned in SetInputLayout()
+        m_outputValues.resize(numElements);
+        ElemType* data = m_outputValues.data();
         outputMatrix->CopyToArray(data, numElements);
+        const size_t numRows = outputMatrix->GetNumRows();
+        std::vector<bool> done(numRequests, false);
+        for (const auto& sequence : seq)
+        {
+            if (sequence.seqId == GAP_SEQUENCE_ID)
+                continue;
+            if (sequence.seqId >= numRequests || done[sequence.seqId])
+                RuntimeError("Only 1 output sequence per request supported by this API");
+            done[sequence.seqId] = true;
+
+            ValueContainer<ElemType>& vec = (*results[sequence.seqId])[i2].m_buffer;
+            const auto columns = pMBLayout->GetColumnIndices(sequence);
+            if (vec.capacity() < columns.size() * numRows)
+                RuntimeError("Not enough space in output buffer for output '%ls'.", node->GetName().c_str());
+
+            vec.resize(columns.size() * numRows);
+            ElemType* target = const_cast<ElemType*>(vec.data());
+            for (size_t t = 0; t < columns.size(); ++t)
+                std::copy(m_outputValues.begin() + columns[t] * numRows, m_outputValues.begin() + (columns[t] + 1) * numRows, target + t * numRows);
+        }
+        if (std::find(done.begin(), done.end(), false) != done.end())
+            RuntimeError("Output '%ls' does not have a sequence for every request, so it cannot be evaluated in batches.", node->GetName().c_str());
     }
 }
 
+template<typename ElemType>
+template<template<typename> class ValueContainer>
+void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<ValueBuffer<ElemType, ValueContainer> >& inputs, std::vector<ValueBuffer<ElemType, ValueContainer> >& outputs, bool resetRNN)
+{
+    ForwardPassRequests<ValueContainer>({ &inputs }, { &outputs }, resetRNN);
+}
+
+template<typename ElemType>
+template<template<typename> class ValueContainer>
+void CNTKEvalExtended<ElemType>::ForwardPassBatchT(const std::vector<Buffers<ValueContainer>>& inputs, std::vector<Buffers<ValueContainer>>& outputs, bool resetRNN)
+{
+    if (inputs.empty())
+        RuntimeError("ForwardPassBatch: Expected at least one request.");
+    if (outputs.size() != inputs.size())
+        RuntimeError("ForwardPassBatch: Expected outputs for %d requests, but got %d.", (int)inputs.size(), (int)outputs.size());
+
+    std::vector<const Buffers<ValueContainer>*> requests;
+    std::vector<Buffers<ValueContainer>*> results;
+    for (size_t r = 0; r < inputs.size(); ++r)
+    {
+        requests.push_back(&inputs[r]);
+        results.push_back(&outputs[r]);
+    }
+    ForwardPassRequests<ValueContainer>(requests, results, resetRNN);
+}
+
 template<typename ElemType>
 void CNTKEvalExtended<ElemType>::ForwardPass(const Values<ElemType>& inputs, Values<ElemType>& outputs)
 {
@@ -434,6 +584,79 @@ void CNTKEvalExtended<ElemType>::ForwardPass(const ValueRefs<ElemType>& inputs,
     ForwardPassT(inputs, outputs, resetRNN);
 }
 
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::ForwardPassBatch(const std::vector<Values<ElemType>>& inputs, std::vector<Values<ElemType>>& outputs, bool resetRNN)
+{
+    ForwardPassBatchT(inputs, outputs, resetRNN);
+}
+
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::ForwardPassBatch(const std::vector<ValueRefs<ElemType>>& inputs, std::vector<ValueRefs<ElemType>>& outputs, bool resetRNN)
+{
+    ForwardPassBatchT(inputs, outputs, resetRNN);
+}
+
+// Creates a network of the same structure, whose parameters share their value matrices with those of 'net'.
+// All other nodes are duplicated, so that each network keeps its own values and MBLayouts.
+template <typename ElemType>
+static ComputationNetworkPtr CloneNetworkSharingParameters(const ComputationNetworkPtr& net)
+{
+    auto clone = make_shared<ComputationNetwork>(net->GetDeviceId());
+    map<ComputationNodeBasePtr, ComputationNodeBasePtr> clonedNodes;
+    for (const auto& node : net->GetAllNodes())
+    {
+        auto newNode = node->Duplicate(node->GetName(), CopyNodeFlags::copyNodeAll);
+        if (node->Is<IFreezable>())
+        {
+            auto parameter = dynamic_pointer_cast<ComputationNode<ElemType>>(node);
+            auto sharedParameter = dynamic_pointer_cast<ComputationNode<ElemType>>(newNode);
+            if (!parameter || !sharedParameter)
+                RuntimeError("CloneSharingParameters: %ls does not have the precision of the evaluator.", node->NodeDescription().c_str());
+            sharedParameter->ValuePtrRef() = parameter->ValuePtrRef();
+        }
+        clonedNodes[node] = clone->AddNodeToNet(newNode);
+    }
+
+    // relink the inputs to the duplicated nodes
+    for (const auto& clonedNode : clonedNodes)
+    {
+        const auto& inputs = clonedNode.first->GetInputs();
+        for (size_t i = 0; i < inputs.size(); i++)
+            clonedNode.second->SetInput(i, clonedNodes.at(inputs[i]));
+    }
+
+    for (const auto& group : { make_pair(L"feature", &net->FeatureNodes()), make_pair(L"label", &net->LabelNodes()),
+                               make_pair(L"criterion", &net->FinalCriterionNodes()), make_pair(L"evaluation", &net->EvaluationNodes()),
+                               make_pair(L"output", &net->OutputNodes()) })
+    {
+        for (const auto& node : *group.second)
+            clone->AddToNodeGroup(group.first, clonedNodes.at(node));
+    }
+
+    clone->CompileNetwork();
+    return clone;
+}
+
+template <typename ElemType>
+IEvaluateModelExtended<ElemType>* CNTKEvalExtended<ElemType>::CloneSharingParameters()
+{
+    if (this->m_net == nullptr)
+        RuntimeError("CloneSharingParameters: The network must be created first.");
+
+    auto clone = new CNTKEvalExtended<ElemType>();
+    clone->m_config = this->m_config;
+    try
+    {
+        clone->m_net = CloneNetworkSharingParameters<ElemType>(this->m_net);
+    }
+    catch (...)
+    {
+        delete clone;
+        throw;
+    }
+    return clone;
+}
+
 template <typename ElemType>
 void CNTKEvalExtended<ElemType>::Destroy()
 {
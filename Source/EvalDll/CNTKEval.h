@@ -107,6 +107,12 @@ public:
 
     virtual void ForwardPass(const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& output, bool resetRNN) override;
 
+    virtual void ForwardPassBatch(const std::vector<Values<ElemType>>& inputs, std::vector<Values<ElemType>>& outputs, bool resetRNN) override;
+
+    virtual void ForwardPassBatch(const std::vector<ValueRefs<ElemType>>& inputs, std::vector<ValueRefs<ElemType>>& outputs, bool resetRNN) override;
+
+    virtual IEvaluateModelExtended<ElemType>* CloneSharingParameters() override;
+
     virtual void Destroy() override;
 
     virtual void CreateNetwork(const std::string& networkDescription) override
@@ -127,9 +133,31 @@ private:
     StreamMinibatchInputs m_inputMatrices;
     bool m_started;
 
+    // kept across calls, so that requests of the same shapes do not rebuild or reallocate them
+    std::map<const MBLayout*, std::pair<std::vector<size_t>, bool>> m_inputLayouts; // MBLayout -> sequence lengths and resetRNN it was built for
+    std::vector<std::vector<ElemType>> m_packedValues;                              // [input] batched dense values, or non-zero values if sparse
+    std::vector<std::vector<int>> m_packedIndices;                                  // [input] batched row indices if sparse
+    std::vector<std::vector<int>> m_packedColIndices;                               // [input] batched column offsets if sparse
+    std::vector<ElemType> m_outputValues;                                           // output matrix, before it is split into the requests
+
+    template<template<typename> class ValueContainer>
+    using Buffers = std::vector<ValueBuffer<ElemType, ValueContainer>>;
+
     template<template<typename> class ValueContainer> 
     void ForwardPassT(const std::vector < ValueBuffer<ElemType, ValueContainer> >& inputs,
                       std::vector < ValueBuffer<ElemType, ValueContainer> >& outputs, bool resetRNN);
 
+    template<template<typename> class ValueContainer>
+    void ForwardPassBatchT(const std::vector<Buffers<ValueContainer>>& inputs, std::vector<Buffers<ValueContainer>>& outputs, bool resetRNN);
+
+    template<template<typename> class ValueContainer>
+    void ForwardPassRequests(const std::vector<const Buffers<ValueContainer>*>& requests, const std::vector<Buffers<ValueContainer>*>& results, bool resetRNN);
+
+    template<template<typename> class ValueContainer>
+    static size_t GetNumSamples(const ComputationNodeBasePtr& inputNode, const ValueBuffer<ElemType, ValueContainer>& buffer, MatrixType type, size_t numRows);
+
+    void SetInputLayout(const ComputationNodeBasePtr& inputNode, const std::vector<size_t>& lengths, bool resetRNN,
+                        std::map<const MBLayout*, std::vector<size_t>>& layoutsOfThisPass);
+
 };
 } } }
@@ -7,6 +7,7 @@
 
 #include "halide_binary_convolve.h"
 #include "CNTKLibrary.h"
+#include <memory>
 
 using namespace CNTK;
 
@@ -111,21 +112,48 @@ public:
         filters = Attr[filters_key].Value<int>(); 
         out_h = convolutional_out_size(h, size, stride, pad);
         out_w = convolutional_out_size(w, size, stride, pad);
-        const NDArrayViewPtr& weight_array = leftOperand.GetValue();
+        schedule = ParseBinaryConvolveSchedule(Attr.Contains(schedule_key) ? Attr[schedule_key].Value<std::wstring>() : L"auto");
+        NDArrayViewPtr weight_array = leftOperand.GetValue();
+        // the weights are binarized on the host, whichever device they live on
+        if (weight_array->Device().Type() != DeviceKind::CPU)
+            weight_array = weight_array->DeepClone(DeviceDescriptor::CPUDevice());
         weight_data = weight_array->DataBuffer<float>();
         binary_weights = (int64_t *) malloc(((size*size*channels)/64)*filters*sizeof(int64_t));
         pad_mask = (int64_t *) malloc((size*size*channels/64)*out_h*out_w*sizeof(int64_t));
         binarize_array(weight_data, size*size*channels*filters, binary_weights);
-        Executor = new HalideBinaryConvolve(binary_weights, pad_mask, w, h, channels, filters, size, stride, pad);
     } 
 
 private:
+    // compiles the schedule for the device on first use: the given one on the CPU, and the CUDA one on a GPU
+    HalideBinaryConvolve& Executor(const DeviceDescriptor& computeDevice)
+    {
+        bool gpu = (computeDevice.Type() == DeviceKind::GPU);
+        auto& executor = gpu ? GpuExecutor : CpuExecutor;
+        if (!executor)
+            executor.reset(new HalideBinaryConvolve(binary_weights, pad_mask, w, h, channels, filters, size, stride, pad,
+                                                    gpu ? BinaryConvolveSchedule::Gpu : schedule));
+        return *executor;
+    }
+
     // simple convolve function that pulls out raw data buffers and passes them into our halide function
-    void Convolve(const NDArrayViewPtr& input, NDArrayViewPtr& output)
+    void Convolve(const NDArrayViewPtr& input, NDArrayViewPtr& output, const DeviceDescriptor& computeDevice)
     {
-        auto inputBuffer = input->DataBuffer<float>();
-        auto outBuffer = output->WritableDataBuffer<float>();
-        Executor->realize(inputBuffer, outBuffer);
+        auto& executor = Executor(computeDevice);
+        if (computeDevice.Type() == DeviceKind::CPU)
+        {
+            executor.realize(input->DataBuffer<float>(), output->WritableDataBuffer<float>());
+            return;
+        }
+
+        // Halide moves the data between its host buffers and the GPU, so the values go through host staging buffers
+        if (!HostInput)
+        {
+            HostInput = MakeSharedObject<NDArrayView>(DataType::Float, input->Shape(), DeviceDescriptor::CPUDevice());
+            HostOutput = MakeSharedObject<NDArrayView>(DataType::Float, output->Shape(), DeviceDescriptor::CPUDevice());
+        }
+        HostInput->CopyFrom(*input);
+        executor.realize(HostInput->DataBuffer<float>(), HostOutput->WritableDataBuffer<float>());
+        output->CopyFrom(*HostOutput);
     }
 
     // forward function definition, needs to parse the data and call into the Convolve function
@@ -151,7 +179,7 @@ private:
         // extract the output data
         auto outputData = outputValue->Data();
         // pass everything to Halide to compute the result, outputs are directly stored in the outputData buffer
-        Convolve(rightOperandData, outputData);
+        Convolve(rightOperandData, outputData, computeDevice);
 
         // Let's save the right input's Value in the BackPropSate to be used in the backward pass for computing gradients
         return MakeSharedObject<BackPropState>(this->shared_from_this(), computeDevice, std::unordered_map<Variable, ValuePtr>({ {Inputs()[1], inputValues[1] } }));
@@ -183,6 +211,7 @@ private:
     const wchar_t* h_key = L"h";
     const wchar_t* channels_key = L"channels";
     const wchar_t* filters_key = L"filters";
+    const wchar_t* schedule_key = L"schedule"; // optional: auto, serial, parallel or gpu (see BinaryConvolveSchedule)
     bool pad;
     int stride;
     int size;
@@ -195,7 +224,11 @@ private:
     int64_t *binary_weights;
     int64_t *pad_mask;
     const float *weight_data;
-    HalideBinaryConvolve *Executor;
+    BinaryConvolveSchedule schedule;
+    std::unique_ptr<HalideBinaryConvolve> CpuExecutor;
+    std::unique_ptr<HalideBinaryConvolve> GpuExecutor;
+    NDArrayViewPtr HostInput;
+    NDArrayViewPtr HostOutput;
 
     // Compute the dimensions of the output variable and return the proper shape and dynamic axes
     void InferOutputs(std::vector<Variable>& outputs) override
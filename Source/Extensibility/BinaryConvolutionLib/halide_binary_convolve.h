@@ -2,9 +2,30 @@
 #define HALIDE_BINARY_CONVOLVE
 
 #include "Halide.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <thread>
 
 using namespace Halide;
 
+// The schedules of the binary convolution. The pipeline is JIT compiled for the host target, so that the vector
+// width follows the instruction set found at runtime (e.g. AVX2, AVX-512 or NEON).
+enum class BinaryConvolveSchedule {
+    Auto,     // Parallel, unless the convolution is too small to split across cores
+    Serial,   // vectorized on the calling thread
+    Parallel, // vectorized, with the output pixels and filters split into tasks for all cores
+    Gpu,      // CUDA, with the buffers copied to and from the device by Halide
+};
+
+inline BinaryConvolveSchedule ParseBinaryConvolveSchedule(const std::wstring& name) {
+    if (name == L"" || name == L"auto") return BinaryConvolveSchedule::Auto;
+    if (name == L"serial") return BinaryConvolveSchedule::Serial;
+    if (name == L"parallel") return BinaryConvolveSchedule::Parallel;
+    if (name == L"gpu") return BinaryConvolveSchedule::Gpu;
+    throw std::invalid_argument("Binary Convolution schedule must be auto, serial, parallel or gpu");
+}
+
 class HalideBinaryConvolve {
     Buffer<float> input;
     Func output;
@@ -21,8 +42,9 @@ class HalideBinaryConvolve {
     int out_x;
     int out_y;
     int bin_width;
+    bool gpu;
 public:
-    HalideBinaryConvolve(int64_t *W_in, int64_t *pad_mask, int w, int h, int channels, int filters, int size, int stride, bool pad, bool gpu = false) :
+    HalideBinaryConvolve(int64_t *W_in, int64_t *pad_mask, int w, int h, int channels, int filters, int size, int stride, bool pad, BinaryConvolveSchedule schedule = BinaryConvolveSchedule::Auto) :
     input(Buffer<float>(w,h,channels)),
     weights(Buffer<int64_t>(W_in, (size*size*channels - 1)/64 + 1, filters)),
     pad_mask_buf(Buffer<int64_t>(pad_mask, (size*size*channels - 1)/64 + 1, (!pad ? (w - size) / stride + 1 : (w - 1)/stride + 1)*(!pad ? (h - size) / stride + 1 : (h - 1)/stride + 1))),
@@ -36,6 +58,7 @@ public:
     out_x(!pad ? (w - size) / stride + 1 : (w - 1)/stride + 1),
     out_y(!pad ? (h - size) / stride + 1 : (h - 1)/stride + 1),
     bin_width((size*size*channels - 1)/64 + 1),
+    gpu(schedule == BinaryConvolveSchedule::Gpu),
     t(get_host_target())
     {
         Var x("x"), y("y"), c("c"), f("f"), k("k");
@@ -68,28 +91,45 @@ public:
         xnor(k, x, y) = (popcount(bit_mask(k, x) & (binarize_weights(k, y) ^ binarize_input(k, x))));
 
         output(x, y) = -((2 * cast<float>(sum(xnor(bw.x, x, y), "accumulate"))) - (64*bin_width) + mask_count(x));
-        if (!gpu) {
-            //output.reorder(y, x);
-            //output.vectorize(y, 8);
-            //output.parallel(x, 8);
-            //binarize_input.compute_at(output, x);
-            //bit_mask.compute_at(output, x);
+
+        int vector_size = t.natural_vector_size<float>();
+        int num_threads = std::max(1u, std::thread::hardware_concurrency());
+        if (schedule == BinaryConvolveSchedule::Auto) {
+            // below a few vectors of work per core the tasks cost more than they save
+            bool small = (int64_t)out_x * out_y * filters < (int64_t)num_threads * vector_size * 64;
+            schedule = small ? BinaryConvolveSchedule::Serial : BinaryConvolveSchedule::Parallel;
+        }
+
+        Var xo("xo"), xi("xi"), yo("yo"), yi("yi"), tile("tile");
+        if (schedule == BinaryConvolveSchedule::Gpu) {
+            t = t.with_feature(Target::CUDA);
+            output.compute_root();
+            output.gpu_tile(x, y, xo, yo, xi, yi, 32, 8);
+            binarize_input.compute_root();
+            binarize_input.gpu_tile(y, yo, yi, 128);
+        } else if (schedule == BinaryConvolveSchedule::Parallel) {
+            // about four tasks per core, so that cores that finish early pick up the remainder
+            int pixels_per_task = std::max(vector_size, (out_x*out_y*filters) / (4*num_threads*vector_size) * vector_size);
+            pixels_per_task = std::min(pixels_per_task, std::max(vector_size, out_x*out_y));
+            output.compute_root();
+            output.split(x, xo, xi, pixels_per_task).vectorize(xi, vector_size).fuse(xo, y, tile).parallel(tile);
+            int rows_per_task = std::max(1, (out_x*out_y) / (4*num_threads));
+            binarize_input.store_root().compute_root();
+            binarize_input.parallel(y, rows_per_task);
+        } else {
             output.compute_root();
-            output.parallel(y, 8);
-            output.vectorize(x, 8);
+            output.vectorize(x, vector_size);
             binarize_input.store_root().compute_root();
-            binarize_input.vectorize(x, 8);
-            binarize_input.parallel(y, 8);
-            //bit_mask.compute_root();
-            //t.set_feature(Target::Profile);
-        } 
+        }
         output.compile_jit(t);
     }
 
     void realize(const float *in_array, float *out_array) {
         Buffer<float> outbuf = Buffer<float>(out_array, out_x*out_y, filters);
         std::memcpy(input.get()->data(), in_array, w*h*channels*sizeof(float));
+        if (gpu) input.set_host_dirty();
         output.realize(outbuf);
+        if (gpu) outbuf.copy_to_host();
     }
 };
 
@@ -182,6 +182,9 @@ public:
         {
             pin_ptr <IEvaluateModelExtended<ElemType>*> p_eval = &m_eval;
             GetEvalExtended<ElemType>(p_eval);
+            m_inputRefs = new Native::ValueRefs<ElemType>();
+            m_outputRefs = new Native::ValueRefs<ElemType>();
+            m_pinnedGCHandleList = gcnew List<GCHandle>;
         }
         catch (const exception& ex)
         {
@@ -275,6 +278,9 @@ public:
     // inputs - vector of input buffers, one for every input as given by GetInputLayouts()
     // outputs - map from node name to output vector, outputs vectors need to be preallocated by caller
     // Called after StartForwardEvaluation()
+    // The buffers are pinned for the duration of the call and handed to the native code without copying. The results
+    // are written directly into the Buffer of each output, which can be reused across calls: all of its Length is
+    // available, and Size is set to the number of elements written.
     //
     void ForwardPass(cli::array<ValueBuffer<ElemType>^>^ inputs, cli::array<ValueBuffer<ElemType>^>^ outputs)
     {
@@ -292,18 +298,18 @@ public:
             throw gcnew ObjectDisposedException("Object has been disposed.");
         }
 
-        // Hold all buffers that should be pinned during native operations
-        List<GCHandle>^ pinnedGCHandleList = gcnew List<GCHandle>;
+        // The ValueRefs and the list of pinned buffers are kept across calls, so that a call does not allocate.
+        Native::ValueRefs<ElemType>& stdInputs = *m_inputRefs;
+        Native::ValueRefs<ElemType>& stdOutputs = *m_outputRefs;
+        stdInputs.clear();
+        stdOutputs.clear();
 
         try
         {
-            Native::ValueRefs<ElemType> stdInputs;
-            Native::ValueRefs<ElemType> stdOutputs;
-
             // Map the managed space into the native space, results will be written directly into the managed memory space
             // https://msdn.microsoft.com/en-us/library/1dz8byfh.aspx
-            TransferVectorsToValueBuffers(inputs, stdInputs, pinnedGCHandleList, StorageType::Sparse);
-            TransferVectorsToValueBuffers(outputs, stdOutputs, pinnedGCHandleList, StorageType::Dense);
+            TransferVectorsToValueBuffers(inputs, stdInputs, m_pinnedGCHandleList, false);
+            TransferVectorsToValueBuffers(outputs, stdOutputs, m_pinnedGCHandleList, true);
 
             try
             {
@@ -326,10 +332,11 @@ public:
         }
         finally
         {
-            for each (auto h in pinnedGCHandleList)
+            for each (auto h in m_pinnedGCHandleList)
             {
                 h.Free();
             }
+            m_pinnedGCHandleList->Clear();
         }
     }
 
@@ -351,12 +358,24 @@ protected:
             m_eval->Destroy();
             m_eval = nullptr;
         }
+
+        delete m_inputRefs;
+        m_inputRefs = nullptr;
+        delete m_outputRefs;
+        m_outputRefs = nullptr;
     }
 
 private:
     // Native model evaluation instance
     IEvaluateModelExtended<ElemType> *m_eval;
 
+    // Native views of the managed buffers of the current ForwardPass()
+    Native::ValueRefs<ElemType> *m_inputRefs;
+    Native::ValueRefs<ElemType> *m_outputRefs;
+
+    // Buffers pinned during the native operations of the current ForwardPass()
+    List<GCHandle>^ m_pinnedGCHandleList;
+
     /// <summary> Throws a CLR exception based on a native exception</summary>
     /// <param name="ex">The native exception to throw as a CLR exception</param>
     /// <returns>A CLR exception</returns>
@@ -438,38 +457,29 @@ private:
         }
     }
 
-    void PinBuffer(cli::array<ElemType>^ itemBuffer, List<GCHandle>^ pinnedGCHandleList, Native::ValueBuffer<ElemType, Native::VectorRef>* vb, StorageType storageType, int bufferSize)
+    // Pins 'itemBuffer' and returns its address; all of the array is available to the native code.
+    template<typename T>
+    T* Pin(cli::array<T>^ itemBuffer, List<GCHandle>^ pinnedGCHandleList, int size)
     {
-        GCHandle h = GCHandle::Alloc(itemBuffer, GCHandleType::Pinned);
-        pinnedGCHandleList->Add(h);
-        ElemType* pp = reinterpret_cast<ElemType *>(h.AddrOfPinnedObject().ToPointer());
-        vb->m_buffer.InitFrom(pp, bufferSize, storageType == StorageType::Sparse ? bufferSize : 0);
-    }
-
-    void PinIndices(cli::array<int>^ itemBuffer, List<GCHandle>^ pinnedGCHandleList, Native::ValueBuffer<ElemType, Native::VectorRef>* vb, StorageType storageType, int bufferSize)
-    {
-        GCHandle h = GCHandle::Alloc(itemBuffer, GCHandleType::Pinned);
-        pinnedGCHandleList->Add(h);
-        int* pp = reinterpret_cast<int *>(h.AddrOfPinnedObject().ToPointer());
-        vb->m_indices.InitFrom(pp, bufferSize, storageType == StorageType::Sparse ? bufferSize : 0);
-    }
+        if (size < 0 || size > itemBuffer->Length)
+        {
+            throw gcnew CNTKRuntimeException(String::Format("Invalid size {0} for a buffer of length {1} in ForwardPass", size, itemBuffer->Length), String::Empty);
+        }
 
-    void PinColIndices(cli::array<int>^ itemBuffer, List<GCHandle>^ pinnedGCHandleList, Native::ValueBuffer<ElemType, Native::VectorRef>* vb, StorageType storageType, int bufferSize)
-    {
         GCHandle h = GCHandle::Alloc(itemBuffer, GCHandleType::Pinned);
         pinnedGCHandleList->Add(h);
-        int* pp = reinterpret_cast<int *>(h.AddrOfPinnedObject().ToPointer());
-        vb->m_colIndices.InitFrom(pp, bufferSize, storageType == StorageType::Sparse ? bufferSize : 0);
+        return reinterpret_cast<T *>(h.AddrOfPinnedObject().ToPointer());
     }
 
-    void TransferVectorsToValueBuffers(cli::array<ValueBuffer<ElemType>^>^ list, Native::ValueRefs<ElemType>& valueRefs, List<GCHandle>^ pinnedGCHandleList, StorageType storageType)
+    // Inputs are passed with their used sizes; outputs are empty, with the length of the managed arrays as capacity.
+    void TransferVectorsToValueBuffers(cli::array<ValueBuffer<ElemType>^>^ list, Native::ValueRefs<ElemType>& valueRefs, List<GCHandle>^ pinnedGCHandleList, bool isOutput)
     {
         for each (auto item in list)
         {
             Native::ValueBuffer<ElemType, Native::VectorRef> vb;
 
             int numElements = item->Size;
-            int bufferSize = item->ColIndices != nullptr ? item->ColIndices[item->Size - 1] : item->Size;
+            int bufferSize = item->ColIndices != nullptr && item->Size > 0 ? item->ColIndices[item->Size - 1] : item->Size;
 
             // Buffer is required
             if (item->Buffer == nullptr)
@@ -477,16 +487,19 @@ private:
                 throw gcnew CNTKRuntimeException("Invalid buffer (empty) for argument into ForwardPass", String::Empty);
             }
 
-            PinBuffer(item->Buffer, pinnedGCHandleList, &vb, storageType, bufferSize);
+            ElemType* buffer = Pin(item->Buffer, pinnedGCHandleList, isOutput ? 0 : bufferSize);
+            vb.m_buffer.InitFrom(buffer, item->Buffer->Length, isOutput ? 0 : bufferSize);
 
             if (item->Indices != nullptr)
             {
-                PinIndices(item->Indices, pinnedGCHandleList, &vb, storageType, bufferSize);
+                int* indices = Pin(item->Indices, pinnedGCHandleList, isOutput ? 0 : bufferSize);
+                vb.m_indices.InitFrom(indices, item->Indices->Length, isOutput ? 0 : bufferSize);
             }
 
             if (item->ColIndices != nullptr)
             {
-                PinColIndices(item->ColIndices, pinnedGCHandleList, &vb, storageType, numElements);
+                int* colIndices = Pin(item->ColIndices, pinnedGCHandleList, isOutput ? 0 : numElements);
+                vb.m_colIndices.InitFrom(colIndices, item->ColIndices->Length, isOutput ? 0 : numElements);
             }
 
             valueRefs.push_back(vb);
@@ -65,12 +65,16 @@ void BatchNormEngine<InoutType, StatType>::Forward(const InoutMat& in, const Sta
 
 template <class InoutType, class StatType>
 void BatchNormEngine<InoutType, StatType>::Backward(const InoutMat& in, const InoutMat& srcGrad, InoutMat& grad, const StatMat& scale, double blendFactor,
-                                         const StatMat& savedMean, const StatMat& savedInvStdDev, StatMat& scaleGrad, StatMat& biasGrad, bool accumulateDataGrad)
+                                         const StatMat& savedMean, const StatMat& savedInvStdDev, StatMat& scaleGrad, StatMat& biasGrad, bool accumulateDataGrad,
+                                         const StatMat* bias, const InoutMat* out)
 {
     assert(!savedMean.IsEmpty());
     assert(!savedInvStdDev.IsEmpty());
+    if (m_reluOutput && (!bias || !out))
+        LogicError("Backward of batch normalization with a fused ReLU requires the bias and the output.");
     EnsureCompatible();
-    BackwardCore(in, srcGrad, grad, scale, blendFactor, savedMean, savedInvStdDev, scaleGrad, biasGrad, accumulateDataGrad);
+    BackwardCore(in, srcGrad, grad, scale, blendFactor, savedMean, savedInvStdDev, scaleGrad, biasGrad, accumulateDataGrad,
+                 m_reluOutput ? bias : nullptr, m_reluOutput ? out : nullptr);
 }
 
 template <class InoutType, class StatType>
@@ -83,8 +87,8 @@ public:
 
 public:
     CntkBatchNormEngine(DEVICEID_TYPE deviceId, const TensorShape& inOutT,
-        bool spatial, ImageLayoutKind imageLayout)
-        : Base(deviceId, inOutT, spatial, imageLayout)
+        bool spatial, ImageLayoutKind imageLayout, bool reluOutput)
+        : Base(deviceId, inOutT, spatial, imageLayout, reluOutput)
     {
     }
 
@@ -93,6 +97,7 @@ protected:
     using Base::m_imageLayout;
     using Base::m_inOutT;
     using Base::m_spatial;
+    using Base::m_reluOutput;
 
     void EnsureCompatible() override
     {
@@ -105,27 +110,27 @@ protected:
     {
 #ifdef USE_MKL2017DNN
         if (in.GetCurrentMatrixLocation() == CPU &&
-            std::is_same<InoutType, StatType>::value &&
+            std::is_same<InoutType, StatType>::value && !m_reluOutput &&
             ForwardCoreMKL(*(const StatMat*)&in, scale, bias, inferenceOnly, expAvgFactor, runMean, runVariance, *(StatMat*)&out, epsilon, savedMean, savedInvStdDev))
             return;
 #endif
 
-        in.BatchNormalizationForward(scale, bias, inferenceOnly, expAvgFactor, blendFactor, runMean, runVariance, out, epsilon, savedMean, savedInvStdDev);
+        in.BatchNormalizationForward(scale, bias, inferenceOnly, expAvgFactor, blendFactor, runMean, runVariance, out, epsilon, savedMean, savedInvStdDev, m_reluOutput);
     }
 
     void BackwardCore(const InoutMat& in, const InoutMat& srcGrad, InoutMat& grad, const StatMat& scale, double blendFactor, const StatMat& savedMean, const StatMat& savedInvStdDev,
-                      StatMat& scaleGrad, StatMat& biasGrad, bool accumulateDataGrad) override
+                      StatMat& scaleGrad, StatMat& biasGrad, bool accumulateDataGrad, const StatMat* /*bias*/, const InoutMat* out) override
     {
 #ifdef USE_MKL2017DNN
         if (srcGrad.GetCurrentMatrixLocation() == CPU &&
-            std::is_same<InoutType, StatType>::value &&
+            std::is_same<InoutType, StatType>::value && !out &&
             BackwardCoreMKL(*(const StatMat*)&in, *(const StatMat*)&srcGrad, *(StatMat*)&grad, scale, savedMean, savedInvStdDev, scaleGrad, biasGrad, accumulateDataGrad))
             return;
 #endif
         if (!accumulateDataGrad)
             grad.SetValue((InoutType)0);
 
-        srcGrad.BatchNormalizationBackward(in, grad, scale, blendFactor, savedMean, savedInvStdDev, scaleGrad, biasGrad);
+        srcGrad.BatchNormalizationBackward(in, grad, scale, blendFactor, savedMean, savedInvStdDev, scaleGrad, biasGrad, out);
     }
 
 private:
@@ -445,6 +450,7 @@ private:
 template class CntkBatchNormEngine<float, float>;
 template class CntkBatchNormEngine<double, double>;
 template class CntkBatchNormEngine<half, float>;
+template class CntkBatchNormEngine<bfloat16, float>;
 
 template <typename T> bool HasFlag(T src, T testFlag)
 {
@@ -454,7 +460,7 @@ template <typename T> bool HasFlag(T src, T testFlag)
 template <class InoutType, class StatType>
 std::unique_ptr<BatchNormEngine<InoutType, StatType>> BatchNormEngine<InoutType, StatType>::Create(DEVICEID_TYPE deviceId, const TensorShape& inOutT,
                                                                              bool spatial, ImageLayoutKind imageLayout,
-                                                                             BatchNormEngineKind enabledEngines)
+                                                                             BatchNormEngineKind enabledEngines, bool reluOutput)
 {
     // Use CNTK as default batch norm engine.
     if (HasFlag(enabledEngines, BatchNormEngineKind::Cntk))
@@ -462,7 +468,7 @@ std::unique_ptr<BatchNormEngine<InoutType, StatType>> BatchNormEngine<InoutType,
         if (GetMathLibTraceLevel() > 0)
             fprintf(stderr, "Using CNTK batch normalization engine.\n");
 
-        return std::make_unique<CntkBatchNormEngine<InoutType, StatType>>(deviceId, inOutT, spatial, imageLayout);
+        return std::make_unique<CntkBatchNormEngine<InoutType, StatType>>(deviceId, inOutT, spatial, imageLayout, reluOutput);
     }
 
     if (HasFlag(enabledEngines, BatchNormEngineKind::CuDnn))
@@ -470,7 +476,7 @@ std::unique_ptr<BatchNormEngine<InoutType, StatType>> BatchNormEngine<InoutType,
         if (GetMathLibTraceLevel() > 0)
             fprintf(stderr, "Using cuDNN batch normalization engine.\n");
 
-        return CuDnnBatchNormEngineFactory<InoutType, StatType>::Create(deviceId, inOutT, spatial, imageLayout);
+        return CuDnnBatchNormEngineFactory<InoutType, StatType>::Create(deviceId, inOutT, spatial, imageLayout, reluOutput);
     }
 
     RuntimeError("Could not find appropriate batch normalization engine.");
@@ -479,5 +485,6 @@ std::unique_ptr<BatchNormEngine<InoutType, StatType>> BatchNormEngine<InoutType,
 template class BatchNormEngine<float, float>;
 template class BatchNormEngine<double, double>;
 template class BatchNormEngine<half, float>;
+template class BatchNormEngine<bfloat16, float>;
 
 }}}
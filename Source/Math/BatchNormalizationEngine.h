@@ -12,6 +12,9 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
 //-------------------------------------------------------------
 // Batch normalization engine interface.
+// An engine created with reluOutput outputs max(0, BN(in)): the ReLU that usually follows batch normalization
+// is fused into it, which saves a pass over the output in both directions. Its Backward then also needs
+// the bias and that output.
 //-------------------------------------------------------------
 enum class BatchNormEngineKind
 {
@@ -39,18 +42,21 @@ public:
                  InoutMat& out, double epsilon, StatMat& saveMean, StatMat& saveInvStdDev);
 
     void Backward(const InoutMat& in, const InoutMat& srcGrad, InoutMat& grad, const StatMat& scale, double blendFactor, const StatMat& saveMean, const StatMat& saveInvStdDev,
-                  StatMat& scaleGrad, StatMat& biasGrad, bool accumulateDataGrad);
+                  StatMat& scaleGrad, StatMat& biasGrad, bool accumulateDataGrad, const StatMat* bias = nullptr, const InoutMat* out = nullptr);
+
+    bool ReluOutput() const { return m_reluOutput; }
 
     static std::unique_ptr<BatchNormEngine<InoutType, StatType>> Create(DEVICEID_TYPE deviceId, const TensorShape& inOutT,
                                                              bool spatial, ImageLayoutKind imageLayout,
-                                                             BatchNormEngineKind enabledEngines = BatchNormEngineKind::All);
+                                                             BatchNormEngineKind enabledEngines = BatchNormEngineKind::All,
+                                                             bool reluOutput = false);
 
     DISABLE_COPY_AND_MOVE(BatchNormEngine);
 
 protected:
     BatchNormEngine(DEVICEID_TYPE deviceId, const TensorShape& inOutT,
-                    bool spatial, ImageLayoutKind imageLayout)
-                    : m_deviceId(deviceId), m_inOutT(inOutT), m_spatial(spatial), m_imageLayout(imageLayout)
+                    bool spatial, ImageLayoutKind imageLayout, bool reluOutput)
+                    : m_deviceId(deviceId), m_inOutT(inOutT), m_spatial(spatial), m_imageLayout(imageLayout), m_reluOutput(reluOutput)
     {
     }
 
@@ -60,14 +66,16 @@ protected:
     virtual void ForwardCore(const InoutMat& in, const StatMat& scale, const StatMat& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, StatMat& runMean, StatMat& runVariance,
                  InoutMat& out, double epsilon, StatMat& saveMean, StatMat& saveInvStdDev) = 0;
 
+    // bias and out are only given with m_reluOutput
     virtual void BackwardCore(const InoutMat& in, const InoutMat& srcGrad, InoutMat& grad, const StatMat& scale, double blendFactor, const StatMat& saveMean, const StatMat& saveInvStdDev,
-                  StatMat& scaleGrad, StatMat& biasGrad, bool accumulateDataGrad) = 0;
+                  StatMat& scaleGrad, StatMat& biasGrad, bool accumulateDataGrad, const StatMat* bias, const InoutMat* out) = 0;
 
 protected:
     DEVICEID_TYPE m_deviceId;
     TensorShape m_inOutT;
     bool m_spatial;
     ImageLayoutKind m_imageLayout;
+    bool m_reluOutput;
 };
 
 #pragma warning(pop)
@@ -0,0 +1,181 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// The kernels behind block pruning and BlockSparseMultiplier (BlockSparseOperations.h).
+//
+
+#include "stdafx.h"
+#include "BlockSparseOperations.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+template <class ElemType>
+static size_t BlockPruningMaskImpl(size_t m, size_t k, const ElemType* a, size_t blockRows, size_t blockCols, double sparsity, ElemType* mask)
+{
+    if (blockRows == 0 || blockCols == 0)
+        InvalidArgument("BlockPruningMask: The block size %d x %d is invalid.", (int)blockRows, (int)blockCols);
+    if (sparsity < 0 || sparsity > 1)
+        InvalidArgument("BlockPruningMask: The sparsity %f is not in [0, 1].", sparsity);
+
+    const size_t numBlockRows = (m + blockRows - 1) / blockRows;
+    const size_t numBlockCols = (k + blockCols - 1) / blockCols;
+    std::vector<double> norms(numBlockRows * numBlockCols, 0);
+    for (size_t j = 0; j < k; j++)
+        for (size_t i = 0; i < m; i++)
+            norms[i / blockRows + (j / blockCols) * numBlockRows] += std::abs((double)a[i + j * m]);
+
+    // the blocks with norms at most the threshold are masked, those equal to it only as far as needed
+    const size_t numMasked = std::min(norms.size(), (size_t)std::floor(sparsity * norms.size() + 0.5));
+    double threshold = -1;
+    size_t numAtThreshold = 0;
+    if (numMasked > 0)
+    {
+        std::vector<double> sorted(norms);
+        std::nth_element(sorted.begin(), sorted.begin() + (numMasked - 1), sorted.end());
+        threshold = sorted[numMasked - 1];
+        numAtThreshold = numMasked - std::count_if(sorted.begin(), sorted.begin() + (numMasked - 1), [threshold](double v) { return v < threshold; });
+    }
+
+    std::vector<bool> masked(norms.size(), false);
+    for (size_t b = 0; b < norms.size(); b++)
+    {
+        if (norms[b] < threshold || (norms[b] == threshold && numAtThreshold > 0))
+        {
+            if (norms[b] == threshold)
+                numAtThreshold--;
+            masked[b] = true;
+        }
+    }
+
+    for (size_t j = 0; j < k; j++)
+        for (size_t i = 0; i < m; i++)
+            mask[i + j * m] = masked[i / blockRows + (j / blockCols) * numBlockRows] ? 0 : 1;
+    return numMasked;
+}
+
+size_t BlockPruningMask(size_t m, size_t k, const float* a, size_t blockRows, size_t blockCols, double sparsity, float* mask)
+{
+    return BlockPruningMaskImpl(m, k, a, blockRows, blockCols, sparsity, mask);
+}
+
+size_t BlockPruningMask(size_t m, size_t k, const double* a, size_t blockRows, size_t blockCols, double sparsity, double* mask)
+{
+    return BlockPruningMaskImpl(m, k, a, blockRows, blockCols, sparsity, mask);
+}
+
+template <class ElemType>
+void BlockSparseMatrix<ElemType>::Assign(size_t m, size_t k, const ElemType* a, size_t blockRows, size_t blockCols)
+{
+    if (blockRows == 0 || blockCols == 0)
+        InvalidArgument("BlockSparseMatrix: The block size %d x %d is invalid.", (int)blockRows, (int)blockCols);
+
+    m_m = m;
+    m_k = k;
+    m_blockRows = blockRows;
+    m_blockCols = blockCols;
+    m_rowStarts.assign(1, 0);
+    m_blockColumn.clear();
+    m_values.clear();
+
+    const size_t blockSize = blockRows * blockCols;
+    for (size_t i0 = 0; i0 < m; i0 += blockRows)
+    {
+        const size_t rows = std::min(blockRows, m - i0);
+        for (size_t j0 = 0; j0 < k; j0 += blockCols)
+        {
+            const size_t cols = std::min(blockCols, k - j0);
+            bool isZero = true;
+            for (size_t c = 0; c < cols && isZero; c++)
+                for (size_t r = 0; r < rows && isZero; r++)
+                    isZero = a[(i0 + r) + (j0 + c) * m] == 0;
+            if (isZero)
+                continue;
+
+            m_blockColumn.push_back(j0 / blockCols);
+            m_values.resize(m_values.size() + blockSize, 0);
+            ElemType* block = m_values.data() + m_values.size() - blockSize;
+            for (size_t c = 0; c < cols; c++)
+                for (size_t r = 0; r < rows; r++)
+                    block[r + c * blockRows] = a[(i0 + r) + (j0 + c) * m];
+        }
+        m_rowStarts.push_back(m_blockColumn.size());
+    }
+}
+
+// The columns [j0, j1) of the rows of block row 'blockRow' of c. The block height is a compile-time constant so that
+// the compiler keeps the sums in registers and vectorizes over the rows of a block; BlockRows == 0 is any height.
+template <class ElemType>
+template <size_t BlockRows>
+void BlockSparseMatrix<ElemType>::MultiplyBlockRow(size_t blockRow, size_t j0, size_t j1, const ElemType* b, ElemType* c, size_t ldc) const
+{
+    const size_t blockRows = BlockRows ? BlockRows : m_blockRows;
+    const size_t i0 = blockRow * blockRows;
+    const size_t rows = std::min(blockRows, m_m - i0);
+    const size_t blockSize = blockRows * m_blockCols;
+
+    ElemType sums[BlockRows ? BlockRows : 1];
+    std::vector<ElemType> anySums(BlockRows ? 0 : blockRows);
+    ElemType* sum = BlockRows ? sums : anySums.data();
+
+    for (size_t j = j0; j < j1; j++)
+    {
+        const ElemType* bj = b + j * m_k;
+        for (size_t r = 0; r < blockRows; r++)
+            sum[r] = 0;
+
+        for (size_t p = m_rowStarts[blockRow]; p < m_rowStarts[blockRow + 1]; p++)
+        {
+            const size_t col0 = m_blockColumn[p] * m_blockCols;
+            const size_t cols = std::min(m_blockCols, m_k - col0);
+            const ElemType* block = m_values.data() + p * blockSize;
+            for (size_t col = 0; col < cols; col++)
+            {
+                const ElemType x = bj[col0 + col];
+                const ElemType* v = block + col * blockRows;
+                for (size_t r = 0; r < blockRows; r++)
+                    sum[r] += v[r] * x;
+            }
+        }
+
+        ElemType* cj = c + j * ldc + i0;
+        for (size_t r = 0; r < rows; r++)
+            cj[r] = sum[r];
+    }
+}
+
+template <class ElemType>
+void BlockSparseMatrix<ElemType>::Multiply(size_t n, const ElemType* b, ElemType* c, size_t ldc) const
+{
+    if (m_rowStarts.size() < 2)
+        return;
+
+    // tiles of block rows by columns of b, so that the columns of b stay in the cache while the blocks are applied to them
+    const size_t numBlockRows = m_rowStarts.size() - 1;
+    const size_t tileN = 16;
+    const size_t numTilesN = (n + tileN - 1) / tileN;
+    const long long numTiles = (long long)(numBlockRows * numTilesN);
+
+#pragma omp parallel for schedule(dynamic) if (numTiles > 1 && m_values.size() * n > 65536)
+    for (long long t = 0; t < numTiles; t++)
+    {
+        const size_t blockRow = t % numBlockRows;
+        const size_t j0 = (t / numBlockRows) * tileN;
+        const size_t j1 = std::min(n, j0 + tileN);
+        switch (m_blockRows)
+        {
+        case 1:  MultiplyBlockRow<1>(blockRow, j0, j1, b, c, ldc); break;
+        case 4:  MultiplyBlockRow<4>(blockRow, j0, j1, b, c, ldc); break;
+        case 8:  MultiplyBlockRow<8>(blockRow, j0, j1, b, c, ldc); break;
+        case 16: MultiplyBlockRow<16>(blockRow, j0, j1, b, c, ldc); break;
+        default: MultiplyBlockRow<0>(blockRow, j0, j1, b, c, ldc); break;
+        }
+    }
+}
+
+template class BlockSparseMatrix<float>;
+template class BlockSparseMatrix<double>;
+
+}}}
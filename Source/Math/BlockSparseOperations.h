@@ -0,0 +1,102 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Block sparse weights: magnitude pruning of a matrix in blocks of elements, and the product of a block-pruned
+// matrix stored in block sparse row (BSR) format with dense data.
+//
+
+#pragma once
+
+#include "QuantizedOperations.h"
+#include "CommonMatrix.h" // for MATH_API
+
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Writes to 'mask' (column-major [m x k] like 'a') 0 for the blocks of blockRows x blockCols elements of 'a' with the
+// smallest L1 norms, and 1 elsewhere, so that the fraction 'sparsity' of the blocks is masked. The blocks at the bottom and the
+// right edges are smaller if m or k are not multiples of the block size. Returns the number of masked blocks.
+MATH_API size_t BlockPruningMask(size_t m, size_t k, const float* a, size_t blockRows, size_t blockCols, double sparsity, float* mask);
+MATH_API size_t BlockPruningMask(size_t m, size_t k, const double* a, size_t blockRows, size_t blockCols, double sparsity, double* mask);
+
+// A column-major [m x k] matrix in block sparse row format: for each row of blocks of blockRows x blockCols elements,
+// the indices of the block columns and the values of the blocks that are not all zero.
+template <class ElemType>
+class MATH_API BlockSparseMatrix
+{
+public:
+    BlockSparseMatrix() : m_m(0), m_k(0), m_blockRows(0), m_blockCols(0)
+    {
+    }
+
+    // builds the blocks from the dense column-major [m x k] matrix 'a'
+    void Assign(size_t m, size_t k, const ElemType* a, size_t blockRows, size_t blockCols);
+
+    // c = this * b for the dense column-major [k x n] matrix b, with c a column-major [m x n] matrix with leading dimension ldc
+    void Multiply(size_t n, const ElemType* b, ElemType* c, size_t ldc) const;
+
+    // the fraction of the blocks that are stored
+    double Density() const
+    {
+        size_t numBlocks = ((m_m + m_blockRows - 1) / m_blockRows) * ((m_k + m_blockCols - 1) / m_blockCols);
+        return numBlocks == 0 ? 0 : (double)m_blockColumn.size() / numBlocks;
+    }
+
+    size_t GetNumRows() const { return m_m; }
+    size_t GetNumCols() const { return m_k; }
+    bool IsEmpty() const { return m_m == 0; }
+
+private:
+    template <size_t BlockRows>
+    void MultiplyBlockRow(size_t blockRow, size_t j0, size_t j1, const ElemType* b, ElemType* c, size_t ldc) const;
+
+    size_t m_m, m_k;
+    size_t m_blockRows, m_blockCols;
+    std::vector<size_t> m_rowStarts;   // the blocks of block row i are [m_rowStarts[i], m_rowStarts[i + 1])
+    std::vector<size_t> m_blockColumn; // the block column of each block
+    std::vector<ElemType> m_values;    // the elements of each block, column-major blockRows x blockCols, zero-padded at the edges
+};
+
+// Product of constant block-pruned weights A with dense data B, for inference on the CPU.
+// A is converted to block sparse format on the first call (so A must not change afterwards, see Reset()).
+template <class ElemType>
+class BlockSparseMultiplier : public QuantizedMultiplier<ElemType>
+{
+    BlockSparseMatrix<ElemType> m_matA;
+    size_t m_blockRows, m_blockCols;
+
+public:
+    BlockSparseMultiplier(size_t blockRows, size_t blockCols) : m_blockRows(blockRows), m_blockCols(blockCols)
+    {
+    }
+
+    // converts A[m,k] to block sparse format and returns the fraction of its blocks that are not zero
+    double Prepare(int m, int k, const ElemType* A)
+    {
+        m_matA.Assign(m, k, A, m_blockRows, m_blockCols);
+        return m_matA.Density();
+    }
+
+    // A[m,k]*B[k,n] = C[m,n], all column-major
+    virtual void Multiply(int m, int n, int k, ElemType* A, ElemType* B, ElemType* C) override
+    {
+        if (m_matA.IsEmpty() || (size_t)m != m_matA.GetNumRows() || (size_t)k != m_matA.GetNumCols())
+            Prepare(m, k, A);
+        m_matA.Multiply(n, B, C, /*ldc=*/m);
+    }
+
+    // forces the weights to be converted again on the next call
+    void Reset() { m_matA = BlockSparseMatrix<ElemType>(); }
+};
+
+// Returns a new BlockSparseMultiplier, or nullptr for element types it does not support.
+template <class ElemType>
+inline shared_ptr<BlockSparseMultiplier<ElemType>> NewBlockSparseMultiplier(size_t /*blockRows*/, size_t /*blockCols*/) { return nullptr; }
+template <>
+inline shared_ptr<BlockSparseMultiplier<float>> NewBlockSparseMultiplier<float>(size_t blockRows, size_t blockCols) { return make_shared<BlockSparseMultiplier<float>>(blockRows, blockCols); }
+template <>
+inline shared_ptr<BlockSparseMultiplier<double>> NewBlockSparseMultiplier<double>(size_t blockRows, size_t blockCols) { return make_shared<BlockSparseMultiplier<double>>(blockRows, blockCols); }
+
+}}}
@@ -101,6 +101,11 @@ public:
     void Adam(CPUMatrix<ElemType>& gradients, CPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample,
               ElemType momentum, ElemType adaWeight, ElemType adaMul, ElemType epsilon, ElemType unitGainFactor, bool adamax=false);
 
+    static void MultiTensorUpdate(const MultiTensorUpdateParameters<ElemType>& update, const std::vector<CPUMatrix<ElemType>*>& parameters,
+                                  const std::vector<const CPUMatrix<ElemType>*>& gradients, const std::vector<CPUMatrix<ElemType>*>& smoothedGradients);
+    static ElemType MultiTensorSumOfSquares(const std::vector<const CPUMatrix<ElemType>*>& matrices);
+    static void MultiTensorSumsOfSquares(const std::vector<const CPUMatrix<ElemType>*>& matrices, std::vector<ElemType>& sums);
+
     ElemType RmsProp(CPUMatrix<ElemType>& gradients,
                      ElemType RMS_GAMMA,
                      ElemType RMS_WGT_INC,
@@ -114,6 +119,7 @@ public:
     void AdaDelta(CPUMatrix<GradType>& gradients, CPUMatrix<ElemType>& functionValues, ElemType learningRate, ElemType rho, ElemType epsilon);
 
     void AdaDeltaFlushTimestamps(size_t cols, ElemType rho, int* timestamps, int currentTimestamp);
+    void LazyDecayFlushTimestamps(size_t cols, ElemType decay, ElemType secondDecay, int* timestamps, int currentTimestamp);
 
     void Reshape(const size_t numRows, const size_t numCols);
 
@@ -173,6 +179,12 @@ public:
 
     CPUMatrix<ElemType>& DoGatherColumnsOf (ElemType beta, const CPUMatrix<ElemType>& idx, const CPUMatrix<ElemType>& a, ElemType alpha);
     CPUMatrix<ElemType>& DoScatterColumnsOf(ElemType beta, const CPUMatrix<ElemType>& idx, const CPUMatrix<ElemType>& a, ElemType alpha);
+    CPUMatrix<ElemType>& AssignDequantizedColumnsOf(const CPUMatrix<ElemType>& idx, const CPUMatrix<char>& codes, const CPUMatrix<ElemType>& scalesAndOffsets);
+    CPUMatrix<ElemType>& AssignDequantizedColumnsOf(const CPUMatrix<ElemType>& idx, const CPUMatrix<half>& codes, const CPUMatrix<ElemType>& scalesAndOffsets);
+
+    CPUMatrix<ElemType>& AssignSegmentedReductionOf(const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& segments, size_t columnStride, ElementWiseOperator reductionOp, bool average);
+    CPUMatrix<ElemType>& DoSegmentedReductionGradientOf(ElemType beta, const CPUMatrix<ElemType>& outputGradient, const CPUMatrix<ElemType>& input, const CPUMatrix<ElemType>& output,
+                                                        const CPUMatrix<ElemType>& segments, size_t columnStride, ElementWiseOperator reductionOp, bool average);
 
     CPUMatrix<ElemType>& operator+=(const ElemType alpha);
     CPUMatrix<ElemType>  operator+(const ElemType alpha) const;
@@ -238,6 +250,7 @@ public:
 
     CPUMatrix<ElemType>& InplaceLogSoftmax(const bool isColWise);
     CPUMatrix<ElemType>& AssignLogSoftmaxOf(const CPUMatrix<ElemType>& a, const bool isColWise);
+    CPUMatrix<ElemType>& InplaceSegmentedLogSoftmax(const std::vector<int>& segmentOffsets);
 
     CPUMatrix<ElemType>& InplaceHardmax(const bool isColWise);
     CPUMatrix<ElemType>& AssignHardmaxOf(const CPUMatrix<ElemType>& a, const bool isColWise);
@@ -246,6 +259,11 @@ public:
     CPUMatrix<ElemType>& DropFrame(const CPUMatrix<ElemType>& label, const CPUMatrix<ElemType>& gamma, const ElemType& threshhold);
     CPUMatrix<ElemType>& AssignSequenceError(const ElemType hsmoothingWeight, const CPUMatrix<ElemType>& label, const CPUMatrix<ElemType>& dnnoutput, const CPUMatrix<ElemType>& gamma, ElemType alpha);
     CPUMatrix<ElemType>& AssignCTCScore(const CPUMatrix<ElemType>& prob, CPUMatrix<ElemType>& alpha, CPUMatrix<ElemType>& beta, const CPUMatrix<ElemType>& phoneSeq, const CPUMatrix<ElemType>& phoneBoundary, CPUMatrix<ElemType>& totalScore, const vector<size_t>& uttMap, const vector<size_t> & uttBeginFrame, const vector<size_t> & uttFrameNum, const vector<size_t> & uttPhoneNum, const size_t samplesInRecurrentStep, const size_t maxFrameNum, const size_t blankTokenId, const int delayConstraint, const bool isColWise);
+    CPUMatrix<ElemType>& AssignEditDistances(const CPUMatrix<ElemType>& firstSeq, const CPUMatrix<ElemType>& secondSeq, const vector<size_t>& uttToChanInd, const vector<size_t>& uttBeginFrame, const vector<size_t>& uttFrameNum, const size_t numParallelSequences,
+                                             const float subPen, const float delPen, const float insPen, const bool squashInputs, const vector<size_t>& tokensToIgnore);
+    CPUMatrix<ElemType>& AssignLambdaRankRanks(const CPUMatrix<ElemType>& gains, const CPUMatrix<ElemType>& scores, const vector<size_t>& queryBegins, CPUMatrix<ElemType>& metrics);
+    static void AddLambdaRankGradient(const CPUMatrix<ElemType>& gains, const CPUMatrix<ElemType>& scores, const CPUMatrix<ElemType>& ranks, const CPUMatrix<ElemType>& metrics,
+                                      const vector<size_t>& queryBegins, const ElemType sigma, CPUMatrix<ElemType>& gradient);
     CPUMatrix<ElemType>& InplaceSqrt();
     CPUMatrix<ElemType>& AssignSqrtOf(const CPUMatrix<ElemType>& a);
 
@@ -300,10 +318,11 @@ public:
     ElemType SumOfAbsElements() const; // sum of all abs(elements)
     ElemType SumOfElements() const;    // sum of all elements
     CPUMatrix<ElemType>& AssignSumOfElements(const CPUMatrix<ElemType>& a);
+    CPUMatrix<ElemType>& AssignHistogramOf(const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& bucketLimits); // see Matrix.h
 
     CPUMatrix<ElemType>& AssignOneHot(const CPUMatrix<ElemType>& a, vector<size_t>& shape, size_t axis);
-    CPUMatrix<ElemType>& GatherFromTarget(const CPUMatrix<ElemType>& indices, const CPUMatrix<ElemType>& target, size_t row_elements);
-    CPUMatrix<ElemType>& ScatterToIndices(const CPUMatrix<ElemType>& values, const CPUMatrix<ElemType>& indices, size_t row_elements, const CPUMatrix<char>* mask = nullptr);
+    CPUMatrix<ElemType>& GatherFromTarget(const CPUMatrix<ElemType>& indices, const CPUMatrix<ElemType>& target, size_t row_elements, size_t outer_elements = 1);
+    CPUMatrix<ElemType>& ScatterToIndices(const CPUMatrix<ElemType>& values, const CPUMatrix<ElemType>& indices, size_t row_elements, size_t outer_elements = 1, const CPUMatrix<char>* mask = nullptr);
 
     bool IsEqualTo(const CPUMatrix<ElemType>& a, const ElemType threshold = 1e-8) const;
 
@@ -357,8 +376,12 @@ public:
     CPUMatrix<ElemType>& AddFoldedPositiveAndShiftedNegSample(const CPUMatrix<ElemType>& a, const size_t posNumber, const size_t negNumber, const size_t shiftNumber);
 
     void VectorMax(CPUMatrix<ElemType>& maxIndexes, CPUMatrix<ElemType>& maxValues, const bool isColWise, int topK = 1) const;
+    void VectorTopKSoftmax(CPUMatrix<ElemType>& topIndexes, CPUMatrix<ElemType>& topValues, CPUMatrix<ElemType>& logSumExp, int topK) const;
     void VectorMin(CPUMatrix<ElemType>& minIndexes, CPUMatrix<ElemType>& minValues, const bool isColWise) const;
 
+    void ExtractTopKMagnitudes(size_t k, std::vector<int>& indices, std::vector<ElemType>& values);
+    void ScatterAddValues(const std::vector<int>& indices, const std::vector<ElemType>& values);
+
     CPUMatrix<ElemType>& AssignNumOfDiff(const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& b, bool searchInCol = false);
 
     void Print(const char* matrixName, ptrdiff_t rowStart, ptrdiff_t rowEnd, ptrdiff_t colStart, ptrdiff_t colEnd) const;
@@ -421,6 +444,12 @@ public:
     void MaxROIPoolingBackward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
                                const size_t pooledWidth, const size_t pooledHeight, const CPUMatrix<ElemType>& roiData, CPUMatrix<ElemType>& grad, CPUMatrix<ElemType>& argmax, double spatialScale) const;
 
+    void AverageROIAlignForward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
+                                const size_t pooledWidth, const size_t pooledHeight, const CPUMatrix<ElemType>& roiData, CPUMatrix<ElemType>& output, double spatialScale) const;
+
+    void AverageROIAlignBackward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
+                                 const size_t pooledWidth, const size_t pooledHeight, const CPUMatrix<ElemType>& roiData, CPUMatrix<ElemType>& grad, double spatialScale) const;
+
     void MaxUnpooling(const CPUMatrix<int>& mpRowCol, const CPUMatrix<int>& mpRowIndices, const CPUMatrix<int>& indices, const CPUMatrix<ElemType>& poolInput, CPUMatrix<ElemType>& input) const;
 
     void AveragePoolingForward(const CPUMatrix<int>& mpRowCol, const CPUMatrix<int>& mpRowIndices, const CPUMatrix<int>& indices, CPUMatrix<ElemType>& output, const bool poolIncludePad) const;
@@ -435,6 +464,16 @@ public:
     void BatchNormalizationBackward(const CPUMatrix<ElemType>& in, CPUMatrix<ElemType>& grad, const CPUMatrix<StatType>& scale, double blendFactor, const CPUMatrix<StatType>& saveMean, const CPUMatrix<StatType>& saveInvStdDev,
                                     CPUMatrix<StatType>& scaleGrad, CPUMatrix<StatType>& biasGrad) const;
 
+    void LayerNormalizationForward(const CPUMatrix<ElemType>& scale, const CPUMatrix<ElemType>& bias, double epsilon, CPUMatrix<ElemType>& out,
+                                   CPUMatrix<ElemType>& saveMean, CPUMatrix<ElemType>& saveInvStdDev) const;
+    void LayerNormalizationBackward(const CPUMatrix<ElemType>& in, CPUMatrix<ElemType>& grad, const CPUMatrix<ElemType>& scale,
+                                    const CPUMatrix<ElemType>& saveMean, const CPUMatrix<ElemType>& saveInvStdDev,
+                                    CPUMatrix<ElemType>& scaleGrad, CPUMatrix<ElemType>& biasGrad) const;
+
+    // forward pass of OptimizedRNNStack into *this, with the cuDNN weight format (see CPURNN.h); there is no backward pass on the CPU
+    void RNNForward(const CPUMatrix<ElemType>& inputX, const CPUMatrix<ElemType>& paramW, size_t xDim, size_t yDim, const std::vector<size_t>& numSequencesForFrame,
+                    const struct RnnAttributes& rnnAttributes, CPUMatrix<ElemType>& workspace);
+
 public:
     // This functions do not depend on <ElemType>, i.e. you can call them on any <ElemType>
     static int SetNumThreads(int numThreads);
@@ -442,7 +481,8 @@ public:
 
     enum OptimizationFlag
     {
-        OPT_EVAL_WITH_MKL = 1, // using Intel MKL functions for evaluation performance
+        OPT_EVAL_WITH_MKL = 1,  // using Intel MKL functions for evaluation performance
+        OPT_EVAL_WITH_SIMD = 2, // using AVX2/AVX-512 kernels for dense elementwise ops, if the CPU supports them
     };
     static void SetOptimizationFlags(int flags);
     static int  GetOptimizationFlags();
@@ -504,6 +544,10 @@ public:
                      const SmallVector<size_t>& regularOpDims, const std::array<SmallVector<ptrdiff_t>, 2>& regularStrides,
                      const SmallVector<size_t>& reducingOpDims, const std::array<SmallVector<ptrdiff_t>, 2>& reducingStrides);
 
+    void ElementwiseProgramOp(ElemType beta, const std::vector<const CPUMatrix<ElemType>*>& inputs, const ElementwiseProgram& program, ElemType alpha);
+
+    void DropoutOp(ElemType beta, const CPUMatrix<ElemType>& a, double dropoutRate, uint64_t seed, uint64_t offset);
+
     static CPUMatrix<ElemType> Ones(const size_t rows, const size_t cols);
     static CPUMatrix<ElemType> Zeros(const size_t rows, const size_t cols);
     static CPUMatrix<ElemType> Eye(const size_t rows);
@@ -534,8 +578,7 @@ public:
         int format;
         stream >> matrixName >> format >> numRows >> numCols;
         ElemType* d_array = new ElemType[numRows * numCols];
-        for (size_t i = 0; i < numRows * numCols; ++i)
-            stream >> d_array[i];
+        stream.ReadValues(d_array, numRows * numCols);
         stream.GetMarker(fileMarkerEndSection, std::wstring(L"EMAT"));
         us.SetValue(numRows, numCols, d_array, matrixFlagNormal);
 
@@ -552,8 +595,7 @@ public:
         stream << s << format;
 
         stream << us.m_numRows << us.m_numCols;
-        for (size_t i = 0; i < us.GetNumElements(); ++i)
-            stream << us.Data()[i];
+        stream.WriteValues(us.Data(), us.GetNumElements());
         stream.PutMarker(fileMarkerEndSection, std::wstring(L"EMAT"));
         return stream;
     }
@@ -602,6 +644,7 @@ private:
 typedef CPUMatrix<float> CPUSingleMatrix;
 typedef CPUMatrix<double> CPUDoubleMatrix;
 typedef CPUMatrix<half> CPUHalfMatrix;
+typedef CPUMatrix<bfloat16> CPUBFloat16Matrix;
 
 template<typename ElemType>
 void CPUMatrixTensorOpImpl(ElemType beta, const CPUMatrix<ElemType>& a, CPUMatrix<ElemType>& o, ElemType alpha, ElementWiseOperator op, ElementWiseOperator reductionOp,
@@ -0,0 +1,91 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "CPUMatrixImpl.h"
+#include "CPUMatrixFloatCompute.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// specialization to compute in float, see MultiplyAndWeightedAddInFloat()
+template <>
+void CPUMatrix<bfloat16>::MultiplyAndWeightedAdd(bfloat16 alpha, const CPUMatrix<bfloat16>& a, const bool transposeA, const CPUMatrix<bfloat16>& b, const bool transposeB,
+    bfloat16 beta, CPUMatrix<bfloat16>& c, shared_ptr<QuantizedMultiplier<bfloat16>> pQuantizedMultiplier)
+{
+    if (pQuantizedMultiplier)
+        RuntimeError("Quantized matrix multiply not supported for BFloat16");
+
+    MultiplyAndWeightedAddInFloat(alpha, a, transposeA, b, transposeB, beta, c);
+}
+
+// specialization to RunTimeError for now due to omp implementation only support build-in type
+template <>
+void CPUMatrix<bfloat16>::AssignSoftmaxSum(const CPUMatrix<bfloat16>& softmax, CPUMatrix<bfloat16>& c)
+{
+    RuntimeError("bfloat16 AssignSoftmaxSum not supported.");
+}
+
+template <>
+void CPUMatrix<bfloat16>::AssignNCEUnnormalizedEval(const CPUMatrix<bfloat16>& a,
+                                                const CPUMatrix<bfloat16>& b, const CPUMatrix<bfloat16>& bias, CPUMatrix<bfloat16>& c)
+{
+    RuntimeError("bfloat16 AssignNCEUnnormalizedEval not supported.");
+}
+
+template <>
+void CPUMatrix<bfloat16>::VectorSum(const CPUMatrix<bfloat16>& a, CPUMatrix<bfloat16>& c, const bool isColWise)
+{
+    RuntimeError("bfloat16 VectorSum not supported.");
+}
+
+template <>
+void CPUMatrix<bfloat16>::VectorNorm1(CPUMatrix<bfloat16>& c, const bool isColWise) const
+{
+    RuntimeError("bfloat16 VectorNorm1 not supported.");
+}
+
+template <>
+bfloat16 CPUMatrix<bfloat16>::SumOfElements() const
+{
+    RuntimeError("bfloat16 SumOfElements not supported.");
+}
+
+template <>
+bfloat16 CPUMatrix<bfloat16>::MatrixNorm1() const
+{
+    RuntimeError("bfloat16 MatrixNorm1 not supported.");
+}
+
+template <>
+    bfloat16 CPUMatrix<bfloat16>::FrobeniusNorm() const
+{
+    RuntimeError("bfloat16 FrobeniusNorm not supported.");
+}
+
+template <>
+void CPUMatrix<bfloat16>::MaxPoolingBackward(const CPUMatrix<bfloat16>& out, const CPUMatrix<bfloat16>& in,
+                                         const CPUMatrix<int>& mpRowCol, const CPUMatrix<int>& mpRowIndices, const CPUMatrix<int>& indices,
+                                         CPUMatrix<bfloat16>& grad, bool accumulateGradient) const
+{
+    RuntimeError("bfloat16 MaxPoolingBackward not supported.");
+}
+
+template <>
+void CPUMatrix<bfloat16>::AveragePoolingBackward(const CPUMatrix<int>& mpRowCol, const CPUMatrix<int>& mpRowIndices, const CPUMatrix<int>& indices, CPUMatrix<bfloat16>& grad, const bool poolIncludePad, bool accumulateGradient) const
+{
+    RuntimeError("bfloat16 AveragePoolingBackward not supported.");
+}
+
+// explicit instantiations, due to CPUMatrix being too big and causing VS2015 cl crash.
+template class MATH_API CPUMatrix<bfloat16>;
+template<> int CPUMatrix<bfloat16>::m_optimizationFlags = 0;
+
+// instantiate templated methods
+template void CPUMatrix<float>::AdaDelta(CPUMatrix<bfloat16>& gradients, CPUMatrix<float>& functionValues, float learningRate, float rho, float epsilon);
+
+template void CPUMatrix<bfloat16>::BatchNormalizationForward(const CPUMatrix<float>& scale, const CPUMatrix<float>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, CPUMatrix<float>& runMean, CPUMatrix<float>& runVariance, CPUMatrix<bfloat16>& out, double epsilon, CPUMatrix<float>& saveMean, CPUMatrix<float>& saveInvStdDev) const;
+
+template void CPUMatrix<bfloat16>::BatchNormalizationBackward(const CPUMatrix<bfloat16>& in, CPUMatrix<bfloat16>& grad, const CPUMatrix<float>& scale, double blendFactor, const CPUMatrix<float>& saveMean, const CPUMatrix<float>& saveInvStdDev, CPUMatrix<float>& scaleGrad, CPUMatrix<float>& biasGrad) const;
+
+}}}
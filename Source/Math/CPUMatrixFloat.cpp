@@ -19,7 +19,30 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         return (m_traceLevel > 0);
     }
 
+    bool MATH_API TracingGPUMemoryAllocator::m_cachingEnabled = false;
+    size_t MATH_API TracingGPUMemoryAllocator::m_cacheLimitInMBs = 0;
+
+    void TracingGPUMemoryAllocator::SetCachingEnabled(bool enabled)
+    {
+        m_cachingEnabled = enabled;
+    }
+
+    bool TracingGPUMemoryAllocator::IsCachingEnabled()
+    {
+        return m_cachingEnabled;
+    }
+
+    void TracingGPUMemoryAllocator::SetCacheLimitInMBs(size_t limitInMBs)
+    {
+        m_cacheLimitInMBs = limitInMBs;
+    }
+
+    size_t TracingGPUMemoryAllocator::GetCacheLimitInMBs()
+    {
+        return m_cacheLimitInMBs;
+    }
+
     // explicit instantiations, due to CPUMatrix being too big and causing VS2015 cl crash.
     template class MATH_API CPUMatrix<float>;
-    template<> int CPUMatrix<float>::m_optimizationFlags = CPUMatrix<float>::OPT_EVAL_WITH_MKL; // enable eval MKL optimization by default
+    template<> int CPUMatrix<float>::m_optimizationFlags = CPUMatrix<float>::OPT_EVAL_WITH_MKL | CPUMatrix<float>::OPT_EVAL_WITH_SIMD; // enable eval MKL and SIMD optimization by default
 }}}
\ No newline at end of file
@@ -0,0 +1,149 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Helpers of the CPUMatrix specializations for the 16-bit element types (half and bfloat16), which are stored
+// in 16 bits but computed in float: the conversions and the matrix product.
+//
+
+#pragma once
+
+#include "CPUMatrixImpl.h"
+#include "CPUMatrixTensorSimd.h"
+
+#include <cstring>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Bulk conversion between half and float, vectorized if the CPU supports it (F16C or AVX-512)
+inline void ConvertBuffer(float* dst, const half* src, size_t count)
+{
+    const Simd::TensorKernels* kernels = Simd::GetTensorKernels();
+    if (kernels)
+        return kernels->m_halfToFloat(count, reinterpret_cast<const unsigned short*>(src), dst);
+
+    for (size_t i = 0; i < count; i++)
+        dst[i] = (float)src[i];
+}
+
+inline void ConvertBuffer(half* dst, const float* src, size_t count)
+{
+    const Simd::TensorKernels* kernels = Simd::GetTensorKernels();
+    if (kernels)
+        return kernels->m_floatToHalf(count, src, reinterpret_cast<unsigned short*>(dst));
+
+    for (size_t i = 0; i < count; i++)
+        dst[i] = (half)src[i];
+}
+
+// Bulk conversion between bfloat16 and float. These are only shifts and integer adds on the bit patterns,
+// which the compiler vectorizes.
+inline void ConvertBuffer(float* dst, const bfloat16* src, size_t count)
+{
+    const unsigned short* bits = reinterpret_cast<const unsigned short*>(src);
+    for (size_t i = 0; i < count; i++)
+    {
+        unsigned int u = (unsigned int)bits[i] << 16;
+        memcpy(dst + i, &u, sizeof(u));
+    }
+}
+
+inline void ConvertBuffer(bfloat16* dst, const float* src, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        dst[i] = (bfloat16)src[i];
+}
+
+// Converts a block of numRows x numCols elements of a column-major matrix with leading dimension 'ld' to or from a dense block.
+template <class ElemType>
+void ConvertBlock(float* dst, const ElemType* src, size_t ld, size_t numRows, size_t numCols)
+{
+    for (size_t j = 0; j < numCols; j++)
+        ConvertBuffer(dst + j * numRows, src + j * ld, numRows);
+}
+
+template <class ElemType>
+void ConvertBlock(ElemType* dst, size_t ld, const float* src, size_t numRows, size_t numCols)
+{
+    for (size_t j = 0; j < numCols; j++)
+        ConvertBuffer(dst + j * ld, src + j * numRows, numRows);
+}
+
+// c = alpha * op(a) * op(b) + beta * c computed in float: c is computed in tiles, and the tiles of the operands that
+// contribute to one are converted to float right before their product. Unlike converting the whole matrices this
+// needs a fixed amount of temporary memory, e.g. for the products with the weights of a model stored in 16 bits.
+template <class ElemType>
+void MultiplyAndWeightedAddInFloat(ElemType alpha, const CPUMatrix<ElemType>& a, const bool transposeA, const CPUMatrix<ElemType>& b, const bool transposeB,
+                                   ElemType beta, CPUMatrix<ElemType>& c)
+{
+    if (a.IsEmpty() || b.IsEmpty())
+        return;
+
+    const size_t m = transposeA ? a.GetNumCols() : a.GetNumRows();
+    const size_t k = transposeA ? a.GetNumRows() : a.GetNumCols();
+    const size_t l = transposeB ? b.GetNumCols() : b.GetNumRows();
+    const size_t n = transposeB ? b.GetNumRows() : b.GetNumCols();
+    if (k != l)
+        InvalidArgument("CPUMatrix<ElemType>::MultiplyAndWeightedAdd : The inner dimensions of a and b must match.");
+
+    if (beta == 0)
+        c.RequireSize(m, n);
+    else
+        c.VerifySize(m, n); // Can't resize if beta != 0
+
+    const float alphaf = (float)alpha;
+    const float betaf = (float)beta;
+    const size_t lda = a.GetNumRows();
+    const size_t ldb = b.GetNumRows();
+    const size_t ldc = c.GetNumRows();
+
+    const size_t tileM = 256;
+    const size_t tileN = 256;
+    const size_t tileK = 512;
+    std::vector<float> aTile(std::min(m, tileM) * std::min(k, tileK));
+    std::vector<float> bTile(std::min(k, tileK) * std::min(n, tileN));
+    std::vector<float> cTile(std::min(m, tileM) * std::min(n, tileN));
+
+    for (size_t n0 = 0; n0 < n; n0 += tileN)
+    {
+        const size_t nb = std::min(tileN, n - n0);
+        for (size_t m0 = 0; m0 < m; m0 += tileM)
+        {
+            const size_t mb = std::min(tileM, m - m0);
+            ElemType* cBlock = c.Data() + n0 * ldc + m0;
+            if (betaf != 0)
+                ConvertBlock(cTile.data(), cBlock, ldc, mb, nb);
+
+            if (alphaf == 0)
+            {
+                for (size_t i = 0; i < mb * nb; i++)
+                    cTile[i] = betaf == 0 ? 0 : betaf * cTile[i];
+            }
+
+            for (size_t k0 = 0; k0 < k && alphaf != 0; k0 += tileK)
+            {
+                const size_t kb = std::min(tileK, k - k0);
+                if (transposeA)
+                    ConvertBlock(aTile.data(), a.Data() + m0 * lda + k0, lda, kb, mb);
+                else
+                    ConvertBlock(aTile.data(), a.Data() + k0 * lda + m0, lda, mb, kb);
+
+                if (transposeB)
+                    ConvertBlock(bTile.data(), b.Data() + k0 * ldb + n0, ldb, nb, kb);
+                else
+                    ConvertBlock(bTile.data(), b.Data() + n0 * ldb + k0, ldb, kb, nb);
+
+                cblas_sgemm((CBLAS_ORDER) (int)MatrixOrder::ColMajor,
+                            transposeA ? CBLAS_TRANSPOSE::CblasTrans : CBLAS_TRANSPOSE::CblasNoTrans,
+                            transposeB ? CBLAS_TRANSPOSE::CblasTrans : CBLAS_TRANSPOSE::CblasNoTrans,
+                            (int)mb, (int)nb, (int)kb, alphaf, aTile.data(), (int)(transposeA ? kb : mb), bTile.data(), (int)(transposeB ? nb : kb),
+                            k0 == 0 ? betaf : 1.0f, cTile.data(), (int)mb);
+            }
+
+            ConvertBlock(cBlock, ldc, cTile.data(), mb, nb);
+        }
+    }
+}
+
+}}}
@@ -4,47 +4,19 @@
 //
 #include "stdafx.h"
 #include "CPUMatrixImpl.h"
+#include "CPUMatrixFloatCompute.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
-// General conversion function with no performance optimization
-// this should only be used in CPU half precision
-// For performance on inference on CPU, user should convert fp16 model to fp32 first, unless MKL supports half precision
-template<typename SrcT, typename DstT>
-static void ConvertBuffer(DstT* dst, const SrcT* src, size_t count)
-{
-    for (size_t i = 0; i < count; i++)
-    {
-        dst[i] = (DstT)src[i];
-    }
-}
-
-// specialization to convert from half to float for computation, and then store in half
+// specialization to compute in float, see MultiplyAndWeightedAddInFloat()
 template <>
 void CPUMatrix<half>::MultiplyAndWeightedAdd(half alpha, const CPUMatrix<half>& a, const bool transposeA, const CPUMatrix<half>& b, const bool transposeB,
     half beta, CPUMatrix<half>& c, shared_ptr<QuantizedMultiplier<half>> pQuantizedMultiplier)
 {
-    CPUMatrix<float> af(a.GetNumRows(), a.GetNumCols());
-    CPUMatrix<float> bf(b.GetNumRows(), b.GetNumCols());
-    CPUMatrix<float> cf(c.GetNumRows(), c.GetNumCols());
-
-    if (alpha != 0)
-    {
-        ConvertBuffer<half, float>(af.Data(), a.Data(), a.GetNumElements());
-        ConvertBuffer<half, float>(bf.Data(), b.Data(), b.GetNumElements());
-    }
-
-    if (beta != 0)
-    {
-        ConvertBuffer<half, float>(cf.Data(), c.Data(), c.GetNumElements());
-    }
-
     if (pQuantizedMultiplier)
         RuntimeError("Quantized matrix multiply not supported for Half");
 
-    CPUMatrix<float>::MultiplyAndWeightedAdd((float)alpha, af, transposeA, bf, transposeB, (float)beta, cf, nullptr);
-
-    ConvertBuffer<float, half>(c.Data(), cf.Data(), c.GetNumElements());
+    MultiplyAndWeightedAddInFloat(alpha, a, transposeA, b, transposeB, beta, c);
 }
 
 // specialization to RunTimeError for now due to omp implementation only support build-in type
@@ -99,14 +71,6 @@ void CPUMatrix<half>::MaxPoolingBackward(const CPUMatrix<half>& out, const CPUMa
     RuntimeError("half MaxPoolingBackward not supported.");
 }
 
-template <>
-void CPUMatrix<half>::MaxROIPoolingBackward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
-                                            const size_t pooledWidth, const size_t pooledHeight, const CPUMatrix<half>& roiData, CPUMatrix<half>& grad,
-                                            CPUMatrix<half>& argmax, double spatialScale) const
-{
-    RuntimeError("half MaxROIPoolingBackward not supported.");
-}
-
 template <>
 void CPUMatrix<half>::AveragePoolingBackward(const CPUMatrix<int>& mpRowCol, const CPUMatrix<int>& mpRowIndices, const CPUMatrix<int>& indices, CPUMatrix<half>& grad, const bool poolIncludePad, bool accumulateGradient) const
 {
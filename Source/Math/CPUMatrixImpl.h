@@ -11,6 +11,9 @@
 #include "File.h"
 
 #include "CPUMatrix.h"
+#include "NumaPolicy.h"
+#include "ThreadPool.h"
+#include "CPURNN.h"
 #include "TensorOps.h"
 #include <assert.h>
 #include <stdexcept>
@@ -57,8 +60,11 @@
 #define HAVE_LAPACK_CONFIG_H
 #define LAPACK_COMPLEX_STRUCTURE
 #endif
+// OpenBLAS declares its own bfloat16, a typedef of uint16_t that would clash with the element type of the same name
+#define bfloat16 openblas_bfloat16
 #include <cblas.h>
 #include <lapacke.h>
+#undef bfloat16
 #endif
 
 #define SWAP(a, b)  \
@@ -109,8 +115,9 @@ CPUMatrix<ElemType>::CPUMatrix()
 
 // helper to allocate an array of ElemType
 // Use this instead of new[] to get NaN initialization for debugging.
+// The storage of a matrix ('isStorage') may be backed by huge pages (see NewLargeArray()), free it with DeleteLargeArray().
 template <class ElemType>
-static ElemType* NewArray(size_t n)
+static ElemType* NewArray(size_t n, bool isStorage = false)
 {
     // We need to allocate possibly one more element for the following reason.
     // At some point we might want to fill a buffer with the result of a random
@@ -120,7 +127,8 @@ static ElemType* NewArray(size_t n)
     // number gaussians on the GPU is not supported so we must always
     // generate an even number. So since we wouldn't know how to update the tally
     // we are making this allocate one more element in the worst case.
-    ElemType* p = new ElemType[AsMultipleOf(n, 2)]();
+    ElemType* p = isStorage ? NewLargeArray<ElemType>(AsMultipleOf(n, 2)) : NewNumaPlacedArray<ElemType>(AsMultipleOf(n, 2));
+    CountMatrixStorageAllocation();
 #if 0 // _DEBUG
         ElemType nan = Matrix<ElemType>::MakeNan(__LINE__);
         for (size_t i = 0; i < n; i++)
@@ -140,7 +148,7 @@ CPUMatrix<ElemType>::CPUMatrix(const size_t numRows, const size_t numCols)
 
     if (GetNumElements() != 0)
     {
-        SetBuffer(NewArray<ElemType>(GetNumElements()), GetNumElements() * sizeof(ElemType));
+        SetBuffer(NewArray<ElemType>(GetNumElements(), /*isStorage=*/true), GetNumElements() * sizeof(ElemType));
     }
 }
 
@@ -669,6 +677,60 @@ CPUMatrix<ElemType>& CPUMatrix<ElemType>::DoGatherColumnsOf(ElemType beta, const
     return *this;
 }
 
+static inline float _dequantizedValue(char code) { return (float)(signed char)code; }
+static inline float _dequantizedValue(half code) { return (float)code; }
+
+// *this[:,j] = codes[:,idx[j]] * scalesAndOffsets(0,idx[j]) + scalesAndOffsets(1,idx[j]); see Matrix::AssignDequantizedColumnsOf()
+template <class ElemType, class QuantizedType>
+static void _assignDequantizedColumnsOf(CPUMatrix<ElemType>& us, const CPUMatrix<ElemType>& idx, const CPUMatrix<QuantizedType>& codes, const CPUMatrix<ElemType>& scalesAndOffsets)
+{
+    if (idx.GetNumRows() != 1) // index is 1-dimensional only
+        InvalidArgument("AssignDequantizedColumnsOf: Map must be a row vector.");
+    if (scalesAndOffsets.GetNumRows() != 2 || scalesAndOffsets.GetNumCols() != codes.GetNumCols())
+        InvalidArgument("AssignDequantizedColumnsOf: There must be a scale and an offset for each column of the codes.");
+
+    const size_t numRows = codes.GetNumRows();
+    us.Resize(numRows, idx.GetNumCols());
+    const QuantizedType* codesData = codes.Data();
+    const ElemType* scalesData = scalesAndOffsets.Data();
+    ElemType* usData = us.Data();
+
+#pragma omp parallel for
+    for (long jOut = 0; jOut < (long)idx.GetNumCols(); jOut++)
+    {
+        ElemType* dst = usData + jOut * numRows;
+        double jInF = (double)idx(0, jOut);
+        if (std::isnan(jInF) || jInF < 0) // negative index means gap
+        {
+            for (size_t i = 0; i < numRows; i++)
+                dst[i] = 0;
+            continue;
+        }
+        size_t jIn = (size_t)jInF;
+        if (jIn >= codes.GetNumCols())
+            InvalidArgument("AssignDequantizedColumnsOf: Map out of bounds. %ld >= %ld", (long int)jIn, (long int)codes.GetNumCols());
+        const QuantizedType* src = codesData + jIn * numRows;
+        float scale = (float)scalesData[2 * jIn];
+        float offset = (float)scalesData[2 * jIn + 1];
+        for (size_t i = 0; i < numRows; i++)
+            dst[i] = (ElemType)(_dequantizedValue(src[i]) * scale + offset);
+    }
+}
+
+template <class ElemType>
+CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignDequantizedColumnsOf(const CPUMatrix<ElemType>& idx, const CPUMatrix<char>& codes, const CPUMatrix<ElemType>& scalesAndOffsets)
+{
+    _assignDequantizedColumnsOf(*this, idx, codes, scalesAndOffsets);
+    return *this;
+}
+
+template <class ElemType>
+CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignDequantizedColumnsOf(const CPUMatrix<ElemType>& idx, const CPUMatrix<half>& codes, const CPUMatrix<ElemType>& scalesAndOffsets)
+{
+    _assignDequantizedColumnsOf(*this, idx, codes, scalesAndOffsets);
+    return *this;
+}
+
 // *this[:,idx[j]] = a[:,j] * alpha + *this[:,idx[j]] * beta
 template <class ElemType>
 CPUMatrix<ElemType>& CPUMatrix<ElemType>::DoScatterColumnsOf(ElemType beta, const CPUMatrix<ElemType>& idx, const CPUMatrix<ElemType>& a, ElemType alpha)
@@ -684,13 +746,117 @@ CPUMatrix<ElemType>& CPUMatrix<ElemType>::DoScatterColumnsOf(ElemType beta, cons
 
     // pre-scale with beta upfront
     // Scatter may add more than one source column to the same target, so we must pre-scale with beta, and then just keep adding.
-    Scale(beta, us); // if beta is 0, then this will be a memset()
+    if (beta != 1) // e.g. adding into some columns of a large parameter leaves the others as they are
+        Scale(beta, us); // if beta is 0, then this will be a memset()
 
     ScatterValues(idx.Data(), a.Data(), us.Data(), alpha, idx.GetNumCols(), a.GetNumRows(), GetNumCols(), idx.GetNumRows());
 
     return *this;
 }
 
+// helper for the segmented reductions: extracts and checks the range of columns of segment j
+template <class ElemType>
+static void GetSegment(const CPUMatrix<ElemType>& segments, size_t j, size_t columnStride, size_t numCols, size_t& first, size_t& length)
+{
+    first  = (size_t)segments(0, j);
+    length = (size_t)segments(1, j);
+    if (length > 0 && first + (length - 1) * columnStride >= numCols)
+        InvalidArgument("SegmentedReduction: Segment %d exceeds the %d columns of the input.", (int)j, (int)numCols);
+}
+
+// *this[:,j] = reduce_k a[:,first_j + k * columnStride], see Matrix<ElemType>::AssignSegmentedReductionOf()
+template <class ElemType>
+CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignSegmentedReductionOf(const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& segments, size_t columnStride, ElementWiseOperator reductionOp, bool average)
+{
+    if (segments.GetNumRows() != 2)
+        InvalidArgument("AssignSegmentedReductionOf: Segments must be given as a 2 x N matrix of first columns and lengths.");
+    if (reductionOp != ElementWiseOperator::opSum && reductionOp != ElementWiseOperator::opLogSum &&
+        reductionOp != ElementWiseOperator::opMin && reductionOp != ElementWiseOperator::opMax)
+        InvalidArgument("AssignSegmentedReductionOf: Only opSum, opLogSum, opMin and opMax are supported.");
+
+    RequireSize(a.GetNumRows(), segments.GetNumCols());
+
+    auto& us = *this;
+    const size_t numRows = a.GetNumRows();
+    // Each segment is reduced into its own output column, and the columns are added in memory order one after another.
+#pragma omp parallel for
+    foreach_column(j, us)
+    {
+        size_t first, length;
+        GetSegment(segments, j, columnStride, a.GetNumCols(), first, length);
+        ElemType* res = &us(0, j);
+        if (length == 0)
+        {
+            memset(res, 0, sizeof(ElemType) * numRows);
+            continue;
+        }
+        memcpy(res, &a(0, first), sizeof(ElemType) * numRows);
+        for (size_t k = 1; k < length; k++)
+        {
+            const ElemType* col = &a(0, first + k * columnStride);
+            switch (reductionOp)
+            {
+            case ElementWiseOperator::opSum:    for (size_t i = 0; i < numRows; i++) res[i] += col[i];                               break;
+            case ElementWiseOperator::opLogSum: for (size_t i = 0; i < numRows; i++) res[i] = LogAdd(res[i], col[i]);                break;
+            case ElementWiseOperator::opMin:    for (size_t i = 0; i < numRows; i++) res[i] = col[i] < res[i] ? col[i] : res[i];     break;
+            case ElementWiseOperator::opMax:    for (size_t i = 0; i < numRows; i++) res[i] = col[i] > res[i] ? col[i] : res[i];     break;
+            default: break;
+            }
+        }
+        if (average && reductionOp == ElementWiseOperator::opSum)
+            for (size_t i = 0; i < numRows; i++)
+                res[i] /= (ElemType)length;
+    }
+
+    return *this;
+}
+
+// *this[:,first_j + k * columnStride] = beta * *this[:,first_j + k * columnStride] + d reduce / d a * outputGradient[:,j]
+// Each column belongs to at most one segment, so the segments can be processed independently.
+template <class ElemType>
+CPUMatrix<ElemType>& CPUMatrix<ElemType>::DoSegmentedReductionGradientOf(ElemType beta, const CPUMatrix<ElemType>& outputGradient, const CPUMatrix<ElemType>& input, const CPUMatrix<ElemType>& output,
+                                                                         const CPUMatrix<ElemType>& segments, size_t columnStride, ElementWiseOperator reductionOp, bool average)
+{
+    if (segments.GetNumRows() != 2 || segments.GetNumCols() != outputGradient.GetNumCols())
+        InvalidArgument("DoSegmentedReductionGradientOf: Segments must be given as a 2 x N matrix of first columns and lengths, one for each output column.");
+    const size_t numRows = outputGradient.GetNumRows();
+    if (GetNumRows() != numRows)
+        InvalidArgument("DoSegmentedReductionGradientOf: The gradient must have the same height as the output gradient.");
+    bool usesValues = (reductionOp != ElementWiseOperator::opSum);
+    if (usesValues && (input.GetNumRows() != numRows || input.GetNumCols() != GetNumCols() || output.GetNumRows() != numRows || output.GetNumCols() != outputGradient.GetNumCols()))
+        InvalidArgument("DoSegmentedReductionGradientOf: The input and output values must have the dimensions of their gradients.");
+
+    auto& us = *this;
+    const long numSegments = (long)segments.GetNumCols();
+#pragma omp parallel for
+    for (long j = 0; j < numSegments; j++)
+    {
+        size_t first, length;
+        GetSegment(segments, j, columnStride, GetNumCols(), first, length);
+        const ElemType* grad = &outputGradient(0, j);
+        const ElemType scale = (average && reductionOp == ElementWiseOperator::opSum && length > 0) ? (ElemType)1 / (ElemType)length : (ElemType)1;
+        for (size_t k = 0; k < length; k++)
+        {
+            size_t col = first + k * columnStride;
+            ElemType* res = &us(0, col);
+            for (size_t i = 0; i < numRows; i++)
+            {
+                ElemType g;
+                switch (reductionOp)
+                {
+                case ElementWiseOperator::opLogSum: g = grad[i] * (ElemType)exp((double)(input(i, col) - output(i, j))); break;
+                case ElementWiseOperator::opMin:
+                case ElementWiseOperator::opMax:    g = input(i, col) == output(i, j) ? grad[i] : (ElemType)0;            break;
+                default:                            g = grad[i] * scale;                                                 break;
+                }
+                res[i] = beta == 0 ? g : beta * res[i] + g;
+            }
+        }
+    }
+
+    return *this;
+}
+
 template <class ElemType>
 void CPUMatrix<ElemType>::SetValue(const ElemType v)
 {
@@ -878,7 +1044,7 @@ void CPUMatrix<ElemType>::SetValue(const size_t numRows, const size_t numCols, E
     if (matrixFlags & matrixFlagDontOwnBuffer)
     {
         // free previous array allocation if any before overwriting
-        delete[] Buffer();
+        DeleteLargeArray(Buffer());
 
         m_numRows = numRows;
         m_numCols = numCols;
@@ -1354,6 +1520,134 @@ void CPUMatrix<ElemType>::Adam(CPUMatrix<ElemType>& gradients, CPUMatrix<ElemTyp
     }
 }
 
+// Applies a learner update to many parameters, with the same arithmetic as the per-parameter updates above.
+// The sizes are verified by Matrix::MultiTensorUpdate().
+template <class ElemType>
+/*static*/ void CPUMatrix<ElemType>::MultiTensorUpdate(const MultiTensorUpdateParameters<ElemType>& update, const vector<CPUMatrix<ElemType>*>& parameters,
+                                                       const vector<const CPUMatrix<ElemType>*>& gradients, const vector<CPUMatrix<ElemType>*>& smoothedGradients)
+{
+    const ElemType gradientScale = update.gradientScale;
+    const ElemType l2Weight = update.l2RegularizationWeight;
+    const ElemType learnRatePerSample = update.learningRate;
+    const ElemType momentum = update.momentum;
+    const ElemType unitGainFactor = update.unitGainFactor;
+    const ElemType adaWeight = update.varianceMomentum;
+    const ElemType adaMul = update.varianceScale;
+    const ElemType epsilon = update.epsilon;
+    const ElemType floor = 1e-16f;
+
+    for (size_t t = 0; t < parameters.size(); t++)
+    {
+        const long n = (long)parameters[t]->GetNumElements();
+        ElemType* val = parameters[t]->Data();
+        const ElemType* grad = gradients[t]->Data();
+        ElemType* smoothAda = smoothedGradients[t]->Data();
+        ElemType* smoothMom = (update.kind == MultiTensorUpdateKind::MomentumSGD) ? smoothAda : smoothAda + n;
+
+        switch (update.kind)
+        {
+        case MultiTensorUpdateKind::MomentumSGD:
+#pragma omp parallel for
+            for (long i = 0; i < n; i++)
+            {
+                const ElemType g = gradientScale * grad[i] + l2Weight * val[i];
+                smoothMom[i] = momentum * smoothMom[i] + unitGainFactor * learnRatePerSample * g;
+                val[i] -= smoothMom[i];
+            }
+            break;
+        case MultiTensorUpdateKind::AdaGrad:
+#pragma omp parallel for
+            for (long i = 0; i < n; i++)
+            {
+                const ElemType g = gradientScale * grad[i] + l2Weight * val[i];
+                smoothAda[i] += g * g;
+                val[i] -= learnRatePerSample * (g / sqrt(smoothAda[i] + floor));
+            }
+            break;
+        case MultiTensorUpdateKind::FSAdaGrad:
+#pragma omp parallel for
+            for (long i = 0; i < n; i++)
+            {
+                ElemType g = gradientScale * grad[i] + l2Weight * val[i];
+                ElemType adaSqr = adaWeight * smoothAda[i] + (1.0f - adaWeight) * g * g;
+                smoothAda[i] = adaSqr;
+                if (adaSqr != 0.0f)
+                {
+                    ElemType w = adaMul * ((ElemType) 1.0 / sqrt(adaSqr));
+                    if (w > 10.0f)
+                        w = 10.0f;
+                    g *= w;
+                }
+
+                if (momentum > 0.0f)
+                {
+                    g = momentum * smoothMom[i] + unitGainFactor * g;
+                    smoothMom[i] = g;
+                }
+
+                val[i] -= g * learnRatePerSample;
+            }
+            break;
+        case MultiTensorUpdateKind::Adam:
+#pragma omp parallel for
+            for (long i = 0; i < n; i++)
+            {
+                ElemType g = gradientScale * grad[i] + l2Weight * val[i];
+                ElemType ada;
+                if (!update.adamax)
+                {
+                    ElemType adaSqr = adaWeight * smoothAda[i] + (1.0f - adaWeight) * g * g;
+                    smoothAda[i] = adaSqr;
+                    ada = sqrt(adaSqr);
+                }
+                else
+                    ada = smoothAda[i] = std::max(adaWeight * smoothAda[i], fabs_(g));
+
+                ElemType w = adaMul * (ElemType)(1.0 / (ada + epsilon));
+                g = momentum * smoothMom[i] + unitGainFactor * g;
+                smoothMom[i] = g;
+                val[i] -= g * w * learnRatePerSample;
+            }
+            break;
+        default:
+            LogicError("MultiTensorUpdate: Unknown update kind %d.", (int)update.kind);
+        }
+    }
+}
+
+// sum of the squares of the elements of a matrix, accumulated in double
+template <class ElemType>
+static double SumOfSquares(const CPUMatrix<ElemType>& matrix)
+{
+    double sum = 0;
+    const long n = (long)matrix.GetNumElements();
+    const ElemType* data = matrix.Data();
+#pragma omp parallel for reduction(+ : sum)
+    for (long i = 0; i < n; i++)
+    {
+        const double value = (double)data[i];
+        sum += value * value;
+    }
+    return sum;
+}
+
+template <class ElemType>
+/*static*/ ElemType CPUMatrix<ElemType>::MultiTensorSumOfSquares(const vector<const CPUMatrix<ElemType>*>& matrices)
+{
+    double sum = 0;
+    for (const auto& matrix : matrices)
+        sum += SumOfSquares(*matrix);
+    return (ElemType)sum;
+}
+
+template <class ElemType>
+/*static*/ void CPUMatrix<ElemType>::MultiTensorSumsOfSquares(const vector<const CPUMatrix<ElemType>*>& matrices, vector<ElemType>& sums)
+{
+    sums.clear();
+    for (const auto& matrix : matrices)
+        sums.push_back((ElemType)SumOfSquares(*matrix));
+}
+
 template <class ElemType>
 ElemType CPUMatrix<ElemType>::RmsProp(CPUMatrix<ElemType>& gradients,
                                       ElemType RMS_GAMMA,
@@ -1510,6 +1804,32 @@ void CPUMatrix<ElemType>::AdaDeltaFlushTimestamps(size_t cols, ElemType rho, int
     }
 }
 
+template <class ElemType>
+void CPUMatrix<ElemType>::LazyDecayFlushTimestamps(size_t cols, ElemType decay, ElemType secondDecay, int* timestamps, int currentTimestamp)
+{
+    // Sets all timestamps to 0 and decays the state of the lazy sparse updates as a dense implementation would have,
+    // i.e. the first 'cols' columns by decay ** (currentTimestamp - timestamp of the column) and the next ones, if any, by secondDecay.
+    auto rows = GetNumRows();
+    bool hasSecond = GetNumCols() >= 2 * cols;
+    auto first = Data();
+    auto second = Data() + cols * rows;
+#pragma omp parallel for
+    for (long col = 0; col < (long)cols; ++col)
+    {
+        double missed = currentTimestamp - timestamps[col];
+        ElemType firstFactor = (ElemType)std::pow((double)decay, missed);
+        ElemType secondFactor = (ElemType)std::pow((double)secondDecay, missed);
+        auto offset = rows * col;
+        timestamps[col] = 0;
+        for (size_t row = 0; row < rows; ++row)
+        {
+            first[offset + row] *= firstFactor;
+            if (hasSecond)
+                second[offset + row] *= secondFactor;
+        }
+    }
+}
+
 template <class ElemType>
 void CPUMatrix<ElemType>::Reshape(const size_t numRows, const size_t numCols)
 {
@@ -1549,10 +1869,10 @@ void CPUMatrix<ElemType>::Resize(const size_t numRows, const size_t numCols, boo
         ElemType* pArray = nullptr;
         if (numElements > 0)
         {
-            pArray = NewArray<ElemType>(numElements);
+            pArray = NewArray<ElemType>(numElements, /*isStorage=*/true);
         }
         // success: update the object
-        delete[] Buffer();
+        DeleteLargeArray(Buffer());
 
         SetBuffer(pArray, numElements * sizeof(ElemType));
         SetSizeAllocated(numElements);
@@ -2485,6 +2805,32 @@ CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignLogSoftmaxOf(const CPUMatrix<Ele
     return *this;
 }
 
+template <class ElemType>
+CPUMatrix<ElemType>& CPUMatrix<ElemType>::InplaceSegmentedLogSoftmax(const std::vector<int>& segmentOffsets)
+{
+    ElemType* data = Data();
+    const long numSegments = (long) segmentOffsets.size() - 1;
+#pragma omp parallel for
+    for (long k = 0; k < numSegments; k++)
+    {
+        ElemType* begin = data + segmentOffsets[k];
+        ElemType* end = data + segmentOffsets[k + 1];
+
+        ElemType maxV = *begin;
+        for (ElemType* p = begin; p != end; p++)
+            maxV = std::max(maxV, *p);
+
+        ElemType sum = 0;
+        for (ElemType* p = begin; p != end; p++)
+            sum += exp(*p -= maxV);
+        sum = log(sum);
+        for (ElemType* p = begin; p != end; p++)
+            *p -= sum;
+    }
+
+    return *this;
+}
+
 //[this]=hardmax([this])
 //the max element is 1 else is 0
 template <class ElemType>
@@ -3276,6 +3622,39 @@ CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignSumOfElements(const CPUMatrix<El
     return *this;
 }
 
+template <class ElemType>
+CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignHistogramOf(const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& bucketLimits)
+{
+    const size_t numLimits = bucketLimits.GetNumElements();
+    const ElemType* limits = bucketLimits.Data();
+    vector<double> counts(numLimits + 1, 0);
+    // as on the GPU, the minimum and maximum of no elements are +inf and -inf
+    double sum = 0, sumOfSquares = 0, minValue = numeric_limits<double>::infinity(), maxValue = -numeric_limits<double>::infinity();
+    const ElemType* data = a.Data();
+    for (size_t k = 0; k < a.GetNumElements(); k++)
+    {
+        double v = (double) data[k];
+        if (!std::isfinite(v))
+            continue;
+        counts[upper_bound(limits, limits + numLimits, data[k], [](ElemType x, ElemType limit) { return x <= limit; }) - limits]++;
+        sum += v;
+        sumOfSquares += v * v;
+        minValue = min(minValue, v);
+        maxValue = max(maxValue, v);
+    }
+
+    auto& us = *this;
+    us.RequireSize(numLimits + 5, 1);
+    for (size_t i = 0; i <= numLimits; i++)
+        us(i, 0) = (ElemType) counts[i];
+    us(numLimits + 1, 0) = (ElemType) sum;
+    us(numLimits + 2, 0) = (ElemType) sumOfSquares;
+    us(numLimits + 3, 0) = (ElemType) minValue;
+    us(numLimits + 4, 0) = (ElemType) maxValue;
+
+    return *this;
+}
+
 template <class ElemType>
 CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignOneHot(const CPUMatrix<ElemType>& a, vector<size_t>& shape, size_t axis)
 {
@@ -3312,26 +3691,33 @@ CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignOneHot(const CPUMatrix<ElemType>
 }
 
 template <class ElemType>
-CPUMatrix<ElemType>& CPUMatrix<ElemType>::GatherFromTarget(const CPUMatrix<ElemType>& indices, const CPUMatrix<ElemType>& target, size_t row_elements)
+CPUMatrix<ElemType>& CPUMatrix<ElemType>::GatherFromTarget(const CPUMatrix<ElemType>& indices, const CPUMatrix<ElemType>& target, size_t row_elements, size_t outer_elements/* = 1*/)
 {
     if (indices.IsEmpty() || target.IsEmpty())
         LogicError("GatherFromTarget: input matrix is empty.");
 
-    if (row_elements == 0)
+    if (row_elements == 0 || outer_elements == 0)
         LogicError("GatherFromTarget: target matrix at least need 1 dim.");
 
+    const size_t numIndexRows = indices.GetNumRows();
+    const size_t axisDim = target.GetNumElements() / (row_elements * outer_elements);
     auto nCols = indices.GetNumCols();
-    auto nRows = indices.GetNumRows() * row_elements;
+    auto nRows = numIndexRows * row_elements * outer_elements;
     this->RequireSize(nRows, nCols);
 
     ElemType* indicesBufPtr = indices.Data();
     ElemType* targetBufPtr = target.Data();
     ElemType* buffer = Data();
 
+    // index i = r + numIndexRows * j copies its slice from each of the outer_elements slices of the target
 #pragma omp parallel for
     for (int i = 0; i < indices.GetNumElements(); i++)
     {
-        memcpy(buffer + i * row_elements, targetBufPtr + ((size_t)indicesBufPtr[i] * row_elements), sizeof(ElemType) * row_elements);
+        const size_t r = i % numIndexRows;
+        const size_t j = i / numIndexRows;
+        const size_t col = (size_t)indicesBufPtr[i];
+        for (size_t o = 0; o < outer_elements; o++)
+            memcpy(buffer + (r + numIndexRows * (o + outer_elements * j)) * row_elements, targetBufPtr + (col + axisDim * o) * row_elements, sizeof(ElemType) * row_elements);
     }
 
     return *this;
@@ -3339,7 +3725,7 @@ CPUMatrix<ElemType>& CPUMatrix<ElemType>::GatherFromTarget(const CPUMatrix<ElemT
 
 template <class ElemType>
 CPUMatrix<ElemType>& CPUMatrix<ElemType>::ScatterToIndices(const CPUMatrix<ElemType>& values, const CPUMatrix<ElemType>& indices, size_t row_elements,
-    const CPUMatrix<char>* mask/*= nullptr*/)
+    size_t outer_elements/* = 1*/, const CPUMatrix<char>* mask/*= nullptr*/)
 {
     if (indices.IsEmpty() || values.IsEmpty() || (mask && mask->IsEmpty()))
         LogicError("ScatterToIndices: input matrix is empty.");
@@ -3353,7 +3739,46 @@ CPUMatrix<ElemType>& CPUMatrix<ElemType>::ScatterToIndices(const CPUMatrix<ElemT
     ElemType* buffer = Data();
     size_t numElemsPerMaskEntry = mask ? indices.GetNumCols() / mask->GetNumCols() * indices.GetNumRows() : 0;
 
-    ScatterValues(indicesBufPtr, valueBufPtr, buffer, static_cast<ElemType>(1), indices.GetNumElements(), row_elements, this->GetNumCols(), maskBufPtr, numElemsPerMaskEntry);
+    if (outer_elements == 1)
+    {
+        ScatterValues(indicesBufPtr, valueBufPtr, buffer, static_cast<ElemType>(1), indices.GetNumElements(), row_elements, this->GetNumCols(), maskBufPtr, numElemsPerMaskEntry);
+        return *this;
+    }
+
+    // As ScatterValues(), but for an index into the middle axis of a [row_elements x axisDim x outer_elements] tensor.
+    // Each target index is owned by one thread, which adds its slices in the order of the indices.
+    const size_t numIndexRows = indices.GetNumRows();
+    const size_t numIndices = indices.GetNumElements();
+    const size_t axisDim = GetNumElements() / (row_elements * outer_elements);
+#pragma omp parallel
+    {
+        int ithread = omp_get_thread_num();
+        int nthread = omp_get_num_threads();
+        for (size_t i = 0; i < numIndices; i++)
+        {
+            auto col_r = indicesBufPtr[i];
+            if (std::isnan(col_r) || col_r < 0)
+                continue;
+            auto col = (size_t)col_r;
+            if (col % nthread != ithread)
+                continue;
+            if (maskBufPtr && maskBufPtr[i / numElemsPerMaskEntry] == 0)
+                continue;
+
+            if (col >= axisDim)
+                InvalidArgument("ScatterToIndices: Indices map out of bounds. %ld >= %ld", (long int)col, (long int)axisDim);
+
+            const size_t r = i % numIndexRows;
+            const size_t j = i / numIndexRows;
+            for (size_t o = 0; o < outer_elements; o++)
+            {
+                ElemType* data = buffer + (col + axisDim * o) * row_elements;
+                const ElemType* value = valueBufPtr + (r + numIndexRows * (o + outer_elements * j)) * row_elements;
+                for (size_t k = 0; k < row_elements; k++)
+                    data[k] += value[k];
+            }
+        }
+    }
 
     return *this;
 }
@@ -3867,6 +4292,27 @@ CPUMatrix<ElemType>& CPUMatrix<ElemType>::AddSignOf(const CPUMatrix<ElemType>& a
     return us;
 }
 //I decided to use CPUMatrix<ElemType>& maxIndexes instead of integer vector because the result may be used to do additional calculation
+// helper for the top k: the rows and values of the k largest elements of a column, where ties go to the lower row as in a stable sort
+template <class ElemType>
+static void SelectTopKOfColumn(const ElemType* curVal, int m, int topK, std::vector<int>& indices, ElemType* curIdx, ElemType* curMax)
+{
+    indices.resize(m);
+    std::iota(indices.begin(), indices.end(), 0);
+    // Partial sort, descending order.
+    std::partial_sort(indices.begin(), indices.begin() + topK, indices.end(),
+                        [curVal](const int& a, const int& b)
+                        {
+                            return curVal[a] > curVal[b] || (curVal[a] == curVal[b] && a < b);
+                        });
+    // REVIEW alexeyk: the following produces warning (see SCL_SECURE_NO_WARNINGS) so use loop instead.
+    // std::transform(indices.begin(), indices.begin() + topK, curIdx, [](const int& a) { return static_cast<ElemType>(a); });
+    for (int i2 = 0; i2 < topK; i2++)
+    {
+        curIdx[i2] = static_cast<ElemType>(indices[i2]);
+        curMax[i2] = curVal[indices[i2]];
+    }
+}
+
 template <class ElemType>
 void CPUMatrix<ElemType>::VectorMax(CPUMatrix<ElemType>& maxIndexes, CPUMatrix<ElemType>& maxValues, const bool isColWise, int topK) const
 {
@@ -3907,27 +4353,12 @@ void CPUMatrix<ElemType>::VectorMax(CPUMatrix<ElemType>& maxIndexes, CPUMatrix<E
         }
         else
         {
-            std::vector<int> indices(m);
-
-            const ElemType* curVal =            Data();
-            ElemType* curIdx       = maxIndexes.Data();
-            ElemType* curMax       =  maxValues.Data();
-            for (int icol = 0; icol < n; icol++, curVal += m, curIdx += topK, curMax += topK)
+#pragma omp parallel
             {
-                std::iota(indices.begin(), indices.end(), 0);
-                // Partial sort, descending order.
-                std::partial_sort(indices.begin(), indices.begin() + topK, indices.end(),
-                                    [curVal](const int& a, const int& b)
-                                    {
-                                        return curVal[a] > curVal[b];
-                                    });
-                // REVIEW alexeyk: the following produces warning (see SCL_SECURE_NO_WARNINGS) so use loop instead.
-                // std::transform(indices.begin(), indices.begin() + topK, curIdx, [](const int& a) { return static_cast<ElemType>(a); });
-                for (int i2 = 0; i2 < topK; i2++)
-                {
-                    curIdx[i2] = static_cast<ElemType>(indices[i2]);
-                    curMax[i2] = curVal[indices[i2]];
-                }
+                std::vector<int> indices;
+#pragma omp for
+                for (int icol = 0; icol < n; icol++)
+                    SelectTopKOfColumn(Data() + (size_t)icol * m, m, topK, indices, maxIndexes.Data() + (size_t)icol * topK, maxValues.Data() + (size_t)icol * topK);
             }
         }
     }
@@ -3958,6 +4389,45 @@ void CPUMatrix<ElemType>::VectorMax(CPUMatrix<ElemType>& maxIndexes, CPUMatrix<E
     }
 }
 
+// column-wise top k of the softmax, see Matrix<ElemType>::VectorTopKSoftmax()
+template <class ElemType>
+void CPUMatrix<ElemType>::VectorTopKSoftmax(CPUMatrix<ElemType>& topIndexes, CPUMatrix<ElemType>& topValues, CPUMatrix<ElemType>& logSumExp, int topK) const
+{
+    if (IsEmpty())
+        LogicError("VectorTopKSoftmax: Matrix is empty.");
+
+    const int m = (int) GetNumRows();
+    const int n = (int) GetNumCols();
+    if (topK <= 0 || topK > m)
+        InvalidArgument("VectorTopKSoftmax: TopK must be positive and less or equal than the number of rows");
+
+    topValues.RequireSize(topK, n);
+    topIndexes.RequireSize(topK, n);
+    logSumExp.RequireSize(1, n);
+
+#pragma omp parallel
+    {
+        std::vector<int> indices;
+#pragma omp for
+        for (int icol = 0; icol < n; icol++)
+        {
+            const ElemType* curVal = Data() + (size_t)icol * m;
+            ElemType* curMax = topValues.Data() + (size_t)icol * topK;
+            SelectTopKOfColumn(curVal, m, topK, indices, topIndexes.Data() + (size_t)icol * topK, curMax);
+
+            // the largest element is the first of the top k
+            ElemType maxVal = curMax[0];
+            ElemType sum = 0;
+            for (int i = 0; i < m; i++)
+                sum += exp_(curVal[i] - maxVal);
+            ElemType lse = maxVal + log_(sum);
+            logSumExp(0, icol) = lse;
+            for (int i2 = 0; i2 < topK; i2++)
+                curMax[i2] = exp_(curMax[i2] - lse);
+        }
+    }
+}
+
 template <class ElemType>
 void CPUMatrix<ElemType>::VectorMin(CPUMatrix<ElemType>& minIndexes, CPUMatrix<ElemType>& minValues, const bool isColWise) const
 {
@@ -4016,6 +4486,52 @@ void CPUMatrix<ElemType>::VectorMin(CPUMatrix<ElemType>& minIndexes, CPUMatrix<E
     }
 }
 
+// Moves the k elements of the largest magnitude out of the matrix, as (linear index, value) pairs, and zeroes them in place.
+template <class ElemType>
+void CPUMatrix<ElemType>::ExtractTopKMagnitudes(size_t k, std::vector<int>& indices, std::vector<ElemType>& values)
+{
+    if (IsEmpty())
+        LogicError("ExtractTopKMagnitudes: Matrix is empty.");
+    if (k > GetNumElements())
+        InvalidArgument("ExtractTopKMagnitudes: k (%d) exceeds the number of elements (%d).", (int) k, (int) GetNumElements());
+
+    ElemType* data = Data();
+    std::vector<int> order(GetNumElements());
+    std::iota(order.begin(), order.end(), 0);
+    // Ties are broken by the index, so that the selection does not depend on the implementation of nth_element().
+    auto larger = [data](int a, int b)
+    {
+        auto magnitudeA = fabs_(data[a]);
+        auto magnitudeB = fabs_(data[b]);
+        return magnitudeA > magnitudeB || (magnitudeA == magnitudeB && a < b);
+    };
+    if (k < order.size())
+        std::nth_element(order.begin(), order.begin() + k, order.end(), larger);
+
+    indices.assign(order.begin(), order.begin() + k);
+    values.resize(k);
+    for (size_t i = 0; i < k; i++)
+    {
+        values[i] = data[indices[i]];
+        data[indices[i]] = 0;
+    }
+}
+
+// Adds the values at the given linear indices; repeated indices accumulate.
+template <class ElemType>
+void CPUMatrix<ElemType>::ScatterAddValues(const std::vector<int>& indices, const std::vector<ElemType>& values)
+{
+    if (indices.size() != values.size())
+        InvalidArgument("ScatterAddValues: The number of indices (%d) and values (%d) differ.", (int) indices.size(), (int) values.size());
+
+    ElemType* data = Data();
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        assert(indices[i] >= 0 && indices[i] < GetNumElements());
+        data[indices[i]] += values[i];
+    }
+}
+
 template <class ElemType>
 CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignNumOfDiff(const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& b, bool searchInCol)
 {
@@ -4775,14 +5291,13 @@ void CPUMatrix<ElemType>::MaxPoolingBackward(const CPUMatrix<ElemType>& out, con
 
 // For each image, for each ROI, this function treats that ROI as an image
 // and does max pooling so that it has output size pooledHeight x pooledWidth.
-// It loops over each location in the output tensor, computes which ROI
-// and image should populate that location, computes the subset of the image
-// corresponding to the ROI and which pixels in that subset should go into the
+// It loops over all ROIs of the minibatch, computes the subset of the image
+// corresponding to the ROI and which pixels in that subset should go into each
 // output location, then takes the max value over that window.
 // src: Images              [W x H x C x N]
 // roiData: ROIs            [4 x numROIs x N],
 // dst: Pooled ROIs         [PW x PH x C x numROIs x N]
-// argmax: max positions    [PW x PH x C x numROIs x N]
+// argmax: max positions    [PW x PH x C x numROIs x N], -1 for empty windows
 // spatialScale             ratio of input feature map to the original image.
 // where PW = Pooled Width, PH = Pooled Height, C = Channels, N = Batch Size
 template <class ElemType>
@@ -4792,194 +5307,230 @@ void CPUMatrix<ElemType>::MaxROIPoolingForward(const size_t numRois, const size_
 {
     size_t roiOutputSize = pooledHeight * pooledWidth * channels;
 
+    // one iteration per ROI of the minibatch
 #pragma omp parallel for
-    for (int imgIdx = 0; imgIdx < numImg; imgIdx++)
+    for (int i = 0; i < (int)(numImg * numRois); i++)
     {
-        auto img = ColumnSlice(imgIdx, 1);
-        auto rois = roiData.ColumnSlice(imgIdx, 1);
-#pragma omp parallel for
-        for (int roiIdx = 0; roiIdx < numRois; roiIdx++)
-        {
-            // each ROI is 4 elements: (x, y, w, h).
-            int base = roiIdx * 4;
-
-            // roi points represent the absolute location of the roi
-            // in the original image.
-            ElemType scX1 = rois(base, (ElemType)0);
-            ElemType scY1 = rois(base + (ElemType)1, (ElemType)0);
-            ElemType scX2 = rois(base + (ElemType)2, (ElemType)0);
-            ElemType scY2 = rois(base + (ElemType)3, (ElemType)0);
+        size_t imgIdx = i / numRois;
+        size_t roiIdx = i % numRois;
+        const ElemType* img = Data() + imgIdx * GetNumRows();
+        // each ROI is 4 elements: (x1, y1, x2, y2).
+        const ElemType* roi = roiData.Data() + imgIdx * roiData.GetNumRows() + roiIdx * 4;
 
-            // compute actual spatial location of the ROI in our featuremap.
-            size_t x1 = (size_t)round(scX1 * spatialScale);
-            size_t y1 = (size_t)round(scY1 * spatialScale);
-            size_t x2 = (size_t)round(scX2 * spatialScale);
-            size_t y2 = (size_t)round(scY2 * spatialScale);
+        // roi points represent the absolute location of the roi
+        // in the original image. Compute actual spatial location of the ROI in our featuremap.
+        int x1 = (int)round((double)roi[0] * spatialScale);
+        int y1 = (int)round((double)roi[1] * spatialScale);
+        int x2 = (int)round((double)roi[2] * spatialScale);
+        int y2 = (int)round((double)roi[3] * spatialScale);
 
-            ElemType roiW = (ElemType)max(x2 - x1 + 1, (size_t)1);
-            ElemType roiH = (ElemType)max(y2 - y1 + 1, (size_t)1);
+        double winW = (double)max(x2 - x1 + 1, 1) / pooledWidth;
+        double winH = (double)max(y2 - y1 + 1, 1) / pooledHeight;
 
-            const ElemType winW = roiW / (ElemType)pooledWidth;
-            const ElemType winH = roiH / (ElemType)pooledHeight;
-
-            // inspired by Ross Girshick fast-rcnn caffe cpu: https://github.com/rbgirshick/fast-rcnn
-            // loop over spatial locations in output.
-#pragma omp parallel for
-            for (int outw = 0; outw < pooledWidth; outw++)
+        // inspired by Ross Girshick fast-rcnn caffe cpu: https://github.com/rbgirshick/fast-rcnn
+        // loop over spatial locations in output.
+        for (size_t outh = 0; outh < pooledHeight; outh++)
+        {
+            for (size_t outw = 0; outw < pooledWidth; outw++)
             {
-                for (int outh = 0; outh < pooledHeight; outh++)
-                {
-                    // compute the top left corner of the input
-                    // spatial window corresponding to this output unit
-                    size_t hstart = (size_t)floor(outh * winH);
-                    size_t wstart = (size_t)floor(outw * winW);
+                // compute the window of the input corresponding to this output unit,
+                // offset by the ROI top left corner and clipped to the input.
+                int hstart = min(max((int)floor(outh * winH) + y1, 0), (int)height);
+                int wstart = min(max((int)floor(outw * winW) + x1, 0), (int)width);
+                int hend = min(max((int)ceil((outh + 1) * winH) + y1, 0), (int)height);
+                int wend = min(max((int)ceil((outw + 1) * winW) + x1, 0), (int)width);
 
-                    // compute bottom right corner (not included)
-                    size_t hend = (size_t)ceil((outh + 1) * winH);
-                    size_t wend = (size_t)ceil((outw + 1) * winW);
+                bool isempty = (hend <= hstart) || (wend <= wstart);
 
-                    // offset window based on ROI top left corner.
-                    // these indices are into the input slice.
-                    hstart = min(max(hstart + y1, (size_t)0), height);
-                    wstart = min(max(wstart + x1, (size_t)0), width);
-                    hend = min(max(hend + y1, (size_t)0), height);
-                    wend = min(max(wend + x1, (size_t)0), width);
-
-                    bool isempty = (hend <= hstart) || (wend <= wstart);
+                for (size_t c = 0; c < channels; c++)
+                {
+                    // [W x H x C x R x N]; R = ROIs per image
+                    size_t outputIdx = roiIdx * roiOutputSize + outw + outh * pooledWidth + c * pooledHeight * pooledWidth;
+                    int maxidx = -1;
+                    ElemType maxval = isempty ? (ElemType)0 : (ElemType)-FLT_MAX;
+                    const ElemType* plane = img + c * height * width;
 
-                    for (size_t c = 0; c < channels; c++)
+                    for (int h = hstart; h < hend; h++)
                     {
-                        // [W x H x C x R x N]; R = ROIs per image
-                        size_t outputIdx = roiIdx * roiOutputSize + outw + outh * pooledWidth + c * pooledHeight * pooledWidth;
-                        size_t maxidx = 0;
-                        ElemType maxval = isempty ? (ElemType)0 : (ElemType)-FLT_MAX;
-                        size_t baseIdx = c * height * width;
-
-                        for (size_t h = hstart; h < hend; h++)
+                        for (int w = wstart; w < wend; w++)
                         {
-                            for (size_t w = wstart; w < wend; w++)
+                            // stored argmax indices are relative to the current channel.
+                            int dataIdx = w + h * (int)width;
+                            if (plane[dataIdx] > maxval)
                             {
-                                // stored argmax indices are relative to the current channel.
-                                size_t dataIdx = w + h * width;
-                                if (img(baseIdx + dataIdx, 0) > maxval)
-                                {
-                                    maxval = img(baseIdx + dataIdx, 0);
-                                    maxidx = dataIdx;
-                                }
+                                maxval = plane[dataIdx];
+                                maxidx = dataIdx;
                             }
                         }
-                        output(outputIdx, imgIdx) = maxval;
-                        argmax(outputIdx, imgIdx) = maxidx;
                     }
+                    output(outputIdx, imgIdx) = maxval;
+                    argmax(outputIdx, imgIdx) = (ElemType)maxidx;
                 }
             }
         }
     }
 }
 
-// This function loops over locations in the input to the ROIPoolingNode (image locations).
-// It loops over the ROIs corresponding to that image, seeing which ones could contain the current location
-// in their output. For each ROI, it checks the argmax data to see if that ROI indeed chose
-// this pixel location as the maximum. If so, it increments the gradient term for the input location.
+// Each iteration owns one channel of one image of the gradient, so that it can add
+// the gradients of all ROIs of the image to their argmax locations without atomics.
 template <class ElemType>
 void CPUMatrix<ElemType>::MaxROIPoolingBackward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
                                                 const size_t pooledWidth, const size_t pooledHeight, const CPUMatrix<ElemType>& roiData, CPUMatrix<ElemType>& grad,
                                                 CPUMatrix<ElemType>& argmax, double spatialScale) const
 {
-    // loop over images in the batch.
-#pragma omp parallel for
-    for (int imgIdx = 0; imgIdx < numImg; imgIdx++)
-    {
-        // ROIs for this image. length 4*numRois;
-        auto rois = roiData.ColumnSlice(imgIdx, 1).Data();
-        // gradient values for all ROIs from this image. length numRois*pooledHeight*pooledWidth*channels;
-        auto pooledGrad = ColumnSlice(imgIdx, 1).Data();
-        auto argmaxCol = argmax.ColumnSlice(imgIdx, 1).Data();
+    UNUSED(roiData); UNUSED(spatialScale);
+    size_t pooledSize = pooledWidth * pooledHeight;
 
-        // loop over spatial locations in the image.
 #pragma omp parallel for
-        for (int w = 0; w < width; w++)
+    for (int i = 0; i < (int)(numImg * channels); i++)
+    {
+        size_t imgIdx = i / channels;
+        size_t c = i % channels;
+        // [W x H x C x N]
+        ElemType* gradPlane = grad.Data() + imgIdx * grad.GetNumRows() + c * height * width;
+        // [PW x PH x C x R x N]
+        const ElemType* pooledGrad = Data() + imgIdx * GetNumRows();
+        const ElemType* argmaxCol = argmax.Data() + imgIdx * argmax.GetNumRows();
+        for (size_t roiN = 0; roiN < numRois; roiN++)
         {
-#pragma omp parallel for
-            for (int h = 0; h < width; h++)
+            size_t offset = (roiN * channels + c) * pooledSize;
+            for (size_t j = offset; j < offset + pooledSize; j++)
             {
-                // loop over the ROIs seeing which ones contain this location.
-                for (int roiN = 0; roiN < numRois; roiN++)
-                {
-                    // each ROI is 4 elements: (x, y, w, h).
-                    int roiOffset = roiN * 4;
-
-                    // ROI data points represent the absolute location of the roi
-                    // in the original image.
-                    size_t roiStartW = (size_t)round(rois[roiOffset + 0] * spatialScale);
-                    size_t roiStartH = (size_t)round(rois[roiOffset + 1] * spatialScale);
-                    size_t roiEndW = (size_t)round(rois[roiOffset + 2] * spatialScale);
-                    size_t roiEndH = (size_t)round(rois[roiOffset + 3] * spatialScale);
-
-                    size_t roiWidth = max(roiEndW - roiStartW + 1, (size_t)1);
-                    size_t roiHeight = max(roiEndH - roiStartH + 1, (size_t)1);
-
-                    // skip this ROI if it doesn't contain the current input location.
-                    const bool inROI = (w >= roiStartW && w < roiStartW + roiWidth &&
-                        h >= roiStartH && h < roiStartH + roiHeight);
-                    if (!inROI)
-                        continue;
-
-                    ElemType winH = (ElemType)roiHeight / (ElemType)pooledHeight;
-                    ElemType winW = (ElemType)roiWidth / (ElemType)pooledWidth;
-
-                    // what pooled nodes in the output for this ROI could have pooled this input location?
-                    size_t phstart = (size_t)((h - roiStartH) / winH);
-                    size_t pwstart = (size_t)((w - roiStartW) / winW);
-                    size_t phend = (size_t)(ceil((h - roiStartH + 1) / winH));
-                    size_t pwend = (size_t)(ceil((w - roiStartW + 1) / winW));
-
-                    phstart = min(max(phstart, (size_t)0), pooledHeight);
-                    phend = min(max(phend, (size_t)0), pooledHeight);
-                    pwstart = min(max(pwstart, (size_t)0), pooledWidth);
-                    pwend = min(max(pwend, (size_t)0), pooledWidth);
-
-                    for (size_t c = 0; c < channels; c++)
-                    {
-                        ElemType gradient = 0;
-                        // [W x H x C x N]
-                        size_t index = w + h*width + c*height*width;
-                        // go right up to channel c of the current ROI.
-                        size_t offset = (roiN * channels + c) * pooledWidth * pooledHeight;
-                        const ElemType* offsetPoolGrad = pooledGrad + offset;
-                        const ElemType* offsetArgmax = argmaxCol + offset;
-                        for (size_t ph = phstart; ph < phend; ph++)
-                        {
-                            for (size_t pw = pwstart; pw < pwend; pw++)
-                            {
-                                if ((size_t)offsetArgmax[ph * pooledWidth + pw] == (w + h * width))
-                                {
-                                    gradient += offsetPoolGrad[ph * pooledWidth + pw];
-                                }
-                            }
-                        }
-
-#pragma omp atomic
-                        grad(index, imgIdx) += gradient;
-                    }
-                }
+                int index = (int)argmaxCol[j];
+                if (index >= 0)
+                    gradPlane[index] += pooledGrad[j];
             }
         }
     }
 }
 
-template <class ElemType>
-void CPUMatrix<ElemType>::MaxUnpooling(const CPUMatrix<int>& mpRowCol, const CPUMatrix<int>& mpRowIndices,
-                                       const CPUMatrix<int>& indices, const CPUMatrix<ElemType>& poolInput,
-                                       CPUMatrix<ElemType>& input) const
+// ROI align (Mask R-CNN): as max ROI pooling, but the ROI and its bins are not quantized. Each output
+// averages samplesW x samplesH points of its bin, with samplesW = ceil(bin width) (same for the height),
+// and each point is bilinearly interpolated from the 4 neighboring input locations.
+// This calls 'f(index, weight)' for the input locations of the output (pw, ph) of the ROI (x1, y1, x2, y2).
+template <class F>
+static void ForEachROIAlignSample(const double roi[4], size_t pw, size_t ph, size_t pooledWidth, size_t pooledHeight,
+                                  size_t width, size_t height, const F& f)
 {
-#pragma omp parallel for
-    for (int64_t sample = 0; sample < (int64_t)GetNumCols(); sample++)
+    double binW = max(roi[2] - roi[0], 1.0) / pooledWidth;
+    double binH = max(roi[3] - roi[1], 1.0) / pooledHeight;
+    int samplesW = max((int)ceil(binW), 1);
+    int samplesH = max((int)ceil(binH), 1);
+    double count = samplesW * samplesH;
+    for (int iy = 0; iy < samplesH; iy++)
     {
-        for (size_t row = 0; row < GetNumRows(); row++)
+        double y = roi[1] + ph * binH + (iy + 0.5) * binH / samplesH;
+        for (int ix = 0; ix < samplesW; ix++)
         {
-            int colBase = mpRowCol(row, 0);
-            assert(0 <= colBase && colBase < input.GetNumRows());
+            double x = roi[0] + pw * binW + (ix + 0.5) * binW / samplesW;
+            // points outside of the image do not contribute
+            if (y < -1 || y > height || x < -1 || x > width)
+                continue;
+            double yc = max(y, 0.0);
+            double xc = max(x, 0.0);
+            int y0 = (int)yc, x0 = (int)xc, y1, x1;
+            if (y0 >= (int)height - 1)
+                y0 = y1 = (int)height - 1, yc = y0;
+            else
+                y1 = y0 + 1;
+            if (x0 >= (int)width - 1)
+                x0 = x1 = (int)width - 1, xc = x0;
+            else
+                x1 = x0 + 1;
+            double ly = yc - y0, lx = xc - x0;
+            f(y0 * width + x0, (1 - ly) * (1 - lx) / count);
+            f(y0 * width + x1, (1 - ly) * lx / count);
+            f(y1 * width + x0, ly * (1 - lx) / count);
+            f(y1 * width + x1, ly * lx / count);
+        }
+    }
+}
+
+// src: Images              [W x H x C x N]
+// roiData: ROIs            [4 x numROIs x N],
+// dst: Pooled ROIs         [PW x PH x C x numROIs x N]
+template <class ElemType>
+void CPUMatrix<ElemType>::AverageROIAlignForward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
+                                                const size_t pooledWidth, const size_t pooledHeight, const CPUMatrix<ElemType>& roiData, CPUMatrix<ElemType>& output,
+                                                double spatialScale) const
+{
+    size_t pooledSize = pooledWidth * pooledHeight;
+
+    // one iteration per ROI of the minibatch
+#pragma omp parallel for
+    for (int i = 0; i < (int)(numImg * numRois); i++)
+    {
+        size_t imgIdx = i / numRois;
+        size_t roiIdx = i % numRois;
+        const ElemType* img = Data() + imgIdx * GetNumRows();
+        ElemType* out = output.Data() + imgIdx * output.GetNumRows() + roiIdx * pooledSize * channels;
+        double roi[4];
+        for (size_t k = 0; k < 4; k++)
+            roi[k] = (double)roiData(roiIdx * 4 + k, imgIdx) * spatialScale;
+
+        for (size_t c = 0; c < channels; c++)
+        {
+            const ElemType* plane = img + c * height * width;
+            for (size_t ph = 0; ph < pooledHeight; ph++)
+            {
+                for (size_t pw = 0; pw < pooledWidth; pw++)
+                {
+                    double sum = 0;
+                    ForEachROIAlignSample(roi, pw, ph, pooledWidth, pooledHeight, width, height,
+                                          [&](size_t index, double weight) { sum += weight * (double)plane[index]; });
+                    out[c * pooledSize + ph * pooledWidth + pw] = (ElemType)sum;
+                }
+            }
+        }
+    }
+}
+
+// As for max ROI pooling, each iteration owns one channel of one image of the gradient.
+template <class ElemType>
+void CPUMatrix<ElemType>::AverageROIAlignBackward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
+                                                 const size_t pooledWidth, const size_t pooledHeight, const CPUMatrix<ElemType>& roiData, CPUMatrix<ElemType>& grad,
+                                                 double spatialScale) const
+{
+    size_t pooledSize = pooledWidth * pooledHeight;
+
+#pragma omp parallel for
+    for (int i = 0; i < (int)(numImg * channels); i++)
+    {
+        size_t imgIdx = i / channels;
+        size_t c = i % channels;
+        ElemType* gradPlane = grad.Data() + imgIdx * grad.GetNumRows() + c * height * width;
+        const ElemType* pooledGrad = Data() + imgIdx * GetNumRows();
+        for (size_t roiN = 0; roiN < numRois; roiN++)
+        {
+            double roi[4];
+            for (size_t k = 0; k < 4; k++)
+                roi[k] = (double)roiData(roiN * 4 + k, imgIdx) * spatialScale;
+            const ElemType* g = pooledGrad + (roiN * channels + c) * pooledSize;
+            for (size_t ph = 0; ph < pooledHeight; ph++)
+            {
+                for (size_t pw = 0; pw < pooledWidth; pw++)
+                {
+                    double value = (double)g[ph * pooledWidth + pw];
+                    ForEachROIAlignSample(roi, pw, ph, pooledWidth, pooledHeight, width, height,
+                                          [&](size_t index, double weight) { gradPlane[index] = (ElemType)((double)gradPlane[index] + weight * value); });
+                }
+            }
+        }
+    }
+}
+
+template <class ElemType>
+void CPUMatrix<ElemType>::MaxUnpooling(const CPUMatrix<int>& mpRowCol, const CPUMatrix<int>& mpRowIndices,
+                                       const CPUMatrix<int>& indices, const CPUMatrix<ElemType>& poolInput,
+                                       CPUMatrix<ElemType>& input) const
+{
+#pragma omp parallel for
+    for (int64_t sample = 0; sample < (int64_t)GetNumCols(); sample++)
+    {
+        for (size_t row = 0; row < GetNumRows(); row++)
+        {
+            int colBase = mpRowCol(row, 0);
+            assert(0 <= colBase && colBase < input.GetNumRows());
 
             int i0 = mpRowIndices(row, 0);
             int size = indices(i0++, 0);
@@ -5131,6 +5682,118 @@ void CPUMatrix<ElemType>::BatchNormalizationBackward(const CPUMatrix<ElemType>&
     RuntimeError("Batch normalization training on CPU is not yet implemented.");
 }
 
+// Normalizes each column over its rows, with statistics from Welford's single pass over the column.
+template <class ElemType>
+void CPUMatrix<ElemType>::LayerNormalizationForward(const CPUMatrix<ElemType>& scale, const CPUMatrix<ElemType>& bias, double epsilon, CPUMatrix<ElemType>& out,
+                                                    CPUMatrix<ElemType>& saveMean, CPUMatrix<ElemType>& saveInvStdDev) const
+{
+    if (scale.GetNumElements() != GetNumRows() || bias.GetNumElements() != GetNumRows())
+        LogicError("LayerNormalizationForward: The scale and bias must have as many elements as the matrix has rows.");
+
+    const long numRows = (long)GetNumRows();
+    const long numCols = (long)GetNumCols();
+    out.RequireSize(numRows, numCols);
+    saveMean.RequireSize(1, numCols);
+    saveInvStdDev.RequireSize(1, numCols);
+
+    const ElemType* scaleData = scale.Data();
+    const ElemType* biasData = bias.Data();
+#pragma omp parallel for
+    for (long j = 0; j < numCols; j++)
+    {
+        const ElemType* x = Data() + j * numRows;
+        double mean = 0;
+        double m2 = 0;
+        for (long i = 0; i < numRows; i++)
+        {
+            double value = (double)x[i];
+            double delta = value - mean;
+            mean += delta / (i + 1);
+            m2 += delta * (value - mean);
+        }
+        double invStdDev = 1 / sqrt(m2 / numRows + epsilon);
+
+        ElemType* y = out.Data() + j * numRows;
+        for (long i = 0; i < numRows; i++)
+            y[i] = (ElemType)(((double)x[i] - mean) * invStdDev * (double)scaleData[i] + (double)biasData[i]);
+        saveMean(0, j) = (ElemType)mean;
+        saveInvStdDev(0, j) = (ElemType)invStdDev;
+    }
+}
+
+// this is the gradient of the output. With g = outGrad .* scale and the normalized input xHat, the gradient of a column
+// of the input is invStdDev * (g - mean(g) - xHat * mean(g .* xHat)), which is added to 'grad'.
+template <class ElemType>
+void CPUMatrix<ElemType>::LayerNormalizationBackward(const CPUMatrix<ElemType>& in, CPUMatrix<ElemType>& grad, const CPUMatrix<ElemType>& scale,
+                                                     const CPUMatrix<ElemType>& saveMean, const CPUMatrix<ElemType>& saveInvStdDev,
+                                                     CPUMatrix<ElemType>& scaleGrad, CPUMatrix<ElemType>& biasGrad) const
+{
+    if (in.GetNumRows() != GetNumRows() || in.GetNumCols() != GetNumCols() || grad.GetNumRows() != GetNumRows() || grad.GetNumCols() != GetNumCols())
+        LogicError("LayerNormalizationBackward: The input, its gradient and the output gradient must have the same dimensions.");
+    if (scale.GetNumElements() != GetNumRows() || saveMean.GetNumElements() != GetNumCols() || saveInvStdDev.GetNumElements() != GetNumCols())
+        LogicError("LayerNormalizationBackward: The scale or the saved statistics do not match the dimensions of the matrix.");
+
+    const long numRows = (long)GetNumRows();
+    const long numCols = (long)GetNumCols();
+    const ElemType* scaleData = scale.Data();
+    const ElemType* meanData = saveMean.Data();
+    const ElemType* invStdDevData = saveInvStdDev.Data();
+
+#pragma omp parallel for
+    for (long j = 0; j < numCols; j++)
+    {
+        const ElemType* dy = Data() + j * numRows;
+        const ElemType* x = in.Data() + j * numRows;
+        ElemType* dx = grad.Data() + j * numRows;
+        const double mean = (double)meanData[j];
+        const double invStdDev = (double)invStdDevData[j];
+
+        double sum = 0;
+        double productSum = 0;
+        for (long i = 0; i < numRows; i++)
+        {
+            double g = (double)dy[i] * (double)scaleData[i];
+            sum += g;
+            productSum += g * ((double)x[i] - mean) * invStdDev;
+        }
+        const double meanOfG = sum / numRows;
+        const double meanOfProduct = productSum / numRows;
+        for (long i = 0; i < numRows; i++)
+        {
+            double g = (double)dy[i] * (double)scaleData[i];
+            double normalized = ((double)x[i] - mean) * invStdDev;
+            dx[i] = (ElemType)((double)dx[i] + invStdDev * (g - meanOfG - normalized * meanOfProduct));
+        }
+    }
+
+    scaleGrad.RequireSize(scale.GetNumRows(), scale.GetNumCols());
+    biasGrad.RequireSize(scale.GetNumRows(), scale.GetNumCols());
+    ElemType* scaleGradData = scaleGrad.Data();
+    ElemType* biasGradData = biasGrad.Data();
+#pragma omp parallel for
+    for (long i = 0; i < numRows; i++)
+    {
+        double scaleSum = 0;
+        double biasSum = 0;
+        for (long j = 0; j < numCols; j++)
+        {
+            double g = (double)Data()[i + j * numRows];
+            scaleSum += g * ((double)in.Data()[i + j * numRows] - (double)meanData[j]) * (double)invStdDevData[j];
+            biasSum += g;
+        }
+        scaleGradData[i] = (ElemType)scaleSum;
+        biasGradData[i] = (ElemType)biasSum;
+    }
+}
+
+template <class ElemType>
+void CPUMatrix<ElemType>::RNNForward(const CPUMatrix<ElemType>& inputX, const CPUMatrix<ElemType>& paramW, size_t xDim, size_t yDim, const std::vector<size_t>& numSequencesForFrame,
+                                     const RnnAttributes& rnnAttributes, CPUMatrix<ElemType>& workspace)
+{
+    // the executor keeps no state between calls, unlike the one of cuDNN
+    CPURNNExecutor<ElemType>(xDim, yDim, rnnAttributes).ForwardCore(paramW, inputX, *this, numSequencesForFrame, workspace);
+}
+
 
 #pragma region Static BLAS Functions
 
@@ -6508,10 +7171,10 @@ void CPUMatrix<ElemType>::RCRFBackwardCompute(const CPUMatrix<ElemType>& alpha,
     }
 };
 
-// Calculate alpha in forward-backward calculation. equation (6), (7) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
-// GPU x dimension corresponds to utterances, y dimension corresponds to phone sequence in each utterance
+// Calculate alpha or beta in forward-backward calculation, equations (6), (7), (10) and (11) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf,
+// for all frames of one utterance. The utterances are independent, so they are processed in parallel.
 // prob (input): the posterior output from the network
-// alpha (output): alpha for forward-backward calculation.
+// score (output): alpha, or beta if !isAlpha, for forward-backward calculation.
 // phoneSeq (input): phone ID sequence for each utterance in this minibatch, each col is one utterance
 // phoneBound (input): phone boundary (frame index) of each phone for each utterance in this minibatch, each col is one utterance
 // uttToChanInd (input):  map from utterance ID to minibatch channel ID. We need this because each channel may contain more than one utterance.
@@ -6519,8 +7182,7 @@ void CPUMatrix<ElemType>::RCRFBackwardCompute(const CPUMatrix<ElemType>& alpha,
 // uttBeginFrame(input): the position of the first frame of each utterance in the minibatch channel. We need this because each channel may contain more than one utterance.
 // uttPhoneNum (input): the phone number of each utterance. The size of this vector =  the number of all utterances in this minibatch
 // numChannels (input): channel number in this minibatch
-// uttNum (input): number of utterances
-// t (input): time stamp to process
+// uttId (input): the utterance to process
 // maxPhoneNum (input): the max number of phones between utterances
 // totalPhoneNum (input): the total number of phones of all utterances
 // blankTokenId (input): id of the CTC blank token
@@ -6529,204 +7191,78 @@ void CPUMatrix<ElemType>::RCRFBackwardCompute(const CPUMatrix<ElemType>& alpha,
 //      Setting this parameter smaller will result in shorted delay between label output during decoding.
 //      delayConstraint=-1 means no constraint
 template<class ElemType>
-void _assignAlphaScore(
+void _assignAlphaBetaScores(
     const ElemType *prob,
-    ElemType *alphaScore,
-    ElemType *phoneSeq,
-    ElemType *phoneBound,
+    ElemType *score,
+    const bool isAlpha,
+    const ElemType *phoneSeq,
+    const ElemType *phoneBound,
     const std::vector<size_t>& uttToChanInd,
     const std::vector<size_t>& uttFrameNum,
     const std::vector<size_t>& uttBeginFrame,
     const std::vector<size_t>& uttPhoneNum,
-    size_t numChannels,
-    const size_t uttNum,
-    const size_t  t,
-    const size_t maxPhoneNum, // Maximum length of utterance in this MB
-    const size_t totalPhoneNum, // Total number of phones
+    const size_t numChannels,
+    const size_t uttId,
+    const size_t maxPhoneNum,
+    const size_t totalPhoneNum,
     const size_t blankTokenId,
     const int delayConstraint)
 {
-    for (size_t uttId = 0;uttId < uttNum;uttId++) {
-
-        // Number of phones and frames in this utterance
-        size_t frameNum = uttFrameNum[uttId];
-        if (t >= frameNum) continue;
-
-        size_t phoneNum = uttPhoneNum[uttId];
+    const size_t phoneNum = uttPhoneNum[uttId];
+    const size_t frameNum = uttFrameNum[uttId];
+    const ElemType* uttPhoneSeq = phoneSeq + uttId * maxPhoneNum;
+    const ElemType* uttPhoneBound = phoneBound + uttId * maxPhoneNum;
 
-#pragma omp parallel for
-        for (int phoneSeqId = 1;phoneSeqId < phoneNum - 1;phoneSeqId++) {
-            // Index of the label in the sequence
-
-            // Current and previous phone indices in phoneSeq matrix
-            size_t labelid = uttId*maxPhoneNum + phoneSeqId;
-
-            // Actual current phone label
-            size_t phoneId = (size_t)(phoneSeq[labelid]);
-
-            // Index of the current frame in minibatch
-            size_t timeId = (t + uttBeginFrame[uttId])*numChannels + uttToChanInd[uttId];
+    for (size_t step = 0; step < frameNum; step++)
+    {
+        const size_t t = isAlpha ? step : frameNum - 1 - step;
 
-            // Index of probability of observing phoneId at frame timeId
-            size_t probId = timeId*totalPhoneNum + phoneId;
+        // Index of the current frame in minibatch, and of the frame the recursion comes from
+        const size_t timeId = (t + uttBeginFrame[uttId]) * numChannels + uttToChanInd[uttId];
+        const ElemType* prevScore = score + (isAlpha ? timeId - numChannels : timeId + numChannels) * maxPhoneNum;
 
-            size_t alphaId = maxPhoneNum* timeId + phoneSeqId; // alpha_t(s)
+        for (size_t s = 1; s < phoneNum - 1; s++)
+        {
+            // Actual current phone label, and the probability of observing it at this frame
+            const size_t phoneId = (size_t)(uttPhoneSeq[s]);
+            const ElemType ascore = phoneId != SIZE_MAX ? prob[timeId * totalPhoneNum + phoneId] : (ElemType)0;
 
-            if (t == 0)
+            ElemType x = LZERO;
+            if (step == 0)
             {
                 // Initialize recursion
-                if (phoneSeqId == 1 || phoneSeqId == 2)
-                {
-                    alphaScore[alphaId] = prob[probId];
-                }
+                if (isAlpha ? (s == 1 || s == 2) : (s == phoneNum - 3 || s == phoneNum - 2))
+                    x = ascore;
             }
             else
             {
-                if (phoneSeqId >= 1)
+                // if current label is not blank and not equal the neighboring non-blank label, the recursion may skip the blank in between
+                if (isAlpha)
                 {
-                    size_t timeId_1 = timeId - numChannels; // Index corresponding to (t-1)
-                    size_t alphaId_0 = maxPhoneNum* timeId_1 + phoneSeqId; // alpha_{t-1}(s)
-                    size_t alphaId_1 = alphaId_0 - 1; // alpha_{t-1}(s-1)
-                    size_t alphaId_2 = alphaId_0 - 2; // alpha_{t-1}(s-2)
-                    ElemType x = LZERO;
-
-                    ElemType ascore;
-                    if (phoneSeqId > 2)
-                    {
-                        size_t labelid_2 = labelid - 2;
-                        // if current label is not blank and not equal prev non-blank label
-                        if ((size_t)(phoneSeq[labelid]) != blankTokenId && phoneId != (size_t)(phoneSeq[labelid_2]))
-                        {
-                            x = LogAdd(x, alphaScore[alphaId_2]);
-                        }
-                    }
-
-                    if (phoneSeqId > 1)
-                    {
-                        x = LogAdd(x, alphaScore[alphaId_1]);
-                    }
-
-                    x = LogAdd(x, alphaScore[alphaId_0]);
-
-                    if (phoneId != SIZE_MAX)
-                        ascore = prob[probId]; // Probability of observing given label at given time
-                    else
-                        ascore = 0;
-                    alphaScore[alphaId] = (ElemType)x + ascore;
-                    if (delayConstraint != -1)
-                    {
-                        size_t labelid_r = labelid + 2;
-                        size_t phoneBoundId_r = (size_t)(phoneBound[labelid_r]);
-                        if (phoneId == blankTokenId)
-                        {
-                            // only constraint right side
-                            if (t > phoneBoundId_r + delayConstraint - 1)
-                                alphaScore[alphaId] = LZERO;
-                        }
-                        else if (phoneId != blankTokenId)
-                        {
-                            if (t > phoneBoundId_r + delayConstraint)
-                                alphaScore[alphaId] = LZERO;
-                        }
-                    }
+                    if (s > 2 && phoneId != blankTokenId && phoneId != (size_t)(uttPhoneSeq[s - 2]))
+                        x = LogAdd(x, prevScore[s - 2]);
+                    if (s > 1)
+                        x = LogAdd(x, prevScore[s - 1]);
                 }
-
-            }
-        }
-    }
-}
-
-// Calculate beta in forward-backward calculation, equation (10), (11) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
-// See _assignAlphaScore for the explanation of parameters
-template<class ElemType>
-void _assignBetaScore(
-    const ElemType *prob,
-    ElemType *betaScore,
-    ElemType *phoneSeq,
-    ElemType *phoneBound,
-    const std::vector<size_t>& uttToChanInd,
-    const std::vector<size_t>& uttFrameNum,
-    const std::vector<size_t>& uttBeginFrame,
-    const std::vector<size_t>& uttPhoneNum,
-    const size_t numChannels,
-    const size_t uttNum,
-    const long  t,
-    const size_t maxPhoneNum,
-    const size_t totalPhoneNum,
-    const size_t blankTokenId,
-    const int delayConstraint)
-{
-    for (size_t uttId = 0;uttId < uttNum;uttId++) {
-
-        // Number of phones and frames in this utterance
-        size_t frameNum = uttFrameNum[uttId];
-        if (t >= frameNum) continue;
-
-        size_t phoneNum = uttPhoneNum[uttId];
-
-#pragma omp parallel for
-        for (int phoneSeqId = 1;phoneSeqId < phoneNum - 1;phoneSeqId++) {
-
-            size_t labelid = uttId*maxPhoneNum + phoneSeqId;
-            size_t labelid_2 = labelid + 2;
-            size_t phoneId = (LONG64)(phoneSeq[labelid]);
-            size_t timeId = (t + uttBeginFrame[uttId])*numChannels + uttToChanInd[uttId];
-            size_t probId = timeId*totalPhoneNum + phoneId;
-            size_t betaid = maxPhoneNum* timeId + phoneSeqId;
-            size_t timeId_1 = timeId + numChannels;
-            size_t betaid_0 = maxPhoneNum* timeId_1 + phoneSeqId;
-            size_t betaid_1 = betaid_0 + 1;
-            size_t betaid_2 = betaid_0 + 2;
-
-            if (t == frameNum - 1)
-            {
-                if (phoneSeqId == phoneNum - 3 || phoneSeqId == phoneNum - 2)
+                else
                 {
-                    betaScore[betaid] = prob[probId];
+                    if (s < phoneNum - 3 && phoneId != blankTokenId && phoneId != (size_t)(uttPhoneSeq[s + 2]))
+                        x = LogAdd(x, prevScore[s + 2]);
+                    if (s < phoneNum - 2)
+                        x = LogAdd(x, prevScore[s + 1]);
                 }
-            }
-            else
-            {
-                if (phoneSeqId >= 1)
-                {
-                    ElemType x = LZERO;
-                    ElemType ascore;
-                    if (phoneSeqId < phoneNum - 3)
-                    {
-                        if (phoneSeq[labelid] != blankTokenId && phoneId != phoneSeq[labelid_2])
-                        {
-                            x = LogAdd(x, betaScore[betaid_2]);
-                        }
-                    }
-
-                    if (phoneSeqId < phoneNum - 2)
-                    {
-                        x = LogAdd(x, betaScore[betaid_1]);
-                    }
-
-                    x = LogAdd(x, betaScore[betaid_0]);
+                x = LogAdd(x, prevScore[s]);
+                x += ascore;
 
-                    if (phoneId != SIZE_MAX)
-                        ascore = prob[probId];
-                    else
-                        ascore = 0;
-                    betaScore[betaid] = (ElemType)x + ascore;
-                    if (delayConstraint != -1)
-                    {
-                        size_t phoneBoundId_r = (size_t)(phoneBound[labelid_2]);
-                        if (phoneId == blankTokenId)
-                        {
-                            if (t > phoneBoundId_r + delayConstraint - 1)
-                                betaScore[betaid] = LZERO;
-                        }
-                        else if (phoneId != blankTokenId)
-                        {
-                            if (t > phoneBoundId_r + delayConstraint)
-                                betaScore[betaid] = LZERO;
-                        }
-                    }
+                if (delayConstraint != -1)
+                {
+                    // only constraint right side; a blank must be left one frame earlier
+                    const size_t phoneBoundId_r = (size_t)(uttPhoneBound[s + 2]);
+                    if (t > phoneBoundId_r + delayConstraint - (phoneId == blankTokenId ? 1 : 0))
+                        x = LZERO;
                 }
             }
+            score[timeId * maxPhoneNum + s] = x;
         }
     }
 }
@@ -6753,16 +7289,17 @@ void _assignTotalScore(ElemType *betaScore,
     }
 }
 
-// Calculate derivative, equation (15) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
-// See _assignAlphaScore for the explanation of parameters
+// Calculate derivative, equation (15) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf, for the frames of one utterance:
+// the occupancies of the positions of each label, normalized to sum to 1 over each frame. CTCscore must be zero.
+// See _assignAlphaBetaScores for the explanation of parameters
 template<class ElemType>
 void _assignCTCScore(
     ElemType *CTCscore,
-    ElemType *prob,
-    ElemType *alphaScore,
-    ElemType *betaScore,
-    ElemType *phoneSeq,
-    const size_t uttNum,
+    const ElemType *prob,
+    const ElemType *alphaScore,
+    const ElemType *betaScore,
+    const ElemType *phoneSeq,
+    const size_t uttId,
     const std::vector<size_t>& uttToChanInd,
     const std::vector<size_t>& uttBeginFrame,
     const std::vector<size_t>& uttPhoneNum,
@@ -6771,36 +7308,31 @@ void _assignCTCScore(
     const size_t maxPhoneNum,
     const size_t totalPhoneNum)
 {
-    for (size_t uttId = 0;uttId < uttNum;uttId++) {
-#pragma omp parallel for
-        for (int t = 0; t < uttFrameNum[uttId]; t++) {
-            size_t phoneNum = uttPhoneNum[uttId];
-            size_t alphaId_0 = (uttBeginFrame[uttId] * numChannels + uttToChanInd[uttId]) * maxPhoneNum;
-            size_t timeId = (t + uttBeginFrame[uttId])*numChannels + uttToChanInd[uttId];
-            ElemType P_lx = betaScore[alphaId_0];
+    const size_t phoneNum = uttPhoneNum[uttId];
+    const ElemType* uttPhoneSeq = phoneSeq + uttId * maxPhoneNum;
+    const ElemType P_lx = betaScore[(uttBeginFrame[uttId] * numChannels + uttToChanInd[uttId]) * maxPhoneNum];
 
-            for (int s = 1; s < phoneNum - 1; s++)
-            {
-                long phoneId = phoneSeq[uttId*maxPhoneNum + s];
-                size_t alphaId = maxPhoneNum* timeId + s;
-                size_t probId = timeId*totalPhoneNum + phoneId;
+    for (size_t t = 0; t < uttFrameNum[uttId]; t++)
+    {
+        const size_t timeId = (t + uttBeginFrame[uttId]) * numChannels + uttToChanInd[uttId];
+        const ElemType* frameProb = prob + timeId * totalPhoneNum;
+        ElemType* frameScore = CTCscore + timeId * totalPhoneNum;
 
-                if (phoneId != SIZE_MAX)
-                {
-                    ElemType logoccu = alphaScore[alphaId] + betaScore[alphaId] - prob[probId] - (ElemType)P_lx;
-                    CTCscore[probId] = LogAdd(CTCscore[probId], logoccu);
-                }
-            }
+        ElemType sum = 0;
+        for (size_t s = 1; s < phoneNum - 1; s++)
+        {
+            const size_t phoneId = (size_t)(uttPhoneSeq[s]);
+            if (phoneId != SIZE_MAX)
+                sum += exp(alphaScore[timeId * maxPhoneNum + s] + betaScore[timeId * maxPhoneNum + s] - frameProb[phoneId] - P_lx);
+        }
+        if (sum <= 0)
+            continue;
 
-            for (int s = 0; s < totalPhoneNum; s++)
-            {
-                size_t probId = timeId*totalPhoneNum + s;
-                ElemType logoccu = CTCscore[probId];
-                if (logoccu < LZERO)
-                    CTCscore[probId] = 0.0f;
-                else
-                    CTCscore[probId] = exp(logoccu);
-            }
+        for (size_t s = 1; s < phoneNum - 1; s++)
+        {
+            const size_t phoneId = (size_t)(uttPhoneSeq[s]);
+            if (phoneId != SIZE_MAX)
+                frameScore[phoneId] += exp(alphaScore[timeId * maxPhoneNum + s] + betaScore[timeId * maxPhoneNum + s] - frameProb[phoneId] - P_lx) / sum;
         }
     }
 }
@@ -6816,28 +7348,29 @@ CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignCTCScore(
     {
         // Total number of phones
         size_t totalPhoneNum = prob.GetNumRows();
-        size_t uttNum = uttFrameNum.size();
+        long uttNum = (long) uttFrameNum.size();
 
         // Max number of phones in utterances in this minibatch
         size_t maxPhoneNum = phoneSeq.GetNumRows();
 
-        for (size_t t = 0; t < maxFrameNum; t++)
-        {
-            _assignAlphaScore(prob.Data(), alpha.Data(), phoneSeq.Data(), phoneBoundary.Data(), uttToChanInd,
-                uttFrameNum, uttBeginFrame, uttPhoneNum, numParallelSequences, uttNum, t, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
-        }
-
-        for (LONG64 t = maxFrameNum - 1; t >= 0; t--)
+        // the alphas and betas of all utterances, in parallel
+#pragma omp parallel for
+        for (long k = 0; k < 2 * uttNum; k++)
         {
-            _assignBetaScore(prob.Data(), beta.Data(), phoneSeq.Data(), phoneBoundary.Data(), uttToChanInd,
-                uttFrameNum, uttBeginFrame, uttPhoneNum, numParallelSequences, uttNum, t, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
+            const bool isAlpha = k % 2 == 0;
+            _assignAlphaBetaScores(prob.Data(), isAlpha ? alpha.Data() : beta.Data(), isAlpha, phoneSeq.Data(), phoneBoundary.Data(), uttToChanInd,
+                uttFrameNum, uttBeginFrame, uttPhoneNum, numParallelSequences, k / 2, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
         }
 
         std::vector<ElemType> scores(uttNum);
         _assignTotalScore(beta.Data(), scores, uttNum, uttToChanInd, uttBeginFrame, numParallelSequences, maxPhoneNum);
 
-        _assignCTCScore(Data(), prob.Data(), alpha.Data(), beta.Data(), phoneSeq.Data(), uttNum, uttToChanInd,
-            uttBeginFrame, uttPhoneNum, uttFrameNum, numParallelSequences, maxPhoneNum, totalPhoneNum);
+#pragma omp parallel for
+        for (long uttId = 0; uttId < uttNum; uttId++)
+        {
+            _assignCTCScore(Data(), prob.Data(), alpha.Data(), beta.Data(), phoneSeq.Data(), uttId, uttToChanInd,
+                uttBeginFrame, uttPhoneNum, uttFrameNum, numParallelSequences, maxPhoneNum, totalPhoneNum);
+        }
 
         totalScore(0, 0) = 0.0;
         for (size_t utt = 0; utt < uttNum; utt++)
@@ -6855,6 +7388,191 @@ CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignCTCScore(
     return *this;
 }
 
+// Extracts the labels of the frames of one utterance, merging runs of identical labels if 'squashInputs', and removing the ignored ones.
+// Returns the number of labels written to 'tokens'.
+template<class ElemType>
+size_t _extractEditDistanceTokens(const ElemType* seq, const size_t chanInd, const size_t beginFrame, const size_t frameNum, const size_t numChannels,
+    const bool squashInputs, const std::vector<size_t>& tokensToIgnore, std::vector<int>& tokens)
+{
+    tokens.clear();
+    int lastId = 0;
+    for (size_t t = 0; t < frameNum; t++)
+    {
+        int id = (int)seq[(beginFrame + t) * numChannels + chanInd];
+        if (t > 0 && squashInputs && id == lastId)
+            continue;
+
+        lastId = id;
+        if (std::find(tokensToIgnore.begin(), tokensToIgnore.end(), (size_t)id) == tokensToIgnore.end())
+            tokens.push_back(id);
+    }
+    return tokens.size();
+}
+
+// Edit distance between 'first' and 'second' by the classic DP over a row of the grid at a time, see https://en.wikipedia.org/wiki/Edit_distance.
+// The penalties decide the alignment; the number of edits along it is returned.
+static float _editDistance(const std::vector<int>& first, const std::vector<int>& second, const float subPen, const float delPen, const float insPen)
+{
+    const size_t m = second.size();
+    // the costs and the numbers of edits of the previous and the current row
+    std::vector<float> prevCost(m + 1), prevEdits(m + 1), cost(m + 1), edits(m + 1);
+    for (size_t j = 0; j <= m; j++)
+    {
+        prevCost[j] = (float)(j * insPen);
+        prevEdits[j] = (float)j;
+    }
+
+    for (size_t i = 1; i <= first.size(); i++)
+    {
+        cost[0] = (float)(i * delPen);
+        edits[0] = (float)i;
+        for (size_t j = 1; j <= m; j++)
+        {
+            if (first[i - 1] == second[j - 1])
+            {
+                cost[j] = prevCost[j - 1];
+                edits[j] = prevEdits[j - 1];
+                continue;
+            }
+
+            float del = prevCost[j] + delPen;
+            float ins = cost[j - 1] + insPen;
+            float sub = prevCost[j - 1] + subPen;
+            if (sub <= del && sub <= ins)
+            {
+                cost[j] = sub;
+                edits[j] = prevEdits[j - 1] + 1.0f;
+            }
+            else if (del < ins)
+            {
+                cost[j] = del;
+                edits[j] = prevEdits[j] + 1.0f;
+            }
+            else
+            {
+                cost[j] = ins;
+                edits[j] = edits[j - 1] + 1.0f;
+            }
+        }
+        cost.swap(prevCost);
+        edits.swap(prevEdits);
+    }
+    return prevEdits[m];
+}
+
+template<class ElemType>
+CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignEditDistances(const CPUMatrix<ElemType>& firstSeq, const CPUMatrix<ElemType>& secondSeq, const std::vector<size_t>& uttToChanInd,
+    const std::vector<size_t>& uttBeginFrame, const std::vector<size_t>& uttFrameNum, const size_t numParallelSequences,
+    const float subPen, const float delPen, const float insPen, const bool squashInputs, const std::vector<size_t>& tokensToIgnore)
+{
+    long uttNum = (long) uttFrameNum.size();
+    RequireSize(3, uttNum);
+
+    // the utterances are independent, a thread computes one at a time
+#pragma omp parallel for schedule(dynamic)
+    for (long uttId = 0; uttId < uttNum; uttId++)
+    {
+        std::vector<int> first, second;
+        _extractEditDistanceTokens(firstSeq.Data(), uttToChanInd[uttId], uttBeginFrame[uttId], uttFrameNum[uttId], numParallelSequences, squashInputs, tokensToIgnore, first);
+        _extractEditDistanceTokens(secondSeq.Data(), uttToChanInd[uttId], uttBeginFrame[uttId], uttFrameNum[uttId], numParallelSequences, squashInputs, tokensToIgnore, second);
+
+        ElemType* result = Data() + 3 * uttId;
+        result[0] = (ElemType)_editDistance(first, second, subPen, delPen, insPen);
+        result[1] = (ElemType)(float)first.size();
+        result[2] = (ElemType)(float)second.size();
+    }
+
+    return *this;
+}
+
+// Whether document i comes before document j in the ranking by decreasing score. Equal scores, or NaN, put the lower gain first;
+// documents with the same score and gain keep their order, so that the ranks of a query are a permutation.
+static inline bool _lambdaRankPrecedes(double gainI, double scoreI, size_t i, double gainJ, double scoreJ, size_t j)
+{
+    if (scoreI == scoreJ || std::isnan(scoreI) || std::isnan(scoreJ))
+        return gainI != gainJ ? gainI < gainJ : i < j;
+    return scoreI > scoreJ;
+}
+
+template<class ElemType>
+CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignLambdaRankRanks(const CPUMatrix<ElemType>& gains, const CPUMatrix<ElemType>& scores, const std::vector<size_t>& queryBegins, CPUMatrix<ElemType>& metrics)
+{
+    long numQueries = (long) queryBegins.size() - 1;
+    RequireSize(1, gains.GetNumCols());
+    metrics.RequireSize(2, numQueries);
+
+    const ElemType* gain = gains.Data();
+    const ElemType* score = scores.Data();
+    ElemType* rank = Data();
+    ElemType* metric = metrics.Data();
+
+    // a document's rank is the number of documents of its query ranked before it; the queries are independent
+#pragma omp parallel for schedule(dynamic)
+    for (long q = 0; q < numQueries; q++)
+    {
+        const size_t begin = queryBegins[q], end = queryBegins[q + 1];
+        double idealDCG = 0, dcg = 0;
+        for (size_t i = begin; i < end; i++)
+        {
+            size_t r = 0;
+            for (size_t j = begin; j < end; j++)
+            {
+                if (j != i && _lambdaRankPrecedes((double)gain[j], (double)score[j], j, (double)gain[i], (double)score[i], i))
+                    r++;
+            }
+            rank[i] = (ElemType)(double)r;
+            idealDCG += (double)gain[i] / log(2.0 + (i - begin));
+            dcg += (double)gain[i] / log(2.0 + r);
+        }
+        metric[2 * q] = (ElemType)idealDCG;
+        metric[2 * q + 1] = (ElemType)dcg;
+    }
+
+    return *this;
+}
+
+template<class ElemType>
+void CPUMatrix<ElemType>::AddLambdaRankGradient(const CPUMatrix<ElemType>& gains, const CPUMatrix<ElemType>& scores, const CPUMatrix<ElemType>& ranks, const CPUMatrix<ElemType>& metrics,
+    const std::vector<size_t>& queryBegins, const ElemType sigma, CPUMatrix<ElemType>& gradient)
+{
+    long numQueries = (long) queryBegins.size() - 1;
+    const ElemType* gain = gains.Data();
+    const ElemType* score = scores.Data();
+    const ElemType* rank = ranks.Data();
+    const ElemType* metric = metrics.Data();
+    ElemType* grad = gradient.Data();
+    const double s = (double)sigma;
+
+#pragma omp parallel for schedule(dynamic)
+    for (long q = 0; q < numQueries; q++)
+    {
+        const double idealDCG = (double)metric[2 * q];
+        if (idealDCG == 0)
+            continue;
+
+        const size_t begin = queryBegins[q], end = queryBegins[q + 1];
+        for (size_t i = begin; i < end; i++)
+        {
+            const double gainI = (double)gain[i], scoreI = (double)score[i], discountI = log(2.0 + (double)rank[i]);
+            double sum = 0;
+            for (size_t j = begin; j < end; j++)
+            {
+                const double gainJ = (double)gain[j];
+                if (fabs(gainI - gainJ) < 0.0000001)
+                    continue;
+
+                const double discountJ = log(2.0 + (double)rank[j]);
+                const double deltaNDCG = fabs((gainI - gainJ) * (discountI - discountJ) / (discountI * discountJ) / idealDCG);
+                if (gainI > gainJ)
+                    sum -= s / (1 + exp(s * (scoreI - (double)score[j]))) * deltaNDCG;
+                else
+                    sum += s / (1 + exp(s * ((double)score[j] - scoreI))) * deltaNDCG;
+            }
+            grad[i] += (ElemType)sum;
+        }
+    }
+}
+
 /// the kernel function for RCRF backward computation
 template <class ElemType>
 void CPUMatrix<ElemType>::_rcrfBackwardCompute(size_t t, size_t k, const CPUMatrix<ElemType>& alpha,
@@ -7085,6 +7803,7 @@ int CPUMatrix<ElemType>::SetNumThreads(int numThreads)
 #ifdef _OPENMP
     omp_set_num_threads(numThreads);
     numThreads = omp_get_max_threads();
+    NumaPolicy::PinThreads(); // the new threads
 
     #ifdef USE_MKL
         mkl_set_num_threads(numThreads);
@@ -7092,6 +7811,7 @@ int CPUMatrix<ElemType>::SetNumThreads(int numThreads)
         openblas_set_num_threads(numThreads);
     #endif
 #endif
+    ThreadPool::SetThreadBudget(numThreads);
     return numThreads;
 }
 
@@ -7167,6 +7887,127 @@ void CPUMatrix<ElemType>::TensorOp(ElemType beta, const CPUMatrix<ElemType>& a,
     CPUMatrixTensorOpImpl<ElemType>(beta, a, b, c, *this, alpha, op, reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
 }
 
+// applies one instruction of an ElementwiseProgram to n elements of its operands
+template <class ElemType>
+static void ElementwiseInstructionOp(ElementWiseOperator op, const ElemType* a, const ElemType* b, const ElemType* c, ElemType* result, size_t n)
+{
+#pragma push_macro("CaseUnaryOp")
+#pragma push_macro("CaseBinaryOp")
+#pragma push_macro("CaseTernaryOp")
+#define CaseUnaryOp(oper)   case ElementWiseOperator::op##oper: for (size_t k = 0; k < n; k++) result[k] = Op##oper(a[k]); break
+#define CaseBinaryOp(oper)  case ElementWiseOperator::op##oper: for (size_t k = 0; k < n; k++) result[k] = Op##oper(a[k], b[k]); break
+#define CaseTernaryOp(oper) case ElementWiseOperator::op##oper: for (size_t k = 0; k < n; k++) result[k] = Op##oper(a[k], b[k], c[k]); break
+    switch (op)
+    {
+        ForAllUnaryOps(CaseUnaryOp);
+        ForAllBinaryOps(CaseBinaryOp);
+        ForAllTernaryOps(CaseTernaryOp);
+    default:
+        LogicError("ElementwiseProgramOp: Operation %d is not supported.", (int)op);
+    }
+#pragma pop_macro("CaseTernaryOp")
+#pragma pop_macro("CaseBinaryOp")
+#pragma pop_macro("CaseUnaryOp")
+}
+
+// evaluates an ElementwiseProgram (CommonMatrix.h) into 'this' in chunks of elements, so that each instruction is
+// dispatched once per chunk and the intermediate results stay in the cache
+template <class ElemType>
+void CPUMatrix<ElemType>::ElementwiseProgramOp(ElemType beta, const vector<const CPUMatrix<ElemType>*>& inputs, const ElementwiseProgram& program, ElemType alpha)
+{
+    // the program and the input sizes are verified by Matrix::ElementwiseProgramOp()
+    const size_t numInputs = program.numInputs;
+    const size_t numInstructions = program.numInstructions;
+    const size_t numElements = GetNumElements();
+    const size_t numRows = GetNumRows();
+    if (numElements == 0)
+        return;
+
+    // no elements: only checks that the operations are supported, since exceptions must not leave the parallel loop below
+    for (size_t i = 0; i < numInstructions; i++)
+        ElementwiseInstructionOp<ElemType>(program.instructions[i].op, nullptr, nullptr, nullptr, nullptr, 0);
+
+    const size_t chunkSize = 256;
+    const long numChunks = (long)((numElements + chunkSize - 1) / chunkSize);
+    ElemType* us = Data();
+#pragma omp parallel for if (numChunks > 1)
+    for (long chunk = 0; chunk < numChunks; chunk++)
+    {
+        ElemType registers[ElementwiseProgram::MaxInputs + ElementwiseProgram::MaxInstructions][chunkSize];
+        const size_t begin = chunk * chunkSize;
+        const size_t n = min(chunkSize, numElements - begin);
+
+        for (size_t i = 0; i < numInputs; i++)
+        {
+            const ElemType* p = inputs[i]->Data();
+            const size_t numInputElements = inputs[i]->GetNumElements();
+            if (numInputElements == numElements)
+                memcpy(registers[i], p + begin, n * sizeof(ElemType));
+            else if (numInputElements == numRows && numRows != 1)
+            {
+                for (size_t k = 0; k < n; k++)
+                    registers[i][k] = p[(begin + k) % numRows];
+            }
+            else
+                fill(registers[i], registers[i] + n, p[0]);
+        }
+
+        for (size_t i = 0; i < numInstructions; i++)
+        {
+            const auto& instruction = program.instructions[i];
+            ElementwiseInstructionOp(instruction.op, registers[instruction.args[0]], registers[instruction.args[1]], registers[instruction.args[2]],
+                                     registers[numInputs + i], n);
+        }
+
+        const ElemType* result = registers[numInputs + numInstructions - 1];
+        ElemType* out = us + begin;
+        if (beta == 0)
+        {
+            for (size_t k = 0; k < n; k++)
+                out[k] = alpha * result[k];
+        }
+        else
+        {
+            for (size_t k = 0; k < n; k++)
+                out[k] = beta * out[k] + alpha * result[k];
+        }
+    }
+}
+
+// applies dropout with a mask drawn from the counter-based generator, see Matrix::DropoutOp();
+// each iteration computes one Philox block, which gives the mask of four consecutive elements
+template <class ElemType>
+void CPUMatrix<ElemType>::DropoutOp(ElemType beta, const CPUMatrix<ElemType>& a, double dropoutRate, uint64_t seed, uint64_t offset)
+{
+    // the sizes are verified by Matrix::DropoutOp()
+    const size_t numElements = a.GetNumElements();
+    if (numElements == 0)
+        return;
+
+    const float maskRate = (float)dropoutRate;
+    const ElemType scaleValue = (ElemType)(1.0 / (1.0 - dropoutRate));
+    const uint64_t firstBlock = offset >> 2;
+    const long numBlocks = (long)(((offset + numElements - 1) >> 2) - firstBlock + 1);
+    const ElemType* pa = a.Data();
+    ElemType* us = Data();
+#pragma omp parallel for if (numBlocks > 1024)
+    for (long block = 0; block < numBlocks; block++)
+    {
+        uint32_t words[4];
+        Philox4x32(seed, firstBlock + block, words);
+        for (size_t w = 0; w < 4; w++)
+        {
+            const uint64_t index = ((firstBlock + block) << 2) + w;
+            if (index < offset || index - offset >= numElements)
+                continue;
+
+            const size_t i = (size_t)(index - offset);
+            const ElemType value = PhiloxUniform(words[w]) < maskRate ? (ElemType)0 : pa[i] * scaleValue;
+            us[i] = beta == 0 ? value : beta * us[i] + value;
+        }
+    }
+}
+
 template <class ElemType>
 int CPUMatrix<ElemType>::Argmin() const
 {
@@ -0,0 +1,30 @@
+#include "stdafx.h"
+#include "CPUMatrixTensorImpl.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+template
+void CPUMatrixTensorOpImpl(bfloat16 beta, const CPUMatrix<bfloat16>& a, CPUMatrix<bfloat16>& o, bfloat16 alpha, ElementWiseOperator op, ElementWiseOperator reductionOp,
+    const array<size_t, 2>& offsets,
+    const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 2>& regularStrides,
+    const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 2>& reducingStrides);
+
+template
+void CPUMatrixTensorOpImpl(bfloat16 beta, const CPUMatrix<bfloat16>& a, const CPUMatrix<bfloat16>& b, CPUMatrix<bfloat16>& o, bfloat16 alpha, ElementWiseOperator op, ElementWiseOperator reductionOp,
+    const array<size_t, 3>& offsets,
+    const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 3>& regularStrides,
+    const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 3>& reducingStrides);
+
+template
+void CPUMatrixTensorOpImpl(bfloat16 beta, const CPUMatrix<bfloat16>& a, const CPUMatrix<bfloat16>& b, const CPUMatrix<bfloat16>& c, CPUMatrix<bfloat16>& o, bfloat16 alpha, ElementWiseOperator op, ElementWiseOperator reductionOp,
+    const array<size_t, 4>& offsets,
+    const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 4>& regularStrides,
+    const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 4>& reducingStrides);
+
+template
+void CPUMatrixTensorArgOpImpl(const CPUMatrix<bfloat16>& a, CPUMatrix<bfloat16>& o, ElementWiseOperator reductionOp,
+    const array<size_t, 2>& offsets,
+    const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 2>& regularStrides,
+    const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 2>& reducingStrides);
+
+}}}
\ No newline at end of file
@@ -287,6 +287,179 @@ struct TensorArgOpIteration<ElemType, N, -1>
     }
 };
 
+// -----------------------------------------------------------------------
+// cache-blocked reduction
+// -----------------------------------------------------------------------
+
+// Reductions are computed for tiles of outputs that are consecutive in all inputs, with the reduction loop
+// outside of the tile loop, so that memory is walked contiguously also when reducing over outer axes
+// (e.g. the bias gradient). Each output is aggregated in the same order as by TensorOpReduction, so results
+// are identical to the per-output loops. Tiles and outer output dimensions are computed in parallel.
+// If there are only a few tiles, the outermost reduction axis is additionally split into chunks whose
+// partial aggregates are combined pairwise. The split depends on the shapes only, so results do not
+// depend on the number of threads.
+template <class ElemType, typename OPFN, typename ReductionOp, size_t N>
+struct TensorOpBlockedReduction
+{
+    static const size_t TileSize = 128;             // aggregates of a tile (in double) stay in L1
+    static const size_t MinChunkSize = 4096;        // minimum number of reduction indices per chunk
+    static const size_t MaxChunks = 64;
+    static const size_t MaxWorkItemsForSplit = 16;  // split the reduction only if there are fewer tiles
+    static const size_t MinElementsForParallel = 16384;
+
+    // aggregate 'count' consecutive outputs over the indices [begin, end) of the outermost reducing dimension
+    static void AggregateTile(const array<ElemType*, N>& pointers, size_t count, const OPFN& opfn, const ReductionOp& reductionOp,
+                              const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides,
+                              size_t begin, size_t end, double* aggregate)
+    {
+        const size_t outer = reducingOpDims.size() - 1;
+        double slice[TileSize];
+        for (size_t r = begin; r < end; r++)
+        {
+            array<ElemType*, N> pp = pointers;
+            for (size_t i = 0; i < N - 1; i++)
+                pp[i] += (ptrdiff_t)r * reducingStrides[i][outer];
+
+            // with two reducing dimensions, the inner one is aggregated first and rounded to ElemType, like TensorOpReduction does
+            double* target = outer == 0 ? aggregate : slice;
+            bool first = outer == 0 ? r == begin : true;
+            const size_t innerDim = outer == 0 ? 1 : reducingOpDims[0];
+            for (size_t r0 = 0; r0 < innerDim; r0++)
+            {
+                for (size_t t = 0; t < count; t++)
+                {
+                    array<ElemType*, N> pt = pp;
+                    for (size_t i = 0; i < N - 1; i++)
+                        pt[i] += t;
+                    double val = opfn(pt);
+                    target[t] = first ? val : reductionOp(target[t], val);
+                }
+                first = false;
+                for (size_t i = 0; i < N - 1; i++)
+                    pp[i] += outer == 0 ? 0 : reducingStrides[i][0];
+            }
+
+            if (outer != 0)
+            {
+                for (size_t t = 0; t < count; t++)
+                {
+                    double val = static_cast<ElemType>(slice[t]);
+                    aggregate[t] = r == begin ? val : reductionOp(aggregate[t], val);
+                }
+            }
+        }
+    }
+
+    static void Loop(ElemType beta, array<ElemType*, N> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp,
+                     const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrides,
+                     const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
+    {
+        if (reducingOpDims.size() > 2)
+            LogicError("TensorOp: %d non-flattened reduction dimensions are not supported.", (int)reducingOpDims.size());
+
+        // the innermost output dimension is tiled if it is consecutive in all inputs
+        bool tiled = regularOpDims.size() > 0;
+        for (size_t i = 0; i < N - 1 && tiled; i++)
+            tiled = regularStrides[i][0] == 1;
+
+        const size_t tileDim = tiled ? regularOpDims[0] : 1;
+        const size_t numTiles = (tileDim + TileSize - 1) / TileSize;
+        const size_t firstOuterDim = tiled ? 1 : 0;
+        size_t numOuter = 1;
+        for (size_t k = firstOuterDim; k < regularOpDims.size(); k++)
+            numOuter *= regularOpDims[k];
+        const size_t numWorkItems = numOuter * numTiles;
+
+        const size_t reductionDim = reducingOpDims.back();
+        size_t reductionSize = 1;
+        for (size_t m = 0; m < reducingOpDims.size(); m++)
+            reductionSize *= reducingOpDims[m];
+
+        size_t numChunks = 1;
+        size_t chunkSize = reductionDim;
+        if (numWorkItems < MaxWorkItemsForSplit && reductionDim >= 2 * MinChunkSize)
+        {
+            chunkSize = std::max(MinChunkSize, (reductionDim + MaxChunks - 1) / MaxChunks);
+            numChunks = (reductionDim + chunkSize - 1) / chunkSize;
+        }
+
+        // partial aggregates, [TileSize x numChunks x numWorkItems]
+        std::vector<double> partials(numChunks > 1 ? TileSize * numChunks * numWorkItems : 0);
+
+        // computes the pointers for the tile of a work item
+        auto tilePointers = [&](size_t workItem, size_t& count)
+        {
+            size_t tile = workItem % numTiles;
+            size_t outerIndex = workItem / numTiles;
+            array<ElemType*, N> pp = pointers;
+            for (size_t k = firstOuterDim; k < regularOpDims.size(); k++)
+            {
+                size_t index = outerIndex % regularOpDims[k];
+                outerIndex /= regularOpDims[k];
+                for (size_t i = 0; i < N; i++)
+                    pp[i] += (ptrdiff_t)index * regularStrides[i][k];
+            }
+            if (tiled)
+            {
+                for (size_t i = 0; i < N; i++)
+                    pp[i] += (ptrdiff_t)(tile * TileSize) * regularStrides[i][0];
+            }
+            count = std::min(TileSize, tileDim - tile * TileSize);
+            return pp;
+        };
+
+        auto writeTile = [&](const array<ElemType*, N>& pp, size_t count, const double* aggregate)
+        {
+            const ptrdiff_t outputStride = tiled ? regularStrides[N - 1][0] : 0;
+            for (size_t t = 0; t < count; t++)
+            {
+                ElemType val = static_cast<ElemType>(aggregate[t]);
+                val *= alpha;
+                auto* pout = pp.back() + (ptrdiff_t)t * outputStride;
+                if (beta != 0)
+                    val += beta * *pout;
+                *pout = val;
+            }
+        };
+
+        const bool parallel = numWorkItems * numChunks > 1 && numOuter * tileDim * reductionSize >= MinElementsForParallel;
+#pragma omp parallel for schedule(static) if (parallel)
+        for (int w = 0; w < (int)(numWorkItems * numChunks); w++)
+        {
+            size_t workItem = w / numChunks;
+            size_t chunk = w % numChunks;
+            size_t count;
+            auto pp = tilePointers(workItem, count);
+            size_t begin = chunk * chunkSize;
+            size_t end = std::min(reductionDim, begin + chunkSize);
+            if (numChunks == 1)
+            {
+                double aggregate[TileSize];
+                AggregateTile(pp, count, opfn, reductionOp, reducingOpDims, reducingStrides, begin, end, aggregate);
+                writeTile(pp, count, aggregate);
+            }
+            else
+                AggregateTile(pp, count, opfn, reductionOp, reducingOpDims, reducingStrides, begin, end, &partials[(workItem * numChunks + chunk) * TileSize]);
+        }
+
+        if (numChunks == 1)
+            return;
+
+        // combine the chunks pairwise, in a fixed order
+        for (size_t workItem = 0; workItem < numWorkItems; workItem++)
+        {
+            size_t count;
+            auto pp = tilePointers(workItem, count);
+            double* p = &partials[workItem * numChunks * TileSize];
+            for (size_t step = 1; step < numChunks; step *= 2)
+                for (size_t chunk = 0; chunk + step < numChunks; chunk += 2 * step)
+                    for (size_t t = 0; t < count; t++)
+                        p[chunk * TileSize + t] = reductionOp(p[chunk * TileSize + t], p[(chunk + step) * TileSize + t]);
+            writeTile(pp, count, p);
+        }
+    }
+};
+
 // -----------------------------------------------------------------------
 // map runtime parameters N to template parameters
 // -----------------------------------------------------------------------
@@ -331,6 +504,8 @@ static void TensorOpWithFnAndReduction(ElemType beta, array<ElemType*, N> pointe
     for (size_t i = 0; i < N; i++) // N = a small constant, this will be unrolled
         pointers[i] += offsets[i];
     size_t dims = regularOpDims.size();
+    if (reducingOpDims.size() > 0 && dims <= 5)
+        return TensorOpBlockedReduction<ElemType, OPFN, ReductionOp, N>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
     switch (dims)
     {
     // N.B. consider code size impact when adding more cases.
@@ -408,6 +583,19 @@ bool CPUMatrixSpecialTernaryTensorOpImpl(ElemType beta, const CPUMatrix<ElemType
     const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 4>& regularStrides,
     const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 4>& reducingStrides);
 
+// vectorized kernels for dense operands, selected for the CPU at runtime (CPUMatrixTensorSimd.cpp)
+template <class ElemType>
+bool CPUMatrixSimdUnaryTensorOpImpl(ElemType beta, const CPUMatrix<ElemType>& a, CPUMatrix<ElemType>& o, ElemType alpha, ElementWiseOperator op, ElementWiseOperator reductionOp,
+    const array<size_t, 2>& offsets,
+    const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 2>& regularStrides,
+    const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 2>& reducingStrides);
+
+template <class ElemType>
+bool CPUMatrixSimdBinaryTensorOpImpl(ElemType beta, const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& b, CPUMatrix<ElemType>& o, ElemType alpha, ElementWiseOperator op, ElementWiseOperator reductionOp,
+    const array<size_t, 3>& offsets,
+    const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 3>& regularStrides,
+    const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 3>& reducingStrides);
+
 // perform unary operation 'op' on a giving 'this', reinterpreting the matrices as tensors as specified by the dims and strides
 // This maps 'op' to a lambda.
 template <class ElemType>
@@ -429,6 +617,10 @@ void CPUMatrixTensorOpImpl(ElemType beta, const CPUMatrix<ElemType>& a, CPUMatri
         return;
 #endif
 
+    if (!!(CPUMatrix<ElemType>::GetOptimizationFlags() & CPUMatrix<ElemType>::OPT_EVAL_WITH_SIMD) &&
+        CPUMatrixSimdUnaryTensorOpImpl(beta, a, o, alpha, op, reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides))
+        return;
+
 // TODO: Change the lambda to take a pointer and a number of elements, so that we can pass it 1 or 4 elements, in order for it to SSE-vectorize.
 #define CaseUnaryTensorOp(oper)                                                        \
     case ElementWiseOperator::op##oper:                                                \
@@ -464,6 +656,10 @@ void CPUMatrixTensorOpImpl(ElemType beta, const CPUMatrix<ElemType>& a, const CP
         return;
 #endif
 
+    if (!!(CPUMatrix<ElemType>::GetOptimizationFlags() & CPUMatrix<ElemType>::OPT_EVAL_WITH_SIMD) &&
+        CPUMatrixSimdBinaryTensorOpImpl(beta, a, b, o, alpha, op, reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides))
+        return;
+
 #define CaseBinaryTensorOp(oper)                                                       \
     case ElementWiseOperator::op##oper:                                                \
         return TensorOpWithFn(beta, pointers, alpha, [](const array<ElemType*, 3>& pp) \
@@ -0,0 +1,282 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Runtime selection of the vectorized tensor kernels (CPUMatrixTensorSimd.h), and the entry points
+// from CPUMatrixTensorOpImpl() that map a tensor op to them if the operands are dense.
+//
+
+#include "stdafx.h"
+#include "CPUMatrixTensorImpl.h"
+#include "CPUMatrixTensorSimd.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+namespace Simd {
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+
+static void CpuId(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+{
+#ifdef _MSC_VER
+    __cpuidex(reinterpret_cast<int*>(regs), (int)leaf, (int)subleaf);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Returns the register state the OS saves on context switches (XCR0).
+static unsigned long long GetEnabledXSaveFeatures()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+static const TensorKernels* DetectTensorKernels()
+{
+    unsigned int regs[4]; // eax, ebx, ecx, edx
+    CpuId(0, 0, regs);
+    if (regs[0] < 7)
+        return nullptr;
+
+    CpuId(1, 0, regs);
+    const bool osxsave = (regs[2] & (1u << 27)) != 0;
+    const bool fma = (regs[2] & (1u << 12)) != 0;
+    const bool f16c = (regs[2] & (1u << 29)) != 0;
+    if (!osxsave)
+        return nullptr;
+
+    const unsigned long long xcr0 = GetEnabledXSaveFeatures();
+    const bool osSavesYmm = (xcr0 & 0x06) == 0x06; // SSE and AVX state
+    const bool osSavesZmm = (xcr0 & 0xe6) == 0xe6; // and the opmask and upper ZMM state
+
+    CpuId(7, 0, regs);
+    const bool avx2 = (regs[1] & (1u << 5)) != 0;
+    const bool avx512f = (regs[1] & (1u << 16)) != 0;
+
+    if (avx512f && osSavesZmm)
+        return &GetAvx512TensorKernels();
+    if (avx2 && fma && f16c && osSavesYmm)
+        return &GetAvx2TensorKernels();
+    return nullptr;
+}
+
+#else
+
+static const TensorKernels* DetectTensorKernels()
+{
+    return nullptr;
+}
+
+#endif
+
+const TensorKernels* GetTensorKernels()
+{
+    static const TensorKernels* kernels = DetectTensorKernels();
+    return kernels;
+}
+
+}
+
+// checks that 'strides' describe consecutive elements for 'dims', and returns their number
+static bool IsDense(const SmallVector<size_t>& dims, const SmallVector<ptrdiff_t>& strides, size_t& count)
+{
+    if (strides.size() != dims.size())
+        return false;
+
+    count = 1;
+    for (size_t rank = 0; rank < dims.size(); ++rank)
+    {
+        if (dims[rank] == 1)
+            continue;
+        if (strides[rank] != (ptrdiff_t)count)
+            return false;
+        count *= dims[rank];
+    }
+    return true;
+}
+
+// Runs 'kernel(begin, n)' over [0, count) in blocks, in parallel if there is more than one.
+template <typename Kernel>
+static void ForEachBlock(size_t count, const Kernel& kernel)
+{
+    const size_t blockSize = 16384;
+    int numBlocks = (int)((count + blockSize - 1) / blockSize);
+#pragma omp parallel for if (numBlocks > 1)
+    for (int i = 0; i < numBlocks; i++)
+    {
+        size_t begin = i * blockSize;
+        kernel(begin, std::min(blockSize, count - begin));
+    }
+}
+
+template <>
+bool CPUMatrixSimdUnaryTensorOpImpl<float>(float beta, const CPUMatrix<float>& a, CPUMatrix<float>& o, float alpha, ElementWiseOperator op, ElementWiseOperator reductionOp,
+    const array<size_t, 2>& offsets,
+    const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 2>& regularStrides,
+    const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 2>& reducingStrides)
+{
+    const Simd::TensorKernels* kernels = Simd::GetTensorKernels();
+    if (!kernels)
+        return false;
+
+    const float* pA = a.Data() + offsets[0];
+    float* pO = o.Data() + offsets[1];
+
+    if (reducingOpDims.size() == 0)
+    {
+        Simd::UnaryOp unaryOp;
+        switch (op)
+        {
+        case ElementWiseOperator::opSigmoid: unaryOp = Simd::UnaryOp::Sigmoid; break;
+        case ElementWiseOperator::opTanh:    unaryOp = Simd::UnaryOp::Tanh; break;
+        case ElementWiseOperator::opExp:     unaryOp = Simd::UnaryOp::Exp; break;
+        case ElementWiseOperator::opLog:     unaryOp = Simd::UnaryOp::Log; break;
+        default:
+            return false;
+        }
+
+        // strided and broadcasting cases are left to the generic code
+        size_t count;
+        if (regularStrides[0] != regularStrides[1] || !IsDense(regularOpDims, regularStrides[0], count))
+            return false;
+
+        ForEachBlock(count, [&](size_t begin, size_t n)
+        {
+            kernels->m_unary(unaryOp, n, pA + begin, pO + begin, alpha, beta);
+        });
+        return true;
+    }
+
+    // reduction over consecutive elements, e.g. the columns of a matrix
+    Simd::ReductionOp simdReductionOp;
+    switch (reductionOp)
+    {
+    case ElementWiseOperator::opSum: simdReductionOp = Simd::ReductionOp::Sum; break;
+    case ElementWiseOperator::opMax: simdReductionOp = Simd::ReductionOp::Max; break;
+    case ElementWiseOperator::opMin: simdReductionOp = Simd::ReductionOp::Min; break;
+    default:
+        return false;
+    }
+
+    if (op != ElementWiseOperator::opCopy || reducingOpDims.size() != 1 || reducingStrides[0][0] != 1 || regularOpDims.size() > 1)
+        return false;
+
+    const size_t n = reducingOpDims[0];
+    const size_t numOutputs = regularOpDims.size() == 0 ? 1 : regularOpDims[0];
+    const ptrdiff_t inputStride = regularOpDims.size() == 0 ? 0 : regularStrides[0][0];
+    const ptrdiff_t outputStride = regularOpDims.size() == 0 ? 0 : regularStrides[1][0];
+
+#pragma omp parallel for if (numOutputs > 1 && n * numOutputs > 16384)
+    for (int j = 0; j < (int)numOutputs; j++)
+    {
+        // same rounding steps as the generic code
+        float val = (float)kernels->m_reduce(simdReductionOp, n, pA + j * inputStride);
+        val *= alpha;
+        float* pout = pO + j * outputStride;
+        if (beta != 0)
+            val += beta * *pout;
+        *pout = val;
+    }
+    return true;
+}
+
+template <>
+bool CPUMatrixSimdBinaryTensorOpImpl<float>(float beta, const CPUMatrix<float>& a, const CPUMatrix<float>& b, CPUMatrix<float>& o, float alpha, ElementWiseOperator op, ElementWiseOperator /*reductionOp*/,
+    const array<size_t, 3>& offsets,
+    const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 3>& regularStrides,
+    const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 3>& /*reducingStrides*/)
+{
+    const Simd::TensorKernels* kernels = Simd::GetTensorKernels();
+    if (!kernels || reducingOpDims.size() != 0)
+        return false;
+
+    Simd::BinaryOp binaryOp;
+    switch (op)
+    {
+    case ElementWiseOperator::opSum:                binaryOp = Simd::BinaryOp::Sum; break;
+    case ElementWiseOperator::opDifference:         binaryOp = Simd::BinaryOp::Difference; break;
+    case ElementWiseOperator::opElementwiseProduct: binaryOp = Simd::BinaryOp::ElementwiseProduct; break;
+    default:
+        return false;
+    }
+
+    size_t count;
+    if (regularStrides[0] != regularStrides[2] || regularStrides[1] != regularStrides[2] || !IsDense(regularOpDims, regularStrides[2], count))
+        return false;
+
+    const float* pA = a.Data() + offsets[0];
+    const float* pB = b.Data() + offsets[1];
+    float* pO = o.Data() + offsets[2];
+    ForEachBlock(count, [&](size_t begin, size_t n)
+    {
+        kernels->m_binary(binaryOp, n, pA + begin, pB + begin, pO + begin, alpha, beta);
+    });
+    return true;
+}
+
+template <>
+bool CPUMatrixSimdUnaryTensorOpImpl<double>(double, const CPUMatrix<double>&, CPUMatrix<double>&, double, ElementWiseOperator, ElementWiseOperator,
+    const array<size_t, 2>&,
+    const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, 2>&,
+    const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, 2>&)
+{
+    return false;
+}
+
+template <>
+bool CPUMatrixSimdBinaryTensorOpImpl<double>(double, const CPUMatrix<double>&, const CPUMatrix<double>&, CPUMatrix<double>&, double, ElementWiseOperator, ElementWiseOperator,
+    const array<size_t, 3>&,
+    const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, 3>&,
+    const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, 3>&)
+{
+    return false;
+}
+
+template <>
+bool CPUMatrixSimdUnaryTensorOpImpl<half>(half, const CPUMatrix<half>&, CPUMatrix<half>&, half, ElementWiseOperator, ElementWiseOperator,
+    const array<size_t, 2>&,
+    const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, 2>&,
+    const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, 2>&)
+{
+    return false;
+}
+
+template <>
+bool CPUMatrixSimdBinaryTensorOpImpl<half>(half, const CPUMatrix<half>&, const CPUMatrix<half>&, CPUMatrix<half>&, half, ElementWiseOperator, ElementWiseOperator,
+    const array<size_t, 3>&,
+    const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, 3>&,
+    const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, 3>&)
+{
+    return false;
+}
+
+template <>
+bool CPUMatrixSimdUnaryTensorOpImpl<bfloat16>(bfloat16, const CPUMatrix<bfloat16>&, CPUMatrix<bfloat16>&, bfloat16, ElementWiseOperator, ElementWiseOperator,
+    const array<size_t, 2>&,
+    const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, 2>&,
+    const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, 2>&)
+{
+    return false;
+}
+
+template <>
+bool CPUMatrixSimdBinaryTensorOpImpl<bfloat16>(bfloat16, const CPUMatrix<bfloat16>&, const CPUMatrix<bfloat16>&, CPUMatrix<bfloat16>&, bfloat16, ElementWiseOperator, ElementWiseOperator,
+    const array<size_t, 3>&,
+    const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, 3>&,
+    const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, 3>&)
+{
+    return false;
+}
+
+}}}
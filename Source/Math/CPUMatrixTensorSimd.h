@@ -0,0 +1,66 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Hand-vectorized float kernels for the common elementwise tensor ops on CPU, and for the conversion
+// of half precision data to and from float, and the int8 dot product of the quantized products.
+// The kernels are compiled once per instruction set (CPUMatrixTensorSimdAvx2.cpp, CPUMatrixTensorSimdAvx512.cpp),
+// the best one supported by the CPU is picked at runtime (CPUMatrixTensorSimd.cpp).
+//
+// This header is included by translation units that are compiled with AVX2/AVX-512 code generation,
+// so it must not pull in any other header with inline functions: the linker could otherwise pick
+// their AVX version for use by the rest of the library.
+//
+
+#pragma once
+
+#include <stddef.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Simd {
+
+enum class UnaryOp
+{
+    Sigmoid,
+    Tanh,
+    Exp,
+    Log, // clipped like ClippedLog() in TensorOps.h
+};
+
+enum class BinaryOp
+{
+    Sum,
+    Difference,
+    ElementwiseProduct,
+};
+
+enum class ReductionOp
+{
+    Sum, // aggregated in double, like the generic code
+    Max,
+    Min,
+};
+
+// Kernels over 'n' consecutive elements. The elementwise ones compute o = beta * o + alpha * op(inputs),
+// o is not read if beta == 0. The reduction returns the aggregate of the n (> 0) elements.
+// The conversions take half precision values as their IEEE bit patterns and round to nearest even, like
+// the scalar code in HalfConverter.hpp. Unlike that code they keep the payload of NaNs.
+// The int8 dot product accumulates in int32, 'n' must be below 2^17 to rule out overflow.
+struct TensorKernels
+{
+    const char* m_name;
+    void (*m_unary)(UnaryOp op, size_t n, const float* a, float* o, float alpha, float beta);
+    void (*m_binary)(BinaryOp op, size_t n, const float* a, const float* b, float* o, float alpha, float beta);
+    double (*m_reduce)(ReductionOp op, size_t n, const float* a);
+    void (*m_halfToFloat)(size_t n, const unsigned short* a, float* o);
+    void (*m_floatToHalf)(size_t n, const float* a, unsigned short* o);
+    int (*m_dotInt8)(size_t n, const signed char* a, const signed char* b);
+};
+
+const TensorKernels& GetAvx2TensorKernels();
+const TensorKernels& GetAvx512TensorKernels();
+
+// Returns the kernels for the best instruction set supported by the CPU, or nullptr if there are none.
+// The CPU is inspected on the first call.
+const TensorKernels* GetTensorKernels();
+
+}}}}
@@ -0,0 +1,140 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// AVX2 + FMA + F16C version of the tensor kernels. This file is compiled with AVX2 code generation
+// (-mavx2 -mfma -mf16c, /arch:AVX2) and does not use the precompiled header, see CPUMatrixTensorSimd.h.
+//
+
+#include "CPUMatrixTensorSimdKernels.h"
+#include <immintrin.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Simd {
+
+namespace {
+
+// The vector traits interface used by CPUMatrixTensorSimdKernels.h.
+struct Avx2
+{
+    typedef __m256 Vec;
+    typedef __m256 Mask;
+    static const size_t Width = 8;
+
+    static inline Vec Load(const float* p) { return _mm256_loadu_ps(p); }
+    static inline void Store(float* p, Vec v) { _mm256_storeu_ps(p, v); }
+    static inline Vec Set(float v) { return _mm256_set1_ps(v); }
+
+    // half precision values, as their bit patterns
+    static inline Vec LoadHalf(const unsigned short* p) { return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))); }
+    static inline void StoreHalf(unsigned short* p, Vec v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT)); }
+
+    static inline Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    static inline Vec Sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+    static inline Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+    static inline Vec Div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+    static inline Vec MulAdd(Vec a, Vec b, Vec c) { return _mm256_fmadd_ps(a, b, c); } // a * b + c
+    static inline Vec Max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+    static inline Vec Min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+    static inline Vec Floor(Vec a) { return _mm256_floor_ps(a); }
+    static inline Vec Abs(Vec a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+
+    // magnitude of 'a' with the sign of 'sign'
+    static inline Vec CopySign(Vec a, Vec sign)
+    {
+        const Vec signMask = _mm256_set1_ps(-0.0f);
+        return _mm256_or_ps(_mm256_andnot_ps(signMask, a), _mm256_and_ps(signMask, sign));
+    }
+
+    static inline Mask Lt(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static inline Mask Gt(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static inline Mask IsNan(Vec a) { return _mm256_cmp_ps(a, a, _CMP_UNORD_Q); }
+    static inline Vec Select(Mask m, Vec ifTrue, Vec ifFalse) { return _mm256_blendv_ps(ifFalse, ifTrue, m); }
+
+    // 2^n for integral n in [-126, 127]
+    static inline Vec Pow2(Vec n)
+    {
+        __m256i e = _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(e, 23));
+    }
+
+    // x = m * 2^e with m in [0.5, 1), for positive normal x
+    static inline Vec Frexp(Vec x, Vec& e)
+    {
+        __m256i bits = _mm256_castps_si256(x);
+        e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+        bits = _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)), _mm256_set1_epi32(0x3f000000));
+        return _mm256_castsi256_ps(bits);
+    }
+
+    // sums are accumulated in double
+    struct SumAccumulator
+    {
+        __m256d m_low;
+        __m256d m_high;
+    };
+
+    static inline SumAccumulator ZeroSum() { return { _mm256_setzero_pd(), _mm256_setzero_pd() }; }
+
+    static inline SumAccumulator AddToSum(SumAccumulator acc, Vec v)
+    {
+        acc.m_low = _mm256_add_pd(acc.m_low, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+        acc.m_high = _mm256_add_pd(acc.m_high, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+        return acc;
+    }
+
+    static inline double ReduceSum(SumAccumulator acc)
+    {
+        __m256d s = _mm256_add_pd(acc.m_low, acc.m_high);
+        __m128d t = _mm_add_pd(_mm256_castpd256_pd128(s), _mm256_extractf128_pd(s, 1));
+        t = _mm_add_sd(t, _mm_unpackhi_pd(t, t));
+        return _mm_cvtsd_f64(t);
+    }
+
+    static inline float ReduceMax(Vec v)
+    {
+        __m128 t = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        t = _mm_max_ps(t, _mm_movehl_ps(t, t));
+        t = _mm_max_ss(t, _mm_shuffle_ps(t, t, 1));
+        return _mm_cvtss_f32(t);
+    }
+
+    static inline float ReduceMin(Vec v)
+    {
+        __m128 t = _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        t = _mm_min_ps(t, _mm_movehl_ps(t, t));
+        t = _mm_min_ss(t, _mm_shuffle_ps(t, t, 1));
+        return _mm_cvtss_f32(t);
+    }
+};
+
+// The values are widened to 16 bit, so each product pair can be summed to 32 bit by _mm256_madd_epi16 without saturation.
+static int DotInt8(size_t n, const signed char* a, const signed char* b)
+{
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+        __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+    }
+
+    __m128i t = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    t = _mm_add_epi32(t, _mm_shuffle_epi32(t, _MM_SHUFFLE(1, 0, 3, 2)));
+    t = _mm_add_epi32(t, _mm_shuffle_epi32(t, _MM_SHUFFLE(2, 3, 0, 1)));
+    int sum = _mm_cvtsi128_si32(t);
+    for (; i < n; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+}
+
+const TensorKernels& GetAvx2TensorKernels()
+{
+    static const TensorKernels kernels = { "AVX2", &KernelsFor<Avx2>::Unary, &KernelsFor<Avx2>::Binary, &KernelsFor<Avx2>::Reduce,
+                                           &KernelsFor<Avx2>::HalfToFloat, &KernelsFor<Avx2>::FloatToHalf, &DotInt8 };
+    return kernels;
+}
+
+}}}}
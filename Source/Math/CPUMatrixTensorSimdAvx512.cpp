@@ -0,0 +1,102 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// AVX-512 (AVX512F only) version of the tensor kernels. This file is compiled with AVX-512 code generation
+// (-mavx512f, /arch:AVX512) and does not use the precompiled header, see CPUMatrixTensorSimd.h.
+// The interface of the traits class is described in CPUMatrixTensorSimdAvx2.cpp.
+//
+
+#include "CPUMatrixTensorSimdKernels.h"
+#include <immintrin.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Simd {
+
+namespace {
+
+struct Avx512
+{
+    typedef __m512 Vec;
+    typedef __mmask16 Mask;
+    static const size_t Width = 16;
+
+    static inline Vec Load(const float* p) { return _mm512_loadu_ps(p); }
+    static inline void Store(float* p, Vec v) { _mm512_storeu_ps(p, v); }
+    static inline Vec Set(float v) { return _mm512_set1_ps(v); }
+
+    static inline Vec LoadHalf(const unsigned short* p) { return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))); }
+    static inline void StoreHalf(unsigned short* p, Vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT)); }
+
+    static inline Vec Add(Vec a, Vec b) { return _mm512_add_ps(a, b); }
+    static inline Vec Sub(Vec a, Vec b) { return _mm512_sub_ps(a, b); }
+    static inline Vec Mul(Vec a, Vec b) { return _mm512_mul_ps(a, b); }
+    static inline Vec Div(Vec a, Vec b) { return _mm512_div_ps(a, b); }
+    static inline Vec MulAdd(Vec a, Vec b, Vec c) { return _mm512_fmadd_ps(a, b, c); }
+    static inline Vec Max(Vec a, Vec b) { return _mm512_max_ps(a, b); }
+    static inline Vec Min(Vec a, Vec b) { return _mm512_min_ps(a, b); }
+    static inline Vec Floor(Vec a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+
+    // the floating point bitwise operations need AVX512DQ, use the integer ones instead
+    static inline Vec Abs(Vec a)
+    {
+        return _mm512_castsi512_ps(_mm512_and_epi32(_mm512_castps_si512(a), _mm512_set1_epi32(0x7fffffff)));
+    }
+
+    static inline Vec CopySign(Vec a, Vec sign)
+    {
+        const __m512i signMask = _mm512_set1_epi32(0x80000000);
+        return _mm512_castsi512_ps(_mm512_or_epi32(_mm512_andnot_epi32(signMask, _mm512_castps_si512(a)),
+                                                   _mm512_and_epi32(signMask, _mm512_castps_si512(sign))));
+    }
+
+    static inline Mask Lt(Vec a, Vec b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static inline Mask Gt(Vec a, Vec b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+    static inline Mask IsNan(Vec a) { return _mm512_cmp_ps_mask(a, a, _CMP_UNORD_Q); }
+    static inline Vec Select(Mask m, Vec ifTrue, Vec ifFalse) { return _mm512_mask_blend_ps(m, ifFalse, ifTrue); }
+
+    static inline Vec Pow2(Vec n)
+    {
+        __m512i e = _mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127));
+        return _mm512_castsi512_ps(_mm512_slli_epi32(e, 23));
+    }
+
+    static inline Vec Frexp(Vec x, Vec& e)
+    {
+        __m512i bits = _mm512_castps_si512(x);
+        e = _mm512_cvtepi32_ps(_mm512_sub_epi32(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(126)));
+        bits = _mm512_or_epi32(_mm512_and_epi32(bits, _mm512_set1_epi32(0x007fffff)), _mm512_set1_epi32(0x3f000000));
+        return _mm512_castsi512_ps(bits);
+    }
+
+    struct SumAccumulator
+    {
+        __m512d m_low;
+        __m512d m_high;
+    };
+
+    static inline SumAccumulator ZeroSum() { return { _mm512_setzero_pd(), _mm512_setzero_pd() }; }
+
+    static inline SumAccumulator AddToSum(SumAccumulator acc, Vec v)
+    {
+        __m256 high = _mm256_castsi256_ps(_mm512_extracti64x4_epi64(_mm512_castps_si512(v), 1));
+        acc.m_low = _mm512_add_pd(acc.m_low, _mm512_cvtps_pd(_mm512_castps512_ps256(v)));
+        acc.m_high = _mm512_add_pd(acc.m_high, _mm512_cvtps_pd(high));
+        return acc;
+    }
+
+    static inline double ReduceSum(SumAccumulator acc) { return _mm512_reduce_add_pd(_mm512_add_pd(acc.m_low, acc.m_high)); }
+    static inline float ReduceMax(Vec v) { return _mm512_reduce_max_ps(v); }
+    static inline float ReduceMin(Vec v) { return _mm512_reduce_min_ps(v); }
+};
+
+}
+
+const TensorKernels& GetAvx512TensorKernels()
+{
+    // AVX512F has no 16 bit multiply-add (that is AVX512BW), the int8 dot product is the AVX2 one
+    static const TensorKernels kernels = { "AVX-512", &KernelsFor<Avx512>::Unary, &KernelsFor<Avx512>::Binary, &KernelsFor<Avx512>::Reduce,
+                                           &KernelsFor<Avx512>::HalfToFloat, &KernelsFor<Avx512>::FloatToHalf, GetAvx2TensorKernels().m_dotInt8 };
+    return kernels;
+}
+
+}}}}
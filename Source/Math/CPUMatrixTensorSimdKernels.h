@@ -0,0 +1,308 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Implementation of the kernels declared in CPUMatrixTensorSimd.h, written against a vector traits
+// class that wraps the intrinsics of one instruction set (see CPUMatrixTensorSimdAvx2.cpp for the interface).
+// Only to be included once per instruction set, by the translation unit compiled for it.
+//
+// The transcendental functions follow the single precision Cephes implementations (expf, logf, tanhf),
+// which are accurate to about 2 ulp over the full range.
+//
+
+#pragma once
+
+#include "CPUMatrixTensorSimd.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Simd {
+
+template <class T>
+struct KernelsFor
+{
+    typedef typename T::Vec Vec;
+    static const size_t Width = T::Width;
+
+    static inline Vec Exp(Vec x)
+    {
+        // beyond these bounds the result is inf or 0 in single precision
+        const Vec hi = T::Set(88.72283935546875f);
+        const Vec lo = T::Set(-104.0f);
+
+        Vec xc = T::Min(T::Max(x, lo), hi);
+
+        // exp(x) = 2^n * exp(r), with r = x - n * ln(2) in [-ln(2)/2, ln(2)/2]
+        Vec n = T::Floor(T::MulAdd(xc, T::Set(1.44269504088896341f), T::Set(0.5f)));
+        Vec r = T::Sub(xc, T::Mul(n, T::Set(0.693359375f)));
+        r = T::Sub(r, T::Mul(n, T::Set(-2.12194440e-4f)));
+
+        Vec y = T::Set(1.9875691500E-4f);
+        y = T::MulAdd(y, r, T::Set(1.3981999507E-3f));
+        y = T::MulAdd(y, r, T::Set(8.3334519073E-3f));
+        y = T::MulAdd(y, r, T::Set(4.1665795894E-2f));
+        y = T::MulAdd(y, r, T::Set(1.6666665459E-1f));
+        y = T::MulAdd(y, r, T::Set(5.0000001201E-1f));
+        y = T::Add(T::MulAdd(y, T::Mul(r, r), r), T::Set(1.0f));
+
+        // n is in [-150, 128], which does not fit into a single exponent: scale in two steps
+        Vec n1 = T::Floor(T::Mul(n, T::Set(0.5f)));
+        Vec n2 = T::Sub(n, n1);
+        y = T::Mul(T::Mul(y, T::Pow2(n1)), T::Pow2(n2));
+
+        y = T::Select(T::Gt(x, hi), T::Set(Infinity()), y);
+        y = T::Select(T::Lt(x, lo), T::Set(0.0f), y);
+        return T::Select(T::IsNan(x), x, y);
+    }
+
+    // log(x), clipped to LOG_OF_EPS_IN_LOG for x < EPS_IN_LOG (see CommonMatrix.h)
+    static inline Vec ClippedLog(Vec x)
+    {
+        const Vec eps = T::Set(1e-37f);
+
+        // eps is a normal number, so the decomposition below needs no special case for denormals
+        Vec e;
+        Vec m = T::Frexp(T::Max(x, eps), e); // m in [0.5, 1)
+
+        // move m to [sqrt(1/2), sqrt(2)) and subtract 1
+        auto small = T::Lt(m, T::Set(0.707106781186547524f));
+        e = T::Select(small, T::Sub(e, T::Set(1.0f)), e);
+        m = T::Sub(T::Select(small, T::Add(m, m), m), T::Set(1.0f));
+
+        Vec z = T::Mul(m, m);
+        Vec y = T::Set(7.0376836292E-2f);
+        y = T::MulAdd(y, m, T::Set(-1.1514610310E-1f));
+        y = T::MulAdd(y, m, T::Set(1.1676998740E-1f));
+        y = T::MulAdd(y, m, T::Set(-1.2420140846E-1f));
+        y = T::MulAdd(y, m, T::Set(1.4249322787E-1f));
+        y = T::MulAdd(y, m, T::Set(-1.6668057665E-1f));
+        y = T::MulAdd(y, m, T::Set(2.0000714765E-1f));
+        y = T::MulAdd(y, m, T::Set(-2.4999993993E-1f));
+        y = T::MulAdd(y, m, T::Set(3.3333331174E-1f));
+        y = T::Mul(T::Mul(y, m), z);
+
+        y = T::MulAdd(e, T::Set(-2.12194440e-4f), y);
+        y = T::MulAdd(z, T::Set(-0.5f), y);
+        Vec result = T::Add(m, y);
+        result = T::MulAdd(e, T::Set(0.693359375f), result);
+
+        result = T::Select(T::Lt(x, eps), T::Set(-85.1f), result);
+        result = T::Select(T::Gt(x, T::Set(3.40282347e+38f)), x, result); // log(inf) = inf
+        return T::Select(T::IsNan(x), x, result);
+    }
+
+    // same formula as Sigmoid() in TensorOps.h
+    static inline Vec Sigmoid(Vec x)
+    {
+        return T::Div(T::Set(1.0f), T::Add(Exp(T::Sub(T::Set(0.0f), x)), T::Set(1.0f)));
+    }
+
+    static inline Vec Tanh(Vec x)
+    {
+        Vec ax = T::Abs(x);
+
+        // small arguments: odd polynomial, avoids the cancellation in the formula below
+        Vec z = T::Mul(x, x);
+        Vec p = T::Set(-5.70498872745E-3f);
+        p = T::MulAdd(p, z, T::Set(2.06390887954E-2f));
+        p = T::MulAdd(p, z, T::Set(-5.37397155531E-2f));
+        p = T::MulAdd(p, z, T::Set(1.33314422036E-1f));
+        p = T::MulAdd(p, z, T::Set(-3.33332819422E-1f));
+        Vec small = T::MulAdd(T::Mul(p, z), x, x);
+
+        // tanh(|x|) = 1 - 2 / (exp(2 |x|) + 1)
+        Vec large = T::Sub(T::Set(1.0f), T::Div(T::Set(2.0f), T::Add(Exp(T::Add(ax, ax)), T::Set(1.0f))));
+        large = T::CopySign(large, x);
+
+        return T::Select(T::Lt(ax, T::Set(0.625f)), small, large);
+    }
+
+    // o = beta * o + alpha * f(a), evaluated in the same order as the generic code
+    template <class F>
+    static inline void Map(size_t n, const float* a, float* o, float alpha, float beta, const F& f)
+    {
+        const Vec va = T::Set(alpha);
+        const Vec vb = T::Set(beta);
+        size_t i = 0;
+        if (beta == 0)
+        {
+            for (; i + Width <= n; i += Width)
+                T::Store(o + i, T::Mul(f(T::Load(a + i)), va));
+        }
+        else
+        {
+            for (; i + Width <= n; i += Width)
+                T::Store(o + i, T::Add(T::Mul(f(T::Load(a + i)), va), T::Mul(vb, T::Load(o + i))));
+        }
+
+        if (i < n)
+        {
+            // the tail goes through a padded copy, so that all elements get the same function
+            float ta[Width], to[Width];
+            for (size_t j = 0; j < Width; j++)
+            {
+                ta[j] = i + j < n ? a[i + j] : 1.0f;
+                to[j] = i + j < n && beta != 0 ? o[i + j] : 0.0f;
+            }
+            Vec r = T::Mul(f(T::Load(ta)), va);
+            if (beta != 0)
+                r = T::Add(r, T::Mul(vb, T::Load(to)));
+            T::Store(to, r);
+            for (size_t j = 0; i + j < n; j++)
+                o[i + j] = to[j];
+        }
+    }
+
+    template <class F>
+    static inline void Map(size_t n, const float* a, const float* b, float* o, float alpha, float beta, const F& f)
+    {
+        const Vec va = T::Set(alpha);
+        const Vec vb = T::Set(beta);
+        size_t i = 0;
+        if (beta == 0)
+        {
+            for (; i + Width <= n; i += Width)
+                T::Store(o + i, T::Mul(f(T::Load(a + i), T::Load(b + i)), va));
+        }
+        else
+        {
+            for (; i + Width <= n; i += Width)
+                T::Store(o + i, T::Add(T::Mul(f(T::Load(a + i), T::Load(b + i)), va), T::Mul(vb, T::Load(o + i))));
+        }
+
+        if (i < n)
+        {
+            float ta[Width], tb[Width], to[Width];
+            for (size_t j = 0; j < Width; j++)
+            {
+                ta[j] = i + j < n ? a[i + j] : 1.0f;
+                tb[j] = i + j < n ? b[i + j] : 1.0f;
+                to[j] = i + j < n && beta != 0 ? o[i + j] : 0.0f;
+            }
+            Vec r = T::Mul(f(T::Load(ta), T::Load(tb)), va);
+            if (beta != 0)
+                r = T::Add(r, T::Mul(vb, T::Load(to)));
+            T::Store(to, r);
+            for (size_t j = 0; i + j < n; j++)
+                o[i + j] = to[j];
+        }
+    }
+
+    static void Unary(UnaryOp op, size_t n, const float* a, float* o, float alpha, float beta)
+    {
+        switch (op)
+        {
+        case UnaryOp::Sigmoid:
+            return Map(n, a, o, alpha, beta, [](Vec x) { return Sigmoid(x); });
+        case UnaryOp::Tanh:
+            return Map(n, a, o, alpha, beta, [](Vec x) { return Tanh(x); });
+        case UnaryOp::Exp:
+            return Map(n, a, o, alpha, beta, [](Vec x) { return Exp(x); });
+        case UnaryOp::Log:
+            return Map(n, a, o, alpha, beta, [](Vec x) { return ClippedLog(x); });
+        }
+    }
+
+    static void Binary(BinaryOp op, size_t n, const float* a, const float* b, float* o, float alpha, float beta)
+    {
+        switch (op)
+        {
+        case BinaryOp::Sum:
+            return Map(n, a, b, o, alpha, beta, [](Vec x, Vec y) { return T::Add(x, y); });
+        case BinaryOp::Difference:
+            return Map(n, a, b, o, alpha, beta, [](Vec x, Vec y) { return T::Sub(x, y); });
+        case BinaryOp::ElementwiseProduct:
+            return Map(n, a, b, o, alpha, beta, [](Vec x, Vec y) { return T::Mul(x, y); });
+        }
+    }
+
+    static double Reduce(ReductionOp op, size_t n, const float* a)
+    {
+        size_t i = 0;
+        switch (op)
+        {
+        case ReductionOp::Sum:
+        {
+            auto acc = T::ZeroSum();
+            for (; i + Width <= n; i += Width)
+                acc = T::AddToSum(acc, T::Load(a + i));
+            double sum = T::ReduceSum(acc);
+            for (; i < n; i++)
+                sum += a[i];
+            return sum;
+        }
+        case ReductionOp::Max:
+        {
+            float result = a[0];
+            if (n >= Width)
+            {
+                Vec m = T::Load(a);
+                for (i = Width; i + Width <= n; i += Width)
+                    m = T::Max(m, T::Load(a + i));
+                result = T::ReduceMax(m);
+            }
+            for (; i < n; i++)
+                result = a[i] > result ? a[i] : result;
+            return result;
+        }
+        case ReductionOp::Min:
+        {
+            float result = a[0];
+            if (n >= Width)
+            {
+                Vec m = T::Load(a);
+                for (i = Width; i + Width <= n; i += Width)
+                    m = T::Min(m, T::Load(a + i));
+                result = T::ReduceMin(m);
+            }
+            for (; i < n; i++)
+                result = a[i] < result ? a[i] : result;
+            return result;
+        }
+        }
+        return 0;
+    }
+
+    static void HalfToFloat(size_t n, const unsigned short* a, float* o)
+    {
+        size_t i = 0;
+        for (; i + Width <= n; i += Width)
+            T::Store(o + i, T::LoadHalf(a + i));
+
+        if (i < n)
+        {
+            unsigned short ta[Width] = {};
+            float to[Width];
+            for (size_t j = 0; i + j < n; j++)
+                ta[j] = a[i + j];
+            T::Store(to, T::LoadHalf(ta));
+            for (size_t j = 0; i + j < n; j++)
+                o[i + j] = to[j];
+        }
+    }
+
+    static void FloatToHalf(size_t n, const float* a, unsigned short* o)
+    {
+        size_t i = 0;
+        for (; i + Width <= n; i += Width)
+            T::StoreHalf(o + i, T::Load(a + i));
+
+        if (i < n)
+        {
+            float ta[Width] = {};
+            unsigned short to[Width];
+            for (size_t j = 0; i + j < n; j++)
+                ta[j] = a[i + j];
+            T::StoreHalf(to, T::Load(ta));
+            for (size_t j = 0; i + j < n; j++)
+                o[i + j] = to[j];
+        }
+    }
+
+private:
+    static inline float Infinity()
+    {
+        union { unsigned int i; float f; } inf = { 0x7f800000u };
+        return inf.f;
+    }
+};
+
+}}}}
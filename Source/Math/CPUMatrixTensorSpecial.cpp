@@ -231,6 +231,33 @@ bool CPUMatrixSpecialTernaryTensorOpImpl<half>(half, const CPUMatrix<half>&, con
     return false;
 }
 
+template<>
+bool CPUMatrixSpecialUnaryTensorOpImpl<bfloat16>(bfloat16, const CPUMatrix<bfloat16>&, CPUMatrix<bfloat16>&, bfloat16, ElementWiseOperator, ElementWiseOperator,
+    const array<size_t, 2>&,
+    const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, 2>&,
+    const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, 2>&)
+{
+    return false;
+}
+
+template<>
+bool CPUMatrixSpecialBinaryTensorOpImpl<bfloat16>(bfloat16, const CPUMatrix<bfloat16>&, const CPUMatrix<bfloat16>&, CPUMatrix<bfloat16>&, bfloat16, ElementWiseOperator, ElementWiseOperator,
+    const array<size_t, 3>&,
+    const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, 3>&,
+    const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, 3>&)
+{
+    return false;
+}
+
+template<>
+bool CPUMatrixSpecialTernaryTensorOpImpl<bfloat16>(bfloat16, const CPUMatrix<bfloat16>&, const CPUMatrix<bfloat16>&, const CPUMatrix<bfloat16>&, CPUMatrix<bfloat16>&, bfloat16, ElementWiseOperator, ElementWiseOperator,
+    const array<size_t, 4>&,
+    const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, 4>&,
+    const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, 4>&)
+{
+    return false;
+}
+
 }}}
 
 #endif
\ No newline at end of file
@@ -0,0 +1,368 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "CPURNN.h"
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+
+#ifdef USE_MKL
+#include <mkl_cblas.h>
+#else
+// OpenBLAS declares its own bfloat16, a typedef of uint16_t that would clash with the element type of the same name
+#define bfloat16 openblas_bfloat16
+#include <cblas.h>
+#undef bfloat16
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// c = op(a) * b + beta * c on column-major matrices, op(a) = a^T if transA
+static void Gemm(bool transA, size_t m, size_t n, size_t k, const float* a, size_t lda, const float* b, size_t ldb, float beta, float* c, size_t ldc)
+{
+    cblas_sgemm(CblasColMajor, transA ? CblasTrans : CblasNoTrans, CblasNoTrans, (int)m, (int)n, (int)k, 1.0f, a, (int)lda, b, (int)ldb, beta, c, (int)ldc);
+}
+
+static void Gemm(bool transA, size_t m, size_t n, size_t k, const double* a, size_t lda, const double* b, size_t ldb, double beta, double* c, size_t ldc)
+{
+    cblas_dgemm(CblasColMajor, transA ? CblasTrans : CblasNoTrans, CblasNoTrans, (int)m, (int)n, (int)k, 1.0, a, (int)lda, b, (int)ldb, beta, c, (int)ldc);
+}
+
+template <class ElemType>
+static inline ElemType Sigmoid(ElemType x)
+{
+    return 1 / (1 + exp(-x));
+}
+
+template <class ElemType>
+CPURNNExecutor<ElemType>::CPURNNExecutor(size_t xDim, size_t yDim, const RnnAttributes& rnnAttributes)
+    : m_xDim(xDim), m_yDim(yDim),
+      m_hiddenSize(rnnAttributes.m_hiddenSize), m_numLayers(rnnAttributes.m_numLayers), m_numDirections(rnnAttributes.m_bidirectional ? 2 : 1),
+      m_persistent(rnnAttributes.m_persistent)
+{
+    if      (rnnAttributes.m_recurrentOp == L"lstm")    m_mode = Mode::LSTM, m_numGates = 4;
+    else if (rnnAttributes.m_recurrentOp == L"gru")     m_mode = Mode::GRU,  m_numGates = 3;
+    else if (rnnAttributes.m_recurrentOp == L"rnnReLU") m_mode = Mode::ReLU, m_numGates = 1;
+    else if (rnnAttributes.m_recurrentOp == L"rnnTanh") m_mode = Mode::Tanh, m_numGates = 1;
+    else InvalidArgument("Unknown cell type '%ls'. Supported values are 'lstm', 'gru', 'rnnReLU', 'rnnTanh'.", rnnAttributes.m_recurrentOp.c_str());
+}
+
+// same as RnnAttributes::GetNumParameters(), but for the actual input dimension
+template <class ElemType>
+size_t CPURNNExecutor<ElemType>::GetNumParameters() const
+{
+    const size_t gateDim = m_numGates * m_hiddenSize;
+    size_t total = 0;
+    size_t inputDim = m_xDim;
+    for (size_t layer = 0; layer < m_numLayers; layer++)
+    {
+        total += m_numDirections * gateDim * (inputDim + m_hiddenSize + 2);
+        inputDim = m_numDirections * m_hiddenSize;
+    }
+    return total;
+}
+
+template <class ElemType>
+/*static*/ inline void CPURNNExecutor<ElemType>::UpdateUnit(Mode mode, size_t k, size_t hiddenSize, const ElemType* g, const ElemType* r, bool hasState,
+                                                           const ElemType* bh, const ElemType* hPrev, ElemType* c, ElemType* h)
+{
+    switch (mode)
+    {
+    case Mode::LSTM:
+    {
+        const size_t k1 = k + hiddenSize, k2 = k1 + hiddenSize, k3 = k2 + hiddenSize;
+        const ElemType inputGate  = Sigmoid(g[k]  + (hasState ? r[k]  : 0));
+        const ElemType forgetGate = Sigmoid(g[k1] + (hasState ? r[k1] : 0));
+        const ElemType cellInput  = tanh(   g[k2] + (hasState ? r[k2] : 0));
+        const ElemType outputGate = Sigmoid(g[k3] + (hasState ? r[k3] : 0));
+        c[k] = (hasState ? forgetGate * c[k] : 0) + inputGate * cellInput;
+        h[k] = outputGate * tanh(c[k]);
+        break;
+    }
+    case Mode::GRU:
+    {
+        const size_t k1 = k + hiddenSize, k2 = k1 + hiddenSize;
+        const ElemType resetGate  = Sigmoid(g[k]  + (hasState ? r[k]  : 0));
+        const ElemType updateGate = Sigmoid(g[k1] + (hasState ? r[k1] : 0));
+        const ElemType candidate  = tanh(g[k2] + resetGate * ((hasState ? r[k2] : 0) + bh[k2]));
+        h[k] = (1 - updateGate) * candidate + (hasState ? updateGate * hPrev[k] : 0);
+        break;
+    }
+    case Mode::ReLU:
+        h[k] = std::max<ElemType>(g[k] + (hasState ? r[k] : 0), 0);
+        break;
+    case Mode::Tanh:
+        h[k] = tanh(g[k] + (hasState ? r[k] : 0));
+        break;
+    }
+}
+
+template <class ElemType>
+bool CPURNNExecutor<ElemType>::MayRunPersistent(size_t maxNumSequences) const
+{
+    if (!m_persistent || maxNumSequences > c_maxPersistentSequences)
+        return false;
+    const size_t recurrentWeightBytes = m_numGates * m_hiddenSize * m_hiddenSize * sizeof(ElemType);
+    return recurrentWeightBytes <= (size_t)omp_get_max_threads() * c_maxPersistentWeightBytesPerThread;
+}
+
+template <class ElemType>
+void CPURNNExecutor<ElemType>::ForwardCore(const CPUMatrix<ElemType>& weightsW, const CPUMatrix<ElemType>& inputX, CPUMatrix<ElemType>& outputY,
+                                           const std::vector<size_t>& numSequencesForFrame, CPUMatrix<ElemType>& workspace)
+{
+    const size_t hiddenSize = m_hiddenSize;
+    const size_t gateDim = m_numGates * hiddenSize;
+    const size_t layerDim = m_numDirections * hiddenSize;
+
+    if (m_yDim != layerDim)
+        InvalidArgument("CPURNNExecutor ForwardCore: Output leading dimension must be twice hidden size for bidirectional networks");
+    if (GetNumParameters() != weightsW.GetNumElements())
+        InvalidArgument("RNN needs %ld parameters, but %ld were allocated", (long)GetNumParameters(), (long)weightsW.GetNumElements());
+
+    // column of the first sequence of each frame
+    const size_t numFrames = numSequencesForFrame.size();
+    std::vector<size_t> frameBegin(numFrames + 1, 0);
+    size_t maxNumSequences = 0;
+    for (size_t t = 0; t < numFrames; t++)
+    {
+        if (t > 0 && numSequencesForFrame[t] > numSequencesForFrame[t - 1])
+            InvalidArgument("CPURNNExecutor ForwardCore: The sequences must be sorted by decreasing length.");
+        frameBegin[t + 1] = frameBegin[t] + numSequencesForFrame[t];
+        maxNumSequences = std::max(maxNumSequences, numSequencesForFrame[t]);
+    }
+    const size_t numCols = frameBegin[numFrames];
+    if (inputX.GetNumRows() != m_xDim || inputX.GetNumCols() != numCols)
+        InvalidArgument("CPURNNExecutor ForwardCore: The input must be [%d x %d], but is [%d x %d].", (int)m_xDim, (int)numCols, (int)inputX.GetNumRows(), (int)inputX.GetNumCols());
+
+    outputY.RequireSize(m_yDim, numCols);
+    if (numCols == 0)
+        return;
+
+    // workspace: the outputs of two layers (the intermediate ones alternate), the gates of all frames, the recurrent
+    // product and the cell states of one step
+    const size_t numLayerBuffers = std::min<size_t>(2, m_numLayers - 1);
+    workspace.RequireSize(numLayerBuffers * layerDim * numCols + gateDim * (numCols + maxNumSequences) + hiddenSize * maxNumSequences, 1);
+    ElemType* layerBuffers[2] = { workspace.Data(), workspace.Data() + layerDim * numCols }; // (the second one only if numLayerBuffers == 2)
+    ElemType* gates = workspace.Data() + numLayerBuffers * layerDim * numCols;
+    ElemType* recurrent = gates + gateDim * numCols;
+    ElemType* cells = recurrent + gateDim * maxNumSequences;
+
+    const ElemType* weights = weightsW.Data();
+    size_t weightsSize = 0;
+    for (size_t layer = 0, inputDim = m_xDim; layer < m_numLayers; layer++, inputDim = layerDim)
+        weightsSize += m_numDirections * gateDim * (inputDim + hiddenSize);
+    const ElemType* biases = weights + weightsSize;
+
+    const ElemType* input = inputX.Data();
+    size_t inputDim = m_xDim;
+    for (size_t layer = 0; layer < m_numLayers; layer++)
+    {
+        ElemType* output = layer + 1 == m_numLayers ? outputY.Data() : layerBuffers[layer % 2];
+        for (size_t dir = 0; dir < m_numDirections; dir++)
+        {
+            const ElemType* wx = weights;
+            const ElemType* wh = wx + gateDim * inputDim;
+            weights = wh + gateDim * hiddenSize;
+            const ElemType* bx = biases;
+            const ElemType* bh = bx + gateDim;
+            biases = bh + gateDim;
+
+            // the directions write their halves of the output rows
+            ForwardDirection(input, inputDim, wx, wh, bx, bh, output + dir * hiddenSize, layerDim, /*backward=*/dir == 1,
+                             numSequencesForFrame, frameBegin, gates, recurrent, cells);
+        }
+        input = output;
+        inputDim = layerDim;
+    }
+}
+
+template <class ElemType>
+void CPURNNExecutor<ElemType>::ForwardDirection(const ElemType* input, size_t inputDim, const ElemType* wx, const ElemType* wh, const ElemType* bx, const ElemType* bh,
+                                                ElemType* output, size_t outputStride, bool backward,
+                                                const std::vector<size_t>& numSequencesForFrame, const std::vector<size_t>& frameBegin,
+                                                ElemType* gates, ElemType* recurrent, ElemType* cells)
+{
+    const size_t hiddenSize = m_hiddenSize;
+    const size_t gateDim = m_numGates * hiddenSize;
+    const size_t numFrames = numSequencesForFrame.size();
+    const size_t numCols = frameBegin[numFrames];
+    const Mode mode = m_mode;
+
+    // The input projections of all frames at once, plus the biases. For a GRU the recurrent bias of the candidate is
+    // added to the recurrent product instead, since the reset gate applies to both.
+    Gemm(/*transA=*/true, gateDim, numCols, inputDim, wx, inputDim, input, inputDim, 0, gates, gateDim);
+    const size_t numSummedBiases = mode == Mode::GRU ? 2 * hiddenSize : gateDim;
+#pragma omp parallel for if (numCols * gateDim > 65536)
+    for (long long j = 0; j < (long long)numCols; j++)
+    {
+        ElemType* g = gates + j * gateDim;
+        for (size_t i = 0; i < numSummedBiases; i++)
+            g[i] += bx[i] + bh[i];
+        for (size_t i = numSummedBiases; i < gateDim; i++)
+            g[i] += bx[i];
+    }
+
+    // (the first frame has the most sequences)
+    if (MayRunPersistent(numSequencesForFrame.front()))
+    {
+        ForwardStepsPersistent(wh, bh, output, outputStride, backward, numSequencesForFrame, frameBegin, gates, recurrent, cells);
+        return;
+    }
+
+    for (size_t step = 0; step < numFrames; step++)
+    {
+        const size_t t = backward ? numFrames - 1 - step : step;
+        const size_t numSequences = numSequencesForFrame[t];
+
+        // The sequences with a state from the previous step are the first ones, since they are sorted by length:
+        // going forward all of them, going backward the ones that continue after this frame. The others start at zero.
+        size_t numWithState = 0;
+        const ElemType* prevOutput = nullptr;
+        if (step > 0)
+        {
+            const size_t prevT = backward ? t + 1 : t - 1;
+            numWithState = std::min(numSequences, numSequencesForFrame[prevT]);
+            prevOutput = output + frameBegin[prevT] * outputStride;
+            Gemm(/*transA=*/true, gateDim, numWithState, hiddenSize, wh, hiddenSize, prevOutput, outputStride, 0, recurrent, gateDim);
+        }
+
+        ElemType* frameGates = gates + frameBegin[t] * gateDim;
+        ElemType* frameOutput = output + frameBegin[t] * outputStride;
+#pragma omp parallel for if (numSequences * gateDim > 16384)
+        for (long long j = 0; j < (long long)numSequences; j++)
+        {
+            const bool hasState = (size_t)j < numWithState;
+            const ElemType* g = frameGates + j * gateDim;
+            const ElemType* r = recurrent + j * gateDim;
+            const ElemType* hPrev = hasState ? prevOutput + j * outputStride : nullptr;
+            ElemType* c = cells + j * hiddenSize;
+            ElemType* h = frameOutput + j * outputStride;
+            for (size_t k = 0; k < hiddenSize; k++)
+                UpdateUnit(mode, k, hiddenSize, g, r, hasState, bh, hPrev, c, h);
+        }
+    }
+}
+
+template <class ElemType>
+void CPURNNExecutor<ElemType>::ForwardStepsPersistent(const ElemType* wh, const ElemType* bh, ElemType* output, size_t outputStride, bool backward,
+                                                      const std::vector<size_t>& numSequencesForFrame, const std::vector<size_t>& frameBegin,
+                                                      const ElemType* gates, ElemType* recurrent, ElemType* cells)
+{
+    const size_t hiddenSize = m_hiddenSize;
+    const size_t gateDim = m_numGates * hiddenSize;
+    const size_t numGates = m_numGates;
+    const size_t numFrames = numSequencesForFrame.size();
+    const Mode mode = m_mode;
+
+#pragma omp parallel
+    {
+        const size_t numThreads = omp_get_num_threads(), thread = omp_get_thread_num();
+        const size_t unitsBegin = hiddenSize * thread / numThreads, unitsEnd = hiddenSize * (thread + 1) / numThreads;
+        for (size_t step = 0; step < numFrames; step++)
+        {
+            // as in ForwardDirection()
+            const size_t t = backward ? numFrames - 1 - step : step;
+            const size_t numSequences = numSequencesForFrame[t];
+            size_t numWithState = 0;
+            const ElemType* prevOutput = nullptr;
+            if (step > 0)
+            {
+                const size_t prevT = backward ? t + 1 : t - 1;
+                numWithState = std::min(numSequences, numSequencesForFrame[prevT]);
+                prevOutput = output + frameBegin[prevT] * outputStride;
+            }
+
+            const ElemType* frameGates = gates + frameBegin[t] * gateDim;
+            ElemType* frameOutput = output + frameBegin[t] * outputStride;
+            for (size_t k = unitsBegin; k < unitsEnd; k++)
+            {
+                // the rows of the unit in all gates, each read once for all sequences
+                for (size_t gate = 0; gate < numGates; gate++)
+                {
+                    const size_t row = gate * hiddenSize + k;
+                    const ElemType* w = wh + row * hiddenSize;
+                    for (size_t j = 0; j < numWithState; j++)
+                    {
+                        const ElemType* hPrev = prevOutput + j * outputStride;
+                        ElemType sum = 0;
+                        for (size_t i = 0; i < hiddenSize; i++)
+                            sum += w[i] * hPrev[i];
+                        recurrent[j * gateDim + row] = sum;
+                    }
+                }
+                for (size_t j = 0; j < numSequences; j++)
+                {
+                    const bool hasState = j < numWithState;
+                    UpdateUnit(mode, k, hiddenSize, frameGates + j * gateDim, recurrent + j * gateDim, hasState, bh,
+                               hasState ? prevOutput + j * outputStride : nullptr, cells + j * hiddenSize, frameOutput + j * outputStride);
+                }
+            }
+            // the outputs of this step are the inputs of all units in the next one
+#pragma omp barrier
+        }
+    }
+}
+
+// no BLAS for half
+template <>
+void CPURNNExecutor<half>::ForwardCore(const CPUMatrix<half>&, const CPUMatrix<half>&, CPUMatrix<half>&, const std::vector<size_t>&, CPUMatrix<half>&)
+{
+    RuntimeError("OptimizedRNNStack: Evaluation on the CPU is not implemented for half precision.");
+}
+
+template <>
+void CPURNNExecutor<half>::ForwardDirection(const half*, size_t, const half*, const half*, const half*, const half*, half*, size_t, bool,
+                                            const std::vector<size_t>&, const std::vector<size_t>&, half*, half*, half*)
+{
+    LogicError("CPURNNExecutor<half>::ForwardDirection should not be called.");
+}
+
+template <>
+void CPURNNExecutor<half>::ForwardStepsPersistent(const half*, const half*, half*, size_t, bool, const std::vector<size_t>&, const std::vector<size_t>&,
+                                                  const half*, half*, half*)
+{
+    LogicError("CPURNNExecutor<half>::ForwardStepsPersistent should not be called.");
+}
+
+template <>
+void CPURNNExecutor<half>::UpdateUnit(Mode, size_t, size_t, const half*, const half*, bool, const half*, const half*, half*, half*)
+{
+    LogicError("CPURNNExecutor<half>::UpdateUnit should not be called.");
+}
+
+// no BLAS for bfloat16
+template <>
+void CPURNNExecutor<bfloat16>::ForwardCore(const CPUMatrix<bfloat16>&, const CPUMatrix<bfloat16>&, CPUMatrix<bfloat16>&, const std::vector<size_t>&, CPUMatrix<bfloat16>&)
+{
+    RuntimeError("OptimizedRNNStack: Evaluation on the CPU is not implemented for bfloat16 precision.");
+}
+
+template <>
+void CPURNNExecutor<bfloat16>::ForwardDirection(const bfloat16*, size_t, const bfloat16*, const bfloat16*, const bfloat16*, const bfloat16*, bfloat16*, size_t, bool,
+                                            const std::vector<size_t>&, const std::vector<size_t>&, bfloat16*, bfloat16*, bfloat16*)
+{
+    LogicError("CPURNNExecutor<bfloat16>::ForwardDirection should not be called.");
+}
+
+template <>
+void CPURNNExecutor<bfloat16>::ForwardStepsPersistent(const bfloat16*, const bfloat16*, bfloat16*, size_t, bool, const std::vector<size_t>&, const std::vector<size_t>&,
+                                                  const bfloat16*, bfloat16*, bfloat16*)
+{
+    LogicError("CPURNNExecutor<bfloat16>::ForwardStepsPersistent should not be called.");
+}
+
+template <>
+void CPURNNExecutor<bfloat16>::UpdateUnit(Mode, size_t, size_t, const bfloat16*, const bfloat16*, bool, const bfloat16*, const bfloat16*, bfloat16*, bfloat16*)
+{
+    LogicError("CPURNNExecutor<bfloat16>::UpdateUnit should not be called.");
+}
+
+template class CPURNNExecutor<float>;
+template class CPURNNExecutor<double>;
+template class CPURNNExecutor<half>;
+template class CPURNNExecutor<bfloat16>;
+
+}}}
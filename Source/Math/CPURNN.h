@@ -0,0 +1,80 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPURNN.h -- forward pass of OptimizedRNNStack on the CPU, with the packed weights of the cuDNN implementation
+//
+
+#pragma once
+
+#include "CPUMatrix.h"
+#include "RNNCommon.h"
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// CPURNNExecutor computes the same as CuDnnRNNExecutor::ForwardCore(), so that models trained on the GPU can be
+// evaluated on the CPU: the same weights, the same data layout (the frames in order of time, the sequences within a
+// frame sorted by decreasing length) and zero initial states. There is no backward pass.
+//
+// The weights are packed like cuDNN does: for each layer and direction (forward first) the input weights, then the
+// recurrent weights, each as one row-major [hiddenSize x inputs] matrix per gate, with the gates in the order of cuDNN
+// (LSTM: input, forget, cell, output; GRU: reset, update, candidate). After all weights follow the biases, for each
+// layer and direction the input bias, then the recurrent bias.
+//
+// The input projections of all frames are one GEMM per layer and direction, and the gates of a step are computed in
+// one pass (in parallel across sequences) from the input projection and the recurrent product.
+//
+// With RnnAttributes::m_persistent, a direction with a few sequences whose recurrent weights fit into the caches of the
+// threads runs all its steps in one parallel region instead, see ForwardStepsPersistent().
+template <class ElemType>
+class CPURNNExecutor
+{
+public:
+    CPURNNExecutor(size_t xDim, size_t yDim, const RnnAttributes& rnnAttributes);
+
+    void ForwardCore(const CPUMatrix<ElemType>& weightsW, const CPUMatrix<ElemType>& inputX, CPUMatrix<ElemType>& outputY,
+                     const std::vector<size_t>& numSequencesForFrame, CPUMatrix<ElemType>& workspace);
+
+    size_t GetNumParameters() const;
+
+private:
+    enum class Mode
+    {
+        LSTM,
+        GRU,
+        ReLU,
+        Tanh
+    };
+
+    void ForwardDirection(const ElemType* input, size_t inputDim, const ElemType* wx, const ElemType* wh, const ElemType* bx, const ElemType* bh,
+                          ElemType* output, size_t outputStride, bool backward,
+                          const std::vector<size_t>& numSequencesForFrame, const std::vector<size_t>& frameBegin,
+                          ElemType* gates, ElemType* recurrent, ElemType* cells);
+
+    // The recurrent steps of ForwardDirection() in one parallel region, in which every thread computes the same hidden units
+    // at every step: their rows of the recurrent product and their cells. Its rows of the recurrent weights thus stay in its
+    // cache from step to step, and the steps are separated by a barrier instead of a GEMM call and a parallel loop.
+    void ForwardStepsPersistent(const ElemType* wh, const ElemType* bh, ElemType* output, size_t outputStride, bool backward,
+                                const std::vector<size_t>& numSequencesForFrame, const std::vector<size_t>& frameBegin,
+                                const ElemType* gates, ElemType* recurrent, ElemType* cells);
+
+    // the cell and output of hidden unit k of one sequence, from its gate inputs g, its recurrent product r (if hasState)
+    // and its previous output hPrev (if hasState)
+    static void UpdateUnit(Mode mode, size_t k, size_t hiddenSize, const ElemType* g, const ElemType* r, bool hasState,
+                           const ElemType* bh, const ElemType* hPrev, ElemType* c, ElemType* h);
+
+    // whether ForwardStepsPersistent() applies to at most 'maxNumSequences' sequences
+    bool MayRunPersistent(size_t maxNumSequences) const;
+
+    // the largest number of sequences, and the recurrent weights per thread, for ForwardStepsPersistent()
+    static const size_t c_maxPersistentSequences = 4;
+    static const size_t c_maxPersistentWeightBytesPerThread = 512 * 1024;
+
+    size_t m_xDim, m_yDim;
+    size_t m_hiddenSize, m_numLayers, m_numDirections, m_numGates;
+    Mode m_mode;
+    bool m_persistent;
+};
+
+}}}
@@ -14,6 +14,7 @@
 #include <math.h>
 #include "CPUMatrix.h"
 #include "CPUSparseMatrix.h"
+#include "NumaPolicy.h"
 #include <random>
 #include <chrono>
 #include <iostream>
@@ -34,8 +35,11 @@
 #define HAVE_LAPACK_CONFIG_H
 #define LAPACK_COMPLEX_STRUCTURE
 #endif
+// OpenBLAS declares its own bfloat16, a typedef of uint16_t that would clash with the element type of the same name
+#define bfloat16 openblas_bfloat16
 #include <cblas.h>
 #include <lapacke.h>
+#undef bfloat16
 #endif
 
 // This is an example of an exported variable
@@ -773,6 +777,19 @@ void CPUSparseMatrix<ElemType>::SetMatrixFromSBCFormat(const size_t* blockIds, c
     memcpy(Data(), val, sizeof(ElemType)*numBlocks*numRows);
 }
 
+template <class ElemType>
+void CPUSparseMatrix<ElemType>::GetMatrixFromSBCFormat(vector<size_t>& blockIds, vector<ElemType>& values) const
+{
+    if (GetFormat() != matrixFormatSparseBlockCol)
+        LogicError("GetMatrixFromSBCFormat: The matrix must be a sparse block column matrix.");
+
+    size_t numBlocks = GetBlockSize();
+    blockIds.resize(numBlocks);
+    for (size_t j = 0; j < numBlocks; j++)
+        blockIds[j] = GetBlockIds()[j] - GetBlockIdShift(); // a column slice shares the block ids of its matrix
+    values.assign(Data(), Data() + numBlocks * GetNumRows());
+}
+
 template <class ElemType>
 ElemType* CPUSparseMatrix<ElemType>::Data()  const
 {
@@ -801,12 +818,13 @@ void CPUSparseMatrix<ElemType>::Allocate(const size_t numRows, const size_t numC
 
     if (reallocate)
     {
+        CountMatrixStorageAllocation();
         if (GetFormat() == MatrixFormat::matrixFormatSparseCSC || GetFormat() == MatrixFormat::matrixFormatSparseCSR)
         {
-            // The initialization of the following buffer is done by new []().
-            auto* pArray      = new ElemType[numNZElemToReserve]();
-            auto* unCompIndex = new CPUSPARSE_INDEX_TYPE[numNZElemToReserve]();
-            auto* compIndex   = new CPUSPARSE_INDEX_TYPE[newCompIndexSize]();
+            // The initialization of the following buffer is done by new []() or its NUMA placed or huge page equivalent.
+            auto* pArray      = NewLargeArray<ElemType>(numNZElemToReserve);
+            auto* unCompIndex = NewLargeArray<CPUSPARSE_INDEX_TYPE>(numNZElemToReserve);
+            auto* compIndex   = NewLargeArray<CPUSPARSE_INDEX_TYPE>(newCompIndexSize);
 
             if (keepExistingValues && (NzCount() > numNZElemToReserve || GetCompIndexSize() > newCompIndexSize))
                 LogicError("Allocate: To keep values m_nz should <= numNZElemToReserve and m_compIndexSize <= newCompIndexSize");
@@ -820,9 +838,9 @@ void CPUSparseMatrix<ElemType>::Allocate(const size_t numRows, const size_t numC
             }
 
             // TODO: This is super ugly. The internals of the storage object should be a shared_ptr.
-            delete[] Buffer();
-            delete[] GetUnCompIndex();
-            delete[] GetCompIndex();
+            DeleteLargeArray(Buffer());
+            DeleteLargeArray(GetUnCompIndex());
+            DeleteLargeArray(GetCompIndex());
 
             SetBuffer(pArray, numNZElemToReserve, false);
             SetUnCompIndex(unCompIndex);
@@ -832,6 +850,7 @@ void CPUSparseMatrix<ElemType>::Allocate(const size_t numRows, const size_t numC
         {
             ElemType* blockVal = new ElemType[numNZElemToReserve];
             size_t* blockIds = new size_t[newCompIndexSize];
+            NumaPolicy::Place(blockVal, numNZElemToReserve * sizeof(ElemType), /*zero=*/false);
 
             if (keepExistingValues && (NzCount() > numNZElemToReserve || GetCompIndexSize() > newCompIndexSize))
                 LogicError("Resize: To keep values m_nz should <= numNZElemToReserve and m_compIndexSize <= newCompIndexSize");
@@ -843,8 +862,8 @@ void CPUSparseMatrix<ElemType>::Allocate(const size_t numRows, const size_t numC
                 memcpy(blockIds, GetBlockIds(), sizeof(size_t) * GetCompIndexSize());
             }
 
-            delete[] Buffer();
-            delete[] GetBlockIds();
+            DeleteLargeArray(Buffer());
+            DeleteLargeArray(GetBlockIds());
 
             SetBuffer(blockVal, numNZElemToReserve, false);
             SetBlockIds(blockIds);
@@ -926,6 +945,70 @@ void CPUSparseMatrix<ElemType>::Reset()
     SetBlockIdShift(0);
 }
 
+// Index structure of a CSC matrix in row-major (CSR) order, i.e. the CSC index of its transpose.
+// Instead of a copy of the values it holds their positions in the CSC matrix, so that it stays valid as long as the
+// sparsity pattern does, e.g. for the products of the forward and backward pass of a minibatch.
+struct CPUSparseIndexTranspose
+{
+    // the CSC index this was built from
+    size_t m_numRows;
+    vector<CPUSPARSE_INDEX_TYPE> m_cscColStart;
+    vector<CPUSPARSE_INDEX_TYPE> m_cscRowIndex;
+
+    vector<CPUSPARSE_INDEX_TYPE> m_rowStart; // m_numRows + 1 entries, starting at 0
+    vector<CPUSPARSE_INDEX_TYPE> m_colIndex; // column of each nonzero element, in ascending order within each row
+    vector<CPUSPARSE_INDEX_TYPE> m_position; // index of each nonzero element into the values of the CSC matrix (view)
+};
+
+template <class ElemType>
+const CPUSparseIndexTranspose& CPUSparseMatrix<ElemType>::GetIndexTranspose() const
+{
+    if (GetFormat() != matrixFormatSparseCSC)
+        NOT_IMPLEMENTED;
+
+    const size_t numRows = GetNumRows();
+    const size_t numCols = GetNumCols();
+    const CPUSPARSE_INDEX_TYPE* colStart = SecondaryIndexLocation();
+    const CPUSPARSE_INDEX_TYPE* rowIndex = MajorIndexLocation();
+    const size_t nz = colStart[numCols] - colStart[0]; // unlike NzCount() this accounts for column slice views
+
+    // Reuse the previous result if the index is unchanged. Comparing it is much cheaper than the scattered writes of the transposition.
+    auto& transpose = m_indexTranspose;
+    if (transpose && transpose->m_numRows == numRows && transpose->m_cscColStart.size() == numCols + 1 && transpose->m_cscRowIndex.size() == nz &&
+        equal(colStart, colStart + numCols + 1, transpose->m_cscColStart.begin()) &&
+        equal(rowIndex, rowIndex + nz, transpose->m_cscRowIndex.begin()))
+        return *transpose;
+
+    if (!transpose)
+        transpose = make_shared<CPUSparseIndexTranspose>();
+
+    transpose->m_numRows = numRows;
+    transpose->m_cscColStart.assign(colStart, colStart + numCols + 1);
+    transpose->m_cscRowIndex.assign(rowIndex, rowIndex + nz);
+
+    // counting sort of the nonzero elements by row
+    auto& rowStart = transpose->m_rowStart;
+    rowStart.assign(numRows + 1, 0);
+    for (size_t p = 0; p < nz; p++)
+        rowStart[rowIndex[p] + 1]++;
+    for (size_t row = 0; row < numRows; row++)
+        rowStart[row + 1] += rowStart[row];
+
+    transpose->m_colIndex.resize(nz);
+    transpose->m_position.resize(nz);
+    vector<CPUSPARSE_INDEX_TYPE> next(rowStart.begin(), rowStart.end() - 1);
+    for (size_t col = 0; col < numCols; col++)
+    {
+        for (CPUSPARSE_INDEX_TYPE p = colStart[col] - colStart[0]; p < colStart[col + 1] - colStart[0]; p++)
+        {
+            CPUSPARSE_INDEX_TYPE q = next[rowIndex[p]]++;
+            transpose->m_colIndex[q] = (CPUSPARSE_INDEX_TYPE)col;
+            transpose->m_position[q] = p;
+        }
+    }
+    return *transpose;
+}
+
 // Implements product of one sparse and one dense matrix updating a third dense matrix. Input matrices are optionally transposed.
 // NOTE: The only for using a class template instead of a function template was that I couldn't make the function template compile.
 template <class ElemType, bool denseTimesSparse /* false means SparseTimesDense */, bool transposeA, bool transposeB>
@@ -985,29 +1068,28 @@ public:
         // * Initialized the output matrix c
 
         // Now do the actual multiplication.
-        ElemType* valueBuffer = sparse.Buffer() + *sparse.SecondaryIndexLocation(); // Points to the value buffer of the current view (i.e. buffer containing values of non-zero elements).
-        int* rowIndexBuffer = sparse.MajorIndexLocation();                          // Points to the index buffer of the current view (i.e. buffer containing indices of non-zero elements).
-        size_t iNonzero = 0;                                                           // Number of nonzero elements handled so far for current slice view.
-        int numPreviosNonzero = sparse.SecondaryIndexLocation()[0];                 // Total number of nonzero values handled in previous slices.
-
-        // Loop over columns of the sparse matrix
-        for (size_t colSparse = 0; colSparse < sparse.GetNumCols(); colSparse++)
+        // Each column of c (for dense * sparse) or row of c (for sparse * dense) only depends on one 'outer' line of the sparse matrix,
+        // so these are computed in parallel. If the outer lines are the rows of the CSC matrix, they are accessed through its transposed index.
+        const bool outerIsSparseCol = (denseTimesSparse && !transposeB) || (!denseTimesSparse && transposeA); // evaluated at compile time
+        const CPUSparseIndexTranspose* indexTranspose = outerIsSparseCol ? nullptr : &sparse.GetIndexTranspose();
+
+        const ElemType* valueBuffer = sparse.Data();                                                                                 // values of the current view
+        const CPUSPARSE_INDEX_TYPE* outerStart = outerIsSparseCol ? sparse.SecondaryIndexLocation() : indexTranspose->m_rowStart.data(); // start of each outer line
+        const CPUSPARSE_INDEX_TYPE* innerIndexBuffer = outerIsSparseCol ? sparse.MajorIndexLocation() : indexTranspose->m_colIndex.data();
+        const CPUSPARSE_INDEX_TYPE* valuePosition = outerIsSparseCol ? nullptr : indexTranspose->m_position.data();                   // position in valueBuffer, or identity
+        const CPUSPARSE_INDEX_TYPE firstNonzero = outerStart[0];                                                                     // nonzero values of previous slices
+        const int numOuterSparse = (int)(outerIsSparseCol ? sparse.GetNumCols() : sparse.GetNumRows());
+        const size_t numNonzero = outerStart[numOuterSparse] - firstNonzero;
+
+#pragma omp parallel for schedule(dynamic, 16) if (numOuterSparse > 1 && numNonzero * outerDimensionDense >= 16384)
+        for (int outer = 0; outer < numOuterSparse; outer++)
         {
-            size_t numNonzeroInSparseCol = sparse.SecondaryIndexLocation()[colSparse + 1] - numPreviosNonzero;
-            // Loop over the nonzero rows of the current column of the sparse matrix
-            for (; iNonzero < numNonzeroInSparseCol; iNonzero++)
+            const size_t outerIndexSparse = outer;
+            // Loop over the nonzero elements of the current outer line of the sparse matrix
+            for (size_t iNonzero = outerStart[outer] - firstNonzero; iNonzero < (size_t)(outerStart[outer + 1] - firstNonzero); iNonzero++)
             {
-                size_t rowSparse = rowIndexBuffer[iNonzero]; // RowLocation
-                ElemType sparseVal = valueBuffer[iNonzero];
-
-                // Determine the index of the 'outer' dimension of the sparse matrix and the common inner index.
-                size_t outerIndexSparse;
-                size_t innerIndex;
-                // Below if-statements are evaluated at compile time.
-                if      ( denseTimesSparse && !transposeB) { outerIndexSparse = colSparse; innerIndex = rowSparse; }
-                else if ( denseTimesSparse &&  transposeB) { outerIndexSparse = rowSparse; innerIndex = colSparse; }
-                else if (!denseTimesSparse && !transposeA) { outerIndexSparse = rowSparse; innerIndex = colSparse; }
-                else if (!denseTimesSparse &&  transposeA) { outerIndexSparse = colSparse; innerIndex = rowSparse; }
+                const size_t innerIndex = innerIndexBuffer[iNonzero];
+                ElemType sparseVal = valueBuffer[valuePosition ? valuePosition[iNonzero] : iNonzero];
 
                 // Loop over the outer index of the dense matrix
                 for (size_t outerIndexDense = 0; outerIndexDense < outerDimensionDense; outerIndexDense++)
@@ -1116,8 +1198,11 @@ void CPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const CPUMatrix<E
             col2BlockId[c.GetBlockIds()[blockId]] = blockId;
         }
 
+        // NzCount() does not account for column slice views
+        const size_t rhsNzCount = rhs.SecondaryIndexLocation()[rhs.GetNumCols()] - rhs.SecondaryIndexLocation()[0];
+
         size_t blockSizeCurr = blockSizePrev;
-        for (size_t rhsNz = 0; rhsNz < rhs.NzCount(); rhsNz++)
+        for (size_t rhsNz = 0; rhsNz < rhsNzCount; rhsNz++)
         {
             size_t resultCol = rhs.MajorIndexLocation()[rhsNz];
             if (col2BlockId.find(resultCol) == col2BlockId.end())
@@ -1135,21 +1220,28 @@ void CPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const CPUMatrix<E
             memset(c.Data() + m * blockSizePrev, 0, sizeof(ElemType) * m * (blockSizeCurr - blockSizePrev));
         }
 
-        for (size_t rhsCol = 0; rhsCol < rhs.GetNumCols(); rhsCol++)
+        // Each row of rhs updates one block of c, so the rows are processed in parallel, using the transposed index of rhs.
+        const CPUSparseIndexTranspose& indexTranspose = rhs.GetIndexTranspose();
+        const ElemType* rhsValues = rhs.Data();
+        const int numRhsRows = (int)rhs.GetNumRows();
+
+#pragma omp parallel for schedule(dynamic, 16) if (rhsNzCount * m >= 16384)
+        for (int rhsRow = 0; rhsRow < numRhsRows; rhsRow++)
         {
-            size_t start = rhs.SecondaryIndexLocation()[rhsCol];
-            size_t end = rhs.SecondaryIndexLocation()[rhsCol + 1];
+            size_t start = indexTranspose.m_rowStart[rhsRow];
+            size_t end = indexTranspose.m_rowStart[rhsRow + 1];
+            if (start == end)
+                continue;
 
+            ElemType* results = c.Buffer() + col2BlockId.find(rhsRow)->second * m;
             for (size_t p = start; p < end; p++)
             {
-                size_t rhsRow = rhs.MajorIndexLocation()[p];
-                ElemType val = rhs.Buffer()[p];
+                size_t rhsCol = indexTranspose.m_colIndex[p];
+                ElemType val = rhsValues[indexTranspose.m_position[p]];
 
-                ElemType* results = c.Buffer() + col2BlockId[rhsRow] * m;
-                #pragma omp parallel for
-                for (int lhsRow = 0; lhsRow < (int)m; lhsRow++)
+                for (size_t lhsRow = 0; lhsRow < m; lhsRow++)
                 {
-                    results[lhsRow] += alpha * lhs((size_t)lhsRow, rhsCol) * val;
+                    results[lhsRow] += alpha * lhs(lhsRow, rhsCol) * val;
                 }
             }
         }
@@ -1164,6 +1256,90 @@ void CPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const CPUMatrix<E
     }
 }
 
+// Adds the columns of 'values' into the columns of this SparseBlockCol matrix given by 'indices', e.g. for the
+// gradient of an embedding that was gathered by word ids. The indices are sorted by column, so that all updates
+// of a block are added up by one thread.
+template <class ElemType>
+CPUSparseMatrix<ElemType>& CPUSparseMatrix<ElemType>::ScatterToIndices(const CPUMatrix<ElemType>& values, const CPUMatrix<ElemType>& indices, size_t row_elements, const CPUMatrix<char>* mask /*= nullptr*/)
+{
+    if (indices.IsEmpty() || values.IsEmpty() || (mask && mask->IsEmpty()))
+        LogicError("ScatterToIndices: input matrix is empty.");
+    if (GetFormat() != matrixFormatSparseBlockCol || row_elements != GetNumRows())
+        NOT_IMPLEMENTED;
+
+    const size_t m = GetNumRows(), n = GetNumCols();
+    const size_t numIndices = indices.GetNumElements();
+    const size_t numIndicesPerMaskEntry = mask ? numIndices / mask->GetNumCols() : 0;
+    const ElemType* indexData = indices.Data();
+    const char* maskData = mask ? mask->Data() : nullptr;
+
+    // (column, position in 'values') of the indices that are not masked, grouped by column
+    vector<pair<size_t, size_t>> columnsAndPositions;
+    columnsAndPositions.reserve(numIndices);
+    for (size_t j = 0; j < numIndices; j++)
+    {
+        if (maskData && maskData[j / numIndicesPerMaskEntry] == 0)
+            continue;
+        size_t col = (size_t)indexData[j];
+        if (col >= n)
+            InvalidArgument("ScatterToIndices: Index %d is out of range for a matrix of %d columns.", (int)col, (int)n);
+        columnsAndPositions.push_back(make_pair(col, j));
+    }
+    sort(columnsAndPositions.begin(), columnsAndPositions.end());
+
+    size_t blockSizePrev = GetBlockSize();
+    if (blockSizePrev == 0)
+        RequireSizeAndAllocate(m, n, 0, true); // allocate for blockIds
+
+    map<size_t, size_t> col2BlockId;
+    for (size_t blockId = 0; blockId < blockSizePrev; blockId++)
+        col2BlockId[GetBlockIds()[blockId]] = blockId;
+
+    // one run of equal columns per block, new blocks for the columns that do not have one yet
+    vector<size_t> runStarts, runBlockIds;
+    size_t blockSizeCurr = blockSizePrev;
+    for (size_t p = 0; p < columnsAndPositions.size(); p++)
+    {
+        size_t col = columnsAndPositions[p].first;
+        if (p > 0 && col == columnsAndPositions[p - 1].first)
+            continue;
+
+        runStarts.push_back(p);
+        auto blockId = col2BlockId.find(col);
+        if (blockId != col2BlockId.end())
+            runBlockIds.push_back(blockId->second);
+        else
+        {
+            GetBlockIds()[blockSizeCurr] = col;
+            runBlockIds.push_back(blockSizeCurr++);
+        }
+    }
+    runStarts.push_back(columnsAndPositions.size());
+
+    if (blockSizeCurr > blockSizePrev)
+    {
+        RequireSizeAndAllocate(m, n, m * blockSizeCurr, true, true);
+        SetBlockSize(blockSizeCurr);
+        memset(Data() + m * blockSizePrev, 0, sizeof(ElemType) * m * (blockSizeCurr - blockSizePrev));
+    }
+
+    const ElemType* valueData = values.Data();
+    const int numRuns = (int)runBlockIds.size();
+#pragma omp parallel for schedule(dynamic, 16) if (columnsAndPositions.size() * m >= 16384)
+    for (int run = 0; run < numRuns; run++)
+    {
+        ElemType* results = Buffer() + runBlockIds[run] * m;
+        for (size_t p = runStarts[run]; p < runStarts[run + 1]; p++)
+        {
+            const ElemType* column = valueData + columnsAndPositions[p].second * m;
+            for (size_t i = 0; i < m; i++)
+                results[i] += column[i];
+        }
+    }
+
+    return *this;
+}
+
 // c[:,j] = alpha * v[j] * a[:,j] + beta * c[:,j]
 template <class ElemType>
 void CPUSparseMatrix<ElemType>::ColumnwiseScaleAndWeightedAdd(ElemType alpha, const CPUSparseMatrix<ElemType>& a, const CPUMatrix<ElemType>& v, ElemType beta, CPUMatrix<ElemType>& c)
@@ -1373,9 +1549,11 @@ void CPUSparseMatrix<ElemType>::InnerProduct(const CPUSparseMatrix<ElemType>& a,
 // Unit-gain momentum (unitGainFactor == 1.0 - momentum):
 // 1) c = momentum * c + (1.0 - momentum) * this
 // 2) this = c
+// Only the columns (rows) present in the gradient are updated; given the 'timestamps' of the last updates of the columns of a block column matrix,
+// the smoothed gradients of a column are first decayed by momentum ** (currentTimestamp - 1 - timestamp), i.e. for the minibatches that missed the column.
 // TODO: NormalGrad is a misnomer here. Come up with a better name.
 template <class ElemType>
-void CPUSparseMatrix<ElemType>::NormalGrad(CPUMatrix<ElemType>& c, const ElemType momentum, const ElemType unitGainFactor)
+void CPUSparseMatrix<ElemType>::NormalGrad(CPUMatrix<ElemType>& c, const ElemType momentum, const ElemType unitGainFactor, int* timestamps, int currentTimestamp)
 {
     if (c.IsEmpty())
     {
@@ -1384,6 +1562,9 @@ void CPUSparseMatrix<ElemType>::NormalGrad(CPUMatrix<ElemType>& c, const ElemTyp
     }
     // BUGBUG: dimension/ownbuffer check?
 
+    if (timestamps != nullptr && GetFormat() != MatrixFormat::matrixFormatSparseBlockCol)
+        NOT_IMPLEMENTED;
+
     if (GetFormat() == MatrixFormat::matrixFormatSparseBlockCol || GetFormat() == MatrixFormat::matrixFormatSparseBlockRow)
     {
         const auto isSparseBlockCol = (GetFormat() == MatrixFormat::matrixFormatSparseBlockCol);
@@ -1392,12 +1573,18 @@ void CPUSparseMatrix<ElemType>::NormalGrad(CPUMatrix<ElemType>& c, const ElemTyp
             size_t i = GetBlockIds()[j] - GetBlockIdShift();
             size_t len = (isSparseBlockCol) ? GetNumRows() : GetNumCols();
             size_t start = j * len;
+            ElemType decayedMomentum = momentum;
+            if (timestamps != nullptr)
+            {
+                decayedMomentum = (ElemType)std::pow((double)momentum, (double)(currentTimestamp - timestamps[i]));
+                timestamps[i] = currentTimestamp;
+            }
             for (size_t p = start; p < start + len; p++)
             {
                 ElemType val = Buffer()[p];
                 size_t row = (isSparseBlockCol) ? (p - start) : i;
                 size_t col = (isSparseBlockCol) ? i : (p - start);
-                c(row, col) = unitGainFactor * val + momentum * c(row, col);
+                c(row, col) = unitGainFactor * val + decayedMomentum * c(row, col);
                 Buffer()[p] = c(row, col);
             }
         }
@@ -1477,6 +1664,71 @@ ElemType CPUSparseMatrix<ElemType>::Adagrad(CPUMatrix<ElemType>& c, const bool n
         return 1;
 }
 
+// Lazy Adam: only the columns present in the block column gradient (this) are updated, the other columns of the smoothed gradients 'c'
+// and of the function values are left as they are. Given 'timestamps', the moments of a column are first decayed for the minibatches
+// that missed the column, by momentum and adaWeight ** (currentTimestamp - 1 - timestamp) respectively.
+template <class ElemType>
+void CPUSparseMatrix<ElemType>::Adam(CPUMatrix<ElemType>& c, CPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample, ElemType momentum,
+                                     ElemType adaWeight, ElemType adaMul, ElemType epsilon, ElemType unitGainFactor, bool adamax, int* timestamps, int currentTimestamp)
+{
+    size_t numColsNeeded = 2 * GetNumCols();
+
+    if (c.IsEmpty() || (c.GetNumCols() < numColsNeeded))
+    {
+        c.RequireSize(GetNumRows(), numColsNeeded);
+        c.SetValue(0.0);
+    }
+
+    if (c.GetNumRows() != GetNumRows() || c.GetNumCols() != numColsNeeded)
+        LogicError("The matrix gradients does not have expected dimensions.");
+
+    if (GetFormat() != MatrixFormat::matrixFormatSparseBlockCol)
+        LogicError("Unsupported sparse format.");
+
+    size_t n = GetNumElements();
+    ElemType* grad = Data();
+    ElemType* smoothAda = c.Data();
+    ElemType* smoothMom = c.Data() + n;
+    ElemType* val = functionValues.Data();
+    auto rows = GetNumRows();
+
+#pragma omp parallel for
+    for (long blockid = 0; blockid < (long)GetBlockSize(); ++blockid)
+    {
+        auto col = GetBlockIds()[blockid] - GetBlockIdShift();
+        auto columnOffset = col * rows;
+        auto blockOffset = blockid * rows;
+        ElemType momDecay = 1;
+        ElemType adaDecay = 1;
+        if (timestamps != nullptr)
+        {
+            double missed = currentTimestamp - 1 - timestamps[col];
+            momDecay = (ElemType)std::pow((double)momentum, missed);
+            adaDecay = (ElemType)std::pow((double)adaWeight, missed);
+            timestamps[col] = currentTimestamp;
+        }
+        for (size_t row = 0; row < rows; ++row)
+        {
+            size_t denseIndex = columnOffset + row;
+            ElemType g = grad[blockOffset + row];
+            ElemType ada;
+            if (!adamax)
+            {
+                ElemType adaSqr = adaWeight * adaDecay * smoothAda[denseIndex] + (1.0f - adaWeight) * g * g;
+                smoothAda[denseIndex] = adaSqr;
+                ada = sqrt(adaSqr);
+            }
+            else
+                ada = smoothAda[denseIndex] = std::max((ElemType)(adaWeight * adaDecay * smoothAda[denseIndex]), (ElemType)(g >= 0 ? g : -g));
+
+            ElemType w = adaMul * (ElemType)(1.0 / (ada + epsilon));
+            g = momentum * momDecay * smoothMom[denseIndex] + unitGainFactor * g;
+            smoothMom[denseIndex] = g;
+            val[denseIndex] -= g * w * learnRatePerSample;
+        }
+    }
+}
+
 template <class ElemType>
 template <class AccumType>
 void CPUSparseMatrix<ElemType>::AdaDelta(CPUMatrix<AccumType>& c, CPUMatrix<AccumType>& functionValues, AccumType learningRate, AccumType rho, AccumType epsilon, int* timestamps, int currentTimestamp)
@@ -1775,6 +2027,16 @@ half CPUSparseMatrix<half>::SumOfElements() const
 {
     RuntimeError("half SumOfElements not supported.");
 }
+template <>
+bfloat16 CPUSparseMatrix<bfloat16>::FrobeniusNorm() const
+{
+    RuntimeError("bfloat16 FrobeniusNorm not supported.");
+}
+template <>
+bfloat16 CPUSparseMatrix<bfloat16>::SumOfElements() const
+{
+    RuntimeError("bfloat16 SumOfElements not supported.");
+}
 
 template <typename ElemType>
 MATH_API File& operator>>(File& stream, CPUSparseMatrix<ElemType>& us)
@@ -1874,11 +2136,13 @@ MATH_API File& operator<<(File& stream, const CPUSparseMatrix<ElemType>& us)
 template class CPUSparseMatrix<float>;
 template class CPUSparseMatrix<double>;
 template class CPUSparseMatrix<half>;
+template class CPUSparseMatrix<bfloat16>;
 
 // instantiate learner methods
 template void CPUSparseMatrix<float>::AdaDelta(CPUMatrix<float>& c, CPUMatrix<float>& functionValues, float learningRate, float rho, float epsilon, int* timestamps, int currentTimestamp);
 template void CPUSparseMatrix<double>::AdaDelta(CPUMatrix<double>& c, CPUMatrix<double>& functionValues, double learningRate, double rho, double epsilon, int* timestamps, int currentTimestamp);
 template void CPUSparseMatrix<half>::AdaDelta(CPUMatrix<float>& c, CPUMatrix<float>& functionValues, float learningRate, float rho, float epsilon, int* timestamps, int currentTimestamp);
+template void CPUSparseMatrix<bfloat16>::AdaDelta(CPUMatrix<float>& c, CPUMatrix<float>& functionValues, float learningRate, float rho, float epsilon, int* timestamps, int currentTimestamp);
 
 // We use Matrix<char> as the backing store for QuantizedMatrix
 // Let's explciitly instantiate the methods we need for that purpose
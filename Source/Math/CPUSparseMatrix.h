@@ -10,6 +10,7 @@
 //#include "GPUSparseMatrix.h"
 #include <map>
 #include <unordered_map>
+#include <memory>
 
 #ifdef _WIN32
 #ifdef MATH_EXPORTS
@@ -21,6 +22,8 @@
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+struct CPUSparseIndexTranspose;
+
 template <class ElemType>
 class MATH_API CPUSparseMatrix : public BaseMatrix<ElemType>
 {
@@ -124,6 +127,8 @@ public:
                                 const size_t nz, const size_t numRows, const size_t numCols);
 
     void SetMatrixFromSBCFormat(const size_t* blockIds, const ElemType* val, const size_t numBlocks, const size_t numRows, const size_t numCols);
+    // the inverse of SetMatrixFromSBCFormat(): the columns of the blocks, and the values of the blocks [numRows x numBlocks]
+    void GetMatrixFromSBCFormat(std::vector<size_t>& blockIds, std::vector<ElemType>& values) const;
 
     // Dense * Sparse -> Dense
     static void MultiplyAndWeightedAdd(ElemType alpha, const CPUMatrix<ElemType>& lhs, const bool transposeA,
@@ -137,6 +142,14 @@ public:
     static void MultiplyAndAdd(ElemType alpha, const CPUMatrix<ElemType>& lhs, const bool transposeA,
                                const CPUSparseMatrix<ElemType>& rhs, const bool transposeB, CPUSparseMatrix<ElemType>& c);
 
+    // Adds the columns of 'values' into the columns of this SparseBlockCol matrix at 'indices', as CPUMatrix::ScatterToIndices
+    // does for a dense matrix. This is the row-sparse gradient of a gather, e.g. of an embedding by word ids.
+    CPUSparseMatrix<ElemType>& ScatterToIndices(const CPUMatrix<ElemType>& values, const CPUMatrix<ElemType>& indices, size_t row_elements, const CPUMatrix<char>* mask = nullptr);
+
+    // Returns the index structure of this CSC matrix in row-major order, for products that need to access the sparse matrix by rows.
+    // It is built on first use and kept until the sparsity pattern changes, see CPUSparseIndexTranspose.
+    const CPUSparseIndexTranspose& GetIndexTranspose() const;
+
     static void ColumnwiseScaleAndWeightedAdd(ElemType alpha, const CPUSparseMatrix<ElemType>& a, const CPUMatrix<ElemType>& v, ElemType beta, CPUMatrix<ElemType>& c);
 
     static void Scale(const ElemType alpha, CPUSparseMatrix<ElemType>& rhs);
@@ -233,8 +246,10 @@ public:
     }
 
 public:
-    void NormalGrad(CPUMatrix<ElemType>& c, const ElemType momentum, ElemType unitGainFactor);
+    void NormalGrad(CPUMatrix<ElemType>& c, const ElemType momentum, ElemType unitGainFactor, int* timestamps = nullptr, int currentTimestamp = 0);
     ElemType Adagrad(CPUMatrix<ElemType>& c, const bool needAveMultiplier);
+    void Adam(CPUMatrix<ElemType>& c, CPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample, ElemType momentum,
+              ElemType adaWeight, ElemType adaMul, ElemType epsilon, ElemType unitGainFactor, bool adamax, int* timestamps, int currentTimestamp);
 
     template<typename AccumType>
     void AdaDelta(CPUMatrix<AccumType>& c, CPUMatrix<AccumType>& functionValues, AccumType learningRate, AccumType rho, AccumType epsilon, int* timestamps, int currentTimestamp);
@@ -358,6 +373,9 @@ public:
     {
         return (GetFormat() & matrixFormatRowMajor) ? MajorIndexSize() : SecondaryIndexSize();
     } // actual number of bytes in use
+
+private:
+    mutable std::shared_ptr<CPUSparseIndexTranspose> m_indexTranspose;
 };
 
 typedef CPUSparseMatrix<float> CPUSingleSparseMatrix;
@@ -3,7 +3,14 @@
 #include "BestGpu.h" // for CPUONLY
 #ifndef CPUONLY
 #include <cuda_runtime_api.h>
+#include "GPUCachingAllocator.h"
 #endif
+#include <atomic>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -15,6 +22,28 @@ inline static void CheckCudaReturnCode(cudaError_t rc, const char* msg)
         RuntimeError("%s: %s (cuda error %d)", msg, cudaGetErrorString(rc), (int)rc);
 }
 
+// the process-wide pool of CUDAPageLockedMemAllocator, never destroyed since the CUDA runtime may be shut down before
+static std::mutex s_poolMutex;
+static std::unordered_map<void*, size_t> s_blocksInUse;         // block -> size class
+static std::map<size_t, std::vector<void*>> s_freeLists;        // size class -> idle blocks
+static PinnedMemoryCacheStats s_poolStats;
+static std::atomic<size_t> s_cacheLimitInMBs(1024);
+
+// call with s_poolMutex held
+static void ReleaseCachedBlocks()
+{
+    for (auto& freeList : s_freeLists)
+    {
+        for (void* p : freeList.second)
+        {
+            CheckCudaReturnCode(cudaFreeHost(p), "Free in CUDAPageLockedMemAllocator failed");
+            s_poolStats.bytesCached -= freeList.first;
+            s_poolStats.numHostFrees++;
+        }
+    }
+    s_freeLists.clear();
+}
+
 CUDAPageLockedMemAllocator::CUDAPageLockedMemAllocator(int deviceID)
     : m_deviceID(deviceID)
 {
@@ -22,18 +51,87 @@ CUDAPageLockedMemAllocator::CUDAPageLockedMemAllocator(int deviceID)
 
 void* CUDAPageLockedMemAllocator::Malloc(size_t size, int deviceId)
 {
-    void* p = nullptr;
-    CheckCudaReturnCode(cudaSetDevice(deviceId), "Cannot set cuda device");
+    const size_t sizeClass = GPUCachingAllocator::RoundUpToSizeClass(size);
 
-    // Note: I ask for cudaHostAllocDefault but cudaHostGetFlags() shows that it is allocated as 'cudaHostAllocMapped'
-    CheckCudaReturnCode(cudaHostAlloc(&p, size, cudaHostAllocDefault), "Malloc in CUDAPageLockedMemAllocator failed");
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    s_poolStats.numAllocations++;
+    void* p = nullptr;
+    auto freeList = s_freeLists.find(sizeClass);
+    if (freeList != s_freeLists.end() && !freeList->second.empty())
+    {
+        p = freeList->second.back();
+        freeList->second.pop_back();
+        s_poolStats.bytesCached -= sizeClass;
+        s_poolStats.numCacheHits++;
+    }
+    else
+    {
+        CheckCudaReturnCode(cudaSetDevice(deviceId), "Cannot set cuda device");
+        // portable, so that the block can be handed out again for any device
+        if (cudaHostAlloc(&p, sizeClass, cudaHostAllocPortable) != cudaSuccess)
+        {
+            cudaGetLastError();
+            ReleaseCachedBlocks(); // the idle blocks may be just what is missing
+            CheckCudaReturnCode(cudaHostAlloc(&p, sizeClass, cudaHostAllocPortable), "Malloc in CUDAPageLockedMemAllocator failed");
+        }
+        s_poolStats.numHostAllocations++;
+    }
+    s_blocksInUse[p] = sizeClass;
+    s_poolStats.bytesInUse += sizeClass;
+    s_poolStats.peakBytesReserved = std::max(s_poolStats.peakBytesReserved, s_poolStats.bytesInUse + s_poolStats.bytesCached);
     return p;
 }
 
 void CUDAPageLockedMemAllocator::Free(void* p, int deviceId)
 {
-    CheckCudaReturnCode(cudaSetDevice(deviceId), "Cannot set cuda device");
-    CheckCudaReturnCode(cudaFreeHost(p), "Free in CUDAPageLockedMemAllocator failed");
+    if (!p)
+        return;
+
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    auto block = s_blocksInUse.find(p);
+    if (block == s_blocksInUse.end())
+        LogicError("Free in CUDAPageLockedMemAllocator: %p was not allocated by it.", p);
+    const size_t sizeClass = block->second;
+    s_blocksInUse.erase(block);
+    s_poolStats.bytesInUse -= sizeClass;
+
+    // Above the limit the block is released right away. That is the case that cudaFreeHost was called for anyway.
+    if (s_poolStats.bytesCached + sizeClass <= s_cacheLimitInMBs * 1024 * 1024)
+    {
+        s_freeLists[sizeClass].push_back(p);
+        s_poolStats.bytesCached += sizeClass;
+    }
+    else
+    {
+        CheckCudaReturnCode(cudaSetDevice(deviceId), "Cannot set cuda device");
+        CheckCudaReturnCode(cudaFreeHost(p), "Free in CUDAPageLockedMemAllocator failed");
+        s_poolStats.numHostFrees++;
+    }
+}
+
+/*static*/ void CUDAPageLockedMemAllocator::SetCacheLimitInMBs(size_t limitInMBs)
+{
+    s_cacheLimitInMBs = limitInMBs;
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    if (s_poolStats.bytesCached > limitInMBs * 1024 * 1024)
+        ReleaseCachedBlocks();
+}
+
+/*static*/ size_t CUDAPageLockedMemAllocator::GetCacheLimitInMBs()
+{
+    return s_cacheLimitInMBs;
+}
+
+/*static*/ void CUDAPageLockedMemAllocator::EmptyCache()
+{
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    ReleaseCachedBlocks();
+}
+
+/*static*/ PinnedMemoryCacheStats CUDAPageLockedMemAllocator::GetCacheStats()
+{
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    return s_poolStats;
 }
 
 void* CUDAPageLockedMemAllocator::Malloc(size_t size)
@@ -78,5 +176,23 @@ void CUDAPageLockedMemAllocator::Free(void*)
 void CUDAPageLockedMemAllocator::Free(void*, int)
 {
 }
+
+void CUDAPageLockedMemAllocator::SetCacheLimitInMBs(size_t)
+{
+}
+
+size_t CUDAPageLockedMemAllocator::GetCacheLimitInMBs()
+{
+    return 0;
+}
+
+void CUDAPageLockedMemAllocator::EmptyCache()
+{
+}
+
+PinnedMemoryCacheStats CUDAPageLockedMemAllocator::GetCacheStats()
+{
+    return PinnedMemoryCacheStats();
+}
 #endif
 } } }
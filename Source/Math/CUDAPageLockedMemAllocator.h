@@ -1,6 +1,7 @@
 #pragma once
 
 #include "MemAllocator.h"
+#include <stddef.h>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -14,6 +15,23 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 #define MATH_API
 #endif
 
+struct PinnedMemoryCacheStats
+{
+    size_t numAllocations = 0;     // number of Malloc() calls served
+    size_t numCacheHits = 0;       // number of those served from a cached block, i.e. without cudaHostAlloc
+    size_t numHostAllocations = 0; // number of cudaHostAlloc calls
+    size_t numHostFrees = 0;       // number of cudaFreeHost calls
+    size_t bytesInUse = 0;         // bytes in blocks currently handed out
+    size_t bytesCached = 0;        // bytes in idle blocks kept for reuse
+    size_t peakBytesReserved = 0;  // high-water mark of bytesInUse + bytesCached
+};
+
+// Page-locked host memory, e.g. for the staging buffers of the reader, the gradient aggregation and ASGD.
+//
+// cudaHostAlloc and cudaFreeHost take milliseconds and synchronize the device, so freed blocks are kept in one
+// process-wide pool, in the size classes of the GPU caching allocator (see GPUCachingAllocator::RoundUpToSizeClass()),
+// and handed out again. The blocks are portable, i.e. may be used with any device, so the pool is shared by all of
+// them. The idle bytes are bounded by the cache limit; blocks above it are released.
 class MATH_API CUDAPageLockedMemAllocator : public MemAllocator
 {
 public:
@@ -25,6 +43,14 @@ public:
     static void* Malloc(size_t size, int deviceId);
     static void Free(void* p, int deviceId);
 
+    // upper bound on the idle (cached) bytes; 0 disables the caching
+    static void SetCacheLimitInMBs(size_t limitInMBs);
+    static size_t GetCacheLimitInMBs();
+
+    // releases all idle blocks
+    static void EmptyCache();
+    static PinnedMemoryCacheStats GetCacheStats();
+
 private:
     int m_deviceID;
 };
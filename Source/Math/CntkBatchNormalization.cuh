@@ -153,6 +153,11 @@ namespace Operations
         return __float2half(rsqrtf(__half2float(a)));
 #endif
     }
+
+    __device__ bfloat16 RSqrt(bfloat16 a)
+    {
+        return bfloat16(rsqrtf((float)a));
+    }
 }
 
 // This function is used to select correct unroll factor.
@@ -643,9 +648,10 @@ struct ComputeSpatialBatchMeanAndInvStdDev
 // or Cx1x1 in convolutional case.
 //--------------------------------------------------------------------
 
+// With reluOutput the output is max(0, BN(x)), a ReLU fused into the normalization.
 template <int BlockDimX, int BlockDimY, bool Spatial, bool NormalizeRunningStats, int U, typename ElemType, typename StatType>
 __global__ void kNormalizeBatchTraining(int vectorSize, int spatialSize, int batchSize,
-    double epsilon,
+    double epsilon, bool reluOutput,
     const ElemType* x, ElemType* y,
     const StatType* bnScale, const StatType* bnBias,
     const StatType* runningMean, const StatType* runningVariance,
@@ -728,6 +734,8 @@ __global__ void kNormalizeBatchTraining(int vectorSize, int spatialSize, int bat
         for (int k = 0; k < U; k++)
         {
             val[k] = scale[k] * (val[k] - mean[k]) * invStdDev[k] + bias[k];
+            if (reluOutput && val[k] < 0)
+                val[k] = 0;
         }
         StoreValues<U>(val, pdst);
     }
@@ -738,7 +746,7 @@ struct NormalizeBatchTraining
 {
     template <typename ElemType, typename StatType>
     static void Call(size_t vectorSize, size_t spatialSize, size_t batchSize, bool spatial,
-                     bool normalizeRunningStats, double epsilon,
+                     bool normalizeRunningStats, double epsilon, bool reluOutput,
                      const ElemType* x, ElemType* y,                               // (in, out) data to normalize -> normalized data
                      const StatType* bnScale, const StatType* bnBias,              // (in) scale/bias to denormalize with
                      const StatType* runningMean, const StatType* runningVariance, // (in) running mean/variance
@@ -758,14 +766,14 @@ struct NormalizeBatchTraining
             if (normalizeRunningStats)
                 kNormalizeBatchTraining<BlockDimX, BlockDimY, true, true, U, ElemType, StatType><<<gdim, bdim, 0, stream>>>(
                     (int)vectorSize, (int)spatialSize, (int)batchSize,
-                    epsilon,
+                    epsilon, reluOutput,
                     x, y, bnScale, bnBias,
                     runningMean, runningVariance,
                     batchMean, batchInvStdDev);
             else
                 kNormalizeBatchTraining<BlockDimX, BlockDimY, true, false, U, ElemType, StatType><<<gdim, bdim, 0, stream>>>(
                     (int)vectorSize, (int)spatialSize, (int)batchSize,
-                    epsilon,
+                    epsilon, reluOutput,
                     x, y, bnScale, bnBias,
                     runningMean, runningVariance,
                     batchMean, batchInvStdDev);
@@ -775,14 +783,14 @@ struct NormalizeBatchTraining
             if (normalizeRunningStats)
                 kNormalizeBatchTraining<BlockDimX, BlockDimY, false, true, U, ElemType, StatType><<<gdim, bdim, 0, stream>>>(
                     (int)vectorSize, (int)spatialSize, (int)batchSize,
-                    epsilon,
+                    epsilon, reluOutput,
                     x, y, bnScale, bnBias,
                     runningMean, runningVariance,
                     batchMean, batchInvStdDev);
             else
                 kNormalizeBatchTraining<BlockDimX, BlockDimY, false, false, U, ElemType, StatType><<<gdim, bdim, 0, stream>>>(
                     (int)vectorSize, (int)spatialSize, (int)batchSize,
-                    epsilon,
+                    epsilon, reluOutput,
                     x, y, bnScale, bnBias,
                     runningMean, runningVariance,
                     batchMean, batchInvStdDev);
@@ -796,10 +804,27 @@ struct NormalizeBatchTraining
 // BatchNormalizationBackward back-propagates derivatives of batch normalization function
 // with respect to the inputs and scale and bias parameters.
 // All tensor dimensions and assumptions are the same as in case of forward propagation.
+// If the forward pass fused a ReLU, y is its output, and the derivatives dy of the outputs it clipped to 0
+// are taken as 0; otherwise y is null.
 //--------------------------------------------------------------------
 
+template <int U, typename ElemType, typename T>
+__device__ __forceinline__ void MaskReluGradient(const ElemType* py, T dy[U])
+{
+    if (py == nullptr)
+        return;
+    T y[U];
+    LoadValues<U>(py, y);
+#pragma unroll
+    for (int k = 0; k < U; k++)
+    {
+        if (y[k] <= 0)
+            dy[k] = 0;
+    }
+}
+
 template <int BlockDimX, int BlockDimY, int U, typename ElemType, typename StatType>
-__global__ void kComputeScaleAndBiasGradients(int vectorSize, int batchSize, const ElemType* x, const ElemType* dy, StatType* dScale, StatType* dBias,
+__global__ void kComputeScaleAndBiasGradients(int vectorSize, int batchSize, const ElemType* x, const ElemType* y, const ElemType* dy, StatType* dScale, StatType* dBias,
                                               const StatType* savedMean, const StatType* savedInvStdDev)
 {
     typedef typename TypeSelector<ElemType>::comp_t comp_t;
@@ -859,11 +884,12 @@ __global__ void kComputeScaleAndBiasGradients(int vectorSize, int batchSize, con
         comp_t curdY[U];
         LoadValues<U>(px, curX);
         LoadValues<U>(pdy, curdY);
+        MaskReluGradient<U>(y ? y + (pdy - dy) : nullptr, curdY);
 #pragma unroll
         for (int k = 0; k < U; k++)
         {
-            ds[k] += (comp_t)pdy[k] * (curX[k] - mean[k]) * invStdDev[k];
-            db[k] += (comp_t)pdy[k];
+            ds[k] += curdY[k] * (curX[k] - mean[k]) * invStdDev[k];
+            db[k] += curdY[k];
         }
     }
 
@@ -904,7 +930,7 @@ __global__ void kComputeScaleAndBiasGradients(int vectorSize, int batchSize, con
 }
 
 template <int BlockDimX, int BlockDimY, int U, typename ElemType, typename StatType>
-__global__ void kComputeSpatialScaleAndBiasGradients(int vectorSize, int spatialSize, int batchSize, const ElemType* x, const ElemType* dy,
+__global__ void kComputeSpatialScaleAndBiasGradients(int vectorSize, int spatialSize, int batchSize, const ElemType* x, const ElemType* y, const ElemType* dy,
                                                         StatType* dScale, StatType* dBias, const StatType* savedMean, const StatType* savedInvStdDev)
 {
     typedef typename TypeSelector<ElemType>::comp_t comp_t;
@@ -968,11 +994,12 @@ __global__ void kComputeSpatialScaleAndBiasGradients(int vectorSize, int spatial
             comp_t curdY[U];
             LoadValues<U>(px, curX);
             LoadValues<U>(pdy, curdY);
+            MaskReluGradient<U>(y ? y + (pdy - dy) : nullptr, curdY);
 #pragma unroll
             for (int k = 0; k < U; k++)
             {
-                ds[k] += (comp_t)pdy[k] * (curX[k] - mean) * invStdDev;
-                db[k] += (comp_t)pdy[k];
+                ds[k] += curdY[k] * (curX[k] - mean) * invStdDev;
+                db[k] += curdY[k];
             }
         }
     }
@@ -994,7 +1021,7 @@ template <int U>
 struct ComputeScaleAndBiasGradients
 {
     template <typename ElemType, typename StatType>
-    static void Call(size_t vectorSize, size_t batchSize, const ElemType* x, const ElemType* dy,
+    static void Call(size_t vectorSize, size_t batchSize, const ElemType* x, const ElemType* y, const ElemType* dy,
         StatType* dScale, StatType* dBias, const StatType* savedMean, const StatType* savedInvStdDev, cudaStream_t stream)
     {
         assert((vectorSize % U) == 0);
@@ -1005,7 +1032,7 @@ struct ComputeScaleAndBiasGradients
         // Create a grid that has uses striding in y-dimension to cover whole minibatch.
         auto gdim = dim3(static_cast<unsigned int>(RoundUpToMultiple(vectorSize, BlockDimX * U)));
         kComputeScaleAndBiasGradients<BlockDimX, BlockDimY, U, ElemType, StatType><<<gdim, bdim, 0, stream>>>(
-            static_cast<int>(vectorSize), static_cast<int>(batchSize), x, dy, dScale, dBias, savedMean, savedInvStdDev);
+            static_cast<int>(vectorSize), static_cast<int>(batchSize), x, y, dy, dScale, dBias, savedMean, savedInvStdDev);
     }
 };
 
@@ -1013,7 +1040,7 @@ template <int U>
 struct ComputeSpatialScaleAndBiasGradients
 {
     template <typename ElemType, typename StatType>
-    static void Call(size_t vectorSize, size_t spatialSize, size_t batchSize, const ElemType* x, const ElemType* dy,
+    static void Call(size_t vectorSize, size_t spatialSize, size_t batchSize, const ElemType* x, const ElemType* y, const ElemType* dy,
                      StatType* dScale, StatType* dBias, const StatType* savedMean, const StatType* savedInvStdDev, cudaStream_t stream)
     {
         assert((spatialSize % U) == 0);
@@ -1026,13 +1053,13 @@ struct ComputeSpatialScaleAndBiasGradients
         // Create a grid that has uses striding in y-dimension to cover whole minibatch.
         auto gdim = dim3(static_cast<unsigned int>(vectorSize / spatialSize));
         kComputeSpatialScaleAndBiasGradients<BlockDimX, BlockDimY, U, ElemType, StatType><<<gdim, bdim, 0, stream>>>(
-            static_cast<int>(vectorSize), static_cast<int>(spatialSize), static_cast<int>(batchSize), x, dy, dScale, dBias, savedMean, savedInvStdDev);
+            static_cast<int>(vectorSize), static_cast<int>(spatialSize), static_cast<int>(batchSize), x, y, dy, dScale, dBias, savedMean, savedInvStdDev);
     }
 };
 
 // mbStatsWeight is the weight with which current MB's stats were used (0 means not at all, locked model).
 template <int BlockDimX, int BlockDimY, bool Spatial, int U, typename ElemType, typename StatType>
-__global__ void kBackpropagateBatchNormGradients(int vectorSize, int spatialSize, int batchSize, const ElemType* x, const ElemType* dy, ElemType* dx,
+__global__ void kBackpropagateBatchNormGradients(int vectorSize, int spatialSize, int batchSize, const ElemType* x, const ElemType* y, const ElemType* dy, ElemType* dx,
                                                     const StatType* bnScale, StatType mbStatsWeight, const StatType* dScale, const StatType* dBias,
                                                     const StatType* savedMean, const StatType* savedInvStdDev)
 {
@@ -1093,6 +1120,7 @@ __global__ void kBackpropagateBatchNormGradients(int vectorSize, int spatialSize
         comp_t dxCur[U];
         LoadValues<U>(px, xCur);
         LoadValues<U>(pdy, dyCur);
+        MaskReluGradient<U>(y ? y + (pdy - dy) : nullptr, dyCur);
         LoadValues<U>(pdx, dxCur);
         // From the BN paper, dL/dxi is a sum of three terms: dL/dxi = t1 + t2 + t3
         // The formulas for dBias and dScale happen to occur as subexpressions in this gradient as well.
@@ -1127,7 +1155,7 @@ template <int U>
 struct BackpropagateBatchNormGradients
 {
     template <typename ElemType, typename StatType>
-    static void Call(size_t vectorSize, size_t spatialSize, size_t batchSize, bool spatial, const ElemType* x, const ElemType* dy, ElemType* dx,
+    static void Call(size_t vectorSize, size_t spatialSize, size_t batchSize, bool spatial, const ElemType* x, const ElemType* y, const ElemType* dy, ElemType* dx,
                      const StatType* bnScale, StatType mbStatsWeight, const StatType* dScale,
                      const StatType* dBias, const StatType* savedMean, const StatType* savedInvStdDev, cudaStream_t stream)
     {
@@ -1141,12 +1169,12 @@ struct BackpropagateBatchNormGradients
         if (spatial)
         {
             kBackpropagateBatchNormGradients<BlockDimX, BlockDimY, true/*spatial*/, U, ElemType, StatType><<<gdim, bdim, 0, stream>>>(
-                static_cast<int>(vectorSize), static_cast<int>(spatialSize), static_cast<int>(batchSize), x, dy, dx, bnScale, mbStatsWeight, dScale, dBias, savedMean, savedInvStdDev);
+                static_cast<int>(vectorSize), static_cast<int>(spatialSize), static_cast<int>(batchSize), x, y, dy, dx, bnScale, mbStatsWeight, dScale, dBias, savedMean, savedInvStdDev);
         }
         else
         {
             kBackpropagateBatchNormGradients<BlockDimX, BlockDimY, false/*not spatial*/, U><<<gdim, bdim, 0, stream>>>(
-                static_cast<int>(vectorSize), static_cast<int>(spatialSize), static_cast<int>(batchSize), x, dy, dx, bnScale, mbStatsWeight, dScale, dBias, savedMean, savedInvStdDev);
+                static_cast<int>(vectorSize), static_cast<int>(spatialSize), static_cast<int>(batchSize), x, y, dy, dx, bnScale, mbStatsWeight, dScale, dBias, savedMean, savedInvStdDev);
         }
     }
 };
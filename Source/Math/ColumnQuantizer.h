@@ -27,7 +27,10 @@ class ColumnQuantizer
     static const size_t QWordNumBits = ValueQuantizer<ElemType>::QWordNumBits;
 
 public:
-    cudacode ColumnQuantizer(size_t logNbits, ElemType lower, ElemType upper)
+    // type in which the values are quantized and their range is computed, e.g. float for half
+    typedef typename ValueQuantizer<ElemType>::CompType CompType;
+
+    cudacode ColumnQuantizer(size_t logNbits, CompType lower, CompType upper)
         : valQ(logNbits, lower, upper)
     {
     }
@@ -81,7 +84,7 @@ public:
     static cudacode void ComputeRangeStatColj(const ElemType* inMat, const ElemType* inResidual, long M, size_t j, size_t bits, ElemType& lower, ElemType& upper)
     {
         /*dummy reducers do nothing in linear CPU version*/
-        ComputeRangeStatColjSubset<ZeroThresholdFor1Bit>(inMat, inResidual, M, j, bits, lower, upper, 0, 1, [](ElemType&){}, [](unsigned int&){});
+        ComputeRangeStatColjSubset<ZeroThresholdFor1Bit>(inMat, inResidual, M, j, bits, lower, upper, 0, 1, [](CompType&){}, [](unsigned int&){});
     }
 
 public:
@@ -99,8 +102,8 @@ public:
 
         if ((valQ.NBits() == 1) && (inResidual == outResidual) /*in-place*/)
         {
-            ElemType val0 = valQ.Unquantize(0);
-            ElemType val1 = valQ.Unquantize(1);
+            CompType val0 = valQ.Unquantize(0);
+            CompType val1 = valQ.Unquantize(1);
             size_t ij = ColMIDX(rowStart, colIdx, M);
             const ElemType* usibj = inMat + ij;
             const ElemType* usibjend = usibj + (rowEnd - rowStart);
@@ -109,7 +112,7 @@ public:
             for (QWord bitmask = 1; usibj < usibjend; bitmask <<= 1, usibj += rowStride, resibj += rowStride)
             {
                 // quantize   --we access element (i,j) through the three increasing pointers
-                ElemType val = *usibj + *resibj;
+                CompType val = (CompType) *usibj + (CompType) *resibj;
 
                 // Explicit use of 'template' keyword is needed to compile with GCC
                 bool qval = valQ.template Quantize1<ZeroThresholdFor1Bit>(val);
@@ -119,8 +122,8 @@ public:
                 }
 
                 // compute residual
-                ElemType uval = valQ.Unquantize1(qval, val0, val1);
-                *resibj = val - uval;
+                CompType uval = valQ.Unquantize1(qval, val0, val1);
+                *resibj = (ElemType) (val - uval);
             }
         }
         else
@@ -131,21 +134,38 @@ public:
             {
                 // quantize
                 size_t ij = ColMIDX(i, colIdx, M);
-                ElemType val = inMat[ij] + inResidual[ij];
+                CompType val = (CompType) inMat[ij] + (CompType) inResidual[ij];
 
                 // 'template' keyword to compile with GCC
                 QWordVal qval = valQ.template Quantize<ZeroThresholdFor1Bit>(val);
 
                 // compute residual
-                ElemType uval = valQ.Unquantize(qval);
-                ElemType r = val - uval;
-                outResidual[ij] = r;
-                bitBuf = bitBuf | (qval << k);
+                CompType uval = valQ.Unquantize(qval);
+                CompType r = val - uval;
+                outResidual[ij] = (ElemType) r;
+                bitBuf = (QWord) (bitBuf | (qval << k));
             }
         }
         return bitBuf;
     }
 
+    // same as QuantizeOneQWord(), for a column whose sums of input and residual are already in 'vals',
+    // e.g. cached by the fused GPU kernel; 'outResidual' points to the residual of that column
+    template <bool ZeroThresholdFor1Bit>
+    cudacode QWord QuantizeOneQWordOfSums(const CompType* vals, size_t rowStart, size_t rowEnd, size_t rowStride, ElemType* outResidual) const
+    {
+        QWord bitBuf = 0;
+        size_t i = rowStart;
+        for (size_t k = 0; (k < QWordNumBits) && (i < rowEnd); k += valQ.NBits(), i += rowStride)
+        {
+            CompType val = vals[i];
+            QWordVal qval = valQ.template Quantize<ZeroThresholdFor1Bit>(val);
+            outResidual[i] = (ElemType) (val - valQ.Unquantize(qval));
+            bitBuf = (QWord) (bitBuf | (qval << k));
+        }
+        return bitBuf;
+    }
+
     // unquantize one QWord of a quantized matrix column
     cudacode void UnquantizeOneQWord(
         ElemType* us, long M,
@@ -155,8 +175,8 @@ public:
         // special case for 1 bit
         if (valQ.NBits() == 1)
         {
-            ElemType val0 = valQ.Unquantize(0);
-            ElemType val1 = valQ.Unquantize(1);
+            CompType val0 = valQ.Unquantize(0);
+            CompType val1 = valQ.Unquantize(1);
             size_t ij = ColMIDX(rowStart, colIdx, M);
             ElemType* usibj = us + ij;
             const ElemType* usibjend = usibj + (rowEnd - rowStart);
@@ -170,13 +190,13 @@ public:
                 bitBuf >>= 1;
 
                 // unquantize
-                ElemType val = ValueQuantizer<ElemType>::Unquantize1(qval, val0, val1);
+                CompType val = ValueQuantizer<ElemType>::Unquantize1(qval, val0, val1);
                 if (add)
                 {
-                    val += *usibj;
+                    val += (CompType) *usibj;
                 }
 
-                *usibj = val;
+                *usibj = (ElemType) val;
             }
         }
         else
@@ -190,26 +210,27 @@ public:
                 const QWordVal qval = (bitBuf >> k) & bitmask; // % 2^Nbits
 
                 // unquantize
-                ElemType val = valQ.Unquantize(qval);
+                CompType val = valQ.Unquantize(qval);
                 size_t ij = ColMIDX(i, colIdx, M);
                 if (add)
                 {
-                    val += us[ij];
+                    val += (CompType) us[ij];
                 }
 
-                us[ij] = val;
+                us[ij] = (ElemType) val;
             }
         }
     }
 
     // determine quantization range of one column
     // This code is written so that it can run in parallel threads on CUDA for collated memory access;
-    // set 'subsets' to >1 and pass cross-thread reducer functions for 'float' and 'size_t' (which would reduce through using CUDA __shared__ memory).
+    // set 'subsets' to >1 and pass cross-thread reducer functions for 'CompType' and 'size_t' (which would reduce through using CUDA __shared__ memory).
+    // 'inResidual' may be null when 'inMat' already holds the sums of input and residual, e.g. in CompType.
     // TODO: further opportunity for speed-up: use 'mean' from last round for 1-bit and stddev calc
-    template <bool ZeroThresholdFor1Bit, class F1, class F2>
+    template <bool ZeroThresholdFor1Bit, class DataType, class F1, class F2>
     static cudacode void ComputeRangeStatColjSubset(
-        const ElemType* inMat,
-        const ElemType* inResidual, long M,
+        const DataType* inMat,
+        const DataType* inResidual, long M,
         size_t j,
         size_t bits,
         ElemType& lower, ElemType& upper,
@@ -229,15 +250,15 @@ public:
         //  - do not symmetrize/pool the quantization values for 0 and 1
         //  - but hard-code the quantization threshold to be 0 instead of the mean of the two bounds
         // This should give us the best of all--fast operation yet ability to be asymmetric within a column.
-        ElemType mean = 0.0f;
+        CompType mean = 0.0f;
         if (!ZeroThresholdFor1Bit && (bits == 1))
         {
-            ElemType meanacc = 0.0f;
+            CompType meanacc = 0.0f;
             // (subset: compute subset sum)
             for (size_t i = subset; i < rows; i += subsets)
             {
                 size_t ij = ColMIDX(i, j, M);
-                meanacc += inMat[ij] + inResidual[ij];
+                meanacc += SumAt(inMat, inResidual, ij);
             }
             // multi-subset (CUDA): reduce to one thread
             allReduceElem(meanacc);
@@ -251,13 +272,13 @@ public:
             // I.e. we should reconstruct to the respective means of each level.
             // To be able to express the range by two floats, we approximate the level threshold as the av. of the two level means.
             // compute the two level means
-            ElemType meanacc0 = 0.0f, meanacc1 = 0.0f;
+            CompType meanacc0 = 0.0f, meanacc1 = 0.0f;
             unsigned int num0 = 0, num1 = 0;
             // (subset: compute subset sum)
             for (size_t i = subset; i < rows; i += subsets)
             {
                 size_t ij = ColMIDX(i, j, M);
-                ElemType val = inMat[ij] + inResidual[ij];
+                CompType val = SumAt(inMat, inResidual, ij);
                 if (val < mean)
                 {
                     meanacc0 += val;
@@ -276,17 +297,17 @@ public:
             allReduceUint(num0);
             allReduceUint(num1);
 
-            ElemType radius;
-            ElemType newmean;
+            CompType radius;
+            CompType newmean;
             if (!ZeroThresholdFor1Bit)
             {
                 // we minimize the error jointly across positive and negative numbers to make things
                 // symmetrical around the mean (which may be non-zero) tying the two sides
-                ElemType devacc0 = (num0 * mean) - meanacc0;
-                ElemType devacc1 = meanacc1 - (num1 * mean);
+                CompType devacc0 = (num0 * mean) - meanacc0;
+                CompType devacc1 = meanacc1 - (num1 * mean);
 
                 // both deviations tied, to ensure consistent mean
-                ElemType dev = (devacc0 + devacc1) / rows;
+                CompType dev = (devacc0 + devacc1) / rows;
                 radius = 2.0f * dev;
                 newmean = mean;
             }
@@ -300,8 +321,8 @@ public:
                     num0 = 1;
                 if (num1 == 0)
                     num1 = 1;
-                ElemType mean0 = meanacc0 / num0;
-                ElemType mean1 = meanacc1 / num1;
+                CompType mean0 = meanacc0 / num0;
+                CompType mean1 = meanacc1 / num1;
 
                 // approximate by using their average as the threshold between 0 and 1
                 // with these values, bits (0,1) which mean values (0.5,1.5) will reconstruct to mean0/1
@@ -311,35 +332,44 @@ public:
 
             if (subset == 0)
             {
-                lower = newmean - radius;
-                upper = newmean + radius;
+                lower = (ElemType) (newmean - radius);
+                upper = (ElemType) (newmean + radius);
             }
         }
         else
         {
-            ElemType stddevs = 4.0f; // TODO: make this a parameter
+            CompType stddevs = 4.0f; // TODO: make this a parameter
             // >1 bit:
             // We linearly quantize between 'stddevs' standard deviations.
-            ElemType varacc = 0.0f;
+            CompType varacc = 0.0f;
             // (subset: compute subset sum)
             for (size_t i = subset; i < rows; i += subsets)
             {
                 size_t ij = ColMIDX(i, j, M);
-                ElemType val = inMat[ij] + inResidual[ij];
+                CompType val = SumAt(inMat, inResidual, ij);
                 varacc += (val - mean) * (val - mean);
             }
             // multi-subset (CUDA): reduce to one thread
             allReduceElem(varacc);
-            ElemType stddev = sqrt(varacc / rows);
+            CompType stddev = sqrt(varacc / rows);
             if (subset == 0)
             {
                 // stddevs = how many stddevs from the mean until outside of quantization range
-                lower = mean - (stddevs * stddev);
-                upper = mean + (stddevs * stddev);
+                lower = (ElemType) (mean - (stddevs * stddev));
+                upper = (ElemType) (mean + (stddevs * stddev));
             }
         }
     }
 
+    // input plus residual of one element, in CompType
+    template <class DataType>
+    static cudacode CompType SumAt(const DataType* inMat, const DataType* inResidual, size_t ij)
+    {
+        if (inResidual == nullptr)
+            return (CompType) inMat[ij];
+        return (CompType) inMat[ij] + (CompType) inResidual[ij];
+    }
+
 private:
     ValueQuantizer<ElemType> valQ;
 
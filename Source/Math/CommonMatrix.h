@@ -15,6 +15,7 @@
 
 #include "Basics.h"
 #include "basetypes.h"
+#include "NumaPolicy.h"
 #include <string>
 #include <stdint.h>
 #include <memory>
@@ -51,20 +52,102 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 MATH_API void SetMathLibTraceLevel(int traceLevel);
 MATH_API int GetMathLibTraceLevel();
 
+// Counts the buffers that are allocated for matrix storage on any device (including the blocks that the
+// caching GPU allocator hands out), e.g. to verify that repeated evaluations with the same shapes allocate none.
+MATH_API void CountMatrixStorageAllocation();
+MATH_API uint64_t GetNumMatrixStorageAllocations();
+
 inline bool IsGpu(DEVICEID_TYPE deviceId)
 {
     return deviceId > CPUDEVICE;
 }
 
+// What device memory is used for. The caching GPU allocator attributes each block to the category of the
+// GPUMemoryCategoryScope that is active on the allocating thread.
+enum class GPUMemoryCategory : int
+{
+    Other = 0,
+    Parameters,
+    Gradients,
+    Activations,
+    Workspace,     // e.g. of the convolution engines
+    ReaderBuffers, // minibatch data transferred to the device by the readers
+    Count
+};
+
+MATH_API const wchar_t* GPUMemoryCategoryName(GPUMemoryCategory category);
+
+// Attributes the device allocations of the current thread to 'category' while in scope. Scopes nest.
+class MATH_API GPUMemoryCategoryScope
+{
+public:
+    GPUMemoryCategoryScope(GPUMemoryCategory category);
+    ~GPUMemoryCategoryScope();
+
+    static GPUMemoryCategory Current();
+
+private:
+    GPUMemoryCategoryScope(const GPUMemoryCategoryScope&) = delete;
+    GPUMemoryCategoryScope& operator=(const GPUMemoryCategoryScope&) = delete;
+
+    GPUMemoryCategory m_previous;
+};
+
+// Statistics reported by the caching GPU allocator (see GPUCachingAllocator.h).
+// All byte counts refer to the rounded size-class sizes that are actually reserved on the device,
+// except for bytesRequested which is the sum of the sizes asked for by the callers.
+// The peaks are high-water marks since the allocator was created or since the last ResetPeakStats().
+struct GPUMemoryCacheStats
+{
+    size_t numAllocations = 0;      // number of Allocate() calls served
+    size_t numCacheHits = 0;        // number of those served from a cached block, i.e. without cudaMalloc
+    size_t numDeviceAllocations = 0; // number of cudaMalloc calls
+    size_t numDeviceFrees = 0;      // number of cudaFree calls (trimming, EmptyCache)
+    size_t bytesInUse = 0;          // bytes in blocks currently handed out
+    size_t bytesRequested = 0;      // bytes requested for the blocks currently handed out
+    size_t bytesCached = 0;         // bytes in idle blocks kept for reuse
+    size_t peakBytesReserved = 0;   // high-water mark of bytesInUse + bytesCached
+    size_t peakBytesInUse = 0;      // high-water mark of bytesInUse
+    size_t bytesInUseByCategory[(int)GPUMemoryCategory::Count] = {};     // bytesInUse split by GPUMemoryCategory
+    size_t peakBytesInUseByCategory[(int)GPUMemoryCategory::Count] = {}; // high-water mark of each of those
+
+    double HitRate() const { return numAllocations > 0 ? (double)numCacheHits / numAllocations : 0.0; }
+
+    // fraction of the reserved device memory that does not back requested bytes (rounding waste plus idle cache)
+    double Fragmentation() const
+    {
+        size_t reserved = bytesInUse + bytesCached;
+        return reserved > 0 ? 1.0 - (double)bytesRequested / reserved : 0.0;
+    }
+};
+
 class MATH_API TracingGPUMemoryAllocator
 {
 private:
     static int m_traceLevel;
+    static bool m_cachingEnabled;
+    static size_t m_cacheLimitInMBs;
 
 public:
     static void SetTraceLevel(int traceLevel);
     static bool IsTraceEnabled();
 
+    // When caching is enabled, freed device buffers are not returned to the driver but kept in
+    // per-device, per-stream size-class bins and handed out again by subsequent allocations.
+    // This avoids the implicit device synchronization of cudaFree when buffer sizes fluctuate.
+    static void SetCachingEnabled(bool enabled);
+    static bool IsCachingEnabled();
+
+    // Upper bound on the idle (cached) bytes per device; 0 means no limit. Excess blocks are released to the driver.
+    static void SetCacheLimitInMBs(size_t limitInMBs);
+    static size_t GetCacheLimitInMBs();
+
+    // Releases all idle cached blocks of the given device back to the driver.
+    static void EmptyCache(int deviceId);
+    static GPUMemoryCacheStats GetCacheStats(int deviceId);
+    // Restarts the peaks of GetCacheStats() from the current values, e.g. at the beginning of an epoch.
+    static void ResetPeakStats(int deviceId);
+
     template <typename AllocatedElemType>
     static AllocatedElemType* Allocate(int deviceId, size_t numRows, size_t numCols);
 
@@ -213,6 +296,59 @@ enum ElementWiseOperator
     Macro(ElementwiseProductWithPowExponentDerivative); \
     Macro(ElementwiseProductWithPowBaseDerivative);
 
+// -----------------------------------------------------------------------
+// ElementwiseProgram -- a tree of elementwise operations that is evaluated in a single pass over the elements,
+// see Matrix::ElementwiseProgramOp()
+// Registers [0, numInputs) hold the inputs, register numInputs + i the result of instruction i. The result of the
+// last instruction is the output. Instructions only read registers below their own.
+// -----------------------------------------------------------------------
+
+struct ElementwiseProgram
+{
+    static const size_t MaxInputs = 8;
+    static const size_t MaxInstructions = 16;
+
+    struct Instruction
+    {
+        ElementWiseOperator op;   // a unary, binary or ternary operation
+        unsigned char args[3];    // registers of the operands; those beyond the arity of op are ignored and should be 0
+    };
+
+    size_t numInputs = 0;
+    size_t numInstructions = 0;
+    Instruction instructions[MaxInstructions];
+};
+
+// -----------------------------------------------------------------------
+// MultiTensorUpdateParameters -- a learner update that is applied to many dense parameters together,
+// see Matrix::MultiTensorUpdate()
+// Each gradient g enters the update as gradientScale * g + l2RegularizationWeight * parameter (the mean gradient
+// and the L2 regularization of the learners); the gradients themselves are not modified.
+// -----------------------------------------------------------------------
+
+enum class MultiTensorUpdateKind : int
+{
+    MomentumSGD, // see Matrix::MomentumSGDUpdate(); the smoothed gradient has the size of the parameter
+    AdaGrad,     // see Matrix::Adagrad() without the average multiplier; the smoothed gradient has the size of the parameter
+    FSAdaGrad,   // see Matrix::FSAdagradUpdate(); the smoothed gradient holds the variance followed by the momentum
+    Adam,        // see Matrix::AdamUpdate(); the smoothed gradient holds the variance followed by the momentum
+};
+
+template <class ElemType>
+struct MultiTensorUpdateParameters
+{
+    MultiTensorUpdateKind kind = MultiTensorUpdateKind::MomentumSGD;
+    ElemType gradientScale = 1;
+    ElemType l2RegularizationWeight = 0;
+    ElemType learningRate = 0;
+    ElemType momentum = 0;
+    ElemType unitGainFactor = 1;
+    ElemType varianceMomentum = 0; // FSAdaGrad and Adam
+    ElemType varianceScale = 1;    // FSAdaGrad: the target AdaGrad denominator; Adam: the bias correction
+    ElemType epsilon = 0;          // Adam
+    bool adamax = false;           // Adam
+};
+
 // -----------------------------------------------------------------------
 // various enums to describe
 // -----------------------------------------------------------------------
@@ -291,17 +427,18 @@ public:
         {
             if (m_computeDevice < 0)
             {
-                delete[] m_pArray;
+                // the arrays of NewLargeArray() may be huge page mappings
+                DeleteLargeArray(m_pArray);
                 m_pArray = nullptr;
                 m_nzValues = nullptr;
 
-                delete[] m_unCompIndex;
+                DeleteLargeArray(m_unCompIndex);
                 m_unCompIndex = nullptr;
 
-                delete[] m_compIndex;
+                DeleteLargeArray(m_compIndex);
                 m_compIndex = nullptr;
 
-                delete[] m_blockIds;
+                DeleteLargeArray(m_blockIds);
                 m_blockIds = nullptr;
             }
             else
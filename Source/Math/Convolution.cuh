@@ -314,87 +314,213 @@ __global__ void kMaxROIPoolingForward(const int totalIterations,
     }
 }
 
-// The kernel operates on one location in the input to the ROIPoolingNode (one image location).
-// It loops over the ROIs corresponding to that image, seeing which ones could contain the location
-// in their output. For each ROI, it checks the argmax data to see if that ROI indeed chose
-// this pixel location as the maximum. If so, it increments the gradient term for the input location.
+// ROI align (Mask R-CNN): the ROI and its bins are not quantized. Each output averages
+// samplesW x samplesH points of its bin, with samplesW = ceil(bin width) (same for the height),
+// and each point is bilinearly interpolated from the 4 neighboring input locations.
+// ROIs are (x1, y1, x2, y2) in the original image, as for max ROI pooling.
+template <typename comp_t>
+__device__ void ROIAlignBin(const comp_t* roi, int pw, int ph, int pooledWidth, int pooledHeight,
+                            comp_t& binStartW, comp_t& binStartH, comp_t& binW, comp_t& binH, int& samplesW, int& samplesH)
+{
+    comp_t roiWidth = max(roi[2] - roi[0], (comp_t)1);
+    comp_t roiHeight = max(roi[3] - roi[1], (comp_t)1);
+    binW = roiWidth / (comp_t)pooledWidth;
+    binH = roiHeight / (comp_t)pooledHeight;
+    binStartW = roi[0] + pw * binW;
+    binStartH = roi[1] + ph * binH;
+    samplesW = max((int)ceil(binW), 1);
+    samplesH = max((int)ceil(binH), 1);
+}
+
+// Returns false for points outside of the image, otherwise the 4 locations and their weights.
+template <typename comp_t>
+__device__ bool ROIAlignBilinear(comp_t y, comp_t x, int width, int height, int index[4], comp_t weight[4])
+{
+    if (y < (comp_t)-1 || y > (comp_t)height || x < (comp_t)-1 || x > (comp_t)width)
+        return false;
+    y = max(y, (comp_t)0);
+    x = max(x, (comp_t)0);
+    int y0 = (int)y;
+    int x0 = (int)x;
+    int y1, x1;
+    if (y0 >= height - 1)
+        y0 = y1 = height - 1, y = (comp_t)y0;
+    else
+        y1 = y0 + 1;
+    if (x0 >= width - 1)
+        x0 = x1 = width - 1, x = (comp_t)x0;
+    else
+        x1 = x0 + 1;
+    comp_t ly = y - y0, lx = x - x0;
+    comp_t hy = 1 - ly, hx = 1 - lx;
+    index[0] = y0 * width + x0; weight[0] = hy * hx;
+    index[1] = y0 * width + x1; weight[1] = hy * lx;
+    index[2] = y1 * width + x0; weight[2] = ly * hx;
+    index[3] = y1 * width + x1; weight[3] = ly * lx;
+    return true;
+}
+
+// src: Images              [W x H x C x N]
+// roiData: ROIs            [4 x numROIs x N],
+// dst: Pooled ROIs         [PW x PH x C x numROIs x N]
+// One thread per output location of all ROIs of the minibatch.
 template <typename ElemType>
-__global__ void kMaxROIPoolingBackward(const int totalIterations,
+__global__ void kAverageROIAlignForward(const int totalIterations,
     const int numROIs, const int numImg,
     const int channels, const int width, const int height,
-    const int pooledWidth, const int pooledHeight, const ElemType* pooledGrad,
-    const ElemType* roiData, ElemType* grad, const ElemType* argmax, double spatialScale)
+    const int pooledWidth, const int pooledHeight, const ElemType* src,
+    const ElemType* roiData, ElemType* dst, double spatialScale)
 {
     typedef typename TypeSelector<ElemType>::comp_t comp_t;
-    // index loops over all input locations (locations in the original input tensor).
     for (int index = blockIdx.x * blockDim.x + threadIdx.x;
         index < (totalIterations); index += blockDim.x * gridDim.x)
     {
-        // images are laid out [W x H x C x N]
-        // (n, c, h, w) is an element in the input image
-        int w = index % width;
-        int h = (index / width) % height;
-        int c = (index / width / height) % channels;
-        int n = index / width / height / channels;
-
-        // compute range of ROIs corresponding to this image:
-        int roiMin = n * numROIs;
-        int roiMax = (n + 1) * numROIs;
-
-        comp_t gradient = 0;
-        for (int roiN = roiMin; roiN < roiMax; roiN++)
+        int pw = index % pooledWidth;
+        int ph = (index / pooledWidth) % pooledHeight;
+        int c = (index / pooledWidth / pooledHeight) % channels;
+        int n = index / pooledWidth / pooledHeight / channels;
+
+        comp_t roi[4];
+        for (int i = 0; i < 4; i++)
+            roi[i] = (comp_t)roiData[n * 4 + i] * (comp_t)spatialScale;
+        comp_t binStartW, binStartH, binW, binH;
+        int samplesW, samplesH;
+        ROIAlignBin(roi, pw, ph, pooledWidth, pooledHeight, binStartW, binStartH, binW, binH, samplesW, samplesH);
+
+        const ElemType* plane = src + ((n / numROIs) * channels + c) * height * width;
+        comp_t sum = 0;
+        for (int iy = 0; iy < samplesH; iy++)
         {
-            // each ROI is 4 elements: (x, y, w, h)
-            const ElemType* roiOffset = roiData + roiN * 4;
-
-            // ROI data is absolute pixel value in the original image size
-            int roiStartW = (int)(round_(roiOffset[0] * spatialScale));
-            int roiStartH = (int)(round_(roiOffset[1] * spatialScale));
-            int roiEndW = (int)(round_(roiOffset[2] * spatialScale));
-            int roiEndH = (int)(round_(roiOffset[3] * spatialScale));
-
-            int roiWidth = max(roiEndW - roiStartW + 1, (int)1);
-            int roiHeight = max(roiEndH - roiStartH + 1, (int)1);
-
-            // skip this ROI if it doesn't contain our input location.
-            const bool inROI = (w >= roiStartW && w < roiStartW + roiWidth &&
-                h >= roiStartH && h < roiStartH + roiHeight);
-            if (!inROI)
-                continue;
+            comp_t y = binStartH + (iy + (comp_t)0.5) * binH / samplesH;
+            for (int ix = 0; ix < samplesW; ix++)
+            {
+                comp_t x = binStartW + (ix + (comp_t)0.5) * binW / samplesW;
+                int indices[4];
+                comp_t weights[4];
+                if (ROIAlignBilinear(y, x, width, height, indices, weights))
+                    for (int k = 0; k < 4; k++)
+                        sum += weights[k] * (comp_t)plane[indices[k]];
+            }
+        }
+        dst[index] = (ElemType)(sum / (samplesW * samplesH));
+    }
+}
 
-            comp_t winH = (comp_t)roiHeight / (comp_t)pooledHeight;
-            comp_t winW = (comp_t)roiWidth / (comp_t)pooledWidth;
+// Input locations of a channel of one ROI that fit the shared memory tile of kROIPoolingBackward.
+static const int ROIPoolingBackwardTileSize = 1024;
 
-            // what pooled nodes in the output for this ROI could have pooled this input location?
-            // we use int here since the computation can yield a negative result
-            int phstart = (int)((float)(h - roiStartH) / winH);
-            int pwstart = (int)((float)(w - roiStartW) / winW);
-            int phend = (int)(ceilf((float)(h - roiStartH + 1) / winH));
-            int pwend = (int)(ceilf((float)(w - roiStartW + 1) / winW));
+template <typename ElemType>
+struct ROIPoolingBackwardTile
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    comp_t* tile;
+    ElemType* plane;
+    bool useTile;
+    int startW, startH, tileW, tileH, width;
 
-            phstart = min(max(phstart, 0), pooledHeight);
-            pwstart = min(max(pwstart, 0), pooledWidth);
-            phend = min(max(phend, 0), pooledHeight);
-            pwend = min(max(pwend, 0), pooledWidth);
+    __device__ void Add(int index, comp_t value)
+    {
+        int w = index % width - startW;
+        int h = index / width - startH;
+        if (useTile && 0 <= w && w < tileW && 0 <= h && h < tileH)
+            atomicAdd(&tile[h * tileW + w], value);
+        else
+            atomicAdd(&plane[index], (ElemType)value);
+    }
+};
+
+// Backward of max ROI pooling (roiAlign = false) and of ROI align: one block per channel of each ROI
+// scatters the pooled gradients to the input. The gradients of the ROI are summed in a shared memory
+// tile that covers the locations the ROI reads, so that overlapping bins and bilinear samples are
+// combined before they are added to the input gradient; only then a global atomic per touched location
+// adds them, as ROIs of an image overlap. ROIs larger than the tile add to the input gradient directly.
+template <bool roiAlign, typename ElemType>
+__global__ void kROIPoolingBackward(const int numROIs,
+    const int channels, const int width, const int height,
+    const int pooledWidth, const int pooledHeight, const ElemType* pooledGrad,
+    const ElemType* roiData, ElemType* grad, const ElemType* argmax, double spatialScale)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    __shared__ comp_t tile[ROIPoolingBackwardTileSize];
+
+    int c = blockIdx.x % channels;
+    int n = blockIdx.x / channels;
+
+    // the locations read by the ROI: [tileStartW, tileEndW) x [tileStartH, tileEndH)
+    comp_t roi[4] = { 0 };
+    int tileStartW, tileStartH, tileEndW, tileEndH;
+    if (roiAlign)
+    {
+        for (int i = 0; i < 4; i++)
+            roi[i] = (comp_t)roiData[n * 4 + i] * (comp_t)spatialScale;
+        tileStartW = min(max((int)floor(roi[0]), 0), width);
+        tileStartH = min(max((int)floor(roi[1]), 0), height);
+        tileEndW = min(max((int)ceil(max(roi[2], roi[0] + 1)) + 2, 0), width);
+        tileEndH = min(max((int)ceil(max(roi[3], roi[1] + 1)) + 2, 0), height);
+    }
+    else
+    {
+        int roiStartW = (int)(round_(roiData[n * 4 + 0] * spatialScale));
+        int roiStartH = (int)(round_(roiData[n * 4 + 1] * spatialScale));
+        int roiEndW = (int)(round_(roiData[n * 4 + 2] * spatialScale));
+        int roiEndH = (int)(round_(roiData[n * 4 + 3] * spatialScale));
+        tileStartW = min(max(roiStartW, 0), width);
+        tileStartH = min(max(roiStartH, 0), height);
+        tileEndW = min(max(roiStartW + max(roiEndW - roiStartW + 1, 1), 0), width);
+        tileEndH = min(max(roiStartH + max(roiEndH - roiStartH + 1, 1), 0), height);
+    }
+    int tileW = max(tileEndW - tileStartW, 0);
+    int tileH = max(tileEndH - tileStartH, 0);
+    bool useTile = tileW * tileH <= ROIPoolingBackwardTileSize;
+    if (useTile)
+    {
+        for (int i = threadIdx.x; i < tileW * tileH; i += blockDim.x)
+            tile[i] = 0;
+    }
+    __syncthreads();
 
-            // go right up to this channel of this ROI.
-            int offset = (roiN * channels + c) * pooledWidth * pooledHeight;
-            const ElemType* offsetPoolGrad = pooledGrad + offset;
-            const ElemType* offsetArgmax = argmax + offset;
+    ElemType* plane = grad + ((n / numROIs) * channels + c) * height * width;
+    ROIPoolingBackwardTile<ElemType> t = { tile, plane, useTile, tileStartW, tileStartH, tileW, tileH, width };
 
-            for (int ph = phstart; ph < phend; ph++)
+    int offset = (n * channels + c) * pooledWidth * pooledHeight;
+    for (int i = threadIdx.x; i < pooledWidth * pooledHeight; i += blockDim.x)
+    {
+        comp_t g = (comp_t)pooledGrad[offset + i];
+        if (!roiAlign)
+        {
+            // empty bins have no argmax
+            int index = (int)argmax[offset + i];
+            if (index >= 0)
+                t.Add(index, g);
+            continue;
+        }
+        comp_t binStartW, binStartH, binW, binH;
+        int samplesW, samplesH;
+        ROIAlignBin(roi, i % pooledWidth, i / pooledWidth, pooledWidth, pooledHeight, binStartW, binStartH, binW, binH, samplesW, samplesH);
+        g /= samplesW * samplesH;
+        for (int iy = 0; iy < samplesH; iy++)
+        {
+            comp_t y = binStartH + (iy + (comp_t)0.5) * binH / samplesH;
+            for (int ix = 0; ix < samplesW; ix++)
             {
-                for (int pw = pwstart; pw < pwend; pw++)
-                {
-                    if ((int)offsetArgmax[ph * pooledWidth + pw] == (h * width + w))
-                    {
-                        gradient += (comp_t)offsetPoolGrad[ph * pooledWidth + pw];
-                    }
-                }
+                comp_t x = binStartW + (ix + (comp_t)0.5) * binW / samplesW;
+                int indices[4];
+                comp_t weights[4];
+                if (ROIAlignBilinear(y, x, width, height, indices, weights))
+                    for (int k = 0; k < 4; k++)
+                        t.Add(indices[k], g * weights[k]);
             }
         }
+    }
+    __syncthreads();
 
-        atomicAdd(&grad[index], (ElemType)gradient);
+    if (useTile)
+    {
+        for (int i = threadIdx.x; i < tileW * tileH; i += blockDim.x)
+        {
+            if (tile[i] != 0)
+                atomicAdd(&plane[(tileStartH + i / tileW) * width + tileStartW + i % tileW], (ElemType)tile[i]);
+        }
     }
 }
 
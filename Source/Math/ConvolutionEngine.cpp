@@ -27,9 +27,63 @@ void ConvolutionEngine<ElemType>::Forward(const Mat& in, const Mat& kernel, Mat&
 
     EnsureCompatible();
     EnsureConvolutionInitialized();
+    GPUMemoryCategoryScope memoryCategory(GPUMemoryCategory::Workspace); // the outputs are already allocated by the node
     ForwardCore(in, kernel, out, workspace);
 }
 
+template <class ElemType>
+void ConvolutionEngine<ElemType>::ForwardFused(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace, const ConvolutionEpilogue<ElemType>& epilogue)
+{
+    if (out.GetDeviceId() != CPUDEVICE)
+        LogicError("ForwardFused: The fused convolution is only implemented on the CPU.");
+
+    const auto& g = *m_geometry;
+    assert(g.InputShape().GetNumElements() == in.GetNumRows());
+    assert(g.OutputShape().GetNumElements() == out.GetNumRows());
+    assert(in.GetNumCols() == out.GetNumCols());
+    assert(g.KernelShape().GetNumElements() * g.KernelCount() == kernel.GetNumElements());
+#ifdef NDEBUG
+    UNUSED(g);
+#endif
+
+    EnsureCompatible();
+    EnsureConvolutionInitialized();
+    ForwardFusedCore(in, kernel, out, workspace, epilogue);
+}
+
+template <class ElemType>
+void ConvolutionEngine<ElemType>::ApplyEpilogue(Mat& out, const ConvolutionEpilogue<ElemType>& epilogue) const
+{
+    if (!epilogue.scale && !epilogue.shift && !epilogue.relu)
+        return;
+    if (out.GetDeviceId() != CPUDEVICE || out.GetMatrixType() != MatrixType::DENSE)
+        LogicError("ApplyEpilogue: Only dense CPU matrices are supported.");
+
+    // the output maps are the outermost dimension of a column (CHW layout)
+    const size_t mapCount = m_geometry->KernelCount();
+    const size_t mapSize = out.GetNumRows() / mapCount;
+    assert(mapSize * mapCount == out.GetNumRows());
+    const size_t numCols = out.GetNumCols();
+    const ElemType* scale = epilogue.scale;
+    const ElemType* shift = epilogue.shift;
+    const bool relu = epilogue.relu;
+    ElemType* data = out.Data();
+
+#pragma omp parallel for
+    for (long i = 0; i < (long)(numCols * mapCount); i++)
+    {
+        const size_t map = i % mapCount;
+        const ElemType a = scale ? scale[map] : (ElemType)1;
+        const ElemType b = shift ? shift[map] : (ElemType)0;
+        ElemType* p = data + i * mapSize;
+        for (size_t j = 0; j < mapSize; j++)
+        {
+            ElemType v = p[j] * a + b;
+            p[j] = relu && v < (ElemType)0 ? (ElemType)0 : v;
+        }
+    }
+}
+
 template <class ElemType>
 void ConvolutionEngine<ElemType>::BackwardData(const Mat& srcGrad, const Mat& kernel, Mat& grad, bool accumulateGradient, Mat& workspace)
 {
@@ -46,6 +100,7 @@ void ConvolutionEngine<ElemType>::BackwardData(const Mat& srcGrad, const Mat& ke
 
     EnsureCompatible();
     EnsureConvolutionInitialized();
+    GPUMemoryCategoryScope memoryCategory(GPUMemoryCategory::Workspace); // the outputs are already allocated by the node
     BackwardDataCore(srcGrad, kernel, grad, accumulateGradient, workspace);
 }
 
@@ -65,6 +120,7 @@ void ConvolutionEngine<ElemType>::BackwardKernel(const Mat& srcGrad, const Mat&
 
     EnsureCompatible();
     EnsureConvolutionInitialized();
+    GPUMemoryCategoryScope memoryCategory(GPUMemoryCategory::Workspace); // the outputs are already allocated by the node
     BackwardKernelCore(srcGrad, in, kernel, accumulateGradient, allowReuse, workspace);
 }
 
@@ -616,7 +672,20 @@ protected:
 #ifdef USE_MKL2017DNN
         if (ForwardCoreMKL(in, kernel, out)) return;
 #endif
+        ForwardGemm(in, kernel, out, workspace, nullptr);
+    }
 
+    void ForwardFusedCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace, const ConvolutionEpilogue<ElemType>& epilogue) override
+    {
+#ifdef USE_MKL2017DNN
+        if (ForwardFusedMKL(in, kernel, out, workspace, epilogue)) return;
+#endif
+        ForwardGemm(in, kernel, out, workspace, &epilogue);
+    }
+
+    // The epilogue, if any, is applied to each sub-batch right after it has been computed.
+    void ForwardGemm(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace, const ConvolutionEpilogue<ElemType>* epilogue)
+    {
         size_t batchSize = in.GetNumCols();
         size_t subBatchSize = m_maxTempMemSizeInSamples == 0 ? batchSize : min(batchSize, m_maxTempMemSizeInSamples);
 
@@ -672,6 +741,12 @@ protected:
                 auto outSlice = out.ColumnSlice(start, curBatchSize);
                 outSlice.AssignTransposeOf(outTempSlice);
             }
+
+            if (epilogue)
+            {
+                auto outSlice = out.ColumnSlice(start, curBatchSize);
+                this->ApplyEpilogue(outSlice, *epilogue);
+            }
         }
     }
 
@@ -869,6 +944,7 @@ protected:
             ContextIndex_Forward = 0,
             ContextIndex_BackwardData,
             ContextIndex_BackwardFilter,
+            ContextIndex_ForwardFused, // with bias, and optionally ReLU
             ContextIndex_Total
         };
 
@@ -876,23 +952,27 @@ protected:
         const ConvolveGeometry* m_prevGeometry = nullptr;
         size_t m_prevBatchSize = 0;
         int m_contextFlags = 0;
+        bool m_fusedRelu = false;
 
         // fixed dimension for MKL for now
         static const int m_dimension = 4;
 
-        static const int NumInputs = 2;
+        static const int MaxInputs = 3;
 
         struct PrimitiveContext
         {
-            MKLDnnResourceAdapter<ElemType> inputs[NumInputs];
+            MKLDnnResourceAdapter<ElemType> inputs[MaxInputs];
             MKLDnnResourceAdapter<ElemType> output;
+            int numInputs = 2;
 
             dnnPrimitive_t primitive = nullptr;
+            dnnPrimitive_t relu = nullptr; // applied in place to the output while it is still in the layout of the primitive
             dnnPrimitiveAttributes_t attributes = nullptr;
 
             void Clear()
             {
                 if (primitive) { dnnDelete<ElemType>(primitive); primitive = nullptr; }
+                if (relu) { dnnDelete<ElemType>(relu); relu = nullptr; }
                 for (auto& i : inputs) i.Clear();
                 output.Clear();
                 if (attributes) { dnnPrimitiveAttributesDestroy<ElemType>(attributes); attributes = nullptr; }
@@ -972,11 +1052,11 @@ protected:
             return forward ? (geometry->InputShape().GetRank() < m_dimension) : (geometry->OutputShape().GetRank() < m_dimension);
         }
 
-        void Prepare(size_t batchSize, const ConvolveGeometry* geometry, ContextIndex contextIndex)
+        void Prepare(size_t batchSize, const ConvolveGeometry* geometry, ContextIndex contextIndex, bool relu = false)
         {
             int flag = (1 << contextIndex);
             bool sameGeometryAndBatchSize = (geometry == m_prevGeometry && batchSize == m_prevBatchSize);
-            if (sameGeometryAndBatchSize && !!(m_contextFlags & flag)) return;
+            if (sameGeometryAndBatchSize && !!(m_contextFlags & flag) && (contextIndex != ContextIndex_ForwardFused || relu == m_fusedRelu)) return;
 
             if (!sameGeometryAndBatchSize)
                 m_contextFlags = 0;
@@ -996,6 +1076,8 @@ protected:
             size_t mapCount = geometry->GetMapCount(geometry->KernelShape().GetRank() - 1);
 
             SmallVector<size_t> outputSize, outputStrides, filterSize, filterStrides, inputSize,  inputStrides;
+            const size_t biasSize[] = { mapCount };
+            const size_t biasStrides[] = { 1 };
             SmallVector<int>    inputOffset;
 
             GetSizesAndStrides(geometry->OutputShape(), batchSize, outputSize, outputStrides, mapCount);
@@ -1009,9 +1091,9 @@ protected:
             auto& ctx = m_context[contextIndex];
             ctx.Clear();
 
-            dnnLayout_t ltUserInputs[NumInputs], ltPrimInputs[NumInputs];
+            dnnLayout_t ltUserInputs[MaxInputs], ltPrimInputs[MaxInputs];
             dnnLayout_t ltUserOutput, ltPrimOutput;
-            dnnResourceType_t inputTypes[NumInputs];
+            dnnResourceType_t inputTypes[MaxInputs];
             dnnResourceType_t outputType;
             switch (contextIndex)
             {
@@ -1054,33 +1136,60 @@ protected:
                 inputTypes[1] = dnnResourceSrc;
                 outputType = dnnResourceDiffFilter;
                 break;
+            case ContextIndex_ForwardFused:
+                CHECK_MKL(dnnLayoutCreate<ElemType>(&ltUserInputs[0], m_dimension, inputSize.begin(), inputStrides.begin()));
+                CHECK_MKL(dnnLayoutCreate<ElemType>(&ltUserInputs[1], filter_dimension, filterSize.begin(), filterStrides.begin()));
+                CHECK_MKL(dnnLayoutCreate<ElemType>(&ltUserInputs[2], 1, biasSize, biasStrides));
+                CHECK_MKL(dnnLayoutCreate<ElemType>(&ltUserOutput, m_dimension, outputSize.begin(), outputStrides.begin()));
+                CHECK_MKL(dnnPrimitiveAttributesCreate<ElemType>(&ctx.attributes));
+                if (geometry->Groups() > 1)
+                    CHECK_MKL(dnnGroupsConvolutionCreateForwardBias<ElemType>(&ctx.primitive, ctx.attributes, dnnAlgorithmConvolutionDirect, geometry->Groups(), m_dimension, inputSize.begin(), outputSize.begin(), filterSize.begin(), convolutionStride.begin(), inputOffset.begin(), dnnBorderZeros));
+                else
+                    CHECK_MKL(dnnConvolutionCreateForwardBias<ElemType>(&ctx.primitive, ctx.attributes, dnnAlgorithmConvolutionDirect, m_dimension, inputSize.begin(), outputSize.begin(), filterSize.begin(), convolutionStride.begin(), inputOffset.begin(), dnnBorderZeros));
+                inputTypes[0] = dnnResourceSrc;
+                inputTypes[1] = dnnResourceFilter;
+                inputTypes[2] = dnnResourceBias;
+                outputType = dnnResourceDst;
+                ctx.numInputs = 3;
+                m_fusedRelu = relu;
+                break;
             default:
                 RuntimeError("Unexpected context type %d", (int)contextIndex);
             }
 
-            for (int i = 0; i < NumInputs; i++)
+            for (int i = 0; i < ctx.numInputs; i++)
             {
                 CHECK_MKL(dnnLayoutCreateFromPrimitive<ElemType>(&ltPrimInputs[i], ctx.primitive, inputTypes[i]));
                 ctx.inputs[i].Create(ltUserInputs[i], ltPrimInputs[i], inputTypes[i], true);
             }
 
             CHECK_MKL(dnnLayoutCreateFromPrimitive<ElemType>(&ltPrimOutput, ctx.primitive, outputType));
+            // the ReLU works on the blocked layout of the convolution output, so that it is converted back only once
+            if (contextIndex == ContextIndex_ForwardFused && relu)
+                CHECK_MKL(dnnReLUCreateForward<ElemType>(&ctx.relu, ctx.attributes, ltPrimOutput, (ElemType)0));
             ctx.output.Create(ltUserOutput, ltPrimOutput, outputType, false);
         }
 
-        void Execute(void* userInput0, void* userInput1, void* userOutput, ContextIndex contextIndex)
+        void Execute(void* userInput0, void* userInput1, void* userOutput, ContextIndex contextIndex, void* userInput2 = nullptr)
         {
             auto& ctx = m_context[contextIndex];
-            void* userInputs[] = { userInput0, userInput1 };
+            void* userInputs[] = { userInput0, userInput1, userInput2 };
             void* resources[dnnResourceNumber] = { 0 };
 
-            for(int i = 0; i < NumInputs; i++)
+            for(int i = 0; i < ctx.numInputs; i++)
                 ctx.inputs[i].PrepareForExecution(userInputs[i], resources);
 
             ctx.output.PrepareForExecution(userOutput, resources);
 
             CHECK_MKL(dnnExecute<ElemType>(ctx.primitive, resources));
 
+            if (ctx.relu)
+            {
+                void* reluResources[dnnResourceNumber] = { 0 };
+                reluResources[dnnResourceSrc] = reluResources[dnnResourceDst] = resources[dnnResourceDst];
+                CHECK_MKL(dnnExecute<ElemType>(ctx.relu, reluResources));
+            }
+
             ctx.output.ConvertOutput(userOutput);
         }
     };
@@ -1098,6 +1207,40 @@ protected:
         return true;
     }
 
+    // Convolution with bias and ReLU as one primitive, plus a scale per output map that is folded into a copy of the kernel.
+    bool ForwardFusedMKL(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace, const ConvolutionEpilogue<ElemType>& epilogue)
+    {
+        if (!m_mklContext.Supported(m_geometry.get(), true)) return false;
+
+        const size_t mapCount = m_geometry->KernelCount();
+        const size_t kernelSize = kernel.GetNumElements() / mapCount;
+        const ElemType* kernelData = kernel.Data();
+        if (epilogue.scale)
+        {
+            // the kernel of each output map is contiguous
+            workspace.Resize(kernelSize, mapCount);
+            ElemType* scaledKernel = workspace.Data();
+#pragma omp parallel for
+            for (long map = 0; map < (long)mapCount; map++)
+                for (size_t i = 0; i < kernelSize; i++)
+                    scaledKernel[map * kernelSize + i] = kernelData[map * kernelSize + i] * epilogue.scale[map];
+            kernelData = scaledKernel;
+        }
+        const ElemType* shift = epilogue.shift;
+        if (!shift)
+        {
+            m_zeroBias.assign(mapCount, 0);
+            shift = m_zeroBias.data();
+        }
+
+        m_mklContext.Prepare(in.GetNumCols(), m_geometry.get(), MKLConvolutionContext::ContextIndex_ForwardFused, epilogue.relu);
+        m_mklContext.Execute(in.Data(), (void*)kernelData, out.Data(), MKLConvolutionContext::ContextIndex_ForwardFused, (void*)shift);
+
+        return true;
+    }
+
+    std::vector<ElemType> m_zeroBias;
+
     bool BackwardDataMKL(const Mat& srcGrad, const Mat& kernel, Mat& grad, bool accumulateGradient, Mat& workspace)
     {
         if (!m_mklContext.Supported(m_geometry.get(), false)) return false;
@@ -1151,6 +1294,579 @@ public:
     }
 };
 
+//------------------------------------------------------------------
+// Winograd convolution engine implementation.
+// This engine computes the forward pass of 2D convolutions with 3x3 kernels and stride 1
+// using the minimal filtering algorithms F(2x2,3x3) and F(4x4,3x3)
+// (Fast algorithms for convolutional neural networks; Lavin, Gray).
+// Uses GEMM engine for backpropagation and reference engine for pooling operations.
+//------------------------------------------------------------------
+
+// The transforms of F(m x m, 3 x 3), as row-major matrices: the input transform B^T [a x a],
+// the kernel transform G [a x 3] and the output transform A^T [m x a], where a = m + 2 is the input tile size.
+struct WinogradF2x3
+{
+    static const size_t TileSize = 2;
+    static const float BT[4][4];
+    static const float G[4][3];
+    static const float AT[2][4];
+};
+
+const float WinogradF2x3::BT[4][4] = { { 1,  0, -1,  0 },
+                                       { 0,  1,  1,  0 },
+                                       { 0, -1,  1,  0 },
+                                       { 0,  1,  0, -1 } };
+const float WinogradF2x3::G[4][3] = { { 1,     0,    0    },
+                                      { 0.5f,  0.5f, 0.5f },
+                                      { 0.5f, -0.5f, 0.5f },
+                                      { 0,     0,    1    } };
+const float WinogradF2x3::AT[2][4] = { { 1, 1,  1,  0 },
+                                       { 0, 1, -1, -1 } };
+
+struct WinogradF4x3
+{
+    static const size_t TileSize = 4;
+    static const float BT[6][6];
+    static const float G[6][3];
+    static const float AT[4][6];
+};
+
+const float WinogradF4x3::BT[6][6] = { { 4,  0, -5,  0, 1, 0 },
+                                       { 0, -4, -4,  1, 1, 0 },
+                                       { 0,  4, -4, -1, 1, 0 },
+                                       { 0, -2, -1,  2, 1, 0 },
+                                       { 0,  2, -1, -2, 1, 0 },
+                                       { 0,  4,  0, -5, 0, 1 } };
+const float WinogradF4x3::G[6][3] = { {  1.0f / 4,   0,          0         },
+                                      { -1.0f / 6,  -1.0f / 6,  -1.0f / 6  },
+                                      { -1.0f / 6,   1.0f / 6,  -1.0f / 6  },
+                                      {  1.0f / 24,  1.0f / 12,  1.0f / 6  },
+                                      {  1.0f / 24, -1.0f / 12,  1.0f / 6  },
+                                      {  0,          0,          1         } };
+const float WinogradF4x3::AT[4][6] = { { 1, 1,  1, 1,  1, 0 },
+                                       { 0, 1, -1, 2, -2, 0 },
+                                       { 0, 1,  1, 4,  4, 0 },
+                                       { 0, 1, -1, 8, -8, 1 } };
+
+// out = mat * in * mat^T, for a row-major [Rows x Cols] matrix mat and a [Cols x Cols] matrix in
+template <class ElemType, size_t Rows, size_t Cols>
+static inline void WinogradTransform(const float (&mat)[Rows][Cols], const ElemType (&in)[Cols][Cols], ElemType (&out)[Rows][Rows])
+{
+    ElemType tmp[Rows][Cols];
+    for (size_t r = 0; r < Rows; r++)
+        for (size_t c = 0; c < Cols; c++)
+        {
+            ElemType sum = 0;
+            for (size_t i = 0; i < Cols; i++)
+                sum += mat[r][i] * in[i][c];
+            tmp[r][c] = sum;
+        }
+    for (size_t r = 0; r < Rows; r++)
+        for (size_t c = 0; c < Rows; c++)
+        {
+            ElemType sum = 0;
+            for (size_t i = 0; i < Cols; i++)
+                sum += tmp[r][i] * mat[c][i];
+            out[r][c] = sum;
+        }
+}
+
+template <class ElemType>
+class WinogradConvolutionEngine : public GemmConvolutionEngine<ElemType>
+{
+public:
+    using Base = GemmConvolutionEngine<ElemType>;
+    using typename Base::Mat;
+
+public:
+    WinogradConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind, bool poolIncludePad)
+        : Base(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad)
+    {
+    }
+
+protected:
+    using Base::m_geometry;
+    using Base::m_deviceId;
+    using Base::m_imageLayout;
+    using Base::m_maxTempMemSizeInSamples;
+
+    void EnsureCompatible() override
+    {
+        Base::EnsureCompatible();
+        if (!IsSupported(m_deviceId, m_geometry, m_imageLayout, PoolKind::None))
+            LogicError("Winograd convolution engine supports only 2D convolutions with 3x3 kernels, stride 1 and full sharing. Geometry: %s", ((string)*m_geometry).c_str());
+    }
+
+    void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace) override
+    {
+#ifdef USE_MKL2017DNN
+        // MKL-DNN comes with its own direct and Winograd convolutions.
+        if (this->ForwardCoreMKL(in, kernel, out)) return;
+#endif
+        ForwardWinograd(in, kernel, out, workspace, nullptr);
+    }
+
+    void ForwardFusedCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace, const ConvolutionEpilogue<ElemType>& epilogue) override
+    {
+#ifdef USE_MKL2017DNN
+        if (this->ForwardFusedMKL(in, kernel, out, workspace, epilogue)) return;
+#endif
+        ForwardWinograd(in, kernel, out, workspace, &epilogue);
+    }
+
+    // F(4x4,3x3) needs 2.25 multiplications per output against 4 of F(2x2,3x3), but its larger tiles
+    // waste more work at the borders of small maps and are less accurate.
+    void ForwardWinograd(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace, const ConvolutionEpilogue<ElemType>* epilogue)
+    {
+        const auto& outT = m_geometry->OutputShape();
+        if (outT[0] >= 8 && outT[1] >= 8)
+            ForwardTiles<WinogradF4x3>(in, kernel, out, workspace, epilogue);
+        else
+            ForwardTiles<WinogradF2x3>(in, kernel, out, workspace, epilogue);
+    }
+
+    // The forward method consists of 4 parts, using the notation of the GEMM engine, a = m + 2 for output tiles
+    // of m x m and P = the number of tiles ceil(W'/m) * ceil(H'/m) * N:
+    // 1. Transforming the kernels: each 3x3 kernel g becomes G g G^T, giving a^2 matrices [K x C].
+    // 2. Transforming the inputs: each a x a input tile d (overlapping by 2) becomes B^T d B, giving a^2 matrices [C x P].
+    // 3. Multiplying the matrices of each of the a^2 tile positions: [K x C] * [C x P] -> [K x P].
+    // 4. Transforming the products back: each a x a tile M becomes the m x m output tile A^T M A,
+    //    to which the epilogue is applied before it is stored.
+    // The transformed inputs take a^2/m^2 (4 or 2.25) times the size of the input, instead of the 9 times
+    // of the unrolled input of the GEMM engine.
+    template <class Winograd>
+    void ForwardTiles(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace, const ConvolutionEpilogue<ElemType>* epilogue)
+    {
+        static const size_t m = Winograd::TileSize;
+        static const size_t a = m + 2;
+        static const size_t numPositions = a * a;
+
+        const auto& inT = m_geometry->InputShape();
+        const auto& outT = m_geometry->OutputShape();
+        const size_t inW = inT[0], inH = inT[1], mapInCount = inT[2];
+        const size_t outW = outT[0], outH = outT[1], mapOutCount = outT[2];
+        const int padW = m_geometry->GetLowerPad(0), padH = m_geometry->GetLowerPad(1);
+        const size_t tilesW = (outW + m - 1) / m, tilesH = (outH + m - 1) / m;
+        const size_t tilesPerSample = tilesW * tilesH;
+
+        size_t batchSize = in.GetNumCols();
+        size_t subBatchSize = m_maxTempMemSizeInSamples == 0 ? batchSize : min(batchSize, m_maxTempMemSizeInSamples);
+        size_t maxTiles = subBatchSize * tilesPerSample;
+
+        // Reserve space for the transformed kernels, the transformed inputs and their products.
+        const size_t kernelSize = numPositions * mapOutCount * mapInCount;
+        const size_t inputSize = numPositions * mapInCount * maxTiles;
+        const size_t productSize = numPositions * mapOutCount * maxTiles;
+        workspace.Resize(1, kernelSize + inputSize + productSize);
+        ElemType* transformedKernel = workspace.Data();
+        ElemType* transformedInput = transformedKernel + kernelSize;
+        ElemType* product = transformedInput + inputSize;
+
+        // 1. Transform the kernels. cudnn layout uses row-major kernel weight matrix.
+        const ElemType* kernelData = kernel.Data();
+#pragma omp parallel for
+        for (long i = 0; i < (long)(mapOutCount * mapInCount); i++)
+        {
+            const size_t k = i % mapOutCount, c = i / mapOutCount;
+            ElemType g[3][3], u[a][a];
+            for (size_t y = 0; y < 3; y++)
+                for (size_t x = 0; x < 3; x++)
+                    g[y][x] = kernelData[(k * mapInCount + c) * 9 + y * 3 + x];
+            WinogradTransform(Winograd::G, g, u);
+            for (size_t pos = 0; pos < numPositions; pos++)
+                transformedKernel[pos * mapOutCount * mapInCount + i] = u[pos / a][pos % a];
+        }
+
+        for (size_t start = 0; start < batchSize; start += subBatchSize)
+        {
+            size_t curBatchSize = min(subBatchSize, batchSize - start);
+            size_t numTiles = curBatchSize * tilesPerSample;
+
+            // 2. Transform the input tiles, zero outside of the input.
+            const ElemType* inData = in.Data() + start * in.GetNumRows();
+#pragma omp parallel for
+            for (long i = 0; i < (long)(numTiles * mapInCount); i++)
+            {
+                const size_t c = i % mapInCount, tile = i / mapInCount;
+                const size_t sample = tile / tilesPerSample;
+                const int x0 = (int)((tile % tilesW) * m) - padW;
+                const int y0 = (int)((tile % tilesPerSample / tilesW) * m) - padH;
+                const ElemType* map = inData + sample * in.GetNumRows() + c * inW * inH;
+                ElemType d[a][a], v[a][a];
+                for (size_t y = 0; y < a; y++)
+                    for (size_t x = 0; x < a; x++)
+                    {
+                        const int inX = x0 + (int)x, inY = y0 + (int)y;
+                        d[y][x] = inX >= 0 && inX < (int)inW && inY >= 0 && inY < (int)inH ? map[inY * inW + inX] : (ElemType)0;
+                    }
+                WinogradTransform(Winograd::BT, d, v);
+                for (size_t pos = 0; pos < numPositions; pos++)
+                    transformedInput[pos * mapInCount * numTiles + i] = v[pos / a][pos % a];
+            }
+
+            // 3. Multiply, one GEMM per tile position.
+            for (size_t pos = 0; pos < numPositions; pos++)
+            {
+                auto u = workspace.ColumnSlice(pos * mapOutCount * mapInCount, mapOutCount * mapInCount);
+                u.Reshape(mapOutCount, mapInCount);
+                auto v = workspace.ColumnSlice(kernelSize + pos * mapInCount * numTiles, mapInCount * numTiles);
+                v.Reshape(mapInCount, numTiles);
+                auto p = workspace.ColumnSlice(kernelSize + inputSize + pos * mapOutCount * numTiles, mapOutCount * numTiles);
+                p.Reshape(mapOutCount, numTiles);
+                Mat::Multiply(u, false, v, false, p);
+            }
+
+            // 4. Transform the products into the output tiles, clipped to the output.
+            ElemType* outData = out.Data() + start * out.GetNumRows();
+            const ElemType* scale = epilogue ? epilogue->scale : nullptr;
+            const ElemType* shift = epilogue ? epilogue->shift : nullptr;
+            const bool relu = epilogue && epilogue->relu;
+#pragma omp parallel for
+            for (long i = 0; i < (long)(numTiles * mapOutCount); i++)
+            {
+                const size_t k = i % mapOutCount, tile = i / mapOutCount;
+                const size_t sample = tile / tilesPerSample;
+                const size_t x0 = (tile % tilesW) * m;
+                const size_t y0 = (tile % tilesPerSample / tilesW) * m;
+                ElemType* map = outData + sample * out.GetNumRows() + k * outW * outH;
+                ElemType p[a][a], y[m][m];
+                for (size_t pos = 0; pos < numPositions; pos++)
+                    p[pos / a][pos % a] = product[pos * mapOutCount * numTiles + i];
+                WinogradTransform(Winograd::AT, p, y);
+                const ElemType alpha = scale ? scale[k] : (ElemType)1;
+                const ElemType beta = shift ? shift[k] : (ElemType)0;
+                for (size_t dy = 0; dy < m && y0 + dy < outH; dy++)
+                    for (size_t dx = 0; dx < m && x0 + dx < outW; dx++)
+                    {
+                        ElemType val = epilogue ? y[dy][dx] * alpha + beta : y[dy][dx];
+                        map[(y0 + dy) * outW + x0 + dx] = relu && val < (ElemType)0 ? (ElemType)0 : val;
+                    }
+            }
+        }
+    }
+
+public:
+    static bool IsSupported(DEVICEID_TYPE deviceId, ConvolveGeometryPtr geometry, ImageLayoutKind imageLayout, PoolKind poolKind)
+    {
+        if (deviceId >= 0 || imageLayout != ImageLayoutKind::CHW || poolKind != PoolKind::None || geometry->Groups() != 1 ||
+            !Base::IsSupported(deviceId, geometry))
+            return false;
+
+        const auto& inT = geometry->InputShape();
+        const auto& kernT = geometry->KernelShape();
+        const auto& outT = geometry->OutputShape();
+        if (inT.GetRank() != 3 || kernT.GetRank() != 3 || outT.GetRank() != 3)
+            return false;
+        // The kernel covers all input maps, so there is one output per kernel.
+        if (kernT[0] != 3 || kernT[1] != 3 || kernT[2] != inT[2] || outT[2] != geometry->KernelCount() || geometry->GetLowerPad(2) != 0)
+            return false;
+        for (size_t i = 0; i < 2; i++)
+        {
+            if (geometry->GetStride(i) != 1 || geometry->GetDilation(i) != 1)
+                return false;
+        }
+        return true;
+    }
+};
+
+//------------------------------------------------------------------
+// Depthwise convolution engine implementation.
+// This engine computes 2D convolutions in which every input channel is its own group,
+// directly and without unrolling: each output map is the sum of kernel width x height
+// shifted and scaled rows of one input map, so the innermost loops run over the output
+// width in contiguous memory, which the compiler vectorizes. It does not support pooling.
+//------------------------------------------------------------------
+template <class ElemType>
+class DepthwiseConvolutionEngine : public ConvolutionEngine<ElemType>
+{
+public:
+    using Base = ConvolutionEngine<ElemType>;
+    using typename Base::Mat;
+
+public:
+    DepthwiseConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind, bool poolIncludePad)
+        : Base(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad)
+    {
+    }
+
+    // BackwardData() and BackwardKernel() assign their results unless asked to accumulate.
+    bool ImplementsGradientOverwriteOptimization() const override { return true; }
+
+protected:
+    using Base::m_geometry;
+    using Base::m_deviceId;
+    using Base::m_imageLayout;
+    using Base::m_poolKind;
+
+    void EnsureCompatible() override
+    {
+        if (!IsSupported(m_deviceId, m_geometry, m_imageLayout, m_poolKind))
+            LogicError("Depthwise convolution engine supports only 2D convolutions on the CPU with one group per input channel and full sharing. Geometry: %s", ((string)*m_geometry).c_str());
+    }
+
+    void EnsureConvolutionInitialized() override
+    {
+        if (!m_xBegin.empty())
+            return;
+
+        const auto& inT = m_geometry->InputShape();
+        const auto& kernT = m_geometry->KernelShape();
+        const auto& outT = m_geometry->OutputShape();
+        m_inW = inT[0]; m_inH = inT[1]; m_mapInCount = inT[2];
+        m_outW = outT[0]; m_outH = outT[1]; m_mapOutCount = outT[2];
+        m_kernW = kernT[0]; m_kernH = kernT[1];
+        m_strideW = (int)m_geometry->GetStride(0);
+
+        // The input row of each output row and kernel row, -1 where it falls into the padding.
+        m_inY.resize(m_outH * m_kernH);
+        for (size_t y = 0; y < m_outH; y++)
+            for (size_t ky = 0; ky < m_kernH; ky++)
+            {
+                int inY = (int)(y * m_geometry->GetStride(1)) + (int)ky * (int)m_geometry->GetDilation(1) - m_geometry->GetLowerPad(1);
+                m_inY[y * m_kernH + ky] = inY >= 0 && inY < (int)m_inH ? inY : -1;
+            }
+
+        // The range of output columns [m_xBegin, m_xEnd) of each kernel column whose input columns, starting at
+        // m_xOffset, are inside of the input, so no bounds are checked in the inner loops.
+        m_xBegin.resize(m_kernW);
+        m_xEnd.resize(m_kernW);
+        m_xOffset.resize(m_kernW);
+        for (size_t kx = 0; kx < m_kernW; kx++)
+        {
+            const int offset = (int)kx * (int)m_geometry->GetDilation(0) - m_geometry->GetLowerPad(0);
+            const int begin = offset >= 0 ? 0 : (-offset + m_strideW - 1) / m_strideW;
+            const int end = (int)m_inW - offset <= 0 ? 0 : min((int)m_outW, ((int)m_inW - offset - 1) / m_strideW + 1);
+            m_xBegin[kx] = begin;
+            m_xEnd[kx] = max(begin, end);
+            m_xOffset[kx] = offset;
+        }
+    }
+
+    void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& /*workspace*/) override
+    {
+        ForwardDepthwise(in, kernel, out, nullptr);
+    }
+
+    void ForwardFusedCore(const Mat& in, const Mat& kernel, Mat& out, Mat& /*workspace*/, const ConvolutionEpilogue<ElemType>& epilogue) override
+    {
+        ForwardDepthwise(in, kernel, out, &epilogue);
+    }
+
+    // Computes one output map of one sample at a time, row by row, applying the epilogue, if any, while it is in cache.
+    // Output map k is computed from input map k / multiplier with the kernel k. cudnn layout uses row-major kernel weight matrix.
+    void ForwardDepthwise(const Mat& in, const Mat& kernel, Mat& out, const ConvolutionEpilogue<ElemType>* epilogue)
+    {
+        const size_t batchSize = in.GetNumCols();
+        const size_t multiplier = m_mapOutCount / m_mapInCount;
+        const size_t kernelSize = m_kernW * m_kernH;
+        const ElemType* inData = in.Data();
+        const ElemType* kernelData = kernel.Data();
+        ElemType* outData = out.Data();
+        const ElemType* scale = epilogue ? epilogue->scale : nullptr;
+        const ElemType* shift = epilogue ? epilogue->shift : nullptr;
+        const bool relu = epilogue && epilogue->relu;
+
+#pragma omp parallel for
+        for (long i = 0; i < (long)(batchSize * m_mapOutCount); i++)
+        {
+            const size_t k = i % m_mapOutCount, sample = i / m_mapOutCount;
+            const ElemType* map = inData + sample * in.GetNumRows() + (k / multiplier) * m_inW * m_inH;
+            const ElemType* w = kernelData + k * kernelSize;
+            ElemType* dst = outData + sample * out.GetNumRows() + k * m_outW * m_outH;
+            const ElemType alpha = scale ? scale[k] : (ElemType)1;
+            const ElemType beta = shift ? shift[k] : (ElemType)0;
+            for (size_t y = 0; y < m_outH; y++)
+            {
+                ElemType* row = dst + y * m_outW;
+                for (size_t x = 0; x < m_outW; x++)
+                    row[x] = 0;
+                for (size_t ky = 0; ky < m_kernH; ky++)
+                {
+                    const int inY = m_inY[y * m_kernH + ky];
+                    if (inY < 0)
+                        continue;
+                    for (size_t kx = 0; kx < m_kernW; kx++)
+                    {
+                        const ElemType wv = w[ky * m_kernW + kx];
+                        const ElemType* src = map + inY * m_inW + m_xOffset[kx];
+                        if (m_strideW == 1)
+                        {
+                            for (int x = m_xBegin[kx]; x < m_xEnd[kx]; x++)
+                                row[x] += wv * src[x];
+                        }
+                        else
+                        {
+                            for (int x = m_xBegin[kx]; x < m_xEnd[kx]; x++)
+                                row[x] += wv * src[x * m_strideW];
+                        }
+                    }
+                }
+                if (epilogue)
+                {
+                    for (size_t x = 0; x < m_outW; x++)
+                    {
+                        ElemType val = row[x] * alpha + beta;
+                        row[x] = relu && val < (ElemType)0 ? (ElemType)0 : val;
+                    }
+                }
+            }
+        }
+    }
+
+    // Each input map gets the gradients of its 'multiplier' output maps, scattered back through the kernel,
+    // so the input maps can be computed in parallel.
+    void BackwardDataCore(const Mat& srcGrad, const Mat& kernel, Mat& grad, bool accumulateGradient, Mat& /*workspace*/) override
+    {
+        const size_t batchSize = srcGrad.GetNumCols();
+        const size_t multiplier = m_mapOutCount / m_mapInCount;
+        const size_t kernelSize = m_kernW * m_kernH;
+        const ElemType* srcGradData = srcGrad.Data();
+        const ElemType* kernelData = kernel.Data();
+        ElemType* gradData = grad.Data();
+
+#pragma omp parallel for
+        for (long i = 0; i < (long)(batchSize * m_mapInCount); i++)
+        {
+            const size_t c = i % m_mapInCount, sample = i / m_mapInCount;
+            ElemType* map = gradData + sample * grad.GetNumRows() + c * m_inW * m_inH;
+            if (!accumulateGradient)
+            {
+                for (size_t j = 0; j < m_inW * m_inH; j++)
+                    map[j] = 0;
+            }
+            for (size_t k = c * multiplier; k < (c + 1) * multiplier; k++)
+            {
+                const ElemType* src = srcGradData + sample * srcGrad.GetNumRows() + k * m_outW * m_outH;
+                const ElemType* w = kernelData + k * kernelSize;
+                for (size_t y = 0; y < m_outH; y++)
+                {
+                    const ElemType* row = src + y * m_outW;
+                    for (size_t ky = 0; ky < m_kernH; ky++)
+                    {
+                        const int inY = m_inY[y * m_kernH + ky];
+                        if (inY < 0)
+                            continue;
+                        for (size_t kx = 0; kx < m_kernW; kx++)
+                        {
+                            const ElemType wv = w[ky * m_kernW + kx];
+                            ElemType* dst = map + inY * m_inW + m_xOffset[kx];
+                            if (m_strideW == 1)
+                            {
+                                for (int x = m_xBegin[kx]; x < m_xEnd[kx]; x++)
+                                    dst[x] += wv * row[x];
+                            }
+                            else
+                            {
+                                for (int x = m_xBegin[kx]; x < m_xEnd[kx]; x++)
+                                    dst[x * m_strideW] += wv * row[x];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Each kernel is the sum over the minibatch of the products of its output map gradients with its input map,
+    // so the kernels can be computed in parallel.
+    void BackwardKernelCore(const Mat& srcGrad, const Mat& in, Mat& kernelGrad, bool accumulateGradient, bool /*allowReuse*/, Mat& /*workspace*/) override
+    {
+        const size_t batchSize = srcGrad.GetNumCols();
+        const size_t multiplier = m_mapOutCount / m_mapInCount;
+        const size_t kernelSize = m_kernW * m_kernH;
+        const ElemType* srcGradData = srcGrad.Data();
+        const ElemType* inData = in.Data();
+        ElemType* kernelGradData = kernelGrad.Data();
+
+#pragma omp parallel for
+        for (long k = 0; k < (long)m_mapOutCount; k++)
+        {
+            ElemType* w = kernelGradData + k * kernelSize;
+            if (!accumulateGradient)
+            {
+                for (size_t j = 0; j < kernelSize; j++)
+                    w[j] = 0;
+            }
+            for (size_t sample = 0; sample < batchSize; sample++)
+            {
+                const ElemType* src = srcGradData + sample * srcGrad.GetNumRows() + k * m_outW * m_outH;
+                const ElemType* map = inData + sample * in.GetNumRows() + (k / multiplier) * m_inW * m_inH;
+                for (size_t y = 0; y < m_outH; y++)
+                {
+                    const ElemType* row = src + y * m_outW;
+                    for (size_t ky = 0; ky < m_kernH; ky++)
+                    {
+                        const int inY = m_inY[y * m_kernH + ky];
+                        if (inY < 0)
+                            continue;
+                        for (size_t kx = 0; kx < m_kernW; kx++)
+                        {
+                            const ElemType* inRow = map + inY * m_inW + m_xOffset[kx];
+                            ElemType sum = 0;
+                            if (m_strideW == 1)
+                            {
+                                for (int x = m_xBegin[kx]; x < m_xEnd[kx]; x++)
+                                    sum += row[x] * inRow[x];
+                            }
+                            else
+                            {
+                                for (int x = m_xBegin[kx]; x < m_xEnd[kx]; x++)
+                                    sum += row[x] * inRow[x * m_strideW];
+                            }
+                            w[ky * m_kernW + kx] += sum;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void EnsurePoolingInitialized() override
+    {
+    }
+
+    void ForwardPoolingCore(const Mat& /*in*/, Mat& /*out*/) override
+    {
+        LogicError("Depthwise convolution engine does not support pooling.");
+    }
+
+    void BackwardPoolingCore(const Mat& /*out*/, const Mat& /*srcGrad*/, const Mat& /*in*/, Mat& /*grad*/, bool /*accumulateGradient*/) override
+    {
+        LogicError("Depthwise convolution engine does not support pooling.");
+    }
+
+    void MaxUnpoolingCore(const Mat& /*out*/, const Mat& /*poolIn*/, Mat& /*in*/) override
+    {
+        LogicError("Depthwise convolution engine does not support pooling.");
+    }
+
+public:
+    static bool IsSupported(DEVICEID_TYPE deviceId, ConvolveGeometryPtr geometry, ImageLayoutKind imageLayout, PoolKind poolKind)
+    {
+        if (deviceId >= 0 || imageLayout != ImageLayoutKind::CHW || poolKind != PoolKind::None || !geometry->IsDepthwise() ||
+            find(begin(geometry->Sharing()), end(geometry->Sharing()), false) != end(geometry->Sharing()))
+            return false;
+
+        const auto& inT = geometry->InputShape();
+        const auto& kernT = geometry->KernelShape();
+        const auto& outT = geometry->OutputShape();
+        if (inT.GetRank() != 3 || kernT.GetRank() != 3 || outT.GetRank() != 3)
+            return false;
+        // Every output map belongs to one input map, and there may be several of them per input map.
+        return kernT[2] == 1 && outT[2] == geometry->KernelCount() && outT[2] % inT[2] == 0;
+    }
+
+private:
+    size_t m_inW, m_inH, m_mapInCount;
+    size_t m_outW, m_outH, m_mapOutCount;
+    size_t m_kernW, m_kernH;
+    int m_strideW;
+    std::vector<int> m_inY;
+    std::vector<int> m_xBegin;
+    std::vector<int> m_xEnd;
+    std::vector<int> m_xOffset;
+};
+
 template <class ElemType>
 std::unique_ptr<ConvolutionEngine<ElemType>> ConvolutionEngine<ElemType>::Create(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId,
                                                                                  ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind,
@@ -1166,11 +1882,22 @@ std::unique_ptr<ConvolutionEngine<ElemType>> ConvolutionEngine<ElemType>::Create
     // can be called from places like MEL with default parameters and never be used.
     // The check will be done later in engine's EnsureCompatible call if the egnine is actually used.
     auto engStr = (std::string)(*geometry);
-    // Only legacy engine supports HWC layout.
+    // HWC layout is supported by the legacy engine and, as channels-last (NHWC) layout, by the cuDNN engine.
+    // They store kernels differently, so cuDNN is only used when the legacy engine is disabled, which the
+    // nodes do for everything but the legacy 2D convolution syntax.
     if (imageLayout == ImageLayoutKind::HWC)
     {
         if (!isEnabled(ConvolutionEngineKind::Legacy))
-            RuntimeError("Trying to use Legacy convolution engine when it's disabled.");
+        {
+            if (!isEnabled(ConvolutionEngineKind::CuDnn) || !CuDnnConvolutionEngineFactory<ElemType>::IsSupported(deviceId, geometry, poolKind))
+                RuntimeError("HWC layout requires the legacy convolution engine or, on a GPU, the cuDNN engine, and neither can be used for geometry: %s.", engStr.c_str());
+
+            if (GetMathLibTraceLevel() > 0)
+                fprintf(stderr, "%lsusing cuDNN convolution engine with HWC layout for geometry: %s.\n", logPrefix.c_str(), engStr.c_str());
+
+            return CuDnnConvolutionEngineFactory<ElemType>::Create(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind,
+                                                                   forceDeterministicAlgorithms, poolIncludePad, inputHasFreeDimension);
+        }
 
         if (GetMathLibTraceLevel() > 0)
             fprintf(stderr, "%lsusing legacy convolution engine for geometry: %s.\n", logPrefix.c_str(), engStr.c_str());
@@ -1191,6 +1918,14 @@ std::unique_ptr<ConvolutionEngine<ElemType>> ConvolutionEngine<ElemType>::Create
 
     if (geometry->Groups() == 1)
     {
+        if (isEnabled(ConvolutionEngineKind::Winograd) && WinogradConvolutionEngine<ElemType>::IsSupported(deviceId, geometry, imageLayout, poolKind))
+        {
+            if (GetMathLibTraceLevel() > 0)
+                fprintf(stderr, "%lsusing Winograd convolution engine for geometry: %s.\n", logPrefix.c_str(), engStr.c_str());
+
+            return std::make_unique<WinogradConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad);
+        }
+
         if (isEnabled(ConvolutionEngineKind::Gemm) && GemmConvolutionEngine<ElemType>::IsSupported(deviceId, geometry))
         {
             if (GetMathLibTraceLevel() > 0)
@@ -1209,6 +1944,14 @@ std::unique_ptr<ConvolutionEngine<ElemType>> ConvolutionEngine<ElemType>::Create
     }
     else if (geometry->Groups() > 1)
     {
+        if (isEnabled(ConvolutionEngineKind::Depthwise) && DepthwiseConvolutionEngine<ElemType>::IsSupported(deviceId, geometry, imageLayout, poolKind))
+        {
+            if (GetMathLibTraceLevel() > 0)
+                fprintf(stderr, "%lsusing depthwise convolution engine for geometry: %s.\n", logPrefix.c_str(), engStr.c_str());
+
+            return std::make_unique<DepthwiseConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad);
+        }
+
         if (!(geometry->InputShape().GetRank() < 4))
         {
             RuntimeError("Group convolution, i.e. groups > 1, for 3-dimensional convolution or higher is not supported on the CPU. Please use GPU, if possible.");
@@ -1231,9 +1974,9 @@ std::unique_ptr<ConvolutionEngine<ElemType>> ConvolutionEngine<ElemType>::Create
         LogicError("Invalid value for 'groups' parameter for convolution: groups must be greater than or equal to 1.");
 }
 
-// only GPU supports fp16 convolution
-template <>
-std::unique_ptr<ConvolutionEngine<half>> ConvolutionEngine<half>::Create(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId,
+// only GPU supports 16-bit convolution
+template <class ElemType>
+static std::unique_ptr<ConvolutionEngine<ElemType>> CreateCuDnnOnly(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId,
     ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind,
     ConvolutionEngineKind enabledEngines, std::wstring logPrefix,
     bool forceDeterministicAlgorithms, bool poolIncludePad,
@@ -1250,22 +1993,45 @@ std::unique_ptr<ConvolutionEngine<half>> ConvolutionEngine<half>::Create(Convolv
 
     // Check if we can use cuDNN engine. Do not need to validate tensors as ConvolveGeometry has already done that.
     if (isEnabled(ConvolutionEngineKind::CuDnn) &&
-        CuDnnConvolutionEngineFactory<half>::IsSupported(deviceId, geometry, poolKind))
+        CuDnnConvolutionEngineFactory<ElemType>::IsSupported(deviceId, geometry, poolKind))
     {
         if (GetMathLibTraceLevel() > 0)
             fprintf(stderr, "%lsusing cuDNN convolution engine for geometry: %s.\n", logPrefix.c_str(), engStr.c_str());
 
-        return CuDnnConvolutionEngineFactory<half>::Create(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind,
+        return CuDnnConvolutionEngineFactory<ElemType>::Create(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind,
             forceDeterministicAlgorithms, poolIncludePad, inputHasFreeDimension);
     }
 
-    RuntimeError("FP16 convolution is only supported via cuDNN.");
+    RuntimeError("%s convolution is only supported via cuDNN.", std::is_same<ElemType, half>::value ? "FP16" : "BFloat16");
 
     return nullptr;
 }
 
+template <>
+std::unique_ptr<ConvolutionEngine<half>> ConvolutionEngine<half>::Create(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId,
+    ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind,
+    ConvolutionEngineKind enabledEngines, std::wstring logPrefix,
+    bool forceDeterministicAlgorithms, bool poolIncludePad,
+    bool inputHasFreeDimension)
+{
+    return CreateCuDnnOnly<half>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, enabledEngines, logPrefix,
+                                 forceDeterministicAlgorithms, poolIncludePad, inputHasFreeDimension);
+}
+
+template <>
+std::unique_ptr<ConvolutionEngine<bfloat16>> ConvolutionEngine<bfloat16>::Create(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId,
+    ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind,
+    ConvolutionEngineKind enabledEngines, std::wstring logPrefix,
+    bool forceDeterministicAlgorithms, bool poolIncludePad,
+    bool inputHasFreeDimension)
+{
+    return CreateCuDnnOnly<bfloat16>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, enabledEngines, logPrefix,
+                                     forceDeterministicAlgorithms, poolIncludePad, inputHasFreeDimension);
+}
+
 template class ConvolutionEngine<float>;
 template class ConvolutionEngine<double>;
 template class ConvolutionEngine<half>;
+template class ConvolutionEngine<bfloat16>;
 
 }}}
@@ -22,8 +22,10 @@ enum class ConvolutionEngineKind
     CuDnn     = 1 << 1, // cuDNN, works only for 2D/3D convos with full sharing.
     Legacy    = 1 << 2, // Legacy, for backwards compatibility. REVIEW alexeyk: implement sparse version and remove Legacy altogether.
     Gemm      = 1 << 3, // Uses convolution unrolling+GEMM technique. Works only for convos with full sharing.
+    Winograd  = 1 << 4, // Winograd minimal filtering, CPU only. Works only for 2D convos with 3x3 kernels, stride 1 and full sharing.
+    Depthwise = 1 << 5, // Direct depthwise convolution, CPU only. Works only for 2D convos with one group per input channel and full sharing.
 
-    All       = Reference | CuDnn | Legacy | Gemm
+    All       = Reference | CuDnn | Legacy | Gemm | Winograd | Depthwise
 };
 
 enum class PoolKind
@@ -33,6 +35,17 @@ enum class PoolKind
     Average
 };
 
+// Transform of the result of a convolution per output map k that ForwardFused() applies while the result is still in cache:
+//   out = out * scale[k] + shift[k], followed by max(0, out) if 'relu'.
+// This folds a following bias, inference-mode batch normalization and ReLU into the convolution.
+template <class ElemType>
+struct ConvolutionEpilogue
+{
+    const ElemType* scale = nullptr; // one per output map, in CPU memory; nullptr for 1
+    const ElemType* shift = nullptr; // one per output map, in CPU memory; nullptr for 0
+    bool relu = false;
+};
+
 #pragma warning(push)
 #pragma warning(disable : 4251)
 
@@ -47,6 +60,9 @@ public:
 
     void Forward(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace);
 
+    // Forward() followed by the epilogue. CPU only.
+    void ForwardFused(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace, const ConvolutionEpilogue<ElemType>& epilogue);
+
     void BackwardData(const Mat& srcGrad, const Mat& kernel, Mat& grad, bool accumulateGradient, Mat& workspace);
 
     void BackwardKernel(const Mat& srcGrad, const Mat& in, Mat& kernelGrad, bool accumulateGradient, bool allowReuse, Mat& workspace);
@@ -88,6 +104,16 @@ protected:
 
     virtual void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace) = 0;
 
+    // Engines that can apply the epilogue as part of the convolution override this. By default it is applied to 'out' afterwards.
+    virtual void ForwardFusedCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace, const ConvolutionEpilogue<ElemType>& epilogue)
+    {
+        ForwardCore(in, kernel, out, workspace);
+        ApplyEpilogue(out, epilogue);
+    }
+
+    // Applies the epilogue to the convolution outputs 'out' (columns), which must be dense and in CPU memory.
+    void ApplyEpilogue(Mat& out, const ConvolutionEpilogue<ElemType>& epilogue) const;
+
     virtual void BackwardDataCore(const Mat& srcGrad, const Mat& kernel, Mat& grad, bool accumulateGradient, Mat& workspace) = 0;
 
     virtual void BackwardKernelCore(const Mat& srcGrad, const Mat& in, Mat& kernelGrad, bool accumulateGradient, bool allowReuse, Mat& workspace) = 0;
@@ -39,6 +39,12 @@ public:
     const TensorShape& UpperPad() const { return m_upperPad; }
     size_t Groups() const { return m_groups; }
 
+    // A depthwise convolution has one group per input channel, so each output map is computed from a single input map.
+    bool IsDepthwise() const
+    {
+        return m_groups > 1 && m_groups == m_inputShape[m_inputShape.GetRank() - 1];
+    }
+
     // Maps from a "row" (index of output cell) to its base "col" (index of input cell). For a given row,
     // the cols that contribute to it are { MpRowCol[row] + Indices[i0 + 1 + i] | 0 <= i < Indices[i0] },
     // where i0 = MpRowIndices[row].
@@ -0,0 +1,128 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "Basics.h"
+#include "CuDnnAlgorithmCache.h"
+#include <stdio.h>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// The entries are lines "<key>\t<algo>\t<mathType>\t<workspaceSize>\n". Lines without the final newline, e.g. the
+// one another process is appending right now, are skipped, as are lines starting with '#'.
+static const char* const s_fileHeader = "# CNTK cuDNN convolution algorithm cache: key, algorithm, math type, workspace bytes\n";
+
+static std::mutex s_mutex;
+static std::wstring s_path;
+static bool s_writable = false;
+static bool s_tune = true;
+static std::map<std::string, CuDnnAlgorithmCache::Entry> s_entries;
+
+// reads the entries of the file into s_entries, call with s_mutex held
+static void LoadEntries()
+{
+    FILE* f = _wfopen(s_path.c_str(), L"rb");
+    if (!f)
+        return; // not written yet
+    std::string contents;
+    std::vector<char> buffer(65536);
+    size_t n;
+    while ((n = fread(buffer.data(), 1, buffer.size(), f)) > 0)
+        contents.append(buffer.data(), n);
+    fclose(f);
+
+    size_t begin = 0, end;
+    while ((end = contents.find('\n', begin)) != std::string::npos)
+    {
+        std::string line = contents.substr(begin, end - begin);
+        begin = end + 1;
+        if (line.empty() || line[0] == '#')
+            continue;
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos || tab == 0)
+            continue;
+        CuDnnAlgorithmCache::Entry entry;
+        unsigned long long workspaceSize;
+        if (sscanf(line.c_str() + tab + 1, "%d\t%d\t%llu", &entry.algo, &entry.mathType, &workspaceSize) != 3)
+            continue;
+        entry.workspaceSize = (size_t)workspaceSize;
+        s_entries[line.substr(0, tab)] = entry;
+    }
+}
+
+/*static*/ void CuDnnAlgorithmCache::Set(const std::wstring& path, bool writable, bool tune)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_path = path;
+    s_writable = writable;
+    s_tune = path.empty() || tune;
+    s_entries.clear();
+    if (!path.empty())
+        LoadEntries();
+}
+
+/*static*/ bool CuDnnAlgorithmCache::IsEnabled()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return !s_path.empty();
+}
+
+/*static*/ bool CuDnnAlgorithmCache::ShouldTune()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return s_tune;
+}
+
+/*static*/ bool CuDnnAlgorithmCache::Lookup(const std::string& key, Entry& entry)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (s_path.empty())
+        return false;
+    auto iter = s_entries.find(key);
+    if (iter == s_entries.end())
+    {
+        // another process may have tuned it meanwhile
+        LoadEntries();
+        iter = s_entries.find(key);
+        if (iter == s_entries.end())
+            return false;
+    }
+    entry = iter->second;
+    return true;
+}
+
+/*static*/ void CuDnnAlgorithmCache::Insert(const std::string& key, const Entry& entry)
+{
+    if (key.empty() || key.find_first_of("\t\n") != std::string::npos)
+        LogicError("CuDnnAlgorithmCache: Invalid key '%s'.", key.c_str());
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (s_path.empty())
+        return;
+    s_entries[key] = entry;
+    if (!s_writable)
+        return;
+
+    FILE* f = _wfopen(s_path.c_str(), L"ab");
+    if (!f)
+    {
+        fprintf(stderr, "WARNING: Cannot write the cuDNN algorithm cache '%ls', further entries are kept in memory only.\n", s_path.c_str());
+        s_writable = false;
+        return;
+    }
+    // one write per line, so that appends of several processes do not interleave within a line
+    fseek(f, 0, SEEK_END);
+    std::string line = ftell(f) == 0 ? s_fileHeader : "";
+    char values[64];
+    sprintf(values, "\t%d\t%d\t%llu\n", entry.algo, entry.mathType, (unsigned long long)entry.workspaceSize);
+    line += key + values;
+    fwrite(line.data(), 1, line.size(), f);
+    fclose(f);
+}
+
+}}}
@@ -0,0 +1,64 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CuDnnAlgorithmCache.h -- persistent cache of the convolution algorithms picked by the cuDNN autotuner
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+#ifdef _WIN32
+#ifndef MATH_API
+#ifdef MATH_EXPORTS
+#define MATH_API __declspec(dllexport)
+#else
+#define MATH_API __declspec(dllimport)
+#endif
+#endif /* MATH_API */
+#else  // no DLLs in Linux
+#define MATH_API
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// CuDnnAlgorithmCache -- the results of cudnnFindConvolution*AlgorithmEx(), kept in a file across processes.
+//
+// The cuDNN convolution engine benchmarks the algorithms of every new geometry and minibatch size. With a cache
+// file, the winner is recorded under a key made of the GPU model, the cuDNN version, the data type, the direction,
+// the geometry, the minibatch size and the workspace limit (see CuDnnConvolutionEngine), so that a restarted
+// process, or another worker of the same job, can take it instead of benchmarking again.
+//
+// The file is a text file with one entry per line, which is appended to as entries are found. Several processes
+// may share it; typically only one of them (e.g. MPI rank 0) writes, and the others read what it has found so far.
+// Lookup() rereads the file on a miss, so that the others pick up entries that were appended in the meantime.
+//
+// Without tuning, the engine takes a cache miss as the signal to use the heuristics of cudnnGet*Algorithm*
+// instead of benchmarking, i.e. it trusts that the cache covers everything that is worth tuning.
+// -----------------------------------------------------------------------
+
+class MATH_API CuDnnAlgorithmCache
+{
+public:
+    struct Entry
+    {
+        int algo;             // cudnnConvolution*Algo_t
+        int mathType;         // cudnnMathType_t
+        size_t workspaceSize; // in bytes
+    };
+
+    // Loads the given file, if it exists. An empty path disables the cache.
+    // 'writable': append newly tuned entries to the file. 'tune': benchmark geometries that are not in the cache.
+    static void Set(const std::wstring& path, bool writable = true, bool tune = true);
+
+    static bool IsEnabled();
+    static bool ShouldTune();
+
+    static bool Lookup(const std::string& key, Entry& entry);
+    static void Insert(const std::string& key, const Entry& entry);
+};
+
+}}}
@@ -21,13 +21,29 @@ public:
 
 public:
     CuDnnBatchNormEngine(DEVICEID_TYPE deviceId, const TensorShape& inOutT,
-                        bool spatial, ImageLayoutKind imageLayout)
-                        : Base(deviceId, inOutT, spatial, imageLayout),
+                        bool spatial, ImageLayoutKind imageLayout, bool reluOutput)
+                        : Base(deviceId, inOutT, spatial, imageLayout, reluOutput),
                         m_cudnn(CuDnn::Instance()),
-                        m_inOutCuDnnT(GetInOutTensor(inOutT), CuDnnTensor::GetDataType<InoutType>()),
-                        m_scaleBiasCuDnnT(GetScaleBiasTensor(inOutT, spatial), CuDnnTensor::GetDataType<StatType>()),
-                        m_cudnnEpsilon(CUDNN_BN_MIN_EPSILON)
+                        m_inOutCuDnnT(GetInOutTensor(inOutT, spatial, imageLayout), CuDnnTensor::GetDataType<InoutType>(), GetTensorLayout(spatial, imageLayout)),
+                        m_scaleBiasCuDnnT(GetScaleBiasTensor(inOutT, spatial, imageLayout), CuDnnTensor::GetDataType<StatType>()),
+                        m_cudnnEpsilon(CUDNN_BN_MIN_EPSILON),
+                        m_relu(nullptr),
+                        m_workspace(deviceId),
+                        m_reserveSpace(deviceId),
+                        m_reserveSpaceSize(0),
+                        m_maskedGrad(deviceId)
     {
+        if (reluOutput)
+        {
+            CUDNN_CALL(cudnnCreateActivationDescriptor(&m_relu));
+            CUDNN_CALL(cudnnSetActivationDescriptor(m_relu, CUDNN_ACTIVATION_RELU, CUDNN_NOT_PROPAGATE_NAN, 0));
+        }
+    }
+
+    ~CuDnnBatchNormEngine()
+    {
+        if (m_relu != nullptr)
+            cudnnDestroyActivationDescriptor(m_relu);
     }
 
 protected:
@@ -35,11 +51,10 @@ protected:
     using Base::m_imageLayout;
     using Base::m_inOutT;
     using Base::m_spatial;
+    using Base::m_reluOutput;
 
     void EnsureCompatible() override
     {
-        if (m_spatial && m_imageLayout == ImageLayoutKind::HWC)
-            InvalidArgument("cuDNN batch normalization supports only cudnn(CHW) layout.");
         if (m_inOutT.GetRank() > 4)
             InvalidArgument("cuDNN batch normalization supports tensors of max 4 dimensions.");
     }
@@ -71,20 +86,63 @@ protected:
         {
             savedMean.Resize(runMean);
             savedInvStdDev.Resize(runMean);
+#if CUDNN_VERSION >= 7401
+            if (FusesRelu())
+            {
+                // the reserve space passes what the fused activation needs on to the backward pass
+                size_t workspaceSize;
+                CUDNN_CALL(cudnnGetBatchNormalizationForwardTrainingExWorkspaceSize(*m_cudnn, mode, CUDNN_BATCHNORM_OPS_BN_ACTIVATION, m_inOutCuDnnT, nullptr, m_inOutCuDnnT,
+                                                                                    m_scaleBiasCuDnnT, m_relu, &workspaceSize));
+                CUDNN_CALL(cudnnGetBatchNormalizationTrainingExReserveSpaceSize(*m_cudnn, mode, CUDNN_BATCHNORM_OPS_BN_ACTIVATION, m_relu, m_inOutCuDnnT, &m_reserveSpaceSize));
+                CUDNN_CALL(cudnnBatchNormalizationForwardTrainingEx(*m_cudnn, mode, CUDNN_BATCHNORM_OPS_BN_ACTIVATION, &C::One, &C::Zero, m_inOutCuDnnT, ptr(in),
+                                                                    nullptr, nullptr, m_inOutCuDnnT, ptr(out), m_scaleBiasCuDnnT, ptr(scale), ptr(bias),
+                                                                    expAvgFactor, ptr(runMean), ptr(runVariance), m_cudnnEpsilon, ptr(savedMean), ptr(savedInvStdDev),
+                                                                    m_relu, Buffer(m_workspace, workspaceSize), workspaceSize,
+                                                                    Buffer(m_reserveSpace, m_reserveSpaceSize), m_reserveSpaceSize));
+                return;
+            }
+#endif
             CUDNN_CALL(cudnnBatchNormalizationForwardTraining(*m_cudnn, mode, &C::One, &C::Zero, m_inOutCuDnnT, ptr(in),
                                                               m_inOutCuDnnT, ptr(out), m_scaleBiasCuDnnT, ptr(scale), ptr(bias), expAvgFactor, ptr(runMean), ptr(runVariance),
                                                               m_cudnnEpsilon, ptr(savedMean), ptr(savedInvStdDev)));
         }
+
+        // the ReLU in place, where cuDNN does not fuse it
+        if (m_reluOutput)
+            CUDNN_CALL(cudnnActivationForward(*m_cudnn, m_relu, &C::One, m_inOutCuDnnT, ptr(out), &C::Zero, m_inOutCuDnnT, ptr(out)));
     }
 
     void BackwardCore(const InoutMat& in, const InoutMat& srcGrad, InoutMat& grad, const StatMat& scale, double blendFactor, const StatMat& savedMean, const StatMat& savedInvStdDev,
-                      StatMat& scaleGrad, StatMat& biasGrad, bool accumulateDataGrad) override
+                      StatMat& scaleGrad, StatMat& biasGrad, bool accumulateDataGrad, const StatMat* bias, const InoutMat* out) override
     {
         UNUSED(blendFactor);  // BUGBUG: It should be used.
+        UNUSED(bias);
         m_inOutCuDnnT.UpdateBatchSize(srcGrad.GetNumCols());
         cudnnBatchNormMode_t mode = m_spatial ? CUDNN_BATCHNORM_SPATIAL_PERSISTENT : CUDNN_BATCHNORM_PER_ACTIVATION;
+#if CUDNN_VERSION >= 7401
+        if (FusesRelu())
+        {
+            size_t workspaceSize;
+            CUDNN_CALL(cudnnGetBatchNormalizationBackwardExWorkspaceSize(*m_cudnn, mode, CUDNN_BATCHNORM_OPS_BN_ACTIVATION, m_inOutCuDnnT, m_inOutCuDnnT, m_inOutCuDnnT,
+                                                                         nullptr, m_inOutCuDnnT, m_scaleBiasCuDnnT, m_relu, &workspaceSize));
+            CUDNN_CALL(cudnnBatchNormalizationBackwardEx(*m_cudnn, mode, CUDNN_BATCHNORM_OPS_BN_ACTIVATION, &C::One, accumulateDataGrad ? &C::One : &C::Zero, &C::One, &C::Zero,
+                                                         m_inOutCuDnnT, ptr(in), m_inOutCuDnnT, ptr(*out), m_inOutCuDnnT, ptr(srcGrad), nullptr, nullptr, m_inOutCuDnnT, ptr(grad),
+                                                         m_scaleBiasCuDnnT, ptr(scale), ptr(*bias), ptr(scaleGrad), ptr(biasGrad), m_cudnnEpsilon, ptr(savedMean), ptr(savedInvStdDev),
+                                                         m_relu, Buffer(m_workspace, workspaceSize), workspaceSize, ptr(m_reserveSpace), m_reserveSpaceSize));
+            return;
+        }
+#endif
+        // where cuDNN does not fuse the ReLU, mask the gradient with its derivative first
+        const InoutMat* dy = &srcGrad;
+        if (out)
+        {
+            m_maskedGrad.Resize(srcGrad);
+            CUDNN_CALL(cudnnActivationBackward(*m_cudnn, m_relu, &C::One, m_inOutCuDnnT, ptr(*out), m_inOutCuDnnT, ptr(srcGrad), m_inOutCuDnnT, ptr(*out),
+                                               &C::Zero, m_inOutCuDnnT, ptr(m_maskedGrad)));
+            dy = &m_maskedGrad;
+        }
         // REVIEW alexeyk: change betaParamDiff to 1 and update CNTK BN engine.
-        CUDNN_CALL(cudnnBatchNormalizationBackward(*m_cudnn, mode, &C::One, accumulateDataGrad ? &C::One : &C::Zero, &C::One, &C::Zero, m_inOutCuDnnT, ptr(in), m_inOutCuDnnT, ptr(srcGrad), m_inOutCuDnnT, ptr(grad),
+        CUDNN_CALL(cudnnBatchNormalizationBackward(*m_cudnn, mode, &C::One, accumulateDataGrad ? &C::One : &C::Zero, &C::One, &C::Zero, m_inOutCuDnnT, ptr(in), m_inOutCuDnnT, ptr(*dy), m_inOutCuDnnT, ptr(grad),
                                                    m_scaleBiasCuDnnT, ptr(scale), ptr(scaleGrad), ptr(biasGrad), m_cudnnEpsilon, ptr(savedMean), ptr(savedInvStdDev)));
     }
 
@@ -101,27 +159,61 @@ private:
         return src.Data();
     }
 
-    static TensorShape GetInOutTensor(const TensorShape& inOutT)
+    // grows a scratch buffer to at least 'bytes'
+    static void* Buffer(InoutMat& buffer, size_t bytes)
     {
+        size_t numElements = std::max((bytes + sizeof(InoutType) - 1) / sizeof(InoutType), (size_t)1);
+        if (buffer.GetNumElements() < numElements)
+            buffer.Resize(numElements, 1);
+        return buffer.Data();
+    }
+
+    // cuDNN fuses the activation only into the persistent spatial mode, for NHWC half tensors with a multiple of 4 channels.
+    // Otherwise the ReLU is a separate cuDNN call.
+    bool FusesRelu() const
+    {
+        return m_reluOutput && m_spatial && GetTensorLayout(m_spatial, m_imageLayout) == ImageLayoutKind::HWC &&
+               std::is_same<InoutType, half>::value && m_inOutT.GetRank() > 1 && (m_inOutT[0] % 4) == 0;
+    }
+
+    // Spatial normalization of the HWC layout normalizes over the channels stored first, which the tensors
+    // describe with the channels last and NHWC strides. Per-activation normalization does not depend on the layout.
+    static ImageLayoutKind GetTensorLayout(bool spatial, ImageLayoutKind imageLayout)
+    {
+        return spatial ? imageLayout : ImageLayoutKind::CHW;
+    }
+
+    static TensorShape GetInOutTensor(const TensorShape& inOutT, bool spatial, ImageLayoutKind imageLayout)
+    {
+        TensorShape t = inOutT;
+        if (GetTensorLayout(spatial, imageLayout) == ImageLayoutKind::HWC && t.GetRank() > 1)
+        {
+            SmallVector<size_t> dims(t.GetRank());
+            for (size_t i = 1; i < t.GetRank(); i++)
+                dims[i - 1] = t[i];
+            dims[t.GetRank() - 1] = t[0];
+            t = TensorShape(dims);
+        }
+
         // cuDNN supports only 3D and 4D tensors (in cuDNN docs it's 4D and 5D dues to N dimension)
         // even for non-spatial inputs so expand the tensor if needed.
-        if (inOutT.GetRank() > 2)
-            return inOutT;
+        if (t.GetRank() > 2)
+            return t;
 
         const size_t outRank = 3;
-        SmallVector<size_t> v(std::max(inOutT.GetRank(), outRank), 1);
-        for (size_t i = outRank - inOutT.GetRank(), j = 0; i < outRank; i++, j++)
-            v[i] = inOutT[j];
+        SmallVector<size_t> v(std::max(t.GetRank(), outRank), 1);
+        for (size_t i = outRank - t.GetRank(), j = 0; i < outRank; i++, j++)
+            v[i] = t[j];
 
         return TensorShape(v);
     }
 
-    static TensorShape GetScaleBiasTensor(const TensorShape& inOutT, bool spatial)
+    static TensorShape GetScaleBiasTensor(const TensorShape& inOutT, bool spatial, ImageLayoutKind imageLayout)
     {
         if (!spatial)
-            return GetInOutTensor(inOutT);
+            return GetInOutTensor(inOutT, spatial, imageLayout);
 
-        const auto& t = GetInOutTensor(inOutT);
+        const auto& t = GetInOutTensor(inOutT, spatial, imageLayout);
         SmallVector<size_t> v(t.GetRank(), 1);
         v[v.size() - 1] = t[t.GetRank() - 1];
         return TensorShape(v);
@@ -134,22 +226,31 @@ private:
     CuDnnTensor m_inOutCuDnnT;
     CuDnnTensor m_scaleBiasCuDnnT;
     double m_cudnnEpsilon;
+
+    // with m_reluOutput
+    cudnnActivationDescriptor_t m_relu;
+    InoutMat m_workspace;
+    InoutMat m_reserveSpace; // from the fused forward pass to its backward pass
+    size_t m_reserveSpaceSize;
+    InoutMat m_maskedGrad;
 };
 
 template class CuDnnBatchNormEngine<float, float>;
 template class CuDnnBatchNormEngine<double, double>;
 template class CuDnnBatchNormEngine<half, float>;
+template class CuDnnBatchNormEngine<bfloat16, float>;
 
 template <typename InoutType, typename StatType>
 std::unique_ptr<BatchNormEngine<InoutType, StatType>> CuDnnBatchNormEngineFactory<InoutType, StatType>::Create(DEVICEID_TYPE deviceId, const TensorShape& inOutT,
-                                                                                         bool spatial, ImageLayoutKind imageLayout)
+                                                                                         bool spatial, ImageLayoutKind imageLayout, bool reluOutput)
 {
-    return std::make_unique<CuDnnBatchNormEngine<InoutType, StatType>>(deviceId, inOutT, spatial, imageLayout);
+    return std::make_unique<CuDnnBatchNormEngine<InoutType, StatType>>(deviceId, inOutT, spatial, imageLayout, reluOutput);
 }
 
 template class CuDnnBatchNormEngineFactory<float, float>;
 template class CuDnnBatchNormEngineFactory<double, double>;
 template class CuDnnBatchNormEngineFactory<half, float>;
+template class CuDnnBatchNormEngineFactory<bfloat16, float>;
 
 CudaTimer::~CudaTimer()
 {
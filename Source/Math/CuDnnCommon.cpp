@@ -6,6 +6,7 @@
 #include "stdafx.h"
 #include "GPUMatrix.h"
 #include "CuDnnCommon.h"
+#include "GPUStreamContext.h"
 #include "half.hpp"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -26,6 +27,8 @@ const double Consts<double>::Zero = 0;
 
 const float Consts<half>::Zero = 0;
 const float Consts<half>::One = 1;
+const float Consts<bfloat16>::Zero = 0;
+const float Consts<bfloat16>::One = 1;
 
 
 CuDnnTensor::CuDnnTensor()
@@ -33,10 +36,10 @@ CuDnnTensor::CuDnnTensor()
 {
 }
 
-CuDnnTensor::CuDnnTensor(const TensorShape& src, cudnnDataType_t dataType)
+CuDnnTensor::CuDnnTensor(const TensorShape& src, cudnnDataType_t dataType, ImageLayoutKind imageLayout)
     : m_tensor(nullptr)
 {
-    Set(src, dataType);
+    Set(src, dataType, imageLayout);
 }
 
 CuDnnTensor::~CuDnnTensor()
@@ -48,9 +51,26 @@ CuDnnTensor::~CuDnnTensor()
     }
 }
 
-void CuDnnTensor::Set(const TensorShape& src, cudnnDataType_t dataType)
+void CuDnnTensor::Set(const TensorShape& srcShape, cudnnDataType_t dataType, ImageLayoutKind imageLayout)
 {
     CUDNN_CALL(cudnnCreateTensorDescriptor(&m_tensor));
+    TensorShape src = srcShape;
+    if (imageLayout == ImageLayoutKind::HWC && src.GetRank() > 1)
+    {
+        // Lay out the channels first and permute them back to the last dimension, which keeps their strides.
+        size_t rank = src.GetRank();
+        SmallVector<size_t> dims(rank);
+        std::vector<size_t> permutation(rank);
+        dims[0] = srcShape[rank - 1];
+        for (size_t i = 0; i + 1 < rank; i++)
+        {
+            dims[i + 1] = srcShape[i];
+            permutation[i] = i + 1;
+        }
+        permutation[rank - 1] = 0;
+        src = TensorShape(dims);
+        src.PermuteDimsInPlace(permutation);
+    }
     // Set cuDNN tensor dimensions. cuDNN uses row-major format while TensorShape - column-major
     // so conversion is required. N dimension will be set to 1.
     const auto& stridesSrc = src.GetStrides();
@@ -62,9 +82,12 @@ void CuDnnTensor::Set(const TensorShape& src, cudnnDataType_t dataType)
         dims[dims.size() - 1 - i] = (int)src[i];
         strides[dims.size() - 1 - i] = (int)stridesSrc[i];
     }
-    // Set "minibatch"(aka N) dimension.
+    // Set "minibatch"(aka N) dimension. Its stride is the extent of the sample, which is not the stride
+    // of the outermost dimension when the channels are stored first.
     dims[0] = 1;
-    strides[0] = strides[1] * dims[1];
+    strides[0] = 1;
+    for (size_t i = 1; i < dims.size(); i++)
+        strides[0] = std::max(strides[0], strides[i] * dims[i]);
     CUDNN_CALL(cudnnSetTensorNdDescriptor(m_tensor, dataType, (int)dims.size(), dims.data(), strides.data()));
 }
 
@@ -92,6 +115,8 @@ cudnnDataType_t CuDnnTensor::GetDataType()
         return CUDNN_DATA_DOUBLE;
     else if (typeid(ElemType) == typeid(half))
         return CUDNN_DATA_HALF;
+    else if (typeid(ElemType) == typeid(bfloat16))
+        return CUDNN_DATA_BFLOAT16;
     else
         InvalidArgument("cuDNN engine currently supports only single and double precision data types.");
 }
@@ -99,6 +124,7 @@ cudnnDataType_t CuDnnTensor::GetDataType()
 template cudnnDataType_t CuDnnTensor::GetDataType<float>();
 template cudnnDataType_t CuDnnTensor::GetDataType<double>();
 template cudnnDataType_t CuDnnTensor::GetDataType<half>();
+template cudnnDataType_t CuDnnTensor::GetDataType<bfloat16>();
 
 CuDnn::ptr_t CuDnn::Instance()
 {
@@ -114,8 +140,7 @@ CuDnn::ptr_t CuDnn::Instance()
         CUDNN_CALL(cudnnSetStream(*cudnn, GetStream()));
         return cudnn;
     };
-
-    static std::shared_ptr<cudnnHandle_t> m_instance = std::shared_ptr<cudnnHandle_t>(createNew(), [](cudnnHandle_t* src)
+    auto destroy = [](cudnnHandle_t* src)
     {
         assert(*src != nullptr);
         auto err = cudnnDestroy(*src);
@@ -124,7 +149,25 @@ CuDnn::ptr_t CuDnn::Instance()
         UNUSED(err);
 #endif
         delete src;
-    });
+    };
+
+    // A thread in a GPUStreamContext uses a handle of the context, bound to its stream, so that other threads do not
+    // change the stream of the handle under it. The engines created in the context keep that handle.
+    GPUStreamContext* context = GPUStreamContext::Current();
+    if (context)
+    {
+        int deviceId;
+        CUDA_CALL(cudaGetDevice(&deviceId));
+        if (deviceId == context->GetDeviceId())
+        {
+            auto& handle = context->CuDnnHandle();
+            if (!handle)
+                handle = std::shared_ptr<cudnnHandle_t>(createNew(), destroy);
+            return std::static_pointer_cast<cudnnHandle_t>(handle);
+        }
+    }
+
+    static std::shared_ptr<cudnnHandle_t> m_instance = std::shared_ptr<cudnnHandle_t>(createNew(), destroy);
     return m_instance;
 }
 
@@ -20,10 +20,12 @@ class CuDnnTensor final
 {
 public:
     CuDnnTensor();
-    CuDnnTensor(const TensorShape& src, cudnnDataType_t dataType);
+    CuDnnTensor(const TensorShape& src, cudnnDataType_t dataType, ImageLayoutKind imageLayout = ImageLayoutKind::CHW);
     ~CuDnnTensor();
 
-    void Set(const TensorShape& src, cudnnDataType_t dataType); 
+    // 'src' has the dimensions in CHW order, with the channels last. With the HWC layout the channels are
+    // stored first (in column-major terms), so the descriptor uses NHWC strides for the same dimensions.
+    void Set(const TensorShape& src, cudnnDataType_t dataType, ImageLayoutKind imageLayout = ImageLayoutKind::CHW);
     void UpdateBatchSize(size_t batchSize);
 
     operator cudnnTensorDescriptor_t() const { return m_tensor; }
@@ -45,6 +47,12 @@ struct CuDnn final
     DISABLE_COPY_AND_MOVE(CuDnn);
 };
 
+// the 16-bit types, which cuDNN computes in float, on the tensor cores where it can
+inline bool Is16BitDataType(cudnnDataType_t dataType)
+{
+    return dataType == CUDNN_DATA_HALF || dataType == CUDNN_DATA_BFLOAT16;
+}
+
 template <typename ElemType>
 struct Consts
 {
@@ -59,4 +67,11 @@ struct Consts<half>
     static const float One;
 };
 
+template <>
+struct Consts<bfloat16>
+{
+    static const float Zero;
+    static const float One;
+};
+
 } } }
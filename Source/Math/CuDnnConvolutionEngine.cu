@@ -10,7 +10,9 @@
 #include <typeinfo>
 #include <typeindex>
 #include "CuDnnCommon.h"
+#include "CuDnnAlgorithmCache.h"
 #include "half.hpp"
+#include <sstream>
 
 // We want tensor core be enabled in order to get(v7)/find tensor core results. But if algo without tensorcore is faster, the only way to force faster algo is to turn it off. Since re-tuning can happen quite often in CNTK, it gets bad if we don't do it carefully. It also require move to get_v7 and we can't test until we can run fp16.
 // For now, let's keep it simple and enable tensor core all the time for fp16.
@@ -24,15 +26,19 @@ const char* CudaErrString<cudnnStatus_t>(cudnnStatus_t x)
 // A note on the formats: CNTK originally used NHWC for input/output tensors and CHWN for kernels.
 // Such formats have very limited support in cuDNN and not used in other frameworks.
 // CNTK with cuDNN by default uses NCHW formats for both inputs/outputs and kernels.
+// With the HWC (channels-last) layout, inputs/outputs are NHWC and kernels are KHWC, i.e. the kernel
+// tensor is [C x W x H x K] in column-major terms. This lets cuDNN pick its tensor core NHWC kernels,
+// and stacks of convolutions, pooling and batch normalization stay in the same layout end to end.
 #define TENSOR_FORMAT CUDNN_TENSOR_NCHW
 #define FILTER_FORMAT CUDNN_TENSOR_NCHW
+#define FILTER_FORMAT_CHANNELS_LAST CUDNN_TENSOR_NHWC
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
 class CuDnnKernel
 {
 public:
-    CuDnnKernel(const ConvolveGeometry& geometry, cudnnDataType_t dataType)
+    CuDnnKernel(const ConvolveGeometry& geometry, cudnnDataType_t dataType, ImageLayoutKind imageLayout)
         : m_kernel(nullptr)
     {
         CUDNN_CALL(cudnnCreateFilterDescriptor(&m_kernel));
@@ -55,7 +61,9 @@ public:
         int numElems = 1;
         for(int i=0; i<(int)dim_size;i++) numElems *= dims[i];
         m_isOdd = (numElems%2==1);
-        CUDNN_CALL(cudnnSetFilterNdDescriptor(m_kernel, dataType, FILTER_FORMAT, (int)dim_size, dims.data()));
+        // The dimensions are given in KCHW order for either format.
+        cudnnTensorFormat_t format = imageLayout == ImageLayoutKind::HWC ? FILTER_FORMAT_CHANNELS_LAST : FILTER_FORMAT;
+        CUDNN_CALL(cudnnSetFilterNdDescriptor(m_kernel, dataType, format, (int)dim_size, dims.data()));
     }
 
     ~CuDnnKernel()
@@ -109,9 +117,9 @@ public:
         }
         CUDNN_CALL(cudnnSetConvolutionNdDescriptor(m_conv, (int)dim_size, pad.data(),
                                                    stride.data(), dilation.data(),
-                                                   CUDNN_CROSS_CORRELATION, dataType == CUDNN_DATA_HALF ? CUDNN_DATA_FLOAT : dataType));
-        // allow tensor core for fp16 by default
-        if(dataType == CUDNN_DATA_HALF)
+                                                   CUDNN_CROSS_CORRELATION, Is16BitDataType(dataType) ? CUDNN_DATA_FLOAT : dataType));
+        // allow tensor core for fp16 and bf16 by default
+        if(Is16BitDataType(dataType))
             CUDNN_CALL(cudnnSetConvolutionMathType(m_conv, CUDNN_TENSOR_OP_MATH));
     }
 
@@ -238,8 +246,8 @@ public:
         }
         inputDims[0] = inShape[0];
         outputDims[0] = outShape[0];
-        m_inT.Set(TensorShape(inputDims), m_dataType);
-        m_outT.Set(TensorShape(outputDims), m_dataType);
+        m_inT.Set(TensorShape(inputDims), m_dataType, imageLayout);
+        m_outT.Set(TensorShape(outputDims), m_dataType, imageLayout);
     }
 
     virtual bool ImplementsGradientOverwriteOptimization() const override { return true; }
@@ -254,8 +262,6 @@ protected:
 
     void EnsureCompatible() override
     {
-        if (m_imageLayout != ImageLayoutKind::CHW)
-            RuntimeError("cuDNN convolution engine supports only CHW/cudnn layout.");
         if (!IsGpu(m_deviceId))
             RuntimeError("cuDNN convolution engine supports GPU devices only.");
     }
@@ -264,7 +270,7 @@ protected:
     {
         if (m_kernelT == nullptr)
         {
-            m_kernelT = std::make_unique<CuDnnKernel>(*m_geometry, m_dataType);
+            m_kernelT = std::make_unique<CuDnnKernel>(*m_geometry, m_dataType, m_imageLayout);
             m_conv = std::make_unique<CuDnnConv>(*m_geometry, m_dataType);
         }
     }
@@ -316,8 +322,8 @@ protected:
             return err;
         };
         CUDNN_CALL(cudnnSetConvolutionGroupCount(*m_conv, (int)m_geometry->Groups()));
-        FindBestAlgo(batchSize, m_fwdAlgo, workspaceSizeFinder, deterministicFinder, finder, staticFinder, workspace);
-        if(m_dataType == CUDNN_DATA_HALF) CUDNN_CALL(cudnnSetConvolutionMathType(*m_conv, m_fwdAlgo.AlgoMathType));
+        FindBestAlgo("fwd", batchSize, m_fwdAlgo, workspaceSizeFinder, deterministicFinder, finder, staticFinder, workspace);
+        if(Is16BitDataType(m_dataType)) CUDNN_CALL(cudnnSetConvolutionMathType(*m_conv, m_fwdAlgo.AlgoMathType));
         else CUDNN_CALL(cudnnSetConvolutionMathType(*m_conv, CUDNN_DEFAULT_MATH));
         // Perform forward convolution operation.
         CUDNN_CALL(cudnnConvolutionForward(*m_cudnn, &C::One, m_inT, ptr(in), *m_kernelT, ptr(kernel), *m_conv, m_fwdAlgo.selectedAlgo, ptr(workspace), workspace.BufferSize(), &C::Zero, m_outT, ptr(out)));
@@ -381,9 +387,9 @@ protected:
             return err;
         };
         CUDNN_CALL(cudnnSetConvolutionGroupCount(*m_conv, (int)m_geometry->Groups()));
-        FindBestAlgo(batchSize, m_backDataAlgo, workspaceSizeFinder, deterministicFinder, finder, staticFinder, workspace);
+        FindBestAlgo("bwdData", batchSize, m_backDataAlgo, workspaceSizeFinder, deterministicFinder, finder, staticFinder, workspace);
         // Compute gradients with respect to the output tensor (data).
-        if(m_dataType == CUDNN_DATA_HALF) CUDNN_CALL(cudnnSetConvolutionMathType(*m_conv, m_backDataAlgo.AlgoMathType));
+        if(Is16BitDataType(m_dataType)) CUDNN_CALL(cudnnSetConvolutionMathType(*m_conv, m_backDataAlgo.AlgoMathType));
         else CUDNN_CALL(cudnnSetConvolutionMathType(*m_conv, CUDNN_DEFAULT_MATH));
         CUDNN_CALL(cudnnConvolutionBackwardData(*m_cudnn, &C::One, *m_kernelT, ptr(kernel), m_outT, ptr(srcGrad), *m_conv, m_backDataAlgo.selectedAlgo, ptr(workspace), workspace.BufferSize(), accumulateGradient ? &C::One : &C::Zero, m_inT, ptr(grad)));
     }
@@ -413,7 +419,7 @@ protected:
             if(!noMem)
                 return cudnnGetConvolutionBackwardFilterAlgorithm(*m_cudnn, m_inT, m_outT, *m_conv, *m_kernelT, CUDNN_CONVOLUTION_BWD_FILTER_SPECIFY_WORKSPACE_LIMIT, workspace.BufferSize(), &algo);
             // special case for half/odd filter
-            if(m_kernelT->isOdd() && m_dataType == CUDNN_DATA_HALF)
+            if(m_kernelT->isOdd() && Is16BitDataType(m_dataType))
             {
                 size_t tmpSize = 0;
                 algo = (cudnnConvolutionBwdFilterAlgo_t) 1;
@@ -455,9 +461,9 @@ protected:
             return err;
         };
         CUDNN_CALL(cudnnSetConvolutionGroupCount(*m_conv, (int)m_geometry->Groups()));
-        FindBestAlgo(batchSize, m_backFiltAlgo, workspaceSizeFinder, deterministicFinder, finder, staticFinder, workspace);
+        FindBestAlgo("bwdFilter", batchSize, m_backFiltAlgo, workspaceSizeFinder, deterministicFinder, finder, staticFinder, workspace);
         // Compute gradients with respect to the output tensor (data).
-        if(m_dataType == CUDNN_DATA_HALF) CUDNN_CALL(cudnnSetConvolutionMathType(*m_conv, m_backFiltAlgo.AlgoMathType));
+        if(Is16BitDataType(m_dataType)) CUDNN_CALL(cudnnSetConvolutionMathType(*m_conv, m_backFiltAlgo.AlgoMathType));
         else CUDNN_CALL(cudnnSetConvolutionMathType(*m_conv, CUDNN_DEFAULT_MATH));
         CUDNN_CALL(cudnnConvolutionBackwardFilter(*m_cudnn, &C::One, m_inT, ptr(in), m_outT, ptr(srcGrad), *m_conv, m_backFiltAlgo.selectedAlgo, ptr(workspace), workspace.BufferSize(), accumulateGradient ? &C::One : &C::Zero, *m_kernelT, ptr(kernelGrad)));
     }
@@ -500,7 +506,7 @@ private:
     static const int MaxAlgoCount = 10;
 
     template <typename TAlgo, typename TWorkspaceSizeFinder, typename TDeterministicFinder, typename TFinder, typename TStaticFinder>
-    void FindBestAlgo(size_t batchSize, TAlgo& algo, TWorkspaceSizeFinder workspaceSizeFinder, TDeterministicFinder deterministicFinder, TFinder finder, TStaticFinder staticFinder, Mat& workspace)
+    void FindBestAlgo(const char* direction, size_t batchSize, TAlgo& algo, TWorkspaceSizeFinder workspaceSizeFinder, TDeterministicFinder deterministicFinder, TFinder finder, TStaticFinder staticFinder, Mat& workspace)
     {
         m_inT.UpdateBatchSize(batchSize);
         m_outT.UpdateBatchSize(batchSize);
@@ -560,6 +566,34 @@ private:
         {
             size_t curSize = workspace.BufferSize();
 
+            // take the algorithm that an earlier process found for this geometry, if any
+            const std::string cacheKey = AlgorithmCacheKey(direction, batchSize);
+            CuDnnAlgorithmCache::Entry cached;
+            if (!cacheKey.empty() && CuDnnAlgorithmCache::Lookup(cacheKey, cached))
+            {
+                try
+                {
+                    if (cached.workspaceSize > curSize)
+                        workspace.Resize((cached.workspaceSize + sizeof(ElemType) - 1) / sizeof(ElemType), 1, 0, false);
+                    algo.RecordAlgoBatchSizeWorkspaceSize(true, (decltype(algo.selectedAlgo))cached.algo, batchSize, cached.workspaceSize);
+                    algo.AlgoMathType = (cudnnMathType_t)cached.mathType;
+                    algo.autotuningState = AutotuningState::Running;
+                    return;
+                }
+                catch (...)
+                {   // not enough memory for its workspace now, tune within what there is
+                    fprintf(stderr, "Cannot allocate the workspace of the cached convolution algorithm, tuning again\n");
+                    workspace.Resize((curSize + sizeof(ElemType) - 1) / sizeof(ElemType), 1, 0, false);
+                }
+            }
+            else if (!cacheKey.empty() && !CuDnnAlgorithmCache::ShouldTune())
+            {   // not in the cache, so trust the heuristics
+                CUDNN_CALL(staticFinder(algo.selectedAlgo, false));
+                algo.RecordAlgoBatchSizeWorkspaceSize(true, algo.selectedAlgo, batchSize, curSize);
+                algo.autotuningState = AutotuningState::Running;
+                return;
+            }
+
             // To control memory usage. No one seems to be using this flag
             size_t inputSampleSize = m_geometry->InputShape().GetNumElements();
             size_t maxMem = m_maxTempMemSizeInSamples == 0 ? (std::numeric_limits<size_t>::max)() : inputSampleSize * m_maxTempMemSizeInSamples * sizeof(ElemType);
@@ -586,6 +620,8 @@ private:
                 algo.RecordAlgoBatchSizeWorkspaceSize(true, (*res).algo, batchSize, (*res).memory);
                 algo.AlgoMathType = (*res).mathType;
                 algo.autotuningState = AutotuningState::Running;
+                if (!cacheKey.empty())
+                    CuDnnAlgorithmCache::Insert(cacheKey, { (int)(*res).algo, (int)(*res).mathType, (*res).memory });
                 if (algo.MaxAlgoWorkspaceSize < curSize)   // need to shrink the workspace
                     workspace.Resize((curSize + sizeof(ElemType) - 1) / sizeof(ElemType), 1, 0, false);
                 else
@@ -604,6 +640,8 @@ private:
                     algo.RecordAlgoBatchSizeWorkspaceSize(true, (*res).algo, batchSize, (*res).memory);
                     algo.AlgoMathType = (*res).mathType;
                     algo.autotuningState = AutotuningState::Running;
+                    if (!cacheKey.empty())
+                        CuDnnAlgorithmCache::Insert(cacheKey, { (int)(*res).algo, (int)(*res).mathType, (*res).memory });
                 }
                 catch (...)
                 {   // fails again, let's fall back to cudnnGet
@@ -628,6 +666,28 @@ private:
         return;
     }
 
+    // The key of the algorithms for this geometry in the CuDnnAlgorithmCache (see there), or empty if it is not enabled.
+    // The free GPU memory also bounds the workspace of the benchmarked algorithms, but a cached one that needs more
+    // than is available is simply tuned again.
+    std::string AlgorithmCacheKey(const char* direction, size_t batchSize)
+    {
+        if (!CuDnnAlgorithmCache::IsEnabled())
+            return std::string();
+        if (m_algorithmCacheKey.empty())
+        {
+            cudaDeviceProp props = {0};
+            CUDA_CALL(cudaGetDeviceProperties(&props, m_deviceId));
+            std::ostringstream key;
+            key << props.name << " sm" << props.major << props.minor << ", cuDNN " << cudnnGetVersion() << ", Type: " << (int)m_dataType;
+            key << ", " << (std::string)*m_geometry << ", Dilation: (";
+            for (size_t i = 0; i < m_geometry->KernelShape().GetRank(); i++)
+                key << (i > 0 ? ", " : "") << m_geometry->GetDilation(i);
+            key << "), Groups: " << m_geometry->Groups() << ", MaxTempMemSizeInSamples: " << m_maxTempMemSizeInSamples;
+            m_algorithmCacheKey = key.str();
+        }
+        return m_algorithmCacheKey + ", " + direction + ", MBSize: " + std::to_string(batchSize);
+    }
+
     static ElemType* ptr(Mat& src)
     {
         return src.Data();
@@ -710,6 +770,7 @@ private:
     // Flag indicating whether only deterministic algorithms should be used.
     bool m_forceDeterministicAlgorithms;
     bool m_inputHasFreeDimension;
+    std::string m_algorithmCacheKey; // the part of the cache key that does not depend on the direction and the minibatch size
 };
 
 template <class ElemType>
@@ -774,5 +835,6 @@ bool CuDnnConvolutionEngineFactory<ElemType>::IsSupported(DEVICEID_TYPE deviceId
 template class CuDnnConvolutionEngineFactory<float>;
 template class CuDnnConvolutionEngineFactory<double>;
 template class CuDnnConvolutionEngineFactory<half>;
+template class CuDnnConvolutionEngineFactory<bfloat16>;
 
 } } }
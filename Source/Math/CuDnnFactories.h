@@ -26,7 +26,7 @@ class CuDnnBatchNormEngineFactory
 {
 public:
     static std::unique_ptr<BatchNormEngine<InoutType, StatType>> Create(DEVICEID_TYPE deviceId, const TensorShape& inOutT,
-                                                             bool spatial, ImageLayoutKind imageLayout);
+                                                             bool spatial, ImageLayoutKind imageLayout, bool reluOutput);
 };
 
 // REVIEW alexeyk: wrong place? It is currently used only in unit tests but I can't add it there because of the build issues.
@@ -44,6 +44,18 @@ public:
     DISABLE_COPY_AND_MOVE(CuDnnTensorDescriptor);
 };
 
+template <class ElemType>
+bool CuDnnRNNExecutor<ElemType>::SetDescriptors(const vector<size_t>& numSequencesForFrame)
+{
+    if (numSequencesForFrame == m_numSequencesForFrame)
+        return false;
+
+    SetDescriptors(m_xDim, numSequencesForFrame, xDesc);
+    SetDescriptors(m_yDim, numSequencesForFrame, yDesc);
+    m_numSequencesForFrame = numSequencesForFrame;
+    return true;
+}
+
 template <class ElemType>
 void CuDnnRNNExecutor<ElemType>::SetDescriptors(size_t dim, const vector<size_t>& numSequencesForFrame, vector<cudnnTensorDescriptor_t>& descriptors)
 {
@@ -54,6 +66,8 @@ void CuDnnRNNExecutor<ElemType>::SetDescriptors(size_t dim, const vector<size_t>
             descriptors.push_back(cudnnTensorDescriptor_t());
             CUDNN_CALL(cudnnCreateTensorDescriptor(&descriptors[i]));
         }
+        else if (i < m_numSequencesForFrame.size() && m_numSequencesForFrame[i] == numSequencesForFrame[i])
+            continue; // already describes this frame
         // these dimensions are what CUDNN expects: (the minibatch dimension, the data dimension, and the number 1 (because each descriptor describes one frame of data)
         int dims[3] = { (int)numSequencesForFrame[i], (int)dim, 1 };
         int strides[3] = { dims[2] * dims[1], dims[2], 1 };
@@ -61,6 +75,92 @@ void CuDnnRNNExecutor<ElemType>::SetDescriptors(size_t dim, const vector<size_t>
     }
 }
 
+template <class ElemType>
+CuDnnRNNExecutor<ElemType>::~CuDnnRNNExecutor()
+{
+    for (auto& descriptor : xDesc)
+        cudnnDestroyTensorDescriptor(descriptor);
+    for (auto& descriptor : yDesc)
+        cudnnDestroyTensorDescriptor(descriptor);
+#if CUDNN_VERSION >= 7201
+    if (m_xDataDesc != nullptr)
+        cudnnDestroyRNNDataDescriptor(m_xDataDesc);
+    if (m_yDataDesc != nullptr)
+        cudnnDestroyRNNDataDescriptor(m_yDataDesc);
+#endif
+}
+
+template <class ElemType>
+void CuDnnRNNExecutor<ElemType>::PrepareForward(const GPUMatrix<ElemType>& weightsW, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace)
+{
+    auto sizes = m_workspaceAndReserveSizes.find(m_numSequencesForFrame);
+    if (sizes == m_workspaceAndReserveSizes.end())
+    {
+        size_t workSize;
+        size_t reserveSize;
+
+        // Need for every pass
+        CUDNN_CALL(cudnnGetRNNWorkspaceSize(*m_cudnn, *m_rnnT, (int)m_seqLength, xDesc.data(), &workSize));
+        // Only needed in training, can't be touched between passes.
+        CUDNN_CALL(cudnnGetRNNTrainingReserveSize(*m_cudnn, *m_rnnT, (int)m_seqLength, xDesc.data(), &reserveSize));
+
+        // bound the cache, in case every minibatch is composed differently
+        const size_t maxCachedCompositions = 1024;
+        if (m_workspaceAndReserveSizes.size() >= maxCachedCompositions)
+            m_workspaceAndReserveSizes.clear();
+        sizes = m_workspaceAndReserveSizes.emplace(m_numSequencesForFrame, std::make_pair(workSize, reserveSize)).first;
+    }
+
+    // convert from bytes to ElemType
+    size_t workSize = (sizes->second.first + sizeof(ElemType) - 1) / (sizeof(ElemType));
+    size_t reserveSize = (sizes->second.second + sizeof(ElemType) - 1) / sizeof(ElemType);
+
+    // larger buffers than needed are fine, and keep the largest minibatch from reallocating again
+    if (reserve.GetNumElements() < reserveSize)
+        reserve.Resize(reserveSize, 1);
+    if (workspace.GetNumElements() < workSize)
+        workspace.Resize(workSize, 1);
+
+    // the filter only depends on the input dimension and the algorithm
+    if (!wDesc)
+        wDesc = make_unique<CuDnnFilter<ElemType>>(*m_rnnT, xDesc[0]);
+    if (wDesc->GetSize() != weightsW.GetNumElements())
+        InvalidArgument("RNN needs %ld parameters, but %ld were allocated", wDesc->GetSize(), weightsW.GetNumElements());
+}
+
+template <class ElemType>
+template <class ForwardFunction>
+void CuDnnRNNExecutor<ElemType>::RunWithFallback(const ForwardFunction& forward, const GPUMatrix<ElemType>& weightsW, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace)
+{
+    cudnnStatus_t status = forward();
+    if (status == CUDNN_STATUS_NOT_SUPPORTED && m_rnnT->IsPersistent())
+    {
+        m_rnnT->SetDescriptor(/*persistent=*/false);
+        InvalidatePlans();
+        PrepareForward(weightsW, reserve, workspace);
+        status = forward();
+    }
+    CUDNN_CALL(status);
+}
+
+// Picks the algorithm again if the persistent one was enabled or disabled since the last pass.
+template <class ElemType>
+void CuDnnRNNExecutor<ElemType>::UpdateAlgorithm(const RnnAttributes& rnnAttributes)
+{
+    if (m_rnnT->IsPersistenceRequested() != rnnAttributes.m_persistent)
+    {
+        m_rnnT = std::make_unique<CuDnnRNN<ElemType>>(rnnAttributes);
+        InvalidatePlans();
+    }
+}
+
+template <class ElemType>
+void CuDnnRNNExecutor<ElemType>::InvalidatePlans()
+{
+    wDesc.reset();
+    m_workspaceAndReserveSizes.clear();
+}
+
 template <class ElemType>
 void CuDnnRNNExecutor<ElemType>::ForwardCore(
     const GPUMatrix<ElemType>& weightsW,
@@ -77,44 +177,106 @@ void CuDnnRNNExecutor<ElemType>::ForwardCore(
     if (m_yDim != (m_rnnT->isBidirectional() ? 2 : 1) * m_rnnT->GetNumHidden())
         InvalidArgument("CuDnn ForwardCore: Output leading dimension must be twice hidden size for bidirectional networks");
 
+    UpdateAlgorithm(rnnAttributes);
+
     // set up the input and output descriptors
-    SetDescriptors(m_xDim, numSequencesForFrame, xDesc);
-    SetDescriptors(m_yDim, numSequencesForFrame, yDesc);
+    SetDescriptors(numSequencesForFrame);
 
     // ensure workspace and reserve are large enough
     m_seqLength = numSequencesForFrame.size();
-    size_t workSize;
-    size_t reserveSize;
+    PrepareForward(weightsW, reserve, workspace);
 
-    // Need for every pass
-    CUDNN_CALL(cudnnGetRNNWorkspaceSize(*m_cudnn, *m_rnnT, (int)m_seqLength, xDesc.data(), &workSize));
-    // Only needed in training, can't be touched between passes.
-    CUDNN_CALL(cudnnGetRNNTrainingReserveSize(*m_cudnn, *m_rnnT, (int)m_seqLength, xDesc.data(), &reserveSize));
+    RunWithFallback([&]()
+    {
+#if CUDNN_VERSION >= 7201
+        CUDNN_CALL(cudnnSetRNNPaddingMode(*m_rnnT, CUDNN_RNN_PADDED_IO_DISABLED));
+#endif
+        return cudnnRNNForwardTraining(
+            *m_cudnn, *m_rnnT,
+            (int)m_seqLength,
+            xDesc.data(), inputX.Data(),
+            0, 0,
+            0, 0,
+            *wDesc, weightsW.Data(),
+            yDesc.data(), outputY.Data(),
+            0, 0,
+            0, 0,
+            workspace.Data(), workspace.GetNumElements()*sizeof(ElemType),
+            reserve.Data(), reserve.GetNumElements()*sizeof(ElemType));
+    }, weightsW, reserve, workspace);
+    m_BackwardDataCalledYet = false;
+    m_unpacked = false;
+}
 
-    // convert from bytes to ElemType
-    workSize = (workSize + sizeof(ElemType) - 1) / (sizeof(ElemType));
-    reserveSize = (reserveSize + sizeof(ElemType) - 1) / sizeof(ElemType);
+template <class ElemType>
+void CuDnnRNNExecutor<ElemType>::ForwardUnpackedCore(
+    const GPUMatrix<ElemType>& weightsW,
+    const GPUMatrix<ElemType>& inputX, GPUMatrix<ElemType>& outputY,
+    const vector<int>& sequenceLengths,
+    const RnnAttributes& rnnAttributes,
+    GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace
+    )
+{
+#if CUDNN_VERSION >= 7201
+    // test that the RNN shape is correct
+    if (!m_rnnT->IsCompatible(rnnAttributes))
+        LogicError("RNN Layout has changed during processing");
 
-    reserve.Resize(reserveSize, 1);
-    workspace.Resize(workSize, 1);
+    if (m_yDim != (m_rnnT->isBidirectional() ? 2 : 1) * m_rnnT->GetNumHidden())
+        InvalidArgument("CuDnn ForwardUnpackedCore: Output leading dimension must be twice hidden size for bidirectional networks");
 
-    wDesc = make_unique<CuDnnFilter<ElemType>>(*m_rnnT, xDesc[0]);
-    if (wDesc->GetSize() != weightsW.GetNumElements())
-        InvalidArgument("RNN needs %ld parameters, but %ld were allocated", wDesc->GetSize(), weightsW.GetNumElements());
+    UpdateAlgorithm(rnnAttributes);
 
-    CUDNN_CALL(cudnnRNNForwardTraining(
-        *m_cudnn, *m_rnnT,
-        (int)m_seqLength,
-        xDesc.data(), inputX.Data(),
-        0, 0,
-        0, 0,
-        *wDesc, weightsW.Data(),
-        yDesc.data(), outputY.Data(),
-        0, 0,
-        0, 0,
-        workspace.Data(), workspace.GetNumElements()*sizeof(ElemType),
-        reserve.Data(), reserve.GetNumElements()*sizeof(ElemType)));
+    size_t numSequences = sequenceLengths.size();
+    m_seqLength = inputX.GetNumCols() / numSequences;
+    if (m_seqLength * numSequences != inputX.GetNumCols() || outputY.GetNumCols() != inputX.GetNumCols())
+        InvalidArgument("CuDnn ForwardUnpackedCore: The data must have a column for every frame of every sequence");
+
+    // The workspace, the reserve and the filter are sized as for a packed minibatch without any padding.
+    bool shapeChanged = SetDescriptors(vector<size_t>(m_seqLength, numSequences));
+    PrepareForward(weightsW, reserve, workspace);
+
+    if (m_xDataDesc == nullptr)
+    {
+        CUDNN_CALL(cudnnCreateRNNDataDescriptor(&m_xDataDesc));
+        CUDNN_CALL(cudnnCreateRNNDataDescriptor(&m_yDataDesc));
+        shapeChanged = true;
+    }
+    if (shapeChanged || sequenceLengths != m_sequenceLengths)
+    {
+        ElemType paddingFill = 0;
+        CUDNN_CALL(cudnnSetRNNDataDescriptor(m_xDataDesc, m_dataType, CUDNN_RNN_DATA_LAYOUT_SEQ_MAJOR_UNPACKED,
+                                             (int)m_seqLength, (int)numSequences, (int)m_xDim, sequenceLengths.data(), &paddingFill));
+        CUDNN_CALL(cudnnSetRNNDataDescriptor(m_yDataDesc, m_dataType, CUDNN_RNN_DATA_LAYOUT_SEQ_MAJOR_UNPACKED,
+                                             (int)m_seqLength, (int)numSequences, (int)m_yDim, sequenceLengths.data(), &paddingFill));
+        m_sequenceLengths = sequenceLengths;
+    }
+
+    RunWithFallback([&]()
+    {
+        CUDNN_CALL(cudnnSetRNNPaddingMode(*m_rnnT, CUDNN_RNN_PADDED_IO_ENABLED));
+        return cudnnRNNForwardTrainingEx(
+            *m_cudnn, *m_rnnT,
+            m_xDataDesc, inputX.Data(),
+            0, 0,
+            0, 0,
+            *wDesc, weightsW.Data(),
+            m_yDataDesc, outputY.Data(),
+            0, 0,
+            0, 0,
+            0, 0,
+            0, 0,
+            0, 0,
+            0, 0,
+            workspace.Data(), workspace.GetNumElements()*sizeof(ElemType),
+            reserve.Data(), reserve.GetNumElements()*sizeof(ElemType));
+    }, weightsW, reserve, workspace);
     m_BackwardDataCalledYet = false;
+    m_unpacked = true;
+#else
+    UNUSED(weightsW); UNUSED(inputX); UNUSED(outputY); UNUSED(sequenceLengths); UNUSED(rnnAttributes); UNUSED(reserve); UNUSED(workspace);
+    LogicError("CuDnn ForwardUnpackedCore: Requires CuDnn 7.2.1 or later");
+#endif
 }
 
 template <class ElemType>
@@ -128,7 +290,28 @@ void CuDnnRNNExecutor<ElemType>::BackwardDataCore(
     if (!m_rnnT->IsCompatible(rnnAttributes))
         LogicError("RNN Layout has changed during processing");
 
-    if (!m_BackwardDataCalledYet)
+    if (!m_BackwardDataCalledYet && m_unpacked)
+    {
+#if CUDNN_VERSION >= 7201
+        CUDNN_CALL(cudnnRNNBackwardDataEx(
+            *m_cudnn, *m_rnnT,
+            m_yDataDesc, outputY.Data(),
+            m_yDataDesc, outputDY.Data(),
+            0, 0,
+            0, 0,
+            0, 0,
+            *wDesc, weightsW.Data(),
+            0, 0,
+            0, 0,
+            m_xDataDesc, dx.Data(),
+            0, 0,
+            0, 0,
+            0, 0,
+            workspace.Data(), workspace.GetNumElements()*sizeof(ElemType),
+            reserve.Data(), reserve.GetNumElements()*sizeof(ElemType)));
+#endif
+    }
+    else if (!m_BackwardDataCalledYet)
     {
         CUDNN_CALL(cudnnRNNBackwardData(
             *m_cudnn, *m_rnnT,
@@ -160,6 +343,20 @@ void CuDnnRNNExecutor<ElemType>::BackwardWeightsCore(const GPUMatrix<ElemType>&
         LogicError("RNN Layout has changed during processing");
     if (!m_BackwardDataCalledYet)
         LogicError("out of order calling you have been very bad");
+#if CUDNN_VERSION >= 7201
+    if (m_unpacked)
+    {
+        CUDNN_CALL(cudnnRNNBackwardWeightsEx(
+            *m_cudnn, *m_rnnT,
+            m_xDataDesc, inputX.Data(),
+            0, 0,
+            m_yDataDesc, outputY.Data(),
+            workspace.Data(), workspace.GetNumElements()*sizeof(ElemType),
+            *wDesc, dw.Data(),
+            reserve.Data(), reserve.GetNumElements()*sizeof(ElemType)));
+        return;
+    }
+#endif
     CUDNN_CALL(cudnnRNNBackwardWeights(
         *m_cudnn, *m_rnnT,
         (int)m_seqLength,
@@ -174,5 +371,6 @@ void CuDnnRNNExecutor<ElemType>::BackwardWeightsCore(const GPUMatrix<ElemType>&
 template class CuDnnRNNExecutor<double>;
 template class CuDnnRNNExecutor<float>;
 template class CuDnnRNNExecutor<half>;
+template class CuDnnRNNExecutor<bfloat16>;
 
 } } }
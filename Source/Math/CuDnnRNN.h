@@ -7,6 +7,7 @@
 #include <typeindex>
 #include "CuDnnCommon.h"
 #include "RNNCommon.h"
+#include <map>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -63,8 +64,10 @@ private:
     cudnnRNNDescriptor_t m_rnnDesc;
     CuDnnDropout m_dropout;
     RnnAttributes m_rnnAttributes;
+    CuDnn::ptr_t m_cudnn;
+    bool m_persistent;
 
-    cudnnRNNMode_t GetMode()
+    cudnnRNNMode_t GetMode() const
     {
         if      (m_rnnAttributes.m_recurrentOp == wstring(L"lstm"))    return cudnnRNNMode_t::CUDNN_LSTM;
         else if (m_rnnAttributes.m_recurrentOp == wstring(L"gru"))     return cudnnRNNMode_t::CUDNN_GRU;
@@ -76,19 +79,30 @@ private:
 public:
     CuDnnRNN(const RnnAttributes& rnnAttributes)
         : m_rnnDesc(nullptr), m_dropout(0.0f), m_rnnAttributes(rnnAttributes),
-        m_dataType(CuDnnTensor::GetDataType<ElemType>())
+        m_dataType(CuDnnTensor::GetDataType<ElemType>()), m_cudnn(CuDnn::Instance())
     {
         CUDNN_CALL(cudnnCreateRNNDescriptor(&m_rnnDesc));
+        SetDescriptor(m_rnnAttributes.m_persistent && MayUsePersistentAlgorithm());
+    }
+
+    // (Re)configures the descriptor, with the persistent or the standard algorithm; the filter, workspace and reserve
+    // depend on it.
+    void SetDescriptor(bool persistent)
+    {
+        m_persistent = persistent;
 #if CUDNN_VERSION >= 7000
-        CUDNN_CALL(cudnnSetRNNDescriptor_v5(m_rnnDesc,
+        CUDNN_CALL(cudnnSetRNNDescriptor_v6(*m_cudnn, m_rnnDesc,
                   (int)m_rnnAttributes.m_hiddenSize,
                   (int)m_rnnAttributes.m_numLayers,
                   m_dropout,
                   CUDNN_LINEAR_INPUT, // We can also skip the input matrix transformation
                   m_rnnAttributes.m_bidirectional ? CUDNN_BIDIRECTIONAL : CUDNN_UNIDIRECTIONAL,
                   GetMode(),
+                  persistent ? CUDNN_RNN_ALGO_PERSIST_STATIC : CUDNN_RNN_ALGO_STANDARD,
                   m_dataType));
 #else
+        if (persistent)
+            LogicError("CuDnnRNN: The persistent algorithm requires cuDNN 7 or later.");
         CUDNN_CALL(cudnnSetRNNDescriptor(m_rnnDesc,
                   (int)m_rnnAttributes.m_hiddenSize,
                   (int)m_rnnAttributes.m_numLayers,
@@ -100,6 +114,35 @@ public:
 #endif
     }
 
+    // The persistent algorithm keeps the recurrent weights of a layer in the registers of all multiprocessors for all the
+    // time steps in one kernel, which only pays off for a few sequences. It needs compute capability 6.0, no doubles, and
+    // the recurrent weights of a layer and direction must fit; we leave half of the register file for the computation.
+    // cuDNN may still decline a configuration, see CuDnnRNNExecutor::RunWithFallback().
+    bool MayUsePersistentAlgorithm() const
+    {
+#if CUDNN_VERSION >= 7000
+        if (m_dataType == CUDNN_DATA_DOUBLE)
+            return false;
+        int deviceId;
+        CUDA_CALL(cudaGetDevice(&deviceId));
+        cudaDeviceProp props;
+        CUDA_CALL(cudaGetDeviceProperties(&props, deviceId));
+        if (props.major < 6)
+            return false;
+        const size_t numGates = (GetMode() == CUDNN_LSTM) ? 4 : (GetMode() == CUDNN_GRU) ? 3 : 1;
+        const size_t hiddenSize = m_rnnAttributes.m_hiddenSize;
+        const size_t recurrentWeightsBytes = numGates * hiddenSize * hiddenSize * sizeof(ElemType);
+        const size_t registerFileBytes = (size_t)props.multiProcessorCount * props.regsPerMultiprocessor * sizeof(int);
+        return recurrentWeightsBytes <= registerFileBytes / 2;
+#else
+        return false;
+#endif
+    }
+
+    bool IsPersistent() const { return m_persistent; }
+    // the setting of RnnAttributes::m_persistent the algorithm was chosen for
+    bool IsPersistenceRequested() const { return m_rnnAttributes.m_persistent; }
+
     ~CuDnnRNN()
     {
         if (m_rnnDesc != nullptr)
@@ -199,12 +242,19 @@ public:
         m_xDim(xDim), m_yDim(yDim),
         m_seqLength(0),
         m_dataType(CuDnnTensor::GetDataType<ElemType>()),
-        m_BackwardDataCalledYet(false)
+        m_BackwardDataCalledYet(false),
+        m_unpacked(false)
     {
         m_rnnT = std::make_unique<CuDnnRNN<ElemType>>(rnnAttributes);
     }
 
+    ~CuDnnRNNExecutor();
+
     void ForwardCore(const GPUMatrix<ElemType>& weightsW, const GPUMatrix<ElemType>& inputX, GPUMatrix<ElemType>& outputY, const vector<size_t>& numSequencesForFrame, const RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace);
+    // Same as ForwardCore(), but the data are in the layout of the minibatch, with column t * numSequences + s holding frame t
+    // of sequence s, where sequence s has sequenceLengths[s] frames. The columns beyond the end of a sequence are ignored in the
+    // input, and set to zero in the output. The backward calls that follow use the same layout.
+    void ForwardUnpackedCore(const GPUMatrix<ElemType>& weightsW, const GPUMatrix<ElemType>& inputX, GPUMatrix<ElemType>& outputY, const vector<int>& sequenceLengths, const RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace);
     void BackwardWeightsCore(const GPUMatrix<ElemType>& inputX, const GPUMatrix<ElemType>& outputY, GPUMatrix<ElemType>& dw, const RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace);
     void BackwardDataCore(const GPUMatrix<ElemType>& outputY, const GPUMatrix<ElemType>& outputDY, const GPUMatrix<ElemType>& w, GPUMatrix<ElemType>& dx, const RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace);
 
@@ -223,12 +273,38 @@ private:
         return src.Data();
     }
 
+    // Sets xDesc and yDesc to the frames of numSequencesForFrame. Only the frames whose number of sequences differs from
+    // the last minibatch are set again. Returns whether any frame changed.
+    bool SetDescriptors(const vector<size_t>& numSequencesForFrame);
     void SetDescriptors(size_t dim, const vector<size_t>& numSequencesForFrame, vector<cudnnTensorDescriptor_t>& descriptors);
+    // Sizes the workspace and reserve, and creates the filter descriptor, once xDesc is set. The sizes are cached for each
+    // composition of the minibatch, and the workspace and reserve only grow, so that minibatches of varying lengths do not
+    // reallocate once the longest has been seen.
+    void PrepareForward(const GPUMatrix<ElemType>& weightsW, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace);
+    // Forgets the filter descriptor and the sizes, which depend on the algorithm of m_rnnT.
+    void InvalidatePlans();
+    // Runs a forward pass with the persistent algorithm if it was chosen, and with the standard one from then on if cuDNN
+    // does not support the configuration.
+    void UpdateAlgorithm(const RnnAttributes& rnnAttributes);
+    template <class ForwardFunction>
+    void RunWithFallback(const ForwardFunction& forward, const GPUMatrix<ElemType>& weightsW, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace);
 
 private:
     std::unique_ptr<CuDnnRNN<ElemType>> m_rnnT;
     bool m_BackwardDataCalledYet;
     size_t m_seqLength;
+    // whether the last forward pass used ForwardUnpackedCore()
+    bool m_unpacked;
+    // the number of sequences of each frame that xDesc and yDesc describe
+    vector<size_t> m_numSequencesForFrame;
+    // the workspace and reserve sizes in bytes for each number of sequences of each frame
+    std::map<vector<size_t>, std::pair<size_t, size_t>> m_workspaceAndReserveSizes;
+#if CUDNN_VERSION >= 7201
+    cudnnRNNDataDescriptor_t m_xDataDesc = nullptr;
+    cudnnRNNDataDescriptor_t m_yDataDesc = nullptr;
+    // the sequence lengths m_xDataDesc and m_yDataDesc describe
+    vector<int> m_sequenceLengths;
+#endif
 };
 
 } } }
@@ -50,6 +50,10 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         // Waits on the event that triggers when all copies have been finished.
         virtual void WaitForCopyCPUToGPU() = 0;
 
+        // Makes the compute stream wait on the event that triggers when all copies have been finished,
+        // without blocking the calling thread.
+        virtual void WaitForCopyCPUToGPUOnComputeStreamAsync() = 0;
+
         // Records an event on a compute stream.
         virtual void RecordComputeStreamSyncPoint() = 0;
 
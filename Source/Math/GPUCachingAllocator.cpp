@@ -0,0 +1,188 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// GPUCachingAllocator.cpp -- per-device caching allocator used by TracingGPUMemoryAllocator
+//
+#include "stdafx.h"
+#include "GPUCachingAllocator.h"
+#include "GPUMatrix.h"
+
+#pragma comment(lib, "cudart.lib")
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+void PrepareDevice(DEVICEID_TYPE deviceId);
+
+/*static*/ GPUCachingAllocator& GPUCachingAllocator::GetInstance(int deviceId)
+{
+    static std::mutex s_instancesMutex;
+    static std::map<int, GPUCachingAllocator*> s_instances;
+
+    std::lock_guard<std::mutex> lock(s_instancesMutex);
+    auto& instance = s_instances[deviceId];
+    if (!instance)
+        instance = new GPUCachingAllocator(deviceId); // never deleted, see header
+    return *instance;
+}
+
+/*static*/ size_t GPUCachingAllocator::RoundUpToSizeClass(size_t numBytes)
+{
+    const size_t smallGranularity = 512;
+    const size_t smallLimit = 1 << 20;
+
+    if (numBytes <= smallLimit)
+        return AsMultipleOf(std::max(numBytes, smallGranularity), smallGranularity);
+
+    // find the power of two just below numBytes and use a quarter of it as granularity
+    size_t powerOfTwo = smallLimit;
+    while (powerOfTwo * 2 < numBytes)
+        powerOfTwo *= 2;
+    return AsMultipleOf(numBytes, powerOfTwo / 4);
+}
+
+void* GPUCachingAllocator::Allocate(size_t numBytes, cudaStream_t stream)
+{
+    const size_t size = RoundUpToSizeClass(numBytes);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.numAllocations++;
+
+    void* ptr = nullptr;
+    auto freeList = m_freeLists.find(std::make_pair(size, stream));
+    if (freeList != m_freeLists.end() && !freeList->second.empty())
+    {
+        ptr = freeList->second.back();
+        freeList->second.pop_back();
+        m_stats.bytesCached -= size;
+        m_stats.numCacheHits++;
+    }
+    else
+        ptr = AllocateFromDevice(size);
+
+    const auto category = GPUMemoryCategoryScope::Current();
+    m_blocksInUse[ptr] = Block{ size, numBytes, stream, category };
+    m_stats.bytesInUse += size;
+    m_stats.bytesRequested += numBytes;
+    m_stats.bytesInUseByCategory[(int)category] += size;
+    m_stats.peakBytesReserved = std::max(m_stats.peakBytesReserved, m_stats.bytesInUse + m_stats.bytesCached);
+    m_stats.peakBytesInUse = std::max(m_stats.peakBytesInUse, m_stats.bytesInUse);
+    m_stats.peakBytesInUseByCategory[(int)category] = std::max(m_stats.peakBytesInUseByCategory[(int)category], m_stats.bytesInUseByCategory[(int)category]);
+    return ptr;
+}
+
+bool GPUCachingAllocator::Free(void* ptr, bool keepInCache, bool ignoreCUDARetCode)
+{
+    if (ptr == nullptr)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto iter = m_blocksInUse.find(ptr);
+    if (iter == m_blocksInUse.end())
+        return false;
+
+    const Block block = iter->second;
+    m_blocksInUse.erase(iter);
+    m_stats.bytesInUse -= block.m_size;
+    m_stats.bytesRequested -= block.m_requested;
+    m_stats.bytesInUseByCategory[(int)block.m_category] -= block.m_size;
+
+    // Only work on the stream of the block is known to be ordered before its reuse. A block that is freed from
+    // another stream (e.g. by a node running on a stream of a GPUStreamPool) may still be in use there, and
+    // cudaFree synchronizes the device.
+    if (keepInCache && block.m_stream == GetStream())
+    {
+        m_freeLists[std::make_pair(block.m_size, block.m_stream)].push_back(ptr);
+        m_stats.bytesCached += block.m_size;
+        TrimToLimit();
+    }
+    else
+        ReleaseToDevice(ptr, ignoreCUDARetCode);
+
+    return true;
+}
+
+void GPUCachingAllocator::EmptyCache()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ReleaseAllCachedBlocks();
+}
+
+GPUMemoryCacheStats GPUCachingAllocator::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void GPUCachingAllocator::ResetPeakStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.peakBytesReserved = m_stats.bytesInUse + m_stats.bytesCached;
+    m_stats.peakBytesInUse = m_stats.bytesInUse;
+    for (int i = 0; i < (int)GPUMemoryCategory::Count; i++)
+        m_stats.peakBytesInUseByCategory[i] = m_stats.bytesInUseByCategory[i];
+}
+
+void* GPUCachingAllocator::AllocateFromDevice(size_t size)
+{
+    PrepareDevice(m_deviceId);
+
+    void* ptr = nullptr;
+    cudaError_t result = cudaMalloc(&ptr, size);
+    if (result == cudaErrorMemoryAllocation && m_stats.bytesCached > 0)
+    {
+        // Out of memory while holding idle blocks: give them back to the driver and try once more.
+        cudaGetLastError(); // clear the sticky error state of the failed call
+        ReleaseAllCachedBlocks();
+        result = cudaMalloc(&ptr, size);
+    }
+    CUDA_CALL(result);
+
+    m_stats.numDeviceAllocations++;
+    return ptr;
+}
+
+void GPUCachingAllocator::ReleaseToDevice(void* ptr, bool ignoreCUDARetCode)
+{
+    PrepareDevice(m_deviceId);
+    if (ignoreCUDARetCode)
+        cudaFree(ptr);
+    else
+        CUDA_CALL(cudaFree(ptr));
+
+    m_stats.numDeviceFrees++;
+}
+
+void GPUCachingAllocator::ReleaseAllCachedBlocks()
+{
+    for (auto& freeList : m_freeLists)
+    {
+        for (auto ptr : freeList.second)
+            ReleaseToDevice(ptr, /*ignoreCUDARetCode=*/ false);
+    }
+
+    m_freeLists.clear();
+    m_stats.bytesCached = 0;
+}
+
+void GPUCachingAllocator::TrimToLimit()
+{
+    const size_t limitInBytes = TracingGPUMemoryAllocator::GetCacheLimitInMBs() << 20;
+    if (limitInBytes == 0)
+        return;
+
+    // Release the largest idle blocks first; they are the least likely to be requested again
+    // and free the most memory per (synchronizing) cudaFree.
+    for (auto freeList = m_freeLists.rbegin(); freeList != m_freeLists.rend() && m_stats.bytesCached > limitInBytes; ++freeList)
+    {
+        const size_t size = freeList->first.first;
+        while (!freeList->second.empty() && m_stats.bytesCached > limitInBytes)
+        {
+            ReleaseToDevice(freeList->second.back(), /*ignoreCUDARetCode=*/ false);
+            freeList->second.pop_back();
+            m_stats.bytesCached -= size;
+        }
+    }
+}
+
+}}}
@@ -0,0 +1,87 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// GPUCachingAllocator.h -- per-device caching allocator used by TracingGPUMemoryAllocator
+//
+#pragma once
+
+#include <cuda_runtime_api.h>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "CommonMatrix.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// GPUCachingAllocator -- keeps freed device blocks for reuse.
+//
+// Requests are rounded up to a size class (see RoundUpToSizeClass()). Freed blocks
+// are kept in a free list per (stream, size class) and handed out again to requests
+// of the same class issued on the same stream. Since work on one stream executes in
+// order, a block freed on a stream can be reused on that stream without synchronizing
+// the device, which is what cudaFree would do. Blocks freed while another stream is
+// current are released to the device instead.
+//
+// Each block in use is attributed to the GPUMemoryCategory of the allocating thread, so that the statistics
+// tell what the device memory is used for.
+//
+// The amount of idle memory is bounded by TracingGPUMemoryAllocator::GetCacheLimitInMBs().
+// If cudaMalloc fails, the cache of the device is emptied and the allocation retried.
+// -----------------------------------------------------------------------
+
+class GPUCachingAllocator
+{
+public:
+    // One instance per device. Instances are intentionally never destroyed, since the
+    // CUDA runtime may already be shut down when static destructors run.
+    static GPUCachingAllocator& GetInstance(int deviceId);
+
+    // Returns a block of at least numBytes bytes that may be used on 'stream'.
+    void* Allocate(size_t numBytes, cudaStream_t stream);
+
+    // Returns true if 'ptr' was handed out by this allocator; in that case the block is either
+    // cached (if 'keepInCache') or released to the driver. Returns false for foreign pointers.
+    bool Free(void* ptr, bool keepInCache, bool ignoreCUDARetCode);
+
+    // Releases all idle blocks to the driver.
+    void EmptyCache();
+
+    GPUMemoryCacheStats GetStats() const;
+    void ResetPeakStats();
+
+    // Size classes: multiples of 512 bytes up to 1 MB; above that four classes per power of two,
+    // which bounds the rounding waste at 25%.
+    static size_t RoundUpToSizeClass(size_t numBytes);
+
+private:
+    GPUCachingAllocator(int deviceId) : m_deviceId(deviceId) {}
+    GPUCachingAllocator(const GPUCachingAllocator&) = delete;
+    GPUCachingAllocator& operator=(const GPUCachingAllocator&) = delete;
+
+    struct Block
+    {
+        size_t m_size;      // size class actually allocated
+        size_t m_requested; // size asked for by the caller
+        cudaStream_t m_stream;
+        GPUMemoryCategory m_category; // see GPUMemoryCategoryScope
+    };
+
+    typedef std::pair<size_t, cudaStream_t> FreeListKey; // ordered by size first, see TrimToLimit()
+
+    // all methods below expect m_mutex to be held
+    void* AllocateFromDevice(size_t size);
+    void ReleaseToDevice(void* ptr, bool ignoreCUDARetCode);
+    void ReleaseAllCachedBlocks();
+    void TrimToLimit();
+
+    const int m_deviceId;
+    mutable std::mutex m_mutex;
+    std::unordered_map<void*, Block> m_blocksInUse;
+    std::map<FreeListKey, std::vector<void*>> m_freeLists;
+    GPUMemoryCacheStats m_stats;
+};
+
+}}}
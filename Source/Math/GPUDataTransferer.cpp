@@ -113,6 +113,12 @@ void GranularGPUDataTransferer::WaitForCopyCPUToGPU()
     cudaEventSynchronize(m_assignCompleteEvent) || "cudaEventSynchronize failed";
 }
 
+void GranularGPUDataTransferer::WaitForCopyCPUToGPUOnComputeStreamAsync()
+{
+    PrepareDevice(m_deviceId);
+    cudaStreamWaitEvent(GetStream(), m_assignCompleteEvent, 0 /*flags 'must be 0'*/) || "cudaStreamWaitEvent failed";
+}
+
 void GranularGPUDataTransferer::RecordComputeStreamSyncPoint()
 {
     PrepareDevice(m_deviceId);
@@ -41,6 +41,7 @@ public:
     void CopyCPUToGPUAsync(const void* cpuBuffer, size_t numElements, size_t elementSize, void* gpuBuffer) override;
     void RecordCPUToGPUCopy() override;
     void WaitForCopyCPUToGPU() override;
+    void WaitForCopyCPUToGPUOnComputeStreamAsync() override;
 
     void RecordComputeStreamSyncPoint() override;
     void WaitForSyncPointOnFetchStreamAsync() override;
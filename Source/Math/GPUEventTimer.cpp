@@ -0,0 +1,78 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// GPUEventTimer.cpp -- measures the GPU time of the work issued between two points, without synchronizing
+//
+#include "stdafx.h"
+#include "GPUEventTimer.h"
+#include "GPUMatrix.h"
+#include <cuda_runtime.h>
+
+#pragma comment(lib, "cudart.lib")
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+void PrepareDevice(DEVICEID_TYPE deviceId);
+
+GPUEventTimer::GPUEventTimer(DEVICEID_TYPE deviceId)
+    : m_deviceId(deviceId), m_startEvent(nullptr), m_stopEvent(nullptr), m_started(false), m_pending(false), m_elapsedSeconds(0)
+{
+    if (deviceId < 0)
+        InvalidArgument("GPUEventTimer: Requires a GPU device.");
+
+    PrepareDevice(deviceId);
+    CUDA_CALL(cudaEventCreate((cudaEvent_t*) &m_startEvent));
+    CUDA_CALL(cudaEventCreate((cudaEvent_t*) &m_stopEvent));
+}
+
+GPUEventTimer::~GPUEventTimer()
+{
+    // no CUDA_CALL, since the runtime may already be shut down
+    cudaEventDestroy((cudaEvent_t) m_stopEvent);
+    cudaEventDestroy((cudaEvent_t) m_startEvent);
+}
+
+void GPUEventTimer::Start()
+{
+    // Without a Stop() since the last Start(), e.g. because the timed work failed, that interval is dropped.
+    Accumulate(); // before the events are recorded again
+    CUDA_CALL(cudaEventRecord((cudaEvent_t) m_startEvent, GetStream()));
+    m_started = true;
+}
+
+void GPUEventTimer::Stop()
+{
+    if (!m_started)
+        LogicError("GPUEventTimer::Stop: Called without Start().");
+
+    CUDA_CALL(cudaEventRecord((cudaEvent_t) m_stopEvent, GetStream()));
+    m_started = false;
+    m_pending = true;
+}
+
+double GPUEventTimer::ElapsedSeconds()
+{
+    Accumulate();
+    return m_elapsedSeconds;
+}
+
+void GPUEventTimer::Reset()
+{
+    Accumulate();
+    m_elapsedSeconds = 0;
+}
+
+void GPUEventTimer::Accumulate()
+{
+    if (!m_pending)
+        return;
+
+    m_pending = false;
+    float milliseconds;
+    CUDA_CALL(cudaEventSynchronize((cudaEvent_t) m_stopEvent));
+    CUDA_CALL(cudaEventElapsedTime(&milliseconds, (cudaEvent_t) m_startEvent, (cudaEvent_t) m_stopEvent));
+    m_elapsedSeconds += milliseconds / 1000.0;
+}
+
+}}}
@@ -0,0 +1,49 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// GPUEventTimer.h -- measures the GPU time of the work issued between two points, without synchronizing
+//
+#pragma once
+
+#include "CommonMatrix.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// GPUEventTimer -- accumulates the GPU time between pairs of Start() and Stop().
+//
+// Start() and Stop() record events on the current stream (see GetStream()), so they do not wait for the GPU.
+// The time between the two events is only read at the next Start() or by ElapsedSeconds(), by which point
+// the work is usually long done. This makes the timer cheap enough to wrap every Forward and Backward of a node,
+// while measuring the time the GPU spent on it rather than the time it took to launch its kernels.
+// -----------------------------------------------------------------------
+
+class MATH_API GPUEventTimer
+{
+public:
+    GPUEventTimer(DEVICEID_TYPE deviceId);
+    ~GPUEventTimer();
+
+    DEVICEID_TYPE GetDeviceId() const { return m_deviceId; }
+
+    void Start();
+    void Stop();
+    double ElapsedSeconds(); // of all Start()/Stop() pairs since the last Reset(); waits for the last Stop()
+    void Reset();
+
+private:
+    GPUEventTimer(const GPUEventTimer&) = delete;
+    GPUEventTimer& operator=(const GPUEventTimer&) = delete;
+
+    void Accumulate();
+
+    DEVICEID_TYPE m_deviceId;
+    void* m_startEvent; // cudaEvent_t
+    void* m_stopEvent;  // cudaEvent_t
+    bool m_started;
+    bool m_pending;     // a Start()/Stop() pair that is not accumulated yet
+    double m_elapsedSeconds;
+};
+
+}}}
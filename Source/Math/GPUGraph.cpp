@@ -0,0 +1,171 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// GPUGraph.cpp -- records the GPU work of a piece of host code once and replays it with a single launch (CUDA graphs)
+//
+#include "stdafx.h"
+#include "GPUGraph.h"
+#include "GPUMatrix.h"
+#include "CuDnnCommon.h"
+#include "GPUStreamContext.h"
+#include <cuda_runtime.h>
+#include <map>
+#include <mutex>
+
+#pragma comment(lib, "cudart.lib")
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+void PrepareDevice(DEVICEID_TYPE deviceId);
+
+// the stream that all graphs of a device are run, recorded and replayed on; a thread in a GPUStreamContext of the
+// device uses the stream of the context instead, which keeps its priority
+static cudaStream_t GetGraphStream(DEVICEID_TYPE deviceId)
+{
+    GPUStreamContext* context = GPUStreamContext::Current();
+    if (context && context->GetDeviceId() == deviceId)
+        return (cudaStream_t) context->GetStream();
+
+    static std::mutex s_streamsMutex;
+    static std::map<DEVICEID_TYPE, cudaStream_t> s_streams; // never destroyed, like the caching allocators
+
+    std::lock_guard<std::mutex> lock(s_streamsMutex);
+    auto& stream = s_streams[deviceId];
+    if (!stream)
+    {
+        PrepareDevice(deviceId);
+        CUDA_CALL(cudaStreamCreate(&stream)); // blocking: synchronizes with the legacy default stream
+    }
+    return stream;
+}
+
+// issues the GPU routines and cuDNN on the graph stream of a device for the lifetime of the object
+class GraphStreamScope
+{
+public:
+    GraphStreamScope(DEVICEID_TYPE deviceId) : m_previousStream(GetStream())
+    {
+        PrepareDevice(deviceId);
+        m_stream = GetGraphStream(deviceId);
+        SetStream(m_stream);
+        CUDNN_CALL(cudnnSetStream(*CuDnn::Instance(), m_stream));
+    }
+    ~GraphStreamScope()
+    {
+        SetStream(m_previousStream);
+        cudnnSetStream(*CuDnn::Instance(), m_previousStream);
+    }
+    cudaStream_t Stream() const { return m_stream; }
+
+private:
+    cudaStream_t m_stream;
+    cudaStream_t m_previousStream;
+};
+
+GPUGraph::GPUGraph(DEVICEID_TYPE deviceId) : m_deviceId(deviceId), m_graph(nullptr), m_graphExec(nullptr)
+{
+}
+
+GPUGraph::~GPUGraph()
+{
+    Reset();
+}
+
+void GPUGraph::Reset()
+{
+#if CUDART_VERSION >= 10000
+    if (m_graphExec)
+        cudaGraphExecDestroy((cudaGraphExec_t) m_graphExec);
+    if (m_graph)
+        cudaGraphDestroy((cudaGraph_t) m_graph);
+#endif
+    m_graphExec = nullptr;
+    m_graph = nullptr;
+}
+
+/*static*/ bool GPUGraph::IsSupported()
+{
+#if CUDART_VERSION >= 10000
+    int runtimeVersion = 0, driverVersion = 0;
+    return cudaRuntimeGetVersion(&runtimeVersion) == cudaSuccess && runtimeVersion >= 10000 &&
+           cudaDriverGetVersion(&driverVersion) == cudaSuccess && driverVersion >= 10000;
+#else
+    return false;
+#endif
+}
+
+void GPUGraph::Run(const std::function<void()>& work)
+{
+    GraphStreamScope scope(m_deviceId);
+    work();
+}
+
+bool GPUGraph::Capture(const std::function<void()>& work)
+{
+    Reset();
+#if CUDART_VERSION >= 10000
+    GraphStreamScope scope(m_deviceId);
+    cudaStream_t stream = scope.Stream();
+#if CUDART_VERSION >= 10010
+    // other threads may keep using the GPU meanwhile, only unsafe calls of this thread invalidate the recording
+    CUDA_CALL(cudaStreamBeginCapture(stream, cudaStreamCaptureModeThreadLocal));
+#else
+    CUDA_CALL(cudaStreamBeginCapture(stream));
+#endif
+
+    cudaGraph_t graph = nullptr;
+    try
+    {
+        work();
+    }
+    catch (...)
+    {
+        // The failed call that invalidated the recording surfaces as an exception. Anything else is a real error.
+        cudaStreamCaptureStatus status = cudaStreamCaptureStatusNone;
+        cudaStreamIsCapturing(stream, &status);
+        cudaStreamEndCapture(stream, &graph);
+        if (graph)
+            cudaGraphDestroy(graph);
+        cudaGetLastError(); // clear the sticky error of the failed call
+        if (status == cudaStreamCaptureStatusInvalidated)
+            return false;
+        throw;
+    }
+
+    if (cudaStreamEndCapture(stream, &graph) != cudaSuccess || !graph)
+    {
+        if (graph)
+            cudaGraphDestroy(graph);
+        cudaGetLastError();
+        return false;
+    }
+    m_graph = graph;
+    cudaGraphExec_t graphExec;
+#if CUDART_VERSION >= 12000
+    CUDA_CALL(cudaGraphInstantiate(&graphExec, graph, 0));
+#else
+    CUDA_CALL(cudaGraphInstantiate(&graphExec, graph, nullptr, nullptr, 0));
+#endif
+    m_graphExec = graphExec;
+
+    // nothing was executed while recording
+    CUDA_CALL(cudaGraphLaunch(graphExec, stream));
+    return true;
+#else
+    UNUSED(work);
+    return false;
+#endif
+}
+
+void GPUGraph::Replay()
+{
+    if (!IsCaptured())
+        LogicError("GPUGraph::Replay: Nothing was captured.");
+#if CUDART_VERSION >= 10000
+    PrepareDevice(m_deviceId);
+    CUDA_CALL(cudaGraphLaunch((cudaGraphExec_t) m_graphExec, GetGraphStream(m_deviceId)));
+#endif
+}
+
+}}}
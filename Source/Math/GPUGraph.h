@@ -0,0 +1,58 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// GPUGraph.h -- records the GPU work of a piece of host code once and replays it with a single launch (CUDA graphs)
+//
+#pragma once
+
+#include "CommonMatrix.h"
+#include <functional>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// GPUGraph -- a recorded sequence of GPU work.
+//
+// Run() and Capture() issue the work of the given host function on a stream owned by this class (one per device,
+// shared by all graphs, so that they execute in order), by redirecting the stream of the GPU routines (see
+// SetStream()) and of cuDNN. That stream synchronizes with the legacy default stream like any blocking stream,
+// so work issued elsewhere needs no extra synchronization.
+//
+// Capture() records the work into a graph and launches it once. Work that cannot be recorded, e.g. a
+// synchronous copy, an allocation from the driver or any use of the legacy default stream, invalidates the
+// recording; then Capture() returns false and nothing was executed, so the caller must undo the host-side
+// effects of the function and run it again. Replay() launches the recorded work again, with the same
+// arguments; in particular, on the same buffers.
+//
+// The stream is also what the caching allocator keys its free lists on (see GPUCachingAllocator), so a
+// Run() before Capture() lets the temporary blocks of the work be cached for the stream.
+// -----------------------------------------------------------------------
+
+class MATH_API GPUGraph
+{
+public:
+    GPUGraph(DEVICEID_TYPE deviceId);
+    ~GPUGraph();
+
+    void Run(const std::function<void()>& work);
+    bool Capture(const std::function<void()>& work);
+    void Replay();
+
+    bool IsCaptured() const { return m_graphExec != nullptr; }
+
+    // whether this build and its CUDA runtime support capturing
+    static bool IsSupported();
+
+private:
+    GPUGraph(const GPUGraph&) = delete;
+    GPUGraph& operator=(const GPUGraph&) = delete;
+
+    void Reset();
+
+    DEVICEID_TYPE m_deviceId;
+    void* m_graph;     // cudaGraph_t
+    void* m_graphExec; // cudaGraphExec_t
+};
+
+}}}
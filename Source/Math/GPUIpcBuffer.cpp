@@ -0,0 +1,103 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "GPUIpcBuffer.h"
+#include "BestGpu.h" // for CPUONLY
+#ifndef CPUONLY
+#include <cuda_runtime_api.h>
+#endif
+#include <string.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+#ifndef CPUONLY
+
+static_assert(sizeof(cudaIpcMemHandle_t) == GPUIpcHandle::Size, "GPUIpcHandle does not match cudaIpcMemHandle_t");
+
+inline static void CheckCudaReturnCode(cudaError_t rc, const char* msg)
+{
+    if (rc != cudaSuccess)
+        RuntimeError("%s: %s (cuda error %d)", msg, cudaGetErrorString(rc), (int)rc);
+}
+
+// makes a device current for the lifetime of the object, and restores the previous one afterwards
+class CurrentDeviceScope
+{
+    int m_previousDeviceId;
+
+public:
+    CurrentDeviceScope(int deviceId) : m_previousDeviceId(-1)
+    {
+        CheckCudaReturnCode(cudaGetDevice(&m_previousDeviceId), "Cannot get cuda device");
+        if (m_previousDeviceId != deviceId)
+            CheckCudaReturnCode(cudaSetDevice(deviceId), "Cannot set cuda device");
+    }
+    ~CurrentDeviceScope()
+    {
+        cudaSetDevice(m_previousDeviceId);
+    }
+};
+
+/*static*/ std::shared_ptr<GPUIpcBuffer> GPUIpcBuffer::Allocate(int deviceId, size_t numBytes)
+{
+    CurrentDeviceScope scope(deviceId);
+    void* data = nullptr;
+    CheckCudaReturnCode(cudaMalloc(&data, numBytes), "GPUIpcBuffer: cudaMalloc failed");
+    return std::shared_ptr<GPUIpcBuffer>(new GPUIpcBuffer(deviceId, data, numBytes, /*isOwner=*/true));
+}
+
+/*static*/ std::shared_ptr<GPUIpcBuffer> GPUIpcBuffer::Open(int deviceId, const GPUIpcHandle& handle, size_t numBytes)
+{
+    CurrentDeviceScope scope(deviceId);
+    cudaIpcMemHandle_t cudaHandle;
+    memcpy(&cudaHandle, handle.m_bytes, sizeof(cudaHandle));
+    void* data = nullptr;
+    CheckCudaReturnCode(cudaIpcOpenMemHandle(&data, cudaHandle, cudaIpcMemLazyEnablePeerAccess), "GPUIpcBuffer: cudaIpcOpenMemHandle failed");
+    return std::shared_ptr<GPUIpcBuffer>(new GPUIpcBuffer(deviceId, data, numBytes, /*isOwner=*/false));
+}
+
+GPUIpcBuffer::~GPUIpcBuffer()
+{
+    // errors are ignored, since the CUDA runtime may already be shut down
+    CurrentDeviceScope scope(m_deviceId);
+    if (m_isOwner)
+        cudaFree(m_data);
+    else
+        cudaIpcCloseMemHandle(m_data);
+}
+
+GPUIpcHandle GPUIpcBuffer::GetHandle() const
+{
+    CurrentDeviceScope scope(m_deviceId);
+    CheckCudaReturnCode(cudaDeviceSynchronize(), "GPUIpcBuffer: cudaDeviceSynchronize failed");
+    cudaIpcMemHandle_t cudaHandle;
+    CheckCudaReturnCode(cudaIpcGetMemHandle(&cudaHandle, m_data), "GPUIpcBuffer: cudaIpcGetMemHandle failed");
+    GPUIpcHandle handle;
+    memcpy(handle.m_bytes, &cudaHandle, sizeof(cudaHandle));
+    return handle;
+}
+
+#else
+// Dummy definitions when compiling for CPUONLY
+/*static*/ std::shared_ptr<GPUIpcBuffer> GPUIpcBuffer::Allocate(int, size_t)
+{
+    RuntimeError("GPUIpcBuffer: GPU memory is not supported by a CPU-only build.");
+}
+
+/*static*/ std::shared_ptr<GPUIpcBuffer> GPUIpcBuffer::Open(int, const GPUIpcHandle&, size_t)
+{
+    RuntimeError("GPUIpcBuffer: GPU memory is not supported by a CPU-only build.");
+}
+
+GPUIpcBuffer::~GPUIpcBuffer()
+{
+}
+
+GPUIpcHandle GPUIpcBuffer::GetHandle() const
+{
+    return GPUIpcHandle();
+}
+#endif
+}}}
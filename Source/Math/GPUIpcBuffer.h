@@ -0,0 +1,62 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// GPUIpcBuffer.h -- device memory shared between the processes on one host through CUDA IPC
+//
+#pragma once
+
+#include "CommonMatrix.h" // for MATH_API
+#include <memory>
+#include <stddef.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// The handle that identifies a GPUIpcBuffer in other processes (the bytes of a cudaIpcMemHandle_t).
+struct GPUIpcHandle
+{
+    static const size_t Size = 64;
+    char m_bytes[Size];
+};
+
+// A device buffer that one process allocates and publishes by its handle, and that other processes on the same host
+// map into their address space with Open(). The memory is released when the allocating process frees it, so that
+// process must keep the buffer until the others have closed it.
+//
+// The buffer is allocated with cudaMalloc, not through the caching allocator, since IPC handles refer to whole
+// allocations and a cached block could be handed out again while it is still mapped elsewhere.
+class MATH_API GPUIpcBuffer
+{
+public:
+    // allocates numBytes on the device
+    static std::shared_ptr<GPUIpcBuffer> Allocate(int deviceId, size_t numBytes);
+
+    // maps the buffer of another process on the device; the mapping is closed with the last reference
+    static std::shared_ptr<GPUIpcBuffer> Open(int deviceId, const GPUIpcHandle& handle, size_t numBytes);
+
+    ~GPUIpcBuffer();
+
+    // The handle for Open() in other processes. Waits for the work queued on the device, so that the other
+    // processes see what has been written into the buffer so far.
+    GPUIpcHandle GetHandle() const;
+
+    void* Data() const { return m_data; }
+    size_t Size() const { return m_numBytes; }
+    int GetDeviceId() const { return m_deviceId; }
+    bool IsOwner() const { return m_isOwner; }
+
+private:
+    GPUIpcBuffer(int deviceId, void* data, size_t numBytes, bool isOwner)
+        : m_deviceId(deviceId), m_data(data), m_numBytes(numBytes), m_isOwner(isOwner)
+    {
+    }
+    GPUIpcBuffer(const GPUIpcBuffer&) = delete;
+    GPUIpcBuffer& operator=(const GPUIpcBuffer&) = delete;
+
+    int m_deviceId;
+    void* m_data;
+    size_t m_numBytes;
+    bool m_isOwner; // allocated by this process (freed) rather than mapped from another (closed)
+};
+
+}}}
@@ -15,6 +15,7 @@
 //#include "GPUSparseMatrix.h"
 #include "GPUTensor.h"
 #include "CommonMatrix.h"
+#include "CUDAPageLockedMemAllocator.h"
 #define TENSOR_OPS_DECL __device__ __host__
 #include "TensorOps.h"
 #include "device_launch_parameters.h"
@@ -25,9 +26,16 @@
 #include "cublas_v2.h"
 #include <assert.h>
 #include <memory>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
 #include "CntkBatchNormalization.cuh"
 #include "Convolution.cuh"
 #include "CuDnnRNN.h"
+#include "GPUCachingAllocator.h"
+#include "GPUStreamContext.h"
 
 #pragma comment(lib, "cudart.lib") // instruct linker to reference these libs
 #pragma comment(lib, "cublas.lib")
@@ -42,11 +50,8 @@
 
 #define UNCONST(t, c, uc) GPUMatrix<t>& uc = const_cast<GPUMatrix<t>&>(c);
 
-#ifdef _WIN32
 // thread local storage to access the current stream, initialize to default stream
-__declspec(thread)
-#endif
-    cudaStream_t t_stream = cudaStreamDefault;
+THREAD_LOCAL cudaStream_t t_stream = cudaStreamDefault;
 
 #define DEFAULT_THREAD_PER_DIM 16
 
@@ -208,10 +213,14 @@ template <typename AllocatedElemType>
 void TracingGPUMemoryAllocator::Free(int deviceId, AllocatedElemType* bufferPtr, bool ignoreCUDARetCode /*= false*/)
 {
     PrepareDevice(deviceId);
-    if (ignoreCUDARetCode)
-        cudaFree((void*) bufferPtr);
-    else
-        CUDA_CALL(cudaFree((void*) bufferPtr));
+    // Blocks handed out by the caching allocator go back to it (and are kept there if caching is still enabled).
+    if (!GPUCachingAllocator::GetInstance(deviceId).Free((void*) bufferPtr, IsCachingEnabled(), ignoreCUDARetCode))
+    {
+        if (ignoreCUDARetCode)
+            cudaFree((void*) bufferPtr);
+        else
+            CUDA_CALL(cudaFree((void*) bufferPtr));
+    }
 
     if (IsTraceEnabled())
     {
@@ -231,11 +240,31 @@ AllocatedElemType* TracingGPUMemoryAllocator::AllocateNoTrace(int deviceId, size
     // In case numElements is odd we allocate a buffer with one more element. The reason is
     // we might call curandGenerateNormal (e.g. for Gaussian noise injection) which would fail
     // if the number of elements it needs to generate is odd.
-    CUDA_CALL(cudaMalloc((void**) &deviceBufferPtr, sizeof(AllocatedElemType) * AsMultipleOf(numElements, 2)));
+    size_t numBytes = sizeof(AllocatedElemType) * AsMultipleOf(numElements, 2);
+    CountMatrixStorageAllocation();
+    if (IsCachingEnabled())
+        deviceBufferPtr = (AllocatedElemType*) GPUCachingAllocator::GetInstance(deviceId).Allocate(numBytes, GetStream());
+    else
+        CUDA_CALL(cudaMalloc((void**) &deviceBufferPtr, numBytes));
 
     return deviceBufferPtr;
 }
 
+void TracingGPUMemoryAllocator::EmptyCache(int deviceId)
+{
+    GPUCachingAllocator::GetInstance(deviceId).EmptyCache();
+}
+
+GPUMemoryCacheStats TracingGPUMemoryAllocator::GetCacheStats(int deviceId)
+{
+    return GPUCachingAllocator::GetInstance(deviceId).GetStats();
+}
+
+void TracingGPUMemoryAllocator::ResetPeakStats(int deviceId)
+{
+    GPUCachingAllocator::GetInstance(deviceId).ResetPeakStats();
+}
+
 std::pair<size_t, size_t> TracingGPUMemoryAllocator::GetFreeAndTotalMemoryInMBs(int deviceId)
 {
     PrepareDevice(deviceId);
@@ -259,6 +288,20 @@ void PrepareDevice(DEVICEID_TYPE deviceId)
     currentDevice = deviceId;
 }
 
+// Copies between host and device in the order of the current stream (see GetStream()), and waits for the copy. On a
+// stream other than the legacy default stream, e.g. that of a GPUStreamContext, the copy does not wait for the work
+// of the other streams of the device.
+static void CopyOnCurrentStream(void* dst, const void* src, size_t numBytes, cudaMemcpyKind kind)
+{
+    if (t_stream == cudaStreamDefault)
+    {
+        CUDA_CALL(cudaMemcpy(dst, src, numBytes, kind));
+        return;
+    }
+    CUDA_CALL(cudaMemcpyAsync(dst, src, numBytes, kind, t_stream));
+    CUDA_CALL(cudaStreamSynchronize(t_stream));
+}
+
 #pragma region DeviceBoundNumber class
 
 template <class ElemType>
@@ -338,7 +381,7 @@ ElemType* GPUMatrix<ElemType>::CopyToArray() const
     {
         PrepareDevice();
         ElemType* pArray = new ElemType[numElements];
-        CUDA_CALL(cudaMemcpy(pArray, Data(), sizeof(ElemType) * m_numRows * m_numCols, cudaMemcpyDeviceToHost));
+        CopyOnCurrentStream(pArray, Data(), sizeof(ElemType) * m_numRows * m_numCols, cudaMemcpyDeviceToHost);
         return pArray;
     }
     else
@@ -364,7 +407,7 @@ size_t GPUMatrix<ElemType>::CopyToArray(ElemType*& arrayCopyTo, size_t& currentA
     if (numElements != 0)
     {
         PrepareDevice();
-        CUDA_CALL(cudaMemcpy(arrayCopyTo, Data(), sizeof(ElemType) * numElements, cudaMemcpyDeviceToHost));
+        CopyOnCurrentStream(arrayCopyTo, Data(), sizeof(ElemType) * numElements, cudaMemcpyDeviceToHost);
     }
 
     return numElements;
@@ -373,8 +416,15 @@ size_t GPUMatrix<ElemType>::CopyToArray(ElemType*& arrayCopyTo, size_t& currentA
 template <class ElemType>
 void GPUMatrix<ElemType>::CopySection(size_t numRows, size_t numCols, ElemType* dst, size_t colStride) const
 {
-    CUBLAS_CALL(cublasGetMatrix((int) numRows, (int) numCols, sizeof(ElemType),
-                                Data(), (int) GetNumRows(), dst, (int) colStride));
+    if (t_stream == cudaStreamDefault)
+    {
+        CUBLAS_CALL(cublasGetMatrix((int) numRows, (int) numCols, sizeof(ElemType),
+                                    Data(), (int) GetNumRows(), dst, (int) colStride));
+        return;
+    }
+    CUBLAS_CALL(cublasGetMatrixAsync((int) numRows, (int) numCols, sizeof(ElemType),
+                                     Data(), (int) GetNumRows(), dst, (int) colStride, t_stream));
+    CUDA_CALL(cudaStreamSynchronize(t_stream));
 }
 template <class ElemType>
 void GPUMatrix<ElemType>::ChangeDeviceTo(DEVICEID_TYPE to_id)
@@ -414,14 +464,13 @@ void GPUMatrix<ElemType>::ChangeDeviceTo(DEVICEID_TYPE to_id)
 #endif
         {
             // peer access didn't work, just copy normal
-            // make this more efficient by keeping some buffers available for each copy
-            ElemType* h_dst = NULL;
+            // the staging buffer comes from the pool of page-locked memory, see CUDAPageLockedMemAllocator
             PrepareDevice();
-            CUDA_CALL(cudaMallocHost((void**) &h_dst, sizeof(ElemType) * m_numRows * m_numCols));
+            ElemType* h_dst = (ElemType*) CUDAPageLockedMemAllocator::Malloc(sizeof(ElemType) * m_numRows * m_numCols, GetComputeDeviceId());
             CUDA_CALL(cudaMemcpy(h_dst, Data(), sizeof(ElemType) * m_numRows * m_numCols, cudaMemcpyDeviceToHost));
             PrepareDevice((DEVICEID_TYPE) to_id);
             CUDA_CALL(cudaMemcpy(d_dst, h_dst, sizeof(ElemType) * m_numRows * m_numCols, cudaMemcpyHostToDevice));
-            CUDA_CALL(cudaFreeHost(h_dst));
+            CUDAPageLockedMemAllocator::Free(h_dst, to_id);
         }
     }
 
@@ -432,6 +481,127 @@ void GPUMatrix<ElemType>::ChangeDeviceTo(DEVICEID_TYPE to_id)
     SetComputeDeviceId(to_id);
 }
 
+// -----------------------------------------------------------------------
+// asynchronous copies between GPUs, see ChangeDeviceToAsync()
+// -----------------------------------------------------------------------
+
+static std::mutex s_peerCopyMutex;
+
+// Enables the access of 'to' to the memory of 'from' once, where the topology allows it. Without it, cudaMemcpyPeerAsync()
+// stages the copy through host memory, but is still asynchronous to the host.
+static void EnablePeerAccess(DEVICEID_TYPE from, DEVICEID_TYPE to) // call with s_peerCopyMutex held
+{
+    static std::set<std::pair<DEVICEID_TYPE, DEVICEID_TYPE>> s_tried;
+    if (!s_tried.insert(std::make_pair(from, to)).second)
+        return;
+    int canAccessPeer = 0;
+    if (cudaDeviceCanAccessPeer(&canAccessPeer, to, from) != cudaSuccess || !canAccessPeer)
+    {
+        cudaGetLastError();
+        return;
+    }
+    PrepareDevice(to);
+    cudaError_t status = cudaDeviceEnablePeerAccess(from, 0);
+    if (status != cudaSuccess && status != cudaErrorPeerAccessAlreadyEnabled)
+        fprintf(stderr, "WARNING: Cannot enable peer access of GPU %d to GPU %d (%s), copies between them go through host memory.\n", (int)to, (int)from, cudaGetErrorString(status));
+    cudaGetLastError(); // clear cudaErrorPeerAccessAlreadyEnabled
+}
+
+// the stream of the copies from a device, not synchronizing with the legacy default stream
+static cudaStream_t GetPeerCopyStream(DEVICEID_TYPE from) // call with s_peerCopyMutex held
+{
+    static std::map<DEVICEID_TYPE, cudaStream_t> s_streams; // never destroyed, like the caching allocators
+    auto& stream = s_streams[from];
+    if (!stream)
+    {
+        PrepareDevice(from);
+        CUDA_CALL(cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking));
+    }
+    return stream;
+}
+
+// source buffers of copies that may still be running, freed once their event has completed
+static std::vector<std::pair<cudaEvent_t, std::function<void()>>> s_pendingPeerCopyFrees;
+
+static void FreeCompletedPeerCopySources() // call with s_peerCopyMutex held
+{
+    auto iter = s_pendingPeerCopyFrees.begin();
+    while (iter != s_pendingPeerCopyFrees.end())
+    {
+        if (cudaEventQuery(iter->first) == cudaErrorNotReady)
+        {
+            ++iter;
+            continue;
+        }
+        cudaGetLastError();
+        iter->second();
+        cudaEventDestroy(iter->first);
+        iter = s_pendingPeerCopyFrees.erase(iter);
+    }
+}
+
+// Copies 'bytes' from device 'from' to device 'to' on the copy stream of 'from', ordered after all work queued so far on
+// the current stream (see GetStream()) of either device, and before all work queued from now on on the one of 'to'.
+// Returns the event of the completion of the copy.
+static cudaEvent_t PeerCopyAsync(void* dst, DEVICEID_TYPE to, const void* src, DEVICEID_TYPE from, size_t bytes)
+{
+    EnablePeerAccess(from, to);
+    cudaStream_t copyStream = GetPeerCopyStream(from);
+
+    // the destination may be memory that earlier work on 'to' is still using, e.g. when it comes from the caching allocator
+    cudaEvent_t sourceReady, destinationReady, done;
+    PrepareDevice(to);
+    CUDA_CALL(cudaEventCreateWithFlags(&destinationReady, cudaEventDisableTiming));
+    CUDA_CALL(cudaEventRecord(destinationReady, GetStream()));
+    PrepareDevice(from);
+    CUDA_CALL(cudaEventCreateWithFlags(&sourceReady, cudaEventDisableTiming));
+    CUDA_CALL(cudaEventCreateWithFlags(&done, cudaEventDisableTiming));
+    CUDA_CALL(cudaEventRecord(sourceReady, GetStream()));
+    CUDA_CALL(cudaStreamWaitEvent(copyStream, sourceReady, 0));
+    CUDA_CALL(cudaStreamWaitEvent(copyStream, destinationReady, 0));
+    CUDA_CALL(cudaMemcpyPeerAsync(dst, to, src, from, bytes, copyStream));
+    CUDA_CALL(cudaEventRecord(done, copyStream));
+    CUDA_CALL(cudaEventDestroy(sourceReady)); // released once the waits are done
+    CUDA_CALL(cudaEventDestroy(destinationReady));
+
+    PrepareDevice(to);
+    CUDA_CALL(cudaStreamWaitEvent(GetStream(), done, 0));
+    return done;
+}
+
+// Same as ChangeDeviceTo(), but without waiting for the copy: the host returns as soon as the copy is queued, and the GPU
+// work on the new device that is queued afterwards (on the current stream) waits for its completion. The old buffer is freed
+// once the copy has completed, by a later call.
+template <class ElemType>
+void GPUMatrix<ElemType>::ChangeDeviceToAsync(DEVICEID_TYPE to_id)
+{
+    if (to_id == CPUDEVICE)
+        LogicError("to_id must be valid GPU");
+    const DEVICEID_TYPE from_id = GetComputeDeviceId();
+    if (from_id == to_id)
+        return;
+
+    std::lock_guard<std::mutex> lock(s_peerCopyMutex);
+    FreeCompletedPeerCopySources();
+
+    const size_t numElements = m_numRows * m_numCols;
+    ElemType* d_dst = TracingGPUMemoryAllocator::Allocate<ElemType>(to_id, m_numRows, m_numCols);
+    SetSizeAllocated(numElements);
+
+    ElemType* buffer = Buffer();
+    if (numElements > 0)
+    {
+        cudaEvent_t done = PeerCopyAsync(d_dst, to_id, Data(), from_id, sizeof(ElemType) * numElements);
+        s_pendingPeerCopyFrees.push_back(std::make_pair(done, [from_id, buffer]() { TracingGPUMemoryAllocator::Free<ElemType>(from_id, buffer); }));
+    }
+    else
+        TracingGPUMemoryAllocator::Free<ElemType>(from_id, buffer);
+    SetBuffer(d_dst, numElements * sizeof(ElemType));
+
+    PrepareDevice((DEVICEID_TYPE) to_id);
+    SetComputeDeviceId(to_id);
+}
+
 template <class ElemType>
 template <class ElemType2>
 void GPUMatrix<ElemType>::CastAssignValuesOf(const GPUMatrix<ElemType2>* other)
@@ -917,10 +1087,22 @@ cublasHandle_t GPUMatrix<ElemType>::GetCublasHandle(int computeDevice /*=-1*/)
 
     if (computeDevice < 0 || computeDevice >= MaxGpus)
         LogicError("GetCublasHandle: Maximum GPU exceeded");
-    cublasHandle_t cuHandle = s_cuHandle[computeDevice];
-    if (cuHandle == NULL)
+    // a thread in a GPUStreamContext of the device has a handle of its own, so that other threads do not change its stream
+    GPUStreamContext* context = GPUStreamContext::Current();
+    cublasHandle_t cuHandle;
+    if (context && context->GetDeviceId() == computeDevice)
+    {
+        cuHandle = (cublasHandle_t) context->CublasHandle();
+        if (cuHandle == NULL)
+            context->CublasHandle() = cuHandle = _initCUBLAS<ElemType>(computeDevice);
+    }
+    else
     {
-        s_cuHandle[computeDevice] = cuHandle = _initCUBLAS<ElemType>(computeDevice);
+        cuHandle = s_cuHandle[computeDevice];
+        if (cuHandle == NULL)
+        {
+            s_cuHandle[computeDevice] = cuHandle = _initCUBLAS<ElemType>(computeDevice);
+        }
     }
     CUBLAS_CALL(cublasSetStream(cuHandle, t_stream));
 
@@ -1012,6 +1194,69 @@ GPUMatrix<ElemType>& GPUMatrix<ElemType>::DoGatherColumnsOf(ElemType beta, const
     return *this;
 }
 
+__device__ __forceinline__ float _dequantizedValue(char code) { return (float)(signed char)code; }
+__device__ __forceinline__ float _dequantizedValue(half code) { return (float)code; }
+
+// Each thread computes one element of the output, reading one code of the gathered column; see Matrix::AssignDequantizedColumnsOf().
+template <class ElemType, class QuantizedType>
+__global__ void _assignDequantizedColumnsOf(ElemType* us, const ElemType* idx, size_t idxStride, const QuantizedType* codes, size_t numRows,
+                                            const ElemType* scalesAndOffsets, CUDA_LONG numElements)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    CUDA_LONG id = GridDim::GetLinearThreadId();
+    if (id >= numElements)
+        return;
+
+    CUDA_LONG i    = id % numRows;
+    CUDA_LONG jOut = id / numRows;
+
+    comp_t jInF = idx[jOut * idxStride];
+    if (isnan_(jInF) || jInF < 0) // negative index means gap
+    {
+        us[id] = 0;
+        return;
+    }
+    size_t jIn = (size_t)jInF;
+    float scale  = (float)scalesAndOffsets[2 * jIn];
+    float offset = (float)scalesAndOffsets[2 * jIn + 1];
+    us[id] = (ElemType)(_dequantizedValue(codes[i + jIn * numRows]) * scale + offset);
+}
+
+template <class ElemType, class QuantizedType>
+static void AssignDequantizedColumns(GPUMatrix<ElemType>& us, const GPUMatrix<ElemType>& idx, const GPUMatrix<QuantizedType>& codes, const GPUMatrix<ElemType>& scalesAndOffsets)
+{
+    if (idx.GetNumRows() != 1) // index is 1-dimensional only
+        InvalidArgument("AssignDequantizedColumnsOf: Map must be a row vector.");
+    if (scalesAndOffsets.GetNumRows() != 2 || scalesAndOffsets.GetNumCols() != codes.GetNumCols())
+        InvalidArgument("AssignDequantizedColumnsOf: There must be a scale and an offset for each column of the codes.");
+    if (idx.GetComputeDeviceId() != codes.GetComputeDeviceId() || scalesAndOffsets.GetComputeDeviceId() != codes.GetComputeDeviceId() || us.GetComputeDeviceId() != codes.GetComputeDeviceId())
+        InvalidArgument("All matrices must be on the same GPU");
+
+    us.RequireSize(codes.GetNumRows(), idx.GetNumCols());
+    CUDA_LONG N = (CUDA_LONG)us.GetNumElements();
+    if (N == 0)
+        return;
+    codes.PrepareDevice();
+    SyncGuard syncGuard;
+    GridDim grid(N);
+    _assignDequantizedColumnsOf<ElemType, QuantizedType><<<grid.m_blocksPerGrid, grid.m_threadsPerBlock, 0, t_stream>>>(us.Data(), idx.Data(), idx.GetNumRows(), codes.Data(), codes.GetNumRows(),
+                                                                                                                       scalesAndOffsets.Data(), grid.m_N);
+}
+
+template <class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignDequantizedColumnsOf(const GPUMatrix<ElemType>& idx, const GPUMatrix<char>& codes, const GPUMatrix<ElemType>& scalesAndOffsets)
+{
+    AssignDequantizedColumns(*this, idx, codes, scalesAndOffsets);
+    return *this;
+}
+
+template <class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignDequantizedColumnsOf(const GPUMatrix<ElemType>& idx, const GPUMatrix<half>& codes, const GPUMatrix<ElemType>& scalesAndOffsets)
+{
+    AssignDequantizedColumns(*this, idx, codes, scalesAndOffsets);
+    return *this;
+}
+
 // little helper for debugging
 template <class ElemType>
 static void Peek(const GPUMatrix<ElemType>& m, const char* which)
@@ -1104,7 +1349,8 @@ GPUMatrix<ElemType>& GPUMatrix<ElemType>::DoScatterColumnsOf(ElemType beta, cons
 
     // pre-scale with beta upfront
     // Scatter may add more than one source column to the same target, so we must pre-scale with beta, and then just keep adding.
-    Scale(beta, us); // if beta is 0, then this will be a memset()
+    if (beta != 1) // e.g. adding into some columns of a large parameter leaves the others as they are
+        Scale(beta, us); // if beta is 0, then this will be a memset()
 
     // launch the kernel
     CUDA_LONG NN = (CUDA_LONG)(a.GetNumElements()); // linear space identifying each individual input element
@@ -1118,6 +1364,127 @@ GPUMatrix<ElemType>& GPUMatrix<ElemType>::DoScatterColumnsOf(ElemType beta, cons
     return *this;
 }
 
+// Each thread reduces one row of one segment, so that the threads of a warp read consecutive elements of each column.
+template <class ElemType>
+__global__ void _assignSegmentedReductionOf(ElemType* us, const ElemType* a, size_t numRows, const ElemType* segments, size_t columnStride, ElementWiseOperator reductionOp, bool average, CUDA_LONG numElements)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    CUDA_LONG id = GridDim::GetLinearThreadId();
+    if (id >= numElements)
+        return;
+
+    CUDA_LONG i = id % numRows; // row index
+    CUDA_LONG j = id / numRows; // segment index
+    size_t first  = (size_t)(comp_t)segments[2 * j];
+    size_t length = (size_t)(comp_t)segments[2 * j + 1];
+
+    const ElemType* pa = a + i + first * numRows;
+    const size_t step = columnStride * numRows;
+    comp_t res = length > 0 ? (comp_t)pa[0] : (comp_t)0; // empty segments reduce to 0
+    for (size_t k = 1; k < length; k++)
+    {
+        comp_t val = (comp_t)pa[k * step];
+        switch (reductionOp)
+        {
+        case ElementWiseOperator::opSum:    res += val;                    break;
+        case ElementWiseOperator::opLogSum: res = LogAdd(res, val);        break;
+        case ElementWiseOperator::opMin:    res = val < res ? val : res;   break;
+        case ElementWiseOperator::opMax:    res = val > res ? val : res;   break;
+        }
+    }
+    if (average && reductionOp == ElementWiseOperator::opSum && length > 0)
+        res /= (comp_t)length;
+    us[id] = res;
+}
+
+// *this[:,j] = reduce_k a[:,first_j + k * columnStride], see Matrix<ElemType>::AssignSegmentedReductionOf()
+template <class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignSegmentedReductionOf(const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& segments, size_t columnStride, ElementWiseOperator reductionOp, bool average)
+{
+    if (segments.GetNumRows() != 2)
+        InvalidArgument("AssignSegmentedReductionOf: Segments must be given as a 2 x N matrix of first columns and lengths.");
+    if (reductionOp != ElementWiseOperator::opSum && reductionOp != ElementWiseOperator::opLogSum &&
+        reductionOp != ElementWiseOperator::opMin && reductionOp != ElementWiseOperator::opMax)
+        InvalidArgument("AssignSegmentedReductionOf: Only opSum, opLogSum, opMin and opMax are supported.");
+    if (segments.GetComputeDeviceId() != a.GetComputeDeviceId())
+        InvalidArgument("All matrices must be on the same GPU");
+
+    RequireSize(a.GetNumRows(), segments.GetNumCols());
+    if (IsEmpty())
+        return *this;
+
+    a.PrepareDevice();
+    CUDA_LONG N = (CUDA_LONG)GetNumElements();
+    SyncGuard syncGuard;
+    GridDim grid(N);
+    _assignSegmentedReductionOf<ElemType><<<grid.m_blocksPerGrid, grid.m_threadsPerBlock, 0, t_stream>>>(Data(), a.Data(), a.GetNumRows(), segments.Data(), columnStride, reductionOp, average, N);
+    return *this;
+}
+
+// Each thread broadcasts one row of one segment back to its columns. Each column belongs to at most one segment, so no atomics are needed.
+template <class ElemType>
+__global__ void _doSegmentedReductionGradientOf(ElemType* us, const ElemType beta, const ElemType* outputGradient, const ElemType* input, const ElemType* output, size_t numRows,
+                                                const ElemType* segments, size_t columnStride, ElementWiseOperator reductionOp, bool average, CUDA_LONG numElements)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    CUDA_LONG id = GridDim::GetLinearThreadId();
+    if (id >= numElements)
+        return;
+
+    CUDA_LONG i = id % numRows; // row index
+    CUDA_LONG j = id / numRows; // segment index
+    size_t first  = (size_t)(comp_t)segments[2 * j];
+    size_t length = (size_t)(comp_t)segments[2 * j + 1];
+
+    comp_t grad = (comp_t)outputGradient[id];
+    comp_t out = (reductionOp != ElementWiseOperator::opSum) ? (comp_t)output[id] : 0;
+    if (average && reductionOp == ElementWiseOperator::opSum && length > 0)
+        grad /= (comp_t)length;
+
+    const size_t step = columnStride * numRows;
+    size_t offset = i + first * numRows;
+    for (size_t k = 0; k < length; k++, offset += step)
+    {
+        comp_t g;
+        switch (reductionOp)
+        {
+        case ElementWiseOperator::opLogSum: g = grad * exp_((comp_t)input[offset] - out);        break;
+        case ElementWiseOperator::opMin:
+        case ElementWiseOperator::opMax:    g = (comp_t)input[offset] == out ? grad : (comp_t)0; break;
+        default:                            g = grad;                                            break;
+        }
+        if (beta != 0)
+            g += (comp_t)beta * (comp_t)us[offset];
+        us[offset] = g;
+    }
+}
+
+// *this[:,first_j + k * columnStride] = beta * *this[:,first_j + k * columnStride] + d reduce / d a * outputGradient[:,j]
+template <class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::DoSegmentedReductionGradientOf(ElemType beta, const GPUMatrix<ElemType>& outputGradient, const GPUMatrix<ElemType>& input, const GPUMatrix<ElemType>& output,
+                                                                         const GPUMatrix<ElemType>& segments, size_t columnStride, ElementWiseOperator reductionOp, bool average)
+{
+    if (segments.GetNumRows() != 2 || segments.GetNumCols() != outputGradient.GetNumCols())
+        InvalidArgument("DoSegmentedReductionGradientOf: Segments must be given as a 2 x N matrix of first columns and lengths, one for each output column.");
+    if (GetNumRows() != outputGradient.GetNumRows())
+        InvalidArgument("DoSegmentedReductionGradientOf: The gradient must have the same height as the output gradient.");
+    if (reductionOp != ElementWiseOperator::opSum &&
+        (input.GetNumRows() != GetNumRows() || input.GetNumCols() != GetNumCols() || output.GetNumRows() != GetNumRows() || output.GetNumCols() != outputGradient.GetNumCols()))
+        InvalidArgument("DoSegmentedReductionGradientOf: The input and output values must have the dimensions of their gradients.");
+    if (segments.GetComputeDeviceId() != GetComputeDeviceId() || outputGradient.GetComputeDeviceId() != GetComputeDeviceId())
+        InvalidArgument("All matrices must be on the same GPU");
+    if (outputGradient.IsEmpty())
+        return *this;
+
+    PrepareDevice();
+    CUDA_LONG N = (CUDA_LONG)outputGradient.GetNumElements();
+    SyncGuard syncGuard;
+    GridDim grid(N);
+    _doSegmentedReductionGradientOf<ElemType><<<grid.m_blocksPerGrid, grid.m_threadsPerBlock, 0, t_stream>>>(Data(), beta, outputGradient.Data(), input.Data(), output.Data(), GetNumRows(),
+                                                                                                               segments.Data(), columnStride, reductionOp, average, N);
+    return *this;
+}
+
 template <class ElemType>
 void GPUMatrix<ElemType>::SetValue(const ElemType v)
 {
@@ -1141,7 +1508,8 @@ void GPUMatrix<ElemType>::SetValue(const ElemType v)
 
     if (isZero)
     {
-        CUDA_CALL(cudaMemset(Data(), 0, N * sizeof(ElemType)));
+        // on the stream of the other GPU routines, so that it can be recorded into a GPUGraph
+        CUDA_CALL(cudaMemsetAsync(Data(), 0, N * sizeof(ElemType), t_stream));
     }
     else
     {
@@ -1273,7 +1641,7 @@ void GPUMatrix<ElemType>::SetValue(const size_t numRows, const size_t numCols, i
                 if (transferer)
                     transferer->CopyCPUToGPUAsync(pArray, GetNumElements(), sizeof(ElemType), Data());
                 else
-                    CUDA_CALL(cudaMemcpy(Data(), pArray, sizeof(ElemType) * GetNumElements(), (matrixFlags & matrixFlagSetValueOnDevice) ? cudaMemcpyDeviceToDevice : cudaMemcpyHostToDevice));
+                    CopyOnCurrentStream(Data(), pArray, sizeof(ElemType) * GetNumElements(), (matrixFlags & matrixFlagSetValueOnDevice) ? cudaMemcpyDeviceToDevice : cudaMemcpyHostToDevice);
             }
             else // row major: must transpose (this is not meant to be efficient, but very useful for defining inline matrices for test code)
             {
@@ -1285,7 +1653,7 @@ void GPUMatrix<ElemType>::SetValue(const size_t numRows, const size_t numCols, i
                 if (transferer)
                     transferer->CopyCPUToGPUAsync(transposed.data(), GetNumElements(), sizeof(ElemType), Data());
                 else
-                    CUDA_CALL(cudaMemcpy(Data(), transposed.data(), sizeof(ElemType) * GetNumElements(), (matrixFlags & matrixFlagSetValueOnDevice) ? cudaMemcpyDeviceToDevice : cudaMemcpyHostToDevice));
+                    CopyOnCurrentStream(Data(), transposed.data(), sizeof(ElemType) * GetNumElements(), (matrixFlags & matrixFlagSetValueOnDevice) ? cudaMemcpyDeviceToDevice : cudaMemcpyHostToDevice);
             }
         }
     }
@@ -1561,6 +1929,134 @@ void GPUMatrix<ElemType>::Adam(GPUMatrix<ElemType>& gradients,
         learnRatePerSample, momentum, adaWeight, adaMul, epsilon, unitGainFactor, adamax);
 }
 
+// Cuts many tensors into the chunks of MultiTensorChunks and calls launch(chunks, numBlocks) for every MultiTensorChunks::MaxBlocks
+// chunks of up to MultiTensorChunks::MaxTensors tensors. 'parameters' and 'smoothedGradients' may be empty if the kernel does not use them.
+template <class ElemType, class LaunchFunction>
+static void LaunchMultiTensorChunks(const std::vector<ElemType*>& parameters, const std::vector<const ElemType*>& gradients, const std::vector<ElemType*>& smoothedGradients,
+                                    const std::vector<size_t>& sizes, const LaunchFunction& launch)
+{
+    typedef MultiTensorChunks<ElemType> Chunks;
+    Chunks chunks;
+    int numTensors = 0;
+    int numBlocks = 0;
+    auto flush = [&]()
+    {
+        if (numBlocks > 0)
+            launch(chunks, numBlocks);
+        numTensors = 0;
+        numBlocks = 0;
+    };
+
+    for (size_t i = 0; i < sizes.size(); i++)
+    {
+        const CUDA_LONG numChunks = (CUDA_LONG)((sizes[i] + Chunks::ChunkSize - 1) / Chunks::ChunkSize);
+        for (CUDA_LONG chunk = 0; chunk < numChunks; chunk++)
+        {
+            // a tensor enters a launch with its first chunk, or with its first chunk after a launch
+            if (chunk == 0 || numBlocks == 0)
+            {
+                if (numTensors == Chunks::MaxTensors)
+                    flush();
+                chunks.parameters[numTensors] = parameters.empty() ? nullptr : parameters[i];
+                chunks.gradients[numTensors] = gradients[i];
+                chunks.smoothedGradients[numTensors] = smoothedGradients.empty() ? nullptr : smoothedGradients[i];
+                chunks.sizes[numTensors] = (CUDA_LONG)sizes[i];
+                chunks.indices[numTensors] = (int)i;
+                numTensors++;
+            }
+            chunks.blockTensors[numBlocks] = (unsigned char)(numTensors - 1);
+            chunks.blockChunks[numBlocks] = chunk;
+            numBlocks++;
+            if (numBlocks == Chunks::MaxBlocks)
+                flush();
+        }
+    }
+    flush();
+}
+
+// Applies a learner update to many parameters with as few launches as possible, see LaunchMultiTensorChunks().
+// The sizes are verified by Matrix::MultiTensorUpdate().
+template <class ElemType>
+/*static*/ void GPUMatrix<ElemType>::MultiTensorUpdate(const MultiTensorUpdateParameters<ElemType>& update, const std::vector<GPUMatrix<ElemType>*>& parameters,
+                                                       const std::vector<const GPUMatrix<ElemType>*>& gradients, const std::vector<GPUMatrix<ElemType>*>& smoothedGradients)
+{
+    if (parameters.empty())
+        return;
+
+    parameters.front()->PrepareDevice();
+    const DEVICEID_TYPE deviceId = parameters.front()->GetComputeDeviceId();
+
+    std::vector<ElemType*> parameterData, smoothedGradientData;
+    std::vector<const ElemType*> gradientData;
+    std::vector<size_t> sizes;
+    for (size_t i = 0; i < parameters.size(); i++)
+    {
+        if (parameters[i]->GetComputeDeviceId() != deviceId || gradients[i]->GetComputeDeviceId() != deviceId || smoothedGradients[i]->GetComputeDeviceId() != deviceId)
+            InvalidArgument("All matrices must be on the same GPU");
+        parameterData.push_back(parameters[i]->Data());
+        gradientData.push_back(gradients[i]->Data());
+        smoothedGradientData.push_back(smoothedGradients[i]->Data());
+        sizes.push_back(parameters[i]->GetNumElements());
+    }
+
+    LaunchMultiTensorChunks<ElemType>(parameterData, gradientData, smoothedGradientData, sizes, [&](const MultiTensorChunks<ElemType>& chunks, int numBlocks)
+    {
+        SyncGuard syncGuard;
+        _multiTensorUpdate<ElemType><<<numBlocks, MultiTensorChunks<ElemType>::ThreadsPerBlock, 0, t_stream>>>(update, chunks);
+    });
+}
+
+// Sums of the squares of the elements of many matrices, computed by as few launches as possible (see LaunchMultiTensorChunks())
+// into a single accumulator, or one per matrix if 'perMatrix', which are copied to the host once.
+template <class ElemType>
+static std::vector<double> ReduceSumsOfSquares(const std::vector<const GPUMatrix<ElemType>*>& matrices, bool perMatrix)
+{
+    matrices.front()->PrepareDevice();
+    const DEVICEID_TYPE deviceId = matrices.front()->GetComputeDeviceId();
+
+    std::vector<const ElemType*> data;
+    std::vector<size_t> sizes;
+    for (const auto& matrix : matrices)
+    {
+        if (matrix->GetComputeDeviceId() != deviceId)
+            InvalidArgument("All matrices must be on the same GPU");
+        data.push_back(matrix->Data());
+        sizes.push_back(matrix->GetNumElements());
+    }
+
+    const size_t numSums = perMatrix ? matrices.size() : 1;
+    double* d_sums = TracingGPUMemoryAllocator::Allocate<double>(deviceId, numSums);
+    CUDA_CALL(cudaMemsetAsync(d_sums, 0, numSums * sizeof(double), t_stream));
+    LaunchMultiTensorChunks<ElemType>({}, data, {}, sizes, [&](const MultiTensorChunks<ElemType>& chunks, int numBlocks)
+    {
+        SyncGuard syncGuard;
+        _multiTensorSumOfSquares<ElemType><<<numBlocks, MultiTensorChunks<ElemType>::ThreadsPerBlock, 0, t_stream>>>(chunks, d_sums, perMatrix);
+    });
+
+    std::vector<double> h_sums(numSums);
+    CUDA_CALL(cudaMemcpy(h_sums.data(), d_sums, numSums * sizeof(double), cudaMemcpyDeviceToHost));
+    TracingGPUMemoryAllocator::Free<double>(deviceId, d_sums);
+    return h_sums;
+}
+
+template <class ElemType>
+/*static*/ ElemType GPUMatrix<ElemType>::MultiTensorSumOfSquares(const std::vector<const GPUMatrix<ElemType>*>& matrices)
+{
+    if (matrices.empty())
+        return 0;
+    return (ElemType)ReduceSumsOfSquares(matrices, /*perMatrix =*/ false).front();
+}
+
+template <class ElemType>
+/*static*/ void GPUMatrix<ElemType>::MultiTensorSumsOfSquares(const std::vector<const GPUMatrix<ElemType>*>& matrices, std::vector<ElemType>& sums)
+{
+    sums.clear();
+    if (matrices.empty())
+        return;
+    for (auto sum : ReduceSumsOfSquares(matrices, /*perMatrix =*/ true))
+        sums.push_back((ElemType)sum);
+}
+
 template <class ElemType>
 ElemType GPUMatrix<ElemType>::RmsProp(GPUMatrix<ElemType>& gradients,
                                       ElemType RMS_GAMMA,
@@ -1665,6 +2161,16 @@ void GPUMatrix<ElemType>::AdaDeltaFlushTimestamps(size_t cols, ElemType rho, int
     _adadeltaFlush<ElemType> << <blocksPerGrid, GridDim::maxThreadsPerBlock >> > (cols, rows, Data(), Data() + cols * rows, rho, timestamps, currentTimestamp);
 }
 
+template <class ElemType>
+void GPUMatrix<ElemType>::LazyDecayFlushTimestamps(size_t cols, ElemType decay, ElemType secondDecay, int* timestamps, int currentTimestamp)
+{
+    // Sets all timestamps to 0 and decays the state of the lazy sparse updates as a dense implementation would have,
+    // i.e. the first 'cols' columns by decay ** (currentTimestamp - timestamp of the column) and the next ones, if any, by secondDecay.
+    size_t rows = GetNumRows();
+    int blocksPerGrid = (cols + GridDim::maxThreadsPerBlock - 1) / GridDim::maxThreadsPerBlock;
+    _lazyDecayFlush<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock>>>(cols, rows, Data(), GetNumCols() >= 2 * cols, decay, secondDecay, timestamps, currentTimestamp);
+}
+
 template <class ElemType>
 void GPUMatrix<ElemType>::Reshape(const size_t numRows, const size_t numCols)
 {
@@ -2288,6 +2794,32 @@ GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignLogSoftmaxOf(const GPUMatrix<Ele
     return *this;
 }
 
+template <class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::InplaceSegmentedLogSoftmax(const std::vector<int>& segmentOffsets)
+{
+    const CUDA_LONG numSegments = (CUDA_LONG) segmentOffsets.size() - 1;
+    if (numSegments == 0)
+        return *this;
+
+    PrepareDevice();
+    SyncGuard syncGuard;
+
+    // ElemType count needed to store the offsets.
+    size_t coffsets = (segmentOffsets.size() * sizeof(int) + sizeof(ElemType) - 1) / sizeof(ElemType);
+    auto workspace = GetOrCreateWorkspace();
+    workspace->RequireSize(1, coffsets);
+    int* deviceOffsets = reinterpret_cast<int*>(workspace->Data());
+    CUDA_CALL(cudaMemcpyAsync(deviceOffsets, segmentOffsets.data(), segmentOffsets.size() * sizeof(int), cudaMemcpyHostToDevice, t_stream));
+
+    // note: kernel uses hard-coded thread dimension
+    _inplaceSegmentedLogSoftmax128Threads<ElemType><<<numSegments, 128, 0, t_stream>>>(Data(), deviceOffsets);
+    // The host buffer must stay valid until the copy is done.
+    CUDA_CALL(cudaStreamSynchronize(t_stream));
+
+    ReleaseWorkspace(std::move(workspace));
+    return *this;
+}
+
 template <class ElemType>
 GPUMatrix<ElemType>& GPUMatrix<ElemType>::InplaceHardmax(const bool isColWise)
 {
@@ -2495,6 +3027,42 @@ GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignSumOfElements(const GPUMatrix<El
     return (*this);
 }
 
+// The result stays on the device, so that the caller can copy the few numbers back when it needs them.
+template <class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignHistogramOf(const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& bucketLimits)
+{
+    if (a.IsEmpty())
+        LogicError("AssignHistogramOf: Matrix a is empty.");
+    if (a.GetComputeDeviceId() != bucketLimits.GetComputeDeviceId() || GetComputeDeviceId() != a.GetComputeDeviceId())
+        InvalidArgument("AssignHistogramOf: All matrices must be on the same GPU.");
+
+    const CUDA_LONG numLimits = (CUDA_LONG) bucketLimits.GetNumElements();
+    RequireSize(numLimits + 5, 1);
+
+    PrepareDevice();
+    const CUDA_LONG N = (CUDA_LONG) a.GetNumElements();
+    // enough blocks to fill the device; each thread strides over the rest
+    int blocksPerGrid = min(CeilDiv(N, _assignHistogramOfThreads), (int) GridDim::GetDeviceProps().multiProcessorCount * 8);
+    size_t sharedBytes = (numLimits + 1) * sizeof(unsigned int);
+    bool sharedCounts = sharedBytes <= 32 * 1024;
+    _initHistogram<ElemType><<<1, _assignHistogramOfThreads, 0, t_stream>>>(Data(), numLimits);
+    _assignHistogramOf<ElemType><<<blocksPerGrid, _assignHistogramOfThreads, sharedCounts ? sharedBytes : 0, t_stream>>>(
+        Data(), a.Data(), N, bucketLimits.Data(), numLimits, sharedCounts);
+    return *this;
+}
+
+// There is no atomic minimum, maximum or addition for half, nor atomic minimum or maximum for bfloat16.
+template <>
+GPUMatrix<half>& GPUMatrix<half>::AssignHistogramOf(const GPUMatrix<half>& /*a*/, const GPUMatrix<half>& /*bucketLimits*/)
+{
+    RuntimeError("AssignHistogramOf: Not supported for half on the GPU.");
+}
+template <>
+GPUMatrix<bfloat16>& GPUMatrix<bfloat16>::AssignHistogramOf(const GPUMatrix<bfloat16>& /*a*/, const GPUMatrix<bfloat16>& /*bucketLimits*/)
+{
+    RuntimeError("AssignHistogramOf: Not supported for bfloat16 on the GPU.");
+}
+
 template <class ElemType>
 DeviceBoundNumber<ElemType> GPUMatrix<ElemType>::Sum_AsDeviceBoundNum() const
 {
@@ -2962,6 +3530,13 @@ void GPUMatrix<ElemType>::VectorMax(GPUMatrix<ElemType>& maxIndexes, GPUMatrix<E
     maxValues.RequireSize(topK, n);
     maxIndexes.RequireSize(topK, n);
 
+    // A small k is selected in a single pass over each column, without sorting the matrix.
+    if (topK <= c_maxTopKSelect)
+    {
+        SelectTopK(maxIndexes, maxValues, nullptr, topK);
+        return;
+    }
+
     // To sort matrix columns we use 2-pass _stable_ sort algorithm:
     // 1. Sort by values (descending) with corresponding row/col indexes.
     // 2. Sort by col indices (ascending) with corresponding values/row indices.
@@ -3019,6 +3594,57 @@ void GPUMatrix<ElemType>::VectorMax(GPUMatrix<ElemType>& maxIndexes, GPUMatrix<E
 
 }
 
+// Launches _vectorTopKSelect() for topK <= c_maxTopKSelect, with the smallest list that holds topK entries.
+template <class ElemType>
+void GPUMatrix<ElemType>::SelectTopK(GPUMatrix<ElemType>& topIndexes, GPUMatrix<ElemType>& topValues, GPUMatrix<ElemType>* logSumExp, int topK) const
+{
+    const CUDA_LONG m = (CUDA_LONG) GetNumRows();
+    const int n = (int) GetNumCols();
+    const int ThreadsPerBlock = 256;
+    ElemType* lse = logSumExp ? logSumExp->Data() : nullptr;
+    if (topK <= 16)
+        _vectorTopKSelect<ElemType, 16, ThreadsPerBlock><<<n, ThreadsPerBlock, 0, t_stream>>>(Data(), topIndexes.Data(), topValues.Data(), lse, m, topK);
+    else
+        _vectorTopKSelect<ElemType, c_maxTopKSelect, ThreadsPerBlock><<<n, ThreadsPerBlock, 0, t_stream>>>(Data(), topIndexes.Data(), topValues.Data(), lse, m, topK);
+}
+
+// Column-wise top k of softmax(*this): the row indexes of the k largest elements of each column, their softmax probabilities,
+// and the log-sum-exp of each column. The probabilities of the other elements are not computed.
+template <class ElemType>
+void GPUMatrix<ElemType>::VectorTopKSoftmax(GPUMatrix<ElemType>& topIndexes, GPUMatrix<ElemType>& topValues, GPUMatrix<ElemType>& logSumExp, int topK) const
+{
+    if (IsEmpty())
+        LogicError("VectorTopKSoftmax: Matrix is empty.");
+    if (topK <= 0 || topK > GetNumRows())
+        InvalidArgument("VectorTopKSoftmax: TopK must be positive and less or equal than the number of rows");
+
+    const CUDA_LONG n = (CUDA_LONG) GetNumCols();
+    PrepareDevice();
+    SyncGuard syncGuard;
+    topValues.RequireSize(topK, n);
+    topIndexes.RequireSize(topK, n);
+    logSumExp.RequireSize(1, n);
+
+    if (topK <= c_maxTopKSelect)
+    {
+        SelectTopK(topIndexes, topValues, &logSumExp, topK);
+        return;
+    }
+
+    // Larger k are sorted as in VectorMax(), and the log-sum-exp comes from a selection of the top 1.
+    VectorMax(topIndexes, topValues, true, topK);
+    auto workspace = GetOrCreateWorkspace();
+    workspace->RequireSize(1, 2 * n);
+    GPUMatrix<ElemType> top1Indexes = workspace->ColumnSlice(0, n);
+    GPUMatrix<ElemType> top1Values = workspace->ColumnSlice(n, n);
+    SelectTopK(top1Indexes, top1Values, &logSumExp, 1);
+    ReleaseWorkspace(std::move(workspace));
+
+    CUDA_LONG N = (CUDA_LONG) topValues.GetNumElements();
+    GridDim grid(N);
+    _assignExpOfDifferenceToColumnValue<ElemType><<<grid.m_blocksPerGrid, grid.m_threadsPerBlock, 0, t_stream>>>(topValues.Data(), logSumExp.Data(), (CUDA_LONG) topK, N);
+}
+
 template <class ElemType>
 void GPUMatrix<ElemType>::VectorMin(GPUMatrix<ElemType>& minIndexes, GPUMatrix<ElemType>& minValues, const bool isColWise) const
 {
@@ -3054,6 +3680,133 @@ void GPUMatrix<ElemType>::VectorMin(GPUMatrix<ElemType>& minIndexes, GPUMatrix<E
     }
 }
 
+template <class ElemType>
+__global__ void _initMagnitudesForSort(const ElemType* a, ElemType* magnitudes, uint64_t* indexes, CUDA_LONG celt)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    CUDA_LONG id = blockDim.x * blockIdx.x + threadIdx.x;
+    if (id >= celt)
+        return;
+    magnitudes[id] = fabs_((comp_t)a[id]);
+    indexes[id] = static_cast<uint64_t>(id);
+}
+
+template <class ElemType>
+__global__ void _extractTopKMagnitudes(ElemType* a, const uint64_t* sortedIndexes, int* topKIndexes, ElemType* topKValues, CUDA_LONG topK)
+{
+    CUDA_LONG id = blockDim.x * blockIdx.x + threadIdx.x;
+    if (id >= topK)
+        return;
+    CUDA_LONG index = static_cast<CUDA_LONG>(sortedIndexes[id]);
+    topKIndexes[id] = index;
+    topKValues[id] = a[index];
+    a[index] = 0;
+}
+
+template <class ElemType>
+__global__ void _scatterAddValues(ElemType* a, const int* indexes, const ElemType* values, CUDA_LONG count)
+{
+    CUDA_LONG id = blockDim.x * blockIdx.x + threadIdx.x;
+    if (id >= count)
+        return;
+    atomicAdd(&a[indexes[id]], values[id]);
+}
+
+// Moves the k elements of the largest magnitude to the host, as (linear index, value) pairs, and zeroes them in place.
+// The magnitudes are sorted together with their indices, so the selection is exact and ties are broken by the sort.
+template <class ElemType>
+void GPUMatrix<ElemType>::ExtractTopKMagnitudes(size_t k, std::vector<int>& indices, std::vector<ElemType>& values)
+{
+    if (IsEmpty())
+        LogicError("ExtractTopKMagnitudes: Matrix is empty.");
+    if (k > GetNumElements())
+        InvalidArgument("ExtractTopKMagnitudes: k (%d) exceeds the number of elements (%d).", (int) k, (int) GetNumElements());
+
+    indices.resize(k);
+    values.resize(k);
+    if (k == 0)
+        return;
+
+    const CUDA_LONG m = (CUDA_LONG) GetNumRows();
+    const CUDA_LONG celt = static_cast<CUDA_LONG>(GetNumElements());
+
+    PrepareDevice();
+    SyncGuard syncGuard;
+
+    ElemType* inVal = nullptr;
+    ElemType* outVal = nullptr;
+    uint64_t* inIdx = nullptr;
+    uint64_t* outIdx = nullptr;
+    // Determine temp buffer size needed for SortPairsDescending.
+    size_t cbtemp = 0;
+    CUDA_CALL(SortPairsDescending(nullptr, cbtemp, inVal, outVal, inIdx, outIdx, celt, 0, sizeof(ElemType) * 8, t_stream));
+    size_t ctemp = (cbtemp + sizeof(ElemType) - 1) / sizeof(ElemType);
+    cbtemp = ctemp * sizeof(ElemType);
+    // ElemType count needed to store indices, accounting for natural alignment for uint64_t type.
+    size_t cidx = ((celt + 1) * sizeof(uint64_t) - 1 + sizeof(ElemType) - 1) / sizeof(ElemType);
+    // Get temp workspace.
+    auto workspace = GetOrCreateWorkspace();
+    // RequireSize to store: the magnitudes before and after sorting, input indices, output indices, and temp storage.
+    workspace->RequireSize(m, 2 * GetNumCols() + (2 * cidx + ctemp + m - 1) / m);
+    inVal = workspace->Data();
+    outVal = inVal + celt;
+    inIdx = reinterpret_cast<uint64_t*>(outVal + celt);
+    // Align indices pointer if needed.
+    size_t cbAlign = reinterpret_cast<size_t>(inIdx) % sizeof(uint64_t);
+    if (cbAlign != 0)
+        reinterpret_cast<uint8_t*&>(inIdx) += sizeof(uint64_t) - cbAlign;
+    outIdx = inIdx + celt;
+    void* ptmp = outIdx + celt;
+    assert(reinterpret_cast<ElemType*>(reinterpret_cast<uint8_t*>(ptmp) + cbtemp) <= workspace->Data() + workspace->GetNumElements());
+
+    const int ThreadsPerBlock = 128;
+    int cblock = (celt + ThreadsPerBlock - 1) / ThreadsPerBlock;
+    _initMagnitudesForSort<ElemType><<<cblock, ThreadsPerBlock, 0, t_stream>>>(Data(), inVal, inIdx, celt);
+    CUDA_CALL(SortPairsDescending(ptmp, cbtemp, inVal, outVal, inIdx, outIdx, celt, 0, sizeof(ElemType) * 8, t_stream));
+    // The unsorted magnitudes and indices are not needed anymore, their storage receives the selected elements.
+    ElemType* topKValues = inVal;
+    int* topKIndexes = reinterpret_cast<int*>(inIdx);
+    cblock = ((CUDA_LONG) k + ThreadsPerBlock - 1) / ThreadsPerBlock;
+    _extractTopKMagnitudes<ElemType><<<cblock, ThreadsPerBlock, 0, t_stream>>>(Data(), outIdx, topKIndexes, topKValues, (CUDA_LONG) k);
+    CUDA_CALL(cudaMemcpyAsync(indices.data(), topKIndexes, k * sizeof(int), cudaMemcpyDeviceToHost, t_stream));
+    CUDA_CALL(cudaMemcpyAsync(values.data(), topKValues, k * sizeof(ElemType), cudaMemcpyDeviceToHost, t_stream));
+    CUDA_CALL(cudaStreamSynchronize(t_stream));
+
+    ReleaseWorkspace(std::move(workspace));
+}
+
+// Adds the values at the given linear indices; repeated indices accumulate.
+template <class ElemType>
+void GPUMatrix<ElemType>::ScatterAddValues(const std::vector<int>& indices, const std::vector<ElemType>& values)
+{
+    if (indices.size() != values.size())
+        InvalidArgument("ScatterAddValues: The number of indices (%d) and values (%d) differ.", (int) indices.size(), (int) values.size());
+    if (indices.empty())
+        return;
+
+    const CUDA_LONG count = (CUDA_LONG) indices.size();
+
+    PrepareDevice();
+    SyncGuard syncGuard;
+
+    // ElemType count needed to store the indices.
+    size_t cidx = (count * sizeof(int) + sizeof(ElemType) - 1) / sizeof(ElemType);
+    auto workspace = GetOrCreateWorkspace();
+    workspace->RequireSize(1, count + cidx);
+    ElemType* deviceValues = workspace->Data();
+    int* deviceIndexes = reinterpret_cast<int*>(deviceValues + count);
+    CUDA_CALL(cudaMemcpyAsync(deviceValues, values.data(), count * sizeof(ElemType), cudaMemcpyHostToDevice, t_stream));
+    CUDA_CALL(cudaMemcpyAsync(deviceIndexes, indices.data(), count * sizeof(int), cudaMemcpyHostToDevice, t_stream));
+
+    const int ThreadsPerBlock = 128;
+    int cblock = (count + ThreadsPerBlock - 1) / ThreadsPerBlock;
+    _scatterAddValues<ElemType><<<cblock, ThreadsPerBlock, 0, t_stream>>>(Data(), deviceIndexes, deviceValues, count);
+    // The host buffers must stay valid until the copies are done.
+    CUDA_CALL(cudaStreamSynchronize(t_stream));
+
+    ReleaseWorkspace(std::move(workspace));
+}
+
 template <class ElemType>
 GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignNumOfDiff(const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, bool searchInCol)
 {
@@ -3371,11 +4124,40 @@ void GPUMatrix<ElemType>::MaxROIPoolingBackward(const size_t numRois, const size
     PrepareDevice();
     SyncGuard syncGuard;
 
-    int count = numImg * channels * height * width;
+    // one block per channel of each ROI of the minibatch
+    int blocks = numRois * numImg * channels;
+    int blockSize = std::min((int)(pooledWidth * pooledHeight + 31) / 32 * 32, 256);
+    kROIPoolingBackward<false><<<blocks, blockSize, 0, t_stream>>>(numRois, channels, width, height,
+                                                                   pooledWidth, pooledHeight, Data(), roiData.Data(), grad.Data(), argmax.Data(), spatialScale);
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::AverageROIAlignForward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
+                                                 const size_t pooledWidth, const size_t pooledHeight, const GPUMatrix<ElemType>& roiData, GPUMatrix<ElemType>& output,
+                                                 double spatialScale) const
+{
+    PrepareDevice();
+    SyncGuard syncGuard;
+
+    int count = numRois * numImg * channels * pooledHeight * pooledWidth;
     const int blockSize = GridDim::maxThreadsPerBlock;
     auto numThreads = dim3((int)floor((double)(count + blockSize - 1) / blockSize));
-    kMaxROIPoolingBackward<<<numThreads, blockSize, 0, t_stream>>>(count, numRois, numImg, channels, width, height,
-                                                                   pooledWidth, pooledHeight, Data(), roiData.Data(), grad.Data(), argmax.Data(), spatialScale);
+    kAverageROIAlignForward<<<numThreads, blockSize, 0, t_stream>>>(count, numRois, numImg, channels, width, height,
+                                                                    pooledWidth, pooledHeight, Data(), roiData.Data(), output.Data(), spatialScale);
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::AverageROIAlignBackward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
+                                                  const size_t pooledWidth, const size_t pooledHeight, const GPUMatrix<ElemType>& roiData, GPUMatrix<ElemType>& grad,
+                                                  double spatialScale) const
+{
+    PrepareDevice();
+    SyncGuard syncGuard;
+
+    int blocks = numRois * numImg * channels;
+    int blockSize = std::min((int)(pooledWidth * pooledHeight + 31) / 32 * 32, 256);
+    kROIPoolingBackward<true><<<blocks, blockSize, 0, t_stream>>>(numRois, channels, width, height,
+                                                                  pooledWidth, pooledHeight, Data(), roiData.Data(), grad.Data(), (const ElemType*)nullptr, spatialScale);
 }
 
 template <class ElemType>
@@ -3420,7 +4202,7 @@ template <class ElemType>
 template <class StatType>
 void GPUMatrix<ElemType>::BatchNormalizationForward(const GPUMatrix<StatType>& scale, const GPUMatrix<StatType>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor,
                                                     GPUMatrix<StatType>& runMean, GPUMatrix<StatType>& runVariance, GPUMatrix<ElemType>& out, double epsilon,
-                                                    GPUMatrix<StatType>& savedMean, GPUMatrix<StatType>& savedInvStdDev) const
+                                                    GPUMatrix<StatType>& savedMean, GPUMatrix<StatType>& savedInvStdDev, bool reluOutput) const
 {
     assert((GetNumRows() % scale.GetNumRows()) == 0);
 
@@ -3468,7 +4250,7 @@ void GPUMatrix<ElemType>::BatchNormalizationForward(const GPUMatrix<StatType>& s
     }
 
     Call2<NormalizeBatchTraining, ElemType, StatType>(spatial ? spatialSize : vectorSize, vectorSize, spatialSize, batchSize, spatial,
-                                           normalizeRunningStats, epsilon,
+                                           normalizeRunningStats, epsilon, reluOutput,
                                            Data(), out.Data(),
                                            scale.Data(), bias.Data(),
                                            runMean.Data(), runVariance.Data(),
@@ -3478,12 +4260,14 @@ void GPUMatrix<ElemType>::BatchNormalizationForward(const GPUMatrix<StatType>& s
 
 // savedMean/savedInvStdDev are the interpolated mean/inverse standard deviation as used in ForwardProp().
 // For blendFactor=1, they are not used and can be uninitialized or empty.
+// reluOutput is the output if the forward pass fused a ReLU (reluOutput=true), else null.
 template <class ElemType>
 template <class StatType>
 void GPUMatrix<ElemType>::BatchNormalizationBackward(const GPUMatrix<ElemType>& in, GPUMatrix<ElemType>& grad, const GPUMatrix<StatType>& scale, double blendFactor,
                                                      const GPUMatrix<StatType>& savedMean, const GPUMatrix<StatType>& savedInvStdDev,
-                                                     GPUMatrix<StatType>& scaleGrad, GPUMatrix<StatType>& biasGrad) const
+                                                     GPUMatrix<StatType>& scaleGrad, GPUMatrix<StatType>& biasGrad, const GPUMatrix<ElemType>* reluOutput) const
 {
+    const ElemType* y = reluOutput ? reluOutput->Data() : nullptr;
     assert((GetNumRows() % scale.GetNumRows()) == 0);
 
     bool spatial = GetNumRows() != scale.GetNumRows();
@@ -3497,12 +4281,12 @@ void GPUMatrix<ElemType>::BatchNormalizationBackward(const GPUMatrix<ElemType>&
     SyncGuard syncGuard;
     if (spatial)
     {
-        Call2<ComputeSpatialScaleAndBiasGradients, ElemType, StatType>(spatialSize, vectorSize, spatialSize, batchSize, in.Data(), Data(), scaleGrad.Data(), biasGrad.Data(),
+        Call2<ComputeSpatialScaleAndBiasGradients, ElemType, StatType>(spatialSize, vectorSize, spatialSize, batchSize, in.Data(), y, Data(), scaleGrad.Data(), biasGrad.Data(),
                                                             savedMean.Data(), savedInvStdDev.Data(), GetStream());
     }
     else
     {
-        Call2<ComputeScaleAndBiasGradients, ElemType, StatType>(vectorSize, vectorSize, batchSize, in.Data(), Data(), scaleGrad.Data(), biasGrad.Data(),
+        Call2<ComputeScaleAndBiasGradients, ElemType, StatType>(vectorSize, vectorSize, batchSize, in.Data(), y, Data(), scaleGrad.Data(), biasGrad.Data(),
                                                      savedMean.Data(), savedInvStdDev.Data(), GetStream());
     }
 
@@ -3517,7 +4301,55 @@ void GPUMatrix<ElemType>::BatchNormalizationBackward(const GPUMatrix<ElemType>&
 #endif
 
     Call2<BackpropagateBatchNormGradients, ElemType, StatType>(spatial ? spatialSize : vectorSize, vectorSize, spatialSize, batchSize, spatial,
-                                                    in.Data(), Data(), grad.Data(), scale.Data(), mbStatsWeight, scaleGrad.Data(), biasGrad.Data(), savedMean.Data(), savedInvStdDev.Data(), GetStream());
+                                                    in.Data(), y, Data(), grad.Data(), scale.Data(), mbStatsWeight, scaleGrad.Data(), biasGrad.Data(), savedMean.Data(), savedInvStdDev.Data(), GetStream());
+}
+
+// returns the mean and inverse standard deviation of each column, as used for its normalization, in saveMean and saveInvStdDev
+template <class ElemType>
+void GPUMatrix<ElemType>::LayerNormalizationForward(const GPUMatrix<ElemType>& scale, const GPUMatrix<ElemType>& bias, double epsilon, GPUMatrix<ElemType>& out,
+                                                    GPUMatrix<ElemType>& saveMean, GPUMatrix<ElemType>& saveInvStdDev) const
+{
+    if (scale.GetNumElements() != GetNumRows() || bias.GetNumElements() != GetNumRows())
+        LogicError("LayerNormalizationForward: The scale and bias must have as many elements as the matrix has rows.");
+
+    out.RequireSize(GetNumRows(), GetNumCols());
+    saveMean.RequireSize(1, GetNumCols());
+    saveInvStdDev.RequireSize(1, GetNumCols());
+    if (IsEmpty())
+        return;
+
+    PrepareDevice();
+    CUDA_LONG N = (CUDA_LONG) GetNumCols();
+    CUDA_LONG M = (CUDA_LONG) GetNumRows();
+    SyncGuard syncGuard;
+    // note: kernel uses hard-coded thread dimension
+    _layerNormalizationForward512Threads<<<N, 512, 0, t_stream>>>(Data(), out.Data(), scale.Data(), bias.Data(), saveMean.Data(), saveInvStdDev.Data(), M, epsilon);
+}
+
+// this is the gradient of the output. The gradient of the input is added to grad, the ones of scale and bias are assigned.
+template <class ElemType>
+void GPUMatrix<ElemType>::LayerNormalizationBackward(const GPUMatrix<ElemType>& in, GPUMatrix<ElemType>& grad, const GPUMatrix<ElemType>& scale,
+                                                     const GPUMatrix<ElemType>& saveMean, const GPUMatrix<ElemType>& saveInvStdDev,
+                                                     GPUMatrix<ElemType>& scaleGrad, GPUMatrix<ElemType>& biasGrad) const
+{
+    if (in.GetNumRows() != GetNumRows() || in.GetNumCols() != GetNumCols() || grad.GetNumRows() != GetNumRows() || grad.GetNumCols() != GetNumCols())
+        LogicError("LayerNormalizationBackward: The input, its gradient and the output gradient must have the same dimensions.");
+    if (scale.GetNumElements() != GetNumRows() || saveMean.GetNumElements() != GetNumCols() || saveInvStdDev.GetNumElements() != GetNumCols())
+        LogicError("LayerNormalizationBackward: The scale or the saved statistics do not match the dimensions of the matrix.");
+
+    scaleGrad.RequireSize(scale.GetNumRows(), scale.GetNumCols());
+    biasGrad.RequireSize(scale.GetNumRows(), scale.GetNumCols());
+    if (IsEmpty())
+        return;
+
+    PrepareDevice();
+    CUDA_LONG N = (CUDA_LONG) GetNumCols();
+    CUDA_LONG M = (CUDA_LONG) GetNumRows();
+    SyncGuard syncGuard;
+    _layerNormalizationBackward512Threads<<<N, 512, 0, t_stream>>>(Data(), in.Data(), grad.Data(), scale.Data(), saveMean.Data(), saveInvStdDev.Data(), M);
+    int blocksPerGrid = (int) ceil(M * 1.0 / GridDim::maxThreadsPerBlock);
+    _layerNormalizationParameterGradients<<<blocksPerGrid, GridDim::maxThreadsPerBlock, 0, t_stream>>>(Data(), in.Data(), saveMean.Data(), saveInvStdDev.Data(),
+                                                                                                      scaleGrad.Data(), biasGrad.Data(), M, N);
 }
 
 #pragma region RNN Functions
@@ -3547,6 +4379,32 @@ void GPUMatrix<ElemType>::RNNBackwardWeights(const GPUMatrix<ElemType>& inputX,
     m_rnnExecutor->BackwardWeightsCore(inputX, outputY, dw, rnnAttributes, reserve, workspace);
 }
 
+template <class ElemType>
+/*static*/ bool GPUMatrix<ElemType>::IsRNNUnpackedLayoutSupported()
+{
+#if CUDNN_VERSION >= 7201
+    return true;
+#else
+    return false;
+#endif
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::RNNForwardUnpacked(const GPUMatrix<ElemType>& inputX, const GPUMatrix<ElemType>& paramW, GPUMatrix<ElemType>& outputY, size_t xDim, size_t yDim, const vector<int>& sequenceLengths, const RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace)
+{
+    if (!m_rnnExecutor)
+        m_rnnExecutor = std::make_unique<CuDnnRNNExecutor<ElemType>>(xDim, yDim, rnnAttributes);
+    m_rnnExecutor->ForwardUnpackedCore(paramW, inputX, outputY, sequenceLengths, rnnAttributes, reserve, workspace);
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::RNNBackwardDataUnpacked(const GPUMatrix<ElemType>& outputY, const GPUMatrix<ElemType>& outputDY, const GPUMatrix<ElemType>& paramW, GPUMatrix<ElemType>& outputDX, const RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace)
+{
+    if (!m_rnnExecutor)
+        LogicError("RNNBackwardDataUnpacked called, but RNNWrapper object is not yet initialized");
+    m_rnnExecutor->BackwardDataCore(outputY, outputDY, paramW, outputDX, rnnAttributes, reserve, workspace);
+}
+
 #pragma region Static BLAS Functions
 
 template <class ElemType>
@@ -3574,9 +4432,42 @@ void GPUMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const GPUMatrix
         RuntimeError("!(m>0 && k>0 && l>0 && n>0)"); // converting from size_t to int may cause overflow
     if (k != l)
         RuntimeError("matrix dim mismatch in MultiplyAndWeightedAdd");
+    if (m <= c_maxSmallGemmDim && n <= c_maxSmallGemmDim && k <= c_maxSmallGemmDim)
+    {
+        StridedBatchedMultiplyAndWeightedAdd(alpha, a.Data(), (int) a.m_numRows, 0, transposeA, b.Data(), (int) b.m_numRows, 0, transposeB, beta, c.Data(), (int) c.m_numRows, 0, m, n, k, 1, c.GetComputeDeviceId());
+        return;
+    }
     CUBLAS_CALL(cublasgemmHelper(cuHandle, transA, transB, m, n, k, &alpha, a.Data(), (int) a.m_numRows, b.Data(), (int) b.m_numRows, &beta, c.Data(), (int) c.m_numRows));
 }
 
+// Small products are launch-bound in cuBLAS, so those that fit into a 64 x 64 block of c with a short inner dimension
+// are computed by _multiplyAndWeightedAddSmallBatched(), with the smallest tile that covers them; the others by cuBLAS.
+template <class ElemType>
+/*static*/ void GPUMatrix<ElemType>::StridedBatchedMultiplyAndWeightedAdd(ElemType alpha, const ElemType* a, int lda, size_t strideA, bool transposeA, const ElemType* b, int ldb, size_t strideB, bool transposeB,
+                                                                        ElemType beta, ElemType* c, int ldc, size_t strideC, int m, int n, int k, int batchCount, int deviceId)
+{
+    if (m <= c_maxSmallGemmDim && n <= c_maxSmallGemmDim && k <= c_maxSmallGemmDim)
+    {
+        SyncGuard syncGuard;
+        int maxDim = std::max(m, n);
+        if (maxDim <= 16)
+            _multiplyAndWeightedAddSmallBatched<ElemType, 16, 16, 2, 2, 16><<<batchCount, 64, 0, t_stream>>>(alpha, a, lda, strideA, transposeA, b, ldb, strideB, transposeB, beta, c, ldc, strideC, m, n, k);
+        else if (maxDim <= 32)
+            _multiplyAndWeightedAddSmallBatched<ElemType, 32, 32, 2, 2, 16><<<batchCount, 256, 0, t_stream>>>(alpha, a, lda, strideA, transposeA, b, ldb, strideB, transposeB, beta, c, ldc, strideC, m, n, k);
+        else
+            _multiplyAndWeightedAddSmallBatched<ElemType, 64, 64, 4, 4, 16><<<batchCount, 256, 0, t_stream>>>(alpha, a, lda, strideA, transposeA, b, ldb, strideB, transposeB, beta, c, ldc, strideC, m, n, k);
+        return;
+    }
+
+    cublasHandle_t cuHandle = GetCublasHandle(deviceId);
+    cublasOperation_t transA = transposeA ? CUBLAS_OP_T : CUBLAS_OP_N;
+    cublasOperation_t transB = transposeB ? CUBLAS_OP_T : CUBLAS_OP_N;
+    if (batchCount == 1)
+        CUBLAS_CALL(cublasgemmHelper(cuHandle, transA, transB, m, n, k, &alpha, a, lda, b, ldb, &beta, c, ldc));
+    else
+        CUBLAS_CALL(cublasGemmStridedBatchedHelper(cuHandle, transA, transB, m, n, k, &alpha, a, lda, (long long) strideA, b, ldb, (long long) strideB, &beta, c, ldc, (long long) strideC, batchCount));
+}
+
 template <class ElemType>
 void GPUMatrix<ElemType>::Multiply1x1AndWeightedAdd(ElemType alpha, const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, ElemType beta, GPUMatrix<ElemType>& c)
 {
@@ -4113,10 +5004,6 @@ void GPUMatrix<ElemType>::BatchMatMul(ElemType beta, const GPUMatrix<ElemType>&
     if (!isColWise)
         LogicError("Only column wise is supported.");
 
-    cublasHandle_t cuHandle = GetCublasHandle(b.GetComputeDeviceId());
-    cublasOperation_t transA = transposeA ? CUBLAS_OP_T : CUBLAS_OP_N;
-    cublasOperation_t transB = transposeB ? CUBLAS_OP_T : CUBLAS_OP_N;
-
     const int aSampleElemNum = (int)a.GetNumRows();
     const int aBatchSize = (int)a.GetNumCols();
     const int bSampleElemNum = (int)b.GetNumRows();
@@ -4138,40 +5025,11 @@ void GPUMatrix<ElemType>::BatchMatMul(ElemType beta, const GPUMatrix<ElemType>&
     else
         c.VerifySize(cSampleElemNum, aBatchSize); // Can't resize if beta != 0
 
-    const ElemType alpha = 1.0;
-
     const int lda = transposeA ? k : m;
     const int ldb = transposeB ? n : k;
     const int ldc = m;
-    ElemType* aBufPtr = a.Data();
-    ElemType* bBufPtr = b.Data();
-    ElemType* cBufPtr = c.Data();
-    std::vector<const ElemType*> Aarray;
-    std::vector<const ElemType*> Barray;
-    std::vector<ElemType*> Carray;
-    Aarray.reserve(aBatchSize);
-    Barray.reserve(aBatchSize);
-    Carray.reserve(aBatchSize);
-    for (int i = 0; i < aBatchSize; i++)
-    {
-        Aarray.push_back(aBufPtr + a.LocateColumn(i));
-        Barray.push_back(bBufPtr + b.LocateColumn(i));
-        Carray.push_back(cBufPtr + c.LocateColumn(i));
-    }
-    ElemType** devAList = 0;
-    ElemType** devBList = 0;
-    ElemType** devCList = 0;
-    CUDA_CALL(cudaMalloc(&devAList, aBatchSize * sizeof(ElemType*)));
-    CUDA_CALL(cudaMalloc(&devBList, aBatchSize * sizeof(ElemType*)));
-    CUDA_CALL(cudaMalloc(&devCList, aBatchSize * sizeof(ElemType*)));
-    CUDA_CALL(cudaMemcpy(devAList, &Aarray[0], sizeof(ElemType*) * aBatchSize, cudaMemcpyHostToDevice));
-    CUDA_CALL(cudaMemcpy(devBList, &Barray[0], sizeof(ElemType*) * aBatchSize, cudaMemcpyHostToDevice));
-    CUDA_CALL(cudaMemcpy(devCList, &Carray[0], sizeof(ElemType*) * aBatchSize, cudaMemcpyHostToDevice));
-
-    CUBLAS_CALL(cublasGemmBatchedHelper(cuHandle, transA, transB, m, n, k, &alpha, (const ElemType**)devAList, lda, (const ElemType**)devBList, ldb, &beta, devCList, ldc, aBatchSize));
-    CUDA_CALL(cudaFree(devAList));
-    CUDA_CALL(cudaFree(devBList));
-    CUDA_CALL(cudaFree(devCList));
+    // the samples are the columns, which are equally spaced
+    StridedBatchedMultiplyAndWeightedAdd((ElemType) 1, a.Data(), lda, aSampleElemNum, transposeA, b.Data(), ldb, bSampleElemNum, transposeB, beta, c.Data(), ldc, cSampleElemNum, m, n, k, aBatchSize, c.GetComputeDeviceId());
 }
 
 template <class ElemType>
@@ -4410,16 +5268,18 @@ GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignOneHot(const GPUMatrix<ElemType>
 
 
 template <class ElemType>
-GPUMatrix<ElemType>& GPUMatrix<ElemType>::GatherFromTarget(const GPUMatrix<ElemType>& indices, const GPUMatrix<ElemType>& target, size_t row_elements)
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::GatherFromTarget(const GPUMatrix<ElemType>& indices, const GPUMatrix<ElemType>& target, size_t row_elements, size_t outer_elements/* = 1*/)
 {
     if (indices.IsEmpty() || target.IsEmpty())
         LogicError("GatherFromTarget: input matrix is empty.");
 
-    if (row_elements == 0)
+    if (row_elements == 0 || outer_elements == 0)
         LogicError("GatherFromTarget: target matrix at least need 1 dim.");
 
+    const size_t numIndexRows = indices.GetNumRows();
+    const size_t axisDim = target.GetNumElements() / (row_elements * outer_elements);
     auto nCols = indices.GetNumCols();
-    auto nRows = indices.GetNumRows() * row_elements;
+    auto nRows = numIndexRows * row_elements * outer_elements;
     this->RequireSize(nRows, nCols);
     this->PrepareDevice();
 
@@ -4428,29 +5288,75 @@ GPUMatrix<ElemType>& GPUMatrix<ElemType>::GatherFromTarget(const GPUMatrix<ElemT
     ElemType* buffer = Data();
 
     size_t num_indices = indices.GetNumElements();
-    CUDA_LONG N = (CUDA_LONG)num_indices * row_elements;
+    SyncGuard syncGuard;
+
+    // Slices of whole 16-byte vectors, e.g. embeddings of a multiple of 4 floats, are copied a float4 per thread.
+    const size_t vectorElements = sizeof(float4) / sizeof(ElemType);
+    if (row_elements % vectorElements == 0 && reinterpret_cast<size_t>(targetBufPtr) % sizeof(float4) == 0 && reinterpret_cast<size_t>(buffer) % sizeof(float4) == 0)
+    {
+        size_t num_row_vectors = row_elements / vectorElements;
+        CUDA_LONG N = (CUDA_LONG)(num_indices * outer_elements * num_row_vectors);
+        int blocksPerGrid = (int)ceil(((double)N) / GridDim::maxThreadsPerBlock);
+        _gatherVectorsFromTarget<ElemType, float4><<<blocksPerGrid, GridDim::maxThreadsPerBlock, 0, t_stream>>>(
+            indicesBufPtr, reinterpret_cast<const float4*>(targetBufPtr), reinterpret_cast<float4*>(buffer), num_row_vectors, numIndexRows, axisDim, outer_elements, N);
+        return *this;
+    }
+
+    CUDA_LONG N = (CUDA_LONG)(num_indices * outer_elements * row_elements);
     int blocksPerGrid = (int)ceil(((double)N) / GridDim::maxThreadsPerBlock);
-    _gatherFromTarget<ElemType> <<<blocksPerGrid, GridDim::maxThreadsPerBlock >>> (indicesBufPtr, targetBufPtr, buffer, row_elements, num_indices, N);
+    _gatherVectorsFromTarget<ElemType, ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock, 0, t_stream>>>(
+        indicesBufPtr, targetBufPtr, buffer, row_elements, numIndexRows, axisDim, outer_elements, N);
 
     return *this;
 }
 
+// Adds the slices of 'values' into the slices of this matrix given by 'indices', see Matrix::ScatterToIndices().
+// As for the SparseBlockCol gradient in GPUSparseMatrix::ScatterToIndices(), the indices are sorted by target, and
+// each run of equal targets is then added up by one thread per element, instead of atomic adds into the targets.
+// With a stable sort, the result does not depend on the order in which the threads run.
 template <class ElemType>
-GPUMatrix<ElemType>& GPUMatrix<ElemType>::ScatterToIndices(const GPUMatrix<ElemType>& values, const GPUMatrix<ElemType>& indices, size_t row_elements, const GPUMatrix<char>* mask/*= nullptr*/)
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::ScatterToIndices(const GPUMatrix<ElemType>& values, const GPUMatrix<ElemType>& indices, size_t row_elements, size_t outer_elements/* = 1*/, const GPUMatrix<char>* mask/*= nullptr*/)
 {
     if (indices.IsEmpty() || values.IsEmpty() || (mask && mask->IsEmpty()))
         LogicError("ScatterToIndices: input matrix is empty.");
+    if (values.GetComputeDeviceId() != GetComputeDeviceId() || indices.GetComputeDeviceId() != GetComputeDeviceId())
+        InvalidArgument("All matrices must be on the same GPU");
 
-    ElemType* indicesBufPtr = indices.Data();
-    ElemType* valueBufPtr = values.Data();
-    char* maskBufPtr = mask ? mask->Data() : nullptr;
-    ElemType* buffer = Data();
-    size_t num_indices_elems_per_mask_col = mask ? indices.GetNumRows() * indices.GetNumCols() / mask->GetNumCols() : 0;
+    const GPUSPARSE_INDEX_TYPE axisDim = (GPUSPARSE_INDEX_TYPE)(GetNumElements() / (row_elements * outer_elements));
+    const CUDA_LONG numIndices = (CUDA_LONG)indices.GetNumElements();
+    const size_t numIndicesPerMaskEntry = mask ? numIndices / mask->GetNumCols() : 0;
 
-    size_t num_indices = indices.GetNumElements();
-    CUDA_LONG N = (CUDA_LONG)num_indices * row_elements;
-    int blocksPerGrid = (int)ceil(((double)N) / GridDim::maxThreadsPerBlock);
-    _scatterToIndices<ElemType> << <blocksPerGrid, GridDim::maxThreadsPerBlock >> > (indicesBufPtr, valueBufPtr, buffer, maskBufPtr, num_indices_elems_per_mask_col, row_elements, num_indices, N);
+    PrepareDevice();
+    SyncGuard syncGuard;
+
+    // The keys only need the bits of the target indices, including 'axisDim' for the masked ones.
+    int endBit = 1;
+    while (endBit < 31 && ((GPUSPARSE_INDEX_TYPE)1 << endBit) <= axisDim)
+        endBit++;
+
+    // keys, positions, sorted keys and sorted positions, followed by the temporary storage of the sort
+    size_t cbtemp = 0;
+    CUDA_CALL(cub::DeviceRadixSort::SortPairs(nullptr, cbtemp, (GPUSPARSE_INDEX_TYPE*)nullptr, (GPUSPARSE_INDEX_TYPE*)nullptr,
+                                              (GPUSPARSE_INDEX_TYPE*)nullptr, (GPUSPARSE_INDEX_TYPE*)nullptr, numIndices, 0, endBit, t_stream));
+    auto workspace = GetOrCreateWorkspace();
+    workspace->RequireSize(1, (4 * numIndices * sizeof(GPUSPARSE_INDEX_TYPE) + cbtemp + sizeof(ElemType) - 1) / sizeof(ElemType));
+    GPUSPARSE_INDEX_TYPE* keys = reinterpret_cast<GPUSPARSE_INDEX_TYPE*>(workspace->Data());
+    GPUSPARSE_INDEX_TYPE* positions = keys + numIndices;
+    GPUSPARSE_INDEX_TYPE* sortedKeys = positions + numIndices;
+    GPUSPARSE_INDEX_TYPE* sortedPositions = sortedKeys + numIndices;
+    void* ptmp = sortedPositions + numIndices;
+
+    int blocksPerGrid = (int)ceil(((double)numIndices) / GridDim::maxThreadsPerBlock);
+    _initIndicesForSparseScatter<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock, 0, t_stream>>>(
+        indices.Data(), mask ? mask->Data() : nullptr, numIndicesPerMaskEntry, axisDim, keys, positions, numIndices);
+    CUDA_CALL(cub::DeviceRadixSort::SortPairs(ptmp, cbtemp, keys, sortedKeys, positions, sortedPositions, numIndices, 0, endBit, t_stream));
+
+    CUDA_LONG N = (CUDA_LONG)(numIndices * outer_elements * row_elements);
+    blocksPerGrid = (int)ceil(((double)N) / GridDim::maxThreadsPerBlock);
+    _reduceSortedIndicesAlongAxis<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock, 0, t_stream>>>(
+        sortedKeys, sortedPositions, values.Data(), Data(), row_elements, indices.GetNumRows(), axisDim, outer_elements, numIndices);
+
+    ReleaseWorkspace(std::move(workspace));
 
     return *this;
 }
@@ -4512,6 +5418,7 @@ GPUMatrix<ElemType>& GPUMatrix<ElemType>::GetARowByIndex(const GPUMatrix<ElemTyp
 }
 
 // Calculate CTC score
+// this (output): CTC posterior of each label, normalized to sum to 1 over each frame; must be zero
 // prob (input): the posterior output from the network
 // alpha, beta (output): alpha and beta for forward-backward calculation.
 // phoneSeq (input): phone ID sequence for each utterance in this minibatch, each col is one utterance
@@ -4572,30 +5479,19 @@ GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignCTCScore(const GPUMatrix<ElemTyp
 
         cudaEvent_t done = nullptr;
         CUDA_CALL(cudaEventCreate(&done));
-        dim3 thread_tail(DEFAULT_THREAD_PER_DIM, DEFAULT_THREAD_PER_DIM);
-        // x dimension is for utterances
-        // y dimention is for phone sequence in each utterance
-        // Ensure that we allocate correct number of blocks for given number of utterances and max number of phones in those utterances
-        dim3 block_tail((uttNum + DEFAULT_THREAD_PER_DIM - 1) / DEFAULT_THREAD_PER_DIM, (maxPhoneNum + DEFAULT_THREAD_PER_DIM - 1) / DEFAULT_THREAD_PER_DIM);
-        for (long t = 0; t < maxFrameNum; t++)
-        {
-            _assignAlphaScore << <block_tail, thread_tail, 0, t_stream >> >(prob.Data(), alpha.Data(), phoneSeq.Data(), phoneBoundary.Data(), gpuUttToChanInd,
-                gpuFrameNum, gpuBeginFrame, gpuPhoneNum, numParallelSequences, uttNum, t, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
-        }
 
-        for (long t = maxFrameNum - 1; t >= 0; t--)
-        {
-            _assignBetaScore << <block_tail, thread_tail, 0, t_stream >> >(prob.Data(), beta.Data(), phoneSeq.Data(), phoneBoundary.Data(), gpuUttToChanInd,
-                gpuFrameNum, gpuBeginFrame, gpuPhoneNum, numParallelSequences, uttNum, t, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
-        }
+        // alpha and beta of all utterances in one launch: a block per utterance and direction, which loops over the frames
+        // note: the number of threads is only bounded by the number of phones of the longest utterance
+        const int threadsPerUtterance = (int) std::min<size_t>(GridDim::maxThreadsPerBlock, (maxPhoneNum + 31) / 32 * 32);
+        _assignAlphaBetaScores<<<dim3((unsigned int) uttNum, 2), threadsPerUtterance, 0, t_stream>>>(prob.Data(), alpha.Data(), beta.Data(), phoneSeq.Data(), phoneBoundary.Data(), gpuUttToChanInd,
+            gpuFrameNum, gpuBeginFrame, gpuPhoneNum, numParallelSequences, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
 
         ElemType zerVar = 0.0;
         totalScore.SetColumn(&zerVar, 0);
         _assignTotalScore << <uttNum, 1, 0, t_stream >> > (beta.Data(), totalScore.Data(), uttNum, gpuUttToChanInd, gpuBeginFrame, numParallelSequences, maxPhoneNum);
 
-        dim3 block_tail_2((uttNum + DEFAULT_THREAD_PER_DIM - 1) / DEFAULT_THREAD_PER_DIM, (maxFrameNum + DEFAULT_THREAD_PER_DIM - 1) / DEFAULT_THREAD_PER_DIM);
-
-        _assignCTCScore << < block_tail_2, thread_tail, 0, t_stream >> >(Data(), prob.Data(), alpha.Data(), beta.Data(), phoneSeq.Data(), uttNum, gpuUttToChanInd,
+        // note: kernel uses hard-coded thread dimension
+        _assignCTCScore128Threads<<<dim3((unsigned int) maxFrameNum, (unsigned int) uttNum), 128, 0, t_stream>>>(Data(), prob.Data(), alpha.Data(), beta.Data(), phoneSeq.Data(), gpuUttToChanInd,
             gpuBeginFrame, gpuPhoneNum, gpuFrameNum, numParallelSequences, maxPhoneNum, totalPhoneNum);
 
         CUDA_CALL(cudaFree(gpuFrameNum));
@@ -4615,6 +5511,101 @@ GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignCTCScore(const GPUMatrix<ElemTyp
     return *this;
 }
 
+// Edit distances of the utterances of a minibatch, see Matrix::AssignEditDistances(). A block per utterance, which walks the
+// anti-diagonals of the grid, so that only the 3 x #utterances result is copied to the host by the caller.
+template<class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignEditDistances(const GPUMatrix<ElemType>& firstSeq, const GPUMatrix<ElemType>& secondSeq, const std::vector<size_t>& uttToChanInd,
+    const std::vector<size_t>& uttBeginFrame, const std::vector<size_t>& uttFrameNum, const size_t numParallelSequences,
+    const float subPen, const float delPen, const float insPen, const bool squashInputs, const std::vector<size_t>& tokensToIgnore)
+{
+    size_t uttNum = uttFrameNum.size();
+    RequireSize(3, uttNum);
+    if (uttNum == 0)
+        return *this;
+
+    PrepareDevice();
+    size_t maxFrameNum = *std::max_element(uttFrameNum.begin(), uttFrameNum.end());
+
+    // the descriptions of the utterances and the ignored tokens in one copy
+    std::vector<size_t> args;
+    args.reserve(3 * uttNum + tokensToIgnore.size());
+    args.insert(args.end(), uttToChanInd.begin(), uttToChanInd.end());
+    args.insert(args.end(), uttBeginFrame.begin(), uttBeginFrame.end());
+    args.insert(args.end(), uttFrameNum.begin(), uttFrameNum.end());
+    args.insert(args.end(), tokensToIgnore.begin(), tokensToIgnore.end());
+
+    size_t *gpuArgs;
+    CUDA_CALL(cudaMalloc((void **)&gpuArgs, args.size() * sizeof(size_t)));
+    CUDA_CALL(cudaMemcpy(gpuArgs, args.data(), args.size() * sizeof(size_t), cudaMemcpyHostToDevice));
+
+    int *gpuTokens;
+    CUDA_CALL(cudaMalloc((void **)&gpuTokens, std::max<size_t>(2 * maxFrameNum * uttNum, 1) * sizeof(int)));
+    float *gpuDiagonals;
+    CUDA_CALL(cudaMalloc((void **)&gpuDiagonals, 6 * (maxFrameNum + 1) * uttNum * sizeof(float)));
+
+    // a diagonal has at most maxFrameNum + 1 cells
+    const int threadsPerUtterance = (int) std::min<size_t>(GridDim::maxThreadsPerBlock, (maxFrameNum + 1 + 31) / 32 * 32);
+    _assignEditDistances<<<(unsigned int) uttNum, threadsPerUtterance, 0, t_stream>>>(Data(), firstSeq.Data(), secondSeq.Data(),
+        gpuArgs, gpuArgs + uttNum, gpuArgs + 2 * uttNum, numParallelSequences, maxFrameNum, gpuArgs + 3 * uttNum, tokensToIgnore.size(),
+        subPen, delPen, insPen, squashInputs, gpuTokens, gpuDiagonals);
+
+    // note: cudaFree() waits for the kernel
+    CUDA_CALL(cudaFree(gpuArgs));
+    CUDA_CALL(cudaFree(gpuTokens));
+    CUDA_CALL(cudaFree(gpuDiagonals));
+
+    return *this;
+}
+
+// LambdaRank ranks and DCGs, see Matrix::AssignLambdaRankRanks(). A block per query.
+template<class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignLambdaRankRanks(const GPUMatrix<ElemType>& gains, const GPUMatrix<ElemType>& scores, const std::vector<size_t>& queryBegins, GPUMatrix<ElemType>& metrics)
+{
+    size_t numQueries = queryBegins.size() - 1;
+    RequireSize(1, gains.GetNumCols());
+    metrics.RequireSize(2, numQueries);
+    if (numQueries == 0)
+        return *this;
+
+    PrepareDevice();
+    size_t *gpuQueryBegins;
+    CUDA_CALL(cudaMalloc((void **)&gpuQueryBegins, queryBegins.size() * sizeof(size_t)));
+    CUDA_CALL(cudaMemcpy(gpuQueryBegins, queryBegins.data(), queryBegins.size() * sizeof(size_t), cudaMemcpyHostToDevice));
+
+    // note: kernel uses hard-coded thread dimension
+    _assignLambdaRankRanks128Threads<<<(unsigned int) numQueries, 128, 0, t_stream>>>(Data(), metrics.Data(), gains.Data(), scores.Data(), gpuQueryBegins);
+
+    // note: cudaFree() waits for the kernel
+    CUDA_CALL(cudaFree(gpuQueryBegins));
+
+    return *this;
+}
+
+// LambdaRank gradient, see Matrix::AddLambdaRankGradient(). A block per query, a thread per document.
+template<class ElemType>
+void GPUMatrix<ElemType>::AddLambdaRankGradient(const GPUMatrix<ElemType>& gains, const GPUMatrix<ElemType>& scores, const GPUMatrix<ElemType>& ranks, const GPUMatrix<ElemType>& metrics,
+    const std::vector<size_t>& queryBegins, const ElemType sigma, GPUMatrix<ElemType>& gradient)
+{
+    size_t numQueries = queryBegins.size() - 1;
+    if (numQueries == 0)
+        return;
+
+    gradient.PrepareDevice();
+    size_t maxDocuments = 0;
+    for (size_t q = 0; q < numQueries; q++)
+        maxDocuments = std::max(maxDocuments, queryBegins[q + 1] - queryBegins[q]);
+
+    size_t *gpuQueryBegins;
+    CUDA_CALL(cudaMalloc((void **)&gpuQueryBegins, queryBegins.size() * sizeof(size_t)));
+    CUDA_CALL(cudaMemcpy(gpuQueryBegins, queryBegins.data(), queryBegins.size() * sizeof(size_t), cudaMemcpyHostToDevice));
+
+    const int threadsPerQuery = (int) std::min<size_t>(GridDim::maxThreadsPerBlock, (maxDocuments + 31) / 32 * 32);
+    _addLambdaRankGradient<<<(unsigned int) numQueries, std::max(threadsPerQuery, 32), 0, t_stream>>>(gradient.Data(), gains.Data(), scores.Data(), ranks.Data(), metrics.Data(),
+        gpuQueryBegins, sigma);
+
+    CUDA_CALL(cudaFree(gpuQueryBegins));
+}
+
 template <class ElemType>
 void GPUMatrix<ElemType>::ConductRowElementMultiplyWithShift(const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, GPUMatrix<ElemType>& c, const size_t shift, const bool isafixed)
 {
@@ -4954,48 +5945,100 @@ void GPUMatrix<ElemType>::TensorArgOp(const GPUMatrix<ElemType>& a, ElementWiseO
     return TensorOpN<ElemType, 2>((ElemType) 0, array<ElemType*, 2>{a.Data(), Data()}, (ElemType) 1, ElementWiseOperator::opCopy, reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
 }
 
+template <class ElemType>
+void GPUMatrix<ElemType>::ElementwiseProgramOp(ElemType beta, const std::vector<const GPUMatrix<ElemType>*>& inputs, const ElementwiseProgram& program, ElemType alpha)
+{
+    std::vector<const ElemType*> pointers;
+    std::vector<size_t> sizes;
+    for (const auto& input : inputs)
+    {
+        input->PrepareDevice();
+        if (input->GetComputeDeviceId() != GetComputeDeviceId())
+            InvalidArgument("All matrices must be on the same GPU");
+        pointers.push_back(input->Data());
+        sizes.push_back(input->GetNumElements());
+    }
+    LaunchElementwiseProgram<ElemType>(beta, pointers, sizes, Data(), alpha, program, GetNumRows(), GetNumElements());
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::DropoutOp(ElemType beta, const GPUMatrix<ElemType>& a, double dropoutRate, uint64_t seed, uint64_t offset)
+{
+    // the sizes are verified by Matrix::DropoutOp()
+    const size_t N = a.GetNumElements();
+    if (N == 0)
+        return;
+
+    a.PrepareDevice();
+    if (a.GetComputeDeviceId() != GetComputeDeviceId())
+        InvalidArgument("All matrices must be on the same GPU");
+
+    // one thread per Philox block of four elements
+    const uint64_t firstBlock = offset >> 2;
+    const CUDA_LONG numBlocks = (CUDA_LONG)(((offset + N - 1) >> 2) - firstBlock + 1);
+    size_t blocksPerGrid = (size_t) ceil(numBlocks / (double) GridDim::maxThreadsPerBlock);
+    SyncGuard syncGuard;
+    _dropout<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock, 0, t_stream>>>(Data(), a.Data(), (CUDA_LONG)N, numBlocks, beta,
+                                                                                      (float)dropoutRate, (ElemType)(1.0 / (1.0 - dropoutRate)), seed, offset);
+}
+
 // =======================================================================
 // explicit instantiations business
 // =======================================================================
 template class GPUMatrix<float>;
 template class GPUMatrix<double>;
 template class GPUMatrix<half>;
+template class GPUMatrix<bfloat16>;
 template class DeviceBoundNumber<float>;
 template class DeviceBoundNumber<double>;
 template class DeviceBoundNumber<half>;
+template class DeviceBoundNumber<bfloat16>;
 
 // instantiation of cast methods
 template void GPUMatrix<char>::CastAssignValuesOf<float>(const GPUMatrix<float>* other);
 template void GPUMatrix<char>::CastAssignValuesOf<double>(const GPUMatrix<double>* other);
 template void GPUMatrix<char>::CastAssignValuesOf<half>(const GPUMatrix<half>* other);
+template void GPUMatrix<char>::CastAssignValuesOf<bfloat16>(const GPUMatrix<bfloat16>* other);
 template void GPUMatrix<short>::CastAssignValuesOf<float>(const GPUMatrix<float>* other);
 template void GPUMatrix<short>::CastAssignValuesOf<double>(const GPUMatrix<double>* other);
 template void GPUMatrix<short>::CastAssignValuesOf<half>(const GPUMatrix<half>* other);
+template void GPUMatrix<short>::CastAssignValuesOf<bfloat16>(const GPUMatrix<bfloat16>* other);
 template void GPUMatrix<int>::CastAssignValuesOf<float>(const GPUMatrix<float>* other);
 template void GPUMatrix<int>::CastAssignValuesOf<double>(const GPUMatrix<double>* other);
 template void GPUMatrix<int>::CastAssignValuesOf<half>(const GPUMatrix<half>* other);
+template void GPUMatrix<int>::CastAssignValuesOf<bfloat16>(const GPUMatrix<bfloat16>* other);
 template void GPUMatrix<float>::CastAssignValuesOf<float>(const GPUMatrix<float>* other);
 template void GPUMatrix<float>::CastAssignValuesOf<double>(const GPUMatrix<double>* other);
 template void GPUMatrix<float>::CastAssignValuesOf<half>(const GPUMatrix<half>* other);
+template void GPUMatrix<float>::CastAssignValuesOf<bfloat16>(const GPUMatrix<bfloat16>* other);
 template void GPUMatrix<double>::CastAssignValuesOf<float>(const GPUMatrix<float>* other);
 template void GPUMatrix<double>::CastAssignValuesOf<double>(const GPUMatrix<double>* other);
 template void GPUMatrix<double>::CastAssignValuesOf<half>(const GPUMatrix<half>* other);
+template void GPUMatrix<double>::CastAssignValuesOf<bfloat16>(const GPUMatrix<bfloat16>* other);
 template void GPUMatrix<half>::CastAssignValuesOf<float>(const GPUMatrix<float>* other);
 template void GPUMatrix<half>::CastAssignValuesOf<double>(const GPUMatrix<double>* other);
 template void GPUMatrix<half>::CastAssignValuesOf<half>(const GPUMatrix<half>* other);
+template void GPUMatrix<half>::CastAssignValuesOf<bfloat16>(const GPUMatrix<bfloat16>* other);
+template void GPUMatrix<bfloat16>::CastAssignValuesOf<float>(const GPUMatrix<float>* other);
+template void GPUMatrix<bfloat16>::CastAssignValuesOf<double>(const GPUMatrix<double>* other);
+template void GPUMatrix<bfloat16>::CastAssignValuesOf<half>(const GPUMatrix<half>* other);
+template void GPUMatrix<bfloat16>::CastAssignValuesOf<bfloat16>(const GPUMatrix<bfloat16>* other);
 
 // instantiation of templated methods
 template void GPUMatrix<float>::AdaDelta<float>(GPUMatrix<float>& gradients, GPUMatrix<float>& functionValues, float learningRate, float rho, float epsilon);
 template void GPUMatrix<double>::AdaDelta<double>(GPUMatrix<double>& gradients, GPUMatrix<double>& functionValues, double learningRate, double rho, double epsilon);
 template void GPUMatrix<float>::AdaDelta<half>(GPUMatrix<half>& gradients, GPUMatrix<float>& functionValues, float learningRate, float rho, float epsilon);
+template void GPUMatrix<float>::AdaDelta<bfloat16>(GPUMatrix<bfloat16>& gradients, GPUMatrix<float>& functionValues, float learningRate, float rho, float epsilon);
 
-template void GPUMatrix<float>::BatchNormalizationForward(const GPUMatrix<float>& scale, const GPUMatrix<float>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, GPUMatrix<float>& runMean, GPUMatrix<float>& runVariance, GPUMatrix<float>& out, double epsilon, GPUMatrix<float>& saveMean, GPUMatrix<float>& saveInvStdDev) const;
-template void GPUMatrix<double>::BatchNormalizationForward(const GPUMatrix<double>& scale, const GPUMatrix<double>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, GPUMatrix<double>& runMean, GPUMatrix<double>& runVariance, GPUMatrix<double>& out, double epsilon, GPUMatrix<double>& saveMean, GPUMatrix<double>& saveInvStdDev) const;
-template void GPUMatrix<half>::BatchNormalizationForward(const GPUMatrix<float>& scale, const GPUMatrix<float>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, GPUMatrix<float>& runMean, GPUMatrix<float>& runVariance, GPUMatrix<half>& out, double epsilon, GPUMatrix<float>& saveMean, GPUMatrix<float>& saveInvStdDev) const;
+template void GPUMatrix<float>::BatchNormalizationForward(const GPUMatrix<float>& scale, const GPUMatrix<float>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, GPUMatrix<float>& runMean, GPUMatrix<float>& runVariance, GPUMatrix<float>& out, double epsilon, GPUMatrix<float>& saveMean, GPUMatrix<float>& saveInvStdDev, bool reluOutput) const;
+template void GPUMatrix<double>::BatchNormalizationForward(const GPUMatrix<double>& scale, const GPUMatrix<double>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, GPUMatrix<double>& runMean, GPUMatrix<double>& runVariance, GPUMatrix<double>& out, double epsilon, GPUMatrix<double>& saveMean, GPUMatrix<double>& saveInvStdDev, bool reluOutput) const;
+template void GPUMatrix<half>::BatchNormalizationForward(const GPUMatrix<float>& scale, const GPUMatrix<float>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, GPUMatrix<float>& runMean, GPUMatrix<float>& runVariance, GPUMatrix<half>& out, double epsilon, GPUMatrix<float>& saveMean, GPUMatrix<float>& saveInvStdDev, bool reluOutput) const;
+template void GPUMatrix<bfloat16>::BatchNormalizationForward(const GPUMatrix<float>& scale, const GPUMatrix<float>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, GPUMatrix<float>& runMean, GPUMatrix<float>& runVariance, GPUMatrix<bfloat16>& out, double epsilon, GPUMatrix<float>& saveMean, GPUMatrix<float>& saveInvStdDev, bool reluOutput) const;
 
-template void GPUMatrix<float>::BatchNormalizationBackward(const GPUMatrix<float>& in, GPUMatrix<float>& grad, const GPUMatrix<float>& scale, double blendFactor, const GPUMatrix<float>& saveMean, const GPUMatrix<float>& saveInvStdDev, GPUMatrix<float>& scaleGrad, GPUMatrix<float>& biasGrad) const;
-template void GPUMatrix<double>::BatchNormalizationBackward(const GPUMatrix<double>& in, GPUMatrix<double>& grad, const GPUMatrix<double>& scale, double blendFactor, const GPUMatrix<double>& saveMean, const GPUMatrix<double>& saveInvStdDev, GPUMatrix<double>& scaleGrad, GPUMatrix<double>& biasGrad) const;
-template void GPUMatrix<half>::BatchNormalizationBackward(const GPUMatrix<half>& in, GPUMatrix<half>& grad, const GPUMatrix<float>& scale, double blendFactor, const GPUMatrix<float>& saveMean, const GPUMatrix<float>& saveInvStdDev, GPUMatrix<float>& scaleGrad, GPUMatrix<float>& biasGrad) const;
+template void GPUMatrix<float>::BatchNormalizationBackward(const GPUMatrix<float>& in, GPUMatrix<float>& grad, const GPUMatrix<float>& scale, double blendFactor, const GPUMatrix<float>& saveMean, const GPUMatrix<float>& saveInvStdDev, GPUMatrix<float>& scaleGrad, GPUMatrix<float>& biasGrad, const GPUMatrix<float>* reluOutput) const;
+template void GPUMatrix<double>::BatchNormalizationBackward(const GPUMatrix<double>& in, GPUMatrix<double>& grad, const GPUMatrix<double>& scale, double blendFactor, const GPUMatrix<double>& saveMean, const GPUMatrix<double>& saveInvStdDev, GPUMatrix<double>& scaleGrad, GPUMatrix<double>& biasGrad, const GPUMatrix<double>* reluOutput) const;
+template void GPUMatrix<half>::BatchNormalizationBackward(const GPUMatrix<half>& in, GPUMatrix<half>& grad, const GPUMatrix<float>& scale, double blendFactor, const GPUMatrix<float>& saveMean, const GPUMatrix<float>& saveInvStdDev, GPUMatrix<float>& scaleGrad, GPUMatrix<float>& biasGrad, const GPUMatrix<half>* reluOutput) const;
+template void GPUMatrix<bfloat16>::BatchNormalizationBackward(const GPUMatrix<bfloat16>& in, GPUMatrix<bfloat16>& grad, const GPUMatrix<float>& scale, double blendFactor, const GPUMatrix<float>& saveMean, const GPUMatrix<float>& saveInvStdDev, GPUMatrix<float>& scaleGrad, GPUMatrix<float>& biasGrad, const GPUMatrix<bfloat16>* reluOutput) const;
 
 template <class ElemType>
 cublasHandle_t GPUMatrix<ElemType>::s_cuHandle[GPUMatrix<ElemType>::MaxGpus] = {0};
@@ -5073,6 +6116,7 @@ template char* TracingGPUMemoryAllocator::Allocate<char>(int, size_t);
 template float* TracingGPUMemoryAllocator::Allocate<float>(int, size_t);
 template double* TracingGPUMemoryAllocator::Allocate<double>(int, size_t);
 template half* TracingGPUMemoryAllocator::Allocate<half>(int, size_t);
+template bfloat16* TracingGPUMemoryAllocator::Allocate<bfloat16>(int, size_t);
 
 template void TracingGPUMemoryAllocator::Free<int>(int, int*, bool);
 template void TracingGPUMemoryAllocator::Free<size_t>(int, size_t*, bool);
@@ -5081,6 +6125,7 @@ template void TracingGPUMemoryAllocator::Free<char>(int, char*, bool);
 template void TracingGPUMemoryAllocator::Free<float>(int, float*, bool);
 template void TracingGPUMemoryAllocator::Free<double>(int, double*, bool);
 template void TracingGPUMemoryAllocator::Free<half>(int, half*, bool);
+template void TracingGPUMemoryAllocator::Free<bfloat16>(int, bfloat16*, bool);
 
 }}}
 
@@ -12,6 +12,7 @@
 #include "BestGpu.h" // for CPUONLY macro
 #include "ConcStack.h"
 #include "GPURNGHandle.h"
+#include "half.hpp"
 #include <string>
 #include <vector>
 #include <array>
@@ -188,6 +189,17 @@ private:
     std::unique_ptr<GPUMatrix<ElemType>> GetOrCreateWorkspace() const;
     void ReleaseWorkspace(std::unique_ptr<GPUMatrix<ElemType>> src) const;
 
+    // the largest k that VectorMax() and VectorTopKSoftmax() select without sorting
+    static const int c_maxTopKSelect = 64;
+    void SelectTopK(GPUMatrix<ElemType>& topIndexes, GPUMatrix<ElemType>& topValues, GPUMatrix<ElemType>* logSumExp, int topK) const;
+
+    // the largest m, n and k of the products that are computed by a register-blocked kernel instead of cuBLAS,
+    // for which these are launch-bound
+    static const int c_maxSmallGemmDim = 64;
+    // c_i = alpha * op(a_i) * op(b_i) + beta * c_i for 'batchCount' products, the i-th operands starting 'stride' elements after the previous ones
+    static void StridedBatchedMultiplyAndWeightedAdd(ElemType alpha, const ElemType* a, int lda, size_t strideA, bool transposeA, const ElemType* b, int ldb, size_t strideB, bool transposeB,
+                                                     ElemType beta, ElemType* c, int ldc, size_t strideC, int m, int n, int k, int batchCount, int deviceId);
+
 public:
     explicit GPUMatrix(int deviceId);
     GPUMatrix(const size_t numRows, const size_t numCols, int deviceId);
@@ -207,6 +219,7 @@ public:
     void CopySection(size_t numRows, size_t numCols, ElemType* dst, size_t colStride) const;
 
     void ChangeDeviceTo(DEVICEID_TYPE to_id);
+    void ChangeDeviceToAsync(DEVICEID_TYPE to_id); // GPU to GPU without waiting for the copy
 
     template<class ElemType2>
     void CastAssignValuesOf(const GPUMatrix<ElemType2>* other);
@@ -237,6 +250,11 @@ public:
     void Adam(GPUMatrix<ElemType>& gradients, GPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample,
               ElemType momentum, ElemType adaWeight, ElemType adaMul, ElemType epsilon, ElemType unitGainFactor, bool adamax=false);
 
+    static void MultiTensorUpdate(const MultiTensorUpdateParameters<ElemType>& update, const std::vector<GPUMatrix<ElemType>*>& parameters,
+                                  const std::vector<const GPUMatrix<ElemType>*>& gradients, const std::vector<GPUMatrix<ElemType>*>& smoothedGradients);
+    static ElemType MultiTensorSumOfSquares(const std::vector<const GPUMatrix<ElemType>*>& matrices);
+    static void MultiTensorSumsOfSquares(const std::vector<const GPUMatrix<ElemType>*>& matrices, std::vector<ElemType>& sums);
+
     ElemType RmsProp(GPUMatrix<ElemType>& gradients, 
                      ElemType RMS_GAMMA, 
                      ElemType RMS_WGT_INC, 
@@ -250,6 +268,7 @@ public:
     void AdaDelta(GPUMatrix<GradType>& gradients, GPUMatrix<ElemType>& functionValues, ElemType learningRate, ElemType rho, ElemType epsilon);
 
     void AdaDeltaFlushTimestamps(size_t cols, ElemType rho, int* timestamps, int currentTimestamp);
+    void LazyDecayFlushTimestamps(size_t cols, ElemType decay, ElemType secondDecay, int* timestamps, int currentTimestamp);
 
     void Reshape(const size_t numRows, const size_t numCols);
 
@@ -291,14 +310,20 @@ public:
     void SetUniformRandomMask(const ElemType maskRate, const ElemType scaleValue, RNGHandle& rngHandle);
 
     GPUMatrix<ElemType>& AssignOneHot(const GPUMatrix<ElemType>& a, vector<size_t>& shape, size_t axis);
-    GPUMatrix<ElemType>& GatherFromTarget(const GPUMatrix<ElemType>& indices, const GPUMatrix<ElemType>& target, size_t row_elements);
-    GPUMatrix<ElemType>& ScatterToIndices(const GPUMatrix<ElemType>& values, const GPUMatrix<ElemType>& indices, size_t row_elements, const GPUMatrix<char>* mask = nullptr);
+    GPUMatrix<ElemType>& GatherFromTarget(const GPUMatrix<ElemType>& indices, const GPUMatrix<ElemType>& target, size_t row_elements, size_t outer_elements = 1);
+    GPUMatrix<ElemType>& ScatterToIndices(const GPUMatrix<ElemType>& values, const GPUMatrix<ElemType>& indices, size_t row_elements, size_t outer_elements = 1, const GPUMatrix<char>* mask = nullptr);
 
     GPUMatrix<ElemType> Transpose() const;
     GPUMatrix<ElemType>& AssignTransposeOf(const GPUMatrix<ElemType>& a);
 
     GPUMatrix<ElemType>& DoGatherColumnsOf (ElemType beta, const GPUMatrix<ElemType>& idx, const GPUMatrix<ElemType>& a, ElemType alpha);
     GPUMatrix<ElemType>& DoScatterColumnsOf(ElemType beta, const GPUMatrix<ElemType>& idx, const GPUMatrix<ElemType>& a, ElemType alpha, bool idxHaveDups);
+    GPUMatrix<ElemType>& AssignDequantizedColumnsOf(const GPUMatrix<ElemType>& idx, const GPUMatrix<char>& codes, const GPUMatrix<ElemType>& scalesAndOffsets);
+    GPUMatrix<ElemType>& AssignDequantizedColumnsOf(const GPUMatrix<ElemType>& idx, const GPUMatrix<half>& codes, const GPUMatrix<ElemType>& scalesAndOffsets);
+
+    GPUMatrix<ElemType>& AssignSegmentedReductionOf(const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& segments, size_t columnStride, ElementWiseOperator reductionOp, bool average);
+    GPUMatrix<ElemType>& DoSegmentedReductionGradientOf(ElemType beta, const GPUMatrix<ElemType>& outputGradient, const GPUMatrix<ElemType>& input, const GPUMatrix<ElemType>& output,
+                                                        const GPUMatrix<ElemType>& segments, size_t columnStride, ElementWiseOperator reductionOp, bool average);
 
     GPUMatrix<ElemType>& operator+=(const ElemType alpha);
     GPUMatrix<ElemType> operator+(const ElemType alpha) const;
@@ -364,6 +389,7 @@ public:
 
     GPUMatrix<ElemType>& InplaceLogSoftmax(const bool isColWise);
     GPUMatrix<ElemType>& AssignLogSoftmaxOf(const GPUMatrix<ElemType>& a, const bool isColWise);
+    GPUMatrix<ElemType>& InplaceSegmentedLogSoftmax(const std::vector<int>& segmentOffsets);
 
     GPUMatrix<ElemType>& InplaceHardmax(const bool isColWise);
     GPUMatrix<ElemType>& AssignHardmaxOf(const GPUMatrix<ElemType>& a, const bool isColWise);
@@ -375,6 +401,11 @@ public:
     GPUMatrix<ElemType>& AssignCTCScore(const GPUMatrix<ElemType>& prob, GPUMatrix<ElemType>& alpha, GPUMatrix<ElemType>& beta,
         const GPUMatrix<ElemType> phoneSeq, const GPUMatrix<ElemType> phoneBoundary, GPUMatrix<ElemType> & totalScore, const vector<size_t>& uttMap, const vector<size_t> & uttBeginFrame, const vector<size_t> & uttFrameNum,
         const vector<size_t> & uttPhoneNum, const size_t samplesInRecurrentStep, const size_t maxFrameNum, const size_t blankTokenId, const int delayConstraint, const bool isColWise);
+    GPUMatrix<ElemType>& AssignEditDistances(const GPUMatrix<ElemType>& firstSeq, const GPUMatrix<ElemType>& secondSeq, const vector<size_t>& uttToChanInd, const vector<size_t>& uttBeginFrame, const vector<size_t>& uttFrameNum, const size_t numParallelSequences,
+        const float subPen, const float delPen, const float insPen, const bool squashInputs, const vector<size_t>& tokensToIgnore);
+    GPUMatrix<ElemType>& AssignLambdaRankRanks(const GPUMatrix<ElemType>& gains, const GPUMatrix<ElemType>& scores, const vector<size_t>& queryBegins, GPUMatrix<ElemType>& metrics);
+    static void AddLambdaRankGradient(const GPUMatrix<ElemType>& gains, const GPUMatrix<ElemType>& scores, const GPUMatrix<ElemType>& ranks, const GPUMatrix<ElemType>& metrics,
+        const vector<size_t>& queryBegins, const ElemType sigma, GPUMatrix<ElemType>& gradient);
 
     GPUMatrix<ElemType>& InplaceSqrt();
     GPUMatrix<ElemType>& AssignSqrtOf(const GPUMatrix<ElemType>& a);
@@ -428,6 +459,7 @@ public:
     ElemType SumOfAbsElements() const; // sum of all abs(elements)
     ElemType SumOfElements() const;    // sum of all elements
     GPUMatrix<ElemType>& AssignSumOfElements(const GPUMatrix<ElemType>& a);
+    GPUMatrix<ElemType>& AssignHistogramOf(const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& bucketLimits); // see Matrix.h
 
     ElemType AbsoluteMax() const;
     bool IsEqualTo(const GPUMatrix<ElemType>& a, const ElemType threshold = 1e-8) const;
@@ -472,8 +504,12 @@ public:
 
     void VectorMax(GPUMatrix<ElemType>& maxIndexes, GPUMatrix<ElemType>& maxValues, const bool isColWise) const;
     void VectorMax(GPUMatrix<ElemType>& maxIndexes, GPUMatrix<ElemType>& maxValues, const bool isColWise, int topK) const;
+    void VectorTopKSoftmax(GPUMatrix<ElemType>& topIndexes, GPUMatrix<ElemType>& topValues, GPUMatrix<ElemType>& logSumExp, int topK) const;
     void VectorMin(GPUMatrix<ElemType>& minIndexes, GPUMatrix<ElemType>& minValues, const bool isColWise) const;
 
+    void ExtractTopKMagnitudes(size_t k, std::vector<int>& indices, std::vector<ElemType>& values);
+    void ScatterAddValues(const std::vector<int>& indices, const std::vector<ElemType>& values);
+
     GPUMatrix<ElemType>& AssignNumOfDiff(const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, bool searchInCol = false);
 
     GPUMatrix<ElemType>& AssignInnerProductOfMatrices(const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b);
@@ -537,23 +573,41 @@ public:
                                const size_t pooledWidth, const size_t pooledHeight, const GPUMatrix<ElemType>& roiData, GPUMatrix<ElemType>& grad, 
                                GPUMatrix<ElemType>& argmax, double spatialScale) const;
 
+    void AverageROIAlignForward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
+                                const size_t pooledWidth, const size_t pooledHeight, const GPUMatrix<ElemType>& roiData, GPUMatrix<ElemType>& output,
+                                double spatialScale) const;
+
+    void AverageROIAlignBackward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
+                                 const size_t pooledWidth, const size_t pooledHeight, const GPUMatrix<ElemType>& roiData, GPUMatrix<ElemType>& grad,
+                                 double spatialScale) const;
+
     void AveragePoolingForward(const GPUMatrix<int>& mpRowCol, const GPUMatrix<int>& mpRowIndices, const GPUMatrix<int>& indices, GPUMatrix<ElemType>& output) const;
     void AveragePoolingBackward(const GPUMatrix<int>& mpRowCol, const GPUMatrix<int>& mpRowIndices, const GPUMatrix<int>& indices, GPUMatrix<ElemType>& grad, bool accumulateGradient) const;
 
     template<class StatType>
     void BatchNormalizationForward(const GPUMatrix<StatType>& scale, const GPUMatrix<StatType>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor,
                                    GPUMatrix<StatType>& runMean, GPUMatrix<StatType>& runVariance, GPUMatrix<ElemType>& out, double epsilon,
-                                   GPUMatrix<StatType>& saveMean, GPUMatrix<StatType>& saveInvStdDev) const;
+                                   GPUMatrix<StatType>& saveMean, GPUMatrix<StatType>& saveInvStdDev, bool reluOutput) const;
 
     template<class StatType>
     void BatchNormalizationBackward(const GPUMatrix<ElemType>& in, GPUMatrix<ElemType>& grad, const GPUMatrix<StatType>& scale, double blendFactor,
                                     const GPUMatrix<StatType>& saveMean, const GPUMatrix<StatType>& saveInvStdDev,
-                                    GPUMatrix<StatType>& scaleGrad, GPUMatrix<StatType>& biasGrad) const;
+                                    GPUMatrix<StatType>& scaleGrad, GPUMatrix<StatType>& biasGrad, const GPUMatrix<ElemType>* reluOutput) const;
+
+    void LayerNormalizationForward(const GPUMatrix<ElemType>& scale, const GPUMatrix<ElemType>& bias, double epsilon, GPUMatrix<ElemType>& out,
+                                   GPUMatrix<ElemType>& saveMean, GPUMatrix<ElemType>& saveInvStdDev) const;
+    void LayerNormalizationBackward(const GPUMatrix<ElemType>& in, GPUMatrix<ElemType>& grad, const GPUMatrix<ElemType>& scale,
+                                    const GPUMatrix<ElemType>& saveMean, const GPUMatrix<ElemType>& saveInvStdDev,
+                                    GPUMatrix<ElemType>& scaleGrad, GPUMatrix<ElemType>& biasGrad) const;
 
     // RNN support functions
     void RNNForward(const GPUMatrix<ElemType>& inputX, const GPUMatrix<ElemType>& paramW, size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame, const struct RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace);
     void RNNBackwardData(const GPUMatrix<ElemType>& outputDY, const GPUMatrix<ElemType>& paramW, GPUMatrix<ElemType>& outputDX, const struct RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace);
     void RNNBackwardWeights(const GPUMatrix<ElemType>& inputX, const GPUMatrix<ElemType>& outputY, GPUMatrix<ElemType>& dw, const struct RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace);
+    // variants for data in the minibatch layout, see Matrix.h; *this only holds the RNN state
+    static bool IsRNNUnpackedLayoutSupported();
+    void RNNForwardUnpacked(const GPUMatrix<ElemType>& inputX, const GPUMatrix<ElemType>& paramW, GPUMatrix<ElemType>& outputY, size_t xDim, size_t yDim, const vector<int>& sequenceLengths, const struct RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace);
+    void RNNBackwardDataUnpacked(const GPUMatrix<ElemType>& outputY, const GPUMatrix<ElemType>& outputDY, const GPUMatrix<ElemType>& paramW, GPUMatrix<ElemType>& outputDX, const struct RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace);
 
 public:
     // static BLAS functions
@@ -607,6 +661,10 @@ public:
                      const SmallVector<size_t>& regularOpDims, const std::array<SmallVector<ptrdiff_t>, 2>& regularStrides,
                      const SmallVector<size_t>& reducingOpDims, const std::array<SmallVector<ptrdiff_t>, 2>& reducingStrides);
 
+    void ElementwiseProgramOp(ElemType beta, const std::vector<const GPUMatrix<ElemType>*>& inputs, const ElementwiseProgram& program, ElemType alpha);
+
+    void DropoutOp(ElemType beta, const GPUMatrix<ElemType>& a, double dropoutRate, uint64_t seed, uint64_t offset);
+
     static void CreateCurandObject(unsigned long seed, const char* caller);
     static void ResetCurandObject(unsigned long seed, const char* caller);
     static GPUMatrix<ElemType> Ones(const size_t rows, const size_t cols, int deviceId);
@@ -655,8 +713,7 @@ public:
         int format;
         stream >> matrixNameDummy >> format >> numRows >> numCols;
         ElemType* d_array = new ElemType[numRows * numCols];
-        for (size_t i = 0; i < numRows * numCols; ++i)
-            stream >> d_array[i];
+        stream.ReadValues(d_array, numRows * numCols);
         stream.GetMarker(fileMarkerEndSection, std::wstring(L"EMAT"));
         us.SetValue(numRows, numCols, us.GetComputeDeviceId(), d_array, matrixFlagNormal | format);
         delete[] d_array;
@@ -674,9 +731,8 @@ public:
 
         stream << us.m_numRows << us.m_numCols;
         ElemType* pArray = us.CopyToArray();
-        for (size_t i = 0; i < us.GetNumElements(); ++i)
-            stream << pArray[i];
-        
+        stream.WriteValues(pArray, us.GetNumElements());
+
         delete[] pArray;
 
         stream.PutMarker(fileMarkerEndSection, std::wstring(L"EMAT"));
@@ -51,6 +51,23 @@ static __inline__ __device__ half atomicAdd(half* address, half val)
     assert(false); // TODO: implement later
     return val;
 }
+// overload atomicAdd for bfloat16, with a compare-and-swap of the aligned 32 bits that hold it
+static __inline__ __device__ bfloat16 atomicAdd(bfloat16* address, bfloat16 val)
+{
+    unsigned int* word = (unsigned int*)((size_t)address & ~(size_t)2);
+    const unsigned int shift = ((size_t)address & 2) ? 16 : 0;
+    unsigned int old = *word, assumed;
+    unsigned short oldBits;
+    do
+    {
+        assumed = old;
+        oldBits = (unsigned short)(assumed >> shift);
+        bfloat16 sum = *(bfloat16*)&oldBits + val;
+        unsigned int sumBits = *(unsigned short*)&sum;
+        old = atomicCAS(word, assumed, (assumed & ~(0xffffu << shift)) | (sumBits << shift));
+    } while (assumed != old);
+    return *(bfloat16*)&oldBits;
+}
 
 
 // TODO: replace this with TensorOps.h LogAdd(). It differs in using ElemType throughout, while this one seems to use 'double' versions of exp() and log().
@@ -717,6 +734,105 @@ __global__ void _multiply1x1AndWeightedAdd(
         c[id] = (comp_t)b[id] * f + (comp_t)c[id] * (comp_t)beta;
 }
 
+// c_i = alpha * op(a_i) * op(b_i) + beta * c_i for products with m <= TileM and n <= TileN, one block per product.
+// Each of the (TileM / ItemsM) x (TileN / ItemsN) threads keeps an ItemsM x ItemsN block of c_i in registers and
+// accumulates it over slices of TileK rows of op(b_i), which are staged in shared memory with the matching columns of op(a_i).
+// The elements of a thread are strided by the number of threads along each dimension, so that neighbouring threads
+// read neighbouring elements of the shared tiles and write neighbouring elements of c_i.
+template <class ElemType, int TileM, int TileN, int ItemsM, int ItemsN, int TileK>
+__global__ void _multiplyAndWeightedAddSmallBatched(
+    const ElemType alpha, const ElemType* a, const CUDA_LONG lda, const size_t strideA, const bool transA,
+    const ElemType* b, const CUDA_LONG ldb, const size_t strideB, const bool transB,
+    const ElemType beta, ElemType* c, const CUDA_LONG ldc, const size_t strideC,
+    const CUDA_LONG m, const CUDA_LONG n, const CUDA_LONG k)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    const int threadsM = TileM / ItemsM;
+    const int threadsN = TileN / ItemsN;
+    const int numThreads = threadsM * threadsN;
+
+    __shared__ comp_t tileA[TileK][TileM];     // tileA[kk][i] = op(a)(i, k0 + kk)
+    __shared__ comp_t tileB[TileK][TileN + 1]; // tileB[kk][j] = op(b)(k0 + kk, j); padded, as it is written along kk
+
+    a += blockIdx.x * strideA;
+    b += blockIdx.x * strideB;
+    c += blockIdx.x * strideC;
+
+    const int tid = threadIdx.x;
+    const int ti = tid % threadsM;
+    const int tj = tid / threadsM;
+
+    comp_t sum[ItemsM][ItemsN];
+#pragma unroll
+    for (int r = 0; r < ItemsM; r++)
+#pragma unroll
+        for (int s = 0; s < ItemsN; s++)
+            sum[r][s] = 0;
+
+    for (CUDA_LONG k0 = 0; k0 < k; k0 += TileK)
+    {
+        for (int idx = tid; idx < TileK * TileM; idx += numThreads)
+        {
+            int i = idx % TileM;
+            int kk = idx / TileM;
+            CUDA_LONG kIndex = k0 + kk;
+            comp_t value = 0;
+            if (i < m && kIndex < k)
+                value = (comp_t)(transA ? a[i * lda + kIndex] : a[kIndex * lda + i]);
+            tileA[kk][i] = value;
+        }
+        for (int idx = tid; idx < TileK * TileN; idx += numThreads)
+        {
+            int kk = idx % TileK;
+            int j = idx / TileK;
+            CUDA_LONG kIndex = k0 + kk;
+            comp_t value = 0;
+            if (j < n && kIndex < k)
+                value = (comp_t)(transB ? b[kIndex * ldb + j] : b[j * ldb + kIndex]);
+            tileB[kk][j] = value;
+        }
+        __syncthreads();
+
+#pragma unroll
+        for (int kk = 0; kk < TileK; kk++)
+        {
+            comp_t aValues[ItemsM];
+            comp_t bValues[ItemsN];
+#pragma unroll
+            for (int r = 0; r < ItemsM; r++)
+                aValues[r] = tileA[kk][ti + r * threadsM];
+#pragma unroll
+            for (int s = 0; s < ItemsN; s++)
+                bValues[s] = tileB[kk][tj + s * threadsN];
+#pragma unroll
+            for (int r = 0; r < ItemsM; r++)
+#pragma unroll
+                for (int s = 0; s < ItemsN; s++)
+                    sum[r][s] += aValues[r] * bValues[s];
+        }
+        __syncthreads();
+    }
+
+#pragma unroll
+    for (int r = 0; r < ItemsM; r++)
+    {
+        int i = ti + r * threadsM;
+#pragma unroll
+        for (int s = 0; s < ItemsN; s++)
+        {
+            int j = tj + s * threadsN;
+            if (i < m && j < n)
+            {
+                ElemType* pc = c + j * ldc + i;
+                if (beta == 0) // don't even read the memory if beta is 0
+                    *pc = (comp_t)alpha * sum[r][s];
+                else
+                    *pc = (comp_t)alpha * sum[r][s] + (comp_t)beta * (comp_t)*pc;
+            }
+        }
+    }
+}
+
 template <class ElemType>
 __global__ void _addValue(
     ElemType* a,
@@ -1086,6 +1202,194 @@ __global__ void _assignColumnwiseLogSoftmaxOf512Threads(
     }
 }
 
+// In-place log softmax of runs of elements of different lengths, run k being [offsets[k], offsets[k + 1]).
+// Each block processes one run. There must be 128 threads in a block.
+template <class ElemType>
+__global__ void _inplaceSegmentedLogSoftmax128Threads(
+    ElemType* us,
+    const int* offsets)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    __shared__ comp_t partials[128];
+    const int begin = offsets[blockIdx.x];
+    const int end = offsets[blockIdx.x + 1];
+
+    comp_t maxV = -10000000;
+    for (int i = begin + threadIdx.x; i < end; i += 128)
+        maxV = max(maxV, (comp_t)us[i]);
+    partials[threadIdx.x] = maxV;
+    __syncthreads();
+    for (int s = 64; s > 0; s >>= 1)
+    {
+        if (threadIdx.x < s)
+            partials[threadIdx.x] = max(partials[threadIdx.x + s], partials[threadIdx.x]);
+        __syncthreads();
+    }
+    maxV = partials[0];
+    __syncthreads();
+
+    comp_t sum = 0;
+    for (int i = begin + threadIdx.x; i < end; i += 128)
+        sum += exp_((comp_t)us[i] - maxV);
+    partials[threadIdx.x] = sum;
+    __syncthreads();
+    for (int s = 64; s > 0; s >>= 1)
+    {
+        if (threadIdx.x < s)
+            partials[threadIdx.x] += partials[threadIdx.x + s];
+        __syncthreads();
+    }
+    const comp_t logSum = maxV + log_(partials[0]);
+
+    for (int i = begin + threadIdx.x; i < end; i += 128)
+        us[i] = (comp_t)us[i] - logSum;
+}
+
+// Layer normalization of each column of a over its rows, one block of 512 threads per column: us = scale .* (a - mean) * invStdDev + bias.
+// Each thread computes Welford statistics (count, mean, sum of squared deviations) of a strided part of the column
+// in a single pass, and the partial statistics are combined pairwise (Chan et al.) in shared memory.
+template <class ElemType>
+__global__ void _layerNormalizationForward512Threads(
+    const ElemType* a,
+    ElemType* us,
+    const ElemType* scale,
+    const ElemType* bias,
+    ElemType* saveMean,
+    ElemType* saveInvStdDev,
+    const CUDA_LONG m_numRows,
+    const double epsilon)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    __shared__ comp_t partialCounts[512];
+    __shared__ comp_t partialMeans[512];
+    __shared__ comp_t partialM2s[512];
+
+    comp_t count = 0;
+    comp_t mean = 0;
+    comp_t m2 = 0;
+    for (int i = threadIdx.x; i < m_numRows; i += 512)
+    {
+        comp_t value = (comp_t)a[IDX2C(i, blockIdx.x, m_numRows)];
+        count += 1;
+        comp_t delta = value - mean;
+        mean += delta / count;
+        m2 += delta * (value - mean);
+    }
+    partialCounts[threadIdx.x] = count;
+    partialMeans[threadIdx.x] = mean;
+    partialM2s[threadIdx.x] = m2;
+    __syncthreads();
+
+    for (int stride = 256; stride > 0; stride >>= 1)
+    {
+        if (threadIdx.x < stride && partialCounts[threadIdx.x + stride] > 0)
+        {
+            comp_t countA = partialCounts[threadIdx.x];
+            comp_t countB = partialCounts[threadIdx.x + stride];
+            comp_t total = countA + countB;
+            comp_t delta = partialMeans[threadIdx.x + stride] - partialMeans[threadIdx.x];
+            partialMeans[threadIdx.x] += delta * countB / total;
+            partialM2s[threadIdx.x] += partialM2s[threadIdx.x + stride] + delta * delta * countA * countB / total;
+            partialCounts[threadIdx.x] = total;
+        }
+        __syncthreads();
+    }
+
+    comp_t colMean = partialMeans[0];
+    comp_t colInvStdDev = 1 / sqrt_(partialM2s[0] / m_numRows + (comp_t)epsilon);
+    if (threadIdx.x == 0)
+    {
+        saveMean[blockIdx.x] = colMean;
+        saveInvStdDev[blockIdx.x] = colInvStdDev;
+    }
+
+    for (int i = threadIdx.x; i < m_numRows; i += 512)
+    {
+        comp_t normalized = ((comp_t)a[IDX2C(i, blockIdx.x, m_numRows)] - colMean) * colInvStdDev;
+        us[IDX2C(i, blockIdx.x, m_numRows)] = normalized * (comp_t)scale[i] + (comp_t)bias[i];
+    }
+}
+
+// Gradient of the layer normalization with respect to its input, one block of 512 threads per column. With g = outGrad .* scale
+// and the normalized input xHat, it adds invStdDev * (g - mean(g) - xHat * mean(g .* xHat)) to inGrad.
+template <class ElemType>
+__global__ void _layerNormalizationBackward512Threads(
+    const ElemType* outGrad,
+    const ElemType* in,
+    ElemType* inGrad,
+    const ElemType* scale,
+    const ElemType* saveMean,
+    const ElemType* saveInvStdDev,
+    const CUDA_LONG m_numRows)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    __shared__ comp_t partialSums[512];
+    __shared__ comp_t partialProductSums[512];
+
+    const comp_t colMean = (comp_t)saveMean[blockIdx.x];
+    const comp_t colInvStdDev = (comp_t)saveInvStdDev[blockIdx.x];
+
+    comp_t sum = 0;
+    comp_t productSum = 0;
+    for (int i = threadIdx.x; i < m_numRows; i += 512)
+    {
+        comp_t g = (comp_t)outGrad[IDX2C(i, blockIdx.x, m_numRows)] * (comp_t)scale[i];
+        sum += g;
+        productSum += g * ((comp_t)in[IDX2C(i, blockIdx.x, m_numRows)] - colMean) * colInvStdDev;
+    }
+    partialSums[threadIdx.x] = sum;
+    partialProductSums[threadIdx.x] = productSum;
+    __syncthreads();
+
+    for (int stride = 256; stride > 0; stride >>= 1)
+    {
+        if (threadIdx.x < stride)
+        {
+            partialSums[threadIdx.x] += partialSums[threadIdx.x + stride];
+            partialProductSums[threadIdx.x] += partialProductSums[threadIdx.x + stride];
+        }
+        __syncthreads();
+    }
+
+    const comp_t meanOfG = partialSums[0] / m_numRows;
+    const comp_t meanOfProduct = partialProductSums[0] / m_numRows;
+    for (int i = threadIdx.x; i < m_numRows; i += 512)
+    {
+        comp_t g = (comp_t)outGrad[IDX2C(i, blockIdx.x, m_numRows)] * (comp_t)scale[i];
+        comp_t normalized = ((comp_t)in[IDX2C(i, blockIdx.x, m_numRows)] - colMean) * colInvStdDev;
+        inGrad[IDX2C(i, blockIdx.x, m_numRows)] = (comp_t)inGrad[IDX2C(i, blockIdx.x, m_numRows)] + colInvStdDev * (g - meanOfG - normalized * meanOfProduct);
+    }
+}
+
+// Gradients of the layer normalization with respect to scale and bias, one thread per row, summing over the columns.
+template <class ElemType>
+__global__ void _layerNormalizationParameterGradients(
+    const ElemType* outGrad,
+    const ElemType* in,
+    const ElemType* saveMean,
+    const ElemType* saveInvStdDev,
+    ElemType* scaleGrad,
+    ElemType* biasGrad,
+    const CUDA_LONG m_numRows,
+    const CUDA_LONG m_numCols)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    const CUDA_LONG row = blockDim.x * blockIdx.x + threadIdx.x;
+    if (row >= m_numRows)
+        return;
+
+    comp_t scaleSum = 0;
+    comp_t biasSum = 0;
+    for (CUDA_LONG j = 0; j < m_numCols; j++)
+    {
+        comp_t g = (comp_t)outGrad[IDX2C(row, j, m_numRows)];
+        scaleSum += g * ((comp_t)in[IDX2C(row, j, m_numRows)] - (comp_t)saveMean[j]) * (comp_t)saveInvStdDev[j];
+        biasSum += g;
+    }
+    scaleGrad[row] = scaleSum;
+    biasGrad[row] = biasSum;
+}
+
 template <class ElemType>
 __global__ void _logSoftMaxRowWise(
     ElemType* a,
@@ -1806,6 +2110,40 @@ __global__ void _setMaskAndScale(
     else     a[id] = scaleValue;
 }
 
+// c = beta * c + a .* mask * scaleValue, see Matrix::DropoutOp(); thread id computes the Philox block
+// (offset >> 2) + id, which gives the mask of up to four consecutive elements
+template <class ElemType>
+__global__ void _dropout(
+    ElemType* c,
+    const ElemType* a,
+    const CUDA_LONG N,
+    const CUDA_LONG numBlocks,
+    const ElemType beta,
+    const float maskRate,
+    const ElemType scaleValue,
+    const uint64_t seed,
+    const uint64_t offset)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    CUDA_LONG id = blockDim.x * blockIdx.x + threadIdx.x;
+    if (id >= numBlocks)
+        return;
+
+    const uint64_t block = (offset >> 2) + id;
+    uint32_t words[4];
+    Philox4x32(seed, block, words);
+    for (int w = 0; w < 4; w++)
+    {
+        const uint64_t index = (block << 2) + w;
+        if (index < offset || index - offset >= N)
+            continue;
+
+        const CUDA_LONG i = (CUDA_LONG)(index - offset);
+        const comp_t value = PhiloxUniform(words[w]) < maskRate ? (comp_t)0 : (comp_t)a[i] * (comp_t)scaleValue;
+        c[i] = beta == 0 ? value : (comp_t)beta * (comp_t)c[i] + value;
+    }
+}
+
 template <class ElemType>
 __global__ void _vectorSum(
     ElemType* c,       // output
@@ -2628,6 +2966,124 @@ __global__ void _vectorMaxMinReduce512Threads(
     }
 }
 
+// Orders the (value, row) candidates of _vectorTopKSelect(): larger values first, ties by the lower row as in a stable sort,
+// and invalid candidates (row < 0) last.
+template <class T>
+static __inline__ __device__ bool _topKPrecedes(T v1, int i1, T v2, int i2)
+{
+    return i1 >= 0 && (i2 < 0 || v1 > v2 || (v1 == v2 && i1 < i2));
+}
+
+// Combines two partial log-sum-exp's given as (max, sum of exp(x - max)) into the first one.
+template <class T>
+static __inline__ __device__ void _combineLogSumExp(T& max1, T& sum1, T max2, T sum2)
+{
+    T m = max1 > max2 ? max1 : max2;
+    sum1 = sum1 * exp_(max1 - m) + sum2 * exp_(max2 - m);
+    max1 = m;
+}
+
+// Selects the k largest elements of each column without sorting it, for k <= MaxK. Each block processes one column:
+// every thread keeps the k largest of its strided elements in a sorted list, and the lists are then merged by k
+// block-wide reductions of their heads. If logSumExp is not null, the block also computes the log-sum-exp of the
+// column in the same pass, and the selected values are returned as their softmax probabilities.
+template <class ElemType, int MaxK, int BlockSize>
+__global__ void _vectorTopKSelect(
+    const ElemType* us,
+    ElemType* Indexes,
+    ElemType* Values,
+    ElemType* logSumExp,
+    const CUDA_LONG numRows,
+    const int k)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    __shared__ comp_t partials[BlockSize];
+    __shared__ comp_t partialSums[BlockSize];
+    __shared__ int partialsInd[BlockSize];
+
+    const int tid = threadIdx.x;
+    const ElemType* col = us + (size_t)blockIdx.x * numRows;
+
+    comp_t vals[MaxK];
+    int inds[MaxK];
+    int count = 0;
+    comp_t runMax = -FLT_MAX;
+    comp_t runSum = 0;
+    for (CUDA_LONG i = tid; i < numRows; i += BlockSize)
+    {
+        comp_t v = col[i];
+        if (logSumExp)
+            _combineLogSumExp(runMax, runSum, v, (comp_t)1);
+        // the rows of a thread come in increasing order, so an equal value never goes before the ones in the list
+        if (count < k || _topKPrecedes(v, (int)i, vals[k - 1], inds[k - 1]))
+        {
+            int pos = count < k ? count++ : k - 1;
+            for (; pos > 0 && _topKPrecedes(v, (int)i, vals[pos - 1], inds[pos - 1]); pos--)
+            {
+                vals[pos] = vals[pos - 1];
+                inds[pos] = inds[pos - 1];
+            }
+            vals[pos] = v;
+            inds[pos] = (int)i;
+        }
+    }
+
+    comp_t lse = 0;
+    if (logSumExp)
+    {
+        partials[tid] = runMax;
+        partialSums[tid] = runSum;
+        __syncthreads();
+        for (int s = BlockSize / 2; s > 0; s >>= 1)
+        {
+            if (tid < s)
+                _combineLogSumExp(partials[tid], partialSums[tid], partials[tid + s], partialSums[tid + s]);
+            __syncthreads();
+        }
+        lse = partials[0] + log_(partialSums[0]);
+        if (tid == 0)
+            logSumExp[blockIdx.x] = lse;
+        __syncthreads();
+    }
+
+    int head = 0;
+    for (int r = 0; r < k; r++)
+    {
+        partials[tid] = head < count ? vals[head] : (comp_t)0;
+        partialsInd[tid] = head < count ? inds[head] : -1;
+        __syncthreads();
+        for (int s = BlockSize / 2; s > 0; s >>= 1)
+        {
+            if (tid < s && _topKPrecedes(partials[tid + s], partialsInd[tid + s], partials[tid], partialsInd[tid]))
+            {
+                partials[tid] = partials[tid + s];
+                partialsInd[tid] = partialsInd[tid + s];
+            }
+            __syncthreads();
+        }
+        int best = partialsInd[0];
+        if (head < count && inds[head] == best)
+            head++;
+        if (tid == 0)
+        {
+            Indexes[(size_t)blockIdx.x * k + r] = (ElemType)best;
+            Values[(size_t)blockIdx.x * k + r] = logSumExp ? (ElemType)exp_(partials[0] - lse) : (ElemType)partials[0];
+        }
+        __syncthreads(); // before the partials are overwritten
+    }
+}
+
+// Turns the top k values of each column into their softmax probabilities, given the log-sum-exp of the columns.
+template <class ElemType>
+__global__ void _assignExpOfDifferenceToColumnValue(ElemType* values, const ElemType* logSumExp, const CUDA_LONG numRows, const CUDA_LONG numElements)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    CUDA_LONG id = blockDim.x * blockIdx.x + threadIdx.x;
+    if (id >= numElements)
+        return;
+    values[id] = (ElemType)exp_((comp_t)values[id] - (comp_t)logSumExp[id / numRows]);
+}
+
 template <class ElemType>
 __global__ void _vectorMax(
     const ElemType* us,
@@ -4251,7 +4707,9 @@ __global__ void _normalGradForSparseBlock(
     ElemType* lhsValues, // lhs is blockCol or blockRow
     const GPUSPARSE_INDEX_TYPE* blockIds,
     ElemType* rhs,
-    ElemType unitGainFactor)
+    ElemType unitGainFactor,
+    const int* timestamps, // of the columns of a blockCol lhs, to catch up with the decay of rhs since the column was last updated; may be null
+    int currentTimestamp)
 {
     const CUDA_LONG index = blockIdx.x * blockDim.x + threadIdx.x;
     CUDA_LONG row, col;
@@ -4271,7 +4729,10 @@ __global__ void _normalGradForSparseBlock(
         col = index - numCols * blockId;
         row = blockIds[blockId];
     }
-    rhs[IDX2C(row, col, numRows)] = unitGainFactor * lhsValues[index] + momentum * rhs[IDX2C(row, col, numRows)];
+    ElemType decayedMomentum = momentum;
+    if (timestamps != nullptr)
+        decayedMomentum = (ElemType)pow_((typename TypeSelector<ElemType>::comp_t)momentum, (typename TypeSelector<ElemType>::comp_t)(currentTimestamp - timestamps[col]));
+    rhs[IDX2C(row, col, numRows)] = unitGainFactor * lhsValues[index] + decayedMomentum * rhs[IDX2C(row, col, numRows)];
     lhsValues[index] = rhs[IDX2C(row, col, numRows)];
 }
 
@@ -4356,6 +4817,128 @@ __global__ void _reductionSum1024Threads(
     }
 }
 
+// atomic minimum and maximum through compare-and-swap, for the block results of _assignHistogramOf()
+static __inline__ __device__ void atomicMinOrMax(float* address, float val, bool isMax)
+{
+    int* addressAsInt = (int*) address;
+    int old = *addressAsInt, assumed;
+    do
+    {
+        assumed = old;
+        float current = __int_as_float(assumed);
+        if (isMax ? current >= val : current <= val)
+            return;
+        old = atomicCAS(addressAsInt, assumed, __float_as_int(val));
+    } while (assumed != old);
+}
+
+static __inline__ __device__ void atomicMinOrMax(double* address, double val, bool isMax)
+{
+    unsigned long long int* addressAsUll = (unsigned long long int*) address;
+    unsigned long long int old = *addressAsUll, assumed;
+    do
+    {
+        assumed = old;
+        double current = __longlong_as_double(assumed);
+        if (isMax ? current >= val : current <= val)
+            return;
+        old = atomicCAS(addressAsUll, assumed, __double_as_longlong(val));
+    } while (assumed != old);
+}
+
+// the start values of the result of _assignHistogramOf(): no counts, and the minimum and maximum of no elements
+template <class ElemType>
+__global__ void _initHistogram(ElemType* us, CUDA_LONG numLimits)
+{
+    for (CUDA_LONG i = threadIdx.x; i < numLimits + 3; i += blockDim.x)
+        us[i] = 0;
+    if (threadIdx.x == 0)
+    {
+        us[numLimits + 3] = INFINITY;
+        us[numLimits + 4] = -INFINITY;
+    }
+}
+
+// One pass over 'a' for the bucket counts and the sum, sum of squares, minimum and maximum of its finite elements (see
+// Matrix::AssignHistogramOf()). A block counts into shared memory when the dynamic shared memory holds numLimits + 1 counts,
+// and reduces its statistics in shared memory, so that each block does only numLimits + 5 atomic updates of 'us'.
+// This function should be called with _assignHistogramOfThreads threads per block.
+#define _assignHistogramOfThreads 256
+template <class ElemType>
+__global__ void _assignHistogramOf(ElemType* us, const ElemType* a, CUDA_LONG N, const ElemType* limits, CUDA_LONG numLimits, bool sharedCounts)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    extern __shared__ unsigned int blockCounts[];
+    __shared__ comp_t partialSums[_assignHistogramOfThreads];
+    __shared__ comp_t partialSumsOfSquares[_assignHistogramOfThreads];
+    __shared__ comp_t partialMins[_assignHistogramOfThreads];
+    __shared__ comp_t partialMaxs[_assignHistogramOfThreads];
+
+    if (sharedCounts)
+    {
+        for (CUDA_LONG i = threadIdx.x; i <= numLimits; i += blockDim.x)
+            blockCounts[i] = 0;
+        __syncthreads();
+    }
+
+    comp_t sum = 0, sumOfSquares = 0, minValue = INFINITY, maxValue = -INFINITY;
+    for (CUDA_LONG id = blockIdx.x * blockDim.x + threadIdx.x; id < N; id += blockDim.x * gridDim.x)
+    {
+        comp_t v = (comp_t) a[id];
+        if (!isfinite(v))
+            continue;
+        // the first limit that is not below v
+        CUDA_LONG lo = 0, hi = numLimits;
+        while (lo < hi)
+        {
+            CUDA_LONG mid = (lo + hi) / 2;
+            if (v <= (comp_t) limits[mid])
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        if (sharedCounts)
+            atomicAdd(&blockCounts[lo], 1u);
+        else
+            atomicAdd(&us[lo], (ElemType) 1);
+        sum += v;
+        sumOfSquares += v * v;
+        minValue = min(minValue, v);
+        maxValue = max(maxValue, v);
+    }
+    partialSums[threadIdx.x] = sum;
+    partialSumsOfSquares[threadIdx.x] = sumOfSquares;
+    partialMins[threadIdx.x] = minValue;
+    partialMaxs[threadIdx.x] = maxValue;
+    __syncthreads();
+
+    for (int stride = _assignHistogramOfThreads / 2; stride > 0; stride /= 2)
+    {
+        if (threadIdx.x < stride)
+        {
+            partialSums[threadIdx.x] += partialSums[threadIdx.x + stride];
+            partialSumsOfSquares[threadIdx.x] += partialSumsOfSquares[threadIdx.x + stride];
+            partialMins[threadIdx.x] = min(partialMins[threadIdx.x], partialMins[threadIdx.x + stride]);
+            partialMaxs[threadIdx.x] = max(partialMaxs[threadIdx.x], partialMaxs[threadIdx.x + stride]);
+        }
+        __syncthreads();
+    }
+
+    if (sharedCounts)
+    {
+        for (CUDA_LONG i = threadIdx.x; i <= numLimits; i += blockDim.x)
+            if (blockCounts[i] != 0)
+                atomicAdd(&us[i], (ElemType) blockCounts[i]);
+    }
+    if (threadIdx.x == 0)
+    {
+        atomicAdd(&us[numLimits + 1], (ElemType) partialSums[0]);
+        atomicAdd(&us[numLimits + 2], (ElemType) partialSumsOfSquares[0]);
+        atomicMinOrMax(&us[numLimits + 3], (ElemType) partialMins[0], /*isMax=*/false);
+        atomicMinOrMax(&us[numLimits + 4], (ElemType) partialMaxs[0], /*isMax=*/true);
+    }
+}
+
 //This function should be called with 1024 threads per block and 1 block
 //THIS IS NOT THE MOST EFFICIENT IMPLEMENTATION!!!
 template <class ElemType>
@@ -5384,6 +5967,151 @@ __global__ void _adam(CUDA_LONG size, ElemType* grad, ElemType* smoothAda, ElemT
     }
 }
 
+// Kernel argument of _multiTensorUpdate: up to MaxTensors tensors and, for each of up to MaxBlocks thread blocks, the tensor
+// and the chunk of ChunkSize elements of it that the block updates. Small enough for the 4 KB limit of kernel arguments.
+// 'indices' are the positions of the tensors in the list of all tensors of the operation, which may take many launches.
+template <class ElemType>
+struct MultiTensorChunks
+{
+    static const int MaxTensors = 48;
+    static const int MaxBlocks = 320;
+    static const int ThreadsPerBlock = 512;
+    static const CUDA_LONG ChunkSize = 16384;
+
+    ElemType* parameters[MaxTensors];
+    const ElemType* gradients[MaxTensors];
+    ElemType* smoothedGradients[MaxTensors];
+    CUDA_LONG sizes[MaxTensors];
+    int indices[MaxTensors];
+    unsigned char blockTensors[MaxBlocks];
+    CUDA_LONG blockChunks[MaxBlocks];
+};
+
+// the dense updates of Matrix::MomentumSGDUpdate(), _adagrad, _fsadagrad and _adam, for the chunks of many tensors in one launch
+template <class ElemType>
+__global__ void _multiTensorUpdate(const MultiTensorUpdateParameters<ElemType> update, const MultiTensorChunks<ElemType> chunks)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    typedef MultiTensorChunks<ElemType> Chunks;
+
+    const int tensor = chunks.blockTensors[blockIdx.x];
+    const CUDA_LONG size = chunks.sizes[tensor];
+    const CUDA_LONG chunkSize = Chunks::ChunkSize;
+    const CUDA_LONG begin = chunks.blockChunks[blockIdx.x] * chunkSize;
+    const CUDA_LONG end = min(begin + chunkSize, size);
+    ElemType* val = chunks.parameters[tensor];
+    const ElemType* grad = chunks.gradients[tensor];
+    ElemType* smoothAda = chunks.smoothedGradients[tensor];
+    ElemType* smoothMom = (update.kind == MultiTensorUpdateKind::MomentumSGD) ? smoothAda : smoothAda + size;
+
+    const comp_t gradientScale = (comp_t)update.gradientScale;
+    const comp_t l2Weight = (comp_t)update.l2RegularizationWeight;
+    const comp_t lr = (comp_t)update.learningRate;
+    const comp_t mom = (comp_t)update.momentum;
+    const comp_t unitGainFactor = (comp_t)update.unitGainFactor;
+    const comp_t adaWeight = (comp_t)update.varianceMomentum;
+    const comp_t adaMul = (comp_t)update.varianceScale;
+    const comp_t epsilon = (comp_t)update.epsilon;
+
+    for (CUDA_LONG idx = begin + threadIdx.x; idx < end; idx += blockDim.x)
+    {
+        comp_t p = val[idx];
+        comp_t g = gradientScale * (comp_t)grad[idx] + l2Weight * p;
+        switch (update.kind)
+        {
+        case MultiTensorUpdateKind::MomentumSGD:
+        {
+            const comp_t m = mom * (comp_t)smoothMom[idx] + unitGainFactor * lr * g;
+            smoothMom[idx] = m;
+            p -= m;
+            break;
+        }
+        case MultiTensorUpdateKind::AdaGrad:
+        {
+            const comp_t a = (comp_t)smoothAda[idx] + g * g;
+            smoothAda[idx] = a;
+            p -= lr * (g / sqrt_(a + (comp_t)1e-16f));
+            break;
+        }
+        case MultiTensorUpdateKind::FSAdaGrad:
+        {
+            const comp_t adaSqr = adaWeight * (comp_t)smoothAda[idx] + (1.0f - adaWeight) * g * g;
+            smoothAda[idx] = adaSqr;
+            if (adaSqr != 0.0f)
+            {
+                comp_t w = adaMul * rsqrt_(adaSqr);
+                if (w > static_cast<comp_t>(10.0))
+                    w = static_cast<comp_t>(10.0);
+                g *= w;
+            }
+            if (mom > 0.0f)
+            {
+                g = mom * (comp_t)smoothMom[idx] + unitGainFactor * g;
+                smoothMom[idx] = g;
+            }
+            p -= lr * g;
+            break;
+        }
+        case MultiTensorUpdateKind::Adam:
+        {
+            comp_t w;
+            if (!update.adamax)
+            {
+                const comp_t adaSqr = adaWeight * (comp_t)smoothAda[idx] + (1.0f - adaWeight) * g * g;
+                smoothAda[idx] = adaSqr;
+                w = adaMul * 1.0 / (sqrt_(adaSqr) + epsilon);
+            }
+            else
+            {
+                const comp_t ada = max(adaWeight * (comp_t)smoothAda[idx], fabs_(g));
+                smoothAda[idx] = ada;
+                w = adaMul / ada;
+            }
+            g = mom * (comp_t)smoothMom[idx] + unitGainFactor * g;
+            smoothMom[idx] = g;
+            p -= lr * g * w;
+            break;
+        }
+        }
+        val[idx] = p;
+    }
+}
+
+// adds the sum of the squares of the gradients of the chunks to *sum, or to sum[i] for the i-th tensor if 'perTensor';
+// to be launched with MultiTensorChunks::ThreadsPerBlock threads
+template <class ElemType>
+__global__ void _multiTensorSumOfSquares(const MultiTensorChunks<ElemType> chunks, double* sum, bool perTensor)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    typedef MultiTensorChunks<ElemType> Chunks;
+    __shared__ double partialSums[Chunks::ThreadsPerBlock];
+
+    const int tensor = chunks.blockTensors[blockIdx.x];
+    const CUDA_LONG chunkSize = Chunks::ChunkSize;
+    const CUDA_LONG begin = chunks.blockChunks[blockIdx.x] * chunkSize;
+    const CUDA_LONG end = min(begin + chunkSize, chunks.sizes[tensor]);
+    const ElemType* data = chunks.gradients[tensor];
+
+    double partialSum = 0;
+    for (CUDA_LONG idx = begin + threadIdx.x; idx < end; idx += blockDim.x)
+    {
+        const double value = (comp_t)data[idx];
+        partialSum += value * value;
+    }
+    partialSums[threadIdx.x] = partialSum;
+    __syncthreads();
+
+    for (int stride = blockDim.x / 2; stride > 0; stride /= 2)
+    {
+        if (threadIdx.x < stride)
+            partialSums[threadIdx.x] += partialSums[threadIdx.x + stride];
+        __syncthreads();
+    }
+
+    if (threadIdx.x == 0)
+        atomicAdd(perTensor ? sum + chunks.indices[tensor] : sum, partialSums[0]);
+}
+
 template <class ElemType>
 __global__ void _adam4BlockSparseCol(CUDA_LONG size,
     ElemType* grad_bsc, const GPUSPARSE_INDEX_TYPE* colOrRow2blockId, const size_t len,
@@ -5418,6 +6146,74 @@ __global__ void _adam4BlockSparseCol(CUDA_LONG size,
     }
 }
 
+// the update of _adam4BlockSparseCol for the columns of the gradient only; the decay of the moments of a column since it was
+// last updated is caught up with if there are timestamps. To be launched with a thread per element of the gradient.
+template <class ElemType>
+__global__ void _lazyAdam4BlockSparseCol(CUDA_LONG size,
+    const ElemType* grad_bsc, const GPUSPARSE_INDEX_TYPE* blockId2ColOrRow, size_t numRows,
+    ElemType* smoothAda, ElemType* smoothMom, ElemType* val,
+    ElemType lr, ElemType mom, ElemType adaWeight, ElemType adaMul, ElemType epsilon, ElemType unitGainFactor, bool adamax,
+    const int* timestamps, int currentTimestamp)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    const CUDA_LONG sparseIndex = blockDim.x * blockIdx.x + threadIdx.x;
+    if (sparseIndex >= size)
+        return;
+    const auto col = blockId2ColOrRow[sparseIndex / numRows];
+    const auto denseIndex = col * numRows + sparseIndex % numRows;
+
+    comp_t momDecay = 1;
+    comp_t adaDecay = 1;
+    if (timestamps != nullptr)
+    {
+        const comp_t missed = (comp_t)(currentTimestamp - 1 - timestamps[col]);
+        momDecay = pow_((comp_t)mom, missed);
+        adaDecay = pow_((comp_t)adaWeight, missed);
+    }
+
+    comp_t g = (comp_t)grad_bsc[sparseIndex];
+    comp_t w;
+    if (!adamax)
+    {
+        comp_t adaSqr = (comp_t)adaWeight * adaDecay * (comp_t)smoothAda[denseIndex] + (1.0f - (comp_t)adaWeight) * g * g;
+        smoothAda[denseIndex] = adaSqr;
+        w = (comp_t)adaMul / (sqrt_(adaSqr) + (comp_t)epsilon);
+    }
+    else
+    {
+        smoothAda[denseIndex] = max((comp_t)adaWeight * adaDecay * (comp_t)smoothAda[denseIndex], fabs_(g));
+        w = (comp_t)adaMul / (comp_t)smoothAda[denseIndex];
+    }
+
+    g = (comp_t)mom * momDecay * (comp_t)smoothMom[denseIndex] + (comp_t)unitGainFactor * g;
+    smoothMom[denseIndex] = g;
+    val[denseIndex] = (comp_t)val[denseIndex] - (comp_t)lr * g * w;
+}
+
+// applies the decays of the state of lazy sparse updates (see _lazyAdam4BlockSparseCol) that are due since the timestamps of the columns,
+// 'decay' to the first 'N' columns and 'secondDecay' to the next 'N' columns if 'hasSecond', and resets the timestamps
+template <class ElemType>
+__global__ void _lazyDecayFlush(CUDA_LONG N, size_t rows, ElemType* data, bool hasSecond,
+    ElemType decay, ElemType secondDecay, int* timestamps, int currentTimestamp)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    const CUDA_LONG col = blockIdx.x * blockDim.x + threadIdx.x;
+    if (col >= N)
+        return;
+
+    const comp_t missed = (comp_t)(currentTimestamp - timestamps[col]);
+    const comp_t firstFactor = pow_((comp_t)decay, missed);
+    const comp_t secondFactor = pow_((comp_t)secondDecay, missed);
+    const size_t offset = rows * col;
+    timestamps[col] = 0;
+    for (size_t row = 0; row < rows; ++row)
+    {
+        data[offset + row] = (comp_t)data[offset + row] * firstFactor;
+        if (hasSecond)
+            data[N * rows + offset + row] = (comp_t)data[N * rows + offset + row] * secondFactor;
+    }
+}
+
 template <class ElemType, class GradType>
 __global__ void _adadelta(CUDA_LONG size, GradType* grad, ElemType* smoothAda, ElemType* smoothX2, ElemType* val,
     ElemType learningRate, ElemType rho, ElemType epsilon)
@@ -5489,10 +6285,11 @@ __global__ void _adadeltaFlush(CUDA_LONG N, size_t rows, ElemType* smoothAda, El
 }
 
 
-// Calculate alpha in forward-backward calculation. equation (6), (7) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
-// GPU x dimension corresponds to utterances, y dimension corresponds to phone sequence in each utterance
+// Calculate alpha and beta in forward-backward calculation, equations (6), (7), (10) and (11) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
+// Each block runs the recursion over all frames of one utterance, blockIdx.x: alpha if blockIdx.y is 0, beta if it is 1.
+// The threads of the block share the phone positions of the utterance and synchronize after each frame.
 // prob (input): the posterior output from the network
-// alpha (output): alpha for forward-backward calculation.
+// alpha, beta (output): alpha and beta for forward-backward calculation.
 // phoneSeq (input): phone ID sequence for each utterance in this minibatch, each col is one utterance
 // phoneBound (input): phone boundary (frame index) of each phone for each utterance in this minibatch, each col is one utterance
 // uttToChanInd (input):  map from utterance ID to minibatch channel ID. We need this because each channel may contain more than one utterance.
@@ -5500,8 +6297,6 @@ __global__ void _adadeltaFlush(CUDA_LONG N, size_t rows, ElemType* smoothAda, El
 // uttBeginFrame(input): the position of the first frame of each utterance in the minibatch channel. We need this because each channel may contain more than one utterance.
 // uttPhoneNum (input): the phone number of each utterance. The size of this vector =  the number of all utterances in this minibatch
 // numChannels (input): channel number in this minibatch
-// uttNum (input): number of utterances
-// t (input): time stamp to process
 // maxPhoneNum (input): the max number of phones between utterances
 // totalPhoneNum (input): the total number of phones of all utterances
 // blankTokenId (input): id of the CTC blank token
@@ -5510,274 +6305,394 @@ __global__ void _adadeltaFlush(CUDA_LONG N, size_t rows, ElemType* smoothAda, El
 //      Setting this parameter smaller will result in shorted delay between label output during decoding.
 //      delayConstraint=-1 means no constraint
 template<class ElemType>
-__global__ void _assignAlphaScore(
+__global__ void _assignAlphaBetaScores(
     const ElemType *prob,
     ElemType *alphaScore,
-    ElemType *phoneSeq,
-    ElemType *phoneBound,
+    ElemType *betaScore,
+    const ElemType *phoneSeq,
+    const ElemType *phoneBound,
     const size_t *uttToChanInd,
     const size_t *uttFrameNum,
     const size_t *uttBeginFrame,
     const size_t *uttPhoneNum,
-    size_t numChannels,
-    const size_t uttNum,
-    const size_t  t,
+    const size_t numChannels,
     const size_t maxPhoneNum, // Maximum length of utterance in this MB
     const size_t totalPhoneNum, // Total number of phones
     const size_t blankTokenId,
     const int delayConstraint)
 {
     typedef typename TypeSelector<ElemType>::comp_t comp_t;
-    LONG64 uttId = blockDim.x * blockIdx.x + threadIdx.x;
-    // Index of the label in the sequence
-    LONG64 phoneSeqId = blockDim.y * blockIdx.y + threadIdx.y;
+    const LONG64 uttId = blockIdx.x;
+    const bool isAlpha = blockIdx.y == 0;
+    ElemType *score = isAlpha ? alphaScore : betaScore;
 
     // Number of phones and frames in this utterance
-    LONG64 phoneNum = uttPhoneNum[uttId];
-    LONG64 frameNum = uttFrameNum[uttId];
-
-    if (uttId >= uttNum || phoneSeqId >= phoneNum - 1 || t >= frameNum || phoneSeqId == 0) return;
-
-    // Current and previous phone indices in phoneSeq matrix
-    LONG64 labelid = uttId*maxPhoneNum + phoneSeqId;
-    LONG64 labelid_2 = labelid - 2;
-
-    // Actual current phone label
-    LONG64 phoneId = (LONG64)(phoneSeq[labelid]);
-
-    // Index of the current frame in minibatch
-    LONG64 timeId = (t + uttBeginFrame[uttId])*numChannels + uttToChanInd[uttId];
+    const LONG64 phoneNum = uttPhoneNum[uttId];
+    const LONG64 frameNum = uttFrameNum[uttId];
+    const ElemType *uttPhoneSeq = phoneSeq + uttId * maxPhoneNum;
+    const ElemType *uttPhoneBound = phoneBound + uttId * maxPhoneNum;
 
-    // Index of probability of observing phoneId at frame timeId
-    LONG64 probId = timeId*totalPhoneNum + phoneId;
+    for (LONG64 step = 0; step < frameNum; step++)
+    {
+        const LONG64 t = isAlpha ? step : frameNum - 1 - step;
 
-    LONG64 alphaId = maxPhoneNum* timeId + phoneSeqId; // alpha_t(s)
-    // Previous time frame
-    LONG64 timeId_1 = timeId - numChannels; // Index corresponding to (t-1)
-    LONG64 alphaId_0 = maxPhoneNum* timeId_1 + phoneSeqId; // alpha_{t-1}(s)
-    LONG64 alphaId_1 = alphaId_0 - 1; // alpha_{t-1}(s-1)
-    LONG64 alphaId_2 = alphaId_0 - 2; // alpha_{t-1}(s-2)
+        // Index of the current frame in minibatch, and of the frame the recursion comes from
+        const LONG64 timeId = (t + uttBeginFrame[uttId]) * numChannels + uttToChanInd[uttId];
+        const ElemType *prevScore = score + (isAlpha ? timeId - (LONG64)numChannels : timeId + (LONG64)numChannels) * (LONG64)maxPhoneNum;
 
-    if (t == 0)
-    {
-        // Initialize recursion
-        if (phoneSeqId == 1 || phoneSeqId == 2)
-        {
-            alphaScore[alphaId] = prob[probId];
-        }
-    }
-    else
-    {
-        if (phoneSeqId >= 1)
+        for (LONG64 s = 1 + threadIdx.x; s < phoneNum - 1; s += blockDim.x)
         {
-            comp_t x = LZERO;
-
-            comp_t ascore;
-            if (phoneSeqId > 2)
-            {
-                // if current label is not blank and not equal prev non-blank label
-                if ((LONG64)(phoneSeq[labelid]) != blankTokenId && phoneId != (LONG64)(phoneSeq[labelid_2]))
-                {
-                    x = logaddk(x, (comp_t)alphaScore[alphaId_2]);
-                }
-            }
+            // Actual current phone label, and the probability of observing it at this frame
+            const LONG64 phoneId = (LONG64)(uttPhoneSeq[s]);
+            const comp_t ascore = phoneId != SIZE_MAX ? (comp_t)prob[timeId * totalPhoneNum + phoneId] : 0;
 
-            if (phoneSeqId > 1)
+            comp_t x = LZERO;
+            if (step == 0)
             {
-                x = logaddk(x, (comp_t)alphaScore[alphaId_1]);
+                // Initialize recursion
+                if (isAlpha ? (s == 1 || s == 2) : (s == phoneNum - 3 || s == phoneNum - 2))
+                    x = ascore;
             }
-
-            x = logaddk(x, (comp_t)alphaScore[alphaId_0]);
-
-            if (phoneId != SIZE_MAX)
-                ascore = prob[probId]; // Probability of observing given label at given time
             else
-                ascore = 0;
-            alphaScore[alphaId] = x + ascore;
-            if (delayConstraint != -1)
             {
-                LONG64 labelid_r = labelid + 2;
-                LONG64 phoneBoundId_r = (LONG64)(phoneBound[labelid_r]);
-                if (phoneId == blankTokenId)
+                // if current label is not blank and not equal the neighboring non-blank label, the recursion may skip the blank in between
+                if (isAlpha)
+                {
+                    if (s > 2 && phoneId != blankTokenId && phoneId != (LONG64)(uttPhoneSeq[s - 2]))
+                        x = logaddk(x, (comp_t)prevScore[s - 2]);
+                    if (s > 1)
+                        x = logaddk(x, (comp_t)prevScore[s - 1]);
+                }
+                else
                 {
-                    // only constraint right side
-                    if (t > phoneBoundId_r + delayConstraint - 1)
-                        alphaScore[alphaId] = LZERO;
+                    if (s < phoneNum - 3 && phoneId != blankTokenId && phoneId != (LONG64)(uttPhoneSeq[s + 2]))
+                        x = logaddk(x, (comp_t)prevScore[s + 2]);
+                    if (s < phoneNum - 2)
+                        x = logaddk(x, (comp_t)prevScore[s + 1]);
                 }
-                else if (phoneId != blankTokenId)
+                x = logaddk(x, (comp_t)prevScore[s]);
+                x += ascore;
+
+                if (delayConstraint != -1)
                 {
-                    if (t > phoneBoundId_r + delayConstraint)
-                        alphaScore[alphaId] = LZERO;
+                    // only constraint right side; a blank must be left one frame earlier
+                    const LONG64 phoneBoundId_r = (LONG64)(uttPhoneBound[s + 2]);
+                    if (t > phoneBoundId_r + delayConstraint - (phoneId == blankTokenId ? 1 : 0))
+                        x = LZERO;
                 }
             }
+            score[timeId * maxPhoneNum + s] = x;
         }
+        // the next frame reads the scores of this one
+        __syncthreads();
     }
 }
 
-// Calculate beta in forward-backward calculation, equation (10), (11) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
-// See _assignAlphaScore for the explanation of parameters
+// Calculate derivative, equation (15) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf: the occupancies of the positions of each label,
+// normalized to sum to 1 over each frame. CTCscore must be zero.
+// Each block processes one frame, blockIdx.x, of one utterance, blockIdx.y. There must be 128 threads in a block.
+// See _assignAlphaBetaScores for the explanation of parameters
 template<class ElemType>
-__global__ void _assignBetaScore(
+__global__ void _assignCTCScore128Threads(
+    ElemType *CTCscore,
     const ElemType *prob,
-    ElemType *betaScore,
-    ElemType *phoneSeq,
-    ElemType *phoneBound,
+    const ElemType *alphaScore,
+    const ElemType *betaScore,
+    const ElemType *phoneSeq,
     const size_t *uttToChanInd,
-    const size_t *uttFrameNum,
     const size_t *uttBeginFrame,
     const size_t *uttPhoneNum,
+    const size_t *uttFrameNum,
     const size_t numChannels,
-    const size_t uttNum,
-    const size_t  t,
     const size_t maxPhoneNum,
-    const size_t totalPhoneNum,
-    const size_t blankTokenId,
-    const int delayConstraint)
+    const size_t totalPhoneNum)
 {
     typedef typename TypeSelector<ElemType>::comp_t comp_t;
-    LONG64 uttId = blockDim.x * blockIdx.x + threadIdx.x;
-    // Index of the label in the sequence
-    LONG64 phoneSeqId = blockDim.y * blockIdx.y + threadIdx.y;
-    LONG64 phoneNum = uttPhoneNum[uttId];
-    LONG64 frameNum = uttFrameNum[uttId];
-
-    if (uttId >= uttNum || phoneSeqId >= phoneNum - 1 || t >= frameNum || phoneSeqId == 0) return;
-
-    LONG64 labelid = uttId*maxPhoneNum + phoneSeqId;
-    LONG64 labelid_2 = labelid + 2;
-    LONG64 phoneId = (LONG64)(phoneSeq[labelid]);
-    LONG64 timeId = (t + uttBeginFrame[uttId])*numChannels + uttToChanInd[uttId];
-    LONG64 probId = timeId*totalPhoneNum + phoneId;
-    LONG64 betaid = maxPhoneNum* timeId + phoneSeqId;
-    LONG64 timeId_1 = timeId + numChannels;
-    LONG64 betaid_0 = maxPhoneNum* timeId_1 + phoneSeqId;
-    LONG64 betaid_1 = betaid_0 + 1;
-    LONG64 betaid_2 = betaid_0 + 2;
-
-    if (t == frameNum - 1)
-    {
-        if (phoneSeqId == phoneNum - 3 || phoneSeqId == phoneNum - 2)
+    const LONG64 uttId = blockIdx.y;
+    const LONG64 t = blockIdx.x;
+    if (t >= uttFrameNum[uttId])
+        return;
+
+    const LONG64 phoneNum = uttPhoneNum[uttId];
+    const ElemType *uttPhoneSeq = phoneSeq + uttId * maxPhoneNum;
+    const comp_t P_lx = betaScore[(uttBeginFrame[uttId] * numChannels + uttToChanInd[uttId]) * maxPhoneNum];
+    const LONG64 timeId = (t + uttBeginFrame[uttId]) * numChannels + uttToChanInd[uttId];
+
+    __shared__ comp_t partials[128];
+    comp_t sum = 0;
+    for (LONG64 s = 1 + threadIdx.x; s < phoneNum - 1; s += 128)
+    {
+        const LONG64 phoneId = (LONG64)(uttPhoneSeq[s]);
+        if (phoneId != SIZE_MAX)
+            sum += exp_((comp_t)alphaScore[timeId * maxPhoneNum + s] + (comp_t)betaScore[timeId * maxPhoneNum + s] - (comp_t)prob[timeId * totalPhoneNum + phoneId] - P_lx);
+    }
+    partials[threadIdx.x] = sum;
+    __syncthreads();
+    for (int i = 64; i > 0; i >>= 1)
+    {
+        if (threadIdx.x < i)
+            partials[threadIdx.x] += partials[threadIdx.x + i];
+        __syncthreads();
+    }
+    sum = partials[0];
+    if (sum <= 0)
+        return;
+
+    // a label may occur at several positions
+    for (LONG64 s = 1 + threadIdx.x; s < phoneNum - 1; s += 128)
+    {
+        const LONG64 phoneId = (LONG64)(uttPhoneSeq[s]);
+        if (phoneId != SIZE_MAX)
         {
-            betaScore[betaid] = prob[probId];
+            comp_t occupancy = exp_((comp_t)alphaScore[timeId * maxPhoneNum + s] + (comp_t)betaScore[timeId * maxPhoneNum + s] - (comp_t)prob[timeId * totalPhoneNum + phoneId] - P_lx);
+            atomicAdd(&CTCscore[timeId * totalPhoneNum + phoneId], (ElemType)(occupancy / sum));
         }
     }
-    else
+}
+
+// Calculate CTC score. equation (8) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
+template<class ElemType>
+__global__ void _assignTotalScore(ElemType *betaScore,
+    ElemType *totalScore,
+    const size_t uttNum,
+    const size_t *uttToChanInd,
+    const size_t *uttBeginFrame,
+    const size_t numChannels,
+    const size_t maxPhoneNum)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    LONG64 uttId = blockIdx.x;
+    if (uttId < uttNum)
+    {
+        LONG64 alphaId_0 = (uttBeginFrame[uttId] * numChannels + uttToChanInd[uttId]) * maxPhoneNum;
+
+        betaScore[alphaId_0] = logaddk((comp_t)betaScore[alphaId_0 + 1], (comp_t)betaScore[alphaId_0 + 2]);
+        // Negative sum
+        atomicAdd(&totalScore[0], -1 * betaScore[alphaId_0]);
+    }
+}
+
+// Extracts the labels of the frames of one utterance, merging runs of identical labels if 'squashInputs', and removing the ignored ones.
+// Returns the number of labels written to 'tokens'.
+template<class ElemType>
+__device__ int _extractEditDistanceTokens(const ElemType *seq, const size_t chanInd, const size_t beginFrame, const size_t frameNum, const size_t numChannels,
+    const bool squashInputs, const size_t *tokensToIgnore, const size_t numTokensToIgnore, int *tokens)
+{
+    int numTokens = 0;
+    int lastId = 0;
+    for (size_t t = 0; t < frameNum; t++)
     {
-        if (phoneSeqId >= 1)
+        int id = (int)seq[(beginFrame + t) * numChannels + chanInd];
+        if (t > 0 && squashInputs && id == lastId)
+            continue;
+
+        lastId = id;
+        bool isIgnored = false;
+        for (size_t k = 0; k < numTokensToIgnore && !isIgnored; k++)
+            isIgnored = tokensToIgnore[k] == (size_t)id;
+        if (!isIgnored)
+            tokens[numTokens++] = id;
+    }
+    return numTokens;
+}
+
+// Edit distances, see CPUMatrix::AssignEditDistances(). Each block aligns the label sequences of one utterance, blockIdx.x.
+// The cells (i, j) of an anti-diagonal i + j = d only depend on the two diagonals before it, so the threads compute a diagonal
+// together, looping over the diagonals.
+// result: 3 x #utterances, the number of edits and the lengths of the two sequences
+// tokens: 2 * maxFrameNum labels per utterance
+// diagonals: the costs and the numbers of edits of three diagonals, 6 * (maxFrameNum + 1) per utterance, indexed by i
+template<class ElemType>
+__global__ void _assignEditDistances(
+    ElemType *result,
+    const ElemType *firstSeq,
+    const ElemType *secondSeq,
+    const size_t *uttToChanInd,
+    const size_t *uttBeginFrame,
+    const size_t *uttFrameNum,
+    const size_t numChannels,
+    const size_t maxFrameNum,
+    const size_t *tokensToIgnore,
+    const size_t numTokensToIgnore,
+    const float subPen,
+    const float delPen,
+    const float insPen,
+    const bool squashInputs,
+    int *tokens,
+    float *diagonals)
+{
+    const size_t uttId = blockIdx.x;
+    int *first = tokens + 2 * maxFrameNum * uttId;
+    int *second = first + maxFrameNum;
+
+    // the first two threads extract the two sequences
+    __shared__ int lengths[2];
+    if (threadIdx.x < 2)
+    {
+        lengths[threadIdx.x] = _extractEditDistanceTokens(threadIdx.x == 0 ? firstSeq : secondSeq, uttToChanInd[uttId], uttBeginFrame[uttId], uttFrameNum[uttId],
+            numChannels, squashInputs, tokensToIgnore, numTokensToIgnore, threadIdx.x == 0 ? first : second);
+    }
+    __syncthreads();
+
+    const int n = lengths[0];
+    const int m = lengths[1];
+    const size_t diagonalSize = maxFrameNum + 1;
+    float *costs = diagonals + 6 * diagonalSize * uttId;
+    float *edits = costs + 3 * diagonalSize;
+    for (int d = 0; d <= n + m; d++)
+    {
+        float *cost = costs + (d % 3) * diagonalSize, *prevCost = costs + ((d + 2) % 3) * diagonalSize, *prev2Cost = costs + ((d + 1) % 3) * diagonalSize;
+        float *edit = edits + (d % 3) * diagonalSize, *prevEdit = edits + ((d + 2) % 3) * diagonalSize, *prev2Edit = edits + ((d + 1) % 3) * diagonalSize;
+        const int iEnd = min(n, d);
+        for (int i = max(0, d - m) + threadIdx.x; i <= iEnd; i += blockDim.x)
         {
-            comp_t x = LZERO;
-            comp_t ascore;
-            if (phoneSeqId < phoneNum - 3)
+            const int j = d - i;
+            if (j == 0)
             {
-                if (phoneSeq[labelid] != blankTokenId && phoneId != phoneSeq[labelid_2])
-                {
-                    x = logaddk(x, (comp_t)betaScore[betaid_2]);
-                }
+                cost[i] = (float)i * delPen;
+                edit[i] = (float)i;
             }
-
-            if (phoneSeqId < phoneNum - 2)
+            else if (i == 0)
             {
-                x = logaddk(x, (comp_t)betaScore[betaid_1]);
+                cost[i] = (float)j * insPen;
+                edit[i] = (float)j;
+            }
+            else if (first[i - 1] == second[j - 1])
+            {
+                cost[i] = prev2Cost[i - 1];
+                edit[i] = prev2Edit[i - 1];
             }
-
-            x = logaddk(x, (comp_t)betaScore[betaid_0]);
-
-            if (phoneId != SIZE_MAX)
-                ascore = prob[probId];
             else
-                ascore = 0;
-            betaScore[betaid] = x + ascore;
-            if (delayConstraint != -1)
             {
-                LONG64 phoneBoundId_r = (LONG64)(phoneBound[labelid_2]);
-                if (phoneId == blankTokenId)
+                // (i - 1, j) and (i, j - 1) are on the previous diagonal, (i - 1, j - 1) on the one before
+                float del = prevCost[i - 1] + delPen;
+                float ins = prevCost[i] + insPen;
+                float sub = prev2Cost[i - 1] + subPen;
+                if (sub <= del && sub <= ins)
                 {
-                    if (t > phoneBoundId_r + delayConstraint - 1)
-                        betaScore[betaid] = LZERO;
+                    cost[i] = sub;
+                    edit[i] = prev2Edit[i - 1] + 1.0f;
                 }
-                else if (phoneId != blankTokenId)
+                else if (del < ins)
                 {
-                    if (t > phoneBoundId_r + delayConstraint)
-                        betaScore[betaid] = LZERO;
+                    cost[i] = del;
+                    edit[i] = prevEdit[i - 1] + 1.0f;
+                }
+                else
+                {
+                    cost[i] = ins;
+                    edit[i] = prevEdit[i] + 1.0f;
                 }
             }
         }
+        // the next diagonal reads this one
+        __syncthreads();
+    }
+
+    if (threadIdx.x == 0)
+    {
+        result[3 * uttId] = (ElemType)edits[((n + m) % 3) * diagonalSize + n];
+        result[3 * uttId + 1] = (ElemType)(float)n;
+        result[3 * uttId + 2] = (ElemType)(float)m;
     }
 }
 
-// Calculate derivative, equation (15) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
-// See _assignAlphaScore for the explanation of parameters
+// Whether document i comes before document j in the ranking by decreasing score, see CPUMatrix::AssignLambdaRankRanks().
+template<class comp_t>
+__device__ bool _lambdaRankPrecedes(comp_t gainI, comp_t scoreI, size_t i, comp_t gainJ, comp_t scoreJ, size_t j)
+{
+    if (scoreI == scoreJ || isnan(scoreI) || isnan(scoreJ))
+        return gainI != gainJ ? gainI < gainJ : i < j;
+    return scoreI > scoreJ;
+}
+
+// Ranks of the documents by decreasing score, and the ideal and the actual DCG, of one query, blockIdx.x, per block.
+// The threads rank the documents of the query side by side, each counting the documents ranked before its own; unlike a sort,
+// this needs no memory per query and no passes over the block. There must be 128 threads in a block.
 template<class ElemType>
-__global__ void _assignCTCScore(
-    ElemType *CTCscore,
-    ElemType *prob,
-    ElemType *alphaScore,
-    ElemType *betaScore,
-    ElemType *phoneSeq,
-    const size_t uttNum,
-    const size_t *uttToChanInd,
-    const size_t *uttBeginFrame,
-    const size_t *uttPhoneNum,
-    const size_t *uttFrameNum,
-    const long numChannels,
-    const long maxPhoneNum,
-    const long totalPhoneNum)
+__global__ void _assignLambdaRankRanks128Threads(
+    ElemType *ranks,
+    ElemType *metrics,
+    const ElemType *gains,
+    const ElemType *scores,
+    const size_t *queryBegins)
 {
     typedef typename TypeSelector<ElemType>::comp_t comp_t;
-    LONG64 uttId = blockDim.x * blockIdx.x + threadIdx.x;
-    LONG64 t = blockDim.y * blockIdx.y + threadIdx.y;
+    const size_t q = blockIdx.x;
+    const size_t begin = queryBegins[q], end = queryBegins[q + 1];
 
-    if (uttId < uttNum && t < uttFrameNum[uttId])
+    __shared__ comp_t partials[2][128];
+    comp_t idealDCG = 0, dcg = 0;
+    for (size_t i = begin + threadIdx.x; i < end; i += 128)
     {
-        LONG64 phoneNum = uttPhoneNum[uttId];
-        LONG64 alphaId_0 = (uttBeginFrame[uttId] * numChannels + uttToChanInd[uttId]) * maxPhoneNum;
-        LONG64 timeId = (t + uttBeginFrame[uttId])*numChannels + uttToChanInd[uttId];
-        comp_t P_lx = betaScore[alphaId_0];
-
-        for (int s = 1; s < phoneNum - 1; s++)
+        const comp_t gainI = (comp_t)gains[i], scoreI = (comp_t)scores[i];
+        size_t rank = 0;
+        for (size_t j = begin; j < end; j++)
         {
-            long phoneId = (comp_t)phoneSeq[uttId*maxPhoneNum + s];
-            LONG64 alphaId = maxPhoneNum* timeId + s;
-            LONG64 probId = timeId*totalPhoneNum + phoneId;
-
-            if (phoneId != SIZE_MAX)
-            {
-                comp_t logoccu = (comp_t)alphaScore[alphaId] + (comp_t)betaScore[alphaId] - (comp_t)prob[probId] - P_lx;
-                CTCscore[probId] = logaddk((comp_t)CTCscore[probId], logoccu);
-            }
+            if (j != i && _lambdaRankPrecedes<comp_t>((comp_t)gains[j], (comp_t)scores[j], j, gainI, scoreI, i))
+                rank++;
         }
-
-        for (int s = 0; s < totalPhoneNum; s++)
+        ranks[i] = (ElemType)(comp_t)rank;
+        idealDCG += gainI / log_((comp_t)(2 + i - begin));
+        dcg += gainI / log_((comp_t)(2 + rank));
+    }
+    partials[0][threadIdx.x] = idealDCG;
+    partials[1][threadIdx.x] = dcg;
+    __syncthreads();
+    for (int k = 64; k > 0; k >>= 1)
+    {
+        if (threadIdx.x < k)
         {
-            LONG64 probId = timeId*totalPhoneNum + s;
-            comp_t logoccu = CTCscore[probId];
-            if (logoccu < LZERO)
-                CTCscore[probId] = 0.0f;
-            else
-                CTCscore[probId] = exp_(logoccu);
+            partials[0][threadIdx.x] += partials[0][threadIdx.x + k];
+            partials[1][threadIdx.x] += partials[1][threadIdx.x + k];
         }
+        __syncthreads();
+    }
+    if (threadIdx.x == 0)
+    {
+        metrics[2 * q] = (ElemType)partials[0][0];
+        metrics[2 * q + 1] = (ElemType)partials[1][0];
     }
 }
 
-// Calculate CTC score. equation (8) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
+// Adds the lambdas of the documents of one query, blockIdx.x, per block to their gradients, see CPUMatrix::AddLambdaRankGradient().
+// A thread sums the lambdas of the pairs of its document and writes its gradient once.
 template<class ElemType>
-__global__ void _assignTotalScore(ElemType *betaScore,
-    ElemType *totalScore,
-    const size_t uttNum,
-    const size_t *uttToChanInd,
-    const size_t *uttBeginFrame,
-    const size_t numChannels,
-    const size_t maxPhoneNum)
+__global__ void _addLambdaRankGradient(
+    ElemType *gradient,
+    const ElemType *gains,
+    const ElemType *scores,
+    const ElemType *ranks,
+    const ElemType *metrics,
+    const size_t *queryBegins,
+    const ElemType sigma)
 {
     typedef typename TypeSelector<ElemType>::comp_t comp_t;
-    LONG64 uttId = blockIdx.x;
-    if (uttId < uttNum)
-    {
-        LONG64 alphaId_0 = (uttBeginFrame[uttId] * numChannels + uttToChanInd[uttId]) * maxPhoneNum;
+    const size_t q = blockIdx.x;
+    const comp_t idealDCG = (comp_t)metrics[2 * q];
+    if (idealDCG == 0)
+        return;
 
-        betaScore[alphaId_0] = logaddk((comp_t)betaScore[alphaId_0 + 1], (comp_t)betaScore[alphaId_0 + 2]);
-        // Negative sum
-        atomicAdd(&totalScore[0], -1 * betaScore[alphaId_0]);
+    const comp_t s = (comp_t)sigma;
+    const size_t begin = queryBegins[q], end = queryBegins[q + 1];
+    for (size_t i = begin + threadIdx.x; i < end; i += blockDim.x)
+    {
+        const comp_t gainI = (comp_t)gains[i], scoreI = (comp_t)scores[i], discountI = log_((comp_t)2 + (comp_t)ranks[i]);
+        comp_t sum = 0;
+        for (size_t j = begin; j < end; j++)
+        {
+            const comp_t gainJ = (comp_t)gains[j];
+            if (fabs(gainI - gainJ) < (comp_t)0.0000001)
+                continue;
+
+            const comp_t discountJ = log_((comp_t)2 + (comp_t)ranks[j]);
+            const comp_t deltaNDCG = fabs((gainI - gainJ) * (discountI - discountJ) / (discountI * discountJ) / idealDCG);
+            if (gainI > gainJ)
+                sum -= s / (1 + exp_(s * (scoreI - (comp_t)scores[j]))) * deltaNDCG;
+            else
+                sum += s / (1 + exp_(s * ((comp_t)scores[j] - scoreI))) * deltaNDCG;
+        }
+        gradient[i] = (ElemType)((comp_t)gradient[i] + sum);
     }
 }
 
@@ -5800,45 +6715,132 @@ __global__ void _assignOneHot(ElemType *indices,
     }
 }
 
-template<class ElemType>
-__global__ void _gatherFromTarget(ElemType *indices,
-                                  ElemType *target,
-                                  ElemType *buffer,
-                                  size_t num_row_elements,
-                                  size_t num_indices,
-                                  CUDA_LONG num_elements)
+// Gathers along the middle axis of a [num_row_elements x axis_dim x num_outer] target, see GPUMatrix::GatherFromTarget().
+// Each thread copies one element, or one vector of elements (e.g. a float4) if VectorType is a vector type. In that case,
+// the caller ensures that the rows consist of whole vectors, and that target and buffer are aligned for the vector type.
+template<class ElemType, class VectorType>
+__global__ void _gatherVectorsFromTarget(const ElemType *indices,
+                                         const VectorType *target,
+                                         VectorType *buffer,
+                                         size_t num_row_vectors,
+                                         size_t num_index_rows,
+                                         size_t axis_dim,
+                                         size_t num_outer,
+                                         CUDA_LONG num_vectors)
 {
     const CUDA_LONG index = blockIdx.x * blockDim.x + threadIdx.x;
-    if (index < num_elements)
+    if (index < num_vectors)
     {
-        size_t indices_index = index / num_row_elements;
-        size_t offset = index % num_row_elements;
-        buffer[index] = target[(size_t)(unsigned long long int)indices[indices_index] * num_row_elements + offset];
+        size_t offset = index % num_row_vectors;
+        size_t slice = index / num_row_vectors; // = r + num_index_rows * (o + num_outer * j)
+        size_t r = slice % num_index_rows;
+        size_t o = (slice / num_index_rows) % num_outer;
+        size_t j = slice / (num_index_rows * num_outer);
+        size_t col = (size_t)(unsigned long long int)indices[r + num_index_rows * j];
+        buffer[index] = target[(col + axis_dim * o) * num_row_vectors + offset];
     }
 }
 
+// Sets up the sort of the indices of a scatter: the keys are the target columns, where masked indices get 'numCols'
+// to sort last, and the values are the positions of the indices.
 template<class ElemType>
-__global__ void _scatterToIndices(ElemType *indices,
-                                  ElemType *value,
-                                  ElemType *buffer,
-                                  char *mask,
-                                  size_t num_indices_elems_per_mask_col,
-                                  size_t num_row_elements,
-                                  size_t num_indices,
-                                  CUDA_LONG num_elements)
+__global__ void _initIndicesForSparseScatter(const ElemType *indices,
+                                             const char *mask,
+                                             size_t num_indices_elems_per_mask_col,
+                                             GPUSPARSE_INDEX_TYPE numCols,
+                                             GPUSPARSE_INDEX_TYPE *keys,
+                                             GPUSPARSE_INDEX_TYPE *positions,
+                                             CUDA_LONG num_indices)
 {
     const CUDA_LONG index = blockIdx.x * blockDim.x + threadIdx.x;
-    if (index < num_elements)
+    if (index >= num_indices)
+        return;
+
+    bool masked = mask && mask[index / num_indices_elems_per_mask_col] == 0;
+    keys[index] = masked ? numCols : (GPUSPARSE_INDEX_TYPE)(unsigned long long int)indices[index];
+    positions[index] = index;
+}
+
+// Marks the columns of the sorted keys that have no block yet, as _findColsWithValues does for the rows of a CSC matrix.
+template<class ElemType>
+__global__ void _findColsOfSortedIndices(const GPUSPARSE_INDEX_TYPE *sortedKeys,
+                                         GPUSPARSE_INDEX_TYPE *col2BlockIds,
+                                         GPUSPARSE_INDEX_TYPE numCols,
+                                         CUDA_LONG num_indices)
+{
+    const CUDA_LONG index = blockIdx.x * blockDim.x + threadIdx.x;
+    if (index >= num_indices)
+        return;
+
+    GPUSPARSE_INDEX_TYPE col = sortedKeys[index];
+    if (col < numCols && (index == 0 || sortedKeys[index - 1] != col) && col2BlockIds[col] == SparseIndex_NotAssigned)
+        col2BlockIds[col] = SparseIndex_Pending;
+}
+
+// Adds the values of each run of equal sorted keys into the block of their column. Each thread sums one row of one run,
+// so that no atomics are needed, and the result does not depend on the order in which the threads run.
+template<class ElemType>
+__global__ void _reduceSortedIndicesToSparseBlockCol(const GPUSPARSE_INDEX_TYPE *sortedKeys,
+                                                     const GPUSPARSE_INDEX_TYPE *sortedPositions,
+                                                     const ElemType *values,
+                                                     size_t numRows,
+                                                     GPUSPARSE_INDEX_TYPE numCols,
+                                                     const GPUSPARSE_INDEX_TYPE *col2BlockIds,
+                                                     ElemType *blockValues,
+                                                     CUDA_LONG num_indices)
+{
+    const CUDA_LONG index = blockIdx.x * blockDim.x + threadIdx.x;
+    const CUDA_LONG start = index / numRows;
+    if (start >= num_indices)
+        return;
+    const size_t row = index - start * numRows;
+
+    GPUSPARSE_INDEX_TYPE col = sortedKeys[start];
+    if (col >= numCols || (start > 0 && sortedKeys[start - 1] == col)) // masked, or not the first of its run
+        return;
+
+    ElemType sum = 0;
+    for (CUDA_LONG p = start; p < num_indices && sortedKeys[p] == col; p++)
+        sum += values[(size_t)sortedPositions[p] * numRows + row];
+    blockValues[(size_t)col2BlockIds[col] * numRows + row] += sum;
+}
+
+// The dense counterpart of _reduceSortedIndicesToSparseBlockCol, for the scatter into the middle axis of a
+// [num_row_elements x axis_dim x num_outer] tensor: each thread sums one element of one outer slice over a run.
+template<class ElemType>
+__global__ void _reduceSortedIndicesAlongAxis(const GPUSPARSE_INDEX_TYPE *sortedKeys,
+                                              const GPUSPARSE_INDEX_TYPE *sortedPositions,
+                                              const ElemType *values,
+                                              ElemType *buffer,
+                                              size_t num_row_elements,
+                                              size_t num_index_rows,
+                                              GPUSPARSE_INDEX_TYPE axis_dim,
+                                              size_t num_outer,
+                                              CUDA_LONG num_indices)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    const CUDA_LONG index = blockIdx.x * blockDim.x + threadIdx.x;
+    const CUDA_LONG slice = index / num_row_elements;
+    const CUDA_LONG start = slice / num_outer;
+    if (start >= num_indices)
+        return;
+    const size_t offset = index - slice * num_row_elements;
+    const size_t o = slice - start * num_outer;
+
+    GPUSPARSE_INDEX_TYPE col = sortedKeys[start];
+    if (col >= axis_dim || (start > 0 && sortedKeys[start - 1] == col)) // masked, or not the first of its run
+        return;
+
+    comp_t sum = 0;
+    for (CUDA_LONG p = start; p < num_indices && sortedKeys[p] == col; p++)
     {
-        size_t indices_index = index / num_row_elements;
-        size_t offset = index % num_row_elements;
-        //Skip missing values
-        assert(!mask || num_indices_elems_per_mask_col != 0);
-        if (mask && mask[indices_index / num_indices_elems_per_mask_col] == 0) return;
-        //We resort to nondeterministic behavior (floating point addition is not associative).
-        //Note that the CPU parallel algorithm will have poor performance on the GPU because of thread divergence
-        atomicAdd(&buffer[(size_t)(unsigned long long int)indices[indices_index] * num_row_elements + offset], value[index]);
+        size_t position = sortedPositions[p];
+        size_t r = position % num_index_rows;
+        size_t j = position / num_index_rows;
+        sum += (comp_t)values[(r + num_index_rows * (o + num_outer * j)) * num_row_elements + offset];
     }
+    ElemType& res = buffer[(col + axis_dim * o) * num_row_elements + offset];
+    res = (comp_t)res + sum;
 }
 
 
@@ -11,12 +11,14 @@
 
 #include "GPUSparseMatrix.h"
 #include "GPUMatrix.h"
+#include "GPUStreamContext.h"
 #include <cuda_runtime.h>
 #include <cusparse_v2.h>
 #include "cublas_v2.h"
 #include "GPUMatrixCUDAKernels.cuh"
 #include <functional>
 #include "CommonMatrix.h"
+#include "CUDAPageLockedMemAllocator.h"
 #include <iostream> // for cout/cerr
 #include <assert.h>
 
@@ -25,13 +27,8 @@ typedef unsigned char byte;
 #pragma warning(disable : 4267) // conversion from 'size_t' to 'unsigned int'; happens in CUDA <<<a,b>>> syntax if a and b are size_t
 #pragma warning(disable : 4127) // conditional expression is constant; "if (sizeof(ElemType)==sizeof(float))" triggers this
 
-#ifdef _WIN32
 // thread local storage to access the current stream, initalize to default stream
-extern __declspec(thread)
-#else
-static
-#endif
-    cudaStream_t t_stream;
+extern THREAD_LOCAL cudaStream_t t_stream;
 
 template <>
 const char* CudaErrString<cusparseStatus_t>(cusparseStatus_t)
@@ -42,6 +39,67 @@ const char* CudaErrString<cusparseStatus_t>(cusparseStatus_t)
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+// One cuSPARSE handle per GPU, as GPUMatrix::GetCublasHandle(): creating a handle costs more than most of the calls
+// made with it. Like the CUBLAS handles, they are never freed. A thread in a GPUStreamContext of the device uses the
+// handle of the context.
+static cusparseHandle_t GetCusparseHandle(DEVICEID_TYPE computeDevice)
+{
+    static cusparseHandle_t s_cusparseHandles[MAX_GPUS] = {};
+    if (computeDevice < 0 || computeDevice >= MAX_GPUS)
+        LogicError("GetCusparseHandle: Maximum GPU exceeded");
+
+    GPUStreamContext* context = GPUStreamContext::Current();
+    cusparseHandle_t& cusparseHandle = (context && context->GetDeviceId() == computeDevice)
+                                       ? (cusparseHandle_t&) context->CusparseHandle()
+                                       : s_cusparseHandles[computeDevice];
+    if (cusparseHandle == nullptr)
+    {
+        PrepareDevice(computeDevice);
+        CUSPARSE_CALL(cusparseCreate(&cusparseHandle));
+    }
+    CUSPARSE_CALL(cusparseSetStream(cusparseHandle, t_stream));
+    return cusparseHandle;
+}
+
+// All our matrices are general and zero-based, so they share a single descriptor.
+static cusparseMatDescr_t GetGeneralMatDescr()
+{
+    static cusparseMatDescr_t s_descr = []
+    {
+        cusparseMatDescr_t descr = nullptr;
+        CUSPARSE_CALL(cusparseCreateMatDescr(&descr));
+        cusparseSetMatType(descr, CUSPARSE_MATRIX_TYPE_GENERAL);
+        cusparseSetMatIndexBase(descr, CUSPARSE_INDEX_BASE_ZERO);
+        return descr;
+    }();
+    return s_descr;
+}
+
+#if CUDART_VERSION >= 11000
+// Workspace of the generic cuSPARSE API, one per GPU. It only grows, so once the largest minibatch has been seen,
+// the products no longer allocate.
+static void* ReserveCusparseWorkspace(DEVICEID_TYPE computeDevice, size_t sizeInBytes)
+{
+    static char* s_workspaces[MAX_GPUS] = {};
+    static size_t s_workspaceSizes[MAX_GPUS] = {};
+    if (sizeInBytes > s_workspaceSizes[computeDevice])
+    {
+        // the caching allocator reuses the old workspace on this stream only, i.e. after the products that use it
+        if (s_workspaces[computeDevice] != nullptr)
+            TracingGPUMemoryAllocator::Free<char>(computeDevice, s_workspaces[computeDevice]);
+        s_workspaces[computeDevice] = TracingGPUMemoryAllocator::Allocate<char>(computeDevice, sizeInBytes);
+        s_workspaceSizes[computeDevice] = sizeInBytes;
+    }
+    return s_workspaces[computeDevice];
+}
+
+template <class ElemType> static cudaDataType CusparseDataType();
+template <> cudaDataType CusparseDataType<float>() { return CUDA_R_32F; }
+template <> cudaDataType CusparseDataType<double>() { return CUDA_R_64F; }
+template <> cudaDataType CusparseDataType<half>() { RuntimeError("Unsupported template argument(half) in CusparseDataType"); }
+template <> cudaDataType CusparseDataType<bfloat16>() { RuntimeError("Unsupported template argument(bfloat16) in CusparseDataType"); }
+#endif
+
 #pragma region Constructors and Destructor
 
 template <class ElemType>
@@ -281,17 +339,12 @@ void GPUSparseMatrix<ElemType>::CopyToDenseMatrix(GPUMatrix<ElemType>& denseMatr
     }
 
     PrepareDevice();
-    cusparseHandle_t cusparseHandle = 0;
-    CUSPARSE_CALL(cusparseCreate(&cusparseHandle));
-    cusparseMatDescr_t descr = 0;
-    CUSPARSE_CALL(cusparseCreateMatDescr(&descr));
-    cusparseSetMatType(descr, CUSPARSE_MATRIX_TYPE_GENERAL);
-    cusparseSetMatIndexBase(descr, CUSPARSE_INDEX_BASE_ZERO);
+    cusparseHandle_t cusparseHandle = GetCusparseHandle(GetComputeDeviceId());
+    cusparseMatDescr_t descr = GetGeneralMatDescr();
 
     denseMatrix.RequireSize(GetNumRows(), GetNumCols());
 
     SyncGuard syncGuard;
-    CUSPARSE_CALL(cusparseSetStream(cusparseHandle, t_stream));
     if (GetFormat() == MatrixFormat::matrixFormatSparseCSR)
     {
         CUSPARSE_CALL(cusparsecsr2denseHelper(cusparseHandle, int(GetNumRows()), int(GetNumCols()), descr, Buffer(), RowLocation(), ColLocation(), denseMatrix.Data(), int(GetNumRows())));
@@ -309,7 +362,6 @@ void GPUSparseMatrix<ElemType>::CopyToDenseMatrix(GPUMatrix<ElemType>& denseMatr
     {
         NOT_IMPLEMENTED;
     }
-    CUSPARSE_CALL(cusparseDestroy(cusparseHandle));
 
 }
 
@@ -332,18 +384,16 @@ void GPUSparseMatrix<ElemType>::ConvertToSparseFormat(MatrixFormat newFormat, GP
     }
 
     PrepareDevice();
-    cusparseHandle_t cusparseHandle = 0;
-    CUSPARSE_CALL(cusparseCreate(&cusparseHandle));
+    cusparseHandle_t cusparseHandle = GetCusparseHandle(GetComputeDeviceId());
 
     SyncGuard syncGuard;
-    CUSPARSE_CALL(cusparseSetStream(cusparseHandle, t_stream));
 
     outMatrix.ChangeDeviceTo(GetComputeDeviceId());
     outMatrix.RequireSizeAndAllocate(GetNumRows(), GetNumCols(), NzCount(), newFormat, true, false);
 
     if ((oldFormat == matrixFormatSparseCSR && newFormat == matrixFormatSparseCSC) || (oldFormat == matrixFormatSparseCSC && newFormat == matrixFormatSparseCSR))
     {
-        CUSPARSE_CALL(cusparsecsr2cscHelper(cusparseHandle, int(GetNumRows()), int(GetNumCols()), int(GetSizeAllocated()),
+        CUSPARSE_CALL(cusparsecsr2cscHelper(cusparseHandle, int(GetNumRows()), int(GetNumCols()), int(NzCount()),
                                             Data(), RowLocation(), ColLocation(), outMatrix.Data(),
                                             outMatrix.RowLocation(), outMatrix.ColLocation(), CUSPARSE_ACTION_NUMERIC, CUSPARSE_INDEX_BASE_ZERO));
     }
@@ -352,7 +402,6 @@ void GPUSparseMatrix<ElemType>::ConvertToSparseFormat(MatrixFormat newFormat, GP
         NOT_IMPLEMENTED;
     }
 
-    CUSPARSE_CALL(cusparseDestroy(cusparseHandle));
 }
 
 template <class ElemType>
@@ -424,14 +473,13 @@ void GPUSparseMatrix<ElemType>::ChangeDeviceTo(DEVICEID_TYPE to_id)
 #endif
         {
             // peer access didn't work, just copy normal
-            // make this more efficient by keeping some buffers available for each copy
-            ElemType* h_dst = NULL;
+            // the staging buffer comes from the pool of page-locked memory, see CUDAPageLockedMemAllocator
             PrepareDevice();
-            CUDA_CALL(cudaMallocHost((void**) &h_dst, BufferSizeAllocated()));
+            ElemType* h_dst = (ElemType*) CUDAPageLockedMemAllocator::Malloc(BufferSizeAllocated(), GetComputeDeviceId());
             CUDA_CALL(cudaMemcpy(h_dst, Buffer(), BufferSizeAllocated(), cudaMemcpyDeviceToHost));
             PrepareDevice((DEVICEID_TYPE) to_id);
             CUDA_CALL(cudaMemcpy(d_dst, h_dst, BufferSizeAllocated(), cudaMemcpyHostToDevice));
-            CUDA_CALL(cudaFreeHost(h_dst));
+            CUDAPageLockedMemAllocator::Free(h_dst, to_id);
         }
 
         TracingGPUMemoryAllocator::Free<ElemType>(GetComputeDeviceId(), Buffer());
@@ -468,12 +516,8 @@ void GPUSparseMatrix<ElemType>::SetValue(const GPUMatrix<ElemType>& denseMatrix,
     }
 
     PrepareDevice();
-    cusparseHandle_t cusparseHandle = 0;
-    CUSPARSE_CALL(cusparseCreate(&cusparseHandle));
-    cusparseMatDescr_t descr = 0;
-    CUSPARSE_CALL(cusparseCreateMatDescr(&descr));
-    cusparseSetMatType(descr, CUSPARSE_MATRIX_TYPE_GENERAL);
-    cusparseSetMatIndexBase(descr, CUSPARSE_INDEX_BASE_ZERO);
+    cusparseHandle_t cusparseHandle = GetCusparseHandle(GetComputeDeviceId());
+    cusparseMatDescr_t descr = GetGeneralMatDescr();
 
     int numRows = (int) denseMatrix.GetNumRows(); // m
     int numCols = (int) denseMatrix.GetNumCols(); // n
@@ -697,7 +741,7 @@ void GPUSparseMatrix<ElemType>::Reshape(const size_t numRows, const size_t numCo
 // WARNING: When memory is reallocated, existing information will be lost.
 // TODO: add keepExistingValues (default to true) argument so that the existing values are kept even after reallocation
 template <class ElemType>
-void GPUSparseMatrix<ElemType>::Allocate(const size_t numRows, const size_t numCols, const size_t numNZElemToReserve, const bool growOnly /*= true*/, bool keepExistingValues /*= true*/)
+void GPUSparseMatrix<ElemType>::Allocate(const size_t numRows, const size_t numCols, size_t numNZElemToReserve, const bool growOnly /*= true*/, bool keepExistingValues /*= true*/)
 {
     // BugBug: This doesn't work because allocate is called from Resize sometimes and resize expects allocate to know the old values not the new values, so this won't work.
     if (GetNumRows() != numRows || GetNumCols() != numCols)
@@ -708,6 +752,14 @@ void GPUSparseMatrix<ElemType>::Allocate(const size_t numRows, const size_t numC
 
     if (reallocate)
     {
+        // When growing, reserve half as much again, so that minibatches with slowly increasing non-zero counts
+        // reallocate a logarithmic number of times rather than on every minibatch.
+        if (growOnly && Buffer() != nullptr && numNZElemToReserve > GetSizeAllocated())
+        {
+            numNZElemToReserve = max(numNZElemToReserve, GetSizeAllocated() + GetSizeAllocated() / 2);
+            bufferSizeNeeded = BufferSizeNeeded(numRows, numCols, numNZElemToReserve, GetFormat());
+        }
+
         // Note that we are allocating one buffer for all of our data structures. Thus the ElemType* nzValues array lives directly next to
         // the GPUSPARSE_INDEX_TYPE* rowIndices/colIndices in sparseCSC/CSR formats. Thus we allocate the number of bytes, and then set the
         // start pointer to an ElemType*.
@@ -761,7 +813,14 @@ void GPUSparseMatrix<ElemType>::RequireSizeAndAllocate(const size_t numRows, con
 
     if (reallocate)
         Allocate(numRows, numCols, numNZElemToReserve, growOnly, keepExistingValues);
+    else if (GetSizeAllocated() < numNZElemToReserve)
+    {
+        // The buffer is large enough, but its layout was compacted for fewer elements (see SetMatrixFromCSCFormat).
+        if (keepExistingValues && NzCount() > 0)
+            LogicError("RequireSizeAndAllocate: cannot keep the values of a compacted sparse matrix.");
 
+        SetSizeAllocated(ElemCountFromBufferSize(numRows, numCols, matrixFormat, BufferSizeAllocated()));
+    }
 }
 
 template <class ElemType>
@@ -942,6 +1001,18 @@ void GPUSparseMatrix<ElemType>::SetMatrixFromCSCFormat(const CPUSPARSE_INDEX_TYP
         // Here we have to wait for them to finish.
         transferer->RecordComputeStreamSyncPoint();
         transferer->WaitForSyncPointOnAssignStreamAsync();
+
+        // Readers pack the values, row indices and column offsets back to back (see SequencePacker), which is
+        // our own layout for exactly nz elements: the buffer is compacted to it and the block copied at once.
+        bool isPacked = sizeof(CPUSPARSE_INDEX_TYPE) == sizeof(GPUSPARSE_INDEX_TYPE) &&
+                        (const char*)h_Row == (const char*)(h_Val + nz) && h_CSCCol == h_Row + nz;
+        if (isPacked && m_sliceViewOffset == 0)
+        {
+            SetSizeAllocated(nz);
+            transferer->CopyCPUToGPUAsync(h_Val, 1, BufferSizeNeeded(numRows, numCols, nz, matrixFormatSparseCSC), Buffer());
+            return;
+        }
+
         transferer->CopyCPUToGPUAsync(h_Val, nz, sizeof(ElemType), Data());
     }
     else
@@ -1377,6 +1448,88 @@ void GPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const GPUMatrix<E
     }
 }
 
+// Adds the columns of 'values' into the columns of this SparseBlockCol matrix given by 'indices', e.g. for the
+// gradient of an embedding that was gathered by word ids. Instead of atomic adds into the columns, the indices are
+// sorted by column, and each run of equal columns is then added up into its block by a segmented reduction.
+template <class ElemType>
+GPUSparseMatrix<ElemType>& GPUSparseMatrix<ElemType>::ScatterToIndices(const GPUMatrix<ElemType>& values, const GPUMatrix<ElemType>& indices, size_t row_elements, const GPUMatrix<char>* mask /*= nullptr*/)
+{
+    VerifyWritable(__FUNCTION__);
+
+    if (indices.IsEmpty() || values.IsEmpty() || (mask && mask->IsEmpty()))
+        LogicError("ScatterToIndices: input matrix is empty.");
+    if (GetFormat() != matrixFormatSparseBlockCol || row_elements != GetNumRows())
+        NOT_IMPLEMENTED;
+    if (values.GetComputeDeviceId() != GetComputeDeviceId() || indices.GetComputeDeviceId() != GetComputeDeviceId())
+        RuntimeError("GPUSparseMatrix::ScatterToIndices: All matrices must be on the same GPU");
+
+    const size_t m = GetNumRows();
+    const GPUSPARSE_INDEX_TYPE n = (GPUSPARSE_INDEX_TYPE)GetNumCols();
+    const CUDA_LONG numIndices = (CUDA_LONG)indices.GetNumElements();
+    const size_t numIndicesPerMaskEntry = mask ? numIndices / mask->GetNumCols() : 0;
+
+    PrepareDevice();
+    SyncGuard syncGuard;
+
+    size_t blockSizePrev = GetBlockSize();
+    if (blockSizePrev == 0)
+    {
+        Resize(m, n, 0);
+        CUDA_CALL(cudaMemset(ColOrRow2BlockId(), SparseIndex_NotAssigned, sizeof(GPUSPARSE_INDEX_TYPE) * (n)));
+        CUDA_CALL(cudaMemset(BlockId2ColOrRow(), SparseIndex_NotAssigned, sizeof(GPUSPARSE_INDEX_TYPE) * (n)));
+    }
+
+    // The keys only need the bits of the column indices, including 'n' for the masked ones.
+    int endBit = 1;
+    while (endBit < 31 && ((GPUSPARSE_INDEX_TYPE)1 << endBit) <= n)
+        endBit++;
+
+    // keys, positions, sorted keys and sorted positions, followed by the temporary storage of the sort
+    size_t cbtemp = 0;
+    CUDA_CALL(cub::DeviceRadixSort::SortPairs(nullptr, cbtemp, (GPUSPARSE_INDEX_TYPE*)nullptr, (GPUSPARSE_INDEX_TYPE*)nullptr,
+                                              (GPUSPARSE_INDEX_TYPE*)nullptr, (GPUSPARSE_INDEX_TYPE*)nullptr, numIndices, 0, endBit, t_stream));
+    ReserveTempDeviceBuffer(4 * numIndices + (cbtemp + sizeof(GPUSPARSE_INDEX_TYPE) - 1) / sizeof(GPUSPARSE_INDEX_TYPE));
+    GPUSPARSE_INDEX_TYPE* keys = GetTempDeviceBuffer();
+    GPUSPARSE_INDEX_TYPE* positions = keys + numIndices;
+    GPUSPARSE_INDEX_TYPE* sortedKeys = positions + numIndices;
+    GPUSPARSE_INDEX_TYPE* sortedPositions = sortedKeys + numIndices;
+    void* ptmp = sortedPositions + numIndices;
+
+    int blocksPerGrid = (int)ceil(((double)numIndices) / GridDim::maxThreadsPerBlock);
+    _initIndicesForSparseScatter<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock, 0, t_stream>>>(
+        indices.Data(), mask ? mask->Data() : nullptr, numIndicesPerMaskEntry, n, keys, positions, numIndices);
+    CUDA_CALL(cub::DeviceRadixSort::SortPairs(ptmp, cbtemp, keys, sortedKeys, positions, sortedPositions, numIndices, 0, endBit, t_stream));
+
+    // new blocks for the columns that do not have one yet
+    size_t* blockSize = TracingGPUMemoryAllocator::Allocate<size_t>(GetComputeDeviceId(), 1);
+    CUDA_CALL(cudaMemcpy(blockSize, &blockSizePrev, sizeof(size_t), cudaMemcpyHostToDevice));
+
+    _findColsOfSortedIndices<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock, 0, t_stream>>>(sortedKeys, ColOrRow2BlockId(), n, numIndices);
+
+    blocksPerGrid = (int)ceil(((double)n) / GridDim::maxThreadsPerBlock);
+    _determineBlockIds<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock, 0, t_stream>>>(BlockId2ColOrRow(), ColOrRow2BlockId(), n, blockSize);
+
+    size_t blockSizeCurr;
+    CUDA_CALL(cudaMemcpy(&blockSizeCurr, blockSize, sizeof(size_t), cudaMemcpyDeviceToHost));
+    TracingGPUMemoryAllocator::Free<size_t>(GetComputeDeviceId(), blockSize);
+    SetBlockSize(blockSizeCurr);
+
+    if (blockSizeCurr > blockSizePrev)
+    {
+        // zero initialize new blocks
+        size_t nnz = m * blockSizeCurr;
+        RequireSizeAndAllocate(m, n, nnz, true, true); // we need to keep the col2blockid and blockid2col info when resizing.
+        CUDA_CALL(cudaMemset(Data() + m * blockSizePrev, 0, sizeof(ElemType) * m * (blockSizeCurr - blockSizePrev)));
+    }
+
+    CUDA_LONG N = numIndices * (CUDA_LONG)m;
+    blocksPerGrid = (int)ceil(((double)N) / GridDim::maxThreadsPerBlock);
+    _reduceSortedIndicesToSparseBlockCol<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock, 0, t_stream>>>(
+        sortedKeys, sortedPositions, values.Data(), m, n, ColOrRow2BlockId(), Data(), numIndices);
+
+    return *this;
+}
+
 // find the rows of rhs with values
 template <class ElemType>
 size_t GPUSparseMatrix<ElemType>::IdentifyRowsWithValues() const
@@ -1470,6 +1623,16 @@ GPUSparseMatrix<ElemType>& GPUSparseMatrix<ElemType>::InplaceSoftThreshold(const
     return *this;
 }
 
+// sets the timestamps of the columns or rows of the blocks of a sparse block matrix
+__global__ void _updateTimestamps(CUDA_LONG N, const GPUSPARSE_INDEX_TYPE* blockId2ColOrRow, int* timestamps, int currentTimestamp)
+{
+    auto blockid = blockIdx.x * blockDim.x + threadIdx.x;
+    if (blockid >= N)
+        return;
+    auto col = blockId2ColOrRow[blockid];
+    timestamps[col] = currentTimestamp;
+}
+
 // A helper method used in MomentumSGDUpdate and NesterovAcceleratedMomentumSGDUpdate.
 // Modifies the smoothed gradients "c", as well as the current gradients "this" on which this method is invoked.
 // Classic momentum (unitGainFactor == 1.0):
@@ -1477,9 +1640,10 @@ GPUSparseMatrix<ElemType>& GPUSparseMatrix<ElemType>::InplaceSoftThreshold(const
 // Unit-gain momentum (unitGainFactor == 1.0 - momentum):
 // 1) c = momentum * c + (1.0 - momentum) * this
 // 2) this = c
+// With timestamps (block column format only), c of a column is first decayed by the momentum of the updates it missed.
 // TODO: NormalGrad is a misnomer here. Come up with a better name.
 template <class ElemType>
-void GPUSparseMatrix<ElemType>::NormalGrad(GPUMatrix<ElemType>& c, const ElemType momentum, ElemType unitGainFactor)
+void GPUSparseMatrix<ElemType>::NormalGrad(GPUMatrix<ElemType>& c, const ElemType momentum, ElemType unitGainFactor, int* timestamps, int currentTimestamp)
 {
     VerifyWritable(__FUNCTION__);
 
@@ -1492,6 +1656,8 @@ void GPUSparseMatrix<ElemType>::NormalGrad(GPUMatrix<ElemType>& c, const ElemTyp
     if (GetFormat() == matrixFormatSparseBlockCol || GetFormat() == matrixFormatSparseBlockRow)
     {
         bool isBlockCol = (GetFormat() == MatrixFormat::matrixFormatSparseBlockCol);
+        if (timestamps != nullptr && !isBlockCol)
+            NOT_IMPLEMENTED;
         SyncGuard syncGuard;
         LONG64 N = (LONG64) GetNumNZElements();
         int blocksPerGrid = (int) ceil(((double) N) / GridDim::maxThreadsPerBlock);
@@ -1505,7 +1671,15 @@ void GPUSparseMatrix<ElemType>::NormalGrad(GPUMatrix<ElemType>& c, const ElemTyp
             Data(),
             BlockId2ColOrRow(),
             c.Data(),
-            unitGainFactor);
+            unitGainFactor,
+            timestamps,
+            currentTimestamp);
+
+        if (timestamps != nullptr)
+        {
+            blocksPerGrid = (int) ceil(((double) GetBlockSize()) / GridDim::maxThreadsPerBlock);
+            _updateTimestamps<<<blocksPerGrid, GridDim::maxThreadsPerBlock>>>((CUDA_LONG) GetBlockSize(), BlockId2ColOrRow(), timestamps, currentTimestamp);
+        }
     }
     else
     {
@@ -1604,7 +1778,10 @@ void GPUSparseMatrix<ElemType>::Adam(
     ElemType adaMul,
     ElemType epsilon,
     ElemType unitGainFactor,
-    bool adamax)
+    bool adamax,
+    bool lazy,
+    int* timestamps,
+    int currentTimestamp)
 {
     if (GetFormat() != MatrixFormat::matrixFormatSparseBlockCol)
     {
@@ -1622,6 +1799,23 @@ void GPUSparseMatrix<ElemType>::Adam(
     assert((c.GetNumRows() == GetNumRows()) && (c.GetNumCols() == numColsNeeded));
 
     size_t n = GetNumElements();
+    if (lazy)
+    {
+        // only the columns of the gradient are updated
+        size_t numNZ = GetBlockSize() * GetNumRows();
+        int blocksPerGrid = (numNZ + GridDim::maxThreadsPerBlock - 1) / GridDim::maxThreadsPerBlock;
+        _lazyAdam4BlockSparseCol<ElemType> << <blocksPerGrid, GridDim::maxThreadsPerBlock >> >(
+            numNZ, Data(), BlockId2ColOrRow(), GetNumRows(),
+            c.Data(), c.Data() + n, functionValues.Data(),
+            learnRatePerSample, momentum, adaWeight, adaMul, epsilon, unitGainFactor, adamax, timestamps, currentTimestamp);
+        if (timestamps != nullptr)
+        {
+            blocksPerGrid = (GetBlockSize() + GridDim::maxThreadsPerBlock - 1) / GridDim::maxThreadsPerBlock;
+            _updateTimestamps<<<blocksPerGrid, GridDim::maxThreadsPerBlock>>>(GetBlockSize(), BlockId2ColOrRow(), timestamps, currentTimestamp);
+        }
+        return;
+    }
+
     int blocksPerGrid = (n + GridDim::maxThreadsPerBlock - 1) / GridDim::maxThreadsPerBlock;
     _adam4BlockSparseCol<ElemType> << <blocksPerGrid, GridDim::maxThreadsPerBlock >> >(
         n, Data(), ColOrRow2BlockId(), GetNumRows(),
@@ -1713,15 +1907,6 @@ ElemType GPUSparseMatrix<ElemType>::RmsProp(GPUMatrix<ElemType>& c,
     return (ElemType)aveMultiplier / n;
 }
 
-__global__ void _updateTimestamps(CUDA_LONG N, const GPUSPARSE_INDEX_TYPE* blockId2ColOrRow, int* timestamps, int currentTimestamp)
-{
-    auto blockid = blockIdx.x * blockDim.x + threadIdx.x;
-    if (blockid >= N)
-        return;
-    auto col = blockId2ColOrRow[blockid];
-    timestamps[col] = currentTimestamp;
-}
-
 template <class ElemType>
 template <class AccumType>
 void GPUSparseMatrix<ElemType>::AdaDelta(GPUMatrix<AccumType>&c, GPUMatrix<AccumType>&functionValues, AccumType learningRate, AccumType rho, AccumType epsilon, int* timestamps, int currentTimestamp)
@@ -1769,12 +1954,8 @@ void GPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const GPU
         RuntimeError("MultiplyAndWeightedAdd: All matrices must be on the same GPU");
 
     a.PrepareDevice();
-    cusparseHandle_t cusparseHandle = 0;
-    CUSPARSE_CALL(cusparseCreate(&cusparseHandle));
-    cusparseMatDescr_t descr = 0;
-    CUSPARSE_CALL(cusparseCreateMatDescr(&descr));
-    cusparseSetMatType(descr, CUSPARSE_MATRIX_TYPE_GENERAL);
-    cusparseSetMatIndexBase(descr, CUSPARSE_INDEX_BASE_ZERO);
+    cusparseHandle_t cusparseHandle = GetCusparseHandle(a.GetComputeDeviceId());
+    cusparseMatDescr_t descr = GetGeneralMatDescr();
 
     cusparseOperation_t oper = (transposeA != reinterpretAsCSR) ? CUSPARSE_OPERATION_TRANSPOSE : CUSPARSE_OPERATION_NON_TRANSPOSE;
 
@@ -1787,10 +1968,32 @@ void GPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const GPU
     const auto& aColLocation = reinterpretAsCSR ? a.RowLocation() : a.ColLocation();
 
     SyncGuard syncGuard;
+#if CUDART_VERSION >= 11000
+    UNUSED(descr);
+    // generic API: the descriptors only wrap the device pointers on the host, while the workspace is kept across calls
+    const cudaDataType dataType = CusparseDataType<ElemType>();
+    cusparseSpMatDescr_t matA;
+    cusparseDnMatDescr_t matB, matC;
+    CUSPARSE_CALL(cusparseCreateCsr(&matA, m, k, (int64_t) a.GetNumNZElements(), (void*) aRowLocation, (void*) aColLocation, (void*) a.Buffer(),
+                                    CUSPARSE_INDEX_32I, CUSPARSE_INDEX_32I, CUSPARSE_INDEX_BASE_ZERO, dataType));
+    CUSPARSE_CALL(cusparseCreateDnMat(&matB, oper == CUSPARSE_OPERATION_TRANSPOSE ? m : k, n, (int64_t) b.GetNumRows(), (void*) b.Data(), dataType, CUSPARSE_ORDER_COL));
+    CUSPARSE_CALL(cusparseCreateDnMat(&matC, oper == CUSPARSE_OPERATION_TRANSPOSE ? k : m, n, (int64_t) c.GetNumRows(), (void*) c.Data(), dataType, CUSPARSE_ORDER_COL));
+
+    size_t workspaceSize = 0;
+    CUSPARSE_CALL(cusparseSpMM_bufferSize(cusparseHandle, oper, CUSPARSE_OPERATION_NON_TRANSPOSE, &alpha, matA, matB, &beta, matC,
+                                          dataType, CUSPARSE_SPMM_ALG_DEFAULT, &workspaceSize));
+    void* workspace = ReserveCusparseWorkspace(a.GetComputeDeviceId(), workspaceSize);
+    CUSPARSE_CALL(cusparseSpMM(cusparseHandle, oper, CUSPARSE_OPERATION_NON_TRANSPOSE, &alpha, matA, matB, &beta, matC,
+                               dataType, CUSPARSE_SPMM_ALG_DEFAULT, workspace));
+
+    CUSPARSE_CALL(cusparseDestroyDnMat(matC));
+    CUSPARSE_CALL(cusparseDestroyDnMat(matB));
+    CUSPARSE_CALL(cusparseDestroySpMat(matA));
+#else
     CUSPARSE_CALL(cusparsecsrmmHelper(cusparseHandle, oper, m, n, k, (int) a.GetNumNZElements(), &alpha, descr, a.Buffer(),
                                      aRowLocation, aColLocation, b.Data(),
                                      (int) b.GetNumRows(), &beta, c.Data(), (int) c.GetNumRows()));
-    CUSPARSE_CALL(cusparseDestroy(cusparseHandle));
+#endif
 }
 
 template <class ElemType>
@@ -1909,18 +2112,8 @@ void GPUSparseMatrix<ElemType>::Multiply(const GPUSparseMatrix<ElemType>& S1, bo
         RuntimeError("Sparse matrix multiply: both matrices must be on the same device");
 
     S1.PrepareDevice();
-    cusparseHandle_t cusparseHandle = 0;
-    CUSPARSE_CALL(cusparseCreate(&cusparseHandle));
-    cusparseMatDescr_t descrA = 0, descrB = 0, descrC = 0;
-    CUSPARSE_CALL(cusparseCreateMatDescr(&descrA));
-    CUSPARSE_CALL(cusparseCreateMatDescr(&descrB));
-    CUSPARSE_CALL(cusparseCreateMatDescr(&descrC));
-    cusparseSetMatType(descrA, CUSPARSE_MATRIX_TYPE_GENERAL);
-    cusparseSetMatType(descrB, CUSPARSE_MATRIX_TYPE_GENERAL);
-    cusparseSetMatType(descrC, CUSPARSE_MATRIX_TYPE_GENERAL);
-    cusparseSetMatIndexBase(descrA, CUSPARSE_INDEX_BASE_ZERO);
-    cusparseSetMatIndexBase(descrB, CUSPARSE_INDEX_BASE_ZERO);
-    cusparseSetMatIndexBase(descrC, CUSPARSE_INDEX_BASE_ZERO);
+    cusparseHandle_t cusparseHandle = GetCusparseHandle(S1.GetComputeDeviceId());
+    cusparseMatDescr_t descrA = GetGeneralMatDescr(), descrB = descrA, descrC = descrA;
     cusparseOperation_t operA = transposeS1 ? CUSPARSE_OPERATION_TRANSPOSE : CUSPARSE_OPERATION_NON_TRANSPOSE;
     cusparseOperation_t operB = transposeS2 ? CUSPARSE_OPERATION_TRANSPOSE : CUSPARSE_OPERATION_NON_TRANSPOSE;
 
@@ -1949,7 +2142,6 @@ void GPUSparseMatrix<ElemType>::Multiply(const GPUSparseMatrix<ElemType>& S1, bo
     CUSPARSE_CALL(cusparsecsrgemmHelper(cusparseHandle, operA, operB, m, n, k, descrA, nnzA, S1.Buffer(), S1.RowLocation(), S1.ColLocation(),
                                         descrB, nnzB, S2.Buffer(), S2.RowLocation(), S2.ColLocation(),
                                         descrC, c.Data(), c.RowLocation(), c.ColLocation()));
-    cusparseDestroy(cusparseHandle);
 }
 
 template <class ElemType>
@@ -1982,18 +2174,8 @@ void GPUSparseMatrix<ElemType>::ScaleAndAdd(ElemType alpha, const GPUSparseMatri
     int nnzB = (int) b.GetNumNZElements();
 
     a.PrepareDevice();
-    cusparseHandle_t cusparseHandle = 0;
-    CUSPARSE_CALL(cusparseCreate(&cusparseHandle));
-    cusparseMatDescr_t descrA = 0, descrB = 0, descrC = 0;
-    CUSPARSE_CALL(cusparseCreateMatDescr(&descrA));
-    CUSPARSE_CALL(cusparseCreateMatDescr(&descrB));
-    CUSPARSE_CALL(cusparseCreateMatDescr(&descrC));
-    cusparseSetMatType(descrA, CUSPARSE_MATRIX_TYPE_GENERAL);
-    cusparseSetMatType(descrB, CUSPARSE_MATRIX_TYPE_GENERAL);
-    cusparseSetMatType(descrB, CUSPARSE_MATRIX_TYPE_GENERAL);
-    cusparseSetMatIndexBase(descrA, CUSPARSE_INDEX_BASE_ZERO);
-    cusparseSetMatIndexBase(descrB, CUSPARSE_INDEX_BASE_ZERO);
-    cusparseSetMatIndexBase(descrC, CUSPARSE_INDEX_BASE_ZERO);
+    cusparseHandle_t cusparseHandle = GetCusparseHandle(a.GetComputeDeviceId());
+    cusparseMatDescr_t descrA = GetGeneralMatDescr(), descrB = descrA, descrC = descrA;
 
     SyncGuard syncGuard;
     // Step 1
@@ -2009,7 +2191,6 @@ void GPUSparseMatrix<ElemType>::ScaleAndAdd(ElemType alpha, const GPUSparseMatri
     // Step 2
     CUSPARSE_CALL(cusparsecsrgeamHelper(cusparseHandle, m, n, &alpha, descrA, nnzA, a.Data(), a.RowLocation(), a.ColLocation(),
                                         &beta, descrB, nnzB, b.Data(), b.RowLocation(), b.ColLocation(), descrC, c.Data(), c.RowLocation(), c.ColLocation()));
-    cusparseDestroy(cusparseHandle);
 }
 
 template <class ElemType>
@@ -2099,8 +2280,7 @@ ElemType GPUSparseMatrix<ElemType>::InnerProductOfMatrices(const GPUSparseMatrix
 
     cusparseAction_t cpVals = CUSPARSE_ACTION_NUMERIC;
     cusparseIndexBase_t idxBase = CUSPARSE_INDEX_BASE_ZERO;
-    cusparseHandle_t cusparseHandle = 0;
-    CUSPARSE_CALL(cusparseCreate(&cusparseHandle));
+    cusparseHandle_t cusparseHandle = GetCusparseHandle(a.GetComputeDeviceId());
 
     bool allocTemp = (a.GetFormat() == matrixFormatSparseCSR);
 
@@ -2147,7 +2327,6 @@ ElemType GPUSparseMatrix<ElemType>::InnerProductOfMatrices(const GPUSparseMatrix
     {
         TracingGPUMemoryAllocator::Free<ElemType>(a.GetComputeDeviceId(), cscValA);
     }
-    CUSPARSE_CALL(cusparseDestroy(cusparseHandle));
     return res;
 }
 
@@ -2408,8 +2587,7 @@ GPUSparseMatrix<ElemType> GPUSparseMatrix<ElemType>::Transpose() const
     GPUSparseMatrix c(GetComputeDeviceId(), GetFormat());
     c.RequireSizeAndAllocate(n, m, nnz, GetFormat(), true, false);
 
-    cusparseHandle_t cusparseHandle = 0;
-    CUSPARSE_CALL(cusparseCreate(&cusparseHandle));
+    cusparseHandle_t cusparseHandle = GetCusparseHandle(GetComputeDeviceId());
 
     SyncGuard syncGuard;
     if (GetFormat() == MatrixFormat::matrixFormatSparseCSR)
@@ -2440,7 +2618,6 @@ GPUSparseMatrix<ElemType> GPUSparseMatrix<ElemType>::Transpose() const
     {
         NOT_IMPLEMENTED;
     }
-    CUSPARSE_CALL(cusparseDestroy(cusparseHandle));
     return c;
 }
 
@@ -2507,17 +2684,11 @@ void GPUSparseMatrix<ElemType>::AssignColumnSliceToDense(GPUMatrix<ElemType>& sl
     }
 
     PrepareDevice();
-    cusparseHandle_t cusparseHandle = 0;
-    CUSPARSE_CALL(cusparseCreate(&cusparseHandle));
-    cusparseMatDescr_t descr = 0;
-    CUSPARSE_CALL(cusparseCreateMatDescr(&descr));
-    cusparseSetMatType(descr, CUSPARSE_MATRIX_TYPE_GENERAL);
-    cusparseSetMatIndexBase(descr, CUSPARSE_INDEX_BASE_ZERO);
+    cusparseHandle_t cusparseHandle = GetCusparseHandle(GetComputeDeviceId());
+    cusparseMatDescr_t descr = GetGeneralMatDescr();
 
     SyncGuard syncGuard;
-    CUSPARSE_CALL(cusparseSetStream(cusparseHandle, t_stream));
     CUSPARSE_CALL(cusparsecsc2denseHelper(cusparseHandle, m, numCols, descr, Buffer(), RowLocation(), ColLocation() + startColumn, slice.Data(), m));
-    CUSPARSE_CALL(cusparseDestroy(cusparseHandle));
 }
 template <class ElemType>
 GPUMatrix<ElemType> GPUSparseMatrix<ElemType>::CopyColumnSliceToDense(size_t startColumn, size_t numCols) const
@@ -3058,32 +3229,44 @@ void GPUSparseMatrix<ElemType>::performElementWiseFunction(ElementWiseOperator k
 template class MATH_API GPUSparseMatrix<float>;
 template class MATH_API GPUSparseMatrix<double>;
 template class MATH_API GPUSparseMatrix<half>;
+template class MATH_API GPUSparseMatrix<bfloat16>;
 
 // instantiate cast methods
 template void GPUSparseMatrix<char>::DeepCast(const GPUSparseMatrix<float>& deepCopyFrom);
 template void GPUSparseMatrix<char>::DeepCast(const GPUSparseMatrix<double>& deepCopyFrom);
 template void GPUSparseMatrix<char>::DeepCast(const GPUSparseMatrix<half>& deepCopyFrom);
+template void GPUSparseMatrix<char>::DeepCast(const GPUSparseMatrix<bfloat16>& deepCopyFrom);
 template void GPUSparseMatrix<short>::DeepCast(const GPUSparseMatrix<float>& deepCopyFrom);
 template void GPUSparseMatrix<short>::DeepCast(const GPUSparseMatrix<double>& deepCopyFrom);
 template void GPUSparseMatrix<short>::DeepCast(const GPUSparseMatrix<half>& deepCopyFrom);
+template void GPUSparseMatrix<short>::DeepCast(const GPUSparseMatrix<bfloat16>& deepCopyFrom);
 template void GPUSparseMatrix<int>::DeepCast(const GPUSparseMatrix<float>& deepCopyFrom);
 template void GPUSparseMatrix<int>::DeepCast(const GPUSparseMatrix<double>& deepCopyFrom);
 template void GPUSparseMatrix<int>::DeepCast(const GPUSparseMatrix<half>& deepCopyFrom);
+template void GPUSparseMatrix<int>::DeepCast(const GPUSparseMatrix<bfloat16>& deepCopyFrom);
 template void GPUSparseMatrix<float>::DeepCast(const GPUSparseMatrix<float>& deepCopyFrom);
 template void GPUSparseMatrix<float>::DeepCast(const GPUSparseMatrix<double>& deepCopyFrom);
 template void GPUSparseMatrix<float>::DeepCast(const GPUSparseMatrix<half>& deepCopyFrom);
+template void GPUSparseMatrix<float>::DeepCast(const GPUSparseMatrix<bfloat16>& deepCopyFrom);
 template void GPUSparseMatrix<double>::DeepCast(const GPUSparseMatrix<float>& deepCopyFrom);
 template void GPUSparseMatrix<double>::DeepCast(const GPUSparseMatrix<double>& deepCopyFrom);
 template void GPUSparseMatrix<double>::DeepCast(const GPUSparseMatrix<half>& deepCopyFrom);
+template void GPUSparseMatrix<double>::DeepCast(const GPUSparseMatrix<bfloat16>& deepCopyFrom);
 template void GPUSparseMatrix<half>::DeepCast(const GPUSparseMatrix<float>& deepCopyFrom);
 template void GPUSparseMatrix<half>::DeepCast(const GPUSparseMatrix<double>& deepCopyFrom);
 template void GPUSparseMatrix<half>::DeepCast(const GPUSparseMatrix<half>& deepCopyFrom);
+template void GPUSparseMatrix<half>::DeepCast(const GPUSparseMatrix<bfloat16>& deepCopyFrom);
+template void GPUSparseMatrix<bfloat16>::DeepCast(const GPUSparseMatrix<float>& deepCopyFrom);
+template void GPUSparseMatrix<bfloat16>::DeepCast(const GPUSparseMatrix<double>& deepCopyFrom);
+template void GPUSparseMatrix<bfloat16>::DeepCast(const GPUSparseMatrix<half>& deepCopyFrom);
+template void GPUSparseMatrix<bfloat16>::DeepCast(const GPUSparseMatrix<bfloat16>& deepCopyFrom);
 
 
 // instantiate learner methods
 template void GPUSparseMatrix<float>::AdaDelta<float>(GPUMatrix<float>&c, GPUMatrix<float>&functionValues, float learningRate, float rho, float epsilon, int* timestamps, int currentTimestamp);
 template void GPUSparseMatrix<double>::AdaDelta<double>(GPUMatrix<double>&c, GPUMatrix<double>&functionValues, double learningRate, double rho, double epsilon, int* timestamps, int currentTimestamp);
 template void GPUSparseMatrix<half>::AdaDelta<float>(GPUMatrix<float>&c, GPUMatrix<float>&functionValues, float learningRate, float rho, float epsilon, int* timestamps, int currentTimestamp);
+template void GPUSparseMatrix<bfloat16>::AdaDelta<float>(GPUMatrix<float>&c, GPUMatrix<float>&functionValues, float learningRate, float rho, float epsilon, int* timestamps, int currentTimestamp);
 
 // We use Matrix<char> as the backing store for QuantizedMatrix
 // Let's explicitly instantiate the methods we need for that purpose
@@ -3217,6 +3400,7 @@ MATH_API File& operator>>(File& stream, GPUSparseMatrix<ElemType>& us)
 template MATH_API File& operator>>(File& stream, GPUSparseMatrix<float>& us);
 template MATH_API File& operator>>(File& stream, GPUSparseMatrix<double>& us);
 template MATH_API File& operator>>(File& stream, GPUSparseMatrix<half>& us);
+template MATH_API File& operator>>(File& stream, GPUSparseMatrix<bfloat16>& us);
 
 template <class ElemType>
 MATH_API File& operator<<(File& stream, const GPUSparseMatrix<ElemType>& us)
@@ -3276,6 +3460,7 @@ MATH_API File& operator<<(File& stream, const GPUSparseMatrix<ElemType>& us)
 template MATH_API File& operator<<(File& stream, const GPUSparseMatrix<float>& us);
 template MATH_API File& operator<<(File& stream, const GPUSparseMatrix<double>& us);
 template MATH_API File& operator<<(File& stream, const GPUSparseMatrix<half>& us);
+template MATH_API File& operator<<(File& stream, const GPUSparseMatrix<bfloat16>& us);
 
 
 }}}
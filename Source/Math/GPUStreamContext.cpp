@@ -0,0 +1,85 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// GPUStreamContext.cpp -- a stream of a device with a priority, on which a thread issues all of its GPU work
+//
+#include "stdafx.h"
+#include "GPUStreamContext.h"
+#include "GPUMatrix.h"
+#include <cuda_runtime.h>
+#include <cublas_v2.h>
+#include <cusparse.h>
+
+#pragma comment(lib, "cudart.lib")
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+void PrepareDevice(DEVICEID_TYPE deviceId);
+
+static THREAD_LOCAL GPUStreamContext* t_currentContext = nullptr;
+
+GPUStreamContext::GPUStreamContext(DEVICEID_TYPE deviceId, int priority)
+    : m_deviceId(deviceId), m_priority(priority), m_stream(nullptr), m_cublasHandle(nullptr), m_cusparseHandle(nullptr),
+      m_previousContext(nullptr), m_previousStream(nullptr), m_entered(false)
+{
+    if (deviceId < 0)
+        InvalidArgument("GPUStreamContext: Requires a GPU device.");
+
+    PrepareDevice(deviceId);
+    // blocking: synchronizes with the legacy default stream; priorities out of the range of the device are clamped
+    CUDA_CALL(cudaStreamCreateWithPriority((cudaStream_t*) &m_stream, cudaStreamDefault, priority));
+    CUDA_CALL(cudaStreamGetPriority((cudaStream_t) m_stream, &m_priority));
+}
+
+GPUStreamContext::~GPUStreamContext()
+{
+    if (m_entered)
+        fprintf(stderr, "GPUStreamContext: Destroyed while it is entered.\n");
+
+    // no CUDA_CALL, since the runtime may already be shut down
+    if (m_cusparseHandle)
+        cusparseDestroy((cusparseHandle_t) m_cusparseHandle);
+    if (m_cublasHandle)
+        cublasDestroy((cublasHandle_t) m_cublasHandle);
+    m_cudnn.reset(); // engines that were created in the context may still hold the handle
+    cudaStreamSynchronize((cudaStream_t) m_stream);
+    cudaStreamDestroy((cudaStream_t) m_stream);
+}
+
+/*static*/ void GPUStreamContext::GetPriorityRange(DEVICEID_TYPE deviceId, int& lowest, int& highest)
+{
+    PrepareDevice(deviceId);
+    CUDA_CALL(cudaDeviceGetStreamPriorityRange(&lowest, &highest));
+}
+
+/*static*/ GPUStreamContext* GPUStreamContext::Current()
+{
+    return t_currentContext;
+}
+
+void GPUStreamContext::Enter()
+{
+    if (m_entered)
+        LogicError("GPUStreamContext::Enter: The context is already entered.");
+
+    PrepareDevice(m_deviceId);
+    m_previousContext = t_currentContext;
+    m_previousStream = ::GetStream();
+    t_currentContext = this;
+    ::SetStream((cudaStream_t) m_stream);
+    m_entered = true;
+}
+
+void GPUStreamContext::Exit()
+{
+    if (!m_entered || t_currentContext != this)
+        LogicError("GPUStreamContext::Exit: The context is not the one entered last on this thread.");
+
+    ::SetStream((cudaStream_t) m_previousStream);
+    t_currentContext = m_previousContext;
+    m_previousContext = nullptr;
+    m_entered = false;
+}
+
+}}}
@@ -0,0 +1,85 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// GPUStreamContext.h -- a stream of a device with a priority, on which a thread issues all of its GPU work
+//
+#pragma once
+
+#include "CommonMatrix.h"
+#include <memory>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// GPUStreamContext -- a stream of its own with a priority, for a thread that shares the device with other work.
+//
+// While a context is entered on a thread (Enter()/Exit(), or GPUStreamContextScope), the GPU routines of that thread
+// are issued on the stream of the context (see GetStream()), and cuBLAS, cuSPARSE and cuDNN use handles of the
+// context that are bound to it; the caching allocator hands out blocks for that stream. The kernels of a stream of
+// a higher priority are scheduled ahead of the pending kernels of streams of a lower priority, so a context of a
+// high priority preempts the work of the others at kernel granularity.
+//
+// The stream is blocking, i.e. it synchronizes with the legacy default stream, so that the synchronous copies that
+// many routines issue there remain correct; the copies of dense matrices between host and device are issued on the
+// stream itself. The streams of a GPUStreamPool and the CUDA graphs (see GPUGraph) of the thread follow the context.
+// A context is used by one thread at a time; cuDNN engines created in it keep its handle.
+// -----------------------------------------------------------------------
+
+class MATH_API GPUStreamContext
+{
+public:
+    // 'priority' as by cudaStreamCreateWithPriority(): lower numbers are higher priorities, see GetPriorityRange()
+    GPUStreamContext(DEVICEID_TYPE deviceId, int priority);
+    ~GPUStreamContext();
+
+    // the priorities of the streams of a device, 'lowest' being that of the default stream
+    static void GetPriorityRange(DEVICEID_TYPE deviceId, int& lowest, int& highest);
+
+    // the context entered on the calling thread, or nullptr
+    static GPUStreamContext* Current();
+
+    DEVICEID_TYPE GetDeviceId() const { return m_deviceId; }
+    int GetPriority() const { return m_priority; }
+    void* GetStream() const { return m_stream; } // cudaStream_t
+
+    void Enter();
+    void Exit();
+
+    // the handles of the context, created on first use by GPUMatrix, GPUSparseMatrix and CuDnn
+    void*& CublasHandle() { return m_cublasHandle; }         // cublasHandle_t
+    void*& CusparseHandle() { return m_cusparseHandle; }     // cusparseHandle_t
+    std::shared_ptr<void>& CuDnnHandle() { return m_cudnn; } // CuDnn::ptr_t
+
+private:
+    GPUStreamContext(const GPUStreamContext&) = delete;
+    GPUStreamContext& operator=(const GPUStreamContext&) = delete;
+
+    DEVICEID_TYPE m_deviceId;
+    int m_priority;
+    void* m_stream;
+    void* m_cublasHandle;
+    void* m_cusparseHandle;
+    std::shared_ptr<void> m_cudnn;
+
+    // restored by Exit()
+    GPUStreamContext* m_previousContext;
+    void* m_previousStream;
+    bool m_entered;
+};
+
+// enters a GPUStreamContext on the calling thread for the lifetime of the object
+class GPUStreamContextScope
+{
+public:
+    GPUStreamContextScope(GPUStreamContext& context) : m_context(context) { m_context.Enter(); }
+    ~GPUStreamContextScope() { m_context.Exit(); }
+
+private:
+    GPUStreamContextScope(const GPUStreamContextScope&) = delete;
+    GPUStreamContextScope& operator=(const GPUStreamContextScope&) = delete;
+
+    GPUStreamContext& m_context;
+};
+
+}}}
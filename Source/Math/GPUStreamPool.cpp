@@ -0,0 +1,104 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// GPUStreamPool.cpp -- a few streams of a device on which independent GPU work is issued concurrently
+//
+#include "stdafx.h"
+#include "GPUStreamPool.h"
+#include "GPUMatrix.h"
+#include "CuDnnCommon.h"
+#include "GPUStreamContext.h"
+#include <cuda_runtime.h>
+
+#pragma comment(lib, "cudart.lib")
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+void PrepareDevice(DEVICEID_TYPE deviceId);
+
+GPUStreamPool::GPUStreamPool(DEVICEID_TYPE deviceId, size_t numStreams, size_t numEvents)
+    : m_deviceId(deviceId), m_streams(numStreams, nullptr), m_joinEvents(numStreams, nullptr), m_events(numEvents, nullptr), m_selected(0), m_active(false)
+{
+    if (deviceId < 0 || numStreams == 0)
+        InvalidArgument("GPUStreamPool: Requires a GPU device and at least one stream.");
+
+    // in a GPUStreamContext, the streams have the priority of the context
+    GPUStreamContext* context = GPUStreamContext::Current();
+    int priority = (context && context->GetDeviceId() == deviceId) ? context->GetPriority() : 0;
+
+    PrepareDevice(deviceId);
+    for (size_t i = 1; i < numStreams; i++)
+        CUDA_CALL(cudaStreamCreateWithPriority((cudaStream_t*) &m_streams[i], cudaStreamDefault, priority)); // blocking: synchronizes with the legacy default stream
+    for (auto& event : m_joinEvents)
+        CUDA_CALL(cudaEventCreateWithFlags((cudaEvent_t*) &event, cudaEventDisableTiming));
+    for (auto& event : m_events)
+        CUDA_CALL(cudaEventCreateWithFlags((cudaEvent_t*) &event, cudaEventDisableTiming));
+}
+
+GPUStreamPool::~GPUStreamPool()
+{
+    // no CUDA_CALL, since the runtime may already be shut down
+    for (auto event : m_events)
+        cudaEventDestroy((cudaEvent_t) event);
+    for (auto event : m_joinEvents)
+        cudaEventDestroy((cudaEvent_t) event);
+    for (size_t i = 1; i < m_streams.size(); i++)
+        cudaStreamDestroy((cudaStream_t) m_streams[i]);
+}
+
+void GPUStreamPool::Begin()
+{
+    if (m_active)
+        LogicError("GPUStreamPool::Begin: Called twice without End().");
+
+    PrepareDevice(m_deviceId);
+    m_streams[0] = GetStream();
+    CUDA_CALL(cudaEventRecord((cudaEvent_t) m_joinEvents[0], (cudaStream_t) m_streams[0]));
+    for (size_t i = 1; i < m_streams.size(); i++)
+        CUDA_CALL(cudaStreamWaitEvent((cudaStream_t) m_streams[i], (cudaEvent_t) m_joinEvents[0], 0));
+    m_selected = 0;
+    m_active = true;
+}
+
+void GPUStreamPool::Select(size_t stream)
+{
+    if (!m_active || stream >= m_streams.size())
+        LogicError("GPUStreamPool::Select: Invalid stream %d, or called outside of Begin() and End().", (int) stream);
+    if (stream == m_selected)
+        return;
+
+    SetStream((cudaStream_t) m_streams[stream]);
+    CUDNN_CALL(cudnnSetStream(*CuDnn::Instance(), (cudaStream_t) m_streams[stream]));
+    m_selected = stream;
+}
+
+void GPUStreamPool::RecordEvent(size_t event)
+{
+    if (!m_active || event >= m_events.size())
+        LogicError("GPUStreamPool::RecordEvent: Invalid event %d, or called outside of Begin() and End().", (int) event);
+    CUDA_CALL(cudaEventRecord((cudaEvent_t) m_events[event], (cudaStream_t) m_streams[m_selected]));
+}
+
+void GPUStreamPool::WaitEvent(size_t event)
+{
+    if (!m_active || event >= m_events.size())
+        LogicError("GPUStreamPool::WaitEvent: Invalid event %d, or called outside of Begin() and End().", (int) event);
+    CUDA_CALL(cudaStreamWaitEvent((cudaStream_t) m_streams[m_selected], (cudaEvent_t) m_events[event], 0));
+}
+
+void GPUStreamPool::End()
+{
+    if (!m_active)
+        LogicError("GPUStreamPool::End: Called without Begin().");
+
+    Select(0);
+    m_active = false; // also if one of the calls below fails, e.g. while unwinding from a failed node
+    for (size_t i = 1; i < m_streams.size(); i++)
+    {
+        CUDA_CALL(cudaEventRecord((cudaEvent_t) m_joinEvents[i], (cudaStream_t) m_streams[i]));
+        CUDA_CALL(cudaStreamWaitEvent((cudaStream_t) m_streams[0], (cudaEvent_t) m_joinEvents[i], 0));
+    }
+}
+
+}}}
@@ -0,0 +1,55 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// GPUStreamPool.h -- a few streams of a device on which independent GPU work is issued concurrently
+//
+#pragma once
+
+#include "CommonMatrix.h"
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// GPUStreamPool -- streams and events for running independent pieces of GPU work side by side.
+//
+// Begin() forks: the streams of the pool wait for all work issued so far on the current stream (see GetStream()),
+// which is stream 0 of the pool. Select() then redirects the GPU routines and cuDNN to one of the streams, and
+// RecordEvent()/WaitEvent() let the selected stream wait for a point in the work of another one. End() joins: the
+// current stream waits for the work of all streams, and the GPU routines are redirected back to it.
+//
+// The streams are blocking, i.e. they synchronize with the legacy default stream, so work that is issued on it
+// (e.g. a synchronous copy) remains correct, it only serializes. CUDA graph capture (see GPUGraph) follows the
+// fork and the join, so that the streams of the pool may also be used while recording.
+// -----------------------------------------------------------------------
+
+class MATH_API GPUStreamPool
+{
+public:
+    GPUStreamPool(DEVICEID_TYPE deviceId, size_t numStreams, size_t numEvents);
+    ~GPUStreamPool();
+
+    DEVICEID_TYPE GetDeviceId() const { return m_deviceId; }
+    size_t GetNumStreams() const { return m_streams.size(); }
+    size_t GetNumEvents() const { return m_events.size(); }
+
+    void Begin();
+    void Select(size_t stream);
+    void RecordEvent(size_t event); // on the selected stream
+    void WaitEvent(size_t event);   // the selected stream waits for the work before the last RecordEvent()
+    void End();
+
+private:
+    GPUStreamPool(const GPUStreamPool&) = delete;
+    GPUStreamPool& operator=(const GPUStreamPool&) = delete;
+
+    DEVICEID_TYPE m_deviceId;
+    std::vector<void*> m_streams;    // cudaStream_t; [0] is the current stream at the time of Begin()
+    std::vector<void*> m_joinEvents; // cudaEvent_t; [0] is the fork event
+    std::vector<void*> m_events;     // cudaEvent_t
+    size_t m_selected;
+    bool m_active;
+};
+
+}}}
@@ -37,11 +37,8 @@
 #pragma warning(disable : 4127) // conditional expression is constant; "if (sizeof(ElemType)==sizeof(float))" triggers this
 #pragma warning(disable : 4702) // unreachable code; triggered for unknown reasons
 
-#ifdef _WIN32
 // thread local storage to access the current stream, initalize to default stream
-__declspec(thread)
-#endif
-extern cudaStream_t t_stream;
+extern THREAD_LOCAL cudaStream_t t_stream;
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -123,6 +120,9 @@ struct FixedArray
                 InvalidArgument("FixedArray: Dimensions out of range, too few bits.");
         }
     }
+    __device__ __host__ FixedArray() // uninitialized, for filling in inside a kernel
+    {
+    }
 };
 template <typename T> // specialized version for 0 elements
 struct FixedArray<T, 0>
@@ -1181,6 +1181,225 @@ void LaunchUnaryTensorOp(ElemType beta, const ElemType* pa, ElemType* pb, ElemTy
     }
 }
 
+// -----------------------------------------------------------------------
+// elementwise programs: a tree of elementwise operations in one kernel
+// -----------------------------------------------------------------------
+
+// the inputs of an ElementwiseProgram, passed to the kernel by value
+template <class ElemType>
+struct ElementwiseProgramInputs
+{
+    const ElemType* pointers[ElementwiseProgram::MaxInputs];
+    CUDA_LONG numElements[ElementwiseProgram::MaxInputs];
+};
+
+// One thread per element. The intermediate results never leave the thread.
+template <class ElemType>
+__global__ void _launchElementwiseProgram(ElemType beta, const ElementwiseProgramInputs<ElemType> inputs, ElemType* pout, ElemType alpha,
+                                          const ElementwiseProgram program, CUDA_LONG numRows, CUDA_LONG numElements)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    CUDA_LONG id = GridDim::GetLinearThreadId();
+    if (id >= numElements)
+        return;
+    comp_t registers[ElementwiseProgram::MaxInputs + ElementwiseProgram::MaxInstructions];
+    for (CUDA_LONG i = 0; i < program.numInputs; i++)
+    {
+        CUDA_LONG n = inputs.numElements[i];
+        registers[i] = inputs.pointers[i][n == numElements ? id : n == numRows ? id % numRows : 0];
+    }
+    for (CUDA_LONG i = 0; i < program.numInstructions; i++)
+    {
+        const auto& instruction = program.instructions[i];
+        registers[program.numInputs + i] = OpElementwiseInstruction<comp_t>(instruction.op, registers[instruction.args[0]], registers[instruction.args[1]], registers[instruction.args[2]]);
+    }
+    comp_t val = registers[program.numInputs + program.numInstructions - 1] * (comp_t)alpha;
+    if (beta != 0)
+        val += (comp_t)beta * (comp_t)pout[id];
+    pout[id] = val;
+}
+
+template <class ElemType>
+void LaunchElementwiseProgram(ElemType beta, const std::vector<const ElemType*>& inputs, const std::vector<size_t>& inputSizes, ElemType* pout, ElemType alpha,
+                              const ElementwiseProgram& program, size_t numRows, size_t numElements)
+{
+    if (numElements == 0)
+        return;
+    ElementwiseProgramInputs<ElemType> kernelInputs = {};
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        kernelInputs.pointers[i] = inputs[i];
+        kernelInputs.numElements[i] = (CUDA_LONG)inputSizes[i];
+    }
+    CUDA_LONG NN = (CUDA_LONG)numElements;
+    SyncGuard syncGuard;
+    GridDim grid(NN);
+    _launchElementwiseProgram<ElemType><<<grid.m_blocksPerGrid, grid.m_threadsPerBlock, 0, t_stream>>>(beta, kernelInputs, pout, alpha, program, (CUDA_LONG)numRows, NN);
+}
+
+// -----------------------------------------------------------------------
+// kernels and launch  --common shapes without reduction
+// -----------------------------------------------------------------------
+
+// _launchTensorOp() maps each thread index back to K tensor indices with fast_divmod, and then multiplies them with strides
+// only known at runtime. Most tensor ops without reduction are however either elementwise over gap-free memory, maybe with
+// scalars broadcast, or matrices with inputs broadcast along rows or columns, like a bias. These get their own kernels.
+
+// rank 1: the output is gap-free, each input is either gap-free (stride 1) or a broadcast scalar (stride 0)
+template <class ElemType, C_size_t N>
+__global__ void _launchLinearTensorOp(ElemType beta, FixedArray<ElemType*, N> pointers, ElemType alpha, ElementWiseOperator op,
+                                      FixedArray<C_int, N> strides, CUDA_LONG numElements)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    CUDA_LONG id = GridDim::GetLinearThreadId();
+    if (id >= numElements)
+        return;
+    #pragma unroll
+    for (C_size_t i = 0; i < N; i++)
+        pointers[i] += id * strides[i];
+    comp_t val = TensorOps<ElemType>::Compute(pointers, op);
+    val *= (comp_t)alpha;
+    auto* pout = pointers[N - 1];
+    if (beta != 0)
+        val += (comp_t)beta * (comp_t)*pout;
+    *pout = val;
+}
+
+// rank 1 with all arguments gap-free and aligned: each thread loads and stores one VectorType (e.g. a float4) per argument
+template <class ElemType, C_size_t N, class VectorType>
+__global__ void _launchVectorizedTensorOp(ElemType beta, FixedArray<ElemType*, N> pointers, ElemType alpha, ElementWiseOperator op, CUDA_LONG numVectors)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    const C_size_t vectorElements = sizeof(VectorType) / sizeof(ElemType);
+    CUDA_LONG id = GridDim::GetLinearThreadId();
+    if (id >= numVectors)
+        return;
+    VectorType vectors[N];
+    #pragma unroll
+    for (C_size_t i = 0; i + 1 < N; i++)
+        vectors[i] = reinterpret_cast<const VectorType*>(pointers[i])[id];
+    if (beta != 0)
+        vectors[N - 1] = reinterpret_cast<const VectorType*>(pointers[N - 1])[id];
+    #pragma unroll
+    for (C_size_t j = 0; j < vectorElements; j++)
+    {
+        FixedArray<ElemType*, N> elements; // the j-th elements of the loaded vectors
+        #pragma unroll
+        for (C_size_t i = 0; i < N; i++)
+            elements[i] = reinterpret_cast<ElemType*>(&vectors[i]) + j;
+        comp_t val = TensorOps<ElemType>::Compute(elements, op);
+        val *= (comp_t)alpha;
+        if (beta != 0)
+            val += (comp_t)beta * (comp_t)*elements[N - 1];
+        *elements[N - 1] = val;
+    }
+    reinterpret_cast<VectorType*>(pointers[N - 1])[id] = vectors[N - 1];
+}
+
+// rank 2: threads go along the rows and blocks along the columns, so that no thread has to divide to find its coordinates
+template <class ElemType, C_size_t N>
+__global__ void _launchRank2TensorOp(ElemType beta, FixedArray<ElemType*, N> pointers, ElemType alpha, ElementWiseOperator op,
+                                     FixedMatrix<C_int, N, 2> strides, CUDA_LONG rows, CUDA_LONG cols)
+{
+    typedef typename TypeSelector<ElemType>::comp_t comp_t;
+    CUDA_LONG row = GridDim::GetLinearThreadId();
+    if (row >= rows)
+        return;
+    #pragma unroll
+    for (C_size_t i = 0; i < N; i++)
+        pointers[i] += row * strides(i, 0);
+    for (CUDA_LONG col = blockIdx.y; col < cols; col += gridDim.y)
+    {
+        FixedArray<ElemType*, N> elements;
+        #pragma unroll
+        for (C_size_t i = 0; i < N; i++)
+            elements[i] = pointers[i] + col * strides(i, 1);
+        comp_t val = TensorOps<ElemType>::Compute(elements, op);
+        val *= (comp_t)alpha;
+        auto* pout = elements[N - 1];
+        if (beta != 0)
+            val += (comp_t)beta * (comp_t)*pout;
+        *pout = val;
+    }
+}
+
+// Classifies the shape of a tensor op without reduction, and launches the kernel specialized on it.
+// Returns false if the shape is none of the above; then the general kernel must be used.
+template <class ElemType, C_size_t N>
+static bool LaunchTensorOpForCommonShape(ElemType beta, const array<ElemType*, N>& pointerVector, ElemType alpha, ElementWiseOperator op,
+                                         const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrides)
+{
+    size_t numElements = 1;
+    for (auto dim : regularOpDims)
+        numElements *= dim;
+    if (numElements == 0 || numElements > INT_MAX)
+        return false;
+
+    if (regularOpDims.size() == 1)
+    {
+        bool isLinear = regularStrides[N - 1][0] == 1;
+        bool isGapFree = isLinear;
+        for (C_size_t i = 0; i + 1 < N; i++)
+        {
+            isLinear  &= regularStrides[i][0] == 0 || regularStrides[i][0] == 1;
+            isGapFree &= regularStrides[i][0] == 1;
+        }
+        if (!isLinear)
+            return false;
+
+        // as many elements as possible as whole vectors, if all arguments start at a vector boundary
+        size_t begin = 0;
+        const size_t vectorElements = sizeof(float4) / sizeof(ElemType);
+        bool isAligned = isGapFree;
+        for (auto* p : pointerVector)
+            isAligned &= reinterpret_cast<size_t>(p) % sizeof(float4) == 0;
+        if (isAligned && numElements >= vectorElements)
+        {
+            CUDA_LONG numVectors = (CUDA_LONG)(numElements / vectorElements);
+            SyncGuard syncGuard;
+            GridDim grid(numVectors);
+            _launchVectorizedTensorOp<ElemType, N, float4><<<grid.m_blocksPerGrid, grid.m_threadsPerBlock, 0, t_stream>>>(beta, FixedArray<ElemType*, N>(pointerVector), alpha, op, numVectors);
+            begin = numVectors * vectorElements;
+        }
+
+        // the rest element by element
+        if (begin < numElements)
+        {
+            array<ElemType*, N> pointers = pointerVector;
+            array<C_int, N> strides;
+            for (C_size_t i = 0; i < N; i++)
+            {
+                strides[i] = (C_int)regularStrides[i][0];
+                pointers[i] += begin * strides[i];
+            }
+            CUDA_LONG NN = (CUDA_LONG)(numElements - begin);
+            SyncGuard syncGuard;
+            GridDim grid(NN);
+            _launchLinearTensorOp<ElemType, N><<<grid.m_blocksPerGrid, grid.m_threadsPerBlock, 0, t_stream>>>(beta, FixedArray<ElemType*, N>(pointers), alpha, op, FixedArray<C_int, N>(strides), NN);
+        }
+        return true;
+    }
+
+    // Threads along the rows only pay off with at least a warp of them, and reading and writing coalesced.
+    if (regularOpDims.size() == 2 && regularOpDims[0] >= 32 && regularStrides[N - 1][0] == 1)
+    {
+        for (C_size_t i = 0; i + 1 < N; i++)
+        {
+            if (regularStrides[i][0] != 0 && regularStrides[i][0] != 1)
+                return false;
+        }
+        CUDA_LONG rows = (CUDA_LONG)regularOpDims[0];
+        CUDA_LONG cols = (CUDA_LONG)regularOpDims[1];
+        CUDA_LONG threadsPerBlock = std::min(CeilDiv(rows, (CUDA_LONG)32) * 32, (CUDA_LONG)GridDim::maxThreadsPerBlock);
+        dim3 blocksPerGrid(CeilDiv(rows, threadsPerBlock), std::min(cols, (CUDA_LONG)65535));
+        SyncGuard syncGuard;
+        _launchRank2TensorOp<ElemType, N><<<blocksPerGrid, threadsPerBlock, 0, t_stream>>>(beta, FixedArray<ElemType*, N>(pointerVector), alpha, op, FixedMatrix<C_int, N, 2>(regularStrides), rows, cols);
+        return true;
+    }
+
+    return false;
+}
+
 // -----------------------------------------------------------------------
 // map runtime parameters N to template parameters
 // -----------------------------------------------------------------------
@@ -1215,6 +1434,13 @@ void TensorOpN(ElemType beta, array<ElemType*, N> pointers, ElemType alpha, Elem
 {
     for (C_size_t i = 0; i < N; i++) // N = a small constant, this will be unrolled
         pointers[i] += offsets[i];
+
+    // special case: common shapes without reduction get kernels without the general index arithmetic
+    if (reducingOpDims.size() == 0 &&
+        reductionOp != ElementWiseOperator::opArgmax && reductionOp != ElementWiseOperator::opArgmin &&
+        LaunchTensorOpForCommonShape<ElemType, N>(beta, pointers, alpha, op, regularOpDims, regularStrides))
+        return;
+
     size_t dims = regularOpDims.size();
     switch (dims)
     {
@@ -1276,11 +1502,33 @@ template void TensorOpN<half, 4>(half beta, array<half*, 4> pointers, half alpha
                                   const array<size_t, 4>& offsets,
                                   const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 4>& regularStrides,
                                   const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 4>& reducingStrides);
+template void TensorOpN<bfloat16, 2>(bfloat16 beta, array<bfloat16*, 2> pointers, bfloat16 alpha, ElementWiseOperator op, ElementWiseOperator reductionOp,
+                                      const array<size_t, 2>& offsets,
+                                      const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 2>& regularStrides,
+                                      const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 2>& reducingStrides);
+template void TensorOpN<bfloat16, 3>(bfloat16 beta, array<bfloat16*, 3> pointers, bfloat16 alpha, ElementWiseOperator op, ElementWiseOperator reductionOp,
+                                      const array<size_t, 3>& offsets,
+                                      const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 3>& regularStrides,
+                                      const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 3>& reducingStrides);
+template void TensorOpN<bfloat16, 4>(bfloat16 beta, array<bfloat16*, 4> pointers, bfloat16 alpha, ElementWiseOperator op, ElementWiseOperator reductionOp,
+                                      const array<size_t, 4>& offsets,
+                                      const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 4>& regularStrides,
+                                      const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 4>& reducingStrides);
 
 
 template void LaunchUnaryTensorOp(float beta, const float* pa, float* pb, float alpha, ElementWiseOperator op, size_t regularOpDim);
 template void LaunchUnaryTensorOp(double beta, const double* pa, double* pb, double alpha, ElementWiseOperator op, size_t regularOpDim);
 template void LaunchUnaryTensorOp(half beta, const half* pa, half* pb, half alpha, ElementWiseOperator op, size_t regularOpDim);
+template void LaunchUnaryTensorOp(bfloat16 beta, const bfloat16* pa, bfloat16* pb, bfloat16 alpha, ElementWiseOperator op, size_t regularOpDim);
+
+template void LaunchElementwiseProgram(float beta, const std::vector<const float*>& inputs, const std::vector<size_t>& inputSizes, float* pout, float alpha,
+                                       const ElementwiseProgram& program, size_t numRows, size_t numElements);
+template void LaunchElementwiseProgram(double beta, const std::vector<const double*>& inputs, const std::vector<size_t>& inputSizes, double* pout, double alpha,
+                                       const ElementwiseProgram& program, size_t numRows, size_t numElements);
+template void LaunchElementwiseProgram(half beta, const std::vector<const half*>& inputs, const std::vector<size_t>& inputSizes, half* pout, half alpha,
+                                       const ElementwiseProgram& program, size_t numRows, size_t numElements);
+template void LaunchElementwiseProgram(bfloat16 beta, const std::vector<const bfloat16*>& inputs, const std::vector<size_t>& inputSizes, bfloat16* pout, bfloat16 alpha,
+                                       const ElementwiseProgram& program, size_t numRows, size_t numElements);
 
 }}}
 
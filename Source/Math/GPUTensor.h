@@ -8,6 +8,7 @@
 #include "TensorShape.h" // only for SmallVector; I was hoping to keep this out
 #include "GPUMatrixCUDAKernels.cuh"
 #include <array>
+#include <vector>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -26,4 +27,10 @@ void TensorOpN(ElemType beta, array<ElemType*, N> pointers, ElemType alpha, Elem
 template <class ElemType>
 void LaunchUnaryTensorOp(ElemType beta, const ElemType* pa, ElemType* pb, ElemType alpha, ElementWiseOperator op, size_t regularOpDim);
 
+// evaluates an ElementwiseProgram (CommonMatrix.h) into pout, one element per thread; input i has inputSizes[i] elements,
+// which is numElements, numRows (broadcast over the columns) or 1
+template <class ElemType>
+void LaunchElementwiseProgram(ElemType beta, const std::vector<const ElemType*>& inputs, const std::vector<size_t>& inputSizes, ElemType* pout, ElemType alpha,
+                              const ElementwiseProgram& program, size_t numRows, size_t numElements);
+
 }}}
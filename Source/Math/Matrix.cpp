@@ -159,6 +159,52 @@ int GetMathLibTraceLevel()
     return m_mathLibTraceLevel.load();
 }
 
+static std::atomic<uint64_t> s_numMatrixStorageAllocations(0);
+
+void CountMatrixStorageAllocation()
+{
+    s_numMatrixStorageAllocations++;
+}
+
+uint64_t GetNumMatrixStorageAllocations()
+{
+    return s_numMatrixStorageAllocations.load();
+}
+
+const wchar_t* GPUMemoryCategoryName(GPUMemoryCategory category)
+{
+    // the order must match enum
+    static const wchar_t* names[(int)GPUMemoryCategory::Count] =
+    {
+        L"other",
+        L"parameters",
+        L"gradients",
+        L"activations",
+        L"workspace",
+        L"readerBuffers",
+    };
+    if ((int)category < 0 || category >= GPUMemoryCategory::Count)
+        LogicError("GPUMemoryCategoryName: Invalid category %d.", (int)category);
+    return names[(int)category];
+}
+
+static THREAD_LOCAL GPUMemoryCategory s_currentGPUMemoryCategory = GPUMemoryCategory::Other;
+
+GPUMemoryCategoryScope::GPUMemoryCategoryScope(GPUMemoryCategory category) : m_previous(s_currentGPUMemoryCategory)
+{
+    s_currentGPUMemoryCategory = category;
+}
+
+GPUMemoryCategoryScope::~GPUMemoryCategoryScope()
+{
+    s_currentGPUMemoryCategory = m_previous;
+}
+
+/*static*/ GPUMemoryCategory GPUMemoryCategoryScope::Current()
+{
+    return s_currentGPUMemoryCategory;
+}
+
 MatrixBase::~MatrixBase() { }
 
 #pragma region Constructors, destructors and other static matrix builders
@@ -1093,6 +1139,43 @@ Matrix<ElemType>& Matrix<ElemType>::DoGatherColumnsOf(ElemType beta, const Matri
     return *this;
 }
 
+// *this[:,j] = codes[:,idx[j]] * scalesAndOffsets(0,idx[j]) + scalesAndOffsets(1,idx[j])
+// The table stays quantized on its device; only the gathered columns are dequantized, as they are read.
+// Invalid entries (gap columns) are denoted by idx(0,j) == -1 and give columns of 0.
+template <class ElemType>
+template <class QuantizedType>
+Matrix<ElemType>& Matrix<ElemType>::AssignDequantizedColumns(const Matrix<ElemType>& idx, const Matrix<QuantizedType>& codes, const Matrix<ElemType>& scalesAndOffsets)
+{
+    if (codes.GetMatrixType() != DENSE || idx.GetMatrixType() != DENSE || scalesAndOffsets.GetMatrixType() != DENSE)
+        NOT_IMPLEMENTED;
+
+    // the table decides the device, since it is the largest and is not moved
+    idx.TransferToDeviceIfNotThere(codes.GetDeviceId(), true);
+    scalesAndOffsets.TransferToDeviceIfNotThere(codes.GetDeviceId(), true);
+    TransferToDeviceIfNotThere(codes.GetDeviceId(), true);
+    SwitchToMatrixType(DENSE, matrixFormatDense, false);
+
+    DISPATCH_MATRIX_ON_FLAG(&codes, this,
+        { m_CPUMatrix->AssignDequantizedColumnsOf(*idx.m_CPUMatrix, *codes.m_CPUMatrix, *scalesAndOffsets.m_CPUMatrix); },
+        { m_GPUMatrix->AssignDequantizedColumnsOf(*idx.m_GPUMatrix, *codes.m_GPUMatrix, *scalesAndOffsets.m_GPUMatrix); },
+        { NOT_IMPLEMENTED; },
+        { NOT_IMPLEMENTED; });
+
+    return *this;
+}
+
+template <class ElemType>
+Matrix<ElemType>& Matrix<ElemType>::AssignDequantizedColumnsOf(const Matrix<ElemType>& idx, const Matrix<char>& codes, const Matrix<ElemType>& scalesAndOffsets)
+{
+    return AssignDequantizedColumns(idx, codes, scalesAndOffsets);
+}
+
+template <class ElemType>
+Matrix<ElemType>& Matrix<ElemType>::AssignDequantizedColumnsOf(const Matrix<ElemType>& idx, const Matrix<half>& codes, const Matrix<ElemType>& scalesAndOffsets)
+{
+    return AssignDequantizedColumns(idx, codes, scalesAndOffsets);
+}
+
 // *this[:,idx[j]] = a[:,j] * alpha + *this[:,idx[j]] * beta
 // idx has width of 'a' and contains values w.r.t. 'this'
 // Unlike gather, for scatter, 'this' must have been sized already.
@@ -1127,6 +1210,47 @@ Matrix<ElemType>& Matrix<ElemType>::DoScatterColumnsOf(ElemType beta, const Matr
     return *this;
 }
 
+// Segmented reduction over the columns of a packed minibatch, e.g. over the sequences of an MBLayout.
+// Column j of 'segments' describes segment j: segments(0,j) is its first column in 'a', segments(1,j) its length.
+// The columns of segment j are a[:,first + k * columnStride] for 0 <= k < length.
+//   *this[:,j] = reduce_k a[:,first + k * columnStride]
+// reductionOp is one of opSum, opLogSum, opMin and opMax. With 'average', sums are divided by the segment length.
+// Empty segments reduce to 0. All segments are reduced by a single kernel launch.
+template <class ElemType>
+Matrix<ElemType>& Matrix<ElemType>::AssignSegmentedReductionOf(const Matrix<ElemType>& a, const Matrix<ElemType>& segments, size_t columnStride, ElementWiseOperator reductionOp, bool average)
+{
+    DecideAndMoveToRightDevice(a, segments, *this);
+    SwitchToMatrixType(a.GetMatrixType(), a.GetFormat(), false);
+
+    DISPATCH_MATRIX_ON_FLAG(&a, this,
+        { m_CPUMatrix->AssignSegmentedReductionOf(*a.m_CPUMatrix, *segments.m_CPUMatrix, columnStride, reductionOp, average); },
+        { m_GPUMatrix->AssignSegmentedReductionOf(*a.m_GPUMatrix, *segments.m_GPUMatrix, columnStride, reductionOp, average); },
+        { NOT_IMPLEMENTED; },
+        { NOT_IMPLEMENTED; });
+
+    return *this;
+}
+
+// The gradient of AssignSegmentedReductionOf(), broadcast back to the columns of each segment:
+//   *this[:,first + k * columnStride] = beta * *this[:,first + k * columnStride] + d reduce / d input * outputGradient[:,j]
+// 'input' and 'output' are the arguments and the result of the forward reduction; they are only used for opLogSum, opMin and opMax.
+// Columns that belong to no segment (gaps) are left untouched.
+template <class ElemType>
+Matrix<ElemType>& Matrix<ElemType>::DoSegmentedReductionGradientOf(ElemType beta, const Matrix<ElemType>& outputGradient, const Matrix<ElemType>& input, const Matrix<ElemType>& output,
+                                                                   const Matrix<ElemType>& segments, size_t columnStride, ElementWiseOperator reductionOp, bool average)
+{
+    DecideAndMoveToRightDevice(*this, outputGradient, input, output);
+    DecideAndMoveToRightDevice(*this, segments);
+
+    DISPATCH_MATRIX_ON_FLAG(&outputGradient, this,
+        { m_CPUMatrix->DoSegmentedReductionGradientOf(beta, *outputGradient.m_CPUMatrix, *input.m_CPUMatrix, *output.m_CPUMatrix, *segments.m_CPUMatrix, columnStride, reductionOp, average); },
+        { m_GPUMatrix->DoSegmentedReductionGradientOf(beta, *outputGradient.m_GPUMatrix, *input.m_GPUMatrix, *output.m_GPUMatrix, *segments.m_GPUMatrix, columnStride, reductionOp, average); },
+        { NOT_IMPLEMENTED; },
+        { NOT_IMPLEMENTED; });
+
+    return *this;
+}
+
 // set all elements of a matrix to a scalar value
 // For sparse matrices, the only allowed value is 0.
 template <class ElemType>
@@ -1181,6 +1305,11 @@ template <>
     return half(nanf(""));
 }
 template <>
+/*static*/ bfloat16 Matrix<bfloat16>::MakeNan(size_t /*payload*/)
+{
+    return bfloat16(nanf(""));
+}
+template <>
 /*static*/ char Matrix<char>::MakeNan(size_t)
 {
     return 0;
@@ -1316,6 +1445,7 @@ void Matrix<ElemType>::AssignValuesOf(const Matrix<ElemType>& deepCopyFrom)
 static void DoCastAssignValuesOf(Matrix<float>&  target, const Matrix<float>&  other) { target.AssignValuesOf(other); }
 static void DoCastAssignValuesOf(Matrix<double>& target, const Matrix<double>& other) { target.AssignValuesOf(other); }
 static void DoCastAssignValuesOf(Matrix<half>& target, const Matrix<half>& other) { target.AssignValuesOf(other); }
+static void DoCastAssignValuesOf(Matrix<bfloat16>& target, const Matrix<bfloat16>& other) { target.AssignValuesOf(other); }
 template<class ElemType>
 static void CopyToVector(const Matrix<ElemType>& source, vector<ElemType>& sourceData)
 {
@@ -1347,9 +1477,9 @@ static void DoCastAssignValuesOf(Matrix<ElemType>& target, const Matrix<ElemType
     {
         CopyToVector(source, sourceData);
     }
-    // cast all values
+    // cast all values, through double since half and bfloat16 don't convert to each other directly
     vector<ElemType> targetData(sourceData.size());
-    transform(sourceData.begin(), sourceData.end(), targetData.begin(), [](ElemTypeOther v){ return (ElemType)v; });
+    transform(sourceData.begin(), sourceData.end(), targetData.begin(), [](ElemTypeOther v){ return (ElemType)(double)v; });
     // set the target
     if (target.GetMatrixType() == MatrixType::SPARSE) // if target is sparse then we cannot assign from a vector directly, but we can from a matrix object
     {
@@ -1368,8 +1498,9 @@ void Matrix<ElemType>::CastAssignValuesOf(const MatrixBase& other) /*override*/
     const Matrix<float> * otherf = dynamic_cast<const Matrix<float>*>(&other);
     const Matrix<double> * otherd = dynamic_cast<const Matrix<double>*>(&other);
     const Matrix<half> * otherh = dynamic_cast<const Matrix<half>*>(&other);
-    if (!otherf && !otherd && !otherh)
-        LogicError("CastAssignValuesOf: Only accepts float, double and half matrices.");
+    const Matrix<bfloat16> * otherb = dynamic_cast<const Matrix<bfloat16>*>(&other);
+    if (!otherf && !otherd && !otherh && !otherb)
+        LogicError("CastAssignValuesOf: Only accepts float, double, half and bfloat16 matrices.");
 
     DISPATCH_MATRIX_ON_FLAG(
         this,
@@ -1378,21 +1509,25 @@ void Matrix<ElemType>::CastAssignValuesOf(const MatrixBase& other) /*override*/
             if (otherf) DoCastAssignValuesOf(*this, *otherf);
             if (otherd) DoCastAssignValuesOf(*this, *otherd);
             if (otherh) DoCastAssignValuesOf(*this, *otherh);
+            if (otherb) DoCastAssignValuesOf(*this, *otherb);
         },
         {
             if (otherf) m_GPUMatrix->template CastAssignValuesOf<float>(otherf->m_GPUMatrix.get());
             if (otherd) m_GPUMatrix->template CastAssignValuesOf<double>(otherd->m_GPUMatrix.get());
             if (otherh) m_GPUMatrix->template CastAssignValuesOf<half>(otherh->m_GPUMatrix.get());
+            if (otherb) m_GPUMatrix->template CastAssignValuesOf<bfloat16>(otherb->m_GPUMatrix.get());
         },
         {
             if (otherf) DoCastAssignValuesOf(*this, *otherf);
             if (otherd) DoCastAssignValuesOf(*this, *otherd);
             if (otherh) DoCastAssignValuesOf(*this, *otherh);
+            if (otherb) DoCastAssignValuesOf(*this, *otherb);
         },
         {
             if (otherf) m_GPUSparseMatrix->template DeepCast<float>(*otherf->m_GPUSparseMatrix);
             if (otherd) m_GPUSparseMatrix->template DeepCast<double>(*otherd->m_GPUSparseMatrix);
             if (otherh) m_GPUSparseMatrix->template DeepCast<half>(*otherh->m_GPUSparseMatrix);
+            if (otherb) m_GPUSparseMatrix->template DeepCast<bfloat16>(*otherb->m_GPUSparseMatrix);
         });
 }
 
@@ -1451,6 +1586,64 @@ void Matrix<ElemType>::SetMatrixFromCSCFormat(const CPUSPARSE_INDEX_TYPE* h_CSCC
         { m_GPUSparseMatrix->SetMatrixFromCSCFormat(h_CSCCol, h_Row, h_Val, nz, numRows, numCols, false, -1, transferer); });
 }
 
+template <class ElemType>
+static void CopyCSCToArrays(const CPUSparseMatrix<ElemType>& us, vector<CPUSPARSE_INDEX_TYPE>& colStarts, vector<CPUSPARSE_INDEX_TYPE>& rowIndices, vector<ElemType>& values)
+{
+    size_t numCols = us.GetNumCols();
+    const CPUSPARSE_INDEX_TYPE* secondaryIndex = us.SecondaryIndexLocation();
+    colStarts.resize(numCols + 1);
+    for (size_t j = 0; j <= numCols; j++)
+        colStarts[j] = secondaryIndex[j] - secondaryIndex[0]; // a column slice starts at its first column's non-zeros
+    size_t nz = colStarts[numCols];
+    rowIndices.assign(us.MajorIndexLocation(), us.MajorIndexLocation() + nz);
+    values.assign(us.Data(), us.Data() + nz);
+}
+
+// e.g. for remapping the ids of a minibatch of one-hot inputs on the host
+template <class ElemType>
+void Matrix<ElemType>::GetMatrixFromCSCFormat(vector<CPUSPARSE_INDEX_TYPE>& colStarts, vector<CPUSPARSE_INDEX_TYPE>& rowIndices, vector<ElemType>& values) const
+{
+    if (GetMatrixType() != SPARSE || GetFormat() != matrixFormatSparseCSC)
+        LogicError("GetMatrixFromCSCFormat: The matrix must be a sparse CSC matrix.");
+
+    if (GetCurrentMatrixLocation() == CPU)
+        CopyCSCToArrays(*m_CPUSparseMatrix, colStarts, rowIndices, values);
+    else if (m_GPUSparseMatrix->GetNumNZElements() == 0) // the host copy of an empty matrix has no index
+    {
+        colStarts.assign(GetNumCols() + 1, 0);
+        rowIndices.clear();
+        values.clear();
+    }
+    else
+    {
+        CPUSparseMatrix<ElemType> hostCopy(matrixFormatSparseCSC, GetNumRows(), GetNumCols(), m_GPUSparseMatrix->GetNumNZElements());
+        m_GPUSparseMatrix->CopyToCPUSparseMatrix(hostCopy);
+        CopyCSCToArrays(hostCopy, colStarts, rowIndices, values);
+    }
+}
+
+// e.g. for exchanging the non-zero columns of an embedding gradient between workers
+template <class ElemType>
+void Matrix<ElemType>::GetMatrixFromSBCFormat(vector<size_t>& blockIds, vector<ElemType>& values) const
+{
+    if (GetMatrixType() != SPARSE || GetFormat() != matrixFormatSparseBlockCol)
+        LogicError("GetMatrixFromSBCFormat: The matrix must be a sparse block column matrix.");
+
+    if (GetCurrentMatrixLocation() == CPU)
+        m_CPUSparseMatrix->GetMatrixFromSBCFormat(blockIds, values);
+    else if (m_GPUSparseMatrix->GetNumNZElements() == 0)
+    {
+        blockIds.clear();
+        values.clear();
+    }
+    else
+    {
+        CPUSparseMatrix<ElemType> hostCopy(matrixFormatSparseBlockCol, GetNumRows(), GetNumCols(), m_GPUSparseMatrix->GetNumNZElements());
+        m_GPUSparseMatrix->CopyToCPUSparseMatrix(hostCopy);
+        hostCopy.GetMatrixFromSBCFormat(blockIds, values);
+    }
+}
+
 ///
 /// adjusts the sparse block column matrix with the new Col2BlockId
 /// For each column, if new Col2BlockId contains valid index, a corresponding block exists at the index
@@ -1677,12 +1870,16 @@ void Matrix<ElemType>::SGDUpdate(Matrix<ElemType>& gradients, ElemType learnRate
 
 // SGD update with momentum.
 // Modifies "this" parameter matrix, on which this method is invoked.
+// For sparse block column gradients, the optional per-column 'timestamps' let the smoothed gradients of the columns
+// catch up with the momentum decay of the minibatches that missed them, see NormalGrad().
 template <class ElemType>
 void Matrix<ElemType>::MomentumSGDUpdate(Matrix<ElemType>& gradients,
                                          Matrix<ElemType>& smoothedGradients,
                                          ElemType learnRatePerSample,
                                          ElemType momentum,
-                                         ElemType unitGainFactor)
+                                         ElemType unitGainFactor,
+                                         int* timestamps,
+                                         int currentTimestamp)
 {
     DecideAndMoveToRightDevice(smoothedGradients, gradients, *this);
 
@@ -1710,14 +1907,14 @@ void Matrix<ElemType>::MomentumSGDUpdate(Matrix<ElemType>& gradients,
             // 3) w_t = w_{t-1} - learnRatePerSample * g'_{t-1}
             if (momentum != 0)
             {
-                gradients.m_CPUSparseMatrix->NormalGrad(*smoothedGradients.m_CPUMatrix, momentum, unitGainFactor);
+                gradients.m_CPUSparseMatrix->NormalGrad(*smoothedGradients.m_CPUMatrix, momentum, unitGainFactor, timestamps, currentTimestamp);
             }
             ScaleAndAdd(-learnRatePerSample, gradients, *this);
         },
         {
             if (momentum != 0)
             {
-                gradients.m_GPUSparseMatrix->NormalGrad(*smoothedGradients.m_GPUMatrix, momentum, unitGainFactor);
+                gradients.m_GPUSparseMatrix->NormalGrad(*smoothedGradients.m_GPUMatrix, momentum, unitGainFactor, timestamps, currentTimestamp);
             }
             ScaleAndAdd(-learnRatePerSample, gradients, *this);
         });
@@ -1832,9 +2029,12 @@ void Matrix<ElemType>::FSAdagradUpdate(Matrix<ElemType>& gradients, Matrix<ElemT
 // smoothedCount - t 
 // meanMomentum - /beta_1 
 // varMomentum - /beta_2
+// lazySparse - for sparse block column gradients, only update the columns present in the gradients (on the CPU there is no other sparse update);
+//              the optional per-column 'timestamps' then let the moments of the columns catch up with the decay of the minibatches that missed them
 template <class ElemType>
 void Matrix<ElemType>::AdamUpdate(Matrix<ElemType>& gradients, Matrix<ElemType>& functionValues, const double smoothedCount,
-    const double learnRatePerSample, const double meanMomentum, const double varMomentum, const double epsilon, ElemType unitGainFactor, bool adamax)
+    const double learnRatePerSample, const double meanMomentum, const double varMomentum, const double epsilon, ElemType unitGainFactor, bool adamax,
+    bool lazySparse, int* timestamps, int currentTimestamp)
 {
     // Bias correction
     let biasCorrection = adamax? (ElemType)(1. / (1- pow(meanMomentum, smoothedCount))) : (ElemType)(sqrt(1- pow(varMomentum, smoothedCount))/(1- pow(meanMomentum, smoothedCount)));
@@ -1852,15 +2052,134 @@ void Matrix<ElemType>::AdamUpdate(Matrix<ElemType>& gradients, Matrix<ElemType>&
         biasCorrection, (ElemType)epsilon, unitGainFactor, adamax);
         SetDataLocation(GPU);
     },
-    { NOT_IMPLEMENTED; },
+    {
+        if (!lazySparse)
+            NOT_IMPLEMENTED;
+        gradients.m_CPUSparseMatrix->Adam(*m_CPUMatrix, *functionValues.m_CPUMatrix,
+        (ElemType)learnRatePerSample, (ElemType)meanMomentum,
+        (ElemType)varMomentum, biasCorrection, (ElemType)epsilon, unitGainFactor, adamax, timestamps, currentTimestamp);
+        SetDataLocation(CPU);
+    },
     { gradients.m_GPUSparseMatrix->Adam(*m_GPUMatrix, *functionValues.m_GPUMatrix,
         (ElemType)learnRatePerSample, (ElemType)meanMomentum,
-        (ElemType)varMomentum, biasCorrection, (ElemType)epsilon, unitGainFactor, adamax);
+        (ElemType)varMomentum, biasCorrection, (ElemType)epsilon, unitGainFactor, adamax, lazySparse, timestamps, currentTimestamp);
         SetDataLocation(GPU); });
 
     // Note: Since both 'this' and gradients are changed, we must call SetDataLocation() on 'this' as well.
 }
 
+// Applies a learner update to many dense parameters together, see MultiTensorUpdateParameters in CommonMatrix.h.
+// The smoothed gradients must be allocated by the caller (they are not resized here); the gradients are not modified.
+template <class ElemType>
+/*static*/ void Matrix<ElemType>::MultiTensorUpdate(const MultiTensorUpdateParameters<ElemType>& update, const std::vector<Matrix<ElemType>*>& parameters,
+                                                    const std::vector<const Matrix<ElemType>*>& gradients, const std::vector<Matrix<ElemType>*>& smoothedGradients)
+{
+    if (parameters.size() != gradients.size() || parameters.size() != smoothedGradients.size())
+        InvalidArgument("MultiTensorUpdate: %d parameters were passed with %d gradients and %d smoothed gradients.",
+                        (int)parameters.size(), (int)gradients.size(), (int)smoothedGradients.size());
+    if (parameters.empty())
+        return;
+
+    const size_t smoothedGradientFactor = (update.kind == MultiTensorUpdateKind::FSAdaGrad || update.kind == MultiTensorUpdateKind::Adam) ? 2 : 1;
+    const DEVICEID_TYPE deviceId = parameters.front()->GetDeviceId();
+    for (size_t i = 0; i < parameters.size(); i++)
+    {
+        if (parameters[i]->GetMatrixType() != DENSE || gradients[i]->GetMatrixType() != DENSE || smoothedGradients[i]->GetMatrixType() != DENSE)
+            InvalidArgument("MultiTensorUpdate: Sparse matrices are not supported.");
+        if (parameters[i]->GetDeviceId() != deviceId || gradients[i]->GetDeviceId() != deviceId || smoothedGradients[i]->GetDeviceId() != deviceId)
+            InvalidArgument("MultiTensorUpdate: All matrices must be on the same device.");
+        const size_t n = parameters[i]->GetNumElements();
+        if (gradients[i]->GetNumElements() != n || smoothedGradients[i]->GetNumElements() != smoothedGradientFactor * n)
+            InvalidArgument("MultiTensorUpdate: Parameter %d has %d elements, but its gradient has %d and its smoothed gradient %d (%d expected).",
+                            (int)i, (int)n, (int)gradients[i]->GetNumElements(), (int)smoothedGradients[i]->GetNumElements(), (int)(smoothedGradientFactor * n));
+    }
+
+    if (deviceId == CPUDEVICE)
+    {
+        std::vector<CPUMatrix<ElemType>*> cpuParameters, cpuSmoothedGradients;
+        std::vector<const CPUMatrix<ElemType>*> cpuGradients;
+        for (size_t i = 0; i < parameters.size(); i++)
+        {
+            cpuParameters.push_back(parameters[i]->m_CPUMatrix.get());
+            cpuGradients.push_back(gradients[i]->m_CPUMatrix.get());
+            cpuSmoothedGradients.push_back(smoothedGradients[i]->m_CPUMatrix.get());
+        }
+        CPUMatrix<ElemType>::MultiTensorUpdate(update, cpuParameters, cpuGradients, cpuSmoothedGradients);
+    }
+    else
+    {
+        std::vector<GPUMatrix<ElemType>*> gpuParameters, gpuSmoothedGradients;
+        std::vector<const GPUMatrix<ElemType>*> gpuGradients;
+        for (size_t i = 0; i < parameters.size(); i++)
+        {
+            gpuParameters.push_back(parameters[i]->m_GPUMatrix.get());
+            gpuGradients.push_back(gradients[i]->m_GPUMatrix.get());
+            gpuSmoothedGradients.push_back(smoothedGradients[i]->m_GPUMatrix.get());
+        }
+        GPUMatrix<ElemType>::MultiTensorUpdate(update, gpuParameters, gpuGradients, gpuSmoothedGradients);
+    }
+}
+
+// verifies that the matrices of MultiTensorSumOfSquares() and MultiTensorSumsOfSquares() are dense and on the same device
+template <class ElemType>
+static DEVICEID_TYPE MultiTensorDeviceId(const std::vector<const Matrix<ElemType>*>& matrices, const char* function)
+{
+    const DEVICEID_TYPE deviceId = matrices.front()->GetDeviceId();
+    for (const auto& matrix : matrices)
+    {
+        if (matrix->GetMatrixType() != DENSE)
+            InvalidArgument("%s: Sparse matrices are not supported.", function);
+        if (matrix->GetDeviceId() != deviceId)
+            InvalidArgument("%s: All matrices must be on the same device.", function);
+    }
+    return deviceId;
+}
+
+template <class ElemType>
+/*static*/ ElemType Matrix<ElemType>::MultiTensorSumOfSquares(const std::vector<const Matrix<ElemType>*>& matrices)
+{
+    if (matrices.empty())
+        return 0;
+
+    if (MultiTensorDeviceId(matrices, "MultiTensorSumOfSquares") == CPUDEVICE)
+    {
+        std::vector<const CPUMatrix<ElemType>*> cpuMatrices;
+        for (const auto& matrix : matrices)
+            cpuMatrices.push_back(matrix->m_CPUMatrix.get());
+        return CPUMatrix<ElemType>::MultiTensorSumOfSquares(cpuMatrices);
+    }
+    else
+    {
+        std::vector<const GPUMatrix<ElemType>*> gpuMatrices;
+        for (const auto& matrix : matrices)
+            gpuMatrices.push_back(matrix->m_GPUMatrix.get());
+        return GPUMatrix<ElemType>::MultiTensorSumOfSquares(gpuMatrices);
+    }
+}
+
+template <class ElemType>
+/*static*/ void Matrix<ElemType>::MultiTensorSumsOfSquares(const std::vector<const Matrix<ElemType>*>& matrices, std::vector<ElemType>& sums)
+{
+    sums.clear();
+    if (matrices.empty())
+        return;
+
+    if (MultiTensorDeviceId(matrices, "MultiTensorSumsOfSquares") == CPUDEVICE)
+    {
+        std::vector<const CPUMatrix<ElemType>*> cpuMatrices;
+        for (const auto& matrix : matrices)
+            cpuMatrices.push_back(matrix->m_CPUMatrix.get());
+        CPUMatrix<ElemType>::MultiTensorSumsOfSquares(cpuMatrices, sums);
+    }
+    else
+    {
+        std::vector<const GPUMatrix<ElemType>*> gpuMatrices;
+        for (const auto& matrix : matrices)
+            gpuMatrices.push_back(matrix->m_GPUMatrix.get());
+        GPUMatrix<ElemType>::MultiTensorSumsOfSquares(gpuMatrices, sums);
+    }
+}
+
 template <class ElemType>
 ElemType Matrix<ElemType>::RmsProp(Matrix<ElemType>& gradients,
                                    ElemType RMS_GAMMA,
@@ -1909,6 +2228,20 @@ void Matrix<ElemType>::AdaDeltaFlushState(size_t cols, ElemType rho, int* timest
     { NOT_IMPLEMENTED; });
 }
 
+// Brings the state of lazy sparse updates (see MomentumSGDUpdate() and AdamUpdate()) up to date: the first 'cols' columns are decayed
+// by 'decay' and the next 'cols' columns, if any, by 'secondDecay' for each minibatch since the timestamps of the columns, which are reset.
+template <class ElemType>
+void Matrix<ElemType>::LazyDecayFlushState(size_t cols, ElemType decay, ElemType secondDecay, int* timestamps, int currentTimestamp)
+{
+    DecideAndMoveToRightDevice(*this, *this);
+
+    DISPATCH_MATRIX_ON_FLAG(this, this,
+    { m_CPUMatrix->LazyDecayFlushTimestamps(cols, decay, secondDecay, timestamps, currentTimestamp); SetDataLocation(CPU); },
+    { m_GPUMatrix->LazyDecayFlushTimestamps(cols, decay, secondDecay, timestamps, currentTimestamp); SetDataLocation(GPU); },
+    { NOT_IMPLEMENTED; },
+    { NOT_IMPLEMENTED; });
+}
+
 template <class ElemType>
 void Matrix<ElemType>::Reshape(const size_t numRows, const size_t numCols)
 {
@@ -2974,6 +3307,25 @@ Matrix<ElemType>& Matrix<ElemType>::AssignLogSoftmaxOf(const Matrix<ElemType>& a
     return *this;
 }
 
+template <class ElemType>
+Matrix<ElemType>& Matrix<ElemType>::InplaceSegmentedLogSoftmax(const std::vector<int>& segmentOffsets)
+{
+    if (segmentOffsets.empty() || segmentOffsets.front() < 0 || segmentOffsets.back() > GetNumElements())
+        InvalidArgument("InplaceSegmentedLogSoftmax: The segments must lie within the matrix.");
+    for (size_t i = 1; i < segmentOffsets.size(); i++)
+        if (segmentOffsets[i] <= segmentOffsets[i - 1])
+            InvalidArgument("InplaceSegmentedLogSoftmax: The segments must be ascending and non-empty.");
+
+    DISPATCH_MATRIX_ON_FLAG(this,
+                            this,
+                            m_CPUMatrix->InplaceSegmentedLogSoftmax(segmentOffsets),
+                            m_GPUMatrix->InplaceSegmentedLogSoftmax(segmentOffsets),
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED);
+
+    return *this;
+}
+
 //[this]=softmax([this]) element wise
 template <class ElemType>
 Matrix<ElemType>& Matrix<ElemType>::InplaceHardmax(const bool isColWise)
@@ -3681,33 +4033,52 @@ Matrix<ElemType>& Matrix<ElemType>::AssignOneHot(const Matrix<ElemType>& a, vect
 }
 
 template <class ElemType>
-Matrix<ElemType>& Matrix<ElemType>::GatherFromTarget(const Matrix<ElemType>& indices, const Matrix<ElemType>& target, size_t row_elements)
+Matrix<ElemType>& Matrix<ElemType>::GatherFromTarget(const Matrix<ElemType>& indices, const Matrix<ElemType>& target, size_t row_elements, size_t outer_elements/* = 1*/)
 {
     if (indices.IsEmpty() || target.IsEmpty())
         LogicError("GatherFromTarget: Input matrix is empty.");
+    if (row_elements == 0 || outer_elements == 0 || target.GetNumElements() % (row_elements * outer_elements) != 0)
+        InvalidArgument("GatherFromTarget: The target of %zu elements cannot be split into %zu x N x %zu elements.", target.GetNumElements(), row_elements, outer_elements);
 
     DISPATCH_MATRIX_ON_FLAG(&indices,
                             this,
-                            m_CPUMatrix->GatherFromTarget(*indices.m_CPUMatrix, *target.m_CPUMatrix, row_elements),
-                            m_GPUMatrix->GatherFromTarget(*indices.m_GPUMatrix, *target.m_GPUMatrix, row_elements),
+                            m_CPUMatrix->GatherFromTarget(*indices.m_CPUMatrix, *target.m_CPUMatrix, row_elements, outer_elements),
+                            m_GPUMatrix->GatherFromTarget(*indices.m_GPUMatrix, *target.m_GPUMatrix, row_elements, outer_elements),
                             NOT_IMPLEMENTED,
                             NOT_IMPLEMENTED);
 
     return *this;
 }
 template <class ElemType>
-Matrix<ElemType>& Matrix<ElemType>::ScatterToIndices(const Matrix<ElemType>& values, const Matrix<ElemType>& indices, size_t row_elements, const Matrix<char>* mask/* = nullptr*/)
+Matrix<ElemType>& Matrix<ElemType>::ScatterToIndices(const Matrix<ElemType>& values, const Matrix<ElemType>& indices, size_t row_elements, size_t outer_elements/* = 1*/, const Matrix<char>* mask/* = nullptr*/)
 {
     if (indices.IsEmpty() || values.IsEmpty() || (mask && mask->IsEmpty()))
         LogicError("ScatterAccordingIndices: input matrix is empty.");
     if (mask && (indices.GetNumCols() % mask->GetNumCols() != 0))
         LogicError("ScatterAccordingIndices: The number of columns(%zu) of the matrix slice to be masked is not a multiple of the number of columns(%zu) of the mask slice.",
             indices.GetNumCols(), mask->GetNumCols());
+    if (row_elements == 0 || outer_elements == 0 || GetNumElements() % (row_elements * outer_elements) != 0)
+        InvalidArgument("ScatterToIndices: The matrix of %zu elements cannot be split into %zu x N x %zu elements.", GetNumElements(), row_elements, outer_elements);
+    if (values.GetNumElements() != indices.GetNumElements() * row_elements * outer_elements)
+        InvalidArgument("ScatterToIndices: The values must have %zu elements for each of the %zu indices.", row_elements * outer_elements, indices.GetNumElements());
+
+    if (GetMatrixType() == SPARSE) // a row-sparse gradient, e.g. of an embedding
+    {
+        if (outer_elements != 1)
+            NOT_IMPLEMENTED;
+        DISPATCH_MATRIX_ON_FLAG(this,
+                                this,
+                                NOT_IMPLEMENTED,
+                                NOT_IMPLEMENTED,
+                                m_CPUSparseMatrix->ScatterToIndices(*values.m_CPUMatrix, *indices.m_CPUMatrix, row_elements, mask ? mask->m_CPUMatrix.get() : nullptr),
+                                m_GPUSparseMatrix->ScatterToIndices(*values.m_GPUMatrix, *indices.m_GPUMatrix, row_elements, mask ? mask->m_GPUMatrix.get() : nullptr));
+        return *this;
+    }
 
     DISPATCH_MATRIX_ON_FLAG(&values,
                             this,
-                            m_CPUMatrix->ScatterToIndices(*values.m_CPUMatrix, *indices.m_CPUMatrix, row_elements, mask ? mask->m_CPUMatrix.get() : nullptr),
-                            m_GPUMatrix->ScatterToIndices(*values.m_GPUMatrix, *indices.m_GPUMatrix, row_elements, mask ? mask->m_GPUMatrix.get() : nullptr),
+                            m_CPUMatrix->ScatterToIndices(*values.m_CPUMatrix, *indices.m_CPUMatrix, row_elements, outer_elements, mask ? mask->m_CPUMatrix.get() : nullptr),
+                            m_GPUMatrix->ScatterToIndices(*values.m_GPUMatrix, *indices.m_GPUMatrix, row_elements, outer_elements, mask ? mask->m_GPUMatrix.get() : nullptr),
                             NOT_IMPLEMENTED,
                             NOT_IMPLEMENTED);
 
@@ -3736,6 +4107,31 @@ Matrix<ElemType>& Matrix<ElemType>::AssignSumOfElements(const Matrix<ElemType>&
     return *this;
 }
 
+template <class ElemType>
+Matrix<ElemType>& Matrix<ElemType>::AssignHistogramOf(const Matrix<ElemType>& a, const Matrix<ElemType>& bucketLimits)
+{
+    if (a.IsEmpty())
+        LogicError("AssignHistogramOf: Matrix a is empty.");
+    if (bucketLimits.IsEmpty() || (bucketLimits.GetNumRows() != 1 && bucketLimits.GetNumCols() != 1))
+        InvalidArgument("AssignHistogramOf: The bucket limits must be a non-empty vector.");
+    if (a.GetDeviceId() != bucketLimits.GetDeviceId())
+        InvalidArgument("AssignHistogramOf: The bucket limits must be on the device of the matrix.");
+    if (a.GetMatrixType() != DENSE || bucketLimits.GetMatrixType() != DENSE)
+        NOT_IMPLEMENTED;
+
+    DecideAndMoveToRightDevice(a, *this);
+    SwitchToMatrixType(DENSE, matrixFormatDense, false);
+
+    DISPATCH_MATRIX_ON_FLAG(&a,
+                            this,
+                            m_CPUMatrix->AssignHistogramOf(*a.m_CPUMatrix, *bucketLimits.m_CPUMatrix),
+                            m_GPUMatrix->AssignHistogramOf(*a.m_GPUMatrix, *bucketLimits.m_GPUMatrix),
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED);
+
+    return *this;
+}
+
 template <class ElemType>
 DeviceBoundNumber<ElemType> Matrix<ElemType>::Sum_AsDeviceBoundNum() const
 {
@@ -4118,6 +4514,24 @@ void Matrix<ElemType>::VectorMax(Matrix<ElemType>& maxIndices, Matrix<ElemType>&
         { NOT_IMPLEMENTED; });
 }
 
+template <class ElemType>
+void Matrix<ElemType>::VectorTopKSoftmax(Matrix<ElemType>& topIndices, Matrix<ElemType>& topValues, Matrix<ElemType>& logSumExp, int topK) const
+{
+    if (IsEmpty())
+        LogicError("VectorTopKSoftmax: Matrix is empty.");
+
+    DecideAndMoveToRightDevice(*this, topIndices, topValues, logSumExp);
+    topIndices.SwitchToMatrixType(GetMatrixType(), GetFormat(), false);
+    logSumExp.SwitchToMatrixType(GetMatrixType(), GetFormat(), false);
+    topValues.SwitchToMatrixType(GetMatrixType(), GetFormat(), false);
+
+    DISPATCH_MATRIX_ON_FLAG(this, &topValues,
+        { m_CPUMatrix->VectorTopKSoftmax(*topIndices.m_CPUMatrix, *topValues.m_CPUMatrix, *logSumExp.m_CPUMatrix, topK); topIndices.SetDataLocation(CPU, DENSE); logSumExp.SetDataLocation(CPU, DENSE); },
+        { m_GPUMatrix->VectorTopKSoftmax(*topIndices.m_GPUMatrix, *topValues.m_GPUMatrix, *logSumExp.m_GPUMatrix, topK); topIndices.SetDataLocation(GPU, DENSE); logSumExp.SetDataLocation(GPU, DENSE); },
+        { NOT_IMPLEMENTED; },
+        { NOT_IMPLEMENTED; });
+}
+
 template <class ElemType>
 void Matrix<ElemType>::VectorMin(Matrix<ElemType>& minIndices, Matrix<ElemType>& minValues, const bool isColWise) const
 {
@@ -4135,6 +4549,29 @@ void Matrix<ElemType>::VectorMin(Matrix<ElemType>& minIndices, Matrix<ElemType>&
         { NOT_IMPLEMENTED; });
 }
 
+template <class ElemType>
+void Matrix<ElemType>::ExtractTopKMagnitudes(size_t k, std::vector<int>& indices, std::vector<ElemType>& values)
+{
+    if (IsEmpty())
+        LogicError("ExtractTopKMagnitudes: Matrix is empty.");
+
+    DISPATCH_MATRIX_ON_FLAG(this, this,
+        { m_CPUMatrix->ExtractTopKMagnitudes(k, indices, values); },
+        { m_GPUMatrix->ExtractTopKMagnitudes(k, indices, values); },
+        { NOT_IMPLEMENTED; },
+        { NOT_IMPLEMENTED; });
+}
+
+template <class ElemType>
+void Matrix<ElemType>::ScatterAddValues(const std::vector<int>& indices, const std::vector<ElemType>& values)
+{
+    DISPATCH_MATRIX_ON_FLAG(this, this,
+        { m_CPUMatrix->ScatterAddValues(indices, values); },
+        { m_GPUMatrix->ScatterAddValues(indices, values); },
+        { NOT_IMPLEMENTED; },
+        { NOT_IMPLEMENTED; });
+}
+
 #pragma endregion Member BLAS Functions
 
 #pragma region Other helper Functions
@@ -4438,6 +4875,17 @@ void Matrix<ElemType>::TransferFromDeviceToDevice(int from_id, int to_id, bool i
     if (updatePreferredDevice)
         m_preferredDeviceId = GetDeviceId();
 }
+template <class ElemType>
+void Matrix<ElemType>::TransferFromDeviceToDeviceAsync(int from_id, int to_id, bool isBeingMoved/* = false*/, bool updatePreferredDevice/* = true*/) const
+{
+    if (from_id >= 0 && to_id >= 0 && from_id != to_id && GetMatrixType() == MatrixType::DENSE && m_GPUMatrix && m_GPUMatrix->GetComputeDeviceId() == from_id)
+        m_GPUMatrix->ChangeDeviceToAsync(to_id);
+    else
+        _transferFromDeviceToDevice(from_id, to_id, isBeingMoved, /*emptyTransfer=*/false);
+    if (updatePreferredDevice)
+        m_preferredDeviceId = GetDeviceId();
+}
+
 template <class ElemType>
 void Matrix<ElemType>::TransferToDeviceIfNotThere(int to_id, bool isBeingMoved/*false: may leave in BOTH state*/, bool emptyTransfer/* = false*/, bool updatePreferredDevice/* = true*/) const
 {
@@ -4924,6 +5372,36 @@ void Matrix<ElemType>::MaxROIPoolingBackward(const size_t numRois, const size_t
                             NOT_IMPLEMENTED);
 }
 
+template <class ElemType>
+void Matrix<ElemType>::AverageROIAlignForward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
+                                              const size_t pooledWidth, const size_t pooledHeight, const Matrix<ElemType>& roiData, Matrix<ElemType>& output,
+                                              double spatialScale) const
+{
+    DecideAndMoveToRightDevice(*this, output);
+
+    DISPATCH_MATRIX_ON_FLAG(this,
+                            this,
+                            m_CPUMatrix->AverageROIAlignForward(numRois, numImg, channels, width, height, pooledWidth, pooledHeight, *(roiData.m_CPUMatrix), *(output.m_CPUMatrix), spatialScale),
+                            m_GPUMatrix->AverageROIAlignForward(numRois, numImg, channels, width, height, pooledWidth, pooledHeight, *(roiData.m_GPUMatrix), *(output.m_GPUMatrix), spatialScale),
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED);
+}
+
+template <class ElemType>
+void Matrix<ElemType>::AverageROIAlignBackward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
+                                               const size_t pooledWidth, const size_t pooledHeight, const Matrix<ElemType>& roiData, Matrix<ElemType>& grad,
+                                               double spatialScale) const
+{
+    DecideAndMoveToRightDevice(*this, grad);
+
+    DISPATCH_MATRIX_ON_FLAG(this,
+                            this,
+                            m_CPUMatrix->AverageROIAlignBackward(numRois, numImg, channels, width, height, pooledWidth, pooledHeight, *(roiData.m_CPUMatrix), *(grad.m_CPUMatrix), spatialScale),
+                            m_GPUMatrix->AverageROIAlignBackward(numRois, numImg, channels, width, height, pooledWidth, pooledHeight, *(roiData.m_GPUMatrix), *(grad.m_GPUMatrix), spatialScale),
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED);
+}
+
 template <class ElemType>
 void Matrix<ElemType>::MaxUnpooling(const Matrix<int>& mpRowCol, const Matrix<int>& mpRowIndices, const Matrix<int>& indices, const Matrix<ElemType>& poolInput, Matrix<ElemType>& input) const
 {
@@ -4989,7 +5467,7 @@ template <class ElemType>
 template <class StatType>
 void Matrix<ElemType>::BatchNormalizationForward(const Matrix<StatType>& scale, const Matrix<StatType>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor,
                                                  Matrix<StatType>& runMean, Matrix<StatType>& runVariance, Matrix<ElemType>& out, double epsilon,
-                                                 Matrix<StatType>& saveMean, Matrix<StatType>& saveInvStdDev) const
+                                                 Matrix<StatType>& saveMean, Matrix<StatType>& saveInvStdDev, bool reluOutput) const
 {
     DecideAndMoveToRightDevice(*this, out);
 
@@ -5001,19 +5479,31 @@ void Matrix<ElemType>::BatchNormalizationForward(const Matrix<StatType>& scale,
                                                                    *(out.m_CPUMatrix), epsilon, *(saveMean.m_CPUMatrix), *(saveInvStdDev.m_CPUMatrix)),
                             m_GPUMatrix->BatchNormalizationForward(*(scale.m_GPUMatrix), *(bias.m_GPUMatrix), inferenceOnly, expAvgFactor, blendFactor,
                                                                    *(runMean.m_GPUMatrix), *(runVariance.m_GPUMatrix),
-                                                                   *(out.m_GPUMatrix), epsilon, *(saveMean.m_GPUMatrix), *(saveInvStdDev.m_GPUMatrix)),
+                                                                   *(out.m_GPUMatrix), epsilon, *(saveMean.m_GPUMatrix), *(saveInvStdDev.m_GPUMatrix), reluOutput),
                             NOT_IMPLEMENTED,
                             NOT_IMPLEMENTED);
+
+    // the GPU kernel applies the ReLU as it stores the output
+    if (reluOutput && GetCurrentMatrixLocation() == CPU)
+        out.InplaceTruncateBottom(0);
 }
 
 template <class ElemType>
 template <class StatType>
 void Matrix<ElemType>::BatchNormalizationBackward(const Matrix<ElemType>& in, Matrix<ElemType>& grad, const Matrix<StatType>& scale, double blendFactor,
                                                   const Matrix<StatType>& saveMean, const Matrix<StatType>& saveInvStdDev,
-                                                  Matrix<StatType>& scaleGrad, Matrix<StatType>& biasGrad) const
+                                                  Matrix<StatType>& scaleGrad, Matrix<StatType>& biasGrad, const Matrix<ElemType>* reluOutput) const
 {
     DecideAndMoveToRightDevice(*this, grad);
 
+    if (reluOutput && GetCurrentMatrixLocation() == CPU)
+    {
+        Matrix<ElemType> maskedGrad(GetNumRows(), GetNumCols(), GetDeviceId());
+        maskedGrad.AssignLinearRectifierDerivativeOf(*reluOutput);
+        maskedGrad.ElementMultiplyWith(*this);
+        return maskedGrad.BatchNormalizationBackward(in, grad, scale, blendFactor, saveMean, saveInvStdDev, scaleGrad, biasGrad);
+    }
+
     // REVIEW alexeyk: add sparse version.
     DISPATCH_MATRIX_ON_FLAG(this,
                             this,
@@ -5021,6 +5511,41 @@ void Matrix<ElemType>::BatchNormalizationBackward(const Matrix<ElemType>& in, Ma
                                                                     *(saveMean.m_CPUMatrix), *(saveInvStdDev.m_CPUMatrix),
                                                                     *(scaleGrad.m_CPUMatrix), *(biasGrad.m_CPUMatrix)),
                             m_GPUMatrix->BatchNormalizationBackward(*(in.m_GPUMatrix), *(grad.m_GPUMatrix), *(scale.m_GPUMatrix), blendFactor,
+                                                                    *(saveMean.m_GPUMatrix), *(saveInvStdDev.m_GPUMatrix),
+                                                                    *(scaleGrad.m_GPUMatrix), *(biasGrad.m_GPUMatrix), reluOutput ? reluOutput->m_GPUMatrix.get() : nullptr),
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED);
+}
+
+template <class ElemType>
+void Matrix<ElemType>::LayerNormalizationForward(const Matrix<ElemType>& scale, const Matrix<ElemType>& bias, double epsilon, Matrix<ElemType>& out,
+                                                 Matrix<ElemType>& saveMean, Matrix<ElemType>& saveInvStdDev) const
+{
+    DecideAndMoveToRightDevice(*this, out, saveMean, saveInvStdDev);
+
+    DISPATCH_MATRIX_ON_FLAG(this,
+                            this,
+                            m_CPUMatrix->LayerNormalizationForward(*(scale.m_CPUMatrix), *(bias.m_CPUMatrix), epsilon,
+                                                                   *(out.m_CPUMatrix), *(saveMean.m_CPUMatrix), *(saveInvStdDev.m_CPUMatrix)),
+                            m_GPUMatrix->LayerNormalizationForward(*(scale.m_GPUMatrix), *(bias.m_GPUMatrix), epsilon,
+                                                                   *(out.m_GPUMatrix), *(saveMean.m_GPUMatrix), *(saveInvStdDev.m_GPUMatrix)),
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED);
+}
+
+template <class ElemType>
+void Matrix<ElemType>::LayerNormalizationBackward(const Matrix<ElemType>& in, Matrix<ElemType>& grad, const Matrix<ElemType>& scale,
+                                                  const Matrix<ElemType>& saveMean, const Matrix<ElemType>& saveInvStdDev,
+                                                  Matrix<ElemType>& scaleGrad, Matrix<ElemType>& biasGrad) const
+{
+    DecideAndMoveToRightDevice(*this, grad, scaleGrad, biasGrad);
+
+    DISPATCH_MATRIX_ON_FLAG(this,
+                            this,
+                            m_CPUMatrix->LayerNormalizationBackward(*(in.m_CPUMatrix), *(grad.m_CPUMatrix), *(scale.m_CPUMatrix),
+                                                                    *(saveMean.m_CPUMatrix), *(saveInvStdDev.m_CPUMatrix),
+                                                                    *(scaleGrad.m_CPUMatrix), *(biasGrad.m_CPUMatrix)),
+                            m_GPUMatrix->LayerNormalizationBackward(*(in.m_GPUMatrix), *(grad.m_GPUMatrix), *(scale.m_GPUMatrix),
                                                                     *(saveMean.m_GPUMatrix), *(saveInvStdDev.m_GPUMatrix),
                                                                     *(scaleGrad.m_GPUMatrix), *(biasGrad.m_GPUMatrix)),
                             NOT_IMPLEMENTED,
@@ -5037,7 +5562,7 @@ void Matrix<ElemType>::RNNForward(const Matrix<ElemType> &inputX, const Matrix<E
 
     DISPATCH_MATRIX_ON_FLAG(this,
                             this,
-                            NOT_IMPLEMENTED,
+                            m_CPUMatrix->RNNForward(*(inputX.m_CPUMatrix), *(paramW.m_CPUMatrix), xDim, yDim, numSequencesForFrame, rnnAttributes, *(workspace.m_CPUMatrix)),
                             m_GPUMatrix->RNNForward(*(inputX.m_GPUMatrix), *(paramW.m_GPUMatrix), xDim, yDim, numSequencesForFrame, rnnAttributes, *(reserve.m_GPUMatrix), *(workspace.m_GPUMatrix)),
                             NOT_IMPLEMENTED,
                             NOT_IMPLEMENTED);
@@ -5073,6 +5598,54 @@ void Matrix<ElemType>::RNNBackwardWeights(const Matrix<ElemType>& inputX, const
                             NOT_IMPLEMENTED);
 }
 
+template <class ElemType>
+/*static*/ bool Matrix<ElemType>::IsRNNUnpackedLayoutSupported(DEVICEID_TYPE deviceId)
+{
+    return deviceId >= 0 && GPUMatrix<ElemType>::IsRNNUnpackedLayoutSupported();
+}
+
+template <class ElemType>
+void Matrix<ElemType>::RNNForwardUnpacked(const Matrix<ElemType>& inputX, const Matrix<ElemType>& paramW, Matrix<ElemType>& outputY, size_t xDim, size_t yDim, const vector<int>& sequenceLengths, const RnnAttributes& rnnAttributes, Matrix<ElemType>& reserve, Matrix<ElemType>& workspace)
+{
+    DecideAndMoveToRightDevice(*this, inputX, paramW, outputY);
+    // move reserve/workspace to the consensus device
+    reserve._transferToDevice(GetDeviceId());
+    workspace._transferToDevice(GetDeviceId());
+
+    if (sequenceLengths.empty() || inputX.GetNumCols() % sequenceLengths.size() != 0)
+        InvalidArgument("RNNForwardUnpacked: The number of columns %d is not a multiple of the number of sequences %d.", (int)inputX.GetNumCols(), (int)sequenceLengths.size());
+    size_t numTimeSteps = inputX.GetNumCols() / sequenceLengths.size();
+    for (int length : sequenceLengths)
+    {
+        if (length <= 0 || length > numTimeSteps)
+            InvalidArgument("RNNForwardUnpacked: Sequence length %d is out of range [1, %d].", length, (int)numTimeSteps);
+    }
+    outputY.Resize(yDim, inputX.GetNumCols());
+
+    DISPATCH_MATRIX_ON_FLAG(this,
+                            nullptr,
+                            NOT_IMPLEMENTED,
+                            m_GPUMatrix->RNNForwardUnpacked(*(inputX.m_GPUMatrix), *(paramW.m_GPUMatrix), *(outputY.m_GPUMatrix), xDim, yDim, sequenceLengths, rnnAttributes, *(reserve.m_GPUMatrix), *(workspace.m_GPUMatrix)),
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED);
+}
+
+template <class ElemType>
+void Matrix<ElemType>::RNNBackwardDataUnpacked(const Matrix<ElemType>& outputY, const Matrix<ElemType>& outputDY, const Matrix<ElemType>& paramW, Matrix<ElemType>& outputDX, const RnnAttributes& rnnAttributes, Matrix<ElemType>& reserve, Matrix<ElemType>& workspace)
+{
+    DecideAndMoveToRightDevice(*this, outputY, outputDY, paramW);
+    outputDX._transferToDevice(GetDeviceId());
+    // move reserve/workspace to the consensus device
+    reserve._transferToDevice(GetDeviceId());
+    workspace._transferToDevice(GetDeviceId());
+    DISPATCH_MATRIX_ON_FLAG(this,
+                            nullptr,
+                            NOT_IMPLEMENTED,
+                            m_GPUMatrix->RNNBackwardDataUnpacked(*(outputY.m_GPUMatrix), *(outputDY.m_GPUMatrix), *(paramW.m_GPUMatrix), *(outputDX.m_GPUMatrix), rnnAttributes, *(reserve.m_GPUMatrix), *(workspace.m_GPUMatrix)),
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED);
+}
+
 #pragma region Static BLAS Functions
 
 template <class ElemType>
@@ -6190,6 +6763,7 @@ Matrix<ElemType>& Matrix<ElemType>::AssignSequenceError(const ElemType hsmoothin
 }
 
 // Calculate CTC score
+// this (output): CTC posterior of each label, normalized to sum to 1 over each frame; zero in the gaps
 // prob (input): the posterior output from the network
 // alpha, beta (output): alpha and beta for forward-backward calculation.
 // phoneSeq (input): phone ID sequence for each utterance in this minibatch, each col is one utterance
@@ -6218,7 +6792,7 @@ Matrix<ElemType>& Matrix<ElemType>::AssignCTCScore(const Matrix<ElemType>& prob,
 
     alpha.SetValue(LZERO);
     beta.SetValue(LZERO);
-    SetValue(LZERO);
+    SetValue(0);
     SwitchToMatrixType(prob.GetMatrixType(), prob.GetFormat(), false);
 
     DISPATCH_MATRIX_ON_FLAG(&prob,
@@ -6234,6 +6808,94 @@ Matrix<ElemType>& Matrix<ElemType>::AssignCTCScore(const Matrix<ElemType>& prob,
     return *this;
 }
 
+// Computes the edit distances of the utterances where the label sequences are, one utterance at a time per thread on the CPU,
+// and one utterance per block on the GPU, so that the labels need not be copied to the host.
+// firstSeq, secondSeq (input): label index of each frame of the minibatch, 1 x (numParallelSequences * #frames)
+// uttToChanInd, uttBeginFrame, uttFrameNum (input): channel, first frame and number of frames of each utterance in the minibatch
+// subPen, delPen, insPen (input): substitution, deletion and insertion penalties, which decide the alignment
+// squashInputs (input): whether to merge runs of identical labels
+// tokensToIgnore (input): labels that are removed before the alignment
+template<class ElemType>
+Matrix<ElemType>& Matrix<ElemType>::AssignEditDistances(const Matrix<ElemType>& firstSeq, const Matrix<ElemType>& secondSeq, const std::vector<size_t>& uttToChanInd,
+    const std::vector<size_t>& uttBeginFrame, const std::vector<size_t>& uttFrameNum, const size_t numParallelSequences,
+    const float subPen, const float delPen, const float insPen, const bool squashInputs, const std::vector<size_t>& tokensToIgnore)
+{
+    if (firstSeq.GetNumRows() != 1 || secondSeq.GetNumRows() != 1 || firstSeq.GetNumCols() != secondSeq.GetNumCols())
+        InvalidArgument("AssignEditDistances: The label sequences must be row vectors of the same size.");
+    if (uttToChanInd.size() != uttFrameNum.size() || uttBeginFrame.size() != uttFrameNum.size())
+        InvalidArgument("AssignEditDistances: The utterance descriptions must have the same size.");
+
+    DecideAndMoveToRightDevice(firstSeq, secondSeq, *this);
+    Resize(3, uttFrameNum.size());
+    SwitchToMatrixType(DENSE, matrixFormatDense, false);
+
+    DISPATCH_MATRIX_ON_FLAG(&firstSeq,
+        this,
+        this->m_CPUMatrix->AssignEditDistances(*firstSeq.m_CPUMatrix, *secondSeq.m_CPUMatrix, uttToChanInd, uttBeginFrame, uttFrameNum, numParallelSequences,
+            subPen, delPen, insPen, squashInputs, tokensToIgnore),
+        this->m_GPUMatrix->AssignEditDistances(*firstSeq.m_GPUMatrix, *secondSeq.m_GPUMatrix, uttToChanInd, uttBeginFrame, uttFrameNum, numParallelSequences,
+            subPen, delPen, insPen, squashInputs, tokensToIgnore),
+        NOT_IMPLEMENTED,
+        NOT_IMPLEMENTED
+    );
+
+    return *this;
+}
+
+// Ranks the documents of each query by their scores, one query per thread on the CPU and one per block on the GPU, and computes
+// the DCG of the ranking and the ideal one, the ranking by gains.
+// gains, scores (input): 1 x #documents, the documents of a query in consecutive columns, ordered by decreasing gain
+// queryBegins (input): the first column of each query, followed by the number of columns
+// metrics (output): 2 x #queries, the ideal DCG and the DCG of the scores
+template<class ElemType>
+Matrix<ElemType>& Matrix<ElemType>::AssignLambdaRankRanks(const Matrix<ElemType>& gains, const Matrix<ElemType>& scores, const std::vector<size_t>& queryBegins, Matrix<ElemType>& metrics)
+{
+    if (gains.GetNumRows() != 1 || scores.GetNumRows() != 1 || gains.GetNumCols() != scores.GetNumCols())
+        InvalidArgument("AssignLambdaRankRanks: The gains and scores must be row vectors of the same size.");
+    if (queryBegins.empty() || queryBegins.front() != 0 || queryBegins.back() != gains.GetNumCols())
+        InvalidArgument("AssignLambdaRankRanks: The queries must cover the columns of the gains.");
+
+    DecideAndMoveToRightDevice(gains, scores, *this, metrics);
+    Resize(1, gains.GetNumCols());
+    metrics.Resize(2, queryBegins.size() - 1);
+    SwitchToMatrixType(DENSE, matrixFormatDense, false);
+    metrics.SwitchToMatrixType(DENSE, matrixFormatDense, false);
+
+    DISPATCH_MATRIX_ON_FLAG(&gains,
+        this,
+        this->m_CPUMatrix->AssignLambdaRankRanks(*gains.m_CPUMatrix, *scores.m_CPUMatrix, queryBegins, *metrics.m_CPUMatrix),
+        this->m_GPUMatrix->AssignLambdaRankRanks(*gains.m_GPUMatrix, *scores.m_GPUMatrix, queryBegins, *metrics.m_GPUMatrix),
+        NOT_IMPLEMENTED,
+        NOT_IMPLEMENTED
+    );
+
+    return *this;
+}
+
+// Adds to the gradient of each document the lambdas of its pairs with the documents of the same query with a different gain,
+// -sigma / (1 + exp(sigma * (s_i - s_j))) * |delta NDCG| for the document with the higher gain, and the negated lambda for the other.
+// A document sums its own lambdas, so that the gradient is written once, without atomics.
+template<class ElemType>
+void Matrix<ElemType>::AddLambdaRankGradient(const Matrix<ElemType>& gains, const Matrix<ElemType>& scores, const Matrix<ElemType>& ranks, const Matrix<ElemType>& metrics,
+    const std::vector<size_t>& queryBegins, const ElemType sigma, Matrix<ElemType>& gradient)
+{
+    if (gradient.GetNumRows() != 1 || gradient.GetNumCols() != gains.GetNumCols() || ranks.GetNumCols() != gains.GetNumCols() || metrics.GetNumCols() + 1 != queryBegins.size())
+        InvalidArgument("AddLambdaRankGradient: The dimensions of the gradient, ranks and metrics do not match the documents and queries.");
+
+    DecideAndMoveToRightDevice(gradient, gains, scores, ranks);
+    DecideAndMoveToRightDevice(gradient, metrics);
+    if (gradient.GetMatrixType() != DENSE)
+        NOT_IMPLEMENTED;
+
+    DISPATCH_MATRIX_ON_FLAG(&gradient,
+        &gradient,
+        CPUMatrix<ElemType>::AddLambdaRankGradient(*gains.m_CPUMatrix, *scores.m_CPUMatrix, *ranks.m_CPUMatrix, *metrics.m_CPUMatrix, queryBegins, sigma, *gradient.m_CPUMatrix),
+        GPUMatrix<ElemType>::AddLambdaRankGradient(*gains.m_GPUMatrix, *scores.m_GPUMatrix, *ranks.m_GPUMatrix, *metrics.m_GPUMatrix, queryBegins, sigma, *gradient.m_GPUMatrix),
+        NOT_IMPLEMENTED,
+        NOT_IMPLEMENTED
+    );
+}
+
 #pragma endregion Static BLAS Functions
 
 // TensorView currently does not interface with sparse matrices. For now, we just catch this and throw.
@@ -6316,24 +6978,94 @@ void Matrix<ElemType>::TensorArgOp(const Matrix<ElemType>& a, ElementWiseOperato
         NOT_IMPLEMENTED);
 }
 
+template <class ElemType>
+void Matrix<ElemType>::ElementwiseProgramOp(ElemType beta, const std::vector<const Matrix<ElemType>*>& inputs, const ElementwiseProgram& program, ElemType alpha)
+{
+    const size_t numInputs = program.numInputs;
+    const size_t numInstructions = program.numInstructions;
+    if (numInputs > ElementwiseProgram::MaxInputs || numInstructions == 0 || numInstructions > ElementwiseProgram::MaxInstructions)
+        InvalidArgument("ElementwiseProgramOp: The program has %d inputs and %d instructions, at most %d and between 1 and %d are supported.",
+                        (int)numInputs, (int)numInstructions, (int)ElementwiseProgram::MaxInputs, (int)ElementwiseProgram::MaxInstructions);
+    for (size_t i = 0; i < numInstructions; i++)
+        for (auto arg : program.instructions[i].args)
+            if (arg >= numInputs + i)
+                InvalidArgument("ElementwiseProgramOp: Instruction %d reads a register that is not computed yet.", (int)i);
+    if (inputs.size() != numInputs)
+        InvalidArgument("ElementwiseProgramOp: The program has %d inputs, but %d were passed.", (int)numInputs, (int)inputs.size());
+
+    VerifyIsDense(*this);
+    for (const auto& input : inputs)
+    {
+        VerifyIsDense(*input);
+        if (input->GetDeviceId() != GetDeviceId())
+            InvalidArgument("ElementwiseProgramOp: All matrices must be on the same device.");
+        const size_t n = input->GetNumElements();
+        if (n != GetNumElements() && n != GetNumRows() && n != 1)
+            InvalidArgument("ElementwiseProgramOp: An input has %d elements, which cannot be broadcast to [%d x %d].", (int)n, (int)GetNumRows(), (int)GetNumCols());
+    }
+
+    DISPATCH_MATRIX_ON_FLAG(this,
+        this,
+        {
+            std::vector<const CPUMatrix<ElemType>*> cpuInputs;
+            for (const auto& input : inputs)
+                cpuInputs.push_back(input->m_CPUMatrix.get());
+            m_CPUMatrix->ElementwiseProgramOp(beta, cpuInputs, program, alpha);
+        },
+        {
+            std::vector<const GPUMatrix<ElemType>*> gpuInputs;
+            for (const auto& input : inputs)
+                gpuInputs.push_back(input->m_GPUMatrix.get());
+            m_GPUMatrix->ElementwiseProgramOp(beta, gpuInputs, program, alpha);
+        },
+        NOT_IMPLEMENTED,
+        NOT_IMPLEMENTED);
+}
+
+template <class ElemType>
+void Matrix<ElemType>::DropoutOp(ElemType beta, const Matrix<ElemType>& a, double dropoutRate, uint64_t seed, uint64_t offset)
+{
+    if (dropoutRate < 0 || dropoutRate >= 1)
+        InvalidArgument("DropoutOp: The dropout rate must be >= 0 and < 1.");
+    if (a.IsEmpty())
+        return;
+
+    DecideAndMoveToRightDevice(a, *this);
+    if (beta == 0)
+        Resize(a);
+    else if (GetNumRows() != a.GetNumRows() || GetNumCols() != a.GetNumCols())
+        InvalidArgument("DropoutOp: The input is [%d x %d], but the output is [%d x %d].", (int)a.GetNumRows(), (int)a.GetNumCols(), (int)GetNumRows(), (int)GetNumCols());
+
+    DISPATCH_MATRIX_ON_FLAG(&a,
+        this,
+        m_CPUMatrix->DropoutOp(beta, *a.m_CPUMatrix, dropoutRate, seed, offset),
+        m_GPUMatrix->DropoutOp(beta, *a.m_GPUMatrix, dropoutRate, seed, offset),
+        NOT_IMPLEMENTED,
+        NOT_IMPLEMENTED);
+}
+
 //template class Matrix<short>;
 template class Matrix<float>;
 template class Matrix<double>;
 template class Matrix<half>;
+template class Matrix<bfloat16>;
 //template class Matrix<char>;
 
 // instantiate some templated methods
 template MATH_API void Matrix<float>::AdaDeltaUpdate(Matrix<float>& gradients, Matrix<float>& functionvalues, float learningRatePerSample, float rho, float epsilon, int* timestamps, int currentTimestamp);
 template MATH_API void Matrix<double>::AdaDeltaUpdate(Matrix<double>& gradients, Matrix<double>& functionvalues, double learningRatePerSample, double rho, double epsilon, int* timestamps, int currentTimestamp);
 template MATH_API void Matrix<float>::AdaDeltaUpdate(Matrix<half>& gradients, Matrix<float>& functionvalues, float learningRatePerSample, float rho, float epsilon, int* timestamps, int currentTimestamp);
+template MATH_API void Matrix<float>::AdaDeltaUpdate(Matrix<bfloat16>& gradients, Matrix<float>& functionvalues, float learningRatePerSample, float rho, float epsilon, int* timestamps, int currentTimestamp);
 
-template MATH_API void Matrix<float>::BatchNormalizationForward(const Matrix<float>& scale, const Matrix<float>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, Matrix<float>& runMean, Matrix<float>& runVariance, Matrix<float>& out, double epsilon, Matrix<float>& saveMean, Matrix<float>& saveInvStdDev) const;
-template MATH_API void Matrix<double>::BatchNormalizationForward(const Matrix<double>& scale, const Matrix<double>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, Matrix<double>& runMean, Matrix<double>& runVariance, Matrix<double>& out, double epsilon, Matrix<double>& saveMean, Matrix<double>& saveInvStdDev) const;
-template MATH_API void Matrix<half>::BatchNormalizationForward(const Matrix<float>& scale, const Matrix<float>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, Matrix<float>& runMean, Matrix<float>& runVariance, Matrix<half>& out, double epsilon, Matrix<float>& saveMean, Matrix<float>& saveInvStdDev) const;
+template MATH_API void Matrix<float>::BatchNormalizationForward(const Matrix<float>& scale, const Matrix<float>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, Matrix<float>& runMean, Matrix<float>& runVariance, Matrix<float>& out, double epsilon, Matrix<float>& saveMean, Matrix<float>& saveInvStdDev, bool reluOutput) const;
+template MATH_API void Matrix<double>::BatchNormalizationForward(const Matrix<double>& scale, const Matrix<double>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, Matrix<double>& runMean, Matrix<double>& runVariance, Matrix<double>& out, double epsilon, Matrix<double>& saveMean, Matrix<double>& saveInvStdDev, bool reluOutput) const;
+template MATH_API void Matrix<half>::BatchNormalizationForward(const Matrix<float>& scale, const Matrix<float>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, Matrix<float>& runMean, Matrix<float>& runVariance, Matrix<half>& out, double epsilon, Matrix<float>& saveMean, Matrix<float>& saveInvStdDev, bool reluOutput) const;
+template MATH_API void Matrix<bfloat16>::BatchNormalizationForward(const Matrix<float>& scale, const Matrix<float>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, Matrix<float>& runMean, Matrix<float>& runVariance, Matrix<bfloat16>& out, double epsilon, Matrix<float>& saveMean, Matrix<float>& saveInvStdDev, bool reluOutput) const;
 
-template MATH_API void Matrix<float>::BatchNormalizationBackward(const Matrix<float>& in, Matrix<float>& grad, const Matrix<float>& scale, double blendFactor, const Matrix<float>& saveMean, const Matrix<float>& saveInvStdDev, Matrix<float>& scaleGrad, Matrix<float>& biasGrad) const;
-template MATH_API void Matrix<double>::BatchNormalizationBackward(const Matrix<double>& in, Matrix<double>& grad, const Matrix<double>& scale, double blendFactor, const Matrix<double>& saveMean, const Matrix<double>& saveInvStdDev, Matrix<double>& scaleGrad, Matrix<double>& biasGrad) const;
-template MATH_API void Matrix<half>::BatchNormalizationBackward(const Matrix<half>& in, Matrix<half>& grad, const Matrix<float>& scale, double blendFactor, const Matrix<float>& saveMean, const Matrix<float>& saveInvStdDev, Matrix<float>& scaleGrad, Matrix<float>& biasGrad) const;
+template MATH_API void Matrix<float>::BatchNormalizationBackward(const Matrix<float>& in, Matrix<float>& grad, const Matrix<float>& scale, double blendFactor, const Matrix<float>& saveMean, const Matrix<float>& saveInvStdDev, Matrix<float>& scaleGrad, Matrix<float>& biasGrad, const Matrix<float>* reluOutput) const;
+template MATH_API void Matrix<double>::BatchNormalizationBackward(const Matrix<double>& in, Matrix<double>& grad, const Matrix<double>& scale, double blendFactor, const Matrix<double>& saveMean, const Matrix<double>& saveInvStdDev, Matrix<double>& scaleGrad, Matrix<double>& biasGrad, const Matrix<double>* reluOutput) const;
+template MATH_API void Matrix<half>::BatchNormalizationBackward(const Matrix<half>& in, Matrix<half>& grad, const Matrix<float>& scale, double blendFactor, const Matrix<float>& saveMean, const Matrix<float>& saveInvStdDev, Matrix<float>& scaleGrad, Matrix<float>& biasGrad, const Matrix<half>* reluOutput) const;
+template MATH_API void Matrix<bfloat16>::BatchNormalizationBackward(const Matrix<bfloat16>& in, Matrix<bfloat16>& grad, const Matrix<float>& scale, double blendFactor, const Matrix<float>& saveMean, const Matrix<float>& saveInvStdDev, Matrix<float>& scaleGrad, Matrix<float>& biasGrad, const Matrix<bfloat16>* reluOutput) const;
 
 // We use Matrix<char> as the backing store for QuantizedMatrix, and also as a flag matrix.
 // Let's explicitly instantiate the methods we need for that purpose
@@ -173,6 +173,9 @@ public:
     void TransferFromDeviceToDevice(int id_from, int id_to, bool isBeingMoved = false, /*if false then keep source and set location to BOTH*/ bool emptyTransfer = false, bool updatePreferredDevice = true) const;
     // Same as TransferFromDeviceToDevice() but moves only if it is currently not on the target device
     void TransferToDeviceIfNotThere(int id_to, bool isBeingMoved = false, bool emptyTransfer = false, bool updatePreferredDevice = true) const;
+    // Same as TransferFromDeviceToDevice(), but a dense matrix that moves between GPUs does not wait for the copy (see
+    // GPUMatrix::ChangeDeviceToAsync()): work queued afterwards on the target GPU waits for it instead, while the host goes on.
+    void TransferFromDeviceToDeviceAsync(int id_from, int id_to, bool isBeingMoved = false, bool updatePreferredDevice = true) const;
     CurrentDataLocation GetCurrentMatrixLocation() const { return m_currentDataLocation; };
     void SwitchToMatrixType(MatrixType newMatrixType, MatrixFormat newMatrixFormat, bool keepValues); // sets matrix type between dense and sparse
     size_t GetNumRows() const;
@@ -208,7 +211,8 @@ public:
     void AssignDiagonalValuesTo(Matrix<ElemType>& diag) const;
 
     void SGDUpdate(Matrix<ElemType>& gradients, ElemType learnRatePerSample);
-    void MomentumSGDUpdate(Matrix<ElemType>& gradients, Matrix<ElemType>& smoothedGradients, ElemType learnRatePerSample, ElemType momentum, ElemType unitGainFactor);
+    void MomentumSGDUpdate(Matrix<ElemType>& gradients, Matrix<ElemType>& smoothedGradients, ElemType learnRatePerSample, ElemType momentum, ElemType unitGainFactor,
+                           int* timestamps = nullptr, int currentTimestamp = 0);
     void NesterovAcceleratedMomentumSGDUpdate(Matrix<ElemType>& gradients, Matrix<ElemType>& smoothedGradients, ElemType learnRatePerSample, ElemType momentum, ElemType unitGainFactor);
 
     ElemType Adagrad(Matrix<ElemType>& gradients, const bool needAveMultiplier);
@@ -216,7 +220,8 @@ public:
                          const double learnRatePerSample, const double meanMomentum, const double varMomentum, ElemType unitGainFactor);
 
     void AdamUpdate(Matrix<ElemType>& gradients, Matrix<ElemType>& functionValues, const double smoothedCount,
-        const double learnRatePerSample, const double meanMomentum, const double varMomentum, const double epsilon, ElemType unitGainFactor, bool adamax = false);
+        const double learnRatePerSample, const double meanMomentum, const double varMomentum, const double epsilon, ElemType unitGainFactor, bool adamax = false,
+        bool lazySparse = false, int* timestamps = nullptr, int currentTimestamp = 0);
 
     ElemType RmsProp(Matrix<ElemType>& gradients, ElemType RMS_GAMMA, ElemType RMS_WGT_INC, ElemType RMS_WGT_MAX, ElemType RMS_WGT_DEC, ElemType RMS_WGT_MIN, const bool needAveMultiplier, const bool initialized);
 
@@ -224,6 +229,17 @@ public:
     void AdaDeltaUpdate(Matrix<GradType>& gradients, Matrix<ElemType>& functionvalues, ElemType learningRatePerSample, ElemType rho, ElemType epsilon, int* timestamps, int currentTimestamp);
 
     void AdaDeltaFlushState(size_t stride, ElemType rho, int* timestamps, int currentTimestamp);
+    void LazyDecayFlushState(size_t cols, ElemType decay, ElemType secondDecay, int* timestamps, int currentTimestamp);
+
+    // Applies the update 'update' to all the given dense parameters, each with its gradient and smoothed gradient; on the GPU
+    // these are processed in chunks by a few kernel launches instead of one or more launches per parameter.
+    static void MultiTensorUpdate(const MultiTensorUpdateParameters<ElemType>& update, const std::vector<Matrix<ElemType>*>& parameters,
+                                  const std::vector<const Matrix<ElemType>*>& gradients, const std::vector<Matrix<ElemType>*>& smoothedGradients);
+    // Returns the sum of the squares of the elements of all the given dense matrices, e.g. the squared global norm of the gradients
+    // of a model; on the GPU this takes a few kernel launches and a single transfer of the result to the host.
+    static ElemType MultiTensorSumOfSquares(const std::vector<const Matrix<ElemType>*>& matrices);
+    // Same for each of the matrices, e.g. the squared norms of the parameters of a model.
+    static void MultiTensorSumsOfSquares(const std::vector<const Matrix<ElemType>*>& matrices, std::vector<ElemType>& sums);
 
     void Resize(const size_t numRows, const size_t numCols, const size_t numNZElemToReserve = 10000, bool growOnly = true, bool keepValue = false); // by default we only reallocate if need to grow
     void Resize(const Matrix<ElemType>& other) // TODO: Should this carry over numNZElemToReserve for sparse matrices?
@@ -293,6 +309,10 @@ public:
     }
     void SetMatrixFromCSCFormat(const CPUSPARSE_INDEX_TYPE* h_CSCCol, const CPUSPARSE_INDEX_TYPE* h_Row, const ElemType* h_Val,
         const size_t nz, const size_t numRows, const size_t numCols, DataTransferer* transferer = nullptr);
+    // copies a sparse CSC matrix to host arrays; colStarts is rebased to 0, and column j holds the non-zeros [colStarts[j], colStarts[j + 1])
+    void GetMatrixFromCSCFormat(std::vector<CPUSPARSE_INDEX_TYPE>& colStarts, std::vector<CPUSPARSE_INDEX_TYPE>& rowIndices, std::vector<ElemType>& values) const;
+    // copies a sparse block column matrix to host arrays: the columns of its blocks, and their values [numRows x numBlocks]
+    void GetMatrixFromSBCFormat(std::vector<size_t>& blockIds, std::vector<ElemType>& values) const;
 
     void MaskColumnsValue(const Matrix<char>& columnsMask, ElemType val, size_t numColsPerMaskEntry);
 
@@ -319,14 +339,32 @@ public:
     Matrix<ElemType>& AssignNceUnnormalizedEval(const Matrix<ElemType>& a, const Matrix<ElemType>& b, const Matrix<ElemType>& c, const Matrix<ElemType>& bias);
 
     Matrix<ElemType>& AssignOneHot(const Matrix<ElemType>& a, vector<size_t>& shape, size_t axis, bool is_sparse);
-    Matrix<ElemType>& GatherFromTarget(const Matrix<ElemType>& indices, const Matrix<ElemType>& target, size_t row_elements);
-    Matrix<ElemType>& ScatterToIndices(const Matrix<ElemType>& values, const Matrix<ElemType>& indices, size_t row_elements, const Matrix<char>* mask = nullptr);
+    // Gathers along an axis of 'target', viewed as a [row_elements x axisDim x outer_elements] tensor: column j of the result is
+    // the [row_elements x indices.GetNumRows() x outer_elements] tensor whose slice (i, o) is the slice (indices(i, j), o) of 'target'.
+    // With outer_elements == 1 this gathers along the last axis.
+    Matrix<ElemType>& GatherFromTarget(const Matrix<ElemType>& indices, const Matrix<ElemType>& target, size_t row_elements, size_t outer_elements = 1);
+    // The gradient of GatherFromTarget(): adds the slices of 'values' into the slices of this matrix given by 'indices'.
+    Matrix<ElemType>& ScatterToIndices(const Matrix<ElemType>& values, const Matrix<ElemType>& indices, size_t row_elements, size_t outer_elements = 1, const Matrix<char>* mask = nullptr);
 
     Matrix<ElemType> Transpose(); // This method doesn't change state of Matrix. It should be a const function
     Matrix<ElemType>& AssignTransposeOf(const Matrix<ElemType>& a);
 
     Matrix<ElemType>& DoGatherColumnsOf (ElemType beta, const Matrix<ElemType>& idx, const Matrix<ElemType>& a, ElemType alpha);
     Matrix<ElemType>& DoScatterColumnsOf(ElemType beta, const Matrix<ElemType>& idx, const Matrix<ElemType>& a, ElemType alpha, bool idxHaveDups);
+    // Gathers the columns idx[j] of a table quantized per column, dequantizing them as they are read:
+    // *this[:,j] = codes[:,idx[j]] * scalesAndOffsets(0,idx[j]) + scalesAndOffsets(1,idx[j]), or 0 for gap columns (idx(0,j) == -1).
+    // 'codes' are int8 values stored as char, or half values.
+    Matrix<ElemType>& AssignDequantizedColumnsOf(const Matrix<ElemType>& idx, const Matrix<char>& codes, const Matrix<ElemType>& scalesAndOffsets);
+    Matrix<ElemType>& AssignDequantizedColumnsOf(const Matrix<ElemType>& idx, const Matrix<half>& codes, const Matrix<ElemType>& scalesAndOffsets);
+private:
+    template <class QuantizedType>
+    Matrix<ElemType>& AssignDequantizedColumns(const Matrix<ElemType>& idx, const Matrix<QuantizedType>& codes, const Matrix<ElemType>& scalesAndOffsets);
+public:
+
+    // segmented reduction over the columns of a packed minibatch; see Matrix.cpp
+    Matrix<ElemType>& AssignSegmentedReductionOf(const Matrix<ElemType>& a, const Matrix<ElemType>& segments, size_t columnStride, ElementWiseOperator reductionOp, bool average);
+    Matrix<ElemType>& DoSegmentedReductionGradientOf(ElemType beta, const Matrix<ElemType>& outputGradient, const Matrix<ElemType>& input, const Matrix<ElemType>& output,
+                                                     const Matrix<ElemType>& segments, size_t columnStride, ElementWiseOperator reductionOp, bool average);
 
     Matrix<ElemType>& operator+=(const ElemType alpha);
     Matrix<ElemType>  operator+(const ElemType alpha) const;
@@ -396,6 +434,8 @@ public:
 
     Matrix<ElemType>& InplaceLogSoftmax(const bool isColWise);
     Matrix<ElemType>& AssignLogSoftmaxOf(const Matrix<ElemType>& a, const bool isColWise);
+    // Replaces each run of elements [segmentOffsets[i], segmentOffsets[i + 1]) by its log softmax; the runs may differ in length.
+    Matrix<ElemType>& InplaceSegmentedLogSoftmax(const std::vector<int>& segmentOffsets);
 
     Matrix<ElemType>& InplaceHardmax(const bool isColWise);
     Matrix<ElemType>& AssignHardmaxOf(const Matrix<ElemType>& a, const bool isColWise);
@@ -408,6 +448,20 @@ public:
         const vector<size_t> & extraUttMap, const vector<size_t> & uttBeginFrame, const vector<size_t> & uttFrameNum, const vector<size_t> & uttPhoneNum, const size_t samplesInRecurrentStep,
         const size_t mbSize, const size_t blankTokenId, const int delayConstraint, const bool isColWise);
 
+    // Edit distances between the label sequences in 'firstSeq' and 'secondSeq' (1 x columns, the label index of each frame) of the
+    // utterances of a minibatch, see EditDistanceErrorNode. Column u of the 3 x #utterances result holds the number of insertions,
+    // deletions and substitutions, and the lengths of the two sequences after squashing and removing the ignored tokens.
+    Matrix<ElemType>& AssignEditDistances(const Matrix<ElemType>& firstSeq, const Matrix<ElemType>& secondSeq, const vector<size_t>& uttToChanInd, const vector<size_t>& uttBeginFrame, const vector<size_t>& uttFrameNum,
+        const size_t numParallelSequences, const float subPen, const float delPen, const float insPen, const bool squashInputs, const vector<size_t>& tokensToIgnore);
+
+    // LambdaRank, see LambdaRankNode. The documents of query q are the columns queryBegins[q] to queryBegins[q + 1] of the 1 x #documents
+    // 'gains' and 'scores', ordered by decreasing gain. Assigns the rank of each document by decreasing score within its query to this
+    // (1 x #documents), and the ideal and the actual DCG of each query to 'metrics' (2 x #queries).
+    Matrix<ElemType>& AssignLambdaRankRanks(const Matrix<ElemType>& gains, const Matrix<ElemType>& scores, const vector<size_t>& queryBegins, Matrix<ElemType>& metrics);
+    // Adds the lambdas of the pairs of documents of each query to 'gradient', given the ranks and metrics of AssignLambdaRankRanks().
+    static void AddLambdaRankGradient(const Matrix<ElemType>& gains, const Matrix<ElemType>& scores, const Matrix<ElemType>& ranks, const Matrix<ElemType>& metrics,
+        const vector<size_t>& queryBegins, const ElemType sigma, Matrix<ElemType>& gradient);
+
     Matrix<ElemType>& InplaceSqrt();
     Matrix<ElemType>& AssignSqrtOf(const Matrix<ElemType>& a);
 
@@ -466,6 +520,9 @@ public:
     ElemType SumOfAbsElements() const; // sum of all abs(elements)
     ElemType SumOfElements() const;    // sum of all elements
     Matrix<ElemType>& AssignSumOfElements(const Matrix<ElemType>& a);
+    // bucket counts of the elements of 'a' for the ascending 'bucketLimits' (bucket i holds limits[i-1] < x <= limits[i], the last one those above all limits),
+    // followed by the sum, the sum of squares, the minimum and the maximum of the finite elements; a column of length numLimits + 5
+    Matrix<ElemType>& AssignHistogramOf(const Matrix<ElemType>& a, const Matrix<ElemType>& bucketLimits);
 
     ElemType LogSumOfElements() const;
 
@@ -511,8 +568,16 @@ public:
     Matrix<ElemType>& AddSignOf(const Matrix<ElemType>& a);
     void VectorMax(Matrix<ElemType>& maxIndexes, Matrix<ElemType>& maxValues, const bool isColWise) const;
     void VectorMax(Matrix<ElemType>& maxIndexes, Matrix<ElemType>& maxValues, const bool isColWise, int topK) const;
+    // Column-wise top k of the softmax of this matrix: the row indexes of the k largest elements of each column, their
+    // softmax probabilities, and the log-sum-exp of each column. The probabilities of the other elements are not computed.
+    void VectorTopKSoftmax(Matrix<ElemType>& topIndexes, Matrix<ElemType>& topValues, Matrix<ElemType>& logSumExp, int topK) const;
     void VectorMin(Matrix<ElemType>& minIndexes, Matrix<ElemType>& minValues, const bool isColWise) const;
 
+    // Moves the k elements of the largest magnitude out of the matrix: their linear indices and values are returned
+    // on the host and the elements are set to zero. ScatterAddValues() adds such a list (or several of them) back.
+    void ExtractTopKMagnitudes(size_t k, std::vector<int>& indices, std::vector<ElemType>& values);
+    void ScatterAddValues(const std::vector<int>& indices, const std::vector<ElemType>& values);
+
     Matrix<ElemType>& AssignNumOfDiff(const Matrix<ElemType>& a, const Matrix<ElemType>& b, bool searchInCol = false);
 
     Matrix<ElemType>& AssignInnerProductOfMatrices(const Matrix<ElemType>& a, const Matrix<ElemType>& b); // this method will resize(1,1) first
@@ -577,23 +642,47 @@ public:
     void MaxROIPoolingBackward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
                                const size_t pooledWidth, const size_t pooledHeight, const Matrix<ElemType>& roiData, Matrix<ElemType>& grad, Matrix<ElemType>& argmax, double spatialScale) const;
 
+    // ROI align: average of bilinearly sampled points of each bin, without quantizing the ROIs and bins.
+    void AverageROIAlignForward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
+                                const size_t pooledWidth, const size_t pooledHeight, const Matrix<ElemType>& roiData, Matrix<ElemType>& output, double spatialScale) const;
+
+    void AverageROIAlignBackward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
+                                 const size_t pooledWidth, const size_t pooledHeight, const Matrix<ElemType>& roiData, Matrix<ElemType>& grad, double spatialScale) const;
+
     void MaxUnpooling(const Matrix<int>& mpRowCol, const Matrix<int>& mpRowIndices, const Matrix<int>& indices, const Matrix<ElemType>& poolInput, Matrix<ElemType>& input) const;
 
     void AveragePoolingForward(const Matrix<int>& mpRowCol, const Matrix<int>& mpRowIndices, const Matrix<int>& indices, Matrix<ElemType>& output, const bool poolIncludePad) const;
     void AveragePoolingBackward(const Matrix<int>& mpRowCol, const Matrix<int>& mpRowIndices, const Matrix<int>& indices, Matrix<ElemType>& grad, const bool poolIncludePad, bool accumulateGradient) const;
 
+    // With reluOutput the output is max(0, BN(in)), computed in the same pass on the GPU. Its backward pass then takes
+    // that output as reluOutput, which masks the gradient of the outputs the ReLU clipped to 0.
     template<class StatType>
     void BatchNormalizationForward(const Matrix<StatType>& scale, const Matrix<StatType>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor,
                                    Matrix<StatType>& runMean, Matrix<StatType>& runVariance, Matrix<ElemType>& out, double epsilon,
-                                   Matrix<StatType>& saveMean, Matrix<StatType>& saveInvStdDev) const;
+                                   Matrix<StatType>& saveMean, Matrix<StatType>& saveInvStdDev, bool reluOutput = false) const;
 
     template<class StatType>
     void BatchNormalizationBackward(const Matrix<ElemType>& in, Matrix<ElemType>& grad, const Matrix<StatType>& scale, double blendFactor, const Matrix<StatType>& saveMean, const Matrix<StatType>& saveInvStdDev,
-                                    Matrix<StatType>& scaleGrad, Matrix<StatType>& biasGrad) const;
+                                    Matrix<StatType>& scaleGrad, Matrix<StatType>& biasGrad, const Matrix<ElemType>* reluOutput = nullptr) const;
+
+    // Normalizes each column of this to zero mean and unit variance over its rows, then applies the per-row scale and bias.
+    // The mean and inverse standard deviation of the columns are returned as [1 x numCols] matrices, for the backward pass.
+    void LayerNormalizationForward(const Matrix<ElemType>& scale, const Matrix<ElemType>& bias, double epsilon, Matrix<ElemType>& out,
+                                   Matrix<ElemType>& saveMean, Matrix<ElemType>& saveInvStdDev) const;
+    // this is the gradient of the output. Adds the gradient of the input 'in' to 'grad', and assigns the gradients of scale and bias.
+    void LayerNormalizationBackward(const Matrix<ElemType>& in, Matrix<ElemType>& grad, const Matrix<ElemType>& scale,
+                                    const Matrix<ElemType>& saveMean, const Matrix<ElemType>& saveInvStdDev,
+                                    Matrix<ElemType>& scaleGrad, Matrix<ElemType>& biasGrad) const;
 
     void RNNForward(const Matrix<ElemType>& inputX, const Matrix<ElemType>& paramW, size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame, const struct RnnAttributes& rnnAttributes, Matrix<ElemType>& reserve, Matrix<ElemType>& workspace);
     void RNNBackwardData(const Matrix<ElemType>& outputDY, const Matrix<ElemType>& paramW, Matrix<ElemType>& outputDX, const struct RnnAttributes& rnnAttributes, Matrix<ElemType>& reserve, Matrix<ElemType>& workspace);
     void RNNBackwardWeights(const Matrix<ElemType>& inputX, const Matrix<ElemType>& outputY, Matrix<ElemType>& dw, const struct RnnAttributes& rnnAttributes, Matrix<ElemType>& reserve, Matrix<ElemType>& workspace);
+    // Variants of RNNForward() and RNNBackwardData() that read and write the data in place in the minibatch layout, without packing:
+    // column t * numSequences + s holds frame t of sequence s, which has sequenceLengths[s] > 0 frames. The output columns beyond the
+    // end of a sequence are set to zero. *this only holds the RNN state, to be passed to the RNNBackward...() calls that follow. GPU only.
+    static bool IsRNNUnpackedLayoutSupported(DEVICEID_TYPE deviceId);
+    void RNNForwardUnpacked(const Matrix<ElemType>& inputX, const Matrix<ElemType>& paramW, Matrix<ElemType>& outputY, size_t xDim, size_t yDim, const vector<int>& sequenceLengths, const struct RnnAttributes& rnnAttributes, Matrix<ElemType>& reserve, Matrix<ElemType>& workspace);
+    void RNNBackwardDataUnpacked(const Matrix<ElemType>& outputY, const Matrix<ElemType>& outputDY, const Matrix<ElemType>& paramW, Matrix<ElemType>& outputDX, const struct RnnAttributes& rnnAttributes, Matrix<ElemType>& reserve, Matrix<ElemType>& workspace);
 
 public:
     // TODO: why are these not static? And why are they here?
@@ -659,6 +748,16 @@ public:
                      const SmallVector<size_t>& regularOpDims, const std::array<SmallVector<ptrdiff_t>, 2>& regularStrides,
                      const SmallVector<size_t>& reducingOpDims, const std::array<SmallVector<ptrdiff_t>, 2>& reducingStrides);
 
+    // this = beta * this + alpha * program(inputs), in a single pass over the elements of this, which has the size of
+    // the result. Each input has as many elements as this, or one per row (broadcast over the columns), or only one.
+    void ElementwiseProgramOp(ElemType beta, const std::vector<const Matrix<ElemType>*>& inputs, const ElementwiseProgram& program, ElemType alpha);
+
+    // this = beta * this + a .* mask / (1 - dropoutRate), where this has the size of a. The mask element of the i-th
+    // element of a (column-major) is 0 with probability dropoutRate and 1 otherwise, drawn from the counter-based
+    // generator at (seed, offset + i), see Philox4x32(). The mask is not stored: the same call with the gradient
+    // in place of a computes the gradient of the dropout.
+    void DropoutOp(ElemType beta, const Matrix<ElemType>& a, double dropoutRate, uint64_t seed, uint64_t offset);
+
 public:
     void Read(File& stream);
     void Write(File& stream) const;
@@ -712,5 +811,6 @@ File& operator<<(File& stream, const Matrix<ElemType>& M)
 typedef Matrix<float> SingleMatrix;
 typedef Matrix<double> DoubleMatrix;
 typedef Matrix<half> HalfMatrix;
+typedef Matrix<bfloat16> BFloat16Matrix;
 
 }}}
@@ -108,5 +108,6 @@ void MatrixQuantizerCPU<ElemType>::WaitUnquantizeAsyncDone()
 //The explicit instantiation part will make the linker happy
 template class MatrixQuantizerCPU<float>;
 template class MatrixQuantizerCPU<double>;
+template class MatrixQuantizerCPU<half>;
 
 }}}
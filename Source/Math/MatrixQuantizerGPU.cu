@@ -343,6 +343,7 @@ void MatrixQuantizerGPU<ElemType>::WaitUnquantizeAsyncDone()
 //explicit
 template class MatrixQuantizerGPU<float>;
 template class MatrixQuantizerGPU<double>;
+template class MatrixQuantizerGPU<half>;
 
 GPUMatrixComputeStreamEvent::GPUMatrixComputeStreamEvent(int deviceId)
     : MatrixComputeStreamEvent(deviceId)
@@ -382,4 +383,6 @@ template void GPUMatrixComputeStreamEvent::SynchronizeQuantizationComputeStreamW
 template void GPUMatrixComputeStreamEvent::SynchronizeQuantizationComputeStreamWithEvent<double>();
 template void GPUMatrixComputeStreamEvent::SynchronizeDataTransferFetchStreamWithEvent<float>();
 template void GPUMatrixComputeStreamEvent::SynchronizeDataTransferFetchStreamWithEvent<double>();
+template void GPUMatrixComputeStreamEvent::SynchronizeQuantizationComputeStreamWithEvent<half>();
+template void GPUMatrixComputeStreamEvent::SynchronizeDataTransferFetchStreamWithEvent<half>();
 } } }
@@ -27,6 +27,7 @@ template <class ElemType>
 
 template class MatrixQuantizerImpl<float>;
 template class MatrixQuantizerImpl<double>;
+template class MatrixQuantizerImpl<half>;
 
 MatrixComputeStreamEvent* MatrixComputeStreamEvent::Create(int deviceId)
 {
@@ -74,4 +75,6 @@ template MATH_API void MatrixComputeStreamEvent::SynchronizeQuantizationComputeS
 template MATH_API void MatrixComputeStreamEvent::SynchronizeQuantizationComputeStreamWithEvent<double>();
 template MATH_API void MatrixComputeStreamEvent::SynchronizeDataTransferFetchStreamWithEvent<float>();
 template MATH_API void MatrixComputeStreamEvent::SynchronizeDataTransferFetchStreamWithEvent<double>();
+template MATH_API void MatrixComputeStreamEvent::SynchronizeQuantizationComputeStreamWithEvent<half>();
+template MATH_API void MatrixComputeStreamEvent::SynchronizeDataTransferFetchStreamWithEvent<half>();
 } } }
@@ -140,8 +140,51 @@ __global__ void _ComputeQuantiStatParj(const ElemType* us, const ElemType* inRes
     const size_t colSizeByte = Microsoft::MSR::CNTK::QuantizedColumn<ElemType>::QuantizedColumnSize(bits, rows);
     auto& qcol = *(Microsoft::MSR::CNTK::QuantizedColumn<ElemType>*) &qpackage[colSizeByte * j];
 
+    typedef typename Microsoft::MSR::CNTK::ColumnQuantizer<ElemType>::CompType CompType;
     Microsoft::MSR::CNTK::ColumnQuantizer<ElemType>::ComputeRangeStatColjSubset<ZeroThresholdFor1Bit>(us, inResidual, M, j, bits, qcol.lower, qcol.upper,
-                                                                                                      subset, REDUCTION_BLOCK_SIZE, allreduce<ElemType, REDUCTION_BLOCK_SIZE>, allreduce<unsigned int, REDUCTION_BLOCK_SIZE>);
+                                                                                                      subset, REDUCTION_BLOCK_SIZE, allreduce<CompType, REDUCTION_BLOCK_SIZE>, allreduce<unsigned int, REDUCTION_BLOCK_SIZE>);
+}
+
+// columns up to this size are quantized by _QuantizeColjFused
+#define MAX_FUSED_COLUMN_BYTES (32 * 1024)
+
+// _ComputeQuantiStatParj and _QuantizeStripjOneQWord fused into one pass over the column, one column per *block*:
+// the sums of the input and the residual are read once into shared memory, and both the range statistics
+// and the quantization to bits and new residual work from there
+template <class ElemType, bool ZeroThresholdFor1Bit>
+__global__ void _QuantizeColjFused(
+    const ElemType* us,
+    const ElemType* curResidual,
+    long M, long N,
+    char* qMat,
+    size_t qColSize,
+    size_t numQWordsPerCol,
+    size_t ldNbits,
+    ElemType* newResidual)
+{
+    typedef typename Microsoft::MSR::CNTK::ColumnQuantizer<ElemType>::CompType CompType;
+    extern __shared__ char sharedColumn[];
+    CompType* vals = (CompType*) sharedColumn;
+
+    size_t j = blockIdx.x; // note: j is never out of range
+    for (size_t i = threadIdx.x; i < M; i += blockDim.x)
+    {
+        size_t ij = ColMIDX(i, j, M);
+        vals[i] = (CompType) us[ij] + (CompType) curResidual[ij];
+    }
+    __syncthreads();
+
+    // the range goes straight to the quantized column, written by the first thread
+    auto& qCol = *(Microsoft::MSR::CNTK::QuantizedColumn<ElemType>*) &qMat[qColSize * j];
+    Microsoft::MSR::CNTK::ColumnQuantizer<ElemType>::template ComputeRangeStatColjSubset<ZeroThresholdFor1Bit>(vals, (const CompType*) nullptr, M, 0, (size_t) 1 << ldNbits, qCol.lower, qCol.upper,
+                                                                                                               threadIdx.x, REDUCTION_BLOCK_SIZE, allreduce<CompType, REDUCTION_BLOCK_SIZE>, allreduce<unsigned int, REDUCTION_BLOCK_SIZE>);
+    __syncthreads();
+
+    // the residual may be updated in place, since the column was read before
+    const Microsoft::MSR::CNTK::ColumnQuantizer<ElemType> q(ldNbits, qCol.lower, qCol.upper);
+    ElemType* resj = newResidual + ColMIDX(0, j, M);
+    for (size_t iQWord = threadIdx.x; iQWord < numQWordsPerCol; iQWord += blockDim.x)
+        qCol.bits[iQWord] = q.template QuantizeOneQWordOfSums<ZeroThresholdFor1Bit>(vals, iQWord, M, numQWordsPerCol, resj);
 }
 
 //caller: griddim and blockdim should be both 1d
@@ -227,6 +270,21 @@ void _QuantizeMatrix(
 
     size_t nRow = M;
     size_t nCol = N;
+    const size_t numQWordsPerCol = Microsoft::MSR::CNTK::ColumnQuantizer<ElemType>::QWordsPerCol(nRow, Nbits);
+    const size_t colsizebyte = Microsoft::MSR::CNTK::QuantizedColumn<ElemType>::QuantizedColumnSize(Nbits, nRow);
+
+    // a column that fits into shared memory is read once, in a single pass
+    typedef typename Microsoft::MSR::CNTK::ColumnQuantizer<ElemType>::CompType CompType;
+    const size_t sharedColumnBytes = nRow * sizeof(CompType);
+    if (sharedColumnBytes <= MAX_FUSED_COLUMN_BYTES)
+    {
+        if (zeroThresholdFor1Bit)
+            _QuantizeColjFused<ElemType, true><<<(unsigned int) nCol, REDUCTION_BLOCK_SIZE, sharedColumnBytes, stream>>>(us, curResidual, M, N, qPackage, colsizebyte, numQWordsPerCol, ldNbits, newResidual);
+        else
+            _QuantizeColjFused<ElemType, false><<<(unsigned int) nCol, REDUCTION_BLOCK_SIZE, sharedColumnBytes, stream>>>(us, curResidual, M, N, qPackage, colsizebyte, numQWordsPerCol, ldNbits, newResidual);
+        return;
+    }
+
     dim3 mvgriddim, mvblockdim;
     // using specialized CUDA code (not shared with CPU) for collated memory access
     // each thread column computes 'warpsize' elements
@@ -254,11 +312,8 @@ void _QuantizeMatrix(
     //     - re-linearize block index and thread index
     //     - map to (i,j) coordinate (start of the set of floats)
 
-    const size_t numQWordsPerCol = Microsoft::MSR::CNTK::ColumnQuantizer<ElemType>::QWordsPerCol(nRow, Nbits);
     const size_t totalQWords = nCol * numQWordsPerCol;
 
-    const size_t colsizebyte = Microsoft::MSR::CNTK::QuantizedColumn<ElemType>::QuantizedColumnSize(Nbits, nRow);
-
     dim3 griddim, blockdim;
     ParallelizeOverRangeDim(totalQWords, griddim, blockdim, 256);
     if (zeroThresholdFor1Bit)
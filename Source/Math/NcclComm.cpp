@@ -10,6 +10,7 @@
 #include <nccl.h>
 #include <nvml.h>
 #include <cuda_runtime.h>
+#include "GpuTopology.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -20,6 +21,13 @@ static void operator||(cudaError_t rc, const char *msg)
         RuntimeError("%s: %s (cuda error %d)", msg, cudaGetErrorString(rc), (int) rc);
 }
 
+// same for NCCL
+static void operator||(ncclResult_t rc, const char *msg)
+{
+    if (rc != ncclSuccess)
+        RuntimeError("%s: %s", msg, ncclGetErrorString(rc));
+}
+
 ncclRedOp_t ncclRedOpFromMpiOp(MPI_Op op)
 {
     if (op == MPI_SUM) return ncclSum;
@@ -30,7 +38,8 @@ ncclRedOp_t ncclRedOpFromMpiOp(MPI_Op op)
 }
 
 NcclComm::NcclComm(int deviceId, const MPIWrapperPtr& mpi)
-    : m_ncclComm(nullptr), m_stream(nullptr)
+    : m_ncclComm(nullptr), m_stream(nullptr), m_overlapStream(nullptr), m_computeStreamEvent(nullptr),
+      m_hostComm(nullptr), m_crossHostComm(nullptr), m_numNodesOnHost(1), m_rankOnHost(0)
 {
     if (deviceId == CPUDEVICE)
     {
@@ -117,15 +126,135 @@ NcclComm::NcclComm(int deviceId, const MPIWrapperPtr& mpi)
         return;
     }
 
+    std::vector<std::string> deviceUUIDs;
+    for (const auto& deviceUUID : allDeviceUUIDs)
+        deviceUUIDs.push_back(deviceUUID.data());
+    InitHierarchicalComms(mpi, deviceUUIDs);
+
     cudaStreamCreateWithFlags(&m_stream, cudaStreamDefault)
         || "cudaStreamCreateWithFlags failed";
     fprintf(stderr, "NcclComm: initialized\n");
 }
 
+// With several GPUs on each of several hosts, AllReduce() works in two levels: a reduce-scatter among the GPUs
+// of a host, an all-reduce of each shard across hosts, and an all-gather among the GPUs of the host again.
+// This way, only 1/(GPUs per host) of the data crosses the network between hosts, from all GPUs in parallel.
+// This requires the same number of ranks on every host; otherwise the flat communicator is used.
+// The ranks of a host are ordered in the shortest ring through the NVLink and PCIe connections of their GPUs
+// (see GpuTopology.h), which is also the order in which BestGpu places them, so that ring neighbors are close.
+void NcclComm::InitHierarchicalComms(const MPIWrapperPtr& mpi, const std::vector<std::string>& deviceUUIDs)
+{
+#if NCCL_MAJOR >= 2 // ncclReduceScatter()/ncclAllGather() signatures of NCCL 2
+    if (!mpi->IsMultiHost() || (mpi->NumNodesOnCurrentHost() < 2))
+        return;
+
+    const size_t numRanks = mpi->NumNodesInUse();
+    int myTopology[3] = { (int) mpi->CurrentHostIndex(), (int) mpi->CurrentNodeRankOnHost(), (int) mpi->NumNodesOnCurrentHost() };
+    std::vector<int> allTopologies(3 * numRanks);
+    mpi->Allgather(myTopology, 3, MPI_INT, allTopologies.data(), 3, MPI_INT);
+    for (size_t r = 0; r < numRanks; r++)
+    {
+        if (allTopologies[3 * r + 2] != myTopology[2])
+        {
+            fprintf(stderr, "NcclComm: hierarchical reduction disabled, hosts run different numbers of ranks\n");
+            return;
+        }
+    }
+
+    // The rank on the host in ring order replaces the rank on the host of MPI, if all ranks could read their topology.
+    int myRingRank = -1;
+    if (nvmlInit() == NVML_SUCCESS)
+    {
+        std::vector<size_t> ranksOfHost;
+        std::vector<nvmlDevice_t> devicesOfHost;
+        bool haveTopology = true;
+        for (size_t r = 0; r < numRanks; r++)
+        {
+            if (allTopologies[3 * r] != myTopology[0])
+                continue;
+            nvmlDevice_t device = nullptr;
+            haveTopology = haveTopology && nvmlDeviceGetHandleByUUID(deviceUUIDs[r].c_str(), &device) == NVML_SUCCESS;
+            ranksOfHost.push_back(r);
+            devicesOfHost.push_back(device);
+        }
+        if (haveTopology)
+        {
+            std::vector<size_t> ring = GpuRingOrder(devicesOfHost);
+            for (size_t i = 0; i < ring.size(); i++)
+            {
+                if (ranksOfHost[ring[i]] == mpi->CurrentNodeRank())
+                    myRingRank = (int) i;
+            }
+        }
+        nvmlShutdown();
+    }
+    std::vector<int> allRingRanks(numRanks);
+    mpi->Allgather(&myRingRank, 1, MPI_INT, allRingRanks.data(), 1, MPI_INT);
+    if (std::all_of(allRingRanks.begin(), allRingRanks.end(), [](int ringRank) { return ringRank >= 0; }))
+    {
+        myTopology[1] = myRingRank;
+        for (size_t r = 0; r < numRanks; r++)
+            allTopologies[3 * r + 1] = allRingRanks[r];
+    }
+
+    // The first rank of each group creates the group's id: rank 0 on a host for the host,
+    // the rank on host 0 for the ranks across hosts that have the same rank on their host.
+    std::array<ncclUniqueId, 2> myIds = {};
+    if (myTopology[1] == 0)
+        ncclGetUniqueId(&myIds[0]);
+    if (myTopology[0] == 0)
+        ncclGetUniqueId(&myIds[1]);
+    std::vector<std::array<ncclUniqueId, 2>> allIds(numRanks);
+    mpi->Allgather(myIds.data(), sizeof(myIds), MPI_CHAR, allIds.data(), sizeof(myIds), MPI_CHAR);
+
+    ncclUniqueId hostId = {}, crossHostId = {};
+    for (size_t r = 0; r < numRanks; r++)
+    {
+        if (allTopologies[3 * r] == myTopology[0] && allTopologies[3 * r + 1] == 0)
+            hostId = allIds[r][0];
+        if (allTopologies[3 * r] == 0 && allTopologies[3 * r + 1] == myTopology[1])
+            crossHostId = allIds[r][1];
+    }
+
+    const size_t numHosts = mpi->NumHosts();
+    ncclResult_t res = ncclCommInitRank(&m_hostComm, myTopology[2], hostId, myTopology[1]);
+    if (res == ncclSuccess)
+        res = ncclCommInitRank(&m_crossHostComm, (int) numHosts, crossHostId, myTopology[0]);
+
+    // all ranks have to agree, since they must issue the same collectives
+    int succeeded = (res == ncclSuccess) ? 1 : 0;
+    mpi->AllReduce(&succeeded, 1, MPI_MIN);
+    if (!succeeded)
+    {
+        fprintf(stderr, "NcclComm: hierarchical reduction disabled, failed to initialize: %s\n", ncclGetErrorString(res));
+        if (m_crossHostComm != nullptr)
+            ncclCommDestroy(m_crossHostComm);
+        if (m_hostComm != nullptr)
+            ncclCommDestroy(m_hostComm);
+        m_crossHostComm = m_hostComm = nullptr;
+        return;
+    }
+
+    m_numNodesOnHost = myTopology[2];
+    m_rankOnHost = myTopology[1];
+    fprintf(stderr, "NcclComm: hierarchical reduction over %d hosts with %d GPUs each\n", (int) numHosts, (int) m_numNodesOnHost);
+#else
+    mpi;
+#endif
+}
+
 NcclComm::~NcclComm()
 {
     if (m_stream != nullptr)
         cudaStreamDestroy(m_stream);
+    if (m_overlapStream != nullptr)
+        cudaStreamDestroy(m_overlapStream);
+    if (m_computeStreamEvent != nullptr)
+        cudaEventDestroy(m_computeStreamEvent);
+    if (m_crossHostComm != nullptr)
+        ncclCommDestroy(m_crossHostComm);
+    if (m_hostComm != nullptr)
+        ncclCommDestroy(m_hostComm);
     if (m_ncclComm != nullptr)
         ncclCommDestroy(m_ncclComm);
 }
@@ -136,33 +265,97 @@ bool NcclComm::IsSupported()
 }
 
 void NcclComm::AllReduceImpl(void* inputbuffer, void *outputbuffer, size_t count, DataType dtype, MPI_Op op)
+{
+    AllReduceImpl(inputbuffer, outputbuffer, count, dtype, op, m_stream);
+}
+
+void NcclComm::AllReduceImpl(void* inputbuffer, void *outputbuffer, size_t count, DataType dtype, MPI_Op op, cudaStream_t stream)
 {
     ncclResult_t res;
     class NcclTypeLookup
     {
         ncclDataType_t ncclTypes[(int)DataType::COUNT];
+        size_t sizes[(int)DataType::COUNT];
     public:
         NcclTypeLookup()
         {
             ncclTypes[(int)DataType::FLOAT]  = ncclFloat;
             ncclTypes[(int)DataType::DOUBLE] = ncclDouble;
             ncclTypes[(int)DataType::HALF] = ncclHalf;
+            ncclTypes[(int)DataType::BFLOAT16] = ncclBfloat16;
             ncclTypes[(int)DataType::INT]    = ncclInt;
+            sizes[(int)DataType::FLOAT]  = sizeof(float);
+            sizes[(int)DataType::DOUBLE] = sizeof(double);
+            sizes[(int)DataType::HALF]   = sizeof(half);
+            sizes[(int)DataType::BFLOAT16] = sizeof(bfloat16);
+            sizes[(int)DataType::INT]    = sizeof(int);
         }
         ncclDataType_t Lookup(DataType dtype)
         {
             return ncclTypes[(int)dtype];
         }
+        size_t SizeOf(DataType dtype)
+        {
+            return sizes[(int)dtype];
+        }
     };
 
     static NcclTypeLookup s_ncclTypeLookup;
 
-    res = ncclAllReduce(inputbuffer, outputbuffer, count, s_ncclTypeLookup.Lookup(dtype), ncclRedOpFromMpiOp(op), m_ncclComm, m_stream);
+#if NCCL_MAJOR >= 2
+    // two-level reduction, see InitHierarchicalComms()
+    const size_t shardCount = count / m_numNodesOnHost;
+    if (m_hostComm != nullptr && shardCount > 0)
+    {
+        const size_t elemSize = s_ncclTypeLookup.SizeOf(dtype);
+        if (inputbuffer != outputbuffer)
+            cudaMemcpyAsync(outputbuffer, inputbuffer, count * elemSize, cudaMemcpyDeviceToDevice, stream) || "NcclComm: cudaMemcpyAsync failed";
+
+        char* buffer = (char*) outputbuffer;
+        char* shard = buffer + m_rankOnHost * shardCount * elemSize;
+        ncclReduceScatter(buffer, shard, shardCount, s_ncclTypeLookup.Lookup(dtype), ncclRedOpFromMpiOp(op), m_hostComm, stream) || "NcclComm ncclReduceScatter failed";
+        ncclAllReduce(shard, shard, shardCount, s_ncclTypeLookup.Lookup(dtype), ncclRedOpFromMpiOp(op), m_crossHostComm, stream) || "NcclComm ncclAllReduce failed";
+        ncclAllGather(shard, buffer, shardCount, s_ncclTypeLookup.Lookup(dtype), m_hostComm, stream) || "NcclComm ncclAllGather failed";
+
+        // the elements that do not divide evenly among the GPUs of a host are reduced directly
+        const size_t remainder = count - shardCount * m_numNodesOnHost;
+        if (remainder > 0)
+        {
+            char* tail = buffer + (count - remainder) * elemSize;
+            ncclAllReduce(tail, tail, remainder, s_ncclTypeLookup.Lookup(dtype), ncclRedOpFromMpiOp(op), m_ncclComm, stream) || "NcclComm ncclAllReduce failed";
+        }
+        return;
+    }
+#endif
+
+    res = ncclAllReduce(inputbuffer, outputbuffer, count, s_ncclTypeLookup.Lookup(dtype), ncclRedOpFromMpiOp(op), m_ncclComm, stream);
 
     if (res != ncclSuccess)
         RuntimeError("NcclComm ncclAllReduce failed: %s", ncclGetErrorString(res));
 }
 
+void NcclComm::AllReduceOverlappedImpl(void* buffer, size_t count, DataType dtype, MPI_Op op)
+{
+    // m_stream is a blocking stream and hence serialized with the (legacy default) compute stream;
+    // overlapping needs a stream that is not
+    if (m_overlapStream == nullptr)
+    {
+        cudaStreamCreateWithFlags(&m_overlapStream, cudaStreamNonBlocking)
+            || "cudaStreamCreateWithFlags failed";
+        cudaEventCreateWithFlags(&m_computeStreamEvent, cudaEventDisableTiming)
+            || "cudaEventCreateWithFlags failed";
+    }
+
+    cudaEventRecord(m_computeStreamEvent, GetStream()) || "NcclComm: cudaEventRecord failed";
+    cudaStreamWaitEvent(m_overlapStream, m_computeStreamEvent, 0) || "NcclComm: cudaStreamWaitEvent failed";
+    AllReduceImpl(buffer, buffer, count, dtype, op, m_overlapStream);
+}
+
+void NcclComm::AllReduceOnComputeStreamImpl(void* buffer, size_t count, DataType dtype, MPI_Op op)
+{
+    AllReduceImpl(buffer, buffer, count, dtype, op, GetStream());
+}
+
 void NcclComm::BroadcastImpl(void* buffer, size_t count, MPI_Datatype dtype, int root)
 {
     ncclResult_t res;
@@ -185,6 +378,12 @@ void NcclComm::Sync()
     cudaStreamSynchronize(m_stream) || "NcclComm: cudaStreamSynchronize failed";
 }
 
+void NcclComm::SyncOverlapped()
+{
+    if (m_overlapStream != nullptr)
+        cudaStreamSynchronize(m_overlapStream) || "NcclComm: cudaStreamSynchronize failed";
+}
+
 }}} // end namespaces
 
 #else // !USE_NCCL
@@ -201,5 +400,7 @@ bool NcclComm::IsSupported()
 
 void NcclComm::Sync() { }
 
+void NcclComm::SyncOverlapped() { }
+
 }}} // end namespaces
 #endif
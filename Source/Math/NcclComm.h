@@ -11,11 +11,13 @@
 #include "Matrix.h"
 #include "MPIWrapper.h"
 
+#include <string>
 #include <vector>
 #include <type_traits>
 
 // Forward declare CUDA stuff
 typedef struct CUstream_st* cudaStream_t;
+typedef struct CUevent_st* cudaEvent_t;
 typedef struct ncclComm* ncclComm_t;
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -29,13 +31,41 @@ private:
         FLOAT = 0,
         DOUBLE,
         HALF,
+        BFLOAT16,
         INT,
         COUNT,
     };
+    template <typename ElemType>
+    static DataType GetDataType()
+    {
+        if (std::is_same<ElemType, float>::value)
+            return DataType::FLOAT;
+        else if (std::is_same<ElemType, double>::value)
+            return DataType::DOUBLE;
+        else if (std::is_same<ElemType, half>::value)
+            return DataType::HALF;
+        else if (std::is_same<ElemType, bfloat16>::value)
+            return DataType::BFLOAT16;
+        else if (std::is_same<ElemType, int>::value)
+            return DataType::INT;
+        else
+            RuntimeError("NcclComm Unsupported reduction type");
+    }
     void AllReduceImpl(void* inputbuffer, void* outputbuffer, size_t count, DataType dtype, MPI_Op op);
+    void AllReduceImpl(void* inputbuffer, void* outputbuffer, size_t count, DataType dtype, MPI_Op op, cudaStream_t stream);
+    void AllReduceOverlappedImpl(void* buffer, size_t count, DataType dtype, MPI_Op op);
+    void AllReduceOnComputeStreamImpl(void* buffer, size_t count, DataType dtype, MPI_Op op);
     void BroadcastImpl(void* buffer, size_t count, MPI_Datatype dtype, int root);
+    void InitHierarchicalComms(const MPIWrapperPtr& mpi, const std::vector<std::string>& deviceUUIDs);
     cudaStream_t m_stream;
+    cudaStream_t m_overlapStream;        // non-blocking, created on first use by AllReduceOverlapped()
+    cudaEvent_t m_computeStreamEvent;   // orders m_overlapStream after the compute stream
     ncclComm_t m_ncclComm;
+    // two-level reductions across hosts, see InitHierarchicalComms(); null if not used
+    ncclComm_t m_hostComm;      // GPUs of this host
+    ncclComm_t m_crossHostComm; // GPUs with the same rank on their host, one per host
+    size_t m_numNodesOnHost;
+    size_t m_rankOnHost;
 #endif
 
 public:
@@ -48,17 +78,7 @@ public:
     void AllReduce(ElemType* inputBuffer, ElemType* outputBuffer, size_t count, MPI_Op op = MPI_SUM)
     {
 #ifdef USE_NCCL
-        DataType dtype = DataType::FLOAT;
-        if (std::is_same<ElemType, float>::value)
-            dtype = DataType::FLOAT;
-        else if (std::is_same<ElemType, double>::value)
-            dtype = DataType::DOUBLE;
-        else if (std::is_same<ElemType, half>::value)
-            dtype = DataType::HALF;
-        else if (std::is_same<ElemType, int>::value)
-            dtype = DataType::INT;
-        else
-            RuntimeError("NcclComm Unsupported reduction type");
+        DataType dtype = GetDataType<ElemType>();
 
         AllReduceImpl(inputBuffer, outputBuffer, count, dtype, op);
 #else
@@ -70,17 +90,7 @@ public:
     void AllReduce(const std::vector<Matrix<ElemType>*>& grads, MPI_Op op = MPI_SUM)
     {
 #ifdef USE_NCCL
-        DataType dtype = DataType::FLOAT;
-        if (std::is_same<ElemType, float>::value)
-            dtype = DataType::FLOAT;
-        else if (std::is_same<ElemType, double>::value)
-            dtype = DataType::DOUBLE;
-        else if (std::is_same<ElemType, half>::value)
-            dtype = DataType::HALF;
-        else if (std::is_same<ElemType, int>::value)
-            dtype = DataType::INT;
-        else
-            RuntimeError("NcclComm Unsupported reduction type");
+        DataType dtype = GetDataType<ElemType>();
 
         for (size_t i=0; i<grads.size(); ++i)
         {
@@ -93,6 +103,33 @@ public:
 #endif
     }
 
+    // Starts an in-place reduction on a separate non-blocking stream. The reduction is ordered after all work
+    // issued to the compute stream so far, but work issued to the compute stream afterwards does not wait
+    // for it, so it overlaps with e.g. the remaining backprop. Complete with SyncOverlapped() before using the result.
+    template <typename ElemType>
+    void AllReduceOverlapped(ElemType* buffer, size_t count, MPI_Op op = MPI_SUM)
+    {
+#ifdef USE_NCCL
+        AllReduceOverlappedImpl(buffer, count, GetDataType<ElemType>(), op);
+#else
+        RuntimeError("NcclComm: CNTK was built without NCCL support.");
+#endif
+    }
+
+    void SyncOverlapped(); // waits for outstanding reductions started by AllReduceOverlapped() to complete
+
+    // Queues an in-place reduction on the compute stream: work issued to it afterwards uses the result, without
+    // the host waiting for it, so the host goes on issuing kernels while the reduction runs.
+    template <typename ElemType>
+    void AllReduceOnComputeStream(ElemType* buffer, size_t count, MPI_Op op = MPI_SUM)
+    {
+#ifdef USE_NCCL
+        AllReduceOnComputeStreamImpl(buffer, count, GetDataType<ElemType>(), op);
+#else
+        RuntimeError("NcclComm: CNTK was built without NCCL support.");
+#endif
+    }
+
     void Broadcast(void* buffer, size_t count, MPI_Datatype dtype, int root)
     {
 #ifdef USE_NCCL
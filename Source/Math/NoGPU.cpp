@@ -15,6 +15,10 @@
 #include "CuDnnFactories.h"
 #include "TensorShape.h"
 #include "GPUDataTransferer.h"
+#include "GPUGraph.h"
+#include "GPUStreamPool.h"
+#include "GPUStreamContext.h"
+#include "GPUEventTimer.h"
 
 #pragma warning(disable : 4100) // unreferenced formal parameter, which is OK since all functions in here are dummies; disabling this allows to copy-paste prototypes here when we add new functions
 #pragma warning(disable : 4702) // unreachable code, which we get from the NOT_IMPLEMENTED macro which is OK
@@ -30,6 +34,19 @@ MATH_API std::size_t GetCUDNNVersion()
 
 void PrepareDevice(DEVICEID_TYPE deviceId);
 
+void TracingGPUMemoryAllocator::EmptyCache(int /*deviceId*/)
+{
+}
+
+GPUMemoryCacheStats TracingGPUMemoryAllocator::GetCacheStats(int /*deviceId*/)
+{
+    return GPUMemoryCacheStats();
+}
+
+void TracingGPUMemoryAllocator::ResetPeakStats(int /*deviceId*/)
+{
+}
+
 template <class ElemType>
 GPUSPARSE_INDEX_TYPE GPUSparseMatrix<ElemType>::SecondaryIndexValueAt(size_t idx) const
 {
@@ -261,6 +278,12 @@ void GPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const GPUMatrix<E
 {
 }
 
+template <class ElemType>
+GPUSparseMatrix<ElemType>& GPUSparseMatrix<ElemType>::ScatterToIndices(const GPUMatrix<ElemType>& values, const GPUMatrix<ElemType>& indices, size_t row_elements, const GPUMatrix<char>* mask /*= nullptr*/)
+{
+    return *this;
+}
+
 template <class ElemType>
 void GPUSparseMatrix<ElemType>::ColumnwiseScaleAndWeightedAdd(ElemType alpha, const GPUSparseMatrix<ElemType>& a, const GPUMatrix<ElemType>& v, ElemType beta, GPUMatrix<ElemType>& c)
 {
@@ -280,7 +303,7 @@ GPUSparseMatrix<ElemType>& GPUSparseMatrix<ElemType>::InplaceTruncate(const Elem
 
 // normal update for smoothed gradients c and current gradients (this)
 template <class ElemType>
-void GPUSparseMatrix<ElemType>::NormalGrad(GPUMatrix<ElemType>& c, const ElemType momentum, ElemType unitGainFactor)
+void GPUSparseMatrix<ElemType>::NormalGrad(GPUMatrix<ElemType>& c, const ElemType momentum, ElemType unitGainFactor, int* timestamps, int currentTimestamp)
 {
 }
 template <class ElemType>
@@ -295,7 +318,8 @@ void GPUSparseMatrix<ElemType>::FSAdagrad(GPUMatrix<ElemType>&, GPUMatrix<ElemTy
 }
 
 template<class ElemType>
-void GPUSparseMatrix<ElemType>::Adam(GPUMatrix<ElemType>& c, GPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample, ElemType momentum, ElemType adaWeight, ElemType adaMul, ElemType epsilon, ElemType unitGainFactor, bool adamax)
+void GPUSparseMatrix<ElemType>::Adam(GPUMatrix<ElemType>& c, GPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample, ElemType momentum, ElemType adaWeight, ElemType adaMul, ElemType epsilon, ElemType unitGainFactor, bool adamax,
+                                     bool lazy, int* timestamps, int currentTimestamp)
 {
 }
 
@@ -796,6 +820,7 @@ template class MATH_API GPUSparseMatrix<char>;
 template class MATH_API GPUSparseMatrix<float>;
 template class MATH_API GPUSparseMatrix<double>;
 template class MATH_API GPUSparseMatrix<half>;
+template class MATH_API GPUSparseMatrix<bfloat16>;
 template class MATH_API GPUSparseMatrix<int>;
 
 template <typename ElemType>
@@ -807,6 +832,7 @@ MATH_API File& operator>>(File& stream, GPUSparseMatrix<ElemType>& us)
 template MATH_API File& operator>>(File& stream, GPUSparseMatrix<float>& us);
 template MATH_API File& operator>>(File& stream, GPUSparseMatrix<double>& us);
 template MATH_API File& operator>>(File& stream, GPUSparseMatrix<half>& us);
+template MATH_API File& operator>>(File& stream, GPUSparseMatrix<bfloat16>& us);
 
 template <typename ElemType>
 MATH_API File& operator<<(File& stream, const GPUSparseMatrix<ElemType>& us)
@@ -816,6 +842,7 @@ MATH_API File& operator<<(File& stream, const GPUSparseMatrix<ElemType>& us)
 template MATH_API File& operator<<(File& stream, const GPUSparseMatrix<float>& us);
 template MATH_API File& operator<<(File& stream, const GPUSparseMatrix<double>& us);
 template MATH_API File& operator<<(File& stream, const GPUSparseMatrix<half>& us);
+template MATH_API File& operator<<(File& stream, const GPUSparseMatrix<bfloat16>& us);
 
 #pragma region DeviceBoundNumber class
 
@@ -882,6 +909,11 @@ void GPUMatrix<ElemType>::ChangeDeviceTo(int to_id)
 {
 }
 
+template <class ElemType>
+void GPUMatrix<ElemType>::ChangeDeviceToAsync(int to_id)
+{
+}
+
 template <class ElemType>
 void GPUMatrix<ElemType>::performElementWiseFunction(const ElementWiseOperator kind, const ElemType* src)
 {
@@ -1051,13 +1083,38 @@ GPUMatrix<ElemType>& GPUMatrix<ElemType>::DoScatterColumnsOf(ElemType beta, cons
 }
 
 template <class ElemType>
-GPUMatrix<ElemType>& GPUMatrix<ElemType>::GatherFromTarget(const GPUMatrix<ElemType>& indices, const GPUMatrix<ElemType>& target, size_t row_elements)
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignDequantizedColumnsOf(const GPUMatrix<ElemType>& idx, const GPUMatrix<char>& codes, const GPUMatrix<ElemType>& scalesAndOffsets)
 {
     return *this;
 }
 
 template <class ElemType>
-GPUMatrix<ElemType>& GPUMatrix<ElemType>::ScatterToIndices(const GPUMatrix<ElemType>& values, const GPUMatrix<ElemType>& indices, size_t row_elements, const GPUMatrix<char>* mask/* = nullptr*/)
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignDequantizedColumnsOf(const GPUMatrix<ElemType>& idx, const GPUMatrix<half>& codes, const GPUMatrix<ElemType>& scalesAndOffsets)
+{
+    return *this;
+}
+
+template <class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignSegmentedReductionOf(const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& segments, size_t columnStride, ElementWiseOperator reductionOp, bool average)
+{
+    return *this;
+}
+
+template <class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::DoSegmentedReductionGradientOf(ElemType beta, const GPUMatrix<ElemType>& outputGradient, const GPUMatrix<ElemType>& input, const GPUMatrix<ElemType>& output,
+                                                                         const GPUMatrix<ElemType>& segments, size_t columnStride, ElementWiseOperator reductionOp, bool average)
+{
+    return *this;
+}
+
+template <class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::GatherFromTarget(const GPUMatrix<ElemType>& indices, const GPUMatrix<ElemType>& target, size_t row_elements, size_t outer_elements)
+{
+    return *this;
+}
+
+template <class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::ScatterToIndices(const GPUMatrix<ElemType>& values, const GPUMatrix<ElemType>& indices, size_t row_elements, size_t outer_elements, const GPUMatrix<char>* mask/* = nullptr*/)
 {
     return *this;
 }
@@ -1181,6 +1238,23 @@ void GPUMatrix<ElemType>::Adam(GPUMatrix<ElemType>& gradients, GPUMatrix<ElemTyp
 
 }
 
+template <class ElemType>
+void GPUMatrix<ElemType>::MultiTensorUpdate(const MultiTensorUpdateParameters<ElemType>& update, const std::vector<GPUMatrix<ElemType>*>& parameters,
+                                            const std::vector<const GPUMatrix<ElemType>*>& gradients, const std::vector<GPUMatrix<ElemType>*>& smoothedGradients)
+{
+}
+
+template <class ElemType>
+ElemType GPUMatrix<ElemType>::MultiTensorSumOfSquares(const std::vector<const GPUMatrix<ElemType>*>& matrices)
+{
+    return 0;
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::MultiTensorSumsOfSquares(const std::vector<const GPUMatrix<ElemType>*>& matrices, std::vector<ElemType>& sums)
+{
+}
+
 template <class ElemType>
 ElemType GPUMatrix<ElemType>::RmsProp(GPUMatrix<ElemType>& gradients, ElemType RMS_GAMMA, ElemType RMS_WGT_INC, ElemType RMS_WGT_MAX, ElemType RMS_WGT_DEC, ElemType RMS_WGT_MIN, const bool needAveMultiplier, const bool initialized)
 {
@@ -1198,6 +1272,11 @@ void GPUMatrix<ElemType>::AdaDeltaFlushTimestamps(size_t cols, ElemType rho, int
 {
 }
 
+template <class ElemType>
+void GPUMatrix<ElemType>::LazyDecayFlushTimestamps(size_t cols, ElemType decay, ElemType secondDecay, int* timestamps, int currentTimestamp)
+{
+}
+
 template <class ElemType>
 void GPUMatrix<ElemType>::Reshape(const size_t numRows, const size_t numCols)
 {
@@ -1472,6 +1551,12 @@ GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignLogSoftmaxOf(const GPUMatrix<Ele
     return *this;
 }
 
+template <class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::InplaceSegmentedLogSoftmax(const std::vector<int>& /*segmentOffsets*/)
+{
+    return *this;
+}
+
 template <class ElemType>
 GPUMatrix<ElemType>& GPUMatrix<ElemType>::InplaceHardmax(const bool isColWise)
 {
@@ -1503,6 +1588,26 @@ GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignCTCScore(const GPUMatrix<ElemTyp
     return *this;
 }
 
+template <class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignEditDistances(const GPUMatrix<ElemType>& firstSeq, const GPUMatrix<ElemType>& secondSeq, const std::vector<size_t>& uttToChanInd,
+    const std::vector<size_t>& uttBeginFrame, const std::vector<size_t>& uttFrameNum, const size_t numParallelSequences,
+    const float subPen, const float delPen, const float insPen, const bool squashInputs, const std::vector<size_t>& tokensToIgnore)
+{
+    return *this;
+}
+
+template <class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignLambdaRankRanks(const GPUMatrix<ElemType>& gains, const GPUMatrix<ElemType>& scores, const std::vector<size_t>& queryBegins, GPUMatrix<ElemType>& metrics)
+{
+    return *this;
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::AddLambdaRankGradient(const GPUMatrix<ElemType>& gains, const GPUMatrix<ElemType>& scores, const GPUMatrix<ElemType>& ranks, const GPUMatrix<ElemType>& metrics,
+    const std::vector<size_t>& queryBegins, const ElemType sigma, GPUMatrix<ElemType>& gradient)
+{
+}
+
 template <class ElemType>
 GPUMatrix<ElemType>& GPUMatrix<ElemType>::InplaceSqrt()
 {
@@ -1717,6 +1822,12 @@ GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignSumOfElements(const GPUMatrix<El
 {
     return (*this);
 }
+
+template <class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignHistogramOf(const GPUMatrix<ElemType>& /*a*/, const GPUMatrix<ElemType>& /*bucketLimits*/)
+{
+    return (*this);
+}
 template <class ElemType>
 void GPUMatrix<ElemType>::MinusOneAt(GPUMatrix<ElemType>& c, const size_t position)
 {
@@ -1925,11 +2036,26 @@ void GPUMatrix<ElemType>::VectorMax(GPUMatrix<ElemType>& maxIndexes, GPUMatrix<E
 {
 }
 
+template <class ElemType>
+void GPUMatrix<ElemType>::VectorTopKSoftmax(GPUMatrix<ElemType>& topIndexes, GPUMatrix<ElemType>& topValues, GPUMatrix<ElemType>& logSumExp, int topK) const
+{
+}
+
 template <class ElemType>
 void GPUMatrix<ElemType>::VectorMin(GPUMatrix<ElemType>& minIndexes, GPUMatrix<ElemType>& minValues, const bool isColWise) const
 {
 }
 
+template <class ElemType>
+void GPUMatrix<ElemType>::ExtractTopKMagnitudes(size_t k, std::vector<int>& indices, std::vector<ElemType>& values)
+{
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::ScatterAddValues(const std::vector<int>& indices, const std::vector<ElemType>& values)
+{
+}
+
 template <class ElemType>
 GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignNumOfDiff(const GPUMatrix<ElemType>& /*a*/, const GPUMatrix<ElemType>& /*b*/, bool /*searchInCol = false*/)
 {
@@ -2039,6 +2165,18 @@ void GPUMatrix<ElemType>::MaxROIPoolingBackward(const size_t numRois, const size
 {
 }
 
+template <class ElemType>
+void GPUMatrix<ElemType>::AverageROIAlignForward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
+    const size_t pooledWidth, const size_t pooledHeight, const GPUMatrix<ElemType>& roiData, GPUMatrix<ElemType>& output, double spatialScale) const
+{
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::AverageROIAlignBackward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
+    const size_t pooledWidth, const size_t pooledHeight, const GPUMatrix<ElemType>& roiData, GPUMatrix<ElemType>& grad, double spatialScale) const
+{
+}
+
 template <class ElemType>
 void GPUMatrix<ElemType>::MaxPoolingForward(const GPUMatrix<int>& mpRowCol, const GPUMatrix<int>& mpRowIndices, const GPUMatrix<int>& indices, GPUMatrix<ElemType>& output) const
 {
@@ -2070,7 +2208,7 @@ template <class ElemType>
 template <class StatType>
 void GPUMatrix<ElemType>::BatchNormalizationForward(const GPUMatrix<StatType>& scale, const GPUMatrix<StatType>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor,
                                                     GPUMatrix<StatType>& runMean, GPUMatrix<StatType>& runVariance, GPUMatrix<ElemType>& out, double epsilon,
-                                                    GPUMatrix<StatType>& saveMean, GPUMatrix<StatType>& saveInvStdDev) const
+                                                    GPUMatrix<StatType>& saveMean, GPUMatrix<StatType>& saveInvStdDev, bool reluOutput) const
 {
 }
 
@@ -2078,7 +2216,20 @@ template <class ElemType>
 template <class StatType>
 void GPUMatrix<ElemType>::BatchNormalizationBackward(const GPUMatrix<ElemType>& in, GPUMatrix<ElemType>& grad, const GPUMatrix<StatType>& scale, double blendFactor,
                                                      const GPUMatrix<StatType>& saveMean, const GPUMatrix<StatType>& saveInvStdDev,
-                                                     GPUMatrix<StatType>& scaleGrad, GPUMatrix<StatType>& biasGrad) const
+                                                     GPUMatrix<StatType>& scaleGrad, GPUMatrix<StatType>& biasGrad, const GPUMatrix<ElemType>* reluOutput) const
+{
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::LayerNormalizationForward(const GPUMatrix<ElemType>& scale, const GPUMatrix<ElemType>& bias, double epsilon, GPUMatrix<ElemType>& out,
+                                                    GPUMatrix<ElemType>& saveMean, GPUMatrix<ElemType>& saveInvStdDev) const
+{
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::LayerNormalizationBackward(const GPUMatrix<ElemType>& in, GPUMatrix<ElemType>& grad, const GPUMatrix<ElemType>& scale,
+                                                     const GPUMatrix<ElemType>& saveMean, const GPUMatrix<ElemType>& saveInvStdDev,
+                                                     GPUMatrix<ElemType>& scaleGrad, GPUMatrix<ElemType>& biasGrad) const
 {
 }
 
@@ -2097,6 +2248,22 @@ void GPUMatrix<ElemType>::RNNBackwardWeights(const GPUMatrix<ElemType>& inputX,
 {
 }
 
+template <class ElemType>
+/*static*/ bool GPUMatrix<ElemType>::IsRNNUnpackedLayoutSupported()
+{
+    return false;
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::RNNForwardUnpacked(const GPUMatrix<ElemType>& inputX, const GPUMatrix<ElemType>& paramW, GPUMatrix<ElemType>& outputY, size_t xDim, size_t yDim, const vector<int>& sequenceLengths, const RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace)
+{
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::RNNBackwardDataUnpacked(const GPUMatrix<ElemType>& outputY, const GPUMatrix<ElemType>& outputDY, const GPUMatrix<ElemType>& paramW, GPUMatrix<ElemType>& outputDX, const RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace)
+{
+}
+
 #pragma endregion Other helper functions
 
 #pragma region Static BLAS Functions
@@ -2293,6 +2460,16 @@ void GPUMatrix<ElemType>::TensorArgOp(const GPUMatrix<ElemType>& a, ElementWiseO
 {
 }
 
+template <class ElemType>
+void GPUMatrix<ElemType>::ElementwiseProgramOp(ElemType beta, const std::vector<const GPUMatrix<ElemType>*>& inputs, const ElementwiseProgram& program, ElemType alpha)
+{
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::DropoutOp(ElemType beta, const GPUMatrix<ElemType>& a, double dropoutRate, uint64_t seed, uint64_t offset)
+{
+}
+
 template <class ElemType>
 void GPUMatrix<ElemType>::CreateCurandObject(unsigned long seed, const char* caller)
 {
@@ -2448,6 +2625,10 @@ template <>
 void GPUMatrixComputeStreamEvent::SynchronizeDataTransferFetchStreamWithEvent<float>(){};
 template <>
 void GPUMatrixComputeStreamEvent::SynchronizeDataTransferFetchStreamWithEvent<double>(){};
+template <>
+void GPUMatrixComputeStreamEvent::SynchronizeQuantizationComputeStreamWithEvent<half>(){};
+template <>
+void GPUMatrixComputeStreamEvent::SynchronizeDataTransferFetchStreamWithEvent<half>(){};
 
 #pragma endregion GPUMatrixComputeStreamEvent functions
 
@@ -2467,6 +2648,8 @@ void GranularGPUDataTransferer::RecordCPUToGPUCopy() {}
 
 void GranularGPUDataTransferer::WaitForCopyCPUToGPU() {}
 
+void GranularGPUDataTransferer::WaitForCopyCPUToGPUOnComputeStreamAsync() {}
+
 void GranularGPUDataTransferer::RecordComputeStreamSyncPoint() {}
 
 void GranularGPUDataTransferer::WaitForSyncPointOnFetchStreamAsync() {}
@@ -2499,74 +2682,153 @@ GPURNGHandle::GPURNGHandle(int deviceId, uint64_t seed, uint64_t offset)
 
 #pragma endregion GPURNGHandle functions
 
+#pragma region GPUGraph functions
+
+GPUGraph::GPUGraph(DEVICEID_TYPE deviceId) : m_deviceId(deviceId), m_graph(nullptr), m_graphExec(nullptr) {}
+GPUGraph::~GPUGraph() {}
+void GPUGraph::Reset() {}
+/*static*/ bool GPUGraph::IsSupported() { return false; }
+void GPUGraph::Run(const std::function<void()>& work) { work(); }
+bool GPUGraph::Capture(const std::function<void()>&) { return false; }
+void GPUGraph::Replay() {}
+
+#pragma endregion GPUGraph functions
+
+#pragma region GPUStreamPool functions
+
+GPUStreamPool::GPUStreamPool(DEVICEID_TYPE deviceId, size_t, size_t) : m_deviceId(deviceId), m_selected(0), m_active(false) {}
+GPUStreamPool::~GPUStreamPool() {}
+void GPUStreamPool::Begin() {}
+void GPUStreamPool::Select(size_t) {}
+void GPUStreamPool::RecordEvent(size_t) {}
+void GPUStreamPool::WaitEvent(size_t) {}
+void GPUStreamPool::End() {}
+
+#pragma endregion GPUStreamPool functions
+
+#pragma region GPUStreamContext functions
+
+GPUStreamContext::GPUStreamContext(DEVICEID_TYPE deviceId, int priority)
+    : m_deviceId(deviceId), m_priority(priority), m_stream(nullptr), m_cublasHandle(nullptr), m_cusparseHandle(nullptr), m_previousContext(nullptr), m_previousStream(nullptr), m_entered(false)
+{
+    InvalidArgument("GPUStreamContext: Requires a GPU device.");
+}
+GPUStreamContext::~GPUStreamContext() {}
+/*static*/ void GPUStreamContext::GetPriorityRange(DEVICEID_TYPE, int& lowest, int& highest) { lowest = highest = 0; }
+/*static*/ GPUStreamContext* GPUStreamContext::Current() { return nullptr; }
+void GPUStreamContext::Enter() {}
+void GPUStreamContext::Exit() {}
+
+#pragma endregion GPUStreamContext functions
+
+#pragma region GPUEventTimer functions
+
+GPUEventTimer::GPUEventTimer(DEVICEID_TYPE deviceId) : m_deviceId(deviceId), m_startEvent(nullptr), m_stopEvent(nullptr), m_started(false), m_pending(false), m_elapsedSeconds(0) {}
+GPUEventTimer::~GPUEventTimer() {}
+void GPUEventTimer::Start() {}
+void GPUEventTimer::Stop() {}
+double GPUEventTimer::ElapsedSeconds() { return 0; }
+void GPUEventTimer::Reset() {}
+void GPUEventTimer::Accumulate() {}
+
+#pragma endregion GPUEventTimer functions
+
 template class GPUMatrix<short>;
 template class GPUMatrix<char>;
 template class GPUMatrix<float>;
 template class GPUMatrix<double>;
 template class GPUMatrix<half>;
+template class GPUMatrix<bfloat16>;
 template class GPUMatrix<int>;
 template class DeviceBoundNumber<float>;
 template class DeviceBoundNumber<double>;
 template class DeviceBoundNumber<half>;
+template class DeviceBoundNumber<bfloat16>;
 template MatrixQuantizerGPU<float>::~MatrixQuantizerGPU();
 template MatrixQuantizerGPU<double>::~MatrixQuantizerGPU();
 template void MatrixQuantizerGPU<float>::QuantizeAsync(const Matrix<float>&, const Matrix<float>&, QuantizedMatrix<float>&, Matrix<float>&, bool);
 template void MatrixQuantizerGPU<double>::QuantizeAsync(const Matrix<double>&, const Matrix<double>&, QuantizedMatrix<double>&, Matrix<double>&, bool);
+template MatrixQuantizerGPU<half>::~MatrixQuantizerGPU();
+template void MatrixQuantizerGPU<half>::QuantizeAsync(const Matrix<half>&, const Matrix<half>&, QuantizedMatrix<half>&, Matrix<half>&, bool);
 
 template void GPUMatrix<char>::CastAssignValuesOf<float>(const GPUMatrix<float>* other);
 template void GPUMatrix<char>::CastAssignValuesOf<double>(const GPUMatrix<double>* other);
 template void GPUMatrix<char>::CastAssignValuesOf<half>(const GPUMatrix<half>* other);
+template void GPUMatrix<char>::CastAssignValuesOf<bfloat16>(const GPUMatrix<bfloat16>* other);
 template void GPUMatrix<short>::CastAssignValuesOf<float>(const GPUMatrix<float>* other);
 template void GPUMatrix<short>::CastAssignValuesOf<double>(const GPUMatrix<double>* other);
 template void GPUMatrix<short>::CastAssignValuesOf<half>(const GPUMatrix<half>* other);
+template void GPUMatrix<short>::CastAssignValuesOf<bfloat16>(const GPUMatrix<bfloat16>* other);
 template void GPUMatrix<int>::CastAssignValuesOf<float>(const GPUMatrix<float>* other);
 template void GPUMatrix<int>::CastAssignValuesOf<double>(const GPUMatrix<double>* other);
 template void GPUMatrix<int>::CastAssignValuesOf<half>(const GPUMatrix<half>* other);
+template void GPUMatrix<int>::CastAssignValuesOf<bfloat16>(const GPUMatrix<bfloat16>* other);
 template void GPUMatrix<float>::CastAssignValuesOf<float>(const GPUMatrix<float>* other);
 template void GPUMatrix<float>::CastAssignValuesOf<double>(const GPUMatrix<double>* other);
 template void GPUMatrix<float>::CastAssignValuesOf<half>(const GPUMatrix<half>* other);
+template void GPUMatrix<float>::CastAssignValuesOf<bfloat16>(const GPUMatrix<bfloat16>* other);
 template void GPUMatrix<double>::CastAssignValuesOf<float>(const GPUMatrix<float>* other);
 template void GPUMatrix<double>::CastAssignValuesOf<double>(const GPUMatrix<double>* other);
 template void GPUMatrix<double>::CastAssignValuesOf<half>(const GPUMatrix<half>* other);
+template void GPUMatrix<double>::CastAssignValuesOf<bfloat16>(const GPUMatrix<bfloat16>* other);
 template void GPUMatrix<half>::CastAssignValuesOf<float>(const GPUMatrix<float>* other);
 template void GPUMatrix<half>::CastAssignValuesOf<double>(const GPUMatrix<double>* other);
 template void GPUMatrix<half>::CastAssignValuesOf<half>(const GPUMatrix<half>* other);
+template void GPUMatrix<half>::CastAssignValuesOf<bfloat16>(const GPUMatrix<bfloat16>* other);
+template void GPUMatrix<bfloat16>::CastAssignValuesOf<float>(const GPUMatrix<float>* other);
+template void GPUMatrix<bfloat16>::CastAssignValuesOf<double>(const GPUMatrix<double>* other);
+template void GPUMatrix<bfloat16>::CastAssignValuesOf<half>(const GPUMatrix<half>* other);
+template void GPUMatrix<bfloat16>::CastAssignValuesOf<bfloat16>(const GPUMatrix<bfloat16>* other);
 
 template void GPUMatrix<float>::AdaDelta<float>(GPUMatrix<float>& gradients, GPUMatrix<float>& functionValues, float learningRate, float rho, float epsilon);
 template void GPUMatrix<double>::AdaDelta<double>(GPUMatrix<double>& gradients, GPUMatrix<double>& functionValues, double learningRate, double rho, double epsilon);
 template void GPUMatrix<float>::AdaDelta<half>(GPUMatrix<half>& gradients, GPUMatrix<float>& functionValues, float learningRate, float rho, float epsilon);
+template void GPUMatrix<float>::AdaDelta<bfloat16>(GPUMatrix<bfloat16>& gradients, GPUMatrix<float>& functionValues, float learningRate, float rho, float epsilon);
 
-template void GPUMatrix<float>::BatchNormalizationForward(const GPUMatrix<float>& scale, const GPUMatrix<float>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, GPUMatrix<float>& runMean, GPUMatrix<float>& runVariance, GPUMatrix<float>& out, double epsilon, GPUMatrix<float>& saveMean, GPUMatrix<float>& saveInvStdDev) const;
-template void GPUMatrix<double>::BatchNormalizationForward(const GPUMatrix<double>& scale, const GPUMatrix<double>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, GPUMatrix<double>& runMean, GPUMatrix<double>& runVariance, GPUMatrix<double>& out, double epsilon, GPUMatrix<double>& saveMean, GPUMatrix<double>& saveInvStdDev) const;
-template void GPUMatrix<half>::BatchNormalizationForward(const GPUMatrix<float>& scale, const GPUMatrix<float>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, GPUMatrix<float>& runMean, GPUMatrix<float>& runVariance, GPUMatrix<half>& out, double epsilon, GPUMatrix<float>& saveMean, GPUMatrix<float>& saveInvStdDev) const;
+template void GPUMatrix<float>::BatchNormalizationForward(const GPUMatrix<float>& scale, const GPUMatrix<float>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, GPUMatrix<float>& runMean, GPUMatrix<float>& runVariance, GPUMatrix<float>& out, double epsilon, GPUMatrix<float>& saveMean, GPUMatrix<float>& saveInvStdDev, bool reluOutput) const;
+template void GPUMatrix<double>::BatchNormalizationForward(const GPUMatrix<double>& scale, const GPUMatrix<double>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, GPUMatrix<double>& runMean, GPUMatrix<double>& runVariance, GPUMatrix<double>& out, double epsilon, GPUMatrix<double>& saveMean, GPUMatrix<double>& saveInvStdDev, bool reluOutput) const;
+template void GPUMatrix<half>::BatchNormalizationForward(const GPUMatrix<float>& scale, const GPUMatrix<float>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, GPUMatrix<float>& runMean, GPUMatrix<float>& runVariance, GPUMatrix<half>& out, double epsilon, GPUMatrix<float>& saveMean, GPUMatrix<float>& saveInvStdDev, bool reluOutput) const;
+template void GPUMatrix<bfloat16>::BatchNormalizationForward(const GPUMatrix<float>& scale, const GPUMatrix<float>& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, GPUMatrix<float>& runMean, GPUMatrix<float>& runVariance, GPUMatrix<bfloat16>& out, double epsilon, GPUMatrix<float>& saveMean, GPUMatrix<float>& saveInvStdDev, bool reluOutput) const;
 
-template void GPUMatrix<float>::BatchNormalizationBackward(const GPUMatrix<float>& in, GPUMatrix<float>& grad, const GPUMatrix<float>& scale, double blendFactor, const GPUMatrix<float>& saveMean, const GPUMatrix<float>& saveInvStdDev, GPUMatrix<float>& scaleGrad, GPUMatrix<float>& biasGrad) const;
-template void GPUMatrix<double>::BatchNormalizationBackward(const GPUMatrix<double>& in, GPUMatrix<double>& grad, const GPUMatrix<double>& scale, double blendFactor, const GPUMatrix<double>& saveMean, const GPUMatrix<double>& saveInvStdDev, GPUMatrix<double>& scaleGrad, GPUMatrix<double>& biasGrad) const;
-template void GPUMatrix<half>::BatchNormalizationBackward(const GPUMatrix<half>& in, GPUMatrix<half>& grad, const GPUMatrix<float>& scale, double blendFactor, const GPUMatrix<float>& saveMean, const GPUMatrix<float>& saveInvStdDev, GPUMatrix<float>& scaleGrad, GPUMatrix<float>& biasGrad) const;
+template void GPUMatrix<float>::BatchNormalizationBackward(const GPUMatrix<float>& in, GPUMatrix<float>& grad, const GPUMatrix<float>& scale, double blendFactor, const GPUMatrix<float>& saveMean, const GPUMatrix<float>& saveInvStdDev, GPUMatrix<float>& scaleGrad, GPUMatrix<float>& biasGrad, const GPUMatrix<float>* reluOutput) const;
+template void GPUMatrix<double>::BatchNormalizationBackward(const GPUMatrix<double>& in, GPUMatrix<double>& grad, const GPUMatrix<double>& scale, double blendFactor, const GPUMatrix<double>& saveMean, const GPUMatrix<double>& saveInvStdDev, GPUMatrix<double>& scaleGrad, GPUMatrix<double>& biasGrad, const GPUMatrix<double>* reluOutput) const;
+template void GPUMatrix<half>::BatchNormalizationBackward(const GPUMatrix<half>& in, GPUMatrix<half>& grad, const GPUMatrix<float>& scale, double blendFactor, const GPUMatrix<float>& saveMean, const GPUMatrix<float>& saveInvStdDev, GPUMatrix<float>& scaleGrad, GPUMatrix<float>& biasGrad, const GPUMatrix<half>* reluOutput) const;
+template void GPUMatrix<bfloat16>::BatchNormalizationBackward(const GPUMatrix<bfloat16>& in, GPUMatrix<bfloat16>& grad, const GPUMatrix<float>& scale, double blendFactor, const GPUMatrix<float>& saveMean, const GPUMatrix<float>& saveInvStdDev, GPUMatrix<float>& scaleGrad, GPUMatrix<float>& biasGrad, const GPUMatrix<bfloat16>* reluOutput) const;
 
 
 template void GPUSparseMatrix<char>::DeepCast(const GPUSparseMatrix<float>& deepCopyFrom);
 template void GPUSparseMatrix<char>::DeepCast(const GPUSparseMatrix<double>& deepCopyFrom);
 template void GPUSparseMatrix<char>::DeepCast(const GPUSparseMatrix<half>& deepCopyFrom);
+template void GPUSparseMatrix<char>::DeepCast(const GPUSparseMatrix<bfloat16>& deepCopyFrom);
 template void GPUSparseMatrix<short>::DeepCast(const GPUSparseMatrix<float>& deepCopyFrom);
 template void GPUSparseMatrix<short>::DeepCast(const GPUSparseMatrix<double>& deepCopyFrom);
 template void GPUSparseMatrix<short>::DeepCast(const GPUSparseMatrix<half>& deepCopyFrom);
+template void GPUSparseMatrix<short>::DeepCast(const GPUSparseMatrix<bfloat16>& deepCopyFrom);
 template void GPUSparseMatrix<int>::DeepCast(const GPUSparseMatrix<float>& deepCopyFrom);
 template void GPUSparseMatrix<int>::DeepCast(const GPUSparseMatrix<double>& deepCopyFrom);
 template void GPUSparseMatrix<int>::DeepCast(const GPUSparseMatrix<half>& deepCopyFrom);
+template void GPUSparseMatrix<int>::DeepCast(const GPUSparseMatrix<bfloat16>& deepCopyFrom);
 template void GPUSparseMatrix<float>::DeepCast(const GPUSparseMatrix<float>& deepCopyFrom);
 template void GPUSparseMatrix<float>::DeepCast(const GPUSparseMatrix<double>& deepCopyFrom);
 template void GPUSparseMatrix<float>::DeepCast(const GPUSparseMatrix<half>& deepCopyFrom);
+template void GPUSparseMatrix<float>::DeepCast(const GPUSparseMatrix<bfloat16>& deepCopyFrom);
 template void GPUSparseMatrix<double>::DeepCast(const GPUSparseMatrix<float>& deepCopyFrom);
 template void GPUSparseMatrix<double>::DeepCast(const GPUSparseMatrix<double>& deepCopyFrom);
 template void GPUSparseMatrix<double>::DeepCast(const GPUSparseMatrix<half>& deepCopyFrom);
+template void GPUSparseMatrix<double>::DeepCast(const GPUSparseMatrix<bfloat16>& deepCopyFrom);
 template void GPUSparseMatrix<half>::DeepCast(const GPUSparseMatrix<float>& deepCopyFrom);
 template void GPUSparseMatrix<half>::DeepCast(const GPUSparseMatrix<double>& deepCopyFrom);
 template void GPUSparseMatrix<half>::DeepCast(const GPUSparseMatrix<half>& deepCopyFrom);
+template void GPUSparseMatrix<half>::DeepCast(const GPUSparseMatrix<bfloat16>& deepCopyFrom);
+template void GPUSparseMatrix<bfloat16>::DeepCast(const GPUSparseMatrix<float>& deepCopyFrom);
+template void GPUSparseMatrix<bfloat16>::DeepCast(const GPUSparseMatrix<double>& deepCopyFrom);
+template void GPUSparseMatrix<bfloat16>::DeepCast(const GPUSparseMatrix<half>& deepCopyFrom);
+template void GPUSparseMatrix<bfloat16>::DeepCast(const GPUSparseMatrix<bfloat16>& deepCopyFrom);
 
 template void GPUSparseMatrix<float>::AdaDelta<float>(GPUMatrix<float>&c, GPUMatrix<float>&functionValues, float learningRate, float rho, float epsilon, int* timestamps, int currentTimestamp);
 template void GPUSparseMatrix<double>::AdaDelta<double>(GPUMatrix<double>&c, GPUMatrix<double>&functionValues, double learningRate, double rho, double epsilon, int* timestamps, int currentTimestamp);
 template void GPUSparseMatrix<half>::AdaDelta<float>(GPUMatrix<float>&c, GPUMatrix<float>&functionValues, float learningRate, float rho, float epsilon, int* timestamps, int currentTimestamp);
+template void GPUSparseMatrix<bfloat16>::AdaDelta<float>(GPUMatrix<float>&c, GPUMatrix<float>&functionValues, float learningRate, float rho, float epsilon, int* timestamps, int currentTimestamp);
 
 template <class ElemType>
 cublasHandle_t GPUMatrix<ElemType>::s_cuHandle[GPUMatrix<ElemType>::MaxGpus] = {0};
@@ -2590,10 +2852,11 @@ bool CuDnnConvolutionEngineFactory<ElemType>::IsSupported(DEVICEID_TYPE, Convolv
 template class CuDnnConvolutionEngineFactory<float>;
 template class CuDnnConvolutionEngineFactory<double>;
 template class CuDnnConvolutionEngineFactory<half>;
+template class CuDnnConvolutionEngineFactory<bfloat16>;
 
 template <class InoutType, class StatType>
 std::unique_ptr<BatchNormEngine<InoutType, StatType>> CuDnnBatchNormEngineFactory<InoutType, StatType>::Create(DEVICEID_TYPE deviceId, const TensorShape& inOutT,
-                                                                                         bool spatial, ImageLayoutKind imageLayout)
+                                                                                         bool spatial, ImageLayoutKind imageLayout, bool reluOutput)
 {
     RuntimeError("The code is compiled with CPUONLY macro.");
 }
@@ -2601,6 +2864,7 @@ std::unique_ptr<BatchNormEngine<InoutType, StatType>> CuDnnBatchNormEngineFactor
 template class CuDnnBatchNormEngineFactory<float, float>;
 template class CuDnnBatchNormEngineFactory<double, double>;
 template class CuDnnBatchNormEngineFactory<half, float>;
+template class CuDnnBatchNormEngineFactory<bfloat16, float>;
 
 CudaTimer::~CudaTimer()
 {
@@ -0,0 +1,484 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "Basics.h"
+#include "NumaPolicy.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+NumaPolicyKind NumaPolicy::s_kind = NumaPolicyKind::None;
+int NumaPolicy::s_node = 0;
+
+#ifdef _WIN32
+
+static std::vector<ULONGLONG> GetNodeProcessorMasks()
+{
+    std::vector<ULONGLONG> masks;
+    ULONG highest;
+    if (!GetNumaHighestNodeNumber(&highest))
+        highest = 0;
+    for (ULONG node = 0; node <= highest; node++)
+    {
+        ULONGLONG mask = 0;
+        if (!GetNumaNodeProcessorMask((UCHAR)node, &mask))
+            mask = 0;
+        masks.push_back(mask); // 0 for memory-only nodes
+    }
+    return masks;
+}
+
+static const std::vector<ULONGLONG>& NodeProcessorMasks()
+{
+    static const std::vector<ULONGLONG> masks = GetNodeProcessorMasks();
+    return masks;
+}
+
+size_t NumaPolicy::GetNumNodes()
+{
+    return std::max<size_t>(1, NodeProcessorMasks().size());
+}
+
+// node == SIZE_MAX: all nodes
+static void PinCurrentThreadToNode(size_t node)
+{
+    ULONGLONG mask = 0;
+    for (size_t i = 0; i < NodeProcessorMasks().size(); i++)
+        if (node == SIZE_MAX || node == i)
+            mask |= NodeProcessorMasks()[i];
+    if (mask != 0)
+        SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)mask); // note: only the first processor group
+}
+
+// Windows places heap pages on the node of the thread that touches them first; there is no way to set another policy for them.
+static void BindPages(void*, size_t, NumaPolicyKind, int)
+{
+}
+
+#else
+
+// parses a list like "0-7,16-23" from /sys/devices/system/node/node<n>/cpulist
+static std::vector<int> ParseCpuList(const char* s)
+{
+    std::vector<int> cpus;
+    while (*s)
+    {
+        char* end;
+        long first = strtol(s, &end, 10);
+        if (end == s)
+            break;
+        long last = first;
+        s = end;
+        if (*s == '-')
+        {
+            last = strtol(s + 1, &end, 10);
+            s = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++)
+            cpus.push_back((int)cpu);
+        while (*s == ',' || *s == '\n')
+            s++;
+    }
+    return cpus;
+}
+
+static std::vector<std::vector<int>> GetNodeCpus()
+{
+    std::vector<std::vector<int>> nodeCpus;
+    for (int node = 0;; node++)
+    {
+        std::string path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+        FILE* f = fopen(path.c_str(), "r");
+        if (!f)
+            break;
+        char buf[4096] = {};
+        size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+        fclose(f);
+        buf[n] = 0;
+        nodeCpus.push_back(ParseCpuList(buf)); // may be empty for memory-only nodes
+    }
+    return nodeCpus;
+}
+
+static const std::vector<std::vector<int>>& NodeCpus()
+{
+    static const std::vector<std::vector<int>> nodeCpus = GetNodeCpus();
+    return nodeCpus;
+}
+
+size_t NumaPolicy::GetNumNodes()
+{
+    return std::max<size_t>(1, NodeCpus().size());
+}
+
+// node == SIZE_MAX: all nodes
+static void PinCurrentThreadToNode(size_t node)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = 0; i < NodeCpus().size(); i++)
+        if (node == SIZE_MAX || node == i)
+            for (int cpu : NodeCpus()[i])
+                if (cpu < CPU_SETSIZE)
+                    CPU_SET(cpu, &set);
+    if (CPU_COUNT(&set) > 0)
+        sched_setaffinity(0, sizeof(set), &set); // 0 = the calling thread
+}
+
+// the memory policy modes and flags of <numaif.h>; we call mbind() directly so as not to depend on libnuma
+enum
+{
+    MPOL_PREFERRED_ = 1,
+    MPOL_INTERLEAVE_ = 3,
+    MPOL_MF_MOVE_ = 1 << 1,
+};
+
+static void BindPages(void* p, size_t bytes, NumaPolicyKind kind, int node)
+{
+    const size_t numNodes = NodeCpus().size();
+    if (numNodes < 2 || (kind != NumaPolicyKind::Interleave && kind != NumaPolicyKind::NodeLocal))
+        return;
+
+    // only the pages that lie completely inside the buffer; the others may be shared with neighboring heap blocks
+    const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t begin = ((size_t)p + pageSize - 1) / pageSize * pageSize;
+    size_t end = ((size_t)p + bytes) / pageSize * pageSize;
+    if (begin >= end)
+        return;
+
+    const size_t bitsPerWord = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> mask((numNodes + bitsPerWord - 1) / bitsPerWord);
+    if (kind == NumaPolicyKind::Interleave)
+    {
+        for (size_t i = 0; i < numNodes; i++)
+            mask[i / bitsPerWord] |= 1ul << (i % bitsPerWord);
+    }
+    else
+        mask[node / bitsPerWord] |= 1ul << (node % bitsPerWord);
+
+    int mode = kind == NumaPolicyKind::Interleave ? MPOL_INTERLEAVE_ : MPOL_PREFERRED_;
+    // maxnode counts bits, and the kernel ignores the last one
+    if (syscall(SYS_mbind, begin, end - begin, mode, mask.data(), mask.size() * bitsPerWord + 1, MPOL_MF_MOVE_) != 0)
+    {
+        static std::once_flag warningOnce;
+        std::call_once(warningOnce, [] { fprintf(stderr, "WARNING: NumaPolicy: mbind() failed, buffers are placed by the OS.\n"); });
+    }
+}
+
+#endif
+
+// node of the OpenMP thread 'thread' of 'numThreads'
+static size_t NodeOfThread(NumaPolicyKind kind, int node, int thread, int numThreads)
+{
+    if (kind == NumaPolicyKind::NodeLocal)
+        return (size_t)node;
+    // consecutive threads share a node, in line with the static scheduling of the loops over the buffers
+    return (size_t)thread * NumaPolicy::GetNumNodes() / numThreads;
+}
+
+void NumaPolicy::PinThreads()
+{
+    if (!IsActive())
+        return;
+
+    // Note that the calling thread is pinned as well, and threads it creates later inherit its affinity.
+    const NumaPolicyKind kind = s_kind;
+    const int node = s_node;
+#pragma omp parallel
+    {
+#ifdef _OPENMP
+        PinCurrentThreadToNode(NodeOfThread(kind, node, omp_get_thread_num(), omp_get_num_threads()));
+#else
+        PinCurrentThreadToNode(NodeOfThread(kind, node, 0, 1));
+#endif
+    }
+}
+
+void NumaPolicy::PinCurrentThread(size_t node)
+{
+    PinCurrentThreadToNode(node % GetNumNodes());
+}
+
+void NumaPolicy::Set(NumaPolicyKind kind, int node)
+{
+    const size_t numNodes = GetNumNodes();
+    if (kind == NumaPolicyKind::NodeLocal && node < 0)
+    {
+#pragma warning(push)
+#pragma warning(disable : 4996) // getenv
+        const char* localRank = getenv("OMPI_COMM_WORLD_LOCAL_RANK");
+#pragma warning(pop)
+        node = localRank ? (int)(atoi(localRank) % numNodes) : 0;
+    }
+    if (kind == NumaPolicyKind::NodeLocal && node >= (int)numNodes)
+        InvalidArgument("NumaPolicy: NUMA node %d does not exist, there are %d.", node, (int)numNodes);
+
+    const bool wasActive = IsActive();
+    s_kind = kind;
+    s_node = node < 0 ? 0 : node;
+    if (IsActive())
+        PinThreads();
+    else if (wasActive)
+    {
+#pragma omp parallel
+        PinCurrentThreadToNode(SIZE_MAX); // unpin
+    }
+}
+
+NumaPolicyKind NumaPolicy::Parse(const std::wstring& name)
+{
+    if (name == L"none" || name.empty())
+        return NumaPolicyKind::None;
+    else if (name == L"interleave")
+        return NumaPolicyKind::Interleave;
+    else if (name == L"nodeLocal")
+        return NumaPolicyKind::NodeLocal;
+    else if (name == L"firstTouch")
+        return NumaPolicyKind::FirstTouch;
+    InvalidArgument("NumaPolicy: Invalid policy '%ls', expected 'none', 'interleave', 'nodeLocal' or 'firstTouch'.", name.c_str());
+}
+
+void NumaPolicy::Place(void* p, size_t bytes, bool zero)
+{
+    if (!IsActive() || bytes < MinBytes)
+    {
+        if (zero)
+            memset(p, 0, bytes);
+        return;
+    }
+
+    BindPages(p, bytes, s_kind, s_node);
+    if (!zero)
+        return;
+
+    // each thread zeroes the part it will work on in statically scheduled loops
+    char* buffer = (char*)p;
+#pragma omp parallel
+    {
+#ifdef _OPENMP
+        const size_t thread = omp_get_thread_num(), numThreads = omp_get_num_threads();
+#else
+        const size_t thread = 0, numThreads = 1;
+#endif
+        const size_t begin = bytes / numThreads * thread + std::min(thread, bytes % numThreads);
+        const size_t end = begin + bytes / numThreads + (thread < bytes % numThreads ? 1 : 0);
+        memset(buffer + begin, 0, end - begin);
+    }
+}
+
+// -----------------------------------------------------------------------
+// HugePages
+// -----------------------------------------------------------------------
+
+HugePageKind HugePages::s_kind = HugePageKind::None;
+size_t HugePages::s_minBytes = HugePages::DefaultMinBytes;
+
+struct HugePageMapping
+{
+    void* base;   // of the whole mapping, which may start before the buffer to align it
+    size_t bytes; // of the whole mapping
+    HugePageKind kind;
+};
+
+static std::mutex s_hugePageMutex;
+static std::unordered_map<void*, HugePageMapping> s_hugePageMappings; // buffer -> mapping
+static std::atomic<size_t> s_numHugePageMappings(0);                  // so that Free() of heap buffers need not lock
+static HugePageStats s_hugePageStats;
+
+static const size_t TransparentHugePageSize = 2 * 1024 * 1024;
+
+static size_t RoundUp(size_t bytes, size_t alignment)
+{
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+#ifdef _WIN32
+
+// Windows has no transparent huge pages; large pages must be reserved by the privilege and are never paged out.
+static bool MapHugePages(size_t bytes, HugePageKind kind, HugePageMapping& mapping)
+{
+    const size_t largePageSize = GetLargePageMinimum();
+    if (kind != HugePageKind::Explicit || largePageSize == 0)
+        return false;
+    mapping.bytes = RoundUp(bytes, largePageSize);
+    mapping.base = VirtualAlloc(nullptr, mapping.bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    mapping.kind = HugePageKind::Explicit;
+    return mapping.base != nullptr;
+}
+
+static void UnmapHugePages(const HugePageMapping& mapping)
+{
+    VirtualFree(mapping.base, 0, MEM_RELEASE);
+}
+
+static size_t GetTransparentHugePageBackedBytes()
+{
+    return 0;
+}
+
+#else
+
+// the flags of <linux/mman.h> for the size of explicit huge pages, which older headers lack
+enum
+{
+    MAP_HUGE_SHIFT_ = 26,
+    MAP_HUGE_1GB_ = 30 << MAP_HUGE_SHIFT_,
+};
+
+static bool MapHugePages(size_t bytes, HugePageKind kind, HugePageMapping& mapping)
+{
+#ifdef MAP_HUGETLB
+    if (kind == HugePageKind::Explicit)
+    {
+        // 1 GB pages for the buffers that fill one, else the default (2 MB) ones; the mapping fails if none are reserved
+        const size_t gigaPageSize = 1024 * 1024 * 1024;
+        if (bytes >= gigaPageSize)
+        {
+            mapping.bytes = RoundUp(bytes, gigaPageSize);
+            mapping.base = mmap(nullptr, mapping.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_1GB_, -1, 0);
+            mapping.kind = HugePageKind::Explicit;
+            if (mapping.base != MAP_FAILED)
+                return true;
+        }
+        mapping.bytes = RoundUp(bytes, TransparentHugePageSize);
+        mapping.base = mmap(nullptr, mapping.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mapping.base != MAP_FAILED)
+            return true;
+    }
+#endif
+
+    // Transparent: over-allocate by a huge page, and unmap what lies outside of the aligned range
+    const size_t alignedBytes = RoundUp(bytes, TransparentHugePageSize);
+    const size_t mappedBytes = alignedBytes + TransparentHugePageSize;
+    char* p = (char*)mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == (char*)MAP_FAILED)
+        return false;
+    char* aligned = (char*)RoundUp((size_t)p, TransparentHugePageSize);
+    if (aligned > p)
+        munmap(p, aligned - p);
+    if (aligned + alignedBytes < p + mappedBytes)
+        munmap(aligned + alignedBytes, p + mappedBytes - (aligned + alignedBytes));
+    mapping.base = aligned;
+    mapping.bytes = alignedBytes;
+    mapping.kind = HugePageKind::Transparent;
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, alignedBytes, MADV_HUGEPAGE); // fails if transparent huge pages are disabled; the mapping is still fine
+#endif
+    return true;
+}
+
+static void UnmapHugePages(const HugePageMapping& mapping)
+{
+    munmap(mapping.base, mapping.bytes);
+}
+
+// the AnonHugePages of /proc/self/smaps_rollup (kernel 4.14 and later), 0 if not available
+static size_t GetTransparentHugePageBackedBytes()
+{
+    FILE* f = fopen("/proc/self/smaps_rollup", "r");
+    if (!f)
+        return 0;
+    char line[256];
+    size_t kB = 0;
+    while (fgets(line, sizeof(line), f))
+    {
+        if (sscanf(line, "AnonHugePages: %zu kB", &kB) == 1)
+            break;
+    }
+    fclose(f);
+    return kB * 1024;
+}
+
+#endif
+
+void HugePages::Set(HugePageKind kind, size_t minBytes)
+{
+    s_kind = kind;
+    s_minBytes = std::max<size_t>(minBytes, 1);
+}
+
+HugePageKind HugePages::Parse(const std::wstring& name)
+{
+    if (name == L"none" || name.empty())
+        return HugePageKind::None;
+    else if (name == L"transparent")
+        return HugePageKind::Transparent;
+    else if (name == L"explicit")
+        return HugePageKind::Explicit;
+    InvalidArgument("HugePages: Invalid kind '%ls', expected 'none', 'transparent' or 'explicit'.", name.c_str());
+}
+
+void* HugePages::Allocate(size_t bytes)
+{
+    const HugePageKind kind = s_kind;
+    if (kind == HugePageKind::None || bytes < s_minBytes || bytes == 0)
+        return nullptr;
+
+    HugePageMapping mapping;
+    bool mapped = MapHugePages(bytes, kind, mapping);
+
+    std::lock_guard<std::mutex> lock(s_hugePageMutex);
+    if (!mapped)
+    {
+        if (s_hugePageStats.numFallbacks++ == 0)
+            fprintf(stderr, "WARNING: HugePages: No huge pages could be mapped, large buffers are allocated on the heap.\n");
+        return nullptr;
+    }
+    s_hugePageMappings[mapping.base] = mapping;
+    s_numHugePageMappings++;
+    s_hugePageStats.numAllocations++;
+    (mapping.kind == HugePageKind::Explicit ? s_hugePageStats.explicitBytes : s_hugePageStats.transparentBytes) += mapping.bytes;
+    return mapping.base;
+}
+
+bool HugePages::Free(void* p)
+{
+    if (!p || s_numHugePageMappings == 0)
+        return false;
+
+    HugePageMapping mapping;
+    {
+        std::lock_guard<std::mutex> lock(s_hugePageMutex);
+        auto iter = s_hugePageMappings.find(p);
+        if (iter == s_hugePageMappings.end())
+            return false;
+        mapping = iter->second;
+        s_hugePageMappings.erase(iter);
+        s_numHugePageMappings--;
+        (mapping.kind == HugePageKind::Explicit ? s_hugePageStats.explicitBytes : s_hugePageStats.transparentBytes) -= mapping.bytes;
+    }
+    UnmapHugePages(mapping);
+    return true;
+}
+
+HugePageStats HugePages::GetStats()
+{
+    HugePageStats stats;
+    {
+        std::lock_guard<std::mutex> lock(s_hugePageMutex);
+        stats = s_hugePageStats;
+    }
+    stats.transparentBackedBytes = GetTransparentHugePageBackedBytes();
+    return stats;
+}
+
+}}}
@@ -0,0 +1,154 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// NumaPolicy.h -- placement of CPU matrix and reader buffers on NUMA nodes and huge pages, and the matching affinity of the math threads
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+#include <string>
+
+#ifdef _WIN32
+#ifndef MATH_API
+#ifdef MATH_EXPORTS
+#define MATH_API __declspec(dllexport)
+#else
+#define MATH_API __declspec(dllimport)
+#endif
+#endif /* MATH_API */
+#else  // no DLLs in Linux
+#define MATH_API
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+enum class NumaPolicyKind
+{
+    None,       // leave placement to the OS, do not pin threads (default)
+    Interleave, // spread the pages of large buffers round-robin over the nodes
+    NodeLocal,  // confine the threads and the buffers to one node, e.g. one per MPI worker or evaluator process
+    FirstTouch, // pin the threads to the nodes in order, and zero large buffers in parallel, so that each page lands
+                // on the node of the thread that works on it in the (statically scheduled) OpenMP loops
+};
+
+class MATH_API NumaPolicy
+{
+public:
+    // Sets the policy and pins the OpenMP threads accordingly. Call this after CPUMatrix::SetNumThreads().
+    // 'node' is only used by NodeLocal: -1 picks the node from the local MPI rank (OMPI_COMM_WORLD_LOCAL_RANK), or node 0.
+    // On Windows Interleave and NodeLocal only pin the threads, since the pages of heap memory cannot be placed there.
+    static void Set(NumaPolicyKind kind, int node = -1);
+
+    // Parses "none", "interleave", "nodeLocal", "firstTouch" (as used by the 'numaPolicy' config parameter).
+    static NumaPolicyKind Parse(const std::wstring& name);
+
+    static NumaPolicyKind GetKind() { return s_kind; }
+    static bool IsActive() { return s_kind != NumaPolicyKind::None; }
+    static size_t GetNumNodes();
+
+    // Pins the OpenMP threads again, e.g. after their number has changed. No-op without a policy.
+    static void PinThreads();
+
+    // Pins the calling thread to 'node' (modulo the number of nodes), regardless of the policy, e.g. a thread that
+    // serves one evaluator context. The OpenMP threads it starts later inherit the affinity.
+    static void PinCurrentThread(size_t node);
+
+    // Applies the policy to a buffer that has not been touched yet (or moves its pages), and optionally zeroes it.
+    // Only pages completely inside the buffer are affected, and buffers below MinBytes are left alone.
+    static void Place(void* p, size_t bytes, bool zero);
+
+    static const size_t MinBytes = 1024 * 1024;
+
+private:
+    static NumaPolicyKind s_kind;
+    static int s_node;
+};
+
+// Same as new T[n](), but placed according to the NumaPolicy. Free with delete[].
+template <class T>
+static inline T* NewNumaPlacedArray(size_t n)
+{
+    if (!NumaPolicy::IsActive() || n * sizeof(T) < NumaPolicy::MinBytes)
+        return new T[n]();
+
+    T* p = new T[n]; // no initialization yet, that is the first touch
+    NumaPolicy::Place(p, n * sizeof(T), /*zero=*/true);
+    return p;
+}
+
+enum class HugePageKind
+{
+    None,        // heap memory (default)
+    Transparent, // 2 MB aligned mappings that the kernel is asked to back with transparent huge pages (Linux)
+    Explicit,    // mappings of reserved huge pages (Linux: MAP_HUGETLB, 1 GB pages for buffers of at least 1 GB if the
+                 // kernel has them, Windows: large pages, which need the 'Lock pages in memory' privilege);
+                 // falls back to Transparent, then to the heap, when none are available
+};
+
+struct HugePageStats
+{
+    size_t numAllocations = 0;        // buffers allocated by HugePages
+    size_t numFallbacks = 0;          // buffers above the threshold that were left to the heap, as no mapping could be made
+    size_t explicitBytes = 0;         // bytes currently in mappings of reserved huge pages
+    size_t transparentBytes = 0;      // bytes currently in mappings advised for transparent huge pages
+    size_t transparentBackedBytes = 0; // of all anonymous memory of the process, the bytes the kernel backs with transparent huge pages
+};
+
+// Huge pages for large CPU matrix and reader buffers, which cut the TLB misses of the GEMMs and of the packing of
+// minibatches over multi-GB buffers. Buffers of at least the threshold are mapped separately and aligned to the huge
+// page size (so at least 2 MB, which covers any SIMD alignment); smaller ones stay on the heap.
+class MATH_API HugePages
+{
+public:
+    static void Set(HugePageKind kind, size_t minBytes = DefaultMinBytes);
+
+    // Parses "none", "transparent", "explicit" (as used by the 'hugePages' config parameter).
+    static HugePageKind Parse(const std::wstring& name);
+
+    static HugePageKind GetKind() { return s_kind; }
+    static size_t GetMinBytes() { return s_minBytes; }
+
+    // A zeroed buffer of 'bytes' backed by huge pages, or nullptr if it is below the threshold, no policy is set,
+    // or no mapping could be made; the caller then allocates it on the heap.
+    static void* Allocate(size_t bytes);
+
+    // Frees a buffer of Allocate(). Returns false (and does nothing) for any other pointer.
+    static bool Free(void* p);
+
+    static HugePageStats GetStats();
+
+    static const size_t DefaultMinBytes = 2 * 1024 * 1024;
+
+private:
+    static HugePageKind s_kind;
+    static size_t s_minBytes;
+};
+
+// Same as NewNumaPlacedArray(), but large arrays are backed by huge pages according to HugePages. Free with DeleteLargeArray().
+template <class T>
+static inline T* NewLargeArray(size_t n)
+{
+    if (HugePages::GetKind() != HugePageKind::None && n * sizeof(T) >= HugePages::GetMinBytes())
+    {
+        // the mapping is zeroed, which is the value-initialization of the numeric element types
+        T* p = static_cast<T*>(HugePages::Allocate(n * sizeof(T)));
+        if (p)
+        {
+            NumaPolicy::Place(p, n * sizeof(T), /*zero=*/false);
+            return p;
+        }
+    }
+    return NewNumaPlacedArray<T>(n);
+}
+
+template <class T>
+static inline void DeleteLargeArray(T* p)
+{
+    if (p && !HugePages::Free(p))
+        delete[] p;
+}
+
+}}}
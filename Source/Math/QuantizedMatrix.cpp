@@ -136,7 +136,7 @@ void QuantizedMatrix<ElemType>::Print(const char* matrixName, size_t rowStart, s
     for (size_t j = colStart; j <= colEnd; j++)
     {
         QuantizedColumn<ElemType>* qCol = this->GetQuantizedColumn(j);
-        fprintf(stderr, "Lower=%.10f,Upper=%.10f\t", qCol->lower, qCol->upper);
+        fprintf(stderr, "Lower=%.10f,Upper=%.10f\t", (double) qCol->lower, (double) qCol->upper);
     }
     fprintf(stderr, "\n");
 
@@ -153,11 +153,11 @@ void QuantizedMatrix<ElemType>::Print(const char* matrixName, size_t rowStart, s
             QWord qWord = qCol->bits[qWordIdx];
 
             QWordVal qVal;
-            ElemType val;
+            CompType val;
             if (this->GetNumBits() == 1)
             {
-                ElemType val0 = q.valQ.Unquantize(0);
-                ElemType val1 = q.valQ.Unquantize(1);
+                CompType val0 = q.valQ.Unquantize(0);
+                CompType val1 = q.valQ.Unquantize(1);
                 qVal = (qWord >> offsetInQWord) & 1;
                 val = ValueQuantizer<ElemType>::Unquantize1(qVal != 0, val0, val1);
             }
@@ -168,7 +168,7 @@ void QuantizedMatrix<ElemType>::Print(const char* matrixName, size_t rowStart, s
                 val = q.valQ.Unquantize(qVal);
             }
 
-            fprintf(stderr, "%10d (%.10f)          \t", (int) qVal, val);
+            fprintf(stderr, "%10d (%.10f)          \t", (int) qVal, (double) val);
         }
         fprintf(stderr, "\n");
     }
@@ -182,5 +182,6 @@ void QuantizedMatrix<ElemType>::Print(const char* matrixName, size_t rowStart, s
 // Explicit instantiation
 template class QuantizedMatrix<float>;
 template class QuantizedMatrix<double>;
+template class QuantizedMatrix<half>;
 
 }}}
@@ -55,6 +55,7 @@ class MATH_API QuantizedMatrix : public QuantizedMatrixBase
 {
     typedef typename ValueQuantizer<ElemType>::QWord QWord;
     typedef typename ValueQuantizer<ElemType>::QWordVal QWordVal;
+    typedef typename ValueQuantizer<ElemType>::CompType CompType;
     static const size_t QWordNumBits = ValueQuantizer<ElemType>::QWordNumBits;
 
 public:
@@ -0,0 +1,101 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// The int8 kernels behind Int8QuantizedMultiplier (QuantizedOperations.h).
+//
+
+#include "stdafx.h"
+#include "QuantizedOperations.h"
+#include "CPUMatrixTensorSimd.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+template <class ElemType>
+static void QuantizeInt8VectorsImpl(size_t count, size_t length, const ElemType* src, size_t vectorStride, size_t elementStride, signed char* dst, float* scales)
+{
+#pragma omp parallel for if (count * length > 65536)
+    for (long long i = 0; i < (long long)count; i++)
+    {
+        const ElemType* v = src + i * vectorStride;
+        double absMax = 0;
+        for (size_t j = 0; j < length; j++)
+            absMax = std::max(absMax, (double)std::abs(v[j * elementStride]));
+
+        // symmetric range [-127, 127], so that the negated values are representable as well
+        const float scale = absMax > 0 ? (float)(absMax / 127) : 1.0f;
+        const double invScale = 1 / (double)scale;
+        signed char* q = dst + i * length;
+        for (size_t j = 0; j < length; j++)
+        {
+            double r = std::round(v[j * elementStride] * invScale);
+            q[j] = (signed char)std::max(-127.0, std::min(127.0, r));
+        }
+        scales[i] = scale;
+    }
+}
+
+void QuantizeInt8Vectors(size_t count, size_t length, const float* src, size_t vectorStride, size_t elementStride, signed char* dst, float* scales)
+{
+    QuantizeInt8VectorsImpl(count, length, src, vectorStride, elementStride, dst, scales);
+}
+
+void QuantizeInt8Vectors(size_t count, size_t length, const double* src, size_t vectorStride, size_t elementStride, signed char* dst, float* scales)
+{
+    QuantizeInt8VectorsImpl(count, length, src, vectorStride, elementStride, dst, scales);
+}
+
+static int DotInt8(size_t n, const signed char* a, const signed char* b)
+{
+    int sum = 0;
+    for (size_t i = 0; i < n; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+template <class ElemType>
+static void QuantizedInt8ProductImpl(size_t m, size_t n, size_t k, const signed char* a, const signed char* b, const float* rowScale, const float* colScale, ElemType* c, size_t ldc)
+{
+    if (k >= (1 << 17))
+        InvalidArgument("QuantizedInt8Product: The reduction dimension %d is too large for 32 bit accumulation.", (int)k);
+
+    const Simd::TensorKernels* kernels = Simd::GetTensorKernels();
+    int (*dot)(size_t, const signed char*, const signed char*) = kernels ? kernels->m_dotInt8 : &DotInt8;
+
+    // tiles of rows of 'a' by columns of 'b', so that both stay in the cache while their products are formed
+    const size_t tileM = 64;
+    const size_t tileN = 16;
+    const size_t numTilesM = (m + tileM - 1) / tileM;
+    const size_t numTilesN = (n + tileN - 1) / tileN;
+    const long long numTiles = (long long)(numTilesM * numTilesN);
+
+#pragma omp parallel for schedule(dynamic) if (numTiles > 1 && m * n * k > 65536)
+    for (long long t = 0; t < numTiles; t++)
+    {
+        const size_t i0 = (t % numTilesM) * tileM;
+        const size_t j0 = (t / numTilesM) * tileN;
+        const size_t i1 = std::min(m, i0 + tileM);
+        const size_t j1 = std::min(n, j0 + tileN);
+        for (size_t j = j0; j < j1; j++)
+        {
+            const signed char* bj = b + j * k;
+            ElemType* cj = c + j * ldc;
+            for (size_t i = i0; i < i1; i++)
+                cj[i] = (ElemType)(rowScale[i] * colScale[j] * (float)dot(k, a + i * k, bj));
+        }
+    }
+}
+
+void QuantizedInt8Product(size_t m, size_t n, size_t k, const signed char* a, const signed char* b, const float* rowScale, const float* colScale, float* c, size_t ldc)
+{
+    QuantizedInt8ProductImpl(m, n, k, a, b, rowScale, colScale, c, ldc);
+}
+
+void QuantizedInt8Product(size_t m, size_t n, size_t k, const signed char* a, const signed char* b, const float* rowScale, const float* colScale, double* c, size_t ldc)
+{
+    QuantizedInt8ProductImpl(m, n, k, a, b, rowScale, colScale, c, ldc);
+}
+
+}}}
@@ -4,9 +4,20 @@
 //
 #pragma once
 #include "Quantizers.h"
+#include "CommonMatrix.h" // for MATH_API
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+// Quantizes 'count' vectors of 'length' elements each to int8, with one scale per vector: value ~= scale * quantized.
+// Element j of vector i is read from src[i * vectorStride + j * elementStride], and written to dst[i * length + j].
+MATH_API void QuantizeInt8Vectors(size_t count, size_t length, const float* src, size_t vectorStride, size_t elementStride, signed char* dst, float* scales);
+MATH_API void QuantizeInt8Vectors(size_t count, size_t length, const double* src, size_t vectorStride, size_t elementStride, signed char* dst, float* scales);
+
+// C[i + j * ldc] = rowScale[i] * colScale[j] * dot(a[i * k .. i * k + k), b[j * k .. j * k + k)), for the [m x k] rows of 'a' and the [k x n] columns of 'b'
+// as written by QuantizeInt8Vectors(). The dot products are accumulated in 32 bit, so k must be below 2^17.
+MATH_API void QuantizedInt8Product(size_t m, size_t n, size_t k, const signed char* a, const signed char* b, const float* rowScale, const float* colScale, float* c, size_t ldc);
+MATH_API void QuantizedInt8Product(size_t m, size_t n, size_t k, const signed char* a, const signed char* b, const float* rowScale, const float* colScale, double* c, size_t ldc);
+
 
 // Quantized product of two dense matrices A and B, where each matrix has its own quantizer.
 // This class handles quantization of both matrices, product and de-quantization of the result.
@@ -40,9 +51,10 @@ public:
         QuantizedMultiplier(pQuantizerA, false, pQuantizerB, false)
     {
     };
+    virtual ~QuantizedMultiplier() {}
 
     // A[m,k]*B[k,n] = C[m,n]
-    void Multiply(int m, int n, int k, ElemType* A, ElemType* B, ElemType* C)
+    virtual void Multiply(int m, int n, int k, ElemType* A, ElemType* B, ElemType* C)
     {
         // Quantize
         if (!m_isAConstant || m_firstPass)
@@ -84,6 +96,59 @@ public:
 
     void SetIsAConstant(bool v) { m_isAConstant = v; }
     void SetIsBConstant(bool v) { m_isBConstant = v; }
+
+protected:
+    // for implementations that do their own quantization
+    QuantizedMultiplier() : m_isAConstant(false), m_isBConstant(false), m_firstPass(true)
+    {
+    }
+};
+
+// Int8 product of constant weights A with data B, for inference on the CPU.
+// Each row of A is quantized with its own scale on the first call (so A must not change afterwards, see Reset()),
+// each column (sample) of B with its own scale on every call. The products are accumulated in int32 and
+// converted back to ElemType in the same pass, there is no intermediate int32 matrix.
+template <class ElemType>
+class Int8QuantizedMultiplier : public QuantizedMultiplier<ElemType>
+{
+    vector<signed char> m_matA, m_matB;
+    vector<float> m_rowScaleA, m_colScaleB;
+    int m_m, m_k; // dimensions of the quantized A
+
+public:
+    Int8QuantizedMultiplier() : m_m(0), m_k(0)
+    {
+    }
+
+    // A[m,k]*B[k,n] = C[m,n], all column-major
+    virtual void Multiply(int m, int n, int k, ElemType* A, ElemType* B, ElemType* C) override
+    {
+        if (m_matA.empty() || m != m_m || k != m_k)
+        {
+            m_matA.resize((size_t)m * k);
+            m_rowScaleA.resize(m);
+            QuantizeInt8Vectors(m, k, A, /*vectorStride=*/1, /*elementStride=*/m, m_matA.data(), m_rowScaleA.data());
+            m_m = m;
+            m_k = k;
+        }
+
+        m_matB.resize((size_t)k * n);
+        m_colScaleB.resize(n);
+        QuantizeInt8Vectors(n, k, B, /*vectorStride=*/k, /*elementStride=*/1, m_matB.data(), m_colScaleB.data());
+
+        QuantizedInt8Product(m, n, k, m_matA.data(), m_matB.data(), m_rowScaleA.data(), m_colScaleB.data(), C, /*ldc=*/m);
+    }
+
+    // forces the weights to be quantized again on the next call
+    void Reset() { m_matA.clear(); }
 };
 
+// Returns a new Int8QuantizedMultiplier, or nullptr for element types it does not support.
+template <class ElemType>
+inline shared_ptr<QuantizedMultiplier<ElemType>> NewInt8QuantizedMultiplier() { return nullptr; }
+template <>
+inline shared_ptr<QuantizedMultiplier<float>> NewInt8QuantizedMultiplier<float>() { return make_shared<Int8QuantizedMultiplier<float>>(); }
+template <>
+inline shared_ptr<QuantizedMultiplier<double>> NewInt8QuantizedMultiplier<double>() { return make_shared<Int8QuantizedMultiplier<double>>(); }
+
 }}}
\ No newline at end of file
@@ -20,6 +20,11 @@ struct RnnAttributes
     int m_axis;
     bool IsSpatialRecurrence() const { return m_axis >= 0; }
 
+    // Whether the recurrence may keep the recurrent weights on chip across the time steps (see Globals::SetPersistentRNN()):
+    // on the GPU in the persistent algorithm of cuDNN, on the CPU in the cache of the threads. An execution choice of the
+    // node, which is neither saved nor compared.
+    bool m_persistent = false;
+
     RnnAttributes(bool bidirectional, size_t numLayers, size_t hiddenSize, const wstring& recurrentOp, int axis) :
         m_bidirectional(bidirectional), m_numLayers(numLayers), m_hiddenSize(hiddenSize), m_recurrentOp(recurrentOp), m_axis(axis)
     {
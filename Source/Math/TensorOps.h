@@ -166,6 +166,51 @@ DECL half min(half a, half b) {
     return (float)a < (float)b ? a : b;
 }
 
+// bfloat16 has no math functions of its own, it is computed in float
+DECL bfloat16 exp_(bfloat16 v) {
+    return bfloat16(expf((float)v));
+}
+DECL bfloat16 log_(bfloat16 v) {
+    return bfloat16(logf((float)v));
+}
+DECL bfloat16 tanh_(bfloat16 v) {
+    return bfloat16(tanhf((float)v));
+}
+DECL bfloat16 sqrt_(bfloat16 v) {
+    return bfloat16(sqrtf((float)v));
+}
+DECL bfloat16 fabs_(bfloat16 v) {
+    unsigned short t = *(unsigned short*)&v & 0x7FFF; // the sign is the top bit, as in float
+    return *(bfloat16*)(&t);
+}
+DECL bfloat16 cos_(bfloat16 v) {
+    return bfloat16(cosf((float)v));
+}
+DECL bfloat16 sin_(bfloat16 v) {
+    return bfloat16(sinf((float)v));
+}
+DECL bfloat16 floor_(bfloat16 v) {
+    return bfloat16(floorf((float)v));
+}
+DECL bfloat16 log1p_(bfloat16 v) {
+    return bfloat16(log1pf((float)v));
+}
+DECL bool isnan_(bfloat16 v) {
+    return v != v;
+}
+DECL bfloat16 max(bfloat16 a, bfloat16 b) {
+    return (float)a > (float)b ? a : b;
+}
+DECL float max(float a, bfloat16 b) {
+    return a > (float)b ? a : (float)b;
+}
+DECL float max(bfloat16 a, float b) {
+    return (float)a > b ? (float)a : b;
+}
+DECL bfloat16 min(bfloat16 a, bfloat16 b) {
+    return (float)a < (float)b ? a : b;
+}
+
 // overload for CUDA only functions
 #if defined(__CUDACC__)
 
@@ -176,6 +221,9 @@ DECL half rsqrt_(half v) {
     return half(rsqrtf((float)v));
 #endif
 }
+DECL bfloat16 rsqrt_(bfloat16 v) {
+    return bfloat16(rsqrtf((float)v));
+}
 DECL float rsqrt_(float v) {
     return rsqrtf(v);
 }
@@ -212,6 +260,10 @@ DECL half pow_(half v,  half e) {
     return half(powf((float)v , (float)e));     //TODO: Improve efficiency?
 }
 
+DECL bfloat16 pow_(bfloat16 v, bfloat16 e) {
+    return bfloat16(powf((float)v, (float)e));
+}
+
 template<typename T>
 DECL T safepow_(T base, T exponent)
 {
@@ -505,6 +557,72 @@ DefTernaryOp(ElementwiseProductWithPowBaseDerivative, (ElemType)(a * c * OpPow(b
 
 #pragma pop_macro("DefTernaryOp")
 
+// evaluates one instruction of an ElementwiseProgram (CommonMatrix.h); operands beyond the arity of op are ignored
+template <class ElemType>
+DECL ElemType OpElementwiseInstruction(ElementWiseOperator op, ElemType a, ElemType b, ElemType c)
+{
+#pragma push_macro("CaseUnaryOp")
+#pragma push_macro("CaseBinaryOp")
+#pragma push_macro("CaseTernaryOp")
+#define CaseUnaryOp(oper)   case ElementWiseOperator::op##oper: return Op##oper(a)
+#define CaseBinaryOp(oper)  case ElementWiseOperator::op##oper: return Op##oper(a, b)
+#define CaseTernaryOp(oper) case ElementWiseOperator::op##oper: return Op##oper(a, b, c)
+    switch (op)
+    {
+        ForAllUnaryOps(CaseUnaryOp);
+        ForAllBinaryOps(CaseBinaryOp);
+        ForAllTernaryOps(CaseTernaryOp);
+    default:
+        return 0; // ElementwiseProgram builders only use the operations above
+    }
+#pragma pop_macro("CaseTernaryOp")
+#pragma pop_macro("CaseBinaryOp")
+#pragma pop_macro("CaseUnaryOp")
+}
+
+// -----------------------------------------------------------------------
+// counter-based random numbers
+// Philox4x32-10 [J. Salmon et al., Parallel Random Numbers: As Easy as 1, 2, 3, SC 2011]. The numbers are a function
+// of (seed, counter) alone, so any element of a random sequence can be computed independently, in the same way on the
+// CPU and the GPU. Element i of the sequence for a seed is word (i & 3) of the block for counter (i >> 2).
+// -----------------------------------------------------------------------
+
+DECL void PhiloxMulHiLo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo)
+{
+    uint64_t product = (uint64_t)a * b;
+    hi = (uint32_t)(product >> 32);
+    lo = (uint32_t)product;
+}
+
+// computes the four 32-bit words of block 'counter'
+DECL void Philox4x32(uint64_t seed, uint64_t counter, uint32_t words[4])
+{
+    uint32_t c0 = (uint32_t)counter, c1 = (uint32_t)(counter >> 32), c2 = 0, c3 = 0;
+    uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+    for (int round = 0; round < 10; round++)
+    {
+        uint32_t hi0, lo0, hi1, lo1;
+        PhiloxMulHiLo(0xD2511F53u, c0, hi0, lo0);
+        PhiloxMulHiLo(0xCD9E8D57u, c2, hi1, lo1);
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+    words[0] = c0;
+    words[1] = c1;
+    words[2] = c2;
+    words[3] = c3;
+}
+
+// maps a random word to a uniform float in [0, 1), with 24 bits of precision
+DECL float PhiloxUniform(uint32_t word)
+{
+    return (float)(word >> 8) * (1.0f / 16777216.0f);
+}
+
 }}}
 #pragma pop_macro("DECL")
 #pragma pop_macro("TENSOR_OPS_DECL")
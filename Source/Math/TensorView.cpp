@@ -408,6 +408,7 @@ void TensorView<ElemType>::DoMatrixProductOf(ElemType beta, bool transC, const T
 template class TensorView<float>;
 template class TensorView<double>;
 template class TensorView<half>;
+template class TensorView<bfloat16>;
 
 template Microsoft::MSR::CNTK::TensorView<char>::TensorView(const MatrixBasePtr& sob, const TensorShape& shape);
 template Microsoft::MSR::CNTK::TensorView<char>::TensorView(const TensorView<char>& other, const TensorShape& shape);
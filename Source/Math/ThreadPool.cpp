@@ -0,0 +1,422 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "Basics.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef USE_MKL
+#include <mkl_service.h>
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+std::atomic<size_t> ThreadPool::s_threadBudget(0);
+std::atomic<int> ComputeThreadShare::s_numActive(0);
+
+// the pool and the worker index of the current thread, if it is a worker
+static thread_local ThreadPool* t_pool = nullptr;
+static thread_local size_t t_workerIndex = 0;
+
+ThreadPool& ThreadPool::Get()
+{
+    // never destroyed: joining the workers during static destruction (or DLL unload on Windows) could deadlock
+    static ThreadPool* pool = new ThreadPool();
+    return *pool;
+}
+
+size_t ThreadPool::GetThreadBudget()
+{
+    size_t budget = s_threadBudget;
+    return budget != 0 ? budget : std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+void ThreadPool::SetThreadBudget(size_t numThreads)
+{
+    s_threadBudget = numThreads;
+
+    ThreadPool& pool = Get();
+    std::lock_guard<std::mutex> lock(pool.m_resizeMutex);
+    if (pool.m_started && pool.m_workers.size() != GetThreadBudget() - 1)
+    {
+        pool.Stop();
+        pool.Start(GetThreadBudget() - 1);
+    }
+}
+
+size_t ThreadPool::GetNumWorkers()
+{
+    if (!m_started)
+    {
+        std::lock_guard<std::mutex> lock(m_resizeMutex);
+        if (!m_started)
+            Start(GetThreadBudget() - 1);
+    }
+    return m_workers.size();
+}
+
+void ThreadPool::Start(size_t numWorkers)
+{
+    m_stop = false;
+    m_workers.clear();
+    for (size_t i = 0; i < numWorkers; i++)
+        m_workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    for (size_t i = 0; i < numWorkers; i++)
+        m_workers[i]->m_thread = std::thread([this, i]() { WorkerLoop(i); });
+    m_started = true;
+}
+
+void ThreadPool::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers)
+        worker->m_thread.join();
+    m_workers.clear();
+    m_started = false;
+}
+
+ThreadPool::~ThreadPool()
+{
+    std::lock_guard<std::mutex> lock(m_resizeMutex);
+    if (m_started)
+        Stop();
+}
+
+bool ThreadPool::TryPop(size_t queue, bool back, std::function<void()>& task)
+{
+    Worker& worker = *m_workers[queue];
+    std::lock_guard<std::mutex> lock(worker.m_mutex);
+    if (worker.m_tasks.empty())
+        return false;
+    if (back)
+    {
+        task = std::move(worker.m_tasks.back());
+        worker.m_tasks.pop_back();
+    }
+    else
+    {
+        task = std::move(worker.m_tasks.front());
+        worker.m_tasks.pop_front();
+    }
+    m_pending--;
+    return true;
+}
+
+// Runs one queued task: the newest one of the own queue if the caller is a worker, else the oldest one of any queue.
+bool ThreadPool::TryRunOne()
+{
+    const size_t numQueues = m_workers.size();
+    if (numQueues == 0 || m_pending == 0)
+        return false;
+
+    const bool isWorker = t_pool == this;
+    const size_t first = isWorker ? t_workerIndex : m_nextQueue % numQueues;
+    std::function<void()> task;
+    for (size_t i = 0; i < numQueues; i++)
+    {
+        const size_t queue = (first + i) % numQueues;
+        if (TryPop(queue, /*back=*/isWorker && i == 0, task))
+        {
+            task();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::WorkerLoop(size_t index)
+{
+    t_pool = this;
+    t_workerIndex = index;
+    for (;;)
+    {
+        if (TryRunOne())
+            continue;
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this]() { return m_stop || m_pending > 0; });
+        if (m_stop && m_pending == 0)
+            return;
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+    size_t numWorkers = GetNumWorkers();
+    if (numWorkers == 0)
+        return task();
+
+    // workers keep their own tasks, others spread them round robin
+    const size_t queue = t_pool == this ? t_workerIndex : m_nextQueue++ % numWorkers;
+    {
+        std::lock_guard<std::mutex> lock(m_workers[queue]->m_mutex);
+        m_workers[queue]->m_tasks.push_back(std::move(task));
+        m_pending++;
+    }
+    {
+        // taking the lock orders this with the check of a worker that is about to sleep
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_wake.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t begin, size_t end, size_t grainSize, const std::function<void(size_t, size_t)>& body)
+{
+    if (end <= begin)
+        return;
+    grainSize = std::max<size_t>(1, grainSize);
+    const size_t numChunks = (end - begin + grainSize - 1) / grainSize;
+    const size_t numHelpers = std::min(numChunks - 1, GetNumWorkers());
+    if (numHelpers == 0)
+    {
+        for (size_t b = begin; b < end; b += grainSize)
+            body(b, std::min(end, b + grainSize));
+        return;
+    }
+
+    // Shared with the helper tasks, which may start after this call has returned: then no chunk is left for them.
+    struct State
+    {
+        std::atomic<size_t> m_nextChunk;
+        std::atomic<size_t> m_numDone;
+        std::atomic<bool> m_failed;
+        std::exception_ptr m_exception;
+        std::mutex m_exceptionMutex;
+    };
+    auto state = std::make_shared<State>();
+    state->m_nextChunk = 0;
+    state->m_numDone = 0;
+    state->m_failed = false;
+
+    // claims and runs chunks until none are left
+    const std::function<void(size_t, size_t)>* pBody = &body;
+    auto runChunks = [state, pBody, begin, end, grainSize, numChunks]()
+    {
+        for (;;)
+        {
+            const size_t chunk = state->m_nextChunk++;
+            if (chunk >= numChunks)
+                return;
+            if (!state->m_failed)
+            {
+                try
+                {
+                    const size_t b = begin + chunk * grainSize;
+                    (*pBody)(b, std::min(end, b + grainSize));
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(state->m_exceptionMutex);
+                    if (!state->m_failed)
+                        state->m_exception = std::current_exception();
+                    state->m_failed = true;
+                }
+            }
+            state->m_numDone++;
+        }
+    };
+
+    for (size_t i = 0; i < numHelpers; i++)
+        Submit(runChunks);
+    runChunks();
+
+    // the chunks claimed by others may still be running: help with other work meanwhile
+    RunPendingUntil([&state, numChunks]() { return state->m_numDone >= numChunks; });
+
+    if (state->m_failed)
+        std::rethrow_exception(state->m_exception);
+}
+
+void ThreadPool::RunPendingUntil(const std::function<bool()>& isDone)
+{
+    while (!isDone())
+    {
+        if (!TryRunOne())
+            std::this_thread::yield();
+    }
+}
+
+// Shared by the tasks of a RunTaskGraph() call. A task submits its dependents that have become ready before it counts
+// itself as done, so that the state is not used after the last task is done, except for releasing it.
+struct ThreadPool::TaskGraph
+{
+    ThreadPool* m_pool;
+    const std::function<void(size_t)>* m_task;
+    std::vector<std::vector<size_t>> m_dependents;
+    std::unique_ptr<std::atomic<size_t>[]> m_numWaiting; // number of dependencies not done yet
+    std::atomic<size_t> m_numDone;
+    std::atomic<bool> m_failed;
+    std::exception_ptr m_exception;
+    std::mutex m_exceptionMutex;
+};
+
+void ThreadPool::RunGraphTask(const std::shared_ptr<TaskGraph>& graph, size_t index)
+{
+    // a dependent that becomes ready continues on this thread, further ones are submitted
+    for (;;)
+    {
+        if (!graph->m_failed)
+        {
+            try
+            {
+                (*graph->m_task)(index);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(graph->m_exceptionMutex);
+                if (!graph->m_failed)
+                    graph->m_exception = std::current_exception();
+                graph->m_failed = true;
+            }
+        }
+
+        const size_t none = (size_t)-1;
+        size_t next = none;
+        for (auto dependent : graph->m_dependents[index])
+        {
+            if (--graph->m_numWaiting[dependent] != 0)
+                continue;
+            if (next == none)
+                next = dependent;
+            else
+                graph->m_pool->Submit([graph, dependent]() { RunGraphTask(graph, dependent); });
+        }
+        graph->m_numDone++;
+        if (next == none)
+            return;
+        index = next;
+    }
+}
+
+void ThreadPool::RunTaskGraph(const std::vector<std::vector<size_t>>& dependencies, const std::function<void(size_t)>& task)
+{
+    const size_t numTasks = dependencies.size();
+    for (size_t i = 0; i < numTasks; i++)
+    {
+        for (auto dependency : dependencies[i])
+        {
+            if (dependency >= i)
+                LogicError("RunTaskGraph: Task %d depends on task %d, which does not come before it.", (int)i, (int)dependency);
+        }
+    }
+
+    // without workers, the order of the tasks is a valid one
+    if (GetNumWorkers() == 0)
+    {
+        for (size_t i = 0; i < numTasks; i++)
+            task(i);
+        return;
+    }
+
+    auto graph = std::make_shared<TaskGraph>();
+    graph->m_pool = this;
+    graph->m_task = &task;
+    graph->m_dependents.resize(numTasks);
+    graph->m_numWaiting.reset(new std::atomic<size_t>[numTasks]);
+    graph->m_numDone = 0;
+    graph->m_failed = false;
+    std::vector<size_t> ready;
+    for (size_t i = 0; i < numTasks; i++)
+    {
+        graph->m_numWaiting[i] = dependencies[i].size();
+        for (auto dependency : dependencies[i])
+            graph->m_dependents[dependency].push_back(i);
+        if (dependencies[i].empty())
+            ready.push_back(i);
+    }
+
+    for (size_t k = 1; k < ready.size(); k++)
+    {
+        const size_t index = ready[k];
+        Submit([graph, index]() { RunGraphTask(graph, index); });
+    }
+    if (!ready.empty())
+        RunGraphTask(graph, ready[0]);
+    RunPendingUntil([&graph, numTasks]() { return graph->m_numDone >= numTasks; });
+
+    if (graph->m_failed)
+        std::rethrow_exception(graph->m_exception);
+}
+
+ComputeThreadShare::ComputeThreadShare() : m_previousNumThreads(0)
+{
+    const int numActive = ++s_numActive;
+    if (numActive <= 1)
+        return;
+
+#ifdef _OPENMP
+    // the number of threads of parallel regions is a per-thread setting
+    const int share = std::max(1, (int)(ThreadPool::GetThreadBudget() / numActive));
+    m_previousNumThreads = omp_get_max_threads();
+    if (share < m_previousNumThreads)
+    {
+        omp_set_num_threads(share);
+#ifdef USE_MKL
+        mkl_set_num_threads_local(share);
+#endif
+    }
+    else
+        m_previousNumThreads = 0;
+#endif
+}
+
+size_t ComputeThreadShare::GetShare()
+{
+    return std::max<size_t>(1, ThreadPool::GetThreadBudget() / std::max(1, (int)s_numActive));
+}
+
+ComputeThreadShare::~ComputeThreadShare()
+{
+#ifdef _OPENMP
+    if (m_previousNumThreads != 0)
+    {
+        omp_set_num_threads(m_previousNumThreads);
+#ifdef USE_MKL
+        mkl_set_num_threads_local(0); // back to the global setting
+#endif
+    }
+#endif
+    s_numActive--;
+}
+
+ComputeThreadLimit::ComputeThreadLimit(size_t numThreads) : m_previousNumThreads(0)
+{
+#ifdef _OPENMP
+    const int limit = std::max(1, (int)numThreads);
+    const int previous = omp_get_max_threads();
+    if (limit != previous)
+    {
+        m_previousNumThreads = previous;
+        omp_set_num_threads(limit);
+#ifdef USE_MKL
+        mkl_set_num_threads_local(limit);
+#endif
+    }
+#else
+    UNUSED(numThreads);
+#endif
+}
+
+ComputeThreadLimit::~ComputeThreadLimit()
+{
+#ifdef _OPENMP
+    if (m_previousNumThreads != 0)
+    {
+        omp_set_num_threads(m_previousNumThreads);
+#ifdef USE_MKL
+        mkl_set_num_threads_local(0); // back to the global setting
+#endif
+    }
+#endif
+}
+
+}}}
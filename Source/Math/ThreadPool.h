@@ -0,0 +1,155 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// ThreadPool.h -- the process-wide pool of worker threads for CPU work outside of the OpenMP kernels (reader transforms,
+// chunk prefetch), and the budget that bounds the total number of compute threads of concurrent evaluations.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef MATH_API
+#ifdef MATH_EXPORTS
+#define MATH_API __declspec(dllexport)
+#else
+#define MATH_API __declspec(dllimport)
+#endif
+#endif /* MATH_API */
+#else  // no DLLs in Linux
+#define MATH_API
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Persistent work-stealing thread pool. Each worker has its own queue: tasks submitted by a worker go to the back of
+// its queue and are run LIFO, idle workers steal from the front of the others' queues.
+// Threads that wait for a ParallelFor() run pending tasks meanwhile, so it may be nested and called from tasks.
+// Tasks should not block on other tasks (e.g. on the future of Async()) since the pool has a fixed number of threads.
+class MATH_API ThreadPool
+{
+public:
+    // The pool shared by the whole process. Its workers are started on first use.
+    static ThreadPool& Get();
+
+    // Sets the total number of threads that do CPU work, callers included: the pool runs budget - 1 workers
+    // (none for a budget of 1, then all tasks run on the calling thread), and ComputeThreadShare divides the
+    // budget among concurrent evaluations. 0 restores the default, the number of hardware threads.
+    // Runs the queued tasks before the workers are replaced; must not be called while other threads use the pool.
+    // Called by CPUMatrix::SetNumThreads().
+    static void SetThreadBudget(size_t numThreads);
+    static size_t GetThreadBudget();
+
+    size_t GetNumWorkers();
+
+    // Runs 'task' on a worker. Exceptions thrown by it are lost, use Async() to observe them.
+    void Submit(std::function<void()> task);
+
+    // Runs 'f' on a worker and returns the future of its result.
+    template <class F>
+    auto Async(F&& f) -> std::future<decltype(f())>
+    {
+        typedef decltype(f()) Result;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(f));
+        std::future<Result> result = task->get_future();
+        Submit([task]() { (*task)(); });
+        return result;
+    }
+
+    // Calls body(b, e) for consecutive chunks [b, e) of [begin, end) of 'grainSize' elements (the last one may be
+    // smaller), in parallel on the calling thread and the workers, and returns when all are done. The chunks are
+    // handed out in order as threads become free, like schedule(dynamic, grainSize).
+    // The first exception thrown by the body is rethrown; the remaining chunks are skipped.
+    void ParallelFor(size_t begin, size_t end, size_t grainSize, const std::function<void(size_t, size_t)>& body);
+
+    // Calls task(i) for every i in [0, dependencies.size()) once task(j) has returned for all j in dependencies[i], which
+    // must come before i. Independent tasks run in parallel on the calling thread and the workers; returns when all are
+    // done. The first exception thrown by a task is rethrown; the tasks that have not started by then are skipped.
+    void RunTaskGraph(const std::vector<std::vector<size_t>>& dependencies, const std::function<void(size_t)>& task);
+
+    // Runs queued tasks on the calling thread until isDone() returns true, e.g. while waiting for tasks it submitted.
+    void RunPendingUntil(const std::function<bool()>& isDone);
+
+    ~ThreadPool();
+
+private:
+    struct Worker
+    {
+        std::mutex m_mutex;
+        std::deque<std::function<void()>> m_tasks;
+        std::thread m_thread;
+    };
+
+    ThreadPool() : m_started(false), m_stop(false), m_pending(0), m_nextQueue(0) {}
+
+    void Start(size_t numWorkers);
+    void Stop();
+    void WorkerLoop(size_t index);
+    bool TryRunOne();
+    bool TryPop(size_t queue, bool back, std::function<void()>& task);
+
+    struct TaskGraph;
+    static void RunGraphTask(const std::shared_ptr<TaskGraph>& graph, size_t index);
+
+    std::mutex m_resizeMutex; // held while workers are started or stopped
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<bool> m_started;
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    bool m_stop;
+    std::atomic<size_t> m_pending; // number of queued tasks
+    std::atomic<size_t> m_nextQueue;
+
+    static std::atomic<size_t> s_threadBudget;
+};
+
+// While in scope, limits the OpenMP (and MKL) threads used by the math kernels called from this thread to its share of
+// the thread budget: the budget divided by the number of ComputeThreadShare instances alive (at the time of construction).
+// Concurrent evaluations (e.g. Function::Forward() on clones from different threads) thus do not each use all cores.
+// Has no effect if it is the only one: then the kernels use the threads set by CPUMatrix::SetNumThreads().
+class MATH_API ComputeThreadShare
+{
+public:
+    ComputeThreadShare();
+    ~ComputeThreadShare();
+
+    // the share of the budget of each of the instances alive
+    static size_t GetShare();
+
+private:
+    int m_previousNumThreads; // 0 if nothing was changed
+
+    ComputeThreadShare(const ComputeThreadShare&) = delete;
+    ComputeThreadShare& operator=(const ComputeThreadShare&) = delete;
+
+    static std::atomic<int> s_numActive;
+};
+
+// While in scope, sets the OpenMP (and MKL) threads used by the math kernels called from this thread to 'numThreads',
+// e.g. for a task of the pool that runs at the same time as others.
+class MATH_API ComputeThreadLimit
+{
+public:
+    explicit ComputeThreadLimit(size_t numThreads);
+    ~ComputeThreadLimit();
+
+private:
+    int m_previousNumThreads; // 0 if nothing was changed
+
+    ComputeThreadLimit(const ComputeThreadLimit&) = delete;
+    ComputeThreadLimit& operator=(const ComputeThreadLimit&) = delete;
+};
+
+}}}
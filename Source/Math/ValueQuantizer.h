@@ -4,6 +4,8 @@
 
 #include "Basics.h"
 #include "BestGpu.h" // for CPUONLY
+#include "File.h"
+#include "half.hpp"
 #ifndef CPUONLY
 #include <cuda.h>
 #include <cuda_runtime.h>
@@ -54,7 +56,17 @@ public:
     static_assert(sizeof(double) == sizeof(ValueType), "Quantized word size != size of ElemType=double");
 };
 
+template <>
+class QuantizedWordHelper<half>
+{
+public:
+    typedef unsigned short ValueType;
+    typedef short ValueTypeSigned;
+    static_assert(sizeof(half) == sizeof(ValueType), "Quantized word size != size of ElemType=half");
+};
+
 #pragma warning(disable : 4334) // 'operator' : result of 32-bit shift implicitly converted to 64 bits (was 64-bit shift intended?)
+// The values are quantized in CompType: for half, the scale factors of a narrow range would overflow in half.
 template <class ElemType>
 class ValueQuantizer
 {
@@ -62,10 +74,11 @@ public:
     typedef typename QuantizedWordHelper<ElemType>::ValueType QWord;
     typedef typename QuantizedWordHelper<ElemType>::ValueType QWordVal;
     typedef typename QuantizedWordHelper<ElemType>::ValueTypeSigned QWordValSigned;
+    typedef typename TypeSelector<ElemType>::comp_t CompType;
     static const size_t QWordNumBits = 8 * sizeof(QWord);
 
 public:
-    cudasharedcode ValueQuantizer(size_t ldNbits, ElemType lower, ElemType upper)
+    cudasharedcode ValueQuantizer(size_t ldNbits, CompType lower, CompType upper)
         : ldNbits(ldNbits), Nbits(1 << ldNbits), quantimin(lower), quantimax(upper)
     {
         rangeend = ((QWordVal) 1) << Nbits;
@@ -80,7 +93,7 @@ public:
         // must protect against NaN: interval is 0 -> quantization is futile, just emit 0
         if (((quantimax - quantimin) < 1e-36f) || (rangeend == 0))
         {
-            qfactor = ufactor = (ElemType) 0.0;
+            qfactor = ufactor = (CompType) 0.0;
         }
         else
         {
@@ -99,7 +112,7 @@ public:
     // quantize one value
     // TODO: we can optimize for 1 bit here - very simply use a template arg 'isonebit'
     template <bool ZeroThresholdFor1Bit>
-    cudasharedcode QWordVal Quantize(ElemType u) const
+    cudasharedcode QWordVal Quantize(CompType u) const
     {
         if (Nbits == QWordNumBits)
         {
@@ -128,21 +141,21 @@ public:
     }
 
     // unquantize one value
-    cudasharedcode ElemType Unquantize(QWordVal u) const
+    cudasharedcode CompType Unquantize(QWordVal u) const
     {
         // special branch that does not quantize at all, for testing
         if (Nbits == QWordNumBits)
         {
-            return *(ElemType*) &u;
+            return (CompType) *(ElemType*) &u;
         }
 
         // Note: in 1-bit case, we want 0.5 -> mean0, 1.5 -> mean1
-        return ((u + (ElemType) 0.5) * ufactor) + quantimin;
+        return ((u + (CompType) 0.5) * ufactor) + quantimin;
     }
 
     // quantize one value --special version for 1 bit
     template <bool ZeroThresholdFor1Bit>
-    cudasharedcode bool Quantize1(ElemType u) const
+    cudasharedcode bool Quantize1(CompType u) const
     {
         assert(Nbits == 1);
         if (!ZeroThresholdFor1Bit)
@@ -151,12 +164,12 @@ public:
         }
         else
         {
-            return u >= (ElemType) 0.0;
+            return u >= (CompType) 0.0;
         }
     }
 
     // unquantize one value  --special case for 1 bit
-    static cudasharedcode ElemType Unquantize1(bool u, ElemType val0, ElemType val1)
+    static cudasharedcode CompType Unquantize1(bool u, CompType val0, CompType val1)
     {
         return u ? val1 : val0;
     }
@@ -192,12 +205,13 @@ public:
 
 protected:
     // quantize for full ElemType size bits case (special case that allows to bypass quantization, for testing/debugging purposes)
-    cudasharedcode QWordVal QuantizeToFullQWord(ElemType u) const
+    cudasharedcode QWordVal QuantizeToFullQWord(CompType u) const
     {
         assert(Nbits == QWordNumBits);
 
         // we return the bit pattern that encodes the float value
-        return *(QWordVal*) &u;
+        ElemType e = (ElemType) u;
+        return *(QWordVal*) &e;
     }
 
 protected:
@@ -208,17 +222,17 @@ protected:
     QWordVal rangeend;
 
     // quantization range
-    ElemType quantimin;
-    ElemType quantimax;
+    CompType quantimin;
+    CompType quantimax;
 
     // quantization threshold for 1-bit case
-    ElemType quantimid;
+    CompType quantimid;
 
     // precomputed factor for quantizing
-    ElemType qfactor;
+    CompType qfactor;
 
     // and for unquantizing
-    ElemType ufactor;
+    CompType ufactor;
 };
 }
 }
@@ -0,0 +1,295 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+// define bfloat16 type: the upper 16 bits of a float, i.e. the range of float with 8 bits of precision.
+// Unlike half, it does not overflow where float does not, so training in it needs no loss scaling.
+// It is a storage type; like half, it is computed in float (see TypeSelector). Included by half.hpp.
+
+#pragma once
+
+#include <cstring>
+
+#if defined(__CUDACC__)
+#define __CUDA_HOSTDEVICE__ __host__ __device__
+#define __INLINE__ __forceinline__
+#else
+#define __CUDA_HOSTDEVICE__
+#define __INLINE__ inline
+#endif
+
+#define __BF16_DECL__ __INLINE__ __CUDA_HOSTDEVICE__
+
+class alignas(2) bfloat16 {
+public:
+    bfloat16() = default;
+    __BF16_DECL__ bfloat16(const bfloat16& other) { __x = other.__x; }
+    __BF16_DECL__ bfloat16& operator=(const bfloat16& other) { __x = other.__x; return *this; }
+
+    // construction from build-in types
+    __BF16_DECL__ bfloat16(float f) { __x = FloatToBits(f); }
+    __BF16_DECL__ bfloat16(double d) : bfloat16((float)d) {}
+    __BF16_DECL__ bfloat16(char i) : bfloat16((float)i) {}
+    __BF16_DECL__ bfloat16(short i) : bfloat16((float)i) {}
+    __BF16_DECL__ bfloat16(int i) : bfloat16((float)i) {}
+    __BF16_DECL__ bfloat16(size_t u) : bfloat16((float)u) {}
+
+    __BF16_DECL__ bfloat16& operator=(float f) { __x = FloatToBits(f); return *this; }
+    __BF16_DECL__ bfloat16& operator=(int i) { *this = ((float)i); return *this; }
+    __BF16_DECL__ bfloat16& operator=(double d) { *this = ((float)d); return *this; }
+    __BF16_DECL__ bfloat16& operator=(size_t u) { *this = ((float)u); return *this; }
+
+    // cast to build-in types
+    __BF16_DECL__ operator float() const
+    {
+        unsigned int u = (unsigned int)__x << 16;
+#ifndef __CUDA_ARCH__
+        float f;
+        memcpy(&f, &u, sizeof(f));
+        return f;
+#else
+        return __uint_as_float(u);
+#endif
+    }
+
+#ifndef HALF_IN_BOOST_TEST // cast operators below conflict with boost test
+    __BF16_DECL__ operator bool() const { return (bool)(float)(*this); }
+    __BF16_DECL__ operator char() const { return (char)(float)(*this); }
+    __BF16_DECL__ operator short() const { return (short)(float)(*this); }
+    __BF16_DECL__ operator int() const { return (int)(float)(*this); }
+    __BF16_DECL__ operator size_t() const { return (size_t)(float)(*this); }
+    __BF16_DECL__ operator long() const { return (long)(float)(*this); }
+    __BF16_DECL__ operator long long() const { return (long long)(float)(*this); }
+#endif
+
+private:
+    // rounds to nearest even; NaNs stay quiet NaNs, and values beyond the largest bfloat16 become infinite
+    __BF16_DECL__ static unsigned short FloatToBits(float f)
+    {
+#ifndef __CUDA_ARCH__
+        unsigned int u;
+        memcpy(&u, &f, sizeof(u));
+#else
+        unsigned int u = __float_as_uint(f);
+#endif
+        if ((u & 0x7fffffff) > 0x7f800000)
+            return (unsigned short)((u >> 16) | 0x40);
+        u += 0x7fff + ((u >> 16) & 1);
+        return (unsigned short)(u >> 16);
+    }
+
+    unsigned short __x;
+};
+
+/* Specialization for bfloat16 (see half.hpp). Kernels uses this wants io in bfloat16 while compute in float */
+template <typename ElemType>
+struct TypeSelector;
+
+template <>
+struct TypeSelector<bfloat16>
+{
+    typedef float comp_t;
+};
+
+/* operators to write to/read from files for bfloat16 */
+inline Microsoft::MSR::CNTK::File& operator>>(Microsoft::MSR::CNTK::File& stream, bfloat16& h)
+{
+    int v;
+    stream >> v;
+    *(short *)&h = (short)v;
+    return stream;
+}
+inline Microsoft::MSR::CNTK::File& operator<<(Microsoft::MSR::CNTK::File& stream, const bfloat16& h)
+{
+    stream << (int)*(short *)&h;
+    return stream;
+}
+
+/* Some basic arithmetic operations expected of a builtin */
+__BF16_DECL__ bfloat16 operator+(const bfloat16 &lh, const bfloat16 &rh) { return (bfloat16)((float)lh + (float)rh); }
+__BF16_DECL__ bfloat16 operator-(const bfloat16 &lh, const bfloat16 &rh) { return (bfloat16)((float)lh - (float)rh); }
+__BF16_DECL__ bfloat16 operator*(const bfloat16 &lh, const bfloat16 &rh) { return (bfloat16)((float)lh * (float)rh); }
+__BF16_DECL__ bfloat16 operator/(const bfloat16 &lh, const bfloat16 &rh) { return (bfloat16)((float)lh / (float)rh); }
+
+__BF16_DECL__ bfloat16 &operator+=(bfloat16 &lh, const bfloat16 &rh) { lh = lh + rh; return lh; }
+__BF16_DECL__ bfloat16 &operator-=(bfloat16 &lh, const bfloat16 &rh) { lh = lh - rh; return lh; }
+__BF16_DECL__ bfloat16 &operator*=(bfloat16 &lh, const bfloat16 &rh) { lh = lh * rh; return lh; }
+__BF16_DECL__ bfloat16 &operator/=(bfloat16 &lh, const bfloat16 &rh) { lh = lh / rh; return lh; }
+
+__BF16_DECL__ bfloat16 &operator++(bfloat16 &h)      { h += bfloat16(1.0f); return h; }
+__BF16_DECL__ bfloat16 &operator--(bfloat16 &h)      { h -= bfloat16(1.0f); return h; }
+__BF16_DECL__ bfloat16  operator++(bfloat16 &h, int) { bfloat16 ret = h; h += bfloat16(1.0f); return ret; }
+__BF16_DECL__ bfloat16  operator--(bfloat16 &h, int) { bfloat16 ret = h; h -= bfloat16(1.0f); return ret; }
+
+/* Unary plus and inverse operators */
+__BF16_DECL__ bfloat16 operator+(const bfloat16 &h) { return h; }
+__BF16_DECL__ bfloat16 operator-(const bfloat16 &h) { return bfloat16(0.0f) - h; }
+
+/* Some basic comparison operations to make it look like a builtin */
+__BF16_DECL__ bool operator==(const bfloat16 &lh, const bfloat16 &rh) { return (float)lh == (float)rh; }
+__BF16_DECL__ bool operator!=(const bfloat16 &lh, const bfloat16 &rh) { return (float)lh != (float)rh; }
+__BF16_DECL__ bool operator> (const bfloat16 &lh, const bfloat16 &rh) { return (float)lh > (float)rh; }
+__BF16_DECL__ bool operator< (const bfloat16 &lh, const bfloat16 &rh) { return (float)lh < (float)rh; }
+__BF16_DECL__ bool operator>=(const bfloat16 &lh, const bfloat16 &rh) { return (float)lh >= (float)rh; }
+__BF16_DECL__ bool operator<=(const bfloat16 &lh, const bfloat16 &rh) { return (float)lh <= (float)rh; }
+
+// overload binary operators between 'bfloat16' and build-in type. TODO: This should be handled in a better way
+// int
+__BF16_DECL__ float operator+(const int &lh, const bfloat16 &rh) { return (float)lh + (float)rh; }
+__BF16_DECL__ float operator-(const int &lh, const bfloat16 &rh) { return (float)lh - (float)rh; }
+__BF16_DECL__ float operator*(const int &lh, const bfloat16 &rh) { return (float)lh * (float)rh; }
+__BF16_DECL__ float operator/(const int &lh, const bfloat16 &rh) { return (float)lh / (float)rh; }
+__BF16_DECL__ bool operator==(const int &lh, const bfloat16 &rh) { return (float)lh == (float)rh; }
+__BF16_DECL__ bool operator!=(const int &lh, const bfloat16 &rh) { return (float)lh != (float)rh; }
+__BF16_DECL__ bool operator> (const int &lh, const bfloat16 &rh) { return (float)lh > (float)rh; }
+__BF16_DECL__ bool operator< (const int &lh, const bfloat16 &rh) { return (float)lh < (float)rh; }
+__BF16_DECL__ bool operator>=(const int &lh, const bfloat16 &rh) { return (float)lh >= (float)rh; }
+__BF16_DECL__ bool operator<=(const int &lh, const bfloat16 &rh) { return (float)lh <= (float)rh; }
+
+__BF16_DECL__ float operator+(const bfloat16 &lh, const int &rh) { return (float)lh + (float)rh; }
+__BF16_DECL__ float operator-(const bfloat16 &lh, const int &rh) { return (float)lh - (float)rh; }
+__BF16_DECL__ float operator*(const bfloat16 &lh, const int &rh) { return (float)lh * (float)rh; }
+__BF16_DECL__ float operator/(const bfloat16 &lh, const int &rh) { return (float)lh / (float)rh; }
+__BF16_DECL__ bool operator==(const bfloat16 &lh, const int &rh) { return (float)lh == (float)rh; }
+__BF16_DECL__ bool operator!=(const bfloat16 &lh, const int &rh) { return (float)lh != (float)rh; }
+__BF16_DECL__ bool operator> (const bfloat16 &lh, const int &rh) { return (float)lh > (float)rh; }
+__BF16_DECL__ bool operator< (const bfloat16 &lh, const int &rh) { return (float)lh < (float)rh; }
+__BF16_DECL__ bool operator>=(const bfloat16 &lh, const int &rh) { return (float)lh >= (float)rh; }
+__BF16_DECL__ bool operator<=(const bfloat16 &lh, const int &rh) { return (float)lh <= (float)rh; }
+
+// double
+__BF16_DECL__ double operator+(const double &lh, const bfloat16 &rh) { return (double)lh + (double)rh; }
+__BF16_DECL__ double operator-(const double &lh, const bfloat16 &rh) { return (double)lh - (double)rh; }
+__BF16_DECL__ double operator*(const double &lh, const bfloat16 &rh) { return (double)lh * (double)rh; }
+__BF16_DECL__ double operator/(const double &lh, const bfloat16 &rh) { return (double)lh / (double)rh; }
+__BF16_DECL__ bool operator==(const double &lh, const bfloat16 &rh) { return (double)lh == (double)rh; }
+__BF16_DECL__ bool operator!=(const double &lh, const bfloat16 &rh) { return (double)lh != (double)rh; }
+__BF16_DECL__ bool operator> (const double &lh, const bfloat16 &rh) { return (double)lh > (double)rh; }
+__BF16_DECL__ bool operator< (const double &lh, const bfloat16 &rh) { return (double)lh < (double)rh; }
+__BF16_DECL__ bool operator>=(const double &lh, const bfloat16 &rh) { return (double)lh >= (double)rh; }
+__BF16_DECL__ bool operator<=(const double &lh, const bfloat16 &rh) { return (double)lh <= (double)rh; }
+
+__BF16_DECL__ double operator+(const bfloat16 &lh, const double &rh) { return (double)lh + (double)rh; }
+__BF16_DECL__ double operator-(const bfloat16 &lh, const double &rh) { return (double)lh - (double)rh; }
+__BF16_DECL__ double operator*(const bfloat16 &lh, const double &rh) { return (double)lh * (double)rh; }
+__BF16_DECL__ double operator/(const bfloat16 &lh, const double &rh) { return (double)lh / (double)rh; }
+__BF16_DECL__ bool operator==(const bfloat16 &lh, const double &rh) { return (double)lh == (double)rh; }
+__BF16_DECL__ bool operator!=(const bfloat16 &lh, const double &rh) { return (double)lh != (double)rh; }
+__BF16_DECL__ bool operator> (const bfloat16 &lh, const double &rh) { return (double)lh > (double)rh; }
+__BF16_DECL__ bool operator< (const bfloat16 &lh, const double &rh) { return (double)lh < (double)rh; }
+__BF16_DECL__ bool operator>=(const bfloat16 &lh, const double &rh) { return (double)lh >= (double)rh; }
+__BF16_DECL__ bool operator<=(const bfloat16 &lh, const double &rh) { return (double)lh <= (double)rh; }
+
+// float
+__BF16_DECL__ float operator+(const float &lh, const bfloat16 &rh) { return (float)lh + (float)rh; }
+__BF16_DECL__ float operator-(const float &lh, const bfloat16 &rh) { return (float)lh - (float)rh; }
+__BF16_DECL__ float operator*(const float &lh, const bfloat16 &rh) { return (float)lh * (float)rh; }
+__BF16_DECL__ float operator/(const float &lh, const bfloat16 &rh) { return (float)lh / (float)rh; }
+__BF16_DECL__ bool operator==(const float &lh, const bfloat16 &rh) { return (float)lh == (float)rh; }
+__BF16_DECL__ bool operator!=(const float &lh, const bfloat16 &rh) { return (float)lh != (float)rh; }
+__BF16_DECL__ bool operator> (const float &lh, const bfloat16 &rh) { return (float)lh > (float)rh; }
+__BF16_DECL__ bool operator< (const float &lh, const bfloat16 &rh) { return (float)lh < (float)rh; }
+__BF16_DECL__ bool operator>=(const float &lh, const bfloat16 &rh) { return (float)lh >= (float)rh; }
+__BF16_DECL__ bool operator<=(const float &lh, const bfloat16 &rh) { return (float)lh <= (float)rh; }
+
+__BF16_DECL__ float operator+(const bfloat16 &lh, const float &rh) { return (float)lh + (float)rh; }
+__BF16_DECL__ float operator-(const bfloat16 &lh, const float &rh) { return (float)lh - (float)rh; }
+__BF16_DECL__ float operator*(const bfloat16 &lh, const float &rh) { return (float)lh * (float)rh; }
+__BF16_DECL__ float operator/(const bfloat16 &lh, const float &rh) { return (float)lh / (float)rh; }
+__BF16_DECL__ bool operator==(const bfloat16 &lh, const float &rh) { return (float)lh == (float)rh; }
+__BF16_DECL__ bool operator!=(const bfloat16 &lh, const float &rh) { return (float)lh != (float)rh; }
+__BF16_DECL__ bool operator> (const bfloat16 &lh, const float &rh) { return (float)lh > (float)rh; }
+__BF16_DECL__ bool operator< (const bfloat16 &lh, const float &rh) { return (float)lh < (float)rh; }
+__BF16_DECL__ bool operator>=(const bfloat16 &lh, const float &rh) { return (float)lh >= (float)rh; }
+__BF16_DECL__ bool operator<=(const bfloat16 &lh, const float &rh) { return (float)lh <= (float)rh; }
+
+// size_t
+__BF16_DECL__ float operator+(const size_t &lh, const bfloat16 &rh) { return (float)lh + (float)rh; }
+__BF16_DECL__ float operator-(const size_t &lh, const bfloat16 &rh) { return (float)lh - (float)rh; }
+__BF16_DECL__ float operator*(const size_t &lh, const bfloat16 &rh) { return (float)lh * (float)rh; }
+__BF16_DECL__ float operator/(const size_t &lh, const bfloat16 &rh) { return (float)lh / (float)rh; }
+__BF16_DECL__ bool operator==(const size_t &lh, const bfloat16 &rh) { return (float)lh == (float)rh; }
+__BF16_DECL__ bool operator!=(const size_t &lh, const bfloat16 &rh) { return (float)lh != (float)rh; }
+__BF16_DECL__ bool operator> (const size_t &lh, const bfloat16 &rh) { return (float)lh > (float)rh; }
+__BF16_DECL__ bool operator< (const size_t &lh, const bfloat16 &rh) { return (float)lh < (float)rh; }
+__BF16_DECL__ bool operator>=(const size_t &lh, const bfloat16 &rh) { return (float)lh >= (float)rh; }
+__BF16_DECL__ bool operator<=(const size_t &lh, const bfloat16 &rh) { return (float)lh <= (float)rh; }
+
+__BF16_DECL__ float operator+(const bfloat16 &lh, const size_t &rh) { return (float)lh + (float)rh; }
+__BF16_DECL__ float operator-(const bfloat16 &lh, const size_t &rh) { return (float)lh - (float)rh; }
+__BF16_DECL__ float operator*(const bfloat16 &lh, const size_t &rh) { return (float)lh * (float)rh; }
+__BF16_DECL__ float operator/(const bfloat16 &lh, const size_t &rh) { return (float)lh / (float)rh; }
+__BF16_DECL__ bool operator==(const bfloat16 &lh, const size_t &rh) { return (float)lh == (float)rh; }
+__BF16_DECL__ bool operator!=(const bfloat16 &lh, const size_t &rh) { return (float)lh != (float)rh; }
+__BF16_DECL__ bool operator> (const bfloat16 &lh, const size_t &rh) { return (float)lh > (float)rh; }
+__BF16_DECL__ bool operator< (const bfloat16 &lh, const size_t &rh) { return (float)lh < (float)rh; }
+__BF16_DECL__ bool operator>=(const bfloat16 &lh, const size_t &rh) { return (float)lh >= (float)rh; }
+__BF16_DECL__ bool operator<=(const bfloat16 &lh, const size_t &rh) { return (float)lh <= (float)rh; }
+
+// LONG64(one place use this)
+__BF16_DECL__ bool operator!=(const LONG64 &lh, const bfloat16 &rh) { return (float)lh != (float)rh; }
+
+
+// long int used by cpu matrix
+__BF16_DECL__ float operator+(const long int &lh, const bfloat16 &rh) { return (float)lh + (float)rh; }
+__BF16_DECL__ float operator-(const long int &lh, const bfloat16 &rh) { return (float)lh - (float)rh; }
+__BF16_DECL__ float operator*(const long int &lh, const bfloat16 &rh) { return (float)lh * (float)rh; }
+__BF16_DECL__ float operator/(const long int &lh, const bfloat16 &rh) { return (float)lh / (float)rh; }
+__BF16_DECL__ bool operator==(const long int &lh, const bfloat16 &rh) { return (float)lh == (float)rh; }
+__BF16_DECL__ bool operator!=(const long int &lh, const bfloat16 &rh) { return (float)lh != (float)rh; }
+__BF16_DECL__ bool operator> (const long int &lh, const bfloat16 &rh) { return (float)lh > (float)rh; }
+__BF16_DECL__ bool operator< (const long int &lh, const bfloat16 &rh) { return (float)lh < (float)rh; }
+__BF16_DECL__ bool operator>=(const long int &lh, const bfloat16 &rh) { return (float)lh >= (float)rh; }
+__BF16_DECL__ bool operator<=(const long int &lh, const bfloat16 &rh) { return (float)lh <= (float)rh; }
+
+__BF16_DECL__ float operator+(const bfloat16 &lh, const long int &rh) { return (float)lh + (float)rh; }
+__BF16_DECL__ float operator-(const bfloat16 &lh, const long int &rh) { return (float)lh - (float)rh; }
+__BF16_DECL__ float operator*(const bfloat16 &lh, const long int &rh) { return (float)lh * (float)rh; }
+__BF16_DECL__ float operator/(const bfloat16 &lh, const long int &rh) { return (float)lh / (float)rh; }
+__BF16_DECL__ bool operator==(const bfloat16 &lh, const long int &rh) { return (float)lh == (float)rh; }
+__BF16_DECL__ bool operator!=(const bfloat16 &lh, const long int &rh) { return (float)lh != (float)rh; }
+__BF16_DECL__ bool operator> (const bfloat16 &lh, const long int &rh) { return (float)lh > (float)rh; }
+__BF16_DECL__ bool operator< (const bfloat16 &lh, const long int &rh) { return (float)lh < (float)rh; }
+__BF16_DECL__ bool operator>=(const bfloat16 &lh, const long int &rh) { return (float)lh >= (float)rh; }
+__BF16_DECL__ bool operator<=(const bfloat16 &lh, const long int &rh) { return (float)lh <= (float)rh; }
+
+// bfloat16 overload of some std function
+namespace std
+{
+#define STD_BFLOAT16_RETBOOL(x) inline bool x(bfloat16 arg) { return x((float)arg); }
+STD_BFLOAT16_RETBOOL(isfinite)
+STD_BFLOAT16_RETBOOL(isinf)
+STD_BFLOAT16_RETBOOL(isnan)
+STD_BFLOAT16_RETBOOL(signbit)
+#undef STD_BFLOAT16_RETBOOL
+
+#define STD_BFLOAT16_UNIOP(x) inline bfloat16 x(bfloat16 arg) { return x((float)arg); }
+STD_BFLOAT16_UNIOP(floor)
+STD_BFLOAT16_UNIOP(round)
+STD_BFLOAT16_UNIOP(exp)
+STD_BFLOAT16_UNIOP(sqrt)
+STD_BFLOAT16_UNIOP(abs)
+STD_BFLOAT16_UNIOP(tanh)
+STD_BFLOAT16_UNIOP(atanh)
+STD_BFLOAT16_UNIOP(log)
+STD_BFLOAT16_UNIOP(log10)
+STD_BFLOAT16_UNIOP(cos)
+STD_BFLOAT16_UNIOP(sin)
+STD_BFLOAT16_UNIOP(tan)
+STD_BFLOAT16_UNIOP(acos)
+STD_BFLOAT16_UNIOP(asin)
+STD_BFLOAT16_UNIOP(atan)
+STD_BFLOAT16_UNIOP(cosh)
+STD_BFLOAT16_UNIOP(sinh)
+STD_BFLOAT16_UNIOP(acosh)
+STD_BFLOAT16_UNIOP(asinh)
+#undef STD_BFLOAT16_UNIOP
+
+#define STD_BFLOAT16_BINOP(x) inline bfloat16 x(const bfloat16& lhs, const bfloat16& rhs) { return x((float)lhs, (float)rhs); }
+STD_BFLOAT16_BINOP(max)
+STD_BFLOAT16_BINOP(pow)
+#undef STD_BFLOAT16_BINOP
+}
+
+#undef __CUDA_HOSTDEVICE__
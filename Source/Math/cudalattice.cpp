@@ -138,7 +138,8 @@ private:
                                 const float lmf, const float wp, const float amf, const float boostingfactor, const bool returnEframescorrect,
                                 const ushortvector &uids, const ushortvector &senone2classmap, doublevector &logaccalphas,
                                 doublevector &logaccbetas, doublevector &logframescorrectedge,
-                                doublevector &logEframescorrect, doublevector &Eframescorrectbuf, double &logEframescorrecttotal, double &totalfwscore)
+                                doublevector &logEframescorrect, doublevector &Eframescorrectbuf, doublevector &fwbwscores,
+                                double &logEframescorrecttotal, double &totalfwscore)
     {
         ondevice no(deviceid);
         latticefunctionsops::forwardbackwardlattice(batchsizeforward, batchsizebackward, numlaunchforward, numlaunchbackward,
@@ -160,6 +161,7 @@ private:
                                                     dynamic_cast<vectorbaseimpl<doublevector, vectorref<double>> &>(logframescorrectedge),
                                                     dynamic_cast<vectorbaseimpl<doublevector, vectorref<double>> &>(logEframescorrect),
                                                     dynamic_cast<vectorbaseimpl<doublevector, vectorref<double>> &>(Eframescorrectbuf),
+                                                    dynamic_cast<vectorbaseimpl<doublevector, vectorref<double>> &>(fwbwscores),
                                                     logEframescorrecttotal, totalfwscore);
     }
 
@@ -98,7 +98,8 @@ struct latticefunctions : public vectorbase<msra::lattices::empty>
                                         const ushortvector& uids, const ushortvector& senone2classmap,
                                         doublevector& logaccalphas, doublevector& logaccbetas,
                                         doublevector& logframescorrectedge, doublevector& logEframescorrect,
-                                        doublevector& Eframescorrectbuf, double& logEframescorrecttotal, double& totalfwscore) = 0;
+                                        doublevector& Eframescorrectbuf, doublevector& fwbwscores,
+                                        double& logEframescorrecttotal, double& totalfwscore) = 0;
     virtual void sMBRerrorsignal(const ushortvector& alignstateids, const uintvector& alignoffsets,
                                  const edgeinfowithscoresvector& edges, const nodeinfovector& nodes,
                                  const doublevector& logpps, const float amf, const doublevector& logEframescorrect,
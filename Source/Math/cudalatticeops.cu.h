@@ -120,6 +120,30 @@ __global__ void setvaluej(vectorref<double> arraytoset, double value, size_t nel
     }
 }
 
+// setinitialtokensj --set the initial tokens of the forward and backward passes to probability 1 (0 in log)
+__global__ void setinitialtokensj(vectorref<double> logalphas, vectorref<double> logbetas, size_t finalnode)
+{
+    if (threadIdx.x == 0 && blockIdx.x == 0)
+    {
+        logalphas[0] = 0.0;
+        logbetas[finalnode] = 0.0;
+    }
+}
+
+// collectfwbwscoresj --gather the total scores (and accuracies) of both passes, so that they are fetched in a single copy
+__global__ void collectfwbwscoresj(const vectorref<double> logalphas, const vectorref<double> logbetas,
+                                   const vectorref<double> logaccalphas, const vectorref<double> logaccbetas,
+                                   size_t finalnode, bool returnEframescorrect, vectorref<double> fwbwscores)
+{
+    if (threadIdx.x == 0 && blockIdx.x == 0)
+    {
+        fwbwscores[0] = logalphas[finalnode];
+        fwbwscores[1] = logbetas[0];
+        fwbwscores[2] = returnEframescorrect ? logaccalphas[finalnode] : 0.0;
+        fwbwscores[3] = returnEframescorrect ? logaccbetas[0] : 0.0;
+    }
+}
+
 __global__ void expfi(matrixref<float> mata)
 {
     const size_t i = threadIdx.x + (blockIdx.x * blockDim.x);
@@ -208,7 +232,7 @@ __global__ void forwardlatticej(const size_t batchsize, const size_t startindex,
 __global__ void backwardlatticej(const size_t batchsize, const size_t startindex, const vectorref<float> edgeacscores,
                                  const size_t spalignunitid, const size_t silalignunitid,
                                  vectorref<msra::lattices::edgeinfowithscores> edges, vectorref<msra::lattices::nodeinfo> nodes,
-                                 vectorref<msra::lattices::aligninfo> aligns, const double totalfwscore,
+                                 vectorref<msra::lattices::aligninfo> aligns,
                                  vectorref<double> logpps, vectorref<double> logalphas, vectorref<double> logbetas,
                                  float lmf, float wp, float amf, const float boostingfactor, const bool returnEframescorrect,
                                  vectorref<double> logframescorrectedge, vectorref<double> logaccalphas,
@@ -219,6 +243,8 @@ __global__ void backwardlatticej(const size_t batchsize, const size_t startindex
     size_t j = jinblock + blockIdx.x * tpb;
     if (j < batchsize) // note: will cause issues if we ever use __synctreads()
     {
+        // read on the device, so that the backward pass can be launched without waiting for the forward pass
+        const double totalfwscore = logalphas[nodes.size() - 1];
         msra::lattices::latticefunctionskernels::backwardlatticej(j + startindex, edgeacscores, spalignunitid, silalignunitid,
                                                                   edges, nodes, aligns, totalfwscore, logpps, logalphas, logbetas,
                                                                   lmf, wp, amf, boostingfactor, returnEframescorrect,
@@ -242,7 +268,7 @@ void latticefunctionsops::forwardbackwardlattice(const size_t *batchsizeforward,
                                                  const vectorref<unsigned short> &senone2classmap, vectorref<double> &logaccalphas,
                                                  vectorref<double> &logaccbetas, vectorref<double> &logframescorrectedge,
                                                  vectorref<double> &logEframescorrect, vectorref<double> & /*Eframescorrectbuf*/,
-                                                 double &logEframescorrecttotal, double &totalfwscore) const
+                                                 vectorref<double> &fwbwscores, double &logEframescorrecttotal, double &totalfwscore) const
 {
     // initialize log{,acc}(alhas/betas)
     dim3 t(32, 8);
@@ -262,9 +288,9 @@ void latticefunctionsops::forwardbackwardlattice(const size_t *batchsizeforward,
         checklaunch("setvaluej");
     }
     // set initial tokens to probability 1 (0 in log)
-    double log1 = 0.0;
-    memcpy(logalphas.get(), 0, &log1, 1);
-    memcpy(logbetas.get(), nodes.size() - 1, &log1, 1);
+    // All of the passes are queued without a round trip to the host; the scores are fetched once at the end.
+    setinitialtokensj<<<1, 1, 0, GetCurrentStream()>>>(logalphas, logbetas, nodes.size() - 1);
+    checklaunch("setinitialtokensj");
 
     // forward pass
     size_t startindex = 0;
@@ -279,14 +305,6 @@ void latticefunctionsops::forwardbackwardlattice(const size_t *batchsizeforward,
         checklaunch("edgealignment");
         startindex += batchsizeforward[i];
     }
-    memcpy<double>(&totalfwscore, logalphas.get(), nodes.size() - 1, 1);
-    double totalfwacc = 0;
-    if (returnEframescorrect)
-    {
-        memcpy<double>(&totalfwacc, logaccalphas.get(), nodes.size() - 1, 1);
-        totalfwacc -= totalfwscore;
-    }
-
     // backward pass
     startindex = edges.size();
     for (size_t i = 0; i < numlaunchbackward; i++)
@@ -294,19 +312,24 @@ void latticefunctionsops::forwardbackwardlattice(const size_t *batchsizeforward,
         dim3 b2((unsigned int) ((batchsizebackward[i] + tpb - 1) / tpb));
         backwardlatticej<<<b2, t, 0, GetCurrentStream()>>>(batchsizebackward[i], startindex - batchsizebackward[i],
                                                           edgeacscores, spalignunitid, silalignunitid, edges, nodes, aligns,
-                                                          totalfwscore, logpps, logalphas, logbetas,
+                                                          logpps, logalphas, logbetas,
                                                           lmf, wp, amf, boostingfactor, returnEframescorrect, logframescorrectedge,
                                                           logaccalphas, logEframescorrect, logaccbetas);
         checklaunch("edgealignment");
         startindex -= batchsizebackward[i];
     }
-    double totalbwscore = 0;
-    memcpy<double>(&totalbwscore, logbetas.get(), 0, 1);
+    collectfwbwscoresj<<<1, 1, 0, GetCurrentStream()>>>(logalphas, logbetas, logaccalphas, logaccbetas, nodes.size() - 1, returnEframescorrect, fwbwscores);
+    checklaunch("collectfwbwscoresj");
+    double scores[4];
+    memcpy<double>(scores, fwbwscores.get(), 0, 4);
+    totalfwscore = scores[0];
+    const double totalbwscore = scores[1];
+    double totalfwacc = 0;
     double totalbwacc = 0;
     if (returnEframescorrect)
     {
-        memcpy<double>(&totalbwacc, logaccbetas.get(), 0, 1);
-        totalbwacc -= totalbwscore;
+        totalfwacc = scores[2] - totalfwscore;
+        totalbwacc = scores[3] - totalbwscore;
         logEframescorrecttotal = totalbwacc;
     }
 
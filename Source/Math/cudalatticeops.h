@@ -51,7 +51,7 @@ protected:
                                 const vectorref<unsigned short>& uids, const vectorref<unsigned short>& senone2classmap,
                                 vectorref<double>& logaccalphas, vectorref<double>& logaccbetas,
                                 vectorref<double>& logframescorrectedge, vectorref<double>& logEframescorrect, vectorref<double>& Eframescorrectbuf,
-                                double& logEframescorrecttotal, double& totalfwscore) const;
+                                vectorref<double>& fwbwscores, double& logEframescorrecttotal, double& totalfwscore) const;
 
     void sMBRerrorsignal(const vectorref<unsigned short>& alignstateids, const vectorref<unsigned int>& alignoffsets,
                          const vectorref<msra::lattices::edgeinfowithscores>& edges, const vectorref<msra::lattices::nodeinfo>& nodes,
@@ -42,11 +42,12 @@
 #define COPY_TILE_DIM 1024
 #define COPY_BLOCK_DIM 256
 
-// kernel(s) for half functions with no library support
+// kernel(s) for half and bfloat16 functions with no library support
 namespace {
-__global__ void transposeNoOverlap(half *odata, const half *idata, const int m, const int n)
+template <class ElemType>
+__global__ void transposeNoOverlap(ElemType *odata, const ElemType *idata, const int m, const int n)
 {
-    __shared__ half tile[TRANS_TILE_DIM][TRANS_TILE_DIM+1];
+    __shared__ ElemType tile[TRANS_TILE_DIM][TRANS_TILE_DIM+1];
 
     int x = blockIdx.x * TRANS_TILE_DIM + threadIdx.x;
     int y = blockIdx.y * TRANS_TILE_DIM + threadIdx.y;
@@ -72,7 +73,8 @@ __global__ void setup_state(curandState *state, unsigned long long seed)
     curand_init(seed, 0, 0, state);
 }
 
-__global__ void GenerateUniformHalf(curandState *state, half *result, int n)
+template <class ElemType>
+__global__ void GenerateUniformHalf(curandState *state, ElemType *result, int n)
 {
     int id = blockIdx.x * blockDim.x + threadIdx.x;
     if(id >= n) return;
@@ -87,7 +89,8 @@ __global__ void GenerateUniformHalf(curandState *state, half *result, int n)
     if(id == n-1) *state = localState;
 }
 
-__global__ void GenerateNormalHalf(curandState *state, half *result, int n, half mean, half stddev)
+template <class ElemType>
+__global__ void GenerateNormalHalf(curandState *state, ElemType *result, int n, ElemType mean, ElemType stddev)
 {
     int id = blockIdx.x * blockDim.x + threadIdx.x;
     if(id >= n) return;
@@ -154,19 +157,39 @@ inline cublasStatus_t cublasgemmHelper(cublasHandle_t handle, cublasOperation_t
     cublasSetMathMode(handle, CUBLAS_TENSOR_OP_MATH);
     return cublasGemmEx(handle, transa, transb, m, n, k, &h_a, A, CUDA_R_16F, lda, B, CUDA_R_16F, ldb, &h_b, C, CUDA_R_16F, ldc, CUDA_R_32F, CUBLAS_GEMM_DFALT);
 }
+inline cublasStatus_t cublasgemmHelper(cublasHandle_t handle, cublasOperation_t transa, cublasOperation_t transb, int m, int n, int k, const bfloat16* alpha, const bfloat16* A, int lda, const bfloat16* B, int ldb, const bfloat16* beta, bfloat16* C, int ldc)
+{
+    // input/output in bf16, computation in fp32, on the tensor cores of the GPUs that have bf16 ones (Ampere and later)
+    float h_a = *alpha;
+    float h_b = *beta;
+    cublasSetMathMode(handle, CUBLAS_TENSOR_OP_MATH);
+    return cublasGemmEx(handle, transa, transb, m, n, k, &h_a, A, CUDA_R_16BF, lda, B, CUDA_R_16BF, ldb, &h_b, C, CUDA_R_16BF, ldc, CUDA_R_32F, CUBLAS_GEMM_DFALT);
+}
 
-// batched gemm
-inline cublasStatus_t cublasGemmBatchedHelper(cublasHandle_t handle, cublasOperation_t transa, cublasOperation_t transb, int m, int n, int k, const float* alpha, const float *Aarray[], int lda, const float *Barray[], int ldb, const float *beta, float *Carray[], int ldc, int batchCount)
+// strided batched gemm, for batches of matrices that are equally spaced in memory
+inline cublasStatus_t cublasGemmStridedBatchedHelper(cublasHandle_t handle, cublasOperation_t transa, cublasOperation_t transb, int m, int n, int k, const float* alpha, const float* A, int lda, long long strideA, const float* B, int ldb, long long strideB, const float* beta, float* C, int ldc, long long strideC, int batchCount)
 {
-    return cublasSgemmBatched(handle, transa, transb, m, n, k, alpha, Aarray, lda, Barray, ldb, beta, Carray, ldc, batchCount);
+    return cublasSgemmStridedBatched(handle, transa, transb, m, n, k, alpha, A, lda, strideA, B, ldb, strideB, beta, C, ldc, strideC, batchCount);
 }
-inline cublasStatus_t cublasGemmBatchedHelper(cublasHandle_t handle, cublasOperation_t transa, cublasOperation_t transb, int m, int n, int k, const double* alpha, const double *Aarray[], int lda, const double *Barray[], int ldb, const double *beta, double *Carray[], int ldc, int batchCount)
+inline cublasStatus_t cublasGemmStridedBatchedHelper(cublasHandle_t handle, cublasOperation_t transa, cublasOperation_t transb, int m, int n, int k, const double* alpha, const double* A, int lda, long long strideA, const double* B, int ldb, long long strideB, const double* beta, double* C, int ldc, long long strideC, int batchCount)
 {
-    return cublasDgemmBatched(handle, transa, transb, m, n, k, alpha, Aarray, lda, Barray, ldb, beta, Carray, ldc, batchCount);
+    return cublasDgemmStridedBatched(handle, transa, transb, m, n, k, alpha, A, lda, strideA, B, ldb, strideB, beta, C, ldc, strideC, batchCount);
 }
-inline cublasStatus_t cublasGemmBatchedHelper(cublasHandle_t handle, cublasOperation_t transa, cublasOperation_t transb, int m, int n, int k, const half* alpha, const half *Aarray[], int lda, const half *Barray[], int ldb, const half *beta, half *Carray[], int ldc, int batchCount)
+inline cublasStatus_t cublasGemmStridedBatchedHelper(cublasHandle_t handle, cublasOperation_t transa, cublasOperation_t transb, int m, int n, int k, const half* alpha, const half* A, int lda, long long strideA, const half* B, int ldb, long long strideB, const half* beta, half* C, int ldc, long long strideC, int batchCount)
 {
-    return cublasHgemmBatched(handle, transa, transb, m, n, k, alpha, (const __half**)Aarray, lda, (const __half**)Barray, ldb, beta, (__half**)Carray, ldc, batchCount);
+    // pseudo FP16 computation as in cublasgemmHelper() (input/output in fp16, computation in fp32)
+    float h_a = *alpha;
+    float h_b = *beta;
+    cublasSetMathMode(handle, CUBLAS_TENSOR_OP_MATH);
+    return cublasGemmStridedBatchedEx(handle, transa, transb, m, n, k, &h_a, A, CUDA_R_16F, lda, strideA, B, CUDA_R_16F, ldb, strideB, &h_b, C, CUDA_R_16F, ldc, strideC, batchCount, CUDA_R_32F, CUBLAS_GEMM_DFALT);
+}
+inline cublasStatus_t cublasGemmStridedBatchedHelper(cublasHandle_t handle, cublasOperation_t transa, cublasOperation_t transb, int m, int n, int k, const bfloat16* alpha, const bfloat16* A, int lda, long long strideA, const bfloat16* B, int ldb, long long strideB, const bfloat16* beta, bfloat16* C, int ldc, long long strideC, int batchCount)
+{
+    // input/output in bf16, computation in fp32 as in cublasgemmHelper()
+    float h_a = *alpha;
+    float h_b = *beta;
+    cublasSetMathMode(handle, CUBLAS_TENSOR_OP_MATH);
+    return cublasGemmStridedBatchedEx(handle, transa, transb, m, n, k, &h_a, A, CUDA_R_16BF, lda, strideA, B, CUDA_R_16BF, ldb, strideB, &h_b, C, CUDA_R_16BF, ldc, strideC, batchCount, CUDA_R_32F, CUBLAS_GEMM_DFALT);
 }
 
 // axpy
@@ -183,6 +206,11 @@ inline cublasStatus_t cublasaxpyHelper(cublasHandle_t handle, int n, const half*
     float tmp_alpha = *alpha;
     return cublasAxpyEx(handle, n, (void*)&tmp_alpha, CUDA_R_32F, (void*)x, CUDA_R_16F, incx, (void*)y, CUDA_R_16F, incy, CUDA_R_32F);
 }
+inline cublasStatus_t cublasaxpyHelper(cublasHandle_t handle, int n, const bfloat16* alpha, const bfloat16* x, int incx, bfloat16* y, int incy)
+{
+    float tmp_alpha = *alpha;
+    return cublasAxpyEx(handle, n, (void*)&tmp_alpha, CUDA_R_32F, (void*)x, CUDA_R_16BF, incx, (void*)y, CUDA_R_16BF, incy, CUDA_R_32F);
+}
 
 // transpose using geam
 inline cublasStatus_t cublasTransposeHelper(cublasHandle_t handle, cublasOperation_t transa, cublasOperation_t transb, int m, int n, float *alpha, float *A, int lda, float *beta, float *B, int ldb, float *C, int ldc)
@@ -206,6 +234,19 @@ inline cublasStatus_t cublasTransposeHelper(cublasHandle_t, cublasOperation_t, c
         RuntimeError("In place transpose(half) not supported."); // cublas do not support this either. There might be bug if this actually get called.
     return (cublasStatus_t) 0;
 }
+inline cublasStatus_t cublasTransposeHelper(cublasHandle_t, cublasOperation_t, cublasOperation_t, int m, int n, bfloat16 *, bfloat16 *A, int, bfloat16 *, bfloat16 *, int, bfloat16 *C, int)
+{
+    if(C != A)
+    {
+        dim3 dimGrid((n+TRANS_TILE_DIM-1)/TRANS_TILE_DIM, (m+TRANS_TILE_DIM-1)/TRANS_TILE_DIM, 1);
+        dim3 dimBlock(TRANS_TILE_DIM, BLOCK_ROWS, 1);
+
+        transposeNoOverlap<<<dimGrid, dimBlock>>>(C, A, n, m);
+    }
+    else
+        RuntimeError("In place transpose(bfloat16) not supported."); // cublas do not support this either. There might be bug if this actually get called.
+    return (cublasStatus_t) 0;
+}
 
 // asum
 inline cublasStatus_t cublasasumHelper(cublasHandle_t handle, int n, const float *x, int incx, float *result)
@@ -216,7 +257,9 @@ inline cublasStatus_t cublasasumHelper(cublasHandle_t handle, int n, const doubl
 {
     return cublasDasum(handle, n, x, incx, result);
 }
-inline cublasStatus_t cublasasumHelper(cublasHandle_t, int n, const half *x, int incx, half *result)
+// reduction of a 16-bit type with cuDNN, which cuBLAS does not have
+template <class ElemType>
+inline cublasStatus_t cudnnasumHelper(cudnnDataType_t dataType, int n, const ElemType *x, int incx, ElemType *result)
 {
     // pass in cudnn handle/descriptor to remove overhead?
     cudnnHandle_t cudnnHandle;
@@ -228,8 +271,8 @@ inline cublasStatus_t cublasasumHelper(cublasHandle_t, int n, const half *x, int
     cudnnCreateTensorDescriptor(&dstTensorDesc);
     cudnnCreateReduceTensorDescriptor(&reduceTensorDesc);
 
-    cudnnSetTensor4dDescriptorEx(srcTensorDesc, CUDNN_DATA_HALF, 1, 1, 1, n, 1, 1, 1, incx);
-    cudnnSetTensor4dDescriptorEx(dstTensorDesc, CUDNN_DATA_HALF, 1, 1, 1, 1, 1, 1, 1, 1);
+    cudnnSetTensor4dDescriptorEx(srcTensorDesc, dataType, 1, 1, 1, n, 1, 1, 1, incx);
+    cudnnSetTensor4dDescriptorEx(dstTensorDesc, dataType, 1, 1, 1, 1, 1, 1, 1, 1);
     cudnnSetReduceTensorDescriptor(reduceTensorDesc,
                                    CUDNN_REDUCE_TENSOR_NORM1,
                                    CUDNN_DATA_FLOAT,
@@ -246,7 +289,7 @@ inline cublasStatus_t cublasasumHelper(cublasHandle_t, int n, const half *x, int
     float beta = 0.0f;
 
     void *d_res;
-    cudaMalloc(&d_res, sizeof(half));
+    cudaMalloc(&d_res, sizeof(ElemType));
 
     cudnnReduceTensor(cudnnHandle,
                       reduceTensorDesc,
@@ -261,7 +304,7 @@ inline cublasStatus_t cublasasumHelper(cublasHandle_t, int n, const half *x, int
                       dstTensorDesc,
                       d_res);
 
-    cudaMemcpy((void *)result, d_res, sizeof(half), cudaMemcpyDeviceToHost);
+    cudaMemcpy((void *)result, d_res, sizeof(ElemType), cudaMemcpyDeviceToHost);
 
     cudnnDestroyReduceTensorDescriptor(reduceTensorDesc);
     cudnnDestroyTensorDescriptor(srcTensorDesc);
@@ -272,6 +315,14 @@ inline cublasStatus_t cublasasumHelper(cublasHandle_t, int n, const half *x, int
 
     return (cublasStatus_t) 0;
 }
+inline cublasStatus_t cublasasumHelper(cublasHandle_t, int n, const half *x, int incx, half *result)
+{
+    return cudnnasumHelper(CUDNN_DATA_HALF, n, x, incx, result);
+}
+inline cublasStatus_t cublasasumHelper(cublasHandle_t, int n, const bfloat16 *x, int incx, bfloat16 *result)
+{
+    return cudnnasumHelper(CUDNN_DATA_BFLOAT16, n, x, incx, result);
+}
 
 // amax
 inline cublasStatus_t cublasamaxHelper(cublasHandle_t handle, int n, const float *x, int incx, int *result)
@@ -282,7 +333,9 @@ inline cublasStatus_t cublasamaxHelper(cublasHandle_t handle, int n, const doubl
 {
     return cublasIdamax(handle, n, x, incx, result);
 }
-inline cublasStatus_t cublasamaxHelper(cublasHandle_t, int n, const half *x, int incx, int *result)
+// like cudnnasumHelper()
+template <class ElemType>
+inline cublasStatus_t cudnnamaxHelper(cudnnDataType_t dataType, int n, const ElemType *x, int incx, int *result)
 {
     unsigned int h_result_uint = 0;
     // pass in cudnn handle/descriptor to remove overhead?
@@ -295,8 +348,8 @@ inline cublasStatus_t cublasamaxHelper(cublasHandle_t, int n, const half *x, int
     cudnnCreateTensorDescriptor(&dstTensorDesc);
     cudnnCreateReduceTensorDescriptor(&reduceTensorDesc);
 
-    cudnnSetTensor4dDescriptorEx(srcTensorDesc, CUDNN_DATA_HALF, 1, 1, 1, n, 1, 1, 1, incx);
-    cudnnSetTensor4dDescriptorEx(dstTensorDesc, CUDNN_DATA_HALF, 1, 1, 1, 1, 1, 1, 1, 1);
+    cudnnSetTensor4dDescriptorEx(srcTensorDesc, dataType, 1, 1, 1, n, 1, 1, 1, incx);
+    cudnnSetTensor4dDescriptorEx(dstTensorDesc, dataType, 1, 1, 1, 1, 1, 1, 1, 1);
     cudnnSetReduceTensorDescriptor(reduceTensorDesc,
                                    CUDNN_REDUCE_TENSOR_AMAX,
                                    CUDNN_DATA_FLOAT,
@@ -312,7 +365,7 @@ inline cublasStatus_t cublasamaxHelper(cublasHandle_t, int n, const half *x, int
     float alpha = 1.0f;
     float beta = 0.0f;
     void *d_max;
-    cudaMalloc(&d_max, sizeof(half));
+    cudaMalloc(&d_max, sizeof(ElemType));
     void *d_result_uint;
     cudaMalloc(&d_result_uint, sizeof(unsigned int));
 
@@ -342,6 +395,14 @@ inline cublasStatus_t cublasamaxHelper(cublasHandle_t, int n, const half *x, int
     *result = (int) h_result_uint;
     return (cublasStatus_t) 0;
 }
+inline cublasStatus_t cublasamaxHelper(cublasHandle_t, int n, const half *x, int incx, int *result)
+{
+    return cudnnamaxHelper(CUDNN_DATA_HALF, n, x, incx, result);
+}
+inline cublasStatus_t cublasamaxHelper(cublasHandle_t, int n, const bfloat16 *x, int incx, int *result)
+{
+    return cudnnamaxHelper(CUDNN_DATA_BFLOAT16, n, x, incx, result);
+}
 
 // scal
 inline cublasStatus_t cublasscalHelper(cublasHandle_t handle, int n, const float *alpha, float *x, int incx)
@@ -357,6 +418,11 @@ inline cublasStatus_t cublasscalHelper(cublasHandle_t handle, int n, const half
     float tmp_alpha = *alpha;
     return cublasScalEx(handle, n, (void*)&tmp_alpha, CUDA_R_32F, (void*)x, CUDA_R_16F, incx, CUDA_R_32F);
 }
+inline cublasStatus_t cublasscalHelper(cublasHandle_t handle, int n, const bfloat16 *alpha, bfloat16 *x, int incx)
+{
+    float tmp_alpha = *alpha;
+    return cublasScalEx(handle, n, (void*)&tmp_alpha, CUDA_R_32F, (void*)x, CUDA_R_16BF, incx, CUDA_R_32F);
+}
 inline cublasStatus_t cublasscalHelper(cublasHandle_t,int,const char *,char *, int)
 {
     RuntimeError("Unsupported template argument(char) in cublas_scal");
@@ -379,6 +445,10 @@ inline cublasStatus_t cublasdotHelper(cublasHandle_t handle, int n, const half *
 {
     return cublasDotEx(handle, n, (void*)x, CUDA_R_16F, incx, (void*)y, CUDA_R_16F, incy, (void*)result, CUDA_R_16F, CUDA_R_32F);
 }
+inline cublasStatus_t cublasdotHelper(cublasHandle_t handle, int n, const bfloat16 *x, int incx, const bfloat16 *y, int incy, bfloat16 *result)
+{
+    return cublasDotEx(handle, n, (void*)x, CUDA_R_16BF, incx, (void*)y, CUDA_R_16BF, incy, (void*)result, CUDA_R_16BF, CUDA_R_32F);
+}
 
 // curand
 inline curandStatus_t curandGenerateUniformHelper(curandGenerator_t generator, float *outputPtr, size_t num)
@@ -401,6 +471,18 @@ inline curandStatus_t curandGenerateUniformHelper(curandGenerator_t, half *outpu
 
     return (curandStatus_t) 0;
 }
+inline curandStatus_t curandGenerateUniformHelper(curandGenerator_t, bfloat16 *outputPtr, size_t num)
+{
+    curandState *devStates;
+    cudaMalloc((void **)&devStates, sizeof(curandState));
+    setup_state<<<1,1>>>(devStates, time(NULL)); // What does curandGenerateUniform actually doing? should also pass in state here
+
+    dim3 dimGrid((unsigned int)(num+COPY_BLOCK_DIM-1)/COPY_BLOCK_DIM, 1, 1);
+    dim3 dimBlock(COPY_BLOCK_DIM, 1, 1);
+    GenerateUniformHalf<<<dimGrid, dimBlock>>>(devStates, outputPtr, (int)num);
+
+    return (curandStatus_t) 0;
+}
 
 inline curandStatus_t curandGenerateUniformHelper(curandGenerator_t, char *, size_t)
 {
@@ -432,6 +514,18 @@ inline curandStatus_t curandGenerateNormalHelper(curandGenerator_t, half *output
 
     return (curandStatus_t) 0;
 }
+inline curandStatus_t curandGenerateNormalHelper(curandGenerator_t, bfloat16 *outputPtr, size_t n, bfloat16 mean, bfloat16 stddev)
+{
+    curandState *devStates;
+    cudaMalloc((void **)&devStates, sizeof(curandState));
+    setup_state<<<1,1>>>(devStates, time(NULL)); // What does curandGenerateUniform actually doing? should also pass in state here
+
+    dim3 dimGrid((unsigned int)(n+COPY_BLOCK_DIM-1)/COPY_BLOCK_DIM, 1, 1);
+    dim3 dimBlock(COPY_BLOCK_DIM, 1, 1);
+    GenerateNormalHalf<<<dimGrid, dimBlock>>>(devStates, outputPtr, (int)n, mean, stddev);
+
+    return (curandStatus_t) 0;
+}
 
 inline curandStatus_t curandGenerateNormalHelper(curandGenerator_t, char*, size_t, char, char)
 {
@@ -456,6 +550,10 @@ inline cusparseStatus_t cusparsecsr2denseHelper(cusparseHandle_t,int,int,const c
 {
     RuntimeError("Unsupported template argument(half) in GPUSparseMatrix");
 }
+inline cusparseStatus_t cusparsecsr2denseHelper(cusparseHandle_t,int,int,const cusparseMatDescr_t, const bfloat16 *, const int *, const int *, bfloat16 *, int)
+{
+    RuntimeError("Unsupported template argument(bfloat16) in GPUSparseMatrix");
+}
 inline cusparseStatus_t cusparsecsr2denseHelper(cusparseHandle_t,int,int,const cusparseMatDescr_t, const short *, const int *, const int *, short *, int)
 {
     RuntimeError("Unsupported template argument(short) in GPUSparseMatrix");
@@ -477,6 +575,10 @@ inline cusparseStatus_t cusparsecsc2denseHelper(cusparseHandle_t,int,int,const c
 {
     RuntimeError("Unsupported template argument(half) in GPUSparseMatrix");
 }
+inline cusparseStatus_t cusparsecsc2denseHelper(cusparseHandle_t,int,int,const cusparseMatDescr_t, const bfloat16 *, const int *, const int *, bfloat16 *, int)
+{
+    RuntimeError("Unsupported template argument(bfloat16) in GPUSparseMatrix");
+}
 inline cusparseStatus_t cusparsecsc2denseHelper(cusparseHandle_t,int,int,const cusparseMatDescr_t, const short *, const int *, const int *, short *, int)
 {
     RuntimeError("Unsupported template argument(short) in GPUSparseMatrix");
@@ -498,6 +600,10 @@ inline cusparseStatus_t cusparsecsr2cscHelper(cusparseHandle_t, int, int, int, c
 {
     RuntimeError("Unsupported template argument(half) in cusparsecsr2cscHelper");
 }
+inline cusparseStatus_t cusparsecsr2cscHelper(cusparseHandle_t, int, int, int, const bfloat16 *, const int *, const int *, bfloat16 *, int *, int *, cusparseAction_t, cusparseIndexBase_t)
+{
+    RuntimeError("Unsupported template argument(bfloat16) in cusparsecsr2cscHelper");
+}
 
 inline cusparseStatus_t cusparsennzHelper(cusparseHandle_t handle, cusparseDirection_t dirA, int m, int n, const cusparseMatDescr_t descrA, const float *A, int lda, int *nnzPerRowColumn, int *nnzTotalDevHostPtr)
 {
@@ -511,6 +617,10 @@ inline cusparseStatus_t cusparsennzHelper(cusparseHandle_t,cusparseDirection_t,i
 {
     RuntimeError("Unsupported template argument(half) in GPUSparseMatrix");
 }
+inline cusparseStatus_t cusparsennzHelper(cusparseHandle_t,cusparseDirection_t,int,int , const cusparseMatDescr_t, const bfloat16 *, int, int *, int *)
+{
+    RuntimeError("Unsupported template argument(bfloat16) in GPUSparseMatrix");
+}
 inline cusparseStatus_t cusparsennzHelper(cusparseHandle_t,cusparseDirection_t,int,int , const cusparseMatDescr_t, const short *, int, int *, int *)
 {
     RuntimeError("Unsupported template argument(short) in GPUSparseMatrix");
@@ -532,6 +642,10 @@ inline cusparseStatus_t cusparsedense2csrHelper(cusparseHandle_t,int,int,const c
 {
     RuntimeError("Unsupported template argument(half) in GPUSparseMatrix");
 }
+inline cusparseStatus_t cusparsedense2csrHelper(cusparseHandle_t,int,int,const cusparseMatDescr_t, const bfloat16 *, int, const int *, bfloat16 *, int *, int *)
+{
+    RuntimeError("Unsupported template argument(bfloat16) in GPUSparseMatrix");
+}
 inline cusparseStatus_t cusparsedense2csrHelper(cusparseHandle_t,int,int,const cusparseMatDescr_t, const short *, int, const int *, short *, int *, int *)
 {
     RuntimeError("Unsupported template argument(short) in GPUSparseMatrix");
@@ -553,6 +667,10 @@ inline cusparseStatus_t cusparsedense2cscHelper(cusparseHandle_t,int,int,const c
 {
     RuntimeError("Unsupported template argument(half) in GPUSparseMatrix");
 }
+inline cusparseStatus_t cusparsedense2cscHelper(cusparseHandle_t,int,int,const cusparseMatDescr_t, const bfloat16 *, int, const int *, bfloat16 *, int *, int *)
+{
+    RuntimeError("Unsupported template argument(bfloat16) in GPUSparseMatrix");
+}
 inline cusparseStatus_t cusparsedense2cscHelper(cusparseHandle_t,int,int,const cusparseMatDescr_t, const short *, int, const int *, short *, int *, int *)
 {
     RuntimeError("Unsupported template argument(short) in GPUSparseMatrix");
@@ -574,6 +692,10 @@ inline cusparseStatus_t cusparsecsrmmHelper(cusparseHandle_t, cusparseOperation_
 {
     RuntimeError("Unsupported template argument(half) in cusparsecsrmmHelper");
 }
+inline cusparseStatus_t cusparsecsrmmHelper(cusparseHandle_t, cusparseOperation_t, int, int, int, int, const bfloat16 *, const cusparseMatDescr_t, const bfloat16 *, const int *, const int *, const bfloat16 *, int, const bfloat16 *, bfloat16 *, int)
+{
+    RuntimeError("Unsupported template argument(bfloat16) in cusparsecsrmmHelper");
+}
 
 inline cusparseStatus_t cusparsecsrgemmHelper(cusparseHandle_t handle, cusparseOperation_t transA, cusparseOperation_t transB, int m, int n, int k, const cusparseMatDescr_t descrA, const int nnzA, const float *csrValA, const int *csrRowPtrA, const int *csrColIndA, const cusparseMatDescr_t descrB, const int nnzB, const float *csrValB, const int *csrRowPtrB, const int *csrColIndB, const cusparseMatDescr_t descrC, float *csrValC, const int *csrRowPtrC, int *csrColIndC)
 {
@@ -587,6 +709,10 @@ inline cusparseStatus_t cusparsecsrgemmHelper(cusparseHandle_t, cusparseOperatio
 {
     RuntimeError("Unsupported template argument(half) in cusparsecsrgemmHelper");
 }
+inline cusparseStatus_t cusparsecsrgemmHelper(cusparseHandle_t, cusparseOperation_t, cusparseOperation_t, int, int, int, const cusparseMatDescr_t, const int, const bfloat16 *, const int *, const int *, const cusparseMatDescr_t, const int, const bfloat16 *, const int *, const int *, const cusparseMatDescr_t, bfloat16 *, const int *, int *)
+{
+    RuntimeError("Unsupported template argument(bfloat16) in cusparsecsrgemmHelper");
+}
 
 inline cusparseStatus_t cusparsecsrgeamHelper(cusparseHandle_t handle, int m, int n, const float *alpha, const cusparseMatDescr_t descrA, int nnzA, const float *csrValA, const int *csrRowPtrA, const int *csrColIndA, const float *beta, const cusparseMatDescr_t descrB, int nnzB, const float *csrValB, const int *csrRowPtrB, const int *csrColIndB, const cusparseMatDescr_t descrC, float *csrValC, int *csrRowPtrC, int *csrColIndC)
 {
@@ -600,6 +726,10 @@ inline cusparseStatus_t cusparsecsrgeamHelper(cusparseHandle_t, int, int, const
 {
     RuntimeError("Unsupported template argument(half) in cusparsecsrgeamHelper");
 }
+inline cusparseStatus_t cusparsecsrgeamHelper(cusparseHandle_t, int, int, const bfloat16 *, const cusparseMatDescr_t, int, const bfloat16 *, const int *, const int *, const bfloat16 *, const cusparseMatDescr_t, int, const bfloat16 *, const int *, const int *, const cusparseMatDescr_t, bfloat16 *, int *, int *)
+{
+    RuntimeError("Unsupported template argument(bfloat16) in cusparsecsrgeamHelper");
+}
 
 inline cusparseStatus_t cusparsedotiHelper(cusparseHandle_t handle, int nnz, const float *xVal, const int *xInd, const float *y, float *resultDevHostPtr, cusparseIndexBase_t idxBase)
 {
@@ -613,6 +743,10 @@ inline cusparseStatus_t cusparsedotiHelper(cusparseHandle_t, int, const half *,
 {
     RuntimeError("Unsupported template argument(half) in cusparsedotiHelper");
 }
+inline cusparseStatus_t cusparsedotiHelper(cusparseHandle_t, int, const bfloat16 *, const int *, const bfloat16 *, bfloat16 *, cusparseIndexBase_t)
+{
+    RuntimeError("Unsupported template argument(bfloat16) in cusparsedotiHelper");
+}
 
 
 // Generalize cub calls
@@ -628,5 +762,9 @@ inline cudaError_t SortPairsDescending(void *, size_t, const half *, half *, con
 {
     RuntimeError("Unsupported template argument(half) in SortPairsDescending");
 }
+inline cudaError_t SortPairsDescending(void *, size_t, const bfloat16 *, bfloat16 *, const uint64_t *, uint64_t *, int, int, int, cudaStream_t)
+{
+    RuntimeError("Unsupported template argument(bfloat16) in SortPairsDescending");
+}
 
 #endif // CPUONLY
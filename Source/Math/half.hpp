@@ -324,4 +324,6 @@ STD_HALF_BINOP(pow)
 #undef STD_HALF_BINOP
 }
 
-#undef __CUDA_HOSTDEVICE__
\ No newline at end of file
+#undef __CUDA_HOSTDEVICE__
+
+#include "bfloat16.hpp"
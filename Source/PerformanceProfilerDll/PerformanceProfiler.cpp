@@ -17,8 +17,11 @@
 #include "fileutil.h"
 #include "TimerUtility.h"
 #include <algorithm>
+#include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <stdio.h>
 #ifndef CPUONLY
 #include <cuda_runtime_api.h>
@@ -67,6 +70,13 @@ static const FixedEventDesc c_fixedEvtDesc[profilerEvtMax] = {
     { "", profilerEvtSeparator, false },                            // profilerSepSpace2
 
     { "Prefetch Minibatch", profilerEvtTime, false },               // profilerEvtPrefetchMinibatch
+    { "_Pack Minibatch", profilerEvtTime, false },                  // profilerEvtReaderPack
+    { "__Get Chunk", profilerEvtTime, false },                      // profilerEvtReaderGetChunk
+    { "__Randomize", profilerEvtTime, false },                      // profilerEvtReaderRandomize
+    { "__Transform", profilerEvtTime, false },                      // profilerEvtReaderTransform
+    { "_Transfer Minibatch", profilerEvtTime, false },              // profilerEvtReaderTransfer
+    { "Wait for Minibatch", profilerEvtTime, false },               // profilerEvtReaderWait
+    { "File Read", profilerEvtThroughput, false },                  // profilerEvtReaderFileRead
 };
 
 
@@ -89,6 +99,8 @@ struct CustomEventRecord
     long long       beginClock;
     long long       endClock;
     unsigned int    threadId;
+    int             eventId;      // fixed event, or -1 for a custom event
+    long long       bytes;        // used only for throughput events
 };
 
 
@@ -107,7 +119,8 @@ struct ProfilerState
     unsigned long long      customEventBufferBytes;      // Number of bytes allocated for the custom event buffer
     unsigned long long      customEventOffset;           // Offset to current place in buffer
     unique_ptr<char[]>      customEventBuffer;           // Pointer to custom event buffer
-    long long               startClock;
+    long long               startClock;                  // Time of the first ProfilerEnable(true), the origin of the detail log
+    unsigned int            mainThreadId;                // Thread that called ProfilerInit()
 };
 
 
@@ -166,6 +179,7 @@ void PERF_PROFILER_API ProfilerInit(const std::wstring& profilerDir, const unsig
 
     g_profilerState->syncGpu = syncGpu;
     g_profilerState->enabled = false;
+    g_profilerState->mainThreadId = GetThreadId();
 
     if (_wmkdir(g_profilerState->profilerDir.c_str()) == -1 && errno != EEXIST)
     {
@@ -186,7 +200,8 @@ void PERF_PROFILER_API ProfilerEnable(bool enable)
 
     g_profilerState->enabled = enable;
 
-    if (enable)
+    // Keep the origin when profiling is turned on again, so that the events of the detail log never go back in time.
+    if (enable && g_profilerState->startClock == 0)
     {
         g_profilerState->startClock = Clock::GetTimeStamp();
     }
@@ -216,7 +231,8 @@ void ProfilerTimeRecordFixedEvent(const int eventId, const long long beginClock,
     g_profilerState->fixedEvents[eventId].cnt++;
 }
 
-void ProfilerTimeRecordToBuffer(const char* eventDescription, const long long beginClock, const long long endClock)
+void ProfilerTimeRecordToBuffer(const char* eventDescription, const long long beginClock, const long long endClock,
+                                const int eventId = -1, const long long bytes = 0)
 {
     std::lock_guard<std::mutex> lock(g_mutex);
 
@@ -242,6 +258,8 @@ void ProfilerTimeRecordToBuffer(const char* eventDescription, const long long be
     eventRecord.beginClock = beginClock;
     eventRecord.endClock = endClock;
     eventRecord.threadId = GetThreadId();
+    eventRecord.eventId = eventId;
+    eventRecord.bytes = bytes;
 
     memcpy(g_profilerState->customEventBuffer.get() + g_profilerState->customEventOffset, &eventRecord, sizeof(CustomEventRecord));
     g_profilerState->customEventOffset += sizeof(CustomEventRecord);
@@ -270,7 +288,7 @@ void PERF_PROFILER_API ProfilerTimeEnd(const long long stateId, const int eventI
 
     long long endClock = Clock::GetTimeStamp();
     ProfilerTimeRecordFixedEvent(eventId, stateId, endClock);
-    ProfilerTimeRecordToBuffer(c_fixedEvtDesc[eventId].eventDescription, stateId, endClock);
+    ProfilerTimeRecordToBuffer(c_fixedEvtDesc[eventId].eventDescription, stateId, endClock, eventId);
 }
 
 
@@ -323,28 +341,49 @@ void PERF_PROFILER_API ProfilerThroughputEnd(const long long stateId, const int
     if (g_profilerState == nullptr)
         return;
 
-    std::lock_guard<std::mutex> lock(g_mutex);
-
-    if (!g_profilerState->enabled)
-        return;
-
     auto beginClock = stateId;
     if (endClock == beginClock)
         return;
 
-    // Use kB rather than bytes to prevent overflow
-    long long kBytesPerSec = Clock::GetTicksPerSecond() * bytes / 1000 / (endClock - beginClock);
-    if (g_profilerState->fixedEvents[eventId].cnt == 0)
     {
-        g_profilerState->fixedEvents[eventId].min = kBytesPerSec;
-        g_profilerState->fixedEvents[eventId].max = kBytesPerSec;
+        std::lock_guard<std::mutex> lock(g_mutex);
+
+        if (!g_profilerState->enabled)
+            return;
+
+        // Use kB rather than bytes to prevent overflow
+        long long kBytesPerSec = Clock::GetTicksPerSecond() * bytes / 1000 / (endClock - beginClock);
+        if (g_profilerState->fixedEvents[eventId].cnt == 0)
+        {
+            g_profilerState->fixedEvents[eventId].min = kBytesPerSec;
+            g_profilerState->fixedEvents[eventId].max = kBytesPerSec;
+        }
+        g_profilerState->fixedEvents[eventId].min = std::min(kBytesPerSec, g_profilerState->fixedEvents[eventId].min);
+        g_profilerState->fixedEvents[eventId].max = std::max(kBytesPerSec, g_profilerState->fixedEvents[eventId].max);
+        g_profilerState->fixedEvents[eventId].sum += kBytesPerSec;
+        g_profilerState->fixedEvents[eventId].sumsq += (double)kBytesPerSec * (double)kBytesPerSec;
+        g_profilerState->fixedEvents[eventId].totalBytes += bytes;
+        g_profilerState->fixedEvents[eventId].cnt++;
     }
-    g_profilerState->fixedEvents[eventId].min = std::min(kBytesPerSec, g_profilerState->fixedEvents[eventId].min);
-    g_profilerState->fixedEvents[eventId].max = std::max(kBytesPerSec, g_profilerState->fixedEvents[eventId].max);
-    g_profilerState->fixedEvents[eventId].sum += kBytesPerSec;
-    g_profilerState->fixedEvents[eventId].sumsq += (double)kBytesPerSec * (double)kBytesPerSec;
-    g_profilerState->fixedEvents[eventId].totalBytes += bytes;
-    g_profilerState->fixedEvents[eventId].cnt++;
+
+    ProfilerTimeRecordToBuffer(c_fixedEvtDesc[eventId].eventDescription, beginClock, endClock, eventId, bytes);
+}
+
+
+//
+// Totals of a fixed time event so far.
+//
+bool PERF_PROFILER_API ProfilerGetTimeEventTotals(const int eventId, std::string& description, int& count, double& seconds)
+{
+    // A nullptr state indicates that the profiler is globally disabled, and not initialized
+    if (g_profilerState == nullptr || eventId < 0 || eventId >= profilerEvtMax || c_fixedEvtDesc[eventId].eventType != profilerEvtTime)
+        return false;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    description = c_fixedEvtDesc[eventId].eventDescription;
+    count = g_profilerState->fixedEvents[eventId].cnt;
+    seconds = TicksToSeconds(g_profilerState->fixedEvents[eventId].sum);
+    return true;
 }
 
 
@@ -541,7 +580,52 @@ void FormatBytesStr(char* str, size_t strLen, long long bytes)
 
 
 //
-// Generate detail event file in chrome://tracing format (https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU/preview#heading=h.yr703knxre9f)
+// Helpers for the detail event file.
+//
+static std::string JsonEscape(const char* str)
+{
+    std::string escaped;
+    for (; *str; str++)
+    {
+        if (*str == '"' || *str == '\\')
+            escaped += '\\';
+        if ((unsigned char)*str < 0x20)
+            escaped += ' ';
+        else
+            escaped += *str;
+    }
+    return escaped;
+}
+
+// The report indents the fixed events with underscores, the tracks of the detail file nest them by time.
+static const char* TrimIndentation(const char* eventDescription)
+{
+    while (*eventDescription == '_')
+        eventDescription++;
+    return eventDescription;
+}
+
+// The separator above a fixed event in the report, e.g. "Data Reader"
+static const char* FixedEventGroup(int eventId)
+{
+    for (int evtIdx = eventId; evtIdx >= 0; evtIdx--)
+    {
+        if (c_fixedEvtDesc[evtIdx].eventType == profilerEvtSeparator && c_fixedEvtDesc[evtIdx].eventDescription[0] != '\0')
+            return c_fixedEvtDesc[evtIdx].eventDescription;
+    }
+    return "";
+}
+
+static double TicksToTraceTime(long long clock)
+{
+    return 1000000.0 * TicksToSeconds(clock - g_profilerState->startClock); // microseconds
+}
+
+//
+// Generate detail event file in chrome://tracing format (https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU/preview#heading=h.yr703knxre9f),
+// which can also be opened in Perfetto (https://ui.perfetto.dev).
+// Every thread gets a track, named after the group of the fixed events recorded on it. Nested scopes show as nested
+// regions. Throughput events additionally carry their bytes, and feed a counter track of the bytes transferred so far.
 //
 void ProfilerGenerateDetailFile(const std::wstring& fileName)
 {
@@ -551,36 +635,71 @@ void ProfilerGenerateDetailFile(const std::wstring& fileName)
         RuntimeError("Error: ProfilerGenerateDetailFile: Cannot create file <%ls>.\n", fileName.c_str());
     }
 
-    fprintfOrDie(f, "[\n");
+    // walk over the variable-size records in the event buffer
+    auto forAllEvents = [](const std::function<void(const char*, const CustomEventRecord&)>& f)
+    {
+        char* eventPtr = g_profilerState->customEventBuffer.get();
+        while (eventPtr < (g_profilerState->customEventBuffer.get() + g_profilerState->customEventOffset))
+        {
+            char* descriptionStr = eventPtr;
+            eventPtr += strlen(descriptionStr) + 1;
+
+            CustomEventRecord eventRecord;
+            memcpy(&eventRecord, eventPtr, sizeof(CustomEventRecord));
+            eventPtr += sizeof(CustomEventRecord);
+
+            f(descriptionStr, eventRecord);
+        }
+    };
+
+    // name the track of each thread
+    std::map<unsigned int, std::string> threadNames;
+    threadNames[g_profilerState->mainThreadId] = "Main Thread";
+    forAllEvents([&](const char*, const CustomEventRecord& eventRecord)
+    {
+        auto& name = threadNames[eventRecord.threadId];
+        if (name.empty() && eventRecord.eventId >= 0)
+            name = FixedEventGroup(eventRecord.eventId);
+    });
 
-    char* eventPtr = g_profilerState->customEventBuffer.get();
+    fprintfOrDie(f, "{\"displayTimeUnit\":\"ms\", \"traceEvents\":[\n");
 
-    bool firstRecord = true;
     unsigned int pid = GetProcessId();
-    while (eventPtr < (g_profilerState->customEventBuffer.get() + g_profilerState->customEventOffset))
+    fprintfOrDie(f, "  {\"pid\":%u, \"name\":\"process_name\", \"ph\":\"M\", \"args\":{\"name\":\"CNTK %s\"}}",
+        pid, JsonEscape(ToLegacyString(ToUTF8(g_profilerState->logSuffix)).c_str()).c_str());
+    for (const auto& thread : threadNames)
     {
-        char* descriptionStr = eventPtr;
-        eventPtr += strlen(descriptionStr) + 1;
-
-        CustomEventRecord* eventRecord = (CustomEventRecord*)eventPtr;
-        eventPtr += sizeof(CustomEventRecord);
-
-        fprintfOrDie(f, "%s  {\"pid\":%u, \"tid\":%u, \"name\":\"%s\", \"cat\":\"PERF\", \"ph\":\"B\", \"ts\":%llu}",
-            firstRecord ? "" : ",\n",
-            pid,
-            eventRecord->threadId,
-            descriptionStr,
-            (unsigned long long)(1000000.0 * TicksToSeconds(eventRecord->beginClock - g_profilerState->startClock)));
-
-        firstRecord = false;
-        fprintfOrDie(f, ",\n  {\"pid\":%u, \"tid\":%u, \"name\":\"%s\", \"cat\":\"PERF\", \"ph\":\"E\", \"ts\":%llu}",
-            pid,
-            eventRecord->threadId,
-            descriptionStr,
-            (unsigned long long)(1000000.0 * TicksToSeconds(eventRecord->endClock - g_profilerState->startClock)));
+        std::string name = (thread.second.empty() ? "Thread" : thread.second) + " " + std::to_string(thread.first);
+        fprintfOrDie(f, ",\n  {\"pid\":%u, \"tid\":%u, \"name\":\"thread_name\", \"ph\":\"M\", \"args\":{\"name\":\"%s\"}}",
+            pid, thread.first, JsonEscape(name.c_str()).c_str());
+        fprintfOrDie(f, ",\n  {\"pid\":%u, \"tid\":%u, \"name\":\"thread_sort_index\", \"ph\":\"M\", \"args\":{\"sort_index\":%d}}",
+            pid, thread.first, thread.first == g_profilerState->mainThreadId ? 0 : 1);
     }
 
-    fprintfOrDie(f, "\n]\n");
+    std::map<int, long long> totalBytes; // per throughput event
+    forAllEvents([&](const char* descriptionStr, const CustomEventRecord& eventRecord)
+    {
+        bool isFixed = eventRecord.eventId >= 0;
+        std::string name = JsonEscape(isFixed ? TrimIndentation(descriptionStr) : descriptionStr);
+        double beginTime = TicksToTraceTime(eventRecord.beginClock);
+        double duration = TicksToTraceTime(eventRecord.endClock) - beginTime;
+
+        fprintfOrDie(f, ",\n  {\"pid\":%u, \"tid\":%u, \"name\":\"%s\", \"cat\":\"%s\", \"ph\":\"X\", \"ts\":%.3f, \"dur\":%.3f",
+            pid, eventRecord.threadId, name.c_str(), isFixed ? FixedEventGroup(eventRecord.eventId) : "Custom", beginTime, duration);
+        if (isFixed && c_fixedEvtDesc[eventRecord.eventId].eventType == profilerEvtThroughput)
+        {
+            fprintfOrDie(f, ", \"args\":{\"bytes\":%lld, \"MBps\":%.3f}}",
+                eventRecord.bytes, duration > 0 ? eventRecord.bytes / duration : 0.0);
+
+            totalBytes[eventRecord.eventId] += eventRecord.bytes;
+            fprintfOrDie(f, ",\n  {\"pid\":%u, \"name\":\"%s\", \"ph\":\"C\", \"ts\":%.3f, \"args\":{\"MB\":%.3f}}",
+                pid, name.c_str(), beginTime + duration, totalBytes[eventRecord.eventId] / 1000000.0);
+        }
+        else
+            fprintfOrDie(f, "}");
+    });
+
+    fprintfOrDie(f, "\n]}\n");
 
     fclose(f);
 }
@@ -26,6 +26,10 @@
 // and ProfilerThroughputEnd() calls should be used. The throughput APIs can only be used
 // with fixed events.
 //
+// The detail log is a Chrome trace (chrome://tracing, or https://ui.perfetto.dev) with a track per
+// thread, on which nested scopes show as nested regions, and a counter of the bytes of each
+// throughput event.
+//
 // CNTK specifics
 //
 // The profiler is turned off during the very first epoch to avoid polluting profile data with
@@ -79,6 +83,13 @@ enum ProfilerEvents
 
     // Data reader events
     profilerEvtPrefetchMinibatch,           // Prefetching the next minibatch in a background thread
+    profilerEvtReaderPack,                  // Packing the minibatch (includes the stages below)
+    profilerEvtReaderGetChunk,              // Getting chunks from the deserializer
+    profilerEvtReaderRandomize,             // Randomization decisions
+    profilerEvtReaderTransform,             // Transforming sequences
+    profilerEvtReaderTransfer,              // Copying the minibatch to the matrices
+    profilerEvtReaderWait,                  // Main thread waiting for the minibatch
+    profilerEvtReaderFileRead,              // File read throughput
 
     profilerEvtMax
 };
@@ -128,6 +139,13 @@ long long PERF_PROFILER_API ProfilerThroughputBegin();
 void PERF_PROFILER_API ProfilerThroughputEnd(const long long stateId, const int eventId, const long long bytes);
 
 
+//
+// Totals of a fixed time event so far: its description in the summary report, the number of events and their time.
+// Returns false if the profiler is not initialized or the event is not a time event.
+//
+bool PERF_PROFILER_API ProfilerGetTimeEventTotals(const int eventId, std::string& description, int& count, double& seconds);
+
+
 //
 // Generate reports and release all resources.
 //
@@ -10,20 +10,13 @@
 #include "BinaryDataChunk.h"
 #include "CBFUtils.h"
 #include "FileWrapper.h"
+#include <algorithm>
 #include <vector>
 
 namespace CNTK {
 
 using namespace Microsoft::MSR::CNTK;
 
-enum class MatrixEncodingType : unsigned char
-{
-    dense = 0,
-    sparse_csc = 1,
-    // TODO: compressed_sparse_csc = 2, // indices are encoded as var-ints
-};
-
-
 void BinaryChunkDeserializer::ReadChunkTable()
 {
     uint64_t firstChunkOffset = m_chunkTableOffset;
@@ -37,13 +30,71 @@ void BinaryChunkDeserializer::ReadChunkTable()
     // Read in all of the offsets for the chunks
     m_file.ReadOrDie(chunks, sizeof(BinaryChunkInfo), m_numChunks);
 
-    // We fill the final entry with the current position of the file
-    auto position = m_file.TellOrDie();
-    chunks[m_numChunks].offset = position;
+    // The last chunk ends where the header starts.
+    chunks[m_numChunks].offset = m_headerOffset;
     chunks[m_numChunks].numSamples = 0;
     chunks[m_numChunks].numSequences = 0;
 
-    m_chunkTable = make_unique<ChunkTable>(m_numChunks, chunks);
+    // Compressed chunks are followed by the sizes of their data once decompressed.
+    std::vector<uint64_t> dataSizes;
+    if (m_compression != CBFCompression::none)
+    {
+        dataSizes.resize(m_numChunks);
+        if (m_numChunks > 0)
+            m_file.ReadOrDie(dataSizes.data(), sizeof(uint64_t), m_numChunks);
+    }
+
+    m_chunkTable = make_unique<ChunkTable>(m_numChunks, chunks, std::move(dataSizes));
+}
+
+shared_ptr<byte> ChunkBufferPool::Get(size_t size)
+{
+    unique_ptr<Buffer> buffer;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        // The smallest free buffer that is large enough.
+        auto best = m_freeBuffers.end();
+        for (auto it = m_freeBuffers.begin(); it != m_freeBuffers.end(); ++it)
+        {
+            if ((*it)->m_capacity >= size && (best == m_freeBuffers.end() || (*it)->m_capacity < (*best)->m_capacity))
+                best = it;
+        }
+
+        if (best != m_freeBuffers.end())
+        {
+            buffer = std::move(*best);
+            m_freeBuffers.erase(best);
+        }
+    }
+
+    if (!buffer)
+    {
+        buffer = make_unique<Buffer>();
+        buffer->m_data.reset(new byte[size]);
+        buffer->m_capacity = size;
+    }
+
+    auto pool = shared_from_this();
+    shared_ptr<Buffer> holder(buffer.release(), [pool](Buffer* b) { pool->Return(b); });
+    return shared_ptr<byte>(holder, holder->m_data.get());
+}
+
+void ChunkBufferPool::Return(Buffer* buffer)
+{
+    unique_ptr<Buffer> returned(buffer);
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_freeBuffers.size() < m_maxFreeBuffers)
+    {
+        m_freeBuffers.push_back(std::move(returned));
+        return;
+    }
+
+    // The pool is full: keep the larger buffers, they fit more chunks.
+    auto smallest = std::min_element(m_freeBuffers.begin(), m_freeBuffers.end(),
+        [](const unique_ptr<Buffer>& a, const unique_ptr<Buffer>& b) { return a->m_capacity < b->m_capacity; });
+    if ((*smallest)->m_capacity < returned->m_capacity)
+        *smallest = std::move(returned);
 }
 
 BinaryChunkDeserializer::BinaryChunkDeserializer(const BinaryConfigHelper& helper) :
@@ -52,6 +103,15 @@ BinaryChunkDeserializer::BinaryChunkDeserializer(const BinaryConfigHelper& helpe
     SetTraceLevel(helper.GetTraceLevel());
 
     Initialize(helper.GetRename(), helper.GetElementType());
+
+    if (helper.UseMemoryMapping())
+    {
+        if (m_file.IsRemote())
+            fprintf(stderr, "WARNING: '%ls' is a remote file, which cannot be memory mapped; its chunks are read instead.\n",
+                helper.GetFilePath().c_str());
+        else
+            m_mappedFile = make_shared<MemoryMappedFile>(helper.GetFilePath());
+    }
 }
 
 
@@ -60,6 +120,9 @@ BinaryChunkDeserializer::BinaryChunkDeserializer(const std::wstring& filename) :
     m_file(FileWrapper::OpenOrDie(filename, L"rb")),
     m_headerOffset(0),
     m_chunkTableOffset(0),
+    m_inputsEndOffset(0),
+    m_compression(CBFCompression::none),
+    m_bufferPool(make_shared<ChunkBufferPool>()),
     m_traceLevel(0)
 {
 }
@@ -71,9 +134,10 @@ void BinaryChunkDeserializer::Initialize(const std::map<std::wstring, std::wstri
     // First, verify the magic number.
     CBFUtils::FindMagicOrDie(m_file);
     
-    // Second, read the version number of the data file, and (for now) make sure the reader version is the same.
+    // Second, read the version number of the data file, and make sure the reader knows it.
+    // Version 1 files are version 2 files without compression.
     uint32_t versionNumber = CBFUtils::GetVersionNumber(m_file);
-    if (versionNumber != s_currentVersion)
+    if (versionNumber == 0 || versionNumber > s_currentVersion)
         LogicError("The reader version is %" PRIu32 ", but the data file was created for version %" PRIu32 ".",
             s_currentVersion, versionNumber);
 
@@ -117,6 +181,18 @@ void BinaryChunkDeserializer::Initialize(const std::map<std::wstring, std::wstri
         m_streams[i] = description;
     }
 
+    m_inputsEndOffset = m_file.TellOrDie();
+
+    // Since version 2, the compression of the chunks precedes the chunk table.
+    if (versionNumber >= 2)
+    {
+        uint32_t compression;
+        m_file.ReadOrDie(compression);
+        m_compression = (CBFCompression)compression;
+        if (m_compression != CBFCompression::none && m_compression != CBFCompression::zlib)
+            RuntimeError("Unknown chunk compression %" PRIu32 " in '%ls'.", compression, m_file.Filename().c_str());
+    }
+
     // We just finished the header. So we're now at the chunk table.
     m_chunkTableOffset = m_file.TellOrDie();
 
@@ -148,12 +224,23 @@ void BinaryChunkDeserializer::SequenceInfosForChunk(ChunkIdType chunkId, std::ve
 
     auto offset = m_chunkTable->GetOffset(chunkId);
     auto numberOfSequences = m_chunkTable->GetNumSequences(chunkId);
-    unique_ptr<uint32_t[]> numSamplesPerSequence(new uint32_t[numberOfSequences]);
+    unique_ptr<uint32_t[]> buffer;
+    const uint32_t* numSamplesPerSequence;
 
-    // Seek to the start of the chunk
-    m_file.SeekOrDie(offset, SEEK_SET);
-    // read 'numberOfSequences' unsigned ints
-    m_file.ReadOrDie(numSamplesPerSequence.get(), sizeof(uint32_t), numberOfSequences);
+    if (m_mappedFile)
+    {
+        numSamplesPerSequence = reinterpret_cast<const uint32_t*>(GetMappedAddress(chunkId, offset, numberOfSequences * sizeof(uint32_t)));
+    }
+    else
+    {
+        buffer.reset(new uint32_t[numberOfSequences]);
+        numSamplesPerSequence = buffer.get();
+
+        // Seek to the start of the chunk
+        m_file.SeekOrDie(offset, SEEK_SET);
+        // read 'numberOfSequences' unsigned ints
+        m_file.ReadOrDie(buffer.get(), sizeof(uint32_t), numberOfSequences);
+    }
 
     auto startId = m_chunkTable->GetStartIndex(chunkId);
     for (decltype(numberOfSequences) i = 0; i < numberOfSequences; i++)
@@ -169,17 +256,50 @@ void BinaryChunkDeserializer::SequenceInfosForChunk(ChunkIdType chunkId, std::ve
     }
 }
 
-unique_ptr<byte[]> BinaryChunkDeserializer::ReadChunk(ChunkIdType chunkId)
+void BinaryChunkDeserializer::WillNeedChunks(const std::vector<ChunkIdType>& chunkIds)
 {
-    // Seek to the start of the data portion in the chunk
-    m_file.SeekOrDie(m_chunkTable->GetDataStartOffset(chunkId), SEEK_SET);
+    for (auto chunkId : chunkIds)
+    {
+        if (chunkId >= m_numChunks)
+            continue;
+
+        // The sequence lengths at the start of the chunk are needed as well as its data.
+        auto offset = m_chunkTable->GetOffset(chunkId);
+        auto size = m_chunkTable->GetDataStartOffset(chunkId) + m_chunkTable->GetChunkSize(chunkId) - offset;
+        m_file.WillNeed(offset, size);
+    }
+}
+
+const char* BinaryChunkDeserializer::GetMappedAddress(ChunkIdType chunkId, int64_t offset, size_t size)
+{
+    if (offset < 0 || offset + size > m_mappedFile->Size())
+        RuntimeError("Chunk %u exceeds the size of the input file.", (unsigned int)chunkId);
+    return m_mappedFile->Data() + offset;
+}
+
+shared_ptr<byte> BinaryChunkDeserializer::ReadChunk(ChunkIdType chunkId)
+{
+    if (m_compression != CBFCompression::none)
+        return ReadCompressedChunk(chunkId);
 
     // Determine how big the chunk is.
     size_t chunkSize = m_chunkTable->GetChunkSize(chunkId);
-    
-    // Create buffer
-    // TODO: use a pool of buffers instead of allocating a new one, each time a chunk is read.
-    unique_ptr<byte[]> buffer(new byte[chunkSize]);
+
+    if (m_mappedFile)
+    {
+        // No copy: the chunk points into the mapping and keeps it alive. GetChunk() is called ahead of
+        // the use of the chunk by the prefetching randomizer, so ask the OS to start reading the pages now.
+        const int64_t offset = m_chunkTable->GetDataStartOffset(chunkId);
+        const char* data = GetMappedAddress(chunkId, offset, chunkSize);
+        m_mappedFile->WillNeed(offset, chunkSize);
+        return shared_ptr<byte>(m_mappedFile, (byte*)data);
+    }
+
+    // Seek to the start of the data portion in the chunk
+    m_file.SeekOrDie(m_chunkTable->GetDataStartOffset(chunkId), SEEK_SET);
+
+    // Take a buffer from the pool, it returns there once the chunk and its sequences are released.
+    shared_ptr<byte> buffer = m_bufferPool->Get(chunkSize);
 
     // Read the chunk from disk
     m_file.ReadOrDie(buffer.get(), sizeof(byte), chunkSize);
@@ -187,13 +307,38 @@ unique_ptr<byte[]> BinaryChunkDeserializer::ReadChunk(ChunkIdType chunkId)
     return buffer;
 }
 
+shared_ptr<byte> BinaryChunkDeserializer::ReadCompressedChunk(ChunkIdType chunkId)
+{
+    const int64_t offset = m_chunkTable->GetDataStartOffset(chunkId);
+    const size_t storedSize = m_chunkTable->GetChunkSize(chunkId);
+    const size_t dataSize = m_chunkTable->GetDataSize(chunkId);
+
+    // Decompress straight from the mapping, or from the compressed data read from disk.
+    const char* data;
+    if (m_mappedFile)
+    {
+        data = GetMappedAddress(chunkId, offset, storedSize);
+    }
+    else
+    {
+        m_compressedBuffer.resize(storedSize);
+        m_file.SeekOrDie(offset, SEEK_SET);
+        m_file.ReadOrDie(m_compressedBuffer.data(), sizeof(char), storedSize);
+        data = m_compressedBuffer.data();
+    }
+
+    shared_ptr<byte> buffer = m_bufferPool->Get(dataSize);
+    CBFUtils::Decompress(m_compression, data, storedSize, buffer.get(), dataSize);
+    return buffer;
+}
+
 
 ChunkPtr BinaryChunkDeserializer::GetChunk(ChunkIdType chunkId)
 {
     // Read the chunk into memory
-    unique_ptr<byte[]> buffer = ReadChunk(chunkId);
+    shared_ptr<byte> buffer = ReadChunk(chunkId);
 
-    return make_shared<BinaryDataChunk>(chunkId, m_chunkTable->GetNumSequences(chunkId), std::move(buffer), m_deserializers);
+    return make_shared<BinaryDataChunk>(chunkId, m_chunkTable->GetNumSequences(chunkId), buffer, m_deserializers);
 }
 
 void BinaryChunkDeserializer::SetTraceLevel(unsigned int traceLevel)
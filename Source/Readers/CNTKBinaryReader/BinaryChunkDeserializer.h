@@ -9,6 +9,9 @@
 #include "BinaryConfigHelper.h"
 #include "BinaryDataChunk.h"
 #include "BinaryDataDeserializer.h"
+#include "MemoryMappedFile.h"
+#include "CBFUtils.h"
+#include <mutex>
 
 namespace CNTK {
 
@@ -24,10 +27,13 @@ struct BinaryChunkInfo
 class ChunkTable {
 public:
 
-    ChunkTable(uint32_t numChunks, BinaryChunkInfo * offsetsTable) :
+    // 'dataSizes' holds the size of the data portion of each chunk once decompressed,
+    // it is empty if the chunks are stored uncompressed.
+    ChunkTable(uint32_t numChunks, BinaryChunkInfo * offsetsTable, std::vector<uint64_t>&& dataSizes = {}) :
         m_numChunks(numChunks),
         m_diskOffsetsTable(offsetsTable),
-        m_startIndex(numChunks)
+        m_startIndex(numChunks),
+        m_dataSizes(std::move(dataSizes))
     {
         uint64_t numSequences = 0;
         for (decltype(m_numChunks) i = 0; i < m_numChunks; i++)
@@ -70,10 +76,43 @@ public:
         return dataEndOffset - dataStartOffset;
     }
 
+    // Size of the data portion of the chunk in memory, GetChunkSize() is its size on disk.
+    uint64_t GetDataSize(uint32_t index)
+    {
+        return m_dataSizes.empty() ? GetChunkSize(index) : m_dataSizes[index];
+    }
+
 private:
     uint32_t m_numChunks;
     unique_ptr<BinaryChunkInfo[]> m_diskOffsetsTable;
     vector<uint64_t> m_startIndex;
+    vector<uint64_t> m_dataSizes;
+};
+
+// Reusable buffers for the chunks that are read or decompressed into memory. A buffer returns to the pool
+// when the last reference to the chunk data is released, so that a sweep allocates about as many buffers
+// as there are chunks in memory at the same time instead of one per chunk.
+class ChunkBufferPool : public std::enable_shared_from_this<ChunkBufferPool>
+{
+public:
+    explicit ChunkBufferPool(size_t maxFreeBuffers = 4) : m_maxFreeBuffers(maxFreeBuffers)
+    {}
+
+    // Returns a buffer of at least 'size' bytes.
+    shared_ptr<byte> Get(size_t size);
+
+private:
+    struct Buffer
+    {
+        unique_ptr<byte[]> m_data;
+        size_t m_capacity;
+    };
+
+    void Return(Buffer* buffer);
+
+    std::mutex m_lock;
+    std::vector<unique_ptr<Buffer>> m_freeBuffers;
+    const size_t m_maxFreeBuffers;
 };
 
 typedef unique_ptr<ChunkTable> ChunkTablePtr;
@@ -101,6 +140,9 @@ public:
     // Get information about particular chunk.
     void SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& result) override;
 
+    // Starts fetching the given chunks if the input is a remote file.
+    void WillNeedChunks(const std::vector<ChunkIdType>& chunkIds) override;
+
 private:
     // Builds an index of the input data.
     void Initialize(const std::map<std::wstring, std::wstring>& rename, DataType precision);
@@ -108,8 +150,14 @@ private:
     // Reads the chunk table from disk into memory
     void ReadChunkTable();
 
-    // Reads a chunk from disk into buffer
-    unique_ptr<byte[]> ReadChunk(ChunkIdType chunkId);
+    // Reads a chunk from disk into buffer, or returns a pointer into the file mapping.
+    // Compressed chunks are decompressed into a buffer, on the thread that asks for the chunk.
+    shared_ptr<byte> ReadChunk(ChunkIdType chunkId);
+
+    shared_ptr<byte> ReadCompressedChunk(ChunkIdType chunkId);
+
+    // Checks that the chunk lies within the mapped file and returns the address of 'offset'.
+    const char* GetMappedAddress(ChunkIdType chunkId, int64_t offset, size_t size);
 
     BinaryChunkDeserializer(const wstring& filename);
 
@@ -118,21 +166,39 @@ private:
 private:
     FileWrapper m_file;
 
+    // If set, chunks are not read but referenced in the mapping of the file.
+    MemoryMappedFilePtr m_mappedFile;
+
     int64_t m_headerOffset, m_chunkTableOffset;
 
+    // End of the descriptions of the inputs in the header.
+    int64_t m_inputsEndOffset;
+
     std::vector<BinaryDataDeserializerPtr> m_deserializers;
     ChunkTablePtr m_chunkTable;
     void* m_chunkBuffer;
 
+    // Codec of the data of the chunks.
+    CBFCompression m_compression;
+
+    // Buffers of the chunks that are not referenced in the file mapping.
+    shared_ptr<ChunkBufferPool> m_bufferPool;
+
+    // Compressed data of the last chunk read from disk.
+    std::vector<char> m_compressedBuffer;
+
     
     uint32_t m_numChunks;
     uint32_t m_numInputs;
     
     unsigned int m_traceLevel;
 
-    static const uint32_t s_currentVersion = 1;
+    // Version 2 records the compression of the chunks in the header.
+    static const uint32_t s_currentVersion = 2;
 
     friend class CNTKBinaryReaderTestRunner;
+    friend class CBFConverter;
+    friend class CBFWriter;
 
 
     DISABLE_COPY_AND_MOVE(BinaryChunkDeserializer);
@@ -66,6 +66,7 @@ namespace CNTK {
 
         m_filepath = Microsoft::MSR::CNTK::ToFixedWStringFromMultiByte(config(L"file"));
         m_keepDataInMemory = config(L"keepDataInMemory", false);
+        m_useMemoryMapping = config(L"useMemoryMapping", false);
 
         m_randomizationWindow = GetRandomizationWindowFromConfig(config);
         m_sampleBasedRandomizationWindow = config(L"sampleBasedRandomizationWindow", false);
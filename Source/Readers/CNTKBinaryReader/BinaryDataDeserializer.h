@@ -24,6 +24,10 @@ public:
         ReadDataType(file);
         ReadSampleSize(file);
 
+        // Unknown precision takes the type of the input, for readers that copy the data rather than use it.
+        if (precision == DataType::Unknown)
+            precision = m_dataType == ReaderDataType::tfloat ? DataType::Float : DataType::Double;
+
         if (precision != DataType::Float && precision != DataType::Double)
             LogicError("Unsupported precision type %u.", (unsigned int)precision);
 
@@ -0,0 +1,382 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include <exception>
+#include <limits>
+#include <omp.h>
+#include "CBFConverter.h"
+#include "StringUtil.h"
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+
+// A chunk of the input: the lengths of its sequences and its data, uncompressed and as written.
+struct ConvertedChunk
+{
+    std::vector<uint32_t> m_sequenceLengths;
+    shared_ptr<byte> m_data;
+    size_t m_dataSize;
+    std::vector<char> m_storedData;
+};
+
+// Runs body(i) for i in [0, count) on 'numThreads' threads, rethrowing the first exception on the calling thread.
+template <class Body>
+static void ParallelFor(size_t count, int numThreads, const Body& body)
+{
+    std::exception_ptr error;
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads)
+    for (int i = 0; i < (int)count; ++i)
+    {
+        try
+        {
+            body((size_t)i);
+        }
+        catch (...)
+        {
+#pragma omp critical
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+CBFWriter::CBFWriter(const std::wstring& path, CBFCompression compression)
+    : m_file(FileWrapper::OpenOrDie(path, L"wb")),
+    m_compression(compression)
+{
+    uint64_t magic = CBFUtils::MAGIC_NUMBER;
+    m_file.WriteOrDie(&magic, sizeof(magic), 1);
+    uint32_t version = BinaryChunkDeserializer::s_currentVersion;
+    m_file.WriteOrDie(&version, sizeof(version), 1);
+}
+
+void CBFWriter::WriteChunk(const std::vector<uint32_t>& sequenceLengths, uint32_t numSamples, uint64_t dataSize, const std::vector<char>& storedData)
+{
+    if (m_compression == CBFCompression::none && dataSize != storedData.size())
+        LogicError("CBFWriter: an uncompressed chunk of %" PRIu64 " bytes is stored in %zu bytes.", dataSize, storedData.size());
+
+    BinaryChunkInfo info;
+    info.offset = m_file.TellOrDie();
+    info.numSequences = (uint32_t)sequenceLengths.size();
+    info.numSamples = numSamples;
+    m_chunkTable.push_back(info);
+    m_dataSizes.push_back(dataSize);
+
+    if (!sequenceLengths.empty())
+        m_file.WriteOrDie(sequenceLengths.data(), sizeof(uint32_t), sequenceLengths.size());
+    if (!storedData.empty())
+        m_file.WriteOrDie(storedData.data(), sizeof(char), storedData.size());
+}
+
+void CBFWriter::Finish(uint32_t numInputs, const std::vector<char>& inputs)
+{
+    int64_t headerOffset = m_file.TellOrDie();
+    uint64_t magic = CBFUtils::MAGIC_NUMBER;
+    m_file.WriteOrDie(&magic, sizeof(magic), 1);
+    uint32_t numChunks = (uint32_t)m_chunkTable.size();
+    m_file.WriteOrDie(&numChunks, sizeof(numChunks), 1);
+    m_file.WriteOrDie(&numInputs, sizeof(numInputs), 1);
+    if (!inputs.empty())
+        m_file.WriteOrDie(inputs.data(), sizeof(char), inputs.size());
+
+    uint32_t compression = (uint32_t)m_compression;
+    m_file.WriteOrDie(&compression, sizeof(compression), 1);
+    if (numChunks > 0)
+    {
+        m_file.WriteOrDie(m_chunkTable.data(), sizeof(BinaryChunkInfo), numChunks);
+        if (m_compression != CBFCompression::none)
+            m_file.WriteOrDie(m_dataSizes.data(), sizeof(uint64_t), numChunks);
+    }
+
+    m_file.WriteOrDie(&headerOffset, sizeof(headerOffset), 1);
+    m_file.FlushOrDie();
+}
+
+template <class T>
+static void Append(std::vector<char>& buffer, const T& value)
+{
+    auto bytes = reinterpret_cast<const char*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+static void AppendBytes(std::vector<char>& buffer, const void* data, size_t size)
+{
+    buffer.insert(buffer.end(), (const char*)data, (const char*)data + size);
+}
+
+/*static*/ void CBFWriter::AppendInput(std::vector<char>& inputs, MatrixEncodingType encoding, const std::string& name, DataType elementType, uint32_t sampleDimension)
+{
+    if (elementType != DataType::Float && elementType != DataType::Double)
+        InvalidArgument("CBFWriter: input '%s' has an element type that the binary format does not support.", name.c_str());
+
+    Append(inputs, encoding);
+    Append(inputs, (uint32_t)name.size());
+    AppendBytes(inputs, name.data(), name.size());
+    Append(inputs, (unsigned char)(elementType == DataType::Float ? 0 : 1));
+    Append(inputs, sampleDimension);
+}
+
+static std::vector<char> ReadBytes(FileWrapper& file, int64_t begin, int64_t end)
+{
+    std::vector<char> result(end - begin);
+    file.SeekOrDie(begin, SEEK_SET);
+    if (!result.empty())
+        file.ReadOrDie(result.data(), sizeof(char), result.size());
+    return result;
+}
+
+/*static*/ std::vector<uint32_t> CBFConverter::ReadSequenceLengths(BinaryChunkDeserializer& reader, uint32_t chunkId)
+{
+    std::vector<uint32_t> result(reader.m_chunkTable->GetNumSequences(chunkId));
+    reader.m_file.SeekOrDie(reader.m_chunkTable->GetOffset(chunkId), SEEK_SET);
+    if (!result.empty())
+        reader.m_file.ReadOrDie(result.data(), sizeof(uint32_t), result.size());
+    return result;
+}
+
+/*static*/ void CBFConverter::Convert(const std::wstring& input, const std::wstring& output, CBFCompression compression, int level)
+{
+    BinaryChunkDeserializer reader(input);
+    reader.Initialize({}, DataType::Unknown);
+
+    fprintf(stderr, "CBFConverter: converting '%ls' (%u chunks, compression '%ls') into '%ls' (compression '%ls')\n",
+        input.c_str(), (unsigned int)reader.m_numChunks, CBFUtils::CompressionName(reader.m_compression),
+        output.c_str(), CBFUtils::CompressionName(compression));
+
+    CBFWriter writer(output, compression);
+    uint64_t totalDataSize = 0, totalStoredSize = 0;
+
+    // Chunks are read in order, compressed in batches that keep all threads busy, and written in order.
+    const uint32_t batchSize = 2 * (uint32_t)omp_get_max_threads();
+    for (uint32_t begin = 0; begin < reader.m_numChunks; begin += batchSize)
+    {
+        std::vector<ConvertedChunk> batch(std::min(batchSize, reader.m_numChunks - begin));
+        for (uint32_t i = 0; i < batch.size(); ++i)
+        {
+            batch[i].m_sequenceLengths = ReadSequenceLengths(reader, begin + i);
+            batch[i].m_data = reader.ReadChunk(begin + i);
+            batch[i].m_dataSize = reader.m_chunkTable->GetDataSize(begin + i);
+        }
+
+        ParallelFor(batch.size(), omp_get_max_threads(), [&](size_t i)
+        {
+            CBFUtils::Compress(compression, batch[i].m_data.get(), batch[i].m_dataSize, level, batch[i].m_storedData);
+            batch[i].m_data.reset();
+        });
+
+        for (uint32_t i = 0; i < batch.size(); ++i)
+        {
+            const auto& chunk = batch[i];
+            writer.WriteChunk(chunk.m_sequenceLengths, reader.m_chunkTable->GetNumSamples(begin + i), chunk.m_dataSize, chunk.m_storedData);
+            totalDataSize += chunk.m_dataSize;
+            totalStoredSize += chunk.m_storedData.size();
+        }
+    }
+
+    // The descriptions of the inputs are copied, they follow the magic number and the numbers of chunks and inputs.
+    const int64_t inputsOffset = reader.m_headerOffset + sizeof(uint64_t) + 2 * sizeof(uint32_t);
+    writer.Finish(reader.m_numInputs, ReadBytes(reader.m_file, inputsOffset, reader.m_inputsEndOffset));
+
+    fprintf(stderr, "CBFConverter: wrote %" PRIu64 " bytes of chunk data as %" PRIu64 " bytes (%.2fx)\n",
+        totalDataSize, totalStoredSize, totalStoredSize == 0 ? 1.0 : (double)totalDataSize / totalStoredSize);
+}
+
+/*static*/ void CBFConverter::Verify(const std::wstring& input, const std::wstring& output)
+{
+    BinaryChunkDeserializer expected(input);
+    expected.Initialize({}, DataType::Unknown);
+    BinaryChunkDeserializer actual(output);
+    actual.Initialize({}, DataType::Unknown);
+
+    if (ReadBytes(expected.m_file, expected.m_headerOffset, expected.m_inputsEndOffset) !=
+        ReadBytes(actual.m_file, actual.m_headerOffset, actual.m_inputsEndOffset))
+        RuntimeError("CBFConverter: the inputs of '%ls' differ from the inputs of '%ls'.", output.c_str(), input.c_str());
+
+    if (expected.m_numChunks != actual.m_numChunks)
+        RuntimeError("CBFConverter: '%ls' has %u chunks, '%ls' has %u.",
+            output.c_str(), (unsigned int)actual.m_numChunks, input.c_str(), (unsigned int)expected.m_numChunks);
+
+    for (uint32_t i = 0; i < expected.m_numChunks; ++i)
+    {
+        size_t dataSize = expected.m_chunkTable->GetDataSize(i);
+        if (expected.m_chunkTable->GetNumSequences(i) != actual.m_chunkTable->GetNumSequences(i) ||
+            expected.m_chunkTable->GetNumSamples(i) != actual.m_chunkTable->GetNumSamples(i) ||
+            dataSize != actual.m_chunkTable->GetDataSize(i) ||
+            ReadSequenceLengths(expected, i) != ReadSequenceLengths(actual, i) ||
+            memcmp(expected.ReadChunk(i).get(), actual.ReadChunk(i).get(), dataSize) != 0)
+            RuntimeError("CBFConverter: chunk %u of '%ls' differs from the chunk of '%ls'.", (unsigned int)i, output.c_str(), input.c_str());
+    }
+
+    fprintf(stderr, "CBFConverter: verified %u chunks in '%ls'\n", (unsigned int)expected.m_numChunks, output.c_str());
+}
+
+// Appends a sequence in the layout read by DenseBinaryDataDeserializer: the number of samples and the values.
+template <class ElemType>
+static void AppendDenseSequence(std::vector<char>& buffer, const SequenceDataPtr& sequence, StorageFormat sourceFormat, size_t sampleDimension)
+{
+    const uint32_t numSamples = sequence->m_numberOfSamples;
+    Append(buffer, numSamples);
+    const ElemType* values = (const ElemType*)sequence->GetDataBuffer();
+    if (sourceFormat == StorageFormat::Dense)
+    {
+        AppendBytes(buffer, values, sizeof(ElemType) * sampleDimension * numSamples);
+        return;
+    }
+
+    std::vector<ElemType> dense(sampleDimension * numSamples, 0);
+    const auto& sparse = static_cast<const SparseSequenceData&>(*sequence);
+    size_t k = 0;
+    for (uint32_t j = 0; j < numSamples; ++j)
+    {
+        for (SparseIndexType n = 0; n < sparse.m_nnzCounts[j]; ++n, ++k)
+            dense[j * sampleDimension + sparse.m_indices[k]] = values[k];
+    }
+    AppendBytes(buffer, dense.data(), sizeof(ElemType) * dense.size());
+}
+
+// Appends a sequence in the layout read by SparseBinaryDataDeserializer: the number of samples, the number of
+// non-zero values, the values, their row indices and the number of non-zero values of each sample.
+template <class ElemType>
+static void AppendSparseSequence(std::vector<char>& buffer, const SequenceDataPtr& sequence, StorageFormat sourceFormat, size_t sampleDimension)
+{
+    const uint32_t numSamples = sequence->m_numberOfSamples;
+    Append(buffer, numSamples);
+    const ElemType* values = (const ElemType*)sequence->GetDataBuffer();
+    if (sourceFormat != StorageFormat::Dense)
+    {
+        const auto& sparse = static_cast<const SparseSequenceData&>(*sequence);
+        Append(buffer, (uint32_t)sparse.m_totalNnzCount);
+        AppendBytes(buffer, values, sizeof(ElemType) * sparse.m_totalNnzCount);
+        AppendBytes(buffer, sparse.m_indices, sizeof(int32_t) * sparse.m_totalNnzCount);
+        AppendBytes(buffer, sparse.m_nnzCounts.data(), sizeof(int32_t) * numSamples);
+        return;
+    }
+
+    std::vector<ElemType> nonZeroValues;
+    std::vector<int32_t> indices, counts(numSamples, 0);
+    for (uint32_t j = 0; j < numSamples; ++j)
+    {
+        for (size_t row = 0; row < sampleDimension; ++row)
+        {
+            ElemType value = values[j * sampleDimension + row];
+            if (value != 0)
+            {
+                nonZeroValues.push_back(value);
+                indices.push_back((int32_t)row);
+                counts[j]++;
+            }
+        }
+    }
+
+    Append(buffer, (uint32_t)nonZeroValues.size());
+    AppendBytes(buffer, nonZeroValues.data(), sizeof(ElemType) * nonZeroValues.size());
+    AppendBytes(buffer, indices.data(), sizeof(int32_t) * indices.size());
+    AppendBytes(buffer, counts.data(), sizeof(int32_t) * counts.size());
+}
+
+template <class ElemType>
+static void AppendSequence(std::vector<char>& buffer, const SequenceDataPtr& sequence, const StreamInformation& stream, StorageFormat format)
+{
+    if (format == StorageFormat::Dense)
+        AppendDenseSequence<ElemType>(buffer, sequence, stream.m_storageFormat, stream.m_sampleLayout.TotalSize());
+    else
+        AppendSparseSequence<ElemType>(buffer, sequence, stream.m_storageFormat, stream.m_sampleLayout.TotalSize());
+}
+
+/*static*/ void CBFConverter::Convert(DataDeserializerPtr source, const std::vector<StorageFormat>& formats, const std::wstring& output,
+    CBFCompression compression, int level, size_t numThreads)
+{
+    auto streams = source->StreamInfos();
+    if (formats.size() != streams.size())
+        LogicError("CBFConverter: %zu storage formats are given for %zu streams.", formats.size(), streams.size());
+
+    std::vector<char> inputs;
+    for (size_t i = 0; i < streams.size(); ++i)
+    {
+        const auto& stream = streams[i];
+        if (formats[i] != StorageFormat::Dense && formats[i] != StorageFormat::SparseCSC)
+            InvalidArgument("CBFConverter: stream '%ls' can only be written as dense or sparse.", stream.m_name.c_str());
+
+        size_t sampleDimension = stream.m_sampleLayout.TotalSize();
+        if (sampleDimension > (size_t)std::numeric_limits<int32_t>::max())
+            InvalidArgument("CBFConverter: the sample dimension %zu of stream '%ls' is too large for the binary format.", sampleDimension, stream.m_name.c_str());
+
+        CBFWriter::AppendInput(inputs, formats[i] == StorageFormat::Dense ? MatrixEncodingType::dense : MatrixEncodingType::sparse_csc,
+            Microsoft::MSR::CNTK::ToLegacyString(Microsoft::MSR::CNTK::ToUTF8(stream.m_name)), stream.m_elementType, (uint32_t)sampleDimension);
+    }
+
+    auto chunks = source->ChunkInfos();
+    fprintf(stderr, "CBFConverter: converting %zu chunks into '%ls' (compression '%ls') on %zu threads\n",
+        chunks.size(), output.c_str(), CBFUtils::CompressionName(compression), numThreads);
+
+    CBFWriter writer(output, compression);
+    uint64_t totalSequences = 0, totalSamples = 0, totalDataSize = 0, totalStoredSize = 0;
+
+    // Chunks are loaded and encoded in batches that keep all threads busy, and written in order.
+    const size_t batchSize = 2 * numThreads;
+    for (size_t begin = 0; begin < chunks.size(); begin += batchSize)
+    {
+        std::vector<std::vector<SequenceInfo>> sequences(std::min(batchSize, chunks.size() - begin));
+        for (size_t i = 0; i < sequences.size(); ++i)
+            source->SequenceInfosForChunk(chunks[begin + i].m_id, sequences[i]);
+
+        std::vector<ConvertedChunk> batch(sequences.size());
+        ParallelFor(batch.size(), (int)numThreads, [&](size_t i)
+        {
+            auto chunk = source->GetChunk(chunks[begin + i].m_id);
+
+            // The data of the streams follow each other, each holding all sequences of the chunk.
+            std::vector<std::vector<char>> streamData(streams.size());
+            std::vector<SequenceDataPtr> data;
+            for (const auto& sequence : sequences[i])
+            {
+                data.clear();
+                chunk->GetSequence(sequence.m_indexInChunk, data);
+                batch[i].m_sequenceLengths.push_back(sequence.m_numberOfSamples);
+                for (size_t s = 0; s < streams.size(); ++s)
+                {
+                    if (streams[s].m_elementType == DataType::Double)
+                        AppendSequence<double>(streamData[s], data[s], streams[s], formats[s]);
+                    else
+                        AppendSequence<float>(streamData[s], data[s], streams[s], formats[s]);
+                }
+            }
+
+            std::vector<char> chunkData;
+            for (const auto& d : streamData)
+                chunkData.insert(chunkData.end(), d.begin(), d.end());
+            batch[i].m_dataSize = chunkData.size();
+            CBFUtils::Compress(compression, chunkData.data(), chunkData.size(), level, batch[i].m_storedData);
+        });
+
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            const auto& chunk = batch[i];
+            uint32_t numSamples = 0;
+            for (auto length : chunk.m_sequenceLengths)
+                numSamples += length;
+
+            writer.WriteChunk(chunk.m_sequenceLengths, numSamples, chunk.m_dataSize, chunk.m_storedData);
+            totalSequences += chunk.m_sequenceLengths.size();
+            totalSamples += numSamples;
+            totalDataSize += chunk.m_dataSize;
+            totalStoredSize += chunk.m_storedData.size();
+        }
+    }
+
+    writer.Finish((uint32_t)streams.size(), inputs);
+
+    fprintf(stderr, "CBFConverter: wrote %" PRIu64 " sequences (%" PRIu64 " samples), %" PRIu64 " bytes of chunk data as %" PRIu64 " bytes\n",
+        totalSequences, totalSamples, totalDataSize, totalStoredSize);
+}
+
+}
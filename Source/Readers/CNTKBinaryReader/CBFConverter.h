@@ -0,0 +1,66 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <vector>
+#include "DataDeserializer.h"
+#include "FileWrapper.h"
+#include "BinaryChunkDeserializer.h"
+#include "CBFUtils.h"
+
+namespace CNTK {
+
+// Writes a CNTK binary format file (version 2): the chunks are appended in order, then the header.
+class CBFWriter
+{
+public:
+    CBFWriter(const std::wstring& path, CBFCompression compression);
+
+    // Appends a chunk: the lengths of its sequences, the size of its data once decompressed and
+    // its data as stored, compressed with the codec of the file.
+    void WriteChunk(const std::vector<uint32_t>& sequenceLengths, uint32_t numSamples, uint64_t dataSize, const std::vector<char>& storedData);
+
+    // Writes the header, after the last chunk. 'inputs' holds the descriptions of 'numInputs' inputs.
+    void Finish(uint32_t numInputs, const std::vector<char>& inputs);
+
+    // Appends the description of an input, in the format read by BinaryChunkDeserializer.
+    static void AppendInput(std::vector<char>& inputs, MatrixEncodingType encoding, const std::string& name, DataType elementType, uint32_t sampleDimension);
+
+    CBFCompression Compression() const { return m_compression; }
+
+private:
+    FileWrapper m_file;
+    CBFCompression m_compression;
+    std::vector<BinaryChunkInfo> m_chunkTable;
+    std::vector<uint64_t> m_dataSizes;
+};
+
+// Converts data into the CNTK binary format. The output is a version 2 file with the data of every chunk
+// stored with the requested compression; 'level' is specific to the codec, negative for its default.
+class CBFConverter
+{
+public:
+    // Writes the CBF file 'input' as 'output', with the same inputs, chunks and sequences. The input can be
+    // of any version and compression, so files can be compressed, recompressed or decompressed.
+    static void Convert(const std::wstring& input, const std::wstring& output, CBFCompression compression, int level = -1);
+
+    // Checks that 'output' contains the same inputs and chunk data as 'input'.
+    static void Verify(const std::wstring& input, const std::wstring& output);
+
+    // Writes the sequences of 'source' as 'output', a chunk of the source becoming a chunk of the output.
+    // Each stream is stored in 'formats' (dense or sparse), whatever its format in the source. Chunks are
+    // loaded and encoded on 'numThreads' threads, so GetChunk() of the source must be thread-safe then.
+    // Sequences are stored in the order of the source and lose their keys: the binary format numbers them.
+    static void Convert(DataDeserializerPtr source, const std::vector<StorageFormat>& formats, const std::wstring& output,
+        CBFCompression compression, int level = -1, size_t numThreads = 1);
+
+private:
+    static std::vector<uint32_t> ReadSequenceLengths(BinaryChunkDeserializer& reader, uint32_t chunkId);
+
+    CBFConverter();
+};
+
+}
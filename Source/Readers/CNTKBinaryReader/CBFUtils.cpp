@@ -0,0 +1,111 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include <limits>
+#include "Basics.h"
+#include "FileWrapper.h"
+#include "CBFUtils.h"
+
+// zlib comes with the libzip installation that enables zip containers in the image reader.
+#ifdef USE_ZIP
+#include <zlib.h>
+#endif
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+
+#ifdef USE_ZIP
+static void CheckZlibSize(size_t size)
+{
+    if (size > std::numeric_limits<uLong>::max())
+        RuntimeError("The chunk size %zu exceeds the limit of the zlib codec.", size);
+}
+#endif
+
+/*static*/ void CBFUtils::Compress(CBFCompression compression, const void* data, size_t size, int level, std::vector<char>& result)
+{
+    switch (compression)
+    {
+    case CBFCompression::none:
+        result.assign((const char*)data, (const char*)data + size);
+        return;
+    case CBFCompression::zlib:
+    {
+#ifdef USE_ZIP
+        CheckZlibSize(size);
+        uLongf resultSize = compressBound((uLong)size);
+        result.resize(resultSize);
+        int status = compress2((Bytef*)result.data(), &resultSize, (const Bytef*)data, (uLong)size, level < 0 ? Z_DEFAULT_COMPRESSION : level);
+        if (status != Z_OK)
+            RuntimeError("zlib compression of a chunk failed with error %d.", status);
+        result.resize(resultSize);
+        return;
+#else
+        break;
+#endif
+    }
+    default:
+        RuntimeError("Unknown chunk compression %u.", (unsigned int)compression);
+    }
+
+    RuntimeError("The chunk compression '%ls' is not supported by this build.", CompressionName(compression));
+}
+
+/*static*/ void CBFUtils::Decompress(CBFCompression compression, const void* data, size_t size, void* result, size_t resultSize)
+{
+    switch (compression)
+    {
+    case CBFCompression::none:
+        if (size != resultSize)
+            RuntimeError("The stored chunk has %zu bytes, %zu were expected.", size, resultSize);
+        memcpy(result, data, size);
+        return;
+    case CBFCompression::zlib:
+    {
+#ifdef USE_ZIP
+        CheckZlibSize(size);
+        CheckZlibSize(resultSize);
+        uLongf actualSize = (uLongf)resultSize;
+        int status = uncompress((Bytef*)result, &actualSize, (const Bytef*)data, (uLong)size);
+        if (status != Z_OK || actualSize != resultSize)
+            RuntimeError("zlib decompression of a chunk failed with error %d (%zu of %zu bytes), the input may be corrupted.",
+                status, (size_t)actualSize, resultSize);
+        return;
+#else
+        break;
+#endif
+    }
+    default:
+        RuntimeError("Unknown chunk compression %u.", (unsigned int)compression);
+    }
+
+    RuntimeError("The chunk compression '%ls' is not supported by this build.", CompressionName(compression));
+}
+
+/*static*/ CBFCompression CBFUtils::ParseCompression(const std::wstring& name)
+{
+    if (name == L"none")
+        return CBFCompression::none;
+    if (name == L"zlib")
+        return CBFCompression::zlib;
+    InvalidArgument("Unknown chunk compression '%ls', expected 'none' or 'zlib'.", name.c_str());
+}
+
+/*static*/ const wchar_t* CBFUtils::CompressionName(CBFCompression compression)
+{
+    switch (compression)
+    {
+    case CBFCompression::none:
+        return L"none";
+    case CBFCompression::zlib:
+        return L"zlib";
+    default:
+        return L"unknown";
+    }
+}
+
+}
@@ -9,10 +9,28 @@
 #define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms  --add this at the top of all CPP files that give "function or variable may be unsafe" warnings
 #endif
 
+#include <vector>
+
 class FileWrapper;
 
 namespace CNTK {
 
+// Encoding of an input, recorded in the header before its description.
+enum class MatrixEncodingType : unsigned char
+{
+    dense = 0,
+    sparse_csc = 1,
+    // TODO: compressed_sparse_csc = 2, // indices are encoded as var-ints
+};
+
+// Codec of the data portion of the chunks, recorded in the header since version 2.
+// The sequence lengths that start each chunk are never compressed.
+enum class CBFCompression : uint32_t
+{
+    none = 0,
+    zlib = 1,
+};
+
 // Implementation of a helper class for reading binary files with FileWrapper class
 class CBFUtils
 {
@@ -46,6 +64,16 @@ public:
         return headerOffset;
     }
 
+    // Compresses 'size' bytes of 'data' into 'result'. 'level' is specific to the codec, negative for its default.
+    static void Compress(CBFCompression compression, const void* data, size_t size, int level, std::vector<char>& result);
+
+    // Decompresses 'size' bytes of 'data' into the 'resultSize' bytes of 'result', which must be filled exactly.
+    static void Decompress(CBFCompression compression, const void* data, size_t size, void* result, size_t resultSize);
+
+    static CBFCompression ParseCompression(const std::wstring& name);
+
+    static const wchar_t* CompressionName(CBFCompression compression);
+
 private:
     CBFUtils();
 };
@@ -13,6 +13,7 @@
 #include "NoRandomizer.h"
 #include "SequencePacker.h"
 #include "FramePacker.h"
+#include "ConfigUtil.h"
 
 namespace CNTK {
 
@@ -29,12 +30,23 @@ CNTKBinaryReader::CNTKBinaryReader(const ConfigParameters& config)
     log << "Initializing CNTKBinaryReader";
     try
     {
+        RemoteStorage::Configure(GetRemoteStorageParameters(config));
         m_deserializer = shared_ptr<DataDeserializer>(new BinaryChunkDeserializer(configHelper));
+        if (configHelper.UseMemoryMapping())
+            log << " | memory mapping the input file";
 
-        if (configHelper.ShouldKeepDataInMemory())
+        auto cacheParameters = GetChunkCacheParameters(config);
+        cacheParameters.m_sharedKey = configHelper.GetFilePath();
+        if (configHelper.ShouldKeepDataInMemory() || cacheParameters.IsBounded() || cacheParameters.IsShared())
         {
-            m_deserializer = shared_ptr<DataDeserializer>(new ChunkCache(m_deserializer));
-            log << " | keeping data in memory";
+            int verbosity = config(L"verbosity", 0);
+            m_deserializer = shared_ptr<DataDeserializer>(new ChunkCache(m_deserializer, cacheParameters, verbosity));
+            if (cacheParameters.IsShared())
+                log << " | sharing up to " << (cacheParameters.m_sharedSizeInBytes >> 20) << " MB of chunks on the host";
+            if (cacheParameters.IsBounded())
+                log << " | caching up to " << (cacheParameters.m_maxSizeInBytes >> 20) << " MB of chunks";
+            else if (!cacheParameters.IsShared())
+                log << " | keeping data in memory";
         }
 
         size_t window = configHelper.GetRandomizationWindow();
@@ -62,7 +74,8 @@ CNTKBinaryReader::CNTKBinaryReader(const ConfigParameters& config)
         }
 
         m_packer = std::make_shared<SequencePacker>( m_sequenceEnumerator,
-                                                    ReaderBase::GetStreamDescriptions());
+                                                    ReaderBase::GetStreamDescriptions(),
+                                                    GetPrefetchDepth(config) + 1);
     }
     catch (const std::runtime_error& e)
     {
@@ -6,13 +6,16 @@
 //
 
 #include "stdafx.h"
+#include <omp.h>
 #define DATAREADER_EXPORTS
 #include "DataReader.h"
 #include "ReaderShim.h"
 #include "CNTKBinaryReader.h"
 #include "V2Dependencies.h"
 #include "BinaryChunkDeserializer.h"
+#include "CBFConverter.h"
 #include "CorpusDescriptor.h"
+#include "StringUtil.h"
 
 namespace CNTK {
 
@@ -55,4 +58,69 @@ extern "C" DATAREADER_API bool CreateDeserializer(DataDeserializerPtr& deseriali
     return true;
 }
 
+// Re-encodes a CNTK binary format file with another chunk compression, implements the "convertCBF" action.
+// TODO: Not safe from the ABI perspective, same as CreateDeserializer.
+extern "C" DATAREADER_API void ConvertCBF(const ConfigParameters& config)
+{
+    wstring inputFile = config(L"inputFile");
+    wstring outputFile = config(L"outputFile");
+    wstring compression = config(L"compression", L"zlib");
+    int level = config(L"compressionLevel", -1);
+
+    CBFConverter::Convert(inputFile, outputFile, CBFUtils::ParseCompression(compression), level);
+
+    if (config(L"verify", true))
+        CBFConverter::Verify(inputFile, outputFile);
+}
+
+// Converts a file in the CNTK text format into the binary format, implements the "convertCTF" action.
+// The configuration is that of the text format deserializer, which parses the file, plus the output file,
+// the compression and, in the section of an input, the "binaryFormat" it is stored in (its "format" by default).
+// TODO: Not safe from the ABI perspective, same as CreateDeserializer.
+extern "C" DATAREADER_API void ConvertCTFToCBF(const ConfigParameters& config)
+{
+    typedef bool(*CreateDeserializerFactory) (DataDeserializerPtr& d, const std::wstring& type, const ConfigParameters& cfg, CorpusDescriptorPtr corpus, bool primary);
+
+    wstring outputFile = config(L"outputFile");
+    wstring compression = config(L"compression", L"none");
+    int level = config(L"compressionLevel", -1);
+
+    // Chunks are loaded concurrently, by as many parsers as there are threads.
+    size_t numThreads = config(L"numParserThreads", (size_t)omp_get_max_threads());
+    ConfigParameters textConfig = config;
+    textConfig.Insert("numParserThreads", std::to_string(numThreads));
+
+    // The text is parsed by the text format deserializer itself, the module stays loaded as for the readers.
+    static Plugin plugin;
+    std::string module = config(L"textFormatModule", "Cntk.Deserializers.TextFormat");
+    auto create = (CreateDeserializerFactory)plugin.Load(module, "CreateDeserializer");
+    DataDeserializerPtr source;
+    if (!create(source, L"CNTKTextFormatDeserializer", textConfig, make_shared<CorpusDescriptor>(false), true))
+        RuntimeError("Cannot create the text format deserializer of module '%s'.", module.c_str());
+
+    std::map<wstring, StorageFormat> binaryFormats;
+    const ConfigParameters& input = config(L"input");
+    for (const pair<string, ConfigParameters>& section : input)
+    {
+        ConfigParameters inputConfig = section.second;
+        if (!inputConfig.ExistsCurrent(L"binaryFormat"))
+            continue;
+
+        string format = inputConfig(L"binaryFormat");
+        if (!AreEqualIgnoreCase(format, "dense") && !AreEqualIgnoreCase(format, "sparse"))
+            InvalidArgument("'binaryFormat' of input '%s' must be either 'dense' or 'sparse'.", section.first.c_str());
+        binaryFormats[Microsoft::MSR::CNTK::ToFixedWStringFromMultiByte(section.first)] =
+            AreEqualIgnoreCase(format, "dense") ? StorageFormat::Dense : StorageFormat::SparseCSC;
+    }
+
+    std::vector<StorageFormat> formats;
+    for (const auto& stream : source->StreamInfos())
+    {
+        auto format = binaryFormats.find(stream.m_name);
+        formats.push_back(format == binaryFormats.end() ? stream.m_storageFormat : format->second);
+    }
+
+    CBFConverter::Convert(source, formats, outputFile, CBFUtils::ParseCompression(compression), level, numThreads);
+}
+
 }
@@ -13,6 +13,7 @@
 #include "TextParser.h"
 #include "SequencePacker.h"
 #include "FramePacker.h"
+#include "ConfigUtil.h"
 
 namespace CNTK {
 
@@ -28,14 +29,18 @@ CNTKTextFormatReader::CNTKTextFormatReader(const ConfigParameters& config)
 
     try
     {
+        RemoteStorage::Configure(GetRemoteStorageParameters(config));
         auto corpus = make_shared<CorpusDescriptor>(true);
         if (configHelper.GetDataType() == DataType::Float)
             m_deserializer = make_shared<TextParser<float>>(corpus, configHelper, true);
         else
             m_deserializer = make_shared<TextParser<double>>(corpus, configHelper, true);
 
-        if (configHelper.ShouldKeepDataInMemory())
-            m_deserializer = make_shared<ChunkCache>(m_deserializer);
+        // A bounded chunk cache is used even if the data is not meant to be kept in memory completely.
+        auto cacheParameters = GetChunkCacheParameters(config);
+        cacheParameters.m_sharedKey = configHelper.GetFilePath();
+        if (configHelper.ShouldKeepDataInMemory() || cacheParameters.IsBounded() || cacheParameters.IsShared())
+            m_deserializer = make_shared<ChunkCache>(m_deserializer, cacheParameters, config(L"verbosity", 0));
 
         size_t window = configHelper.GetRandomizationWindow();
         if (window > 0)
@@ -47,7 +52,8 @@ CNTKTextFormatReader::CNTKTextFormatReader(const ConfigParameters& config)
                                                                 /*multithreadedGetNextSequences =*/ false,
                                                                 /*maxNumberOfInvalidSequences =*/ 0,
                                                                 /*sampleBasedRandomizationWindow =*/ configHelper.UseSampleBasedRandomizationWindow(),
-                                                                /*seedOffset =*/ GetRandomSeed(config));
+                                                                /*seedOffset =*/ GetRandomSeed(config),
+                                                                /*maxNumberOfPrefetchedChunks =*/ configHelper.GetNumParserThreads());
         }
         else
         {
@@ -58,13 +64,15 @@ CNTKTextFormatReader::CNTKTextFormatReader(const ConfigParameters& config)
         {
             m_packer = std::make_shared<FramePacker>(
                 m_sequenceEnumerator,
-                ReaderBase::GetStreamDescriptions());
+                ReaderBase::GetStreamDescriptions(),
+                GetPrefetchDepth(config) + 1);
         }
         else
         {
             m_packer = std::make_shared<SequencePacker>(
                 m_sequenceEnumerator,
-                ReaderBase::GetStreamDescriptions());
+                ReaderBase::GetStreamDescriptions(),
+                GetPrefetchDepth(config) + 1);
         }
     }
     catch (const std::runtime_error& e)
@@ -0,0 +1,197 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Fast path for parsing the numbers of the CNTK text format: the end of a numeric token is located
+// with SSE2 (16 characters at a time), the token is then converted without the per-character state
+// machine of TextParser. Only the common, well-formed cases are handled; for everything else the
+// functions return false and the caller falls back to the regular parser, which also produces the
+// warnings for malformed input.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CNTK_FAST_NUMBER_PARSER_SSE2 1
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include "TextReaderConstants.h"
+
+namespace CNTK { namespace FastNumberParser {
+
+// Characters that cannot be part of a number and terminate a numeric token:
+// control characters and white space, non-ASCII bytes, the name prefix and the index delimiter.
+inline bool IsTokenTerminator(char c)
+{
+    return static_cast<signed char>(c) <= SPACE_CHAR || c == NAME_PREFIX || c == INDEX_DELIMITER;
+}
+
+// Returns the length of the token starting at 'data', or 'size' if no terminator was found.
+inline size_t FindTokenEnd(const char* data, size_t size)
+{
+    size_t i = 0;
+#ifdef CNTK_FAST_NUMBER_PARSER_SSE2
+    // The comparison is signed, so that non-ASCII bytes count as terminators just like in IsTokenTerminator().
+    const __m128i printable = _mm_set1_epi8(SPACE_CHAR + 1);
+    const __m128i namePrefix = _mm_set1_epi8(NAME_PREFIX);
+    const __m128i indexDelimiter = _mm_set1_epi8(INDEX_DELIMITER);
+    for (; i + 16 <= size; i += 16)
+    {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i terminators = _mm_or_si128(_mm_cmplt_epi8(block, printable),
+                                                 _mm_or_si128(_mm_cmpeq_epi8(block, namePrefix), _mm_cmpeq_epi8(block, indexDelimiter)));
+        const int mask = _mm_movemask_epi8(terminators);
+        if (mask != 0)
+        {
+#ifdef _MSC_VER
+            unsigned long first;
+            _BitScanForward(&first, mask);
+            return i + first;
+#else
+            return i + __builtin_ctz(mask);
+#endif
+        }
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        if (IsTokenTerminator(data[i]))
+            return i;
+    }
+    return size;
+}
+
+inline bool IsDecimalDigit(char c)
+{
+    return '0' <= c && c <= '9';
+}
+
+// Parses an unsigned decimal integer that occupies the complete range [begin, end).
+inline bool TryParseUint64(const char* begin, const char* end, size_t& value)
+{
+    // 19 digits always fit into 64 bits; leave longer numbers to the overflow checks of the regular parser.
+    if (begin == end || end - begin > 19)
+        return false;
+
+    uint64_t result = 0;
+    for (const char* p = begin; p != end; ++p)
+    {
+        if (!IsDecimalDigit(*p))
+            return false;
+        result = result * 10 + (*p - '0');
+    }
+    value = static_cast<size_t>(result);
+    return true;
+}
+
+// Parses a real number of the form [sign] digits [. [digits]] [(e|E) [sign] digits] that occupies
+// the complete range [begin, end). Succeeds only if the result can be computed exactly, i.e. if
+// the significant digits fit into the 53 bit mantissa of a double and the decimal exponent is
+// within the range of exactly representable powers of ten (Clinger's fast path). The result is
+// then correctly rounded, since it takes a single rounding step.
+inline bool TryParseReal(const char* begin, const char* end, double& value)
+{
+    static const double powersOfTen[] =
+    {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const int maxExactPowerOfTen = 22;
+    const int maxSignificantDigits = 19;
+    const uint64_t maxExactMantissa = uint64_t(1) << 53;
+
+    const char* p = begin;
+    bool negative = false;
+    if (p != end && (*p == '-' || *p == '+'))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int numSignificantDigits = 0;
+    int exponent = 0;
+
+    auto appendDigit = [&](char c) -> bool
+    {
+        if (mantissa == 0 && c == '0')
+            return true; // leading zeros are not significant
+        if (++numSignificantDigits > maxSignificantDigits)
+            return false;
+        mantissa = mantissa * 10 + (c - '0');
+        return true;
+    };
+
+    // The regular parser requires at least one digit in front of the period.
+    const char* integralBegin = p;
+    for (; p != end && IsDecimalDigit(*p); ++p)
+    {
+        if (!appendDigit(*p))
+            return false;
+    }
+    if (p == integralBegin)
+        return false;
+
+    if (p != end && *p == '.')
+    {
+        ++p;
+        const char* fractionBegin = p;
+        for (; p != end && IsDecimalDigit(*p); ++p)
+        {
+            if (!appendDigit(*p))
+                return false;
+            --exponent;
+        }
+
+        // "1.e5" stops the regular parser at the letter 'e', leave it to that parser.
+        if (p == fractionBegin && p != end)
+            return false;
+    }
+
+    if (p != end && (*p == 'e' || *p == 'E'))
+    {
+        ++p;
+        bool negativeExponent = false;
+        if (p != end && (*p == '-' || *p == '+'))
+        {
+            negativeExponent = (*p == '-');
+            ++p;
+        }
+
+        const char* exponentBegin = p;
+        int explicitExponent = 0;
+        for (; p != end && IsDecimalDigit(*p); ++p)
+        {
+            explicitExponent = explicitExponent * 10 + (*p - '0');
+            if (explicitExponent > 1000)
+                return false;
+        }
+        if (p == exponentBegin)
+            return false;
+
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+
+    if (p != end)
+        return false;
+
+    double result;
+    if (mantissa == 0)
+        result = 0.0;
+    else if (mantissa > maxExactMantissa || exponent > maxExactPowerOfTen || exponent < -maxExactPowerOfTen)
+        return false;
+    else if (exponent >= 0)
+        result = static_cast<double>(mantissa) * powersOfTen[exponent];
+    else
+        result = static_cast<double>(mantissa) / powersOfTen[-exponent];
+
+    value = negative ? -result : result;
+    return true;
+}
+
+}}
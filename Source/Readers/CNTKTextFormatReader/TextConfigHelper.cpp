@@ -125,9 +125,17 @@ TextConfigHelper::TextConfigHelper(const ConfigParameters& config)
     m_maxErrors = config(L"maxErrors", 0);
     m_traceLevel = config(L"traceLevel", 1);
     m_chunkSizeBytes = config(L"chunkSizeInBytes", g_32MB); // 32 MB by default
+    m_readBufferSizeBytes = config(L"readBufferSizeInBytes", g_2MB); // 2 MB by default
+    if (m_readBufferSizeBytes == 0)
+        InvalidArgument("readBufferSizeInBytes must be positive.");
+    m_readAhead = config(L"readAhead", true);
     m_keepDataInMemory = config(L"keepDataInMemory", false);
     m_frameMode = config(L"frameMode", false);
     m_cacheIndex = config(L"cacheIndex", false);
+    m_fastNumberParsing = config(L"fastNumberParsing", false);
+    m_numParserThreads = config(L"numParserThreads", (size_t)1);
+    if (m_numParserThreads == 0)
+        InvalidArgument("numParserThreads must be at least 1.");
 
     m_randomizationWindow = GetRandomizationWindowFromConfig(config);
     m_sampleBasedRandomizationWindow = config(L"sampleBasedRandomizationWindow", false);
@@ -33,12 +33,20 @@ public:
 
     bool ShouldCacheIndex() const { return m_cacheIndex; }
 
+    bool UseFastNumberParsing() const { return m_fastNumberParsing; }
+
+    size_t GetNumParserThreads() const { return m_numParserThreads; }
+
     unsigned int GetMaxAllowedErrors() const { return m_maxErrors; }
 
     unsigned int GetTraceLevel() const { return m_traceLevel; }
 
     size_t GetChunkSize() const { return m_chunkSizeBytes; }
 
+    size_t GetReadBufferSize() const { return m_readBufferSizeBytes; }
+
+    bool ShouldReadAhead() const { return m_readAhead; }
+
     bool ShouldKeepDataInMemory() const { return m_keepDataInMemory; }
 
     bool IsInFrameMode() const { return m_frameMode; }
@@ -59,10 +67,14 @@ private:
     unsigned int m_maxErrors;
     unsigned int m_traceLevel;
     size_t m_chunkSizeBytes; // chunks size in bytes
+    size_t m_readBufferSizeBytes; // size of the blocks in which the file is read
+    bool m_readAhead; // if true, the next block is read in the background while the current one is parsed
     bool m_keepDataInMemory; // if true the whole dataset is kept in memory
     bool m_frameMode; // if true, the maximum expected sequence length in the dataset is one sample.
     bool m_cacheIndex; // When true, the index will be loaded from a cache file it if exists.
                        // If cache does not exist, the index, once created, will be written out to a file.
+    size_t m_numParserThreads; // number of chunks that can be parsed concurrently.
+    bool m_fastNumberParsing; // if true, well-formed numbers are parsed by the vectorized fast path (see FastNumberParser.h).
 };
 
 }
@@ -11,6 +11,7 @@
 #include "IndexBuilder.h"
 #include "TextParser.h"
 #include "TextReaderConstants.h"
+#include "FastNumberParser.h"
 #include "File.h"
 
 #define isSign(c) ((c == '-' || c == '+'))
@@ -68,11 +69,15 @@ TextParser(corpus, helper.GetFilePath(), helper.GetStreams(), primary)
     SetTraceLevel(helper.GetTraceLevel());
     SetMaxAllowedErrors(helper.GetMaxAllowedErrors());
     SetChunkSize(helper.GetChunkSize());
+    SetReadBuffer(helper.GetReadBufferSize(), helper.ShouldReadAhead());
     SetSkipSequenceIds(helper.ShouldSkipSequenceIds());
 
     SetCacheIndex(helper.ShouldCacheIndex());
+    SetFastNumberParsing(helper.UseFastNumberParsing());
 
     Initialize();
+
+    SetNumParserThreads(helper.GetNumParserThreads());
 }
 
 // Internal, used for testing.
@@ -86,6 +91,8 @@ TextParser<ElemType>::TextParser(CorpusDescriptorPtr corpus, const std::wstring&
     m_streamInfos(streams.size()),
     m_index(nullptr),
     m_chunkSizeBytes(0),
+    m_readBufferSizeBytes(BUFFER_SIZE),
+    m_readAhead(true),
     m_traceLevel(TraceLevel::Error),
     m_hadWarnings(false),
     m_numAllowedErrors(0),
@@ -93,7 +100,9 @@ TextParser<ElemType>::TextParser(CorpusDescriptorPtr corpus, const std::wstring&
     m_numRetries(5),
     m_corpus(corpus),
     m_useMaximumAsSequenceLength(true),
-    m_cacheIndex(false)
+    m_cacheIndex(false),
+    m_useFastNumberParsing(false),
+    m_parent(nullptr)
 {
     assert(streams.size() > 0);
 
@@ -147,6 +156,28 @@ TextParser<ElemType>::TextParser(CorpusDescriptorPtr corpus, const std::wstring&
 template <class ElemType>
 TextParser<ElemType>::~TextParser() = default;
 
+template <class ElemType>
+TextParser<ElemType>::TextParser(TextParser* parent) :
+    TextParser(parent->m_corpus, parent->m_filename, parent->m_streamDescriptors, parent->m_primary)
+{
+    m_parent = parent;
+    m_traceLevel = parent->m_traceLevel;
+    m_skipSequenceIds = parent->m_skipSequenceIds;
+    m_chunkSizeBytes = parent->m_chunkSizeBytes;
+    m_readBufferSizeBytes = parent->m_readBufferSizeBytes;
+    m_readAhead = parent->m_readAhead;
+    m_numRetries = parent->m_numRetries;
+    m_useFastNumberParsing = parent->m_useFastNumberParsing;
+    m_index = parent->m_index;
+
+    attempt(m_numRetries, [this]()
+    {
+        m_file = std::make_shared<FileWrapper>(m_filename, L"rbS");
+        m_file->CheckIsOpenOrDie();
+        m_fileReader = std::make_shared<BufferedFileReader>(m_readBufferSizeBytes, *m_file, m_readAhead);
+    });
+}
+
 template <class ElemType>
 void TextParser<ElemType>::PrintWarningNotification()
 {
@@ -187,6 +218,8 @@ void TextParser<ElemType>::Initialize()
             .SetCorpus(m_corpus)
             .SetPrimary(m_primary)
             .SetChunkSize(m_chunkSizeBytes)
+            .SetBufferSize(m_readBufferSizeBytes)
+            .SetReadAhead(m_readAhead)
             .SetCachingEnabled(m_cacheIndex);
 
         if (!m_useMaximumAsSequenceLength)
@@ -198,7 +231,7 @@ void TextParser<ElemType>::Initialize()
 
         m_index = builder.Build();
 
-        m_fileReader = std::make_shared<BufferedFileReader>(BUFFER_SIZE, *m_file);
+        m_fileReader = std::make_shared<BufferedFileReader>(m_readBufferSizeBytes, *m_file, m_readAhead);
     });
 
     assert(m_index != nullptr);
@@ -242,6 +275,19 @@ void TextParser<ElemType>::SequenceInfosForChunk(ChunkIdType chunkId, std::vecto
     }
 }
 
+template <class ElemType>
+void TextParser<ElemType>::WillNeedChunks(const std::vector<ChunkIdType>& chunkIds)
+{
+    for (auto chunkId : chunkIds)
+    {
+        if (chunkId >= m_index->Chunks().size())
+            continue;
+
+        const auto& chunk = m_index->Chunks()[chunkId];
+        m_file->WillNeed(chunk.StartOffset(), chunk.SizeInBytes());
+    }
+}
+
 template <class ElemType>
 TextParser<ElemType>::TextDataChunk::TextDataChunk(TextParser* parser) :
     m_parser(parser)
@@ -260,6 +306,32 @@ void TextParser<ElemType>::TextDataChunk::GetSequence(size_t sequenceId, std::ve
 
 template <class ElemType>
 ChunkPtr TextParser<ElemType>::GetChunk(ChunkIdType chunkId)
+{
+    if (m_workers.empty())
+        return LoadChunk(chunkId);
+
+    TextParser<ElemType>* worker;
+    {
+        std::unique_lock<std::mutex> lock(m_workersMutex);
+        m_workerIdle.wait(lock, [this]() { return !m_idleWorkers.empty(); });
+        worker = m_idleWorkers.back();
+        m_idleWorkers.pop_back();
+    }
+
+    auto release = MakeScopeExit([this, worker]()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_workersMutex);
+            m_idleWorkers.push_back(worker);
+        }
+        m_workerIdle.notify_one();
+    });
+
+    return worker->LoadChunk(chunkId);
+}
+
+template <class ElemType>
+ChunkPtr TextParser<ElemType>::LoadChunk(ChunkIdType chunkId)
 {
     const auto& chunkDescriptor = m_index->Chunks()[chunkId];
     auto textChunk = make_shared<TextDataChunk>(this);
@@ -282,6 +354,9 @@ template <class ElemType>
 void TextParser<ElemType>::LoadChunk(TextChunkPtr& chunk, const ChunkDescriptor& descriptor)
 {
     chunk->m_sequenceMap.resize(descriptor.NumberOfSequences());
+
+    // Chunks are loaded in random order, the data that follows this one is most likely not needed next.
+    m_fileReader->SetReadAheadLimit(descriptor.StartOffset() + descriptor.SizeInBytes());
     for (size_t sequenceIndex = 0; sequenceIndex < descriptor.NumberOfSequences(); ++sequenceIndex)
     {
         const auto& sequenceDescriptor = descriptor.Sequences()[sequenceIndex];
@@ -292,6 +367,15 @@ void TextParser<ElemType>::LoadChunk(TextChunkPtr& chunk, const ChunkDescriptor&
 template <class ElemType>
 void TextParser<ElemType>::IncrementNumberOfErrorsOrDie()
 {
+    if (m_parent)
+    {
+        // Workers share the budget of the parser that owns them.
+        std::lock_guard<std::mutex> lock(m_parent->m_errorsMutex);
+        m_parent->m_hadWarnings = true;
+        m_parent->IncrementNumberOfErrorsOrDie();
+        return;
+    }
+
     if (m_numAllowedErrors == 0)
     {
         PrintWarningNotification();
@@ -897,9 +981,28 @@ void TextParser<ElemType>::SkipToNextInput(size_t& bytesToRead)
     }
 }
 
+template <class ElemType>
+bool TextParser<ElemType>::TryReadUint64Fast(size_t& value, size_t& bytesToRead)
+{
+    const char* data = m_fileReader->Current();
+    const size_t available = min(m_fileReader->Available(), bytesToRead);
+
+    // A token that reaches the end of the buffer might continue after a refill.
+    const size_t length = FastNumberParser::FindTokenEnd(data, available);
+    if (length == available || !FastNumberParser::TryParseUint64(data, data + length, value))
+        return false;
+
+    m_fileReader->Skip(length);
+    bytesToRead -= length;
+    return true;
+}
+
 template <class ElemType>
 bool TextParser<ElemType>::TryReadUint64(size_t& value, size_t& bytesToRead)
 {
+    if (m_useFastNumberParsing && TryReadUint64Fast(value, bytesToRead))
+        return true;
+
     value = 0;
     bool found = false;
     for (; bytesToRead && CanRead(); m_fileReader->Pop(), --bytesToRead)
@@ -968,6 +1071,9 @@ bool TextParser<ElemType>::TryReadUint64(size_t& value, size_t& bytesToRead)
 template <class ElemType>
 bool TextParser<ElemType>::TryReadRealNumber(ElemType& value, size_t& bytesToRead)
 {
+    if (m_useFastNumberParsing && TryReadRealNumberFast(value, bytesToRead))
+        return true;
+
     State state = State::Init;
     double coefficient = .0, number = .0, divider = .0;
     bool negative = false;
@@ -1196,6 +1302,24 @@ bool TextParser<ElemType>::TryReadRealNumber(ElemType& value, size_t& bytesToRea
     return false;
 }
 
+template <class ElemType>
+bool TextParser<ElemType>::TryReadRealNumberFast(ElemType& value, size_t& bytesToRead)
+{
+    const char* data = m_fileReader->Current();
+    const size_t available = min(m_fileReader->Available(), bytesToRead);
+
+    // A token that reaches the end of the buffer might continue after a refill.
+    const size_t length = FastNumberParser::FindTokenEnd(data, available);
+    double number;
+    if (length == available || !FastNumberParser::TryParseReal(data, data + length, number))
+        return false;
+
+    value = static_cast<ElemType>(number);
+    m_fileReader->Skip(length);
+    bytesToRead -= length;
+    return true;
+}
+
 template <class ElemType>
 void TextParser<ElemType>::SetTraceLevel(unsigned int traceLevel)
 {
@@ -1220,6 +1344,13 @@ void TextParser<ElemType>::SetChunkSize(size_t size)
     m_chunkSizeBytes = size;
 }
 
+template <class ElemType>
+void TextParser<ElemType>::SetReadBuffer(size_t size, bool readAhead)
+{
+    m_readBufferSizeBytes = size;
+    m_readAhead = readAhead;
+}
+
 template <class ElemType>
 void TextParser<ElemType>::SetNumRetries(unsigned int numRetries)
 {
@@ -1232,6 +1363,30 @@ void TextParser<ElemType>::SetCacheIndex(bool value)
     m_cacheIndex = value;
 }
 
+template <class ElemType>
+void TextParser<ElemType>::SetFastNumberParsing(bool value)
+{
+    m_useFastNumberParsing = value;
+}
+
+template <class ElemType>
+void TextParser<ElemType>::SetNumParserThreads(size_t numThreads)
+{
+    // Workers share the index, so they can only be created once it is built.
+    assert(m_index);
+
+    m_idleWorkers.clear();
+    m_workers.clear();
+    if (numThreads <= 1)
+        return;
+
+    for (size_t i = 0; i < numThreads; ++i)
+    {
+        m_workers.push_back(std::unique_ptr<TextParser<ElemType>>(new TextParser<ElemType>(this)));
+        m_idleWorkers.push_back(m_workers.back().get());
+    }
+}
+
 template<class ElemType>
 inline bool TextParser<ElemType>::CanRead()
 {
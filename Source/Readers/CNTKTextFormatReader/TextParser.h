@@ -10,6 +10,8 @@
 #include "TextConfigHelper.h"
 #include "Index.h"
 #include "CorpusDescriptor.h"
+#include <condition_variable>
+#include <mutex>
 
 namespace CNTK {
 
@@ -38,12 +40,22 @@ public:
 
     bool GetSequenceInfoByKey(const SequenceKey&, SequenceInfo&) override;
 
+    // Starts fetching the given chunks if the input is a remote file.
+    void WillNeedChunks(const std::vector<ChunkIdType>& chunkIds) override;
+
 private:
     TextParser(CorpusDescriptorPtr corpus, const std::wstring& filename, const vector<StreamDescriptor>& streams, bool primary = true);
 
+    // Creates a parser that loads chunks on behalf of 'parent' (see SetNumParserThreads()).
+    // It has its own file handle and buffer, but shares the index and settings of the parent.
+    explicit TextParser(TextParser* parent);
+
     // Builds an index of the input data.
     void Initialize();
 
+    // Loads the chunk with this parser's file reader.
+    ChunkPtr LoadChunk(ChunkIdType chunkId);
+
     struct DenseInputStreamBuffer : DenseSequenceData
     {
         // capacity = expected number of samples * sample size
@@ -128,17 +140,31 @@ private:
     bool m_useMaximumAsSequenceLength;
 
     size_t m_chunkSizeBytes;
+    size_t m_readBufferSizeBytes;
+    bool m_readAhead;
     unsigned int m_traceLevel;
     bool m_hadWarnings;
     unsigned int m_numAllowedErrors;
     bool m_skipSequenceIds;
     bool m_cacheIndex;
+    bool m_useFastNumberParsing;
     unsigned int m_numRetries; // specifies the number of times an unsuccessful
                                // file operation should be repeated (default value is 5).
 
     // Corpus descriptor.
     CorpusDescriptorPtr m_corpus;
 
+    // Parsers that load chunks concurrently. A chunk is loaded by the first idle one;
+    // without them, chunks are loaded by this parser (which is then not thread-safe).
+    std::vector<std::unique_ptr<TextParser<ElemType>>> m_workers;
+    std::vector<TextParser<ElemType>*> m_idleWorkers;
+    std::mutex m_workersMutex;
+    std::condition_variable m_workerIdle;
+
+    // The parser this one is a worker of, shares its budget of allowed errors.
+    TextParser<ElemType>* m_parent;
+    std::mutex m_errorsMutex;
+
     // throws runtime exception when number of parsing errors is
     // greater than the specified threshold
     void IncrementNumberOfErrorsOrDie();
@@ -162,6 +188,12 @@ private:
 
     bool TryReadUint64(size_t& value, size_t& bytesToRead);
 
+    // Fast paths of the two methods above (see FastNumberParser.h). They only consume input
+    // and return true for well-formed numbers that are completely contained in the file buffer.
+    bool TryReadRealNumberFast(ElemType& value, size_t& bytesToRead);
+
+    bool TryReadUint64Fast(size_t& value, size_t& bytesToRead);
+
     // Reads dense sample values into the provided vector.
     bool TryReadDenseSample(std::vector<ElemType>& values, size_t sampleSize, size_t& bytesToRead);
 
@@ -199,10 +231,19 @@ private:
 
     void SetChunkSize(size_t size);
 
+    // Sets the size of the blocks in which the file is read and whether the next block is read
+    // in the background. Must be called before the index is built.
+    void SetReadBuffer(size_t size, bool readAhead);
+
     void SetNumRetries(unsigned int numRetries);
 
     void SetCacheIndex(bool value);
 
+    void SetFastNumberParsing(bool value);
+
+    // Enables concurrent calls to GetChunk(), each parsing on one of 'numThreads' workers.
+    void SetNumParserThreads(size_t numThreads);
+
     friend class CNTKTextFormatReaderTestRunner<ElemType>;
 
     DISABLE_COPY_AND_MOVE(TextParser);
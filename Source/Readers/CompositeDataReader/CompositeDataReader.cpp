@@ -17,6 +17,7 @@
 #include "NoRandomizer.h"
 #include "FramePacker.h"
 #include "SequencePacker.h"
+#include "BucketingSequencePacker.h"
 #include "TruncatedBpttPacker.h"
 #include "CorpusDescriptor.h"
 #include "ConfigUtil.h"
@@ -35,8 +36,12 @@ using namespace Microsoft::MSR::CNTK;
 // For more information please see its header file.
 // This method composes together packers + randomizer + a set of transformers and deserializers.
 CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
-    m_truncationLength(0)
+    m_truncationLength(0),
+    m_bucketingWindow(0)
 {
+    // Applies to the remote input files of all deserializers.
+    RemoteStorage::Configure(GetRemoteStorageParameters(config));
+
     wstring action = config(L"action", L"");
     bool isActionWrite = AreEqualIgnoreCase(action, L"write");
 
@@ -82,6 +87,9 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
     else
     {
         m_packingMode = PackingMode::sequence;
+
+        // Sequences of similar length can be grouped to reduce the gaps in minibatches, see BucketingSequencePacker.
+        m_bucketingWindow = config(L"bucketingWindow", (size_t)0);
     }
 
     m_rightSplice = config(L"rightSplice", 0);
@@ -125,10 +133,13 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
         if (randomize)
         {
             bool sampleBasedRandomizationWindow = config(L"sampleBasedRandomizationWindow", false);
+
+            // User defined deserializers may not support concurrent loading of chunks, so it has to be enabled.
+            size_t maxPrefetchedChunks = config(L"maxPrefetchedChunks", (size_t)1);
             m_sequenceEnumerator = std::make_shared<LTTumblingWindowRandomizer>(deserializer,
                 sampleBasedRandomizationWindow, config(L"randomizationWindow", requestDataSize),
                 GetRandomSeed(config),
-                multiThreadedDeserialization, maxErrors);
+                multiThreadedDeserialization, maxErrors, maxPrefetchedChunks);
         }
         else
             m_sequenceEnumerator = std::make_shared<LTNoRandomizer>(deserializer, multiThreadedDeserialization, maxErrors);
@@ -184,9 +195,8 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
     // that input matches what the network expects (including tensor shape, etc.).
     std::vector<StreamInformation> outputStreams = m_sequenceEnumerator->GetStreamDescriptions();
 
-    // Currently for prefetch we use two alternating buffers,
-    // same is the default.
-    size_t numAlternatingBuffers = 2;
+    // For prefetch we use alternating buffers, one more than the number of prefetched minibatches.
+    size_t numAlternatingBuffers = GetPrefetchDepth(config) + 1;
 
     // Check whether to use local timeline, by default we use it for better performance.
     bool localTimeline = config(L"localTimeline", true);
@@ -201,12 +211,22 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
             m_corpus);
         break;
     case PackingMode::sequence:
-        m_packer = std::make_shared<SequencePacker>(
-            m_sequenceEnumerator,
-            outputStreams,
-            numAlternatingBuffers,
-            localTimeline,
-            m_corpus);
+        if (m_bucketingWindow > 0)
+            m_packer = std::make_shared<BucketingSequencePacker>(
+                m_sequenceEnumerator,
+                outputStreams,
+                m_bucketingWindow,
+                numAlternatingBuffers,
+                localTimeline,
+                m_corpus,
+                verbosity);
+        else
+            m_packer = std::make_shared<SequencePacker>(
+                m_sequenceEnumerator,
+                outputStreams,
+                numAlternatingBuffers,
+                localTimeline,
+                m_corpus);
         break;
     case PackingMode::truncated:
     {
@@ -96,6 +96,9 @@ private:
 
     // rightSplice(nr) for LC-BLSTM
     size_t m_rightSplice;
+
+    // Window of the bucketing sequence packer in samples, 0 if sequences are packed in randomized order.
+    size_t m_bucketingWindow;
 };
 
 }
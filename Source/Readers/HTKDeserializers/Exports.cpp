@@ -18,6 +18,9 @@
 #include "LatticeDeserializer.h"
 #include "MLFDeserializer.h"
 #include "MLFBinaryDeserializer.h"
+#include "MLFBinaryConverter.h"
+#include "KaldiFeatureDeserializer.h"
+#include "ConfigHelper.h"
 #include "StringUtil.h"
 #include "V2Dependencies.h"
 
@@ -75,6 +78,10 @@ extern "C" DATAREADER_API bool CreateDeserializer(DataDeserializerPtr& deseriali
     {
         deserializer = make_shared<MLFBinaryDeserializer>(corpus, deserializerConfig, primary);
     }
+    else if (type == L"KaldiFeatureDeserializer")
+    {
+        deserializer = make_shared<KaldiFeatureDeserializer>(corpus, deserializerConfig, primary);
+    }
     else
     {
         // Unknown type.
@@ -85,4 +92,20 @@ extern "C" DATAREADER_API bool CreateDeserializer(DataDeserializerPtr& deseriali
     return true;
 }
 
+// Converts text MLF files into a binary MLF, implements the "convertMLF" action.
+// TODO: Not safe from the ABI perspective, same as CreateDeserializer.
+extern "C" DATAREADER_API void ConvertMLFToBinary(const ConfigParameters& config)
+{
+    ConfigHelper helper(config);
+    wstring outputFile = config(L"outputFile");
+    wstring stateListPath = config(L"labelMappingFile", L"");
+    size_t chunkSizeInBytes = config(L"chunkSizeInBytes", 4 * g_1MB);
+
+    MLFBinaryConverter converter(helper.GetMlfPaths(), stateListPath, chunkSizeInBytes);
+    converter.Convert(outputFile);
+
+    if (config(L"verify", true))
+        converter.Verify(outputFile);
+}
+
 }
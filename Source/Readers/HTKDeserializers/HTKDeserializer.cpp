@@ -8,7 +8,11 @@
 #include "ConfigHelper.h"
 #include "Basics.h"
 #include "StringUtil.h"
+#include "IndexBuilder.h"
+#include "EnvironmentUtil.h"
 #include <unordered_set>
+#include <sstream>
+#include <thread>
 
 namespace CNTK {
 
@@ -116,31 +120,178 @@ void HTKDeserializer::InitializeAugmentationWindow(const std::pair<size_t, size_
     }
 }
 
-// Initializes chunks based on the configuration and utterance descriptions.
-void HTKDeserializer::InitializeChunkInfos(ConfigHelper& config)
+// Record of a script file line in the index cache.
+struct CachedUtterance
+{
+    uint64_t m_id;
+    uint32_t m_archivePathIndex; // index into the archive paths stored in the cache
+    uint32_t m_firstFrame;
+    uint32_t m_lastFrame;
+    uint8_t m_isArchive;
+    uint8_t m_isIdxFormat;
+};
+
+static const uint64_t s_scriptCacheMagic = 0x636e746b5f736370; // 'cntk_scp'
+static const uint64_t s_scriptCacheVersion = 1;
+
+// Reads the lines of the script file, writes the index cache if the cache file name is not empty.
+void HTKDeserializer::ReadScript(ConfigHelper& config, const wstring& cacheFilename, const string& cacheOptions,
+    const function<void(UtteranceDescription&&, const string&)>& addUtterance)
 {
     string scriptPath = config.GetScpFilePath();
     string rootPath = config.GetRootPath();
     string scpDir = config.GetScpDir();
 
-    fprintf(stderr, "Reading script file %s ...", scriptPath.c_str());
-
     ifstream scp(scriptPath.c_str());
     if (!scp)
         RuntimeError("Failed to open input file: %s", scriptPath.c_str());
 
+    // Only the first process on each node writes the cache.
+    bool writeCache = !cacheFilename.empty() && EnvironmentUtil::GetLocalMPINodeRank() == 0;
+
+    // Utterances and archive paths in the order of the script file, for the cache.
+    vector<CachedUtterance> cachedUtterances;
+    vector<unsigned int> archivePaths;
+    unordered_map<unsigned int, uint32_t> archivePathToCacheIndex;
+
+    string line, key;
+    while (getline(scp, line))
+    {
+        config.AdjustUtterancePath(rootPath, scpDir, line);
+        key.clear();
+
+        UtteranceDescription description(htkfeatreader::parsedpath::Parse(line, key));
+        description.SetId(m_corpus->KeyToId(key));
+
+        if (writeCache)
+        {
+            const auto& path = description.GetPath();
+            auto archivePath = archivePathToCacheIndex.insert(make_pair(path.archivePathIdx, (uint32_t)archivePaths.size()));
+            if (archivePath.second)
+                archivePaths.push_back(path.archivePathIdx);
+
+            CachedUtterance cached = {};
+            cached.m_id = description.GetId();
+            cached.m_archivePathIndex = archivePath.first->second;
+            cached.m_firstFrame = path.s;
+            cached.m_lastFrame = path.e;
+            cached.m_isArchive = path.isarchive;
+            cached.m_isIdxFormat = path.isidxformat;
+            cachedUtterances.push_back(cached);
+        }
+
+        addUtterance(move(description), key);
+    }
+
+    if (scp.bad())
+        RuntimeError("An error occurred while reading input file: %s", scriptPath.c_str());
+
+    if (!writeCache)
+        return;
+
+    // The archive paths follow the options, one per line.
+    vector<const string*> archivePathNames(htkfeatreader::parsedpath::archivePathStringVector.size());
+    for (const auto& archivePath : htkfeatreader::parsedpath::archivePathStringMap)
+        archivePathNames[archivePath.second] = &archivePath.first;
+
+    string extra = cacheOptions;
+    for (auto archivePath : archivePaths)
+        extra.append(*archivePathNames[archivePath]).push_back('\n');
+
+    // Similarly to IndexBuilder, the cache is written in the background.
+    thread([cacheFilename, scriptPath, cachedUtterances = move(cachedUtterances), extra = move(extra)]()
+    {
+        IndexCache::TryWrite(cacheFilename, ToFixedWStringFromMultiByte(scriptPath), s_scriptCacheMagic, s_scriptCacheVersion,
+            sizeof(CachedUtterance), cachedUtterances.size(),
+            [&cachedUtterances](FileWrapper& cache)
+            {
+                return cachedUtterances.empty() ||
+                    cache.TryWrite(cachedUtterances.data(), sizeof(CachedUtterance), cachedUtterances.size());
+            },
+            extra);
+    }).detach();
+}
+
+// Reads the lines of the script file from the index cache,
+// returns false if there is no cache or it does not match the script file and the options.
+bool HTKDeserializer::TryReadScriptCache(const wstring& cacheFilename, const string& scriptPath, const string& cacheOptions,
+    const function<void(UtteranceDescription&&, const string&)>& addUtterance)
+{
+    auto cache = IndexCache::TryOpen(cacheFilename, ToFixedWStringFromMultiByte(scriptPath),
+        s_scriptCacheMagic, s_scriptCacheVersion, sizeof(CachedUtterance));
+    if (!cache)
+        return false;
+
+    const char* extra = cache->Extra();
+    const char* extraEnd = extra + cache->ExtraSize();
+    if (cache->ExtraSize() < cacheOptions.size() || cacheOptions.compare(0, cacheOptions.size(), extra, cacheOptions.size()) != 0)
+        return false;
+
+    vector<unsigned int> archivePaths;
+    for (const char* begin = extra + cacheOptions.size(); begin < extraEnd;)
+    {
+        const char* end = find(begin, extraEnd, '\n');
+        archivePaths.push_back(htkfeatreader::parsedpath::RegisterArchivePath(string(begin, end)));
+        begin = end + 1;
+    }
+
+    for (size_t i = 0; i < cache->NumberOfRecords(); ++i)
+    {
+        if (cache->Record<CachedUtterance>(i).m_archivePathIndex >= archivePaths.size())
+            return false;
+    }
+
+    // Keys are not cached, they are only used in the report of duplicates.
+    const string key;
+    for (size_t i = 0; i < cache->NumberOfRecords(); ++i)
+    {
+        const auto& cached = cache->Record<CachedUtterance>(i);
+        htkfeatreader::parsedpath path;
+        path.s = cached.m_firstFrame;
+        path.e = cached.m_lastFrame;
+        path.archivePathIdx = archivePaths[cached.m_archivePathIndex];
+        path.isarchive = cached.m_isArchive != 0;
+        path.isidxformat = cached.m_isIdxFormat != 0;
+
+        UtteranceDescription description(move(path));
+        description.SetId(cached.m_id);
+        addUtterance(move(description), key);
+    }
+
+    return true;
+}
+
+// Initializes chunks based on the configuration and utterance descriptions.
+void HTKDeserializer::InitializeChunkInfos(ConfigHelper& config)
+{
+    string scriptPath = config.GetScpFilePath();
+
+    fprintf(stderr, "Reading script file %s ...", scriptPath.c_str());
+
+    // Ids can only be cached if they do not depend on the order in which the keys are seen.
+    wstring cacheFilename;
+    if (config.GetCacheIndex() && (m_corpus->IsNumericSequenceKeys() || m_corpus->IsHashingEnabled()))
+    {
+        wstringstream wss;
+        wss << ToFixedWStringFromMultiByte(scriptPath) << "."
+            << (m_corpus->IsNumericSequenceKeys() ? "1" : "0") << "."
+            << (m_corpus->IsHashingEnabled() ? std::to_wstring(CorpusDescriptor::s_hashVersion) : L"0") << "."
+            << L"v" << s_scriptCacheVersion << "."
+            << L"cache";
+        cacheFilename = wss.str();
+    }
+
+    // The archive paths depend on the prefix path and the location of the script file.
+    string cacheOptions = config.GetRootPath() + "\n" + config.GetScpDir() + "\n";
+
     deque<UtteranceDescription> utterances;
     size_t totalNumberOfFrames = 0;
     std::unordered_map<size_t, std::vector<string>> duplicates;
+    bool cached = false;
     {
         std::unordered_set<size_t> uniqueIds;
-        string line, key;
-        while (getline(scp, line))
+        auto addUtterance = [&](UtteranceDescription&& description, const string& key)
         {
-            config.AdjustUtterancePath(rootPath, scpDir, line);
-            key.clear();
-
-            UtteranceDescription description(htkfeatreader::parsedpath::Parse(line, key));
             size_t numberOfFrames = description.GetNumberOfFrames();
 
             if (m_expandToPrimary && numberOfFrames != 1)
@@ -150,8 +301,7 @@ void HTKDeserializer::InitializeChunkInfos(ConfigHelper& config)
             if (numberOfFrames <= m_maxSequenceSize)
             {
                 totalNumberOfFrames += numberOfFrames;
-                size_t id = m_corpus->KeyToId(key);
-                description.SetId(id);
+                size_t id = description.GetId();
                 if (uniqueIds.find(id) == uniqueIds.end())
                 {
                     utterances.push_back(std::move(description));
@@ -162,13 +312,14 @@ void HTKDeserializer::InitializeChunkInfos(ConfigHelper& config)
                     duplicates[id].push_back(key);
                 }
             }
-        }
-    }
+        };
 
-    if (scp.bad())
-        RuntimeError("An error occurred while reading input file: %s", scriptPath.c_str());
+        cached = !cacheFilename.empty() && TryReadScriptCache(cacheFilename, scriptPath, cacheOptions, addUtterance);
+        if (!cached)
+            ReadScript(config, cacheFilename, cacheOptions, addUtterance);
+    }
 
-    fprintf(stderr, " %zu entries\n", utterances.size());
+    fprintf(stderr, " %zu entries%s\n", utterances.size(), cached ? " (from index cache)" : "");
 
     // TODO: We should be able to configure IO chunks based on size.
     // distribute utterances over chunks
@@ -228,7 +379,10 @@ void HTKDeserializer::InitializeChunkInfos(ConfigHelper& config)
         {
             fprintf(stderr, "ID '%zu':\n", u.first);
             for (const auto& k : u.second)
-                fprintf(stderr, "Key '%s'\n", k.c_str());
+            {
+                if (!k.empty())
+                    fprintf(stderr, "Key '%s'\n", k.c_str());
+            }
         }
 
         numberOfDuplicates += (u.second.size() + 1);
@@ -345,31 +499,6 @@ void HTKDeserializer::SequenceInfosForChunk(ChunkIdType chunkId, vector<Sequence
     }
 }
 
-// A wrapper around a matrix that views it as a vector of column vectors.
-// Does not have any memory associated.
-class MatrixAsVectorOfVectors : boost::noncopyable
-{
-public:
-    MatrixAsVectorOfVectors(msra::dbn::matrixbase& m)
-        : m_matrix(m)
-    {
-    }
-
-    size_t size() const
-    {
-        return m_matrix.cols();
-    }
-
-    const_array_ref<float> operator[](size_t j) const
-    {
-        return array_ref<float>(&m_matrix(0, j), m_matrix.rows());
-    }
-
-private:
-    msra::dbn::matrixbase& m_matrix;
-};
-
-
 // Represents a chunk data in memory. Given up to the randomizer.
 // It is up to the randomizer to decide when to release a particular chunk.
 class HTKDeserializer::HTKChunk : public Chunk, boost::noncopyable
@@ -414,6 +543,7 @@ ChunkPtr HTKDeserializer::GetChunk(ChunkIdType chunkId)
 // A matrix that stores all samples of a sequence without padding (differently from ssematrix).
 // The number of columns equals the number of samples in the sequence.
 // The number of rows equals the size of the feature vector of a sample (= dimensions).
+template <class ElemType>
 class FeatureMatrix
 {
 public:
@@ -422,14 +552,14 @@ public:
         m_data.resize(m_numRows * m_numColumns);
     }
 
-    // Returns a reference to the column.
-    inline array_ref<float> col(size_t column)
+    // Returns a pointer to the column.
+    inline ElemType* col(size_t column)
     {
-        return array_ref<float>(m_data.data() + m_numRows * column, m_numRows);
+        return m_data.data() + m_numRows * column;
     }
 
     // Gets pointer to the data.
-    inline float* GetData()
+    inline ElemType* GetData()
     {
         return m_data.data();
     }
@@ -448,20 +578,21 @@ public:
 
 private:
     // Features
-    std::vector<float> m_data;
+    std::vector<ElemType> m_data;
     // Number of rows = dimension of the feature
     size_t m_numRows;
     // Number of columns = number of samples in utterance.
     size_t m_numColumns;
 };
 
-// This class stores sequence data for HTK for floats.
-struct HTKFloatSequenceData : DenseSequenceData
+// This class stores sequence data for HTK, in floats or doubles.
+template <class ElemType>
+struct HTKSequenceData : DenseSequenceData
 {
-    HTKFloatSequenceData(FeatureMatrix&& data, const NDShape& frameShape) : m_buffer(data), m_frameShape(frameShape)
+    HTKSequenceData(FeatureMatrix<ElemType>&& data, const NDShape& frameShape) : m_buffer(std::move(data)), m_frameShape(frameShape)
     {
-        m_numberOfSamples = (uint32_t)data.GetNumberOfColumns();
-        if (m_numberOfSamples != data.GetNumberOfColumns())
+        m_numberOfSamples = (uint32_t)m_buffer.GetNumberOfColumns();
+        if (m_numberOfSamples != m_buffer.GetNumberOfColumns())
         {
             RuntimeError("Maximum number of samples per sequence exceeded.");
         }
@@ -478,70 +609,50 @@ struct HTKFloatSequenceData : DenseSequenceData
     }
 
 private:
-    FeatureMatrix m_buffer;
-    const NDShape& m_frameShape;
-};
-
-// This class stores sequence data for HTK for doubles.
-struct HTKDoubleSequenceData : DenseSequenceData
-{
-    HTKDoubleSequenceData(FeatureMatrix& data, const NDShape& frameShape)
-        : m_buffer(data.GetData(), data.GetData() + data.GetTotalSize()),
-          m_frameShape(frameShape)
-    {
-        m_numberOfSamples = (uint32_t)data.GetNumberOfColumns();
-        if (m_numberOfSamples != data.GetNumberOfColumns())
-            RuntimeError("Maximum number of samples per sequence exceeded.");
-    }
-
-    const void* GetDataBuffer() override
-    {
-        return m_buffer.data();
-    }
-
-    const NDShape& GetSampleShape() override
-    {
-        return m_frameShape;
-    }
-
-private:
-    std::vector<double> m_buffer;
+    FeatureMatrix<ElemType> m_buffer;
     const NDShape& m_frameShape;
 };
 
-// Copies a source into a destination with the specified destination offset.
-static void CopyToOffset(const const_array_ref<float>& source, array_ref<float>& destination, size_t offset)
-{
-    size_t sourceSize = source.size() * sizeof(float);
-    memcpy_s((char*)destination.begin() + sourceSize * offset, sourceSize, &source.front(), sourceSize);
-}
-
-// TODO: Move augmentation to the separate class outside of deserializer.
 // TODO: Check the CNTK Book why different left and right extents are not supported.
-// Augments a frame with a given index with frames to the left and right of it.
-static void AugmentNeighbors(const MatrixAsVectorOfVectors& utterance,
+// Augments a frame with a given index with frames to the left and right of it, converting them to the
+// element type of the destination. Frames beyond the boundaries of the utterance are replaced with the first/last one.
+// When the whole window lies inside of the utterance and the frames are stored without padding, the window
+// is a contiguous range of the utterance and is copied at once.
+template <class ElemType>
+static void AugmentNeighbors(const msra::dbn::matrixstripe& utterance,
                              size_t frameIndex,
                              const size_t leftExtent,
                              const size_t rightExtent,
-                             array_ref<float>& destination)
+                             ElemType* destination)
 {
-    CopyToOffset(utterance[frameIndex], destination, leftExtent);
-
-    for (size_t currentFrame = frameIndex, n = 1; n <= leftExtent; n++)
+    const size_t dimension = utterance.rows();
+    const size_t numFrames = utterance.cols();
+    if (frameIndex >= leftExtent && frameIndex + rightExtent < numFrames && utterance.getcolstride() == dimension)
     {
-        if (currentFrame > 0)
-            currentFrame--; // index does not move beyond boundary
-        CopyToOffset(utterance[currentFrame], destination, leftExtent - n);
+        const float* window = &utterance(0, frameIndex - leftExtent);
+        std::copy(window, window + dimension * (leftExtent + 1 + rightExtent), destination);
+        return;
     }
 
-    for (size_t currentFrame = frameIndex, n = 1; n <= rightExtent; n++)
+    for (size_t n = 0; n <= leftExtent + rightExtent; n++)
     {
-        if (currentFrame + 1 < utterance.size())
-            currentFrame++; // index does not move beyond boundary
-        CopyToOffset(utterance[currentFrame], destination, leftExtent + n);
+        size_t currentFrame = frameIndex + n < leftExtent ? 0 : std::min(frameIndex + n - leftExtent, numFrames - 1);
+        const float* frame = &utterance(0, currentFrame);
+        std::copy(frame, frame + dimension, destination + dimension * n);
     }
 }
 
+// Expands the frames of the utterance with their context into a sequence with the given number of samples.
+template <class ElemType>
+SequenceDataPtr HTKDeserializer::CreateSequence(const msra::dbn::matrixstripe& utterance, size_t firstFrame, size_t numberOfSamples, bool repeatFrame)
+{
+    FeatureMatrix<ElemType> features(m_dimension, numberOfSamples);
+    for (size_t i = 0; i < numberOfSamples; ++i)
+        AugmentNeighbors(utterance, repeatFrame ? firstFrame : firstFrame + i, m_augmentationWindow.first, m_augmentationWindow.second, features.col(i));
+
+    return make_shared<HTKSequenceData<ElemType>>(std::move(features), m_streams.front().m_sampleLayout);
+}
+
 // Get a sequence by its chunk id and sequence id.
 // Sequence ids are guaranteed to be unique inside a chunk.
 void HTKDeserializer::GetSequenceById(ChunkIdType chunkId, size_t id, vector<SequenceDataPtr>& r)
@@ -555,14 +666,13 @@ void HTKDeserializer::GetSequenceById(ChunkIdType chunkId, size_t id, vector<Seq
     {
         fprintf(stderr, "HTKDeserializer::GetSequenceById: Reading features for utterance [%u,%u]\n", utterance->GetPath().s, utterance->GetPath().e);
     }
-    // wrapper that allows m[j].size() and m[j][i] as required by augmentneighbors()
-    MatrixAsVectorOfVectors utteranceFramesWrapper(utteranceFrames);
-
     size_t utteranceLength = utterance->GetNumberOfFrames();
+    size_t firstFrame = 0;
     if (m_frameMode)
     {
         // Always return a single frame only.
-        utteranceLength = 1; 
+        utteranceLength = 1;
+        firstFrame = id - chunkInfo.GetStartFrameIndexInsideChunk(utteranceIndex);
     }
     else if (m_expandToPrimary)
     {
@@ -573,29 +683,12 @@ void HTKDeserializer::GetSequenceById(ChunkIdType chunkId, size_t id, vector<Seq
         utteranceLength = r.front()->m_numberOfSamples;
     }
 
-    FeatureMatrix features(m_dimension, utteranceLength);
-    if (m_frameMode)
-    {
-        // For frame mode augment a single frame.
-        size_t frameIndex = id - chunkInfo.GetStartFrameIndexInsideChunk(utteranceIndex);
-        auto fillIn = features.col(0);
-        AugmentNeighbors(utteranceFramesWrapper, frameIndex, m_augmentationWindow.first, m_augmentationWindow.second, fillIn);
-    }
-    else
-    {
-        for (size_t resultingIndex = 0; resultingIndex < utteranceLength; ++resultingIndex)
-        {
-            auto fillIn = features.col(resultingIndex);
-            AugmentNeighbors(utteranceFramesWrapper, m_expandToPrimary ? 0 : resultingIndex, m_augmentationWindow.first, m_augmentationWindow.second, fillIn);
-        }
-    }
-
-    // Copy features to the sequence depending on the type.
-    DenseSequenceDataPtr result;
+    // Expand the features directly into the sequence depending on the type.
+    SequenceDataPtr result;
     if (m_elementType == DataType::Double)
-        result = make_shared<HTKDoubleSequenceData>(features, m_streams.front().m_sampleLayout);
+        result = CreateSequence<double>(utteranceFrames, firstFrame, utteranceLength, m_expandToPrimary);
     else if (m_elementType == DataType::Float)
-        result = make_shared<HTKFloatSequenceData>(std::move(features), m_streams.front().m_sampleLayout);
+        result = CreateSequence<float>(utteranceFrames, firstFrame, utteranceLength, m_expandToPrimary);
     else
         LogicError("Currently, HTK Deserializer supports only double and float types.");
 
@@ -47,9 +47,19 @@ private:
     void InitializeFeatureInformation();
     void InitializeAugmentationWindow(const std::pair<size_t, size_t>& augmentationWindow);
 
+    // Reading of the script file, either from the file or from its index cache.
+    void ReadScript(ConfigHelper& config, const std::wstring& cacheFilename, const std::string& cacheOptions,
+        const std::function<void(UtteranceDescription&&, const std::string&)>& addUtterance);
+    bool TryReadScriptCache(const std::wstring& cacheFilename, const std::string& scriptPath, const std::string& cacheOptions,
+        const std::function<void(UtteranceDescription&&, const std::string&)>& addUtterance);
+
     // Gets sequence by its chunk id and id inside the chunk.
     void GetSequenceById(ChunkIdType chunkId, size_t id, std::vector<SequenceDataPtr>&);
 
+    // Creates a sequence of the given element type from the frames of the utterance expanded with their context.
+    template <class ElemType>
+    SequenceDataPtr CreateSequence(const msra::dbn::matrixstripe& utterance, size_t firstFrame, size_t numberOfSamples, bool repeatFrame);
+
     // Dimension of features.
     size_t m_dimension;
 
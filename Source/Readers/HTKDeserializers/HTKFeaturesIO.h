@@ -23,6 +23,7 @@
 #include "simplesenonehmm.h"
 #include <array>
 #include <ReaderUtil.h>
+#include "RemoteStorage.h"
 
 namespace CNTK {
 
@@ -267,22 +268,25 @@ public:
                 }
             }
 
-            auto iter = archivePathStringMap.find(archivepath);
-            if (iter != archivePathStringMap.end())
-            {
-                result.archivePathIdx = iter->second;
-            }
-            else
-            {
-                result.archivePathIdx = (unsigned int)archivePathStringMap.size();
-                archivePathStringMap[archivepath] = result.archivePathIdx;
-                archivePathStringVector.push_back(Microsoft::MSR::CNTK::ToFixedWStringFromMultiByte(archivepath));
-            }
+            result.archivePathIdx = RegisterArchivePath(archivepath);
 
             logicalPath = logicalPath.substr(0, logicalPath.find_last_of("."));
             return result;
         }
 
+        // returns the index of the archive path in archivePathStringVector, adding it if it is new
+        static unsigned int RegisterArchivePath(const string& archivepath)
+        {
+            auto iter = archivePathStringMap.find(archivepath);
+            if (iter != archivePathStringMap.end())
+                return iter->second;
+
+            auto archivePathIdx = (unsigned int)archivePathStringMap.size();
+            archivePathStringMap[archivepath] = archivePathIdx;
+            archivePathStringVector.push_back(Microsoft::MSR::CNTK::ToFixedWStringFromMultiByte(archivepath));
+            return archivePathIdx;
+        }
+
         // get the physical path for 'make' test
         wstring physicallocation() const
         {
@@ -307,7 +311,7 @@ private:
     void openphysical(const parsedpath& ppath)
     {
         wstring physpath = ppath.physicallocation();
-        auto_file_ptr f2(fopenOrDie(physpath, L"rb")); // removed 'S' for now, as we mostly run local anyway, and this will speed up debugging
+        auto_file_ptr f2(RemoteStorage::OpenStreamOrDie(physpath, L"rb")); // removed 'S' for now, as we mostly run local anyway, and this will speed up debugging
 
         // read the header (12 bytes for htk feature files)
         fileheader H;
@@ -16,6 +16,7 @@
 #include "TruncatedBpttPacker.h"
 #include "BlockRandomizer.h"
 #include "NoRandomizer.h"
+#include "ConfigUtil.h"
 
 namespace CNTK {
 using namespace Microsoft::MSR::CNTK;
@@ -154,16 +155,17 @@ HTKMLFReader::HTKMLFReader(const ConfigParameters& readerConfig)
     // TODO: As the next step the packers will be moved out of the readers into the
     // TODO: core CNTK. They are format agnostic and can be used with any type of 
     // TODO: deserializers.
+    size_t numberOfBuffers = GetPrefetchDepth(readerConfig) + 1;
     switch (m_packingMode)
     {
     case PackingMode::sample:
-        m_packer = std::make_shared<FramePacker>(m_sequenceEnumerator, m_streams);
+        m_packer = std::make_shared<FramePacker>(m_sequenceEnumerator, m_streams, numberOfBuffers);
         break;
     case PackingMode::sequence:
-        m_packer = std::make_shared<SequencePacker>(m_sequenceEnumerator, m_streams);
+        m_packer = std::make_shared<SequencePacker>(m_sequenceEnumerator, m_streams, numberOfBuffers);
         break;
     case PackingMode::truncated:
-        m_packer = std::make_shared<TruncatedBPTTPacker>(m_sequenceEnumerator, m_streams);
+        m_packer = std::make_shared<TruncatedBPTTPacker>(m_sequenceEnumerator, m_streams, numberOfBuffers);
         break;
     default:
         LogicError("Unsupported type of packer '%d'.", (int)m_packingMode);
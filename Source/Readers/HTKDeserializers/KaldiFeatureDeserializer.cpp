@@ -0,0 +1,567 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "KaldiFeatureDeserializer.h"
+#include "Basics.h"
+#include "StringUtil.h"
+#include "ReaderConstants.h"
+#include "SequenceData.h"
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+// Global header of a compressed matrix, as written by Kaldi, without the format that is given by the token.
+struct KaldiCompressedHeader
+{
+    float m_minValue;
+    float m_range;
+    int32_t m_numRows;
+    int32_t m_numCols;
+};
+
+// Header of a column of a CM matrix, values of the 0th, 25th, 75th and 100th percentiles.
+struct KaldiColumnHeader
+{
+    uint16_t m_percentile[4];
+};
+
+class KaldiFeatureDeserializer::KaldiChunk : public Chunk
+{
+public:
+    KaldiChunk(const KaldiFeatureDeserializer& parent, ChunkIdType chunkId)
+        : m_parent(parent), m_descriptor(parent.m_chunks[chunkId])
+    {
+        const size_t elementSize = DataTypeSize(parent.m_elementType);
+        const size_t frameSize = parent.m_dimension * elementSize;
+
+        // Utterances that are not exposed in place are converted into a buffer of the chunk.
+        size_t convertedSize = 0;
+        for (size_t i = 0; i < m_descriptor.m_numUtterances; ++i)
+        {
+            const auto& utterance = parent.m_utterances[m_descriptor.m_firstUtterance + i];
+            if (!IsInPlace(utterance))
+                convertedSize += utterance.m_numFrames * frameSize;
+        }
+        m_converted = make_shared<vector<char>>(convertedSize);
+
+        size_t convertedOffset = 0;
+        m_data.reserve(m_descriptor.m_numUtterances);
+        for (size_t i = 0; i < m_descriptor.m_numUtterances; ++i)
+        {
+            const auto& utterance = parent.m_utterances[m_descriptor.m_firstUtterance + i];
+            if (IsInPlace(utterance))
+            {
+                const char* data = parent.m_archives[utterance.m_archive]->Data() + utterance.m_offset;
+                m_data.push_back(make_pair(data, shared_ptr<uint8_t>(parent.m_archives[utterance.m_archive], (uint8_t*)data)));
+                continue;
+            }
+
+            char* data = m_converted->data() + convertedOffset;
+            if (parent.m_elementType == DataType::Float)
+                parent.Decode(utterance, reinterpret_cast<float*>(data));
+            else
+                parent.Decode(utterance, reinterpret_cast<double*>(data));
+            m_data.push_back(make_pair(data, shared_ptr<uint8_t>(m_converted, (uint8_t*)data)));
+            convertedOffset += utterance.m_numFrames * frameSize;
+        }
+    }
+
+    void GetSequence(size_t sequenceIndex, vector<SequenceDataPtr>& result) override
+    {
+        const auto& stream = m_parent.m_streams.front();
+        const size_t frameSize = m_parent.m_dimension * DataTypeSize(m_parent.m_elementType);
+
+        size_t utteranceIndex = sequenceIndex, frame = 0;
+        unsigned int numberOfSamples;
+        if (m_parent.m_frameMode)
+        {
+            auto first = m_parent.m_utterances.begin() + m_descriptor.m_firstUtterance;
+            auto found = upper_bound(first, first + m_descriptor.m_numUtterances, sequenceIndex,
+                                     [](size_t index, const Utterance& u) { return index < u.m_firstFrameInChunk; });
+            utteranceIndex = (found - first) - 1;
+            frame = sequenceIndex - first[utteranceIndex].m_firstFrameInChunk;
+            numberOfSamples = 1;
+        }
+        else
+            numberOfSamples = m_parent.m_utterances[m_descriptor.m_firstUtterance + utteranceIndex].m_numFrames;
+
+        if (utteranceIndex >= m_descriptor.m_numUtterances || frame >= m_parent.m_utterances[m_descriptor.m_firstUtterance + utteranceIndex].m_numFrames)
+            LogicError("Sequence index %zu is out of range of the chunk.", sequenceIndex);
+
+        const auto& utterance = m_parent.m_utterances[m_descriptor.m_firstUtterance + utteranceIndex];
+        const auto& data = m_data[utteranceIndex];
+        auto sequence = make_shared<ExternalDenseSequenceData>(data.first + frame * frameSize, numberOfSamples, stream.m_sampleLayout);
+        sequence->m_elementType = stream.m_elementType;
+        sequence->m_key = SequenceKey { utterance.m_key, (unsigned int)frame };
+        sequence->m_holdingBuffer = data.second;
+        result.push_back(sequence);
+    }
+
+private:
+    bool IsInPlace(const Utterance& utterance) const
+    {
+        return (utterance.m_format == MatrixFormat::Float && m_parent.m_elementType == DataType::Float) ||
+               (utterance.m_format == MatrixFormat::Double && m_parent.m_elementType == DataType::Double);
+    }
+
+    const KaldiFeatureDeserializer& m_parent;
+    const ChunkDescriptor& m_descriptor;
+
+    // Frames of each utterance, with what keeps them alive: the mapping of the archive or m_converted.
+    vector<pair<const char*, shared_ptr<uint8_t>>> m_data;
+    shared_ptr<vector<char>> m_converted;
+};
+
+KaldiFeatureDeserializer::KaldiFeatureDeserializer(CorpusDescriptorPtr corpus, const ConfigParameters& cfg, bool primary)
+    : DataDeserializerBase(primary), m_corpus(corpus)
+{
+    m_frameMode = (ConfigValue)cfg("frameMode", "true");
+    m_verbosity = cfg(L"verbosity", 0);
+
+    ConfigParameters input = cfg(L"input");
+    auto inputName = input.GetMemberIds().front();
+    std::wstring precision = cfg(L"precision", L"float");
+    ConfigParameters streamConfig = input(inputName);
+
+    m_elementType = AreEqualIgnoreCase(precision, L"float") ? DataType::Float : DataType::Double;
+    m_dimension = streamConfig(L"dim");
+    m_maxSequenceSize = input(L"maxSequenceSize", SIZE_MAX);
+
+    wstring scriptPath = streamConfig(L"scpFile", L"");
+    wstring archivePath = streamConfig(L"arkFile", L"");
+    if (scriptPath.empty() == archivePath.empty())
+        InvalidArgument("KaldiFeatureDeserializer: Input '%ls' must have either an 'scpFile' or an 'arkFile'.", inputName.c_str());
+
+    // A chunk constitutes of 15 minutes, as for the HTK features.
+    const size_t FramesPerSec = 100;
+    Index(scriptPath, archivePath, cfg(L"chunkSizeInFrames", 15 * 60 * FramesPerSec));
+
+    StreamInformation stream;
+    stream.m_id = 0;
+    stream.m_name = inputName;
+    stream.m_sampleLayout = NDShape({ m_dimension });
+    stream.m_elementType = m_elementType;
+    stream.m_storageFormat = StorageFormat::Dense;
+    stream.m_definesMbSize = input(L"definesMBSize", false);
+    m_streams.push_back(stream);
+}
+
+const char* KaldiFeatureDeserializer::GetAddress(uint32_t archive, size_t offset, size_t size) const
+{
+    const auto& file = *m_archives[archive];
+    if (offset > file.Size() || size > file.Size() - offset)
+        RuntimeError("KaldiFeatureDeserializer: Unexpected end of archive '%ls' at offset %zu.", m_archivePaths[archive].c_str(), offset);
+    return file.Data() + offset;
+}
+
+size_t KaldiFeatureDeserializer::ParseMatrix(uint32_t archive, size_t offset, Utterance& utterance) const
+{
+    const char* marker = GetAddress(archive, offset, 2);
+    if (marker[0] != '\0' || marker[1] != 'B')
+        RuntimeError("KaldiFeatureDeserializer: No binary matrix at offset %zu of '%ls', only binary archives are supported.",
+                     offset, m_archivePaths[archive].c_str());
+    offset += 2;
+
+    // The token of the type, followed by a blank.
+    string token;
+    for (;; ++offset)
+    {
+        char c = *GetAddress(archive, offset, 1);
+        if (c == ' ')
+            break;
+        if (token.size() >= 3)
+            RuntimeError("KaldiFeatureDeserializer: Invalid matrix type at offset %zu of '%ls'.", offset, m_archivePaths[archive].c_str());
+        token.push_back(c);
+    }
+    offset++;
+
+    int32_t numRows, numCols;
+    if (token == "FM" || token == "DM")
+    {
+        // Rows and columns are each written as a byte with their size, followed by the value.
+        const char* header = GetAddress(archive, offset, 10);
+        if (header[0] != sizeof(int32_t) || header[5] != sizeof(int32_t))
+            RuntimeError("KaldiFeatureDeserializer: Invalid matrix header at offset %zu of '%ls'.", offset, m_archivePaths[archive].c_str());
+        memcpy(&numRows, header + 1, sizeof(numRows));
+        memcpy(&numCols, header + 6, sizeof(numCols));
+        offset += 10;
+
+        utterance.m_format = token == "FM" ? MatrixFormat::Float : MatrixFormat::Double;
+        utterance.m_size = (size_t)numRows * numCols * (token == "FM" ? sizeof(float) : sizeof(double));
+    }
+    else if (token == "CM" || token == "CM2" || token == "CM3")
+    {
+        KaldiCompressedHeader header;
+        memcpy(&header, GetAddress(archive, offset, sizeof(header)), sizeof(header));
+        numRows = header.m_numRows;
+        numCols = header.m_numCols;
+
+        size_t numValues = (size_t)max(numRows, 0) * max(numCols, 0);
+        if (token == "CM")
+        {
+            utterance.m_format = MatrixFormat::CompressedColumns;
+            utterance.m_size = sizeof(header) + numCols * sizeof(KaldiColumnHeader) + numValues;
+        }
+        else if (token == "CM2")
+        {
+            utterance.m_format = MatrixFormat::CompressedTwoBytes;
+            utterance.m_size = sizeof(header) + numValues * sizeof(uint16_t);
+        }
+        else
+        {
+            utterance.m_format = MatrixFormat::CompressedOneByte;
+            utterance.m_size = sizeof(header) + numValues;
+        }
+    }
+    else
+        RuntimeError("KaldiFeatureDeserializer: Unsupported matrix type '%s' at offset %zu of '%ls'.", token.c_str(), offset, m_archivePaths[archive].c_str());
+
+    if (numRows < 0 || numCols < 0)
+        RuntimeError("KaldiFeatureDeserializer: Invalid matrix size at offset %zu of '%ls'.", offset, m_archivePaths[archive].c_str());
+    if (numRows > 0 && (size_t)numCols != m_dimension)
+        RuntimeError("KaldiFeatureDeserializer: The matrix at offset %zu of '%ls' has dimension %d, expected %zu.",
+                     offset, m_archivePaths[archive].c_str(), (int)numCols, m_dimension);
+
+    GetAddress(archive, offset, utterance.m_size);
+    utterance.m_archive = archive;
+    utterance.m_offset = offset;
+    utterance.m_numFrames = (uint32_t)numRows;
+    return offset + utterance.m_size;
+}
+
+void KaldiFeatureDeserializer::Index(const wstring& scriptPath, const wstring& archivePath, size_t chunkSizeInFrames)
+{
+    unordered_map<wstring, uint32_t> archives;
+    auto getArchive = [this, &archives](const wstring& path)
+    {
+        auto found = archives.find(path);
+        if (found != archives.end())
+            return found->second;
+
+        uint32_t archive = (uint32_t)m_archives.size();
+        m_archives.push_back(make_shared<MemoryMappedFile>(path));
+        m_archivePaths.push_back(path);
+        archives[path] = archive;
+        return archive;
+    };
+
+    vector<Utterance> utterances;
+    size_t numberOfSkipped = 0;
+    unordered_set<size_t> keys;
+    auto add = [&](const string& key, Utterance& utterance)
+    {
+        utterance.m_key = m_corpus->KeyToId(key);
+        if (!keys.insert(utterance.m_key).second)
+        {
+            if (m_verbosity)
+                fprintf(stderr, "KaldiFeatureDeserializer: Skipping duplicate utterance '%s'.\n", key.c_str());
+            numberOfSkipped++;
+        }
+        else if (utterance.m_numFrames == 0 || utterance.m_numFrames > m_maxSequenceSize)
+            numberOfSkipped++;
+        else
+            utterances.push_back(utterance);
+    };
+
+    if (!scriptPath.empty())
+    {
+        ifstream script(Microsoft::MSR::CNTK::ToLegacyString(Microsoft::MSR::CNTK::ToUTF8(scriptPath)).c_str());
+        if (!script)
+            RuntimeError("KaldiFeatureDeserializer: Failed to open script file '%ls'.", scriptPath.c_str());
+
+        string line;
+        while (getline(script, line))
+        {
+            auto keyEnd = line.find_first_of(" \t");
+            auto pathStart = line.find_first_not_of(" \t", keyEnd);
+            auto pathEnd = line.find_last_not_of(" \t\r");
+            if (keyEnd == string::npos || pathStart == string::npos)
+            {
+                if (line.find_first_not_of(" \t\r") == string::npos)
+                    continue;
+                RuntimeError("KaldiFeatureDeserializer: Invalid line '%s' in '%ls', expected 'key archive:offset'.", line.c_str(), scriptPath.c_str());
+            }
+
+            string location = line.substr(pathStart, pathEnd - pathStart + 1);
+            auto colon = location.find_last_of(':');
+            if (colon == string::npos || colon + 1 == location.size() || location.find_first_not_of("0123456789", colon + 1) != string::npos)
+                RuntimeError("KaldiFeatureDeserializer: Unsupported location '%s' in '%ls', expected 'archive:offset' without ranges or pipes.",
+                             location.c_str(), scriptPath.c_str());
+
+            Utterance utterance = {};
+            uint32_t archive = getArchive(Microsoft::MSR::CNTK::ToFixedWStringFromMultiByte(location.substr(0, colon)));
+            ParseMatrix(archive, stoull(location.substr(colon + 1)), utterance);
+            add(line.substr(0, keyEnd), utterance);
+        }
+
+        if (script.bad())
+            RuntimeError("KaldiFeatureDeserializer: An error occurred while reading '%ls'.", scriptPath.c_str());
+    }
+    else
+    {
+        uint32_t archive = getArchive(archivePath);
+        const auto& file = *m_archives[archive];
+        size_t offset = 0;
+        while (offset < file.Size())
+        {
+            // Each entry is the key, a blank and the matrix.
+            const char* begin = file.Data() + offset;
+            const char* blank = (const char*)memchr(begin, ' ', file.Size() - offset);
+            if (blank == nullptr)
+                RuntimeError("KaldiFeatureDeserializer: Unexpected end of archive '%ls' at offset %zu.", archivePath.c_str(), offset);
+
+            Utterance utterance = {};
+            string key(begin, blank);
+            offset = ParseMatrix(archive, blank - file.Data() + 1, utterance);
+            add(key, utterance);
+
+            // Entries may be separated by new lines.
+            while (offset < file.Size() && isspace((unsigned char)file.Data()[offset]))
+                offset++;
+        }
+    }
+
+    // The matrices are read in the order of the archives, so that the reads of a chunk are close.
+    stable_sort(utterances.begin(), utterances.end(), [](const Utterance& a, const Utterance& b)
+    {
+        return a.m_archive != b.m_archive ? a.m_archive < b.m_archive : a.m_offset < b.m_offset;
+    });
+
+    size_t totalNumberOfFrames = 0;
+    for (auto& utterance : utterances)
+    {
+        if (m_chunks.empty() || m_chunks.back().m_numFrames > chunkSizeInFrames)
+        {
+            if (m_chunks.size() >= numeric_limits<ChunkIdType>::max())
+                RuntimeError("Number of chunks exceeded overflow limit.");
+            m_chunks.push_back(ChunkDescriptor { m_utterances.size(), 0, 0 });
+        }
+
+        auto& chunk = m_chunks.back();
+        if (!m_primary)
+            m_keyToChunkLocation.push_back(make_tuple(utterance.m_key, (ChunkIdType)(m_chunks.size() - 1), (uint32_t)chunk.m_numUtterances));
+
+        utterance.m_firstFrameInChunk = (uint32_t)chunk.m_numFrames;
+        chunk.m_numUtterances++;
+        chunk.m_numFrames += utterance.m_numFrames;
+        totalNumberOfFrames += utterance.m_numFrames;
+        m_utterances.push_back(utterance);
+    }
+
+    sort(m_keyToChunkLocation.begin(), m_keyToChunkLocation.end());
+
+    fprintf(stderr, "KaldiFeatureDeserializer: %zu utterances with %zu frames in %zu archives grouped into %zu chunks, %zu utterances skipped\n",
+            m_utterances.size(), totalNumberOfFrames, m_archives.size(), m_chunks.size(), numberOfSkipped);
+}
+
+template <class ElemType>
+void KaldiFeatureDeserializer::Decode(const Utterance& utterance, ElemType* result) const
+{
+    const char* data = m_archives[utterance.m_archive]->Data() + utterance.m_offset;
+    const size_t numRows = utterance.m_numFrames, numCols = m_dimension;
+
+    switch (utterance.m_format)
+    {
+    case MatrixFormat::Float:
+    case MatrixFormat::Double:
+        for (size_t i = 0; i < numRows * numCols; ++i)
+        {
+            if (utterance.m_format == MatrixFormat::Float)
+            {
+                float value;
+                memcpy(&value, data + i * sizeof(value), sizeof(value));
+                result[i] = (ElemType)value;
+            }
+            else
+            {
+                double value;
+                memcpy(&value, data + i * sizeof(value), sizeof(value));
+                result[i] = (ElemType)value;
+            }
+        }
+        break;
+
+    case MatrixFormat::CompressedColumns:
+    {
+        // Values are stored by column, each byte interpolating between the percentiles of its column.
+        KaldiCompressedHeader header;
+        memcpy(&header, data, sizeof(header));
+        const float increment = header.m_range * (1.0f / 65535.0f);
+        const char* columnHeaders = data + sizeof(header);
+        const uint8_t* values = (const uint8_t*)(columnHeaders + numCols * sizeof(KaldiColumnHeader));
+        for (size_t c = 0; c < numCols; ++c)
+        {
+            KaldiColumnHeader column;
+            memcpy(&column, columnHeaders + c * sizeof(column), sizeof(column));
+            float p0 = header.m_minValue + increment * column.m_percentile[0];
+            float p25 = header.m_minValue + increment * column.m_percentile[1];
+            float p75 = header.m_minValue + increment * column.m_percentile[2];
+            float p100 = header.m_minValue + increment * column.m_percentile[3];
+
+            const uint8_t* columnValues = values + c * numRows;
+            for (size_t r = 0; r < numRows; ++r)
+            {
+                uint8_t v = columnValues[r];
+                float value;
+                if (v <= 64)
+                    value = p0 + (p25 - p0) * v * (1 / 64.0f);
+                else if (v <= 192)
+                    value = p25 + (p75 - p25) * (v - 64) * (1 / 128.0f);
+                else
+                    value = p75 + (p100 - p75) * (v - 192) * (1 / 63.0f);
+                result[r * numCols + c] = (ElemType)value;
+            }
+        }
+        break;
+    }
+
+    case MatrixFormat::CompressedTwoBytes:
+    case MatrixFormat::CompressedOneByte:
+    {
+        // Values are stored by row, linearly between the minimum and the maximum of the matrix.
+        KaldiCompressedHeader header;
+        memcpy(&header, data, sizeof(header));
+        const char* values = data + sizeof(header);
+        if (utterance.m_format == MatrixFormat::CompressedTwoBytes)
+        {
+            const float increment = header.m_range * (1.0f / 65535.0f);
+            for (size_t i = 0; i < numRows * numCols; ++i)
+            {
+                uint16_t v;
+                memcpy(&v, values + i * sizeof(v), sizeof(v));
+                result[i] = (ElemType)(header.m_minValue + increment * v);
+            }
+        }
+        else
+        {
+            const float increment = header.m_range * (1.0f / 255.0f);
+            for (size_t i = 0; i < numRows * numCols; ++i)
+                result[i] = (ElemType)(header.m_minValue + increment * (uint8_t)values[i]);
+        }
+        break;
+    }
+    }
+}
+
+vector<ChunkInfo> KaldiFeatureDeserializer::ChunkInfos()
+{
+    vector<ChunkInfo> result;
+    result.reserve(m_chunks.size());
+    for (ChunkIdType i = 0; i < m_chunks.size(); ++i)
+    {
+        const auto& chunk = m_chunks[i];
+        result.push_back(ChunkInfo { i, chunk.m_numFrames, m_frameMode ? chunk.m_numFrames : chunk.m_numUtterances });
+    }
+    return result;
+}
+
+void KaldiFeatureDeserializer::SequenceInfosForChunk(ChunkIdType chunkId, vector<SequenceInfo>& result)
+{
+    const auto& chunk = m_chunks[chunkId];
+    result.reserve(result.size() + (m_frameMode ? chunk.m_numFrames : chunk.m_numUtterances));
+    size_t offsetInChunk = 0;
+    for (size_t i = 0; i < chunk.m_numUtterances; ++i)
+    {
+        const auto& utterance = m_utterances[chunk.m_firstUtterance + i];
+        SequenceInfo sequence = {};
+        sequence.m_chunkId = chunkId;
+        sequence.m_key.m_sequence = utterance.m_key;
+        if (m_frameMode)
+        {
+            // Because it is a frame mode, creating a sequence for each frame.
+            sequence.m_numberOfSamples = 1;
+            for (uint32_t k = 0; k < utterance.m_numFrames; ++k)
+            {
+                sequence.m_key.m_sample = k;
+                sequence.m_indexInChunk = offsetInChunk++;
+                result.push_back(sequence);
+            }
+        }
+        else
+        {
+            sequence.m_numberOfSamples = utterance.m_numFrames;
+            sequence.m_indexInChunk = offsetInChunk++;
+            result.push_back(sequence);
+        }
+    }
+}
+
+ChunkPtr KaldiFeatureDeserializer::GetChunk(ChunkIdType chunkId)
+{
+    if (chunkId >= m_chunks.size())
+        LogicError("KaldiFeatureDeserializer: Invalid chunk id %u.", (unsigned int)chunkId);
+    return make_shared<KaldiChunk>(*this, chunkId);
+}
+
+bool KaldiFeatureDeserializer::GetSequenceInfo(const SequenceInfo& primary, SequenceInfo& result)
+{
+    assert(!m_primary);
+    auto found = lower_bound(m_keyToChunkLocation.begin(), m_keyToChunkLocation.end(), make_tuple(primary.m_key.m_sequence, (ChunkIdType)0, (uint32_t)0));
+    if (found == m_keyToChunkLocation.end() || get<0>(*found) != primary.m_key.m_sequence)
+        return false;
+
+    ChunkIdType chunkId = get<1>(*found);
+    uint32_t utteranceIndexInsideChunk = get<2>(*found);
+    const auto& utterance = m_utterances[m_chunks[chunkId].m_firstUtterance + utteranceIndexInsideChunk];
+
+    result.m_chunkId = chunkId;
+    result.m_key = primary.m_key;
+    if (m_frameMode)
+    {
+        if (primary.m_key.m_sample >= utterance.m_numFrames)
+            RuntimeError("Sequence with key '%s' has '%d' frame(s), whereas the primary sequence expects at least '%d' frames",
+                         m_corpus->IdToKey(primary.m_key.m_sequence).c_str(), (int)utterance.m_numFrames, (int)primary.m_key.m_sample + 1);
+
+        result.m_numberOfSamples = 1;
+        result.m_indexInChunk = utterance.m_firstFrameInChunk + primary.m_key.m_sample;
+    }
+    else
+    {
+        result.m_numberOfSamples = utterance.m_numFrames;
+        result.m_indexInChunk = utteranceIndexInsideChunk;
+    }
+
+    return true;
+}
+
+void KaldiFeatureDeserializer::WillNeedChunks(const vector<ChunkIdType>& chunkIds)
+{
+    // The matrices of a chunk are mostly adjacent, so the ranges are merged per archive.
+    const size_t maxGap = 64 * 1024;
+    for (auto chunkId : chunkIds)
+    {
+        if (chunkId >= m_chunks.size())
+            continue;
+
+        const auto& chunk = m_chunks[chunkId];
+        size_t begin = 0, end = 0;
+        uint32_t archive = 0;
+        for (size_t i = 0; i <= chunk.m_numUtterances; ++i)
+        {
+            const Utterance* utterance = i < chunk.m_numUtterances ? &m_utterances[chunk.m_firstUtterance + i] : nullptr;
+            if (i > 0 && (utterance == nullptr || utterance->m_archive != archive || utterance->m_offset > end + maxGap))
+            {
+                m_archives[archive]->WillNeed(begin, end - begin);
+                if (utterance == nullptr)
+                    break;
+                begin = utterance->m_offset;
+            }
+            else if (i == 0)
+                begin = utterance->m_offset;
+
+            archive = utterance->m_archive;
+            end = utterance->m_offset + utterance->m_size;
+        }
+    }
+}
+
+}
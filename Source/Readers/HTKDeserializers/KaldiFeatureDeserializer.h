@@ -0,0 +1,101 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "DataDeserializerBase.h"
+#include "Config.h"
+#include "CorpusDescriptor.h"
+#include "MemoryMappedFile.h"
+#include <boost/noncopyable.hpp>
+
+namespace CNTK {
+
+// Deserializer for features in Kaldi binary archives, as written by copy-feats, so that Kaldi corpora can be
+// read by the composite reader with the chunking, randomization, prefetching and distributed decimation of
+// the HTK feature deserializer. The Kaldi libraries are not needed.
+//
+// The utterances are given either by a Kaldi script file, lines of 'key archive:offset', or by an archive
+// that is scanned once. The archives are memory mapped and only the headers of the matrices are read when
+// the deserializer is created; utterances are grouped into chunks of about 15 minutes as by the HTK
+// deserializer. Float matrices read as float are exposed where they are in the mapping, double and compressed
+// (CM, CM2, CM3) matrices are converted when the chunk is loaded, which happens on the prefetch threads.
+//   input = [ features = [ dim = 40 ; scpFile = "feats.scp" ] ]       # or arkFile = "feats.ark"
+class KaldiFeatureDeserializer : public DataDeserializerBase, private boost::noncopyable
+{
+public:
+    KaldiFeatureDeserializer(CorpusDescriptorPtr corpus, const Microsoft::MSR::CNTK::ConfigParameters& config, bool primary);
+
+    std::vector<ChunkInfo> ChunkInfos() override;
+
+    void SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& result) override;
+
+    ChunkPtr GetChunk(ChunkIdType chunkId) override;
+
+    bool GetSequenceInfo(const SequenceInfo& primary, SequenceInfo& result) override;
+
+    void WillNeedChunks(const std::vector<ChunkIdType>& chunkIds) override;
+
+private:
+    class KaldiChunk;
+
+    enum class MatrixFormat : uint8_t
+    {
+        Float,               // FM
+        Double,              // DM
+        CompressedColumns,   // CM, one byte per value with per column percentiles
+        CompressedTwoBytes,  // CM2
+        CompressedOneByte,   // CM3
+    };
+
+    struct Utterance
+    {
+        size_t m_key;
+        uint32_t m_archive;
+        MatrixFormat m_format;
+        uint32_t m_numFrames;
+        uint32_t m_firstFrameInChunk;
+        size_t m_offset; // of the values, or of the header of a compressed matrix
+        size_t m_size;
+    };
+
+    struct ChunkDescriptor
+    {
+        size_t m_firstUtterance;
+        size_t m_numUtterances;
+        size_t m_numFrames;
+    };
+
+    // Reads the script file, or scans the archive, and builds the chunks.
+    void Index(const std::wstring& scriptPath, const std::wstring& archivePath, size_t chunkSizeInFrames);
+
+    // Reads the header of the matrix at 'offset' of the archive. Returns the offset after the matrix.
+    size_t ParseMatrix(uint32_t archive, size_t offset, Utterance& utterance) const;
+
+    const char* GetAddress(uint32_t archive, size_t offset, size_t size) const;
+
+    // Converts the matrix of the utterance to the element type of the stream.
+    template <class ElemType>
+    void Decode(const Utterance& utterance, ElemType* result) const;
+
+    size_t m_dimension;
+    DataType m_elementType;
+    bool m_frameMode;
+    size_t m_maxSequenceSize;
+    int m_verbosity;
+
+    CorpusDescriptorPtr m_corpus;
+
+    std::vector<std::wstring> m_archivePaths;
+    std::vector<MemoryMappedFilePtr> m_archives;
+
+    std::vector<Utterance> m_utterances;
+    std::vector<ChunkDescriptor> m_chunks;
+
+    // <key, chunk, utterance inside the chunk>, sorted by key, for finding the sequences when not primary.
+    std::vector<std::tuple<size_t, ChunkIdType, uint32_t>> m_keyToChunkLocation;
+};
+
+}
@@ -0,0 +1,280 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "LatticeCompression.h"
+#include <stdint.h>
+#include <string.h>
+#include "Basics.h"
+#include "latticestorage.h"
+
+namespace CNTK {
+
+using namespace msra::lattices;
+
+namespace {
+
+static_assert(sizeof(nodeinfo) == 2 && sizeof(edgeinfo) == 8 && sizeof(aligninfo) == 4, "unexpected size of the lattice structures");
+
+// A serialized V2 lattice: "LAT " 2, the header, then tagged vectors of nodes, edges and alignment tokens, then "END ".
+const size_t TagSize = 4 + sizeof(int32_t);
+const size_t HeaderSize = 32;                  // sizeof(lattice::header_v1_v2)
+const size_t PrefixSize = TagSize + HeaderSize;
+const size_t HasAcScoresOffset = TagSize + 24; // 64 bit word with numframes, impliedspunitid and, as its top bit, hasacscores
+
+enum EncodingType : char
+{
+    Raw = 0,
+    Compact = 1,
+};
+
+void WriteVarint(std::vector<char>& output, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        output.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    output.push_back((char)value);
+}
+
+uint64_t ZigZag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+class Reader
+{
+public:
+    Reader(const char* begin, const char* end) : m_current(begin), m_end(end) {}
+
+    uint64_t Varint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (m_current == m_end)
+                break;
+
+            uint8_t byte = (uint8_t)*m_current++;
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+        RuntimeError("Corrupted compressed lattice.");
+    }
+
+    const char* Bytes(size_t size)
+    {
+        if ((size_t)(m_end - m_current) < size)
+            RuntimeError("Corrupted compressed lattice.");
+        const char* result = m_current;
+        m_current += size;
+        return result;
+    }
+
+private:
+    const char* m_current;
+    const char* m_end;
+};
+
+// Returns the number of elements of the vector with 'tag' at 'offset', or SIZE_MAX if it is not there.
+size_t VectorSize(const char* lattice, size_t size, size_t offset, const char* tag, size_t elementSize)
+{
+    int32_t count;
+    if (offset + TagSize > size || memcmp(lattice + offset, tag, 4) != 0)
+        return SIZE_MAX;
+
+    memcpy(&count, lattice + offset + 4, sizeof(count));
+    if (count < 0 || (size - offset - TagSize) / elementSize < (size_t)count)
+        return SIZE_MAX;
+    return (size_t)count;
+}
+
+class Writer
+{
+public:
+    Writer(char* begin, char* end) : m_current(begin), m_end(end) {}
+
+    void Bytes(const void* data, size_t size)
+    {
+        if ((size_t)(m_end - m_current) < size)
+            RuntimeError("Compressed lattice does not match its size.");
+        memcpy(m_current, data, size);
+        m_current += size;
+    }
+
+    void Tag(const char* tag, size_t count)
+    {
+        int32_t value = (int32_t)count;
+        Bytes(tag, 4);
+        Bytes(&value, sizeof(value));
+    }
+
+    bool IsFull() const { return m_current == m_end; }
+
+private:
+    char* m_current;
+    char* m_end;
+};
+
+// The alignment tokens of an edge are preceded by its scores, raw floats.
+size_t NumberOfScoreTokens(const char* prefix)
+{
+    uint64_t word;
+    memcpy(&word, prefix + HasAcScoresOffset, sizeof(word));
+    return (word >> 63) ? 2 : 1;
+}
+
+}
+
+/*static*/ void LatticeCompression::Encode(const char* lattice, size_t size, std::vector<char>& output)
+{
+    int32_t version = 0;
+    if (size >= PrefixSize)
+        memcpy(&version, lattice + 4, sizeof(version));
+
+    size_t nodesOffset = PrefixSize;
+    size_t numNodes = size >= PrefixSize && memcmp(lattice, "LAT ", 4) == 0 && version == 2 ?
+        VectorSize(lattice, size, nodesOffset, "NODS", sizeof(nodeinfo)) : SIZE_MAX;
+    size_t edgesOffset = nodesOffset + TagSize + numNodes * sizeof(nodeinfo);
+    size_t numEdges = numNodes != SIZE_MAX ? VectorSize(lattice, size, edgesOffset, "EDGS", sizeof(edgeinfo)) : SIZE_MAX;
+    size_t tokensOffset = edgesOffset + TagSize + numEdges * sizeof(edgeinfo);
+    size_t numTokens = numEdges != SIZE_MAX ? VectorSize(lattice, size, tokensOffset, "ALNS", sizeof(aligninfo)) : SIZE_MAX;
+    if (numTokens == SIZE_MAX)
+    {
+        output.push_back(EncodingType::Raw);
+        output.insert(output.end(), lattice, lattice + size);
+        return;
+    }
+
+    output.push_back(EncodingType::Compact);
+    output.insert(output.end(), lattice, lattice + PrefixSize);
+
+    WriteVarint(output, numNodes);
+    int64_t previous = 0;
+    for (size_t i = 0; i < numNodes; ++i)
+    {
+        nodeinfo node;
+        memcpy(&node, lattice + nodesOffset + TagSize + i * sizeof(node), sizeof(node));
+        WriteVarint(output, ZigZag((int64_t)node.t - previous));
+        previous = node.t;
+    }
+
+    WriteVarint(output, numEdges);
+    int64_t previousStart = 0, previousAlign = 0;
+    for (size_t i = 0; i < numEdges; ++i)
+    {
+        edgeinfo edge;
+        memcpy(&edge, lattice + edgesOffset + TagSize + i * sizeof(edge), sizeof(edge));
+        WriteVarint(output, ZigZag((int64_t)edge.S - previousStart));
+        WriteVarint(output, ZigZag((int64_t)edge.E - (int64_t)edge.S) << 2 | edge.implysp << 1 | edge.unused);
+        WriteVarint(output, ZigZag((int64_t)edge.firstalign - previousAlign));
+        previousStart = edge.S;
+        previousAlign = edge.firstalign;
+    }
+
+    WriteVarint(output, numTokens);
+    const size_t numScoreTokens = NumberOfScoreTokens(lattice);
+    size_t remainingScores = numScoreTokens;
+    for (size_t i = 0; i < numTokens; ++i)
+    {
+        const char* token = lattice + tokensOffset + TagSize + i * sizeof(aligninfo);
+        if (remainingScores > 0)
+        {
+            output.insert(output.end(), token, token + sizeof(aligninfo));
+            remainingScores--;
+            continue;
+        }
+
+        aligninfo align;
+        memcpy(&align, token, sizeof(align));
+        WriteVarint(output, (uint64_t)align.frames << 2 | align.unused << 1 | align.last);
+        WriteVarint(output, align.unit);
+        if (align.last)
+            remainingScores = numScoreTokens;
+    }
+
+    // The end tag and anything after it.
+    size_t tailOffset = tokensOffset + TagSize + numTokens * sizeof(aligninfo);
+    WriteVarint(output, size - tailOffset);
+    output.insert(output.end(), lattice + tailOffset, lattice + size);
+}
+
+/*static*/ void LatticeCompression::Decode(const char* encoded, size_t encodedSize, char* output, size_t size)
+{
+    Reader in(encoded, encoded + encodedSize);
+    Writer out(output, output + size);
+
+    if (*in.Bytes(1) == EncodingType::Raw)
+    {
+        out.Bytes(in.Bytes(size), size);
+        return;
+    }
+
+    const char* prefix = in.Bytes(PrefixSize);
+    out.Bytes(prefix, PrefixSize);
+
+    size_t numNodes = in.Varint();
+    out.Tag("NODS", numNodes);
+    int64_t previous = 0;
+    for (size_t i = 0; i < numNodes; ++i)
+    {
+        previous += UnZigZag(in.Varint());
+        nodeinfo node((size_t)previous);
+        out.Bytes(&node, sizeof(node));
+    }
+
+    size_t numEdges = in.Varint();
+    out.Tag("EDGS", numEdges);
+    int64_t previousStart = 0, previousAlign = 0;
+    for (size_t i = 0; i < numEdges; ++i)
+    {
+        int64_t start = previousStart + UnZigZag(in.Varint());
+        uint64_t endAndFlags = in.Varint();
+        int64_t firstAlign = previousAlign + UnZigZag(in.Varint());
+
+        edgeinfo edge((size_t)start, (size_t)(start + UnZigZag(endAndFlags >> 2)), (size_t)firstAlign);
+        edge.implysp = (endAndFlags >> 1) & 1;
+        edge.unused = endAndFlags & 1;
+        out.Bytes(&edge, sizeof(edge));
+        previousStart = start;
+        previousAlign = firstAlign;
+    }
+
+    size_t numTokens = in.Varint();
+    out.Tag("ALNS", numTokens);
+    const size_t numScoreTokens = NumberOfScoreTokens(prefix);
+    size_t remainingScores = numScoreTokens;
+    for (size_t i = 0; i < numTokens; ++i)
+    {
+        if (remainingScores > 0)
+        {
+            out.Bytes(in.Bytes(sizeof(aligninfo)), sizeof(aligninfo));
+            remainingScores--;
+            continue;
+        }
+
+        uint64_t framesAndFlags = in.Varint();
+        aligninfo align((size_t)in.Varint(), (size_t)(framesAndFlags >> 2));
+        align.unused = (framesAndFlags >> 1) & 1;
+        align.last = framesAndFlags & 1;
+        out.Bytes(&align, sizeof(align));
+        if (align.last)
+            remainingScores = numScoreTokens;
+    }
+
+    size_t tailSize = in.Varint();
+    out.Bytes(in.Bytes(tailSize), tailSize);
+    if (!out.IsFull())
+        RuntimeError("Compressed lattice does not match its size.");
+}
+
+}
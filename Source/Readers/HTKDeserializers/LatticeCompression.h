@@ -0,0 +1,29 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+namespace CNTK {
+
+// Compact in-memory encoding of serialized V2 lattices (as written to lattice archives, see latticearchive.h).
+// Node times and edge node/alignment indices are delta encoded, alignment units and durations are stored
+// as variable length integers, and the scores are kept as they are, so the decoded lattice is identical
+// byte for byte to the original. Lattices that cannot be parsed are stored unchanged.
+//
+// The lattice deserializer keeps the chunks in this form and decodes an utterance when its sequence is read.
+class LatticeCompression
+{
+public:
+    // Appends the encoding of the 'size' bytes of a serialized lattice to 'output'.
+    static void Encode(const char* lattice, size_t size, std::vector<char>& output);
+
+    // Decodes an encoded lattice of 'size' bytes into 'output', which must have room for them.
+    static void Decode(const char* encoded, size_t encodedSize, char* output, size_t size);
+};
+
+}
@@ -9,6 +9,7 @@
 #include "ConfigHelper.h"
 #include "Basics.h"
 #include "MLFUtils.h"
+#include "LatticeCompression.h"
 
 namespace CNTK {
 
@@ -48,10 +49,13 @@ protected:
     shared_ptr<vector<char>> m_pBuffer; // Ptr to the buffer for the whole chunk
     vector<bool> m_valid;    // Bit mask whether the parsed sequence is valid.
 
+    // When the lattices are compressed, m_pBuffer holds the encoded sequences at these offsets instead.
+    vector<size_t> m_encodedOffsets;
+
     const LatticeDeserializer& m_deserializer;
     const ChunkDescriptor& m_descriptor;     // Current chunk descriptor.
     int m_verbosity;
-    ChunkBase(const LatticeDeserializer& deserializer, const ChunkDescriptor& descriptor, const wstring& fileName, int verbosity):
+    ChunkBase(const LatticeDeserializer& deserializer, const ChunkDescriptor& descriptor, const wstring& fileName, int verbosity, bool compress):
         m_descriptor(descriptor),
         m_deserializer(deserializer),
         m_verbosity(verbosity)
@@ -79,7 +83,24 @@ protected:
 
         f.ReadOrDie(buffer.data(), sizeInBytes, 1);
 
-        m_pBuffer = make_shared<vector<char> >(move(buffer));
+        if (compress)
+        {
+            auto encoded = make_shared<vector<char>>();
+            m_encodedOffsets.reserve(descriptor.NumberOfSequences() + 1);
+            for (const auto& sequence : descriptor.Sequences())
+            {
+                m_encodedOffsets.push_back(encoded->size());
+                LatticeCompression::Encode(buffer.data() + sequence.OffsetInChunk(), sequence.SizeInBytes(), *encoded);
+            }
+            m_encodedOffsets.push_back(encoded->size());
+            encoded->shrink_to_fit();
+            m_pBuffer = encoded;
+
+            if (m_verbosity == 1)
+                fprintf(stderr, "Compressed lattice chunk from %zu to %zu bytes\n", sizeInBytes, m_pBuffer->size());
+        }
+        else
+            m_pBuffer = make_shared<vector<char> >(move(buffer));
 
         // all sequences are valid by default.
         m_valid.resize(m_descriptor.NumberOfSequences(), true);
@@ -96,8 +117,8 @@ class LatticeDeserializer::SequenceChunk : public LatticeDeserializer::ChunkBase
 {
 
 public:
-    SequenceChunk(const LatticeDeserializer& parent, const ChunkDescriptor& descriptor, const wstring& fileName, int verbosity)
-        : ChunkBase(parent, descriptor, fileName, verbosity), m_ndShape({ 1 })
+    SequenceChunk(const LatticeDeserializer& parent, const ChunkDescriptor& descriptor, const wstring& fileName, int verbosity, bool compress)
+        : ChunkBase(parent, descriptor, fileName, verbosity, compress), m_ndShape({ 1 })
     {
     }
 
@@ -115,7 +136,19 @@ public:
             fprintf(stderr, "Reading sequence '%s'...\n", KeyOf(sequence).c_str());
 
         // Deserialize the binary lattice graph and serialize it into a vector
-        SequenceDataPtr s = make_shared<LatticeFloatSequenceData>(m_pBuffer->data() + sequence.OffsetInChunk(), sequence.NumberOfSamples(), m_ndShape, m_pBuffer);
+        SequenceDataPtr s;
+        if (m_encodedOffsets.empty())
+        {
+            s = make_shared<LatticeFloatSequenceData>(m_pBuffer->data() + sequence.OffsetInChunk(), sequence.NumberOfSamples(), m_ndShape, m_pBuffer);
+        }
+        else
+        {
+            // Decode the lattice of this utterance only, padded with zeros to the whole number of floats it is exposed as.
+            auto decoded = make_shared<vector<char>>(sequence.NumberOfSamples() * sizeof(float), (char)0);
+            LatticeCompression::Decode(m_pBuffer->data() + m_encodedOffsets[sequenceIndex], m_encodedOffsets[sequenceIndex + 1] - m_encodedOffsets[sequenceIndex],
+                                       decoded->data(), sequence.SizeInBytes());
+            s = make_shared<LatticeFloatSequenceData>(decoded->data(), sequence.NumberOfSamples(), m_ndShape, decoded);
+        }
 
         result.push_back(s);
     }
@@ -130,6 +163,7 @@ LatticeDeserializer::LatticeDeserializer(
     bool primary)
     : DataDeserializerBase(primary),
       m_verbosity(0),
+      m_compressLattices(false),
       m_corpus(corpus)
 {
     if (primary)
@@ -138,6 +172,7 @@ LatticeDeserializer::LatticeDeserializer(
 
     m_verbosity = cfg(L"verbosity", 0);
     m_chunkSizeBytes = cfg(L"chunkSizeInBytes", g_64MB);
+    m_compressLattices = cfg(L"compressLattices", false);
 
     ConfigParameters input = cfg(L"input");
     auto inputName = input.GetMemberIds().front();
@@ -294,7 +329,7 @@ ChunkPtr LatticeDeserializer::GetChunk(ChunkIdType chunkId)
         auto chunk = m_chunks[chunkId];
         auto& fileName = m_latticeFiles[m_chunkToFileIndex[chunk]];
 
-        result = make_shared<SequenceChunk>(*this, *chunk, fileName, m_verbosity);
+        result = make_shared<SequenceChunk>(*this, *chunk, fileName, m_verbosity, m_compressLattices);
     });
 
     return result;
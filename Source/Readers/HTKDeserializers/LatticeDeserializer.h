@@ -49,6 +49,9 @@ private:
     // General configuration
     int m_verbosity;
 
+    // Keep the lattices of loaded chunks compressed and decode them per sequence (see LatticeCompression.h).
+    bool m_compressLattices;
+
     // Used to correlate a sequence key with the sequence inside the chunk when deserializer is running not in primary mode.
     // <key, chunkid, offset inside chunk>, sorted by key to be able to retrieve by binary search.
     std::vector<std::tuple<size_t, ChunkIdType, uint32_t>> m_keyToChunkLocation;
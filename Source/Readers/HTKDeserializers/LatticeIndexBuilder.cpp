@@ -70,7 +70,7 @@ namespace CNTK {
     {
         m_input.CheckIsOpenOrDie();
 
-        index->Reserve(filesize(m_input.File()));
+        index->Reserve(m_input.Filesize());
 
         if (m_latticeToc.size() == 0)
             RuntimeError("Lattice TOC is empty");
@@ -107,7 +107,7 @@ namespace CNTK {
                 if (byteOffset == 0)
                 {
                     // New chunk in the same toc file
-                    AddSequence(index, prevId, filesize(m_input.File()), prevSequenceStartOffset, seqKey);
+                    AddSequence(index, prevId, m_input.Filesize(), prevSequenceStartOffset, seqKey);
                 }
                 else 
                 { 
@@ -120,7 +120,7 @@ namespace CNTK {
             prevSequenceStartOffset = byteOffset;
         }
         if (m_lastChunkInTOC) {
-            AddSequence(index, prevId, filesize(m_input.File()), prevSequenceStartOffset, "last_sequence");
+            AddSequence(index, prevId, m_input.Filesize(), prevSequenceStartOffset, "last_sequence");
         }
     }
 
@@ -0,0 +1,232 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include <exception>
+#include <omp.h>
+#include "MLFBinaryConverter.h"
+#include "MLFIndexBuilder.h"
+#include "FileWrapper.h"
+
+namespace CNTK {
+
+    using namespace std;
+
+    MLFBinaryConverter::MLFBinaryConverter(const vector<wstring>& mlfPaths, const wstring& stateListPath, size_t chunkSizeInBytes)
+        : m_mlfPaths(mlfPaths),
+        m_chunkSizeInBytes(chunkSizeInBytes),
+        m_corpus(make_shared<CorpusDescriptor>(false))
+    {
+        if (m_mlfPaths.empty())
+            InvalidArgument("MLFBinaryConverter: no MLF files were specified.");
+
+        if (!stateListPath.empty())
+        {
+            m_stateTable = make_shared<StateTable>();
+            m_stateTable->ReadStateList(stateListPath);
+        }
+    }
+
+    // Runs body(i) for i in [0, count) on several threads, rethrowing the first exception on the calling thread.
+    template <class Body>
+    static void ParallelFor(size_t count, const Body& body)
+    {
+        exception_ptr error;
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < (int)count; ++i)
+        {
+            try
+            {
+                body((size_t)i);
+            }
+            catch (...)
+            {
+#pragma omp critical
+                if (!error)
+                    error = current_exception();
+            }
+        }
+
+        if (error)
+            rethrow_exception(error);
+    }
+
+    size_t MLFBinaryConverter::Convert(const wstring& outputPath)
+    {
+        auto output = FileWrapper::OpenOrDie(outputPath, L"wb");
+        output.WriteOrDie(MLF_BIN_LABEL.data(), sizeof(char), MLF_BIN_LABEL.size());
+        short version = 2;
+        output.WriteOrDie(&version, sizeof(version), 1);
+
+        m_fingerprints.clear();
+        size_t numberOfSkippedUtterances = 0;
+        for (const auto& path : m_mlfPaths)
+        {
+            fprintf(stderr, "MLFBinaryConverter: converting '%ls'\n", path.c_str());
+
+            MLFIndexBuilder builder(FileWrapper(path, L"rbS"), m_corpus);
+            builder.SetChunkSize(m_chunkSizeInBytes);
+            auto index = builder.Build();
+
+            // Chunks are converted in batches that keep all threads busy, and written in order.
+            const size_t batchSize = 2 * (size_t)omp_get_max_threads();
+            for (size_t begin = 0; begin < index->NumberOfChunks(); begin += batchSize)
+            {
+                vector<ConvertedChunk> batch(min(batchSize, index->NumberOfChunks() - begin));
+                ParallelFor(batch.size(), [&](size_t i) { ConvertChunk(path, (*index)[begin + i], batch[i]); });
+
+                for (const auto& chunk : batch)
+                {
+                    if (!chunk.m_data.empty())
+                        output.WriteOrDie(chunk.m_data.data(), sizeof(char), chunk.m_data.size());
+                    m_fingerprints.insert(m_fingerprints.end(), chunk.m_fingerprints.begin(), chunk.m_fingerprints.end());
+                    numberOfSkippedUtterances += chunk.m_numberOfSkippedUtterances;
+                }
+            }
+        }
+
+        output.FlushOrDie();
+
+        fprintf(stderr, "MLFBinaryConverter: wrote %zu utterances to '%ls'", m_fingerprints.size(), outputPath.c_str());
+        if (numberOfSkippedUtterances > 0)
+            fprintf(stderr, ", skipped %zu utterances that could not be parsed", numberOfSkippedUtterances);
+        fprintf(stderr, "\n");
+        return m_fingerprints.size();
+    }
+
+    template <class T>
+    static void Append(vector<char>& buffer, const T& value)
+    {
+        auto bytes = reinterpret_cast<const char*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    void MLFBinaryConverter::ConvertChunk(const wstring& path, const ChunkDescriptor& chunk, ConvertedChunk& result) const
+    {
+        auto f = FileWrapper::OpenOrDie(path, L"rbS");
+        vector<char> buffer(chunk.SizeInBytes() + 1);
+        buffer[chunk.SizeInBytes()] = 0;
+        f.SeekOrDie(chunk.StartOffset(), SEEK_SET);
+        f.ReadOrDie(buffer.data(), chunk.SizeInBytes(), 1);
+
+        MLFUtteranceParser parser(m_stateTable);
+        vector<MLFFrameRange> utterance;
+        vector<pair<ushort, ushort>> states;
+        for (const auto& sequence : chunk.Sequences())
+        {
+            auto key = m_corpus->IdToKey(sequence.m_key);
+            auto start = buffer.data() + sequence.OffsetInChunk();
+            auto absoluteOffset = chunk.StartOffset() + sequence.OffsetInChunk();
+            if (!parser.Parse(boost::make_iterator_range(start, start + sequence.SizeInBytes()), utterance, absoluteOffset))
+            {
+                fprintf(stderr, "WARNING: Cannot parse the utterance '%s'\n", key.c_str());
+                result.m_numberOfSkippedUtterances++;
+                continue;
+            }
+
+            if (key.size() > MAX_UTTERANCE_LABEL_LENGTH)
+                RuntimeError("Utterance label length is greater than limit %hu: %s", MAX_UTTERANCE_LABEL_LENGTH, key.c_str());
+
+            if (utterance.size() > numeric_limits<ushort>::max())
+                RuntimeError("Utterance '%s' has %zu state ranges, the binary MLF format supports at most %u.",
+                    key.c_str(), utterance.size(), (unsigned int)numeric_limits<ushort>::max());
+
+            states.clear();
+            for (const auto& range : utterance)
+            {
+                if (range.NumFrames() > numeric_limits<ushort>::max())
+                    RuntimeError("Utterance '%s' has a state range of %u frames, the binary MLF format supports at most %u.",
+                        key.c_str(), range.NumFrames(), (unsigned int)numeric_limits<ushort>::max());
+                states.push_back(make_pair((ushort)range.ClassId(), (ushort)range.NumFrames()));
+            }
+
+            uint numberOfFrames = utterance.back().FirstFrame() + utterance.back().NumFrames();
+
+            // Label, number of frames, number of state ranges and the ranges as (class id, number of frames) pairs.
+            Append(result.m_data, (ushort)key.size());
+            result.m_data.insert(result.m_data.end(), key.begin(), key.end());
+            Append(result.m_data, numberOfFrames);
+            Append(result.m_data, (ushort)states.size());
+            for (const auto& state : states)
+            {
+                Append(result.m_data, state.first);
+                Append(result.m_data, state.second);
+            }
+
+            result.m_fingerprints.push_back(Fingerprint(key, numberOfFrames, states));
+        }
+    }
+
+    void MLFBinaryConverter::Verify(const wstring& outputPath) const
+    {
+        auto corpus = make_shared<CorpusDescriptor>(false);
+        MLFBinaryIndexBuilder builder(FileWrapper(outputPath, L"rbS"), corpus);
+        auto index = builder.Build();
+
+        if (index->NumberOfSequences() != m_fingerprints.size())
+            RuntimeError("MLFBinaryConverter: '%ls' contains %zu utterances, %zu were written.",
+                outputPath.c_str(), index->NumberOfSequences(), m_fingerprints.size());
+
+        vector<size_t> firstSequence(index->NumberOfChunks() + 1, 0);
+        for (size_t i = 0; i < index->NumberOfChunks(); ++i)
+            firstSequence[i + 1] = firstSequence[i] + (*index)[i].NumberOfSequences();
+
+        ParallelFor(index->NumberOfChunks(), [&](size_t i)
+        {
+            const auto& chunk = (*index)[i];
+            auto f = FileWrapper::OpenOrDie(outputPath, L"rbS");
+            vector<char> buffer(chunk.SizeInBytes());
+            f.SeekOrDie(chunk.StartOffset(), SEEK_SET);
+            f.ReadOrDie(buffer.data(), chunk.SizeInBytes(), 1);
+
+            vector<pair<ushort, ushort>> states;
+            for (size_t j = 0; j < chunk.NumberOfSequences(); ++j)
+            {
+                const auto& sequence = chunk[j];
+                auto data = buffer.data() + sequence.OffsetInChunk();
+                ushort numberOfStates = *(ushort*)data;
+                data += sizeof(ushort);
+
+                states.resize(numberOfStates);
+                for (auto& state : states)
+                {
+                    state.first = *(ushort*)data;
+                    state.second = *(ushort*)(data + sizeof(ushort));
+                    data += 2 * sizeof(ushort);
+                }
+
+                auto key = corpus->IdToKey(sequence.m_key);
+                if (Fingerprint(key, sequence.NumberOfSamples(), states) != m_fingerprints[firstSequence[i] + j])
+                    RuntimeError("MLFBinaryConverter: utterance '%s' in '%ls' does not match the text MLF.", key.c_str(), outputPath.c_str());
+            }
+        });
+
+        fprintf(stderr, "MLFBinaryConverter: verified %zu utterances in '%ls'\n", m_fingerprints.size(), outputPath.c_str());
+    }
+
+    // FNV-1a hash of the content of an utterance.
+    /*static*/ uint64_t MLFBinaryConverter::Fingerprint(const string& key, uint32_t numberOfFrames, const vector<pair<ushort, ushort>>& states)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        auto add = [&hash](const void* data, size_t size)
+        {
+            for (size_t i = 0; i < size; ++i)
+            {
+                hash ^= static_cast<const unsigned char*>(data)[i];
+                hash *= 1099511628211ULL;
+            }
+        };
+
+        add(key.data(), key.size());
+        add(&numberOfFrames, sizeof(numberOfFrames));
+        for (const auto& state : states)
+        {
+            add(&state.first, sizeof(state.first));
+            add(&state.second, sizeof(state.second));
+        }
+        return hash;
+    }
+
+}
@@ -0,0 +1,54 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <boost/noncopyable.hpp>
+#include "MLFUtils.h"
+#include "MLFBinaryIndexBuilder.h"
+#include "ReaderConstants.h"
+
+namespace CNTK {
+
+    // Converts text MLF files into a single binary MLF (format version 2) as read by MLFBinaryDeserializer.
+    // Each text file is indexed with MLFIndexBuilder, then its chunks are parsed in parallel with MLFUtteranceParser
+    // and written in the order of the text files. State names are translated into class ids with the state list,
+    // as in MLFDeserializer. Utterances that cannot be parsed are skipped with a warning.
+    class MLFBinaryConverter : boost::noncopyable
+    {
+    public:
+        MLFBinaryConverter(const std::vector<std::wstring>& mlfPaths, const std::wstring& stateListPath, size_t chunkSizeInBytes = 4 * g_1MB);
+
+        // Writes the binary MLF, returns the number of utterances written.
+        size_t Convert(const std::wstring& outputPath);
+
+        // Reads back the binary MLF written by Convert() and checks that it contains the same utterances.
+        void Verify(const std::wstring& outputPath) const;
+
+    private:
+        // The utterances of a chunk of a text file in the binary format, with the fingerprints of their content.
+        struct ConvertedChunk
+        {
+            std::vector<char> m_data;
+            std::vector<uint64_t> m_fingerprints;
+            size_t m_numberOfSkippedUtterances = 0;
+        };
+
+        void ConvertChunk(const std::wstring& path, const ChunkDescriptor& chunk, ConvertedChunk& result) const;
+
+        static uint64_t Fingerprint(const std::string& key, uint32_t numberOfFrames, const std::vector<std::pair<ushort, ushort>>& states);
+
+        std::vector<std::wstring> m_mlfPaths;
+        StateTablePtr m_stateTable;
+        size_t m_chunkSizeInBytes;
+
+        // Keys of the utterances of the text files.
+        CorpusDescriptorPtr m_corpus;
+
+        // Fingerprints of the written utterances, in the order of the binary file.
+        std::vector<uint64_t> m_fingerprints;
+    };
+
+}
@@ -86,9 +86,9 @@ namespace CNTK {
     {
         m_input.CheckIsOpenOrDie();
 
-        index->Reserve(filesize(m_input.File()));
+        index->Reserve(m_input.Filesize());
 
-        BufferedFileReader reader(m_bufferSize, m_input);
+        BufferedFileReader reader(m_bufferSize, m_input, m_readAhead);
 
         if (reader.Empty())
             RuntimeError("Input file is empty");
@@ -21,12 +21,260 @@
 #ifdef LEAKDETECT
 #include <vld.h> // for memory leak detection
 #endif
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+// An utterance to write, with the output it is for.
+struct HTKFeatureWriteTask
+{
+    size_t m_output;
+    std::wstring m_path; // of the file, or the logical path in the archive
+    std::unique_ptr<msra::dbn::matrix> m_features;
+};
+
+// Writes the utterances on threads of its own, since the writes block on file I/O.
+// An output can be written into archives instead of a file per utterance: the utterances are appended to
+// '<archive>.<n>.htk', and '<archive>.scp' gets a line 'path=<archive>.<n>.htk[first,last]' for each of them,
+// as read by the HTK deserializers. All the utterances of an archive output are written by the same thread,
+// so that they stay in order.
+class HTKFeatureWriteQueue
+{
+    struct Archive
+    {
+        std::wstring m_prefix;
+        size_t m_dim;
+        size_t m_framesPerFile;
+        size_t m_fileIndex;
+        std::wstring m_path;
+        std::unique_ptr<msra::asr::htkfeatwriter> m_file;
+        size_t m_numFrames; // in m_file
+        FILE* m_script;
+    };
+
+public:
+    HTKFeatureWriteQueue(size_t numThreads, size_t maxQueuedBytes, unsigned int samplePeriod)
+        : m_samplePeriod(samplePeriod), m_maxQueuedBytes(maxQueuedBytes), m_queuedBytes(0), m_numBusy(0), m_nextThread(0), m_stop(false),
+          m_queues(numThreads)
+    {
+        for (size_t i = 0; i < numThreads; i++)
+            m_threads.emplace_back([this, i] { Run(i); });
+    }
+
+    ~HTKFeatureWriteQueue()
+    {
+        Finish();
+    }
+
+    void AddArchive(size_t output, const std::wstring& prefix, size_t dim, size_t framesPerFile)
+    {
+        if (m_archives.size() <= output)
+            m_archives.resize(output + 1);
+
+        auto archive = std::make_unique<Archive>();
+        archive->m_prefix = prefix;
+        archive->m_dim = dim;
+        archive->m_framesPerFile = framesPerFile;
+        archive->m_fileIndex = 0;
+        archive->m_numFrames = 0;
+        msra::files::make_intermediate_dirs(prefix);
+        archive->m_script = fopenOrDie(prefix + L".scp", L"w");
+        m_archives[output] = std::move(archive);
+    }
+
+    void Post(HTKFeatureWriteTask&& task)
+    {
+        size_t numBytes = task.m_features->rows() * task.m_features->cols() * sizeof(float);
+        bool isArchive = task.m_output < m_archives.size() && m_archives[task.m_output];
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_error.empty())
+            RuntimeError("HTKMLFWriter: %s", m_error.c_str());
+
+        // A caller that is faster than the disk waits here; an utterance bigger than the bound is taken alone.
+        m_done.wait(lock, [this, numBytes] { return m_queuedBytes == 0 || m_queuedBytes + numBytes <= m_maxQueuedBytes; });
+        m_queuedBytes += numBytes;
+        size_t thread = isArchive ? task.m_output % m_queues.size() : m_nextThread++ % m_queues.size();
+        m_queues[thread].push_back(std::move(task));
+        m_wakeUp.notify_all();
+    }
+
+    // Waits for the posted utterances, stops the threads and completes the archives.
+    // Returns the first error, if any.
+    std::string Finish()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [this] { return m_queuedBytes == 0 && m_numBusy == 0; });
+            m_stop = true;
+        }
+        m_wakeUp.notify_all();
+        for (auto& thread : m_threads)
+            thread.join();
+        m_threads.clear();
+
+        for (auto& archive : m_archives)
+        {
+            if (!archive)
+                continue;
+            try
+            {
+                CloseFile(*archive);
+                fcloseOrDie(archive->m_script);
+            }
+            catch (const std::exception& e)
+            {
+                if (m_error.empty())
+                    m_error = e.what();
+            }
+            archive.reset();
+        }
+
+        return m_error;
+    }
+
+private:
+    void Run(size_t thread)
+    {
+        for (;;)
+        {
+            HTKFeatureWriteTask task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wakeUp.wait(lock, [this, thread] { return m_stop || !m_queues[thread].empty(); });
+                if (m_queues[thread].empty())
+                    return;
+
+                task = std::move(m_queues[thread].front());
+                m_queues[thread].pop_front();
+                m_numBusy++;
+            }
+
+            std::string error;
+            try
+            {
+                Write(task);
+            }
+            catch (const std::exception& e)
+            {
+                error = e.what();
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!error.empty() && m_error.empty())
+                m_error = error;
+            m_queuedBytes -= task.m_features->rows() * task.m_features->cols() * sizeof(float);
+            m_numBusy--;
+            m_done.notify_all();
+        }
+    }
+
+    void Write(const HTKFeatureWriteTask& task)
+    {
+        const auto& output = *task.m_features;
+        const size_t nansinf = output.countnaninf();
+        if (nansinf > 0)
+            fprintf(stderr, "chunkeval: %d NaNs or INF detected in '%ls' (%d frames)\n", (int) nansinf, task.m_path.c_str(), (int) output.cols());
+
+        if (task.m_output < m_archives.size() && m_archives[task.m_output])
+        {
+            Append(*m_archives[task.m_output], task.m_path, output);
+            return;
+        }
+
+        // save it
+        msra::files::make_intermediate_dirs(task.m_path);
+        msra::util::attempt(5, [&]()
+                            {
+                                msra::asr::htkfeatwriter::write(task.m_path, "USER", m_samplePeriod, output);
+                            });
+
+        fprintf(stderr, "evaluate: writing %d frames of %ls\n", (int) output.cols(), task.m_path.c_str());
+    }
+
+    void Append(Archive& archive, const std::wstring& logicalPath, const msra::dbn::matrix& output)
+    {
+        const size_t numFrames = output.cols();
+        if (numFrames == 0)
+        {
+            fprintf(stderr, "evaluate: skipping '%ls' without frames, it cannot be referenced in an archive\n", logicalPath.c_str());
+            return;
+        }
+
+        // The frame count of the header is 32 bits, so the utterances are spread over several files.
+        if (archive.m_file && archive.m_numFrames + numFrames > archive.m_framesPerFile)
+            CloseFile(archive);
+
+        if (!archive.m_file)
+        {
+            archive.m_path = archive.m_prefix + L"." + std::to_wstring(archive.m_fileIndex++) + L".htk";
+            archive.m_file.reset(new msra::asr::htkfeatwriter(archive.m_path, "USER", archive.m_dim, m_samplePeriod));
+            archive.m_numFrames = 0;
+        }
+
+        std::vector<float> frame(output.rows());
+        for (size_t j = 0; j < numFrames; j++)
+        {
+            for (size_t i = 0; i < frame.size(); i++)
+                frame[i] = output(i, j);
+            archive.m_file->write(frame);
+        }
+
+        fprintfOrDie(archive.m_script, "%ls=%ls[%d,%d]\n", logicalPath.c_str(), archive.m_path.c_str(),
+                     (int) archive.m_numFrames, (int) (archive.m_numFrames + numFrames - 1));
+        archive.m_numFrames += numFrames;
+    }
+
+    // Writes the frame count into the header of the current file of the archive.
+    static void CloseFile(Archive& archive)
+    {
+        if (!archive.m_file)
+            return;
+
+        archive.m_file->close(archive.m_numFrames);
+        archive.m_file.reset();
+        fprintf(stderr, "evaluate: wrote %d frames to archive %ls\n", (int) archive.m_numFrames, archive.m_path.c_str());
+    }
+
+    const unsigned int m_samplePeriod;
+    const size_t m_maxQueuedBytes;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp; // a queue or m_stop changed
+    std::condition_variable m_done;   // an utterance was written
+    size_t m_queuedBytes;             // of the utterances still to write
+    size_t m_numBusy;                 // threads writing an utterance
+    size_t m_nextThread;
+    bool m_stop;
+    std::string m_error;              // first error
+    std::vector<std::deque<HTKFeatureWriteTask>> m_queues; // one for each thread
+    std::vector<std::unique_ptr<Archive>> m_archives;      // for each output, null if written into files
+    std::vector<std::thread> m_threads;
+};
+
 // Create a Data Writer
 //DATAWRITER_API IDataWriter* DataWriterFactory(void)
 
+template <class ElemType>
+HTKMLFWriter<ElemType>::HTKMLFWriter()
+    : m_tempArray(nullptr), m_tempArraySize(0)
+{
+}
+
+template <class ElemType>
+HTKMLFWriter<ElemType>::~HTKMLFWriter()
+{
+    if (m_writeQueue)
+    {
+        auto error = m_writeQueue->Finish();
+        if (!error.empty())
+            fprintf(stderr, "HTKMLFWriter: %s\n", error.c_str());
+    }
+    delete[] m_tempArray;
+}
+
 template <class ElemType>
 template <class ConfigRecordType>
 void HTKMLFWriter<ElemType>::InitFromConfig(const ConfigRecordType& writerConfig)
@@ -34,6 +282,9 @@ void HTKMLFWriter<ElemType>::InitFromConfig(const ConfigRecordType& writerConfig
     m_tempArray = nullptr;
     m_tempArraySize = 0;
 
+    vector<wstring> archives;
+    vector<size_t> framesPerArchive;
+
     vector<wstring> scriptpaths;
     vector<wstring> filelist;
     size_t numFiles;
@@ -58,6 +309,10 @@ void HTKMLFWriter<ElemType>::InitFromConfig(const ConfigRecordType& writerConfig
         else
             RuntimeError("HTKMLFWriter::Init: writer needs to specify scpFile for output");
 
+        // With an archive, the entries of the scpFile are the logical paths of the utterances.
+        archives.push_back(thisOutput(L"archive", L""));
+        framesPerArchive.push_back(thisOutput(L"framesPerArchive", (size_t) 4000000));
+
         outputNameToIdMap[outputNames[i]] = i;
         outputNameToDimMap[outputNames[i]] = udims[i];
         wstring type = thisOutput(L"type", "Real");
@@ -95,11 +350,30 @@ void HTKMLFWriter<ElemType>::InitFromConfig(const ConfigRecordType& writerConfig
     }
     outputFileIndex = 0;
     sampPeriod = 100000;
+
+    size_t numThreads = writerConfig(L"numWriterThreads", (size_t) 0);
+    if (numThreads == 0)
+        numThreads = std::min<size_t>(std::max<size_t>(std::thread::hardware_concurrency(), 1), 8);
+    size_t maxQueuedBytes = writerConfig(L"maxQueuedMB", (size_t) 256) * 1024 * 1024;
+    m_writeQueue.reset(new HTKFeatureWriteQueue(numThreads, maxQueuedBytes, sampPeriod));
+    foreach_index (i, archives)
+    {
+        if (!archives[i].empty())
+            m_writeQueue->AddArchive(i, archives[i], udims[i], framesPerArchive[i]);
+    }
 }
 
 template <class ElemType>
 void HTKMLFWriter<ElemType>::Destroy()
 {
+    if (m_writeQueue)
+    {
+        auto error = m_writeQueue->Finish();
+        m_writeQueue.reset();
+        if (!error.empty())
+            RuntimeError("HTKMLFWriter: %s", error.c_str());
+    }
+
     delete[] m_tempArray;
     m_tempArray = nullptr;
     m_tempArraySize = 0;
@@ -129,7 +403,7 @@ bool HTKMLFWriter<ElemType>::SaveData(size_t /*recordStart*/, const std::map<std
         assert(outputData.GetNumRows() == dim);
         dim;
 
-        Save(outFile, outputData);
+        Save(id, outFile, outputData);
     }
 
     outputFileIndex++;
@@ -138,10 +412,11 @@ bool HTKMLFWriter<ElemType>::SaveData(size_t /*recordStart*/, const std::map<std
 }
 
 template <class ElemType>
-void HTKMLFWriter<ElemType>::Save(std::wstring& outputFile, Matrix<ElemType>& outputData)
+void HTKMLFWriter<ElemType>::Save(size_t outputId, std::wstring& outputFile, Matrix<ElemType>& outputData)
 {
-    msra::dbn::matrix output;
-    output.resize(outputData.GetNumRows(), outputData.GetNumCols());
+    // The output is copied here, since the matrix is reused for the next minibatch.
+    std::unique_ptr<msra::dbn::matrix> output(new msra::dbn::matrix());
+    output->resize(outputData.GetNumRows(), outputData.GetNumCols());
     outputData.CopyToArray(m_tempArray, m_tempArraySize);
     ElemType* pValue = m_tempArray;
 
@@ -149,21 +424,11 @@ void HTKMLFWriter<ElemType>::Save(std::wstring& outputFile, Matrix<ElemType>& ou
     {
         for (int i = 0; i < outputData.GetNumRows(); i++)
         {
-            output(i, j) = (float) *pValue++;
+            (*output)(i, j) = (float) *pValue++;
         }
     }
 
-    const size_t nansinf = output.countnaninf();
-    if (nansinf > 0)
-        fprintf(stderr, "chunkeval: %d NaNs or INF detected in '%ls' (%d frames)\n", (int) nansinf, outputFile.c_str(), (int) output.cols());
-    // save it
-    msra::files::make_intermediate_dirs(outputFile);
-    msra::util::attempt(5, [&]()
-                        {
-                            msra::asr::htkfeatwriter::write(outputFile, "USER", this->sampPeriod, output);
-                        });
-
-    fprintf(stderr, "evaluate: writing %d frames of %ls\n", (int) output.cols(), outputFile.c_str());
+    m_writeQueue->Post(HTKFeatureWriteTask{ outputId, outputFile, std::move(output) });
 }
 
 template <class ElemType>
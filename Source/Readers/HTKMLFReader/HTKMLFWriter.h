@@ -8,10 +8,13 @@
 #include "DataWriter.h"
 #include "ScriptableObjects.h"
 #include <map>
+#include <memory>
 #include <vector>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+class HTKFeatureWriteQueue;
+
 template <class ElemType>
 class HTKMLFWriter : public IDataWriter
 {
@@ -25,10 +28,13 @@ private:
     std::map<std::wstring, size_t> outputNameToTypeMap;
     unsigned int sampPeriod;
     size_t outputFileIndex;
-    void Save(std::wstring& outputFile, Matrix<ElemType>& outputData);
+    void Save(size_t outputId, std::wstring& outputFile, Matrix<ElemType>& outputData);
     ElemType* m_tempArray;
     size_t m_tempArraySize;
 
+    // The files or archives are written in the background, SaveData() only copies the outputs.
+    std::unique_ptr<HTKFeatureWriteQueue> m_writeQueue;
+
     enum OutputTypes
     {
         outputReal,
@@ -36,6 +42,9 @@ private:
     };
 
 public:
+    HTKMLFWriter();
+    ~HTKMLFWriter();
+
     template <class ConfigRecordType>
     void InitFromConfig(const ConfigRecordType& writerConfig);
     virtual void Init(const ConfigParameters& config)
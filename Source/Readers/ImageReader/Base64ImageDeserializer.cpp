@@ -12,6 +12,7 @@
 #include "ReaderUtil.h"
 #include "Index.h"
 #include "IndexBuilder.h"
+#include "ImageUtil.h"
 
 namespace CNTK {
     using namespace Microsoft::MSR::CNTK;
@@ -105,15 +106,22 @@ namespace CNTK {
             while (currentSequence > imageStart &&  !IsBase64Char(*(currentSequence - 1)))
                 currentSequence--;
 
-            std::vector<char> decodedImage;
+            // The decoded bytes are only needed until the image is decoded, so each thread keeps reusing one buffer
+            // that grows to the largest image it has seen.
+            thread_local std::vector<char> decodedImage;
+            const size_t decodedSizeBound = Base64DecodedSizeBound(currentSequence - imageStart);
+            if (decodedImage.size() < decodedSizeBound)
+                decodedImage.resize(decodedSizeBound);
+
+            size_t decodedSize = 0;
             cv::Mat image;
-            if (!DecodeBase64(imageStart, currentSequence, decodedImage))
+            if (!DecodeBase64(imageStart, currentSequence, decodedImage.data(), decodedSize))
             {
                 fprintf(stderr, "WARNING: Cannot decode sequence with id %zu in the input file '%ls'\n", sequence.m_key, m_deserializer.m_fileName.c_str());
             }
             else
             {
-                image = cv::imdecode(decodedImage, m_deserializer.m_grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
+                image = DecodeImage((const unsigned char*)decodedImage.data(), decodedSize, m_deserializer.m_grayscale, m_deserializer.m_minDecodedSize);
             }
 
             m_deserializer.PopulateSequenceData(image, classId, copyId, { sequence.m_key, 0 }, result);
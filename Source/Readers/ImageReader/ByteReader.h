@@ -11,6 +11,7 @@
 #include <unordered_map>
 #include <memory>
 #include "ConcStack.h"
+#include "MemoryMappedFile.h"
 #endif
 
 namespace CNTK {
@@ -26,7 +27,13 @@ public:
     virtual void Register(const MultiMap& sequences) = 0;
     virtual cv::Mat Read(size_t seqId, const std::string& path, bool grayscale) = 0;
 
+    // Decode JPEG images at reduced resolution down to this size, see DecodeImage(); 0 for full resolution.
+    void SetMinDecodedSize(size_t minDecodedSize) { m_minDecodedSize = minDecodedSize; }
+
     DISABLE_COPY_AND_MOVE(ByteReader);
+
+protected:
+    size_t m_minDecodedSize = 0;
 };
 
 class FileByteReader : public ByteReader
@@ -42,6 +49,10 @@ public:
 };
 
 #ifdef USE_ZIP
+// Reads images from a zip container. The container is memory mapped and its central directory is parsed
+// once on registration, so that stored entries are decoded straight from the mapping and deflated entries
+// are inflated on the calling thread, without any shared state. Only entries with other compression methods
+// or encryption, and containers the central directory of which cannot be parsed, go through a pool of libzip handles.
 class ZipByteReader : public ByteReader
 {
 public:
@@ -54,9 +65,28 @@ private:
     using ZipPtr = std::unique_ptr<zip_t, void(*)(zip_t*)>;
     ZipPtr OpenZip();
 
+    struct ZipEntry
+    {
+        zip_uint64_t m_index;             // index of the entry for libzip
+        zip_uint64_t m_size;              // uncompressed size
+        zip_uint64_t m_compressedSize;
+        zip_uint64_t m_localHeaderOffset;
+        bool m_direct;                    // whether the entry can be read from the mapping
+        bool m_deflated;
+    };
+
+    // Parses the central directory of the mapped container; returns false if it is not understood.
+    bool TryReadCentralDirectory(std::unordered_map<std::string, ZipEntry>& entries) const;
+    void ReadCentralDirectoryWithLibzip(std::unordered_map<std::string, ZipEntry>& entries);
+
+    // Returns the data of a directly readable entry inside the mapping.
+    const unsigned char* GetEntryData(const ZipEntry& entry, const std::string& path) const;
+    void ReadWithLibzip(const ZipEntry& entry, size_t seqId, const std::string& path, std::vector<unsigned char>& contents);
+
     std::string m_zipPath;
+    MemoryMappedFilePtr m_mapping;
     Microsoft::MSR::CNTK::conc_stack<ZipPtr> m_zips;
-    std::unordered_map<size_t, std::pair<zip_uint64_t, zip_uint64_t>> m_seqIdToIndex;
+    std::unordered_map<size_t, ZipEntry> m_seqIdToEntry;
     Microsoft::MSR::CNTK::conc_stack<std::vector<unsigned char>> m_workspace;
 };
 #endif
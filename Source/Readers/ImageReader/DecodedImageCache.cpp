@@ -0,0 +1,152 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include <algorithm>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+#include "DecodedImageCache.h"
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+
+DecodedImageCacheParameters GetDecodedImageCacheParameters(const ConfigParameters& config)
+{
+    DecodedImageCacheParameters parameters;
+    parameters.m_maxSizeInBytes = config(L"decodedImageCacheSizeInMB", (size_t)0) << 20;
+    parameters.m_shortSide = config(L"decodedImageCacheShortSide", (size_t)0);
+    parameters.m_spillDirectory = (std::wstring)config(L"decodedImageCacheSpillDirectory", L"");
+    parameters.m_maxSpillSizeInBytes = config(L"decodedImageCacheSpillSizeInMB", (size_t)0) << 20;
+    return parameters;
+}
+
+DecodedImageCache::DecodedImageCache(const DecodedImageCacheParameters& parameters, int verbosity)
+    : m_parameters(parameters), m_verbosity(verbosity), m_bytesInMemory(0), m_bytesSpilled(0), m_numHits(0), m_numMisses(0)
+{
+    if (!m_parameters.IsEnabled())
+        InvalidArgument("DecodedImageCache: a memory budget is required.");
+
+    if (!m_parameters.m_spillDirectory.empty())
+    {
+        // The process id and the address of the cache keep several readers sharing a directory apart.
+        m_spillFileName = m_parameters.m_spillDirectory + L"/images_" + std::to_wstring(GetCurrentProcessId()) + L"_" +
+                          std::to_wstring(reinterpret_cast<uintptr_t>(this)) + L".bin";
+    }
+}
+
+DecodedImageCache::~DecodedImageCache()
+{
+    if (m_verbosity > 0)
+    {
+        fprintf(stderr, "DecodedImageCache: %zu hits, %zu misses, %zu images in memory (%zu MB), %zu images on disk (%zu MB).\n",
+                m_numHits, m_numMisses, m_images.size(), m_bytesInMemory >> 20, m_spilledImages.size(), m_bytesSpilled >> 20);
+    }
+
+    if (m_spillFile)
+    {
+        m_spillFile.reset();
+        _wunlink(m_spillFileName.c_str());
+    }
+}
+
+cv::Mat DecodedImageCache::Get(size_t id, const std::function<cv::Mat()>& decode)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Transforms may work in place, so the cached image is never handed out.
+        auto it = m_images.find(id);
+        if (it != m_images.end())
+        {
+            m_numHits++;
+            return it->second.clone();
+        }
+
+        auto spilled = m_spilledImages.find(id);
+        if (spilled != m_spilledImages.end())
+        {
+            m_numHits++;
+            return LoadSpilled(spilled->second);
+        }
+
+        m_numMisses++;
+    }
+
+    // Decoding is the expensive part, several images can be decoded concurrently.
+    cv::Mat image = decode();
+    if (!image.data || image.depth() != CV_8U)
+        return image;
+
+    image = Resize(image);
+    if (!image.isContinuous())
+        image = image.clone();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_images.find(id) != m_images.end() || m_spilledImages.find(id) != m_spilledImages.end())
+        return image; // decoded by another thread in the meantime
+
+    const size_t size = image.total() * image.elemSize();
+    if (m_bytesInMemory + size <= m_parameters.m_maxSizeInBytes)
+    {
+        m_images[id] = image.clone();
+        m_bytesInMemory += size;
+    }
+    else
+    {
+        TrySpill(id, image);
+    }
+    return image;
+}
+
+cv::Mat DecodedImageCache::Resize(const cv::Mat& image) const
+{
+    const int shortSide = std::min(image.rows, image.cols);
+    if (m_parameters.m_shortSide == 0 || shortSide <= (int)m_parameters.m_shortSide)
+        return image;
+
+    // The short side is fixed, the long side keeps the aspect ratio. Area interpolation avoids aliasing when shrinking.
+    const double scale = (double)m_parameters.m_shortSide / shortSide;
+    cv::Size size(std::max(1, (int)std::round(image.cols * scale)), std::max(1, (int)std::round(image.rows * scale)));
+    cv::Mat resized;
+    cv::resize(image, resized, size, 0, 0, cv::INTER_AREA);
+    return resized;
+}
+
+bool DecodedImageCache::TrySpill(size_t id, const cv::Mat& image)
+{
+    const size_t size = image.total() * image.elemSize();
+    if (m_spillFileName.empty() ||
+        (m_parameters.m_maxSpillSizeInBytes != 0 && m_bytesSpilled + size > m_parameters.m_maxSpillSizeInBytes))
+        return false;
+
+    if (!m_spillFile)
+        m_spillFile = std::make_unique<FileWrapper>(FileWrapper::OpenOrDie(m_spillFileName, L"w+b"));
+
+    // Images are appended to a single file, reads in between move the position.
+    SpilledImage spilled;
+    spilled.m_offset = (int64_t)m_bytesSpilled;
+    spilled.m_rows = image.rows;
+    spilled.m_cols = image.cols;
+    spilled.m_type = image.type();
+
+    m_spillFile->SeekOrDie(spilled.m_offset, SEEK_SET);
+    m_spillFile->WriteOrDie(image.data, sizeof(uchar), size);
+    m_spillFile->FlushOrDie();
+
+    m_spilledImages[id] = spilled;
+    m_bytesSpilled += size;
+    return true;
+}
+
+cv::Mat DecodedImageCache::LoadSpilled(const SpilledImage& spilled)
+{
+    cv::Mat image(spilled.m_rows, spilled.m_cols, spilled.m_type);
+    m_spillFile->SeekOrDie(spilled.m_offset, SEEK_SET);
+    m_spillFile->ReadOrDie(image.data, sizeof(uchar), image.total() * image.elemSize());
+    return image;
+}
+
+}
@@ -0,0 +1,81 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <opencv2/core/mat.hpp>
+#include "Config.h"
+#include "FileWrapper.h"
+
+namespace CNTK {
+
+// Bounds of the decoded image cache, all sizes in bytes. A memory budget of 0 disables the cache.
+struct DecodedImageCacheParameters
+{
+    size_t m_maxSizeInBytes = 0;      // memory budget for decoded images
+    size_t m_shortSide = 0;           // if not 0, images are scaled down to this short side before they are cached
+    std::wstring m_spillDirectory;    // if not empty, images beyond the memory budget are stored in a file here
+    size_t m_maxSpillSizeInBytes = 0; // disk budget of the spill tier, 0 means unbounded
+
+    bool IsEnabled() const { return m_maxSizeInBytes != 0; }
+};
+
+// Reads the decoded image cache parameters (reader config "decodedImageCacheSizeInMB",
+// "decodedImageCacheShortSide", "decodedImageCacheSpillDirectory" and "decodedImageCacheSpillSizeInMB").
+DecodedImageCacheParameters GetDecodedImageCacheParameters(const Microsoft::MSR::CNTK::ConfigParameters& config);
+
+// A cache of decoded 8 bit images, keyed by the sequence id of the image.
+// Unlike ChunkCache, which keeps the deserialized sequences, this keeps the images before any transform,
+// so that the random transforms still run on every epoch, while the decoding only runs on the first one.
+// The cache is filled in the order images are requested and nothing is evicted: every epoch touches all
+// images once, so an LRU policy would evict each image before it is requested again.
+// Images that fit neither the memory nor the disk budget are decoded every time.
+class DecodedImageCache
+{
+public:
+    DecodedImageCache(const DecodedImageCacheParameters& parameters, int verbosity = 0);
+    ~DecodedImageCache();
+
+    // Returns a copy of the cached image with the given id, or decodes it with 'decode' and caches it.
+    // May be called concurrently from several threads.
+    cv::Mat Get(size_t id, const std::function<cv::Mat()>& decode);
+
+private:
+    struct SpilledImage
+    {
+        int64_t m_offset;
+        int m_rows;
+        int m_cols;
+        int m_type;
+    };
+
+    // Scales the image down to the configured short side.
+    cv::Mat Resize(const cv::Mat& image) const;
+
+    bool TrySpill(size_t id, const cv::Mat& image);
+    cv::Mat LoadSpilled(const SpilledImage& spilled);
+
+    const DecodedImageCacheParameters m_parameters;
+    const int m_verbosity;
+
+    std::mutex m_mutex;
+    std::unordered_map<size_t, cv::Mat> m_images;
+    std::unordered_map<size_t, SpilledImage> m_spilledImages;
+    size_t m_bytesInMemory;
+
+    std::wstring m_spillFileName;
+    std::unique_ptr<FileWrapper> m_spillFile;
+    size_t m_bytesSpilled;
+
+    size_t m_numHits;
+    size_t m_numMisses;
+
+    DISABLE_COPY_AND_MOVE(DecodedImageCache);
+};
+
+}
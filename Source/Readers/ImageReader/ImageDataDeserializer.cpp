@@ -64,6 +64,10 @@ private:
 ImageDataDeserializer::ImageDataDeserializer(CorpusDescriptorPtr corpus, const ConfigParameters& config, bool primary) : ImageDeserializerBase(corpus, config, primary)
 {
     CreateSequenceDescriptions(corpus, config(L"file"), m_labelGenerator->LabelDimension(), m_multiViewCrop);
+
+    auto cacheParameters = GetDecodedImageCacheParameters(config);
+    if (cacheParameters.IsEnabled())
+        m_decodedImageCache = std::make_unique<DecodedImageCache>(cacheParameters, m_verbosity);
 }
 
 // TODO: Should be removed at some point.
@@ -146,6 +150,7 @@ void ImageDataDeserializer::CreateSequenceDescriptions(CorpusDescriptorPtr corpu
     // Creating the default reader with expanded directory to the map file.
     auto mapFileDirectory = ExtractDirectory(mapPath);
     m_defaultReader = make_unique<FileByteReader>(mapFileDirectory);
+    m_defaultReader->SetMinDecodedSize(m_minDecodedSize);
 
     size_t numberOfCopies = isMultiCrop ? ImageDeserializerBase::NumMultiViewCopies : 1;
     static_assert(ImageDeserializerBase::NumMultiViewCopies < std::numeric_limits<uint8_t>::max(), "Do not support more than 256 copies.");
@@ -262,6 +267,7 @@ void ImageDataDeserializer::RegisterByteReader(size_t seqId, const std::string&
     if (r == knownReaders.end())
     {
         reader = std::make_shared<ZipByteReader>(containerPath);
+        reader->SetMinDecodedSize(m_minDecodedSize);
         knownReaders[containerPath] = reader;
         readerSequences[containerPath] = MultiMap();
     }
@@ -284,6 +290,13 @@ cv::Mat ImageDataDeserializer::ReadImage(size_t seqId, const std::string& path,
 {
     assert(!path.empty());
 
+    if (m_decodedImageCache)
+        return m_decodedImageCache->Get(seqId, [&]() { return ReadImageFromReader(seqId, path, grayscale); });
+    return ReadImageFromReader(seqId, path, grayscale);
+}
+
+cv::Mat ImageDataDeserializer::ReadImageFromReader(size_t seqId, const std::string& path, bool grayscale)
+{
     ImageDataDeserializer::SeqReaderMap::const_iterator r;
     if (m_readers.empty() || (r = m_readers.find(seqId)) == m_readers.end())
         return m_defaultReader->Read(seqId, path, grayscale);
@@ -295,7 +308,15 @@ cv::Mat FileByteReader::Read(size_t, const std::string& seqPath, bool grayscale)
     assert(!seqPath.empty());
     auto path = Expand3Dots(seqPath, m_expandDirectory);
 
-    return cv::imread(path, grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
+    if (m_minDecodedSize == 0)
+        return cv::imread(path, grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
+
+    // The header of the image decides the resolution to decode it at, so it is read into memory first.
+    std::ifstream file(path, std::ios::binary);
+    std::vector<unsigned char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (contents.empty())
+        return cv::Mat();
+    return DecodeImage(contents.data(), contents.size(), grayscale, m_minDecodedSize);
 }
 
 bool ImageDataDeserializer::GetSequenceInfoByKey(const SequenceKey& key, SequenceInfo& result)
@@ -8,6 +8,7 @@
 #include "ImageDeserializerBase.h"
 #include "Config.h"
 #include "ByteReader.h"
+#include "DecodedImageCache.h"
 #include <unordered_map>
 #include "CorpusDescriptor.h"
 
@@ -62,12 +63,16 @@ private:
     using ReaderSequenceMap = std::map<std::string, std::map<std::string, std::vector<size_t>>>;
     void RegisterByteReader(size_t seqId, const std::string& path, PathReaderMap& knownReaders, ReaderSequenceMap& readerSequences, const std::string& expandDirectory);
     cv::Mat ReadImage(size_t seqId, const std::string& path, bool grayscale);
+    cv::Mat ReadImageFromReader(size_t seqId, const std::string& path, bool grayscale);
 
     // REVIEW alexeyk: can potentially use vector instead of map. Need to handle default reader and resizing though.
     using SeqReaderMap = std::unordered_map<size_t, std::shared_ptr<ByteReader>>;
     SeqReaderMap m_readers;
 
     std::unique_ptr<FileByteReader> m_defaultReader;
+
+    // Decoded images kept across epochs, if configured.
+    std::unique_ptr<DecodedImageCache> m_decodedImageCache;
 };
 
 }
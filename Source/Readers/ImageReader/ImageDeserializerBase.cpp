@@ -20,7 +20,7 @@ using namespace Microsoft::MSR::CNTK;
     ImageDeserializerBase::ImageDeserializerBase() 
         : DataDeserializerBase(true),
           m_precision(DataType::Float),
-          m_grayscale(false), m_verbosity(0), m_multiViewCrop(false)
+          m_grayscale(false), m_minDecodedSize(0), m_verbosity(0), m_multiViewCrop(false)
     {}
 
     ImageDeserializerBase::ImageDeserializerBase(CorpusDescriptorPtr corpus, const ConfigParameters& config, bool primary)
@@ -71,6 +71,10 @@ using namespace Microsoft::MSR::CNTK;
 
         m_grayscale = config(L"grayscale", false);
 
+        // Decoding is the bottleneck of the reader for large images that the transforms scale down anyway;
+        // this should not exceed the size the crop transform takes from the image.
+        m_minDecodedSize = config(L"minDecodedSize", (size_t)0);
+
         // TODO: multiview should be done on the level of randomizer/transformers - it is responsiblity of the
         // TODO: randomizer to collect how many copies each transform needs and request same sequence several times.
         m_multiViewCrop = config(L"multiViewCrop", false);
@@ -43,6 +43,9 @@ namespace CNTK {
         // Flag whether images shall be loaded in grayscale.
         bool m_grayscale;
 
+        // JPEG images are decoded at reduced resolution, as long as both sides stay at least this size (0: full resolution).
+        size_t m_minDecodedSize;
+
         // Verbosity.
         int m_verbosity;
 
@@ -14,6 +14,7 @@
 #include "FramePacker.h"
 #include <omp.h>
 #include "TransformController.h"
+#include "ConfigUtil.h"
 
 namespace CNTK {
 
@@ -84,7 +85,7 @@ ImageReader::ImageReader(const ConfigParameters& config)
     m_packer = std::make_shared<FramePacker>(
         m_sequenceEnumerator,
         m_streams,
-        2 /* number of buffers*/,
+        GetPrefetchDepth(config) + 1 /* number of buffers*/,
         useLocalTimeline);
 }
 
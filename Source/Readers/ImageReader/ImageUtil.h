@@ -9,6 +9,7 @@
 #include "SequenceData.h"
 #include "DataDeserializer.h"
 #include <numeric>
+#include <algorithm>
 
 namespace CNTK {
 
@@ -53,6 +54,69 @@ namespace CNTK {
         return resultType;
     }
 
+    // Reads the size of a JPEG image from its frame header, without decoding it.
+    inline bool TryGetJpegSize(const unsigned char* data, size_t size, size_t& width, size_t& height)
+    {
+        if (size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+            return false;
+
+        size_t pos = 2;
+        while (pos + 4 <= size)
+        {
+            if (data[pos] != 0xFF)
+                return false;
+
+            unsigned char marker = data[pos + 1];
+            if (marker == 0xFF) // fill byte
+            {
+                pos++;
+                continue;
+            }
+            if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) // markers without a segment
+            {
+                pos += 2;
+                continue;
+            }
+
+            // Start of frame of any kind, other than the DHT, JPG and DAC segments sharing the range.
+            if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+            {
+                if (pos + 9 > size)
+                    return false;
+                height = ((size_t)data[pos + 5] << 8) | data[pos + 6];
+                width = ((size_t)data[pos + 7] << 8) | data[pos + 8];
+                return width != 0 && height != 0;
+            }
+
+            if (marker == 0xDA) // start of scan, no frame header
+                return false;
+
+            pos += 2 + (((size_t)data[pos + 2] << 8) | data[pos + 3]);
+        }
+        return false;
+    }
+
+    // JPEG images can be decoded at 1/2, 1/4 or 1/8 of their resolution in the DCT domain, which is several times faster
+    // than decoding them fully and scaling them down later. Decodes 'data' at the smallest of these resolutions where both sides
+    // are still at least 'minSize' pixels; at full resolution if 'minSize' is 0 or the image is not a JPEG.
+    inline cv::Mat DecodeImage(const unsigned char* data, size_t size, bool grayscale, size_t minSize)
+    {
+        int flags = grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR;
+        size_t width, height;
+        if (minSize > 0 && TryGetJpegSize(data, size, width, height))
+        {
+            int reducedFlags[] = {
+                grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_2 : cv::IMREAD_REDUCED_COLOR_2,
+                grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_4 : cv::IMREAD_REDUCED_COLOR_4,
+                grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_8 : cv::IMREAD_REDUCED_COLOR_8
+            };
+            for (size_t i = 0, factor = 2; i < 3 && std::min(width, height) / factor >= minSize; i++, factor *= 2)
+                flags = reducedFlags[i];
+        }
+
+        return cv::imdecode(cv::Mat(1, (int)size, CV_8U, const_cast<unsigned char*>(data)), flags);
+    }
+
     // A helper interface to generate a typed label in a sparse format for categories.
     // It is represented as an array indexed by the category, containing zero values for all categories the sequence does not belong to,
     // and a single one for a category it belongs to: [ 0 .. 0.. 1 .. 0 ]
@@ -6,9 +6,12 @@
 #include "stdafx.h"
 #include <opencv2/opencv.hpp>
 #include "ByteReader.h"
+#include "ImageUtil.h"
 
 #ifdef USE_ZIP
+#include <algorithm>
 #include <File.h>
+#include <zlib.h>
 
 namespace CNTK {
 
@@ -23,6 +26,32 @@ std::string GetZipError(int err)
     return errS;
 }
 
+namespace {
+
+// Signatures and sizes of the zip records, all fields are little endian.
+const uint32_t LocalHeaderSignature = 0x04034b50;
+const uint32_t CentralHeaderSignature = 0x02014b50;
+const uint32_t EndOfCentralDirectorySignature = 0x06054b50;
+const uint32_t Zip64EndOfCentralDirectorySignature = 0x06064b50;
+const uint32_t Zip64LocatorSignature = 0x07064b50;
+const size_t LocalHeaderSize = 30;
+const size_t CentralHeaderSize = 46;
+const size_t EndOfCentralDirectorySize = 22;
+const size_t Zip64LocatorSize = 20;
+const size_t Zip64EndOfCentralDirectorySize = 56;
+const size_t MaxCommentSize = 0xFFFF;
+
+const uint16_t FlagEncrypted = 1 << 0;
+const uint16_t FlagUtf8 = 1 << 11;
+const uint16_t MethodStored = 0;
+const uint16_t MethodDeflated = 8;
+
+uint16_t ReadUInt16(const unsigned char* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+uint32_t ReadUInt32(const unsigned char* p) { return (uint32_t)ReadUInt16(p) | ((uint32_t)ReadUInt16(p + 2) << 16); }
+uint64_t ReadUInt64(const unsigned char* p) { return (uint64_t)ReadUInt32(p) | ((uint64_t)ReadUInt32(p + 4) << 32); }
+
+}
+
 ZipByteReader::ZipByteReader(const std::string& zipPath)
     : m_zipPath(zipPath)
 {
@@ -47,30 +76,148 @@ ZipByteReader::ZipPtr ZipByteReader::OpenZip()
     });
 }
 
-void ZipByteReader::Register(const MultiMap& sequences)
+bool ZipByteReader::TryReadCentralDirectory(std::unordered_map<std::string, ZipEntry>& entries) const
+{
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(m_mapping->Data());
+    const size_t fileSize = m_mapping->Size();
+    if (fileSize < EndOfCentralDirectorySize)
+        return false;
+
+    // The end of central directory record is followed by a comment of at most 64K.
+    size_t end = fileSize - EndOfCentralDirectorySize;
+    const size_t first = end > MaxCommentSize ? end - MaxCommentSize : 0;
+    while (ReadUInt32(data + end) != EndOfCentralDirectorySignature)
+    {
+        if (end == first)
+            return false;
+        end--;
+    }
+
+    uint64_t numEntries = ReadUInt16(data + end + 10);
+    uint64_t directorySize = ReadUInt32(data + end + 12);
+    uint64_t directoryOffset = ReadUInt32(data + end + 16);
+    if (end >= Zip64LocatorSize && ReadUInt32(data + end - Zip64LocatorSize) == Zip64LocatorSignature)
+    {
+        uint64_t zip64End = ReadUInt64(data + end - Zip64LocatorSize + 8);
+        if (zip64End + Zip64EndOfCentralDirectorySize > fileSize || ReadUInt32(data + zip64End) != Zip64EndOfCentralDirectorySignature)
+            return false;
+        if (ReadUInt32(data + zip64End + 16) != 0 || ReadUInt32(data + zip64End + 20) != 0)
+            return false; // multi-disk archives are not supported
+        numEntries = ReadUInt64(data + zip64End + 32);
+        directorySize = ReadUInt64(data + zip64End + 40);
+        directoryOffset = ReadUInt64(data + zip64End + 48);
+    }
+    else if (ReadUInt16(data + end + 4) != 0 || ReadUInt16(data + end + 6) != 0)
+    {
+        return false; // multi-disk archives are not supported
+    }
+
+    if (directoryOffset + directorySize > fileSize)
+        return false;
+
+    size_t position = directoryOffset;
+    const size_t directoryEnd = directoryOffset + directorySize;
+    for (uint64_t i = 0; i < numEntries; ++i)
+    {
+        if (position + CentralHeaderSize > directoryEnd || ReadUInt32(data + position) != CentralHeaderSignature)
+            return false;
+
+        const unsigned char* header = data + position;
+        const uint16_t flags = ReadUInt16(header + 8);
+        const uint16_t method = ReadUInt16(header + 10);
+        const uint16_t nameLength = ReadUInt16(header + 28);
+        const uint16_t extraLength = ReadUInt16(header + 30);
+        const uint16_t commentLength = ReadUInt16(header + 32);
+        if (position + CentralHeaderSize + nameLength + extraLength + commentLength > directoryEnd)
+            return false;
+
+        ZipEntry entry;
+        entry.m_index = i;
+        entry.m_compressedSize = ReadUInt32(header + 20);
+        entry.m_size = ReadUInt32(header + 24);
+        entry.m_localHeaderOffset = ReadUInt32(header + 42);
+
+        // Sizes and offset that do not fit into 32 bits are in the zip64 extra field, in this order.
+        const unsigned char* extra = header + CentralHeaderSize + nameLength;
+        for (size_t e = 0; e + 4 <= extraLength;)
+        {
+            const uint16_t id = ReadUInt16(extra + e);
+            const uint16_t length = ReadUInt16(extra + e + 2);
+            if (id == 0x0001)
+            {
+                size_t f = e + 4;
+                for (zip_uint64_t* value : { &entry.m_size, &entry.m_compressedSize, &entry.m_localHeaderOffset })
+                {
+                    if (*value != 0xFFFFFFFF)
+                        continue;
+                    if (f + 8 > e + 4 + length)
+                        return false;
+                    *value = ReadUInt64(extra + f);
+                    f += 8;
+                }
+            }
+            e += 4 + length;
+        }
+
+        std::string name(reinterpret_cast<const char*>(header + CentralHeaderSize), nameLength);
+
+        // libzip converts names in the legacy code page to UTF-8, so such names would not match.
+        if (!(flags & FlagUtf8) && std::any_of(name.begin(), name.end(), [](char c) { return (c & 0x80) != 0; }))
+            return false;
+
+        entry.m_deflated = method == MethodDeflated;
+        entry.m_direct = !(flags & FlagEncrypted) && (method == MethodStored || method == MethodDeflated) &&
+                         entry.m_localHeaderOffset + LocalHeaderSize <= fileSize;
+        entries[name] = entry;
+
+        position += CentralHeaderSize + nameLength + extraLength + commentLength;
+    }
+    return true;
+}
+
+void ZipByteReader::ReadCentralDirectoryWithLibzip(std::unordered_map<std::string, ZipEntry>& entries)
 {
     auto zipFile = m_zips.pop_or_create([this]() { return OpenZip(); });
     zip_stat_t stat;
     zip_stat_init(&stat);
 
-    size_t numberOfEntries = 0;
     size_t numEntries = zip_get_num_entries(zipFile.get(), 0);
     for (size_t i = 0; i < numEntries; ++i) {
         int err = zip_stat_index(zipFile.get(), i, 0, &stat);
         if (ZIP_ER_OK != err)
             RuntimeError("Failed to get file info for index %d, zip library error: %s", (int)i, GetZipError(err).c_str());
 
-        auto sequenceInfo = sequences.find(std::string(stat.name));
-        if (sequenceInfo == sequences.end())
-        {
+        ZipEntry entry = {};
+        entry.m_index = stat.index;
+        entry.m_size = stat.size;
+        entry.m_direct = false;
+        entries[std::string(stat.name)] = entry;
+    }
+    m_zips.push(std::move(zipFile));
+}
+
+void ZipByteReader::Register(const MultiMap& sequences)
+{
+    std::unordered_map<std::string, ZipEntry> entries;
+    m_mapping = std::make_shared<MemoryMappedFile>(Microsoft::MSR::CNTK::ToFixedWStringFromMultiByte(m_zipPath));
+    if (!TryReadCentralDirectory(entries))
+    {
+        fprintf(stderr, "WARNING: Cannot index container %s directly, reading it through the zip library.\n", m_zipPath.c_str());
+        entries.clear();
+        ReadCentralDirectoryWithLibzip(entries);
+    }
+
+    size_t numberOfEntries = 0;
+    for (const auto& s : sequences)
+    {
+        auto entry = entries.find(s.first);
+        if (entry == entries.end())
             continue;
-        }
 
-        for (auto sid : sequenceInfo->second)
-            m_seqIdToIndex[sid] = std::make_pair(stat.index, stat.size);
+        for (auto sid : s.second)
+            m_seqIdToEntry[sid] = entry->second;
         numberOfEntries++;
     }
-    m_zips.push(std::move(zipFile));
 
     if (numberOfEntries == sequences.size())
         return;
@@ -80,7 +227,7 @@ void ZipByteReader::Register(const MultiMap& sequences)
     {
         for (const auto& id : s.second)
         {
-            if (m_seqIdToIndex.find(id) == m_seqIdToIndex.end())
+            if (m_seqIdToEntry.find(id) == m_seqIdToEntry.end())
             {
                 fprintf(stderr, "Sequence %s is not found in container %s.\n", s.first.c_str(), m_zipPath.c_str());
                 break;
@@ -91,19 +238,25 @@ void ZipByteReader::Register(const MultiMap& sequences)
     RuntimeError("Cannot retrieve image data for some sequences. For more detail, please see the log file.");
 }
 
-cv::Mat ZipByteReader::Read(size_t seqId, const std::string& path, bool grayscale)
+const unsigned char* ZipByteReader::GetEntryData(const ZipEntry& entry, const std::string& path) const
 {
-    // Find index of the file in .zip file.
-    auto r = m_seqIdToIndex.find(seqId);
-    if (r == m_seqIdToIndex.end())
-        RuntimeError("Could not find file %s in the zip file, sequence id = %lu", path.c_str(), (long)seqId);
+    // The data follows the local header, the name and extra field of which may differ from the central directory.
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(m_mapping->Data());
+    const unsigned char* header = data + entry.m_localHeaderOffset;
+    if (ReadUInt32(header) != LocalHeaderSignature)
+        RuntimeError("Invalid local header of file %s in the zip file %s", path.c_str(), m_zipPath.c_str());
 
-    zip_uint64_t index = std::get<0>((*r).second);
-    zip_uint64_t size = std::get<1>((*r).second);
+    const size_t offset = entry.m_localHeaderOffset + LocalHeaderSize + ReadUInt16(header + 26) + ReadUInt16(header + 28);
+    if (offset + entry.m_compressedSize > m_mapping->Size())
+        RuntimeError("File %s exceeds the zip file %s", path.c_str(), m_zipPath.c_str());
+    return data + offset;
+}
+
+void ZipByteReader::ReadWithLibzip(const ZipEntry& entry, size_t seqId, const std::string& path, std::vector<unsigned char>& contents)
+{
+    zip_uint64_t index = entry.m_index;
+    zip_uint64_t size = entry.m_size;
 
-    auto contents = m_workspace.pop_or_create([size]() { return vector<unsigned char>(size); });
-    if (contents.size() < size)
-        contents.resize(size);
     auto zipFile = m_zips.pop_or_create([this]() { return OpenZip(); });
     attempt(5, [&zipFile, &contents, &path, index, seqId, size]()
     {
@@ -134,8 +287,52 @@ cv::Mat ZipByteReader::Read(size_t seqId, const std::string& path, bool grayscal
         }
     });
     m_zips.push(std::move(zipFile));
+}
+
+cv::Mat ZipByteReader::Read(size_t seqId, const std::string& path, bool grayscale)
+{
+    // Find the entry of the file in .zip file.
+    auto r = m_seqIdToEntry.find(seqId);
+    if (r == m_seqIdToEntry.end())
+        RuntimeError("Could not find file %s in the zip file, sequence id = %lu", path.c_str(), (long)seqId);
+
+    const ZipEntry& entry = r->second;
+    const zip_uint64_t size = entry.m_size;
+
+    // Stored entries are decoded in place.
+    if (entry.m_direct && !entry.m_deflated)
+    {
+        cv::Mat img = DecodeImage(GetEntryData(entry, path), size, grayscale, m_minDecodedSize);
+        assert(nullptr != img.data);
+        return img;
+    }
+
+    auto contents = m_workspace.pop_or_create([size]() { return vector<unsigned char>(size); });
+    if (contents.size() < size)
+        contents.resize(size);
+
+    if (entry.m_direct)
+    {
+        z_stream stream = {};
+        stream.next_in = const_cast<Bytef*>(GetEntryData(entry, path));
+        stream.avail_in = (uInt)entry.m_compressedSize;
+        stream.next_out = contents.data();
+        stream.avail_out = (uInt)size;
+
+        // Zip entries are raw deflate streams without a zlib header.
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+            RuntimeError("Could not initialize inflating file %s in the zip file", path.c_str());
+        int result = inflate(&stream, Z_FINISH);
+        inflateEnd(&stream);
+        if (result != Z_STREAM_END || stream.total_out != size)
+            RuntimeError("Could not inflate file %s in the zip file, sequence id = %lu, zlib error: %d", path.c_str(), (long)seqId, result);
+    }
+    else
+    {
+        ReadWithLibzip(entry, seqId, path, contents);
+    }
 
-    cv::Mat img = cv::imdecode(contents, grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
+    cv::Mat img = DecodeImage(contents.data(), size, grayscale, m_minDecodedSize);
     assert(nullptr != img.data);
     m_workspace.push(std::move(contents));
     return img;
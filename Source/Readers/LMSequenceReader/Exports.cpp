@@ -10,6 +10,8 @@
 #define DATAWRITER_EXPORTS
 #include "SequenceReader.h"
 #include "SequenceWriter.h"
+#include "LMSequenceDeserializer.h"
+#include "CorpusDescriptor.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -31,4 +33,20 @@ extern "C" DATAWRITER_API void GetWriterD(IDataWriter** pwriter)
     *pwriter = new LMSequenceWriter<double>();
 }
 
+// Exposes the corpus of the LMSequenceReader as a deserializer of the composite reader, [type = "LMSequenceDeserializer"].
+extern "C" DATAREADER_API bool CreateDeserializer(::CNTK::DataDeserializerPtr& deserializer, const std::wstring& type, const ConfigParameters& deserializerConfig, ::CNTK::CorpusDescriptorPtr corpus, bool primary)
+{
+    if (corpus && !corpus->IsNumericSequenceKeys())
+        InvalidArgument("LMSequenceDeserializer does not support non-numeric sequence keys.");
+
+    if (!primary)
+        InvalidArgument("LMSequenceDeserializer can only be used as a primary.");
+
+    if (type != L"LMSequenceDeserializer")
+        InvalidArgument("Unknown deserializer type '%ls'", type.c_str());
+
+    deserializer = std::make_shared<::CNTK::LMSequenceDeserializer>(deserializerConfig);
+    return true;
+}
+
 }}}
@@ -0,0 +1,481 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "LMSequenceDeserializer.h"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include "File.h"
+#include "fileutil.h"
+#include "ReaderConstants.h"
+#include "SequenceData.h"
+#include "StringUtil.h"
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+namespace {
+
+inline bool IsBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Calls f(word, length) for the words of [begin, end), which must not contain a new line.
+template <class F>
+inline void ForEachWord(const char* begin, const char* end, F f)
+{
+    const char* p = begin;
+    while (p < end)
+    {
+        while (p < end && IsBlank(*p))
+            ++p;
+        const char* word = p;
+        while (p < end && !IsBlank(*p))
+            ++p;
+        if (p > word)
+            f(word, (size_t)(p - word));
+    }
+}
+
+inline bool IsWord(const char* word, size_t length, const string& value)
+{
+    return !value.empty() && length == value.size() && memcmp(word, value.data(), length) == 0;
+}
+
+}
+
+uint32_t HashedVocabulary::Hash(const char* word, size_t length)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i)
+        hash = (hash ^ (uint8_t)word[i]) * 16777619u;
+    return hash;
+}
+
+size_t HashedVocabulary::FindSlot(const char* word, size_t length, uint32_t hash) const
+{
+    for (size_t slot = hash & m_mask;; slot = (slot + 1) & m_mask)
+    {
+        uint32_t id = m_slots[slot];
+        if (id == 0)
+            return slot;
+
+        --id;
+        if (m_slotHashes[slot] == hash &&
+            m_wordOffsets[id + 1] - m_wordOffsets[id] == length &&
+            memcmp(m_words.data() + m_wordOffsets[id], word, length) == 0)
+            return slot;
+    }
+}
+
+uint32_t HashedVocabulary::Find(const char* word, size_t length) const
+{
+    if (m_slots.empty())
+        return NotFound;
+
+    uint32_t id = m_slots[FindSlot(word, length, Hash(word, length))];
+    return id == 0 ? NotFound : id - 1;
+}
+
+uint32_t HashedVocabulary::Add(const char* word, size_t length)
+{
+    // The table is kept at most half full, so that the probe sequences stay short.
+    if (2 * (Size() + 1) > m_slots.size())
+        Grow();
+
+    uint32_t hash = Hash(word, length);
+    size_t slot = FindSlot(word, length, hash);
+    if (m_slots[slot] != 0)
+        return m_slots[slot] - 1;
+
+    if (Size() >= NotFound - 1)
+        RuntimeError("HashedVocabulary: Too many words.");
+
+    uint32_t id = (uint32_t)Size();
+    m_words.insert(m_words.end(), word, word + length);
+    m_wordOffsets.push_back(m_words.size());
+    m_slots[slot] = id + 1;
+    m_slotHashes[slot] = hash;
+    return id;
+}
+
+void HashedVocabulary::Grow()
+{
+    size_t capacity = max<size_t>(2 * m_slots.size(), 1024);
+    m_slots.assign(capacity, 0);
+    m_slotHashes.assign(capacity, 0);
+    m_mask = capacity - 1;
+
+    for (uint32_t id = 0; id < Size(); ++id)
+    {
+        const char* word = m_words.data() + m_wordOffsets[id];
+        size_t length = m_wordOffsets[id + 1] - m_wordOffsets[id];
+        uint32_t hash = Hash(word, length);
+        size_t slot = FindSlot(word, length, hash);
+        m_slots[slot] = id + 1;
+        m_slotHashes[slot] = hash;
+    }
+}
+
+// The words of the sentences are looked up when the chunk is created. The sequences point into the ids,
+// the features and the labels of a sentence into the same ones, shifted by a word.
+class LMSequenceDeserializer::LMSequenceChunk : public Chunk
+{
+public:
+    LMSequenceChunk(const LMSequenceDeserializer& parent, const ChunkDescriptor& descriptor)
+        : m_parent(parent), m_descriptor(descriptor), m_ids(make_shared<vector<SparseIndexType>>())
+    {
+        m_ids->reserve(descriptor.m_numSamples + 2 * descriptor.m_numSequences);
+        m_sequenceStarts.reserve(descriptor.m_numSequences);
+        for (size_t i = 0; i < descriptor.m_numSequences; ++i)
+        {
+            m_sequenceStarts.push_back(m_ids->size());
+            parent.Tokenize(descriptor.m_firstSequence + i, *m_ids);
+        }
+
+        m_holdingBuffer = shared_ptr<uint8_t>(m_ids, (uint8_t*)m_ids->data());
+    }
+
+    void GetSequence(size_t sequenceIndex, vector<SequenceDataPtr>& result) override
+    {
+        if (sequenceIndex >= m_descriptor.m_numSequences)
+            LogicError("Sequence index %zu is out of range of the chunk.", sequenceIndex);
+
+        const size_t index = m_descriptor.m_firstSequence + sequenceIndex;
+        SequenceKey key { index, 0 };
+        for (const auto& stream : m_parent.m_streams)
+        {
+            auto sequence = make_shared<ExternalSparseSequenceData>(m_parent.m_ones.data(), m_parent.m_sequenceLengths[index], stream.m_sampleLayout);
+            sequence->m_indices = m_ids->data() + m_sequenceStarts[sequenceIndex] + stream.m_id;
+            sequence->m_nnzCounts.assign(sequence->m_numberOfSamples, 1);
+            sequence->m_totalNnzCount = (SparseIndexType)sequence->m_numberOfSamples;
+            sequence->m_elementType = stream.m_elementType;
+            sequence->m_key = key;
+            sequence->m_holdingBuffer = m_holdingBuffer;
+            result.push_back(sequence);
+        }
+    }
+
+private:
+    const LMSequenceDeserializer& m_parent;
+    const ChunkDescriptor& m_descriptor;
+
+    shared_ptr<vector<SparseIndexType>> m_ids;
+    vector<size_t> m_sequenceStarts;
+
+    // Keeps the ids alive while the sequences are used.
+    shared_ptr<uint8_t> m_holdingBuffer;
+};
+
+LMSequenceDeserializer::LMSequenceDeserializer(const ConfigParameters& config)
+    : DataDeserializerBase(true), m_maxSequenceLength(0)
+{
+    m_fileName = ToFixedWStringFromMultiByte(config(L"file"));
+    m_traceLevel = config(L"traceLevel", 1);
+    m_beginSequence = ToLegacyString(ToUTF8(config(L"beginSequence", L"")));
+    m_endSequence = ToLegacyString(ToUTF8(config(L"endSequence", L"")));
+    m_unk = ToLegacyString(ToUTF8(config(L"unk", L"<unk>")));
+
+    size_t elementSize;
+    DataType elementType;
+    string precision = config.Find("precision", "float");
+    if (AreEqualIgnoreCase(precision, "double"))
+    {
+        elementSize = sizeof(double);
+        elementType = DataType::Double;
+    }
+    else if (AreEqualIgnoreCase(precision, "float"))
+    {
+        elementSize = sizeof(float);
+        elementType = DataType::Float;
+    }
+    else
+        InvalidArgument("Not supported precision '%s'. Expected 'double' or 'float'.", precision.c_str());
+
+    // The words of the sentence, and optionally the next words, in this order.
+    wstring featuresName, labelsName;
+    size_t dim = 0;
+    const ConfigParameters& input = config(L"input");
+    for (const pair<string, ConfigParameters>& section : input)
+    {
+        wstring name = ToFixedWStringFromMultiByte(section.first);
+        string labelType = section.second.Find("labelType", "category");
+        if (AreEqualIgnoreCase(labelType, "category") && featuresName.empty())
+        {
+            featuresName = name;
+            dim = section.second(L"dim", (size_t)0);
+        }
+        else if (AreEqualIgnoreCase(labelType, "nextWord") && labelsName.empty())
+            labelsName = name;
+        else
+            InvalidArgument("LMSequenceDeserializer: Unexpected input '%ls' of labelType '%s'. "
+                            "Expected one input of labelType 'category' and at most one of labelType 'nextWord'.", name.c_str(), labelType.c_str());
+    }
+
+    if (featuresName.empty())
+        InvalidArgument("LMSequenceDeserializer requires an input of labelType 'category'.");
+    m_hasNextWord = !labelsName.empty();
+
+    m_file = make_shared<MemoryMappedFile>(m_fileName);
+
+    size_t chunkSizeInBytes = config(L"chunkSizeInBytes", g_32MB);
+    wstring vocabularyPath = ToFixedWStringFromMultiByte(config(L"vocabulary"));
+    if (fexists(vocabularyPath))
+    {
+        LoadVocabulary(vocabularyPath);
+        Index(chunkSizeInBytes, nullptr);
+    }
+    else
+    {
+        vector<size_t> wordCounts;
+        Index(chunkSizeInBytes, &wordCounts);
+        WriteVocabulary(vocabularyPath, wordCounts);
+    }
+
+    m_beginSequenceId = m_vocabulary.Find(m_beginSequence);
+    m_endSequenceId = m_vocabulary.Find(m_endSequence);
+    m_unkId = m_vocabulary.Find(m_unk);
+    if (!m_beginSequence.empty() && m_beginSequenceId == HashedVocabulary::NotFound)
+        InvalidArgument("LMSequenceDeserializer: beginSequence '%s' is not in the vocabulary '%ls'.", m_beginSequence.c_str(), vocabularyPath.c_str());
+    if (!m_endSequence.empty() && m_endSequenceId == HashedVocabulary::NotFound)
+        InvalidArgument("LMSequenceDeserializer: endSequence '%s' is not in the vocabulary '%ls'.", m_endSequence.c_str(), vocabularyPath.c_str());
+    if (m_unkId == HashedVocabulary::NotFound && m_traceLevel > 0)
+        fprintf(stderr, "LMSequenceDeserializer: unk '%s' is not in the vocabulary. Unknown words will error out if encountered.\n", m_unk.c_str());
+
+    if (dim == 0)
+        dim = m_vocabulary.Size();
+    else if (dim < m_vocabulary.Size())
+        InvalidArgument("LMSequenceDeserializer: The dim %zu of input '%ls' is smaller than the %zu words of the vocabulary '%ls'.",
+                        dim, featuresName.c_str(), m_vocabulary.Size(), vocabularyPath.c_str());
+
+    for (const auto& name : { featuresName, labelsName })
+    {
+        if (name.empty())
+            continue;
+
+        StreamInformation stream;
+        stream.m_id = m_streams.size();
+        stream.m_name = name;
+        stream.m_storageFormat = StorageFormat::SparseCSC;
+        stream.m_elementType = elementType;
+        stream.m_sampleLayout = NDShape({ dim });
+        m_streams.push_back(stream);
+    }
+
+    m_ones.resize(m_maxSequenceLength * elementSize);
+    for (size_t i = 0; i < m_maxSequenceLength; ++i)
+    {
+        if (elementType == DataType::Float)
+            reinterpret_cast<float*>(m_ones.data())[i] = 1;
+        else
+            reinterpret_cast<double*>(m_ones.data())[i] = 1;
+    }
+
+    if (m_traceLevel > 0)
+        fprintf(stderr, "LMSequenceDeserializer: %zu sentences of '%ls' in %zu chunks, %zu words in the vocabulary\n",
+                m_sequenceLengths.size(), m_fileName.c_str(), m_chunks.size(), m_vocabulary.Size());
+}
+
+void LMSequenceDeserializer::LoadVocabulary(const wstring& path)
+{
+    vector<string> words;
+    File::LoadLabelFile(path, words);
+    for (const auto& word : words)
+    {
+        size_t size = m_vocabulary.Size();
+        if (m_vocabulary.Add(word.data(), word.size()) != size)
+            RuntimeError("LMSequenceDeserializer: Word '%s' is more than once in the vocabulary '%ls'.", word.c_str(), path.c_str());
+    }
+}
+
+void LMSequenceDeserializer::WriteVocabulary(const wstring& path, vector<size_t>& wordCounts)
+{
+    // The symbols are added if the corpus does not have them, so that they get an id.
+    for (const auto& symbol : { m_beginSequence, m_endSequence, m_unk })
+    {
+        if (symbol.empty())
+            continue;
+        if (m_vocabulary.Add(symbol.data(), symbol.size()) == wordCounts.size())
+            wordCounts.push_back(0);
+    }
+
+    vector<uint32_t> order(wordCounts.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&wordCounts](uint32_t a, uint32_t b) { return wordCounts[a] > wordCounts[b]; });
+
+    HashedVocabulary ordered;
+    for (auto id : order)
+    {
+        string word = m_vocabulary.Word(id);
+        ordered.Add(word.data(), word.size());
+    }
+    m_vocabulary = move(ordered);
+
+    // Written to a temporary file first, so that a reader never sees a partial vocabulary.
+    wstring temporaryPath = path + L".tmp";
+    FILE* f = fopenOrDie(temporaryPath, L"wb");
+    try
+    {
+        for (uint32_t id = 0; id < m_vocabulary.Size(); ++id)
+            fprintfOrDie(f, "%s\n", m_vocabulary.Word(id).c_str());
+    }
+    catch (...)
+    {
+        fclose(f);
+        throw;
+    }
+    fcloseOrDie(f);
+    renameOrDie(temporaryPath, path);
+
+    if (m_traceLevel > 0)
+        fprintf(stderr, "LMSequenceDeserializer: Wrote the vocabulary of %zu words to '%ls'\n", m_vocabulary.Size(), path.c_str());
+}
+
+void LMSequenceDeserializer::Index(size_t chunkSizeInBytes, vector<size_t>* wordCounts)
+{
+    // The mapping does not read ahead by itself, the scan does it in large steps.
+    const size_t prefetchSize = g_64MB;
+    size_t prefetched = 0;
+
+    const char* data = m_file->Data();
+    const size_t size = m_file->Size();
+    size_t offset = 0;
+    while (offset < size)
+    {
+        if (offset + prefetchSize / 2 >= prefetched && prefetched < size)
+        {
+            m_file->WillNeed(prefetched, min(prefetchSize, size - prefetched));
+            prefetched += prefetchSize;
+        }
+
+        const char* lineEnd = (const char*)memchr(data + offset, '\n', size - offset);
+        if (lineEnd == nullptr)
+            lineEnd = data + size;
+
+        size_t numWords = 0;
+        bool hasBegin = false, hasEnd = false;
+        ForEachWord(data + offset, lineEnd, [&](const char* word, size_t length)
+        {
+            hasBegin = numWords == 0 ? IsWord(word, length, m_beginSequence) : hasBegin;
+            hasEnd = IsWord(word, length, m_endSequence);
+            ++numWords;
+
+            if (wordCounts != nullptr)
+            {
+                uint32_t id = m_vocabulary.Add(word, length);
+                if (id == wordCounts->size())
+                    wordCounts->push_back(0);
+                (*wordCounts)[id]++;
+            }
+        });
+
+        if (numWords > 0)
+            numWords += (!m_beginSequence.empty() && !hasBegin) + (!m_endSequence.empty() && !hasEnd);
+        size_t numSamples = m_hasNextWord && numWords > 0 ? numWords - 1 : numWords;
+        if (numSamples >= SequenceLenMax)
+            RuntimeError("LMSequenceDeserializer: The sentence at offset %zu of '%ls' is too long.", offset, m_fileName.c_str());
+
+        // Empty lines, or sentences without a word to predict, are skipped.
+        if (numSamples > 0)
+        {
+            if (m_chunks.empty() || (size_t)(lineEnd - data) - m_sequenceOffsets[m_chunks.back().m_firstSequence] > chunkSizeInBytes)
+            {
+                if (m_chunks.size() >= numeric_limits<ChunkIdType>::max())
+                    RuntimeError("Number of chunks exceeded overflow limit.");
+                m_chunks.push_back(ChunkDescriptor { m_sequenceOffsets.size(), 0, 0 });
+            }
+
+            m_sequenceOffsets.push_back(offset);
+            m_sequenceLengths.push_back((unsigned int)numSamples);
+            m_chunks.back().m_numSequences++;
+            m_chunks.back().m_numSamples += numSamples;
+            m_maxSequenceLength = max(m_maxSequenceLength, numSamples);
+        }
+
+        offset = lineEnd - data + 1;
+    }
+
+    m_sequenceOffsets.push_back(size);
+}
+
+void LMSequenceDeserializer::Tokenize(size_t sequenceIndex, vector<SparseIndexType>& ids) const
+{
+    const char* begin = m_file->Data() + m_sequenceOffsets[sequenceIndex];
+    const char* end = m_file->Data() + m_sequenceOffsets[sequenceIndex + 1];
+    const char* lineEnd = (const char*)memchr(begin, '\n', end - begin);
+    if (lineEnd != nullptr)
+        end = lineEnd;
+
+    const size_t start = ids.size();
+    ForEachWord(begin, end, [&](const char* word, size_t length)
+    {
+        uint32_t id = m_vocabulary.Find(word, length);
+        if (id == HashedVocabulary::NotFound)
+        {
+            if (m_unkId == HashedVocabulary::NotFound)
+                RuntimeError("LMSequenceDeserializer: Word '%s' is not in the vocabulary.", string(word, length).c_str());
+            id = m_unkId;
+        }
+        ids.push_back((SparseIndexType)id);
+    });
+
+    if (!m_beginSequence.empty() && (ids.size() == start || ids[start] != (SparseIndexType)m_beginSequenceId))
+        ids.insert(ids.begin() + start, (SparseIndexType)m_beginSequenceId);
+    if (!m_endSequence.empty() && (ids.size() == start || ids.back() != (SparseIndexType)m_endSequenceId))
+        ids.push_back((SparseIndexType)m_endSequenceId);
+
+    if (ids.size() - start != m_sequenceLengths[sequenceIndex] + (m_hasNextWord ? 1 : 0))
+        RuntimeError("LMSequenceDeserializer: The sentence at offset %zu of '%ls' changed since it was indexed.",
+                     m_sequenceOffsets[sequenceIndex], m_fileName.c_str());
+}
+
+vector<ChunkInfo> LMSequenceDeserializer::ChunkInfos()
+{
+    vector<ChunkInfo> result;
+    result.reserve(m_chunks.size());
+    for (size_t i = 0; i < m_chunks.size(); ++i)
+        result.push_back(ChunkInfo { (ChunkIdType)i, m_chunks[i].m_numSamples, m_chunks[i].m_numSequences });
+    return result;
+}
+
+void LMSequenceDeserializer::SequenceInfosForChunk(ChunkIdType chunkId, vector<SequenceInfo>& result)
+{
+    const auto& chunk = m_chunks[chunkId];
+    result.reserve(result.size() + chunk.m_numSequences);
+    for (size_t i = 0; i < chunk.m_numSequences; ++i)
+    {
+        SequenceInfo sequence = {};
+        sequence.m_indexInChunk = i;
+        sequence.m_numberOfSamples = m_sequenceLengths[chunk.m_firstSequence + i];
+        sequence.m_chunkId = chunkId;
+        sequence.m_key.m_sequence = chunk.m_firstSequence + i;
+        result.push_back(sequence);
+    }
+}
+
+ChunkPtr LMSequenceDeserializer::GetChunk(ChunkIdType chunkId)
+{
+    return make_shared<LMSequenceChunk>(*this, m_chunks.at(chunkId));
+}
+
+void LMSequenceDeserializer::WillNeedChunks(const vector<ChunkIdType>& chunkIds)
+{
+    for (auto chunkId : chunkIds)
+    {
+        if (chunkId >= m_chunks.size())
+            continue;
+
+        const auto& chunk = m_chunks[chunkId];
+        size_t start = m_sequenceOffsets[chunk.m_firstSequence];
+        m_file->WillNeed(start, m_sequenceOffsets[chunk.m_firstSequence + chunk.m_numSequences] - start);
+    }
+}
+
+}
@@ -0,0 +1,139 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "DataDeserializerBase.h"
+#include "MemoryMappedFile.h"
+#include "Config.h"
+
+namespace CNTK {
+
+// Vocabulary with an open addressing hash table (linear probing) over a single buffer of words, so that
+// words can be looked up directly from the memory mapped corpus, without creating strings.
+// Lookups are const and can be done from several threads.
+class HashedVocabulary
+{
+public:
+    static const uint32_t NotFound = (uint32_t)-1;
+
+    HashedVocabulary() : m_mask(0) {}
+
+    // Returns the id of the word, adding it with the next id if it is new.
+    uint32_t Add(const char* word, size_t length);
+
+    uint32_t Find(const char* word, size_t length) const;
+
+    uint32_t Find(const std::string& word) const
+    {
+        return Find(word.data(), word.size());
+    }
+
+    std::string Word(uint32_t id) const
+    {
+        return std::string(m_words.data() + m_wordOffsets[id], m_wordOffsets[id + 1] - m_wordOffsets[id]);
+    }
+
+    size_t Size() const
+    {
+        return m_wordOffsets.size() - 1;
+    }
+
+private:
+    static uint32_t Hash(const char* word, size_t length);
+
+    // Returns the slot that holds the word, or the empty slot where it would be added.
+    size_t FindSlot(const char* word, size_t length, uint32_t hash) const;
+
+    void Grow();
+
+    std::vector<char> m_words;
+    std::vector<size_t> m_wordOffsets { 0 }; // start of each word in m_words, followed by the end of the last one
+    std::vector<uint32_t> m_slots;           // id + 1 of the word in the slot, 0 if empty
+    std::vector<uint32_t> m_slotHashes;
+    size_t m_mask;
+};
+
+// Deserializer for language model training on a pre-tokenized text corpus, one sentence per line and
+// words separated by blanks, as read by the LMSequenceReader. Unlike the LMSequenceReader, it can be used
+// by the composite reader with its randomizers, prefetching and distributed decimation.
+//
+// The corpus is memory mapped and scanned once when the deserializer is created, to find the sentences and
+// to group them into chunks of about 'chunkSizeInBytes' bytes. The words are only looked up when a chunk is
+// loaded, which happens on the prefetch threads.
+//
+// The vocabulary is read from the 'vocabulary' file, one word per line, the line giving the id. If the file
+// does not exist, it is built during the scan from the words of the corpus, most frequent first, and written
+// to that file, so that the next runs and the evaluation use the same ids.
+//
+// The sentences get 'beginSequence' and 'endSequence' added where they do not have them already. Words that
+// are not in the vocabulary are mapped to 'unk'. The word ids are exposed as one-hot sparse streams, which
+// can be fed to an embedding (Times) without expanding them:
+//   input = [
+//       features = [ dim = 0 ]                    # dimension is the size of the vocabulary if 0 or not given
+//       labels = [ labelType = "nextWord" ]       # optional, the word following the one of the features
+//   ]
+class LMSequenceDeserializer : public DataDeserializerBase
+{
+public:
+    explicit LMSequenceDeserializer(const Microsoft::MSR::CNTK::ConfigParameters& config);
+
+    std::vector<ChunkInfo> ChunkInfos() override;
+
+    void SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& result) override;
+
+    ChunkPtr GetChunk(ChunkIdType chunkId) override;
+
+    void WillNeedChunks(const std::vector<ChunkIdType>& chunkIds) override;
+
+private:
+    class LMSequenceChunk;
+
+    struct ChunkDescriptor
+    {
+        size_t m_firstSequence;
+        size_t m_numSequences;
+        size_t m_numSamples;
+    };
+
+    // Finds the sentences and builds the chunks. If 'wordCounts' is given, the words of the corpus are
+    // added to the vocabulary and counted.
+    void Index(size_t chunkSizeInBytes, std::vector<size_t>* wordCounts);
+
+    void LoadVocabulary(const std::wstring& path);
+
+    // Orders the vocabulary built by Index() by decreasing count and writes it to 'path'.
+    void WriteVocabulary(const std::wstring& path, std::vector<size_t>& wordCounts);
+
+    // Appends the ids of the words of the sentence, with the sentence boundaries, to 'ids'.
+    void Tokenize(size_t sequenceIndex, std::vector<SparseIndexType>& ids) const;
+
+    std::wstring m_fileName;
+    MemoryMappedFilePtr m_file;
+
+    HashedVocabulary m_vocabulary;
+    std::string m_beginSequence;
+    std::string m_endSequence;
+    std::string m_unk;
+    uint32_t m_beginSequenceId;
+    uint32_t m_endSequenceId;
+    uint32_t m_unkId;
+
+    // With a 'nextWord' stream, the sentence of n words gives n - 1 samples.
+    bool m_hasNextWord;
+
+    // Values of the one-hot samples, all ones, in the precision of the streams.
+    std::vector<char> m_ones;
+    size_t m_maxSequenceLength;
+
+    // Offset of each sentence in the file, followed by the end of the last one.
+    std::vector<size_t> m_sequenceOffsets;
+    std::vector<unsigned int> m_sequenceLengths;
+    std::vector<ChunkDescriptor> m_chunks;
+
+    unsigned int m_traceLevel;
+};
+
+}
@@ -0,0 +1,315 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "LibSVMBinaryDeserializer.h"
+#include <limits>
+#include "ReaderConstants.h"
+#include "SequenceData.h"
+#include "StringUtil.h"
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+// The chunk finds the arrays of each stream in its minibatches up front, a sequence is then a row of them.
+class LibSVMBinaryDeserializer::LibSVMChunk : public Chunk
+{
+public:
+    LibSVMChunk(const LibSVMBinaryDeserializer& parent, const ChunkDescriptor& descriptor)
+        : m_parent(parent), m_descriptor(descriptor),
+          m_holdingBuffer(parent.m_file, (uint8_t*)parent.m_file->Data())
+    {
+        const size_t numStreams = parent.m_streams.size();
+        m_batchFirstRows.reserve(descriptor.m_numBatches);
+        m_streamData.reserve(descriptor.m_numBatches * numStreams);
+
+        size_t firstRow = 0;
+        for (size_t b = descriptor.m_firstBatch; b < descriptor.m_firstBatch + descriptor.m_numBatches; ++b)
+        {
+            const auto& batch = parent.m_batches[b];
+            size_t offset = batch.m_offset + sizeof(int32_t);
+            for (size_t i = 0; i < numStreams; ++i)
+            {
+                StreamData data = {};
+                if (i < parent.m_numFeatures)
+                {
+                    int32_t nnz;
+                    memcpy(&nnz, parent.GetAddress(offset, sizeof(nnz)), sizeof(nnz));
+                    if (nnz < 0)
+                        RuntimeError("Invalid number of non zero values %d in the minibatch at offset %zu of '%ls'.", (int)nnz, batch.m_offset, parent.m_fileName.c_str());
+                    offset += sizeof(nnz);
+
+                    data.m_nnz = nnz;
+                    data.m_values = parent.GetAddress(offset, nnz * parent.m_elementSize);
+                    offset += nnz * parent.m_elementSize;
+                    data.m_rowIndices = (const SparseIndexType*)parent.GetAddress(offset, nnz * sizeof(int32_t));
+                    offset += nnz * sizeof(int32_t);
+                    data.m_columnStarts = (const int32_t*)parent.GetAddress(offset, (batch.m_numRows + 1) * sizeof(int32_t));
+                    offset += (batch.m_numRows + 1) * sizeof(int32_t);
+                }
+                else
+                {
+                    size_t size = batch.m_numRows * parent.m_streams[i].m_sampleLayout.TotalSize() * parent.m_elementSize;
+                    data.m_values = parent.GetAddress(offset, size);
+                    offset += size;
+                }
+                m_streamData.push_back(data);
+            }
+
+            if (offset > batch.m_offset + batch.m_size)
+                RuntimeError("The minibatch at offset %zu of '%ls' is larger than its entry in the offset table.", batch.m_offset, parent.m_fileName.c_str());
+
+            m_batchFirstRows.push_back(firstRow);
+            firstRow += batch.m_numRows;
+        }
+    }
+
+    void GetSequence(size_t sequenceIndex, vector<SequenceDataPtr>& result) override
+    {
+        if (sequenceIndex >= m_descriptor.m_numRows)
+            LogicError("Sequence index %zu is out of range of the chunk.", sequenceIndex);
+
+        size_t batch = upper_bound(m_batchFirstRows.begin(), m_batchFirstRows.end(), sequenceIndex) - m_batchFirstRows.begin() - 1;
+        size_t row = sequenceIndex - m_batchFirstRows[batch];
+        SequenceKey key { m_descriptor.m_firstRow + sequenceIndex, 0 };
+
+        const size_t numStreams = m_parent.m_streams.size();
+        for (size_t i = 0; i < numStreams; ++i)
+        {
+            const auto& stream = m_parent.m_streams[i];
+            const auto& data = m_streamData[batch * numStreams + i];
+            if (i < m_parent.m_numFeatures)
+            {
+                int32_t start = data.m_columnStarts[row], end = data.m_columnStarts[row + 1];
+                if (start < 0 || start > end || end > data.m_nnz)
+                    RuntimeError("Invalid column start %d..%d of the sequence %zu in '%ls'.", (int)start, (int)end, (size_t)key.m_sequence, m_parent.m_fileName.c_str());
+
+                auto sequence = make_shared<ExternalSparseSequenceData>(data.m_values + start * m_parent.m_elementSize, 1, stream.m_sampleLayout);
+                sequence->m_indices = const_cast<SparseIndexType*>(data.m_rowIndices + start);
+                sequence->m_totalNnzCount = end - start;
+                sequence->m_nnzCounts.push_back(end - start);
+                sequence->m_elementType = stream.m_elementType;
+                sequence->m_key = key;
+                sequence->m_holdingBuffer = m_holdingBuffer;
+                result.push_back(sequence);
+            }
+            else
+            {
+                size_t size = stream.m_sampleLayout.TotalSize() * m_parent.m_elementSize;
+                auto sequence = make_shared<ExternalDenseSequenceData>(data.m_values + row * size, 1, stream.m_sampleLayout);
+                sequence->m_elementType = stream.m_elementType;
+                sequence->m_key = key;
+                sequence->m_holdingBuffer = m_holdingBuffer;
+                result.push_back(sequence);
+            }
+        }
+    }
+
+private:
+    struct StreamData
+    {
+        const char* m_values;
+        const SparseIndexType* m_rowIndices; // sparse streams only
+        const int32_t* m_columnStarts;
+        int32_t m_nnz;
+    };
+
+    const LibSVMBinaryDeserializer& m_parent;
+    const ChunkDescriptor& m_descriptor;
+
+    // Keeps the file mapping alive while the sequences are used.
+    shared_ptr<uint8_t> m_holdingBuffer;
+
+    // Index of the first sequence of each minibatch in the chunk.
+    vector<size_t> m_batchFirstRows;
+
+    // Arrays of [batch * number of streams + stream].
+    vector<StreamData> m_streamData;
+};
+
+LibSVMBinaryDeserializer::LibSVMBinaryDeserializer(const ConfigParameters& config)
+    : DataDeserializerBase(true),
+      m_dataStart(0),
+      m_numFeatures(0)
+{
+    m_fileName = ToFixedWStringFromMultiByte(config(L"file"));
+    m_traceLevel = config(L"traceLevel", 1);
+
+    string precision = config.Find("precision", "float");
+    if (AreEqualIgnoreCase(precision, "double"))
+        m_elementSize = sizeof(double);
+    else if (AreEqualIgnoreCase(precision, "float"))
+        m_elementSize = sizeof(float);
+    else
+        InvalidArgument("Not supported precision '%s'. Expected 'double' or 'float'.", precision.c_str());
+
+    // As for the binary format, inputs of the file can be exposed under another name, given by the 'alias' of an input section.
+    map<wstring, wstring> rename;
+    if (config.ExistsCurrent(L"input"))
+    {
+        const ConfigParameters& input = config(L"input");
+        for (const pair<string, ConfigParameters>& section : input)
+        {
+            ConfigParameters sectionConfig = section.second;
+            if (sectionConfig.ExistsCurrent(L"alias"))
+                rename[ToFixedWStringFromMultiByte(sectionConfig(L"alias"))] = ToFixedWStringFromMultiByte(section.first);
+        }
+    }
+
+    m_file = make_shared<MemoryMappedFile>(m_fileName);
+    ReadHeader(rename);
+    BuildChunks(config(L"chunkSizeInBytes", g_32MB));
+
+    if (m_traceLevel > 0)
+        fprintf(stderr, "LibSVMBinaryDeserializer: %zu minibatches of '%ls' in %zu chunks\n", m_batches.size(), m_fileName.c_str(), m_chunks.size());
+}
+
+const char* LibSVMBinaryDeserializer::GetAddress(size_t offset, size_t size) const
+{
+    if (offset > m_file->Size() || size > m_file->Size() - offset)
+        RuntimeError("Unexpected end of file '%ls' at offset %zu.", m_fileName.c_str(), offset);
+    return m_file->Data() + offset;
+}
+
+void LibSVMBinaryDeserializer::ReadHeader(const map<wstring, wstring>& rename)
+{
+    size_t offset = 0;
+    auto read = [this, &offset](void* value, size_t size)
+    {
+        memcpy(value, GetAddress(offset, size), size);
+        offset += size;
+    };
+
+    int64_t numRows, numBatches;
+    int32_t numFeatures, numLabels;
+    read(&numRows, sizeof(numRows));
+    read(&numBatches, sizeof(numBatches));
+    read(&numFeatures, sizeof(numFeatures));
+    read(&numLabels, sizeof(numLabels));
+    if (numBatches < 0 || numFeatures < 0 || numLabels < 0)
+        RuntimeError("Invalid header of file '%ls'.", m_fileName.c_str());
+
+    DataType elementType = m_elementSize == sizeof(float) ? DataType::Float : DataType::Double;
+    for (int32_t i = 0; i < numFeatures + numLabels; ++i)
+    {
+        int32_t length, dimension;
+        read(&length, sizeof(length));
+        if (length < 0)
+            RuntimeError("Invalid header of file '%ls'.", m_fileName.c_str());
+        string name(GetAddress(offset, length), length);
+        offset += length;
+        read(&dimension, sizeof(dimension));
+        if (dimension <= 0)
+            RuntimeError("Invalid dimension %d of input '%s' in file '%ls'.", (int)dimension, name.c_str(), m_fileName.c_str());
+
+        StreamInformation stream;
+        stream.m_id = m_streams.size();
+        stream.m_name = ToFixedWStringFromMultiByte(name);
+        auto renamed = rename.find(stream.m_name);
+        if (renamed != rename.end())
+            stream.m_name = renamed->second;
+        stream.m_storageFormat = i < numFeatures ? StorageFormat::SparseCSC : StorageFormat::Dense;
+        stream.m_elementType = elementType;
+        stream.m_sampleLayout = NDShape({ (size_t)dimension });
+        m_streams.push_back(stream);
+    }
+    m_numFeatures = numFeatures;
+
+    // The offset table, the last minibatch ends with the file.
+    m_dataStart = offset + numBatches * sizeof(int64_t);
+    const char* offsets = GetAddress(offset, numBatches * sizeof(int64_t));
+    m_batches.reserve(numBatches);
+    for (int64_t i = 0; i < numBatches; ++i)
+    {
+        int64_t start, end;
+        memcpy(&start, offsets + i * sizeof(int64_t), sizeof(start));
+        if (i + 1 < numBatches)
+            memcpy(&end, offsets + (i + 1) * sizeof(int64_t), sizeof(end));
+        else
+            end = (int64_t)(m_file->Size() - m_dataStart);
+        if (start < 0 || end < start)
+            RuntimeError("Invalid offset of minibatch %d in file '%ls'.", (int)i, m_fileName.c_str());
+
+        BatchDescriptor batch;
+        batch.m_offset = m_dataStart + start;
+        batch.m_size = end - start;
+        int32_t rows;
+        memcpy(&rows, GetAddress(batch.m_offset, sizeof(rows)), sizeof(rows));
+        if (rows < 0)
+            RuntimeError("Invalid number of rows %d of minibatch %d in file '%ls'.", (int)rows, (int)i, m_fileName.c_str());
+        batch.m_numRows = rows;
+        m_batches.push_back(batch);
+    }
+}
+
+void LibSVMBinaryDeserializer::BuildChunks(size_t chunkSizeInBytes)
+{
+    size_t row = 0;
+    for (size_t i = 0; i < m_batches.size(); ++i)
+    {
+        // Empty minibatches do not start chunks.
+        if (m_chunks.empty() ||
+            (m_chunks.back().m_numRows > 0 && m_batches[i].m_offset + m_batches[i].m_size - m_batches[m_chunks.back().m_firstBatch].m_offset > chunkSizeInBytes))
+        {
+            if (m_chunks.size() >= numeric_limits<ChunkIdType>::max())
+                RuntimeError("Number of chunks exceeded overflow limit.");
+            m_chunks.push_back(ChunkDescriptor { i, 0, row, 0 });
+        }
+
+        auto& chunk = m_chunks.back();
+        chunk.m_numBatches++;
+        chunk.m_numRows += m_batches[i].m_numRows;
+        row += m_batches[i].m_numRows;
+    }
+
+    if (!m_chunks.empty() && m_chunks.back().m_numRows == 0)
+        m_chunks.pop_back();
+}
+
+vector<ChunkInfo> LibSVMBinaryDeserializer::ChunkInfos()
+{
+    vector<ChunkInfo> result;
+    result.reserve(m_chunks.size());
+    for (size_t i = 0; i < m_chunks.size(); ++i)
+        result.push_back(ChunkInfo { (ChunkIdType)i, m_chunks[i].m_numRows, m_chunks[i].m_numRows });
+    return result;
+}
+
+void LibSVMBinaryDeserializer::SequenceInfosForChunk(ChunkIdType chunkId, vector<SequenceInfo>& result)
+{
+    const auto& chunk = m_chunks[chunkId];
+    result.reserve(result.size() + chunk.m_numRows);
+    for (size_t i = 0; i < chunk.m_numRows; ++i)
+    {
+        SequenceInfo sequence = {};
+        sequence.m_indexInChunk = i;
+        sequence.m_numberOfSamples = 1;
+        sequence.m_chunkId = chunkId;
+        sequence.m_key.m_sequence = chunk.m_firstRow + i;
+        result.push_back(sequence);
+    }
+}
+
+ChunkPtr LibSVMBinaryDeserializer::GetChunk(ChunkIdType chunkId)
+{
+    return make_shared<LibSVMChunk>(*this, m_chunks.at(chunkId));
+}
+
+void LibSVMBinaryDeserializer::WillNeedChunks(const vector<ChunkIdType>& chunkIds)
+{
+    for (auto chunkId : chunkIds)
+    {
+        if (chunkId >= m_chunks.size())
+            continue;
+
+        const auto& first = m_batches[m_chunks[chunkId].m_firstBatch];
+        const auto& last = m_batches[m_chunks[chunkId].m_firstBatch + m_chunks[chunkId].m_numBatches - 1];
+        m_file->WillNeed(first.m_offset, last.m_offset + last.m_size - first.m_offset);
+    }
+}
+
+}
@@ -0,0 +1,78 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "DataDeserializerBase.h"
+#include "MemoryMappedFile.h"
+#include "Config.h"
+
+namespace CNTK {
+
+// Deserializer for the files of the LibSVMBinaryReader, so that they can be read by the composite reader
+// with its randomizers, caching and prefetching. The file is memory mapped and the sequences point into
+// the mapping. Each row of the file is a sequence of a single sample, the features are sparse and the labels dense.
+// Chunks are runs of consecutive minibatches of the file, of about 'chunkSizeInBytes' bytes.
+//
+// The layout of the file is:
+//   int64 numRows, int64 numBatches, int32 numFeatures, int32 numLabels
+//   for each feature, then each label: int32 nameLength, char name[nameLength], int32 dimension
+//   int64 batchOffsets[numBatches], relative to the end of this table
+//   for each batch: int32 numRows
+//     for each feature: int32 nnz, values[nnz], int32 rowIndices[nnz], int32 columnStarts[numRows + 1]
+//     for each label: values[numRows * dimension]
+// where the values are floats or doubles, as given by 'precision'.
+class LibSVMBinaryDeserializer : public DataDeserializerBase
+{
+public:
+    explicit LibSVMBinaryDeserializer(const Microsoft::MSR::CNTK::ConfigParameters& config);
+
+    std::vector<ChunkInfo> ChunkInfos() override;
+
+    void SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& result) override;
+
+    ChunkPtr GetChunk(ChunkIdType chunkId) override;
+
+    void WillNeedChunks(const std::vector<ChunkIdType>& chunkIds) override;
+
+private:
+    class LibSVMChunk;
+
+    struct BatchDescriptor
+    {
+        size_t m_offset;   // in the file
+        size_t m_size;
+        uint32_t m_numRows;
+    };
+
+    struct ChunkDescriptor
+    {
+        size_t m_firstBatch;
+        size_t m_numBatches;
+        size_t m_firstRow; // index of the first sequence of the chunk in the file
+        size_t m_numRows;
+    };
+
+    void ReadHeader(const std::map<std::wstring, std::wstring>& rename);
+    void BuildChunks(size_t chunkSizeInBytes);
+
+    // Returns the address of the given range of the file, which must lie within the file.
+    const char* GetAddress(size_t offset, size_t size) const;
+
+    std::wstring m_fileName;
+    MemoryMappedFilePtr m_file;
+    size_t m_dataStart;
+
+    // The first streams are the features, in the order of the file, the rest are the labels.
+    size_t m_numFeatures;
+    size_t m_elementSize;
+
+    std::vector<BatchDescriptor> m_batches;
+    std::vector<ChunkDescriptor> m_chunks;
+
+    unsigned int m_traceLevel;
+};
+
+}
@@ -12,7 +12,8 @@
 #include <utility>
 
 #include "DataReader.h"
-#include "ExceptionCapture.h"
+#include "ThreadPool.h"
+#include "ReaderStatistics.h"
 
 namespace CNTK {
 
@@ -24,7 +25,8 @@ BlockRandomizer::BlockRandomizer(
     bool multithreadedGetNextSequence,
     size_t maxNumberOfInvalidSequences,
     bool sampleBasedRandomizationWindow,
-    size_t seedOffset)
+    size_t seedOffset,
+    size_t maxNumberOfPrefetchedChunks)
     : m_verbosity(verbosity),
       m_deserializer(deserializer),
       m_sweep(SIZE_MAX),
@@ -34,12 +36,16 @@ BlockRandomizer::BlockRandomizer(
       m_sweepSizeInSamples(0),
       m_chunkRandomizer(std::make_shared<ChunkRandomizer>(deserializer, randomizationRange, sampleBasedRandomizationWindow)),
       m_multithreadedGetNextSequences(multithreadedGetNextSequence),
-      m_prefetchedChunk(ChunkIdMax),
+      m_maxNumberOfPrefetchedChunks(maxNumberOfPrefetchedChunks),
       m_cleaner(maxNumberOfInvalidSequences),
-      m_seedOffset(seedOffset)
+      m_seedOffset(seedOffset),
+      m_maxImbalance(0)
 {
     assert(deserializer != nullptr);
 
+    if (maxNumberOfPrefetchedChunks == 0)
+        InvalidArgument("The number of prefetched chunks must be at least 1.");
+
     m_launchType = shouldPrefetch ? launch::async : launch::deferred;
 
     m_streams = m_deserializer->StreamInfos();
@@ -64,6 +70,7 @@ void BlockRandomizer::StartEpoch(const EpochConfiguration& config)
     m_currentWindowRange = ClosedOpenChunkInterval{};
 
     m_config = config;
+    AssignChunksToWorkers();
     
     if (config.m_totalEpochSizeInSweeps != g_infinity)
     {
@@ -110,9 +117,15 @@ void BlockRandomizer::PrepareNewSweepIfNeeded(size_t samplePosition)
                     (int) sweep);
 
         m_sweep = sweep;
+        ScopeReaderStage stage(ReaderStage::Randomize);
 
-        // Rerandomizing the chunks.
+        // Rerandomizing the chunks, this takes over the chunks prepared during the previous sweep.
         m_chunkRandomizer->Randomize(m_seedOffset + m_sweep);
+        AssignChunksToWorkers();
+
+        // Preparing the next sweep meanwhile, its first chunks are prefetched at the end of this one.
+        if (m_launchType == launch::async)
+            m_chunkRandomizer->PrepareRandomization(m_seedOffset + m_sweep + 1);
 
         // Resetting sequence randomizer.
         m_sequenceRandomizer->Reset(m_seedOffset + m_sweep);
@@ -221,11 +234,11 @@ std::pair<size_t, size_t> BlockRandomizer::LoadSequenceData(size_t globalSampleC
 
     if (m_multithreadedGetNextSequences)
     {
-        ExceptionCapture capture;
-#pragma omp parallel for schedule(dynamic)
-        for (int i = 0; i < m_sequenceBuffer.size(); ++i)
-            capture.SafeRun(process, i);
-        capture.RethrowIfHappened();
+        Microsoft::MSR::CNTK::ThreadPool::Get().ParallelFor(0, m_sequenceBuffer.size(), 1, [&process](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                process((int)i);
+        });
     }
     else
     {
@@ -234,8 +247,15 @@ std::pair<size_t, size_t> BlockRandomizer::LoadSequenceData(size_t globalSampleC
     }
 
     // Now it is safe to start the new chunk prefetch.
-    ChunkIdType chunkToPrefetchNext = GetChunkToPrefetch(windowRange);
-    Prefetch(chunkToPrefetchNext);
+    Prefetch(GetChunksToPrefetch(windowRange, m_maxNumberOfPrefetchedChunks));
+
+    // Deserializers reading from remote storage can fetch ahead what the next window brings.
+    auto upcoming = GetChunksToPrefetch(windowRange, std::max<size_t>(windowRange.Size(), m_maxNumberOfPrefetchedChunks));
+    if (upcoming != m_announcedChunks)
+    {
+        m_deserializer->WillNeedChunks(upcoming);
+        m_announcedChunks = std::move(upcoming);
+    }
 
     return { numGlobalSamples, numLocalSamples };
 }
@@ -282,7 +302,7 @@ std::tuple<bool, bool, size_t, size_t> BlockRandomizer::GetNextSequenceDescripti
         [&, this](const RandomizedSequenceDescription& s)
     {
         auto sequenceLength = s.m_numberOfSamples;
-        bool isLocal = s.m_chunk->m_chunkId % m_config.m_numberOfWorkers == m_config.m_workerRank; 
+        bool isLocal = IsLocalChunk(*s.m_chunk);
 
         // TODO: should we just drop this flag and return false if we cannot fulfil this request?
         if (!atLeastOneSequenceNeeded) 
@@ -318,7 +338,10 @@ std::tuple<bool, bool, size_t, size_t> BlockRandomizer::GetNextSequenceDescripti
         return true;
     };
 
-    m_sequenceRandomizer->GetNextSequenceDescriptions(callback, windowRange);
+    {
+        ScopeReaderStage stage(ReaderStage::Randomize);
+        m_sequenceRandomizer->GetNextSequenceDescriptions(callback, windowRange);
+    }
 
     if (actualNumberOfLocalSamples > actualNumberOfGlobalSamples)
         LogicError("Local sample count cannot be greater than the global sample count.");
@@ -366,7 +389,7 @@ void BlockRandomizer::LoadDataChunks(const ClosedOpenChunkInterval& windowRange)
     for (size_t i = windowRange.m_begin; i < windowRange.m_end; ++i)
     {
         auto const& chunk = m_chunkRandomizer->GetRandomizedChunks()[i];
-        if (chunk.m_chunkId % m_config.m_numberOfWorkers != m_config.m_workerRank)
+        if (!IsLocalChunk(chunk))
         {
             continue;
         }
@@ -395,10 +418,12 @@ void BlockRandomizer::LoadDataChunks(const ClosedOpenChunkInterval& windowRange)
         }
 
         auto const& chunk = m_chunkRandomizer->GetRandomizedChunks()[i];
-        if (chunk.m_original->m_id == m_prefetchedChunk && m_prefetch.valid())
+        auto prefetched = m_prefetches.find(chunk.m_original->m_id);
+        if (prefetched != m_prefetches.end())
         {
             // Taking prefetched chunk.
-            m_chunks[chunk.m_original->m_id] = m_prefetch.get();
+            m_chunks[chunk.m_original->m_id] = prefetched->second.get();
+            m_prefetches.erase(prefetched);
             if (m_verbosity >= Information)
                 fprintf(stderr, "BlockRandomizer::RetrieveDataChunks: paged in prefetched chunk %u (original chunk: %u), now %" PRIu64 " chunks in memory\n",
                 chunk.m_chunkId,
@@ -407,12 +432,12 @@ void BlockRandomizer::LoadDataChunks(const ClosedOpenChunkInterval& windowRange)
         }
         else
         {
-            // Make sure we have no outstanding prefetches.
-            if (m_prefetch.valid())
-            {
-                m_prefetch.wait();
-            }
+            // Make sure we have no outstanding prefetches, unless
+            // the deserializer was configured to load chunks concurrently.
+            if (m_maxNumberOfPrefetchedChunks == 1)
+                WaitForPrefetches();
 
+            ScopeReaderStage stage(ReaderStage::GetChunk);
             m_chunks[chunk.m_original->m_id] = m_deserializer->GetChunk(chunk.m_original->m_id);
             if (m_verbosity >= Information)
                 fprintf(stderr, "BlockRandomizer::RetrieveDataChunks: paged in randomized chunk %u (original chunk: %u), now %" PRIu64 " chunks in memory\n",
@@ -429,45 +454,101 @@ void BlockRandomizer::LoadDataChunks(const ClosedOpenChunkInterval& windowRange)
                 m_chunkRandomizer->GetRandomizedChunks()[windowRange.m_end - 1].m_chunkId);
 }
 
-// Identifies chunk id that should be prefetched.
-ChunkIdType BlockRandomizer::GetChunkToPrefetch(const ClosedOpenChunkInterval& windowRange)
+// Identifies chunk ids that should be prefetched.
+std::vector<ChunkIdType> BlockRandomizer::GetChunksToPrefetch(const ClosedOpenChunkInterval& windowRange, size_t maxNumberOfChunks)
 {
-    ChunkIdType toBePrefetched = ChunkIdMax;
+    std::vector<ChunkIdType> toBePrefetched;
     auto current = windowRange.m_end;
-    while (current < m_chunkRandomizer->GetRandomizedChunks().size())
+    while (current < m_chunkRandomizer->GetRandomizedChunks().size() &&
+           toBePrefetched.size() < maxNumberOfChunks)
     {
         const auto& chunk = m_chunkRandomizer->GetRandomizedChunks()[current];
-        if (chunk.m_chunkId % m_config.m_numberOfWorkers == m_config.m_workerRank &&
-            m_chunks.find(chunk.m_original->m_id) == m_chunks.end())
+        if (IsLocalChunk(chunk) &&
+            m_chunks.find(chunk.m_original->m_id) == m_chunks.end() &&
+            std::find(toBePrefetched.begin(), toBePrefetched.end(), chunk.m_original->m_id) == toBePrefetched.end())
         {
-            toBePrefetched = chunk.m_original->m_id;
-            break;
+            toBePrefetched.push_back(chunk.m_original->m_id);
         }
         ++current;
     }
+
+    // At the end of the sweep, continue with the chunks the next sweep starts with.
+    // Prefetches are identified by original chunk ids, so they are taken over in the next sweep.
+    const std::vector<RandomizedChunk>* nextSweepChunks = nullptr;
+    if (toBePrefetched.size() < maxNumberOfChunks && (nextSweepChunks = GetNextSweepChunks()) != nullptr)
+    {
+        for (size_t i = 0; i < nextSweepChunks->size() && toBePrefetched.size() < maxNumberOfChunks; ++i)
+        {
+            const auto& chunk = (*nextSweepChunks)[i];
+            if (m_nextSweepChunkOwners[i] == m_config.m_workerRank &&
+                m_chunks.find(chunk.m_original->m_id) == m_chunks.end() &&
+                std::find(toBePrefetched.begin(), toBePrefetched.end(), chunk.m_original->m_id) == toBePrefetched.end())
+            {
+                toBePrefetched.push_back(chunk.m_original->m_id);
+            }
+        }
+    }
     return toBePrefetched;
 }
 
-// Performs io prefetch of the specified chunk if needed.
-void BlockRandomizer::Prefetch(ChunkIdType chunkId)
+const std::vector<RandomizedChunk>* BlockRandomizer::GetNextSweepChunks()
+{
+    if (m_launchType != launch::async || m_sweep == SIZE_MAX)
+        return nullptr;
+
+    // Typically finished long ago, the preparation started with the current sweep.
+    auto chunks = m_chunkRandomizer->GetPreparedChunks(m_seedOffset + m_sweep + 1);
+    if (chunks && m_nextSweepChunkOwners.size() != chunks->size())
+        AssignChunksToWorkers(*chunks, m_nextSweepChunkOwners);
+    return chunks;
+}
+
+// Performs io prefetch of the specified chunks if needed.
+void BlockRandomizer::Prefetch(const std::vector<ChunkIdType>& chunkIds)
 {
-    // Start new prefetch if necessary.
-    if (m_prefetchedChunk != chunkId && chunkId != ChunkIdMax)
+    // Drop prefetches that are not needed anymore, to stay within the bound.
+    for (auto it = m_prefetches.begin(); it != m_prefetches.end();)
     {
-        // Wait to make sure there is no outstanding prefetches.
-        if (m_prefetch.valid())
+        if (std::find(chunkIds.begin(), chunkIds.end(), it->first) == chunkIds.end())
         {
-            m_prefetch.wait();
+            if (it->second.valid())
+                it->second.wait();
+            it = m_prefetches.erase(it);
         }
+        else
+            ++it;
+    }
 
-        m_prefetchedChunk = chunkId;
-        m_prefetch = std::async(m_launchType, [this, chunkId]() { return m_deserializer->GetChunk(chunkId); });
+    // Start new prefetches if necessary.
+    for (auto chunkId : chunkIds)
+    {
+        if (m_prefetches.find(chunkId) != m_prefetches.end())
+            continue;
+
+        auto getChunk = [this, chunkId]()
+        {
+            ScopeReaderStage stage(ReaderStage::GetChunk);
+            return m_deserializer->GetChunk(chunkId);
+        };
+        if (m_launchType == launch::async)
+            m_prefetches[chunkId] = Microsoft::MSR::CNTK::ThreadPool::Get().Async(getChunk); // on the shared pool, not a new thread per chunk
+        else
+            m_prefetches[chunkId] = std::async(launch::deferred, getChunk);
 
         if (m_verbosity >= Debug)
             fprintf(stderr, "BlockRandomizer::Prefetch: prefetching original chunk: %u\n", chunkId);
     }
 }
 
+void BlockRandomizer::WaitForPrefetches()
+{
+    for (auto& prefetch : m_prefetches)
+    {
+        if (prefetch.second.valid())
+            prefetch.second.wait();
+    }
+}
+
 void BlockRandomizer::SetState(const std::map<std::wstring, size_t>& state)
 {
     auto it = state.find(g_minibatchSourcePosition);
@@ -494,6 +575,89 @@ void BlockRandomizer::SetConfiguration(const ReaderConfiguration& config)
     m_currentWindowRange = ClosedOpenChunkInterval{};
 
     *((ReaderConfiguration*)&m_config) = config;
+    AssignChunksToWorkers();
+}
+
+void BlockRandomizer::SetChunkAffinity(ChunkAffinity affinity, double maxImbalance)
+{
+    if (maxImbalance < 0)
+        InvalidArgument("The maximum imbalance of the chunk assignment must not be negative.");
+
+    m_chunkAffinity = affinity;
+    m_maxImbalance = maxImbalance;
+    m_currentWindowRange = ClosedOpenChunkInterval{};
+    AssignChunksToWorkers();
+}
+
+void BlockRandomizer::AssignChunksToWorkers()
+{
+    AssignChunksToWorkers(m_chunkRandomizer->GetRandomizedChunks(), m_chunkOwners);
+
+    // The next sweep is assigned again when needed, with the current configuration.
+    m_nextSweepChunkOwners.clear();
+}
+
+void BlockRandomizer::AssignChunksToWorkers(const std::vector<RandomizedChunk>& chunks, std::vector<size_t>& owners) const
+{
+    size_t numberOfWorkers = std::max<size_t>(m_config.m_numberOfWorkers, 1);
+
+    owners.resize(chunks.size());
+    if (!m_chunkAffinity || numberOfWorkers == 1)
+    {
+        for (size_t i = 0; i < chunks.size(); ++i)
+            owners[i] = chunks[i].m_chunkId % numberOfWorkers;
+        return;
+    }
+
+    // The assignment only depends on the randomized chunks and the affinity, so all workers compute the same.
+    std::vector<size_t> assignedSamples(numberOfWorkers, 0);
+    size_t totalSamples = 0, numPreferred = 0;
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        size_t chunkSamples = chunks[i].m_original->m_numberOfSamples;
+        totalSamples += chunkSamples;
+        double bound = (1 + m_maxImbalance) * totalSamples / numberOfWorkers;
+
+        size_t owner = m_chunkAffinity(*chunks[i].m_original, numberOfWorkers);
+        if (owner < numberOfWorkers && assignedSamples[owner] <= bound)
+            numPreferred++;
+        else
+            owner = std::min_element(assignedSamples.begin(), assignedSamples.end()) - assignedSamples.begin();
+
+        owners[i] = owner;
+        assignedSamples[owner] += chunkSamples;
+    }
+
+    if (m_verbosity >= Notification)
+        fprintf(stderr, "BlockRandomizer::AssignChunksToWorkers: %" PRIu64 " of %" PRIu64 " chunks assigned to their preferred worker\n",
+                numPreferred, chunks.size());
+}
+
+ChunkAffinity CreateFileToHostChunkAffinity(
+    const std::vector<std::wstring>& chunkFiles,
+    const std::map<std::wstring, std::wstring>& fileToHost,
+    const std::vector<std::wstring>& workerHosts)
+{
+    // Workers of every host, by rank.
+    std::map<std::wstring, std::vector<size_t>> hostWorkers;
+    for (size_t rank = 0; rank < workerHosts.size(); ++rank)
+        hostWorkers[workerHosts[rank]].push_back(rank);
+
+    return [chunkFiles, fileToHost, hostWorkers, numberOfHostWorkers = workerHosts.size()](const ChunkInfo& chunk, size_t numberOfWorkers)
+    {
+        if (numberOfWorkers != numberOfHostWorkers || chunk.m_id >= chunkFiles.size())
+            return ChunkAffinityNone;
+
+        auto host = fileToHost.find(chunkFiles[chunk.m_id]);
+        if (host == fileToHost.end())
+            return ChunkAffinityNone;
+
+        auto workers = hostWorkers.find(host->second);
+        if (workers == hostWorkers.end())
+            return ChunkAffinityNone;
+
+        return workers->second[chunk.m_id % workers->second.size()];
+    };
 }
 
 }
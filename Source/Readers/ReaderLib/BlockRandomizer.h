@@ -6,6 +6,9 @@
 #pragma once
 
 #include <vector>
+#include <functional>
+#include <map>
+#include <string>
 
 #include "SequenceEnumerator.h"
 #include "DataDeserializer.h"
@@ -16,6 +19,20 @@
 
 namespace CNTK {
 
+// Preferred worker of an original chunk for locality-aware decimation, given the number of workers,
+// or ChunkAffinityNone if the chunk has no preferred worker.
+// It must return the same result on all workers, because every worker computes the assignment of all chunks.
+typedef std::function<size_t(const ChunkInfo& chunk, size_t numberOfWorkers)> ChunkAffinity;
+static const size_t ChunkAffinityNone = SIZE_MAX;
+
+// Creates a chunk affinity that prefers the workers running on the host where the file of a chunk is stored or cached.
+// Chunks of a host with several workers are spread over them round-robin. Chunks of files or hosts not in the maps,
+// and all chunks when the number of workers differs from the number of worker hosts, have no preferred worker.
+ChunkAffinity CreateFileToHostChunkAffinity(
+    const std::vector<std::wstring>& chunkFiles,               // file of every original chunk, by chunk id
+    const std::map<std::wstring, std::wstring>& fileToHost,    // host every file is stored on or cached near
+    const std::vector<std::wstring>& workerHosts);             // host of every worker, by worker rank
+
 // A randomizer that firstly randomizes chunks and then sequences inside a rolling window of chunks.
 // Uses ChunkRandomizer to randomize chunk descriptions and SequenceRandomizer to randomize sequence descriptions inside a window of chunks.
 // It requires only a window of sequence descriptions and corresponding chunk data.
@@ -23,7 +40,8 @@ namespace CNTK {
 // The high-level algorithm is:
 //     When next sequences are requested (limited by the sampleCount), the following steps are performed:
 //         1) if a new sweep is entered, randomize chunk descriptions using ChunkRandomizer, also precalculate randomization windows for all
-//            chunk descriptions
+//            chunk descriptions. With prefetch, the chunks of the next sweep are randomized in the background meanwhile, so that
+//            the prefetch of chunks goes on across the sweep boundary into the first window of the next sweep.
 //         2) if a new chunk is entered, using SequenceRandomizer identify a window of chunks and requested their sequence descriptions from deserializer.
 //         3) randomize sequence descriptions inside the window
 //         4) return sequence descriptions not exceeding sampleCount/minibatch limit
@@ -32,6 +50,9 @@ namespace CNTK {
 //
 // This class is responsible for decimation and loading the data chunks in to memory.
 // Actual randomization happens in ChunkRandomizer and SequenceRandomizer.
+// By default randomized chunk i is read by worker i % numberOfWorkers. With a chunk affinity (see SetChunkAffinity)
+// the chunks are assigned to their preferred workers instead, as long as the imbalance stays bounded; this keeps every
+// worker on the same files across sweeps, so that the page cache and the chunk cache stay effective.
 // TODO: The behavior can be simplified by only randomizing sequences forward.
 class BlockRandomizer : public SequenceEnumerator
 {
@@ -44,7 +65,8 @@ public:
         bool multithreadedGetNextSequences = false,
         size_t maxNumberOfInvalidSequences = 0, // per worker
         bool sampleBasedRandomizationWindow = true,
-        size_t seedOffset = 0);
+        size_t seedOffset = 0,
+        size_t maxNumberOfPrefetchedChunks = 1);
 
     // Starts a new epoch.
     virtual void StartEpoch(const EpochConfiguration& config) override;
@@ -65,17 +87,34 @@ public:
 
     ~BlockRandomizer()
     {
-        if (m_prefetch.valid())
-        {
-            m_prefetch.wait();
-        }
+        WaitForPrefetches();
     }
 
     void SetState(const std::map<std::wstring, size_t>& state) override;
 
     void SetConfiguration(const ReaderConfiguration& config) override;
 
+    // Enables locality-aware decimation. Going through the chunks of a sweep in randomized order, a chunk is assigned
+    // to its preferred worker unless the worker already has more than (1 + maxImbalance) times the average number of
+    // samples assigned so far, otherwise to the worker that has the fewest samples. So no worker gets more than that bound
+    // plus a chunk at any point of the sweep. The default affinity-less behavior is restored by passing nullptr.
+    void SetChunkAffinity(ChunkAffinity affinity, double maxImbalance = 0.1);
+
 private:
+    // Whether the randomized chunk is read by this worker.
+    bool IsLocalChunk(const RandomizedChunk& chunk) const
+    {
+        return m_chunkOwners[chunk.m_chunkId] == m_config.m_workerRank;
+    }
+
+    // Assigns the randomized chunks of the current sweep to the workers.
+    void AssignChunksToWorkers();
+    void AssignChunksToWorkers(const std::vector<RandomizedChunk>& chunks, std::vector<size_t>& owners) const;
+
+    // Gets the randomized chunks of the next sweep prepared in the background and assigns them to the workers,
+    // or returns nullptr if they are not prepared.
+    const std::vector<RandomizedChunk>* GetNextSweepChunks();
+
     // Load data for chunks if needed.
     void LoadDataChunks(const ClosedOpenChunkInterval& windowRange);
 
@@ -97,11 +136,15 @@ private:
     // Prepares a new sweep if needed.
     void PrepareNewSweepIfNeeded(size_t samplePosition);
 
-    // Performs io prefetch of the specified chunk if needed.
-    void Prefetch(ChunkIdType chunkId);
+    // Performs io prefetch of the specified chunks if needed,
+    // outstanding prefetches of other chunks are dropped.
+    void Prefetch(const std::vector<ChunkIdType>& chunkIds);
+
+    // Returns at most 'maxNumberOfChunks' next candidates for the prefetch after the given range.
+    std::vector<ChunkIdType> GetChunksToPrefetch(const ClosedOpenChunkInterval& windowRange, size_t maxNumberOfChunks);
 
-    // Returns next candidate for the prefetch in the given range.
-    ChunkIdType GetChunkToPrefetch(const ClosedOpenChunkInterval& windowRange);
+    // Waits for all outstanding prefetches.
+    void WaitForPrefetches();
 
     // Global sample position on the timeline.
     size_t m_globalSamplePosition;
@@ -129,6 +172,16 @@ private:
     // Chunk randomizer.
     ChunkRandomizerPtr m_chunkRandomizer;
 
+    // Worker of every randomized chunk of the current sweep.
+    std::vector<size_t> m_chunkOwners;
+
+    // Worker of every randomized chunk of the next sweep, empty until the next sweep is prepared.
+    std::vector<size_t> m_nextSweepChunkOwners;
+
+    // Locality-aware decimation, see SetChunkAffinity().
+    ChunkAffinity m_chunkAffinity;
+    double m_maxImbalance;
+
     // Sequence randomizer.
     SequenceRandomizerPtr m_sequenceRandomizer;
 
@@ -153,12 +206,16 @@ private:
 
     int m_verbosity;
 
-    // Prefetch future.
-    std::future<ChunkPtr> m_prefetch;
+    // Prefetch futures by original chunk id.
+    std::map<ChunkIdType, std::future<ChunkPtr>> m_prefetches;
     // Whether to have async or deferred prefetch.
     launch m_launchType;
-    // Prefetched original chunk id.
-    ChunkIdType m_prefetchedChunk;
+    // Maximum number of chunks that are prefetched at the same time. When bigger than one,
+    // the deserializer must support concurrent GetChunk calls.
+    size_t m_maxNumberOfPrefetchedChunks;
+
+    // Chunks last passed to WillNeedChunks() of the deserializer.
+    std::vector<ChunkIdType> m_announcedChunks;
 
     // Current loaded chunks.
     ClosedOpenChunkInterval m_currentWindowRange;
@@ -0,0 +1,156 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include "BucketingSequencePacker.h"
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+
+BucketingSequencePacker::BucketingSequencePacker(
+    SequenceEnumeratorPtr sequenceEnumerator,
+    const std::vector<StreamInformation>& streams,
+    size_t windowSizeInSamples,
+    size_t numberOfBuffers,
+    bool useLocalTimeline,
+    CorpusDescriptorPtr corpus,
+    int verbosity)
+    : SequencePacker(sequenceEnumerator, streams, numberOfBuffers, useLocalTimeline, corpus),
+      m_windowSizeInSamples(windowSizeInSamples),
+      m_verbosity(verbosity),
+      m_endOfEpoch(false),
+      m_numPackedSamples(0),
+      m_numPackedFrames(0)
+{
+    if (m_windowSizeInSamples == 0)
+        InvalidArgument("BucketingSequencePacker: the window size must be positive.");
+}
+
+void BucketingSequencePacker::SetConfiguration(const ReaderConfiguration& config, const std::vector<MemoryProviderPtr>& memoryProviders)
+{
+    SequencePacker::SetConfiguration(config, memoryProviders);
+    Reset();
+    m_numPackedSamples = 0;
+    m_numPackedFrames = 0;
+}
+
+void BucketingSequencePacker::Reset()
+{
+    m_minibatches.clear();
+    m_endOfEpoch = false;
+}
+
+double BucketingSequencePacker::GetPackingEfficiency() const
+{
+    return m_numPackedFrames == 0 ? 1.0 : (double)m_numPackedSamples / m_numPackedFrames;
+}
+
+Minibatch BucketingSequencePacker::ReadMinibatch()
+{
+    if (m_minibatches.empty())
+        FillWindow();
+
+    Sequences sequences = std::move(m_minibatches.front());
+    m_minibatches.pop_front();
+
+    Minibatch minibatch = PackSequences(sequences);
+    for (const auto& stream : minibatch.m_data)
+    {
+        m_numPackedSamples += stream->m_layout->GetActualNumSamples();
+        m_numPackedFrames += stream->m_layout->GetNumCols();
+    }
+
+    if (minibatch.m_endOfEpoch && m_verbosity > 0)
+        fprintf(stderr, "BucketingSequencePacker: packing efficiency %.1f%% (%zu samples in %zu frames).\n",
+                100.0 * GetPackingEfficiency(), m_numPackedSamples, m_numPackedFrames);
+
+    return minibatch;
+}
+
+void BucketingSequencePacker::FillWindow()
+{
+    assert(m_minibatches.empty());
+    const size_t numStreams = m_outputStreamDescriptions.size();
+
+    // Sequences of the window, each with its data in all streams.
+    std::vector<std::vector<SequenceDataPtr>> window;
+    std::vector<size_t> lengths;
+    size_t windowSizeInSamples = 0;
+    bool endOfSweep = false;
+    while (!m_endOfEpoch && !endOfSweep && windowSizeInSamples < m_windowSizeInSamples)
+    {
+        auto sequences = m_sequenceEnumerator->GetNextSequences(m_globalMinibatchSizeInSamples, m_localMinibatchSizeInSamples);
+        endOfSweep = sequences.m_endOfSweep;
+        m_endOfEpoch = sequences.m_endOfEpoch;
+        if (sequences.m_data.empty() || sequences.m_data.front().empty())
+        {
+            if (!endOfSweep && !m_endOfEpoch)
+                break; // nothing left for this worker
+            continue;
+        }
+
+        assert(sequences.m_data.size() == numStreams);
+        for (size_t i = 0; i < sequences.m_data.front().size(); ++i)
+        {
+            std::vector<SequenceDataPtr> sequence(numStreams);
+            size_t length = 0;
+            for (size_t stream = 0; stream < numStreams; ++stream)
+            {
+                sequence[stream] = sequences.m_data[stream][i];
+                length = std::max(length, (size_t)sequence[stream]->m_numberOfSamples);
+            }
+            window.push_back(std::move(sequence));
+            lengths.push_back(length);
+            windowSizeInSamples += length;
+        }
+    }
+
+    // Sequences of similar length go together.
+    std::vector<size_t> order(window.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&lengths](size_t a, size_t b) { return lengths[a] < lengths[b]; });
+
+    // Local timeline minibatch sizes are per worker already, global ones are shared by the workers.
+    const size_t minibatchSize = m_useLocalTimeline ?
+        m_localMinibatchSizeInSamples :
+        std::max<size_t>(1, m_config.m_minibatchSizeInSamples / m_config.m_numberOfWorkers);
+
+    Sequences current;
+    current.m_data.resize(numStreams);
+    size_t currentSize = 0;
+    for (size_t index : order)
+    {
+        if (currentSize > 0 && currentSize + lengths[index] > minibatchSize)
+        {
+            m_minibatches.push_back(std::move(current));
+            current = Sequences();
+            current.m_data.resize(numStreams);
+            currentSize = 0;
+        }
+
+        for (size_t stream = 0; stream < numStreams; ++stream)
+            current.m_data[stream].push_back(window[index][stream]);
+        currentSize += lengths[index];
+    }
+
+    if (currentSize > 0)
+        m_minibatches.push_back(std::move(current));
+
+    // Otherwise the longest sequences would always come last in a window.
+    std::shuffle(m_minibatches.begin(), m_minibatches.end(), m_rng);
+
+    // The flags of the window belong to its last minibatch; an empty one carries them if the window is empty.
+    if (m_minibatches.empty())
+        m_minibatches.push_back(Sequences());
+    m_minibatches.back().m_endOfSweep = endOfSweep;
+    m_minibatches.back().m_endOfEpoch = m_endOfEpoch;
+}
+
+}
@@ -0,0 +1,73 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <deque>
+#include <random>
+#include "SequencePacker.h"
+
+namespace CNTK {
+
+// A sequence packer that reduces the gaps in minibatches of sequences with very different lengths.
+// It reads a window of sequences from the enumerator (in randomized order), sorts the window by
+// sequence length and cuts it into minibatches of sequences with similar lengths, each of at most
+// the minibatch size in samples. A sequence longer than that makes a minibatch on its own.
+// The minibatches of a window are returned in a random order.
+//
+// Randomization: every sequence is still returned exactly once per sweep, and sequences only move
+// within their window, so a window of W samples delays or advances a sequence by at most W samples
+// relative to the randomizer. What changes is the composition of the minibatches: they are drawn
+// from a length band of the window rather than uniformly, and the larger W is compared to the
+// minibatch size, the narrower these bands are and the more minibatches are correlated with length.
+// A window of a few tens of minibatches removes most of the padding, keeping W well below the
+// randomization window keeps the order of the data dominated by the randomizer.
+// The window never crosses a sweep or epoch end, so epoch sizes and sweep boundaries are unchanged.
+// Positions saved by checkpoints are the positions of the enumerator: at the end of an epoch they are
+// exact, within an epoch the sequences buffered in the current window are skipped after a restore.
+class BucketingSequencePacker : public SequencePacker
+{
+public:
+    BucketingSequencePacker(
+        SequenceEnumeratorPtr sequenceEnumerator,
+        const std::vector<StreamInformation>& streams,
+        size_t windowSizeInSamples,
+        size_t numberOfBuffers = 2,
+        bool useLocalTimeline = false,
+        CorpusDescriptorPtr corpus = nullptr,
+        int verbosity = 0);
+
+    virtual Minibatch ReadMinibatch() override;
+
+    void SetConfiguration(const ReaderConfiguration& config, const std::vector<MemoryProviderPtr>& memoryProviders) override;
+
+    virtual void Reset() override;
+
+    // Share of the packed frames that contain samples rather than gaps, since the start of the epoch.
+    double GetPackingEfficiency() const;
+
+private:
+    // Reads the next window of sequences and cuts it into minibatches.
+    void FillWindow();
+
+    const size_t m_windowSizeInSamples;
+    const int m_verbosity;
+
+    // Minibatches of the current window that have not been returned yet.
+    std::deque<Sequences> m_minibatches;
+
+    // Whether the enumerator has returned the end of the epoch.
+    bool m_endOfEpoch;
+
+    // Orders the minibatches of a window.
+    std::mt19937_64 m_rng;
+
+    size_t m_numPackedSamples;
+    size_t m_numPackedFrames;
+};
+
+typedef std::shared_ptr<BucketingSequencePacker> BucketingSequencePackerPtr;
+
+}
@@ -10,8 +10,8 @@ namespace CNTK {
 
     using namespace std;
 
-    BufferedFileReader::BufferedFileReader(size_t maxSize, const FileWrapper& file) 
-        : m_maxSize(maxSize), m_file(file)
+    BufferedFileReader::BufferedFileReader(size_t maxSize, const FileWrapper& file, bool readAhead) 
+        : m_maxSize(maxSize), m_file(file), m_readAhead(readAhead)
     {
         m_file.CheckIsOpenOrDie();
 
@@ -20,25 +20,102 @@ namespace CNTK {
 
         m_buffer.reserve(maxSize);
 
+        // Reading ahead only pays off for files that span several buffers.
+        if (m_readAhead && m_file.Filesize() > maxSize)
+            m_file.AdviseSequential();
+
         Refill();
     }
 
+    BufferedFileReader::~BufferedFileReader()
+    {
+        // The background read uses the buffers and the file, let it finish.
+        if (m_pendingRead.valid())
+            m_pendingRead.wait();
+    }
+
     void BufferedFileReader::Refill()
     {
         if (m_done)
             return;
 
         m_index = 0;
-        m_fileOffset = m_file.TellOrDie();
 
-        m_buffer.resize(m_maxSize);
-        size_t bytesRead = m_file.Read(m_buffer.data(), 1, m_maxSize);
+        if (m_pendingRead.valid())
+        {
+            // The next block has been (or is being) read in the background.
+            size_t bytesRead = WaitForReadAhead();
+            m_buffer.swap(m_nextBuffer);
+            m_fileOffset = m_nextFileOffset;
+            m_done = (bytesRead == 0);
+        }
+        else
+        {
+            m_fileOffset = m_file.TellOrDie();
+
+            m_buffer.resize(m_maxSize);
+            size_t bytesRead = m_file.Read(m_buffer.data(), 1, m_maxSize);
+
+            if (bytesRead != m_maxSize && !m_file.ReachedEOF())
+                RuntimeError("Error reading file '%ls': %s.", m_file.Filename().c_str(), strerror(errno));
+
+            m_buffer.resize(bytesRead);
+            m_done = (bytesRead == 0);
+        }
+
+        StartReadAhead();
+    }
+
+    void BufferedFileReader::Seek(size_t fileOffset)
+    {
+        if (m_pendingRead.valid())
+        {
+            // The file position is only known once the pending read is over.
+            size_t bytesRead = WaitForReadAhead();
+            if (fileOffset >= m_nextFileOffset && fileOffset < m_nextFileOffset + bytesRead)
+            {
+                // Moving forward into the block that has been read ahead.
+                m_buffer.swap(m_nextBuffer);
+                m_fileOffset = m_nextFileOffset;
+                m_index = fileOffset - m_fileOffset;
+                m_done = false;
+                StartReadAhead();
+                return;
+            }
+        }
+
+        m_file.SeekOrDie(fileOffset, SEEK_SET);
+        Reset();
+    }
+
+    void BufferedFileReader::StartReadAhead()
+    {
+        // A short buffer means that the EOF has been reached.
+        if (!m_readAhead || m_done || m_buffer.size() < m_maxSize)
+            return;
+
+        m_nextFileOffset = m_fileOffset + m_buffer.size();
+        if (m_nextFileOffset >= m_readAheadLimit)
+            return;
+
+        // The file position is at m_nextFileOffset, right after the current buffer.
+        m_pendingRead = std::async(std::launch::async, [this]()
+        {
+            m_nextBuffer.resize(m_maxSize);
+            size_t bytesRead = m_file.Read(m_nextBuffer.data(), 1, m_maxSize);
+
+            if (bytesRead != m_maxSize && !m_file.ReachedEOF())
+                RuntimeError("Error reading file '%ls': %s.", m_file.Filename().c_str(), strerror(errno));
+
+            m_nextBuffer.resize(bytesRead);
+            return bytesRead;
+        });
+    }
 
-        if (bytesRead != m_maxSize && !m_file.ReachedEOF())
-            RuntimeError("Error reading file '%ls': %s.", m_file.Filename().c_str(), strerror(errno));
-        
-        m_buffer.resize(bytesRead);
-        m_done = (bytesRead == 0);
+    size_t BufferedFileReader::WaitForReadAhead()
+    {
+        // get() rethrows the error of the background read, and invalidates the future.
+        return m_pendingRead.valid() ? m_pendingRead.get() : 0;
     }
 
     bool BufferedFileReader::TryMoveToNextLine()
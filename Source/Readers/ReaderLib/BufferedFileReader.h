@@ -8,15 +8,21 @@
 #include <stdint.h>
 #include <vector>
 #include <memory>
+#include <future>
 #include "ReaderConstants.h"
 #include "FileWrapper.h"
 
 namespace CNTK {
 
+// Reads a file through a buffer of up to 'maxSize' bytes. With 'readAhead', the reader is double-buffered:
+// while the current buffer is consumed, the next block of the file is read on a background thread, so that
+// parsing and I/O overlap. The file must not be accessed by others while the reader is in use then.
 class BufferedFileReader
 {
 public:
-    BufferedFileReader(size_t maxSize, const FileWrapper& file);
+    BufferedFileReader(size_t maxSize, const FileWrapper& file, bool readAhead = false);
+
+    ~BufferedFileReader();
 
     // File offset that correspond to the current position.
     inline size_t GetFileOffset() const { return m_fileOffset + m_index; }
@@ -59,6 +65,22 @@ public:
         return true;
     }
 
+    // Returns a pointer to the current position. Available() characters can be read
+    // from there on without a refill.
+    inline const char* Current() const { return m_buffer.data() + m_index; }
+
+    inline size_t Available() const { return m_done ? 0 : m_buffer.size() - m_index; }
+
+    // Advances the current position by 'count' characters, at most Available().
+    // The skipped characters must not contain an EOL, since the line number is not updated.
+    inline void Skip(size_t count)
+    {
+        assert(count <= Available());
+        m_index += count;
+        if (m_index == m_buffer.size())
+            Refill();
+    }
+
     // Moves the current position to the next line (the position following an EOL delimiter).
     // Returns true, unless the EOF has been reached.
     bool TryMoveToNextLine();
@@ -82,8 +104,7 @@ public:
         // We reset the current buffer only if the new fileOffset is out of the buffer limits.
         // If not, we just go to the index corresponding to the offset.
         if (fileOffset >= (m_buffer.size() + m_fileOffset) || fileOffset < m_fileOffset) {
-            m_file.SeekOrDie(fileOffset, SEEK_SET);
-            Reset();
+            Seek(fileOffset);
         }
         else
         {
@@ -92,10 +113,23 @@ public:
         }
     }
 
+    // Stops reading ahead at the given file offset, e.g. at the end of the chunk being parsed,
+    // so that no I/O is wasted on data that is not going to be consumed.
+    void SetReadAheadLimit(size_t fileOffset) { m_readAheadLimit = fileOffset; }
+
 private:
     // Read up to m_maxSize bytes from file into the buffer.
     void Refill();
 
+    // Moves to a file offset outside of the current buffer.
+    void Seek(size_t fileOffset);
+
+    // Starts reading the block that follows the current buffer into m_nextBuffer, in read-ahead mode.
+    void StartReadAhead();
+
+    // Waits for the pending read-ahead, if any. Returns the number of bytes read into m_nextBuffer.
+    size_t WaitForReadAhead();
+
     // Resets the buffer: clears the current buffer content and refills starting at the current file position.
     void Reset()
     {
@@ -126,6 +160,13 @@ private:
     size_t m_lineNumber{ 0 };
 
     FileWrapper m_file;
+
+    // Double buffering: the block at m_nextFileOffset that is being read in the background.
+    bool m_readAhead{ false };
+    size_t m_readAheadLimit{ SIZE_MAX };
+    std::vector<char> m_nextBuffer;
+    size_t m_nextFileOffset{ 0 };
+    std::future<size_t> m_pendingRead;
 };
 
 }
@@ -361,4 +361,24 @@ ChunkPtr Bundler::GetChunk(ChunkIdType chunkId)
     return std::make_shared<BundlingChunk>(m_streams.size(), this, chunkId);
 }
 
+void Bundler::WillNeedChunks(const std::vector<ChunkIdType>& chunkIds)
+{
+    std::vector<std::vector<ChunkIdType>> underlying(m_deserializers.size());
+    for (auto chunkId : chunkIds)
+    {
+        if (chunkId >= m_chunks.size())
+            continue;
+
+        const auto& secondaryChunks = m_chunks[chunkId].m_secondaryChunks;
+        for (size_t i = 0; i < secondaryChunks.size(); ++i)
+            for (auto c : secondaryChunks[i])
+                if (std::find(underlying[i].begin(), underlying[i].end(), c) == underlying[i].end())
+                    underlying[i].push_back(c);
+    }
+
+    for (size_t i = 0; i < m_deserializers.size(); ++i)
+        if (!underlying[i].empty())
+            m_deserializers[i]->WillNeedChunks(underlying[i]);
+}
+
 }
@@ -29,6 +29,9 @@ public:
     // Gets a chunk with data.
     virtual ChunkPtr GetChunk(ChunkIdType chunkId) override;
 
+    // Passes the hint on to the deserializers, with their chunks that make up the given ones.
+    virtual void WillNeedChunks(const std::vector<ChunkIdType>& chunkIds) override;
+
 private:
     DISABLE_COPY_AND_MOVE(Bundler);
 
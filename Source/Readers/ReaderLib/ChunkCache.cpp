@@ -6,21 +6,475 @@
 #define _CRT_SECURE_NO_WARNINGS
 
 #include "ChunkCache.h"
+#include "FileWrapper.h"
+#include "IndexBuilder.h"
+#include "SequenceData.h"
 
 namespace CNTK {
 
+namespace {
+
+// All fields of a spilled chunk are 8 byte aligned, so that the sequences
+// can point directly into the buffer the file was read into.
+const size_t SpillAlignment = sizeof(uint64_t);
+
+void Append(std::vector<char>& buffer, const void* data, size_t numBytes)
+{
+    const char* begin = static_cast<const char*>(data);
+    buffer.insert(buffer.end(), begin, begin + numBytes);
+    buffer.resize((buffer.size() + SpillAlignment - 1) / SpillAlignment * SpillAlignment, 0);
+}
+
+void Append(std::vector<char>& buffer, uint64_t value)
+{
+    Append(buffer, &value, sizeof(value));
+}
+
+struct SpilledDenseSequenceData : DenseSequenceData
+{
+    SpilledDenseSequenceData(unsigned int numberOfSamples, const NDShape& sampleShape)
+        : DenseSequenceData(numberOfSamples), m_data(nullptr), m_sampleShape(sampleShape)
+    {}
+
+    const void* GetDataBuffer() override { return m_data; }
+    const NDShape& GetSampleShape() override { return m_sampleShape; }
+
+    const void* m_data;
+    NDShape m_sampleShape;
+};
+
+struct SpilledSparseSequenceData : SparseSequenceData
+{
+    SpilledSparseSequenceData(unsigned int numberOfSamples, const NDShape& sampleShape)
+        : SparseSequenceData(numberOfSamples), m_data(nullptr), m_sampleShape(sampleShape)
+    {}
+
+    const void* GetDataBuffer() override { return m_data; }
+    const NDShape& GetSampleShape() override { return m_sampleShape; }
+
+    const void* m_data;
+    NDShape m_sampleShape;
+};
+
+// A chunk read back from the spill directory or found in shared memory, see ChunkCache::Serialize() for the layout.
+class SpilledChunk : public Chunk
+{
+public:
+    SpilledChunk(std::shared_ptr<uint8_t> buffer, size_t size, const std::vector<StreamInformation>& streams, std::vector<SequenceInfo>&& sequenceInfos)
+        : m_buffer(buffer), m_size(size), m_streams(streams), m_sequenceInfos(std::move(sequenceInfos))
+    {
+        size_t offset = 0;
+        const uint64_t numSequences = ReadValue(offset);
+        for (uint64_t i = 0; i < numSequences; ++i)
+        {
+            const uint64_t indexInChunk = ReadValue(offset);
+            m_sequenceOffsets[indexInChunk] = offset;
+            offset = SkipSequence(offset);
+        }
+    }
+
+    void GetSequence(size_t sequenceIndex, std::vector<SequenceDataPtr>& result) override
+    {
+        auto sequence = m_sequenceOffsets.find(sequenceIndex);
+        if (sequence == m_sequenceOffsets.end())
+            RuntimeError("Spilled chunk does not contain sequence %zu.", sequenceIndex);
+
+        size_t offset = sequence->second;
+        for (const auto& stream : m_streams)
+            result.push_back(ReadSequence(stream, offset));
+    }
+
+    void SequenceInfos(std::vector<SequenceInfo>& result) override
+    {
+        result.insert(result.end(), m_sequenceInfos.begin(), m_sequenceInfos.end());
+    }
+
+private:
+    uint64_t ReadValue(size_t& offset) const
+    {
+        if (offset + sizeof(uint64_t) > m_size)
+            RuntimeError("Spilled chunk is truncated.");
+        uint64_t value = *reinterpret_cast<const uint64_t*>(m_buffer.get() + offset);
+        offset += sizeof(uint64_t);
+        return value;
+    }
+
+    const void* ReadBlock(size_t& offset, size_t numBytes) const
+    {
+        if (offset + numBytes > m_size)
+            RuntimeError("Spilled chunk is truncated.");
+        const void* block = m_buffer.get() + offset;
+        offset += (numBytes + SpillAlignment - 1) / SpillAlignment * SpillAlignment;
+        return block;
+    }
+
+    size_t SkipSequence(size_t offset) const
+    {
+        for (const auto& stream : m_streams)
+            ReadSequence(stream, offset);
+        return offset;
+    }
+
+    SequenceDataPtr ReadSequence(const StreamInformation& stream, size_t& offset) const
+    {
+        const bool isValid = ReadValue(offset) != 0;
+        if (!isValid)
+            return InvalidSequenceData::Instance();
+
+        const auto numberOfSamples = static_cast<unsigned int>(ReadValue(offset));
+        const size_t keySequence = ReadValue(offset);
+        const auto keySample = static_cast<unsigned int>(ReadValue(offset));
+        const size_t elementSize = DataTypeSize(stream.m_elementType);
+
+        SequenceDataPtr result;
+        if (stream.m_storageFormat == StorageFormat::Dense)
+        {
+            auto dense = std::make_shared<SpilledDenseSequenceData>(numberOfSamples, stream.m_sampleLayout);
+            dense->m_data = ReadBlock(offset, numberOfSamples * stream.m_sampleLayout.TotalSize() * elementSize);
+            result = dense;
+        }
+        else
+        {
+            auto sparse = std::make_shared<SpilledSparseSequenceData>(numberOfSamples, stream.m_sampleLayout);
+            sparse->m_totalNnzCount = static_cast<SparseIndexType>(ReadValue(offset));
+            auto nnzCounts = static_cast<const SparseIndexType*>(ReadBlock(offset, numberOfSamples * sizeof(SparseIndexType)));
+            sparse->m_nnzCounts.assign(nnzCounts, nnzCounts + numberOfSamples);
+            sparse->m_data = ReadBlock(offset, sparse->m_totalNnzCount * elementSize);
+            sparse->m_indices = const_cast<SparseIndexType*>(static_cast<const SparseIndexType*>(
+                ReadBlock(offset, sparse->m_totalNnzCount * sizeof(SparseIndexType))));
+            result = sparse;
+        }
+
+        result->m_elementType = stream.m_elementType;
+        result->m_key = SequenceKey(keySequence, keySample);
+        // The sequence keeps the buffer alive, even if the chunk goes away.
+        result->m_holdingBuffer = m_buffer;
+        return result;
+    }
+
+    std::shared_ptr<uint8_t> m_buffer;
+    size_t m_size;
+    std::vector<StreamInformation> m_streams;
+    std::vector<SequenceInfo> m_sequenceInfos;
+    std::unordered_map<size_t, size_t> m_sequenceOffsets;
+};
+
+}
+
+ChunkCache::ChunkCache(DataDeserializerPtr deserializer, const ChunkCacheParameters& parameters, int verbosity)
+    : m_deserializer(deserializer), m_parameters(parameters), m_verbosity(verbosity)
+{
+    m_streams = m_deserializer->StreamInfos();
+
+    if (!m_parameters.m_spillDirectory.empty() && !m_parameters.IsBounded())
+        InvalidArgument("ChunkCache: a spill directory requires a memory budget.");
+
+    // Sizes are only measured and chunks only serialized with a budget.
+    for (const auto& stream : m_streams)
+    {
+        if ((m_parameters.IsBounded() || m_parameters.IsShared()) && stream.m_storageFormat != StorageFormat::Dense && stream.m_storageFormat != StorageFormat::SparseCSC)
+            InvalidArgument("ChunkCache: unsupported storage format of stream '%ls'.", stream.m_name.c_str());
+    }
+
+    if (m_parameters.IsShared())
+    {
+        if (m_parameters.m_sharedKey.empty())
+            InvalidArgument("ChunkCache: sharing chunks requires a key that identifies the data.");
+
+        // Other jobs may read a different version of the same file.
+        std::wstring key = m_parameters.m_sharedKey;
+        uint64_t size, modificationTime;
+        if (IndexCache::TryGetFileStamp(m_parameters.m_sharedKey, size, modificationTime))
+            key += L"|" + std::to_wstring(size) + L"|" + std::to_wstring(modificationTime);
+        for (const auto& stream : m_streams)
+            key += L"|" + stream.m_name;
+
+        m_sharedStore = SharedChunkStore::TryOpen(key, m_deserializer->ChunkInfos().size(), m_parameters.m_sharedSizeInBytes);
+        if (m_sharedStore && m_verbosity > 0)
+            fprintf(stderr, "ChunkCache: sharing up to %zu MB of chunks in '%s'.\n", m_parameters.m_sharedSizeInBytes >> 20, m_sharedStore->Name().c_str());
+    }
+}
+
+ChunkCache::~ChunkCache()
+{
+    if (m_verbosity > 0)
+    {
+        fprintf(stderr, "ChunkCache: %zu hits, %zu spill hits, %zu misses, %zu evictions, %zu chunks spilled (%zu MB in memory, %zu MB on disk).\n",
+                m_statistics.m_numHits, m_statistics.m_numSpillHits, m_statistics.m_numMisses, m_statistics.m_numEvictions,
+                m_statistics.m_numSpilled, m_statistics.m_bytesInMemory >> 20, m_statistics.m_bytesSpilled >> 20);
+        if (m_sharedStore)
+            fprintf(stderr, "ChunkCache: %zu shared hits, %zu chunks shared (%zu MB in shared memory).\n",
+                    m_statistics.m_numSharedHits, m_statistics.m_numShared, m_sharedStore->SizeInBytes() >> 20);
+    }
+
+    for (const auto& spilled : m_spilledChunks)
+        _wunlink(SpillFileName(spilled.first).c_str());
+}
+
 ChunkPtr ChunkCache::GetChunk(ChunkIdType chunkId)
 {
-    auto it = m_chunkMap.find(chunkId);
-    if (it != m_chunkMap.end())
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    auto it = m_chunks.find(chunkId);
+    if (it != m_chunks.end())
+    {
+        m_lru.splice(m_lru.begin(), m_lru, it->second.m_lruPosition);
+        m_statistics.m_numHits++;
+        return it->second.m_chunk;
+    }
+
+    if (m_sharedStore)
     {
-        return it->second;
+        // Chunks in shared memory are not kept in the cache, finding them again is cheap.
+        lock.unlock();
+        auto shared = LoadShared(chunkId);
+        lock.lock();
+        if (shared)
+        {
+            m_statistics.m_numSharedHits++;
+            return shared;
+        }
     }
- 
-    ChunkPtr chunk = m_deserializer->GetChunk(chunkId);
-    m_chunkMap[chunkId] = chunk;
- 
+
+    ChunkPtr chunk;
+    if (m_spilledChunks.find(chunkId) != m_spilledChunks.end())
+    {
+        chunk = LoadSpilled(chunkId);
+        m_statistics.m_numSpillHits++;
+    }
+    else
+    {
+        // The deserializer may load several chunks concurrently, do not hold the lock meanwhile.
+        lock.unlock();
+        chunk = m_deserializer->GetChunk(chunkId);
+        // Once shared, the chunk is served from shared memory and the deserialized copy is released.
+        auto shared = m_sharedStore ? Share(chunkId, chunk) : nullptr;
+        lock.lock();
+        m_statistics.m_numMisses++;
+
+        if (shared)
+        {
+            m_statistics.m_numShared++;
+            return shared;
+        }
+
+        // Another thread could have loaded the same chunk in the meantime.
+        it = m_chunks.find(chunkId);
+        if (it != m_chunks.end())
+        {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.m_lruPosition);
+            return it->second.m_chunk;
+        }
+    }
+
+    Insert(chunkId, chunk);
     return chunk;
 }
 
+ChunkCacheStatistics ChunkCache::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_statistics;
+}
+
+size_t ChunkCache::MeasureChunk(ChunkIdType chunkId, const ChunkPtr& chunk)
+{
+    std::vector<SequenceInfo> sequences;
+    m_deserializer->SequenceInfosForChunk(chunkId, sequences);
+
+    size_t sizeInBytes = 0;
+    std::vector<SequenceDataPtr> data;
+    for (const auto& sequence : sequences)
+    {
+        data.clear();
+        chunk->GetSequence(sequence.m_indexInChunk, data);
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            if (!data[i]->m_isValid)
+                continue;
+
+            const size_t elementSize = DataTypeSize(m_streams[i].m_elementType);
+            if (m_streams[i].m_storageFormat == StorageFormat::Dense)
+                sizeInBytes += data[i]->m_numberOfSamples * data[i]->GetSampleShape().TotalSize() * elementSize;
+            else
+            {
+                auto sparse = std::static_pointer_cast<SparseSequenceData>(data[i]);
+                sizeInBytes += sparse->m_totalNnzCount * (elementSize + sizeof(SparseIndexType)) +
+                               sparse->m_nnzCounts.size() * sizeof(SparseIndexType);
+            }
+        }
+    }
+    return sizeInBytes;
+}
+
+void ChunkCache::Insert(ChunkIdType chunkId, const ChunkPtr& chunk)
+{
+    if (m_parameters.IsShared() && !m_parameters.IsBounded())
+        return;
+
+    // Without a budget the sizes are irrelevant and measuring them would touch every sequence.
+    const size_t sizeInBytes = m_parameters.IsBounded() ? MeasureChunk(chunkId, chunk) : 0;
+    if (m_parameters.IsBounded() && sizeInBytes > m_parameters.m_maxSizeInBytes)
+    {
+        // Would evict everything else and still not fit.
+        Spill(chunkId, chunk);
+        return;
+    }
+
+    m_lru.push_front(chunkId);
+    m_chunks[chunkId] = CachedChunk{ chunk, sizeInBytes, m_lru.begin() };
+    m_statistics.m_bytesInMemory += sizeInBytes;
+    EvictToBudget();
+}
+
+void ChunkCache::EvictToBudget()
+{
+    if (!m_parameters.IsBounded())
+        return;
+
+    while (m_statistics.m_bytesInMemory > m_parameters.m_maxSizeInBytes)
+    {
+        const ChunkIdType victim = m_lru.back();
+        auto it = m_chunks.find(victim);
+        Spill(victim, it->second.m_chunk);
+
+        m_statistics.m_bytesInMemory -= it->second.m_sizeInBytes;
+        m_statistics.m_numEvictions++;
+        m_chunks.erase(it);
+        m_lru.pop_back();
+    }
+}
+
+std::wstring ChunkCache::SpillFileName(ChunkIdType chunkId) const
+{
+    // The process id and the address of the cache keep several readers sharing a directory apart.
+    return m_parameters.m_spillDirectory + L"/chunk_" + std::to_wstring(GetCurrentProcessId()) + L"_" +
+           std::to_wstring(reinterpret_cast<uintptr_t>(this)) + L"_" + std::to_wstring(chunkId) + L".bin";
+}
+
+// Layout of a serialized chunk, all fields 8 byte aligned:
+//   numSequences, then for each sequence its index in the chunk followed by one record per stream:
+//   isValid [, numSamples, key.m_sequence, key.m_sample, payload]
+// where the payload of a dense stream is the sample data, and the payload of a sparse stream
+// is totalNnzCount, nnzCounts, values and indices.
+bool ChunkCache::Serialize(ChunkIdType chunkId, const ChunkPtr& chunk, std::vector<char>& buffer)
+{
+    std::vector<SequenceInfo> sequences;
+    m_deserializer->SequenceInfosForChunk(chunkId, sequences);
+
+    buffer.clear();
+    Append(buffer, sequences.size());
+
+    std::vector<SequenceDataPtr> data;
+    for (const auto& sequence : sequences)
+    {
+        data.clear();
+        chunk->GetSequence(sequence.m_indexInChunk, data);
+        Append(buffer, sequence.m_indexInChunk);
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            const auto& stream = m_streams[i];
+            Append(buffer, data[i]->m_isValid ? 1 : 0);
+            if (!data[i]->m_isValid)
+                continue;
+
+            Append(buffer, data[i]->m_numberOfSamples);
+            Append(buffer, data[i]->m_key.m_sequence);
+            Append(buffer, data[i]->m_key.m_sample);
+
+            const size_t elementSize = DataTypeSize(stream.m_elementType);
+            if (stream.m_storageFormat == StorageFormat::Dense)
+            {
+                if (data[i]->GetSampleShape() != stream.m_sampleLayout)
+                    return false;
+                Append(buffer, data[i]->GetDataBuffer(), data[i]->m_numberOfSamples * stream.m_sampleLayout.TotalSize() * elementSize);
+            }
+            else
+            {
+                auto sparse = std::static_pointer_cast<SparseSequenceData>(data[i]);
+                Append(buffer, sparse->m_totalNnzCount);
+                Append(buffer, sparse->m_nnzCounts.data(), sparse->m_nnzCounts.size() * sizeof(SparseIndexType));
+                Append(buffer, sparse->GetDataBuffer(), sparse->m_totalNnzCount * elementSize);
+                Append(buffer, sparse->m_indices, sparse->m_totalNnzCount * sizeof(SparseIndexType));
+            }
+        }
+    }
+    return true;
+}
+
+void ChunkCache::Spill(ChunkIdType chunkId, const ChunkPtr& chunk)
+{
+    if (m_parameters.m_spillDirectory.empty() ||
+        m_spilledChunks.find(chunkId) != m_spilledChunks.end() ||
+        m_unspillableChunks.find(chunkId) != m_unspillableChunks.end())
+        return;
+
+    std::vector<char> buffer;
+    if (!Serialize(chunkId, chunk, buffer))
+    {
+        // The spilled form relies on the layout of the stream.
+        m_unspillableChunks.insert(chunkId);
+        return;
+    }
+
+    if (m_parameters.m_maxSpillSizeInBytes != 0 &&
+        m_statistics.m_bytesSpilled + buffer.size() > m_parameters.m_maxSpillSizeInBytes)
+    {
+        // The spill tier is full; spilled chunks are kept, later chunks are deserialized again.
+        m_unspillableChunks.insert(chunkId);
+        return;
+    }
+
+    auto file = FileWrapper::OpenOrDie(SpillFileName(chunkId), L"wb");
+    file.WriteOrDie(buffer.data(), sizeof(char), buffer.size());
+    file.FlushOrDie();
+
+    m_spilledChunks[chunkId] = buffer.size();
+    m_statistics.m_bytesSpilled += buffer.size();
+    m_statistics.m_numSpilled++;
+}
+
+ChunkPtr ChunkCache::LoadSpilled(ChunkIdType chunkId)
+{
+    const size_t size = m_spilledChunks[chunkId];
+    std::shared_ptr<uint8_t> buffer(new uint8_t[size], std::default_delete<uint8_t[]>());
+
+    auto file = FileWrapper::OpenOrDie(SpillFileName(chunkId), L"rb");
+    file.ReadOrDie(buffer.get(), sizeof(uint8_t), size);
+
+    std::vector<SequenceInfo> sequences;
+    m_deserializer->SequenceInfosForChunk(chunkId, sequences);
+    return std::make_shared<SpilledChunk>(buffer, size, m_streams, std::move(sequences));
+}
+
+ChunkPtr ChunkCache::Share(ChunkIdType chunkId, const ChunkPtr& chunk)
+{
+    if (!m_sharedStore->CanInsert(chunkId))
+        return nullptr;
+
+    std::vector<char> buffer;
+    if (!Serialize(chunkId, chunk, buffer))
+        return nullptr;
+
+    auto shared = m_sharedStore->Insert(chunkId, buffer);
+    if (!shared)
+        return nullptr;
+
+    std::vector<SequenceInfo> sequences;
+    m_deserializer->SequenceInfosForChunk(chunkId, sequences);
+    return std::make_shared<SpilledChunk>(shared, buffer.size(), m_streams, std::move(sequences));
+}
+
+ChunkPtr ChunkCache::LoadShared(ChunkIdType chunkId)
+{
+    size_t size;
+    auto shared = m_sharedStore->Find(chunkId, size);
+    if (!shared)
+        return nullptr;
+
+    std::vector<SequenceInfo> sequences;
+    m_deserializer->SequenceInfosForChunk(chunkId, sequences);
+    return std::make_shared<SpilledChunk>(shared, size, m_streams, std::move(sequences));
+}
+
 }
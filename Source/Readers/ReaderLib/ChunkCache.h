@@ -5,22 +5,60 @@
 
 #pragma once
 
+#include <list>
 #include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
 #include "DataDeserializer.h"
+#include "SharedChunkStore.h"
 
 namespace CNTK {
 
-// A cache to store the complete dataset (all chunks) in memory. The caching can
-// be switched on/off by a boolean flag in the reader config section, independent 
-// of the randomization and chunking parameters. The caching should only be enabled 
-// when the whole dataset fits in memory.
-// Implemented as a wrapping proxy around a deserializer that stores pointers to
-// all chunks it sees in an internal map.
+// Bounds of the chunk cache, all sizes in bytes. A size of 0 means unbounded.
+struct ChunkCacheParameters
+{
+    size_t m_maxSizeInBytes = 0;      // memory budget for deserialized chunks
+    std::wstring m_spillDirectory;    // if not empty, chunks evicted from memory are written here
+    size_t m_maxSpillSizeInBytes = 0; // disk budget of the spill tier
+    size_t m_sharedSizeInBytes = 0;   // if not 0, chunks are shared with the other processes of the host in a segment of this size
+    std::wstring m_sharedKey;         // identifies the data across processes (the input file of the deserializer)
+
+    bool IsBounded() const { return m_maxSizeInBytes != 0; }
+    bool IsShared() const { return m_sharedSizeInBytes != 0; }
+};
+
+struct ChunkCacheStatistics
+{
+    size_t m_numHits = 0;        // chunks served from memory
+    size_t m_numSpillHits = 0;   // chunks loaded back from the spill directory
+    size_t m_numSharedHits = 0;  // chunks found in shared memory
+    size_t m_numMisses = 0;      // chunks requested from the underlying deserializer
+    size_t m_numEvictions = 0;   // chunks dropped from memory to stay within budget
+    size_t m_numSpilled = 0;     // chunks written to the spill directory
+    size_t m_numShared = 0;      // chunks copied to shared memory by this process
+    size_t m_bytesInMemory = 0;
+    size_t m_bytesSpilled = 0;
+};
+
+// A cache of deserialized chunks. The caching can be switched on/off by a boolean flag
+// in the reader config section, independent of the randomization and chunking parameters.
+// Without a memory budget all chunks are kept, which should only be used when the whole
+// dataset fits in memory. With a budget the least recently used chunks are evicted;
+// if a spill directory is given, evicted chunks are written there in a flat binary form
+// and read back on the next request instead of being deserialized again.
+// With a shared budget, chunks are also kept in shared memory (see SharedChunkStore), where the
+// other processes of the host that read the same data find them; a chunk that has been shared is
+// served from there and does not count against the memory budget. A shared cache without a memory
+// budget keeps no other chunks.
+// Implemented as a wrapping proxy around a deserializer.
 class ChunkCache : public DataDeserializer
 {
 public:
 
-    ChunkCache(DataDeserializerPtr deserializer) : m_deserializer(deserializer) { }
+    ChunkCache(DataDeserializerPtr deserializer, const ChunkCacheParameters& parameters = ChunkCacheParameters(), int verbosity = 0);
+    ~ChunkCache();
 
     virtual std::vector<StreamInformation> StreamInfos() override
     {
@@ -45,10 +83,58 @@ public:
     // Gets chunk data given its id.
     virtual ChunkPtr GetChunk(ChunkIdType chunkId);
 
+    virtual void WillNeedChunks(const std::vector<ChunkIdType>& chunkIds) override
+    {
+        m_deserializer->WillNeedChunks(chunkIds);
+    }
+
+    ChunkCacheStatistics GetStatistics() const;
+
 private:
-    // A map of currently loaded chunks
-    std::map<size_t, ChunkPtr> m_chunkMap;
+    struct CachedChunk
+    {
+        ChunkPtr m_chunk;
+        size_t m_sizeInBytes;
+        std::list<ChunkIdType>::iterator m_lruPosition;
+    };
+
+    // Returns the number of bytes the sequences of the chunk occupy.
+    size_t MeasureChunk(ChunkIdType chunkId, const ChunkPtr& chunk);
+
+    void Insert(ChunkIdType chunkId, const ChunkPtr& chunk);
+    void EvictToBudget();
+
+    // Writes the chunk in the flat binary form that SpilledChunk reads.
+    // Returns false if the chunk cannot be represented in it.
+    bool Serialize(ChunkIdType chunkId, const ChunkPtr& chunk, std::vector<char>& buffer);
+
+    // Moves the chunk to shared memory. Returns the shared chunk, or nullptr if the chunk is not shared.
+    ChunkPtr Share(ChunkIdType chunkId, const ChunkPtr& chunk);
+    ChunkPtr LoadShared(ChunkIdType chunkId);
+
+    std::wstring SpillFileName(ChunkIdType chunkId) const;
+    void Spill(ChunkIdType chunkId, const ChunkPtr& chunk);
+    ChunkPtr LoadSpilled(ChunkIdType chunkId);
+
     DataDeserializerPtr m_deserializer;
+    const ChunkCacheParameters m_parameters;
+    const int m_verbosity;
+    std::vector<StreamInformation> m_streams;
+
+    mutable std::mutex m_mutex;
+
+    // Chunks in memory; the most recently used chunk is at the front of m_lru.
+    std::unordered_map<ChunkIdType, CachedChunk> m_chunks;
+    std::list<ChunkIdType> m_lru;
+
+    // Chunks in the spill directory with the size of their files.
+    std::map<ChunkIdType, size_t> m_spilledChunks;
+    // Chunks that cannot be spilled, e.g. because of a sample layout that differs from the stream.
+    std::set<ChunkIdType> m_unspillableChunks;
+
+    SharedChunkStorePtr m_sharedStore;
+
+    ChunkCacheStatistics m_statistics;
 
     DISABLE_COPY_AND_MOVE(ChunkCache);
 };
@@ -7,6 +7,7 @@
 #include "ChunkRandomizer.h"
 #include <random>
 #include "RandomOrdering.h"
+#include "ThreadPool.h"
 
 namespace CNTK {
 
@@ -15,12 +16,20 @@ namespace CNTK {
         bool sampleBasedRandomizationWindow) :
         m_deserializer(deserializer), 
         m_randomizationRange(randomizationRange),
-        m_sampleBasedRandomizationWindow(sampleBasedRandomizationWindow)
+        m_sampleBasedRandomizationWindow(sampleBasedRandomizationWindow),
+        m_preparedSeed(0),
+        m_hasPreparedChunks(false)
     {
         m_originalChunks = m_deserializer->ChunkInfos();
         assert(m_originalChunks.size() < ChunkIdMax);
     }
 
+    ChunkRandomizer::~ChunkRandomizer()
+    {
+        // The preparation refers to the original chunks.
+        DropPreparedChunks();
+    }
+
     // Gets randomized chunks.
     const std::vector<RandomizedChunk>& ChunkRandomizer::GetRandomizedChunks() const
     {
@@ -29,6 +38,56 @@ namespace CNTK {
 
     // Randomizes chunks and calculates randomization windows.
     void ChunkRandomizer::Randomize(size_t seed)
+    {
+        if (GetPreparedChunks(seed))
+        {
+            // The sequence randomizer keeps a reference to m_randomizedChunks, so the prepared chunks are swapped in.
+            m_randomizedChunks.swap(m_preparedChunks);
+            m_hasPreparedChunks = false;
+            return;
+        }
+
+        DropPreparedChunks();
+        Randomize(seed, m_randomizedChunks);
+    }
+
+    void ChunkRandomizer::PrepareRandomization(size_t seed)
+    {
+        if ((m_preparation.valid() || m_hasPreparedChunks) && m_preparedSeed == seed)
+            return;
+
+        DropPreparedChunks();
+        m_preparedSeed = seed;
+        m_preparation = Microsoft::MSR::CNTK::ThreadPool::Get().Async([this, seed]()
+        {
+            Randomize(seed, m_preparedChunks);
+        });
+    }
+
+    const std::vector<RandomizedChunk>* ChunkRandomizer::GetPreparedChunks(size_t seed)
+    {
+        if (m_preparedSeed != seed)
+            return nullptr;
+
+        if (m_preparation.valid())
+        {
+            m_preparation.get(); // rethrows
+            m_hasPreparedChunks = true;
+        }
+        return m_hasPreparedChunks ? &m_preparedChunks : nullptr;
+    }
+
+    void ChunkRandomizer::DropPreparedChunks()
+    {
+        if (m_preparation.valid())
+            m_preparation.wait();
+        m_preparation = std::future<void>();
+        m_hasPreparedChunks = false;
+    }
+
+    // Randomizes chunks and calculates randomization windows into the given vector.
+    // Only reads the original chunks, so that it can run concurrently with the use of the current randomization.
+    void ChunkRandomizer::Randomize(size_t seed, std::vector<RandomizedChunk>& randomizedChunks) const
     {
         std::vector<ChunkIdType> randomizedChunkIndices;
         randomizedChunkIndices.reserve(m_originalChunks.size());
@@ -37,12 +96,12 @@ namespace CNTK {
             randomizedChunkIndices.push_back(i);
         }
 
-        m_rng.seed((unsigned long)seed);
-        Microsoft::MSR::CNTK::RandomShuffleMT(randomizedChunkIndices, m_rng);
+        std::mt19937_64 rng((unsigned long)seed);
+        Microsoft::MSR::CNTK::RandomShuffleMT(randomizedChunkIndices, rng);
 
         // Place randomized chunks on the timeline
-        m_randomizedChunks.clear();
-        m_randomizedChunks.reserve(m_originalChunks.size());
+        randomizedChunks.clear();
+        randomizedChunks.reserve(m_originalChunks.size());
 
         size_t samplePosition = 0;
         size_t sequencePosition = 0;
@@ -60,29 +119,29 @@ namespace CNTK {
             randomizedChunk.m_original = &m_originalChunks[originalChunkIndex];
             randomizedChunk.m_samplePositionStart = samplePosition;
             randomizedChunk.m_sequencePositionStart = sequencePosition;
-            m_randomizedChunks.push_back(randomizedChunk);
+            randomizedChunks.push_back(randomizedChunk);
             samplePosition += numberOfSamples;
             sequencePosition += numberOfSequences;
         }
 
         if (m_sampleBasedRandomizationWindow) 
         {
-            RandomizeUsingWindowInSamples();
+            RandomizeUsingWindowInSamples(randomizedChunks);
         }
         else 
         {
-            RandomizeUsingWindowInChunks();
+            RandomizeUsingWindowInChunks(randomizedChunks);
         }
     }
 
     // Randomizes chunks and calculates randomization windows in samples.
-    void ChunkRandomizer::RandomizeUsingWindowInSamples()
+    void ChunkRandomizer::RandomizeUsingWindowInSamples(std::vector<RandomizedChunk>& randomizedChunks) const
     {
         // For each chunk, compute the randomization range (w.r.t. the randomized chunk sequence)
         size_t halfWindowRange = m_randomizationRange / 2;
         for (ChunkIdType chunkId = 0; chunkId < m_originalChunks.size(); chunkId++)
         {
-            auto& chunk = m_randomizedChunks[chunkId];
+            auto& chunk = randomizedChunks[chunkId];
 
             // start with the range of left neighbor
             if (chunkId == 0)
@@ -92,12 +151,12 @@ namespace CNTK {
             }
             else
             {
-                chunk.m_randomizationWindow.m_begin = m_randomizedChunks[chunkId - 1].m_randomizationWindow.m_begin; // might be too early
-                chunk.m_randomizationWindow.m_end = m_randomizedChunks[chunkId - 1].m_randomizationWindow.m_end; // might have more space
+                chunk.m_randomizationWindow.m_begin = randomizedChunks[chunkId - 1].m_randomizationWindow.m_begin; // might be too early
+                chunk.m_randomizationWindow.m_end = randomizedChunks[chunkId - 1].m_randomizationWindow.m_end; // might have more space
             }
 
             // Need to adapt now.
-            while (chunk.m_samplePositionStart - m_randomizedChunks[chunk.m_randomizationWindow.m_begin].m_samplePositionStart > halfWindowRange)
+            while (chunk.m_samplePositionStart - randomizedChunks[chunk.m_randomizationWindow.m_begin].m_samplePositionStart > halfWindowRange)
             {
                 // too early, need to increase
                 chunk.m_randomizationWindow.m_begin++;
@@ -109,7 +168,7 @@ namespace CNTK {
             chunk.m_randomizationWindow.m_end = std::max(chunk.m_randomizationWindow.m_end, chunkId + 1);
 
             while (chunk.m_randomizationWindow.m_end < m_originalChunks.size() &&
-                m_randomizedChunks[chunk.m_randomizationWindow.m_end].SampleEndPosition() - chunk.m_samplePositionStart < halfWindowRange)
+                randomizedChunks[chunk.m_randomizationWindow.m_end].SampleEndPosition() - chunk.m_samplePositionStart < halfWindowRange)
             {
                 // got more space, move window to the right.
                 chunk.m_randomizationWindow.m_end++;
@@ -118,22 +177,22 @@ namespace CNTK {
     }
 
     // Randomizes chunks and calculates randomization windows in chunks.
-    void ChunkRandomizer::RandomizeUsingWindowInChunks()
+    void ChunkRandomizer::RandomizeUsingWindowInChunks(std::vector<RandomizedChunk>& randomizedChunks) const
     {
         auto halfWindowRange = m_randomizationRange / 2;
         auto windwowSize = m_randomizationRange == 0 ? 1 : ChunkIdType(m_randomizationRange);
-        for (auto i = 0; i < m_randomizedChunks.size(); i++)
+        for (auto i = 0; i < randomizedChunks.size(); i++)
         {
-            auto& chunk = m_randomizedChunks[i];
+            auto& chunk = randomizedChunks[i];
             chunk.m_randomizationWindow.m_begin = (i > halfWindowRange) ? i - ChunkIdType(halfWindowRange) : 0;
             
             chunk.m_randomizationWindow.m_end = chunk.m_randomizationWindow.m_begin + windwowSize;
 
-            if (chunk.m_randomizationWindow.m_end > m_randomizedChunks.size()) 
+            if (chunk.m_randomizationWindow.m_end > randomizedChunks.size()) 
             {
-                chunk.m_randomizationWindow.m_end = ChunkIdType(m_randomizedChunks.size());
+                chunk.m_randomizationWindow.m_end = ChunkIdType(randomizedChunks.size());
                 chunk.m_randomizationWindow.m_begin =
-                    (m_randomizedChunks.size() > windwowSize) ? ChunkIdType(m_randomizedChunks.size() - windwowSize) : 0;
+                    (randomizedChunks.size() > windwowSize) ? ChunkIdType(randomizedChunks.size() - windwowSize) : 0;
             }
         }
     }
@@ -7,6 +7,7 @@
 
 #include <vector>
 #include "DataDeserializer.h"
+#include <future>
 #include <random>
 
 namespace CNTK {
@@ -73,22 +74,45 @@ namespace CNTK {
     public:
         ChunkRandomizer(DataDeserializerPtr deserializer, size_t randomizationRange, bool sampleBasedRandomizationWindow = true);
 
+        ~ChunkRandomizer();
+
         // Gets randomized chunks.
         const std::vector<RandomizedChunk>& GetRandomizedChunks() const;
 
         // Randomizes chunks based on the seed.
+        // If the randomization for the seed has been prepared, only takes over its result.
         void Randomize(size_t seed);
 
+        // Starts randomizing chunks for the given seed on the thread pool, e.g. for the next sweep while the current
+        // one is still being read. The current randomized chunks are not affected.
+        void PrepareRandomization(size_t seed);
+
+        // Gets the prepared randomized chunks for the seed, waiting for the preparation if needed,
+        // or nullptr if no randomization was prepared for this seed.
+        const std::vector<RandomizedChunk>* GetPreparedChunks(size_t seed);
+
+    private:
+        // Randomizes chunks based on the seed into the given vector.
+        void Randomize(size_t seed, std::vector<RandomizedChunk>& randomizedChunks) const;
+
         // Randomize by spraying original sequences over a window of "m_randomizationRange" samples.
-        void RandomizeUsingWindowInSamples();
+        void RandomizeUsingWindowInSamples(std::vector<RandomizedChunk>& randomizedChunks) const;
 
         // Randomize by spraying original sequences over a window of "m_randomizationRange" of chunks.
-        void RandomizeUsingWindowInChunks();
+        void RandomizeUsingWindowInChunks(std::vector<RandomizedChunk>& randomizedChunks) const;
+
+        // Waits for an outstanding preparation and drops its result.
+        void DropPreparedChunks();
 
-    private:
         DataDeserializerPtr m_deserializer;
         // Randomized chunks.
         std::vector<RandomizedChunk> m_randomizedChunks;
+
+        // Randomization prepared by PrepareRandomization(), for the seed m_preparedSeed.
+        std::future<void> m_preparation;
+        std::vector<RandomizedChunk> m_preparedChunks;
+        size_t m_preparedSeed;
+        bool m_hasPreparedChunks;
         // Original chunks.
         std::vector<ChunkInfo> m_originalChunks;
 
@@ -99,8 +123,6 @@ namespace CNTK {
         // if true randomization range == number of samples, else 
         // randomization range = number of chunks.
         bool m_sampleBasedRandomizationWindow;
-
-        std::mt19937_64 m_rng;
     };
 
     typedef std::shared_ptr<ChunkRandomizer> ChunkRandomizerPtr;
@@ -8,6 +8,8 @@
 #include <string>
 #include <vector>
 #include "Config.h"
+#include "ChunkCache.h"
+#include "RemoteStorage.h"
 
 namespace CNTK {
 
@@ -37,6 +39,43 @@ inline std::vector<std::string> GetSectionsWithParameter(const std::string& read
     return result;
 }
 
+// Number of minibatches that ReaderShim reads ahead of the network (reader config "prefetchDepth").
+// Packers need one buffer more than that: one for each prefetched minibatch whose copy to the device
+// may still be in flight, and one for the minibatch being packed.
+inline size_t GetPrefetchDepth(const Microsoft::MSR::CNTK::ConfigParameters& config)
+{
+    size_t prefetchDepth = config(L"prefetchDepth", (size_t)1);
+    if (prefetchDepth == 0)
+        InvalidArgument("prefetchDepth must be at least 1.");
+    return prefetchDepth;
+}
+
+// Bounds of the chunk cache (reader config "chunkCacheSizeInMB", "chunkCacheSpillDirectory",
+// "chunkCacheSpillSizeInMB" and "chunkCacheSharedSizeInMB"). A cache size of 0 keeps all chunks once
+// "keepDataInMemory" is set. The key of the shared cache is left to the reader.
+inline ChunkCacheParameters GetChunkCacheParameters(const Microsoft::MSR::CNTK::ConfigParameters& config)
+{
+    ChunkCacheParameters parameters;
+    parameters.m_maxSizeInBytes = config(L"chunkCacheSizeInMB", (size_t)0) << 20;
+    parameters.m_spillDirectory = (std::wstring)config(L"chunkCacheSpillDirectory", L"");
+    parameters.m_maxSpillSizeInBytes = config(L"chunkCacheSpillSizeInMB", (size_t)0) << 20;
+    parameters.m_sharedSizeInBytes = config(L"chunkCacheSharedSizeInMB", (size_t)0) << 20;
+    return parameters;
+}
+
+// Settings of the cache of remote input files (reader config "remoteBlockSizeInMB", "remoteCacheSizeInMB",
+// "remoteCacheDirectory" and "remoteConnections"). The cache is shared by the process, so settings
+// that are not given keep their current value.
+inline RemoteStorageParameters GetRemoteStorageParameters(const Microsoft::MSR::CNTK::ConfigParameters& config)
+{
+    RemoteStorageParameters parameters = RemoteStorage::GetParameters();
+    parameters.m_blockSizeInBytes = config(L"remoteBlockSizeInMB", parameters.m_blockSizeInBytes >> 20) << 20;
+    parameters.m_cacheSizeInBytes = config(L"remoteCacheSizeInMB", parameters.m_cacheSizeInBytes >> 20) << 20;
+    parameters.m_cacheDirectory = config(L"remoteCacheDirectory", parameters.m_cacheDirectory);
+    parameters.m_numConnections = config(L"remoteConnections", parameters.m_numConnections);
+    return parameters;
+}
+
 // This class allows specifying delimiters and 3 dot patterns
 // both for char and wchar_t strings.
 template<class T>
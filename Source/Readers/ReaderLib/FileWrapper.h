@@ -15,10 +15,13 @@
 #ifdef __unix__
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #endif
 #include <errno.h>
 #include <memory>
 #include "fileutil.h"
+#include "RemoteStorage.h"
+#include "ReaderStatistics.h"
 #include <type_traits>
 
 namespace CNTK {
@@ -27,9 +30,11 @@ class FileWrapper
 {
 public:
 
+    // URLs of a remote storage (see RemoteStorage) are opened read-only, as a stream over the block cache.
     FileWrapper(const std::wstring& filename, const wchar_t* mode)
-        : m_filename(filename), 
-        m_file(_wfopen(filename.c_str(), mode), [](FILE* m_file)
+        : m_filename(filename),
+        m_remote(RemoteStorage::IsRemote(filename) ? RemoteStorage::Open(filename) : nullptr),
+        m_file(m_remote ? RemoteStorage::OpenStreamOrDie(filename, mode) : _wfopen(filename.c_str(), mode), [](FILE* m_file)
         {
             if (m_file)
             {
@@ -108,12 +113,39 @@ public:
 
     inline size_t Filesize() const
     {
-        return filesize(m_file.get());
+        return m_remote ? (size_t)m_remote->Size() : filesize(m_file.get());
+    }
+
+    inline bool IsRemote() const
+    {
+        return m_remote != nullptr;
+    }
+
+    // Hints that the given range will be read soon. Only remote files act on it:
+    // their blocks are then fetched in the background.
+    inline void WillNeed(uint64_t offset, size_t size) const
+    {
+        if (m_remote)
+            m_remote->WillNeed(offset, size);
+    }
+
+    // Hints that the file will be read sequentially, so that the OS reads ahead more aggressively.
+    // Remote files read ahead through WillNeed() instead.
+    inline void AdviseSequential() const
+    {
+#ifdef __unix__
+        int fd = m_remote ? -1 : fileno(m_file.get());
+        if (fd >= 0)
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
     }
 
     inline size_t Read(void* ptr, size_t size, size_t count)
     {
-        return fread(ptr, size, count, m_file.get());
+        ScopeReaderStage stage(ReaderStage::FileRead);
+        size_t numRead = fread(ptr, size, count, m_file.get());
+        stage.AddBytes(numRead * size);
+        return numRead;
     }
 
     inline bool TryRead(void* ptr, size_t size, size_t count)
@@ -213,6 +245,7 @@ public:
 private:
 
     std::wstring m_filename;
+    RemoteFilePtr m_remote;
     std::shared_ptr<FILE> m_file;
 };
 
@@ -7,6 +7,7 @@
 
 #include <algorithm>
 #include "MemoryProvider.h"
+#include "NumaPolicy.h"
 
 namespace CNTK {
 
@@ -17,13 +18,18 @@ class HeapMemoryProvider : public MemoryProvider
 public:
     virtual void* Alloc(size_t elementSize, size_t numberOfElements) override
     {
-        // Currently not alligned.
-        return ::operator new(elementSize * numberOfElements);
+        // Large buffers may be backed by huge pages (aligned to them), the others are currently not aligned.
+        void* p = Microsoft::MSR::CNTK::HugePages::Allocate(elementSize * numberOfElements);
+        if (!p)
+            p = ::operator new(elementSize * numberOfElements);
+        Microsoft::MSR::CNTK::NumaPolicy::Place(p, elementSize * numberOfElements, /*zero=*/false);
+        return p;
     }
 
     virtual void Free(void* p) override
     {
-        ::operator delete(p);
+        if (!Microsoft::MSR::CNTK::HugePages::Free(p))
+            ::operator delete(p);
     }
 };
 
@@ -7,6 +7,8 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include <inttypes.h>
 #include <future>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "IndexBuilder.h"
 #include "ReaderConstants.h"
 #include "FileWrapper.h"
@@ -23,25 +25,115 @@ IndexBuilder::IndexBuilder(const FileWrapper& input)
     m_isCacheEnabled(false),
     m_chunkSize(g_32MB),
     m_bufferSize(g_2MB),
+    m_readAhead(true),
     m_primary(true)
 {}
 
+/*static*/ bool IndexCache::TryGetFileStamp(const wstring& filename, uint64_t& size, uint64_t& modificationTime)
+{
+#ifdef _WIN32
+    struct _stat64 status;
+    if (_wstat64(filename.c_str(), &status) != 0)
+        return false;
+#else
+    struct stat status;
+    if (stat(wtocharpath(filename.c_str()).c_str(), &status) != 0)
+        return false;
+#endif
+    size = static_cast<uint64_t>(status.st_size);
+    modificationTime = static_cast<uint64_t>(status.st_mtime);
+    return true;
+}
+
+/*static*/ shared_ptr<IndexCache> IndexCache::TryOpen(const wstring& cacheFilename, const wstring& sourceFilename,
+    uint64_t magic, uint64_t version, size_t recordSize)
+{
+    uint64_t sourceSize, sourceModificationTime;
+    if (!TryGetFileStamp(sourceFilename, sourceSize, sourceModificationTime) || !fexists(cacheFilename.c_str()))
+        return nullptr;
+
+    MemoryMappedFilePtr file;
+    try
+    {
+        file = make_shared<MemoryMappedFile>(cacheFilename);
+    }
+    catch (...)
+    {
+        return nullptr; // e.g., the cache is being replaced by another process.
+    }
+
+    if (file->Size() < sizeof(Header))
+        return nullptr;
+
+    const Header& header = *reinterpret_cast<const Header*>(file->Data());
+    if (header.magic != magic || header.version != version || header.recordSize != recordSize ||
+        header.sourceSize != sourceSize || header.sourceModificationTime != sourceModificationTime)
+        return nullptr;
+
+    if (file->Size() != sizeof(Header) + header.numberOfRecords * header.recordSize + header.extraSize)
+        return nullptr;
+
+    // The records are read in order, the whole file is needed.
+    file->WillNeed(0, file->Size());
+    return shared_ptr<IndexCache>(new IndexCache(file, recordSize, header.numberOfRecords, header.extraSize));
+}
+
+/*static*/ bool IndexCache::TryWrite(const wstring& cacheFilename, const wstring& sourceFilename,
+    uint64_t magic, uint64_t version, size_t recordSize, uint64_t numberOfRecords,
+    const function<bool(FileWrapper&)>& writeRecords, const string& extra)
+{
+    if (Microsoft::MSR::CNTK::EnvironmentUtil::GetLocalMPINodeRank() != 0)
+        return false; // only the main node should write the cache file.
+
+    Header header = {};
+    header.magic = magic;
+    header.version = version;
+    header.recordSize = recordSize;
+    header.numberOfRecords = numberOfRecords;
+    header.extraSize = extra.size();
+    if (!TryGetFileStamp(sourceFilename, header.sourceSize, header.sourceModificationTime))
+        return false;
+
+    // The temporary file belongs to this process, so that processes on other nodes
+    // writing the same cache to a shared file system do not interfere.
+    auto temp = cacheFilename + L"." + to_wstring(GetCurrentProcessId()) + L".tmp";
+    bool success;
+    {
+        FileWrapper cache(temp, L"wb");
+        success = cache.IsOpen() &&
+            cache.TryWrite(header) &&
+            writeRecords(cache) &&
+            (extra.empty() || cache.TryWrite(extra.data(), 1, extra.size())) &&
+            cache.TryFlush();
+    }
+
+    if (success)
+    {
+        try
+        {
+            // TODO: add TryRename that does not throw.
+            renameOrDie(temp, cacheFilename);
+            return true;
+        }
+        catch (...) {}
+    }
+
+    _wunlink(temp.c_str());
+    return false;
+}
+
 shared_ptr<Index> IndexBuilder::Build()
 {
     if (m_isCacheEnabled) 
     {
-        auto cacheFilename = GetCacheFilename();
-        if (msra::files::fuptodate(cacheFilename, m_input.Filename(), true))
-        {
-            // cache file is up-to-date, try to reconstruct the index from cache.
-            auto index = TryLoadFromCache(cacheFilename, m_chunkSize);
+        // Try to reconstruct the index from cache, which fails if the cache does not match the input file.
+        auto index = TryLoadFromCache(GetCacheFilename(), m_chunkSize);
 
-            if (index != nullptr) 
-            {
-                if (!m_primary) 
-                    index->MapSequenceKeyToLocation();
-                return index;
-            }
+        if (index != nullptr) 
+        {
+            if (!m_primary) 
+                index->MapSequenceKeyToLocation();
+            return index;
         }
     }
     
@@ -72,84 +164,43 @@ void IndexBuilder::WriteIndexCacheAsync(shared_ptr<Index>& index)
         return; // only the main node should write the cache file.
     
     auto cacheFilename = GetCacheFilename();
+    auto inputFilename = m_input.Filename();
 
     // using thread(lambda).detach() as a workaround the blocking
     // async destructor.
-    thread([cacheFilename, index]()
+    thread([cacheFilename, inputFilename, index]()
     {
-        // At this point, it's safe to assume that the previous cache is stale,
-        // remove the cache file if it exists (return value is ignored).
-        _wunlink(cacheFilename.c_str());
-
-        bool isCacheEnabled = true;
-        auto temp = cacheFilename + L".tmp";
-        {
-            FileWrapper cache(temp, L"wb");
-            isCacheEnabled = cache.IsOpen();
-
-            Prefix prefix(s_magic, s_version, index->NumberOfSequences(), uint64_t(sizeof(Prefix)));
-
-            isCacheEnabled = isCacheEnabled && cache.TryWrite(prefix);
-
-            IndexedSequence cachedSequence;
-            for (auto& chunk : index->Chunks())
+        IndexCache::TryWrite(cacheFilename, inputFilename, s_magic, s_version, sizeof(IndexedSequence), index->NumberOfSequences(),
+            [&index](FileWrapper& cache)
             {
-                for (auto& sequence : chunk.Sequences())
+                IndexedSequence cachedSequence;
+                for (auto& chunk : index->Chunks())
                 {
-                    cachedSequence.SetKey(sequence.m_key)
-                        .SetNumberOfSamples(sequence.NumberOfSamples())
-                        .SetSize(sequence.SizeInBytes())
-                        .SetOffset(chunk.StartOffset() + sequence.OffsetInChunk());
-
-                    isCacheEnabled = isCacheEnabled && cache.TryWrite(cachedSequence);
+                    for (auto& sequence : chunk.Sequences())
+                    {
+                        cachedSequence.SetKey(sequence.m_key)
+                            .SetNumberOfSamples(sequence.NumberOfSamples())
+                            .SetSize(sequence.SizeInBytes())
+                            .SetOffset(chunk.StartOffset() + sequence.OffsetInChunk());
+
+                        if (!cache.TryWrite(cachedSequence))
+                            return false;
+                    }
                 }
-            }
-
-            isCacheEnabled = isCacheEnabled && cache.TryFlush();
-        }
-        
-
-        if (isCacheEnabled) 
-        {
-            try 
-            {
-                // TODO: add TryRename that does not throw.
-                renameOrDie(temp, cacheFilename);
-            }
-            catch (...) {}
-        }
+                return true;
+            });
     }).detach();
 }
 
-const static size_t s_sequenceSize = sizeof(IndexedSequence);
-const static size_t s_numSequencesToBuffer = (g_1MB >> 1) / s_sequenceSize;
-
-/*static*/ shared_ptr<Index> IndexBuilder::TryLoadFromCache(const wstring& cacheFilename, size_t chunkSize)
+shared_ptr<Index> IndexBuilder::TryLoadFromCache(const wstring& cacheFilename, size_t chunkSize)
 {
-    FileWrapper cache(cacheFilename.c_str(), L"rb");
-
-    if (!cache.IsOpen())
-        return nullptr;
-
-    Prefix prefix;
-    if (!cache.TryRead(prefix) || prefix.magic != s_magic)
+    auto cache = IndexCache::TryOpen(cacheFilename, m_input.Filename(), s_magic, s_version, sizeof(IndexedSequence));
+    if (!cache)
         return nullptr;
 
     auto index = make_shared<Index>(chunkSize);
-
-    char buffer[s_numSequencesToBuffer * s_sequenceSize];
-    for (uint64_t i = 0; i < prefix.totalNumberOfSequences; )
-    {
-        auto numSequencesToRead = min(s_numSequencesToBuffer, prefix.totalNumberOfSequences - i);
-
-        if (!cache.TryRead(buffer, s_sequenceSize, numSequencesToRead))
-            return nullptr;
-
-        for (int j = 0; j < numSequencesToRead; j++) 
-            index->AddSequence(*reinterpret_cast<IndexedSequence*>(buffer + j * s_sequenceSize));
-        
-        i += numSequencesToRead;
-    }
+    for (size_t i = 0; i < cache->NumberOfRecords(); i++)
+        index->AddSequence(cache->Record<IndexedSequence>(i));
 
     return index;
 }
@@ -218,7 +269,7 @@ static const char s_BOM[3] = { '\xEF', '\xBB', '\xBF' };
     if (m_fileSize == 0)
         RuntimeError("Input file is empty");
 
-    m_reader.reset(new BufferedFileReader(m_bufferSize, m_input));
+    m_reader.reset(new BufferedFileReader(m_bufferSize, m_input, m_readAhead));
 
     index->Reserve(m_fileSize);
 
@@ -254,6 +305,9 @@ static const char s_BOM[3] = { '\xEF', '\xBB', '\xBF' };
     {
         PopulateImpl(index);
     }
+
+    // Done with the file, which is read by the deserializer next.
+    m_reader.reset();
 }
 
 void TextInputIndexBuilder::PopulateFromLines(shared_ptr<Index>& index)
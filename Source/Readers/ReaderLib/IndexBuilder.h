@@ -7,11 +7,13 @@
 
 #include <stdint.h>
 #include <vector>
+#include <functional>
 #include <boost/noncopyable.hpp>
 #include "Index.h"
 #include "CorpusDescriptor.h"
 #include "BufferedFileReader.h"
 #include "FileWrapper.h"
+#include "MemoryMappedFile.h"
 
 namespace CNTK {
 
@@ -43,23 +45,70 @@ public:
 };
 
 
-class IndexBuilder : private boost::noncopyable
+// A binary file that caches data derived from a source file (e.g., the index of the sequences in
+// the source), so that the source does not need to be parsed again on the next run.
+// The cache consists of a header, an array of fixed-size records and optional free-form data.
+// It is valid as long as the size and the modification time of the source match the ones
+// recorded in the header. The cache is written by one process on each node (into a temporary file
+// that is renamed when complete, so no process ever sees a partial cache) and it is memory-mapped
+// by all processes that read it, so that they share the pages of the OS file cache.
+class IndexCache : private boost::noncopyable
 {
-    struct Prefix {
-        Prefix() = default;
-        Prefix(uint64_t magic, uint64_t version, uint64_t totalNumberOfSequences, 
-            uint64_t firstSequenceOffset = sizeof(Prefix))
-            : magic{ magic }, version{ version },
-            totalNumberOfSequences{ totalNumberOfSequences }, firstSequenceOffset{ firstSequenceOffset }
-        {}
+    struct Header
+    {
         uint64_t magic;
         uint64_t version;
-        uint64_t totalNumberOfSequences;
-        uint64_t firstSequenceOffset; // this offset is set to the size of prefix for the moment
-        // but eventually, this can be used to append additional staff after prefix, without breaking
-        // back compat.
+        uint64_t sourceSize;
+        uint64_t sourceModificationTime;
+        uint64_t recordSize;
+        uint64_t numberOfRecords;
+        uint64_t extraSize; // size in bytes of the free-form data following the records
     };
 
+public:
+    // Maps the cache file. Returns nullptr if the file does not exist, is malformed, or if it
+    // does not match the given magic, version, record size or the current state of the source.
+    static std::shared_ptr<IndexCache> TryOpen(const std::wstring& cacheFilename, const std::wstring& sourceFilename,
+        uint64_t magic, uint64_t version, size_t recordSize);
+
+    // Writes the cache of the source file, the records are written by 'writeRecords'.
+    // Only the first process on each node writes the cache, returns false in all others
+    // and if the cache could not be written.
+    static bool TryWrite(const std::wstring& cacheFilename, const std::wstring& sourceFilename,
+        uint64_t magic, uint64_t version, size_t recordSize, uint64_t numberOfRecords,
+        const std::function<bool(FileWrapper&)>& writeRecords, const std::string& extra = std::string());
+
+    size_t NumberOfRecords() const { return m_numberOfRecords; }
+
+    template <class T>
+    const T& Record(size_t i) const
+    {
+        assert(sizeof(T) == m_recordSize && i < m_numberOfRecords);
+        return reinterpret_cast<const T*>(m_records)[i];
+    }
+
+    const char* Extra() const { return m_records + m_numberOfRecords * m_recordSize; }
+
+    size_t ExtraSize() const { return m_extraSize; }
+
+    // Gets the size and the modification time of a file.
+    static bool TryGetFileStamp(const std::wstring& filename, uint64_t& size, uint64_t& modificationTime);
+
+private:
+    IndexCache(const MemoryMappedFilePtr& file, size_t recordSize, size_t numberOfRecords, size_t extraSize)
+        : m_file(file), m_records(file->Data() + sizeof(Header)),
+        m_recordSize(recordSize), m_numberOfRecords(numberOfRecords), m_extraSize(extraSize)
+    {}
+
+    MemoryMappedFilePtr m_file;
+    const char* m_records;
+    size_t m_recordSize;
+    size_t m_numberOfRecords;
+    size_t m_extraSize;
+};
+
+class IndexBuilder : private boost::noncopyable
+{
 public:
     // Reads the input file, building and index of chunks and corresponding
     // sequences. Returns input data index (chunk and sequence metadata);
@@ -74,6 +123,9 @@ public:
 
     IndexBuilder& SetBufferSize(size_t size) { m_bufferSize = size; return *this; }
 
+    // Reads the next buffer in the background while the current one is parsed (on by default).
+    IndexBuilder& SetReadAhead(bool value) { m_readAhead = value; return *this; }
+
     IndexBuilder& SetCachingEnabled(bool value) { m_isCacheEnabled = value; return *this; }
 
     virtual std::wstring GetCacheFilename() = 0;
@@ -88,15 +140,16 @@ protected:
     FileWrapper m_input;
     CorpusDescriptorPtr m_corpus;
     size_t m_bufferSize;
+    bool m_readAhead;
     bool m_primary;
     size_t m_chunkSize;
 
     bool m_isCacheEnabled;
 
-    static const uint64_t s_version = 1;
+    static const uint64_t s_version = 2;
 
 private:
-    static std::shared_ptr<Index> TryLoadFromCache(const std::wstring& cacheFilename, size_t chunkSize);
+    std::shared_ptr<Index> TryLoadFromCache(const std::wstring& cacheFilename, size_t chunkSize);
     void WriteIndexCacheAsync(std::shared_ptr<Index>& index);
     std::shared_ptr<Index> m_index;
 
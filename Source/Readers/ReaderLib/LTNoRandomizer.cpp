@@ -5,6 +5,7 @@
 
 #define _CRT_SECURE_NO_WARNINGS
 #include "LTNoRandomizer.h"
+#include "ReaderStatistics.h"
 
 namespace CNTK {
 
@@ -29,7 +30,10 @@ void LTNoRandomizer::Prefetch() const
 
     auto chunkId = m_originalChunkDescriptions[m_currentChunkPosition].m_id;
     m_prefetchedChunk.m_info = m_originalChunkDescriptions[m_currentChunkPosition];
-    m_prefetchedChunk.m_data = m_deserializer->GetChunk(chunkId);
+    {
+        ScopeReaderStage stage(ReaderStage::GetChunk);
+        m_prefetchedChunk.m_data = m_deserializer->GetChunk(chunkId);
+    }
     m_prefetchedChunk.m_sequenceInfos.clear();
     m_prefetchedChunk.m_data->SequenceInfos(m_prefetchedChunk.m_sequenceInfos);
 }
@@ -8,41 +8,136 @@
 
 #include "LTTumblingWindowRandomizer.h"
 #include "RandomOrdering.h"
+#include "ThreadPool.h"
+#include "ReaderStatistics.h"
+#include <deque>
+#include <future>
 #include <tuple>
 
 namespace CNTK {
 
+using Microsoft::MSR::CNTK::RandMT;
 using Microsoft::MSR::CNTK::RandomShuffleMT;
+using Microsoft::MSR::CNTK::ThreadPool;
 
 // Properties used in the checkpoint.
 const static std::wstring s_chunkPositionProperty = L"chunkPosition";
 const static std::wstring s_sweepIndexProperty = L"sweepIndex";
 
+// Windows with more sequences than this are shuffled in parallel.
+const static size_t s_parallelShuffleBlockSize = 1 << 16;
+const static size_t s_maxParallelShuffleBlocks = 1 << 10;
+
+// Shuffles v[begin, end) on the thread pool: every element is sent to a random block, then the blocks are
+// shuffled independently and concatenated, which gives a uniformly random permutation as RandomShuffleMT does.
+// The number of blocks depends on the size only, and each block has its own generator seeded from 'seed'
+// and its index, so the result does not depend on the number of threads.
+template <class T>
+static void ParallelRandomShuffle(std::vector<T>& v, size_t begin, size_t end, size_t seed)
+{
+    const size_t size = end - begin;
+    const size_t numBlocks = std::min((size + s_parallelShuffleBlockSize - 1) / s_parallelShuffleBlockSize, s_maxParallelShuffleBlocks);
+    const size_t blockSize = (size + numBlocks - 1) / numBlocks;
+
+    auto generator = [seed](size_t index)
+    {
+        std::seed_seq sequence{ (uint32_t)seed, (uint32_t)((uint64_t)seed >> 32), (uint32_t)index };
+        return std::mt19937_64(sequence);
+    };
+
+    // Target block of every element, and the number of elements each source block sends to each target block.
+    std::vector<uint32_t> targets(size);
+    std::vector<size_t> counts(numBlocks * numBlocks, 0); // [source block][target block]
+    ThreadPool::Get().ParallelFor(0, numBlocks, 1, [&](size_t first, size_t last)
+    {
+        for (size_t block = first; block < last; ++block)
+        {
+            auto rng = generator(block);
+            size_t* blockCounts = &counts[block * numBlocks];
+            for (size_t i = block * blockSize; i < std::min(size, (block + 1) * blockSize); ++i)
+            {
+                targets[i] = (uint32_t)RandMT(0, numBlocks, rng);
+                blockCounts[targets[i]]++;
+            }
+        }
+    });
+
+    // Target blocks are laid out in order, each one with the elements of the source blocks in order.
+    std::vector<size_t> offsets(numBlocks * numBlocks);
+    std::vector<size_t> targetStart(numBlocks + 1);
+    size_t offset = 0;
+    for (size_t target = 0; target < numBlocks; ++target)
+    {
+        targetStart[target] = offset;
+        for (size_t block = 0; block < numBlocks; ++block)
+        {
+            offsets[block * numBlocks + target] = offset;
+            offset += counts[block * numBlocks + target];
+        }
+    }
+    targetStart[numBlocks] = offset;
+
+    std::vector<T> scattered(size);
+    ThreadPool::Get().ParallelFor(0, numBlocks, 1, [&](size_t first, size_t last)
+    {
+        for (size_t block = first; block < last; ++block)
+        {
+            size_t* blockOffsets = &offsets[block * numBlocks];
+            for (size_t i = block * blockSize; i < std::min(size, (block + 1) * blockSize); ++i)
+                scattered[blockOffsets[targets[i]]++] = std::move(v[begin + i]);
+        }
+    });
+
+    ThreadPool::Get().ParallelFor(0, numBlocks, 1, [&](size_t first, size_t last)
+    {
+        for (size_t target = first; target < last; ++target)
+        {
+            auto rng = generator(numBlocks + target);
+            RandomShuffleMT(scattered, targetStart[target], targetStart[target + 1], rng);
+            std::move(scattered.begin() + targetStart[target], scattered.begin() + targetStart[target + 1], v.begin() + begin + targetStart[target]);
+        }
+    });
+}
+
 LTTumblingWindowRandomizer::LTTumblingWindowRandomizer(
     DataDeserializerPtr deserializer,
     bool sampleBasedRandomizationWindow,
     size_t randomizationRange,
     size_t seedOffset,
     bool multithreadedGetNextSequences,
-    size_t maxNumberOfInvalidSequences)
+    size_t maxNumberOfInvalidSequences,
+    size_t maxNumberOfPrefetchedChunks)
     : Base(deserializer, { { s_chunkPositionProperty, 0}, { s_sweepIndexProperty, 0} }, multithreadedGetNextSequences, maxNumberOfInvalidSequences),
   m_randomizationRange(randomizationRange),
   m_seedOffset(seedOffset),
   m_chunkPosition(0),
   m_sampleBasedRandomizationWindow(sampleBasedRandomizationWindow),
+  m_maxNumberOfPrefetchedChunks(maxNumberOfPrefetchedChunks),
   m_sweepCount(0)
 {
+    if (maxNumberOfPrefetchedChunks == 0)
+        InvalidArgument("The number of prefetched chunks must be at least 1.");
+
     RandomizeChunks(m_sweepCount);
 }
 
 void LTTumblingWindowRandomizer::RandomizeWindow(size_t sweepCount, size_t chunkPositionOfWindow, size_t sequencePositionInWindow) const
 {
-    m_rng.seed((unsigned long)(chunkPositionOfWindow + sweepCount + m_seedOffset));
+    ScopeReaderStage stage(ReaderStage::Randomize);
+    const size_t seed = chunkPositionOfWindow + sweepCount + m_seedOffset;
+    if (m_maxNumberOfPrefetchedChunks > 1 && m_prefetchedSequences.size() - sequencePositionInWindow > s_parallelShuffleBlockSize)
+    {
+        ParallelRandomShuffle(m_prefetchedSequences, sequencePositionInWindow, m_prefetchedSequences.size(), seed);
+        return;
+    }
+
+    m_rng.seed((unsigned long)seed);
     RandomShuffleMT(m_prefetchedSequences, sequencePositionInWindow, m_prefetchedSequences.size(), m_rng);
 }
 
 void LTTumblingWindowRandomizer::RandomizeChunks(size_t sweepCount) const
 {
+    ScopeReaderStage stage(ReaderStage::Randomize);
     m_prefetchedChunkDescriptions = m_originalChunkDescriptions;
     m_rng.seed((unsigned long)sweepCount + m_seedOffset);
     RandomShuffleMT(m_prefetchedChunkDescriptions, m_rng);
@@ -59,6 +154,31 @@ void LTTumblingWindowRandomizer::Prefetch() const
     m_prefetchedChunks.clear();
     m_prefetchedSequences.clear();
 
+    // Chunks of this worker that are being loaded ahead, by position. How far to load is estimated
+    // from the chunk descriptions, the loop below still decides where the window ends.
+    // Loads do not cross the sweep boundary, the chunks of the next sweep are not randomized yet.
+    std::deque<std::pair<size_t, std::future<ChunkPtr>>> loads;
+    size_t nextLoadPosition = position;
+    int64_t rangeToLoad = range;
+    auto loadAhead = [&]()
+    {
+        while (loads.size() < m_maxNumberOfPrefetchedChunks && rangeToLoad > 0 && nextLoadPosition < m_prefetchedChunkDescriptions.size())
+        {
+            const auto& chunk = m_prefetchedChunkDescriptions[nextLoadPosition];
+            if (nextLoadPosition % Config().m_numberOfWorkers == Config().m_workerRank)
+            {
+                ChunkIdType id = chunk.m_id;
+                loads.emplace_back(nextLoadPosition, std::async(std::launch::async, [this, id]()
+                {
+                    ScopeReaderStage stage(ReaderStage::GetChunk);
+                    return m_deserializer->GetChunk(id);
+                }));
+                rangeToLoad -= m_sampleBasedRandomizationWindow ? (int64_t)chunk.m_numberOfSamples : 1;
+            }
+            nextLoadPosition++;
+        }
+    };
+
     size_t lastSequencePositionInWindow = 0;
     size_t lastWindowPosition = m_chunkPosition;
     while (range > 0)
@@ -69,7 +189,28 @@ void LTTumblingWindowRandomizer::Prefetch() const
             size_t oldSize = m_prefetchedSequences.size();
 
             // Query deserializer.
-            ChunkPtr data = m_deserializer->GetChunk(desc.m_id);
+            ChunkPtr data;
+            if (m_maxNumberOfPrefetchedChunks > 1)
+            {
+                if (loads.empty())
+                {
+                    // The estimate fell short.
+                    nextLoadPosition = position;
+                    rangeToLoad = range;
+                }
+
+                loadAhead();
+                assert(loads.front().first == position);
+                data = loads.front().second.get();
+                loads.pop_front();
+                loadAhead();
+            }
+            else
+            {
+                ScopeReaderStage stage(ReaderStage::GetChunk);
+                data = m_deserializer->GetChunk(desc.m_id);
+            }
+
             data->SequenceInfos(m_prefetchedSequences);
             m_prefetchedChunks.push_back(std::make_tuple(desc, data));
 
@@ -93,6 +234,8 @@ void LTTumblingWindowRandomizer::Prefetch() const
             // Switch to next sweep, randomize chunks.
             sweepIndex++;
             RandomizeChunks(sweepIndex);
+            nextLoadPosition = 0;
+            rangeToLoad = range;
 
             // Put a marker and reset window position to the beginning of the sweep.
             m_prefetchedSequences.push_back(s_endOfSweep);
@@ -110,7 +253,9 @@ void LTTumblingWindowRandomizer::Prefetch() const
 void LTTumblingWindowRandomizer::RefillSequenceWindow(SequenceWindow& window)
 {
     window.m_dataChunks.clear();
-    window.m_sequences = m_prefetchedSequences;
+
+    // The sequences of the previous window are cleared by the next Prefetch.
+    window.m_sequences.swap(m_prefetchedSequences);
     for (const auto& s : window.m_sequences)
         if (IsEndOfSweep(s))
             m_sweepCount++;
@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <random>
 #include <vector>
 #include "LocalTimelineRandomizerBase.h"
 
@@ -12,6 +13,9 @@ namespace CNTK {
 
 // LT - LocalTimeline
 // A randomizer that firstly randomizes chunks and then sequences inside a tumbling window of chunks.
+// The next window is prepared in the background while the current one is consumed. When
+// maxNumberOfPrefetchedChunks is bigger than one, its chunks are loaded that many at a time
+// (the deserializer must support concurrent GetChunk calls) and big windows are shuffled on the thread pool.
 class LTTumblingWindowRandomizer : public LocalTimelineRandomizerBase
 {
     typedef LocalTimelineRandomizerBase Base;
@@ -23,7 +27,8 @@ public:
         size_t randomizationRange,
         size_t seedOffset = 0,
         bool multithreadedGetNextSequences = false,
-        size_t maxNumberOfInvalidSequences= 0); // per worker
+        size_t maxNumberOfInvalidSequences= 0, // per worker
+        size_t maxNumberOfPrefetchedChunks = 1);
 
     std::map<std::wstring, size_t> GetInnerState() override;
     void SetInnerState(const std::map<std::wstring, size_t>& state) override;
@@ -37,6 +42,7 @@ private:
     const size_t m_randomizationRange;
     const size_t m_seedOffset;
     const bool m_sampleBasedRandomizationWindow;
+    const size_t m_maxNumberOfPrefetchedChunks;
 
     // Current chunk position that the randomizer works with.
     ChunkIdType m_chunkPosition;
@@ -8,7 +8,7 @@
 
 #include "LocalTimelineRandomizerBase.h"
 #include "DataReader.h"
-#include "ExceptionCapture.h"
+#include "ThreadPool.h"
 
 namespace CNTK {
 
@@ -229,11 +229,11 @@ Sequences LocalTimelineRandomizerBase::GetNextSequences(size_t /*ignoring global
 
     if (m_multithreadedGetNextSequences)
     {
-        ExceptionCapture capture;
-#pragma omp parallel for schedule(dynamic)
-        for (int i = 0; i < m_sequenceBuffer.size(); ++i)
-            capture.SafeRun(process, i);
-        capture.RethrowIfHappened();
+        Microsoft::MSR::CNTK::ThreadPool::Get().ParallelFor(0, m_sequenceBuffer.size(), 1, [&process](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                process((int)i);
+        });
     }
     else
     {
@@ -0,0 +1,115 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS
+#include "MemoryMappedFile.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#endif
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+
+#ifdef _WIN32
+
+MemoryMappedFile::MemoryMappedFile(const std::wstring& filename)
+    : m_filename(filename), m_data(nullptr), m_size(0), m_fileHandle(INVALID_HANDLE_VALUE), m_mappingHandle(nullptr)
+{
+    m_fileHandle = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (m_fileHandle == INVALID_HANDLE_VALUE)
+        RuntimeError("Cannot open file '%ls' for memory mapping (error %u).", filename.c_str(), (unsigned int)GetLastError());
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_fileHandle, &size))
+        RuntimeError("Cannot get the size of file '%ls' (error %u).", filename.c_str(), (unsigned int)GetLastError());
+    m_size = (size_t)size.QuadPart;
+    if (m_size == 0)
+        return;
+
+    m_mappingHandle = CreateFileMappingW(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mappingHandle)
+        RuntimeError("Cannot create a mapping of file '%ls' (error %u).", filename.c_str(), (unsigned int)GetLastError());
+
+    m_data = static_cast<const char*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data)
+        RuntimeError("Cannot map file '%ls' (error %u).", filename.c_str(), (unsigned int)GetLastError());
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mappingHandle)
+        CloseHandle(m_mappingHandle);
+    if (m_fileHandle != INVALID_HANDLE_VALUE)
+        CloseHandle(m_fileHandle);
+}
+
+void MemoryMappedFile::WillNeed(size_t /*offset*/, size_t /*size*/) const
+{
+    // TODO: PrefetchVirtualMemory() requires Windows 8; until then the file is opened with
+    // FILE_FLAG_RANDOM_ACCESS and pages are brought in on first access.
+}
+
+#else
+
+MemoryMappedFile::MemoryMappedFile(const std::wstring& filename)
+    : m_filename(filename), m_data(nullptr), m_size(0)
+{
+    int fd = open(wtocharpath(filename.c_str()).c_str(), O_RDONLY);
+    if (fd < 0)
+        RuntimeError("Cannot open file '%ls' for memory mapping: %s.", filename.c_str(), strerror(errno));
+
+    // The mapping stays valid after the descriptor is closed.
+    auto closeFile = MakeScopeExit([fd]() { close(fd); });
+
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+        RuntimeError("Cannot get the size of file '%ls': %s.", filename.c_str(), strerror(errno));
+    m_size = (size_t)status.st_size;
+    if (m_size == 0)
+        return;
+
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+        RuntimeError("Cannot map file '%ls': %s.", filename.c_str(), strerror(errno));
+    m_data = static_cast<const char*>(data);
+
+    // Chunks are visited in random order, sequential read-ahead would only waste IO.
+    madvise(data, m_size, MADV_RANDOM);
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    if (m_data)
+        munmap(const_cast<char*>(m_data), m_size);
+}
+
+void MemoryMappedFile::WillNeed(size_t offset, size_t size) const
+{
+    if (!m_data || offset >= m_size)
+        return;
+
+    // madvise() expects a page aligned start address.
+    static const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t begin = offset / pageSize * pageSize;
+    size_t end = std::min(offset + size, m_size);
+    madvise(const_cast<char*>(m_data) + begin, end - begin, MADV_WILLNEED);
+}
+
+#endif
+
+}
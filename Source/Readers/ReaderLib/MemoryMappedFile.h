@@ -0,0 +1,48 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include "Basics.h"
+
+namespace CNTK {
+
+// A read-only mapping of a complete file into the address space of the process.
+// Deserializers can hand out pointers into the mapping instead of copying the data
+// into buffers of their own; the pages are then shared with the OS file cache.
+// Since access is expected to be random (chunks are picked by the randomizer),
+// the kernel read-ahead is switched off and WillNeed() should be used to announce
+// the ranges that are about to be read.
+class MemoryMappedFile
+{
+public:
+    explicit MemoryMappedFile(const std::wstring& filename);
+    ~MemoryMappedFile();
+
+    const char* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+    // Hints that the given range will be accessed soon, so that the OS
+    // starts reading it asynchronously. Does not block.
+    void WillNeed(size_t offset, size_t size) const;
+
+private:
+    std::wstring m_filename;
+    const char* m_data;
+    size_t m_size;
+#ifdef _WIN32
+    void* m_fileHandle;
+    void* m_mappingHandle;
+#endif
+
+    DISABLE_COPY_AND_MOVE(MemoryMappedFile);
+};
+
+typedef std::shared_ptr<MemoryMappedFile> MemoryMappedFilePtr;
+
+}
@@ -8,7 +8,8 @@
 
 #include "NoRandomizer.h"
 #include "DataReader.h"
-#include "ExceptionCapture.h"
+#include "ThreadPool.h"
+#include "ReaderStatistics.h"
 
 namespace CNTK {
 
@@ -205,6 +206,7 @@ Sequences NoRandomizer::GetNextSequences(size_t globalSampleCount, size_t localS
             }
             else
             {
+                ScopeReaderStage stage(ReaderStage::GetChunk);
                 chunks[s.m_chunkId] = m_deserializer->GetChunk(s.m_chunkId);
             }
         }
@@ -233,11 +235,11 @@ Sequences NoRandomizer::GetNextSequences(size_t globalSampleCount, size_t localS
     // TODO: This will be changed, when we move transformers under the (no-) randomizer, should not deal with multithreading here.
     if (m_multithreadedGetNextSequences)
     {
-        ExceptionCapture capture;
-#pragma omp parallel for schedule(dynamic)
-        for (int i = 0; i < m_sequenceBuffer.size(); ++i)
-            capture.SafeRun(process, i);
-        capture.RethrowIfHappened();
+        Microsoft::MSR::CNTK::ThreadPool::Get().ParallelFor(0, m_sequenceBuffer.size(), 1, [&process](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                process((int)i);
+        });
     }
     else
     {
@@ -7,6 +7,7 @@
 #include "ReaderBase.h"
 #include "CudaMemoryProvider.h"
 #include "HeapMemoryProvider.h"
+#include "ReaderStatistics.h"
 
 namespace CNTK {
 
@@ -60,6 +61,7 @@ void ReaderBase::StartEpoch(const EpochConfiguration& config, const std::map<std
 Minibatch ReaderBase::ReadMinibatch()
 {
     assert(m_packer != nullptr);
+    ScopeReaderStage stage(ReaderStage::Pack);
     return m_packer->ReadMinibatch();
 }
 
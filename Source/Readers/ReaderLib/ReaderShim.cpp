@@ -19,6 +19,9 @@
 #include "ReaderShim.h"
 #include "DataTransferer.h"
 #include "PerformanceProfiler.h"
+#include "ConfigUtil.h"
+#include "TimerUtility.h"
+#include "ReaderStatistics.h"
 
 namespace CNTK {
 
@@ -42,8 +45,15 @@ inline TensorShape AsTensorShape(const NDShape& viewShape)
 template <class ElemType>
 ReaderShim<ElemType>::ReaderShim() :
     m_deviceId(CPUDEVICE),
-    m_dataTransferers(2, DataTransfererPtr()),
-    m_currentDataTransferIndex(0),
+    m_prefetchSlots(1),
+    m_nextSlotToConsume(0),
+    m_prefetchDepth(1),
+    m_numReadsStarted(0),
+    m_numReadsDone(0),
+    m_prefetchedEndOfEpoch(false),
+    m_prefetchAcrossEpochs(false),
+    m_startedNextEpoch(false),
+    m_verbosity(0),
     m_endOfEpoch(false),
     m_endOfSweep(false),
     m_reader(nullptr),
@@ -76,6 +86,11 @@ void ReaderShim<ElemType>::Init(const ConfigParameters& config)
     // otherwise deferring - synchronous execution during .get() call
     m_launchType = prefetch ? launch::async : launch::deferred;
 
+    // Deferred prefetches only run when their result is requested, so reading ahead would not help.
+    m_prefetchDepth = prefetch ? GetPrefetchDepth(config) : 1;
+    m_prefetchAcrossEpochs = prefetch && config(L"prefetchAcrossEpochs", true);
+    m_verbosity = config(L"verbosity", 0);
+
     m_numParallelSequences = numberOfuttsPerMinibatchForAllEpochs[0];
 
     if (!m_reader)
@@ -122,14 +137,8 @@ void ReaderShim<ElemType>::SetCurrentSamplePosition(size_t currentSamplePosition
     if (GetCurrentSamplePosition() == currentSamplePosition)
         return;
 
-    // Make sure there are no outstanding reads.
-    if (m_prefetchTask.valid())
-        m_prefetchTask.wait();
-
-    // Let's check that there is no outstanding copies.
-    // Wait on all events if there are any pending copy operations in flight.
-    if (m_dataTransferers[m_currentDataTransferIndex])
-        m_dataTransferers[m_currentDataTransferIndex]->WaitForCopyCPUToGPU();
+    // The prefetched minibatches are from the old position.
+    DiscardPrefetchedMinibatches();
 
     // Set current position.
     std::map<std::wstring, size_t> state;
@@ -143,30 +152,86 @@ void ReaderShim<ElemType>::SetCurrentSamplePosition(size_t currentSamplePosition
 template <class ElemType>
 void ReaderShim<ElemType>::SetConfiguration(const ReaderConfiguration& config, const std::map<std::wstring, int>& inputDescriptions)
 {
-    // Make sure there are no outstanding reads.
-    if (m_prefetchTask.valid())
-        m_prefetchTask.get();
-
-    // Let's check that there is no outstanding copies.
-    // Wait on all events if there are any pending copy operations in flight.
-    if (m_dataTransferers[m_currentDataTransferIndex])
-        m_dataTransferers[m_currentDataTransferIndex]->WaitForCopyCPUToGPU();
+    // Make sure there are no outstanding reads, the reader is rewound to the current state below.
+    DiscardPrefetchedMinibatches();
 
     m_reader->SetConfiguration(config, inputDescriptions);
     m_reader->SetState(m_currentState);
+    *((ReaderConfiguration*)&m_epochConfig) = config;
+}
+
+// Whether the epoch 'next' follows 'current' with the same configuration.
+static bool IsFollowingEpoch(const EpochConfiguration& current, const EpochConfiguration& next)
+{
+    return next.m_epochIndex == current.m_epochIndex + 1 &&
+        next.m_totalEpochSizeInSamples == current.m_totalEpochSizeInSamples &&
+        next.m_totalEpochSizeInSweeps == current.m_totalEpochSizeInSweeps &&
+        next.m_numberOfWorkers == current.m_numberOfWorkers &&
+        next.m_workerRank == current.m_workerRank &&
+        next.m_minibatchSizeInSamples == current.m_minibatchSizeInSamples &&
+        next.m_truncationSize == current.m_truncationSize &&
+        next.m_rightSplice == current.m_rightSplice &&
+        next.m_maxErrors == current.m_maxErrors &&
+        next.m_allowMinibatchesToCrossSweepBoundaries == current.m_allowMinibatchesToCrossSweepBoundaries;
+}
+
+template <class ElemType>
+bool ReaderShim<ElemType>::IsEpochStartedAhead(const EpochConfiguration& config, const std::unordered_set<InputStreamDescription>& inputs)
+{
+    // The current epoch has to be read to its end, and the prefetches must fill the same buffers.
+    if (!m_prefetchAcrossEpochs || !m_endOfEpoch || m_prefetchTasks.empty() ||
+        !IsFollowingEpoch(m_epochConfig, config) || inputs != m_inputs)
+        return false;
+
+    // The oldest prefetch is the first one after the end of the epoch, which started the next epoch.
+    m_prefetchTasks.front().wait();
+    std::lock_guard<std::mutex> lock(m_readMutex);
+    return m_startedNextEpoch;
+}
+
+template <class ElemType>
+void ReaderShim<ElemType>::StartNextEpochAhead()
+{
+    auto config = m_epochConfig;
+    config.m_epochIndex++;
+    m_reader->StartEpoch(config, m_inputDescriptions);
+    m_nextEpochStartState = m_reader->GetState();
+    m_startedNextEpoch = true;
+    m_prefetchedEndOfEpoch = false;
+
+    if (m_verbosity > 0)
+        fprintf(stderr, "ReaderShim: started epoch %d ahead\n", (int)config.m_epochIndex + 1);
 }
 
 template <class ElemType>
 void ReaderShim<ElemType>::StartEpoch(const EpochConfiguration& config, const std::unordered_set<InputStreamDescription>& inputs)
 {
+    bool isStartedAhead = IsEpochStartedAhead(config, inputs);
+
     // For adaptive minibatch, make sure there are no outstanding reads.
-    if (m_prefetchTask.valid())
-        m_prefetchTask.get();
+    if (!isStartedAhead)
+        DiscardPrefetchedMinibatches(/*restoreEpoch =*/ false);
 
-    // Let's check that there is no outstanding copies.
-    // Wait on all events if there are any pending copy operations in flight.
-    if (m_dataTransferers[m_currentDataTransferIndex])
-        m_dataTransferers[m_currentDataTransferIndex]->WaitForCopyCPUToGPU();
+    if (m_verbosity > 0 && m_prefetchStatistics.m_numMinibatches > 0)
+    {
+        fprintf(stderr, "ReaderShim: %d minibatches, %.2f of %d prefetched on average when requested, %.3fs spent waiting for data\n",
+                (int)m_prefetchStatistics.m_numMinibatches, m_prefetchStatistics.AverageOccupancy(), (int)m_prefetchDepth,
+                m_prefetchStatistics.m_waitTimeInSeconds);
+        ReaderStatistics::PrintSummary(stderr, "ReaderShim: ");
+    }
+    m_prefetchStatistics = PrefetchStatistics();
+    ReaderStatistics::Reset();
+
+    if (isStartedAhead)
+    {
+        // The prefetches in flight go on with this epoch, into the same buffers and on the same device.
+        std::lock_guard<std::mutex> lock(m_readMutex);
+        m_epochConfig = config;
+        m_startedNextEpoch = false;
+        m_currentState = m_nextEpochStartState;
+        m_endOfEpoch = false;
+        return;
+    }
 
     // Now we can be sure, no prefetch thread is running and there are no outstanding memcopies.
     // Let's check that requested devices are ok and see whether we need to change our data transferers.
@@ -182,14 +247,16 @@ void ReaderShim<ElemType>::StartEpoch(const EpochConfiguration& config, const st
         LogicError("Readers do not support running on several GPUs in the same process, at least two devices found '%d', '%d'", deviceId, secondDevice->GetDeviceId());
     }
 
-    if (m_deviceId != deviceId)
+    if (m_deviceId != deviceId || m_prefetchSlots.size() != m_prefetchDepth)
     {
-        // Device changed. Let's change the data transferers.
+        // Device or depth changed. Let's change the data transferers, one per slot in order to support
+        // that many copy operations in flight.
         m_deviceId = deviceId;
-        m_dataTransferers.clear();
-        // We need two in order to support two operations in flight.
-        m_dataTransferers.push_back(m_deviceId == CPUDEVICE ? nullptr : CreatePrefetchDataTransferer(m_deviceId));
-        m_dataTransferers.push_back(m_deviceId == CPUDEVICE ? nullptr : CreatePrefetchDataTransferer(m_deviceId));
+        m_prefetchSlots.clear();
+        m_prefetchSlots.resize(m_prefetchDepth);
+        for (auto& slot : m_prefetchSlots)
+            slot.m_dataTransferer = m_deviceId == CPUDEVICE ? nullptr : CreatePrefetchDataTransferer(m_deviceId);
+        m_nextSlotToConsume = 0;
     }
 
     // Let's create the buffers for the prefetch thread.
@@ -198,16 +265,22 @@ void ReaderShim<ElemType>::StartEpoch(const EpochConfiguration& config, const st
     {
         inputDescriptions[i.GetStreamName()] = i.GetDeviceId();
         // Creating buffers with the same properties the network expects.
-        m_prefetchBuffers[i.GetStreamName()] = StreamPrefetchBuffer
+        for (auto& slot : m_prefetchSlots)
         {
-            std::make_shared<Matrix<ElemType>>(0, 0, i.GetDeviceId(), i.GetMatrixType(), i.GetMatrixFormat()),
-            std::make_shared<MBLayout>(),
-            NDShape::Unknown()
-        };
+            slot.m_buffers[i.GetStreamName()] = StreamPrefetchBuffer
+            {
+                std::make_shared<Matrix<ElemType>>(0, 0, i.GetDeviceId(), i.GetMatrixType(), i.GetMatrixFormat()),
+                std::make_shared<MBLayout>(),
+                NDShape::Unknown()
+            };
+        }
     }
 
     m_endOfEpoch = false;
     m_reader->StartEpoch(config, inputDescriptions);
+    m_epochConfig = config;
+    m_inputs = inputs;
+    m_inputDescriptions = inputDescriptions;
 
     m_currentState = m_reader->GetState();
 }
@@ -215,14 +288,51 @@ void ReaderShim<ElemType>::StartEpoch(const EpochConfiguration& config, const st
 template <class ElemType>
 void ReaderShim<ElemType>::StartAsyncPrefetching()
 {
-    auto localCurrentDataTransferIndex = m_currentDataTransferIndex;
-    // Starting the prefetch task. There is always a single async read in flight.
-    // When the network requests a new minibatch, we wait for the current async to finish, swap the buffers
-    // and kick off the new prefetch.
-    m_prefetchTask = std::async(m_launchType, [this, localCurrentDataTransferIndex]()
+    // Starting the prefetch tasks. There are always m_prefetchDepth async reads in flight, each into its own slot.
+    // When the network requests a new minibatch, we wait for the oldest one to finish, swap the buffers
+    // and kick off a new prefetch into the slot that got free.
+    while (m_prefetchTasks.size() < m_prefetchSlots.size())
+    {
+        size_t slotIndex = (m_nextSlotToConsume + m_prefetchTasks.size()) % m_prefetchSlots.size();
+        size_t readIndex = m_numReadsStarted++;
+        m_prefetchTasks.push_back(std::async(m_launchType, [this, slotIndex, readIndex]()
+        {
+            return PrefetchMinibatch(slotIndex, readIndex);
+        }));
+    }
+}
+
+template <class ElemType>
+void ReaderShim<ElemType>::DiscardPrefetchedMinibatches(bool restoreEpoch)
+{
+    // Make sure there are no outstanding reads.
+    // Deferred tasks have to run as well, later ones wait for them to read.
+    while (!m_prefetchTasks.empty())
+    {
+        m_prefetchTasks.front().get();
+        m_prefetchTasks.pop_front();
+    }
+
+    // Let's check that there is no outstanding copies.
+    // Wait on all events if there are any pending copy operations in flight.
+    for (auto& slot : m_prefetchSlots)
+    {
+        if (slot.m_dataTransferer)
+            slot.m_dataTransferer->WaitForCopyCPUToGPU();
+    }
+
+    m_prefetchedEndOfEpoch = false;
+
+    if (m_startedNextEpoch)
     {
-        return PrefetchMinibatch(localCurrentDataTransferIndex);
-    });
+        // A prefetch has started the next epoch, let's go back to the current one.
+        m_startedNextEpoch = false;
+        if (restoreEpoch)
+        {
+            m_reader->StartEpoch(m_epochConfig, m_inputDescriptions);
+            m_reader->SetState(m_currentState);
+        }
+    }
 }
 
 string EnumerateInputs(const unordered_map<wstring, size_t>& nameToStreamId)
@@ -266,41 +376,54 @@ bool ReaderShim<ElemType>::GetMinibatch(StreamMinibatchInputs& matrices)
         }
     }
 
-    if (!m_prefetchTask.valid())
+    if (m_prefetchTasks.empty())
         StartAsyncPrefetching();
 
-    auto result = m_prefetchTask.get();
+    for (auto& prefetchTask : m_prefetchTasks)
+    {
+        if (prefetchTask.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+            m_prefetchStatistics.m_numReadyOnRequest++;
+    }
+
+    Timer waitTimer;
+    waitTimer.Start();
+    ScopeReaderStage wait(ReaderStage::Wait);
+    auto result = m_prefetchTasks.front().get();
+    m_prefetchTasks.pop_front();
+    waitTimer.Stop();
+    m_prefetchStatistics.m_waitTimeInSeconds += waitTimer.ElapsedSeconds();
+    m_prefetchStatistics.m_numMinibatches++;
 
     // Ok, prefetch is done.
+    auto& slot = m_prefetchSlots[m_nextSlotToConsume];
+    m_nextSlotToConsume = (m_nextSlotToConsume + 1) % m_prefetchSlots.size();
 
     // Let's update our sample position.
-    m_currentState = m_reader->GetState();
+    m_currentState = slot.m_readerState;
 
     m_endOfEpoch = result.m_isEndOfEpoch;
     m_endOfSweep = result.m_isEndOfSweep;
     if (m_endOfEpoch && !result.m_isDataAvailable)
     {
-        // No data and end of epoch, simply return.
+        // No data and end of epoch, simply return. The slot is free, so the next epoch can be prefetched into it.
+        if (m_prefetchAcrossEpochs)
+            StartAsyncPrefetching();
         return false;
     }
 
-    // Remember current data transfer, async memcpy for it already started on the prefetch thread.
-    auto currentDataTransferIndex = m_currentDataTransferIndex;
-
+    m_getKeyById = slot.m_getKeyById;
     matrices.m_getKeyById = m_getKeyById;
 
-    // Let's update the current data transferer.
-    m_currentDataTransferIndex = (m_currentDataTransferIndex + 1) % 2;
-
-    // Record an event that prefetch can wait on to ensure that prior compute has finished.
-    if (m_dataTransferers[m_currentDataTransferIndex])
-        m_dataTransferers[m_currentDataTransferIndex]->RecordComputeStreamSyncPoint();
+    // The memcopy into the slot was started on the prefetch thread. Only the compute stream has to wait till it has
+    // finished, so that this thread can go on queuing the work of the minibatch.
+    if (slot.m_dataTransferer)
+        slot.m_dataTransferer->WaitForCopyCPUToGPUOnComputeStreamAsync();
 
     // We have some data - let's swap the matrices.
     // We cannot simply change pointers because it seems they are remembered deeper in the network.
     for (auto i = matrices.begin(); i != matrices.end(); ++i)
     {
-        std::swap(i->second.GetMatrix<ElemType>(), *m_prefetchBuffers[i->first].m_matrix);
+        std::swap(i->second.GetMatrix<ElemType>(), *slot.m_buffers[i->first].m_matrix);
 
         // Resetting layouts.
         i->second.pMBLayout->Init(1, 0);
@@ -312,7 +435,7 @@ bool ReaderShim<ElemType>::GetMinibatch(StreamMinibatchInputs& matrices)
     // Let's now check the layouts and throw if the same layout is being assigned twice.
     for (auto i = matrices.begin(); i != matrices.end(); ++i)
     {
-        auto streamLayout = m_prefetchBuffers[i->first].m_mbLayout;
+        auto streamLayout = slot.m_buffers[i->first].m_mbLayout;
         auto& layout = i->second.pMBLayout;
         if (layout->GetNumCols() == 0) // just initialized, let's take the layout of the reader.
         {
@@ -329,7 +452,7 @@ bool ReaderShim<ElemType>::GetMinibatch(StreamMinibatchInputs& matrices)
         }
 
         // Check sample shape.
-        const auto& sampleShape = m_prefetchBuffers[i->first].m_sampleShape;
+        const auto& sampleShape = slot.m_buffers[i->first].m_sampleShape;
         if (i->second.sampleLayout.size() == 0 || AsNDShape(i->second.sampleLayout).IsUnknown()) // Not set.
         {
             i->second.sampleLayout = AsTensorShape(sampleShape);
@@ -345,54 +468,111 @@ bool ReaderShim<ElemType>::GetMinibatch(StreamMinibatchInputs& matrices)
     // So pick up the first one.
     m_numParallelSequences = matrices.begin()->second.pMBLayout->GetNumParallelSequences();
 
-    // It is time to issue the next prefetch.
-    if (!m_endOfEpoch)
+    // The slot now holds the matrices of the previous minibatch, which the network may still be computing on.
+    // Record an event that prefetch can wait on to ensure that prior compute has finished.
+    if (slot.m_dataTransferer)
+        slot.m_dataTransferer->RecordComputeStreamSyncPoint();
+
+    // It is time to issue the next prefetch, after the end of the epoch only if the next one is read ahead.
+    if (!m_endOfEpoch || m_prefetchAcrossEpochs)
     {
         StartAsyncPrefetching();
     }
 
-    // Let's wait till the previous memcopy has finished.
-    if (m_dataTransferers[currentDataTransferIndex])
-        m_dataTransferers[currentDataTransferIndex]->WaitForCopyCPUToGPU();
-
     return result.m_isDataAvailable;
 }
 
+// Returns the number of bytes copied.
 template <class ElemType>
-void FillMatrixFromStream(StorageFormat type, Matrix<ElemType>* matrix, size_t numRows, const StreamMinibatchPtr& stream, DataTransferer* transferer)
+size_t FillMatrixFromStream(StorageFormat type, Matrix<ElemType>* matrix, size_t numRows, const StreamMinibatchPtr& stream, DataTransferer* transferer)
 {
     size_t numCols = stream->m_layout->GetNumCols();
+    GPUMemoryCategoryScope memoryCategory(GPUMemoryCategory::ReaderBuffers);
 
     if (type == StorageFormat::Dense)
     {
         auto data = reinterpret_cast<const ElemType*>(stream->m_data);
         matrix->SetValue(numRows, numCols, matrix->GetDeviceId(), const_cast<ElemType*>(data), matrixFlagNormal, transferer);
+        return numRows * numCols * sizeof(ElemType);
     }
     else if (type == StorageFormat::SparseCSC)
     {
         // In the sparse case the m_data layout is identical to CUDA's CSC layout
-        // (see http://docs.nvidia.com/cuda/cusparse/#compressed-sparse-column-format-csc).
+        // (see http://docs.nvidia.com/cuda/cusparse/#compressed-sparse-column-format-csc),
+        // so a GPU matrix takes it from the pinned buffer with a single transfer.
         size_t* data = reinterpret_cast<size_t*>(stream->m_data);
         size_t nnzCount = *data;
         ElemType* values = reinterpret_cast<ElemType*>(data + 1);
         IndexType* rows = reinterpret_cast<IndexType*>(values + nnzCount);
         IndexType* columns = reinterpret_cast<IndexType*>(rows + nnzCount);
         matrix->SetMatrixFromCSCFormat(columns, rows, values, nnzCount, numRows, numCols, transferer);
+        return nnzCount * (sizeof(ElemType) + sizeof(IndexType)) + (numCols + 1) * sizeof(IndexType);
     }
     else
         RuntimeError("Storage type %d is not supported.", (int)type);
 }
 
 template <class ElemType>
-typename ReaderShim<ElemType>::PrefetchResult ReaderShim<ElemType>::PrefetchMinibatch(size_t currentDataTransferIndex)
+typename ReaderShim<ElemType>::PrefetchResult ReaderShim<ElemType>::PrefetchMinibatch(size_t slotIndex, size_t readIndex)
 {
     PROFILE_SCOPE(profilerEvtPrefetchMinibatch);
 
+    auto& slot = m_prefetchSlots[slotIndex];
+
     // Resetting layouts.
-    for (auto& mx : m_prefetchBuffers)
+    for (auto& mx : slot.m_buffers)
         mx.second.m_mbLayout = std::make_shared<MBLayout>();
 
-    Minibatch minibatch = m_reader->ReadMinibatch();
+    Minibatch minibatch;
+    std::vector<StreamInformation> streams;
+    std::vector<size_t> streamIds;
+    {
+        // The reader is not thread safe, and minibatches have to be read in the order of the slots.
+        std::unique_lock<std::mutex> lock(m_readMutex);
+        m_readDone.wait(lock, [this, readIndex]() { return m_numReadsDone == readIndex; });
+        auto markReadDone = MakeScopeExit([this]()
+        {
+            m_numReadsDone++;
+            m_readDone.notify_all();
+        });
+
+        // The packer cycles through m_prefetchDepth + 1 buffers, so this read reuses the buffer of the read before
+        // the previous one, which was copied by the transferer of the previous slot. Nobody waits for that copy
+        // on the host anymore, so let's make sure it has finished before the buffer is overwritten.
+        // The transferer may already have recorded the copy of the previous read, which comes later on the same stream.
+        auto& previousSlot = m_prefetchSlots[(slotIndex + m_prefetchSlots.size() - 1) % m_prefetchSlots.size()];
+        if (previousSlot.m_dataTransferer)
+            previousSlot.m_dataTransferer->WaitForCopyCPUToGPU();
+
+        // Nothing is left to read after the end of the epoch, unless the next epoch is read ahead.
+        if (m_prefetchedEndOfEpoch && m_prefetchAcrossEpochs && !m_startedNextEpoch)
+            StartNextEpochAhead();
+
+        if (m_prefetchedEndOfEpoch)
+            minibatch.m_endOfEpoch = true;
+        else
+        {
+            minibatch = m_reader->ReadMinibatch();
+            m_prefetchedEndOfEpoch = minibatch.m_endOfEpoch;
+        }
+
+        slot.m_readerState = m_reader->GetState();
+
+        bool isSampleLayoutUnknown = false;
+        for (auto& mx : slot.m_buffers)
+        {
+            streamIds.push_back(m_nameToStreamId[mx.first]);
+            isSampleLayoutUnknown |= m_streams[streamIds.back()].m_sampleLayout.IsUnknown();
+        }
+
+        if (isSampleLayoutUnknown && !minibatch.m_data.empty())
+        {
+            // Sample layout can be lazily updated on the first minibatch, so let reread it.
+            // In the future we should use NDShape for the sequence instead of sample.
+            m_streams = m_reader->GetStreamDescriptions();
+        }
+        streams = m_streams;
+    }
 
     // If there is no data we can simply return.
     if (minibatch.m_data.empty())
@@ -402,32 +582,27 @@ typename ReaderShim<ElemType>::PrefetchResult ReaderShim<ElemType>::PrefetchMini
     // But before we need to make sure that corresponding compute has already finished from the last iteration.
 
     // We need to make sure that the compute for the current transfer is finished before we start prefetch.
-    if (m_dataTransferers[currentDataTransferIndex])
-        m_dataTransferers[currentDataTransferIndex]->WaitForSyncPointOnAssignStreamAsync();
+    if (slot.m_dataTransferer)
+        slot.m_dataTransferer->WaitForSyncPointOnAssignStreamAsync();
 
-    m_getKeyById = minibatch.m_getKeyById;
+    slot.m_getKeyById = minibatch.m_getKeyById;
 
-    for (auto& mx : m_prefetchBuffers)
+    ScopeReaderStage transfer(ReaderStage::Transfer);
+    auto streamId = streamIds.begin();
+    for (auto& mx : slot.m_buffers)
     {
-        size_t streamId = m_nameToStreamId[mx.first];
-        const auto& stream = minibatch.m_data[streamId];
+        const auto& stream = minibatch.m_data[*streamId];
         mx.second.m_mbLayout = stream->m_layout;
         mx.second.m_sampleShape = stream->m_sampleShape;
 
-        if (m_streams[streamId].m_sampleLayout.IsUnknown())
-        {
-            // Sample layout can be lazily updated on the first minibatch, so let reread it.
-            // In the future we should use NDShape for the sequence instead of sample.
-            m_streams = m_reader->GetStreamDescriptions();
-        }
-
-        size_t sampleSize = m_streams[streamId].m_sampleLayout.TotalSize();
-        FillMatrixFromStream(m_streams[streamId].m_storageFormat, mx.second.m_matrix.get(), sampleSize, stream, m_dataTransferers[currentDataTransferIndex].get());
+        size_t sampleSize = streams[*streamId].m_sampleLayout.TotalSize();
+        transfer.AddBytes(FillMatrixFromStream(streams[*streamId].m_storageFormat, mx.second.m_matrix.get(), sampleSize, stream, slot.m_dataTransferer.get()));
+        ++streamId;
     }
 
     // Let's record that we started the copy, so that the main thread can wait afterwards.
-    if (m_dataTransferers[currentDataTransferIndex])
-        m_dataTransferers[currentDataTransferIndex]->RecordCPUToGPUCopy();
+    if (slot.m_dataTransferer)
+        slot.m_dataTransferer->RecordCPUToGPUCopy();
 
     return PrefetchResult{ minibatch.m_endOfSweep, minibatch.m_endOfEpoch, true };
 }
@@ -474,14 +649,8 @@ void ReaderShim<ElemType>::SetState(const std::map<std::wstring, size_t>& state)
     if (m_currentState == state)
         return;
 
-    // Make sure there are no outstanding reads.
-    if (m_prefetchTask.valid())
-        m_prefetchTask.wait();
-
-    // Let's check that there is no outstanding copies.
-    // Wait on all events if there are any pending copy operations in flight.
-    if (m_dataTransferers[m_currentDataTransferIndex])
-        m_dataTransferers[m_currentDataTransferIndex]->WaitForCopyCPUToGPU();
+    // The prefetched minibatches are from the old state.
+    DiscardPrefetchedMinibatches();
 
     // Set current position.
     m_reader->SetState(state);
@@ -11,6 +11,9 @@
 #include <unordered_map>
 #include <string>
 #include <future>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 #include "DataReader.h"
 #include "Reader.h"
 
@@ -50,10 +53,10 @@ public:
         // Make sure there are no outstanding reads.
         // Future destructor does not wait as of 2013 so probably it is not in VS2013:
         // More info can be found here http://www.open-std.org/jtc1/sc22/wg21/docs/papers/2013/n3679.html.
-        if (m_prefetchTask.valid())
+        for (auto& prefetchTask : m_prefetchTasks)
         {
             // If there are some, give them time to finish.
-            m_prefetchTask.wait_for(std::chrono::seconds(60));
+            prefetchTask.wait_for(std::chrono::seconds(60));
             // TODO: if the prefetch is still valid, print a warning here!
         }
 
@@ -114,10 +117,36 @@ public:
         return m_endOfSweep;
     }
 
+    // Prefetch statistics since the start of the epoch.
+    struct PrefetchStatistics
+    {
+        size_t m_numMinibatches = 0;   // minibatches handed out by GetMinibatch()
+        size_t m_numReadyOnRequest = 0; // sum over these of the number of prefetched minibatches that were already available
+        double m_waitTimeInSeconds = 0; // time GetMinibatch() spent waiting for the reader
+
+        double AverageOccupancy() const { return m_numMinibatches ? (double)m_numReadyOnRequest / m_numMinibatches : 0.0; }
+    };
+
+    const PrefetchStatistics& GetPrefetchStatistics() const
+    {
+        return m_prefetchStatistics;
+    }
+
 private:
 
     void StartAsyncPrefetching();
 
+    // Waits for all in-flight prefetches and drops their results, e.g. before the reader state is changed.
+    // If a prefetch has started the next epoch ahead, the reader is rewound to the current state unless restoreEpoch is false.
+    void DiscardPrefetchedMinibatches(bool restoreEpoch = true);
+
+    // Starts the epoch following m_epochConfig on the reader, from a prefetch that hit the end of the current epoch.
+    // Must be called with m_readMutex held.
+    void StartNextEpochAhead();
+
+    // Whether the prefetches in flight read the epoch 'config', because a prefetch started it ahead. Waits for that prefetch.
+    bool IsEpochStartedAhead(const EpochConfiguration& config, const std::unordered_set<MSR_CNTK::InputStreamDescription>& inputs);
+
     struct PrefetchResult
     {
         bool m_isEndOfSweep;
@@ -125,9 +154,39 @@ private:
         bool m_isDataAvailable;
     };
 
-    PrefetchResult PrefetchMinibatch(size_t currentDataTransferIndex);
+    PrefetchResult PrefetchMinibatch(size_t slotIndex, size_t readIndex);
+
+    // In-flight prefetches, oldest first. The oldest one fills m_prefetchSlots[m_nextSlotToConsume],
+    // the following ones the next slots in round robin order.
+    std::deque<std::future<PrefetchResult>> m_prefetchTasks;
+    size_t m_nextSlotToConsume;
+
+    // Number of minibatches to read ahead (reader config "prefetchDepth", see GetPrefetchDepth()).
+    size_t m_prefetchDepth;
+
+    // Prefetch tasks may run concurrently, but have to call the reader one at a time and in the order
+    // in which they were started. m_numReadsStarted orders the tasks, m_numReadsDone is the next one to read.
+    std::mutex m_readMutex;
+    std::condition_variable m_readDone;
+    size_t m_numReadsStarted;
+    size_t m_numReadsDone;
+    bool m_prefetchedEndOfEpoch; // a prefetch hit the end of the epoch, later ones have nothing to read
+
+    // With "prefetchAcrossEpochs", the prefetch after the end of the epoch starts the next epoch with the same
+    // configuration and goes on reading it, so that there is no gap till the first minibatch of the next epoch.
+    // If StartEpoch() then asks for a different configuration, these minibatches are dropped.
+    bool m_prefetchAcrossEpochs;
+    bool m_startedNextEpoch; // a prefetch started the epoch after m_epochConfig
+    std::map<std::wstring, size_t> m_nextEpochStartState;
+
+    // Configuration and inputs of the current epoch.
+    EpochConfiguration m_epochConfig;
+    std::unordered_set<MSR_CNTK::InputStreamDescription> m_inputs;
+    std::map<std::wstring, int> m_inputDescriptions;
+
+    PrefetchStatistics m_prefetchStatistics;
+    int m_verbosity;
 
-    std::future<PrefetchResult> m_prefetchTask;
     ReaderPtr m_reader;
     ReaderFactory m_factory;
     bool m_endOfEpoch;
@@ -148,22 +207,28 @@ private:
         NDShape m_sampleShape;
     };
 
-    // Intermediate buffer where the prefetch thread puts its data to.
-    // When the main thread enters GetMinibatch it swaps the matrices from this buffer,
-    // triggers the next prefetch and waits if memCpy is still in progress.
-    std::unordered_map<std::wstring, StreamPrefetchBuffer> m_prefetchBuffers;
+    // A prefetched minibatch. A prefetch task puts its data into the buffers of a slot and starts
+    // the copy to the device with the slot's data transferer. When the main thread enters GetMinibatch
+    // it waits for the oldest slot, swaps the matrices from its buffers and triggers a new prefetch
+    // into that slot.
+    struct PrefetchSlot
+    {
+        std::unordered_map<std::wstring, StreamPrefetchBuffer> m_buffers;
+        MSR_CNTK::DataTransfererPtr m_dataTransferer; // null on the CPU
 
-    // Alternating data transfer operations. In the current version these are only two - 
-    // currently waiting on the main thread and the one that can be started by the prefetch thread 
-    // in the meantime.
-    std::vector<MSR_CNTK::DataTransfererPtr> m_dataTransferers;
+        // Id to key mapping.
+        std::function<std::string(size_t)> m_getKeyById;
 
-    // Id to key mapping.
-    std::function<std::string(size_t)> m_getKeyById;
+        // State of the reader right after this minibatch was read. This becomes the current state
+        // once the minibatch has been handed out, so that checkpoints do not skip prefetched data.
+        std::map<std::wstring, size_t> m_readerState;
+    };
 
-    // Current data transfer. Flips 0 and 1.
     // Can be changed only from the main thread with no ongoing prefetch.
-    size_t m_currentDataTransferIndex; 
+    std::vector<PrefetchSlot> m_prefetchSlots;
+
+    // Id to key mapping of the last minibatch.
+    std::function<std::string(size_t)> m_getKeyById;
 
     // Device id.
     int m_deviceId;
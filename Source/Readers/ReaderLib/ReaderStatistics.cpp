@@ -0,0 +1,122 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS
+#include "ReaderStatistics.h"
+#include <atomic>
+#include <string>
+#include "PerformanceProfiler.h"
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace {
+
+const char* s_stageNames[(int)ReaderStage::Count] = {
+    "file read", "get chunk", "randomize", "transform", "pack", "transfer", "wait"
+};
+
+#ifndef CNTK_UWP
+const int s_stageEvents[(int)ReaderStage::Count] = {
+    profilerEvtReaderFileRead, profilerEvtReaderGetChunk, profilerEvtReaderRandomize, profilerEvtReaderTransform,
+    profilerEvtReaderPack, profilerEvtReaderTransfer, profilerEvtReaderWait
+};
+#endif
+
+struct StageCounters
+{
+    std::atomic<size_t> m_numCalls;
+    std::atomic<long long> m_nanoseconds;
+    std::atomic<size_t> m_bytes;
+};
+
+// Zero initialized as a static.
+StageCounters s_counters[(int)ReaderStage::Count];
+
+}
+
+/*static*/ void ReaderStatistics::Record(ReaderStage stage, long long nanoseconds, size_t bytes)
+{
+    auto& counters = s_counters[(int)stage];
+    counters.m_numCalls.fetch_add(1, std::memory_order_relaxed);
+    counters.m_nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    if (bytes != 0)
+        counters.m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+/*static*/ ReaderStageStatistics ReaderStatistics::Get(ReaderStage stage)
+{
+    const auto& counters = s_counters[(int)stage];
+    return ReaderStageStatistics
+    {
+        counters.m_numCalls.load(std::memory_order_relaxed),
+        counters.m_nanoseconds.load(std::memory_order_relaxed) * 1e-9,
+        counters.m_bytes.load(std::memory_order_relaxed)
+    };
+}
+
+/*static*/ void ReaderStatistics::Reset()
+{
+    for (auto& counters : s_counters)
+    {
+        counters.m_numCalls.store(0, std::memory_order_relaxed);
+        counters.m_nanoseconds.store(0, std::memory_order_relaxed);
+        counters.m_bytes.store(0, std::memory_order_relaxed);
+    }
+}
+
+/*static*/ const char* ReaderStatistics::StageName(ReaderStage stage)
+{
+    return s_stageNames[(int)stage];
+}
+
+/*static*/ void ReaderStatistics::PrintSummary(FILE* output, const char* prefix)
+{
+    std::string summary;
+    for (int i = 0; i < (int)ReaderStage::Count; ++i)
+    {
+        auto statistics = Get((ReaderStage)i);
+        if (statistics.m_numCalls == 0)
+            continue;
+
+        char stage[128];
+        if (statistics.m_bytes != 0)
+            snprintf(stage, sizeof(stage), "%s %.3fs/%d (%.1f MB)", s_stageNames[i], statistics.m_timeInSeconds,
+                     (int)statistics.m_numCalls, statistics.m_bytes / (1024.0 * 1024.0));
+        else
+            snprintf(stage, sizeof(stage), "%s %.3fs/%d", s_stageNames[i], statistics.m_timeInSeconds, (int)statistics.m_numCalls);
+
+        summary += summary.empty() ? "" : ", ";
+        summary += stage;
+    }
+
+    if (!summary.empty())
+        fprintf(output, "%sreader stages (time/calls): %s\n", prefix, summary.c_str());
+}
+
+ScopeReaderStage::ScopeReaderStage(ReaderStage stage, size_t bytes)
+    : m_stage(stage), m_bytes(bytes)
+{
+#ifndef CNTK_UWP
+    m_profilerStateId = stage == ReaderStage::FileRead ? ProfilerThroughputBegin() : ProfilerTimeBegin();
+#endif
+    m_start = std::chrono::steady_clock::now();
+}
+
+ScopeReaderStage::~ScopeReaderStage()
+{
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start);
+    ReaderStatistics::Record(m_stage, (long long)elapsed.count(), m_bytes);
+
+#ifndef CNTK_UWP
+    if (m_stage == ReaderStage::FileRead)
+        ProfilerThroughputEnd(m_profilerStateId, s_stageEvents[(int)m_stage], (long long)m_bytes);
+    else
+        ProfilerTimeEnd(m_profilerStateId, s_stageEvents[(int)m_stage]);
+#endif
+}
+
+}
@@ -0,0 +1,73 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <stdio.h>
+#include <chrono>
+#include "Basics.h"
+
+namespace CNTK {
+
+// Stages of the reader pipeline that are measured. Stages nest: packing a minibatch includes getting
+// the chunks, randomizing and transforming its sequences, and getting a chunk includes reading files.
+enum class ReaderStage : int
+{
+    FileRead,  // FileWrapper reads
+    GetChunk,  // chunks requested from the deserializer by the randomizers
+    Randomize, // randomization decisions of the randomizers
+    Transform, // sequences transformed by the TransformController
+    Pack,      // ReadMinibatch() of the packer
+    Transfer,  // minibatch copies to the matrices (started on the prefetch thread)
+    Wait,      // time the network spends waiting for the minibatch and its copies
+    Count
+};
+
+struct ReaderStageStatistics
+{
+    size_t m_numCalls;
+    double m_timeInSeconds; // summed over all threads
+    size_t m_bytes;
+};
+
+// Time and bytes per stage of all readers of the process, since the last Reset(). Counting costs a few
+// atomic increments per measurement; each one is also reported to the performance profiler as a fixed event.
+class ReaderStatistics
+{
+public:
+    static void Record(ReaderStage stage, long long nanoseconds, size_t bytes);
+
+    static ReaderStageStatistics Get(ReaderStage stage);
+
+    static void Reset();
+
+    static const char* StageName(ReaderStage stage);
+
+    // Prints a line with the stages that were used since the last Reset().
+    static void PrintSummary(FILE* output, const char* prefix);
+};
+
+// Measures a stage for the lifetime of the object.
+class ScopeReaderStage
+{
+public:
+    explicit ScopeReaderStage(ReaderStage stage, size_t bytes = 0);
+    ~ScopeReaderStage();
+
+    void AddBytes(size_t bytes)
+    {
+        m_bytes += bytes;
+    }
+
+private:
+    ReaderStage m_stage;
+    size_t m_bytes;
+    long long m_profilerStateId;
+    std::chrono::steady_clock::time_point m_start;
+
+    DISABLE_COPY_AND_MOVE(ScopeReaderStage);
+};
+
+}
@@ -0,0 +1,710 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define __STDC_FORMAT_MACROS
+#define _CRT_SECURE_NO_WARNINGS
+#include <inttypes.h>
+#include "RemoteStorage.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "FileWrapper.h"
+#include "StringUtil.h"
+
+#ifdef USE_CURL
+#include <curl/curl.h>
+#endif
+
+namespace CNTK {
+
+using namespace std;
+using namespace Microsoft::MSR::CNTK;
+
+#ifdef USE_CURL
+
+// Range requests with libcurl. Credentials have to be part of the URL, e.g. an Azure shared access
+// signature or a pre-signed S3 URL; the size is taken from the first byte request rather than from
+// a HEAD request, since pre-signed URLs are only valid for GET.
+class HttpRangeReader : public RangeReader
+{
+public:
+    explicit HttpRangeReader(const wstring& url)
+        : m_url(ToLegacyString(ToUTF8(url)))
+    {
+        static once_flag initialized;
+        call_once(initialized, []() { curl_global_init(CURL_GLOBAL_DEFAULT); });
+
+        char byte;
+        Response response = Get(0, 1, &byte);
+        if (response.m_status == 200)
+            RuntimeError("'%s' does not support range requests.", m_url.c_str());
+        if (sscanf(response.m_contentRange.c_str(), "bytes 0-0/%" SCNu64, &m_size) != 1)
+            RuntimeError("Unexpected content range '%s' of '%s'.", response.m_contentRange.c_str(), m_url.c_str());
+        m_version = response.m_etag;
+    }
+
+    uint64_t Size() override { return m_size; }
+
+    string Version() override { return m_version; }
+
+    void Read(uint64_t offset, size_t size, char* buffer) override
+    {
+        if (size != 0)
+            Get(offset, size, buffer);
+    }
+
+private:
+    struct Response
+    {
+        long m_status = 0;
+        string m_contentRange;
+        string m_etag;
+    };
+
+    struct Transfer
+    {
+        char* m_buffer;
+        size_t m_size;
+        size_t m_received;
+        Response* m_response;
+    };
+
+    static size_t OnData(char* data, size_t size, size_t count, void* context)
+    {
+        auto transfer = static_cast<Transfer*>(context);
+        size_t bytes = size * count;
+        if (bytes > transfer->m_size - transfer->m_received)
+            return 0; // more than requested, fails the transfer
+        memcpy(transfer->m_buffer + transfer->m_received, data, bytes);
+        transfer->m_received += bytes;
+        return bytes;
+    }
+
+    static size_t OnHeader(char* data, size_t size, size_t count, void* context)
+    {
+        auto response = static_cast<Transfer*>(context)->m_response;
+        string header(data, size * count);
+        auto colon = header.find(':');
+        if (colon != string::npos)
+        {
+            auto name = header.substr(0, colon);
+            auto value = header.substr(colon + 1);
+            value.erase(0, value.find_first_not_of(" \t"));
+            value.erase(value.find_last_not_of(" \t\r\n") + 1);
+            if (AreEqualIgnoreCase(name, string("Content-Range")))
+                response->m_contentRange = value;
+            else if (AreEqualIgnoreCase(name, string("ETag")))
+                response->m_etag = value;
+        }
+        return size * count;
+    }
+
+    // Gets the range [offset, offset + size), retrying on transient failures.
+    Response Get(uint64_t offset, size_t size, char* buffer)
+    {
+        // Each thread keeps its handle, so that connections are reused.
+        static thread_local unique_ptr<CURL, void(*)(CURL*)> handle(curl_easy_init(), curl_easy_cleanup);
+        if (!handle)
+            RuntimeError("Cannot initialize libcurl.");
+
+        const int maxAttempts = 4;
+        string error;
+        for (int attempt = 0; attempt < maxAttempts; ++attempt)
+        {
+            if (attempt > 0)
+                this_thread::sleep_for(chrono::seconds(1 << (attempt - 1)));
+
+            Response response;
+            Transfer transfer = { buffer, size, 0, &response };
+            auto range = to_string(offset) + "-" + to_string(offset + size - 1);
+            char message[CURL_ERROR_SIZE] = {};
+
+            CURL* curl = handle.get();
+            curl_easy_reset(curl);
+            curl_easy_setopt(curl, CURLOPT_URL, m_url.c_str());
+            curl_easy_setopt(curl, CURLOPT_RANGE, range.c_str());
+            curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+            curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+            curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 30L);
+            curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+            curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 60L);
+            curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, message);
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &HttpRangeReader::OnData);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &transfer);
+            curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, &HttpRangeReader::OnHeader);
+            curl_easy_setopt(curl, CURLOPT_HEADERDATA, &transfer);
+
+            CURLcode code = curl_easy_perform(curl);
+            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response.m_status);
+            if (code == CURLE_OK && (response.m_status == 206 || response.m_status == 200) && transfer.m_received == size)
+                return response;
+
+            if (code != CURLE_OK)
+                error = message[0] ? message : curl_easy_strerror(code);
+            else if (response.m_status == 206 || response.m_status == 200)
+                error = "received " + to_string(transfer.m_received) + " of " + to_string(size) + " bytes";
+            else
+                error = "HTTP status " + to_string(response.m_status);
+
+            // Client errors (e.g. an expired signature) do not go away by retrying.
+            if (code == CURLE_OK && response.m_status >= 400 && response.m_status < 500 && response.m_status != 408 && response.m_status != 429)
+                break;
+        }
+
+        RuntimeError("Cannot read bytes %" PRIu64 "-%" PRIu64 " of '%s': %s.", offset, offset + size - 1, m_url.c_str(), error.c_str());
+    }
+
+    string m_url;
+    uint64_t m_size;
+    string m_version;
+};
+
+#endif
+
+// The blocks of all remote files, the backends and the open files. Blocks are fetched by a pool of
+// threads, one request per block at a time; blocks that are read right away go before the prefetched ones,
+// and a reader fetches a block itself if no thread has taken it up yet. Fetched blocks are kept in memory
+// in LRU order within the budget, and, if a cache directory is set, also on disk.
+class BlockCache
+{
+public:
+    static BlockCache& Get()
+    {
+        static BlockCache cache;
+        return cache;
+    }
+
+    ~BlockCache()
+    {
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_queueChanged.notify_all();
+        for (auto& worker : m_workers)
+            worker.join();
+    }
+
+    void RegisterBackend(const wstring& scheme, const StorageBackend& backend)
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_backends[ToLower(scheme)] = backend;
+    }
+
+    bool IsRemote(const wstring& path)
+    {
+        auto end = path.find(L"://");
+        if (end == wstring::npos || end == 0)
+            return false;
+
+        lock_guard<mutex> lock(m_mutex);
+        return m_backends.find(ToLower(path.substr(0, end))) != m_backends.end();
+    }
+
+    RemoteFilePtr Open(const wstring& url)
+    {
+        StorageBackend backend;
+        size_t blockSize;
+        {
+            lock_guard<mutex> lock(m_mutex);
+            auto file = m_files.find(url);
+            if (file != m_files.end())
+                return file->second;
+
+            auto end = url.find(L"://");
+            auto found = end == wstring::npos ? m_backends.end() : m_backends.find(ToLower(url.substr(0, end)));
+            if (found == m_backends.end())
+                InvalidArgument("'%ls' is not a URL of a supported remote storage.", url.c_str());
+            backend = found->second;
+            blockSize = m_parameters.m_blockSizeInBytes;
+        }
+
+        // The backend may send requests, so it is called without the lock.
+        RemoteFilePtr file(new RemoteFile(url, backend(url), blockSize));
+
+        lock_guard<mutex> lock(m_mutex);
+        return m_files.insert(make_pair(url, file)).first->second;
+    }
+
+    void Configure(const RemoteStorageParameters& parameters)
+    {
+        if (parameters.m_blockSizeInBytes == 0)
+            InvalidArgument("The block size of remote files must not be zero.");
+        if (parameters.m_numConnections == 0)
+            InvalidArgument("The number of connections to remote storage must not be zero.");
+
+        lock_guard<mutex> lock(m_mutex);
+        m_parameters = parameters;
+        Evict();
+    }
+
+    RemoteStorageParameters GetParameters()
+    {
+        lock_guard<mutex> lock(m_mutex);
+        return m_parameters;
+    }
+
+    RemoteStorageStatistics GetStatistics()
+    {
+        lock_guard<mutex> lock(m_mutex);
+        return m_statistics;
+    }
+
+    void Read(const RemoteFile& file, uint64_t offset, size_t size, char* buffer)
+    {
+        if (size == 0)
+            return;
+        if (offset > file.m_size || size > file.m_size - offset)
+            RuntimeError("Cannot read %zu bytes at offset %" PRIu64 " of '%ls', the file has %" PRIu64 " bytes.",
+                size, offset, file.m_url.c_str(), file.m_size);
+
+        const uint64_t first = offset / file.m_blockSize;
+        const uint64_t last = (offset + size - 1) / file.m_blockSize;
+
+        // All blocks are queued first, so that they are fetched concurrently.
+        vector<BlockPtr> blocks;
+        {
+            lock_guard<mutex> lock(m_mutex);
+            for (uint64_t i = first; i <= last; ++i)
+                blocks.push_back(FindOrQueue(file, i, /*demand =*/ true));
+        }
+
+        for (const auto& block : blocks)
+        {
+            {
+                unique_lock<mutex> lock(m_mutex);
+                if (block->m_state == Block::State::queued)
+                {
+                    block->m_state = Block::State::fetching;
+                    lock.unlock();
+                    Fetch(block);
+                    lock.lock();
+                }
+
+                m_blockReady.wait(lock, [&block]() { return block->m_state == Block::State::ready || block->m_state == Block::State::failed; });
+                if (block->m_state == Block::State::failed)
+                    RuntimeError("%s", block->m_error.c_str());
+
+                if (block->m_inMemory)
+                    m_lru.splice(m_lru.begin(), m_lru, block->m_lru);
+            }
+
+            // The data of a ready block does not change, and the pointer keeps it alive if the block is evicted.
+            uint64_t blockOffset = block->m_index * file.m_blockSize;
+            uint64_t begin = max(offset, blockOffset);
+            uint64_t end = min(offset + size, blockOffset + block->m_data.size());
+            memcpy(buffer + (begin - offset), block->m_data.data() + (begin - blockOffset), end - begin);
+        }
+    }
+
+    void WillNeed(const RemoteFile& file, uint64_t offset, size_t size)
+    {
+        if (size == 0 || offset >= file.m_size)
+            return;
+
+        const uint64_t first = offset / file.m_blockSize;
+        const uint64_t last = (min(offset + size, file.m_size) - 1) / file.m_blockSize;
+
+        lock_guard<mutex> lock(m_mutex);
+        for (uint64_t i = first; i <= last; ++i)
+        {
+            // Blocks that are prefetched but not read yet take at most half of the budget,
+            // the other half holds the blocks being read.
+            if (m_prefetchedBytes + file.m_blockSize > m_parameters.m_cacheSizeInBytes / 2)
+                break;
+            FindOrQueue(file, i, /*demand =*/ false);
+        }
+    }
+
+private:
+    struct Block
+    {
+        enum class State { queued, fetching, ready, failed };
+
+        Block(const RemoteFile& file, uint64_t index) : m_file(file), m_index(index) {}
+
+        uint64_t Size() const { return min<uint64_t>(m_file.m_blockSize, m_file.m_size - m_index * m_file.m_blockSize); }
+
+        const RemoteFile& m_file; // files are never closed
+        const uint64_t m_index;
+        State m_state = State::queued;
+        bool m_demanded = false;  // read at least once, otherwise only prefetched
+        bool m_inMemory = false;  // in m_blocks and m_lru
+        vector<char> m_data;
+        string m_error;
+        list<shared_ptr<Block>>::iterator m_lru;
+    };
+
+    typedef shared_ptr<Block> BlockPtr;
+    typedef pair<const RemoteFile*, uint64_t> BlockId;
+
+    BlockCache() : m_stop(false), m_prefetchedBytes(0), m_bytesInMemory(0)
+    {
+#ifdef USE_CURL
+        auto http = [](const wstring& url) { return make_shared<HttpRangeReader>(url); };
+        m_backends[L"http"] = http;
+        m_backends[L"https"] = http;
+#endif
+    }
+
+    static wstring ToLower(wstring value)
+    {
+        transform(value.begin(), value.end(), value.begin(), ::towlower);
+        return value;
+    }
+
+    // Returns the block, queueing it for fetching if it is not known. Requires m_mutex.
+    BlockPtr FindOrQueue(const RemoteFile& file, uint64_t index, bool demand)
+    {
+        BlockId id(&file, index);
+        auto found = m_blocks.find(id);
+        if (found != m_blocks.end())
+        {
+            auto block = found->second;
+            if (demand && !block->m_demanded)
+            {
+                block->m_demanded = true;
+                m_prefetchedBytes -= block->Size();
+
+                // Moves ahead of the prefetches; the entry in the prefetch queue is skipped later.
+                if (block->m_state == Block::State::queued)
+                    m_demandQueue.push_back(block);
+            }
+
+            if (demand && block->m_state == Block::State::ready)
+                m_statistics.m_numHits++;
+            return block;
+        }
+
+        auto block = make_shared<Block>(file, index);
+        block->m_demanded = demand;
+        m_blocks[id] = block;
+        if (demand)
+        {
+            m_demandQueue.push_back(block);
+        }
+        else
+        {
+            m_prefetchQueue.push_back(block);
+            m_prefetchedBytes += block->Size();
+        }
+
+        // Workers are started on first use.
+        while (m_workers.size() < m_parameters.m_numConnections)
+            m_workers.push_back(thread([this]() { WorkerLoop(); }));
+        m_queueChanged.notify_one();
+        return block;
+    }
+
+    void WorkerLoop()
+    {
+        unique_lock<mutex> lock(m_mutex);
+        while (!m_stop)
+        {
+            BlockPtr block;
+            for (auto queue : { &m_demandQueue, &m_prefetchQueue })
+            {
+                while (!block && !queue->empty())
+                {
+                    if (queue->front()->m_state == Block::State::queued)
+                        block = queue->front();
+                    queue->pop_front();
+                }
+            }
+
+            if (!block)
+            {
+                m_queueChanged.wait(lock);
+                continue;
+            }
+
+            block->m_state = Block::State::fetching;
+            lock.unlock();
+            Fetch(block);
+            lock.lock();
+        }
+    }
+
+    // Reads a block from the cache directory or the backend and publishes it. Called without m_mutex.
+    void Fetch(const BlockPtr& block)
+    {
+        const RemoteFile& file = block->m_file;
+        vector<char> data(block->Size());
+        string error;
+        bool fromDisk = false;
+
+        auto directory = GetParameters().m_cacheDirectory;
+        auto path = directory.empty() ? wstring() : directory + L"/" + DiskCacheName(*block);
+        try
+        {
+            fromDisk = !path.empty() && TryReadFromDisk(path, data);
+            if (!fromDisk)
+            {
+                file.m_reader->Read(block->m_index * file.m_blockSize, data.size(), data.data());
+                if (!path.empty())
+                    TryWriteToDisk(path, data);
+            }
+        }
+        catch (const exception& e)
+        {
+            error = e.what();
+            if (error.empty())
+                error = "Cannot read '" + ToLegacyString(ToUTF8(file.m_url)) + "'.";
+        }
+
+        {
+            lock_guard<mutex> lock(m_mutex);
+            if (!error.empty())
+            {
+                // Readers that wait for the block fail, the next request tries again.
+                block->m_error = error;
+                block->m_state = Block::State::failed;
+                m_blocks.erase(BlockId(&file, block->m_index));
+                if (!block->m_demanded)
+                    m_prefetchedBytes -= block->Size();
+            }
+            else
+            {
+                if (fromDisk)
+                {
+                    m_statistics.m_numDiskHits++;
+                }
+                else
+                {
+                    m_statistics.m_numFetches++;
+                    m_statistics.m_bytesFetched += data.size();
+                }
+
+                block->m_data.swap(data);
+                block->m_state = Block::State::ready;
+                block->m_inMemory = true;
+                m_lru.push_front(block);
+                block->m_lru = m_lru.begin();
+                m_bytesInMemory += block->m_data.size();
+                Evict();
+            }
+        }
+        m_blockReady.notify_all();
+    }
+
+    // Drops the least recently used blocks until the budget is met. Requires m_mutex.
+    void Evict()
+    {
+        while (m_bytesInMemory > m_parameters.m_cacheSizeInBytes && !m_lru.empty())
+        {
+            auto block = m_lru.back();
+            m_lru.pop_back();
+            block->m_inMemory = false;
+            m_blocks.erase(BlockId(&block->m_file, block->m_index));
+            m_bytesInMemory -= block->m_data.size();
+            if (!block->m_demanded)
+                m_prefetchedBytes -= block->m_data.size();
+            m_statistics.m_numEvictions++;
+        }
+    }
+
+    // Files in the cache directory are named after the URL and the version of the object, so that
+    // different objects, or versions of an object, do not share blocks.
+    static wstring DiskCacheName(const Block& block)
+    {
+        const RemoteFile& file = block.m_file;
+        auto key = ToLegacyString(ToUTF8(file.m_url)) + "\n" + file.m_version + "\n" + to_string(file.m_size);
+        uint64_t hash = 14695981039346656037ULL;
+        for (unsigned char c : key)
+        {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+
+        wchar_t name[64];
+        swprintf(name, sizeof(name) / sizeof(name[0]), L"%016" PRIx64, hash);
+        return wstring(name) + L"_" + to_wstring(file.m_blockSize) + L"_" + to_wstring(block.m_index) + L".block";
+    }
+
+    static bool TryReadFromDisk(const wstring& path, vector<char>& data)
+    {
+        FileWrapper file(path, L"rb");
+        return file.IsOpen() && file.Filesize() == data.size() && file.TryRead(data.data(), 1, data.size());
+    }
+
+    // Writes through a temporary file, so that other processes sharing the directory never see partial blocks.
+    static void TryWriteToDisk(const wstring& path, const vector<char>& data)
+    {
+        auto temp = path + L"." + to_wstring(GetCurrentProcessId()) + L".tmp";
+        bool success;
+        {
+            FileWrapper file(temp, L"wb");
+            success = file.IsOpen() && file.TryWrite(data.data(), 1, data.size()) && file.TryFlush();
+        }
+
+        if (success)
+        {
+            try
+            {
+                renameOrDie(temp, path);
+                return;
+            }
+            catch (...) {}
+        }
+
+        _wunlink(temp.c_str());
+    }
+
+    mutex m_mutex;
+    condition_variable m_queueChanged;
+    condition_variable m_blockReady;
+    bool m_stop;
+
+    RemoteStorageParameters m_parameters;
+    map<wstring, StorageBackend> m_backends;
+    map<wstring, RemoteFilePtr> m_files;
+
+    map<BlockId, BlockPtr> m_blocks;
+    deque<BlockPtr> m_demandQueue;
+    deque<BlockPtr> m_prefetchQueue;
+    list<BlockPtr> m_lru;
+    size_t m_prefetchedBytes; // of the blocks that are prefetched and not read yet
+    size_t m_bytesInMemory;   // of the ready blocks
+    vector<thread> m_workers;
+
+    RemoteStorageStatistics m_statistics;
+};
+
+RemoteFile::RemoteFile(const wstring& url, const RangeReaderPtr& reader, size_t blockSizeInBytes)
+    : m_url(url), m_reader(reader), m_size(reader->Size()), m_version(reader->Version()), m_blockSize(blockSizeInBytes)
+{}
+
+void RemoteFile::Read(uint64_t offset, size_t size, char* buffer)
+{
+    BlockCache::Get().Read(*this, offset, size, buffer);
+}
+
+void RemoteFile::WillNeed(uint64_t offset, size_t size)
+{
+    BlockCache::Get().WillNeed(*this, offset, size);
+}
+
+#ifdef _WIN32
+
+FILE* RemoteFile::OpenStream()
+{
+    RuntimeError("Remote file '%ls' cannot be opened as a stream, this is only supported on Linux.", m_url.c_str());
+}
+
+#else
+
+namespace {
+
+// State of a stream opened with fopencookie().
+struct RemoteStream
+{
+    RemoteFilePtr m_file;
+    uint64_t m_position;
+};
+
+ssize_t ReadRemoteStream(void* cookie, char* buffer, size_t size)
+{
+    auto stream = static_cast<RemoteStream*>(cookie);
+    size = (size_t)min<uint64_t>(size, stream->m_file->Size() - min(stream->m_position, stream->m_file->Size()));
+    try
+    {
+        stream->m_file->Read(stream->m_position, size, buffer);
+    }
+    catch (const exception& e)
+    {
+        // The stdio caller only sees the error code.
+        fprintf(stderr, "ERROR: %s\n", e.what());
+        errno = EIO;
+        return -1;
+    }
+
+    stream->m_position += size;
+    return (ssize_t)size;
+}
+
+int SeekRemoteStream(void* cookie, off64_t* offset, int whence)
+{
+    auto stream = static_cast<RemoteStream*>(cookie);
+    int64_t base = whence == SEEK_SET ? 0 : whence == SEEK_CUR ? (int64_t)stream->m_position : (int64_t)stream->m_file->Size();
+    if (base + *offset < 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    stream->m_position = (uint64_t)(base + *offset);
+    *offset = (off64_t)stream->m_position;
+    return 0;
+}
+
+int CloseRemoteStream(void* cookie)
+{
+    delete static_cast<RemoteStream*>(cookie);
+    return 0;
+}
+
+}
+
+FILE* RemoteFile::OpenStream()
+{
+    cookie_io_functions_t functions = { &ReadRemoteStream, nullptr, &SeekRemoteStream, &CloseRemoteStream };
+    auto stream = new RemoteStream{ BlockCache::Get().Open(m_url), 0 };
+    FILE* f = fopencookie(stream, "r", functions);
+    if (!f)
+    {
+        delete stream;
+        RuntimeError("Cannot open a stream of '%ls': %s.", m_url.c_str(), strerror(errno));
+    }
+    return f;
+}
+
+#endif
+
+/*static*/ void RemoteStorage::RegisterBackend(const wstring& scheme, const StorageBackend& backend)
+{
+    BlockCache::Get().RegisterBackend(scheme, backend);
+}
+
+/*static*/ bool RemoteStorage::IsRemote(const wstring& path)
+{
+    return BlockCache::Get().IsRemote(path);
+}
+
+/*static*/ RemoteFilePtr RemoteStorage::Open(const wstring& url)
+{
+    return BlockCache::Get().Open(url);
+}
+
+/*static*/ FILE* RemoteStorage::OpenStreamOrDie(const wstring& path, const wchar_t* mode)
+{
+    if (!IsRemote(path))
+        return fopenOrDie(path, mode);
+
+    if (wcschr(mode, L'w') || wcschr(mode, L'a') || wcschr(mode, L'+'))
+        InvalidArgument("Remote file '%ls' can only be opened for reading.", path.c_str());
+    return Open(path)->OpenStream();
+}
+
+/*static*/ void RemoteStorage::Configure(const RemoteStorageParameters& parameters)
+{
+    BlockCache::Get().Configure(parameters);
+}
+
+/*static*/ RemoteStorageParameters RemoteStorage::GetParameters()
+{
+    return BlockCache::Get().GetParameters();
+}
+
+/*static*/ RemoteStorageStatistics RemoteStorage::GetStatistics()
+{
+    return BlockCache::Get().GetStatistics();
+}
+
+}
@@ -0,0 +1,123 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include "Basics.h"
+
+namespace CNTK {
+
+// Random access to an object in remote storage, implemented by a storage backend.
+// Read() is called from several threads at once, for different ranges.
+class RangeReader
+{
+public:
+    virtual ~RangeReader() {}
+
+    // Size of the object in bytes.
+    virtual uint64_t Size() = 0;
+
+    // Identifies the content of the object (e.g. its ETag), so that blocks cached on disk
+    // for an older version are not used. Empty if the backend cannot tell.
+    virtual std::string Version() { return std::string(); }
+
+    // Reads 'size' bytes at 'offset' into 'buffer'. Throws if the range cannot be read completely.
+    virtual void Read(uint64_t offset, size_t size, char* buffer) = 0;
+};
+
+typedef std::shared_ptr<RangeReader> RangeReaderPtr;
+
+// Opens the object with the given URL, throws if it does not exist.
+typedef std::function<RangeReaderPtr(const std::wstring& url)> StorageBackend;
+
+// Settings of the block cache shared by all remote files. Sizes are in bytes.
+struct RemoteStorageParameters
+{
+    size_t m_blockSizeInBytes = 4 << 20;   // granularity of the range requests and of the cache
+    size_t m_cacheSizeInBytes = 256 << 20; // memory budget of the cache
+    std::wstring m_cacheDirectory;         // if not empty, fetched blocks are also kept in this directory
+    size_t m_numConnections = 8;           // number of blocks fetched concurrently
+};
+
+struct RemoteStorageStatistics
+{
+    size_t m_numHits = 0;      // blocks found in memory
+    size_t m_numDiskHits = 0;  // blocks read from the cache directory
+    size_t m_numFetches = 0;   // blocks requested from the backend
+    size_t m_numEvictions = 0; // blocks dropped from memory to stay within budget
+    size_t m_bytesFetched = 0;
+};
+
+class BlockCache;
+
+// A read-only file in remote storage. Its content is fetched in blocks of a fixed size through
+// a process-wide cache, so concurrent readers of the same file share the requests and the memory.
+// Like MemoryMappedFile, WillNeed() should be used to announce the ranges that are about to be read:
+// their blocks are then fetched in the background, several at a time.
+class RemoteFile
+{
+public:
+    const std::wstring& Url() const { return m_url; }
+    uint64_t Size() const { return m_size; }
+
+    // Reads 'size' bytes at 'offset', waiting for the blocks that are not in the cache yet.
+    void Read(uint64_t offset, size_t size, char* buffer);
+
+    // Hints that the given range will be read soon. Does not block.
+    void WillNeed(uint64_t offset, size_t size);
+
+    // Opens the file as a read-only stdio stream, for code that works with FILE*.
+    // The stream keeps the file alive and should be closed with fclose().
+    FILE* OpenStream();
+
+private:
+    friend class BlockCache;
+
+    RemoteFile(const std::wstring& url, const RangeReaderPtr& reader, size_t blockSizeInBytes);
+
+    std::wstring m_url;
+    RangeReaderPtr m_reader;
+    uint64_t m_size;
+    std::string m_version;
+    size_t m_blockSize;
+
+    DISABLE_COPY_AND_MOVE(RemoteFile);
+};
+
+typedef std::shared_ptr<RemoteFile> RemoteFilePtr;
+
+// Maps URLs to storage backends by their scheme ("scheme://..."). Paths without a registered scheme
+// are local files. The "http" and "https" backends are built in when libcurl is available (USE_CURL);
+// other object stores can be added with RegisterBackend(), or reached through pre-signed HTTPS URLs.
+class RemoteStorage
+{
+public:
+    static void RegisterBackend(const std::wstring& scheme, const StorageBackend& backend);
+
+    // Returns true if 'path' is a URL with a registered scheme.
+    static bool IsRemote(const std::wstring& path);
+
+    // Opens a remote file; files stay open, so later calls with the same URL return the same file.
+    static RemoteFilePtr Open(const std::wstring& url);
+
+    // Opens 'path' as a stdio stream: remote files read-only, local files with fopenOrDie().
+    static FILE* OpenStreamOrDie(const std::wstring& path, const wchar_t* mode);
+
+    // Changes the settings of the cache. The block size applies to the files opened afterwards.
+    static void Configure(const RemoteStorageParameters& parameters);
+    static RemoteStorageParameters GetParameters();
+
+    static RemoteStorageStatistics GetStatistics();
+
+private:
+    RemoteStorage();
+};
+
+}
@@ -79,6 +79,52 @@ namespace CNTK {
         DISABLE_COPY_AND_MOVE(DenseSequenceWithBuffer);
     };
 
+    // Sequences that point into memory they do not own, typically the mapping of the input file.
+    // The deserializer keeps the memory alive through m_holdingBuffer.
+    struct ExternalDenseSequenceData : DenseSequenceData
+    {
+        ExternalDenseSequenceData(const void* data, unsigned int numberOfSamples, const NDShape& sampleShape)
+            : DenseSequenceData(numberOfSamples), m_data(data), m_sampleShape(sampleShape)
+        {}
+
+        const void* GetDataBuffer() override
+        {
+            return m_data;
+        }
+
+        const NDShape& GetSampleShape() override
+        {
+            return m_sampleShape;
+        }
+
+        const void* m_data;
+
+        // Non-owning reference on the sample shape of the stream.
+        const NDShape& m_sampleShape;
+    };
+
+    struct ExternalSparseSequenceData : SparseSequenceData
+    {
+        ExternalSparseSequenceData(const void* data, unsigned int numberOfSamples, const NDShape& sampleShape)
+            : SparseSequenceData(numberOfSamples), m_data(data), m_sampleShape(sampleShape)
+        {}
+
+        const void* GetDataBuffer() override
+        {
+            return m_data;
+        }
+
+        const NDShape& GetSampleShape() override
+        {
+            return m_sampleShape;
+        }
+
+        const void* m_data;
+
+        // Non-owning reference on the sample shape of the stream.
+        const NDShape& m_sampleShape;
+    };
+
     class InvalidSequenceData : public SequenceDataBase
     {
     public:
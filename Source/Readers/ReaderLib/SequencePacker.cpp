@@ -57,7 +57,11 @@ MBLayoutPtr SequencePacker::CreateBinaryMBLayout(const StreamBatch& batch)
 
 Minibatch SequencePacker::ReadMinibatch()
 {
-    auto sequences = m_sequenceEnumerator->GetNextSequences(m_globalMinibatchSizeInSamples, m_localMinibatchSizeInSamples);
+    return PackSequences(m_sequenceEnumerator->GetNextSequences(m_globalMinibatchSizeInSamples, m_localMinibatchSizeInSamples));
+}
+
+Minibatch SequencePacker::PackSequences(const Sequences& sequences)
+{
     const auto& batch = sequences.m_data;
 
     Minibatch minibatch(sequences.m_endOfSweep, sequences.m_endOfEpoch);
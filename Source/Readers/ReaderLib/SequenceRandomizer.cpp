@@ -179,20 +179,22 @@ namespace CNTK {
             m_randomizationCursor == 0 ? 0 : m_randomizedChunks[m_randomizationCursor - 1].SequenceEndPosition();
 
         size_t endSequencePosToRandomize = m_randomizedChunks[nextRandomizationCursor - 1].SequenceEndPosition();
+
+        // Positions are visited in order, so the chunk of t is tracked instead of searched.
+        ChunkIdType tChunkIndex = GetChunkIndexForSequencePosition(firstSequencePositionToRandomize);
         for (size_t t = firstSequencePositionToRandomize; t < endSequencePosToRandomize; ++t)
         {
-            // Get valid randomization range, expressed in chunks
-            // TODO: This can be done more efficiently, we know the range of chunks already.
-            const ChunkIdType currentChunkIdx = GetChunkIndexForSequencePosition(t);
+            while (t >= m_randomizedChunks[tChunkIndex].SequenceEndPosition())
+                tChunkIndex++;
 
-            size_t chunkWindowBegin = m_randomizedChunks[currentChunkIdx].m_randomizationWindow.m_begin;
-            size_t chunkWindowEnd = m_randomizedChunks[currentChunkIdx].m_randomizationWindow.m_end;
+            // Get valid randomization range, expressed in chunks
+            size_t chunkWindowBegin = m_randomizedChunks[tChunkIndex].m_randomizationWindow.m_begin;
+            size_t chunkWindowEnd = m_randomizedChunks[tChunkIndex].m_randomizationWindow.m_end;
 
             // Get valid randomization range, expressed in sequence positions.
             size_t posBegin = m_randomizedChunks[chunkWindowBegin].m_sequencePositionStart;
             size_t posEnd = m_randomizedChunks[chunkWindowEnd - 1].SequenceEndPosition();
 
-            ChunkIdType tChunkIndex = GetChunkIndexForSequencePosition(t);
             auto& tSequence = GetRandomizedSequenceDescriptionByPosition(tChunkIndex, t);
 
             for (;;)
@@ -201,7 +203,7 @@ namespace CNTK {
                 const size_t j = Microsoft::MSR::CNTK::RandMT(posBegin, posEnd, m_rng);
 
                 // Pick up j sequence.
-                ChunkIdType jChunkIndex = GetChunkIndexForSequencePosition(j);
+                ChunkIdType jChunkIndex = GetChunkIndexForSequencePosition(j, (ChunkIdType)chunkWindowBegin, (ChunkIdType)chunkWindowEnd);
                 auto& jSequence = GetRandomizedSequenceDescriptionByPosition(jChunkIndex, j);
 
                 // Try again if the sequence currently at j cannot be placed at position i.
@@ -219,10 +221,13 @@ namespace CNTK {
         }
 
         // Verify that we got it right
+        tChunkIndex = GetChunkIndexForSequencePosition(firstSequencePositionToRandomize);
         for (size_t t = firstSequencePositionToRandomize; t < endSequencePosToRandomize; ++t)
         {
             // TODO assert only
-            ChunkIdType tChunkIndex = GetChunkIndexForSequencePosition(t);
+            while (t >= m_randomizedChunks[tChunkIndex].SequenceEndPosition())
+                tChunkIndex++;
+
             if (!IsValidForPosition(tChunkIndex, GetRandomizedSequenceDescriptionByPosition(tChunkIndex, t)))
             {
                 LogicError("SequenceRandomizer::RandomizeNextSequenceDescriptions: randomization logic mangled!");
@@ -312,12 +317,25 @@ namespace CNTK {
             // (unless we need to go past the randomized chunk window)
         }
 
-        // Advance sequence by sequence until the desire offset is reached.
         if (m_verbosity)
             fprintf(stderr, "SequenceRandomizer::Seek(): advancing cursor from %" PRIu64 " to %" PRIu64 "\n",
                 m_currentSampleCursor,
                 sweepSampleOffset);
 
+        // Skip the chunks that end before the offset as a whole, their samples are known once they are randomized.
+        // The cursor is at the start of a chunk here.
+        while (m_currentChunkCursor < m_randomizedChunks.size())
+        {
+            const auto& info = m_randomizedChunkInfo[m_currentChunkCursor - m_chunkWindowBegin];
+            if (info.start + info.numberOfSamples > sweepSampleOffset)
+                break;
+
+            m_currentSequenceCursor = m_randomizedChunks[m_currentChunkCursor].SequenceEndPosition();
+            m_currentSampleCursor = info.start + info.numberOfSamples;
+            MoveChunkCursor();
+        }
+
+        // Advance sequence by sequence until the desire offset is reached.
         ClosedOpenChunkInterval window;
         GetNextSequenceDescriptions([&](const RandomizedSequenceDescription&) { return m_currentSampleCursor < sweepSampleOffset; }, window);
 
@@ -333,10 +351,16 @@ namespace CNTK {
 
     // Gets randomized chunk index using a sequence position in the sweep.
     ChunkIdType SequenceRandomizer::GetChunkIndexForSequencePosition(size_t sequencePosition) const
+    {
+        return GetChunkIndexForSequencePosition(sequencePosition, 0, (ChunkIdType)m_randomizedChunks.size());
+    }
+
+    // Same as above, for a position that is known to be in the chunks [begin, end).
+    ChunkIdType SequenceRandomizer::GetChunkIndexForSequencePosition(size_t sequencePosition, ChunkIdType begin, ChunkIdType end) const
     {
         auto result = std::upper_bound(
-            m_randomizedChunks.begin(),
-            m_randomizedChunks.end(),
+            m_randomizedChunks.begin() + begin,
+            m_randomizedChunks.begin() + end,
             sequencePosition,
             [](size_t sp, const RandomizedChunk& c) { return sp < c.m_sequencePositionStart; });
         return (ChunkIdType)(result - 1 - m_randomizedChunks.begin());
@@ -63,6 +63,7 @@ private:
 
     // Gets randomized chunk index using a sequence position in the sweep.
     ChunkIdType GetChunkIndexForSequencePosition(size_t sequenceSweepPosition) const;
+    ChunkIdType GetChunkIndexForSequencePosition(size_t sequenceSweepPosition, ChunkIdType begin, ChunkIdType end) const;
 
     // Gets randomized sequence by sequence position in sweep and its randomized chunk index.
     RandomizedSequenceDescription& GetRandomizedSequenceDescriptionByPosition(ChunkIdType chunkIndex, size_t sequenceSweepPosition);
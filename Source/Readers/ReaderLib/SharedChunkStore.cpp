@@ -0,0 +1,261 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS
+#include "SharedChunkStore.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+
+// Layout of the segment: the header, an entry per chunk, then the chunk data. A segment filled
+// with zeros (as created by ftruncate) is a valid empty store, so the entries need no initialization.
+struct SharedChunkStoreHeader
+{
+    std::atomic<uint32_t> m_isInitialized; // set by the creator once the fields below are valid
+    std::atomic<uint32_t> m_numAttached;   // processes that have the segment open
+    uint64_t m_magic;
+    uint64_t m_numChunks;
+    uint64_t m_capacity;                   // bytes available for chunk data
+    std::atomic<uint64_t> m_used;          // bytes of chunk data allocated so far
+};
+
+enum SharedChunkState : uint32_t
+{
+    Empty = 0,    // not stored yet
+    Writing = 1,  // claimed by a process that is copying it in
+    Stored = 2,
+    Unshared = 3, // did not fit, will not be stored
+};
+
+struct SharedChunkStoreEntry
+{
+    std::atomic<uint32_t> m_state;
+    uint64_t m_offset;
+    uint64_t m_size;
+};
+
+namespace {
+
+const uint64_t SharedChunkStoreMagic = 0x636e746b5f73686d; // 'cntk_shm'
+const size_t SharedChunkStoreAlignment = 64;
+
+size_t AlignUp(size_t size)
+{
+    return (size + SharedChunkStoreAlignment - 1) / SharedChunkStoreAlignment * SharedChunkStoreAlignment;
+}
+
+size_t EntriesOffset()
+{
+    return AlignUp(sizeof(SharedChunkStoreHeader));
+}
+
+size_t DataOffset(size_t numChunks)
+{
+    return AlignUp(EntriesOffset() + numChunks * sizeof(SharedChunkStoreEntry));
+}
+
+// Processes on the host may create the segment at the same time; waits until the creator is done.
+template <class F>
+bool WaitFor(F condition)
+{
+    for (int i = 0; i < 1000; ++i)
+    {
+        if (condition())
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return condition();
+}
+
+}
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+    "The shared chunk store requires lock-free atomics, which can be used across processes.");
+
+#ifdef _WIN32
+
+/*static*/ std::shared_ptr<SharedChunkStore> SharedChunkStore::TryOpen(const std::wstring& /*key*/, size_t /*numChunks*/, size_t /*capacityInBytes*/)
+{
+    fprintf(stderr, "WARNING: The shared memory chunk cache is not supported on Windows, chunks are not shared.\n");
+    return nullptr;
+}
+
+SharedChunkStore::~SharedChunkStore()
+{
+}
+
+#else
+
+/*static*/ std::shared_ptr<SharedChunkStore> SharedChunkStore::TryOpen(const std::wstring& key, size_t numChunks, size_t capacityInBytes)
+{
+    // The segment is named after a hash of everything that defines its content and layout.
+    std::string id = wtocharpath(key.c_str()) + "|" + std::to_string(numChunks) + "|" + std::to_string(capacityInBytes);
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : id)
+    {
+        hash ^= (unsigned char)c;
+        hash *= 1099511628211ULL;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "/cntk_chunks_%016llx", (unsigned long long)hash);
+
+    const size_t capacity = AlignUp(capacityInBytes);
+    const size_t size = DataOffset(numChunks) + capacity;
+
+    bool created = true;
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST)
+    {
+        created = false;
+        fd = shm_open(name, O_RDWR, 0600);
+    }
+
+    if (fd < 0)
+    {
+        fprintf(stderr, "WARNING: Cannot open the shared memory segment '%s' (%s), chunks are not shared.\n", name, strerror(errno));
+        return nullptr;
+    }
+
+    auto closeFile = MakeScopeExit([fd]() { close(fd); });
+
+    if (created && ftruncate(fd, (off_t)size) != 0)
+    {
+        fprintf(stderr, "WARNING: Cannot allocate %zu MB of shared memory (%s), chunks are not shared.\n", size >> 20, strerror(errno));
+        shm_unlink(name);
+        return nullptr;
+    }
+
+    struct stat status;
+    if (!created && !WaitFor([&]() { return fstat(fd, &status) == 0 && status.st_size != 0; }))
+    {
+        fprintf(stderr, "WARNING: The shared memory segment '%s' is not initialized, chunks are not shared.\n", name);
+        return nullptr;
+    }
+
+    if (!created && (size_t)status.st_size != size)
+    {
+        fprintf(stderr, "WARNING: The shared memory segment '%s' has an unexpected size, chunks are not shared.\n", name);
+        return nullptr;
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        fprintf(stderr, "WARNING: Cannot map the shared memory segment '%s' (%s), chunks are not shared.\n", name, strerror(errno));
+        if (created)
+            shm_unlink(name);
+        return nullptr;
+    }
+
+    auto header = static_cast<SharedChunkStoreHeader*>(mapping);
+    if (created)
+    {
+        header->m_magic = SharedChunkStoreMagic;
+        header->m_numChunks = numChunks;
+        header->m_capacity = capacity;
+        header->m_isInitialized.store(1, std::memory_order_release);
+    }
+    else if (!WaitFor([header]() { return header->m_isInitialized.load(std::memory_order_acquire) != 0; }) ||
+             header->m_magic != SharedChunkStoreMagic || header->m_numChunks != numChunks || header->m_capacity != capacity)
+    {
+        fprintf(stderr, "WARNING: The shared memory segment '%s' was created for different data, chunks are not shared.\n", name);
+        munmap(mapping, size);
+        return nullptr;
+    }
+
+    header->m_numAttached.fetch_add(1);
+    return std::shared_ptr<SharedChunkStore>(new SharedChunkStore(name, mapping, size));
+}
+
+SharedChunkStore::~SharedChunkStore()
+{
+    // The last process removes the segment. A process that crashed before detaching keeps it
+    // alive, it is then reused by the next job that reads the same data.
+    if (m_header->m_numAttached.fetch_sub(1) == 1)
+        shm_unlink(m_name.c_str());
+    munmap(m_mapping, m_mappingSize);
+}
+
+#endif
+
+SharedChunkStore::SharedChunkStore(const std::string& name, void* mapping, size_t mappingSize)
+    : m_name(name), m_mapping(mapping), m_mappingSize(mappingSize)
+{
+    auto base = static_cast<uint8_t*>(mapping);
+    m_header = reinterpret_cast<SharedChunkStoreHeader*>(base);
+    m_entries = reinterpret_cast<SharedChunkStoreEntry*>(base + EntriesOffset());
+    m_data = base + DataOffset(m_header->m_numChunks);
+}
+
+std::shared_ptr<uint8_t> SharedChunkStore::Find(ChunkIdType chunkId, size_t& size)
+{
+    if (chunkId >= m_header->m_numChunks)
+        return nullptr;
+
+    const auto& entry = m_entries[chunkId];
+    if (entry.m_state.load(std::memory_order_acquire) != SharedChunkState::Stored)
+        return nullptr;
+
+    size = entry.m_size;
+    // The buffer shares the ownership of the store, which keeps the segment mapped.
+    return std::shared_ptr<uint8_t>(shared_from_this(), m_data + entry.m_offset);
+}
+
+bool SharedChunkStore::CanInsert(ChunkIdType chunkId) const
+{
+    return chunkId < m_header->m_numChunks &&
+           m_entries[chunkId].m_state.load(std::memory_order_relaxed) == SharedChunkState::Empty &&
+           m_header->m_used.load(std::memory_order_relaxed) < m_header->m_capacity;
+}
+
+std::shared_ptr<uint8_t> SharedChunkStore::Insert(ChunkIdType chunkId, const std::vector<char>& data)
+{
+    if (chunkId >= m_header->m_numChunks)
+        return nullptr;
+
+    auto& entry = m_entries[chunkId];
+    uint32_t expected = SharedChunkState::Empty;
+    if (!entry.m_state.compare_exchange_strong(expected, SharedChunkState::Writing))
+        return nullptr;
+
+    const uint64_t size = AlignUp(data.size());
+    uint64_t offset = m_header->m_used.load();
+    do
+    {
+        if (offset + size > m_header->m_capacity)
+        {
+            entry.m_state.store(SharedChunkState::Unshared);
+            return nullptr;
+        }
+    } while (!m_header->m_used.compare_exchange_weak(offset, offset + size));
+
+    memcpy(m_data + offset, data.data(), data.size());
+    entry.m_offset = offset;
+    entry.m_size = data.size();
+    entry.m_state.store(SharedChunkState::Stored, std::memory_order_release);
+
+    return std::shared_ptr<uint8_t>(shared_from_this(), m_data + offset);
+}
+
+size_t SharedChunkStore::SizeInBytes() const
+{
+    return (size_t)m_header->m_used.load();
+}
+
+}
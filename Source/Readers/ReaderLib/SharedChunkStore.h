@@ -0,0 +1,69 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "DataDeserializer.h"
+
+namespace CNTK {
+
+struct SharedChunkStoreHeader;
+struct SharedChunkStoreEntry;
+
+// Serialized chunks in a shared memory segment of the host, so that the processes reading the same data
+// (e.g. the MPI ranks of a job) deserialize every chunk once and keep a single copy of it in memory.
+// The segment is named after a key that identifies the data, created by the first process that
+// opens it and removed by the last one that closes it.
+//
+// The directory of the segment has an entry per chunk that is claimed with an atomic compare-and-swap,
+// so no lock is shared between the processes. Space is allocated in order and never freed:
+// once the segment is full, the remaining chunks are not shared.
+class SharedChunkStore : public std::enable_shared_from_this<SharedChunkStore>
+{
+public:
+    // Opens the store of 'key', creating it with room for 'numChunks' chunks and 'capacityInBytes' bytes
+    // of chunk data if it does not exist yet. Returns nullptr (with a warning) if the segment cannot be
+    // used, e.g. because it was created for a different number of chunks.
+    static std::shared_ptr<SharedChunkStore> TryOpen(const std::wstring& key, size_t numChunks, size_t capacityInBytes);
+
+    ~SharedChunkStore();
+
+    // Returns the stored chunk, or nullptr if it has not been stored (completely) yet.
+    // The returned buffer keeps the segment mapped.
+    std::shared_ptr<uint8_t> Find(ChunkIdType chunkId, size_t& size);
+
+    // Returns false if the chunk is stored, being stored or cannot be stored anymore, so that
+    // it need not be serialized for Insert().
+    bool CanInsert(ChunkIdType chunkId) const;
+
+    // Copies a serialized chunk into the segment and returns the stored copy. Returns nullptr if
+    // another process stores the chunk at the same time, or if the segment is full.
+    std::shared_ptr<uint8_t> Insert(ChunkIdType chunkId, const std::vector<char>& data);
+
+    const std::string& Name() const { return m_name; }
+
+    // Bytes of chunk data stored by all processes.
+    size_t SizeInBytes() const;
+
+private:
+    SharedChunkStore(const std::string& name, void* mapping, size_t mappingSize);
+
+    std::string m_name;
+    void* m_mapping;
+    size_t m_mappingSize;
+    SharedChunkStoreHeader* m_header;
+    SharedChunkStoreEntry* m_entries;
+    uint8_t* m_data;
+
+    DISABLE_COPY_AND_MOVE(SharedChunkStore);
+};
+
+typedef std::shared_ptr<SharedChunkStore> SharedChunkStorePtr;
+
+}
@@ -9,7 +9,8 @@
 
 #include "Transformer.h"
 #include "SequenceEnumerator.h"
-#include "ExceptionCapture.h"
+#include "ThreadPool.h"
+#include "ReaderStatistics.h"
 
 namespace CNTK {
 
@@ -82,21 +83,20 @@ public:
             return sequences;
         }
 
+        ScopeReaderStage stage(ReaderStage::Transform);
         if (m_multiThreadedDeserialization)
         {
-            ExceptionCapture capture;
-#pragma omp parallel for schedule(dynamic)
-            for (int j = 0; j < sequences.m_data.front().size(); ++j)
+            // on the shared pool, so that concurrent readers and the math threads stay within the thread budget
+            Microsoft::MSR::CNTK::ThreadPool::Get().ParallelFor(0, sequences.m_data.front().size(), 1, [this, &sequences](size_t begin, size_t end)
             {
-                capture.SafeRun([this, &sequences](int sequenceId)
+                for (size_t sequenceId = begin; sequenceId < end; ++sequenceId)
                 {
                     for (auto& t : m_transformations)
                     {
-                        sequences.m_data[t.second][sequenceId] = t.first.m_transformer->Transform(sequences.m_data[t.second][sequenceId], sequenceId);
+                        sequences.m_data[t.second][sequenceId] = t.first.m_transformer->Transform(sequences.m_data[t.second][sequenceId], (int)sequenceId);
                     }
-                }, j);
-            }
-            capture.RethrowIfHappened();
+                }
+            });
         }
         else
         {
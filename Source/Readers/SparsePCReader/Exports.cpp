@@ -9,6 +9,8 @@
 #define DATAREADER_EXPORTS
 #include "DataReader.h"
 #include "SparsePCReader.h"
+#include "SparsePCDeserializer.h"
+#include "CorpusDescriptor.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -21,4 +23,20 @@ extern "C" DATAREADER_API void GetReaderD(IDataReader** preader)
     *preader = new SparsePCReader<double>();
 }
 
+// Exposes the file format of the SparsePCReader as a deserializer of the composite reader, [type = "SparsePCDeserializer"].
+extern "C" DATAREADER_API bool CreateDeserializer(::CNTK::DataDeserializerPtr& deserializer, const std::wstring& type, const ConfigParameters& deserializerConfig, ::CNTK::CorpusDescriptorPtr corpus, bool primary)
+{
+    if (corpus && !corpus->IsNumericSequenceKeys())
+        InvalidArgument("SparsePCDeserializer does not support non-numeric sequence keys.");
+
+    if (!primary)
+        InvalidArgument("SparsePCDeserializer can only be used as a primary.");
+
+    if (type != L"SparsePCDeserializer")
+        InvalidArgument("Unknown deserializer type '%ls'", type.c_str());
+
+    deserializer = std::make_shared<::CNTK::SparsePCDeserializer>(deserializerConfig);
+    return true;
+}
+
 }}}
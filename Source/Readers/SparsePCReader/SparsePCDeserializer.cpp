@@ -0,0 +1,337 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "SparsePCDeserializer.h"
+#include <limits>
+#include "ReaderConstants.h"
+#include "SequenceData.h"
+#include "StringUtil.h"
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+namespace {
+
+// Sequence of several records, which are not contiguous in the file, so their data is copied.
+struct GatheredSparseSequenceData : SparseSequenceData
+{
+    GatheredSparseSequenceData(unsigned int numberOfSamples, const NDShape& sampleShape)
+        : SparseSequenceData(numberOfSamples), m_sampleShape(sampleShape)
+    {}
+
+    const void* GetDataBuffer() override
+    {
+        return m_values.data();
+    }
+
+    const NDShape& GetSampleShape() override
+    {
+        return m_sampleShape;
+    }
+
+    vector<char> m_values;
+    vector<SparseIndexType> m_indexBuffer;
+    const NDShape& m_sampleShape;
+};
+
+struct GatheredDenseSequenceData : DenseSequenceData
+{
+    GatheredDenseSequenceData(unsigned int numberOfSamples, const NDShape& sampleShape)
+        : DenseSequenceData(numberOfSamples), m_sampleShape(sampleShape)
+    {}
+
+    const void* GetDataBuffer() override
+    {
+        return m_values.data();
+    }
+
+    const NDShape& GetSampleShape() override
+    {
+        return m_sampleShape;
+    }
+
+    vector<char> m_values;
+    const NDShape& m_sampleShape;
+};
+
+}
+
+class SparsePCDeserializer::SparsePCChunk : public Chunk
+{
+public:
+    SparsePCChunk(const SparsePCDeserializer& parent, const ChunkDescriptor& descriptor)
+        : m_parent(parent), m_descriptor(descriptor),
+          m_holdingBuffer(parent.m_file, (uint8_t*)parent.m_file->Data())
+    {}
+
+    void GetSequence(size_t sequenceIndex, vector<SequenceDataPtr>& result) override
+    {
+        if (sequenceIndex >= m_descriptor.m_numSequences)
+            LogicError("Sequence index %zu is out of range of the chunk.", sequenceIndex);
+
+        const size_t index = m_descriptor.m_firstSequence + sequenceIndex;
+        const size_t elementSize = m_parent.m_elementSize;
+        const size_t numFeatures = m_parent.m_numFeatures;
+        const auto& streams = m_parent.m_streams;
+        SequenceKey key { index, 0 };
+
+        // A single record is exposed where it is in the mapping.
+        size_t offset = m_parent.m_sequenceOffsets[index];
+        if (m_parent.m_microbatchSize == 1)
+        {
+            for (size_t i = 0; i < numFeatures; ++i)
+            {
+                int32_t nnz = *(const int32_t*)(m_parent.m_file->Data() + offset);
+                offset += sizeof(int32_t);
+
+                auto sequence = make_shared<ExternalSparseSequenceData>(m_parent.m_file->Data() + offset, 1, streams[i].m_sampleLayout);
+                offset += nnz * elementSize;
+                sequence->m_indices = (SparseIndexType*)(m_parent.m_file->Data() + offset);
+                offset += nnz * sizeof(int32_t);
+                sequence->m_totalNnzCount = nnz;
+                sequence->m_nnzCounts.push_back(nnz);
+                Add(sequence, streams[i], key, result);
+            }
+
+            auto label = make_shared<ExternalDenseSequenceData>(m_parent.m_file->Data() + offset, 1, streams.back().m_sampleLayout);
+            Add(label, streams.back(), key, result);
+            return;
+        }
+
+        // Otherwise the values and indices of the records are gathered per stream.
+        const unsigned int numRecords = (unsigned int)m_parent.m_microbatchSize;
+        vector<shared_ptr<GatheredSparseSequenceData>> features;
+        for (size_t i = 0; i < numFeatures; ++i)
+            features.push_back(make_shared<GatheredSparseSequenceData>(numRecords, streams[i].m_sampleLayout));
+        auto label = make_shared<GatheredDenseSequenceData>(numRecords, streams.back().m_sampleLayout);
+        label->m_values.resize(numRecords * elementSize);
+
+        for (unsigned int r = 0; r < numRecords; ++r)
+        {
+            for (size_t i = 0; i < numFeatures; ++i)
+            {
+                auto& feature = *features[i];
+                int32_t nnz = *(const int32_t*)(m_parent.m_file->Data() + offset);
+                offset += sizeof(int32_t);
+
+                const char* values = m_parent.m_file->Data() + offset;
+                feature.m_values.insert(feature.m_values.end(), values, values + nnz * elementSize);
+                offset += nnz * elementSize;
+                const SparseIndexType* indices = (const SparseIndexType*)(m_parent.m_file->Data() + offset);
+                feature.m_indexBuffer.insert(feature.m_indexBuffer.end(), indices, indices + nnz);
+                offset += nnz * sizeof(int32_t);
+                feature.m_nnzCounts.push_back(nnz);
+                feature.m_totalNnzCount += nnz;
+            }
+
+            memcpy(label->m_values.data() + r * elementSize, m_parent.m_file->Data() + offset, elementSize);
+            offset += elementSize + (m_parent.m_verificationCode != 0 ? sizeof(int32_t) : 0);
+        }
+
+        for (size_t i = 0; i < numFeatures; ++i)
+        {
+            features[i]->m_indices = features[i]->m_indexBuffer.data();
+            Add(features[i], streams[i], key, result);
+        }
+        Add(label, streams.back(), key, result);
+    }
+
+private:
+    void Add(const SequenceDataPtr& sequence, const StreamInformation& stream, const SequenceKey& key, vector<SequenceDataPtr>& result)
+    {
+        sequence->m_elementType = stream.m_elementType;
+        sequence->m_key = key;
+        sequence->m_holdingBuffer = m_holdingBuffer;
+        result.push_back(sequence);
+    }
+
+    const SparsePCDeserializer& m_parent;
+    const ChunkDescriptor& m_descriptor;
+
+    // Keeps the file mapping alive while the sequences are used.
+    shared_ptr<uint8_t> m_holdingBuffer;
+};
+
+SparsePCDeserializer::SparsePCDeserializer(const ConfigParameters& config)
+    : DataDeserializerBase(true)
+{
+    m_fileName = ToFixedWStringFromMultiByte(config(L"file"));
+    m_traceLevel = config(L"traceLevel", 1);
+    m_microbatchSize = config(L"microbatchSize", (size_t)1);
+    m_verificationCode = (int32_t)config(L"verificationCode", (size_t)0);
+    if (m_microbatchSize == 0 || m_microbatchSize > SequenceLenMax)
+        InvalidArgument("Invalid microbatchSize %zu.", m_microbatchSize);
+
+    string precision = config.Find("precision", "float");
+    if (AreEqualIgnoreCase(precision, "double"))
+        m_elementSize = sizeof(double);
+    else if (AreEqualIgnoreCase(precision, "float"))
+        m_elementSize = sizeof(float);
+    else
+        InvalidArgument("Not supported precision '%s'. Expected 'double' or 'float'.", precision.c_str());
+
+    vector<wstring> featureNames, labelNames;
+    const ConfigParameters& input = config(L"input");
+    GetFileConfigNames(input, featureNames, labelNames);
+    if (labelNames.size() != 1)
+        InvalidArgument("SparsePCDeserializer requires exactly one label input.");
+    if (featureNames.empty())
+        InvalidArgument("SparsePCDeserializer requires at least one feature input with a 'dim'.");
+
+    DataType elementType = m_elementSize == sizeof(float) ? DataType::Float : DataType::Double;
+    m_numFeatures = featureNames.size();
+    for (size_t i = 0; i < m_numFeatures; ++i)
+    {
+        // Same order as in the SparsePCReader: the file has the features in reverse.
+        wstring name = featureNames[m_numFeatures - i - 1];
+        ConfigParameters featureConfig = input(name);
+        size_t dim = featureConfig(L"dim");
+
+        StreamInformation stream;
+        stream.m_id = m_streams.size();
+        stream.m_name = name;
+        stream.m_storageFormat = StorageFormat::SparseCSC;
+        stream.m_elementType = elementType;
+        stream.m_sampleLayout = NDShape({ dim });
+        m_streams.push_back(stream);
+    }
+
+    StreamInformation label;
+    label.m_id = m_streams.size();
+    label.m_name = labelNames.front();
+    label.m_storageFormat = StorageFormat::Dense;
+    label.m_elementType = elementType;
+    label.m_sampleLayout = NDShape({ 1 });
+    m_streams.push_back(label);
+
+    m_file = make_shared<MemoryMappedFile>(m_fileName);
+    Index(config(L"chunkSizeInBytes", g_32MB));
+
+    if (m_traceLevel > 0)
+        fprintf(stderr, "SparsePCDeserializer: %zu sequences of '%ls' in %zu chunks\n",
+                m_sequenceOffsets.size() - 1, m_fileName.c_str(), m_chunks.size());
+}
+
+const char* SparsePCDeserializer::GetAddress(size_t offset, size_t size) const
+{
+    if (offset > m_file->Size() || size > m_file->Size() - offset)
+        RuntimeError("Unexpected end of file '%ls' at offset %zu.", m_fileName.c_str(), offset);
+    return m_file->Data() + offset;
+}
+
+size_t SparsePCDeserializer::SkipRecord(size_t offset) const
+{
+    for (size_t i = 0; i < m_numFeatures; ++i)
+    {
+        int32_t nnz;
+        memcpy(&nnz, GetAddress(offset, sizeof(nnz)), sizeof(nnz));
+        if (nnz < 0 || (size_t)nnz > m_streams[i].m_sampleLayout.TotalSize())
+            RuntimeError("Invalid number of non zero values %d of input '%ls' at offset %zu of '%ls'.",
+                         (int)nnz, m_streams[i].m_name.c_str(), offset, m_fileName.c_str());
+        offset += sizeof(nnz);
+
+        size_t size = nnz * (m_elementSize + sizeof(int32_t));
+        GetAddress(offset, size);
+        offset += size;
+    }
+
+    GetAddress(offset, m_elementSize);
+    offset += m_elementSize;
+
+    if (m_verificationCode != 0)
+    {
+        int32_t code;
+        memcpy(&code, GetAddress(offset, sizeof(code)), sizeof(code));
+        if (code != m_verificationCode)
+            RuntimeError("Verification code did not match (expected %d) at offset %zu of '%ls'.", (int)m_verificationCode, offset, m_fileName.c_str());
+        offset += sizeof(code);
+    }
+
+    return offset;
+}
+
+void SparsePCDeserializer::Index(size_t chunkSizeInBytes)
+{
+    // The mapping does not read ahead by itself, the scan does it in large steps.
+    const size_t prefetchSize = g_64MB;
+    size_t prefetched = 0;
+
+    size_t offset = 0;
+    while (offset < m_file->Size())
+    {
+        if (offset >= prefetched)
+        {
+            m_file->WillNeed(prefetched, min(prefetchSize, m_file->Size() - prefetched));
+            prefetched += prefetchSize;
+        }
+
+        // A last group of fewer records than the microbatch size is left out, as by the SparsePCReader.
+        size_t end = offset, numRecords = 0;
+        for (; numRecords < m_microbatchSize && end < m_file->Size(); ++numRecords)
+            end = SkipRecord(end);
+        if (numRecords < m_microbatchSize)
+            break;
+
+        if (m_chunks.empty() || end - m_sequenceOffsets[m_chunks.back().m_firstSequence] > chunkSizeInBytes)
+        {
+            if (m_chunks.size() >= numeric_limits<ChunkIdType>::max())
+                RuntimeError("Number of chunks exceeded overflow limit.");
+            m_chunks.push_back(ChunkDescriptor { m_sequenceOffsets.size(), 0 });
+        }
+
+        m_sequenceOffsets.push_back(offset);
+        m_chunks.back().m_numSequences++;
+        offset = end;
+    }
+
+    m_sequenceOffsets.push_back(offset);
+}
+
+vector<ChunkInfo> SparsePCDeserializer::ChunkInfos()
+{
+    vector<ChunkInfo> result;
+    result.reserve(m_chunks.size());
+    for (size_t i = 0; i < m_chunks.size(); ++i)
+        result.push_back(ChunkInfo { (ChunkIdType)i, m_chunks[i].m_numSequences * m_microbatchSize, m_chunks[i].m_numSequences });
+    return result;
+}
+
+void SparsePCDeserializer::SequenceInfosForChunk(ChunkIdType chunkId, vector<SequenceInfo>& result)
+{
+    const auto& chunk = m_chunks[chunkId];
+    result.reserve(result.size() + chunk.m_numSequences);
+    for (size_t i = 0; i < chunk.m_numSequences; ++i)
+    {
+        SequenceInfo sequence = {};
+        sequence.m_indexInChunk = i;
+        sequence.m_numberOfSamples = (unsigned int)m_microbatchSize;
+        sequence.m_chunkId = chunkId;
+        sequence.m_key.m_sequence = chunk.m_firstSequence + i;
+        result.push_back(sequence);
+    }
+}
+
+ChunkPtr SparsePCDeserializer::GetChunk(ChunkIdType chunkId)
+{
+    return make_shared<SparsePCChunk>(*this, m_chunks.at(chunkId));
+}
+
+void SparsePCDeserializer::WillNeedChunks(const vector<ChunkIdType>& chunkIds)
+{
+    for (auto chunkId : chunkIds)
+    {
+        if (chunkId >= m_chunks.size())
+            continue;
+
+        const auto& chunk = m_chunks[chunkId];
+        size_t start = m_sequenceOffsets[chunk.m_firstSequence];
+        m_file->WillNeed(start, m_sequenceOffsets[chunk.m_firstSequence + chunk.m_numSequences] - start);
+    }
+}
+
+}
@@ -0,0 +1,74 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "DataDeserializerBase.h"
+#include "MemoryMappedFile.h"
+#include "Config.h"
+
+namespace CNTK {
+
+// Deserializer for the files of the SparsePCReader, so that they can be read by the composite reader
+// with its randomizers, caching and prefetching. The file is memory mapped; it has no index, so the
+// records are scanned once when the deserializer is created, and grouped into chunks of about
+// 'chunkSizeInBytes' bytes.
+//
+// The file is a sequence of records, each with
+//   for each feature: int32 nnz, values[nnz], int32 rowIndices[nnz]
+//   value label
+//   int32 verificationCode, if 'verificationCode' is not 0
+// where the values are floats or doubles, as given by 'precision'. As for the SparsePCReader, the features
+// are the input sections with a 'dim' and are stored in the reverse order of the configuration, the label
+// is the input section with a 'labelType' (or 'labelDim'). Every 'microbatchSize' consecutive records form
+// a sequence with as many samples.
+class SparsePCDeserializer : public DataDeserializerBase
+{
+public:
+    explicit SparsePCDeserializer(const Microsoft::MSR::CNTK::ConfigParameters& config);
+
+    std::vector<ChunkInfo> ChunkInfos() override;
+
+    void SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& result) override;
+
+    ChunkPtr GetChunk(ChunkIdType chunkId) override;
+
+    void WillNeedChunks(const std::vector<ChunkIdType>& chunkIds) override;
+
+private:
+    class SparsePCChunk;
+
+    struct ChunkDescriptor
+    {
+        size_t m_firstSequence;
+        size_t m_numSequences;
+    };
+
+    // Builds the offsets of the sequences, checking the records on the way.
+    void Index(size_t chunkSizeInBytes);
+
+    // Returns the offset of the record after the one at 'offset'.
+    size_t SkipRecord(size_t offset) const;
+
+    // Returns the address of the given range of the file, which must lie within the file.
+    const char* GetAddress(size_t offset, size_t size) const;
+
+    std::wstring m_fileName;
+    MemoryMappedFilePtr m_file;
+
+    // The first streams are the features, in the order of the file, the last one is the label.
+    size_t m_numFeatures;
+    size_t m_elementSize;
+    size_t m_microbatchSize;
+    int32_t m_verificationCode;
+
+    // Offset of each sequence in the file, followed by the end of the last one.
+    std::vector<size_t> m_sequenceOffsets;
+    std::vector<ChunkDescriptor> m_chunks;
+
+    unsigned int m_traceLevel;
+};
+
+}
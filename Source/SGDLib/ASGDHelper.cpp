@@ -2,7 +2,7 @@
 // Copyright (c) Microsoft. All rights reserved.
 // Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
 //
-// ASGDHelper.cpp : Implements ASGDHelper interface. The implementation is based on Multiverso.
+// ASGDHelper.cpp : Implements ASGDHelper interface, either with a parameter server built on MPI or based on Multiverso.
 //
 
 #define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms  --add this at the top of all CPP files that give "function or variable may be unsafe" warnings
@@ -14,6 +14,10 @@
 
 #include <functional>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <climits>
 #include <unordered_map>
 #include <numeric>
 #include <algorithm>
@@ -32,6 +36,7 @@
 
 #ifndef CPUONLY
 #include <cuda_runtime.h>
+#include "CUDAPageLockedMemAllocator.h"
 #pragma comment (lib, "cudart.lib")     // for cudaMemcpyAsync()
 #endif
 
@@ -143,16 +148,21 @@ public:
         if (m_useAsyncBuffer && m_aysncBufferThread != nullptr && m_aysncBufferThread->joinable())
             m_aysncBufferThread->join();
 
-        delete m_bufferSwapIndex, m_deltaArray;
+        delete m_bufferSwapIndex;
 
         for (size_t i = 0; i < m_localBufferNum; i++)
         {
 #ifndef CPUONLY
-            CUDA_CALL(cudaFreeHost(m_cpuAsyncBuffer[i]));
+            CUDAPageLockedMemAllocator::Free(m_cpuAsyncBuffer[i], m_pinnedMemoryDeviceId);
 #else
             delete m_cpuAsyncBuffer[i];
 #endif
         }
+#ifndef CPUONLY
+        CUDAPageLockedMemAllocator::Free(m_deltaArray, m_pinnedMemoryDeviceId);
+#else
+        delete[] m_deltaArray;
+#endif
         delete m_cpuAsyncBuffer;
 #ifndef CPUONLY
         CUDA_CALL(cudaStreamDestroy(_commStream));
@@ -472,10 +482,11 @@ private:
             m_gpuAsyncBuffer[i2].reserve(m_tableCount);
 
         // create pinned memory
+        m_pinnedMemoryDeviceId = learnableNodes.front()->GetDeviceId();
         for (int i3 = 0; i3 < m_localBufferNum; ++i3)
-            CUDA_CALL(cudaMallocHost((void **)&m_cpuAsyncBuffer[i3], sizeof(ElemType) * (m_totalModelSize), cudaHostAllocPortable));
+            m_cpuAsyncBuffer[i3] = (ElemType*) CUDAPageLockedMemAllocator::Malloc(sizeof(ElemType) * (m_totalModelSize), m_pinnedMemoryDeviceId);
 
-        CUDA_CALL(cudaMallocHost((void **)&m_deltaArray, sizeof(ElemType) * (m_totalModelSize), cudaHostAllocPortable));
+        m_deltaArray = (ElemType*) CUDAPageLockedMemAllocator::Malloc(sizeof(ElemType) * (m_totalModelSize), m_pinnedMemoryDeviceId);
 #else
         for (int i4 = 0; i4 < m_localBufferNum; i4++)
             m_cpuAsyncBuffer[i4] = new ElemType[m_totalModelSize];
@@ -581,6 +592,7 @@ private:
     ElemType * m_deltaArray;
     //std::vector<shared_ptr<ElemType>  > m_cpuAsyncBuffer;
     ElemType ** m_cpuAsyncBuffer;
+    int m_pinnedMemoryDeviceId; // the device that m_cpuAsyncBuffer and m_deltaArray were allocated for
 
     MPIWrapperPtr m_pMPI;
 
@@ -595,8 +607,588 @@ private:
 
 #endif 
 
+// -----------------------------------------------------------------------
+// MPIASGDHelper -- implementation of the ASGDHelper interface with a parameter server built on MPI point-to-point messages
+// Every rank is a worker and also serves one contiguous shard of the model, which is the concatenation of all the learnable
+// nodes. A worker pushes the delta of its local model to all the shards and pulls the current values back. A server replies
+// to the push of a worker only when that worker is at most maxStaleness pushes ahead of the slowest worker (stale synchronous
+// parallel); a negative maxStaleness never delays the reply. The deltas can be sent in half precision, with the rounding
+// error carried over to the next push of the worker; the model itself is always sent in full precision.
+// All MPI calls are made by one communication thread, which serves the shard of this rank and carries out the pushes, pulls
+// and barriers of this worker. No other thread may use MPI while the helper exists.
+// -----------------------------------------------------------------------
+template<class ElemType = float>
+class MPIASGDHelper : public ASGDHelper<ElemType>
+{
+public:
+    typedef shared_ptr<ComputationNode<ElemType>> ComputationNodePtr;
+
+    MPIASGDHelper(const std::list<ComputationNodeBasePtr> & learnableNodes,             // Parameters that needs to be train
+        const MPIWrapperPtr& mpi,                                                       // MPI communicator of the workers
+        bool useAsyncBuffer = true,                                                     // Using asynchonous buffer to hide communication cost
+        bool isSimulatedModelAveragingSGD = false,                                      // Using parameter server-based MA rather than ASGD
+        AdjustLearningRateAtBeginning adjusttype = AdjustLearningRateAtBeginning::None, // Adjust learning per minibatches at very beginning of training process
+        double adjustCoef = 0.2,                                                        // see in DecayCoefficient()
+        size_t adjustPerMinibatches = 600,                                              //
+        int traceLevel = 0,                                                             // log level
+        int maxStaleness = -1,                                                          // max number of pushes a worker may be ahead of the slowest one, -1 for no bound
+        bool useFp16Deltas = false) :                                                   // send the deltas in half precision
+        m_mpi(mpi), m_numWorkers((int)mpi->NumNodesInUse()), m_myRank((int)mpi->CurrentNodeRank()),
+        m_parameterSyncCounter(0), m_adjustLearningRateAtBeginningType(adjusttype),
+        m_adjustCoefficient(adjustCoef), m_adjustMBNumber(adjustPerMinibatches),
+        m_useAsyncBuffer(useAsyncBuffer), m_traceLevel(traceLevel), m_ModelAveragingSGDSimulating(isSimulatedModelAveragingSGD),
+        m_maxStaleness(maxStaleness), m_useFp16Deltas(useFp16Deltas),
+        m_jobRequested(false), m_jobDone(true), m_shutdownRequested(false),
+        m_clock(0), m_jobRunning(false), m_doneSent(false), m_jobIsBarrier(false),
+        m_barrierClock(0), m_numDoneWorkers(0), m_numBarrierArrivals(0)
+    {
+        // Model averaging: every push waits for the pushes of all the other workers.
+        if (m_ModelAveragingSGDSimulating)
+        {
+            m_maxStaleness = 0;
+            m_useAsyncBuffer = false;
+        }
+
+        for (auto& node : learnableNodes)
+        {
+            m_tableOffsets.push_back(m_totalModelSize);
+            m_tableLength.push_back(dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value().GetNumElements());
+            m_totalModelSize += m_tableLength.back();
+        }
+
+        for (int s = 0; s < m_numWorkers; s++)
+        {
+            if (ShardSize(s) * sizeof(ElemType) + sizeof(MessageHeader) > INT_MAX)
+                RuntimeError("MPIASGDHelper: model shard of %d elements is too large for an MPI message, use more workers.", (int)ShardSize(s));
+        }
+
+        // Pipeline releated variables
+        m_localBufferNum = m_useAsyncBuffer ? 2 : 1;
+        m_bufferSwapIndex.resize(m_localBufferNum);
+        m_bufferIndexInUse = 0;
+        for (int i = 0; i < m_localBufferNum; i++)
+            m_bufferSwapIndex[i] = (i + 1) % m_localBufferNum;
+
+        m_cpuAsyncBuffer.resize(m_localBufferNum);
+        for (auto& buffer : m_cpuAsyncBuffer)
+            buffer.resize(m_totalModelSize);
+        m_deltaArray.resize(m_totalModelSize);
+        if (m_useFp16Deltas)
+            m_fp16Residual.assign(m_totalModelSize, 0);
+
+        // Server state of the shard of this rank, with a receive posted for every worker.
+        m_shard.assign(ShardSize(m_myRank), 0);
+        m_clocks.assign(m_numWorkers, 0);
+        m_atBarrier.assign(m_numWorkers, 0);
+        m_requestBuffers.resize(m_numWorkers);
+        m_serverRequests.assign(m_numWorkers, MPI_REQUEST_NULL);
+        for (int w = 0; w < m_numWorkers; w++)
+        {
+            m_requestBuffers[w].resize(sizeof(MessageHeader) + m_shard.size() * sizeof(ElemType));
+            PostRequestReceive(w);
+        }
+
+        m_communicationThread = std::thread([this]() { CommunicationLoop(); });
+
+        if (m_traceLevel > 0)
+            fprintf(stderr, "MPIASGDHelper: %d workers, shard of %d of %d elements, maxStaleness %d, %s deltas.\n",
+                    m_numWorkers, (int)m_shard.size(), (int)m_totalModelSize, m_maxStaleness, m_useFp16Deltas ? "fp16" : "full precision");
+    }
+
+    ~MPIASGDHelper()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobFinished.wait(lock, [this]() { return m_jobDone || m_error; });
+            m_shutdownRequested = true;
+        }
+        m_communicationThread.join();
+    }
+
+    void InitModel(const std::list<ComputationNodeBasePtr> & learnableNodes) override
+    {
+        float factor = 1.0f / m_numWorkers;
+
+        CopyFromModel(learnableNodes, m_deltaArray.data());
+
+        // because the parameter server will minus the delta on the server, so that we should send the minus initial model to the server.
+        // The initial model is always sent in full precision.
+        std::transform(m_deltaArray.begin(), m_deltaArray.end(), m_deltaArray.begin(), [factor](ElemType v) { return -factor * v; });
+        RunJob(JobKind::PushAndPull, m_cpuAsyncBuffer[0].data(), /*compress=*/false, nullptr);
+        WaitAsyncBuffer();
+        WaitAll();
+        RunJob(JobKind::Pull, m_cpuAsyncBuffer[0].data(), /*compress=*/false, nullptr);
+        WaitAsyncBuffer();
+
+        for (int i = 1; i < m_localBufferNum; i++)
+            m_cpuAsyncBuffer[i] = m_cpuAsyncBuffer[0];
+        CopyToModel(learnableNodes, m_cpuAsyncBuffer[0].data());
+
+        if (m_traceLevel > 0)
+            fprintf(stderr, "MPIASGDHelper: initial model loaded.\n");
+    }
+
+    bool PushAndPullModel(const std::list<ComputationNodeBasePtr> & learnableNodes, size_t sampleSinceLastSynced) override
+    {
+        m_parameterSyncCounter++;
+
+        float factor = m_ModelAveragingSGDSimulating ? 1.0f / m_numWorkers : DecayCoefficient();
+
+        WaitAsyncBuffer();
+        m_bufferIndexInUse = m_bufferSwapIndex[m_bufferIndexInUse];
+
+        // delta = (model the worker started from - local model) * factor, computed by the communication thread
+        ElemType* base = m_cpuAsyncBuffer[m_bufferIndexInUse].data();
+        CopyFromModel(learnableNodes, m_deltaArray.data());
+        auto computeDelta = [this, base, factor]()
+        {
+            std::transform(base, base + m_totalModelSize, m_deltaArray.begin(), m_deltaArray.begin(),
+                           [factor](ElemType b, ElemType m) { return factor * (b - m); });
+        };
+
+        if (m_useAsyncBuffer)
+        {
+            // Continue training from the model pulled by the previous push while this one is exchanged.
+            CopyToModel(learnableNodes, m_cpuAsyncBuffer[m_bufferSwapIndex[m_bufferIndexInUse]].data());
+            RunJob(JobKind::PushAndPull, base, m_useFp16Deltas, computeDelta);
+        }
+        else
+        {
+            RunJob(JobKind::PushAndPull, base, m_useFp16Deltas, computeDelta);
+            WaitAsyncBuffer();
+            CopyToModel(learnableNodes, base);
+        }
+        return true;
+    }
+
+    void WaitAll() override
+    {
+        RunJob(JobKind::Barrier, nullptr, false, nullptr);
+        WaitAsyncBuffer();
+    }
+
+    void WaitAsyncBuffer() override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_jobFinished.wait(lock, [this]() { return m_jobDone || m_error; });
+        if (m_error)
+            std::rethrow_exception(m_error);
+    }
+
+private:
+    enum class MessageKind : int
+    {
+        Push = 0,           // delta of the shard, the server replies with the shard once the staleness bound allows it
+        Pull = 1,           // the server replies with the shard right away
+        Barrier = 2,        // sent to every server; rank 0 releases all workers once every one of them arrived
+        BarrierRelease = 3, // sent by rank 0, with the clock all workers continue from
+        Done = 4,           // last message of a worker to every server
+    };
+
+    enum class JobKind
+    {
+        PushAndPull,
+        Pull,
+        Barrier,
+    };
+
+    struct MessageHeader
+    {
+        long long m_clock; // number of pushes of the worker, including this one
+        int m_kind;
+        int m_compressed;  // the payload is half precision
+    };
+
+    struct Job
+    {
+        JobKind m_kind;
+        ElemType* m_target;            // receives the pulled model
+        bool m_compress;
+        std::function<void()> m_prepare; // run by the communication thread before the job is sent
+    };
+
+    struct PendingSend
+    {
+        MPI_Request m_request;
+        std::vector<char> m_buffer;
+    };
+
+    static const int s_requestTag = 0x4153; // worker -> server
+    static const int s_replyTag = 0x4154;   // server -> worker, the values of the shard
+    static const int s_releaseTag = 0x4155; // rank 0 -> worker, barrier release
+
+    size_t ShardBegin(int s) const { return m_totalModelSize * s / m_numWorkers; }
+    size_t ShardSize(int s) const { return ShardBegin(s + 1) - ShardBegin(s); }
+
+    void CopyFromModel(const std::list<ComputationNodeBasePtr> & learnableNodes, ElemType* dst)
+    {
+        int i = 0; // indicate the index of learnable nodes
+        for (auto nodeIter = learnableNodes.begin(); nodeIter != learnableNodes.end(); nodeIter++, i++)
+        {
+            ComputationNodePtr node = dynamic_pointer_cast<ComputationNode<ElemType>>(*nodeIter);
+            Matrix<ElemType> &mat = node->Value();
+            ElemType* px = dst + m_tableOffsets[i];
+            size_t length = m_tableLength[i];
+            mat.CopyToArray(px, length);
+        }
+    }
+
+    void CopyToModel(const std::list<ComputationNodeBasePtr> & learnableNodes, ElemType* src)
+    {
+        int i = 0; // indicate the index of learnable nodes
+        for (auto nodeIter = learnableNodes.begin(); nodeIter != learnableNodes.end(); nodeIter++, i++)
+        {
+            ComputationNodePtr node = dynamic_pointer_cast<ComputationNode<ElemType>>(*nodeIter);
+            Matrix<ElemType> &mat = node->Value();
+            mat.SetValue(mat.GetNumRows(), mat.GetNumCols(), mat.GetDeviceId(), src + m_tableOffsets[i]);
+        }
+    }
+
+    float DecayCoefficient()
+    {
+        float f = 1.f;
+        switch (m_adjustLearningRateAtBeginningType)
+        {
+        case AdjustLearningRateAtBeginning::None:
+            break;
+        case AdjustLearningRateAtBeginning::Linearly:
+            f = min(f, max(0.f, (float)(m_adjustCoefficient + (1 - m_adjustCoefficient) / m_adjustMBNumber * m_parameterSyncCounter)));
+            break;
+        case AdjustLearningRateAtBeginning::Staircase:
+            f = min(f, max(0.f, (float)(m_adjustCoefficient * (m_parameterSyncCounter / m_adjustMBNumber + 1))));
+            break;
+        default:
+            break;
+        }
+        return f;
+    }
+
+    // Hands a job to the communication thread, after the previous one has finished.
+    void RunJob(JobKind kind, ElemType* target, bool compress, std::function<void()> prepare)
+    {
+        WaitAsyncBuffer();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = Job{ kind, target, compress, std::move(prepare) };
+        m_jobDone = false;
+        m_jobRequested = true;
+    }
+
+    // -----------------------------------------------------------------------
+    // communication thread
+    // -----------------------------------------------------------------------
+
+    void CommunicationLoop()
+    {
+        try
+        {
+            while (!m_doneSent || m_numDoneWorkers < m_numWorkers || !m_pendingSends.empty())
+            {
+                bool progress = ServeRequests();
+                progress = ProgressJob() || progress;
+                progress = CompleteSends() || progress;
+                if (!progress)
+                    std::this_thread::yield();
+            }
+        }
+        catch (...)
+        {
+            fprintf(stderr, "MPIASGDHelper: communication thread failed.\n");
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_error = std::current_exception();
+            m_jobFinished.notify_all();
+        }
+    }
+
+    void PostSend(int dest, int tag, std::vector<char>&& buffer)
+    {
+        m_pendingSends.emplace_back();
+        auto& send = m_pendingSends.back();
+        send.m_buffer = std::move(buffer);
+        m_mpi->Isend(send.m_buffer.data(), (int)send.m_buffer.size(), MPI_CHAR, dest, tag, &send.m_request) || MpiFail("MPIASGDHelper: MPI_Isend");
+    }
+
+    void SendMessage(int dest, int tag, MessageKind kind, long long clock, const ElemType* payload = nullptr, size_t offset = 0, size_t count = 0, bool compress = false)
+    {
+        MessageHeader header = { clock, (int)kind, compress ? 1 : 0 };
+        std::vector<char> buffer(sizeof(MessageHeader) + count * (compress ? sizeof(half) : sizeof(ElemType)));
+        memcpy(buffer.data(), &header, sizeof(header));
+        if (compress)
+        {
+            // error feedback: whatever the rounding loses is added to the next delta
+            half* out = reinterpret_cast<half*>(buffer.data() + sizeof(MessageHeader));
+            ElemType* residual = m_fp16Residual.data() + offset;
+            for (size_t i = 0; i < count; i++)
+            {
+                ElemType v = payload[offset + i] + residual[i];
+                out[i] = half((float)v);
+                residual[i] = v - (ElemType)(float)out[i];
+            }
+        }
+        else if (count > 0)
+            memcpy(buffer.data() + sizeof(MessageHeader), payload + offset, count * sizeof(ElemType));
+        PostSend(dest, tag, std::move(buffer));
+    }
+
+    void SendShard(int worker)
+    {
+        std::vector<char> buffer(m_shard.size() * sizeof(ElemType));
+        memcpy(buffer.data(), m_shard.data(), buffer.size());
+        PostSend(worker, s_replyTag, std::move(buffer));
+    }
+
+    bool CompleteSends()
+    {
+        bool progress = false;
+        for (auto iter = m_pendingSends.begin(); iter != m_pendingSends.end();)
+        {
+            int flag = 0;
+            m_mpi->Test(&iter->m_request, &flag, MPI_STATUS_IGNORE) || MpiFail("MPIASGDHelper: MPI_Test");
+            if (flag)
+            {
+                iter = m_pendingSends.erase(iter);
+                progress = true;
+            }
+            else
+                ++iter;
+        }
+        return progress;
+    }
+
+    void PostRequestReceive(int worker)
+    {
+        m_mpi->Irecv(m_requestBuffers[worker].data(), (int)m_requestBuffers[worker].size(), MPI_CHAR, worker, s_requestTag, &m_serverRequests[worker]) || MpiFail("MPIASGDHelper: MPI_Irecv");
+    }
+
+    // Server side: handles the messages that arrived for the shard of this rank.
+    bool ServeRequests()
+    {
+        bool progress = false;
+        for (;;)
+        {
+            int worker = MPI_UNDEFINED, flag = 0;
+            m_mpi->Testany(m_numWorkers, m_serverRequests.data(), &worker, &flag, MPI_STATUS_IGNORE) || MpiFail("MPIASGDHelper: MPI_Testany");
+            if (!flag || worker == MPI_UNDEFINED)
+                return progress;
+            progress = true;
+
+            MessageHeader header;
+            memcpy(&header, m_requestBuffers[worker].data(), sizeof(header));
+            const char* payload = m_requestBuffers[worker].data() + sizeof(MessageHeader);
+
+            switch ((MessageKind)header.m_kind)
+            {
+            case MessageKind::Push:
+                if (header.m_compressed)
+                {
+                    const half* delta = reinterpret_cast<const half*>(payload);
+                    for (size_t i = 0; i < m_shard.size(); i++)
+                        m_shard[i] -= (ElemType)(float)delta[i];
+                }
+                else
+                {
+                    const ElemType* delta = reinterpret_cast<const ElemType*>(payload);
+                    for (size_t i = 0; i < m_shard.size(); i++)
+                        m_shard[i] -= delta[i];
+                }
+                m_clocks[worker] = header.m_clock;
+                m_atBarrier[worker] = 0; // the barrier has been released, even if not all of its messages arrived here yet
+                m_deferredReplies.push_back(worker);
+                ReplyToPushes();
+                break;
+            case MessageKind::Pull:
+                SendShard(worker);
+                break;
+            case MessageKind::Barrier:
+                // A worker in a barrier does not hold back the pushes of the others, which may be behind it.
+                // Once all workers arrived they continue from the same clock, however many pushes each of them did.
+                m_atBarrier[worker] = 1;
+                m_barrierClock = std::max(m_barrierClock, header.m_clock);
+                ReplyToPushes();
+                if (++m_numBarrierArrivals == m_numWorkers)
+                {
+                    for (int w = 0; w < m_numWorkers; w++)
+                    {
+                        m_atBarrier[w] = 0;
+                        m_clocks[w] = std::max(m_clocks[w], m_barrierClock);
+                    }
+                    if (m_myRank == 0)
+                    {
+                        for (int w = 0; w < m_numWorkers; w++)
+                            SendMessage(w, s_releaseTag, MessageKind::BarrierRelease, m_barrierClock);
+                    }
+                    m_numBarrierArrivals = 0;
+                    m_barrierClock = 0;
+                }
+                break;
+            case MessageKind::Done:
+                // a worker that has finished never holds back the others
+                m_clocks[worker] = LLONG_MAX;
+                m_numDoneWorkers++;
+                ReplyToPushes();
+                continue; // no more messages from this worker
+            default:
+                LogicError("MPIASGDHelper: unexpected message kind %d.", header.m_kind);
+            }
+            PostRequestReceive(worker);
+        }
+    }
+
+    // Replies to the pushes that are within the staleness bound.
+    void ReplyToPushes()
+    {
+        long long minClock = LLONG_MAX;
+        for (int w = 0; w < m_numWorkers; w++)
+        {
+            if (!m_atBarrier[w])
+                minClock = std::min(minClock, m_clocks[w]);
+        }
+        for (auto iter = m_deferredReplies.begin(); iter != m_deferredReplies.end();)
+        {
+            if (m_maxStaleness < 0 || m_clocks[*iter] <= minClock + m_maxStaleness)
+            {
+                SendShard(*iter);
+                iter = m_deferredReplies.erase(iter);
+            }
+            else
+                ++iter;
+        }
+    }
+
+    // Worker side: starts the next job, or completes the running one.
+    bool ProgressJob()
+    {
+        if (!m_jobRunning)
+        {
+            Job job;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_jobRequested)
+                {
+                    if (!m_shutdownRequested || m_doneSent)
+                        return false;
+                    for (int s = 0; s < m_numWorkers; s++)
+                        SendMessage(s, s_requestTag, MessageKind::Done, m_clock);
+                    m_doneSent = true;
+                    return true;
+                }
+                job = std::move(m_job);
+                m_jobRequested = false;
+            }
+            StartJob(job);
+            m_jobRunning = true;
+            return true;
+        }
+
+        int index = MPI_UNDEFINED, flag = 0;
+        m_mpi->Testany((int)m_jobRequests.size(), m_jobRequests.data(), &index, &flag, MPI_STATUS_IGNORE) || MpiFail("MPIASGDHelper: MPI_Testany");
+        if (!flag)
+            return false;
+        if (index == MPI_UNDEFINED) // all replies arrived
+        {
+            if (m_jobIsBarrier)
+                m_clock = m_releaseHeader.m_clock;
+            m_jobIsBarrier = false;
+            m_jobRunning = false;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobDone = true;
+            m_jobFinished.notify_all();
+        }
+        return true;
+    }
+
+    void StartJob(Job& job)
+    {
+        if (job.m_prepare)
+            job.m_prepare();
+
+        m_jobRequests.clear();
+        if (job.m_kind == JobKind::Barrier)
+        {
+            m_jobRequests.push_back(MPI_REQUEST_NULL);
+            m_mpi->Irecv(&m_releaseHeader, (int)sizeof(m_releaseHeader), MPI_CHAR, 0, s_releaseTag, &m_jobRequests.back()) || MpiFail("MPIASGDHelper: MPI_Irecv");
+            for (int s = 0; s < m_numWorkers; s++)
+                SendMessage(s, s_requestTag, MessageKind::Barrier, m_clock);
+            m_jobIsBarrier = true;
+            return;
+        }
+
+        if (job.m_kind == JobKind::PushAndPull)
+            m_clock++;
+
+        // post all the receives first, they cannot be reallocated once the first one is posted
+        m_jobRequests.assign(m_numWorkers, MPI_REQUEST_NULL);
+        for (int s = 0; s < m_numWorkers; s++)
+            m_mpi->Irecv(job.m_target + ShardBegin(s), (int)(ShardSize(s) * sizeof(ElemType)), MPI_CHAR, s, s_replyTag, &m_jobRequests[s]) || MpiFail("MPIASGDHelper: MPI_Irecv");
+
+        for (int s = 0; s < m_numWorkers; s++)
+        {
+            if (job.m_kind == JobKind::PushAndPull)
+                SendMessage(s, s_requestTag, MessageKind::Push, m_clock, m_deltaArray.data(), ShardBegin(s), ShardSize(s), job.m_compress);
+            else
+                SendMessage(s, s_requestTag, MessageKind::Pull, m_clock);
+        }
+    }
+
+    MPIWrapperPtr m_mpi;
+    int m_numWorkers;
+    int m_myRank;
+
+    size_t m_parameterSyncCounter;
+    AdjustLearningRateAtBeginning m_adjustLearningRateAtBeginningType;
+    double m_adjustCoefficient;
+    size_t m_adjustMBNumber;
+
+    bool m_useAsyncBuffer;
+    int m_traceLevel;
+    bool m_ModelAveragingSGDSimulating;
+    int m_maxStaleness;
+    bool m_useFp16Deltas;
+
+    vector<size_t> m_tableLength;
+    vector<size_t> m_tableOffsets;
+    size_t m_totalModelSize = 0;
+
+    // Pipeline releated variables, as in MultiversoHelper
+    int m_localBufferNum;
+    vector<int> m_bufferSwapIndex;
+    int m_bufferIndexInUse;
+    vector<vector<ElemType>> m_cpuAsyncBuffer;
+    vector<ElemType> m_deltaArray;
+    vector<ElemType> m_fp16Residual;
+
+    // state shared with the communication thread
+    std::thread m_communicationThread;
+    std::mutex m_mutex;
+    std::condition_variable m_jobFinished;
+    Job m_job;
+    bool m_jobRequested;
+    bool m_jobDone;
+    bool m_shutdownRequested;
+    std::exception_ptr m_error;
+
+    // worker state, only used by the communication thread
+    long long m_clock;
+    bool m_jobRunning;
+    bool m_doneSent;
+    bool m_jobIsBarrier;
+    vector<MPI_Request> m_jobRequests;
+    MessageHeader m_releaseHeader;
+    std::list<PendingSend> m_pendingSends;
+
+    // server state, only used by the communication thread
+    vector<ElemType> m_shard;
+    vector<long long> m_clocks;              // last push of every worker
+    vector<vector<char>> m_requestBuffers;
+    vector<MPI_Request> m_serverRequests;
+    std::list<int> m_deferredReplies;        // workers whose push waits for the slowest worker
+    vector<char> m_atBarrier;
+    long long m_barrierClock;                // largest clock of the workers in the barrier
+    int m_numDoneWorkers;
+    int m_numBarrierArrivals;
+};  // Class MPIASGDHelper
+
 // A None implementation of ASGDHelper interface which does nothing
-// This is used when CNTK_ENABLE_ASGD = false
+// This is used when the Multiverso backend is requested but CNTK_ENABLE_ASGD = false
 template<class ElemType = float>
 class NoneASGDHelper : public ASGDHelper<ElemType>
 {
@@ -635,8 +1227,19 @@ ASGDHelper<ElemType>* NewASGDHelper(
     double adjustCoef,
     size_t adjustPerMinibatches,
     int traceLevel,
-    int syncPerfStats) 
+    int syncPerfStats,
+    const MPIWrapperPtr& mpi,
+    ASGDBackend backend,
+    int maxStaleness,
+    bool useFp16Deltas)
 {
+    if (backend == ASGDBackend::Native)
+    {
+        if (!mpi)
+            InvalidArgument("NewASGDHelper: the native parameter server requires MPI.");
+        return new MPIASGDHelper<ElemType>(learnableNodes, mpi, useAsyncBuffer, isSimulatedModelAveragingSGD,
+                                           adjusttype, adjustCoef, adjustPerMinibatches, traceLevel, maxStaleness, useFp16Deltas);
+    }
 #ifdef ASGD_PARALLEL_SUPPORT
     return new MultiversoHelper<ElemType>(learnableNodes, nodeNumRanks, useAsyncBuffer, isSimulatedModelAveragingSGD, 
                                       adjusttype, adjustCoef, adjustPerMinibatches, traceLevel, syncPerfStats);
@@ -655,7 +1258,11 @@ template<> ASGDHelper<half>* NewASGDHelper<half>(
     double adjustCoef,
     size_t adjustPerMinibatches,
     int traceLevel,
-    int syncPerfStats)
+    int syncPerfStats,
+    const MPIWrapperPtr& mpi,
+    ASGDBackend backend,
+    int maxStaleness,
+    bool useFp16Deltas)
 {
     RuntimeError("NewASGDHelper - half not supported!");
 }
@@ -669,7 +1276,11 @@ template ASGDHelper<float>* NewASGDHelper<float>(
     double adjustCoef,
     size_t adjustPerMinibatches,
     int traceLevel,
-    int syncPerfStats); 
+    int syncPerfStats,
+    const MPIWrapperPtr& mpi,
+    ASGDBackend backend,
+    int maxStaleness,
+    bool useFp16Deltas);
 
 template ASGDHelper<double>* NewASGDHelper<double>(
     const std::list<ComputationNodeBasePtr> & learnableNodes,
@@ -680,6 +1291,10 @@ template ASGDHelper<double>* NewASGDHelper<double>(
     double adjustCoef,
     size_t adjustPerMinibatches,
     int traceLevel,
-    int syncPerfStats); 
+    int syncPerfStats,
+    const MPIWrapperPtr& mpi,
+    ASGDBackend backend,
+    int maxStaleness,
+    bool useFp16Deltas);
 
 }}} 
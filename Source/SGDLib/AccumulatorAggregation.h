@@ -46,13 +46,17 @@ void AggregateAccumulatorValuesAndUpdateEvaluation(
         accumulatorValues.emplace_back(&accumulator);
     }
 
-    // Prepare aggregator.
+    // Prepare aggregator. All accumulators are packed into one contiguous buffer, so that together with the header
+    // they are reduced in a single call rather than one per accumulator.
+    size_t accumulatorSizeInBytes = 0;
+    for (Matrix<ElemType>* acc : accumulatorValues)
+        accumulatorSizeInBytes = std::max(accumulatorSizeInBytes, sizeof(ElemType) * acc->GetNumElements());
     std::shared_ptr<IDistGradAggregator<ElemType>> distGradAgg = GetSimpleDistGradAggregator<ElemType>(
         mpi,
         false /*useAsyncAggregation*/,
         net->GetDeviceId(),
         0 /*syncStatsTrace*/,
-        packThresholdSizeInBytes);
+        std::max(packThresholdSizeInBytes, accumulatorSizeInBytes));
 
     // Prepare header.
     const size_t c_evalNodes = 1;
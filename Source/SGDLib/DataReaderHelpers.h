@@ -258,6 +258,125 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         return 0;
     }
 
+    // ===================================================================
+    // SubminibatchAutoSizer -- picks the number of sub-minibatches from a device memory budget
+    // ===================================================================
+
+    // Instead of a guessed maxSamplesInRAM, the split of each minibatch is derived from what past sub-minibatches used:
+    // the activations, i.e. the values and gradients of the nodes with an MBLayout (counted once per matrix, as the
+    // MatrixPool shares them), per column of the layout, and everything else at the peak of forward and backward
+    // (parameters, gradients, learner state, workspaces). The peak is the high-water mark of the caching allocator if it is
+    // enabled, and the memory in use on the device after backward otherwise. A minibatch is then split into as few
+    // sub-minibatches as keep the predicted peak within 'memoryFraction' of the device memory. Since this is re-evaluated
+    // for each minibatch, the split follows the sequence lengths; the estimates grow at once and shrink slowly.
+    // The first minibatch is split as far as c_probeSubminibatches, so that it fits while it is measured.
+    template <class ElemType>
+    class SubminibatchAutoSizer
+    {
+        static const size_t c_probeSubminibatches = 8;
+
+        DEVICEID_TYPE m_deviceId;
+        size_t m_budgetBytes;       // 0 if disabled
+        double m_bytesPerColumn;    // activations
+        double m_fixedBytes;        // the rest of the peak
+        size_t m_numSubminibatches; // of the last minibatch
+        int m_traceLevel;
+
+        size_t ActivationBytes(const ComputationNetwork& net) const
+        {
+            std::set<const Matrix<ElemType>*> matrices;
+            size_t bytes = 0;
+            for (const auto& nodeBase : net.GetAllNodes())
+            {
+                auto node = dynamic_pointer_cast<ComputationNode<ElemType>>(nodeBase);
+                if (!node || !node->HasMBLayout())
+                    continue;
+                for (const auto& matrix : { node->ValuePtrRef(), node->GradientPtrRef() })
+                {
+                    if (matrix && matrix->GetMatrixType() == DENSE && matrices.insert(matrix.get()).second)
+                        bytes += matrix->GetNumElements() * sizeof(ElemType);
+                }
+            }
+            return bytes;
+        }
+
+    public:
+        SubminibatchAutoSizer()
+            : m_deviceId(CPUDEVICE), m_budgetBytes(0), m_bytesPerColumn(0), m_fixedBytes(0), m_numSubminibatches(0), m_traceLevel(0)
+        {
+        }
+
+        // 'memoryFraction' 0 disables this, as does a network without a GPU.
+        void Init(const ComputationNetworkPtr& net, double memoryFraction, int traceLevel)
+        {
+            if (memoryFraction < 0 || memoryFraction > 1)
+                InvalidArgument("subminibatchMemoryFraction must be between 0 and 1.");
+
+            m_deviceId = net->GetDeviceId();
+            m_budgetBytes = 0;
+            m_traceLevel = traceLevel;
+            if (memoryFraction > 0 && m_deviceId >= 0)
+                m_budgetBytes = (size_t)(memoryFraction * TracingGPUMemoryAllocator::GetFreeAndTotalMemoryInMBs(m_deviceId).second * (1 << 20));
+        }
+
+        bool IsEnabled() const { return m_budgetBytes > 0; }
+
+        // the number of sub-minibatches for the minibatch that 'net' holds now
+        size_t NumSubminibatches(ComputationNetwork& net)
+        {
+            const auto& layout = net.GetMBLayoutPtrOfNetwork();
+            if (!layout)
+                return 1;
+            const size_t numSequences = layout->GetNumParallelSequences();
+            size_t numSubminibatches;
+            if (m_bytesPerColumn <= 0)
+                numSubminibatches = std::min(numSequences, c_probeSubminibatches);
+            else
+            {
+                double available = (double)m_budgetBytes - m_fixedBytes;
+                size_t maxColumns = available > 0 ? (size_t)(available / m_bytesPerColumn) : 0;
+                // the split is by parallel sequences, so the columns per sub-minibatch come in multiples of the time steps
+                size_t maxSequences = maxColumns / std::max(layout->GetNumTimeSteps(), (size_t)1);
+                numSubminibatches = maxSequences > 0 ? (numSequences + maxSequences - 1) / maxSequences : numSequences;
+                numSubminibatches = std::min(std::max(numSubminibatches, (size_t)1), numSequences);
+            }
+
+            if (m_traceLevel > 0 && numSubminibatches != m_numSubminibatches)
+                fprintf(stderr, "SubminibatchAutoSizer: %d sub-minibatches for %d parallel sequences of %d time steps (%.1f KB per column, %.1f MB fixed, %.1f MB budget).\n",
+                        (int)numSubminibatches, (int)numSequences, (int)layout->GetNumTimeSteps(), m_bytesPerColumn / 1024, m_fixedBytes / (1 << 20), (double)m_budgetBytes / (1 << 20));
+            return (m_numSubminibatches = numSubminibatches);
+        }
+
+        void BeginSubminibatch()
+        {
+            if (TracingGPUMemoryAllocator::IsCachingEnabled())
+                TracingGPUMemoryAllocator::ResetPeakStats(m_deviceId);
+        }
+
+        // after the forward and backward of the sub-minibatch that 'net' holds
+        void EndSubminibatch(ComputationNetwork& net)
+        {
+            const auto& layout = net.GetMBLayoutPtrOfNetwork();
+            if (!layout || layout->GetNumCols() == 0)
+                return;
+
+            double peakBytes;
+            if (TracingGPUMemoryAllocator::IsCachingEnabled())
+                peakBytes = (double)TracingGPUMemoryAllocator::GetCacheStats(m_deviceId).peakBytesInUse;
+            else
+            {
+                auto freeAndTotal = TracingGPUMemoryAllocator::GetFreeAndTotalMemoryInMBs(m_deviceId);
+                peakBytes = (double)(freeAndTotal.second - freeAndTotal.first) * (1 << 20);
+            }
+            double activationBytes = (double)ActivationBytes(net);
+            double bytesPerColumn = activationBytes / layout->GetNumCols();
+            double fixedBytes = std::max(peakBytes - activationBytes, 0.0);
+            const double decay = 0.95;
+            m_bytesPerColumn = std::max(bytesPerColumn, decay * m_bytesPerColumn);
+            m_fixedBytes = std::max(fixedBytes, decay * m_fixedBytes);
+        }
+    };
+
     // ===================================================================
     // SubminibatchHelpers -- helper for sub-minibatch implementation
     // TODO: Can this just exist inside SGD.cpp?
@@ -527,6 +646,9 @@ namespace Microsoft { namespace MSR { namespace CNTK {
             }
         }
 
+        // their states are kept per sub-minibatch, so the number of sub-minibatches must not change between minibatches
+        bool HasStatefulNodes() const { return !m_netStatefulNodes.empty(); }
+
         void GetSubMinibatchToNet(size_t iSubminibatch)
         {
             Matrices decimatedMatrices;
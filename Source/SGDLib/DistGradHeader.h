@@ -52,6 +52,37 @@ public:
         return DistGradHeaderSize(numEvalNode);
     }
 
+    // Number of doubles in the packed form of the header, which is all-reduced as one contiguous buffer.
+    // The sample counts are exact in double up to 2^53.
+    size_t PackedSize() const
+    {
+        return 3 + 2 * (size_t) numEvalNode;
+    }
+
+    void Pack(double* buffer) const
+    {
+        buffer[0] = (double) numSamples;
+        buffer[1] = (double) numSamplesWithLabel;
+        buffer[2] = criterion;
+        for (int i = 0; i < numEvalNode; i++)
+        {
+            buffer[3 + 2 * i]     = evalErrors[i].first;
+            buffer[3 + 2 * i + 1] = (double) evalErrors[i].second;
+        }
+    }
+
+    void Unpack(const double* buffer)
+    {
+        numSamples          = (size_t) buffer[0];
+        numSamplesWithLabel = (size_t) buffer[1];
+        criterion           = buffer[2];
+        for (int i = 0; i < numEvalNode; i++)
+        {
+            evalErrors[i].first  = buffer[3 + 2 * i];
+            evalErrors[i].second = (size_t) buffer[3 + 2 * i + 1];
+        }
+    }
+
     void Clear()
     {
         numSamples = 0;
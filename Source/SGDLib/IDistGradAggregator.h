@@ -19,6 +19,18 @@ public:
     // Returns a boolean indicating if any samples were processed
     virtual bool AggregateGradients(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool resetState) = 0;
 
+    // Optional aggregation that overlaps with backprop. Called before backprop with the gradients that will be
+    // passed to AggregateGradients(), in the order in which backprop completes them. If this returns true, the
+    // caller invokes NotifyGradientReady() for each gradient as soon as it is final, and the aggregator may start
+    // reducing it right away; AggregateGradients() then completes the aggregation.
+    virtual bool BeginOverlappedAggregation(const std::vector<Matrix<ElemType>*>& /*gradientsInReadinessOrder*/)
+    {
+        return false;
+    }
+
+    virtual void NotifyGradientReady(const Matrix<ElemType>* /*gradient*/)
+    {}
+
     size_t NumProc()
     {
         return m_mpi->NumNodesInUse();
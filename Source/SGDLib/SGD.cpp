@@ -37,6 +37,7 @@
 #include "ProgressTracing.h"
 #include "PerformanceProfiler.h"
 
+#include <future>
 #include <map>
 #include <set>
 
@@ -285,6 +286,31 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
     auto preComputeNodesList = net->GetNodesRequiringPreComputation();
     additionalNodesToEvaluate.insert(additionalNodesToEvaluate.end(), preComputeNodesList.cbegin(), preComputeNodesList.cend());
 
+    // compute the ReLU after batch normalization in the same pass, see ComputationNetwork::FuseBatchNormalizationRelu()
+    if (m_fuseBatchNormalizationRelu)
+    {
+        std::vector<ComputationNodeBasePtr> keepNodes(criterionNodes.begin(), criterionNodes.end());
+        keepNodes.insert(keepNodes.end(), evaluationNodes.begin(), evaluationNodes.end());
+        keepNodes.insert(keepNodes.end(), additionalNodesToEvaluate.begin(), additionalNodesToEvaluate.end());
+        size_t numFused = net->FuseBatchNormalizationRelu(keepNodes);
+        if (m_traceLevel > 0 && numFused > 0)
+            LOGPRINTF(stderr, "Fused %d ReLU operations into batch normalization.\n", (int)numFused);
+    }
+
+    // split the network across GPUs before their memory is allocated
+    if (m_pipelineDevices.size() > 0)
+    {
+        if (m_mpi && m_mpi->NumNodesInUse() > 1)
+            InvalidArgument("pipelineDevices cannot be combined with parallel training across processes.");
+        std::vector<DEVICEID_TYPE> stageDevices;
+        for (size_t i = 0; i < m_pipelineDevices.size(); i++)
+            stageDevices.push_back((DEVICEID_TYPE)m_pipelineDevices[i]);
+        std::vector<ComputationNodeBasePtr> rootNodes(criterionNodes.begin(), criterionNodes.end());
+        rootNodes.insert(rootNodes.end(), evaluationNodes.begin(), evaluationNodes.end());
+        rootNodes.insert(rootNodes.end(), additionalNodesToEvaluate.begin(), additionalNodesToEvaluate.end());
+        net->PlacePipelineStages(stageDevices, rootNodes);
+    }
+
     // allocate memory for forward and backward computation
     net->AllocateAllMatrices(evaluationNodes, additionalNodesToEvaluate, criterionNodes[0]); // TODO: use criterionNodes.front() throughout
 
@@ -362,7 +388,7 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
             const size_t c_smoothed_gradients_factor = 3;
             shared_ptr<Matrix<float>> compoundMatrixPtr = std::make_shared<Matrix<float>>(numRows,
                 numCols * c_smoothed_gradients_factor,
-                net->GetDeviceId());
+                node->GetDeviceId());
             // Initialize float parameters
             auto parameterMatrix = compoundMatrixPtr->ColumnSlice(2 * numCols, numCols);
             parameterMatrix.CastAssignValuesOf(node->Value());
@@ -373,7 +399,7 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
         {
             smoothedGradientPtr = std::make_shared<Matrix<ElemType>>(numRows,
                 numCols,
-                net->GetDeviceId());
+                node->GetDeviceId()); // the device of the parameter, which may be a pipeline stage (see PlacePipelineStages())
         }
         smoothedGradients.push_back(smoothedGradientPtr);
         smoothedCounts.push_back(0);
@@ -515,7 +541,7 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                                                   m_seqGammarCalcAMF, m_seqGammarCalcLMF, m_seqGammarCalcWP, m_seqGammarCalcbMMIFactor, m_seqGammarCalcUsesMBR);
     }
 
-    // Multiverso Warpper for ASGD logic init
+    // parameter server for ASGD logic init
     if (m_parallelizationMethod == ParallelizationMethod::dataParallelASGD)
     {
         m_pASGDHelper.reset(NewASGDHelper<ElemType>(learnableNodes,
@@ -526,7 +552,11 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                                          m_adjustCoefficient,
                                          m_adjustPerMinibatches,
                                          m_traceLevel,
-                                         m_syncStatsTrace));
+                                         m_syncStatsTrace,
+                                         m_mpi,
+                                         m_asgdBackend,
+                                         m_asgdMaxStaleness,
+                                         m_asgdUseFp16Deltas));
         m_pASGDHelper->InitModel(learnableNodes);
     }
 
@@ -537,6 +567,74 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
         tensorBoardWriter = make_shared<::CNTK::Internal::TensorBoardFileWriter>(m_tensorBoardLogDir, net);
     }
 
+    vector<wstring> cvSetTrainAndEvalNodes;
+    if (criterionNodes.size() > 0)
+    {
+        cvSetTrainAndEvalNodes.push_back(criterionNodes[0]->NodeName());
+    }
+    for (let node : evaluationNodes)
+    {
+        cvSetTrainAndEvalNodes.push_back(node->NodeName());
+    }
+
+    auto reportCrossValidation = [&](int epoch, const vector<EpochCriterion>& vScore)
+    {
+        LOGPRINTF(stderr, "Finished Epoch[%2d of %d]: [Validate] ", epoch + 1, (int)m_maxEpochs);
+        for (size_t k = 0; k < vScore.size() /*&& k < 2*/; k++)
+            vScore[k].LogCriterion(cvSetTrainAndEvalNodes[k], /*addSemicolon=*/k + 1 < vScore.size());
+            //fprintf(stderr, "%s %ls = %.8f * %d", k ? ";" : "", cvSetTrainAndEvalNodes[k].c_str(), vScore[k].Average(), (int)vScore[k].second);
+        fprintf(stderr, "\n");
+
+        if (tensorBoardWriter)
+        {
+            for (size_t k = 0; k < vScore.size(); k++)
+            {
+                tensorBoardWriter->WriteValue(L"summary/test_" + cvSetTrainAndEvalNodes[k], (float)vScore[k].Average(), epoch + 1);
+            }
+
+            tensorBoardWriter->Flush();
+        }
+
+        if (m_saveBestModelPerCriterion)
+        {
+            // Loops through criteria (i.e. score) and updates the best one if smaller value is found.
+            UpdateBestEpochs(vScore, cvSetTrainAndEvalNodes, epoch, m_criteriaBestEpoch);
+        }
+    };
+
+    // With asyncCrossValidationDeviceId, the main node validates the saved model of each epoch on that device,
+    // while training goes on. The results are reported when the next epoch has finished, and cannot control the
+    // learning rate.
+    bool useAsyncCrossValidation = m_asyncCrossValidationDeviceId != DEVICEID_NOTYETDETERMINED &&
+                                   validationSetDataReader != trainSetDataReader && validationSetDataReader != nullptr;
+    std::future<vector<EpochCriterion>> asyncCrossValidation;
+    int asyncCrossValidationEpoch = -1;
+    auto startAsyncCrossValidation = [&](int epoch, const wstring& modelName)
+    {
+        if (!useAsyncCrossValidation || (m_mpi != nullptr && !m_mpi->IsMainNode()))
+            return;
+
+        size_t mbSize = m_mbSize[epoch];
+        asyncCrossValidationEpoch = epoch;
+        asyncCrossValidation = std::async(std::launch::async, [this, modelName, validationSetDataReader, &cvSetTrainAndEvalNodes, mbSize]()
+        {
+            auto cvNet = ComputationNetwork::CreateFromFile<ElemType>(m_asyncCrossValidationDeviceId, modelName);
+            SimpleEvaluator<ElemType> evalforvalidation(cvNet, nullptr);
+            return evalforvalidation.Evaluate(validationSetDataReader, cvSetTrainAndEvalNodes, mbSize);
+        });
+    };
+    auto finishAsyncCrossValidation = [&]()
+    {
+        if (asyncCrossValidation.valid())
+            reportCrossValidation(asyncCrossValidationEpoch, asyncCrossValidation.get());
+    };
+    if (useAsyncCrossValidation)
+        LOGPRINTF(stderr, "Cross-validation runs asynchronously on device %d; the learning rate is controlled by the training criterion.\n", (int)m_asyncCrossValidationDeviceId);
+
+    // normalize by the statistics of groups of workers, see BatchNormalizationNode::SetSyncGroupSize()
+    if (m_batchNormalizationSyncGroupSize != 1)
+        ComputationNetwork::SetBatchNormalizationSyncGroupSize<ElemType>(net, criterionNodes[0], m_batchNormalizationSyncGroupSize);
+
     // --- MAIN EPOCH LOOP
     for (int i = startEpoch; i < (int) m_maxEpochs; i++) // TODO: why is this an int, and not a size_t?
     {
@@ -729,44 +827,20 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
             tensorBoardWriter->Flush();
         }
 
-        if (validationSetDataReader != trainSetDataReader && validationSetDataReader != nullptr)
+        if (useAsyncCrossValidation)
         {
-            // TODO(dataASGD) making evaluator becoming nondistributed one when using ASGD, since Multiverso has another background thread using MPI.
+            // the previous epoch, which has had this epoch's training time to finish
+            finishAsyncCrossValidation();
+        }
+        else if (validationSetDataReader != trainSetDataReader && validationSetDataReader != nullptr)
+        {
+            // TODO(dataASGD) making evaluator becoming nondistributed one when using ASGD, since the parameter server has another background thread using MPI.
             //                Making the evaluation serial (non-distributed) will slowdown training especially when validation set is large.
             SimpleEvaluator<ElemType> evalforvalidation(net, UsingAsyncGradientAggregation(i + 1) ?nullptr : m_mpi, m_enableDistributedMBReading);
-            vector<wstring> cvSetTrainAndEvalNodes;
-            if (criterionNodes.size() > 0)
-            {
-                cvSetTrainAndEvalNodes.push_back(criterionNodes[0]->NodeName());
-            }
-            for (let node : evaluationNodes)
-            {
-                cvSetTrainAndEvalNodes.push_back(node->NodeName());
-            }
 
             // BUGBUG: We should not use the training MB size. The training MB size is constrained by both convergence and memory. Eval is only constrained by memory.
             let vScore = evalforvalidation.Evaluate(validationSetDataReader, cvSetTrainAndEvalNodes, UsingAsyncGradientAggregation(i + 1) ? m_mbSize[i] / m_mpi->NumNodesInUse() : m_mbSize[i]);
-            LOGPRINTF(stderr, "Finished Epoch[%2d of %d]: [Validate] ", i + 1, (int)m_maxEpochs);
-            for (size_t k = 0; k < vScore.size() /*&& k < 2*/; k++)
-                vScore[k].LogCriterion(cvSetTrainAndEvalNodes[k], /*addSemicolon=*/k + 1 < vScore.size());
-                //fprintf(stderr, "%s %ls = %.8f * %d", k ? ";" : "", cvSetTrainAndEvalNodes[k].c_str(), vScore[k].Average(), (int)vScore[k].second);
-            fprintf(stderr, "\n");
-
-            if (tensorBoardWriter)
-            {
-                for (size_t k = 0; k < vScore.size(); k++)
-                {
-                    tensorBoardWriter->WriteValue(L"summary/test_" + cvSetTrainAndEvalNodes[k], (float)vScore[k].Average(), i + 1);
-                }
-
-                tensorBoardWriter->Flush();
-            }
-
-            if (m_saveBestModelPerCriterion)
-            {
-                // Loops through criteria (i.e. score) and updates the best one if smaller value is found.
-                UpdateBestEpochs(vScore, cvSetTrainAndEvalNodes, i, m_criteriaBestEpoch);
-            }
+            reportCrossValidation(i, vScore);
 
             if (m_useCVSetControlLRIfCVExists)
             {
@@ -840,6 +914,7 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                         // the parallel training nodes from colliding to write the same file
                         if ((m_mpi == nullptr) || m_mpi->IsMainNode())
                             net->Save(GetModelNameForEpoch(i, true));
+                        startAsyncCrossValidation(i, GetModelNameForEpoch(i, true));
 
                         LOGPRINTF(stderr, "Finished training and saved final model\n\n");
                         break;
@@ -928,6 +1003,7 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                 if (m_traceLevel > 0)
                     LOGPRINTF(stderr, "SGD: Saving checkpoint model '%ls'\n", modelName.c_str());
                 net->Save(modelName);
+                startAsyncCrossValidation(i, modelName);
                 if (!m_keepCheckPointFiles)
                 {
                     // delete previous checkpoint file to save space
@@ -966,6 +1042,8 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
     }
     // --- END OF MAIN EPOCH LOOP
 
+    finishAsyncCrossValidation();
+
     // Check if we need to save best model per criterion and this is the main node as well.
     if (m_saveBestModelPerCriterion && ((m_mpi == nullptr) || m_mpi->IsMainNode()))
     {
@@ -1093,10 +1171,21 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
     DataReaderHelpers::SubminibatchDispatcher<ElemType> smbDispatcher;
     size_t numSubminibatchesNeeded = DataReaderHelpers::GetNumSubminibatchesNeeded<ElemType>(trainSetDataReader, m_maxSamplesInRAM, m_numSubminiBatches, tunedMBSize);
 
+    // without a user-specified split, it may be sized from the GPU memory
+    DataReaderHelpers::SubminibatchAutoSizer<ElemType> smbAutoSizer;
+    if (numSubminibatchesNeeded <= 1)
+        smbAutoSizer.Init(net, m_subminibatchMemoryFraction, m_traceLevel);
+
     // this is non-trivial, we need a manager object to handle this
-    if (numSubminibatchesNeeded > 1)
+    if (numSubminibatchesNeeded > 1 || smbAutoSizer.IsEnabled())
         smbDispatcher.Init(net, learnableNodes, criterionNodes, evaluationNodes);
 
+    if (smbAutoSizer.IsEnabled() && smbDispatcher.HasStatefulNodes())
+    {
+        fprintf(stderr, "WARNING: subminibatchMemoryFraction is ignored, since the network carries state across minibatches; use maxSamplesInRAM or numSubminibatches instead.\n");
+        smbAutoSizer.Init(net, 0, m_traceLevel);
+    }
+
     // The following is a special feature only supported by the Kaldi2Reader for more efficient sequence training.
     // This attempts to compute the error signal for the whole utterance, which will
     // be fed to the neural network as features. Currently it is a workaround
@@ -1116,6 +1205,9 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
 
             if (m_bufferedAsyncGradientAggregation)
                 fprintf(stderr, ", BufferedAsyncGradientAggregation is ENABLED");
+
+            if (m_overlapGradientAggregation)
+                fprintf(stderr, ", overlapped gradient aggregation is ENABLED");
         }
 
         if (useAsyncGradientAggregation)
@@ -1139,6 +1231,8 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
             else
                 fprintf(stderr, ", with %d subminibatch", (int)numSubminibatchesNeeded);
         }
+        else if (smbAutoSizer.IsEnabled())
+            fprintf(stderr, ", with subminibatches sized to %.0f%% of the GPU memory", 100 * m_subminibatchMemoryFraction);
         fprintf(stderr, ".\n");
     }
 
@@ -1265,7 +1359,8 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
 
             // We optionally break the minibatch into sub-minibatches.
             // This, when enabled, is used when a full minibatch does not fit into GPU RAM.
-            size_t actualNumSubminibatches = numSubminibatchesNeeded <= 1 ? 1 : smbDispatcher.GetMinibatchIntoCache(*trainSetDataReader, *net, *inputMatrices, numSubminibatchesNeeded);
+            size_t numSubminibatches = smbAutoSizer.IsEnabled() ? smbAutoSizer.NumSubminibatches(*net) : numSubminibatchesNeeded;
+            size_t actualNumSubminibatches = numSubminibatches <= 1 ? 1 : smbDispatcher.GetMinibatchIntoCache(*trainSetDataReader, *net, *inputMatrices, numSubminibatches);
             for (size_t ismb = 0; ismb < actualNumSubminibatches; ismb++)
             {
                 if (actualNumSubminibatches > 1)
@@ -1274,6 +1369,8 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
                     ComputationNetwork::BumpEvalTimeStamp(featureNodes);
                     ComputationNetwork::BumpEvalTimeStamp(labelNodes);
                 }
+                if (smbAutoSizer.IsEnabled())
+                    smbAutoSizer.BeginSubminibatch();
 
                 // ===========================================================
                 // forward prop for evaluate eval nodes
@@ -1288,7 +1385,16 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
                 // ===========================================================
 
                 if (learnRatePerSample > 0.01 * m_minLearnRate) // only compute gradient when learning rate is large enough
-                    net->Backprop(criterionNodes[0]);
+                {
+                    // gradients are final only after the last sub-minibatch, so only that one can overlap with their aggregation
+                    if (useGradientAggregation && m_overlapGradientAggregation && (ismb + 1 == actualNumSubminibatches))
+                        BackpropWithOverlappedAggregation(net, criterionNodes[0], learnableNodes, learnParamsGradients);
+                    else
+                        net->Backprop(criterionNodes[0]);
+                }
+
+                if (smbAutoSizer.IsEnabled())
+                    smbAutoSizer.EndSubminibatch(*net);
 
                 // house-keeping for sub-minibatching
                 if (actualNumSubminibatches > 1)
@@ -1335,28 +1441,7 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
         {
             // distributed gradient aggregation
             if (learnParamsGradients.size() == 0)
-            {
-                // lazily form the list of smoothedGradients to exchange
-                learnParamsGradients.reserve(learnableNodes.size());
-                for (auto nodeIter = learnableNodes.begin(); nodeIter != learnableNodes.end(); nodeIter++)
-                {
-                    ComputationNodePtr node = dynamic_pointer_cast<ComputationNode<ElemType>>(*nodeIter);
-                    if (node->IsParameterUpdateRequired())
-                    {
-                        Matrix<ElemType>* currParamsGradient = &(node->Gradient()); // TODO: we can use shared_ptrs now
-
-                        // Sometimes, in parallel training, the current node may not get any samples to process
-                        // In this case, the gradient matrix may not have been sized yet. If so, lets size it.
-                        if (currParamsGradient->GetNumCols() == 0)
-                        {
-                            Matrix<ElemType>* currParamsValues = &(node->Value());
-                            currParamsGradient->Resize(currParamsValues->GetNumRows(), currParamsValues->GetNumCols());
-                        }
-
-                        learnParamsGradients.push_back(currParamsGradient);
-                    }
-                }
-            }
+                FormGradientsToAggregate(learnableNodes, learnParamsGradients);
 
             // hoist the criterion into CPU space for all-reduce
             localEpochCriterion.Assign(0, numSamplesWithLabelOfNetwork);
@@ -1707,34 +1792,30 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
     // in case of model averaging, do one more final aggregation of criteria
     if (useModelAggregation && (m_mpi->NumNodesInUse() > 1))
     {
-        // 1. total epoch samples processed by all workers
-        size_t totalEpochSamplesOfAllWorkers = totalEpochSamples;
-        m_mpi->AllReduce(&totalEpochSamplesOfAllWorkers, 1);
-
         // get criteria for this worker
         assert(!useGradientAggregation); // (otherwise the data would not be in localEpochCriterion)
         epochCriterion = localEpochCriterion.GetCriterion(0);
         for (size_t i = 0; i < epochEvalErrors.size(); i++)
             epochEvalErrors[i] = localEpochEvalErrors.GetCriterion(i);
 
-        // all-reduce epochCriterion and epochEvalErrors over nodes
-        m_mpi->AllReduce(&epochCriterion.first,  1);
-        m_mpi->AllReduce(&epochCriterion.second, 1);
-        // to transfer the eval vectors, we must pull them apart into STL objects and exchange them separately
-        // TODO: merge with training criteria
-        vector<double> numer(epochEvalErrors.size());
-        vector<size_t> denom(epochEvalErrors.size());
-        for (size_t i = 0; i < epochEvalErrors.size(); i++)
+        // all-reduce the total epoch samples, epochCriterion and epochEvalErrors over nodes, packed into one buffer
+        // (the sample counts are exact in double up to 2^53)
+        vector<double> packed;
+        packed.reserve(3 + 2 * epochEvalErrors.size());
+        packed.push_back((double)totalEpochSamples);
+        packed.push_back(epochCriterion.first);
+        packed.push_back((double)epochCriterion.second);
+        for (const auto& evalError : epochEvalErrors)
         {
-            numer[i] = epochEvalErrors[i].first;
-            denom[i] = epochEvalErrors[i].second;
+            packed.push_back(evalError.first);
+            packed.push_back((double)evalError.second);
         }
-        m_mpi->AllReduce(numer);
-        m_mpi->AllReduce(denom);
-        for (size_t i = 0; i < epochEvalErrors.size(); i++)
-            epochEvalErrors[i] = EpochCriterion(numer[i], denom[i]);
+        m_mpi->AllReduce(packed);
 
-        totalEpochSamples = totalEpochSamplesOfAllWorkers;
+        totalEpochSamples = (size_t)packed[0];
+        epochCriterion = EpochCriterion(packed[1], (size_t)packed[2]);
+        for (size_t i = 0; i < epochEvalErrors.size(); i++)
+            epochEvalErrors[i] = EpochCriterion(packed[3 + 2 * i], (size_t)packed[3 + 2 * i + 1]);
     }
 
     if (useGradientAggregation && !evaluationNodesWhichAccumulateResult.empty())
@@ -1811,24 +1892,43 @@ bool SGD<ElemType>::PreCompute(ComputationNetworkPtr net,
     // compute
     ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::preComputing);
 
+    // initialize
+    for (auto & node : nodes)
+        dynamic_pointer_cast<IPreComputeNode>(node)->MarkComputed(false /*begin accumulating*/);
+
+    // The statistics may have been computed for the same data and nodes before.
+    wstring cacheKey = GetPreComputeCacheKey(nodes);
+    if (TryLoadPreComputeCache(nodes, cacheKey))
+    {
+        for (auto & node : nodes)
+            dynamic_pointer_cast<IPreComputeNode>(node)->MarkComputed(true /*done accumulating*/);
+
+        LOGPRINTF(stderr, "Precomputing --> Loaded from cache '%ls'.\n\n", m_preComputeCacheFile.c_str());
+        return true;
+    }
+
+    // With distributed reading every worker accumulates over its shard of the data, and the partial statistics
+    // are combined with one all-reduce; otherwise every worker reads all the data.
+    bool useDistributedMBReading = (m_mpi != nullptr) && (m_mpi->NumNodesInUse() > 1) &&
+                                   m_enableDistributedMBReading &&
+                                   trainSetDataReader->SupportsDistributedMBRead();
+
     // trainSetDataReader->StartMinibatchLoop(m_mbSize[0],  0 , requestDataSize);
     // trainSetDataReader->StartMinibatchLoop(m_mbSize[0],  0 , m_epochSize); // only based on one epoch
     // To support large dataset, we usually partition whole dataset into several epoch's,
     // so we need to use all the data to do precomputing
-    if (m_useAllDataForPreComputedNode) // using all the data
-        trainSetDataReader->StartMinibatchLoop(m_mbSize[0], 0, inputMatrices->GetStreamDescriptions());
-    else // using only one epoch. Note: One epoch is often enough for feature mean/stddev, but not for estimating priors.
-        trainSetDataReader->StartMinibatchLoop(m_mbSize[0], 0, inputMatrices->GetStreamDescriptions(), m_epochSize);
+    size_t requestedSamples = m_useAllDataForPreComputedNode ? requestDataSize // using all the data
+                                                             : m_epochSize;    // using only one epoch. Note: One epoch is often enough for feature mean/stddev, but not for estimating priors.
+    if (useDistributedMBReading)
+        trainSetDataReader->StartDistributedMinibatchLoop(m_mbSize[0], 0, m_mpi->CurrentNodeRank(), m_mpi->NumNodesInUse(), inputMatrices->GetStreamDescriptions(), requestedSamples);
+    else
+        trainSetDataReader->StartMinibatchLoop(m_mbSize[0], 0, inputMatrices->GetStreamDescriptions(), requestedSamples);
     net->StartEvaluateMinibatchLoop(nodes);
 
-    // initialize
-    for (auto & node : nodes)
-        dynamic_pointer_cast<IPreComputeNode>(node)->MarkComputed(false /*begin accumulating*/);
-
     const size_t numIterationsBeforePrintingProgress = 100;
     size_t numItersSinceLastPrintOfProgress = 0;
     size_t actualMBSizeDummy;
-    while (DataReaderHelpers::GetMinibatchIntoNetwork<ElemType>(*trainSetDataReader, net, nullptr, false, false, *inputMatrices, actualMBSizeDummy, m_mpi))
+    while (DataReaderHelpers::GetMinibatchIntoNetwork<ElemType>(*trainSetDataReader, net, nullptr, useDistributedMBReading, false, *inputMatrices, actualMBSizeDummy, m_mpi))
     {
         // TODO: move these into GetMinibatchIntoNetwork()  --but those are passed around; necessary? Can't we get them from 'net'?
         ComputationNetwork::BumpEvalTimeStamp(featureNodes);
@@ -1839,6 +1939,26 @@ bool SGD<ElemType>::PreCompute(ComputationNetworkPtr net,
         numItersSinceLastPrintOfProgress = ProgressTracing::TraceFakeProgress(numIterationsBeforePrintingProgress, numItersSinceLastPrintOfProgress);
     }
 
+    // All statistics are sums of per-sample terms, which all nodes pack into one buffer for a single all-reduce.
+    vector<double> sums;
+    if (useDistributedMBReading || !m_preComputeCacheFile.empty())
+    {
+        for (auto & node : nodes)
+            dynamic_pointer_cast<IPreComputeNode>(node)->GetAccumulatedSums(sums);
+    }
+
+    if (useDistributedMBReading)
+    {
+        m_mpi->AllReduce(sums);
+
+        const double* nodeSums = sums.data();
+        for (auto & node : nodes)
+            dynamic_pointer_cast<IPreComputeNode>(node)->SetAccumulatedSums(nodeSums);
+    }
+
+    if (!m_preComputeCacheFile.empty() && ((m_mpi == nullptr) || m_mpi->IsMainNode()))
+        SavePreComputeCache(cacheKey, sums);
+
     // finalize
     for (auto & node : nodes)
         dynamic_pointer_cast<IPreComputeNode>(node)->MarkComputed(true /*done accumulating*/);
@@ -1849,6 +1969,74 @@ bool SGD<ElemType>::PreCompute(ComputationNetworkPtr net,
     return true;
 }
 
+// The precompute cache is valid for the same nodes on the same inputs, and the same data as identified by
+// the preComputeCacheKey option and the reader configuration, where the caller knows it
+template <class ElemType>
+wstring SGD<ElemType>::GetPreComputeCacheKey(const std::list<ComputationNodeBasePtr>& nodes) const
+{
+    wstring key = m_preComputeCacheKey + L"\n" + m_preComputeDataKey + L"\n";
+    key += m_useAllDataForPreComputedNode ? L"all data\n" : msra::strfun::wstrprintf(L"%d samples\n", (int) m_epochSize);
+    for (const auto & node : nodes)
+    {
+        key += msra::strfun::wstrprintf(L"%ls = %ls(%ls) [%s]\n", node->NodeName().c_str(), node->OperationName().c_str(),
+                                        node->GetInputs()[0]->NodeName().c_str(), string(node->GetSampleLayout()).c_str());
+    }
+    return key;
+}
+
+// Sets the accumulators of the nodes from the cache, if there is one for 'key'.
+// All workers must find the same cache, otherwise they all compute.
+template <class ElemType>
+bool SGD<ElemType>::TryLoadPreComputeCache(const std::list<ComputationNodeBasePtr>& nodes, const wstring& key)
+{
+    if (m_preComputeCacheFile.empty())
+        return false;
+
+    vector<double> sums;
+    if (fexists(m_preComputeCacheFile))
+    {
+        File fstream(m_preComputeCacheFile, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead);
+        wstring cachedKey;
+        fstream.GetMarker(FileMarker::fileMarkerBeginSection, L"BPreComputeCache");
+        fstream >> cachedKey;
+        if (cachedKey == key)
+            fstream >> sums;
+        else
+            LOGPRINTF(stderr, "Precomputing --> Ignoring cache '%ls', which is for different data or nodes.\n", m_preComputeCacheFile.c_str());
+    }
+
+    int numWorkersWithCache = sums.empty() ? 0 : 1;
+    if (m_mpi != nullptr)
+        m_mpi->AllReduce(&numWorkersWithCache, 1);
+    if (numWorkersWithCache != ((m_mpi != nullptr) ? (int) m_mpi->NumNodesInUse() : 1))
+        return false;
+
+    const double* nodeSums = sums.data();
+    for (auto & node : nodes)
+        dynamic_pointer_cast<IPreComputeNode>(node)->SetAccumulatedSums(nodeSums);
+    if (nodeSums != sums.data() + sums.size())
+        RuntimeError("Precompute cache '%ls' does not match the nodes.", m_preComputeCacheFile.c_str());
+    return true;
+}
+
+template <class ElemType>
+void SGD<ElemType>::SavePreComputeCache(const wstring& key, const vector<double>& sums)
+{
+    // Saving into temporary file and then renaming it, to avoid a corrupted cache if the process dies during writing
+    wstring tempFileName = m_preComputeCacheFile + L".tmp";
+    {
+        File fstream(tempFileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsWrite);
+        fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BPreComputeCache");
+        fstream << key;
+        fstream << sums;
+        fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EPreComputeCache");
+        fstream.Flush();
+    }
+
+    _wunlink(m_preComputeCacheFile.c_str());
+    renameOrDie(tempFileName, m_preComputeCacheFile);
+}
+
 // return a reasonable initial learning rate based on the initial mbsize
 template <class ElemType>
 double SGD<ElemType>::SearchForBestLearnRate(ComputationNetworkPtr net,
@@ -2327,10 +2515,88 @@ std::shared_ptr<IDistGradAggregator<ElemType>> _GetAllReduceDistGradAggregator(c
         return std::make_shared<AllReduceDistGradAggregator<ElemType>>(mpi, nBits, zeroThresholdFor1Bit, true /*useQuantizationForSelfStripe*/, useAsyncAggregation, traceLevel, syncStatsTrace);
 }
 
+#ifdef CNTK_PARALLEL_TRAINING_SUPPORT
 template <>
 std::shared_ptr<IDistGradAggregator<half>> _GetAllReduceDistGradAggregator<half>(const MPIWrapperPtr& mpi, int nBits, bool zeroThresholdFor1Bit, bool useAsyncAggregation, int traceLevel, int syncStatsTrace)
 {
-    RuntimeError("SGD - half not supported for quantization!");
+    // the quantized communicator of the V2 aggregator only takes float and double
+    if (Globals::UseV2Aggregator())
+        RuntimeError("SGD - half not supported for quantization with the V2 aggregator!");
+
+    return std::make_shared<AllReduceDistGradAggregator<half>>(mpi, nBits, zeroThresholdFor1Bit, true /*useQuantizationForSelfStripe*/, useAsyncAggregation, traceLevel, syncStatsTrace);
+}
+#endif
+
+// lazily form the list of gradients to exchange
+template <class ElemType>
+void SGD<ElemType>::FormGradientsToAggregate(const std::list<ComputationNodeBasePtr>& learnableNodes, std::vector<Matrix<ElemType>*>& learnParamsGradients)
+{
+    learnParamsGradients.reserve(learnableNodes.size());
+    for (auto nodeIter = learnableNodes.begin(); nodeIter != learnableNodes.end(); nodeIter++)
+    {
+        ComputationNodePtr node = dynamic_pointer_cast<ComputationNode<ElemType>>(*nodeIter);
+        if (node->IsParameterUpdateRequired())
+        {
+            Matrix<ElemType>* currParamsGradient = &(node->Gradient()); // TODO: we can use shared_ptrs now
+
+            // Sometimes, in parallel training, the current node may not get any samples to process
+            // In this case, the gradient matrix may not have been sized yet. If so, lets size it.
+            if (currParamsGradient->GetNumCols() == 0)
+            {
+                Matrix<ElemType>* currParamsValues = &(node->Value());
+                currParamsGradient->Resize(currParamsValues->GetNumRows(), currParamsValues->GetNumCols());
+            }
+
+            learnParamsGradients.push_back(currParamsGradient);
+        }
+    }
+}
+
+// backprop, handing each parameter gradient to the aggregator as soon as backprop has completed it
+// See IDistGradAggregator::BeginOverlappedAggregation(). Falls back to plain backprop if the aggregator cannot overlap.
+template <class ElemType>
+void SGD<ElemType>::BackpropWithOverlappedAggregation(const ComputationNetworkPtr& net, const ComputationNodeBasePtr& criterionNode,
+                                                      const std::list<ComputationNodeBasePtr>& learnableNodes, std::vector<Matrix<ElemType>*>& learnParamsGradients)
+{
+    if (learnParamsGradients.size() == 0)
+        FormGradientsToAggregate(learnableNodes, learnParamsGradients);
+
+    std::unordered_map<const ComputationNodeBase*, Matrix<ElemType>*> gradientOfNode;
+    for (auto& node : learnableNodes)
+    {
+        if (node->IsParameterUpdateRequired())
+            gradientOfNode[node.get()] = &dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Gradient();
+    }
+
+    // Backprop visits the nodes in reverse evaluation order. Parameters that the criterion does not depend on
+    // are never visited; they go last.
+    std::vector<Matrix<ElemType>*> gradientsInReadinessOrder;
+    gradientsInReadinessOrder.reserve(learnParamsGradients.size());
+    const auto& evalOrder = net->GetEvalOrder(criterionNode);
+    for (auto nodeIter = evalOrder.rbegin(); nodeIter != evalOrder.rend(); nodeIter++)
+    {
+        auto gradient = gradientOfNode.find(nodeIter->get());
+        if (gradient != gradientOfNode.end())
+            gradientsInReadinessOrder.push_back(gradient->second);
+    }
+    for (auto gradient : learnParamsGradients)
+    {
+        if (std::find(gradientsInReadinessOrder.begin(), gradientsInReadinessOrder.end(), gradient) == gradientsInReadinessOrder.end())
+            gradientsInReadinessOrder.push_back(gradient);
+    }
+
+    if (!m_distGradAgg->BeginOverlappedAggregation(gradientsInReadinessOrder))
+    {
+        net->Backprop(criterionNode);
+        return;
+    }
+
+    net->Backprop(criterionNode, [&](const ComputationNodeBasePtr& node)
+    {
+        auto gradient = gradientOfNode.find(node.get());
+        if (gradient != gradientOfNode.end())
+            m_distGradAgg->NotifyGradientReady(gradient->second);
+    });
 }
 
 template <class ElemType>
@@ -2352,21 +2618,22 @@ void SGD<ElemType>::InitDistGradAgg(int numEvalNodes, int numGradientBits, int d
     {
         if (traceLevel > 0)
             fprintf(stderr, "Initializing dataParallelSGD with FP%d aggregation.\n", numGradientBits);
-        m_distGradAgg = GetSimpleDistGradAggregator<ElemType>(m_mpi, m_bufferedAsyncGradientAggregation, deviceId, m_syncStatsTrace, m_packThresholdSizeInBytes, m_useFP16AllReduce);
+        m_distGradAgg = GetSimpleDistGradAggregator<ElemType>(m_mpi, m_bufferedAsyncGradientAggregation, deviceId, m_syncStatsTrace, m_packThresholdSizeInBytes, m_useFP16AllReduce,
+                                                              m_overlapGradientAggregation ? m_gradientBucketSizeInBytes : 0, m_numBackupWorkers);
     }
 
     m_gradHeader.reset(DistGradHeader::Create(numEvalNodes), [](DistGradHeader* ptr) { DistGradHeader::Destroy(ptr); });
 }
 
 template <class ElemType>
-shared_ptr<IMASGD<ElemType>> _GetBlockMomentumSGD(const MPIWrapperPtr& mpi, size_t traceLevel, DEVICEID_TYPE devID, bool useNesterovBlockMomentum, bool resetSGDMomentum, double blockLearningRate, double blockMomentumAsTimeConstant, size_t modelAggregationBlockSize)
+shared_ptr<IMASGD<ElemType>> _GetBlockMomentumSGD(const MPIWrapperPtr& mpi, size_t traceLevel, DEVICEID_TYPE devID, bool useNesterovBlockMomentum, bool resetSGDMomentum, double blockLearningRate, double blockMomentumAsTimeConstant, size_t modelAggregationBlockSize, bool pipelineAggregation)
 {
     assert(!Globals::UseV2Aggregator());
-    return make_shared<BlockMomentumSGD<ElemType>>(mpi, traceLevel, devID, useNesterovBlockMomentum, resetSGDMomentum, blockLearningRate, blockMomentumAsTimeConstant, modelAggregationBlockSize);
+    return make_shared<BlockMomentumSGD<ElemType>>(mpi, traceLevel, devID, useNesterovBlockMomentum, resetSGDMomentum, blockLearningRate, blockMomentumAsTimeConstant, modelAggregationBlockSize, pipelineAggregation);
 }
 
 template <>
-shared_ptr<IMASGD<half>> _GetBlockMomentumSGD<half>(const MPIWrapperPtr& mpi, size_t traceLevel, DEVICEID_TYPE devID, bool useNesterovBlockMomentum, bool resetSGDMomentum, double blockLearningRate, double blockMomentumAsTimeConstant, size_t modelAggregationBlockSize)
+shared_ptr<IMASGD<half>> _GetBlockMomentumSGD<half>(const MPIWrapperPtr& mpi, size_t traceLevel, DEVICEID_TYPE devID, bool useNesterovBlockMomentum, bool resetSGDMomentum, double blockLearningRate, double blockMomentumAsTimeConstant, size_t modelAggregationBlockSize, bool pipelineAggregation)
 {
     assert(!Globals::UseV2Aggregator());
     RuntimeError("SGD - half not supported when useV2Aggregator is false!");
@@ -2418,7 +2685,7 @@ void SGD<ElemType>::InitModelAggregationHandler(int traceLevel, DEVICEID_TYPE de
             m_pMASGDHelper = _GetBlockMomentumSGD<ElemType>(m_mpi, traceLevel, devID,
                                                                  m_useNesterovBlockMomentum, m_resetSGDMomentum, 
                                                                  m_blockLearningRate, m_blockMomentumAsTimeConstant, 
-                                                                 m_modelAggregationBlockSize);
+                                                                 m_modelAggregationBlockSize, m_pipelineBlockMomentumAggregation);
 #endif 
     }
 }
@@ -2589,6 +2856,22 @@ void SGD<ElemType1>::ClipGradient(Matrix<ElemType>& gradient, const size_t actua
         double maxGradientPerMB = m_clippingThresholdPerSample * actualMBSize;
         if (m_gradientClippingWithTruncation)
             gradient.InplaceTruncate((ElemType)(maxGradientPerMB));
+        else if (gradient.GetDeviceId() != CPUDEVICE && gradient.GetMatrixType() == MatrixType::DENSE && maxGradientPerMB > 0)
+        {
+            // norm2 normalized with factor min(1, maxGradientPerMB / norm), computed on the device,
+            // so that the update can be queued without reading the norm back
+            auto factor = dynamic_pointer_cast<Matrix<ElemType>>(m_clippingFactor);
+            if (!factor || factor->GetDeviceId() != gradient.GetDeviceId())
+            {
+                factor = make_shared<Matrix<ElemType>>(1, 1, gradient.GetDeviceId());
+                m_clippingFactor = factor;
+            }
+            factor->AssignFrobeniusNormOf(gradient);
+            factor->InplaceTruncateBottom((ElemType) maxGradientPerMB);
+            factor->ElementInverse();
+            *factor *= (ElemType) maxGradientPerMB;
+            Matrix<ElemType>::Scale(*factor, gradient);
+        }
         else
         {
             // norm2 normalized
@@ -3028,7 +3311,6 @@ static LearningRateSearchAlgorithm ParseLearningRateSearchType(const wstring& s)
     else InvalidArgument("autoAdjustLR: Invalid learning rate search type. Valid values are (none | searchBeforeEpoch | adjustAfterEpoch)");
 }
   
-#ifdef ASGD_PARALLEL_SUPPORT
 static AdjustLearningRateAtBeginning AdjustLearningRateAtBeginningType(const wstring& s)
 {
     if      (EqualCI(s.c_str(), L"") || EqualCI(s.c_str(), L"none")) return AdjustLearningRateAtBeginning::None;
@@ -3036,7 +3318,13 @@ static AdjustLearningRateAtBeginning AdjustLearningRateAtBeginningType(const wst
     else if (EqualCI(s.c_str(), L"staircase"))                       return AdjustLearningRateAtBeginning::Staircase;
     else InvalidArgument("AdjustLearningRateatBeginningType: Invalid Type. Valid values are (None | Linearly | Staircase)");
 }
-#endif
+
+static ASGDBackend ParseASGDBackend(const wstring& s)
+{
+    if      (EqualCI(s.c_str(), L"") || EqualCI(s.c_str(), L"native")) return ASGDBackend::Native;
+    else if (EqualCI(s.c_str(), L"multiverso"))                        return ASGDBackend::Multiverso;
+    else InvalidArgument("ParseASGDBackend: Invalid ASGD backend. Valid values are (native | multiverso)");
+}
 
 template<class ConfigRecordType>
 SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
@@ -3069,6 +3357,7 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_loadBestModel = configAALR(L"loadBestModel", true);
     m_useCVSetControlLRIfCVExists = configAALR(L"UseCVSetControlLRIfCVExists", true);
     m_useEvalCriterionControlLR = configAALR(L"UseEvalCriterionControlLR", false);
+    m_asyncCrossValidationDeviceId = (DEVICEID_TYPE) configSGD(L"asyncCrossValidationDeviceId", (int) DEVICEID_NOTYETDETERMINED);
 
     // TODO: mbSize and truncated should be specified differently for truncated BPTT:
     //       mbSize = total number of samples after which a model update should happen
@@ -3077,6 +3366,8 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_truncated = configSGD(L"truncated", false);
     m_maxSamplesInRAM = configSGD(L"maxSamplesInRAM", (size_t) SIZE_MAX);
     m_numSubminiBatches = configSGD(L"numSubminibatches", (size_t) 1);
+    m_subminibatchMemoryFraction = configSGD(L"subminibatchMemoryFraction", 0.0);
+    m_pipelineDevices = configSGD(L"pipelineDevices", ConfigRecordType::Array(intargvector()));
 
     m_packThresholdSizeInBytes = configSGD(L"packThresholdSizeInKB", DEFAULT_PACK_THRESHOLD_SIZE_IN_KB) * 1024;
 
@@ -3152,6 +3443,8 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_dropoutRates = configSGD(L"dropoutRate", ConfigRecordType::Array(doubleargvector(vector<double>{0.0})));
     m_batchNormalizationTimeConstant = configSGD(L"batchNormalizationTimeConstant", ConfigRecordType::Array(doubleargvector(vector<double>{0})));
     m_batchNormalizationBlendTimeConstant = configSGD(L"batchNormalizationBlendTimeConstant", ConfigRecordType::Array(doubleargvector(vector<double>{0})));
+    m_batchNormalizationSyncGroupSize = configSGD(L"batchNormalizationSyncGroupSize", (size_t) 1);
+    m_fuseBatchNormalizationRelu = configSGD(L"fuseBatchNormalizationRelu", false);
 
     GradientsUpdateType gradUpdateType = ParseGradUpdateType(configSGD(L"gradUpdateType", L"None"));
     m_gradType.type = gradUpdateType;
@@ -3194,6 +3487,8 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     }
 
     m_useAllDataForPreComputedNode = configSGD(L"UseAllDataForPreComputedNode", true);
+    m_preComputeCacheFile = static_cast<std::wstring>(configSGD(L"preComputeCache", L""));
+    m_preComputeCacheKey = static_cast<std::wstring>(configSGD(L"preComputeCacheKey", L""));
 
     // consistency checks
     for (size_t i = 0; i < m_mbSize.size(); i++)
@@ -3296,6 +3591,9 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_numGradientBits = vector<int>{8 * (int)sizeofElemType}; // means no quantization
     m_zeroThresholdFor1Bit = true;
     m_bufferedAsyncGradientAggregation = false;
+    m_overlapGradientAggregation = false;
+    m_gradientBucketSizeInBytes = DEFAULT_GRADIENT_BUCKET_SIZE_IN_KB * 1024;
+    m_numBackupWorkers = 0;
     m_enableDistributedMBReading = false;
     m_parallelizationStartEpochNum = 0;
     m_modelAggregationBlockSize = 0; 
@@ -3325,8 +3623,6 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
             if (useV2Aggregator)
                 Globals::SetUseV2Aggregator();
             m_useFP16AllReduce = configParallelTrain(L"useFp16AllReduce", false);
-            if (m_useFP16AllReduce && !useV2Aggregator)
-                InvalidArgument("To set useFp16AllReduce to true, please also set useV2Aggregator to true!");
 
         if (configParallelTrain.Exists(L"DataParallelSGD"))
         {
@@ -3335,10 +3631,32 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
             m_numGradientBits = configDataParallelSGD(L"gradientBits", ConfigRecordType::Array(intargvector(vector<int>{defaultGradientBits})));
             m_zeroThresholdFor1Bit = configDataParallelSGD(L"useZeroThresholdFor1BitQuantization", true);
             m_bufferedAsyncGradientAggregation = configDataParallelSGD(L"useBufferedAsyncGradientAggregation", false);
+            m_overlapGradientAggregation = configDataParallelSGD(L"overlapGradientAggregation", false);
+            m_gradientBucketSizeInBytes = configDataParallelSGD(L"gradientBucketSizeInKB", DEFAULT_GRADIENT_BUCKET_SIZE_IN_KB) * 1024;
+            if (m_overlapGradientAggregation && m_bufferedAsyncGradientAggregation)
+                InvalidArgument("overlapGradientAggregation cannot be combined with useBufferedAsyncGradientAggregation.");
+            if (m_overlapGradientAggregation && m_gradientBucketSizeInBytes == 0)
+                InvalidArgument("gradientBucketSizeInKB must be greater than 0.");
+            m_numBackupWorkers = configDataParallelSGD(L"numBackupWorkers", (size_t)0);
+            if (m_numBackupWorkers > 0)
+            {
+                if (m_numBackupWorkers >= numMPIWorkers)
+                    InvalidArgument("numBackupWorkers must be less than the number of workers.");
+                if (m_overlapGradientAggregation || m_bufferedAsyncGradientAggregation || useV2Aggregator)
+                    InvalidArgument("numBackupWorkers cannot be combined with overlapGradientAggregation, useBufferedAsyncGradientAggregation or useV2Aggregator.");
+                for (size_t i = 0; i < m_numGradientBits.size(); i++)
+                {
+                    if (m_numGradientBits[i] != defaultGradientBits)
+                        InvalidArgument("numBackupWorkers cannot be combined with quantized gradients (gradientBits < %d).", defaultGradientBits);
+                }
+            }
             for (size_t i = 0; i < m_numGradientBits.size(); i++)
             {
                 if (m_numGradientBits[i] < 1 || m_numGradientBits[i] > defaultGradientBits)
                     InvalidArgument("gradientBits values must be in the range [1, 32] when using precision=float and in range [1, 64] when using precision=double.");
+                // the quantized values of a column are packed into words
+                if ((m_numGradientBits[i] & (m_numGradientBits[i] - 1)) != 0)
+                    InvalidArgument("gradientBits values must be a power of two, e.g. 1, 2, 4 or 8.");
             }
         }
         if (configParallelTrain.Exists(L"ModelAveragingSGD"))
@@ -3404,6 +3722,9 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
             m_resetSGDMomentum = configBMSGD(L"resetSGDMomentum", true);
             m_useNesterovBlockMomentum = configBMSGD(L"useNesterovMomentum", true);
             m_blockLearningRate = configBMSGD(L"blockLearningRate", 1.0); 
+            m_pipelineBlockMomentumAggregation = configBMSGD(L"pipelineModelAggregation", false);
+            if (m_pipelineBlockMomentumAggregation && Globals::UseV2Aggregator())
+                InvalidArgument("pipelineModelAggregation of BlockMomentumSGD is not supported with useV2Aggregator.");
 
             if (configBMSGD.Exists(L"blockMomentumPerSync") && configBMSGD.Exists(L"blockMomentumAsTimeConstant"))
             {
@@ -3430,10 +3751,14 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
 
         if (configParallelTrain.Exists(L"DataParallelASGD"))
         {
-#ifndef ASGD_PARALLEL_SUPPORT
-            InvalidArgument("DataParallelASGD is not enabled in this version.\n");
-#else
             const ConfigRecordType & configDataParallelASGD(configParallelTrain(L"DataParallelASGD", ConfigRecordType::Record()));
+            m_asgdBackend = ParseASGDBackend(configDataParallelASGD(L"backend", L"native"));
+#ifndef ASGD_PARALLEL_SUPPORT
+            if (m_asgdBackend == ASGDBackend::Multiverso)
+                InvalidArgument("DataParallelASGD with backend=multiverso is not enabled in this version.\n");
+#endif
+            m_asgdMaxStaleness = configDataParallelASGD(L"maxStaleness", (int)-1);  // native backend: bounded staleness, -1 for fully asynchronous
+            m_asgdUseFp16Deltas = configDataParallelASGD(L"useFp16Deltas", false);  // native backend: half precision model deltas
             m_nSyncSamplesPerWorker = configDataParallelASGD(L"syncPeriodPerWorker", ConfigRecordType::Array(intargvector(vector<int>{256})));
 #if 1       // legacy option
             if (configDataParallelASGD.Exists(L"syncPeriod"))
@@ -3453,7 +3778,6 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
                 m_adjustCoefficient = configAdjustLearningRateAtBeginning(L"adjustCoefficient", (double)0.1);
                 m_adjustPerMinibatches = configAdjustLearningRateAtBeginning(L"adjustPerMinibatches", (size_t)256);
             }
-#endif
         }
         } // if (!pMPI)
     } // if (configSGD.Exists(L"ParallelTrain"))
@@ -3495,6 +3819,7 @@ void SGDParams::InitializeAndCheckBlockMomentumSGDParameters()
     // don't need do anything here 
     m_blockMomentumAsTimeConstant = 0.0;
     m_blockLearningRate = 1.0;
+    m_pipelineBlockMomentumAggregation = false;
 #endif 
 }
 
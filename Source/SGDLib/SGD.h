@@ -217,6 +217,12 @@ protected:
     // default is 1, which means no subminibatch is used
     // if m_maxTempMemSizeInSamples = SIZE_MAX (which means users do not specify the option) and m_numSubminiBatches > 1
     // we divide one minibatch to m_numSubminiBatches subMinibatches
+    double m_subminibatchMemoryFraction;
+    // if neither of the above is specified and this is > 0, the sub-minibatches are sized automatically,
+    // so that forward-backward uses at most this fraction of the GPU memory (see SubminibatchAutoSizer)
+    intargvector m_pipelineDevices;
+    // if not empty, the network is split into stages that are placed on these GPUs, in order, see ComputationNetwork::PlacePipelineStages();
+    // the subminibatches above are the micro-batches of this pipeline
 
     // the number of samples in each epoch (0 means, use all the samples in each epoch).
     size_t m_epochSize;
@@ -250,6 +256,9 @@ protected:
     bool m_useCVSetControlLRIfCVExists;
     bool m_useEvalCriterionControlLR;
 
+    // device on which the cross-validation of each epoch runs in the background, DEVICEID_NOTYETDETERMINED to run it in line
+    DEVICEID_TYPE m_asyncCrossValidationDeviceId;
+
     double m_increaseLearnRateIfImproveMoreThan;
     double m_learnRateIncreaseFactor;
     double m_learnRateDecreaseFactor;
@@ -261,6 +270,8 @@ protected:
     doubleargvector m_dropoutRates;
     doubleargvector m_batchNormalizationTimeConstant;
     doubleargvector m_batchNormalizationBlendTimeConstant;
+    size_t m_batchNormalizationSyncGroupSize; // ranks that normalize by their joint statistics; 1 = each its own, 0 = all
+    bool m_fuseBatchNormalizationRelu;        // fuse a ReLU that follows batch normalization into it
     size_t m_maxTempMemSizeInSamplesForCNN;
 
     int m_traceLevel;
@@ -286,6 +297,11 @@ protected:
     bool m_doUnitTest;
 
     bool m_useAllDataForPreComputedNode;
+    // file the precomputed statistics are kept in to skip precomputation next time, if not empty
+    std::wstring m_preComputeCacheFile;
+    // identify the training data for the cache: specified by the user, and set by the caller (see GetPreComputeCacheKey())
+    std::wstring m_preComputeCacheKey;
+    std::wstring m_preComputeDataKey;
 
     // Parallel training
     MPIWrapperPtr m_mpi;
@@ -311,6 +327,11 @@ protected:
     intargvector m_numGradientBits;
     bool m_bufferedAsyncGradientAggregation;
     bool m_zeroThresholdFor1Bit;
+    // start aggregating gradients in buckets of this size while backprop is still running
+    bool m_overlapGradientAggregation;
+    size_t m_gradientBucketSizeInBytes;
+    // take the gradients of the first (numWorkers - m_numBackupWorkers) workers of every step, dropping the late ones
+    size_t m_numBackupWorkers;
 
     // Parallel training related with MA / BM
     size_t m_modelAggregationBlockSize;
@@ -318,6 +339,7 @@ protected:
     bool   m_useNesterovBlockMomentum;
     double m_blockLearningRate; 
     double m_blockMomentumAsTimeConstant;
+    bool   m_pipelineBlockMomentumAggregation; // all-reduce the block gradient while training the next block
 
     bool m_needAveMultiplier;
     double m_L2RegWeight;
@@ -330,6 +352,9 @@ protected:
     AdjustLearningRateAtBeginning m_adjustLearningRateAtBeginning;
     double m_adjustCoefficient;
     size_t m_adjustPerMinibatches;
+    ASGDBackend m_asgdBackend;
+    int m_asgdMaxStaleness;
+    bool m_asgdUseFp16Deltas;
 
     // sequence training
     double m_hSmoothingWeight;
@@ -402,6 +427,12 @@ public:
             m_parallelizationMethod = ParallelizationMethod::none;
         }
 
+    // identifies the training data, for the precompute cache (see GetPreComputeCacheKey())
+    void SetPreComputeDataKey(const std::wstring& key)
+    {
+        m_preComputeDataKey = key;
+    }
+
     void Train(shared_ptr<ComputationNetwork> net, DEVICEID_TYPE deviceId,
                IDataReader* trainSetDataReader,
                IDataReader* validationSetDataReader, int startEpoch, bool loadNetworkFromCheckpoint);
@@ -431,6 +462,10 @@ protected:
                     const std::vector<ComputationNodeBasePtr>& labelNodes,
                     StreamMinibatchInputs* inputMatrices);
 
+    std::wstring GetPreComputeCacheKey(const std::list<ComputationNodeBasePtr>& nodes) const;
+    bool TryLoadPreComputeCache(const std::list<ComputationNodeBasePtr>& nodes, const std::wstring& key);
+    void SavePreComputeCache(const std::wstring& key, const std::vector<double>& sums);
+
     // return a reasonable initial learning rate based on the initial mbsize
     double SearchForBestLearnRate(ComputationNetworkPtr net,
                                   ComputationNetworkPtr refNet,
@@ -534,6 +569,9 @@ protected:
                          const int startEpoch = 0);
 
     void InitDistGradAgg(int numEvalNodes, int numGradientBits, int deviceId, int traceLevel);
+    void FormGradientsToAggregate(const std::list<ComputationNodeBasePtr>& learnableNodes, std::vector<Matrix<ElemType>*>& learnParamsGradients);
+    void BackpropWithOverlappedAggregation(const ComputationNetworkPtr& net, const ComputationNodeBasePtr& criterionNode,
+                                           const std::list<ComputationNodeBasePtr>& learnableNodes, std::vector<Matrix<ElemType>*>& learnParamsGradients);
     void InitModelAggregationHandler(int traceLevel, DEVICEID_TYPE devID);
 private:
     // UpdateWeights() - actual weight update, implementing various update rules
@@ -627,6 +665,9 @@ protected:
 
     shared_ptr<IMASGD<ElemType>> m_pMASGDHelper;
 
+    // 1x1 scratch of ClipGradient(), which keeps the clipping factor of GPU gradients on the device
+    mutable MatrixBasePtr m_clippingFactor;
+
 private:
     void MarkDropoutNodesEvalTimeStampAsOutdated(const ComputationNetworkPtr& net, const ComputationNodeBasePtr& criterionNode);
     std::shared_ptr<ASGDHelper<ElemType>> m_pASGDHelper;
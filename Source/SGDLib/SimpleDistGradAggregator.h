@@ -25,15 +25,28 @@ class SimpleDistGradAggregator : public IDistGradAggregator<ElemType>
     UsingIDistGradAggregatorMembers;
 
 public:
-    SimpleDistGradAggregator(const MPIWrapperPtr& mpi, bool useAsyncAggregation, int deviceId, int syncStatsTrace, size_t packThresholdSizeInBytes = DEFAULT_PACK_THRESHOLD_SIZE_IN_BYTES)
+    SimpleDistGradAggregator(const MPIWrapperPtr& mpi, bool useAsyncAggregation, int deviceId, int syncStatsTrace, size_t packThresholdSizeInBytes = DEFAULT_PACK_THRESHOLD_SIZE_IN_BYTES,
+                             bool useFP16AllReduce = false, size_t overlappedBucketSizeInBytes = 0, size_t numBackupWorkers = 0)
         : IDistGradAggregator<ElemType>(mpi), m_useAsyncAggregation(useAsyncAggregation), m_initialized(false), m_bufferedGradHeader(nullptr), m_syncStatsTrace(syncStatsTrace),
-        m_iterationCount(0), m_packThresholdSizeInBytes(packThresholdSizeInBytes)
-    {}
+        m_iterationCount(0), m_packThresholdSizeInBytes(packThresholdSizeInBytes), m_useFP16AllReduce(useFP16AllReduce), m_overlappedBucketSizeInBytes(overlappedBucketSizeInBytes), m_numBucketsLaunched(0),
+        m_numBackupWorkers(numBackupWorkers), m_backupStep(0), m_backupSendRequest(MPI_REQUEST_NULL)
+    {
+        if ((m_numBackupWorkers > 0) && (m_numBackupWorkers >= NumProc()))
+            InvalidArgument("The number of backup workers (%d) must be less than the number of workers (%d).", (int) m_numBackupWorkers, (int) NumProc());
+        if ((m_numBackupWorkers > 0) && (m_useAsyncAggregation || (m_overlappedBucketSizeInBytes > 0)))
+            InvalidArgument("Backup workers cannot be combined with buffered async or overlapped gradient aggregation.");
+    }
 
     ~SimpleDistGradAggregator()
     {
-        for (size_t i = 0; i < m_recvHeaders.size(); ++i)
-            DistGradHeader::Destroy(m_recvHeaders[i]);
+        // Late contributions and results that were not waited for are still in flight; all workers send them, so they complete.
+        if (m_numBackupWorkers > 0)
+        {
+            m_mpi->Wait(&m_backupSendRequest, MPI_STATUSES_IGNORE);
+            m_mpi->Waitall((int) m_backupRecvRequests.size(), m_backupRecvRequests.data(), MPI_STATUSES_IGNORE);
+            for (auto& requests : m_backupResultRequests)
+                m_mpi->Waitall((int) requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+        }
 
         if (m_bufferedGradHeader != nullptr)
             DistGradHeader::Destroy(m_bufferedGradHeader);
@@ -46,13 +59,27 @@ public:
             return (headerCPU->numSamples != 0);
 
 
+        bool showSyncPerfStats = (m_syncStatsTrace > 0) && ((m_iterationCount % m_syncStatsTrace) == 0);
+        m_iterationCount++;
+
+        if (m_numBackupWorkers > 0)
+        {
+            AggregateGradientsWithBackupWorkers(gradients, headerCPU, showSyncPerfStats);
+            return (headerCPU->numSamples != 0);
+        }
+
         // Initialize NCCL
         if (m_nccl == nullptr)
             m_nccl.reset(new NcclComm(::CNTK::DeviceDescriptor::UseDefaultDevice().Id(), m_mpi));
 
+        // once overlapped aggregation has been set up, all minibatches go through the buckets
+        if (!m_buckets.empty())
+        {
+            AggregateGradientsOverlapped(gradients, headerCPU, showSyncPerfStats);
+            return (headerCPU->numSamples != 0);
+        }
+
         ResetState(gradients, headerCPU->numEvalNode, resetState);
-        bool showSyncPerfStats = (m_syncStatsTrace > 0) && ((m_iterationCount % m_syncStatsTrace) == 0);
-        m_iterationCount++;
 
         if (m_useAsyncAggregation)
         {
@@ -135,7 +162,63 @@ public:
         }
     }
 
+    // Gradients are grouped into buckets of about m_overlappedBucketSizeInBytes, in the order in which backprop
+    // completes them. A bucket is reduced as soon as all of its gradients are ready, while backprop continues.
+    bool BeginOverlappedAggregation(const std::vector<Matrix<ElemType>*>& gradientsInReadinessOrder) override
+    {
+        if ((m_overlappedBucketSizeInBytes == 0) || m_useAsyncAggregation || (m_mpi->NumNodesInUse() == 1) || gradientsInReadinessOrder.empty())
+            return false;
+
+        if (m_nccl == nullptr)
+            m_nccl.reset(new NcclComm(::CNTK::DeviceDescriptor::UseDefaultDevice().Id(), m_mpi));
+
+        // The reductions must not block the compute stream: use MPI_Iallreduce for CPU and NCCL for GPU gradients.
+        // Other configurations (e.g. GPU without NCCL, which stages gradients through host memory) are not overlapped.
+        int deviceId = gradientsInReadinessOrder[0]->GetDeviceId();
+        if ((deviceId == CPUDEVICE) ? (m_mpi->UseGpuGdr() != 0) : !m_nccl->IsSupported())
+            return false;
+
+        // sparse gradients are only aggregated after backprop, see AggregateSparseBlockColGradient()
+        for (auto gradient : gradientsInReadinessOrder)
+        {
+            if (gradient->GetMatrixType() != DENSE)
+                return false;
+        }
+
+        if (m_numBucketsLaunched != 0)
+            LogicError("BeginOverlappedAggregation: Previous aggregation has not been completed.");
+
+        if (gradientsInReadinessOrder != m_overlapGradients)
+            CreateBuckets(gradientsInReadinessOrder);
+
+        return true;
+    }
+
+    void NotifyGradientReady(const Matrix<ElemType>* gradient) override
+    {
+        auto bucketIndex = m_bucketOfGradient.find(gradient);
+        if (bucketIndex == m_bucketOfGradient.end())
+            LogicError("NotifyGradientReady: Gradient was not passed to BeginOverlappedAggregation().");
+
+        m_buckets[bucketIndex->second].m_numReady++;
+
+        // Buckets are started strictly in order, so that all workers issue the same sequence of collectives,
+        // even if backprop completes gradients in a slightly different order on some of them.
+        while ((m_numBucketsLaunched < m_buckets.size()) && (m_buckets[m_numBucketsLaunched].m_numReady >= m_buckets[m_numBucketsLaunched].m_gradients.size()))
+            LaunchBucket(m_buckets[m_numBucketsLaunched++]);
+    }
+
 private:
+    struct GradientBucket
+    {
+        std::vector<Matrix<ElemType>*> m_gradients;
+        size_t m_numElements = 0;
+        size_t m_numReady = 0;                      // number of m_gradients that backprop has completed
+        std::unique_ptr<Matrix<ElemType>> m_buffer; // contiguous copy of m_gradients, null if the bucket holds a single gradient
+        std::unique_ptr<Matrix<half>> m_halfBuffer; // contiguous half precision copy of m_gradients, if they are reduced in half precision
+        MPI_Request m_request;                      // pending MPI_Iallreduce of CPU gradients
+    };
+
     std::shared_ptr<ElemType> AllocateIntermediateBuffer(int deviceID, size_t numElements)
     {
         assert(deviceID >= 0);
@@ -148,6 +231,37 @@ private:
                                          });
     }
 
+    // Half precision reduction is done by NCCL, hence GPU float gradients only.
+    bool ShouldUseFP16AllReduce(int deviceId)
+    {
+        return m_useFP16AllReduce && std::is_same<ElemType, float>::value && (deviceId != CPUDEVICE) && m_nccl->IsSupported();
+    }
+
+    // Casts the gradients to half precision into consecutive ranges of 'buffer'. They are scaled by 1/NumProc() first,
+    // so that the sum over all workers does not overflow the half range where a single gradient does not.
+    void PackToHalf(const std::vector<Matrix<ElemType>*>& gradients, Matrix<half>& buffer)
+    {
+        size_t offset = 0;
+        for (auto gradient : gradients)
+        {
+            Matrix<ElemType>::Scale((ElemType) (1.0 / NumProc()), *gradient);
+            buffer.ColumnSlice(offset, gradient->GetNumElements()).CastAssignValuesOf(gradient->Reshaped(1, gradient->GetNumElements()));
+            offset += gradient->GetNumElements();
+        }
+    }
+
+    // Reverses PackToHalf() on the reduced buffer.
+    void UnpackFromHalf(const Matrix<half>& buffer, const std::vector<Matrix<ElemType>*>& gradients)
+    {
+        size_t offset = 0;
+        for (auto gradient : gradients)
+        {
+            gradient->Reshaped(1, gradient->GetNumElements()).CastAssignValuesOf(buffer.ColumnSlice(offset, gradient->GetNumElements()));
+            Matrix<ElemType>::Scale((ElemType) NumProc(), *gradient);
+            offset += gradient->GetNumElements();
+        }
+    }
+
     bool ShouldCopyDataToCPU(int deviceId)
     {
         // Do not copy if data is on CPU
@@ -178,6 +292,15 @@ private:
             size_t packedGradientsSizeInElements = 0;
             for (size_t i = 0; i < gradients.size(); i++)
             {
+                // Sparse gradients are exchanged by their non-zero columns, see AggregateSparseBlockColGradient()
+                if (gradients[i]->GetMatrixType() != DENSE)
+                {
+                    if ((gradients[i]->GetFormat() != matrixFormatSparseBlockCol) || m_useAsyncAggregation)
+                        RuntimeError("Gradient aggregation for sparse gradient matrices is only supported for the sparse block column format, and without buffered async aggregation!");
+                    m_sparseGradientIndex.push_back(i);
+                    continue;
+                }
+
                 if (!m_useAsyncAggregation && sizeof(ElemType) * gradients[i]->GetNumElements() <= m_packThresholdSizeInBytes)
                 {
                     packedGradientsSizeInElements += gradients[i]->GetNumElements();
@@ -188,10 +311,6 @@ private:
                     m_gradientIndexToAggregate.push_back(i);
                 }
 
-                // Make sure none of the gradient matrixes are sparse - we currently do not support aggregation of sparse gradient matrices
-                if (gradients[i]->GetMatrixType() != DENSE)
-                    RuntimeError("Gradient aggregation for sparse gradient matrices is currently unsupported!");
-
                 if (m_useAsyncAggregation)
                     m_bufferedGradients[gradients[i]].reset(new Matrix<ElemType>(gradients[i]->GetNumRows(), gradients[i]->GetNumCols(), deviceId));
             }
@@ -211,7 +330,8 @@ private:
                 // Reuse "@param m_gradientIndexToAggregate" for following code, if no continous buffer allocated
                 for (size_t i = 0; i < gradients.size(); i++)
                 {
-                    m_gradientIndexToAggregate.push_back(i);
+                    if (gradients[i]->GetMatrixType() == DENSE)
+                        m_gradientIndexToAggregate.push_back(i);
                 }
             }
             else
@@ -235,12 +355,6 @@ private:
                 m_bufferedGradHeader = DistGradHeader::Create(numEvalNodes);
                 m_bufferedGradHeader->Clear();
             }
-
-            if (m_mpi->IsMainNode())
-            {
-                for (size_t i = 0; i < NumProc() - 1; ++i)
-                    m_recvHeaders.push_back(DistGradHeader::Create(numEvalNodes));
-            }
         }
         else if (resetState)
         {
@@ -259,6 +373,21 @@ private:
         }
     }
 
+    // The header is all-reduced as one packed buffer with a single non-blocking call; it is started before the
+    // gradients are aggregated and only waited for when they are done.
+    void StartHeaderAggregation(DistGradHeader* headerCPU)
+    {
+        m_packedHeader.resize(headerCPU->PackedSize());
+        headerCPU->Pack(m_packedHeader.data());
+        m_mpi->Iallreduce(MPI_IN_PLACE, m_packedHeader.data(), (int) m_packedHeader.size(), MPI_DOUBLE, MPI_SUM, &m_headerRequest) || MpiFail("MPI_Iallreduce");
+    }
+
+    void CompleteHeaderAggregation(DistGradHeader* headerCPU)
+    {
+        m_mpi->Wait(&m_headerRequest, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+        headerCPU->Unpack(m_packedHeader.data());
+    }
+
     void AggregateGradientsImpl(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool showSyncPerfStats)
     {
         Timer aggregationTimer;
@@ -298,27 +427,11 @@ private:
             offset += gradients[i]->GetNumElements();
         }
 
-        // Initiate receive of the header on the main node
-        std::vector<MPI_Request> recvHeaderRequests(NumProc() - 1);
-        if (m_mpi->IsMainNode())
-        {
-            for (size_t j = 0; j < NumProc() - 1; ++j)
-            {
-                int source = (j >= MyRank()) ? (j + 1) : j;
-                // We use a tag of 'numGradMatrices' for the pre-aggregation header
-                m_mpi->Irecv(m_recvHeaders[j], m_recvHeaders[j]->Size(), MPI_CHAR, source, numGradMatrices, &(recvHeaderRequests[j])) || MpiFail("MPI_Irecv");
-            }
-        }
-
-        // Send the headers from all nodes but the main node
-        MPI_Request sendHeaderRequest;
-        if (!m_mpi->IsMainNode())
-            m_mpi->Isend(headerCPU, headerCPU->Size(), MPI_CHAR, m_mpi->MainNodeRank(), numGradMatrices, &sendHeaderRequest) || MpiFail("MPI_Isend");
+        StartHeaderAggregation(headerCPU);
 
 
         // New aggregation pipeline for non-GDR, perform sync allreduce on the gradient data
-        // For CPU, still use async allreduce
-        std::vector<MPI_Request> allReduceRequests;
+        std::vector<Matrix<ElemType>*> halfReducedGradients;
         size_t gpuToCpuIndex = 0;
         size_t cpuToGpuIndex = 0;
         size_t allReduceIndex = 0;
@@ -392,17 +505,9 @@ private:
                 ElemType* reductionBuffer;
                 for (size_t i : m_gradientIndexToAggregate)
                 {
-                    allReduceRequests.push_back(MPI_Request());
                     reductionBuffer = (i == -1)? m_aggregationBuffer->Data() : gradients[i]->Data();
-                    // CPU
-                    if (m_mpi->UseGpuGdr() == 0)
-                    {
-                        m_mpi->Iallreduce(MPI_IN_PLACE, reductionBuffer, (i == -1) ? m_aggregationBuffer->GetNumElements() : gradients[i]->GetNumElements(),
-                            MPIWrapper::GetDataType(reductionBuffer), MPI_SUM, &allReduceRequests.back()) || MpiFail("MPI_Iallreduce");
-                        allReduceIndex++;
-                    }
-                    // GDR && GPU
-                    else if (deviceId != CPUDEVICE)
+                    // CPU (sync as well, so that MPIWrapper may use its native all-reduce), or GDR && GPU
+                    if ((m_mpi->UseGpuGdr() == 0) || (deviceId != CPUDEVICE))
                     {
                         m_mpi->AllReduce(reductionBuffer, (i == -1) ? m_aggregationBuffer->GetNumElements() : gradients[i]->GetNumElements());
                     }
@@ -411,41 +516,31 @@ private:
             else if (m_nccl->IsSupported())
             {
                 std::vector<Matrix<ElemType>*> ncclReduceGradients;
+                size_t numElements = 0;
                 for (size_t i : m_gradientIndexToAggregate)
                 {
                     ncclReduceGradients.push_back((i == -1) ? m_aggregationBuffer.get() : gradients[i]);
+                    numElements += ncclReduceGradients.back()->GetNumElements();
                 }
-                m_nccl->AllReduce(ncclReduceGradients);
-            }
-        }
-
-        // On the main node wait for the headers to arrive and aggregate
-        if (m_mpi->IsMainNode())
-        {
-            size_t numNodesHeadersReceivedFrom = 0;
-            while (numNodesHeadersReceivedFrom < (NumProc() - 1))
-            {
-                int idx = MPI_UNDEFINED;
-                m_mpi->Waitany(recvHeaderRequests.size(), recvHeaderRequests.data(), &idx, MPI_STATUS_IGNORE) || MpiFail("MPI_Waitany");
-                if (idx == MPI_UNDEFINED)
+                if (ShouldUseFP16AllReduce(deviceId))
                 {
-                    break;
+                    // All gradients go through a single half precision buffer, which halves the volume and needs one reduction
+                    if (!m_halfAggregationBuffer || m_halfAggregationBuffer->GetNumElements() != numElements)
+                        m_halfAggregationBuffer.reset(new Matrix<half>(1, numElements, deviceId));
+                    PackToHalf(ncclReduceGradients, *m_halfAggregationBuffer);
+                    m_nccl->AllReduce(m_halfAggregationBuffer->Data(), m_halfAggregationBuffer->Data(), numElements);
+                    halfReducedGradients = ncclReduceGradients;
                 }
-
-                numNodesHeadersReceivedFrom++;
-
-                headerCPU->Aggregate(m_recvHeaders[idx], true);
+                else
+                    m_nccl->AllReduce(ncclReduceGradients);
             }
-
-            assert(numNodesHeadersReceivedFrom == (NumProc() - 1));
         }
 
-        // Broadcast the aggregated header to all nodes
-        m_mpi->Bcast(headerCPU, headerCPU->Size(), MPI_CHAR, m_mpi->MainNodeRank());
-
         if (m_nccl->IsSupported())
         {
             m_nccl->Sync();
+            if (!halfReducedGradients.empty())
+                UnpackFromHalf(*m_halfAggregationBuffer, halfReducedGradients);
         }
         // Non-GDR && GPU
         else if ((m_mpi->UseGpuGdr() == 0) && (deviceId != CPUDEVICE))
@@ -454,15 +549,6 @@ private:
             for (size_t i = 0; i < allReduceIndex; i++)
                 m_gpuDataTransferers[i]->WaitForCopyCPUToGPUAsync();
         }
-        // CPU
-        else if (m_mpi->UseGpuGdr() == 0)
-        {
-            // Wait for the Iallreduce operations to finish
-            for (size_t i = 0; i < allReduceIndex; i++)
-            {
-                m_mpi->Wait(&allReduceRequests[i], MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
-            }
-        }
 
         // Copy data back to the packed gradients from the continous buffer
         offset = 0;
@@ -472,9 +558,10 @@ private:
             offset += gradients[i]->GetNumElements();
         }
 
-        // Wait for completion of the async send requests
-        if (!m_mpi->IsMainNode())
-            m_mpi->Wait(&sendHeaderRequest, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+        for (size_t i : m_sparseGradientIndex)
+            AggregateSparseBlockColGradient(*gradients[i]);
+
+        CompleteHeaderAggregation(headerCPU);
 
         if (showSyncPerfStats)
         {
@@ -484,13 +571,388 @@ private:
         }
     }
 
+    // A SparseBlockCol gradient, e.g. of an embedding, holds only the columns of the words of the minibatch. All workers
+    // gather the (column index, column) pairs of all others, and the columns of equal index are then added up by
+    // ScatterToIndices(), which sorts them by index and reduces each run of equal ones on the GPU. The columns of every
+    // index are added in the order of the ranks, so all workers end up with the same sum.
+    // Once the columns of all workers together are as many as those of the gradient, this would exchange more than
+    // an all-reduce, so the gradient is then densified and all-reduced. All workers know all the numbers of columns,
+    // so they all take the same choice.
+    void AggregateSparseBlockColGradient(Matrix<ElemType>& gradient)
+    {
+        if (gradient.GetMatrixType() == DENSE) // the gradient of a product with a dense input is dense again, which is rare
+            return AllReduceDense(gradient);
+
+        std::vector<size_t> blockIds;
+        std::vector<ElemType> values;
+        gradient.GetMatrixFromSBCFormat(blockIds, values);
+
+        const size_t numRows = gradient.GetNumRows();
+        const size_t numCols = gradient.GetNumCols();
+        const int deviceId = gradient.GetDeviceId();
+        size_t numBlocks = blockIds.size();
+        std::vector<size_t> numBlocksOfRanks(NumProc());
+        m_mpi->AllGather(&numBlocks, 1, numBlocksOfRanks.data(), 1);
+        size_t numGatheredBlocks = 0;
+        for (auto n : numBlocksOfRanks)
+            numGatheredBlocks += n;
+
+        if (numGatheredBlocks == 0)
+            return;
+
+        std::unique_ptr<Matrix<ElemType>> columns;
+        std::vector<ElemType> columnIndices;
+        if (numGatheredBlocks < numCols)
+        {
+            std::vector<int> blockCounts(NumProc()), blockOffsets(NumProc()), valueCounts(NumProc()), valueOffsets(NumProc());
+            for (size_t rank = 0, offset = 0; rank < NumProc(); offset += numBlocksOfRanks[rank], rank++)
+            {
+                blockCounts[rank] = (int) numBlocksOfRanks[rank];
+                blockOffsets[rank] = (int) offset;
+                valueCounts[rank] = (int) (numBlocksOfRanks[rank] * numRows);
+                valueOffsets[rank] = (int) (offset * numRows);
+            }
+
+            std::vector<size_t> gatheredBlockIds(numGatheredBlocks);
+            std::vector<ElemType> gatheredValues(numGatheredBlocks * numRows);
+            m_mpi->Allgatherv(blockIds.data(), (int) numBlocks, MPIWrapper::GetDataType(blockIds.data()),
+                              gatheredBlockIds.data(), blockCounts.data(), blockOffsets.data(), MPIWrapper::GetDataType(gatheredBlockIds.data()));
+            m_mpi->Allgatherv(values.data(), (int) values.size(), MPIWrapper::GetDataType(values.data()),
+                              gatheredValues.data(), valueCounts.data(), valueOffsets.data(), MPIWrapper::GetDataType(gatheredValues.data()));
+
+            columns.reset(new Matrix<ElemType>(numRows, numGatheredBlocks, gatheredValues.data(), deviceId));
+            columnIndices.assign(gatheredBlockIds.begin(), gatheredBlockIds.end());
+        }
+        else
+        {
+            columns.reset(new Matrix<ElemType>(numRows, numCols, deviceId));
+            columns->AssignValuesOf(gradient);
+            AllReduceDense(*columns);
+            columnIndices.resize(numCols);
+            for (size_t j = 0; j < numCols; j++)
+                columnIndices[j] = (ElemType) j;
+        }
+
+        Matrix<ElemType> indices(1, columnIndices.size(), columnIndices.data(), deviceId);
+        gradient.SetValue(0);
+        gradient.ScatterToIndices(*columns, indices, numRows);
+    }
+
+    // all-reduces a single dense matrix in place, e.g. a sparse gradient that is too dense for the all-gather
+    void AllReduceDense(Matrix<ElemType>& data)
+    {
+        if (data.GetDeviceId() == CPUDEVICE || m_mpi->UseGpuGdr())
+            m_mpi->AllReduce(data.Data(), data.GetNumElements());
+        else if (m_nccl->IsSupported())
+        {
+            m_nccl->AllReduce(data.Data(), data.Data(), data.GetNumElements());
+            m_nccl->Sync();
+        }
+        else
+        {
+            std::unique_ptr<ElemType[]> buffer(data.CopyToArray());
+            m_mpi->AllReduce(buffer.get(), data.GetNumElements());
+            data.SetValue(data.GetNumRows(), data.GetNumCols(), data.GetDeviceId(), buffer.get());
+        }
+    }
+
+    // Synchronous aggregation with backup workers: the main node takes the contributions of the first
+    // NumProc() - m_numBackupWorkers workers of a step, including its own, and drops the late ones. The sum and its header,
+    // whose sample counts cover only the contributors, are sent to all workers, so that all of them apply the same update and
+    // stay in sync; a late worker simply finds the result of the step waiting when it is done.
+    // A contribution is [step, packed header, gradients], the result has the same layout.
+    // The main node keeps the results of the last two steps in flight, so a worker can be late by up to a step without
+    // ever stalling the others.
+    void AggregateGradientsWithBackupWorkers(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool showSyncPerfStats)
+    {
+        Timer aggregationTimer;
+        if (showSyncPerfStats)
+            aggregationTimer.Start();
+
+        // If the current node did not process any samples, the gradients should be zero'd
+        if (headerCPU->numSamples == 0)
+        {
+            for (auto gradient : gradients)
+                gradient->SetValue(0);
+        }
+
+        size_t numElements = 0;
+        for (auto gradient : gradients)
+        {
+            // Make sure none of the gradient matrixes are sparse - we currently do not support aggregation of sparse gradient matrices
+            if (gradient->GetMatrixType() != DENSE)
+                RuntimeError("Gradient aggregation for sparse gradient matrices is currently unsupported!");
+            numElements += gradient->GetNumElements();
+        }
+
+        const size_t numHeaderElements = 1 + headerCPU->PackedSize();
+        const size_t messageSize = numHeaderElements * sizeof(double) + numElements * sizeof(ElemType);
+        const double step = (double) ++m_backupStep;
+        const int mainNode = (int) m_mpi->MainNodeRank();
+        size_t numDropped = 0;
+
+        if (!m_mpi->IsMainNode())
+        {
+            m_mpi->Wait(&m_backupSendRequest, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+            m_backupSendBuffer.resize(messageSize);
+            PackContribution(gradients, headerCPU, step, m_backupSendBuffer.data());
+            m_mpi->Isend(m_backupSendBuffer.data(), (int) messageSize, MPI_CHAR, mainNode, s_backupGradientTag, &m_backupSendRequest) || MpiFail("MPI_Isend");
+
+            auto& result = m_backupResults[0];
+            result.resize(messageSize);
+            m_mpi->Recv(result.data(), (int) messageSize, MPI_CHAR, mainNode, s_backupResultTag, MPI_STATUSES_IGNORE) || MpiFail("MPI_Recv");
+            if (((const double*) result.data())[0] != step)
+                LogicError("AggregateGradientsWithBackupWorkers: Received the result of step %d in step %d.", (int) ((const double*) result.data())[0], (int) step);
+            UnpackContribution(result.data(), gradients, headerCPU);
+        }
+        else
+        {
+            // The result of this step reuses the buffer of the one two steps ago, once it has been sent.
+            size_t slot = m_backupStep % 2;
+            auto& result = m_backupResults[slot];
+            auto& resultRequests = m_backupResultRequests[slot];
+            resultRequests.resize(NumProc(), MPI_REQUEST_NULL);
+            m_mpi->Waitall((int) resultRequests.size(), resultRequests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+
+            // The sum starts with the contribution of the main node.
+            result.resize(messageSize);
+            PackContribution(gradients, headerCPU, step, result.data());
+            double* resultHeader = (double*) result.data();
+            ElemType* resultGradients = (ElemType*) (resultHeader + numHeaderElements);
+
+            // Only workers whose previous contribution arrived need a new receive; the others have their late one still pending.
+            m_backupRecvBuffers.resize(NumProc());
+            m_backupRecvRequests.resize(NumProc(), MPI_REQUEST_NULL);
+            for (int rank = 0; rank < (int) NumProc(); rank++)
+            {
+                if ((rank != mainNode) && (m_backupRecvRequests[rank] == MPI_REQUEST_NULL))
+                    PostBackupReceive(rank, messageSize);
+            }
+
+            size_t numContributions = 1;
+            while (numContributions < NumProc() - m_numBackupWorkers)
+            {
+                int rank;
+                MPI_Status status;
+                m_mpi->Waitany((int) NumProc(), m_backupRecvRequests.data(), &rank, &status) || MpiFail("MPI_Waitany");
+
+                const double* header = (const double*) m_backupRecvBuffers[rank].data();
+                if (header[0] != step)
+                {
+                    // Dropped contribution of an earlier step; the worker's contribution to this step is next.
+                    PostBackupReceive(rank, messageSize);
+                    continue;
+                }
+
+                const ElemType* contribution = (const ElemType*) (header + numHeaderElements);
+                for (size_t i = 1; i < numHeaderElements; i++)
+                    resultHeader[i] += header[i];
+                for (size_t i = 0; i < numElements; i++)
+                    resultGradients[i] += contribution[i];
+                numContributions++;
+            }
+
+            // The contributions of this step still pending are late.
+            for (int rank = 0; rank < (int) NumProc(); rank++)
+                numDropped += (m_backupRecvRequests[rank] != MPI_REQUEST_NULL);
+
+            for (int rank = 0; rank < (int) NumProc(); rank++)
+            {
+                if (rank != mainNode)
+                    m_mpi->Isend(result.data(), (int) messageSize, MPI_CHAR, rank, s_backupResultTag, &resultRequests[rank]) || MpiFail("MPI_Isend");
+            }
+
+            UnpackContribution(result.data(), gradients, headerCPU);
+        }
+
+        if (showSyncPerfStats)
+        {
+            aggregationTimer.Stop();
+            double gradientAggregationTime = aggregationTimer.ElapsedSeconds();
+            if (m_mpi->IsMainNode())
+                fprintf(stderr, "Actual gradient aggregation time: %.6g, dropped %d late contributions\n", gradientAggregationTime, (int) numDropped);
+            else
+                fprintf(stderr, "Actual gradient aggregation time: %.6g\n", gradientAggregationTime);
+        }
+    }
+
+    void PostBackupReceive(int rank, size_t messageSize)
+    {
+        m_backupRecvBuffers[rank].resize(messageSize);
+        m_mpi->Irecv(m_backupRecvBuffers[rank].data(), (int) messageSize, MPI_CHAR, rank, s_backupGradientTag, &m_backupRecvRequests[rank]) || MpiFail("MPI_Irecv");
+    }
+
+    void PackContribution(const std::vector<Matrix<ElemType>*>& gradients, const DistGradHeader* headerCPU, double step, char* buffer)
+    {
+        double* header = (double*) buffer;
+        header[0] = step;
+        headerCPU->Pack(header + 1);
+
+        ElemType* data = (ElemType*) (header + 1 + headerCPU->PackedSize());
+        for (auto gradient : gradients)
+        {
+            gradient->CopySection(gradient->GetNumRows(), gradient->GetNumCols(), data, gradient->GetNumRows());
+            data += gradient->GetNumElements();
+        }
+    }
+
+    void UnpackContribution(char* buffer, const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU)
+    {
+        const double* header = (const double*) buffer;
+        headerCPU->Unpack(header + 1);
+
+        ElemType* data = (ElemType*) (header + 1 + headerCPU->PackedSize());
+        for (auto gradient : gradients)
+        {
+            gradient->SetValue(gradient->GetNumRows(), gradient->GetNumCols(), gradient->GetDeviceId(), data);
+            data += gradient->GetNumElements();
+        }
+    }
+
+    void CreateBuckets(const std::vector<Matrix<ElemType>*>& gradientsInReadinessOrder)
+    {
+        m_overlapGradients = gradientsInReadinessOrder;
+        m_buckets.clear();
+        m_bucketOfGradient.clear();
+
+        size_t bucketSizeInBytes = 0;
+        for (auto gradient : gradientsInReadinessOrder)
+        {
+            // Make sure none of the gradient matrixes are sparse - we currently do not support aggregation of sparse gradient matrices
+            if (gradient->GetMatrixType() != DENSE)
+                RuntimeError("Gradient aggregation for sparse gradient matrices is currently unsupported!");
+
+            if (m_buckets.empty() || (bucketSizeInBytes >= m_overlappedBucketSizeInBytes))
+            {
+                m_buckets.push_back(GradientBucket());
+                bucketSizeInBytes = 0;
+            }
+
+            m_buckets.back().m_gradients.push_back(gradient);
+            m_buckets.back().m_numElements += gradient->GetNumElements();
+            m_bucketOfGradient[gradient] = m_buckets.size() - 1;
+            bucketSizeInBytes += sizeof(ElemType) * gradient->GetNumElements();
+        }
+
+        // a bucket of a single gradient is reduced in place, unless in half precision
+        int deviceId = gradientsInReadinessOrder[0]->GetDeviceId();
+        bool useFP16AllReduce = ShouldUseFP16AllReduce(deviceId);
+        for (auto& bucket : m_buckets)
+        {
+            if (useFP16AllReduce)
+                bucket.m_halfBuffer.reset(new Matrix<half>(1, bucket.m_numElements, deviceId));
+            else if (bucket.m_gradients.size() > 1)
+                bucket.m_buffer.reset(new Matrix<ElemType>(1, bucket.m_numElements, deviceId));
+        }
+
+        fprintf(stderr, "Overlapped gradient aggregation: %d gradients in %d buckets%s.\n", (int) m_overlapGradients.size(), (int) m_buckets.size(),
+                useFP16AllReduce ? ", reduced in half precision" : "");
+    }
+
+    void LaunchBucket(GradientBucket& bucket)
+    {
+        if (bucket.m_halfBuffer)
+        {
+            // The casts are queued on the compute stream, which the reduction waits for.
+            PackToHalf(bucket.m_gradients, *bucket.m_halfBuffer);
+            m_nccl->AllReduceOverlapped(bucket.m_halfBuffer->Data(), bucket.m_halfBuffer->GetNumElements());
+            return;
+        }
+
+        Matrix<ElemType>* reductionBuffer = bucket.m_gradients[0];
+        if (bucket.m_buffer)
+        {
+            // Copy the gradients into the contiguous buffer of the bucket. On the GPU this is queued on the compute stream,
+            // which the reduction waits for.
+            size_t offset = 0;
+            for (auto gradient : bucket.m_gradients)
+            {
+                bucket.m_buffer->ColumnSlice(offset, gradient->GetNumElements()).AssignValuesOf(gradient->Reshaped(1, gradient->GetNumElements()));
+                offset += gradient->GetNumElements();
+            }
+            reductionBuffer = bucket.m_buffer.get();
+        }
+
+        if (reductionBuffer->GetDeviceId() == CPUDEVICE)
+        {
+            m_mpi->Iallreduce(MPI_IN_PLACE, reductionBuffer->Data(), reductionBuffer->GetNumElements(),
+                MPIWrapper::GetDataType(reductionBuffer->Data()), MPI_SUM, &bucket.m_request) || MpiFail("MPI_Iallreduce");
+        }
+        else
+            m_nccl->AllReduceOverlapped(reductionBuffer->Data(), reductionBuffer->GetNumElements());
+    }
+
+    // completes the aggregation started by BeginOverlappedAggregation()
+    void AggregateGradientsOverlapped(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool showSyncPerfStats)
+    {
+        if (gradients.size() != m_overlapGradients.size())
+            LogicError("AggregateGradients: Gradients differ from the ones passed to BeginOverlappedAggregation().");
+
+        Timer aggregationTimer;
+        if (showSyncPerfStats)
+            aggregationTimer.Start();
+
+        // If the current node did not process any samples, the gradients should be zero'd
+        if (headerCPU->numSamples == 0)
+        {
+            for (size_t i = m_numBucketsLaunched; i < m_buckets.size(); i++)
+            {
+                for (auto gradient : m_buckets[i].m_gradients)
+                    gradient->SetValue(0);
+            }
+        }
+
+        // start whatever backprop has not (e.g. if it did not run for this minibatch)
+        while (m_numBucketsLaunched < m_buckets.size())
+            LaunchBucket(m_buckets[m_numBucketsLaunched++]);
+
+        StartHeaderAggregation(headerCPU);
+
+        if (m_overlapGradients[0]->GetDeviceId() == CPUDEVICE)
+        {
+            for (auto& bucket : m_buckets)
+                m_mpi->Wait(&bucket.m_request, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+        }
+        else
+            m_nccl->SyncOverlapped();
+
+        // Copy data back to the gradients from the contiguous buffers, and get ready for the next minibatch
+        for (auto& bucket : m_buckets)
+        {
+            if (bucket.m_halfBuffer)
+                UnpackFromHalf(*bucket.m_halfBuffer, bucket.m_gradients);
+            else if (bucket.m_buffer)
+            {
+                size_t offset = 0;
+                for (auto gradient : bucket.m_gradients)
+                {
+                    gradient->AssignValuesOf(bucket.m_buffer->ColumnSlice(offset, gradient->GetNumElements()).Reshaped(gradient->GetNumRows(), gradient->GetNumCols()));
+                    offset += gradient->GetNumElements();
+                }
+            }
+            bucket.m_numReady = 0;
+        }
+        m_numBucketsLaunched = 0;
+
+        CompleteHeaderAggregation(headerCPU);
+
+        if (showSyncPerfStats)
+        {
+            aggregationTimer.Stop();
+            double gradientAggregationTime = aggregationTimer.ElapsedSeconds();
+            fprintf(stderr, "Overlapped gradient aggregation wait time: %.6g\n", gradientAggregationTime);
+        }
+    }
+
 private:
     std::unique_ptr<CUDAPageLockedMemAllocator> m_allocator;
 
     std::vector<std::shared_ptr<ElemType>> m_intermediateCPUBuffers;
     std::vector<std::unique_ptr<GPUDataTransferer>> m_gpuDataTransferers;
 
-    std::vector<DistGradHeader*> m_recvHeaders;
+    // packed header of the aggregation in flight, see StartHeaderAggregation()
+    std::vector<double> m_packedHeader;
+    MPI_Request m_headerRequest;
 
     // Perform aysnchronous gradient aggregation using double buffering of the gradient matrices
     bool m_useAsyncAggregation;
@@ -508,6 +970,32 @@ private:
     std::unique_ptr<Matrix<ElemType>> m_aggregationBuffer;
     std::vector<size_t> m_packedGradientsIndex;
     std::vector<size_t> m_gradientIndexToAggregate;
+    std::vector<size_t> m_sparseGradientIndex; // SparseBlockCol gradients, see AggregateSparseBlockColGradient()
+
+    // Reduce GPU float gradients in half precision (tunable by "useFp16AllReduce=[true|false]")
+    const bool m_useFP16AllReduce;
+    std::unique_ptr<Matrix<half>> m_halfAggregationBuffer;
+
+    // Overlapping gradient aggregation with backprop, see BeginOverlappedAggregation().
+    // Bucket size, 0 if not overlapping (tunable by define "gradientBucketSizeInKB=[value]")
+    const size_t m_overlappedBucketSizeInBytes;
+    std::vector<Matrix<ElemType>*> m_overlapGradients; // in readiness order
+    std::vector<GradientBucket> m_buckets;
+    std::unordered_map<const Matrix<ElemType>*, size_t> m_bucketOfGradient;
+    size_t m_numBucketsLaunched;
+
+    // Synchronous aggregation with backup workers, see AggregateGradientsWithBackupWorkers().
+    static const int s_backupGradientTag = 0x4247; // worker -> main node
+    static const int s_backupResultTag = 0x4248;   // main node -> worker
+    // Number of late workers whose contributions are dropped in every step (tunable by "numBackupWorkers=[value]")
+    const size_t m_numBackupWorkers;
+    size_t m_backupStep;
+    std::vector<char> m_backupSendBuffer;
+    MPI_Request m_backupSendRequest;
+    std::vector<std::vector<char>> m_backupRecvBuffers; // by rank, main node only
+    std::vector<MPI_Request> m_backupRecvRequests;
+    std::vector<char> m_backupResults[2];               // on the main node, of the last two steps
+    std::vector<MPI_Request> m_backupResultRequests[2];
 
     int m_syncStatsTrace;
 
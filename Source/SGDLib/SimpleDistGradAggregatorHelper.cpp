@@ -25,7 +25,9 @@ std::shared_ptr<IDistGradAggregator<ElemType>> GetSimpleDistGradAggregator(
     int deviceId,
     int syncStatsTrace,
     size_t packThresholdSizeInBytes,
-    bool useFP16AllReduce)
+    bool useFP16AllReduce,
+    size_t overlappedBucketSizeInBytes,
+    size_t numBackupWorkers)
 {
     if (Globals::UseV2Aggregator())
         return std::make_shared<V2SimpleDistGradAggregator<ElemType>>(
@@ -40,7 +42,10 @@ std::shared_ptr<IDistGradAggregator<ElemType>> GetSimpleDistGradAggregator(
             useAsyncAggregation,
             deviceId,
             syncStatsTrace,
-            packThresholdSizeInBytes);
+            packThresholdSizeInBytes,
+            useFP16AllReduce,
+            overlappedBucketSizeInBytes,
+            numBackupWorkers);
 }
 
 template <>
@@ -50,7 +55,9 @@ std::shared_ptr<IDistGradAggregator<half>> GetSimpleDistGradAggregator<half>(
     int deviceId,
     int syncStatsTrace,
     size_t packThresholdSizeInBytes,
-    bool useFP16AllReduce)
+    bool useFP16AllReduce,
+    size_t overlappedBucketSizeInBytes,
+    size_t numBackupWorkers)
 {
     if (Globals::UseV2Aggregator())
         return std::make_shared<V2SimpleDistGradAggregator<half>>(
@@ -69,7 +76,9 @@ template std::shared_ptr<IDistGradAggregator<float>> GetSimpleDistGradAggregator
     int deviceId,
     int syncStatsTrace,
     size_t packThresholdSizeInBytes,
-    bool useFP16AllReduce);
+    bool useFP16AllReduce,
+    size_t overlappedBucketSizeInBytes,
+    size_t numBackupWorkers);
 
 template std::shared_ptr<IDistGradAggregator<double>> GetSimpleDistGradAggregator<double>(
     const MPIWrapperPtr& mpi,
@@ -77,6 +86,8 @@ template std::shared_ptr<IDistGradAggregator<double>> GetSimpleDistGradAggregato
     int deviceId,
     int syncStatsTrace,
     size_t packThresholdSizeInBytes,
-    bool useFP16AllReduce);
+    bool useFP16AllReduce,
+    size_t overlappedBucketSizeInBytes,
+    size_t numBackupWorkers);
 
 }}}
@@ -91,6 +91,9 @@ public:
 
         bool useParallelTrain = (m_mpi != nullptr);
         bool useDistributedMBReading = useParallelTrain && m_enableDistributedMBReading && dataReader->SupportsDistributedMBRead();
+        // When every worker reads its own part of the data and no progress is traced, the workers evaluate independently
+        // and their results are aggregated once at the end, instead of after every minibatch.
+        bool aggregateOnce = useDistributedMBReading && m_traceLevel == 0;
         if (useDistributedMBReading)
             dataReader->StartDistributedMinibatchLoop(mbSize, 0, m_mpi->CurrentNodeRank(), m_mpi->NumNodesInUse(), inputMatrices.GetStreamDescriptions(), testSize);
         else
@@ -122,7 +125,7 @@ public:
             bool wasDataRead = DataReaderHelpers::GetMinibatchIntoNetwork<ElemType>(*dataReader, m_net, nullptr, useDistributedMBReading, useParallelTrain, inputMatrices, actualMBSize, m_mpi);
             // in case of distributed reading, we do a few more loops until all ranks have completed
             // end of epoch
-            if (!wasDataRead && (!useDistributedMBReading || noMoreSamplesToProcess)) 
+            if (!wasDataRead && (!useDistributedMBReading || aggregateOnce || noMoreSamplesToProcess))
                 break;
 
             // Note: If !wasDataRead then the data that GetMinibatchIntoNetwork() was supposed to full in are undefined.
@@ -158,16 +161,9 @@ public:
             // BUGBUG (Issue #95): Once we have multiple layouts, this must be done on a per-node basis.
             size_t numSamplesWithLabel = wasDataRead ? m_net->GetNumSamplesWithLabelOfNetwork(actualMBSize) : 0;
             size_t aggregateNumSamplesWithLabel = numSamplesWithLabel;
-            if (useParallelTrain)
+            if (useParallelTrain && !aggregateOnce)
             {
-                if (m_gradHeader == nullptr)
-                {
-                    m_gradHeader.reset(DistGradHeader::Create(evalNodes.size()), [](DistGradHeader* ptr) {
-                        DistGradHeader::Destroy(ptr);
-                    });
-
-                    m_distGradAgg = GetSimpleDistGradAggregator<ElemType>(m_mpi, false /*useAsyncAggregation*/, m_net->GetDeviceId(), 0 /*syncStatsTrace*/);
-                }
+                PrepareAggregation(evalNodes.size());
 
                 m_gradHeader->numEvalNode = evalNodes.size();
                 m_gradHeader->numSamples = actualMBSize;
@@ -176,18 +172,7 @@ public:
                 for (size_t i = 0; i < evalNodes.size(); i++)
                     m_gradHeader->evalErrors[i] = localEpochEvalErrors.Assign(i, numSamplesWithLabel).GetCriterion(i);
 
-                // TODO: We are reusing the aggregation logic inside SimpleDistGradAggregator, which has a heavy dependency
-                // on the gradient matrix. At some point we should refactor the aggregator class to be able to only calculating
-                // eval results and then remove this hack.
-                if (learnParamsGradients.size() == 0)
-                {
-                    Matrix<ElemType>* matrix = new Matrix<ElemType>((DEVICEID_TYPE)m_net->GetDeviceId());
-                    learnParamsGradients.push_back(matrix);
-                }
-
-                // Using SimpleDistAggregator for eval results only. At some point we should rename the class to be just
-                // IDistAggregator and SimpleDistAggregator.
-                bool samplesProcessed = m_distGradAgg->AggregateGradients(learnParamsGradients, m_gradHeader.get(), /*resetState =*/ false);
+                bool samplesProcessed = AggregateHeader(learnParamsGradients);
                 noMoreSamplesToProcess = !samplesProcessed;
 
                 aggregateNumSamplesWithLabel = m_gradHeader->numSamplesWithLabel;
@@ -268,6 +253,29 @@ public:
             DisplayEvalStatistics(numMBsRunLastLogged + 1, numMBsRun, numSamplesLastLogged, evalNodes, evalResults, evalResultsLastLogged);
         }
 
+        if (aggregateOnce)
+        {
+            // a single reduction of what the workers have evaluated locally
+            PrepareAggregation(evalNodes.size());
+            m_gradHeader->numEvalNode = evalNodes.size();
+            m_gradHeader->numSamples = totalEpochSamples;
+            m_gradHeader->numSamplesWithLabel = totalEpochSamples;
+            m_gradHeader->criterion = 0.0; // (not used here)
+            for (size_t i = 0; i < evalNodes.size(); i++)
+                m_gradHeader->evalErrors[i] = ContainsAccumulatedResult(evalNodes[i]) ? EpochCriterion(0) : evalResults[i];
+
+            if (AggregateHeader(learnParamsGradients))
+            {
+                // Nodes that accumulate their result are aggregated below.
+                for (size_t i = 0; i < evalResults.size(); i++)
+                {
+                    if (!ContainsAccumulatedResult(evalNodes[i]))
+                        evalResults[i] = m_gradHeader->evalErrors[i];
+                }
+                totalEpochSamples = m_gradHeader->numSamplesWithLabel;
+            }
+        }
+
         if (useParallelTrain && !evalNodesWhichAccumulateResult.empty())
         {
             // Each worker contains accumulated values for part of the data set, we have to aggregate accumulated values
@@ -287,6 +295,35 @@ public:
     }
 
 protected:
+    void PrepareAggregation(size_t numEvalNodes)
+    {
+        if (m_gradHeader == nullptr)
+        {
+            m_gradHeader.reset(DistGradHeader::Create(numEvalNodes), [](DistGradHeader* ptr) {
+                DistGradHeader::Destroy(ptr);
+            });
+
+            m_distGradAgg = GetSimpleDistGradAggregator<ElemType>(m_mpi, false /*useAsyncAggregation*/, m_net->GetDeviceId(), 0 /*syncStatsTrace*/);
+        }
+    }
+
+    // Aggregates m_gradHeader across the workers. Returns false if no worker has processed any samples.
+    bool AggregateHeader(std::vector<Matrix<ElemType>*>& learnParamsGradients)
+    {
+        // TODO: We are reusing the aggregation logic inside SimpleDistGradAggregator, which has a heavy dependency
+        // on the gradient matrix. At some point we should refactor the aggregator class to be able to only calculating
+        // eval results and then remove this hack.
+        if (learnParamsGradients.size() == 0)
+        {
+            Matrix<ElemType>* matrix = new Matrix<ElemType>((DEVICEID_TYPE)m_net->GetDeviceId());
+            learnParamsGradients.push_back(matrix);
+        }
+
+        // Using SimpleDistAggregator for eval results only. At some point we should rename the class to be just
+        // IDistAggregator and SimpleDistAggregator.
+        return m_distGradAgg->AggregateGradients(learnParamsGradients, m_gradHeader.get(), /*resetState =*/ false);
+    }
+
     void DisplayEvalStatistics(const size_t startMBNum, const size_t endMBNum, const size_t numSamplesLastLogged,
                                const vector<ComputationNodeBasePtr>& evalNodes,
                                const EpochCriterion evalResults, const EpochCriterion evalResultsLastLogged, bool displayConvertedValue = false)
@@ -310,6 +347,7 @@ protected:
                 if (evalNodes[i]->OperationName() == OperationNameOf(CrossEntropyWithSoftmaxNode) ||
                     evalNodes[i]->OperationName() == OperationNameOf(CrossEntropyNode) ||
                     evalNodes[i]->OperationName() == OperationNameOf(ClassBasedCrossEntropyWithSoftmaxNode) ||
+                    evalNodes[i]->OperationName() == OperationNameOf(SampledCrossEntropyWithSoftmaxNode) ||
                     evalNodes[i]->OperationName() == OperationNameOf(NoiseContrastiveEstimationNode))
                     fprintf(stderr, "; perplexity = %.8f", std::exp(criterionSinceLastLogged.Average()));
             }
@@ -16,13 +16,139 @@
 #include <stdexcept>
 #include <fstream>
 #include <cstdio>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include "ProgressTracing.h"
+#include "Globals.h"
 #include "ComputationNetworkBuilder.h"
 
 using namespace std;
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+// Writes a file on a background thread, in large sequential blocks, so that the producer does not wait for the disk.
+// Errors of the background thread are rethrown by the next Write() or Close().
+class BackgroundFileWriter
+{
+public:
+    BackgroundFileWriter(const std::wstring& path, size_t blockSizeInBytes = Globals::GetFileWriteBlockSize(), size_t maxPendingBlocks = 4)
+        : m_blockSizeInBytes(blockSizeInBytes), m_maxPendingBlocks(maxPendingBlocks), m_closing(false)
+    {
+        m_file = fopenOrDie(path, L"wb");
+        m_block.reserve(m_blockSizeInBytes);
+        m_thread = std::thread([this]() { WriteBlocks(); });
+    }
+
+    ~BackgroundFileWriter()
+    {
+        try
+        {
+            Close();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    void Write(const void* data, size_t sizeInBytes)
+    {
+        auto bytes = reinterpret_cast<const char*>(data);
+        m_block.insert(m_block.end(), bytes, bytes + sizeInBytes);
+        if (m_block.size() >= m_blockSizeInBytes)
+            Submit();
+    }
+
+    // writes the pending data and closes the file
+    void Close()
+    {
+        if (!m_file)
+            return;
+
+        Submit();
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_closing = true;
+        }
+        m_changed.notify_all();
+        m_thread.join();
+        fcloseOrDie(m_file);
+        m_file = nullptr;
+        RethrowError();
+    }
+
+private:
+    void Submit()
+    {
+        RethrowError();
+        if (m_block.empty())
+            return;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_changed.wait(lock, [this]() { return m_pendingBlocks.size() < m_maxPendingBlocks; });
+        m_pendingBlocks.push_back(std::move(m_block));
+        lock.unlock();
+        m_changed.notify_all();
+
+        m_block = std::vector<char>();
+        m_block.reserve(m_blockSizeInBytes);
+    }
+
+    void WriteBlocks()
+    {
+        for (;;)
+        {
+            std::vector<char> block;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_changed.wait(lock, [this]() { return !m_pendingBlocks.empty() || m_closing; });
+                if (m_pendingBlocks.empty())
+                    return;
+                block = std::move(m_pendingBlocks.front());
+                m_pendingBlocks.pop_front();
+            }
+            m_changed.notify_all();
+
+            // after an error, the remaining blocks are dropped
+            if (!m_error)
+            {
+                try
+                {
+                    fwriteOrDie(block, m_file);
+                }
+                catch (...)
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_error = std::current_exception();
+                }
+            }
+        }
+    }
+
+    void RethrowError()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_error)
+        {
+            auto error = m_error;
+            m_error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    FILE* m_file;
+    const size_t m_blockSizeInBytes;
+    const size_t m_maxPendingBlocks;
+    std::vector<char> m_block;                    // what is being filled by Write()
+    std::deque<std::vector<char>> m_pendingBlocks; // what the background thread has yet to write
+    bool m_closing;
+    std::exception_ptr m_error;
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::thread m_thread;
+};
 
 template <class ElemType>
 class SimpleOutputWriter
@@ -208,6 +334,8 @@ public:
             if (nodeOutputPath != L"-")
                 nodeOutputPath += L"." + onode->NodeName();
             auto f = make_shared<File>(nodeOutputPath, fileOptionsWrite | fileOptionsText);
+            if (nodeOutputPath != L"-")
+                f->Setvbuf();
             outputStreams[onode] = f;
         }
 
@@ -290,6 +418,126 @@ public:
             iter.second->Flush();
     }
 
+    // Writes the outputs in binary, for each output node into
+    //  - <outputPath>.<node>.bin: the samples of all sequences one after another, each sample as <dim> float32 values
+    //  - <outputPath>.<node>.idx: a text index, with 'dim=<dim>' in the first line and then one line per sequence:
+    //    <sequence key (writeSequenceKey) or number> <index of its first sample> <number of samples>
+    // Each minibatch is copied from the device in one piece, and the files are written on background threads.
+    void WriteBinaryOutput(IDataReader& dataReader, size_t mbSize, std::wstring outputPath, const std::vector<std::wstring>& outputNodeNames, size_t numOutputSamples = requestDataSize, bool writeSequenceKey = false)
+    {
+        ScopedNetworkOperationMode modeGuard(m_net, NetworkOperationMode::inferring);
+
+        std::vector<ComputationNodeBasePtr> outputNodes = m_net->OutputNodesByName(outputNodeNames);
+        std::vector<ComputationNodeBasePtr> inputNodes = m_net->InputNodesForOutputs(outputNodeNames);
+        m_net->AllocateAllMatrices({}, outputNodes, nullptr); // don't allocate for backward pass
+
+        StreamMinibatchInputs inputMatrices = DataReaderHelpers::RetrieveInputMatrices(inputNodes);
+
+        if (outputPath == L"-")
+            InvalidArgument("write: Binary output cannot go to stdout, 'outputPath' must be a file path.");
+
+        struct OutputStreams
+        {
+            unique_ptr<BackgroundFileWriter> data;
+            unique_ptr<BackgroundFileWriter> index;
+            size_t numSamples;
+            size_t numSequences;
+        };
+        File::MakeIntermediateDirs(outputPath);
+        std::map<ComputationNodeBasePtr, OutputStreams> outputStreams;
+        for (auto& onode : outputNodes)
+        {
+            auto& streams = outputStreams[onode];
+            streams.data.reset(new BackgroundFileWriter(outputPath + L"." + onode->NodeName() + L".bin"));
+            streams.index.reset(new BackgroundFileWriter(outputPath + L"." + onode->NodeName() + L".idx"));
+            streams.numSamples = 0;
+            streams.numSequences = 0;
+
+            auto header = msra::strfun::_strprintf<char>("dim=%d\n", (int)onode->GetSampleLayout().GetNumElements());
+            streams.index->Write(header.data(), header.size());
+        }
+
+        dataReader.StartMinibatchLoop(mbSize, 0, inputMatrices.GetStreamDescriptions(), numOutputSamples);
+        m_net->StartEvaluateMinibatchLoop(outputNodes);
+
+        size_t totalEpochSamples = 0;
+        size_t actualMBSize;
+        const size_t numIterationsBeforePrintingProgress = 100;
+        size_t numItersSinceLastPrintOfProgress = 0;
+        std::vector<float> samples;
+        for (size_t numMBsRun = 0; DataReaderHelpers::GetMinibatchIntoNetwork<ElemType>(dataReader, m_net, nullptr, false, false, inputMatrices, actualMBSize, nullptr); numMBsRun++)
+        {
+            ComputationNetwork::BumpEvalTimeStamp(inputNodes);
+            m_net->ForwardProp(outputNodes);
+
+            for (auto& onode : outputNodes)
+            {
+                auto node = dynamic_pointer_cast<ComputationNode<ElemType>>(onode);
+                auto& streams = outputStreams[onode];
+
+                const Matrix<ElemType>& values = node->Value();
+                const size_t numRows = values.GetNumRows();
+                unique_ptr<ElemType[]> data(values.CopyToArray());
+
+                MBLayoutPtr pMBLayout = node->GetMBLayout();
+                if (!pMBLayout) // no MBLayout: treat the columns as a single sequence
+                {
+                    pMBLayout = make_shared<MBLayout>();
+                    pMBLayout->Init(1, values.GetNumCols());
+                    pMBLayout->AddSequence(0, 0, 0, values.GetNumCols());
+                }
+
+                char line[1024];
+                for (const auto& seqInfo : pMBLayout->GetAllSequences())
+                {
+                    if (seqInfo.seqId == GAP_SEQUENCE_ID)
+                        continue;
+                    const size_t tBegin = seqInfo.tBegin >= 0 ? seqInfo.tBegin : 0;
+                    const size_t tEnd = std::min((size_t)seqInfo.tEnd, pMBLayout->GetNumTimeSteps());
+                    if (tBegin >= tEnd)
+                        continue;
+
+                    samples.resize(numRows * (tEnd - tBegin));
+                    for (size_t t = tBegin; t < tEnd; t++)
+                    {
+                        const ElemType* sample = data.get() + pMBLayout->GetColumnIndex(seqInfo, t - tBegin) * numRows;
+                        std::copy(sample, sample + numRows, samples.begin() + (t - tBegin) * numRows);
+                    }
+                    streams.data->Write(samples.data(), samples.size() * sizeof(float));
+
+                    int length;
+                    if (writeSequenceKey && inputMatrices.m_getKeyById)
+                        length = snprintf(line, sizeof(line), "%s %zu %zu\n", inputMatrices.m_getKeyById(seqInfo.seqId).c_str(), streams.numSamples, tEnd - tBegin);
+                    else
+                        length = snprintf(line, sizeof(line), "%zu %zu %zu\n", streams.numSequences, streams.numSamples, tEnd - tBegin);
+                    if (length < 0 || length >= (int)sizeof(line))
+                        RuntimeError("write: The key of sequence %d is too long for the index.", (int)streams.numSequences);
+                    streams.index->Write(line, length);
+
+                    streams.numSamples += tEnd - tBegin;
+                    streams.numSequences++;
+                }
+            }
+            totalEpochSamples += actualMBSize;
+
+            if (m_verbosity > 1)
+                fprintf(stderr, "Minibatch[%lu]: ActualMBSize = %lu\n", (unsigned long)numMBsRun, (unsigned long)actualMBSize);
+
+            numItersSinceLastPrintOfProgress = ProgressTracing::TraceFakeProgress(numIterationsBeforePrintingProgress, numItersSinceLastPrintOfProgress);
+
+            dataReader.DataEnd();
+        } // end loop over minibatches
+
+        // close all files here (where we can catch errors)
+        for (auto& iter : outputStreams)
+        {
+            iter.second.data->Close();
+            iter.second.index->Close();
+        }
+
+        fprintf(stderr, "Written to %ls*\nTotal Samples Evaluated = %lu\n", outputPath.c_str(), (unsigned long)totalEpochSamples);
+    }
+
 private:
     ComputationNetworkPtr m_net;
     int m_verbosity;
@@ -369,18 +369,11 @@ public:
         matrixPhoneSeqs.TransferFromDeviceToDevice(CPUDEVICE, m_deviceid);
         matrixPhoneBounds.TransferFromDeviceToDevice(CPUDEVICE, m_deviceid);
 
-        // compute alpha, beta and CTC scores
+        // compute alpha, beta and CTC scores; the CTC scores come normalized over each frame
         Microsoft::MSR::CNTK::Matrix<ElemType> alpha(m_deviceid);
         Microsoft::MSR::CNTK::Matrix<ElemType> beta(m_deviceid);
         CTCPosterior.AssignCTCScore(prob, alpha, beta, matrixPhoneSeqs, matrixPhoneBounds, totalScore, uttToChanInd, uttBeginFrame,
             uttFrameNum, uttPhoneNum, numParallelSequences, mbsize, blankTokenId, delayConstraint, /*isColWise=*/true );
-        
-        Microsoft::MSR::CNTK::Matrix<ElemType> rowSum(m_deviceid);
-        rowSum.Resize(1, numCols);
-
-        // Normalize the CTC scores
-        CTCPosterior.VectorSum(CTCPosterior, rowSum, /*isColWise=*/true);
-        CTCPosterior.RowElementDivideBy(rowSum);
     }
 
 private:
@@ -34,7 +34,7 @@ void latticefunctionsops::forwardbackwardlattice(const size_t* batchsizeforward,
                                                  const vectorref<unsigned short>& uids, const vectorref<unsigned short>& senone2classmap,
                                                  vectorref<double>& logaccalphas, vectorref<double>& logaccbetas,
                                                  vectorref<double>& logframescorrectedge, vectorref<double>& logEframescorrect, vectorref<double>& Eframescorrectbuf,
-                                                 double& logEframescorrecttotal, double& totalfwscore) const
+                                                 vectorref<double>& fwbwscores, double& logEframescorrecttotal, double& totalfwscore) const
 {
 }
 
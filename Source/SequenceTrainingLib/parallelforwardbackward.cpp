@@ -393,6 +393,7 @@ struct parallelstateimpl
           logframescorrectedgegpu(msra::cuda::newdoublevector(deviceid)),
           Eframescorrectbufgpu(msra::cuda::newdoublevector(deviceid)),
           logEframescorrectgpu(msra::cuda::newdoublevector(deviceid)),
+          fwbwscoresgpu(msra::cuda::newdoublevector(deviceid)),
           uidsgpu(msra::cuda::newushortvector(deviceid)),
           senone2classmapgpu(msra::cuda::newushortvector(deviceid)),
           errorsignalgpu(new Microsoft::MSR::CNTK::Matrix<float>((int) deviceid)),
@@ -533,6 +534,7 @@ struct parallelstateimpl
     std::unique_ptr<doublevector> logframescorrectedgegpu;
     std::unique_ptr<doublevector> Eframescorrectbufgpu;
     std::unique_ptr<doublevector> logEframescorrectgpu;
+    std::unique_ptr<doublevector> fwbwscoresgpu; // total fw/bw scores and accuracies, fetched once per lattice
 
     std::unique_ptr<ushortvector> backptrstoragegpu;
     std::unique_ptr<sizetvector> backptroffsetsgpu;
@@ -596,6 +598,7 @@ struct parallelstateimpl
                           const bool allocateframescorrect, const bool copyuids, const bool allocateaccvectors)
     {
         logppsgpu->allocate(edges.size());
+        fwbwscoresgpu->allocate(4);
 #ifndef TWO_CHANNEL
         const size_t alphabetanoderatio = 1;
 #else
@@ -809,40 +812,9 @@ double lattice::parallelforwardbackwardlattice(parallelstate& parallelstate, con
                                                const_array_ref<size_t>& uids, std::vector<double>& logEframescorrect,
                                                std::vector<double>& Eframescorrectbuf, double& logEframescorrecttotal) const
 {                                     // ^^ TODO: remove this
-    vector<size_t> batchsizeforward;  // record the batch size that exclude the data dependency for forward
-    vector<size_t> batchsizebackward; // record the batch size that exclude the data dependency for backward
-
-    size_t endindexforward = edges[0].E;
-    size_t countbatchforward = 0;
-
-    size_t endindexbackward = edges.back().S;
-    size_t countbatchbackward = 0;
-    foreach_index (j, edges) // compute the batch size info for kernel launches
-    {
-        if (edges[j].S < endindexforward)
-            countbatchforward++; // note: we don't check forward because the order of end node is assured.
-        else
-        {
-            batchsizeforward.push_back(countbatchforward);
-            countbatchforward = 1;
-            endindexforward = edges[j].E;
-        }
-        const size_t backj = edges.size() - 1 - j;
-        if (edges[backj].E > endindexbackward)
-        {
-            countbatchbackward++;
-            if (endindexbackward < edges[backj].S)
-                endindexbackward = edges[backj].S;
-        }
-        else
-        {
-            batchsizebackward.push_back(countbatchbackward);
-            countbatchbackward = 1;
-            endindexbackward = edges[backj].S;
-        }
-    }
-    batchsizeforward.push_back(countbatchforward);
-    batchsizebackward.push_back(countbatchbackward);
+    // the batch sizes that exclude the data dependency for forward and backward, computed once per lattice
+    const auto& batchsizeforward = getstructureindex().batchsizeforward;
+    const auto& batchsizebackward = getstructureindex().batchsizebackward;
 
     std::vector<unsigned short> uidsuint(uids.size()); // actually we shall not do this, but as it will not take much time, let us just leave it here now.
     foreach_index (i, uidsuint)
@@ -870,7 +842,8 @@ double lattice::parallelforwardbackwardlattice(parallelstate& parallelstate, con
                                                  returnEframescorrect, *parallelstate->uidsgpu.get(), *parallelstate->senone2classmapgpu.get(),
                                                  *parallelstate->logaccalphasgpu.get(), *parallelstate->logaccbetasgpu.get(),
                                                  *parallelstate->logframescorrectedgegpu.get(), *parallelstate->logEframescorrectgpu.get(),
-                                                 *parallelstate->Eframescorrectbufgpu.get(), logEframescorrecttotal, totalfwscore);
+                                                 *parallelstate->Eframescorrectbufgpu.get(), *parallelstate->fwbwscoresgpu.get(),
+                                                 logEframescorrecttotal, totalfwscore);
     }
     else // emulation
     {
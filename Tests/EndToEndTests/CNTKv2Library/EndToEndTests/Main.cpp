@@ -22,6 +22,7 @@ void TrainSequenceToSequenceTranslator();
 void TrainTruncatedLSTMAcousticModelClassifier();
 void TestFrameMode();
 void TestDistributedCheckpointing();
+int RunTrainingBenchmarks(int argc, char* argv[]);
 
 int main(int argc, char *argv[])
 {
@@ -43,6 +44,9 @@ int main(int argc, char *argv[])
     fprintf(stderr, "Run tests using CPU-only build.\n");
 #endif
 
+    if (argc >= 2 && !std::string(argv[1]).compare("Benchmark"))
+        return RunTrainingBenchmarks(argc, argv);
+
     if (argc > 2)
     {
         if (argc == 3 && !std::string(argv[1]).compare("Distribution")) {
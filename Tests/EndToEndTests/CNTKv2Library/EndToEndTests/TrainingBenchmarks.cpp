@@ -0,0 +1,484 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Training throughput and scaling benchmarks of a fixed set of reference models on synthetic data.
+//
+// V2LibraryEndToEndTests Benchmark [-models resnet,lstm,seq2seq,dssm] [-steps 50] [-warmup 5] [-device gpu|cpu]
+//                                  [-distributed] [-baseline resnet=1234.5,...] [-output report.json]
+//
+// With -distributed, the benchmark is launched by mpiexec over the nodes and GPUs to measure; each worker uses a
+// data parallel learner and the GPU of its rank on its host. The input of every minibatch is generated once up front,
+// so the numbers do not depend on the readers. The report is written by the first worker only.
+//
+
+#define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms  --add this at the top of all CPP files that give "function or variable may be unsafe" warnings
+
+#include "CNTKLibrary.h"
+#include <functional>
+#include <chrono>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <unordered_set>
+#include "Common.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <Psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace CNTK;
+
+FunctionPtr ResNetClassifier(Variable input, size_t numOutputClasses, const DeviceDescriptor& device, const std::wstring& outputName);
+
+namespace
+{
+    struct BenchmarkModel
+    {
+        FunctionPtr m_model;
+        FunctionPtr m_loss;
+        FunctionPtr m_evaluation;
+        std::unordered_map<Variable, ValuePtr> m_arguments; // the synthetic minibatch, reused in every step
+        size_t m_samplesPerMinibatch = 0;
+    };
+
+    struct BenchmarkOptions
+    {
+        std::vector<std::string> m_models = { "resnet", "lstm", "seq2seq", "dssm" };
+        size_t m_steps = 50;
+        size_t m_warmupSteps = 5;
+        bool m_useGpu = true;
+        bool m_distributed = false;
+        std::unordered_map<std::string, double> m_baselines; // samples/s of one worker, for the scaling efficiency
+        std::string m_output;
+    };
+
+    struct BenchmarkResult
+    {
+        std::string m_model;
+        std::string m_error;
+        size_t m_samplesPerMinibatch = 0;
+        double m_timeToFirstMinibatchSeconds = 0; // building the model and the trainer, and the first step
+        double m_stepSeconds = 0;                 // average of the measured steps
+        double m_samplesPerSecond = 0;            // of this worker
+        double m_aggregateSamplesPerSecond = 0;   // of all workers
+        double m_communicationSeconds = 0;        // gradient aggregation in the measured steps
+        double m_scalingEfficiency = 0;           // 0 without a baseline
+        size_t m_peakHostMemoryMB = 0;
+        size_t m_peakDeviceMemoryMB = 0;
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    double SecondsSince(const Clock::time_point& start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    size_t PeakHostMemoryInMB()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return 0;
+        return counters.PeakWorkingSetSize / (1024 * 1024);
+#else
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return (size_t)usage.ru_maxrss / 1024;
+#endif
+    }
+
+    double GradientAggregationSeconds()
+    {
+        auto times = Internal::GetProfiledTimes();
+        auto aggregation = times.find(L"Gradient Aggregation");
+        return (aggregation == times.end()) ? 0 : aggregation->second.second;
+    }
+
+    ValuePtr DeviceValue(const NDArrayViewPtr& data, const DeviceDescriptor& device)
+    {
+        return MakeSharedObject<Value>(data->DeepClone(device, /*readOnly =*/ true));
+    }
+
+    // The CIFAR-10 ResNet of CifarResNet.cpp on random 32x32x3 images.
+    BenchmarkModel CreateResNet(const DeviceDescriptor& device)
+    {
+        const size_t numClasses = 10;
+        const size_t minibatchSize = 64;
+        const NDShape imageShape = { 32, 32, 3 };
+
+        BenchmarkModel benchmark;
+        auto imageInput = InputVariable(imageShape, DataType::Float, L"features");
+        auto labels = InputVariable({ numClasses }, DataType::Float, L"labels");
+        benchmark.m_model = ResNetClassifier(imageInput, numClasses, device, L"classifierOutput");
+        benchmark.m_loss = CrossEntropyWithSoftmax(benchmark.m_model, labels, L"lossFunction");
+        benchmark.m_evaluation = ClassificationError(benchmark.m_model, labels, L"predictionError");
+
+        std::vector<float> images(imageShape.TotalSize() * minibatchSize);
+        for (auto& pixel : images)
+            pixel = (float)(rand() % 256);
+        std::vector<size_t> classes(minibatchSize);
+        for (auto& label : classes)
+            label = rand() % numClasses;
+
+        benchmark.m_arguments = { { imageInput, Value::CreateBatch(imageShape, images, device, /*readOnly =*/ true) },
+                                  { labels, Value::CreateBatch<float>(numClasses, classes, device, /*readOnly =*/ true) } };
+        benchmark.m_samplesPerMinibatch = minibatchSize;
+        return benchmark;
+    }
+
+    // The LSTMP acoustic model of TruncatedLSTMAcousticModel.cpp on random frames, in sequences of the truncation length.
+    BenchmarkModel CreateLSTMAcousticModel(const DeviceDescriptor& device)
+    {
+        const size_t featuresDim = 33;
+        const size_t cellDim = 1024;
+        const size_t hiddenDim = 256;
+        const size_t numClasses = 132;
+        const size_t numLSTMLayers = 3;
+        const size_t truncationLength = 20;
+        const size_t numSequences = 16;
+
+        BenchmarkModel benchmark;
+        auto features = InputVariable({ featuresDim }, DataType::Float, L"features");
+        auto labels = InputVariable({ numClasses }, DataType::Float, L"labels");
+
+        auto pastValueRecurrenceHook = [](const Variable& x) { return PastValue(x); };
+        FunctionPtr r = features;
+        for (size_t i = 0; i < numLSTMLayers; ++i)
+            r = LSTMPComponentWithSelfStabilization<float>(r, { hiddenDim }, { cellDim }, pastValueRecurrenceHook, pastValueRecurrenceHook, device).first;
+
+        benchmark.m_model = FullyConnectedLinearLayer(r, numClasses, device, L"classifierOutput");
+        benchmark.m_loss = CrossEntropyWithSoftmax(benchmark.m_model, labels, L"lossFunction");
+        benchmark.m_evaluation = ClassificationError(benchmark.m_model, labels, L"classificationError");
+
+        std::vector<size_t> sequenceLengths(numSequences, truncationLength);
+        benchmark.m_arguments = { { features, GenerateSequences<float>(sequenceLengths, { featuresDim }, device, false) },
+                                  { labels, GenerateSequences<float>(sequenceLengths, { numClasses }, device, true) } };
+        benchmark.m_samplesPerMinibatch = numSequences * truncationLength;
+        return benchmark;
+    }
+
+    // A one layer version of the encoder/decoder of Seq2Seq.cpp, without the attention and the sentence start token handling.
+    BenchmarkModel CreateSequenceToSequence(const DeviceDescriptor& device)
+    {
+        const size_t vocabularyDim = 2000;
+        const size_t embeddingDim = 300;
+        const size_t hiddenDim = 512;
+        const size_t numSequences = 32;
+        const size_t inputLength = 20;
+        const size_t labelLength = 24;
+
+        BenchmarkModel benchmark;
+        auto rawInput = InputVariable({ vocabularyDim }, /*isSparse =*/ true, DataType::Float, L"rawInput", { Axis(L"inputAxis"), Axis::DefaultBatchAxis() });
+        auto rawLabels = InputVariable({ vocabularyDim }, /*isSparse =*/ true, DataType::Float, L"rawLabels", { Axis(L"labelAxis"), Axis::DefaultBatchAxis() });
+
+        auto inputEmbedding = Embedding(rawInput, embeddingDim, device);
+        auto labelEmbedding = Embedding(rawLabels, embeddingDim, device);
+
+        auto futureValueRecurrenceHook = [](const Variable& x) { return FutureValue(x); };
+        auto encoder = LSTMPComponentWithSelfStabilization<float>(inputEmbedding, { hiddenDim }, { hiddenDim }, futureValueRecurrenceHook, futureValueRecurrenceHook, device).first;
+        auto thoughtVector = Sequence::BroadcastAs(Sequence::First(encoder), labelEmbedding, L"thoughtVectorBroadcast");
+
+        auto pastValueRecurrenceHook = [](const Variable& x) { return PastValue(x); };
+        auto decoderInput = Splice({ labelEmbedding, thoughtVector }, Axis(0));
+        auto decoder = LSTMPComponentWithSelfStabilization<float>(decoderInput, { hiddenDim }, { hiddenDim }, pastValueRecurrenceHook, pastValueRecurrenceHook, device).first;
+
+        benchmark.m_model = FullyConnectedLinearLayer(decoder, vocabularyDim, device, L"classifierOutput");
+        benchmark.m_loss = CrossEntropyWithSoftmax(benchmark.m_model, rawLabels, L"lossFunction");
+        benchmark.m_evaluation = ClassificationError(benchmark.m_model, rawLabels, L"classificationError");
+
+        benchmark.m_arguments = { { rawInput, GenerateSequences<float>(std::vector<size_t>(numSequences, inputLength), { vocabularyDim }, device, true) },
+                                  { rawLabels, GenerateSequences<float>(std::vector<size_t>(numSequences, labelLength), { vocabularyDim }, device, true) } };
+        benchmark.m_samplesPerMinibatch = numSequences * labelLength;
+        return benchmark;
+    }
+
+    FunctionPtr DSSMTower(const Variable& input, const DeviceDescriptor& device)
+    {
+        auto tanh = [](const FunctionPtr& x) { return Tanh(x); };
+        auto tower = FullyConnectedDNNLayer(input, 300, device, tanh);
+        tower = FullyConnectedDNNLayer(tower, 300, device, tanh);
+        return FullyConnectedLinearLayer(tower, 128, device);
+    }
+
+    // A DSSM on sparse letter-trigram queries and documents, ranking each query's document against the documents of
+    // the other queries in the minibatch.
+    BenchmarkModel CreateSparseDSSM(const DeviceDescriptor& device)
+    {
+        const size_t trigramDim = 50000;
+        const size_t nonZerosPerSample = 30;
+        const size_t numNegativeSamples = 4;
+        const size_t minibatchSize = 1024;
+
+        BenchmarkModel benchmark;
+        std::vector<Axis> batchAxes = { Axis::DefaultBatchAxis() };
+        auto query = InputVariable({ trigramDim }, /*isSparse =*/ true, DataType::Float, L"query", batchAxes);
+        auto document = InputVariable({ trigramDim }, /*isSparse =*/ true, DataType::Float, L"document", batchAxes);
+        auto labels = InputVariable({ numNegativeSamples + 1 }, DataType::Float, L"labels", batchAxes);
+
+        benchmark.m_model = CosineDistanceWithNegativeSamples(DSSMTower(query, device), DSSMTower(document, device), 1, numNegativeSamples, L"similarity");
+        benchmark.m_loss = CrossEntropyWithSoftmax(benchmark.m_model, labels, L"lossFunction");
+        benchmark.m_evaluation = ClassificationError(benchmark.m_model, labels, L"classificationError");
+
+        // the matching document is always the first one of the similarities
+        benchmark.m_arguments = { { query, DeviceValue(GenerateSparseSequence<float>(trigramDim, minibatchSize, nonZerosPerSample).second, device) },
+                                  { document, DeviceValue(GenerateSparseSequence<float>(trigramDim, minibatchSize, nonZerosPerSample).second, device) },
+                                  { labels, Value::CreateBatch<float>(numNegativeSamples + 1, std::vector<size_t>(minibatchSize, 0), device, /*readOnly =*/ true) } };
+        benchmark.m_samplesPerMinibatch = minibatchSize;
+        return benchmark;
+    }
+
+    const std::vector<std::pair<std::string, std::function<BenchmarkModel(const DeviceDescriptor&)>>>& BenchmarkModels()
+    {
+        static const std::vector<std::pair<std::string, std::function<BenchmarkModel(const DeviceDescriptor&)>>> models = {
+            { "resnet", CreateResNet },
+            { "lstm", CreateLSTMAcousticModel },
+            { "seq2seq", CreateSequenceToSequence },
+            { "dssm", CreateSparseDSSM },
+        };
+        return models;
+    }
+
+    BenchmarkResult RunBenchmark(const std::string& name, const std::function<BenchmarkModel(const DeviceDescriptor&)>& create,
+                                 const BenchmarkOptions& options, const DistributedCommunicatorPtr& communicator, const DeviceDescriptor& device)
+    {
+        BenchmarkResult result;
+        result.m_model = name;
+        try
+        {
+            auto start = Clock::now();
+            auto benchmark = create(device);
+            result.m_samplesPerMinibatch = benchmark.m_samplesPerMinibatch;
+
+            auto learner = SGDLearner(benchmark.m_model->Parameters(), TrainingParameterPerSampleSchedule(0.0001));
+            if (communicator)
+                learner = CreateDataParallelDistributedLearner(communicator, learner, 0);
+            auto trainer = CreateTrainer(benchmark.m_model, benchmark.m_loss, benchmark.m_evaluation, { learner });
+
+            size_t peakDeviceMemoryMB = 0;
+            auto step = [&]() {
+                trainer->TrainMinibatch(benchmark.m_arguments, false, device);
+                // includes the other processes on the GPU, which the workers of other ranks do not share
+                peakDeviceMemoryMB = std::max(peakDeviceMemoryMB, Internal::GetUsedDeviceMemoryInMB(device));
+            };
+
+            step();
+            result.m_timeToFirstMinibatchSeconds = SecondsSince(start);
+
+            for (size_t i = 1; i < options.m_warmupSteps; ++i)
+                step();
+
+            if (communicator)
+                communicator->Barrier();
+
+            double aggregationSecondsBefore = GradientAggregationSeconds();
+            start = Clock::now();
+            for (size_t i = 0; i < options.m_steps; ++i)
+                step();
+            // the values of the last step are copied out of the GPU so that its time is included
+            trainer->PreviousMinibatchLossAverage();
+            double seconds = SecondsSince(start);
+
+            size_t numWorkers = communicator ? communicator->Workers().size() : 1;
+            result.m_stepSeconds = seconds / options.m_steps;
+            result.m_samplesPerSecond = benchmark.m_samplesPerMinibatch * options.m_steps / seconds;
+            result.m_aggregateSamplesPerSecond = result.m_samplesPerSecond * numWorkers;
+            result.m_communicationSeconds = GradientAggregationSeconds() - aggregationSecondsBefore;
+            result.m_peakHostMemoryMB = PeakHostMemoryInMB();
+            result.m_peakDeviceMemoryMB = peakDeviceMemoryMB;
+
+            auto baseline = options.m_baselines.find(name);
+            if (baseline != options.m_baselines.end() && baseline->second > 0)
+                result.m_scalingEfficiency = result.m_aggregateSamplesPerSecond / (baseline->second * numWorkers);
+        }
+        catch (const std::exception& e)
+        {
+            result.m_error = e.what();
+        }
+
+        return result;
+    }
+
+    std::string JsonEscape(const std::string& s)
+    {
+        std::string escaped;
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += (c == '\n' || c == '\r' || c == '\t') ? ' ' : c;
+        }
+        return escaped;
+    }
+
+    std::string Report(const std::vector<BenchmarkResult>& results, const BenchmarkOptions& options, const DeviceDescriptor& device, size_t numWorkers, size_t numHosts)
+    {
+        std::ostringstream json;
+        json << "{\n"
+             << "  \"device\": \"" << (device.Type() == DeviceKind::GPU ? "gpu" : "cpu") << "\",\n"
+             << "  \"workers\": " << numWorkers << ",\n"
+             << "  \"hosts\": " << numHosts << ",\n"
+             << "  \"steps\": " << options.m_steps << ",\n"
+             << "  \"warmupSteps\": " << options.m_warmupSteps << ",\n"
+             << "  \"benchmarks\": [";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const auto& r = results[i];
+            json << (i ? "," : "") << "\n    { \"model\": \"" << r.m_model << "\"";
+            if (!r.m_error.empty())
+                json << ", \"error\": \"" << JsonEscape(r.m_error) << "\"";
+            else
+                json << ", \"samplesPerMinibatch\": " << r.m_samplesPerMinibatch
+                     << ", \"timeToFirstMinibatchSeconds\": " << r.m_timeToFirstMinibatchSeconds
+                     << ", \"stepSeconds\": " << r.m_stepSeconds
+                     << ", \"samplesPerSecondPerWorker\": " << r.m_samplesPerSecond
+                     << ", \"samplesPerSecond\": " << r.m_aggregateSamplesPerSecond
+                     << ", \"communicationSeconds\": " << r.m_communicationSeconds
+                     << ", \"scalingEfficiency\": " << r.m_scalingEfficiency
+                     << ", \"peakHostMemoryMB\": " << r.m_peakHostMemoryMB
+                     << ", \"peakDeviceMemoryMB\": " << r.m_peakDeviceMemoryMB;
+            json << " }";
+        }
+        json << "\n  ]\n}\n";
+        return json.str();
+    }
+
+    std::vector<std::string> Split(const std::string& s, char separator)
+    {
+        std::vector<std::string> parts;
+        std::istringstream stream(s);
+        std::string part;
+        while (std::getline(stream, part, separator))
+        {
+            if (!part.empty())
+                parts.push_back(part);
+        }
+        return parts;
+    }
+
+    BenchmarkOptions ParseOptions(int argc, char* argv[])
+    {
+        BenchmarkOptions options;
+        for (int i = 2; i < argc; ++i)
+        {
+            std::string option = argv[i];
+            auto value = [&]() {
+                if (i + 1 >= argc)
+                    throw std::runtime_error("Missing the value of " + option);
+                return std::string(argv[++i]);
+            };
+
+            if (option == "-models")
+                options.m_models = Split(value(), ',');
+            else if (option == "-steps")
+                options.m_steps = std::stoul(value());
+            else if (option == "-warmup")
+                options.m_warmupSteps = std::stoul(value());
+            else if (option == "-device")
+                options.m_useGpu = (value() == "gpu");
+            else if (option == "-distributed")
+                options.m_distributed = true;
+            else if (option == "-output")
+                options.m_output = value();
+            else if (option == "-baseline")
+            {
+                for (const auto& baseline : Split(value(), ','))
+                {
+                    auto separator = baseline.find('=');
+                    if (separator == std::string::npos)
+                        throw std::runtime_error("The baseline '" + baseline + "' is not of the form model=samplesPerSecond");
+                    options.m_baselines[baseline.substr(0, separator)] = std::stod(baseline.substr(separator + 1));
+                }
+            }
+            else
+                throw std::runtime_error("Unknown option " + option);
+        }
+
+        if (options.m_steps == 0)
+            throw std::runtime_error("The number of steps must be positive");
+        if (options.m_warmupSteps == 0)
+            options.m_warmupSteps = 1; // the first step is always taken, for the time to the first minibatch
+
+#ifdef CPUONLY
+        options.m_useGpu = false;
+#endif
+        return options;
+    }
+}
+
+int RunTrainingBenchmarks(int argc, char* argv[])
+{
+    try
+    {
+        auto options = ParseOptions(argc, argv);
+
+        DistributedCommunicatorPtr communicator;
+        size_t localRank = 0, numHosts = 1;
+        if (options.m_distributed)
+        {
+            communicator = MPICommunicator();
+            auto current = communicator->CurrentWorker();
+            std::unordered_set<std::wstring> hosts;
+            for (const auto& worker : communicator->Workers())
+            {
+                hosts.insert(worker.m_hostId);
+                if (worker.m_hostId == current.m_hostId && worker.m_globalRank < current.m_globalRank)
+                    localRank++;
+            }
+            numHosts = hosts.size();
+        }
+
+        auto device = options.m_useGpu ? DeviceDescriptor::GPUDevice((unsigned int)localRank) : DeviceDescriptor::CPUDevice();
+        size_t numWorkers = communicator ? communicator->Workers().size() : 1;
+        bool isMainWorker = !communicator || communicator->CurrentWorker().IsMain();
+
+        Internal::StartProfiler(L"profiler");
+        Internal::EnableProfiler();
+
+        std::vector<BenchmarkResult> results;
+        for (const auto& name : options.m_models)
+        {
+            auto model = std::find_if(BenchmarkModels().begin(), BenchmarkModels().end(), [&](const std::pair<std::string, std::function<BenchmarkModel(const DeviceDescriptor&)>>& m) { return m.first == name; });
+            if (model == BenchmarkModels().end())
+                throw std::runtime_error("Unknown benchmark model " + name);
+
+            if (name == "resnet" && device.Type() != DeviceKind::GPU)
+            {
+                fprintf(stderr, "Cannot run the resnet benchmark on a CPU device.\n");
+                continue;
+            }
+
+            if (isMainWorker)
+                fprintf(stderr, "Benchmarking %s on %d worker(s)..\n", name.c_str(), (int)numWorkers);
+
+            results.push_back(RunBenchmark(name, model->second, options, communicator, device));
+        }
+
+        Internal::StopProfiler();
+
+        if (isMainWorker)
+        {
+            auto report = Report(results, options, device, numWorkers, numHosts);
+            if (options.m_output.empty())
+                printf("%s", report.c_str());
+            else
+                std::ofstream(options.m_output) << report;
+        }
+
+        if (communicator)
+            DistributedCommunicator::Finalize();
+
+        bool hasError = std::any_of(results.begin(), results.end(), [](const BenchmarkResult& r) { return !r.m_error.empty(); });
+        return hasError ? -1 : 0;
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "Benchmark failed: %s\n", e.what());
+        return -1;
+    }
+}
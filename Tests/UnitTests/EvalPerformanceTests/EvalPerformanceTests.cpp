@@ -0,0 +1,641 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// EvalPerformanceTests.cpp : a load generator for the evaluation APIs, reporting the latency distribution, throughput,
+// allocations and memory of a model at different concurrencies and batch sizes.
+//
+// Usage: evalperformancetests -model <file> [-api c|v2] [-mode share|clone|pooled|batching] [-device cpu|gpu[:<id>]]
+//                             [-threads 1,4,16] [-batchSizes 1,8] [-sequenceLength <n>] [-rate <requests/s>]
+//                             [-requests <n>] [-warmup <n>] [-maxWaitMicroseconds <n>] [-output <results.json>]
+//
+// Each combination of thread count and batch size is one run. Every thread repeatedly evaluates a request of batch size
+// sequences of sequenceLength random samples of each input:
+//   share, clone:      every thread evaluates its own clone of the model, sharing or copying the parameters;
+//   pooled, batching:  all threads call the one model loaded by CNTK_LoadPooledModel or CNTK_LoadBatchingModel
+//                      (C API only, one sequence per request).
+// With -rate 0 (the default) each thread sends its next request as soon as the previous one returns. Otherwise the
+// requests arrive at the given total rate with exponentially distributed gaps, and the latency of a request is measured
+// from its arrival, so that the time it waited for its thread is included.
+//
+
+#define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms  --add this at the top of all CPP files that give "function or variable may be unsafe" warnings
+
+#include "CNTKLibrary.h"
+#include "CNTKLibraryC.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <Psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+using namespace CNTK;
+
+// ---------------------------------------------------------------------------
+// allocation counting
+// ---------------------------------------------------------------------------
+
+// Counts the heap allocations of operator new. Where the library is linked against its own runtime (e.g. a DLL with a
+// static CRT), its allocations are not seen here.
+static atomic<uint64_t> s_numAllocations(0);
+static atomic<uint64_t> s_allocatedBytes(0);
+
+void* operator new(size_t size)
+{
+    s_numAllocations.fetch_add(1, memory_order_relaxed);
+    s_allocatedBytes.fetch_add(size, memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (!p)
+        throw bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+// ---------------------------------------------------------------------------
+// options and results
+// ---------------------------------------------------------------------------
+
+struct Options
+{
+    string m_modelPath;
+    string m_api = "v2";
+    string m_mode = "share";
+    bool m_useGpu = false;
+    unsigned int m_gpuId = 0;
+    vector<size_t> m_threads = { 1 };
+    vector<size_t> m_batchSizes = { 1 };
+    size_t m_sequenceLength = 1;
+    double m_rate = 0;                // total requests per second of all threads, 0 for back-to-back requests
+    size_t m_requests = 1000;         // measured requests per thread
+    size_t m_warmup = 20;             // unmeasured requests per thread
+    size_t m_maxWaitMicroseconds = 1000;
+    string m_outputPath;
+};
+
+struct Run
+{
+    size_t m_threads = 0;
+    size_t m_batchSize = 0;
+    string m_error;
+    double m_setupSeconds = 0;        // creating the clones or the serving model
+    double m_seconds = 0;             // of the measured requests
+    vector<double> m_latencies;       // in microseconds, sorted
+    uint64_t m_numAllocations = 0;    // during the measured requests
+    uint64_t m_allocatedBytes = 0;
+    size_t m_peakResidentMB = 0;
+    size_t m_deviceMemoryMB = 0;      // in use on the GPU after the run, by all processes
+};
+
+typedef chrono::steady_clock Clock;
+
+double Seconds(const Clock::duration& d)
+{
+    return chrono::duration<double>(d).count();
+}
+
+size_t PeakResidentMB()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize / (1024 * 1024);
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (size_t)usage.ru_maxrss / 1024;
+#endif
+}
+
+vector<float> RandomData(size_t size, mt19937& generator)
+{
+    uniform_real_distribution<float> distribution(0, 1);
+    vector<float> data(size);
+    for (auto& v : data)
+        v = distribution(generator);
+    return data;
+}
+
+// ---------------------------------------------------------------------------
+// clients: one per thread, evaluating one request per call
+// ---------------------------------------------------------------------------
+
+struct Client
+{
+    virtual ~Client() {}
+    virtual void Evaluate() = 0;
+};
+
+class V2Client : public Client
+{
+public:
+    V2Client(const FunctionPtr& model, size_t batchSize, size_t sequenceLength, const DeviceDescriptor& device, mt19937& generator)
+        : m_model(model), m_device(device)
+    {
+        for (const auto& input : m_model->Arguments())
+        {
+            vector<vector<float>> sequences;
+            for (size_t i = 0; i < batchSize; ++i)
+                sequences.push_back(RandomData(input.Shape().TotalSize() * sequenceLength, generator));
+            m_inputs[input] = Value::Create(input.Shape(), sequences, m_device, /*readOnly =*/ true);
+        }
+        for (const auto& output : m_model->Outputs())
+            m_outputs[output] = nullptr;
+    }
+
+    void Evaluate() override
+    {
+        // the values of the first call are reused as the buffers for the outputs of the following calls
+        m_model->Evaluate(m_inputs, m_outputs, m_device);
+    }
+
+private:
+    FunctionPtr m_model;
+    DeviceDescriptor m_device;
+    unordered_map<Variable, ValuePtr> m_inputs;
+    unordered_map<Variable, ValuePtr> m_outputs;
+};
+
+void CheckStatus(const CNTK_StatusCode& status, const char* call)
+{
+    if (status.value != CNTK_SUCCESS)
+        throw runtime_error(string(call) + " failed: " + status.description);
+}
+
+class CClient : public Client
+{
+public:
+    CClient(CNTK_ModelHandle model, bool ownsModel, size_t sequenceLength, mt19937& generator)
+        : m_model(model), m_ownsModel(ownsModel)
+    {
+        CheckStatus(CNTK_GetModelArgumentsInfo(m_model, &m_inputInfos, &m_numInputs), "CNTK_GetModelArgumentsInfo");
+        CheckStatus(CNTK_GetModelOutputsInfo(m_model, &m_outputInfos, &m_numOutputs), "CNTK_GetModelOutputsInfo");
+
+        m_shapes.resize(m_numInputs);
+        for (uint32_t i = 0; i < m_numInputs; ++i)
+        {
+            const auto& shape = m_inputInfos[i].shape;
+            m_shapes[i].assign(shape.value, shape.value + shape.size);
+            m_shapes[i].push_back((uint32_t)sequenceLength);
+            size_t size = 1;
+            for (auto d : m_shapes[i])
+                size *= d;
+            m_data.push_back(RandomData(size, generator));
+        }
+        for (uint32_t i = 0; i < m_numInputs; ++i)
+            m_inputValues.push_back(CNTK_Value{ CNTK_Shape{ m_shapes[i].data(), (uint32_t)m_shapes[i].size() }, m_data[i].data() });
+        m_resetFlags.reset(new bool[m_numInputs]);
+        fill(m_resetFlags.get(), m_resetFlags.get() + m_numInputs, true);
+    }
+
+    ~CClient()
+    {
+        if (m_outputValues)
+        {
+            for (uint32_t i = 0; i < m_numOutputs; ++i)
+                CNTK_CleanValue(&m_outputValues[i]);
+            CNTK_ReleaseArray(m_outputValues);
+        }
+        for (uint32_t i = 0; i < m_numInputs; ++i)
+            CNTK_CleanVariable(&m_inputInfos[i]);
+        CNTK_ReleaseArray(m_inputInfos);
+        for (uint32_t i = 0; i < m_numOutputs; ++i)
+            CNTK_CleanVariable(&m_outputInfos[i]);
+        CNTK_ReleaseArray(m_outputInfos);
+        if (m_ownsModel)
+            CNTK_ReleaseModel(m_model);
+    }
+
+    void Evaluate() override
+    {
+        // the outputs of the first call are allocated by the library; the following calls write into them
+        CheckStatus(CNTK_EvaluateSequence(m_model, m_inputInfos, m_inputValues.data(), m_resetFlags.get(), m_numInputs,
+                                          m_outputInfos, m_numOutputs, &m_outputValues), "CNTK_EvaluateSequence");
+    }
+
+private:
+    CNTK_ModelHandle m_model;
+    bool m_ownsModel;
+    CNTK_Variable* m_inputInfos = nullptr;
+    uint32_t m_numInputs = 0;
+    CNTK_Variable* m_outputInfos = nullptr;
+    uint32_t m_numOutputs = 0;
+    vector<vector<uint32_t>> m_shapes;
+    vector<vector<float>> m_data;
+    vector<CNTK_Value> m_inputValues;
+    unique_ptr<bool[]> m_resetFlags;
+    CNTK_Value* m_outputValues = nullptr;
+};
+
+// Loads the model once and creates the clients of a run.
+class ClientFactory
+{
+public:
+    explicit ClientFactory(const Options& options)
+        : m_options(options),
+          m_device(options.m_useGpu ? DeviceDescriptor::GPUDevice(options.m_gpuId) : DeviceDescriptor::CPUDevice())
+    {
+        wstring modelPath(options.m_modelPath.begin(), options.m_modelPath.end());
+        CNTK_DeviceDescriptor device{ options.m_useGpu ? CNTK_DeviceKind_GPU : CNTK_DeviceKind_CPU, options.m_useGpu ? options.m_gpuId : 0 };
+
+        auto start = Clock::now();
+        if (options.m_api == "v2")
+            m_v2Model = Function::Load(modelPath, m_device);
+        else if (options.m_mode == "share" || options.m_mode == "clone")
+            CheckStatus(CNTK_LoadModel(options.m_modelPath.c_str(), &device, &m_cModel), "CNTK_LoadModel");
+        m_loadSeconds = Seconds(Clock::now() - start);
+    }
+
+    ~ClientFactory()
+    {
+        if (m_cModel != CNTK_INVALID_MODEL_HANDLE)
+            CNTK_ReleaseModel(m_cModel);
+    }
+
+    double LoadSeconds() const { return m_loadSeconds; }
+
+    // A serving model loaded for the run, for the modes where the threads share one model; null otherwise.
+    CNTK_ModelHandle LoadServingModel(size_t numThreads, size_t batchSize) const
+    {
+        if (m_options.m_api != "c" || (m_options.m_mode != "pooled" && m_options.m_mode != "batching"))
+            return CNTK_INVALID_MODEL_HANDLE;
+
+        if (batchSize != 1)
+            throw runtime_error("With the C API a request is one sequence; use -batchSizes 1, or the batching mode to merge the requests of threads");
+
+        CNTK_DeviceDescriptor device{ m_options.m_useGpu ? CNTK_DeviceKind_GPU : CNTK_DeviceKind_CPU, m_options.m_useGpu ? m_options.m_gpuId : 0 };
+        CNTK_ModelHandle model = CNTK_INVALID_MODEL_HANDLE;
+        if (m_options.m_mode == "pooled")
+            CheckStatus(CNTK_LoadPooledModel(m_options.m_modelPath.c_str(), &device, (uint32_t)numThreads, &model), "CNTK_LoadPooledModel");
+        else
+            CheckStatus(CNTK_LoadBatchingModel(m_options.m_modelPath.c_str(), &device, (uint32_t)numThreads, (uint32_t)m_options.m_maxWaitMicroseconds, &model), "CNTK_LoadBatchingModel");
+        return model;
+    }
+
+    unique_ptr<Client> CreateClient(CNTK_ModelHandle servingModel, size_t batchSize, mt19937& generator) const
+    {
+        if (servingModel != CNTK_INVALID_MODEL_HANDLE)
+            return unique_ptr<Client>(new CClient(servingModel, /*ownsModel =*/ false, m_options.m_sequenceLength, generator));
+
+        bool share = (m_options.m_mode == "share");
+        if (m_v2Model)
+        {
+            auto clone = m_v2Model->Clone(share ? ParameterCloningMethod::Share : ParameterCloningMethod::Clone);
+            return unique_ptr<Client>(new V2Client(clone, batchSize, m_options.m_sequenceLength, m_device, generator));
+        }
+
+        if (batchSize != 1)
+            throw runtime_error("With the C API a request is one sequence; use -batchSizes 1");
+
+        CNTK_ModelHandle clone = CNTK_INVALID_MODEL_HANDLE;
+        CheckStatus(CNTK_CloneModel(m_cModel, share ? CNTK_ModelParameterShare : CNTK_ModelParameterClone, false, &clone), "CNTK_CloneModel");
+        return unique_ptr<Client>(new CClient(clone, /*ownsModel =*/ true, m_options.m_sequenceLength, generator));
+    }
+
+    const DeviceDescriptor& Device() const { return m_device; }
+
+private:
+    const Options& m_options;
+    DeviceDescriptor m_device;
+    FunctionPtr m_v2Model;
+    CNTK_ModelHandle m_cModel = CNTK_INVALID_MODEL_HANDLE;
+    double m_loadSeconds = 0;
+};
+
+// ---------------------------------------------------------------------------
+// load generation
+// ---------------------------------------------------------------------------
+
+Run RunLoad(const ClientFactory& factory, const Options& options, size_t numThreads, size_t batchSize)
+{
+    Run run;
+    run.m_threads = numThreads;
+    run.m_batchSize = batchSize;
+
+    CNTK_ModelHandle servingModel = CNTK_INVALID_MODEL_HANDLE;
+    try
+    {
+        auto setupStart = Clock::now();
+        servingModel = factory.LoadServingModel(numThreads, batchSize);
+        vector<unique_ptr<Client>> clients;
+        mt19937 generator(1);
+        for (size_t i = 0; i < numThreads; ++i)
+            clients.push_back(factory.CreateClient(servingModel, batchSize, generator));
+        run.m_setupSeconds = Seconds(Clock::now() - setupStart);
+
+        vector<vector<double>> latencies(numThreads);
+        vector<string> errors(numThreads);
+        atomic<size_t> numWarm(0);
+        atomic<bool> started(false);
+        uint64_t allocationsBefore = 0, bytesBefore = 0;
+        Clock::time_point start;
+
+        auto client = [&](size_t index) {
+            try
+            {
+                for (size_t i = 0; i < options.m_warmup; ++i)
+                    clients[index]->Evaluate();
+
+                // the last thread to warm up starts the measurement of all of them
+                if (++numWarm == numThreads)
+                {
+                    allocationsBefore = s_numAllocations.load();
+                    bytesBefore = s_allocatedBytes.load();
+                    start = Clock::now();
+                    started = true;
+                }
+                while (!started)
+                    this_thread::yield();
+
+                mt19937 arrivals((unsigned int)index + 1);
+                exponential_distribution<double> gap(options.m_rate > 0 ? options.m_rate / numThreads : 1);
+                auto arrival = start;
+                latencies[index].reserve(options.m_requests);
+                for (size_t i = 0; i < options.m_requests; ++i)
+                {
+                    if (options.m_rate > 0)
+                    {
+                        arrival += chrono::duration_cast<Clock::duration>(chrono::duration<double>(gap(arrivals)));
+                        this_thread::sleep_until(arrival);
+                    }
+                    else
+                        arrival = Clock::now();
+
+                    clients[index]->Evaluate();
+                    latencies[index].push_back(1e6 * Seconds(Clock::now() - arrival));
+                }
+            }
+            catch (const exception& e)
+            {
+                errors[index] = e.what();
+                // do not keep the other threads waiting for the measurement to start
+                if (++numWarm >= numThreads)
+                    started = true;
+            }
+        };
+
+        vector<thread> threads;
+        for (size_t i = 0; i < numThreads; ++i)
+            threads.emplace_back(client, i);
+        for (auto& t : threads)
+            t.join();
+        run.m_seconds = Seconds(Clock::now() - start);
+        run.m_numAllocations = s_numAllocations.load() - allocationsBefore;
+        run.m_allocatedBytes = s_allocatedBytes.load() - bytesBefore;
+
+        for (const auto& error : errors)
+        {
+            if (!error.empty())
+                throw runtime_error(error);
+        }
+
+        for (const auto& l : latencies)
+            run.m_latencies.insert(run.m_latencies.end(), l.begin(), l.end());
+        sort(run.m_latencies.begin(), run.m_latencies.end());
+        clients.clear();
+    }
+    catch (const exception& e)
+    {
+        run.m_error = e.what();
+    }
+
+    run.m_peakResidentMB = PeakResidentMB();
+    run.m_deviceMemoryMB = Internal::GetUsedDeviceMemoryInMB(factory.Device());
+    if (servingModel != CNTK_INVALID_MODEL_HANDLE)
+        CNTK_ReleaseModel(servingModel);
+    return run;
+}
+
+// ---------------------------------------------------------------------------
+// reporting
+// ---------------------------------------------------------------------------
+
+double Percentile(const vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[min(index, sorted.size() - 1)];
+}
+
+// Latency histogram with buckets of 1, 2 and 5 times the powers of ten microseconds, as [upper bound, count] pairs.
+string Histogram(const vector<double>& sorted)
+{
+    ostringstream json;
+    json << "[";
+    size_t begin = 0;
+    bool first = true;
+    for (double decade = 1; begin < sorted.size(); decade *= 10)
+    {
+        for (double step : { 1.0, 2.0, 5.0 })
+        {
+            double bound = decade * step;
+            size_t end = upper_bound(sorted.begin() + begin, sorted.end(), bound) - sorted.begin();
+            if (end > begin)
+            {
+                json << (first ? "" : ", ") << "[" << bound << ", " << (end - begin) << "]";
+                first = false;
+            }
+            begin = end;
+        }
+    }
+    json << "]";
+    return json.str();
+}
+
+string JsonEscape(const string& s)
+{
+    string escaped;
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += (c == '\n' || c == '\r' || c == '\t') ? ' ' : c;
+    }
+    return escaped;
+}
+
+string Report(const vector<Run>& runs, const Options& options, double loadSeconds)
+{
+    ostringstream json;
+    json << "{\n"
+         << "  \"model\": \"" << JsonEscape(options.m_modelPath) << "\",\n"
+         << "  \"api\": \"" << options.m_api << "\",\n"
+         << "  \"mode\": \"" << options.m_mode << "\",\n"
+         << "  \"device\": \"" << (options.m_useGpu ? "gpu:" + to_string(options.m_gpuId) : string("cpu")) << "\",\n"
+         << "  \"sequenceLength\": " << options.m_sequenceLength << ",\n"
+         << "  \"rate\": " << options.m_rate << ",\n"
+         << "  \"loadSeconds\": " << loadSeconds << ",\n"
+         << "  \"runs\": [";
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        const auto& r = runs[i];
+        json << (i ? "," : "") << "\n    { \"threads\": " << r.m_threads << ", \"batchSize\": " << r.m_batchSize;
+        if (!r.m_error.empty())
+            json << ", \"error\": \"" << JsonEscape(r.m_error) << "\"";
+        else
+        {
+            size_t numRequests = r.m_latencies.size();
+            double mean = 0;
+            for (auto l : r.m_latencies)
+                mean += l;
+            mean /= max<size_t>(numRequests, 1);
+
+            json << ", \"setupSeconds\": " << r.m_setupSeconds
+                 << ", \"requests\": " << numRequests
+                 << ", \"requestsPerSecond\": " << numRequests / r.m_seconds
+                 << ", \"sequencesPerSecond\": " << numRequests * r.m_batchSize / r.m_seconds
+                 << ",\n      \"latencyMicroseconds\": { \"mean\": " << mean
+                 << ", \"p50\": " << Percentile(r.m_latencies, 0.5)
+                 << ", \"p90\": " << Percentile(r.m_latencies, 0.9)
+                 << ", \"p99\": " << Percentile(r.m_latencies, 0.99)
+                 << ", \"p999\": " << Percentile(r.m_latencies, 0.999)
+                 << ", \"max\": " << (numRequests ? r.m_latencies.back() : 0) << " }"
+                 << ",\n      \"histogram\": " << Histogram(r.m_latencies)
+                 << ",\n      \"allocationsPerRequest\": " << (double)r.m_numAllocations / max<size_t>(numRequests, 1)
+                 << ", \"allocatedBytesPerRequest\": " << (double)r.m_allocatedBytes / max<size_t>(numRequests, 1);
+        }
+        json << ", \"peakResidentMB\": " << r.m_peakResidentMB << ", \"deviceMemoryMB\": " << r.m_deviceMemoryMB << " }";
+    }
+    json << "\n  ]\n}\n";
+    return json.str();
+}
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+
+vector<size_t> ParseList(const string& s)
+{
+    vector<size_t> values;
+    istringstream stream(s);
+    string value;
+    while (getline(stream, value, ','))
+    {
+        if (!value.empty())
+            values.push_back(stoul(value));
+    }
+    if (values.empty() || find(values.begin(), values.end(), 0) != values.end())
+        throw runtime_error("Expected a list of positive numbers instead of '" + s + "'");
+    return values;
+}
+
+Options ParseOptions(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        string option = argv[i];
+        auto value = [&]() {
+            if (i + 1 >= argc)
+                throw runtime_error("Missing the value of " + option);
+            return string(argv[++i]);
+        };
+
+        if (option == "-model")
+            options.m_modelPath = value();
+        else if (option == "-api")
+            options.m_api = value();
+        else if (option == "-mode")
+            options.m_mode = value();
+        else if (option == "-device")
+        {
+            string device = value();
+            options.m_useGpu = (device.compare(0, 3, "gpu") == 0);
+            if (options.m_useGpu && device.size() > 4)
+                options.m_gpuId = (unsigned int)stoul(device.substr(4));
+        }
+        else if (option == "-threads")
+            options.m_threads = ParseList(value());
+        else if (option == "-batchSizes")
+            options.m_batchSizes = ParseList(value());
+        else if (option == "-sequenceLength")
+            options.m_sequenceLength = stoul(value());
+        else if (option == "-rate")
+            options.m_rate = stod(value());
+        else if (option == "-requests")
+            options.m_requests = stoul(value());
+        else if (option == "-warmup")
+            options.m_warmup = stoul(value());
+        else if (option == "-maxWaitMicroseconds")
+            options.m_maxWaitMicroseconds = stoul(value());
+        else if (option == "-output")
+            options.m_outputPath = value();
+        else
+            throw runtime_error("Unknown option " + option);
+    }
+
+    if (options.m_modelPath.empty())
+        throw runtime_error("No model given; use -model <file>");
+    if (options.m_api != "c" && options.m_api != "v2")
+        throw runtime_error("The api must be c or v2");
+    if (options.m_mode != "share" && options.m_mode != "clone" && options.m_mode != "pooled" && options.m_mode != "batching")
+        throw runtime_error("The mode must be share, clone, pooled or batching");
+    if (options.m_api == "v2" && (options.m_mode == "pooled" || options.m_mode == "batching"))
+        throw runtime_error("The pooled and batching modes are only available with the C API");
+    if (options.m_requests == 0 || options.m_sequenceLength == 0)
+        throw runtime_error("The number of requests and the sequence length must be positive");
+    return options;
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        auto options = ParseOptions(argc, argv);
+        ClientFactory factory(options);
+
+        vector<Run> runs;
+        for (auto numThreads : options.m_threads)
+        {
+            for (auto batchSize : options.m_batchSizes)
+            {
+                fprintf(stderr, "Evaluating %d thread(s), batch size %d..\n", (int)numThreads, (int)batchSize);
+                runs.push_back(RunLoad(factory, options, numThreads, batchSize));
+                if (!runs.back().m_error.empty())
+                    fprintf(stderr, "Failed: %s\n", runs.back().m_error.c_str());
+                else
+                    fprintf(stderr, "p50 %.1f us, p99 %.1f us, %.1f requests/s\n", Percentile(runs.back().m_latencies, 0.5),
+                            Percentile(runs.back().m_latencies, 0.99), runs.back().m_latencies.size() / runs.back().m_seconds);
+            }
+        }
+
+        auto report = Report(runs, options, factory.LoadSeconds());
+        if (options.m_outputPath.empty())
+            printf("%s", report.c_str());
+        else
+            ofstream(options.m_outputPath) << report;
+
+        bool hasError = any_of(runs.begin(), runs.end(), [](const Run& r) { return !r.m_error.empty(); });
+        return hasError ? 1 : 0;
+    }
+    catch (const exception& e)
+    {
+        fprintf(stderr, "EXCEPTION occurred: %s\n", e.what());
+        return -1;
+    }
+}
@@ -227,6 +227,52 @@ BOOST_AUTO_TEST_CASE(EvalDenseTimesTest)
     eval->Destroy();
 }
 
+BOOST_AUTO_TEST_CASE(EvalBatchTest)
+{
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(4) \n"
+        "o1 = Times(Constant(2, rows=1, cols=4), i1, tag=\"output\") \n"
+        "FeatureNodes = (i1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float> *eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    // Two requests of different lengths in one forward pass
+    std::vector<Values<float>> inputs(2, Values<float>(1));
+    inputs[0][0].m_buffer = { 1, 2, 3, 4, 1, 1, 1, 1 };
+    inputs[1][0].m_buffer = { 0, 0, 0, 1 };
+    std::vector<Values<float>> outputs = { outputLayouts.CreateBuffers<float>({ 2 }), outputLayouts.CreateBuffers<float>({ 2 }) };
+    eval->ForwardPassBatch(inputs, outputs, true);
+
+    std::vector<float> expected0{ 20, 8 };
+    std::vector<float> expected1{ 2 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(outputs[0][0].m_buffer.begin(), outputs[0][0].m_buffer.end(), expected0.begin(), expected0.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(outputs[1][0].m_buffer.begin(), outputs[1][0].m_buffer.end(), expected1.begin(), expected1.end());
+
+    // A single request afterwards gets the layout of one sequence again
+    Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 1 });
+    eval->ForwardPass(inputs[1], outputBuffer);
+    BOOST_CHECK_EQUAL_COLLECTIONS(outputBuffer[0].m_buffer.begin(), outputBuffer[0].m_buffer.end(), expected1.begin(), expected1.end());
+
+    // The clone shares the parameters and evaluates the same
+    IEvaluateModelExtended<float>* clone = eval->CloneSharingParameters();
+    clone->StartForwardEvaluation({ outputLayouts[0].m_name });
+    Values<float> cloneOutputBuffer = outputLayouts.CreateBuffers<float>({ 2 });
+    clone->ForwardPass(inputs[0], cloneOutputBuffer);
+    BOOST_CHECK_EQUAL_COLLECTIONS(cloneOutputBuffer[0].m_buffer.begin(), cloneOutputBuffer[0].m_buffer.end(), expected0.begin(), expected0.end());
+
+    clone->Destroy();
+    eval->Destroy();
+}
+
 BOOST_AUTO_TEST_CASE(EvalSparseTimesTest)
 {
     std::string modelDefinition =
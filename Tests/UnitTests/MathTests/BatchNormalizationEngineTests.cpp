@@ -325,6 +325,70 @@ BOOST_AUTO_TEST_CASE(BatchNormalizationBackward)
     }
 }
 
+BOOST_AUTO_TEST_CASE(BatchNormalizationFusedRelu)
+{
+    std::mt19937 rng(0);
+    boost::random::normal_distribution<float> nd;
+
+    int deviceId = 0;
+    for (auto kind : {BatchNormEngineKind::Cntk, BatchNormEngineKind::CuDnn})
+    {
+        for (bool spatial : {false, true})
+        {
+            TensorShape inOutT(11, 11, 8);
+            size_t batchSize = 16;
+            double eps = 1e-5;
+
+            // the fused engine vs. the plain one followed by a ReLU
+            auto engFused = BNEng::Create(deviceId, inOutT, spatial, ImageLayoutKind::CHW, kind, /*reluOutput=*/true);
+            auto eng = BNEng::Create(deviceId, inOutT, spatial, ImageLayoutKind::CHW, kind);
+
+            size_t crow = inOutT.GetNumElements();
+            size_t crowScaleBias = spatial ? inOutT[inOutT.GetRank() - 1] : crow;
+            auto randomMat = [&](size_t r, size_t c)
+            {
+                vec buf(r * c);
+                std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+                return SingleMatrix(r, c, buf.data(), deviceId, matrixFlagNormal);
+            };
+            SingleMatrix x = randomMat(crow, batchSize);
+            SingleMatrix dy = randomMat(crow, batchSize);
+            SingleMatrix scale = randomMat(crowScaleBias, 1);
+            SingleMatrix bias = randomMat(crowScaleBias, 1);
+
+            SingleMatrix runMean(crowScaleBias, 1, deviceId), runVariance(crowScaleBias, 1, deviceId);
+            SingleMatrix runMeanExp(crowScaleBias, 1, deviceId), runVarianceExp(crowScaleBias, 1, deviceId);
+            runMean.SetValue(0);
+            runVariance.SetValue(1);
+            runMeanExp.SetValue(0);
+            runVarianceExp.SetValue(1);
+            SingleMatrix y(crow, batchSize, deviceId), yExp(crow, batchSize, deviceId);
+            SingleMatrix saveMean(deviceId), saveInvStdDev(deviceId), saveMeanExp(deviceId), saveInvStdDevExp(deviceId);
+
+            engFused->Forward(x, scale, bias, false, 1, 0, runMean, runVariance, y, eps, saveMean, saveInvStdDev);
+            eng->Forward(x, scale, bias, false, 1, 0, runMeanExp, runVarianceExp, yExp, eps, saveMeanExp, saveInvStdDevExp);
+            yExp.InplaceTruncateBottom(0);
+
+            std::string emsg;
+            BOOST_REQUIRE_MESSAGE(CheckEqual(y, yExp, emsg, Err<float>::Rel, Err<float>::Abs), "y of the fused ReLU is invalid. " << emsg);
+
+            SingleMatrix dx(crow, batchSize, deviceId), dxExp(crow, batchSize, deviceId);
+            SingleMatrix dScale(crowScaleBias, 1, deviceId), dBias(crowScaleBias, 1, deviceId);
+            SingleMatrix dScaleExp(crowScaleBias, 1, deviceId), dBiasExp(crowScaleBias, 1, deviceId);
+            SingleMatrix dyMasked(crow, batchSize, deviceId);
+            dyMasked.AssignLinearRectifierDerivativeOf(yExp);
+            dyMasked.ElementMultiplyWith(dy);
+
+            engFused->Backward(x, dy, dx, scale, 0, saveMean, saveInvStdDev, dScale, dBias, false, &bias, &y);
+            eng->Backward(x, dyMasked, dxExp, scale, 0, saveMeanExp, saveInvStdDevExp, dScaleExp, dBiasExp, false);
+
+            BOOST_REQUIRE_MESSAGE(CheckEqual(dx, dxExp, emsg, Err<float>::Rel * 16, Err<float>::Abs * 64), "dx of the fused ReLU is invalid. " << emsg);
+            BOOST_REQUIRE_MESSAGE(CheckEqual(dScale, dScaleExp, emsg, Err<float>::Rel * 88, Err<float>::Abs * 16), "dScale of the fused ReLU is invalid. " << emsg);
+            BOOST_REQUIRE_MESSAGE(CheckEqual(dBias, dBiasExp, emsg, Err<float>::Rel * 88, Err<float>::Abs * 16), "dBias of the fused ReLU is invalid. " << emsg);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
@@ -0,0 +1,74 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "../../../Source/Math/BlockSparseOperations.h"
+#include <random>
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(BlockSparseOperationsUnitTests)
+
+BOOST_FIXTURE_TEST_CASE(BlockPruningMasksSmallestBlocks, RandomSeedFixture)
+{
+    // [6 x 3] in blocks of 4 x 2, so that the blocks at the edges are smaller: the L1 norms of the 2 x 2 blocks are
+    // 4, 16 (top) and 1, 2 (bottom), with the bottom right block a single column
+    size_t m = 6, k = 3;
+    std::vector<float> A = { 1, 1, 1, 1, 0.25f, 0.25f,
+                             0, 0, 0, 0, 0.25f, 0.25f,
+                             4, -4, 4, -4, 1, -1 };
+    std::vector<float> mask(m * k);
+
+    BOOST_CHECK_EQUAL(BlockPruningMask(m, k, A.data(), 4, 2, 0.5, mask.data()), 2);
+    std::vector<float> expected = { 1, 1, 1, 1, 0, 0,
+                                    1, 1, 1, 1, 0, 0,
+                                    1, 1, 1, 1, 0, 0 };
+    // the top left block (norm 4) is kept against the bottom right one (norm 2)
+    for (size_t i = 0; i < m * k; i++)
+        BOOST_CHECK_EQUAL(mask[i], expected[i]);
+
+    BOOST_CHECK_EQUAL(BlockPruningMask(m, k, A.data(), 4, 2, 0, mask.data()), 0);
+    for (auto v : mask)
+        BOOST_CHECK_EQUAL(v, 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(MultiplyBlockSparseMatchesDenseProduct, RandomSeedFixture)
+{
+    // A[m,k]*B[k,n] = C[m,n], with sizes that are not multiples of the block sizes and the column tiles
+    int m = 70, n = 19, k = 37;
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<double> dist(-2.0, 2.0);
+    std::vector<double> A(m * k), B(k * n), C(m * n), mask(m * k);
+    for (auto& a : A)
+        a = dist(rng);
+    for (auto& b : B)
+        b = dist(rng);
+
+    const size_t blockSizes[][2] = { { 4, 1 }, { 16, 16 }, { 3, 2 } };
+    for (const auto& blockSize : blockSizes)
+    {
+        std::vector<double> prunedA(A);
+        BlockPruningMask(m, k, A.data(), blockSize[0], blockSize[1], 0.8, mask.data());
+        for (size_t i = 0; i < prunedA.size(); i++)
+            prunedA[i] *= mask[i];
+
+        BlockSparseMultiplier<double> mult(blockSize[0], blockSize[1]);
+        BOOST_CHECK_LE(mult.Prepare(m, k, prunedA.data()), 0.21);
+        mult.Multiply(m, n, k, prunedA.data(), B.data(), C.data());
+
+        for (int i = 0; i < m; i++)
+            for (int j = 0; j < n; j++)
+            {
+                double expected = 0;
+                for (int l = 0; l < k; l++)
+                    expected += prunedA[i + l * m] * B[l + j * k];
+                BOOST_CHECK_SMALL(C[i + j * m] - expected, 1e-10);
+            }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
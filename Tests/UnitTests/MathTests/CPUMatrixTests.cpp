@@ -4,6 +4,7 @@
 //
 #include "stdafx.h"
 #include "../../../Source/Math/CPUMatrix.h"
+#include "../../../Source/Math/NumaPolicy.h"
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -1215,6 +1216,124 @@ BOOST_FIXTURE_TEST_CASE(CPUMatrixGatherFromTarget, RandomSeedFixture)
     BOOST_CHECK(m2.IsEqualTo(expect, 1e-6));
 }
 
+// c = 0.5 * op(a) * op(b) + 0.25 * c of a 16-bit type against the float product of the same values,
+// within an absolute tolerance plus relRounding times the magnitude of the result, for its rounding
+template <class ElemType>
+static void TestMultiplyAndWeightedAddInFloat(unsigned long counter, float relRounding)
+{
+    // larger than one tile of the 16-bit product in each dimension
+    const size_t m = 300;
+    const size_t k = 700;
+    const size_t n = 270;
+
+    for (int transposeA = 0; transposeA < 2; transposeA++)
+    {
+        for (int transposeB = 0; transposeB < 2; transposeB++)
+        {
+            SMatrix af(transposeA ? k : m, transposeA ? m : k);
+            SMatrix bf(transposeB ? n : k, transposeB ? k : n);
+            SMatrix cf(m, n);
+            af.SetUniformRandomValue(-1, 1, counter++);
+            bf.SetUniformRandomValue(-1, 1, counter++);
+            cf.SetUniformRandomValue(-1, 1, counter++);
+
+            // the float product of the same values is the reference
+            CPUMatrix<ElemType> a(af.GetNumRows(), af.GetNumCols());
+            CPUMatrix<ElemType> b(bf.GetNumRows(), bf.GetNumCols());
+            CPUMatrix<ElemType> c(m, n);
+            for (size_t i = 0; i < af.GetNumElements(); i++)
+                af.Data()[i] = (float)(a.Data()[i] = (ElemType)af.Data()[i]);
+            for (size_t i = 0; i < bf.GetNumElements(); i++)
+                bf.Data()[i] = (float)(b.Data()[i] = (ElemType)bf.Data()[i]);
+            for (size_t i = 0; i < cf.GetNumElements(); i++)
+                cf.Data()[i] = (float)(c.Data()[i] = (ElemType)cf.Data()[i]);
+
+            CPUMatrix<ElemType>::MultiplyAndWeightedAdd(0.5f, a, transposeA != 0, b, transposeB != 0, 0.25f, c);
+            SMatrix::MultiplyAndWeightedAdd(0.5f, af, transposeA != 0, bf, transposeB != 0, 0.25f, cf);
+
+            for (size_t i = 0; i < cf.GetNumElements(); i++)
+                BOOST_CHECK_SMALL((float)c.Data()[i] - cf.Data()[i], 0.01f + relRounding * abs(cf.Data()[i]));
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUMatrixHalfMultiplyAndWeightedAdd, RandomSeedFixture)
+{
+    TestMultiplyAndWeightedAddInFloat<half>(IncrementCounter(), 0.002f);
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUMatrixBFloat16MultiplyAndWeightedAdd, RandomSeedFixture)
+{
+    // bfloat16 has 8 bits of significand against the 11 bits of half
+    TestMultiplyAndWeightedAddInFloat<bfloat16>(IncrementCounter(), 0.008f);
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUMatrixBFloat16Conversion, RandomSeedFixture)
+{
+    // the conversion rounds to the nearest, ties to even, and keeps the range of float
+    BOOST_CHECK_EQUAL((float)(bfloat16)1.0f, 1.0f);
+    BOOST_CHECK_EQUAL((float)(bfloat16)(1.0f + 1.0f / 256), 1.0f);
+    BOOST_CHECK_EQUAL((float)(bfloat16)(1.0f + 3.0f / 256), 1.0f + 4.0f / 256);
+    BOOST_CHECK(abs((float)(bfloat16)1e30f - 1e30f) < 1e30f / 128);
+    BOOST_CHECK(std::isnan((float)(bfloat16)std::numeric_limits<float>::quiet_NaN()));
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUMatrixNumaPlacedAllocation, RandomSeedFixture)
+{
+    // the policies must not change the zero initialization, whatever the number of NUMA nodes
+    for (auto kind : { NumaPolicyKind::FirstTouch, NumaPolicyKind::Interleave, NumaPolicyKind::NodeLocal })
+    {
+        NumaPolicy::Set(kind, kind == NumaPolicyKind::NodeLocal ? 0 : -1);
+        BOOST_CHECK(NumaPolicy::IsActive());
+
+        SMatrix m(1023, 517); // above NumaPolicy::MinBytes, and not a multiple of the page size
+        for (size_t i = 0; i < m.GetNumElements(); i++)
+            BOOST_CHECK_EQUAL(m.Data()[i], 0.0f);
+
+        m.SetValue(1.0f);
+        SMatrix m2(m);
+        BOOST_CHECK(m2.IsEqualTo(m));
+    }
+    NumaPolicy::Set(NumaPolicyKind::None);
+    BOOST_CHECK(!NumaPolicy::IsActive());
+    BOOST_CHECK(NumaPolicy::Parse(L"firstTouch") == NumaPolicyKind::FirstTouch);
+    BOOST_CHECK_THROW(NumaPolicy::Parse(L"everywhere"), std::invalid_argument);
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUMatrixHugePageAllocation, RandomSeedFixture)
+{
+    // whether or not the system grants the mappings, the storage must be zeroed and usable, and the buffers accounted for
+    HugePages::Set(HugePageKind::Transparent, HugePages::DefaultMinBytes);
+    auto before = HugePages::GetStats();
+    {
+        SMatrix m(1024, 1025); // a bit above 4 MB
+        auto during = HugePages::GetStats();
+        BOOST_CHECK_EQUAL(during.numAllocations + during.numFallbacks, before.numAllocations + before.numFallbacks + 1);
+        if (during.numAllocations > before.numAllocations)
+        {
+            BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(m.Data()) % HugePages::DefaultMinBytes, 0);
+            BOOST_CHECK(during.transparentBytes >= before.transparentBytes + m.GetNumElements() * sizeof(float));
+        }
+        for (size_t i = 0; i < m.GetNumElements(); i++)
+            BOOST_CHECK_EQUAL(m.Data()[i], 0.0f);
+
+        m.SetValue(2.0f);
+        m.Resize(2048, 1025); // reallocated through the huge page path, the old mapping is released
+        m.SetValue(3.0f);
+        SMatrix m2(m);
+        BOOST_CHECK(m2.IsEqualTo(m));
+
+        SMatrix small(10, 10); // below the threshold, left to the heap
+        BOOST_CHECK_EQUAL(small(9, 9), 0.0f);
+    }
+    BOOST_CHECK_EQUAL(HugePages::GetStats().transparentBytes, before.transparentBytes);
+
+    HugePages::Set(HugePageKind::None);
+    BOOST_CHECK(HugePages::GetKind() == HugePageKind::None);
+    BOOST_CHECK(HugePages::Parse(L"explicit") == HugePageKind::Explicit);
+    BOOST_CHECK_THROW(HugePages::Parse(L"giant"), std::invalid_argument);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
 } } }
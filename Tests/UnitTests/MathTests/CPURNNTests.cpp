@@ -0,0 +1,244 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "../../../Source/Math/Matrix.h"
+#include "../../../Source/Math/RNNCommon.h"
+#include "common.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// the sequences in the data layout of OptimizedRNNStackNode::PackSequencesForCuDNN(): frame by frame, longest sequence first
+struct PackedSequences
+{
+    std::vector<size_t> lengths; // decreasing
+    std::vector<size_t> numSequencesForFrame;
+
+    PackedSequences(const std::vector<size_t>& lengths) : lengths(lengths)
+    {
+        for (size_t t = 0; t < lengths[0]; t++)
+            numSequencesForFrame.push_back(std::count_if(lengths.begin(), lengths.end(), [t](size_t len) { return len > t; }));
+    }
+
+    size_t Column(size_t seq, size_t t) const
+    {
+        return std::accumulate(numSequencesForFrame.begin(), numSequencesForFrame.begin() + t, (size_t)0) + seq;
+    }
+
+    size_t NumColumns() const { return std::accumulate(lengths.begin(), lengths.end(), (size_t)0); }
+};
+
+static float Sigmoid(float x) { return 1 / (1 + exp(-x)); }
+
+// One sequence at a time, straight from the cuDNN equations, on weights in the cuDNN layout (see CPURNN.h).
+static std::vector<float> ReferenceRNN(const std::vector<float>& w, const std::vector<float>& x, const PackedSequences& packed,
+                                       size_t xDim, size_t hiddenSize, size_t numLayers, bool bidirectional, const std::wstring& op)
+{
+    const size_t H = hiddenSize, numDirections = bidirectional ? 2 : 1;
+    const size_t numGates = op == L"lstm" ? 4 : op == L"gru" ? 3 : 1;
+    const size_t yDim = numDirections * H;
+
+    // offsets of the weights and biases of each layer and direction
+    std::vector<size_t> wxOffset, whOffset, bOffset, inDims;
+    size_t offset = 0;
+    for (size_t l = 0; l < numLayers; l++)
+        for (size_t d = 0; d < numDirections; d++)
+        {
+            inDims.push_back(l == 0 ? xDim : yDim);
+            wxOffset.push_back(offset); offset += numGates * H * inDims.back();
+            whOffset.push_back(offset); offset += numGates * H * H;
+        }
+    for (size_t l = 0; l < numLayers * numDirections; l++)
+    {
+        bOffset.push_back(offset); offset += 2 * numGates * H;
+    }
+    BOOST_REQUIRE_EQUAL(offset, w.size());
+
+    std::vector<float> y(yDim * packed.NumColumns());
+    for (size_t seq = 0; seq < packed.lengths.size(); seq++)
+    {
+        const size_t len = packed.lengths[seq];
+        std::vector<std::vector<float>> input(len);
+        for (size_t t = 0; t < len; t++)
+            input[t].assign(x.begin() + packed.Column(seq, t) * xDim, x.begin() + (packed.Column(seq, t) + 1) * xDim);
+
+        for (size_t l = 0; l < numLayers; l++)
+        {
+            std::vector<std::vector<float>> output(len, std::vector<float>(yDim));
+            for (size_t d = 0; d < numDirections; d++)
+            {
+                const size_t p = l * numDirections + d, inDim = inDims[p];
+                // gate g of unit k: W[g][k] . in + bW[g][k]
+                auto linear = [&](size_t base, size_t numInputs, size_t g, size_t k, const std::vector<float>& in, size_t bias)
+                {
+                    float sum = w[bias + g * H + k];
+                    for (size_t i = 0; i < numInputs; i++)
+                        sum += w[base + (g * H + k) * numInputs + i] * in[i];
+                    return sum;
+                };
+                std::vector<float> h(H, 0), c(H, 0);
+                for (size_t s = 0; s < len; s++)
+                {
+                    const size_t t = d == 0 ? s : len - 1 - s;
+                    std::vector<float> newH(H);
+                    for (size_t k = 0; k < H; k++)
+                    {
+                        auto pre = [&](size_t g) { return linear(wxOffset[p], inDim, g, k, input[t], bOffset[p]) + linear(whOffset[p], H, g, k, h, bOffset[p] + numGates * H); };
+                        if (op == L"lstm")
+                        {
+                            c[k] = Sigmoid(pre(1)) * c[k] + Sigmoid(pre(0)) * tanh(pre(2));
+                            newH[k] = Sigmoid(pre(3)) * tanh(c[k]);
+                        }
+                        else if (op == L"gru")
+                        {
+                            float r = Sigmoid(pre(0)), z = Sigmoid(pre(1));
+                            float candidate = tanh(linear(wxOffset[p], inDim, 2, k, input[t], bOffset[p]) + r * linear(whOffset[p], H, 2, k, h, bOffset[p] + numGates * H));
+                            newH[k] = (1 - z) * candidate + z * h[k];
+                        }
+                        else if (op == L"rnnReLU")
+                            newH[k] = std::max(pre(0), 0.0f);
+                        else
+                            newH[k] = tanh(pre(0));
+                    }
+                    h = newH;
+                    std::copy(h.begin(), h.end(), output[t].begin() + d * H);
+                }
+            }
+            input = output;
+        }
+        for (size_t t = 0; t < len; t++)
+            std::copy(input[t].begin(), input[t].end(), y.begin() + packed.Column(seq, t) * yDim);
+    }
+    return y;
+}
+
+BOOST_AUTO_TEST_SUITE(CPURNNSuite)
+
+BOOST_FIXTURE_TEST_CASE(RNNForwardMatchesReference, RandomSeedFixture)
+{
+    std::mt19937 rng(IncrementCounter());
+    std::uniform_real_distribution<float> uniform(-0.5f, 0.5f);
+
+    const size_t xDim = 5, hiddenSize = 4;
+    PackedSequences packed({ 6, 4, 4, 2, 1 });
+    std::vector<float> x(xDim * packed.NumColumns());
+    for (auto& v : x)
+        v = uniform(rng);
+    SingleMatrix inputX(xDim, packed.NumColumns(), x.data(), CPUDEVICE);
+
+    for (const std::wstring op : { L"lstm", L"gru", L"rnnReLU", L"rnnTanh" })
+        for (size_t numLayers : { 1, 3 })
+            for (bool bidirectional : { false, true })
+            {
+                RnnAttributes attributes(bidirectional, numLayers, hiddenSize, op, -1);
+                auto numParameters = attributes.GetNumParameters(xDim);
+                std::vector<float> w(numParameters.first * numParameters.second);
+                for (auto& v : w)
+                    v = uniform(rng);
+                SingleMatrix paramW(numParameters.first, numParameters.second, w.data(), CPUDEVICE);
+
+                const size_t yDim = (bidirectional ? 2 : 1) * hiddenSize;
+                SingleMatrix outputY(CPUDEVICE), reserve(CPUDEVICE), workspace(CPUDEVICE);
+                outputY.RNNForward(inputX, paramW, xDim, yDim, packed.numSequencesForFrame, attributes, reserve, workspace);
+
+                auto expected = ReferenceRNN(w, x, packed, xDim, hiddenSize, numLayers, bidirectional, op);
+                SingleMatrix reference(yDim, packed.NumColumns(), expected.data(), CPUDEVICE);
+                std::string msg;
+                BOOST_REQUIRE_EQUAL(outputY.GetNumRows(), yDim);
+                BOOST_REQUIRE_EQUAL(outputY.GetNumCols(), packed.NumColumns());
+                BOOST_CHECK_MESSAGE(CheckEqual(outputY, reference, msg, 1e-4f, 1e-5f),
+                                    msg << ", op " << std::string(op.begin(), op.end()) << ", " << numLayers << " layers, bidirectional " << bidirectional);
+            }
+}
+
+// With the recurrent weights kept on chip: few enough sequences for the persistent steps on the CPU, and the persistent
+// algorithm of cuDNN on GPUs that support it.
+BOOST_FIXTURE_TEST_CASE(RNNForwardPersistentMatchesReference, RandomSeedFixture)
+{
+    std::mt19937 rng(IncrementCounter());
+    std::uniform_real_distribution<float> uniform(-0.5f, 0.5f);
+
+    const size_t xDim = 5, hiddenSize = 9;
+    PackedSequences packed({ 7, 4, 1 });
+    std::vector<float> x(xDim * packed.NumColumns());
+    for (auto& v : x)
+        v = uniform(rng);
+
+    std::vector<DEVICEID_TYPE> deviceIds = { CPUDEVICE };
+#ifndef CPUONLY
+    deviceIds.push_back(0);
+#endif
+    for (const std::wstring op : { L"lstm", L"gru", L"rnnReLU", L"rnnTanh" })
+        for (bool bidirectional : { false, true })
+        {
+            RnnAttributes attributes(bidirectional, 2, hiddenSize, op, -1);
+            attributes.m_persistent = true;
+            auto numParameters = attributes.GetNumParameters(xDim);
+            std::vector<float> w(numParameters.first * numParameters.second);
+            for (auto& v : w)
+                v = uniform(rng);
+
+            const size_t yDim = (bidirectional ? 2 : 1) * hiddenSize;
+            auto expected = ReferenceRNN(w, x, packed, xDim, hiddenSize, 2, bidirectional, op);
+            SingleMatrix reference(yDim, packed.NumColumns(), expected.data(), CPUDEVICE);
+            for (DEVICEID_TYPE deviceId : deviceIds)
+            {
+                SingleMatrix inputX(xDim, packed.NumColumns(), x.data(), deviceId);
+                SingleMatrix paramW(numParameters.first, numParameters.second, w.data(), deviceId);
+                SingleMatrix outputY(yDim, packed.NumColumns(), deviceId), reserve(deviceId), workspace(deviceId);
+                outputY.RNNForward(inputX, paramW, xDim, yDim, packed.numSequencesForFrame, attributes, reserve, workspace);
+                outputY.TransferToDeviceIfNotThere(CPUDEVICE, true);
+                std::string msg;
+                BOOST_CHECK_MESSAGE(CheckEqual(outputY, reference, msg, 1e-3f, 1e-4f),
+                                    msg << ", op " << std::string(op.begin(), op.end()) << ", bidirectional " << bidirectional << ", device " << deviceId);
+            }
+        }
+}
+
+#ifndef CPUONLY
+BOOST_FIXTURE_TEST_CASE(RNNForwardMatchesCuDnn, RandomSeedFixture)
+{
+    std::mt19937 rng(IncrementCounter());
+    std::uniform_real_distribution<float> uniform(-0.5f, 0.5f);
+
+    const size_t xDim = 7, hiddenSize = 6;
+    PackedSequences packed({ 5, 5, 3, 1 });
+    std::vector<float> x(xDim * packed.NumColumns());
+    for (auto& v : x)
+        v = uniform(rng);
+
+    for (const std::wstring op : { L"lstm", L"gru", L"rnnReLU", L"rnnTanh" })
+        for (bool bidirectional : { false, true })
+        {
+            RnnAttributes attributes(bidirectional, 2, hiddenSize, op, -1);
+            auto numParameters = attributes.GetNumParameters(xDim);
+            std::vector<float> w(numParameters.first * numParameters.second);
+            for (auto& v : w)
+                v = uniform(rng);
+
+            const size_t yDim = (bidirectional ? 2 : 1) * hiddenSize;
+            SingleMatrix outputs[2] = { SingleMatrix(CPUDEVICE), SingleMatrix(0) };
+            for (auto& outputY : outputs)
+            {
+                const DEVICEID_TYPE deviceId = outputY.GetDeviceId();
+                SingleMatrix inputX(xDim, packed.NumColumns(), x.data(), deviceId);
+                SingleMatrix paramW(numParameters.first, numParameters.second, w.data(), deviceId);
+                SingleMatrix reserve(deviceId), workspace(deviceId);
+                outputY.Resize(yDim, packed.NumColumns());
+                outputY.RNNForward(inputX, paramW, xDim, yDim, packed.numSequencesForFrame, attributes, reserve, workspace);
+            }
+            std::string msg;
+            BOOST_CHECK_MESSAGE(CheckEqual(outputs[0], outputs[1], msg, 1e-3f, 1e-4f),
+                                msg << ", op " << std::string(op.begin(), op.end()) << ", bidirectional " << bidirectional);
+        }
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
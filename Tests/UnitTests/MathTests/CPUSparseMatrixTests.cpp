@@ -116,6 +116,85 @@ BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixMultiplyAndAdd, RandomSeedFixture)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixMultiplyAndWeightedAddMatchesDense, RandomSeedFixture)
+{
+    const size_t m = 40;
+    const size_t k = 60;
+    const size_t n = 30;
+
+    auto randomSparse = [this](size_t numRows, size_t numCols, DenseMatrix& dense, SparseMatrix& sparse)
+    {
+        dense.Resize(numRows, numCols);
+        dense.SetUniformRandomValue(-10, 1, IncrementCounter());
+        dense.InplaceTruncateBottom(0);
+        sparse = SparseMatrix(MatrixFormat::matrixFormatSparseCSC, numRows, numCols, 0);
+        foreach_coord(row, col, dense)
+        {
+            if (dense(row, col) != 0)
+                sparse.SetValue(row, col, dense(row, col));
+        }
+    };
+
+    for (int transposeA = 0; transposeA < 2; transposeA++)
+    {
+        for (int transposeB = 0; transposeB < 2; transposeB++)
+        {
+            // dense * sparse, the products with the transposed sparse matrix access it by rows
+            DenseMatrix a(transposeA ? k : m, transposeA ? m : k);
+            a.SetUniformRandomValue(-1, 1, IncrementCounter());
+            DenseMatrix bDense;
+            SparseMatrix b(MatrixFormat::matrixFormatSparseCSC);
+            DenseMatrix c(m, n);
+            c.SetUniformRandomValue(-1, 1, IncrementCounter());
+            DenseMatrix cExpected(c);
+
+            // the second product uses a different sparsity pattern in the same matrix
+            for (int pass = 0; pass < 2; pass++)
+            {
+                randomSparse(transposeB ? n : k, transposeB ? k : n, bDense, b);
+                SparseMatrix::MultiplyAndWeightedAdd(0.5, a, transposeA != 0, b, transposeB != 0, 0.25, c);
+                DenseMatrix::MultiplyAndWeightedAdd(0.5, a, transposeA != 0, bDense, transposeB != 0, 0.25, cExpected);
+                BOOST_CHECK(c.IsEqualTo(cExpected, c_epsilonFloatE4));
+            }
+
+            // sparse * dense
+            DenseMatrix aDense;
+            SparseMatrix aSparse(MatrixFormat::matrixFormatSparseCSC);
+            randomSparse(transposeA ? k : m, transposeA ? m : k, aDense, aSparse);
+            DenseMatrix d(transposeB ? n : k, transposeB ? k : n);
+            d.SetUniformRandomValue(-1, 1, IncrementCounter());
+            DenseMatrix e(m, n);
+            e.SetUniformRandomValue(-1, 1, IncrementCounter());
+            DenseMatrix eExpected(e);
+            SparseMatrix::MultiplyAndWeightedAdd(0.5, aSparse, transposeA != 0, d, transposeB != 0, 0.25, e);
+            DenseMatrix::MultiplyAndWeightedAdd(0.5, aDense, transposeA != 0, d, transposeB != 0, 0.25, eExpected);
+            BOOST_CHECK(e.IsEqualTo(eExpected, c_epsilonFloatE4));
+        }
+    }
+
+    // column slice views, also into a SparseBlockCol result
+    DenseMatrix a(m, n);
+    a.SetUniformRandomValue(-1, 1, IncrementCounter());
+    DenseMatrix bDense;
+    SparseMatrix b(MatrixFormat::matrixFormatSparseCSC);
+    randomSparse(k, n + 20, bDense, b);
+    DenseMatrix bSliceDense = bDense.ColumnSlice(10, n);
+    SparseMatrix bSlice = b.ColumnSlice(10, n);
+
+    DenseMatrix cExpected(m, k);
+    DenseMatrix::MultiplyAndWeightedAdd(1, a, false, bSliceDense, true, 0, cExpected);
+    DenseMatrix c(m, k);
+    SparseMatrix::MultiplyAndWeightedAdd(1, a, false, bSlice, true, 0, c);
+    BOOST_CHECK(c.IsEqualTo(cExpected, c_epsilonFloatE4));
+
+    SparseMatrix cBlocks(MatrixFormat::matrixFormatSparseBlockCol, m, k, 0);
+    SparseMatrix::MultiplyAndAdd(1, a, false, bSlice, true, cBlocks);
+    foreach_coord(row, col, cExpected)
+    {
+        BOOST_CHECK(abs(cBlocks(row, col) - cExpected(row, col)) < c_epsilonFloatE4);
+    }
+}
+
 BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixDoGatherColumnsOf, RandomSeedFixture)
 {
     const size_t m = 100;
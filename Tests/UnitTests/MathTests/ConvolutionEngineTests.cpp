@@ -17,6 +17,7 @@
 #include "../../../Source/Math/GPUMatrix.h"
 #include "../../../Source/Math/ConvolutionEngine.h"
 #include "../../../Source/Math/CuDnnFactories.h"
+#include "../../../Source/Math/CuDnnAlgorithmCache.h"
 #include "common.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
@@ -642,6 +643,383 @@ BOOST_AUTO_TEST_CASE(MaxUnpooling)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ConvolutionForwardFused)
+{
+    std::mt19937 rng(0);
+    boost::random::uniform_int_distribution<> batchSizeG(1, 8);
+    boost::random::normal_distribution<float> nd;
+
+    int cpuDeviceId = -1;
+    for (auto engKind : { ConvolutionEngineKind::Reference, ConvolutionEngineKind::Gemm })
+    {
+        for (const auto& g : GenerateConvTestConfigs())
+        {
+            // the epilogue is per output map, which must be the last output dimension
+            const auto& outShape = g->OutputShape();
+            size_t mapCount = g->KernelCount();
+            const auto& sharing = g->Sharing();
+            if (outShape[outShape.GetRank() - 1] != mapCount || std::find(begin(sharing), end(sharing), false) != end(sharing))
+                continue;
+
+            auto eng = ConvEng::Create(g, cpuDeviceId, ImageLayoutKind::CHW, 3, PoolKind::None, engKind);
+
+            size_t n = batchSizeG(rng);
+            vec buf(g->InputShape().GetNumElements() * n);
+            std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+            SingleMatrix in(g->InputShape().GetNumElements(), n, buf.data(), cpuDeviceId, matrixFlagNormal);
+
+            size_t inMapCount = g->GetMapCount(g->InputShape().GetRank() - 1);
+            buf.resize(g->KernelShape().GetNumElements() * inMapCount);
+            std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+            SingleMatrix kernel(inMapCount, g->KernelShape().GetNumElements(), buf.data(), cpuDeviceId, matrixFlagNormal);
+
+            vec scale(mapCount), shift(mapCount);
+            std::generate(begin(scale), end(scale), [&] { return nd(rng); });
+            std::generate(begin(shift), end(shift), [&] { return nd(rng); });
+
+            size_t crowOut = outShape.GetNumElements();
+            SingleMatrix workspace(cpuDeviceId);
+            SingleMatrix expected(crowOut, n, cpuDeviceId);
+            eng->Forward(in, kernel, expected, workspace);
+
+            std::stringstream tmsg;
+            tmsg << "Geometry: " << (std::string)(*g) << ", Batch: " << n << ", Engine: " << (int)engKind;
+            std::string msg = " are not equal, " + tmsg.str();
+            std::string emsg;
+
+            // bias + ReLU, and batch normalization (scale and shift) without ReLU
+            for (bool withScale : { false, true })
+            {
+                ConvolutionEpilogue<float> epilogue;
+                epilogue.scale = withScale ? scale.data() : nullptr;
+                epilogue.shift = shift.data();
+                epilogue.relu = !withScale;
+
+                SingleMatrix ref(expected.DeepClone(), cpuDeviceId);
+                float* data = ref.Data();
+                size_t mapSize = crowOut / mapCount;
+                for (size_t i = 0; i < crowOut * n; i++)
+                {
+                    size_t k = (i % crowOut) / mapSize;
+                    float v = data[i] * (withScale ? scale[k] : 1) + shift[k];
+                    data[i] = epilogue.relu ? std::max(v, 0.0f) : v;
+                }
+
+                SingleMatrix out(crowOut, n, cpuDeviceId);
+                eng->ForwardFused(in, kernel, out, workspace, epilogue);
+                BOOST_REQUIRE_MESSAGE(CheckEqual(out, ref, emsg, Err<float>::Rel * 4, Err<float>::Abs * 14), "out" << msg << ". " << emsg);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ConvolutionForwardWinograd)
+{
+    std::mt19937 rng(0);
+    boost::random::uniform_int_distribution<> batchSizeG(1, 8);
+    boost::random::normal_distribution<float> nd;
+
+    // 3x3 convolutions with stride 1: maps smaller and larger than the F(4x4,3x3) threshold, with and without padding
+    std::vector<ConvolveGeometryPtr> geometries;
+    for (auto inSize : { std::make_pair(3, 3), std::make_pair(5, 7), std::make_pair(8, 8), std::make_pair(13, 11), std::make_pair(16, 16) })
+        for (size_t inC : { 1, 3 })
+            for (size_t mapCount : { 1, 5 })
+                for (bool autoPad : { false, true })
+                    geometries.push_back(std::make_shared<ConvolveGeometry>(TensorShape(inSize.first, inSize.second, inC),
+                        TensorShape(3, 3, inC), TensorShape(mapCount), TensorShape(1, 1, inC),
+                        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{autoPad, autoPad, false},
+                        TensorShape(0), TensorShape(0)));
+    // explicit padding
+    geometries.push_back(std::make_shared<ConvolveGeometry>(TensorShape(10, 9, 4),
+        TensorShape(3, 3, 4), TensorShape(6), TensorShape(1, 1, 4),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{false},
+        TensorShape(1, 1, 0), TensorShape(1, 1, 0)));
+
+    int cpuDeviceId = -1;
+    for (size_t maxTempMem : { 0, 1, 3 })
+    {
+        for (const auto& g : geometries)
+        {
+            auto baseEng = ConvEng::Create(g, cpuDeviceId, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::Reference);
+            auto testEng = ConvEng::Create(g, cpuDeviceId, ImageLayoutKind::CHW, maxTempMem, PoolKind::None, ConvolutionEngineKind::Winograd);
+
+            size_t n = batchSizeG(rng);
+            vec buf(g->InputShape().GetNumElements() * n);
+            std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+            SingleMatrix in(g->InputShape().GetNumElements(), n, buf.data(), cpuDeviceId, matrixFlagNormal);
+
+            size_t mapCount = g->GetMapCount(g->InputShape().GetRank() - 1);
+            buf.resize(g->KernelShape().GetNumElements() * mapCount);
+            std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+            SingleMatrix kernel(mapCount, g->KernelShape().GetNumElements(), buf.data(), cpuDeviceId, matrixFlagNormal);
+
+            size_t crowOut = g->OutputShape().GetNumElements();
+            SingleMatrix out(crowOut, n, cpuDeviceId);
+            SingleMatrix outB(crowOut, n, cpuDeviceId);
+            SingleMatrix workspace(cpuDeviceId);
+            SingleMatrix workspaceB(cpuDeviceId);
+
+            testEng->Forward(in, kernel, out, workspace);
+            baseEng->Forward(in, kernel, outB, workspaceB);
+
+            std::stringstream tmsg;
+            tmsg << "Geometry: " << (std::string)(*g) << ", Batch: " << n << ", MaxTempMem: " << maxTempMem;
+            std::string msg = " are not equal, " + tmsg.str();
+            std::string emsg;
+            // the transforms of F(4x4,3x3) lose some precision, mostly visible for outputs close to 0
+            float relErr = Err<float>::Rel * 32;
+            float absErr = Err<float>::Abs * 1024;
+
+            BOOST_REQUIRE_MESSAGE(!out.HasNan("out"), "out has NaNs, " << tmsg.str());
+            BOOST_REQUIRE_MESSAGE(CheckEqual(out, outB, emsg, relErr, absErr), "out" << msg << ". " << emsg);
+
+            // the epilogue is applied to the output tiles
+            vec shift(mapCount);
+            std::generate(begin(shift), end(shift), [&] { return nd(rng); });
+            ConvolutionEpilogue<float> epilogue;
+            epilogue.shift = shift.data();
+            epilogue.relu = true;
+            testEng->ForwardFused(in, kernel, out, workspace, epilogue);
+            float* data = outB.Data();
+            for (size_t i = 0; i < crowOut * n; i++)
+                data[i] = std::max(data[i] + shift[(i % crowOut) / (crowOut / mapCount)], 0.0f);
+            BOOST_REQUIRE_MESSAGE(CheckEqual(out, outB, emsg, relErr, absErr), "fused out" << msg << ". " << emsg);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ConvolutionDepthwise)
+{
+    std::mt19937 rng(0);
+    boost::random::uniform_int_distribution<> batchSizeG(1, 8);
+    boost::random::normal_distribution<float> nd;
+
+    // A depthwise convolution is the dense convolution whose kernel k is zero but for the channel k / multiplier,
+    // which the reference engine computes.
+    struct DepthwiseConfig { size_t w, h, c, multiplier, kernW, kernH, stride; bool autoPad; };
+    std::vector<DepthwiseConfig> configs = {
+        { 7, 5, 3, 1, 3, 3, 1, true }, { 8, 8, 4, 1, 3, 3, 2, true }, { 9, 6, 2, 2, 3, 3, 1, false },
+        { 11, 10, 3, 1, 5, 5, 2, true }, { 10, 9, 5, 3, 3, 1, 1, true }, { 6, 7, 4, 2, 2, 2, 3, false },
+    };
+
+    int cpuDeviceId = -1;
+    for (const auto& cfg : configs)
+    {
+        const size_t mapCount = cfg.c * cfg.multiplier;
+        const size_t kernelSize = cfg.kernW * cfg.kernH;
+        auto g = std::make_shared<ConvolveGeometry>(TensorShape(cfg.w, cfg.h, cfg.c), TensorShape(cfg.kernW, cfg.kernH, 1), TensorShape(mapCount),
+            TensorShape(cfg.stride, cfg.stride, cfg.c), ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{cfg.autoPad, cfg.autoPad, false},
+            TensorShape(0), TensorShape(0), TensorShape(1), false, cfg.c);
+        auto gDense = std::make_shared<ConvolveGeometry>(TensorShape(cfg.w, cfg.h, cfg.c), TensorShape(cfg.kernW, cfg.kernH, cfg.c), TensorShape(mapCount),
+            TensorShape(cfg.stride, cfg.stride, cfg.c), ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{cfg.autoPad, cfg.autoPad, false},
+            TensorShape(0), TensorShape(0));
+        BOOST_REQUIRE(g->OutputShape() == gDense->OutputShape());
+
+        // the depthwise engine is selected for such geometries
+        auto testEng = ConvEng::Create(g, cpuDeviceId, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::All);
+        auto baseEng = ConvEng::Create(gDense, cpuDeviceId, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::Reference);
+
+        size_t n = batchSizeG(rng);
+        size_t crowIn = g->InputShape().GetNumElements();
+        size_t crowOut = g->OutputShape().GetNumElements();
+        vec buf(crowIn * n);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        SingleMatrix in(crowIn, n, buf.data(), cpuDeviceId, matrixFlagNormal);
+
+        vec kernelBuf(kernelSize * mapCount);
+        std::generate(begin(kernelBuf), end(kernelBuf), [&] { return nd(rng); });
+        vec denseKernelBuf(kernelSize * cfg.c * mapCount, 0);
+        for (size_t k = 0; k < mapCount; k++)
+            std::copy_n(kernelBuf.data() + k * kernelSize, kernelSize, denseKernelBuf.data() + (k * cfg.c + k / cfg.multiplier) * kernelSize);
+        SingleMatrix kernel(mapCount, kernelSize, kernelBuf.data(), cpuDeviceId, matrixFlagNormal);
+        SingleMatrix kernelB(mapCount, kernelSize * cfg.c, denseKernelBuf.data(), cpuDeviceId, matrixFlagNormal);
+
+        SingleMatrix workspace(cpuDeviceId);
+        SingleMatrix workspaceB(cpuDeviceId);
+
+        std::stringstream tmsg;
+        tmsg << "Geometry: " << (std::string)(*g) << ", Batch: " << n;
+        std::string msg = " are not equal, " + tmsg.str();
+        std::string emsg;
+        float relErr = Err<float>::Rel;
+        float absErr = Err<float>::Abs;
+
+        SingleMatrix out(crowOut, n, cpuDeviceId);
+        SingleMatrix outB(crowOut, n, cpuDeviceId);
+        testEng->Forward(in, kernel, out, workspace);
+        baseEng->Forward(in, kernelB, outB, workspaceB);
+        BOOST_REQUIRE_MESSAGE(CheckEqual(out, outB, emsg, relErr * 4, absErr * 14), "out" << msg << ". " << emsg);
+
+        buf.resize(crowOut * n);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        SingleMatrix srcGrad(crowOut, n, buf.data(), cpuDeviceId, matrixFlagNormal);
+
+        // the gradients are accumulated into the given ones, or overwrite them
+        for (bool accumulate : { true, false })
+        {
+            SingleMatrix grad(crowIn, n, cpuDeviceId);
+            grad.SetUniformRandomValue(-1, 1, 1);
+            SingleMatrix gradB(grad.DeepClone(), cpuDeviceId);
+            if (!accumulate)
+                gradB.SetValue(0);
+            testEng->BackwardData(srcGrad, kernel, grad, accumulate, workspace);
+            baseEng->BackwardData(srcGrad, kernelB, gradB, true, workspaceB);
+            BOOST_REQUIRE_MESSAGE(CheckEqual(grad, gradB, emsg, relErr * 16, absErr * 16), "grad" << msg << ". " << emsg);
+
+            SingleMatrix kernelGrad(mapCount, kernelSize, cpuDeviceId);
+            kernelGrad.SetUniformRandomValue(-1, 1, 2);
+            SingleMatrix initial(kernelGrad.DeepClone(), cpuDeviceId);
+            SingleMatrix kernelGradB(mapCount, kernelSize * cfg.c, cpuDeviceId);
+            kernelGradB.SetValue(0);
+            testEng->BackwardKernel(srcGrad, in, kernelGrad, accumulate, true, workspace);
+            baseEng->BackwardKernel(srcGrad, in, kernelGradB, true, true, workspaceB);
+            // the kernel gradients of the dense convolution that belong to the depthwise kernels, plus the initial values
+            vec expected(kernelSize * mapCount);
+            for (size_t k = 0; k < mapCount; k++)
+                for (size_t j = 0; j < kernelSize; j++)
+                    expected[k * kernelSize + j] = kernelGradB.Data()[(k * cfg.c + k / cfg.multiplier) * kernelSize + j] +
+                                                   (accumulate ? initial.Data()[k * kernelSize + j] : 0);
+            SingleMatrix expectedKernelGrad(mapCount, kernelSize, expected.data(), cpuDeviceId, matrixFlagNormal);
+            BOOST_REQUIRE_MESSAGE(CheckEqual(kernelGrad, expectedKernelGrad, emsg, relErr * 192, absErr * 32), "kernel" << msg << ". " << emsg);
+        }
+    }
+}
+
+// Moves the channels, the last dimension of each of the 'count' [spatial x C] blocks, to the front,
+// i.e. converts CHW tensors (and CHW x K kernels) to the channels-last layout of the HWC engine.
+vec ToChannelsFirst(const vec& src, size_t numChannels, size_t count)
+{
+    size_t spatialSize = src.size() / numChannels / count;
+    vec dst(src.size());
+    for (size_t j = 0; j < count; j++)
+        for (size_t c = 0; c < numChannels; c++)
+            for (size_t i = 0; i < spatialSize; i++)
+                dst[(j * spatialSize + i) * numChannels + c] = src[(j * numChannels + c) * spatialSize + i];
+    return dst;
+}
+
+BOOST_AUTO_TEST_CASE(ConvolutionForwardChannelsLast)
+{
+    std::mt19937 rng(0);
+    boost::random::uniform_int_distribution<> batchSizeG(1, 8);
+    boost::random::normal_distribution<float> nd;
+
+    int deviceId = 0;
+    for (const auto& g : GenerateConvTestConfigs())
+    {
+        // HWC applies to 2D convolutions only.
+        if (g->InputShape().GetRank() != 3)
+            continue;
+        auto baseEng = ConvEng::Create(g, deviceId, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::CuDnn);
+        auto testEng = ConvEng::Create(g, deviceId, ImageLayoutKind::HWC, 0, PoolKind::None, ConvolutionEngineKind::CuDnn);
+
+        size_t n = batchSizeG(rng);
+        size_t inC = g->InputShape()[2];
+        vec buf(g->InputShape().GetNumElements() * n);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        SingleMatrix inB(g->InputShape().GetNumElements(), n, buf.data(), deviceId, matrixFlagNormal);
+        SingleMatrix in(g->InputShape().GetNumElements(), n, ToChannelsFirst(buf, inC, n).data(), deviceId, matrixFlagNormal);
+
+        size_t mapCount = g->GetMapCount(g->InputShape().GetRank() - 1);
+        buf.resize(g->KernelShape().GetNumElements() * mapCount);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        SingleMatrix kernelB(mapCount, g->KernelShape().GetNumElements(), buf.data(), deviceId, matrixFlagNormal);
+        SingleMatrix kernel(mapCount, g->KernelShape().GetNumElements(), ToChannelsFirst(buf, inC, mapCount).data(), deviceId, matrixFlagNormal);
+
+        size_t crowOut = g->OutputShape().GetNumElements();
+        SingleMatrix out(crowOut, n, deviceId);
+        SingleMatrix outB(crowOut, n, deviceId);
+        SingleMatrix workspace(deviceId);
+        SingleMatrix workspaceB(deviceId);
+
+        testEng->Forward(in, kernel, out, workspace);
+        baseEng->Forward(inB, kernelB, outB, workspaceB);
+
+        vec outBHost(crowOut * n);
+        outB.CopySection(crowOut, n, outBHost.data(), crowOut);
+        SingleMatrix outExpected(crowOut, n, ToChannelsFirst(outBHost, mapCount, n).data(), deviceId, matrixFlagNormal);
+
+        std::stringstream tmsg;
+        tmsg << "Geometry: " << (std::string)(*g) << ", Batch: " << n;
+        std::string emsg;
+        BOOST_REQUIRE_MESSAGE(CheckEqual(out, outExpected, emsg, Err<float>::Rel * 4, Err<float>::Abs * 14), "out are not equal, " << tmsg.str() << ". " << emsg);
+    }
+
+    // Pooling does not change the channels, the same tensors with the channels first give the same result.
+    for (const auto& g : GeneratePoolTestConfigs())
+    {
+        auto baseEng = ConvEng::Create(g, deviceId, ImageLayoutKind::CHW, 0, PoolKind::Max, ConvolutionEngineKind::CuDnn);
+        auto testEng = ConvEng::Create(g, deviceId, ImageLayoutKind::HWC, 0, PoolKind::Max, ConvolutionEngineKind::CuDnn);
+
+        size_t n = batchSizeG(rng);
+        size_t inC = g->InputShape()[2];
+        vec buf(g->InputShape().GetNumElements() * n);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        SingleMatrix inB(g->InputShape().GetNumElements(), n, buf.data(), deviceId, matrixFlagNormal);
+        SingleMatrix in(g->InputShape().GetNumElements(), n, ToChannelsFirst(buf, inC, n).data(), deviceId, matrixFlagNormal);
+
+        size_t crowOut = g->OutputShape().GetNumElements();
+        SingleMatrix out(crowOut, n, deviceId);
+        SingleMatrix outB(crowOut, n, deviceId);
+
+        testEng->ForwardPooling(in, out);
+        baseEng->ForwardPooling(inB, outB);
+
+        vec outBHost(crowOut * n);
+        outB.CopySection(crowOut, n, outBHost.data(), crowOut);
+        SingleMatrix outExpected(crowOut, n, ToChannelsFirst(outBHost, inC, n).data(), deviceId, matrixFlagNormal);
+
+        std::string emsg;
+        BOOST_REQUIRE_MESSAGE(CheckEqual(out, outExpected, emsg, Err<float>::Rel, Err<float>::Abs),
+                              "pooled out are not equal, Geometry: " << (std::string)(*g) << ", Batch: " << n << ". " << emsg);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(CuDnnAlgorithmCacheFile)
+{
+    const char* path = "CuDnnAlgorithmCacheFile.txt";
+    const std::wstring wpath = L"CuDnnAlgorithmCacheFile.txt";
+    remove(path);
+
+    CuDnnAlgorithmCache::Set(wpath);
+    BOOST_REQUIRE(CuDnnAlgorithmCache::IsEnabled());
+    BOOST_REQUIRE(CuDnnAlgorithmCache::ShouldTune());
+    CuDnnAlgorithmCache::Entry entry;
+    BOOST_REQUIRE(!CuDnnAlgorithmCache::Lookup("conv, fwd", entry));
+    CuDnnAlgorithmCache::Insert("conv, fwd", { 1, 0, 4096 });
+    CuDnnAlgorithmCache::Insert("conv, bwdData", { 3, 1, 0 });
+
+    // another process in the middle of appending an entry
+    FILE* f = fopen(path, "ab");
+    BOOST_REQUIRE(f != nullptr);
+    fputs("conv, bwdFilter\t2\t0\t1024", f);
+    fclose(f);
+
+    // as a later process that does not tune and does not write
+    CuDnnAlgorithmCache::Set(wpath, /*writable=*/false, /*tune=*/false);
+    BOOST_REQUIRE(!CuDnnAlgorithmCache::ShouldTune());
+    BOOST_REQUIRE(CuDnnAlgorithmCache::Lookup("conv, fwd", entry));
+    BOOST_REQUIRE_EQUAL(entry.algo, 1);
+    BOOST_REQUIRE_EQUAL(entry.mathType, 0);
+    BOOST_REQUIRE_EQUAL(entry.workspaceSize, 4096);
+    BOOST_REQUIRE(CuDnnAlgorithmCache::Lookup("conv, bwdData", entry));
+    BOOST_REQUIRE_EQUAL(entry.algo, 3);
+    BOOST_REQUIRE_EQUAL(entry.mathType, 1);
+    BOOST_REQUIRE(!CuDnnAlgorithmCache::Lookup("conv, bwdFilter", entry));
+
+    // entries of a reader stay in memory
+    CuDnnAlgorithmCache::Insert("other conv, fwd", { 2, 0, 0 });
+    BOOST_REQUIRE(CuDnnAlgorithmCache::Lookup("other conv, fwd", entry));
+    CuDnnAlgorithmCache::Set(wpath);
+    BOOST_REQUIRE(!CuDnnAlgorithmCache::Lookup("other conv, fwd", entry));
+
+    CuDnnAlgorithmCache::Set(L"");
+    BOOST_REQUIRE(!CuDnnAlgorithmCache::IsEnabled());
+    BOOST_REQUIRE(CuDnnAlgorithmCache::ShouldTune());
+    BOOST_REQUIRE(!CuDnnAlgorithmCache::Lookup("conv, fwd", entry));
+    remove(path);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE(Half_ConvolutionSuite)
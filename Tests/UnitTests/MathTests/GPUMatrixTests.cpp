@@ -7,6 +7,7 @@
 #include "stdafx.h"
 #include "../../../Source/Math/GPUMatrix.h"
 #include "../../../Source/Math/Matrix.h"
+#include "../../../Source/Math/CUDAPageLockedMemAllocator.h"
 #include "BestGpu.h"
 
 using namespace Microsoft::MSR::CNTK;
@@ -796,6 +797,90 @@ BOOST_FIXTURE_TEST_CASE(GPUMatrixGatherFromTarget, RandomSeedFixture)
     BOOST_CHECK(m2.IsEqualTo(expect, 1e-6));
 }
 
+BOOST_FIXTURE_TEST_CASE(GPUMatrixCachingAllocatorReuse, RandomSeedFixture)
+{
+    TracingGPUMemoryAllocator::SetCachingEnabled(true);
+    TracingGPUMemoryAllocator::EmptyCache(c_deviceIdZero);
+    auto before = TracingGPUMemoryAllocator::GetCacheStats(c_deviceIdZero);
+
+    {
+        GPUMatrix<float> m0 = GPUMatrix<float>::Ones(1000, 300, c_deviceIdZero);
+    }
+    // same size class as before, so this must be served from the cache
+    GPUMatrix<float> m1 = GPUMatrix<float>::Ones(999, 300, c_deviceIdZero);
+
+    auto after = TracingGPUMemoryAllocator::GetCacheStats(c_deviceIdZero);
+    BOOST_CHECK_EQUAL(after.numAllocations - before.numAllocations, 2);
+    BOOST_CHECK_EQUAL(after.numCacheHits - before.numCacheHits, 1);
+    BOOST_CHECK_EQUAL(after.numDeviceAllocations - before.numDeviceAllocations, 1);
+    BOOST_CHECK(after.bytesRequested <= after.bytesInUse);
+
+    auto ones = GPUMatrix<float>::Ones(999, 300, c_deviceIdZero);
+    BOOST_CHECK(m1.IsEqualTo(ones, c_epsilonFloatE5));
+
+    TracingGPUMemoryAllocator::SetCachingEnabled(false);
+    TracingGPUMemoryAllocator::EmptyCache(c_deviceIdZero);
+}
+
+BOOST_FIXTURE_TEST_CASE(GPUMatrixCachingAllocatorCategories, RandomSeedFixture)
+{
+    TracingGPUMemoryAllocator::SetCachingEnabled(true);
+    TracingGPUMemoryAllocator::EmptyCache(c_deviceIdZero);
+    const int workspace = (int)GPUMemoryCategory::Workspace;
+    auto before = TracingGPUMemoryAllocator::GetCacheStats(c_deviceIdZero);
+
+    {
+        GPUMemoryCategoryScope memoryCategory(GPUMemoryCategory::Workspace);
+        GPUMatrix<float> m0(1000, 300, c_deviceIdZero);
+        auto during = TracingGPUMemoryAllocator::GetCacheStats(c_deviceIdZero);
+        BOOST_CHECK(during.bytesInUseByCategory[workspace] - before.bytesInUseByCategory[workspace] >= 1000 * 300 * sizeof(float));
+        BOOST_CHECK_EQUAL(during.bytesInUseByCategory[(int)GPUMemoryCategory::Other], before.bytesInUseByCategory[(int)GPUMemoryCategory::Other]);
+    }
+    BOOST_CHECK(GPUMemoryCategoryScope::Current() == GPUMemoryCategory::Other);
+
+    // freed, but the peak stays until it is reset
+    auto after = TracingGPUMemoryAllocator::GetCacheStats(c_deviceIdZero);
+    BOOST_CHECK_EQUAL(after.bytesInUseByCategory[workspace], before.bytesInUseByCategory[workspace]);
+    BOOST_CHECK(after.peakBytesInUseByCategory[workspace] >= 1000 * 300 * sizeof(float));
+    BOOST_CHECK(after.peakBytesInUse >= after.bytesInUse + 1000 * 300 * sizeof(float));
+
+    TracingGPUMemoryAllocator::ResetPeakStats(c_deviceIdZero);
+    after = TracingGPUMemoryAllocator::GetCacheStats(c_deviceIdZero);
+    BOOST_CHECK_EQUAL(after.peakBytesInUseByCategory[workspace], after.bytesInUseByCategory[workspace]);
+    BOOST_CHECK_EQUAL(after.peakBytesInUse, after.bytesInUse);
+
+    TracingGPUMemoryAllocator::SetCachingEnabled(false);
+    TracingGPUMemoryAllocator::EmptyCache(c_deviceIdZero);
+}
+
+BOOST_FIXTURE_TEST_CASE(PageLockedMemoryPoolReuse, RandomSeedFixture)
+{
+    CUDAPageLockedMemAllocator::EmptyCache();
+    auto before = CUDAPageLockedMemAllocator::GetCacheStats();
+
+    void* p0 = CUDAPageLockedMemAllocator::Malloc(3 << 20, c_deviceIdZero);
+    memset(p0, 0, 3 << 20);
+    CUDAPageLockedMemAllocator::Free(p0, c_deviceIdZero);
+    // same size class as before, so this must be served from the cache
+    void* p1 = CUDAPageLockedMemAllocator::Malloc((3 << 20) - 100, c_deviceIdZero);
+    BOOST_CHECK_EQUAL(p0, p1);
+
+    auto after = CUDAPageLockedMemAllocator::GetCacheStats();
+    BOOST_CHECK_EQUAL(after.numAllocations - before.numAllocations, 2);
+    BOOST_CHECK_EQUAL(after.numCacheHits - before.numCacheHits, 1);
+    BOOST_CHECK_EQUAL(after.numHostAllocations - before.numHostAllocations, 1);
+    BOOST_CHECK(after.peakBytesReserved >= 3 << 20);
+
+    // without a cache limit blocks are released right away
+    const size_t limitInMBs = CUDAPageLockedMemAllocator::GetCacheLimitInMBs();
+    CUDAPageLockedMemAllocator::SetCacheLimitInMBs(0);
+    CUDAPageLockedMemAllocator::Free(p1, c_deviceIdZero);
+    after = CUDAPageLockedMemAllocator::GetCacheStats();
+    BOOST_CHECK_EQUAL(after.bytesCached, 0);
+    BOOST_CHECK_EQUAL(after.numHostFrees - before.numHostFrees, 1);
+    CUDAPageLockedMemAllocator::SetCacheLimitInMBs(limitInMBs);
+}
+
 #if 0 // Temporarily disabling
 BOOST_FIXTURE_TEST_CASE(GPUMatrixLargeInequality, RandomSeedFixture)
 {
@@ -5,6 +5,7 @@
 #include "stdafx.h"
 #include "../../../Source/Math/Matrix.h"
 #include "../../../Source/Math/Helpers.h"
+#include "BestGpu.h"
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -104,6 +105,39 @@ BOOST_FIXTURE_TEST_CASE(MatrixDataSynchronization_GravitatingTowardsPreferredDev
     BOOST_CHECK_EQUAL(CurrentDataLocation::GPU, matrixC.GetCurrentMatrixLocation());
 }
 
+// Requires two GPUs
+BOOST_FIXTURE_TEST_CASE(MatrixDataSynchronization_AsyncTransferBetweenGPUs, RandomSeedFixture)
+{
+    bool hasTwoGpus = false;
+#ifndef CPUONLY
+    hasTwoGpus = GetAllGpusData().size() > 1;
+#endif
+    if (!hasTwoGpus)
+    {
+        BOOST_TEST_MESSAGE("Skipping the asynchronous transfer between GPUs, it needs two GPUs.");
+        return;
+    }
+
+    SingleMatrix expected = SingleMatrix::RandomGaussian(64, 23, CPUDEVICE, 0, 2, IncrementCounter());
+    SingleMatrix matrixA(64, 23, expected.Data(), c_deviceIdZero, matrixFlagNormal);
+    for (int round = 0; round < 3; round++)
+    {
+        matrixA.TransferFromDeviceToDeviceAsync(0, 1);
+        BOOST_CHECK_EQUAL(1, matrixA.GetDeviceId());
+        matrixA.TransferFromDeviceToDeviceAsync(1, 0);
+        BOOST_CHECK_EQUAL(0, matrixA.GetDeviceId());
+    }
+    // a product on the target GPU must see the copied values
+    matrixA.TransferFromDeviceToDeviceAsync(0, 1);
+    SingleMatrix matrixB = SingleMatrix::Eye(23, 1);
+    const SingleMatrix matrixC = matrixA * matrixB;
+    BOOST_CHECK_EQUAL(1, matrixC.GetDeviceId());
+
+    SingleMatrix result(CPUDEVICE);
+    result.SetValue(matrixC);
+    BOOST_CHECK(result.IsEqualTo(expected, c_epsilonFloatE5));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
 } } }
@@ -34,6 +34,26 @@ BOOST_FIXTURE_TEST_CASE(CPUMatrixFileWriteRead, RandomSeedFixture)
     BOOST_CHECK(matrixCpuCopy.IsEqualTo(matrixCpuRead, c_epsilonFloatE5));
 }
 
+BOOST_FIXTURE_TEST_CASE(CPUMatrixBinaryFileWriteRead, RandomSeedFixture)
+{
+    CPUMatrix<float> matrixCpu = CPUMatrix<float>::RandomUniform(43, 10, -26.3f, 30.2f, IncrementCounter());
+    CPUMatrix<float> matrixCpuCopy = matrixCpu;
+
+    std::wstring fileNameCpu(L"MCPU.bin");
+    File fileCpu(fileNameCpu, fileOptionsBinary | fileOptionsReadWrite);
+
+    fileCpu << matrixCpu << matrixCpu;
+    fileCpu.SetPosition(0);
+
+    // the values of both matrices must be read back, and nothing beyond them
+    CPUMatrix<float> matrixCpuRead1, matrixCpuRead2;
+    fileCpu >> matrixCpuRead1 >> matrixCpuRead2;
+
+    BOOST_CHECK(matrixCpuCopy.IsEqualTo(matrixCpuRead1, 0));
+    BOOST_CHECK(matrixCpuCopy.IsEqualTo(matrixCpuRead2, 0));
+    BOOST_CHECK_EQUAL(fileCpu.GetPosition(), fileCpu.Size());
+}
+
 BOOST_FIXTURE_TEST_CASE(MatrixFileWriteRead, RandomSeedFixture)
 {
     // Test Matrix in Dense mode
@@ -417,6 +417,8 @@ BOOST_FIXTURE_TEST_CASE(GPUMatrix1BitQuantizeFloat, RandomSeedFixture)
     TestQuantization<float>(c_deviceIdZero, 89, 23, -0.5f, +0.5f, 2715, 5);
     TestQuantization<float>(c_deviceIdZero, 15, 35, -0.5f, +0.5f, 2815, 5);
     TestQuantization<float>(c_deviceIdZero, 100, 50, -0.5f, +0.5f, 2915, 5);
+    // columns too tall to be quantized in one pass through shared memory
+    TestQuantization<float>(c_deviceIdZero, 9000, 3, -0.5f, +0.5f, 3015, 2);
 }
 
 BOOST_FIXTURE_TEST_CASE(GPUMatrix1BitQuantizeDouble, RandomSeedFixture)
@@ -3002,6 +3002,886 @@ BOOST_FIXTURE_TEST_CASE(MatrixFSAdagradUpdate_WithAndWithout_UnitGain, RandomSee
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(MatrixElementwiseProgram, RandomSeedFixture)
+{
+    // the cell update of an LSTM, c' = scale * (sigmoid(f + bias) * c + sigmoid(i) * tanh(g)), with the bias
+    // broadcast over the columns and the scale over all elements
+    typedef ElementwiseProgram::Instruction Instruction;
+    ElementwiseProgram program;
+    program.numInputs = 6; // f, i, g, c, bias, scale
+    const Instruction instructions[] =
+    {
+        { ElementWiseOperator::opSum,                { 0, 4, 0 } }, // 6
+        { ElementWiseOperator::opSigmoid,            { 6, 0, 0 } }, // 7
+        { ElementWiseOperator::opElementwiseProduct, { 7, 3, 0 } }, // 8
+        { ElementWiseOperator::opSigmoid,            { 1, 0, 0 } }, // 9
+        { ElementWiseOperator::opTanh,               { 2, 0, 0 } }, // 10
+        { ElementWiseOperator::opElementwiseProduct, { 9, 10, 0 } }, // 11
+        { ElementWiseOperator::opSum,                { 8, 11, 0 } }, // 12
+        { ElementWiseOperator::opElementwiseProduct, { 12, 5, 0 } }, // 13
+    };
+    for (const auto& instruction : instructions)
+        program.instructions[program.numInstructions++] = instruction;
+
+    const size_t rows = 37, cols = 29; // several chunks on the CPU
+    for (DEVICEID_TYPE deviceId : { CPUDEVICE, c_deviceIdZero })
+    {
+        auto f = SingleMatrix::RandomUniform(rows, cols, deviceId, -3, 3, IncrementCounter());
+        auto i = SingleMatrix::RandomUniform(rows, cols, deviceId, -3, 3, IncrementCounter());
+        auto g = SingleMatrix::RandomUniform(rows, cols, deviceId, -3, 3, IncrementCounter());
+        auto c = SingleMatrix::RandomUniform(rows, cols, deviceId, -3, 3, IncrementCounter());
+        auto bias = SingleMatrix::RandomUniform(rows, 1, deviceId, -1, 1, IncrementCounter());
+        SingleMatrix scale(1, 1, deviceId);
+        scale.SetValue(0.75f);
+        auto result = SingleMatrix::RandomUniform(rows, cols, deviceId, -1, 1, IncrementCounter());
+        SingleMatrix previous = result.DeepClone();
+
+        result.ElementwiseProgramOp(0.5f, { &f, &i, &g, &c, &bias, &scale }, program, 2.0f);
+
+        std::unique_ptr<float[]> pf(f.CopyToArray()), pi(i.CopyToArray()), pg(g.CopyToArray()), pc(c.CopyToArray());
+        std::unique_ptr<float[]> pbias(bias.CopyToArray()), pprevious(previous.CopyToArray()), presult(result.CopyToArray());
+        auto sigmoid = [](float x) { return 1 / (1 + exp(-x)); };
+        for (size_t k = 0; k < rows * cols; k++)
+        {
+            float expected = 0.75f * (sigmoid(pf[k] + pbias[k % rows]) * pc[k] + sigmoid(pi[k]) * tanh(pg[k]));
+            BOOST_CHECK_CLOSE(presult[k], 0.5f * pprevious[k] + 2.0f * expected, 1e-3f);
+        }
+    }
+
+    // an input that cannot be broadcast
+    SingleMatrix out(rows, cols, CPUDEVICE), wrong(2, 3, CPUDEVICE);
+    ElementwiseProgram negate;
+    negate.numInputs = 1;
+    negate.instructions[negate.numInstructions++] = { ElementWiseOperator::opNegate, { 0, 0, 0 } };
+    BOOST_CHECK_THROW(out.ElementwiseProgramOp(0, { &wrong }, negate, 1), std::invalid_argument);
+}
+
+BOOST_FIXTURE_TEST_CASE(MatrixLayerNormalization, RandomSeedFixture)
+{
+    // y = scale .* (x - mean) / sqrt(var + epsilon) + bias for each column, and the gradients of the loss sum(dy .* y),
+    // the input gradient checked against central differences
+    const size_t rows = 37, cols = 5;
+    const double epsilon = 1e-5, delta = 1e-5;
+    for (DEVICEID_TYPE deviceId : { CPUDEVICE, c_deviceIdZero })
+    {
+        auto x = DoubleMatrix::RandomUniform(rows, cols, deviceId, -3, 3, IncrementCounter());
+        auto scale = DoubleMatrix::RandomUniform(rows, 1, deviceId, 0.5, 1.5, IncrementCounter());
+        auto bias = DoubleMatrix::RandomUniform(rows, 1, deviceId, -1, 1, IncrementCounter());
+        auto outGrad = DoubleMatrix::RandomUniform(rows, cols, deviceId, -1, 1, IncrementCounter());
+        DoubleMatrix y(deviceId), mean(deviceId), invStdDev(deviceId), scaleGrad(deviceId), biasGrad(deviceId);
+
+        x.LayerNormalizationForward(scale, bias, epsilon, y, mean, invStdDev);
+        BOOST_REQUIRE(mean.GetNumRows() == 1 && mean.GetNumCols() == cols);
+
+        auto inGrad = DoubleMatrix::RandomUniform(rows, cols, deviceId, -1, 1, IncrementCounter());
+        DoubleMatrix previousInGrad = inGrad.DeepClone();
+        outGrad.LayerNormalizationBackward(x, inGrad, scale, mean, invStdDev, scaleGrad, biasGrad);
+
+        std::unique_ptr<double[]> px(x.CopyToArray()), py(y.CopyToArray()), pscale(scale.CopyToArray()), pbias(bias.CopyToArray());
+        std::unique_ptr<double[]> pdy(outGrad.CopyToArray()), pdx(inGrad.CopyToArray()), pprevious(previousInGrad.CopyToArray());
+        std::unique_ptr<double[]> pdscale(scaleGrad.CopyToArray()), pdbias(biasGrad.CopyToArray());
+
+        // the loss for column j, with its element k moved by 'offset'
+        auto loss = [&](size_t j, size_t k, double offset, std::vector<double>* normalized)
+        {
+            double m = 0, v = 0;
+            for (size_t i = 0; i < rows; i++)
+                m += px[i + j * rows] + (i == k ? offset : 0);
+            m /= rows;
+            for (size_t i = 0; i < rows; i++)
+                v += pow(px[i + j * rows] + (i == k ? offset : 0) - m, 2);
+            v /= rows;
+            double result = 0;
+            for (size_t i = 0; i < rows; i++)
+            {
+                double xHat = (px[i + j * rows] + (i == k ? offset : 0) - m) / sqrt(v + epsilon);
+                if (normalized)
+                    normalized->push_back(xHat);
+                result += pdy[i + j * rows] * (pscale[i] * xHat + pbias[i]);
+            }
+            return result;
+        };
+
+        std::vector<double> expectedScaleGrad(rows, 0), expectedBiasGrad(rows, 0);
+        for (size_t j = 0; j < cols; j++)
+        {
+            std::vector<double> normalized;
+            loss(j, 0, 0, &normalized);
+            for (size_t i = 0; i < rows; i++)
+            {
+                BOOST_CHECK_SMALL(py[i + j * rows] - (pscale[i] * normalized[i] + pbias[i]), 1e-9);
+                expectedScaleGrad[i] += pdy[i + j * rows] * normalized[i];
+                expectedBiasGrad[i] += pdy[i + j * rows];
+
+                double numericalGrad = (loss(j, i, delta, nullptr) - loss(j, i, -delta, nullptr)) / (2 * delta);
+                BOOST_CHECK_SMALL(pdx[i + j * rows] - pprevious[i + j * rows] - numericalGrad, 1e-6);
+            }
+        }
+        for (size_t i = 0; i < rows; i++)
+        {
+            BOOST_CHECK_SMALL(pdscale[i] - expectedScaleGrad[i], 1e-9);
+            BOOST_CHECK_SMALL(pdbias[i] - expectedBiasGrad[i], 1e-9);
+        }
+    }
+
+    // scale and bias that do not match the rows
+    DoubleMatrix x(4, 3, CPUDEVICE), wrong(3, 1, CPUDEVICE), y(CPUDEVICE), mean(CPUDEVICE), invStdDev(CPUDEVICE);
+    BOOST_CHECK_THROW(x.LayerNormalizationForward(wrong, wrong, 1e-5, y, mean, invStdDev), std::logic_error);
+}
+
+BOOST_FIXTURE_TEST_CASE(MatrixDropoutOp, RandomSeedFixture)
+{
+    // the mask is regenerated from (seed, offset): column slices with their offsets and the gradient see the same mask
+    const size_t rows = 13, cols = 300;
+    const double dropoutRate = 0.3;
+    const uint64_t seed = 1234, offset = 5;
+    for (DEVICEID_TYPE deviceId : { CPUDEVICE, c_deviceIdZero })
+    {
+        auto x = DoubleMatrix::RandomUniform(rows, cols, deviceId, 1, 2, IncrementCounter());
+        DoubleMatrix y(deviceId), ySlices(rows, cols, deviceId);
+        y.DropoutOp(0, x, dropoutRate, seed, offset);
+        for (size_t j = 0; j < cols; j++)
+        {
+            DoubleMatrix slice = ySlices.ColumnSlice(j, 1);
+            slice.DropoutOp(0, x.ColumnSlice(j, 1), dropoutRate, seed, offset + j * rows);
+        }
+
+        auto previousGrad = DoubleMatrix::RandomUniform(rows, cols, deviceId, -1, 1, IncrementCounter());
+        DoubleMatrix grad = previousGrad.DeepClone();
+        grad.DropoutOp(1, x, dropoutRate, seed, offset);
+
+        std::unique_ptr<double[]> px(x.CopyToArray()), py(y.CopyToArray()), pySlices(ySlices.CopyToArray());
+        std::unique_ptr<double[]> pgrad(grad.CopyToArray()), pprevious(previousGrad.CopyToArray());
+        size_t numDropped = 0;
+        for (size_t i = 0; i < rows * cols; i++)
+        {
+            if (py[i] == 0)
+                numDropped++;
+            else
+                BOOST_CHECK_CLOSE(py[i], px[i] / (1 - dropoutRate), 1e-9);
+            BOOST_CHECK_EQUAL(py[i], pySlices[i]);
+            BOOST_CHECK_CLOSE(pgrad[i], pprevious[i] + py[i], 1e-9);
+        }
+        BOOST_CHECK_SMALL(numDropped / (double)(rows * cols) - dropoutRate, 0.02);
+    }
+
+    DoubleMatrix x(4, 3, CPUDEVICE), y(CPUDEVICE);
+    BOOST_CHECK_THROW(y.DropoutOp(0, x, 1, seed, offset), std::invalid_argument);
+}
+
+BOOST_FIXTURE_TEST_CASE(MatrixInplaceSegmentedLogSoftmax, RandomSeedFixture)
+{
+    // runs of several lengths, including longer ones than a block of the GPU kernel, match the column-wise log softmax
+    const std::vector<int> lengths = { 3, 1, 200, 7, 7, 7, 129, 2 };
+    std::vector<int> offsets(1, 0);
+    for (int length : lengths)
+        offsets.push_back(offsets.back() + length);
+
+    for (DEVICEID_TYPE deviceId : { CPUDEVICE, c_deviceIdZero })
+    {
+        auto x = DoubleMatrix::RandomUniform(1, offsets.back(), deviceId, -20, 20, IncrementCounter());
+        DoubleMatrix y = x.DeepClone();
+        y.InplaceSegmentedLogSoftmax(offsets);
+
+        for (size_t k = 0; k < lengths.size(); k++)
+        {
+            DoubleMatrix expected(deviceId);
+            expected.AssignLogSoftmaxOf(x.ColumnSlice(offsets[k], lengths[k]).Reshaped(lengths[k], 1), true);
+            DoubleMatrix actual = y.ColumnSlice(offsets[k], lengths[k]).Reshaped(lengths[k], 1);
+            BOOST_CHECK(actual.IsEqualTo(expected, c_epsilonFloatE5));
+        }
+    }
+
+    DoubleMatrix x(1, 5, CPUDEVICE);
+    BOOST_CHECK_THROW(x.InplaceSegmentedLogSoftmax({ 0, 3, 6 }), std::invalid_argument);
+    BOOST_CHECK_THROW(x.InplaceSegmentedLogSoftmax({ 0, 3, 3 }), std::invalid_argument);
+}
+
+BOOST_FIXTURE_TEST_CASE(MatrixAssignCTCScore, RandomSeedFixture)
+{
+    // two utterances in parallel channels, "a b" over 4 frames and "a" over 3 frames followed by a gap,
+    // against the sums over all alignments; labels a = 0, b = 1, blank = 2
+    const size_t numLabels = 3, blank = 2, numChannels = 2, maxFrameNum = 4;
+    const std::vector<std::vector<size_t>> targets = { { 0, 1 }, { 0 } };
+    const std::vector<size_t> uttToChanInd = { 0, 1 }, uttBeginFrame = { 0, 0 }, uttFrameNum = { 4, 3 };
+
+    // the phone sequences as built by GammaCalculation::doCTC: blanks around the labels, within sentinels
+    std::vector<size_t> uttPhoneNum;
+    for (const auto& target : targets)
+        uttPhoneNum.push_back(2 * target.size() + 3);
+    const size_t maxPhoneNum = uttPhoneNum[0];
+    std::vector<double> phoneSeqData(maxPhoneNum * targets.size(), 0), phoneBoundData(maxPhoneNum * targets.size(), 0);
+    for (size_t u = 0; u < targets.size(); u++)
+    {
+        double* seq = &phoneSeqData[u * maxPhoneNum];
+        seq[0] = seq[uttPhoneNum[u] - 1] = (double)SIZE_MAX;
+        for (size_t s = 1; s + 1 < uttPhoneNum[u]; s++)
+            seq[s] = s % 2 ? blank : targets[u][s / 2 - 1];
+    }
+
+    for (DEVICEID_TYPE deviceId : { CPUDEVICE, c_deviceIdZero })
+    {
+        DoubleMatrix prob(deviceId);
+        prob.AssignLogSoftmaxOf(DoubleMatrix::RandomUniform(numLabels, numChannels * maxFrameNum, deviceId, -2, 2, IncrementCounter()), true);
+        DoubleMatrix phoneSeq(maxPhoneNum, targets.size(), phoneSeqData.data(), deviceId);
+        DoubleMatrix phoneBound(maxPhoneNum, targets.size(), phoneBoundData.data(), deviceId);
+        DoubleMatrix alpha(deviceId), beta(deviceId), totalScore(1, 1, deviceId), posterior(deviceId);
+        posterior.AssignCTCScore(prob, alpha, beta, phoneSeq, phoneBound, totalScore, uttToChanInd, uttBeginFrame, uttFrameNum, uttPhoneNum,
+                                 numChannels, maxFrameNum, blank, /*delayConstraint=*/ -1, /*isColWise=*/ true);
+
+        std::unique_ptr<double[]> p(prob.CopyToArray()), actual(posterior.CopyToArray());
+        std::vector<double> expected(numLabels * numChannels * maxFrameNum, 0);
+        double expectedScore = 0;
+        for (size_t u = 0; u < targets.size(); u++)
+        {
+            // enumerate the paths, keep those that collapse to the target
+            const size_t T = uttFrameNum[u];
+            size_t numPaths = 1;
+            for (size_t t = 0; t < T; t++)
+                numPaths *= numLabels;
+            double total = 0;
+            std::vector<double> occupancy(numLabels * T, 0);
+            for (size_t code = 0; code < numPaths; code++)
+            {
+                std::vector<size_t> path, collapsed;
+                double pathProb = 1;
+                for (size_t t = 0, c = code; t < T; t++, c /= numLabels)
+                {
+                    path.push_back(c % numLabels);
+                    pathProb *= exp(p[(t * numChannels + uttToChanInd[u]) * numLabels + path.back()]);
+                    if (path.back() != blank && (t == 0 || path[t - 1] != path.back()))
+                        collapsed.push_back(path.back());
+                }
+                if (collapsed != targets[u])
+                    continue;
+                total += pathProb;
+                for (size_t t = 0; t < T; t++)
+                    occupancy[t * numLabels + path[t]] += pathProb;
+            }
+            expectedScore -= log(total);
+            for (size_t t = 0; t < T; t++)
+                for (size_t k = 0; k < numLabels; k++)
+                    expected[(t * numChannels + uttToChanInd[u]) * numLabels + k] = occupancy[t * numLabels + k] / total;
+        }
+
+        BOOST_CHECK_CLOSE(totalScore.Get00Element(), expectedScore, 1e-6);
+        for (size_t i = 0; i < expected.size(); i++)
+            BOOST_CHECK_SMALL(actual[i] - expected[i], 1e-9);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(MatrixAssignEditDistances, RandomSeedFixture)
+{
+    // three utterances, two of them one after the other in channel 0, against the full grid DP of the labels with
+    // runs merged and label 0 ignored
+    const size_t numChannels = 2, numFrames = 9, numLabels = 4;
+    const std::vector<size_t> uttToChanInd = { 0, 0, 1 }, uttBeginFrame = { 0, 5, 0 }, uttFrameNum = { 5, 4, 9 };
+    const std::vector<size_t> tokensToIgnore = { 0 };
+    const float subPen = 1.0f, delPen = 1.5f, insPen = 0.5f;
+
+    std::vector<float> firstData(numChannels * numFrames), secondData(numChannels * numFrames);
+    for (size_t i = 0; i < firstData.size(); i++)
+    {
+        firstData[i] = (float)((i * 7 + i / 3) % numLabels);
+        secondData[i] = (float)((i * 5 + i / 4) % numLabels);
+    }
+
+    auto extract = [&](const std::vector<float>& data, size_t u)
+    {
+        std::vector<int> tokens;
+        for (size_t t = 0; t < uttFrameNum[u]; t++)
+        {
+            int id = (int)data[(uttBeginFrame[u] + t) * numChannels + uttToChanInd[u]];
+            if ((t == 0 || id != (int)data[(uttBeginFrame[u] + t - 1) * numChannels + uttToChanInd[u]]) && id != 0)
+                tokens.push_back(id);
+        }
+        return tokens;
+    };
+
+    std::vector<float> expected;
+    for (size_t u = 0; u < uttFrameNum.size(); u++)
+    {
+        auto first = extract(firstData, u), second = extract(secondData, u);
+        const size_t n = first.size(), m = second.size();
+        std::vector<std::vector<float>> cost(n + 1, std::vector<float>(m + 1)), edits(n + 1, std::vector<float>(m + 1));
+        for (size_t i = 0; i <= n; i++)
+            for (size_t j = 0; j <= m; j++)
+            {
+                if (i == 0 || j == 0)
+                {
+                    cost[i][j] = i * delPen + j * insPen;
+                    edits[i][j] = (float)(i + j);
+                }
+                else if (first[i - 1] == second[j - 1])
+                {
+                    cost[i][j] = cost[i - 1][j - 1];
+                    edits[i][j] = edits[i - 1][j - 1];
+                }
+                else
+                {
+                    float del = cost[i - 1][j] + delPen, ins = cost[i][j - 1] + insPen, sub = cost[i - 1][j - 1] + subPen;
+                    if (sub <= del && sub <= ins)
+                        cost[i][j] = sub, edits[i][j] = edits[i - 1][j - 1] + 1;
+                    else if (del < ins)
+                        cost[i][j] = del, edits[i][j] = edits[i - 1][j] + 1;
+                    else
+                        cost[i][j] = ins, edits[i][j] = edits[i][j - 1] + 1;
+                }
+            }
+        expected.push_back(edits[n][m]);
+        expected.push_back((float)n);
+        expected.push_back((float)m);
+    }
+
+    for (DEVICEID_TYPE deviceId : { CPUDEVICE, c_deviceIdZero })
+    {
+        SingleMatrix firstSeq(1, firstData.size(), firstData.data(), deviceId);
+        SingleMatrix secondSeq(1, secondData.size(), secondData.data(), deviceId);
+        SingleMatrix distances(deviceId);
+        distances.AssignEditDistances(firstSeq, secondSeq, uttToChanInd, uttBeginFrame, uttFrameNum, numChannels,
+                                      subPen, delPen, insPen, /*squashInputs=*/ true, tokensToIgnore);
+
+        BOOST_CHECK_EQUAL(distances.GetNumRows(), 3);
+        BOOST_CHECK_EQUAL(distances.GetNumCols(), uttFrameNum.size());
+        std::unique_ptr<float[]> actual(distances.CopyToArray());
+        for (size_t i = 0; i < expected.size(); i++)
+            BOOST_CHECK_EQUAL(actual[i], expected[i]);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(MatrixLambdaRank, RandomSeedFixture)
+{
+    // two queries, the documents ordered by decreasing gain, against the ranks, DCGs and pairwise lambdas of the definition
+    std::vector<double> gainData = { 31, 7, 3, 0, 0, 15, 1, 0 }, scoreData = { 0.9, 0.3, 1.2, 0.0, 0.5, 0.4, 0.5, 0.3 };
+    const std::vector<size_t> queryBegins = { 0, 5, 8 };
+    const double sigma = 1.0;
+
+    std::vector<double> expectedRanks(gainData.size()), expectedMetrics, expectedGradient(gainData.size(), 0.5);
+    for (size_t q = 0; q + 1 < queryBegins.size(); q++)
+    {
+        const size_t begin = queryBegins[q], end = queryBegins[q + 1];
+        std::vector<size_t> order;
+        for (size_t i = begin; i < end; i++)
+            order.push_back(i);
+        std::sort(order.begin(), order.end(), [&](size_t i, size_t j)
+        {
+            return scoreData[i] != scoreData[j] ? scoreData[i] > scoreData[j] : gainData[i] != gainData[j] ? gainData[i] < gainData[j] : i < j;
+        });
+        for (size_t r = 0; r < order.size(); r++)
+            expectedRanks[order[r]] = (double)r;
+
+        double idealDCG = 0, dcg = 0;
+        for (size_t i = begin; i < end; i++)
+        {
+            idealDCG += gainData[i] / log(2.0 + (i - begin));
+            dcg += gainData[i] / log(2.0 + expectedRanks[i]);
+        }
+        expectedMetrics.push_back(idealDCG);
+        expectedMetrics.push_back(dcg);
+
+        for (size_t i = begin; i < end; i++)
+            for (size_t j = i + 1; j < end; j++)
+            {
+                if (gainData[i] == gainData[j])
+                    continue;
+                double di = log(2.0 + expectedRanks[i]), dj = log(2.0 + expectedRanks[j]);
+                double lambda = -sigma / (1 + exp(sigma * (scoreData[i] - scoreData[j]))) * fabs((gainData[i] - gainData[j]) * (di - dj) / (di * dj) / idealDCG);
+                expectedGradient[i] += lambda;
+                expectedGradient[j] -= lambda;
+            }
+    }
+
+    for (DEVICEID_TYPE deviceId : { CPUDEVICE, c_deviceIdZero })
+    {
+        DoubleMatrix gains(1, gainData.size(), gainData.data(), deviceId);
+        DoubleMatrix scores(1, scoreData.size(), scoreData.data(), deviceId);
+        DoubleMatrix ranks(deviceId), metrics(deviceId), gradient(1, gainData.size(), deviceId);
+        gradient.SetValue(0.5);
+
+        ranks.AssignLambdaRankRanks(gains, scores, queryBegins, metrics);
+        DoubleMatrix::AddLambdaRankGradient(gains, scores, ranks, metrics, queryBegins, sigma, gradient);
+
+        std::unique_ptr<double[]> actualRanks(ranks.CopyToArray()), actualMetrics(metrics.CopyToArray()), actualGradient(gradient.CopyToArray());
+        for (size_t i = 0; i < expectedRanks.size(); i++)
+        {
+            BOOST_CHECK_EQUAL(actualRanks[i], expectedRanks[i]);
+            BOOST_CHECK_SMALL(actualGradient[i] - expectedGradient[i], 1e-12);
+        }
+        for (size_t i = 0; i < expectedMetrics.size(); i++)
+            BOOST_CHECK_SMALL(actualMetrics[i] - expectedMetrics[i], 1e-12);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(MatrixDequantizedColumns, RandomSeedFixture)
+{
+    // gathering from an int8 or half table with a scale and an offset per column, against the dequantized table
+    const size_t rows = 3, cols = 4;
+    std::vector<char> int8Codes(rows * cols);
+    std::vector<half> halfCodes(rows * cols);
+    for (size_t i = 0; i < int8Codes.size(); i++)
+    {
+        int8Codes[i] = (char)((int)(i * 37 % 256) - 128);
+        halfCodes[i] = half((float)i * 0.25f - 1.0f);
+    }
+    std::vector<float> scalesAndOffsets = { 0.5f, 1.0f, 0.25f, -2.0f, 2.0f, 0.0f, 0.125f, 3.0f };
+    std::vector<float> indexData = { 2, 0, -1, 3, 2 };
+
+    for (DEVICEID_TYPE deviceId : { CPUDEVICE, c_deviceIdZero })
+    {
+        Matrix<char> int8Table(rows, cols, int8Codes.data(), deviceId);
+        Matrix<half> halfTable(rows, cols, halfCodes.data(), deviceId);
+        SingleMatrix scales(2, cols, scalesAndOffsets.data(), deviceId);
+        SingleMatrix indices(1, indexData.size(), indexData.data(), deviceId);
+        SingleMatrix int8Columns(deviceId), halfColumns(deviceId);
+
+        int8Columns.AssignDequantizedColumnsOf(indices, int8Table, scales);
+        halfColumns.AssignDequantizedColumnsOf(indices, halfTable, scales);
+
+        BOOST_CHECK_EQUAL(int8Columns.GetNumRows(), rows);
+        BOOST_CHECK_EQUAL(int8Columns.GetNumCols(), indexData.size());
+        std::unique_ptr<float[]> actualInt8(int8Columns.CopyToArray()), actualHalf(halfColumns.CopyToArray());
+        for (size_t j = 0; j < indexData.size(); j++)
+            for (size_t i = 0; i < rows; i++)
+            {
+                float expectedInt8 = 0, expectedHalf = 0;
+                if (indexData[j] >= 0)
+                {
+                    size_t k = (size_t)indexData[j] * rows + i;
+                    float scale = scalesAndOffsets[2 * (size_t)indexData[j]], offset = scalesAndOffsets[2 * (size_t)indexData[j] + 1];
+                    expectedInt8 = (float)(signed char)int8Codes[k] * scale + offset;
+                    expectedHalf = (float)halfCodes[k] * scale + offset;
+                }
+                BOOST_CHECK_EQUAL(actualInt8[j * rows + i], expectedInt8);
+                BOOST_CHECK_EQUAL(actualHalf[j * rows + i], expectedHalf);
+            }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(MatrixScatterToIndicesSparseBlockCol, RandomSeedFixture)
+{
+    // Scattering into a SparseBlockCol matrix (the gradient of an embedding gathered by word ids) adds up the columns
+    // of repeated indices, and adds to the blocks of earlier scatters, like the scatter into a dense matrix.
+    const size_t rows = 5, cols = 12;
+    std::vector<std::vector<float>> indexBatches = { { 3, 7, 3, 0, 11, 3, 7 }, { 7, 2, 2 } };
+    for (DEVICEID_TYPE deviceId : { CPUDEVICE, c_deviceIdZero })
+    {
+        SingleMatrix dense(rows, cols, deviceId);
+        dense.SetValue(0);
+        SingleMatrix sparse(rows, cols, deviceId, SPARSE, matrixFormatSparseBlockCol);
+        for (auto& indexData : indexBatches)
+        {
+            SingleMatrix indices(1, indexData.size(), indexData.data(), deviceId);
+            SingleMatrix values = SingleMatrix::RandomUniform(rows, indexData.size(), deviceId, -1, 1, IncrementCounter());
+            dense.ScatterToIndices(values, indices, rows);
+            sparse.ScatterToIndices(values, indices, rows);
+        }
+
+        sparse.SwitchToMatrixType(DENSE, matrixFormatDense, true);
+        BOOST_CHECK(sparse.IsEqualTo(dense, c_epsilonFloatE5));
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(MatrixGetMatrixFromSBCFormat, RandomSeedFixture)
+{
+    // The (column, values) pairs of the blocks of a SparseBlockCol matrix, which scattered to their columns again give the
+    // same matrix, as when the gradients of an embedding are gathered from all workers and added up.
+    const size_t rows = 4, cols = 10;
+    std::vector<float> indexData = { 6, 1, 6, 9 };
+    for (DEVICEID_TYPE deviceId : { CPUDEVICE, c_deviceIdZero })
+    {
+        SingleMatrix indices(1, indexData.size(), indexData.data(), deviceId);
+        SingleMatrix values = SingleMatrix::RandomUniform(rows, indexData.size(), deviceId, -1, 1, IncrementCounter());
+        SingleMatrix sparse(rows, cols, deviceId, SPARSE, matrixFormatSparseBlockCol);
+        sparse.ScatterToIndices(values, indices, rows);
+
+        std::vector<size_t> blockIds;
+        std::vector<float> blockValues;
+        sparse.GetMatrixFromSBCFormat(blockIds, blockValues);
+        BOOST_CHECK_EQUAL(blockIds.size(), 3);
+        BOOST_CHECK_EQUAL(blockValues.size(), 3 * rows);
+
+        // each worker contributes the same blocks, so the sum is twice the matrix
+        std::vector<float> gatheredIndexData(blockIds.begin(), blockIds.end());
+        gatheredIndexData.insert(gatheredIndexData.end(), blockIds.begin(), blockIds.end());
+        std::vector<float> gatheredValueData(blockValues);
+        gatheredValueData.insert(gatheredValueData.end(), blockValues.begin(), blockValues.end());
+        SingleMatrix gatheredIndices(1, gatheredIndexData.size(), gatheredIndexData.data(), deviceId);
+        SingleMatrix gatheredValues(rows, gatheredIndexData.size(), gatheredValueData.data(), deviceId);
+        SingleMatrix sum(rows, cols, deviceId, SPARSE, matrixFormatSparseBlockCol);
+        sum.ScatterToIndices(gatheredValues, gatheredIndices, rows);
+
+        SingleMatrix expected(rows, cols, deviceId);
+        expected.SetValue(0);
+        expected.ScatterToIndices(values, indices, rows);
+        expected *= 2;
+        sum.SwitchToMatrixType(DENSE, matrixFormatDense, true);
+        BOOST_CHECK(sum.IsEqualTo(expected, c_epsilonFloatE5));
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(MatrixGatherAndScatterAlongAxis, RandomSeedFixture)
+{
+    // A [inner x axisDim x outer] target gathered along its middle axis by 2 x 3 indices, with repeated indices,
+    // for slices of whole float4 vectors (inner = 4) and of single elements (inner = 3).
+    const size_t axisDim = 5, outer = 2, indexRows = 2, indexCols = 3;
+    std::vector<float> indexData = { 4, 1, 1, 0, 4, 4 };
+    for (size_t inner : { 4, 3 })
+    {
+        for (DEVICEID_TYPE deviceId : { CPUDEVICE, c_deviceIdZero })
+        {
+            SingleMatrix indices(indexRows, indexCols, indexData.data(), deviceId);
+            SingleMatrix target = SingleMatrix::RandomUniform(inner * axisDim, outer, deviceId, -1, 1, IncrementCounter());
+            SingleMatrix output(deviceId);
+            output.GatherFromTarget(indices, target, inner, outer);
+            BOOST_CHECK_EQUAL(output.GetNumRows(), inner * indexRows * outer);
+            BOOST_CHECK_EQUAL(output.GetNumCols(), indexCols);
+
+            std::unique_ptr<float[]> t(target.CopyToArray());
+            std::unique_ptr<float[]> out(output.CopyToArray());
+            for (size_t j = 0; j < indexCols; j++)
+                for (size_t o = 0; o < outer; o++)
+                    for (size_t i = 0; i < indexRows; i++)
+                        for (size_t r = 0; r < inner; r++)
+                            BOOST_CHECK_EQUAL(out[r + inner * (i + indexRows * (o + outer * j))], t[r + inner * ((size_t)indexData[i + indexRows * j] + axisDim * o)]);
+
+            // the gradient adds the slices of all indices, on top of what is there
+            SingleMatrix values = SingleMatrix::RandomUniform(output.GetNumRows(), indexCols, deviceId, -1, 1, IncrementCounter());
+            SingleMatrix gradient(inner * axisDim, outer, deviceId);
+            gradient.SetValue(1);
+            gradient.ScatterToIndices(values, indices, inner, outer);
+
+            std::unique_ptr<float[]> v(values.CopyToArray());
+            std::vector<float> expected(inner * axisDim * outer, 1);
+            for (size_t j = 0; j < indexCols; j++)
+                for (size_t o = 0; o < outer; o++)
+                    for (size_t i = 0; i < indexRows; i++)
+                        for (size_t r = 0; r < inner; r++)
+                            expected[r + inner * ((size_t)indexData[i + indexRows * j] + axisDim * o)] += v[r + inner * (i + indexRows * (o + outer * j))];
+            std::unique_ptr<float[]> g(gradient.CopyToArray());
+            for (size_t k = 0; k < expected.size(); k++)
+                BOOST_CHECK_SMALL(g[k] - expected[k], 1e-5f);
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(MatrixVectorTopKSelection, RandomSeedFixture)
+{
+    // Columns of 1000 values with repeated values, so that ties go to the lower row. k = 5 and 40 are selected without
+    // sorting; k = 70 is sorted. The top k of the softmax returns the probabilities of the top k and the log-sum-exp.
+    const size_t rows = 1000, cols = 3;
+    std::vector<float> data(rows * cols);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (float)((i * 7919) % 113) / 16;
+
+    for (int k : { 5, 40, 70 })
+    {
+        std::vector<int> expectedRows(k * cols);
+        std::vector<double> expectedLogSumExp(cols);
+        for (size_t j = 0; j < cols; j++)
+        {
+            const float* col = data.data() + j * rows;
+            std::vector<int> order(rows);
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [col](int a, int b) { return col[a] > col[b]; });
+            std::copy(order.begin(), order.begin() + k, expectedRows.begin() + j * k);
+            double sum = 0;
+            for (size_t i = 0; i < rows; i++)
+                sum += exp((double)col[i] - col[order[0]]);
+            expectedLogSumExp[j] = col[order[0]] + log(sum);
+        }
+
+        for (DEVICEID_TYPE deviceId : { CPUDEVICE, c_deviceIdZero })
+        {
+            SingleMatrix a(rows, cols, data.data(), deviceId);
+            SingleMatrix indices(deviceId), values(deviceId), logSumExp(deviceId);
+            a.VectorMax(indices, values, true, k);
+            std::unique_ptr<float[]> idx(indices.CopyToArray());
+            std::unique_ptr<float[]> val(values.CopyToArray());
+            for (size_t e = 0; e < expectedRows.size(); e++)
+            {
+                BOOST_CHECK_EQUAL((int)idx[e], expectedRows[e]);
+                BOOST_CHECK_EQUAL(val[e], data[(e / k) * rows + expectedRows[e]]);
+            }
+
+            a.VectorTopKSoftmax(indices, values, logSumExp, k);
+            idx.reset(indices.CopyToArray());
+            val.reset(values.CopyToArray());
+            std::unique_ptr<float[]> lse(logSumExp.CopyToArray());
+            for (size_t j = 0; j < cols; j++)
+                BOOST_CHECK_SMALL(lse[j] - expectedLogSumExp[j], 1e-4);
+            for (size_t e = 0; e < expectedRows.size(); e++)
+            {
+                BOOST_CHECK_EQUAL((int)idx[e], expectedRows[e]);
+                BOOST_CHECK_SMALL(val[e] - exp(data[(e / k) * rows + expectedRows[e]] - expectedLogSumExp[e / k]), 1e-6);
+            }
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(MatrixBatchMatMulSmallAndLarge, RandomSeedFixture)
+{
+    // Batches of products c_i = beta * c_i + op(a_i) * op(b_i) of each tile size of the small GEMM kernel on the GPU,
+    // and of some larger than 64 in one dimension that go to cuBLAS; the single products also go through Multiply().
+    const size_t batch = 7;
+    struct Shape { int m, n, k; };
+    for (const Shape& shape : { Shape{ 3, 5, 7 }, Shape{ 20, 17, 30 }, Shape{ 64, 40, 64 }, Shape{ 65, 10, 20 }, Shape{ 12, 8, 100 } })
+    {
+        for (int trans = 0; trans < 4; trans++)
+        {
+            const bool transA = (trans & 1) != 0, transB = (trans & 2) != 0;
+            const int m = shape.m, n = shape.n, k = shape.k;
+            const int lda = transA ? k : m, ldb = transB ? n : k;
+
+            std::vector<float> aData(m * k * batch), bData(k * n * batch), cData(m * n * batch);
+            for (size_t i = 0; i < aData.size(); i++)
+                aData[i] = (float)((i * 37) % 29) / 8 - 1.5f;
+            for (size_t i = 0; i < bData.size(); i++)
+                bData[i] = (float)((i * 53) % 31) / 16 - 1;
+            for (size_t i = 0; i < cData.size(); i++)
+                cData[i] = (float)(i % 11) / 4;
+
+            const float beta = 0.5f;
+            std::vector<float> expected(cData.size());
+            for (size_t s = 0; s < batch; s++)
+                for (int j = 0; j < n; j++)
+                    for (int i = 0; i < m; i++)
+                    {
+                        double sum = 0;
+                        for (int l = 0; l < k; l++)
+                        {
+                            double aValue = aData[s * m * k + (transA ? i * lda + l : l * lda + i)];
+                            double bValue = bData[s * k * n + (transB ? l * ldb + j : j * ldb + l)];
+                            sum += aValue * bValue;
+                        }
+                        size_t index = s * m * n + j * m + i;
+                        expected[index] = (float)(beta * cData[index] + sum);
+                    }
+
+            for (DEVICEID_TYPE deviceId : { CPUDEVICE, c_deviceIdZero })
+            {
+                SingleMatrix a(m * k, batch, aData.data(), deviceId);
+                SingleMatrix b(k * n, batch, bData.data(), deviceId);
+                SingleMatrix c(m * n, batch, cData.data(), deviceId);
+                SingleMatrix::BatchMatMul(beta, a, transA, m, b, transB, n, c, true);
+                std::unique_ptr<float[]> result(c.CopyToArray());
+                for (size_t e = 0; e < expected.size(); e++)
+                    BOOST_CHECK_SMALL(result[e] - expected[e], 1e-3f);
+
+                SingleMatrix a0 = a.ColumnSlice(0, 1);
+                a0.Reshape(transA ? k : m, transA ? m : k);
+                SingleMatrix b0 = b.ColumnSlice(0, 1);
+                b0.Reshape(transB ? n : k, transB ? k : n);
+                SingleMatrix c0(m, n, cData.data(), deviceId);
+                SingleMatrix::MultiplyAndWeightedAdd(1, a0, transA, b0, transB, beta, c0);
+                result.reset(c0.CopyToArray());
+                for (size_t e = 0; e < m * n; e++)
+                    BOOST_CHECK_SMALL(result[e] - expected[e], 1e-3f);
+            }
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(MatrixROIPooling, RandomSeedFixture)
+{
+    // [W x H x C x N] images, 3 ROIs (x1, y1, x2, y2) per image in the coordinates of the original image, which is twice as large.
+    const size_t width = 9, height = 7, channels = 2, numImg = 2, numRois = 3, pooledWidth = 3, pooledHeight = 2;
+    const double spatialScale = 0.5;
+    std::vector<float> roiData = { 0, 0, 16, 12,   2, 3, 10, 11,   5, 1, 6, 2,
+                                   4, 2, 14, 8,    0, 6, 3, 12,    1, 1, 16, 3 };
+    const size_t inRows = width * height * channels, outRows = pooledWidth * pooledHeight * channels * numRois;
+
+    for (DEVICEID_TYPE deviceId : { CPUDEVICE, c_deviceIdZero })
+    {
+        SingleMatrix rois(4 * numRois, numImg, roiData.data(), deviceId);
+
+        // Bilinear interpolation is exact for a linear input, so ROI align gives its value at the bin centers
+        // for these ROIs, which lie within the feature map.
+        std::vector<float> linear(inRows * numImg);
+        for (size_t n = 0; n < numImg; n++)
+            for (size_t c = 0; c < channels; c++)
+                for (size_t y = 0; y < height; y++)
+                    for (size_t x = 0; x < width; x++)
+                        linear[((n * channels + c) * height + y) * width + x] = 1 + 0.5f * x + 0.25f * y + c + 3 * n;
+        SingleMatrix in(inRows, numImg, linear.data(), deviceId);
+        SingleMatrix out(outRows, numImg, deviceId);
+        in.AverageROIAlignForward(numRois, numImg, channels, width, height, pooledWidth, pooledHeight, rois, out, spatialScale);
+        std::unique_ptr<float[]> result(out.CopyToArray());
+        for (size_t n = 0; n < numImg; n++)
+        {
+            for (size_t r = 0; r < numRois; r++)
+            {
+                const float* roi = &roiData[(n * numRois + r) * 4];
+                double x1 = roi[0] * spatialScale, y1 = roi[1] * spatialScale;
+                double binW = std::max(roi[2] * spatialScale - x1, 1.0) / pooledWidth;
+                double binH = std::max(roi[3] * spatialScale - y1, 1.0) / pooledHeight;
+                for (size_t c = 0; c < channels; c++)
+                    for (size_t ph = 0; ph < pooledHeight; ph++)
+                        for (size_t pw = 0; pw < pooledWidth; pw++)
+                        {
+                            double x = x1 + (pw + 0.5) * binW, y = y1 + (ph + 0.5) * binH;
+                            double expected = 1 + 0.5 * x + 0.25 * y + c + 3 * n;
+                            size_t i = n * outRows + ((r * channels + c) * pooledHeight + ph) * pooledWidth + pw;
+                            BOOST_CHECK_CLOSE(result[i], expected, 1e-3);
+                        }
+            }
+        }
+
+        // The backward passes are the transposes of the forward ones: <forward(x), g> = <x, backward(g)>.
+        SingleMatrix x = SingleMatrix::RandomUniform(inRows, numImg, deviceId, -1, 1, IncrementCounter());
+        SingleMatrix g = SingleMatrix::RandomUniform(outRows, numImg, deviceId, -1, 1, IncrementCounter());
+        for (bool roiAlign : { false, true })
+        {
+            SingleMatrix argmax(outRows, numImg, deviceId);
+            SingleMatrix grad(inRows, numImg, deviceId);
+            grad.SetValue(0);
+            if (roiAlign)
+            {
+                x.AverageROIAlignForward(numRois, numImg, channels, width, height, pooledWidth, pooledHeight, rois, out, spatialScale);
+                g.AverageROIAlignBackward(numRois, numImg, channels, width, height, pooledWidth, pooledHeight, rois, grad, spatialScale);
+            }
+            else
+            {
+                x.MaxROIPoolingForward(numRois, numImg, channels, width, height, pooledWidth, pooledHeight, rois, out, argmax, spatialScale);
+                g.MaxROIPoolingBackward(numRois, numImg, channels, width, height, pooledWidth, pooledHeight, rois, grad, argmax, spatialScale);
+            }
+            float forward = SingleMatrix::InnerProductOfMatrices(out, g);
+            float backward = SingleMatrix::InnerProductOfMatrices(x, grad);
+            BOOST_CHECK_CLOSE(forward, backward, 1e-2);
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(MatrixSegmentedReduction, RandomSeedFixture)
+{
+    // 4 sequences packed into 3 parallel streams of 4 time steps; columns 2 and 11 are gaps.
+    const size_t numRows = 5, numParallel = 3, numCols = 12;
+    std::vector<float> segmentData = { 0, 4,   1, 2,   7, 2,   5, 2 }; // (first column, length) of each sequence
+    const size_t numSegments = segmentData.size() / 2;
+    const std::vector<std::pair<ElementWiseOperator, bool>> reductions = {
+        { ElementWiseOperator::opSum, false }, { ElementWiseOperator::opSum, true }, { ElementWiseOperator::opLogSum, false },
+        { ElementWiseOperator::opMin, false }, { ElementWiseOperator::opMax, false } };
+
+    SingleMatrix x = SingleMatrix::RandomUniform(numRows, numCols, CPUDEVICE, -1, 1, IncrementCounter());
+    SingleMatrix g = SingleMatrix::RandomUniform(numRows, numSegments, CPUDEVICE, -1, 1, IncrementCounter());
+    std::unique_ptr<float[]> xData(x.CopyToArray()), gData(g.CopyToArray());
+
+    for (DEVICEID_TYPE deviceId : { CPUDEVICE, c_deviceIdZero })
+    {
+        SingleMatrix segments(2, numSegments, segmentData.data(), deviceId);
+        SingleMatrix in(numRows, numCols, xData.get(), deviceId);
+        SingleMatrix outGrad(numRows, numSegments, gData.get(), deviceId);
+        for (const auto& reduction : reductions)
+        {
+            const auto op = reduction.first;
+            const bool average = reduction.second;
+            SingleMatrix out(deviceId);
+            out.AssignSegmentedReductionOf(in, segments, numParallel, op, average);
+
+            SingleMatrix inGrad(numRows, numCols, deviceId);
+            inGrad.SetValue(1);
+            inGrad.DoSegmentedReductionGradientOf(/*beta=*/1, outGrad, in, out, segments, numParallel, op, average);
+
+            BOOST_REQUIRE_EQUAL(out.GetNumCols(), numSegments);
+            std::unique_ptr<float[]> outData(out.CopyToArray()), inGradData(inGrad.CopyToArray());
+            std::vector<float> expectedGrad(numRows * numCols, 1);
+            for (size_t j = 0; j < numSegments; j++)
+            {
+                size_t first = (size_t)segmentData[2 * j], length = (size_t)segmentData[2 * j + 1];
+                for (size_t i = 0; i < numRows; i++)
+                {
+                    double expected = xData[first * numRows + i];
+                    for (size_t k = 1; k < length; k++)
+                    {
+                        double v = xData[(first + k * numParallel) * numRows + i];
+                        switch (op)
+                        {
+                        case ElementWiseOperator::opSum:    expected += v;                                                                   break;
+                        case ElementWiseOperator::opLogSum: expected = std::max(expected, v) + log1p(exp(-fabs(expected - v)));             break;
+                        case ElementWiseOperator::opMin:    expected = std::min(expected, v);                                                break;
+                        default:                            expected = std::max(expected, v);                                                break;
+                        }
+                    }
+                    if (average)
+                        expected /= length;
+                    BOOST_CHECK_SMALL(outData[j * numRows + i] - expected, 1e-4);
+
+                    for (size_t k = 0; k < length; k++)
+                    {
+                        size_t index = (first + k * numParallel) * numRows + i;
+                        double grad = gData[j * numRows + i];
+                        switch (op)
+                        {
+                        case ElementWiseOperator::opSum:    grad /= average ? length : 1;                                                    break;
+                        case ElementWiseOperator::opLogSum: grad *= exp(xData[index] - outData[j * numRows + i]);                           break;
+                        default:                            grad = xData[index] == outData[j * numRows + i] ? grad : 0;                      break;
+                        }
+                        expectedGrad[index] += (float)grad;
+                    }
+                }
+            }
+            // the gaps keep their gradient
+            for (size_t i = 0; i < numRows * numCols; i++)
+                BOOST_CHECK_SMALL(inGradData[i] - expectedGrad[i], 1e-4f);
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(MatrixHistogram, RandomSeedFixture)
+{
+    // Values on the limits go to the bucket below them, and the infinities and NaN are left out. 9000 limits are too many
+    // to count in the shared memory of a GPU block.
+    const size_t rows = 317, cols = 401;
+    std::vector<float> data(rows * cols);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (float)((int)((i * 7919) % 2003) - 1000) / 8;
+    data[5] = std::numeric_limits<float>::infinity();
+    data[77] = -std::numeric_limits<float>::infinity();
+    data[1234] = std::numeric_limits<float>::quiet_NaN();
+
+    for (size_t numLimits : { 3, 50, 9000 })
+    {
+        std::vector<float> limits(numLimits);
+        for (size_t i = 0; i < numLimits; i++)
+            limits[i] = -100 + 200.0f * i / (numLimits - 1);
+
+        std::vector<double> expected(numLimits + 5, 0);
+        double sumOfAbs = 0;
+        expected[numLimits + 3] = std::numeric_limits<double>::infinity();
+        expected[numLimits + 4] = -std::numeric_limits<double>::infinity();
+        for (float v : data)
+        {
+            if (!std::isfinite(v))
+                continue;
+            size_t bucket = 0;
+            while (bucket < numLimits && v > limits[bucket])
+                bucket++;
+            expected[bucket]++;
+            expected[numLimits + 1] += v;
+            sumOfAbs += fabs(v);
+            expected[numLimits + 2] += (double)v * v;
+            expected[numLimits + 3] = std::min(expected[numLimits + 3], (double)v);
+            expected[numLimits + 4] = std::max(expected[numLimits + 4], (double)v);
+        }
+
+        for (DEVICEID_TYPE deviceId : { CPUDEVICE, c_deviceIdZero })
+        {
+            SingleMatrix a(rows, cols, data.data(), deviceId);
+            SingleMatrix bucketLimits(1, numLimits, limits.data(), deviceId);
+            SingleMatrix histogram(deviceId);
+            histogram.AssignHistogramOf(a, bucketLimits);
+            BOOST_REQUIRE_EQUAL(histogram.GetNumElements(), numLimits + 5);
+            std::unique_ptr<float[]> result(histogram.CopyToArray());
+            for (size_t i = 0; i <= numLimits; i++)
+                BOOST_CHECK_EQUAL(result[i], expected[i]);
+            // the sums are accumulated in float, in an order that depends on the device
+            BOOST_CHECK_SMALL(result[numLimits + 1] - expected[numLimits + 1], 1e-5 * sumOfAbs);
+            BOOST_CHECK_SMALL(result[numLimits + 2] - expected[numLimits + 2], 1e-5 * expected[numLimits + 2]);
+            BOOST_CHECK_EQUAL(result[numLimits + 3], expected[numLimits + 3]);
+            BOOST_CHECK_EQUAL(result[numLimits + 4], expected[numLimits + 4]);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
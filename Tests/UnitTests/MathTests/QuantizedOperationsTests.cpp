@@ -5,6 +5,7 @@
 #include "stdafx.h"
 #include "../../../Source/Math/QuantizedOperations.h"
 #include "../../../Source/Math/Helpers.h"
+#include <random>
 
 using namespace Microsoft::MSR::CNTK;
 namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
@@ -50,6 +51,53 @@ BOOST_FIXTURE_TEST_CASE(MultiplyIntToShort, RandomSeedFixture)
         BOOST_CHECK_EQUAL(round(C_upd[i]), C_expected_upd[i]);
 }
 
+BOOST_FIXTURE_TEST_CASE(MultiplyInt8MatchesFloatProduct, RandomSeedFixture)
+{
+    // A[m,k]*B[k,n] = C[m,n], with sizes that are not multiples of the vector and tile widths
+    int m = 70, n = 19, k = 37;
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+    std::vector<float> A(m * k), B(k * n), C(m * n);
+    for (auto& a : A)
+        a = dist(rng);
+    for (auto& b : B)
+        b = dist(rng);
+    for (int l = 0; l < k; l++) // an all-zero row of A
+        A[3 + l * m] = 0;
+
+    Int8QuantizedMultiplier<float> mult;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        mult.Multiply(m, n, k, A.data(), B.data(), C.data());
+
+        // every quantized value is off by at most half its scale
+        std::vector<float> scaleA(m), scaleB(n);
+        for (int i = 0; i < m; i++)
+            for (int l = 0; l < k; l++)
+                scaleA[i] = std::max(scaleA[i], std::abs(A[i + l * m]) / 127);
+        for (int j = 0; j < n; j++)
+            for (int l = 0; l < k; l++)
+                scaleB[j] = std::max(scaleB[j], std::abs(B[l + j * k]) / 127);
+
+        for (int i = 0; i < m; i++)
+            for (int j = 0; j < n; j++)
+            {
+                double expected = 0, bound = 0;
+                for (int l = 0; l < k; l++)
+                {
+                    expected += (double)A[i + l * m] * B[l + j * k];
+                    bound += std::abs(A[i + l * m]) * scaleB[j] / 2 + std::abs(B[l + j * k]) * scaleA[i] / 2 + scaleA[i] * scaleB[j] / 4;
+                }
+                BOOST_CHECK_LE(std::abs(C[i + j * m] - expected), bound * 1.01 + 1e-5);
+                if (i == 3)
+                    BOOST_CHECK_EQUAL(C[i + j * m], 0);
+            }
+
+        // the second pass uses the cached weights with new data
+        for (auto& b : B)
+            b = dist(rng);
+    }
+}
 
 BOOST_AUTO_TEST_SUITE_END()
 
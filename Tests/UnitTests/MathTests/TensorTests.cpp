@@ -63,6 +63,29 @@ BOOST_AUTO_TEST_CASE(BiasAddition2)
     });
 }
 
+BOOST_AUTO_TEST_CASE(AdditionForCommonShapes)
+{
+    Test::TensorTest<float> tensorTester;
+
+    // shapes with kernels of their own on the GPU; odd sizes leave elements after the last whole vector
+    tensorTester.OneTensorTest("elementwise addition (gap-free, odd size)", 1e-8, [&tensorTester](DEVICEID_TYPE deviceId)
+    {
+        return tensorTester.BroadcastingTest(TensorShape{ 1027 }, TensorShape{ 1027 }, deviceId);
+    });
+    tensorTester.OneTensorTest("addition of a scalar", 1e-8, [&tensorTester](DEVICEID_TYPE deviceId)
+    {
+        return tensorTester.BroadcastingTest(TensorShape{ 1027 }, TensorShape{ 1 }, deviceId);
+    });
+    tensorTester.OneTensorTest("addition of a column (broadcasting)", 1e-8, [&tensorTester](DEVICEID_TYPE deviceId)
+    {
+        return tensorTester.BroadcastingTest(TensorShape{ 300, 77 }, TensorShape{ 300 }, deviceId);
+    });
+    tensorTester.OneTensorTest("addition of a row (broadcasting)", 1e-8, [&tensorTester](DEVICEID_TYPE deviceId)
+    {
+        return tensorTester.BroadcastingTest(TensorShape{ 300, 77 }, TensorShape{ 1, 77 }, deviceId);
+    });
+}
+
 BOOST_AUTO_TEST_CASE(BiasGradient)
 {
     Test::TensorTest<float> tensorTester;
@@ -101,6 +124,71 @@ BOOST_AUTO_TEST_CASE(OldRnnForwardProp)
     TestOldRnnForwardPropSRP<float>();
 }
 
+BOOST_AUTO_TEST_CASE(CpuBlockedReductionOverOuterAxes)
+{
+    Test::TensorTest<double> tensorTester;
+
+    // enough rows for several tiles and a partial one, enough columns to split the reduction into chunks
+    const size_t rows = 300, cols = 9000;
+    auto input = tensorTester.CreateTensor(TensorShape{ rows, cols }, 1, CPUDEVICE);
+    auto rowSums = tensorTester.CreateTensor(TensorShape{ rows, 1 }, 2, CPUDEVICE);
+    auto total = tensorTester.CreateTensor(TensorShape{ 1, 1 }, 3, CPUDEVICE);
+
+    rowSums.DoCopyOf(0, input, 1);
+    total.DoUnaryOpOf(0, input, 1, ElementWiseOperator::opSqr, ElementWiseOperator::opSum);
+
+    const double* data = input.GetSOB().Data();
+    double expectedTotal = 0;
+    for (size_t i = 0; i < rows; i++)
+    {
+        double sum = 0;
+        for (size_t j = 0; j < cols; j++)
+        {
+            sum += data[i + j * rows];
+            expectedTotal += data[i + j * rows] * data[i + j * rows];
+        }
+        BOOST_CHECK_CLOSE(rowSums.GetSOB().Data()[i], sum, 1e-9);
+    }
+    BOOST_CHECK_CLOSE(total.GetSOB().Data()[0], expectedTotal, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(CpuSimdKernelsMatchGenericCode)
+{
+    Test::TensorTest<float> tensorTester;
+    const int flags = CPUMatrix<float>::GetOptimizationFlags();
+
+    // computes 'fn(result)' with and without the vectorized kernels, and compares
+    auto test = [&](const char* what, TensorShape resultShape, const std::function<void(TensorView<float>&)>& fn)
+    {
+        fprintf(stderr, "===== CPU SIMD test '%s'\n", what);
+        TensorView<float> results[2] = { tensorTester.CreateTensor(resultShape, 7, CPUDEVICE), tensorTester.CreateTensor(resultShape, 7, CPUDEVICE) };
+        CPUMatrix<float>::SetOptimizationFlags(flags & ~CPUMatrix<float>::OPT_EVAL_WITH_SIMD);
+        fn(results[0]);
+        CPUMatrix<float>::SetOptimizationFlags(flags | CPUMatrix<float>::OPT_EVAL_WITH_SIMD);
+        fn(results[1]);
+        CPUMatrix<float>::SetOptimizationFlags(flags);
+        BOOST_CHECK(results[0].GetSOB().IsEqualTo(results[1].GetSOB(), 1e-5f));
+    };
+
+    // odd sizes to cover the tails of the vector loops
+    const TensorShape shape{ 37, 29 };
+    int randomSeed = 1;
+    auto a = tensorTester.CreateTensor(shape, randomSeed++, CPUDEVICE);
+    auto b = tensorTester.CreateTensor(shape, randomSeed++, CPUDEVICE);
+    auto positive = tensorTester.CreateTensor(shape, randomSeed++, CPUDEVICE);
+    positive.AssignExpOf(positive, 4);
+
+    test("sigmoid", shape, [&](TensorView<float>& r) { r.AssignSigmoidOf(a, 8); });
+    test("tanh", shape, [&](TensorView<float>& r) { r.AssignTanhOf(a, 3); });
+    test("exp", shape, [&](TensorView<float>& r) { r.AddExpOf(a, 2); });
+    test("log", shape, [&](TensorView<float>& r) { r.AssignLogOf(positive, 1); });
+    test("sum", shape, [&](TensorView<float>& r) { r.AssignSumOf(a, b, 1); });
+    test("product", shape, [&](TensorView<float>& r) { r.DoElementwiseProductOf(0.5f, a, b, 2); });
+    test("column sum", TensorShape{ 1, 29 }, [&](TensorView<float>& r) { r.DoCopyOf(1, a, 1); });
+    test("column max", TensorShape{ 1, 29 }, [&](TensorView<float>& r) { r.DoUnaryOpOf(0, a, 1, ElementWiseOperator::opCopy, ElementWiseOperator::opMax); });
+    test("total min", TensorShape{ 1, 1 }, [&](TensorView<float>& r) { r.DoUnaryOpOf(0, a, 1, ElementWiseOperator::opCopy, ElementWiseOperator::opMin); });
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE(Half_MathTensorTests)
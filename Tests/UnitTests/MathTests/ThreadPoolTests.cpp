@@ -0,0 +1,144 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "../../../Source/Math/ThreadPool.h"
+#include <random>
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(ThreadPoolUnitTests)
+
+BOOST_FIXTURE_TEST_CASE(ParallelForCoversRangeOnce, RandomSeedFixture)
+{
+    ThreadPool& pool = ThreadPool::Get();
+    for (size_t grainSize : { 1, 7, 1000, 5000 })
+    {
+        std::vector<std::atomic<int>> counts(3001);
+        for (auto& c : counts)
+            c = 0;
+        pool.ParallelFor(1, counts.size(), grainSize, [&](size_t begin, size_t end)
+        {
+            BOOST_REQUIRE(begin < end && end - begin <= grainSize);
+            for (size_t i = begin; i < end; i++)
+                counts[i]++;
+        });
+        BOOST_CHECK_EQUAL(counts[0], 0);
+        for (size_t i = 1; i < counts.size(); i++)
+            BOOST_CHECK_EQUAL(counts[i], 1);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(ParallelForNestedAndFromTasks, RandomSeedFixture)
+{
+    ThreadPool& pool = ThreadPool::Get();
+    std::atomic<size_t> sum(0);
+    auto nested = [&]()
+    {
+        pool.ParallelFor(0, 64, 1, [&](size_t begin, size_t end)
+        {
+            pool.ParallelFor(0, 100, 10, [&](size_t b, size_t e) { sum += (end - begin) * (e - b); });
+        });
+    };
+
+    nested();
+    BOOST_CHECK_EQUAL(sum, 64 * 100);
+
+    // the same from several tasks at once
+    sum = 0;
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 4; i++)
+        futures.push_back(pool.Async(nested));
+    for (auto& f : futures)
+        f.get();
+    BOOST_CHECK_EQUAL(sum, 4 * 64 * 100);
+}
+
+BOOST_FIXTURE_TEST_CASE(ParallelForAndAsyncPropagateExceptions, RandomSeedFixture)
+{
+    ThreadPool& pool = ThreadPool::Get();
+    BOOST_CHECK_THROW(pool.ParallelFor(0, 100, 1, [](size_t begin, size_t) { if (begin == 42) throw std::runtime_error("42"); }), std::runtime_error);
+
+    auto result = pool.Async([]() { return 7; });
+    BOOST_CHECK_EQUAL(result.get(), 7);
+    auto failure = pool.Async([]() -> int { throw std::logic_error("failed"); });
+    BOOST_CHECK_THROW(failure.get(), std::logic_error);
+}
+
+BOOST_FIXTURE_TEST_CASE(RunTaskGraphRespectsDependencies, RandomSeedFixture)
+{
+    ThreadPool& pool = ThreadPool::Get();
+    const size_t budget = ThreadPool::GetThreadBudget();
+    std::mt19937 rng(42);
+    for (size_t numThreads : { (size_t)1, (size_t)4 })
+    {
+        ThreadPool::SetThreadBudget(numThreads);
+        for (int trial = 0; trial < 10; trial++)
+        {
+            const size_t numTasks = 200;
+            std::vector<std::vector<size_t>> dependencies(numTasks);
+            for (size_t i = 1; i < numTasks; i++)
+            {
+                const size_t numDependencies = rng() % 4;
+                for (size_t k = 0; k < numDependencies; k++)
+                    dependencies[i].push_back(rng() % i);
+            }
+
+            std::vector<std::atomic<int>> counts(numTasks);
+            for (auto& c : counts)
+                c = 0;
+            std::atomic<bool> ordered(true);
+            pool.RunTaskGraph(dependencies, [&](size_t i)
+            {
+                for (auto dependency : dependencies[i])
+                    ordered = ordered && counts[dependency] == 1;
+                counts[i]++;
+            });
+            BOOST_CHECK(ordered);
+            for (auto& c : counts)
+                BOOST_CHECK_EQUAL(c, 1);
+        }
+    }
+    ThreadPool::SetThreadBudget(budget);
+}
+
+BOOST_FIXTURE_TEST_CASE(RunTaskGraphPropagatesExceptions, RandomSeedFixture)
+{
+    ThreadPool& pool = ThreadPool::Get();
+    // a chain 0 -> 1 -> 2 that fails at 1, and an independent task 3
+    std::vector<std::vector<size_t>> dependencies = { {}, { 0 }, { 1 }, {} };
+    std::atomic<bool> ranAfterFailure(false);
+    BOOST_CHECK_THROW(pool.RunTaskGraph(dependencies, [&](size_t i)
+    {
+        if (i == 1)
+            throw std::runtime_error("1");
+        if (i == 2)
+            ranAfterFailure = true;
+    }), std::runtime_error);
+    BOOST_CHECK(!ranAfterFailure);
+
+    BOOST_CHECK_THROW(pool.RunTaskGraph({ {}, { 1 } }, [](size_t) {}), std::logic_error);
+}
+
+BOOST_FIXTURE_TEST_CASE(ThreadBudgetSetsNumberOfWorkers, RandomSeedFixture)
+{
+    const size_t budget = ThreadPool::GetThreadBudget();
+
+    ThreadPool::SetThreadBudget(3);
+    BOOST_CHECK_EQUAL(ThreadPool::Get().GetNumWorkers(), 2);
+
+    // without workers everything runs on the calling thread
+    ThreadPool::SetThreadBudget(1);
+    BOOST_CHECK_EQUAL(ThreadPool::Get().GetNumWorkers(), 0);
+    const auto caller = std::this_thread::get_id();
+    ThreadPool::Get().ParallelFor(0, 10, 1, [&](size_t, size_t) { BOOST_CHECK(std::this_thread::get_id() == caller); });
+    BOOST_CHECK(ThreadPool::Get().Async([]() { return std::this_thread::get_id(); }).get() == caller);
+
+    ThreadPool::SetThreadBudget(budget);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
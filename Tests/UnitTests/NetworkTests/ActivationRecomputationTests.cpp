@@ -0,0 +1,60 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+
+#include "../../../Source/ComputationNetworkLib/LinearAlgebraNodes.h"
+#include "../../../Source/ComputationNetworkLib/TrainingNodes.h"
+#include "TestHelpers.h"
+#include <memory>
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(ActivationRecomputationTestSuite)
+
+BOOST_AUTO_TEST_CASE(ForwardPropRecomputableNodes)
+{
+    auto input = make_shared<DummyNodeTest<float>>(CPUDEVICE, L"input");
+    auto weights = make_shared<DummyNodeTest<float>>(CPUDEVICE, L"weights");
+
+    // leaves hold data that cannot be recomputed
+    BOOST_CHECK(!input->IsForwardPropRecomputable());
+
+    auto plus = make_shared<PlusNode<float>>(CPUDEVICE, L"plus");
+    plus->AttachInputs({ input, weights });
+    BOOST_CHECK(plus->IsForwardPropRecomputable());
+
+    auto times = make_shared<TimesNode<float>>(CPUDEVICE, L"times");
+    times->AttachInputs({ weights, input });
+    BOOST_CHECK(times->IsForwardPropRecomputable());
+
+    // a second forward pass would draw a different mask
+    auto dropout = make_shared<DropoutNode<float>>(CPUDEVICE, L"dropout");
+    dropout->AttachInputs({ plus });
+    BOOST_CHECK(!dropout->IsForwardPropRecomputable());
+}
+
+BOOST_AUTO_TEST_CASE(RecomputeDuringBackpropRequest)
+{
+    auto plus = make_shared<PlusNode<float>>(CPUDEVICE, L"plus");
+    BOOST_CHECK(!plus->IsRecomputeDuringBackpropRequested());
+
+    plus->SetRecomputeDuringBackprop(true);
+    BOOST_CHECK(plus->IsRecomputeDuringBackpropRequested());
+
+    // the request survives copying the node
+    auto copy = make_shared<PlusNode<float>>(CPUDEVICE, L"copy");
+    plus->CopyTo(copy, L"copy", CopyNodeFlags::copyNodeValue);
+    BOOST_CHECK(copy->IsRecomputeDuringBackpropRequested());
+
+    // without a buffer from the matrix pool, there is nothing to swap in
+    BOOST_CHECK_THROW(plus->SwapRecomputedValue(), std::logic_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
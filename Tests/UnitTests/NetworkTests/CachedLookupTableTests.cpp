@@ -0,0 +1,125 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+
+#include "../../../Source/ComputationNetworkLib/InputAndParamNodes.h"
+#include "TestHelpers.h"
+#include <memory>
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// We perform test on CPU; the cache only moves columns between host and device through Matrix operations.
+const DEVICEID_TYPE c_deviceId = CPUDEVICE;
+
+const size_t c_tableSize = 4;
+const size_t c_embeddingDim = 2;
+const size_t c_numSlots = 2;
+const size_t c_minibatchSize = 2;
+
+// Extends the cached lookup table node to drive it without a network and to access its table.
+template <class ElemType>
+class CachedLookupTableNodeTest : public CachedLookupTableNode<ElemType>
+{
+public:
+    CachedLookupTableNodeTest()
+        : CachedLookupTableNode<ElemType>(c_deviceId, L"CachedLookupTableNodeTest", c_tableSize)
+    {
+    }
+
+    // sets row r of the table to (r, 10 * r)
+    void SetTable()
+    {
+        vector<ElemType> table;
+        for (size_t row = 0; row < c_tableSize; row++)
+        {
+            table.push_back((ElemType)row);
+            table.push_back((ElemType)(10 * row));
+        }
+        this->m_table.SetValue(c_embeddingDim, c_tableSize, CPUDEVICE, table.data());
+    }
+
+    size_t SlotOf(size_t row) { return this->m_slotOfRow.at(row); }
+
+    // looks up one row per sample
+    void ForwardPass(DummyNodeTest<ElemType>& input, const vector<CPUSPARSE_INDEX_TYPE>& rows)
+    {
+        vector<CPUSPARSE_INDEX_TYPE> colStarts = { 0, 1, 2 };
+        vector<ElemType> values(rows.size(), 1);
+        input.Value().SwitchToMatrixType(SPARSE, matrixFormatSparseCSC, false);
+        input.Value().SetMatrixFromCSCFormat(colStarts.data(), rows.data(), values.data(), rows.size(), c_tableSize, c_minibatchSize);
+
+        this->CreateValueMatrixIfNull();
+        this->UpdateFunctionValuesSize();
+        this->ForwardPropNonLooping();
+    }
+
+    bool IsOutputEqualTo(const vector<ElemType>& output)
+    {
+        return AreEqual(output.data(), this->Value().Data(), output.size(), 1e-6f);
+    }
+};
+
+template <class ElemType>
+void CachedLookupTableTestImpl()
+{
+    auto cache = make_shared<LearnableParameter<ElemType>>(c_deviceId, L"cache", c_embeddingDim, c_numSlots);
+    vector<ElemType> inputData(c_tableSize * c_minibatchSize, 0);
+    auto input = make_shared<DummyNodeTest<ElemType>>(c_deviceId, c_minibatchSize, SmallVector<size_t>{ c_tableSize }, inputData);
+    auto node = make_shared<CachedLookupTableNodeTest<ElemType>>();
+    node->AttachInputs(vector<ComputationNodeBasePtr>{ cache, input });
+    node->Validate(true);
+    node->SetTable();
+
+    // Rows that are not cached are loaded.
+    node->ForwardPass(*input, { 0, 1 });
+    BOOST_REQUIRE_MESSAGE(node->IsOutputEqualTo({ 0, 0, 1, 10 }), "Rows are not loaded into the cache");
+
+    // The cached rows are updated, as by a learner.
+    cache->Value() += (ElemType)100;
+
+    // Row 2 evicts row 1, which the minibatch does not look up; row 0 is used from the cache.
+    node->ForwardPass(*input, { 2, 0 });
+    BOOST_REQUIRE_MESSAGE(node->IsOutputEqualTo({ 2, 20, 100, 100 }), "Cached rows are not used");
+
+    // Row 1 evicts row 2, which is looked up less frequently than row 0, and is reloaded with its update.
+    node->ForwardPass(*input, { 1, 1 });
+    BOOST_REQUIRE_MESSAGE(node->IsOutputEqualTo({ 101, 110, 101, 110 }), "Evicted rows are not written back");
+    BOOST_REQUIRE_MESSAGE(node->SlotOf(0) != node->SlotOf(1), "The most frequently used row is evicted");
+
+    const auto& table = node->GetTable();
+    vector<ElemType> expectedTable = { 100, 100, 101, 110, 2, 20, 3, 30 };
+    BOOST_REQUIRE_MESSAGE(AreEqual(expectedTable.data(), table.Data(), expectedTable.size(), 1e-6f), "Cached rows are not written back to the table");
+
+    // The gradient of the cache is that of the slots that were looked up.
+    node->CreateGradientMatrixIfNull();
+    node->GradientPtrRef()->Resize(c_embeddingDim, c_minibatchSize);
+    node->GradientPtrRef()->SetValue(1);
+    cache->CreateGradientMatrixIfNull();
+    cache->GradientPtrRef()->Resize(c_embeddingDim, c_numSlots);
+    cache->GradientPtrRef()->SetValue(0);
+    cache->SetPreferredGradientMatrixType(DENSE);
+    node->BackpropToNonLooping(0);
+
+    vector<ElemType> expectedGradient(c_embeddingDim * c_numSlots, 0);
+    expectedGradient[node->SlotOf(1) * c_embeddingDim] = 2;
+    expectedGradient[node->SlotOf(1) * c_embeddingDim + 1] = 2;
+    BOOST_REQUIRE_MESSAGE(AreEqual(expectedGradient.data(), cache->GradientPtrRef()->Data(), expectedGradient.size(), 1e-6f), "The gradient of the cache is invalid");
+}
+
+BOOST_AUTO_TEST_SUITE(CachedLookupTableTestSuite)
+
+BOOST_AUTO_TEST_CASE(CachedLookupTableTest)
+{
+    CachedLookupTableTestImpl<float>();
+    CachedLookupTableTestImpl<double>();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
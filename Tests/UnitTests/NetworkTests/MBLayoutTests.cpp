@@ -0,0 +1,73 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+
+#include "../../../Source/Common/Include/Sequences.h"
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(MBLayoutTestSuite)
+
+// three parallel sequences: one truncated at the start, two in a row, and one followed by a gap
+static MBLayoutPtr CreateTestLayout()
+{
+    auto layout = make_shared<MBLayout>(3, 6, L"");
+    layout->AddSequence(0, 0, -2, 6);
+    layout->AddSequence(1, 1, 0, 2);
+    layout->AddSequence(2, 1, 2, 6);
+    layout->AddSequence(3, 2, 0, 4);
+    layout->AddGap(2, 4, 6);
+    return layout;
+}
+
+BOOST_AUTO_TEST_CASE(DelayedFramesMatchPerFrameTests)
+{
+    auto layout = CreateTestLayout();
+    const size_t S = layout->GetNumParallelSequences(), T = layout->GetNumTimeSteps();
+    for (ptrdiff_t timeOffset : { -2, -1, 1, 3 })
+    {
+        auto delayedFrames = layout->GetDelayedFrames(timeOffset);
+        BOOST_REQUIRE_EQUAL(delayedFrames->m_invalid.size(), S * T);
+        for (size_t t = 0; t < T; t++)
+        {
+            FrameRange fr(layout, t);
+            bool anyValid = false, allValid = true;
+            for (size_t s = 0; s < S; s++)
+            {
+                bool invalid = layout->IsBeyondStartOrEnd(fr.WithTimeOffset(timeOffset).Sequence(s)) || layout->IsGap(fr.Sequence(s));
+                BOOST_CHECK_EQUAL(delayedFrames->m_invalid[t * S + s] != 0, invalid);
+                anyValid |= !invalid;
+                allValid &= !invalid;
+            }
+            BOOST_CHECK_EQUAL(delayedFrames->m_anySeqValid[t], anyValid);
+            BOOST_CHECK_EQUAL(delayedFrames->m_allSeqValid[t], allValid);
+        }
+
+        // determined once, and shared by copies of the layout
+        BOOST_CHECK(layout->GetDelayedFrames(timeOffset) == delayedFrames);
+        auto copy = make_shared<MBLayout>();
+        copy->CopyFrom(layout);
+        BOOST_CHECK(copy->GetDelayedFrames(timeOffset) == delayedFrames);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ColumnsValidityMaskMarksGaps)
+{
+    auto layout = CreateTestLayout();
+    const size_t S = layout->GetNumParallelSequences(), T = layout->GetNumTimeSteps();
+    const auto& mask = layout->GetColumnsValidityMask(CPUDEVICE);
+    BOOST_REQUIRE_EQUAL(mask.GetNumElements(), S * T);
+    const char* data = mask.Data();
+    for (size_t t = 0; t < T; t++)
+        for (size_t s = 0; s < S; s++)
+            BOOST_CHECK_EQUAL(data[t * S + s] == 0, layout->IsGap(FrameRange(layout, t).Sequence(s)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
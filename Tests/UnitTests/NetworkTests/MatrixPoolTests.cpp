@@ -0,0 +1,64 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+
+#include "../../../Source/ComputationNetworkLib/MatrixPool.h"
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(MatrixPoolTestSuite)
+
+BOOST_AUTO_TEST_CASE(PlanMemoryOffsetsReusesGaps)
+{
+    // a (size 10) and c (size 4) live at the same time as b (size 6); c can reuse the memory of a once a is released
+    vector<MemoryLifetime> requests = {
+        { 0, 2, 10 }, // a
+        { 1, 5, 6 },  // b
+        { 3, 6, 4 },  // c
+    };
+
+    vector<size_t> offsets;
+    size_t arenaSize = PlanMemoryOffsets(requests, offsets);
+
+    BOOST_CHECK_EQUAL(arenaSize, 16);
+    BOOST_CHECK_EQUAL(offsets[0], 0);
+    BOOST_CHECK_EQUAL(offsets[1], 10);
+    BOOST_CHECK_EQUAL(offsets[2], 0);
+    BOOST_CHECK_EQUAL(ComputeMemoryLowerBound(requests), 16);
+}
+
+BOOST_AUTO_TEST_CASE(PlanMemoryOffsetsNeverOverlapsLiveRequests)
+{
+    vector<MemoryLifetime> requests;
+    for (int i = 0; i < 50; i++)
+        requests.push_back(MemoryLifetime{ i, i + (i % 7), (size_t)(1 + (i * 37) % 23) });
+
+    vector<size_t> offsets;
+    size_t arenaSize = PlanMemoryOffsets(requests, offsets);
+
+    size_t naive = 0;
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+        naive += requests[i].size;
+        BOOST_CHECK(offsets[i] + requests[i].size <= arenaSize);
+        for (size_t j = 0; j < i; j++)
+        {
+            if (!requests[i].Overlaps(requests[j]))
+                continue;
+            bool disjointInMemory = offsets[i] + requests[i].size <= offsets[j] || offsets[j] + requests[j].size <= offsets[i];
+            BOOST_CHECK(disjointInMemory);
+        }
+    }
+
+    BOOST_CHECK(arenaSize >= ComputeMemoryLowerBound(requests));
+    BOOST_CHECK(arenaSize < naive);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
@@ -0,0 +1,53 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+
+#include "TestHelpers.h"
+#include <memory>
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(NodeTimingTestSuite)
+
+BOOST_AUTO_TEST_CASE(NodeTimingStatisticsAccumulateAndReset)
+{
+    vector<float> data(3 * 4, 1.0f);
+    auto node = make_shared<DummyNodeTest<float>>(CPUDEVICE, 4, SmallVector<size_t>{ 3 }, data);
+
+    // nothing is recorded while node timing is disabled
+    Globals::SetNodeTiming(false);
+    node->BeginTiming(false);
+    node->EndTiming(false);
+    NodeTimingStatistics statistics;
+    BOOST_CHECK(!node->GetTimingStatistics(statistics));
+
+    Globals::SetNodeTiming(true);
+    for (int i = 0; i < 2; i++)
+    {
+        node->BeginTiming(false);
+        node->EndTiming(false);
+    }
+    node->BeginTiming(true);
+    node->EndTiming(true);
+    Globals::SetNodeTiming(false);
+
+    BOOST_REQUIRE(node->GetTimingStatistics(statistics));
+    BOOST_CHECK_EQUAL(statistics.forwardCount, 2);
+    BOOST_CHECK_EQUAL(statistics.backwardCount, 1);
+    BOOST_CHECK(!statistics.onGPU);
+    BOOST_CHECK(statistics.forwardSeconds >= 0 && statistics.backwardSeconds >= 0);
+    BOOST_CHECK(statistics.value == &node->Value());
+    BOOST_CHECK(statistics.valueBytes >= data.size() * sizeof(float));
+
+    node->ResetTiming();
+    BOOST_CHECK(!node->GetTimingStatistics(statistics));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
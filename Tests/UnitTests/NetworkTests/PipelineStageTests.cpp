@@ -0,0 +1,100 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+
+#include "../../../Source/ComputationNetworkLib/LinearAlgebraNodes.h"
+#include "../../../Source/ComputationNetworkLib/SpecialPurposeNodes.h"
+#include "TestHelpers.h"
+#include <memory>
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// We perform test on CPU; between GPUs, the values and gradients are copied asynchronously.
+const DEVICEID_TYPE c_deviceId = CPUDEVICE;
+
+// Extends the transfer node to drive it without a network.
+template <class ElemType>
+class DeviceTransferNodeTest : public DeviceTransferNode<ElemType>
+{
+public:
+    DeviceTransferNodeTest()
+        : DeviceTransferNode<ElemType>(c_deviceId, L"DeviceTransferNodeTest")
+    {
+    }
+
+    using DeviceTransferNode<ElemType>::Validate;
+
+    bool HasLayoutOf(const ComputationNodeBase& input) const
+    {
+        return this->GetMBLayout() == input.GetMBLayout() && this->GetSampleLayout() == input.GetSampleLayout();
+    }
+
+    void ForwardPass()
+    {
+        this->CreateValueMatrixIfNull();
+        this->UpdateFunctionValuesSize();
+        this->ForwardProp(FrameRange(this->GetMBLayout()));
+    }
+
+    void BackwardPass(vector<ElemType>& gradient)
+    {
+        this->CreateGradientMatrixIfNull();
+        this->Gradient().SetValue(this->GetSampleLayout().GetNumElements(), gradient.size() / this->GetSampleLayout().GetNumElements(), c_deviceId, gradient.data());
+        this->BackpropTo(0, FrameRange(this->GetMBLayout()));
+    }
+};
+
+template <class ElemType>
+void DeviceTransferTestImpl()
+{
+    const size_t c_minibatchSize = 2;
+    vector<ElemType> inputData = { 1, 2, 3, 4 };
+    auto input = make_shared<DummyNodeTest<ElemType>>(c_deviceId, c_minibatchSize, SmallVector<size_t>{ 2 }, inputData);
+    auto transfer = make_shared<DeviceTransferNodeTest<ElemType>>();
+    transfer->AttachInputs(vector<ComputationNodeBasePtr>{ input });
+    transfer->Validate(true);
+    BOOST_REQUIRE_MESSAGE(transfer->HasLayoutOf(*input), "The transfer does not keep the layout of its input");
+
+    // The value is that of the input.
+    transfer->ForwardPass();
+    BOOST_REQUIRE_MESSAGE(AreEqual(inputData.data(), transfer->Value().Data(), inputData.size(), 1e-6f), "The value is not transferred");
+
+    // The gradient is added to that of the input.
+    vector<ElemType> gradientData = { 10, 20, 30, 40 };
+    input->GetGradient().SetValue(1);
+    transfer->BackwardPass(gradientData);
+    vector<ElemType> expectedGradient = { 11, 21, 31, 41 };
+    BOOST_REQUIRE_MESSAGE(AreEqual(expectedGradient.data(), input->GetGradient().Data(), expectedGradient.size(), 1e-6f), "The gradient is not transferred back");
+}
+
+BOOST_AUTO_TEST_SUITE(PipelineStageTestSuite)
+
+BOOST_AUTO_TEST_CASE(DeviceTransferTest)
+{
+    DeviceTransferTestImpl<float>();
+    DeviceTransferTestImpl<double>();
+}
+
+BOOST_AUTO_TEST_CASE(PipelineStageAnnotation)
+{
+    ComputationNodeBasePtr plus = make_shared<PlusNode<float>>(c_deviceId, L"plus");
+    BOOST_CHECK_EQUAL(plus->GetPipelineStage(), -1);
+
+    plus->SetPipelineStage(1);
+    BOOST_CHECK_EQUAL(plus->GetPipelineStage(), 1);
+
+    // the stage survives copying the node
+    ComputationNodeBasePtr copy = make_shared<PlusNode<float>>(c_deviceId, L"copy");
+    plus->CopyTo(copy, L"copy", CopyNodeFlags::copyNodeValue);
+    BOOST_CHECK_EQUAL(copy->GetPipelineStage(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
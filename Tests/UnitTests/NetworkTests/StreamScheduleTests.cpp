@@ -0,0 +1,198 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+
+#include "../../../Source/ComputationNetworkLib/StreamSchedule.h"
+#include <random>
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// simulates the issue order of a schedule: whether every dependency of every node is ordered before it, either by
+// the order of a stream or through an event
+static bool RespectsDependencies(const StreamSchedule& schedule, const vector<vector<size_t>>& inputs, const vector<vector<size_t>>& predecessors)
+{
+    const size_t numNodes = inputs.size();
+    // done[i][j]: once node i has been issued, node j is known to have completed before
+    vector<vector<bool>> done(numNodes, vector<bool>(numNodes, false));
+    vector<vector<bool>> stream(schedule.numStreams, vector<bool>(numNodes, false)); // what the work issued on a stream so far waits for
+    vector<vector<bool>> event(schedule.numEvents, vector<bool>(numNodes, false));
+
+    vector<bool> beforeFork(numNodes, false);
+    for (auto leaf : schedule.leaves)
+        beforeFork[leaf] = true;
+    for (auto& s : stream)
+        s = beforeFork;
+
+    vector<bool> issued(numNodes, false);
+    for (auto leaf : schedule.leaves)
+        issued[leaf] = true;
+    for (const auto& step : schedule.steps)
+    {
+        auto& s = stream[step.stream];
+        for (auto e : step.waits)
+        {
+            for (size_t j = 0; j < numNodes; j++)
+                s[j] = s[j] || event[e][j];
+        }
+        done[step.node] = s;
+        s[step.node] = true;
+        if (step.event >= 0)
+            event[step.event] = s;
+        issued[step.node] = true;
+    }
+
+    for (size_t i = 0; i < numNodes; i++)
+    {
+        if (!issued[i])
+            return false;
+        if (beforeFork[i])
+            continue;
+        for (auto j : inputs[i])
+            if (!done[i][j])
+                return false;
+        if (i < predecessors.size())
+            for (auto j : predecessors[i])
+                if (!done[i][j])
+                    return false;
+    }
+    return true;
+}
+
+BOOST_AUTO_TEST_SUITE(StreamScheduleTestSuite)
+
+BOOST_AUTO_TEST_CASE(StreamScheduleRunsTowersConcurrently)
+{
+    // 0: input, 1: shared layer, then two towers 2 -> 4 and 3 -> 5, joined by 6
+    vector<vector<size_t>> inputs = { {}, { 0 }, { 1 }, { 1 }, { 2 }, { 3 }, { 4, 5 } };
+
+    auto schedule = PlanStreamSchedule(inputs, {}, 4);
+
+    BOOST_CHECK_EQUAL(schedule.leaves.size(), 1);
+    BOOST_CHECK_EQUAL(schedule.leaves[0], 0);
+    BOOST_REQUIRE_EQUAL(schedule.steps.size(), 6);
+    BOOST_CHECK_EQUAL(schedule.numStreams, 2);
+
+    // the towers are on different streams, each as a chain, and the join waits for the other tower only
+    vector<size_t> streamOf(inputs.size());
+    for (const auto& step : schedule.steps)
+        streamOf[step.node] = step.stream;
+    BOOST_CHECK_EQUAL(streamOf[2], streamOf[4]);
+    BOOST_CHECK_EQUAL(streamOf[3], streamOf[5]);
+    BOOST_CHECK_NE(streamOf[4], streamOf[5]);
+    BOOST_CHECK_EQUAL(schedule.numEvents, 2); // the fork (1) and the end of the second tower (5)
+    BOOST_CHECK_EQUAL(schedule.steps.back().waits.size(), 1);
+    BOOST_CHECK(RespectsDependencies(schedule, inputs, {}));
+}
+
+BOOST_AUTO_TEST_CASE(StreamScheduleChainUsesOneStream)
+{
+    vector<vector<size_t>> inputs = { {}, { 0 }, { 1 }, { 2 }, { 3, 0 } };
+
+    auto schedule = PlanStreamSchedule(inputs, {}, 4);
+
+    BOOST_CHECK(!schedule.IsConcurrent());
+    BOOST_CHECK_EQUAL(schedule.numEvents, 0);
+}
+
+BOOST_AUTO_TEST_CASE(StreamScheduleOrdersMemoryReuse)
+{
+    // two independent chains 1 -> 2 and 3 -> 4; node 4 reuses the memory of node 1, which node 2 reads
+    vector<vector<size_t>> inputs = { {}, { 0 }, { 1 }, { 0 }, { 3 } };
+    vector<vector<size_t>> predecessors = { {}, {}, {}, {}, { 1, 2 } };
+
+    auto schedule = PlanStreamSchedule(inputs, predecessors, 2);
+
+    BOOST_CHECK(schedule.IsConcurrent());
+    BOOST_CHECK(RespectsDependencies(schedule, inputs, predecessors));
+    // without the predecessors, node 4 would not wait for anything
+    BOOST_CHECK(!schedule.steps.back().waits.empty());
+}
+
+BOOST_AUTO_TEST_CASE(StreamScheduleRespectsDependenciesOfRandomGraphs)
+{
+    std::mt19937 rng(1234);
+    for (size_t numStreams = 1; numStreams <= 5; numStreams++)
+    {
+        for (int trial = 0; trial < 20; trial++)
+        {
+            const size_t numNodes = 40;
+            vector<vector<size_t>> inputs(numNodes), predecessors(numNodes);
+            for (size_t i = 1; i < numNodes; i++)
+            {
+                size_t numInputs = rng() % 3;
+                for (size_t k = 0; k < numInputs; k++)
+                    inputs[i].push_back(rng() % i);
+                if (rng() % 4 == 0)
+                    predecessors[i].push_back(rng() % i);
+            }
+
+            auto schedule = PlanStreamSchedule(inputs, predecessors, numStreams);
+
+            BOOST_CHECK(schedule.numStreams <= numStreams);
+            BOOST_CHECK_EQUAL(schedule.leaves.size() + schedule.steps.size(), numNodes);
+            BOOST_CHECK(RespectsDependencies(schedule, inputs, predecessors));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(WavefrontStepsStackedLoopsTogether)
+{
+    // 0: input, 1: loop of layer 1, 2: weights, 3: projection of layer 1, 4: loop of layer 2, 5: weights,
+    // 6: projection of layer 2, 7: loop of layer 3, 8: output layer
+    vector<vector<size_t>> inputs = { {}, { 0 }, {}, { 2, 1 }, { 3 }, {}, { 5, 4 }, { 6 }, { 7 } };
+    vector<bool> isLoop =      { false, true, false, false, true, false, false, true, false };
+    vector<bool> isSteppable = { false, false, false, true, false, false, true, false, true };
+    vector<int> layoutOf =     { 0, 0, -1, 0, 0, -1, 0, 0, 0 };
+    vector<int> directionOf =  { 0, 1, 0, 0, 1, 0, 0, 1, 0 };
+
+    auto wavefronts = PlanWavefronts(inputs, {}, isLoop, isSteppable, layoutOf, directionOf);
+
+    BOOST_REQUIRE_EQUAL(wavefronts.size(), 1);
+    const auto& stages = wavefronts[0].stages;
+    BOOST_REQUIRE_EQUAL(stages.size(), 3);
+    BOOST_CHECK_EQUAL(stages[0].loop, 1);
+    BOOST_CHECK(stages[0].steppedNodes.empty());
+    BOOST_CHECK_EQUAL(stages[1].loop, 4);
+    BOOST_CHECK(stages[1].steppedNodes == vector<size_t>({ 3 }));
+    BOOST_CHECK_EQUAL(stages[2].loop, 7);
+    BOOST_CHECK(stages[2].steppedNodes == vector<size_t>({ 6 }));
+
+    // a backward layer 2 ends the wavefront after layer 1, and starts a new one with layer 3
+    directionOf[4] = -1;
+    directionOf[7] = -1;
+    wavefronts = PlanWavefronts(inputs, {}, isLoop, isSteppable, layoutOf, directionOf);
+    BOOST_REQUIRE_EQUAL(wavefronts.size(), 1);
+    BOOST_CHECK_EQUAL(wavefronts[0].stages.front().loop, 4);
+    BOOST_CHECK_EQUAL(wavefronts[0].stages.back().loop, 7);
+}
+
+BOOST_AUTO_TEST_CASE(WavefrontRespectsMemoryReuseAndNonLocalNodes)
+{
+    vector<vector<size_t>> inputs = { {}, { 0 }, { 1 }, { 2 } };
+    vector<bool> isLoop =      { false, true, false, true };
+    vector<bool> isSteppable = { false, false, true, false };
+    vector<int> layoutOf =     { 0, 0, 0, 0 };
+    vector<int> directionOf =  { 0, 1, 0, 1 };
+
+    BOOST_CHECK_EQUAL(PlanWavefronts(inputs, {}, isLoop, isSteppable, layoutOf, directionOf).size(), 1);
+
+    // the projection reuses the memory of a node that the first loop reads
+    vector<vector<size_t>> predecessors = { {}, {}, { 1 }, {} };
+    BOOST_CHECK(PlanWavefronts(inputs, predecessors, isLoop, isSteppable, layoutOf, directionOf).empty());
+
+    // a node between the loops that reads other frames of its input, or has another layout
+    isSteppable[2] = false;
+    BOOST_CHECK(PlanWavefronts(inputs, {}, isLoop, isSteppable, layoutOf, directionOf).empty());
+    isSteppable[2] = true;
+    layoutOf[2] = 1;
+    BOOST_CHECK(PlanWavefronts(inputs, {}, isLoop, isSteppable, layoutOf, directionOf).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
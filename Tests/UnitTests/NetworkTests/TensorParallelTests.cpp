@@ -0,0 +1,124 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+
+#include "../../../Source/ComputationNetworkLib/TensorParallelNodes.h"
+#include "TestHelpers.h"
+#include <cmath>
+#include <memory>
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// We perform test on CPU without MPI, hence with a single shard that holds all classes;
+// the reductions over the shards then do nothing, which leaves the distributed log-sum-exp.
+const DEVICEID_TYPE c_deviceId = CPUDEVICE;
+
+const size_t c_numClasses = 3;
+const size_t c_minibatchSize = 2;
+
+// Extends the criterion node to drive it without a network.
+template <class ElemType>
+class TensorParallelCrossEntropyWithSoftmaxNodeTest : public TensorParallelCrossEntropyWithSoftmaxNode<ElemType>
+{
+public:
+    TensorParallelCrossEntropyWithSoftmaxNodeTest()
+        : TensorParallelCrossEntropyWithSoftmaxNode<ElemType>(c_deviceId, L"TensorParallelCrossEntropyWithSoftmaxNodeTest")
+    {
+    }
+
+    using TensorParallelCrossEntropyWithSoftmaxNode<ElemType>::Validate;
+
+    void ForwardPass()
+    {
+        // This is done in RequestMatricesBeforeForwardProp, but here we don't have matrix pool available.
+        this->CreateMatrixIfNull(this->m_logSoftmaxOfRight);
+        this->CreateMatrixIfNull(this->m_softmaxOfRight);
+        this->CreateMatrixIfNull(this->m_logSumExpOfRight);
+        this->CreateMatrixIfNull(this->m_sumExpOfRight);
+        this->CreateMatrixIfNull(this->m_shardLabels);
+        this->CreateValueMatrixIfNull();
+        this->UpdateFunctionMBSize();
+        this->ForwardPropNonLooping();
+    }
+
+    void BackwardPass()
+    {
+        this->CreateGradientMatrixIfNull();
+        this->Gradient().Resize(1, 1);
+        this->Gradient().SetValue(1);
+        this->BackpropToNonLooping(1);
+    }
+};
+
+template <class ElemType>
+void TensorParallelCrossEntropyWithSoftmaxTestImpl(bool sparseLabels)
+{
+    vector<ElemType> predictionData = { 1, 2, 3, 1, 0, -1 };
+    vector<ElemType> labelsData = { 0, 0, 1, 1, 0, 0 };
+    auto prediction = make_shared<DummyNodeTest<ElemType>>(c_deviceId, c_minibatchSize, SmallVector<size_t>{ c_numClasses }, predictionData);
+    auto labels = make_shared<DummyNodeTest<ElemType>>(c_deviceId, c_minibatchSize, SmallVector<size_t>{ c_numClasses }, labelsData);
+    prediction->Value().SetValue(c_numClasses, c_minibatchSize, c_deviceId, predictionData.data());
+    if (sparseLabels)
+    {
+        vector<CPUSPARSE_INDEX_TYPE> colStarts = { 0, 1, 2 };
+        vector<CPUSPARSE_INDEX_TYPE> rows = { 2, 0 };
+        vector<ElemType> values = { 1, 1 };
+        labels->Value().SwitchToMatrixType(SPARSE, matrixFormatSparseCSC, false);
+        labels->Value().SetMatrixFromCSCFormat(colStarts.data(), rows.data(), values.data(), values.size(), c_numClasses, c_minibatchSize);
+    }
+    else
+        labels->Value().SetValue(c_numClasses, c_minibatchSize, c_deviceId, labelsData.data());
+
+    auto node = make_shared<TensorParallelCrossEntropyWithSoftmaxNodeTest<ElemType>>();
+    node->AttachInputs(vector<ComputationNodeBasePtr>{ labels, prediction });
+    node->Validate(true);
+
+    // the cross entropy is the log-sum-exp of each column less the logit of its label
+    vector<double> softmax(predictionData.size());
+    double expectedLoss = 0;
+    for (size_t j = 0; j < c_minibatchSize; j++)
+    {
+        double sumExp = 0;
+        for (size_t i = 0; i < c_numClasses; i++)
+            sumExp += exp((double)predictionData[j * c_numClasses + i]);
+        for (size_t i = 0; i < c_numClasses; i++)
+        {
+            softmax[j * c_numClasses + i] = exp((double)predictionData[j * c_numClasses + i]) / sumExp;
+            expectedLoss -= labelsData[j * c_numClasses + i] * (predictionData[j * c_numClasses + i] - log(sumExp));
+        }
+    }
+    node->ForwardPass();
+    BOOST_REQUIRE_MESSAGE(fabs(node->Value().Get00Element() - expectedLoss) < 1e-5, "The cross entropy is invalid");
+
+    // the gradient of the prediction is its softmax less the labels
+    vector<ElemType> expectedGradient(predictionData.size());
+    for (size_t k = 0; k < expectedGradient.size(); k++)
+        expectedGradient[k] = (ElemType)(softmax[k] - labelsData[k]);
+    prediction->GetGradient().SetValue(0);
+    node->BackwardPass();
+    BOOST_REQUIRE_MESSAGE(AreEqual(expectedGradient.data(), prediction->GetGradient().Data(), expectedGradient.size(), 1e-5f), "The gradient of the prediction is invalid");
+}
+
+BOOST_AUTO_TEST_SUITE(TensorParallelTestSuite)
+
+BOOST_AUTO_TEST_CASE(TensorParallelCrossEntropyWithSoftmaxTest)
+{
+    TensorParallelCrossEntropyWithSoftmaxTestImpl<float>(/*sparseLabels=*/false);
+    TensorParallelCrossEntropyWithSoftmaxTestImpl<double>(/*sparseLabels=*/false);
+}
+
+BOOST_AUTO_TEST_CASE(TensorParallelCrossEntropyWithSparseLabelsTest)
+{
+    TensorParallelCrossEntropyWithSoftmaxTestImpl<float>(/*sparseLabels=*/true);
+    TensorParallelCrossEntropyWithSoftmaxTestImpl<double>(/*sparseLabels=*/true);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
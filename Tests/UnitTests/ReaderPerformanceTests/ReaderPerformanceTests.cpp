@@ -0,0 +1,325 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// ReaderPerformanceTests.cpp : measures the throughput of a reader configuration on its own, without a network.
+//
+// Usage: readerperformancetests configFile=<file> [section=reader] [minibatchSize=256] [numMinibatches=1000] [warmupMinibatches=10]
+//                               [repetitions=3] [deviceId=-1] [output=results.json] [sweep=[prefetchDepth=1:2:4; numParserThreads=1:4]]
+//
+// The reader section is a CompositeDataReader configuration (deserializers = (...) with their module and type), as in a CNTK
+// config file, so that any mix of CTF, CBF, HTK/MLF, Image and Base64 deserializers can be measured. Every combination of the
+// swept values is run. A swept key is set in the reader section, which covers its own options (prefetchDepth, chunkCacheSizeInMB,
+// multiThreadedDeserialization, ...), and is also defined on the command line, so that options of the deserializers can refer
+// to it as $key$ (e.g. numParserThreads = $numParserThreads$).
+//
+// For each combination and repetition the tool reports samples/s, MB/s delivered to the matrices and read from files, the time
+// spent in each stage of the reader pipeline (ReaderStatistics), the prefetch occupancy, the CPU utilization and the memory.
+//
+
+#define _CRT_SECURE_NO_WARNINGS
+#include "Basics.h"
+#include "Config.h"
+#include "DataReader.h"
+#include "Reader.h"
+#include "ReaderShim.h"
+#include "ReaderStatistics.h"
+#include "Sequences.h"
+#include <sys/resource.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+using ::CNTK::EpochConfiguration;
+using ::CNTK::Reader;
+using ::CNTK::ReaderShim;
+using ::CNTK::ReaderStage;
+using ::CNTK::ReaderStageStatistics;
+using ::CNTK::ReaderStatistics;
+
+namespace {
+
+struct Measurement
+{
+    size_t m_numMinibatches = 0;
+    size_t m_numSamples = 0;
+    double m_seconds = 0;
+    double m_cpuSeconds = 0;         // user + system time of the process
+    size_t m_residentBytes = 0;      // at the end of the measurement
+    ReaderShim<float>::PrefetchStatistics m_prefetch;
+    ReaderStageStatistics m_stages[(int)ReaderStage::Count];
+};
+
+struct Run
+{
+    vector<pair<string, string>> m_settings; // the swept values
+    double m_creationSeconds = 0;            // creating the reader, which includes building or loading the indices
+    string m_error;                          // why the run failed, if it did
+    vector<Measurement> m_repetitions;
+};
+
+double CpuSeconds()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+size_t PeakResidentBytes()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (size_t)usage.ru_maxrss * 1024;
+}
+
+size_t ResidentBytes()
+{
+    size_t totalPages = 0, residentPages = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm)
+    {
+        if (fscanf(statm, "%zu %zu", &totalPages, &residentPages) != 2)
+            residentPages = 0;
+        fclose(statm);
+    }
+    return residentPages * sysconf(_SC_PAGESIZE);
+}
+
+// The reader is only loaded once; unloading it while readers of previous runs may still be referenced is not worth it.
+Reader* CreateCompositeReader(const ConfigParameters& readerConfig)
+{
+    typedef Reader* (*CreateCompositeDataReaderProc)(const ConfigParameters* parameters);
+    static Plugin plugin;
+    static CreateCompositeDataReaderProc createReaderProc = (CreateCompositeDataReaderProc)plugin.Load(L"CompositeDataReader", "CreateCompositeDataReader");
+    return createReaderProc(&readerConfig);
+}
+
+void Measure(const ConfigParameters& config, const ConfigParameters& readerConfig, Run& run)
+{
+    const size_t minibatchSize = config(L"minibatchSize", (size_t)256);
+    const size_t numMinibatches = config(L"numMinibatches", (size_t)1000);
+    const size_t warmupMinibatches = config(L"warmupMinibatches", (size_t)10);
+    const size_t repetitions = config(L"repetitions", (size_t)3);
+    const DEVICEID_TYPE deviceId = config(L"deviceId", (int)CPUDEVICE);
+
+    auto start = chrono::steady_clock::now();
+    shared_ptr<Reader> reader(CreateCompositeReader(readerConfig));
+    auto streams = reader->GetStreamDescriptions();
+    shared_ptr<ReaderShim<float>> shim(new ReaderShim<float>(reader), [](ReaderShim<float>* x) { x->Destroy(); });
+    shim->Init(readerConfig);
+    run.m_creationSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    StreamMinibatchInputs matrices;
+    unordered_set<InputStreamDescription> inputs;
+    for (const auto& s : streams)
+    {
+        if (s.m_elementType != ::CNTK::DataType::Float)
+            InvalidArgument("Stream '%ls' is not of type float, which is the only type measured.", s.m_name.c_str());
+
+        const bool isDense = s.m_storageFormat == ::CNTK::StorageFormat::Dense;
+        InputStreamDescription input(s.m_name, deviceId, isDense ? MatrixType::DENSE : MatrixType::SPARSE, isDense ? matrixFormatDense : matrixFormatSparseCSC);
+        inputs.insert(input);
+        const auto& dims = s.m_sampleLayout.Dimensions();
+        matrices.AddInput(s.m_name, make_shared<Matrix<float>>(0, 0, deviceId, input.GetMatrixType(), input.GetMatrixFormat()), make_shared<MBLayout>(),
+                          TensorShape(SmallVector<size_t>(vector<size_t>(dims.begin(), dims.end()))));
+    }
+
+    for (size_t repetition = 0; repetition < repetitions; repetition++)
+    {
+        EpochConfiguration epoch;
+        epoch.m_numberOfWorkers = 1;
+        epoch.m_workerRank = 0;
+        epoch.m_minibatchSizeInSamples = minibatchSize;
+        epoch.m_truncationSize = readerConfig(L"truncationLength", (size_t)0);
+        epoch.m_allowMinibatchesToCrossSweepBoundaries = true;
+        epoch.m_totalEpochSizeInSamples = numeric_limits<size_t>::max() / 2; // the minibatch count ends the repetition
+        epoch.m_epochIndex = repetition;
+        shim->StartEpoch(epoch, inputs);
+
+        for (size_t i = 0; i < warmupMinibatches && shim->GetMinibatch(matrices); i++)
+            ;
+
+        Measurement measurement;
+        ReaderStatistics::Reset();
+        const double cpuStart = CpuSeconds();
+        start = chrono::steady_clock::now();
+        const auto prefetchStart = shim->GetPrefetchStatistics();
+        while (measurement.m_numMinibatches < numMinibatches && shim->GetMinibatch(matrices))
+        {
+            size_t numSamples = 0;
+            for (const auto& input : matrices)
+                numSamples = max(numSamples, input.second.pMBLayout->GetActualNumSamples());
+            measurement.m_numSamples += numSamples;
+            measurement.m_numMinibatches++;
+        }
+        measurement.m_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        measurement.m_cpuSeconds = CpuSeconds() - cpuStart;
+        measurement.m_residentBytes = ResidentBytes();
+
+        const auto& prefetch = shim->GetPrefetchStatistics();
+        measurement.m_prefetch.m_numMinibatches = prefetch.m_numMinibatches - prefetchStart.m_numMinibatches;
+        measurement.m_prefetch.m_numReadyOnRequest = prefetch.m_numReadyOnRequest - prefetchStart.m_numReadyOnRequest;
+        measurement.m_prefetch.m_waitTimeInSeconds = prefetch.m_waitTimeInSeconds - prefetchStart.m_waitTimeInSeconds;
+        for (int stage = 0; stage < (int)ReaderStage::Count; stage++)
+            measurement.m_stages[stage] = ReaderStatistics::Get((ReaderStage)stage);
+
+        auto& transfer = measurement.m_stages[(int)ReaderStage::Transfer];
+        fprintf(stderr, "  repetition %d: %d minibatches, %.1f samples/s, %.2f MB/s, CPU %.0f%%, resident %.1f MB\n",
+                (int)repetition + 1, (int)measurement.m_numMinibatches, measurement.m_numSamples / measurement.m_seconds,
+                transfer.m_bytes / measurement.m_seconds / (1024 * 1024), 100 * measurement.m_cpuSeconds / measurement.m_seconds,
+                measurement.m_residentBytes / (1024.0 * 1024.0));
+        ReaderStatistics::PrintSummary(stderr, "    ");
+        run.m_repetitions.push_back(measurement);
+    }
+}
+
+string Quote(const string& s)
+{
+    string quoted = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            quoted += '\\';
+        quoted += (unsigned char)c < 0x20 ? ' ' : c;
+    }
+    return quoted + "\"";
+}
+
+void WriteJson(const string& path, const ConfigParameters& config, const vector<Run>& runs)
+{
+    ofstream out(path);
+    if (!out)
+        RuntimeError("Cannot open '%s' for writing.", path.c_str());
+
+    out << "{\n  \"minibatchSize\": " << (size_t)config(L"minibatchSize", (size_t)256) << ",\n  \"numMinibatches\": " << (size_t)config(L"numMinibatches", (size_t)1000)
+        << ",\n  \"peakResidentBytes\": " << PeakResidentBytes() << ",\n  \"runs\": [";
+    for (size_t i = 0; i < runs.size(); i++)
+    {
+        const auto& run = runs[i];
+        out << (i > 0 ? "," : "") << "\n    {\n      \"settings\": {";
+        for (size_t j = 0; j < run.m_settings.size(); j++)
+            out << (j > 0 ? ", " : " ") << Quote(run.m_settings[j].first) << ": " << Quote(run.m_settings[j].second);
+        out << " },\n      \"creationSeconds\": " << run.m_creationSeconds;
+        if (!run.m_error.empty())
+            out << ",\n      \"error\": " << Quote(run.m_error);
+        out << ",\n      \"repetitions\": [";
+        for (size_t j = 0; j < run.m_repetitions.size(); j++)
+        {
+            const auto& m = run.m_repetitions[j];
+            out << (j > 0 ? "," : "") << "\n        { \"minibatches\": " << m.m_numMinibatches << ", \"samples\": " << m.m_numSamples
+                << ", \"seconds\": " << m.m_seconds << ", \"samplesPerSecond\": " << m.m_numSamples / m.m_seconds
+                << ", \"deliveredMBPerSecond\": " << m.m_stages[(int)ReaderStage::Transfer].m_bytes / m.m_seconds / (1024 * 1024)
+                << ", \"readMBPerSecond\": " << m.m_stages[(int)ReaderStage::FileRead].m_bytes / m.m_seconds / (1024 * 1024)
+                << ", \"cpuUtilization\": " << m.m_cpuSeconds / m.m_seconds << ", \"residentBytes\": " << m.m_residentBytes
+                << ", \"prefetchOccupancy\": " << m.m_prefetch.AverageOccupancy() << ", \"waitSeconds\": " << m.m_prefetch.m_waitTimeInSeconds
+                << ",\n          \"stages\": {";
+            for (int stage = 0; stage < (int)ReaderStage::Count; stage++)
+                out << (stage > 0 ? ", " : " ") << Quote(ReaderStatistics::StageName((ReaderStage)stage)) << ": { \"calls\": " << m.m_stages[stage].m_numCalls
+                    << ", \"seconds\": " << m.m_stages[stage].m_timeInSeconds << ", \"bytes\": " << m.m_stages[stage].m_bytes << " }";
+            out << " } }";
+        }
+        out << "\n      ]\n    }";
+    }
+    out << "\n  ]\n}\n";
+    if (!out)
+        RuntimeError("Failed to write the results to '%s'.", path.c_str());
+}
+
+int wmain1(int argc, wchar_t* argv[])
+{
+    ConfigParameters config;
+    ConfigParameters::ParseCommandLine(argc, argv, config);
+
+    // the cartesian product of the swept values
+    vector<pair<string, ConfigArray>> sweep;
+    if (config.Exists("sweep"))
+    {
+        ConfigParameters sweepConfig = config("sweep");
+        for (const auto& parameter : sweepConfig)
+            sweep.push_back(make_pair(parameter.first, ConfigArray(parameter.second)));
+    }
+    vector<vector<pair<string, string>>> combinations(1);
+    for (const auto& parameter : sweep)
+    {
+        vector<vector<pair<string, string>>> extended;
+        for (const auto& combination : combinations)
+        {
+            for (const auto& value : parameter.second)
+            {
+                extended.push_back(combination);
+                extended.back().push_back(make_pair(parameter.first, (string)value));
+            }
+        }
+        combinations = move(extended);
+    }
+
+    const wstring section = config(L"section", L"reader");
+    vector<Run> runs;
+    for (const auto& combination : combinations)
+    {
+        vector<wstring> arguments(argv, argv + argc);
+        string description;
+        for (const auto& setting : combination)
+        {
+            arguments.push_back(ToFixedWStringFromMultiByte(setting.first + "=" + setting.second));
+            description += (description.empty() ? "" : ", ") + setting.first + "=" + setting.second;
+        }
+        fprintf(stderr, "reader configuration %d of %d%s%s\n", (int)runs.size() + 1, (int)combinations.size(), description.empty() ? "" : ": ", description.c_str());
+
+        vector<wchar_t*> wargs;
+        for (auto& argument : arguments)
+            wargs.push_back(&argument[0]);
+        ConfigParameters runConfig;
+        ConfigParameters::ParseCommandLine((int)wargs.size(), wargs.data(), runConfig);
+        ConfigParameters readerConfig(runConfig(section));
+        for (const auto& setting : combination)
+            readerConfig.Insert(setting.first, setting.second);
+
+        Run run;
+        run.m_settings = combination;
+        try
+        {
+            Measure(runConfig, readerConfig, run);
+        }
+        catch (const exception& e)
+        {
+            run.m_error = e.what();
+            fprintf(stderr, "  failed: %s\n", e.what());
+        }
+        runs.push_back(run);
+    }
+
+    fprintf(stderr, "peak resident memory %.1f MB\n", PeakResidentBytes() / (1024.0 * 1024.0));
+    const wstring output = config(L"output", L"");
+    if (!output.empty())
+        WriteJson(ToLegacyString(ToUTF8(output)), config, runs);
+    return 0;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        vector<wstring> arguments;
+        for (int i = 0; i < argc; i++)
+            arguments.push_back(ToFixedWStringFromMultiByte(argv[i]));
+        vector<wchar_t*> wargs;
+        for (auto& argument : arguments)
+            wargs.push_back(&argument[0]);
+        return wmain1(argc, wargs.data());
+    }
+    catch (const exception& e)
+    {
+        fprintf(stderr, "EXCEPTION occurred: %s\n", e.what());
+        return 1;
+    }
+}
@@ -16,6 +16,7 @@
 #include <boost/scope_exit.hpp>
 #include "Common/ReaderTestHelper.h"
 #include "TextParser.h"
+#include "FastNumberParser.h"
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -86,6 +87,7 @@ BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_Simple_dense)
     };
     test({});
     test({ L"defMBSize=true" });
+    test({ L"fastNumberParsing=true" });
 };
 
 BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_Simple_dense_single_stream)
@@ -136,6 +138,7 @@ BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_MNIST_dense)
 
     test({});
     test({ L"defMBSize=true" });
+    test({ L"fastNumberParsing=true" });
 };
 
 // 1 single sample sequence
@@ -370,6 +373,7 @@ BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_50x20_jagged_sequences_dense)
 
     test({});
     test({ L"defMBSize=true" });
+    test({ L"fastNumberParsing=true" });
 };
 
 // 1 single sample sequence
@@ -475,6 +479,7 @@ BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_10x10_sparse)
 
     test({});
     test({ L"defMBSize=true" });
+    test({ L"fastNumberParsing=true" });
 };
 
 // 3 sequences with 5 samples for each of 3 input stream (no randomization)
@@ -528,6 +533,7 @@ BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_20x10_MI_jagged_samples_sparse)
 
     test({});
     test({ L"defMBSize=true" });
+    test({ L"fastNumberParsing=true" });
 };
 
 // 50 sequences with up to 20 samples each (536 samples in total)
@@ -620,6 +626,7 @@ BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_missing_trailing_newline)
 
     test({});
     test({ L"defMBSize=true" });
+    test({ L"fastNumberParsing=true" });
 };
 
 BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_blank_lines)
@@ -1062,6 +1069,39 @@ BOOST_AUTO_TEST_CASE(CNTKTextFormatReaderNoFirstMinibatchData)
         2);
 };
 
+BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_fast_number_parser)
+{
+    using namespace ::CNTK::FastNumberParser;
+
+    auto parse = [](const string& token, double& value)
+    {
+        return TryParseReal(token.data(), token.data() + token.size(), value);
+    };
+
+    double value;
+    for (const string token : { "0", "-0", "1", "1.", "+2.5", "123.456", "0.000123", "1e5", "1E-5", "-2.5e+3", "9007199254740992" })
+    {
+        BOOST_REQUIRE(parse(token, value));
+        BOOST_CHECK_EQUAL(value, strtod(token.c_str(), nullptr));
+    }
+
+    // Malformed numbers and numbers that cannot be computed exactly are left to the regular parser.
+    for (const string token : { "", "-", ".5", "1.e5", "1e", "1.5x", "1e400", "9007199254740993", "12345678901234567890" })
+        BOOST_CHECK(!parse(token, value));
+
+    size_t index;
+    string indices = "123456:1";
+    BOOST_REQUIRE_EQUAL(FindTokenEnd(indices.data(), indices.size()), 6);
+    BOOST_REQUIRE(TryParseUint64(indices.data(), indices.data() + 6, index));
+    BOOST_CHECK_EQUAL(index, 123456);
+
+    // Longer than one SSE register.
+    string row = "0.12345678901234567 0.5|labels 1";
+    BOOST_CHECK_EQUAL(FindTokenEnd(row.data(), row.size()), 19);
+    BOOST_CHECK_EQUAL(FindTokenEnd(row.data() + 20, row.size() - 20), 3);
+    BOOST_CHECK_EQUAL(FindTokenEnd(row.data(), 10), 10);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
@@ -4,20 +4,29 @@
 //
 
 #include "stdafx.h"
+#include <atomic>
 #include <numeric>
 #include <random>
 #include <set>
+#include <thread>
 #include "NoRandomizer.h"
 #include "LTNoRandomizer.h"
+#include "LTTumblingWindowRandomizer.h"
 #include "DataDeserializer.h"
 #include "BlockRandomizer.h"
 #include "CorpusDescriptor.h"
 #include "FramePacker.h"
 #include "SequencePacker.h"
+#include "BucketingSequencePacker.h"
 #include "TruncatedBpttPacker.h"
 #include "CudaMemoryProvider.h"
 #include "HeapMemoryProvider.h"
 #include "BufferedFileReader.h"
+#include "ChunkCache.h"
+#include "RemoteStorage.h"
+#include "ReaderUtil.h"
+#include "ReaderStatistics.h"
+#include "ConcStack.h"
 
 #pragma warning(push)
 // disable warning about possible mod 0 operation in uniform_int_distribution
@@ -101,7 +110,7 @@ public:
     MockDeserializer(size_t numChunks, size_t numSequencesPerChunks, const vector<float>& data, uint32_t sequenceLength = 1)
         : m_numChunks(numChunks),
           m_numSequencesPerChunk(numSequencesPerChunks),
-          m_sampleShape(NDShape(1)),
+          m_sampleShape(NDShape({ 1 })),
           m_sequenceLength(sequenceLength)
     {
         m_sequenceData.reserve(data.size());
@@ -262,6 +271,177 @@ BOOST_AUTO_TEST_CASE(CheckSetCurrentCursorForRandomizers)
     test(expectedNo, unterTestNo, epochSize);
 }
 
+BOOST_AUTO_TEST_CASE(BlockRandomizerPrefetchesSeveralChunks)
+{
+    size_t chunkSizeInSamples = 1000;
+    size_t sweepNumberOfSamples = 50000;
+    uint32_t maxSequenceLength = 30;
+    size_t randomizationWindow = chunkSizeInSamples * 5;
+    auto deserializer = make_shared<SequentialDeserializer>(0, chunkSizeInSamples, sweepNumberOfSamples, maxSequenceLength);
+
+    auto expected = make_shared<BlockRandomizer>(0, randomizationWindow, deserializer, true, false);
+    auto underTest = make_shared<BlockRandomizer>(0, randomizationWindow, deserializer, true, false, 0, true, 0,
+                                                  /*maxNumberOfPrefetchedChunks =*/ 4);
+
+    // The number of prefetched chunks must not change the order of the data.
+    for (size_t epoch = 0; epoch < 3; ++epoch)
+    {
+        auto expectedEpoch = ReadFullEpoch(expected, sweepNumberOfSamples / 2, epoch);
+        auto actualEpoch = ReadFullEpoch(underTest, sweepNumberOfSamples / 2, epoch);
+        BOOST_CHECK_EQUAL_COLLECTIONS(
+            expectedEpoch.begin(),
+            expectedEpoch.end(),
+            actualEpoch.begin(),
+            actualEpoch.end());
+    }
+
+    BOOST_CHECK_THROW(make_shared<BlockRandomizer>(0, randomizationWindow, deserializer, true, false, 0, true, 0, 0), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(BlockRandomizerPrefetchesAcrossSweeps)
+{
+    size_t chunkSizeInSamples = 1000;
+    size_t sweepNumberOfSamples = 20000;
+    uint32_t maxSequenceLength = 30;
+    size_t randomizationWindow = chunkSizeInSamples * 5;
+    auto deserializer = make_shared<SequentialDeserializer>(0, chunkSizeInSamples, sweepNumberOfSamples, maxSequenceLength);
+
+    // Without prefetch nothing is prepared in the background.
+    auto expected = make_shared<BlockRandomizer>(0, randomizationWindow, deserializer, false, false);
+    auto underTest = make_shared<BlockRandomizer>(0, randomizationWindow, deserializer, true, false, 0, true, 0,
+                                                  /*maxNumberOfPrefetchedChunks =*/ 2);
+
+    // The next sweep prepared and prefetched at the end of an epoch must not change the order of the data.
+    for (size_t epoch = 0; epoch < 3; ++epoch)
+    {
+        auto expectedEpoch = ReadFullEpoch(expected, sweepNumberOfSamples, epoch);
+        auto actualEpoch = ReadFullEpoch(underTest, sweepNumberOfSamples, epoch);
+        BOOST_CHECK_EQUAL_COLLECTIONS(
+            expectedEpoch.begin(),
+            expectedEpoch.end(),
+            actualEpoch.begin(),
+            actualEpoch.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ChunkRandomizerPreparesRandomization)
+{
+    auto deserializer = make_shared<SequentialDeserializer>(0, 100, 5000, 1);
+    ChunkRandomizer expected(deserializer, 1000);
+    ChunkRandomizer underTest(deserializer, 1000);
+
+    underTest.Randomize(1);
+    underTest.PrepareRandomization(2);
+    BOOST_CHECK(underTest.GetPreparedChunks(3) == nullptr);
+    BOOST_REQUIRE(underTest.GetPreparedChunks(2) != nullptr);
+
+    // The current randomization is not affected by the preparation.
+    expected.Randomize(1);
+    BOOST_CHECK_EQUAL(underTest.GetRandomizedChunks()[0].m_original->m_id, expected.GetRandomizedChunks()[0].m_original->m_id);
+
+    expected.Randomize(2);
+    underTest.Randomize(2);
+    BOOST_CHECK(underTest.GetPreparedChunks(2) == nullptr);
+    BOOST_REQUIRE_EQUAL(underTest.GetRandomizedChunks().size(), expected.GetRandomizedChunks().size());
+    for (size_t i = 0; i < expected.GetRandomizedChunks().size(); ++i)
+    {
+        const auto& a = expected.GetRandomizedChunks()[i];
+        const auto& b = underTest.GetRandomizedChunks()[i];
+        BOOST_CHECK_EQUAL(a.m_original->m_id, b.m_original->m_id);
+        BOOST_CHECK_EQUAL(a.m_samplePositionStart, b.m_samplePositionStart);
+        BOOST_CHECK(a.m_randomizationWindow == b.m_randomizationWindow);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ReaderStatisticsCountStages)
+{
+    size_t chunkSizeInSamples = 1000;
+    size_t sweepNumberOfSamples = 10000;
+    auto deserializer = make_shared<SequentialDeserializer>(0, chunkSizeInSamples, sweepNumberOfSamples, 1);
+    auto randomizer = make_shared<BlockRandomizer>(0, chunkSizeInSamples * 2, deserializer, false, false);
+
+    ReaderStatistics::Reset();
+    ReadFullEpoch(randomizer, sweepNumberOfSamples, 0);
+    {
+        ScopeReaderStage stage(ReaderStage::Transfer, 100);
+        stage.AddBytes(28);
+    }
+
+    // Every chunk is loaded once in a sweep.
+    BOOST_CHECK_EQUAL(ReaderStatistics::Get(ReaderStage::GetChunk).m_numCalls, sweepNumberOfSamples / chunkSizeInSamples);
+    BOOST_CHECK(ReaderStatistics::Get(ReaderStage::Randomize).m_numCalls > 0);
+    BOOST_CHECK_EQUAL(ReaderStatistics::Get(ReaderStage::Transfer).m_numCalls, 1);
+    BOOST_CHECK_EQUAL(ReaderStatistics::Get(ReaderStage::Transfer).m_bytes, 128);
+    BOOST_CHECK_EQUAL(ReaderStatistics::Get(ReaderStage::Pack).m_numCalls, 0);
+
+    ReaderStatistics::Reset();
+    BOOST_CHECK_EQUAL(ReaderStatistics::Get(ReaderStage::GetChunk).m_numCalls, 0);
+    BOOST_CHECK_EQUAL(ReaderStatistics::Get(ReaderStage::Transfer).m_bytes, 0);
+}
+
+BOOST_AUTO_TEST_CASE(BlockRandomizerLocalityAwareDecimation)
+{
+    size_t numChunks = 8, numSequencesPerChunk = 10, numWorkers = 2;
+    vector<float> data(numChunks * numSequencesPerChunk);
+    iota(data.begin(), data.end(), 0.0f);
+
+    // Most of the chunks prefer the first worker.
+    auto affinity = [](const ChunkInfo& chunk, size_t) { return chunk.m_id < 6 ? (size_t)0 : (size_t)1; };
+
+    auto test = [&](double maxImbalance)
+    {
+        vector<size_t> readBy(data.size(), SIZE_MAX);
+        for (size_t w = 0; w < numWorkers; ++w)
+        {
+            auto randomizer = make_shared<BlockRandomizer>(0, SIZE_MAX, make_shared<MockDeserializer>(numChunks, numSequencesPerChunk, data), true, false);
+            randomizer->SetChunkAffinity(affinity, maxImbalance);
+
+            EpochConfiguration epochConfiguration;
+            epochConfiguration.m_numberOfWorkers = numWorkers;
+            epochConfiguration.m_workerRank = w;
+            epochConfiguration.m_minibatchSizeInSamples = 1;
+            epochConfiguration.m_totalEpochSizeInSamples = data.size();
+            epochConfiguration.m_epochIndex = 0;
+            randomizer->StartEpoch(epochConfiguration);
+
+            for (;;)
+            {
+                Sequences sequences = randomizer->GetNextSequences(1, 1);
+                for (const auto& s : sequences.m_data)
+                {
+                    size_t value = (size_t)*((float*)reinterpret_cast<DenseSequenceData&>(*s[0]).GetDataBuffer());
+                    BOOST_CHECK_EQUAL(readBy[value], SIZE_MAX);
+                    readBy[value] = w;
+                }
+                if (sequences.m_endOfEpoch)
+                    break;
+            }
+        }
+
+        // Every sample is read by exactly one worker, and its whole chunk by the same worker.
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            BOOST_CHECK(readBy[i] < numWorkers);
+            BOOST_CHECK_EQUAL(readBy[i], readBy[i - i % numSequencesPerChunk]);
+        }
+        return readBy;
+    };
+
+    // Without a bound on the imbalance every chunk goes to its preferred worker.
+    auto readBy = test(100.0);
+    for (size_t i = 0; i < data.size(); ++i)
+        BOOST_CHECK_EQUAL(readBy[i], i / numSequencesPerChunk < 6 ? 0u : 1u);
+
+    // With a bound the workers stay within it up to a chunk, and most chunks still go to their preferred worker.
+    readBy = test(0.25);
+    size_t firstWorkerSamples = count(readBy.begin(), readBy.end(), 0u);
+    BOOST_CHECK(firstWorkerSamples <= 1.25 * data.size() / numWorkers + numSequencesPerChunk);
+    size_t preferredSamples = 0;
+    for (size_t i = 0; i < data.size(); ++i)
+        preferredSamples += readBy[i] == (i / numSequencesPerChunk < 6 ? 0u : 1u);
+    BOOST_CHECK(preferredSamples >= 6 * numSequencesPerChunk);
+}
+
 BOOST_AUTO_TEST_CASE(RandRollbackToEarlierEpochBetweenSweeps)
 {
     size_t chunkSizeInSamples = 10000;
@@ -1078,6 +1258,201 @@ BOOST_AUTO_TEST_CASE(LTNoRandomizerCheckNoDuplicateSequence)
     }
 }
 
+BOOST_AUTO_TEST_CASE(LTTumblingWindowRandomizerPrefetchesSeveralChunks)
+{
+    size_t numChunks = 100, numSequencesPerChunk = 500;
+    vector<float> data(numChunks * numSequencesPerChunk);
+    iota(data.begin(), data.end(), 0.0f);
+    auto mockDeserializer = make_shared<MockDeserializer>(numChunks, numSequencesPerChunk, data);
+
+    // The number of prefetched chunks must not change the order of the data, with the window in chunks or in samples.
+    for (bool sampleBasedRandomizationWindow : { false, true })
+    {
+        size_t randomizationWindow = sampleBasedRandomizationWindow ? numSequencesPerChunk * 5 : 5;
+        auto expected = make_shared<LTTumblingWindowRandomizer>(mockDeserializer, sampleBasedRandomizationWindow, randomizationWindow);
+        auto underTest = make_shared<LTTumblingWindowRandomizer>(mockDeserializer, sampleBasedRandomizationWindow, randomizationWindow,
+                                                                 0, false, 0, /*maxNumberOfPrefetchedChunks =*/ 4);
+
+        // Three sweeps, to cross the sweep boundaries.
+        auto expectedEpoch = ReadFullEpoch(expected, data.size() * 3, 0);
+        auto actualEpoch = ReadFullEpoch(underTest, data.size() * 3, 0);
+        BOOST_CHECK_EQUAL(actualEpoch.size(), data.size() * 3);
+        BOOST_CHECK_EQUAL_COLLECTIONS(
+            expectedEpoch.begin(),
+            expectedEpoch.end(),
+            actualEpoch.begin(),
+            actualEpoch.end());
+    }
+
+    // A window that is big enough to be shuffled in parallel: the sweep still has
+    // all the sequences, and the order is reproducible.
+    numChunks = 4;
+    numSequencesPerChunk = 50000;
+    data.resize(numChunks * numSequencesPerChunk);
+    iota(data.begin(), data.end(), 0.0f);
+    mockDeserializer = make_shared<MockDeserializer>(numChunks, numSequencesPerChunk, data);
+
+    auto first = make_shared<LTTumblingWindowRandomizer>(mockDeserializer, false, numChunks, 0, false, 0, 4);
+    auto second = make_shared<LTTumblingWindowRandomizer>(mockDeserializer, false, numChunks, 0, false, 0, 4);
+    auto firstSweep = ReadFullEpoch(first, data.size(), 0);
+    auto secondSweep = ReadFullEpoch(second, data.size(), 0);
+    BOOST_CHECK_EQUAL_COLLECTIONS(firstSweep.begin(), firstSweep.end(), secondSweep.begin(), secondSweep.end());
+    BOOST_CHECK(firstSweep != data);
+
+    sort(firstSweep.begin(), firstSweep.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(firstSweep.begin(), firstSweep.end(), data.begin(), data.end());
+
+    BOOST_CHECK_THROW(make_shared<LTTumblingWindowRandomizer>(mockDeserializer, false, numChunks, 0, false, 0, 0), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(ChunkCacheEvictsLeastRecentlyUsed)
+{
+    vector<float> data(8);
+    iota(data.begin(), data.end(), 0.0f);
+
+    // 4 chunks with 2 sequences of a single float each, i.e. 8 bytes per chunk.
+    auto mockDeserializer = make_shared<MockDeserializer>(4, 2, data);
+
+    ChunkCacheParameters parameters;
+    parameters.m_maxSizeInBytes = 2 * 2 * sizeof(float);
+    ChunkCache cache(mockDeserializer, parameters);
+
+    auto chunk0 = cache.GetChunk(0);
+    cache.GetChunk(1);
+    BOOST_CHECK(cache.GetChunk(0) == chunk0);
+    cache.GetChunk(2); // evicts chunk 1
+    BOOST_CHECK(cache.GetChunk(0) == chunk0);
+    cache.GetChunk(1); // evicts chunk 2
+
+    auto statistics = cache.GetStatistics();
+    BOOST_CHECK_EQUAL(statistics.m_numHits, 2);
+    BOOST_CHECK_EQUAL(statistics.m_numMisses, 4);
+    BOOST_CHECK_EQUAL(statistics.m_numEvictions, 2);
+    BOOST_CHECK_EQUAL(statistics.m_bytesInMemory, 2 * 2 * sizeof(float));
+}
+
+BOOST_AUTO_TEST_CASE(ChunkCacheSpillsEvictedChunks)
+{
+    vector<float> data(8);
+    iota(data.begin(), data.end(), 0.0f);
+    auto mockDeserializer = make_shared<MockDeserializer>(4, 2, data, 3);
+
+    ChunkCacheParameters parameters;
+    parameters.m_maxSizeInBytes = 2 * 2 * 3 * sizeof(float);
+    parameters.m_spillDirectory = L".";
+    ChunkCache cache(mockDeserializer, parameters);
+
+    cache.GetChunk(0);
+    cache.GetChunk(1);
+    cache.GetChunk(2); // spills chunk 0
+
+    auto chunk = cache.GetChunk(0); // spills chunk 1
+    auto statistics = cache.GetStatistics();
+    BOOST_CHECK_EQUAL(statistics.m_numSpilled, 2);
+    BOOST_CHECK_EQUAL(statistics.m_numSpillHits, 1);
+    BOOST_CHECK_EQUAL(statistics.m_numMisses, 3);
+
+    for (size_t i = 0; i < 2; ++i)
+    {
+        vector<SequenceDataPtr> sequences;
+        chunk->GetSequence(i, sequences);
+        BOOST_REQUIRE_EQUAL(sequences.size(), 1);
+        BOOST_CHECK_EQUAL(sequences[0]->m_numberOfSamples, 3);
+        BOOST_CHECK_EQUAL(sequences[0]->m_key.m_sequence, i);
+
+        auto values = static_cast<const float*>(sequences[0]->GetDataBuffer());
+        for (size_t j = 0; j < 3; ++j)
+            BOOST_CHECK_EQUAL(values[j], data[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ChunkCacheSharesChunksBetweenProcesses)
+{
+#ifndef _WIN32 // the shared store needs POSIX shared memory
+    vector<float> data(8);
+    iota(data.begin(), data.end(), 0.0f);
+
+    ChunkCacheParameters parameters;
+    parameters.m_sharedSizeInBytes = 1 << 20;
+    parameters.m_sharedKey = L"ChunkCacheSharesChunksBetweenProcesses_" + to_wstring(GetCurrentProcessId());
+
+    // Two caches of the same data stand for two processes on the host.
+    ChunkCache first(make_shared<MockDeserializer>(4, 2, data), parameters);
+    ChunkCache second(make_shared<MockDeserializer>(4, 2, data), parameters);
+
+    first.GetChunk(0);
+    first.GetChunk(1);
+    auto chunk = second.GetChunk(1); // deserialized by the first one
+    second.GetChunk(2);
+
+    BOOST_CHECK_EQUAL(first.GetStatistics().m_numShared, 2);
+    BOOST_CHECK_EQUAL(first.GetStatistics().m_numMisses, 2);
+    BOOST_CHECK_EQUAL(second.GetStatistics().m_numSharedHits, 1);
+    BOOST_CHECK_EQUAL(second.GetStatistics().m_numMisses, 1);
+    BOOST_CHECK(first.GetChunk(2) != nullptr);
+    BOOST_CHECK_EQUAL(first.GetStatistics().m_numSharedHits, 1);
+
+    for (size_t i = 2; i < 4; ++i)
+    {
+        vector<SequenceDataPtr> sequences;
+        chunk->GetSequence(i, sequences);
+        BOOST_REQUIRE_EQUAL(sequences.size(), 1);
+        BOOST_CHECK_EQUAL(sequences[0]->m_key.m_sequence, i);
+        BOOST_CHECK_EQUAL(*static_cast<const float*>(sequences[0]->GetDataBuffer()), data[i]);
+    }
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(RemoteStorageReadsThroughBlockCache)
+{
+    // An object of 1000 bytes served from memory, counting the range requests.
+    class MemoryRangeReader : public RangeReader
+    {
+    public:
+        MemoryRangeReader() : m_data(1000), m_numReads(0) { iota(m_data.begin(), m_data.end(), (char)0); }
+        uint64_t Size() override { return m_data.size(); }
+        void Read(uint64_t offset, size_t size, char* buffer) override
+        {
+            ++m_numReads;
+            memcpy(buffer, m_data.data() + offset, size);
+        }
+
+        vector<char> m_data;
+        atomic<size_t> m_numReads;
+    };
+
+    auto object = make_shared<MemoryRangeReader>();
+    RemoteStorage::RegisterBackend(L"readerlibtest", [object](const wstring&) { return object; });
+
+    auto parameters = RemoteStorage::GetParameters();
+    auto blockSize = parameters.m_blockSizeInBytes;
+    parameters.m_blockSizeInBytes = 64;
+    RemoteStorage::Configure(parameters);
+    auto file = RemoteStorage::Open(L"readerlibtest://bucket/object");
+    parameters.m_blockSizeInBytes = blockSize;
+    RemoteStorage::Configure(parameters);
+
+    BOOST_CHECK(RemoteStorage::IsRemote(file->Url()));
+    BOOST_CHECK(!RemoteStorage::IsRemote(L"bucket/object"));
+    BOOST_REQUIRE_EQUAL(file->Size(), 1000);
+
+    vector<char> buffer(100);
+    file->Read(900, 100, buffer.data());
+    BOOST_CHECK(equal(buffer.begin(), buffer.end(), object->m_data.begin() + 900));
+    file->Read(950, 50, buffer.data()); // served from the cache
+    BOOST_CHECK(equal(buffer.begin(), buffer.begin() + 50, object->m_data.begin() + 950));
+    BOOST_CHECK_EQUAL(object->m_numReads, 2);
+
+#ifndef _WIN32 // remote streams need fopencookie()
+    FILE* stream = file->OpenStream();
+    BOOST_REQUIRE(stream != nullptr);
+    BOOST_REQUIRE_EQUAL(fseek(stream, 10, SEEK_SET), 0);
+    BOOST_REQUIRE_EQUAL(fread(buffer.data(), 1, buffer.size(), stream), buffer.size());
+    BOOST_CHECK(equal(buffer.begin(), buffer.end(), object->m_data.begin() + 10));
+    fclose(stream);
+#endif
+}
+
 BOOST_AUTO_TEST_CASE(DefaultCorpusDescriptor)
 {
     const int seed = 13;
@@ -1150,6 +1525,48 @@ BOOST_AUTO_TEST_CASE(NumericCorpusDescriptorWithHash)
         { return string("Hashing should not be used with numeric sequence keys.") == e.what(); });
 }
 
+BOOST_AUTO_TEST_CASE(StringToIdMapConcurrentAdds)
+{
+    const size_t numKeys = 100000, numThreads = 8;
+    StringToIdMap map;
+
+    // All threads add the same keys, each in its own order.
+    vector<vector<size_t>> ids(numThreads, vector<size_t>(numKeys));
+    vector<thread> threads;
+    for (size_t t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            vector<size_t> keys(numKeys);
+            iota(keys.begin(), keys.end(), 0);
+            shuffle(keys.begin(), keys.end(), mt19937_64(t));
+            for (size_t key : keys)
+                ids[t][key] = map.AddIfNotExists("utterance_" + to_string(key));
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+
+    BOOST_CHECK_EQUAL(map.Size(), numKeys);
+    set<size_t> unique(ids[0].begin(), ids[0].end());
+    BOOST_CHECK_EQUAL(unique.size(), numKeys);
+    BOOST_CHECK_EQUAL(*unique.rbegin(), numKeys - 1);
+    for (size_t key = 0; key < numKeys; ++key)
+    {
+        for (size_t t = 1; t < numThreads; ++t)
+            BOOST_REQUIRE_EQUAL(ids[t][key], ids[0][key]);
+        BOOST_REQUIRE_EQUAL(map[ids[0][key]], "utterance_" + to_string(key));
+    }
+
+    size_t id;
+    BOOST_CHECK(map.TryGet("utterance_42", id));
+    BOOST_CHECK_EQUAL(id, ids[0][42]);
+    BOOST_CHECK(!map.Contains("utterance_" + to_string(numKeys)));
+    BOOST_CHECK_EQUAL(map.AddIfNotExists(""), numKeys);
+    BOOST_CHECK_EQUAL(map[numKeys], "");
+    BOOST_CHECK_THROW(map[numKeys + 1], std::runtime_error);
+}
+
 BOOST_AUTO_TEST_CASE(CheckEpochBoundarySingleWorker)
 {
     size_t chunkSizeInSamples = 1000;
@@ -1700,6 +2117,58 @@ BOOST_AUTO_TEST_CASE(SequencePackerBigChunksWithSequences1Sweep)
     }
 }
 
+BOOST_AUTO_TEST_CASE(BucketingSequencePackerWithSequences1Sweep)
+{
+    size_t chunkSizeInSamples = 998;
+    size_t sweepNumberOfSamples = 21335;
+    uint32_t maxSequenceLength = 300;
+    size_t randomizationWindow = chunkSizeInSamples * 5;
+    size_t bucketingWindow = 2000;
+
+    auto deserializer = make_shared<SequentialDeserializer>(0, chunkSizeInSamples, sweepNumberOfSamples, maxSequenceLength);
+
+    auto blockRandomizer = make_shared<BlockRandomizer>(0, randomizationWindow, deserializer, true);
+    auto packer = std::make_shared<BucketingSequencePacker>(blockRandomizer, deserializer->StreamInfos(), bucketingWindow, 1, true);
+
+    CheckPackerOnSweep(packer, blockRandomizer, deserializer, 1, 640, false, true);
+    CheckPackerOnSweep(packer, blockRandomizer, deserializer, 5, 640, false, true);
+
+    // Compared to packing in randomized order, there should be less padding.
+    auto measureEfficiency = [&](PackerPtr p)
+    {
+        EpochConfiguration config;
+        config.m_minibatchSizeInSamples = 640;
+        config.m_truncationSize = 0;
+        config.m_epochIndex = 0;
+        config.m_totalEpochSizeInSamples = deserializer->TotalSize();
+        config.m_numberOfWorkers = 1;
+        config.m_workerRank = 0;
+        p->SetConfiguration(config, std::vector<MemoryProviderPtr> { std::make_shared<HeapMemoryProvider>() });
+        blockRandomizer->StartEpoch(config);
+
+        size_t samples = 0, frames = 0;
+        while (true)
+        {
+            auto minibatch = p->ReadMinibatch();
+            if (!minibatch.m_data.empty())
+            {
+                samples += minibatch.m_data.front()->m_layout->GetActualNumSamples();
+                frames += minibatch.m_data.front()->m_layout->GetNumCols();
+            }
+            if (minibatch.m_endOfEpoch)
+                break;
+        }
+        BOOST_REQUIRE_EQUAL(samples, deserializer->TotalSize());
+        return (double)samples / frames;
+    };
+
+    double bucketed = measureEfficiency(packer);
+    BOOST_REQUIRE_CLOSE(bucketed, packer->GetPackingEfficiency(), 1e-6);
+
+    double randomOrder = measureEfficiency(std::make_shared<SequencePacker>(blockRandomizer, deserializer->StreamInfos(), 1, true));
+    BOOST_TEST(bucketed > randomOrder);
+}
+
 BOOST_AUTO_TEST_CASE(SequencePackerSmallChunksWithSequences1Sweep)
 {
     size_t chunkSizeInSamples = 1;
@@ -1906,6 +2375,118 @@ BOOST_AUTO_TEST_CASE(TestTruncatedBpttPacker)
     BOOST_TEST(!mb.m_endOfSweep);
 }
 
+BOOST_AUTO_TEST_CASE(DecodeBase64MatchesEncodedData)
+{
+    auto encode = [](const std::vector<char>& data)
+    {
+        std::string encoded;
+        for (size_t i = 0; i < data.size(); i += 3)
+        {
+            uint32_t value = (uint8_t)data[i] << 16;
+            if (i + 1 < data.size())
+                value |= (uint8_t)data[i + 1] << 8;
+            if (i + 2 < data.size())
+                value |= (uint8_t)data[i + 2];
+            encoded += base64IndexTable[value >> 18];
+            encoded += base64IndexTable[(value >> 12) & 63];
+            encoded += i + 1 < data.size() ? base64IndexTable[(value >> 6) & 63] : '=';
+            encoded += i + 2 < data.size() ? base64IndexTable[value & 63] : '=';
+        }
+        return encoded;
+    };
+
+    // Lengths around the block sizes of the vectorized decoder, so that both its loop and the scalar tail are covered.
+    std::mt19937 rng(42);
+    for (size_t length = 0; length < 300; ++length)
+    {
+        std::vector<char> data(length);
+        for (auto& c : data)
+            c = (char)rng();
+
+        auto encoded = encode(data);
+        std::vector<char> decoded;
+        BOOST_REQUIRE(DecodeBase64(encoded.data(), encoded.data() + encoded.size(), decoded));
+        BOOST_REQUIRE_EQUAL_COLLECTIONS(decoded.begin(), decoded.end(), data.begin(), data.end());
+    }
+
+    std::vector<char> decoded;
+    std::string truncated = "QUJD";
+    BOOST_TEST(!DecodeBase64(truncated.data(), truncated.data() + 3, decoded));
+}
+
+BOOST_AUTO_TEST_CASE(ConcStackReusesPushedItems)
+{
+    Microsoft::MSR::CNTK::conc_stack<std::unique_ptr<int>> stack;
+    int created = 0;
+    auto create = [&created]() { return std::make_unique<int>(created++); };
+
+    auto first = stack.pop_or_create(create);
+    auto second = stack.pop_or_create(create);
+    BOOST_REQUIRE_EQUAL(created, 2);
+
+    stack.push(std::move(first));
+    stack.push(std::move(second));
+    BOOST_REQUIRE_EQUAL(*stack.pop_or_create(create), 1);
+    BOOST_REQUIRE_EQUAL(*stack.pop_or_create(create), 0);
+    BOOST_REQUIRE_EQUAL(*stack.pop_or_create(create), 2);
+    BOOST_REQUIRE_EQUAL(created, 3);
+
+    // items without a default constructor, left on the stack when it is destroyed
+    auto deleted = std::make_shared<int>(0);
+    {
+        typedef std::unique_ptr<int, std::function<void(int*)>> Handle;
+        Microsoft::MSR::CNTK::conc_stack<Handle> handles;
+        for (int i = 0; i < 100; ++i)
+            handles.push(Handle(new int(i), [deleted](int* p) { ++*deleted; delete p; }));
+    }
+    BOOST_REQUIRE_EQUAL(*deleted, 100);
+}
+
+BOOST_AUTO_TEST_CASE(ConcStackHandsOutEachItemToOneThreadAtATime)
+{
+    struct Item
+    {
+        std::atomic<bool> inUse;
+        Item() : inUse(false) {}
+    };
+
+    Microsoft::MSR::CNTK::conc_stack<std::shared_ptr<Item>> stack;
+    std::atomic<int> created(0);
+    std::atomic<int> conflicts(0);
+    const int numThreads = 8;
+    const int numIterations = 20000;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < numIterations; ++i)
+            {
+                auto first = stack.pop_or_create([&created]() { created++; return std::make_shared<Item>(); });
+                auto second = stack.pop_or_create([&created]() { created++; return std::make_shared<Item>(); });
+                if (first->inUse.exchange(true) || second->inUse.exchange(true))
+                    conflicts++;
+                first->inUse = false;
+                second->inUse = false;
+                stack.push(std::move(second));
+                stack.push(first);
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    BOOST_REQUIRE_EQUAL(conflicts.load(), 0);
+    // every thread holds at most two items at a time
+    BOOST_REQUIRE_LE(created.load(), 2 * numThreads);
+
+    std::set<Item*> items;
+    for (int i = 0; i < created; ++i)
+        items.insert(stack.pop_or_create([]() { return std::shared_ptr<Item>(); }).get());
+    BOOST_REQUIRE_EQUAL(items.size(), (size_t)created.load());
+    BOOST_REQUIRE(items.count(nullptr) == 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
@@ -4,6 +4,7 @@
 //
 
 #include <chrono>
+#include <random>
 #include "stdafx.h"
 #include "BufferedFileReader.h"
 #include "FileWrapper.h"
@@ -270,6 +271,39 @@ BOOST_AUTO_TEST_CASE(Test_set_offset_after_reading_all)
     }
 }
 
+BOOST_AUTO_TEST_CASE(Test_read_ahead)
+{
+    CreateTestFile(s_textData);
+    std::mt19937 rng(0);
+
+    for (size_t i : { 1, 2, 3, 7, 19, 33, 71, 139, 144, 145, 146, 147, 150, 300 })
+    {
+        auto f = FileWrapper::OpenOrDie(L"test.tmp", L"rb");
+        BufferedFileReader reader(i, f, true);
+
+        string content;
+        for (char c; reader.TryGetNext(c);)
+            content.push_back(c);
+        BOOST_REQUIRE_EQUAL(content, s_textData);
+
+        // Jumps backwards and forwards, into and beyond the block that is read ahead.
+        for (size_t j = 0; j < 100; ++j)
+        {
+            size_t offset = rng() % s_textData.size();
+            size_t size = min<size_t>(rng() % (3 * i + 1), s_textData.size() - offset);
+            if (j % 2)
+                reader.SetReadAheadLimit(offset + size);
+
+            reader.SetFileOffset(offset);
+            BOOST_REQUIRE_EQUAL(reader.GetFileOffset(), offset);
+
+            vector<char> buffer(size);
+            BOOST_REQUIRE(size == 0 || reader.TryReadBinarySegment(size, buffer.data()));
+            BOOST_REQUIRE(equal(buffer.begin(), buffer.end(), s_textData.begin() + offset));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 
@@ -764,6 +798,38 @@ BOOST_AUTO_TEST_CASE(Index_with_caching)
     CheckIdentical(index, cachedIndex);
 }
 
+BOOST_AUTO_TEST_CASE(Index_with_caching_of_modified_input)
+{
+    auto filename = L"test.tmp";
+    CreateTestFile(s_textData, filename);
+    {
+        auto f1 = FileWrapper::OpenOrDie(filename, L"rb");
+        TextInputIndexBuilder(f1).SetCachingEnabled(true).Build();
+    }
+    // Cache is written out asynchronously in a separate thread, 
+    Sleep(1000);  // sleep for a second to give enough time to finish writing.
+
+    // The cache records the size of the input, so it does not match the modified input.
+    auto modifiedData = s_textData + s_textData;
+    CreateTestFile(modifiedData, filename);
+
+    shared_ptr<Index> index, cachedIndex;
+    {
+        auto f1 = FileWrapper::OpenOrDie(filename, L"rb");
+        index = TextInputIndexBuilder(f1).Build();
+    }
+    {
+        auto f1 = FileWrapper::OpenOrDie(filename, L"rb");
+        TextInputIndexBuilder indexBuilder(f1);
+        cachedIndex = indexBuilder.SetCachingEnabled(true).Build();
+        Sleep(1000);
+        _wunlink(indexBuilder.GetCacheFilename().c_str());
+    }
+    _wunlink(filename);
+
+    CheckIdentical(index, cachedIndex);
+}
+
 BOOST_AUTO_TEST_CASE(Index_64MB_with_caching_check_perf)
 {
     if (true)
@@ -703,6 +703,47 @@ void RunConvDilTest(const DeviceDescriptor& device, bool sequential = false)
         PrintOutput<ElementType>(6, outputData);
 }
 
+template <typename ElementType>
+void RunConvBatchNormFoldingTest(const DeviceDescriptor& device)
+{
+    auto input = InputVariable({ 5, 4, 2 }, AsDataType<ElementType>());
+    auto kernel = Parameter(NDArrayView::RandomUniform<ElementType>({ 3, 3, 2, 3 }, -1, 1, seed++, device));
+    auto conv = Convolution(kernel, input);
+
+    // running statistics per output map
+    auto perMap = [&](std::vector<ElementType> values) { return MakeSharedObject<NDArrayView>(NDShape({ 3 }), values, false)->DeepClone(device); };
+    auto scale = Parameter(perMap({ 0.5f, 2.0f, -1.0f }));
+    auto bias = Parameter(perMap({ 0.1f, -0.2f, 0.3f }));
+    auto runningMean = Constant(perMap({ 1.0f, -0.5f, 0.25f }));
+    auto runningVariance = Constant(perMap({ 4.0f, 0.5f, 1.5f }));
+    auto runningCount = Constant::Scalar(AsDataType<ElementType>(), 100.0, device);
+    auto model = BatchNormalization(conv, scale, bias, runningMean, runningVariance, runningCount, /*spatial =*/ true, 0, 0, 0.00001, true, false, L"bn");
+
+    std::vector<ElementType> inputData(input.Shape().TotalSize() * 3);
+    for (size_t i = 0; i < inputData.size(); ++i)
+        inputData[i] = static_cast<ElementType>((i % 7) - 3);
+    auto inputValue = Value::CreateBatch(input.Shape(), inputData, device);
+
+    auto evaluate = [&](const FunctionPtr& function)
+    {
+        auto output = function->Output();
+        std::unordered_map<Variable, ValuePtr> outputDataMap = { { output, nullptr } };
+        function->Evaluate({ { function->Arguments()[0], inputValue } }, outputDataMap, device);
+        std::vector<std::vector<ElementType>> outputData;
+        outputDataMap.at(output)->CopyVariableValueTo(output, outputData);
+        return outputData;
+    };
+
+    auto folded = Internal::FoldBatchNormalization(model);
+    BOOST_TEST((folded->FindByName(L"bn")->OpName() != L"BatchNormalization"));
+
+    auto expected = evaluate(model);
+    auto actual = evaluate(folded);
+    BOOST_TEST(actual.size() == expected.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+        FloatingPointVectorCompare(actual[i], expected[i], "RunConvBatchNormFoldingTest: output of the folded model does not match the original.");
+}
+
 BOOST_AUTO_TEST_SUITE(ConvolutionFunctionSuite)
 
 BOOST_AUTO_TEST_CASE(ConvolutionNetworkDifferentRankInCPU)
@@ -717,6 +758,12 @@ BOOST_AUTO_TEST_CASE(ConvolutionNetworkDifferentRankInCPU)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ConvolutionBatchNormFoldingInCPU)
+{
+    if (ShouldRunOnCpu())
+        RunConvBatchNormFoldingTest<float>(DeviceDescriptor::CPUDevice());
+}
+
 BOOST_AUTO_TEST_CASE(ConvolutionNetwork1DFreeDimensionInCPU)
 {
     if (ShouldRunOnCpu())
@@ -782,6 +829,12 @@ BOOST_AUTO_TEST_CASE(ConvolutionNetworkDifferentRankInGPU)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ConvolutionBatchNormFoldingInGPU)
+{
+    if (ShouldRunOnGpu())
+        RunConvBatchNormFoldingTest<float>(DeviceDescriptor::GPUDevice(0));
+}
+
 BOOST_AUTO_TEST_CASE(ConvolutionNetwork1DFreeDimensionInGPU)
 {
     if (ShouldRunOnGpu())
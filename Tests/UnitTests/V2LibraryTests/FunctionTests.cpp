@@ -6,6 +6,7 @@
 #include "CNTKLibrary.h"
 #include "Common.h"
 #include <numeric>
+#include <thread>
 
 using namespace CNTK;
 
@@ -142,6 +143,52 @@ void TestReduceSum(size_t sampleRank, const DeviceDescriptor& device)
     }
 }
 
+void TestUnpackSequence(size_t numSequences, const DeviceDescriptor& device)
+{
+    // A single sequence is already in unpacked order; several sequences of different lengths need a gather.
+    const float paddingValue = -1.0f;
+    NDShape inputShape({ 3 });
+    size_t dim = inputShape.TotalSize();
+    auto sequenceLengths = GenerateSequenceLengths(numSequences, 6);
+    auto sequences = GenerateSequences<float>(sequenceLengths, inputShape);
+    ValuePtr sequencesValue = Value::Create(inputShape, sequences, device, true);
+    size_t maxSequenceLength = *std::max_element(sequenceLengths.begin(), sequenceLengths.end());
+
+    auto inputVar = InputVariable(inputShape, DataType::Float, /*needsGradient =*/ true, L"input");
+    auto unpackFunc = Sequence::Unpack(inputVar, paddingValue, /*supressMaskOutput =*/ true);
+
+    std::unordered_map<Variable, ValuePtr> outputs = { { unpackFunc->Output(), nullptr } };
+    auto backpropState = unpackFunc->Forward({ { inputVar, sequencesValue } }, outputs, device, { unpackFunc->Output() });
+    auto outputValue = outputs[unpackFunc->Output()];
+
+    auto outputView = MakeSharedObject<NDArrayView>(DataType::Float, outputValue->Shape(), DeviceDescriptor::CPUDevice());
+    outputView->CopyFrom(*outputValue->Data());
+    std::vector<float> outputData(outputView->DataBuffer<float>(), outputView->DataBuffer<float>() + outputView->Shape().TotalSize());
+
+    std::vector<float> expectedOutput(dim * maxSequenceLength * numSequences, paddingValue);
+    for (size_t i = 0; i < numSequences; ++i)
+        for (size_t j = 0; j < sequenceLengths[i] * dim; ++j)
+            expectedOutput[(i * maxSequenceLength * dim) + j] = sequences[i][j];
+    FloatingPointVectorCompare(outputData, expectedOutput, "TestUnpackSequence: Forward prop results do not match expected results");
+
+    // The gradient of the valid positions goes back to the corresponding input frames.
+    std::vector<float> rootGradientData(outputData.size());
+    for (size_t i = 0; i < rootGradientData.size(); ++i)
+        rootGradientData[i] = (float)i;
+    auto rootGradient = MakeSharedObject<Value>(MakeSharedObject<NDArrayView>(outputValue->Shape(), rootGradientData, false));
+    std::unordered_map<Variable, ValuePtr> inputGradients = { { inputVar, nullptr } };
+    unpackFunc->Backward(backpropState, { { unpackFunc->Output(), rootGradient } }, inputGradients);
+
+    std::vector<std::vector<float>> inputGradientData;
+    inputGradients[inputVar]->CopyVariableValueTo(inputVar, inputGradientData);
+    for (size_t i = 0; i < numSequences; ++i)
+    {
+        std::vector<float> expectedGradient(rootGradientData.begin() + (i * maxSequenceLength * dim), rootGradientData.begin() + (i * maxSequenceLength * dim) + (sequenceLengths[i] * dim));
+        inputGradientData[i].resize(sequenceLengths[i] * dim);
+        FloatingPointVectorCompare(inputGradientData[i], expectedGradient, "TestUnpackSequence: Backward prop results do not match expected results");
+    }
+}
+
 void TestSlice(size_t sampleRank, const DeviceDescriptor& device)
 {
     size_t numSequences = 7;
@@ -1096,6 +1143,530 @@ void SetRandomSeed(const DeviceDescriptor& device)
     FloatingPointVectorCompare(result2, result4, "SetRandomSeed: output does match the expected after resetting the dropout seed.");
 }
 
+void TestInferenceGraphOptimization(const DeviceDescriptor& device)
+{
+    auto shape = NDShape({ 3, 2 });
+    auto input = InputVariable(shape, DataType::Float);
+    std::vector<float> scaleData = { 0.5f, -1.0f, 2.0f, 0.25f, 1.5f, -0.75f };
+    std::vector<float> offsetData = { 0.1f, 0.2f, -0.3f, 0.4f, -0.5f, 0.6f };
+    auto scale = Constant(MakeSharedObject<NDArrayView>(shape, scaleData, false)->DeepClone(device));
+    auto offset = Constant(MakeSharedObject<NDArrayView>(shape, offsetData, false)->DeepClone(device));
+
+    // the two branches are the same, their constant part can be computed ahead, and 'unused' is not requested
+    auto branch1 = Tanh(Plus(input, ElementTimes(scale, Exp(offset))));
+    auto branch2 = Tanh(Plus(input, ElementTimes(scale, Exp(offset))));
+    auto output = Plus(branch1, branch2);
+    auto unused = Sigmoid(ElementTimes(input, scale));
+
+    std::vector<float> inputData(shape.TotalSize(), 1.0f);
+    auto inputValue = MakeSharedObject<Value>(MakeSharedObject<NDArrayView>(shape, inputData, false));
+    auto evaluate = [&](const FunctionPtr& function)
+    {
+        std::unordered_map<Variable, ValuePtr> outputMap = { { output->Output(), nullptr } };
+        function->Forward({ { input, inputValue } }, outputMap, device);
+        std::vector<std::vector<float>> result;
+        outputMap.at(output->Output())->CopyVariableValueTo(output->Output(), result);
+        return result[0];
+    };
+
+    auto expected = [&]()
+    {
+        std::vector<float> result(shape.TotalSize());
+        for (size_t i = 0; i < result.size(); i++)
+            result[i] = 2 * tanh(1.0f + scaleData[i] * exp(offsetData[i]));
+        return result;
+    };
+
+    auto plain = evaluate(Combine({ output, unused }));
+    FloatingPointVectorCompare(plain, expected(), "TestInferenceGraphOptimization: output of the plain network does not match the expected.");
+
+    Internal::EnableInferenceGraphOptimization();
+    auto optimizedFunction = Combine({ output, unused });
+    auto optimized = evaluate(optimizedFunction);
+    FloatingPointVectorCompare(optimized, expected(), "TestInferenceGraphOptimization: output of the optimized network does not match the expected.");
+
+    // the folded values follow a change of the Constants
+    scaleData = { 1.0f, 2.0f, 3.0f, -1.0f, -2.0f, -3.0f };
+    scale.SetValue(MakeSharedObject<NDArrayView>(shape, scaleData, false)->DeepClone(device));
+    optimized = evaluate(optimizedFunction);
+    FloatingPointVectorCompare(optimized, expected(), "TestInferenceGraphOptimization: output of the optimized network does not match the expected after changing a Constant.");
+    Internal::DisableInferenceGraphOptimization();
+}
+
+void TestBatchingEvaluator(const DeviceDescriptor& device)
+{
+    const size_t inputDim = 4, outputDim = 3, numThreads = 8, numRequestsPerThread = 10;
+    auto input = InputVariable({ inputDim }, DataType::Float, L"features");
+    std::vector<float> weightsData(outputDim * inputDim);
+    for (size_t i = 0; i < weightsData.size(); i++)
+        weightsData[i] = (float)i / weightsData.size() - 0.5f;
+    auto weights = Constant(MakeSharedObject<NDArrayView>(NDShape({ outputDim, inputDim }), weightsData, false)->DeepClone(device));
+    auto model = Tanh(Times(weights, input));
+
+    auto evaluator = CreateBatchingEvaluator(model, device, /*maxBatchSize =*/ 16, /*maxWaitMicroseconds =*/ 2000);
+
+    // each request is a few sequences of different lengths; its result must not depend on the requests it is batched with
+    std::vector<std::thread> threads;
+    std::vector<std::string> errors(numThreads);
+    for (size_t t = 0; t < numThreads; t++)
+    {
+        threads.push_back(std::thread([&, t]()
+        {
+            try
+            {
+                for (size_t r = 0; r < numRequestsPerThread; r++)
+                {
+                    std::vector<std::vector<float>> sequences(1 + (t + r) % 3);
+                    for (size_t s = 0; s < sequences.size(); s++)
+                    {
+                        sequences[s].resize(inputDim * (1 + (t + s) % 4));
+                        for (size_t i = 0; i < sequences[s].size(); i++)
+                            sequences[s][i] = (float)((t * 31 + r * 7 + s * 3 + i) % 11) / 11;
+                    }
+                    auto inputValue = Value::Create({ inputDim }, sequences, device, /*readOnly =*/ true);
+
+                    std::unordered_map<Variable, ValuePtr> outputs = { { model->Output(), nullptr } };
+                    evaluator->Evaluate({ { input, inputValue } }, outputs);
+                    std::vector<std::vector<float>> result;
+                    outputs.at(model->Output())->CopyVariableValueTo(model->Output(), result);
+
+                    std::vector<std::vector<float>> expected(sequences.size());
+                    for (size_t s = 0; s < sequences.size(); s++)
+                    {
+                        for (size_t j = 0; j < sequences[s].size() / inputDim; j++)
+                        {
+                            for (size_t k = 0; k < outputDim; k++)
+                            {
+                                float sum = 0;
+                                for (size_t i = 0; i < inputDim; i++)
+                                    sum += weightsData[i * outputDim + k] * sequences[s][j * inputDim + i];
+                                expected[s].push_back(tanh(sum));
+                            }
+                        }
+                    }
+
+                    if (result.size() != expected.size())
+                        ReportFailure("TestBatchingEvaluator: Expected %d sequences, got %d.", (int)expected.size(), (int)result.size());
+                    for (size_t s = 0; s < expected.size(); s++)
+                        FloatingPointVectorCompare(result[s], expected[s], "TestBatchingEvaluator: The output of a request does not match the expected.");
+                }
+            }
+            catch (const std::exception& e)
+            {
+                errors[t] = e.what();
+            }
+        }));
+    }
+    for (auto& thread : threads)
+        thread.join();
+    for (const auto& error : errors)
+        BOOST_CHECK_MESSAGE(error.empty(), error);
+
+    auto statistics = evaluator->Statistics();
+    BOOST_TEST(statistics.numRequests == numThreads * numRequestsPerThread);
+    BOOST_TEST(statistics.numBatches <= statistics.numRequests);
+    BOOST_TEST(statistics.p50QueueingLatencyMs <= statistics.p99QueueingLatencyMs);
+
+    // an invalid request fails by itself, without getting into a batch
+    std::unordered_map<Variable, ValuePtr> outputs = { { model->Output(), nullptr } };
+    VerifyException([&]() { evaluator->Evaluate({}, outputs); }, "Was able to evaluate a request without a value for the argument.");
+}
+
+void TestStreamingEvaluator(const DeviceDescriptor& device)
+{
+    const size_t inputDim = 3, outputDim = 4;
+    auto input = InputVariable({ inputDim }, DataType::Float, L"features");
+    auto parameter = [&](size_t rows, size_t cols, float scale)
+    {
+        std::vector<float> data(rows * cols);
+        for (size_t i = 0; i < data.size(); i++)
+            data[i] = scale * ((float)((i * 7) % 13) / 13 - 0.5f);
+        return Constant(MakeSharedObject<NDArrayView>(NDShape({ rows, cols }), data, false)->DeepClone(device));
+    };
+
+    // h(t) = tanh(W x(t) + U h(t-1) + V x(t-2)), with recurrences of one and two steps
+    auto placeholder = PlaceholderVariable(NDShape({ outputDim }));
+    auto output = Tanh(Plus(Plus(Times(parameter(outputDim, inputDim, 1), input), Times(parameter(outputDim, outputDim, 0.8f), placeholder)),
+                            Times(parameter(outputDim, inputDim, 0.5f), PastValue(input, 2))), L"output");
+    auto model = output->ReplacePlaceholders({ { placeholder, PastValue(output->Output()) } });
+
+    const std::vector<size_t> lengths = { 7, 5, 4, 6 };
+    std::vector<std::vector<float>> sequences(lengths.size());
+    for (size_t s = 0; s < lengths.size(); s++)
+    {
+        for (size_t i = 0; i < lengths[s] * inputDim; i++)
+            sequences[s].push_back((float)((s * 5 + i * 3) % 7) / 7 - 0.3f);
+    }
+
+    // the whole sequences at once
+    std::unordered_map<Variable, ValuePtr> outputs = { { model->Output(), nullptr } };
+    model->Evaluate({ { input, Value::Create({ inputDim }, sequences, device, /*readOnly =*/ true) } }, outputs, device);
+    std::vector<std::vector<float>> expected;
+    outputs.at(model->Output())->CopyVariableValueTo(model->Output(), expected);
+
+    // The streams are fed chunks of 1 to 3 frames; the streams that are done drop out, so that the others change their
+    // parallel sequence. Stream 3 first runs over a different sequence, and is reset before it is fed its own.
+    auto evaluator = CreateStreamingEvaluator(model, device);
+    std::vector<StreamContextPtr> streams;
+    for (size_t s = 0; s < lengths.size(); s++)
+        streams.push_back(evaluator->CreateStream());
+    for (size_t t = 0; t < 4; t += 2)
+    {
+        std::vector<std::vector<float>> chunk = { std::vector<float>(sequences[0].begin() + t * inputDim, sequences[0].begin() + (t + 2) * inputDim) };
+        std::unordered_map<Variable, ValuePtr> chunkOutputs = { { model->Output(), nullptr } };
+        evaluator->Evaluate(streams[3], { { input, Value::Create({ inputDim }, chunk, device, /*readOnly =*/ true) } }, chunkOutputs);
+    }
+    BOOST_TEST(streams[3]->NumFrames() == 4);
+    streams[3]->Reset();
+
+    std::vector<size_t> numFramesFed(lengths.size(), 0);
+    std::vector<std::vector<float>> results(lengths.size());
+    for (size_t round = 0; ; round++)
+    {
+        std::vector<StreamContextPtr> batch;
+        std::vector<size_t> batchSequences;
+        std::vector<std::unordered_map<Variable, ValuePtr>> chunks, chunkOutputs;
+        for (size_t s = 0; s < lengths.size(); s++)
+        {
+            auto numFrames = std::min(1 + (s + round) % 3, lengths[s] - numFramesFed[s]);
+            if (numFrames == 0)
+                continue;
+
+            std::vector<std::vector<float>> chunk = { std::vector<float>(sequences[s].begin() + numFramesFed[s] * inputDim,
+                                                                         sequences[s].begin() + (numFramesFed[s] + numFrames) * inputDim) };
+            batch.push_back(streams[s]);
+            batchSequences.push_back(s);
+            chunks.push_back({ { input, Value::Create({ inputDim }, chunk, { streams[s]->NumFrames() == 0 }, device, /*readOnly =*/ true) } });
+            chunkOutputs.push_back({ { model->Output(), nullptr } });
+            numFramesFed[s] += numFrames;
+        }
+        if (batch.empty())
+            break;
+
+        evaluator->Evaluate(batch, chunks, chunkOutputs);
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            std::vector<std::vector<float>> result;
+            chunkOutputs[i].at(model->Output())->CopyVariableValueTo(model->Output(), result);
+            if (result.size() != 1)
+                ReportFailure("TestStreamingEvaluator: Expected one sequence for the chunk of a stream, got %d.", (int)result.size());
+            results[batchSequences[i]].insert(results[batchSequences[i]].end(), result.front().begin(), result.front().end());
+        }
+    }
+
+    for (size_t s = 0; s < lengths.size(); s++)
+    {
+        BOOST_TEST(streams[s]->NumFrames() == lengths[s]);
+        FloatingPointVectorCompare(results[s], expected[s], "TestStreamingEvaluator: The outputs of a stream do not match the evaluation of the whole sequence.");
+    }
+
+    // a stream of another evaluator is rejected
+    auto otherStream = CreateStreamingEvaluator(model, device)->CreateStream();
+    std::unordered_map<Variable, ValuePtr> otherOutputs = { { model->Output(), nullptr } };
+    auto otherChunk = Value::Create({ inputDim }, std::vector<std::vector<float>>({ sequences[0] }), device, /*readOnly =*/ true);
+    VerifyException([&]() { evaluator->Evaluate(otherStream, { { input, otherChunk } }, otherOutputs); },
+                    "Was able to evaluate a stream of another evaluator.");
+}
+
+void TestEvaluatorPool(const DeviceDescriptor& device, EvaluationStreamPriority streamPriority = EvaluationStreamPriority::Shared)
+{
+    const size_t inputDim = 4, outputDim = 3, numThreads = 16, numRequestsPerThread = 10;
+    auto input = InputVariable({ inputDim }, DataType::Float, L"features");
+    std::vector<float> weightsData(outputDim * inputDim);
+    for (size_t i = 0; i < weightsData.size(); i++)
+        weightsData[i] = (float)i / weightsData.size() - 0.5f;
+    auto weights = Parameter(MakeSharedObject<NDArrayView>(NDShape({ outputDim, inputDim }), weightsData, false)->DeepClone(device));
+    auto model = Tanh(Times(weights, input));
+
+    auto pool = CreateEvaluatorPool(model, { device }, /*numContextsPerDevice =*/ 2, /*maxBatchSize =*/ 4, /*pinToNumaNodes =*/ false, streamPriority);
+    BOOST_TEST(pool->NumContexts() == 2);
+
+    // more threads than contexts, each submitting a few requests before waiting for them
+    std::vector<std::thread> threads;
+    std::vector<std::string> errors(numThreads);
+    for (size_t t = 0; t < numThreads; t++)
+    {
+        threads.push_back(std::thread([&, t]()
+        {
+            try
+            {
+                std::vector<std::vector<float>> inputs(numRequestsPerThread);
+                std::vector<std::unordered_map<Variable, ValuePtr>> arguments(numRequestsPerThread);
+                std::vector<std::unordered_map<Variable, ValuePtr>> outputs(numRequestsPerThread);
+                std::vector<size_t> tickets;
+                for (size_t r = 0; r < numRequestsPerThread; r++)
+                {
+                    inputs[r].resize(inputDim);
+                    for (size_t i = 0; i < inputDim; i++)
+                        inputs[r][i] = (float)((t * 31 + r * 7 + i) % 11) / 11;
+                    arguments[r] = { { input, Value::CreateBatch({ inputDim }, inputs[r], device, /*readOnly =*/ true) } };
+                    outputs[r] = { { model->Output(), nullptr } };
+                    tickets.push_back(pool->Submit(arguments[r], outputs[r]));
+                }
+
+                for (size_t r = 0; r < numRequestsPerThread; r++)
+                {
+                    pool->Wait(tickets[r]);
+                    std::vector<std::vector<float>> result;
+                    outputs[r].at(model->Output())->CopyVariableValueTo(model->Output(), result);
+
+                    std::vector<float> expected;
+                    for (size_t k = 0; k < outputDim; k++)
+                    {
+                        float sum = 0;
+                        for (size_t i = 0; i < inputDim; i++)
+                            sum += weightsData[i * outputDim + k] * inputs[r][i];
+                        expected.push_back(tanh(sum));
+                    }
+
+                    if (result.size() != 1)
+                        ReportFailure("TestEvaluatorPool: Expected 1 sample, got %d.", (int)result.size());
+                    FloatingPointVectorCompare(result[0], expected, "TestEvaluatorPool: The output of a request does not match the expected.");
+                }
+            }
+            catch (const std::exception& e)
+            {
+                errors[t] = e.what();
+            }
+        }));
+    }
+    for (auto& thread : threads)
+        thread.join();
+    for (const auto& error : errors)
+        BOOST_CHECK_MESSAGE(error.empty(), error);
+
+    // the contexts share the storage of the parameters, so an update is seen by all of them
+    weights.SetValue(MakeSharedObject<NDArrayView>(0.0f, NDShape({ outputDim, inputDim }), device));
+    for (size_t r = 0; r < 2 * pool->NumContexts(); r++)
+    {
+        std::vector<float> ones(inputDim, 1.0f);
+        std::unordered_map<Variable, ValuePtr> outputs = { { model->Output(), nullptr } };
+        pool->Evaluate({ { input, Value::CreateBatch({ inputDim }, ones, device, /*readOnly =*/ true) } }, outputs);
+        std::vector<std::vector<float>> result;
+        outputs.at(model->Output())->CopyVariableValueTo(model->Output(), result);
+        FloatingPointVectorCompare(result[0], std::vector<float>(outputDim, 0.0f), "TestEvaluatorPool: A context does not share the parameters of the model.");
+    }
+
+    // new values of the parameters, given by uid, are switched in between the requests
+    std::vector<float> newWeightsData(outputDim * inputDim, 0.25f);
+    pool->UpdateParameters({ { weights.Uid(), MakeSharedObject<NDArrayView>(NDShape({ outputDim, inputDim }), newWeightsData, false) } });
+    for (size_t r = 0; r < 2 * pool->NumContexts(); r++)
+    {
+        std::vector<float> ones(inputDim, 1.0f);
+        std::unordered_map<Variable, ValuePtr> outputs = { { model->Output(), nullptr } };
+        pool->Evaluate({ { input, Value::CreateBatch({ inputDim }, ones, device, /*readOnly =*/ true) } }, outputs);
+        std::vector<std::vector<float>> result;
+        outputs.at(model->Output())->CopyVariableValueTo(model->Output(), result);
+        FloatingPointVectorCompare(result[0], std::vector<float>(outputDim, tanh(0.25f * inputDim)), "TestEvaluatorPool: A context does not evaluate with the updated parameters.");
+    }
+    VerifyException([&]() { pool->UpdateParameters({ { L"NoSuchParameter", MakeSharedObject<NDArrayView>(NDShape({ outputDim, inputDim }), newWeightsData, false) } }); },
+                    "Was able to update a parameter that the model does not have.");
+    VerifyException([&]() { pool->UpdateParameters({ { weights.Uid(), MakeSharedObject<NDArrayView>(NDShape({ outputDim * inputDim }), newWeightsData, false) } }); },
+                    "Was able to update a parameter with a value of another shape.");
+
+    // errors are reported to the waiting caller
+    std::unordered_map<Variable, ValuePtr> outputs = { { model->Output(), nullptr } };
+    auto ticket = pool->Submit({}, outputs);
+    VerifyException([&]() { pool->Wait(ticket); }, "Was able to evaluate a request without a value for the argument.");
+    VerifyException([&]() { pool->Wait(ticket); }, "Was able to wait for a ticket twice.");
+}
+
+void TestEvaluationWithoutAllocations(const DeviceDescriptor& device)
+{
+    const size_t inputDim = 5, outputDim = 3;
+    auto input = InputVariable({ inputDim }, DataType::Float, L"features");
+    auto weights = Parameter(NDArrayView::RandomUniform<float>({ outputDim, inputDim }, -0.5, 0.5, 1, device));
+    auto model = Tanh(Times(weights, input));
+
+    // sequences of different lengths, so that the data is rearranged into and out of the packed layout, and the output has a mask
+    std::vector<std::vector<float>> sequences = { std::vector<float>(inputDim * 4, 0.5f), std::vector<float>(inputDim * 2, -0.25f), std::vector<float>(inputDim * 3, 1.0f) };
+    auto inputValue = Value::Create({ inputDim }, sequences, device, /*readOnly =*/ true);
+    auto outputValue = MakeSharedObject<Value>(MakeSharedObject<NDArrayView>(DataType::Float, NDShape({ outputDim, 4, 3 }), device), MakeSharedObject<NDMask>(NDShape({ 4, 3 }), DeviceDescriptor::CPUDevice()));
+
+    std::unordered_map<Variable, ValuePtr> outputs = { { model->Output(), outputValue } };
+    for (size_t i = 0; i < 2; i++) // warm-up
+        model->Evaluate({ { input, inputValue } }, outputs, device);
+
+    auto numAllocations = Internal::GetNumStorageAllocations();
+    for (size_t i = 0; i < 5; i++)
+        model->Evaluate({ { input, inputValue } }, outputs, device);
+    BOOST_TEST(Internal::GetNumStorageAllocations() == numAllocations);
+
+    BOOST_TEST(outputs.at(model->Output()) == outputValue);
+    BOOST_TEST(outputValue->Mask()->MaskedCount() == 3);
+}
+
+void TestCompiledNetworkVariants(const DeviceDescriptor& device)
+{
+    const size_t inputDim = 4, outputDim = 3;
+    auto input = InputVariable({ inputDim }, DataType::Float, L"features");
+    std::vector<float> weightsData(outputDim * inputDim);
+    for (size_t i = 0; i < weightsData.size(); i++)
+        weightsData[i] = 0.1f * i - 0.5f;
+    auto weights = Parameter(MakeSharedObject<NDArrayView>(NDShape({ outputDim, inputDim }), weightsData, false)->DeepClone(device));
+    auto hidden = Times(weights, input);
+    auto model = Tanh(hidden);
+
+    std::vector<float> inputData = { 1.0f, -2.0f, 0.5f, 3.0f };
+    auto inputValue = MakeSharedObject<Value>(MakeSharedObject<NDArrayView>(NDShape({ inputDim, 1, 1 }), inputData, false)->DeepClone(device));
+    std::vector<float> expectedHidden(outputDim, 0.0f), expectedModel(outputDim);
+    for (size_t i = 0; i < outputDim; i++)
+    {
+        for (size_t j = 0; j < inputDim; j++)
+            expectedHidden[i] += weightsData[j * outputDim + i] * inputData[j];
+        expectedModel[i] = tanh(expectedHidden[i]);
+    }
+
+    // the intermediate 'hidden' is not an output of the network built for 'model', so asking for either one in turn
+    // needs two networks
+    Internal::SetMaxNumCompiledNetworksPerFunction(2);
+    std::unordered_map<Variable, ValuePtr> outputs[2] =
+    {
+        { { model->Output(), MakeSharedObject<Value>(MakeSharedObject<NDArrayView>(DataType::Float, NDShape({ outputDim, 1, 1 }), device)) } },
+        { { hidden->Output(), MakeSharedObject<Value>(MakeSharedObject<NDArrayView>(DataType::Float, NDShape({ outputDim, 1, 1 }), device)) } }
+    };
+    auto evaluate = [&](size_t i, const std::vector<float>& expected)
+    {
+        model->Forward({ { input, inputValue } }, outputs[i], device);
+        std::vector<std::vector<float>> result;
+        outputs[i].begin()->second->CopyVariableValueTo(outputs[i].begin()->first, result);
+        FloatingPointVectorCompare(result[0], expected, "TestCompiledNetworkVariants: the output does not match the expected.");
+    };
+    evaluate(0, expectedModel); // warm-up
+    evaluate(1, expectedHidden);
+
+    auto numAllocations = Internal::GetNumStorageAllocations();
+    for (size_t i = 0; i < 3; i++)
+    {
+        evaluate(0, expectedModel);
+        evaluate(1, expectedHidden);
+    }
+    BOOST_TEST(Internal::GetNumStorageAllocations() == numAllocations);
+    Internal::SetMaxNumCompiledNetworksPerFunction(1);
+}
+
+void TestPrepare(const DeviceDescriptor& device)
+{
+    const size_t inputDim = 5, outputDim = 3, sequenceLength = 3;
+    auto input = InputVariable({ inputDim }, DataType::Float, L"features");
+    auto weights = Parameter(NDArrayView::RandomUniform<float>({ outputDim, inputDim }, -0.5, 0.5, 1, device));
+    auto model = Tanh(Times(weights, input));
+
+    auto report = model->Prepare({ 2, 8, 4 }, sequenceLength, device);
+    BOOST_TEST(report.entries.size() == 3);
+    BOOST_TEST(report.numNetworkVariants == 1);
+    BOOST_TEST(report.allVariantsKept);
+    BOOST_TEST((report.entries[1].argumentShapes.at(input) == NDShape({ inputDim, sequenceLength, 8 })));
+    for (const auto& entry : report.entries)
+        BOOST_TEST(entry.numWarmStorageAllocations == 0);
+
+    // a request of a prepared shape is served without allocations
+    std::vector<std::vector<float>> sequences(4, std::vector<float>(inputDim * sequenceLength, 0.5f));
+    auto inputValue = Value::Create({ inputDim }, sequences, device, /*readOnly =*/ true);
+    std::unordered_map<Variable, ValuePtr> outputs = { { model->Output(), nullptr } };
+    auto numAllocations = Internal::GetNumStorageAllocations();
+    model->Evaluate({ { input, inputValue } }, outputs, device);
+    BOOST_TEST(Internal::GetNumStorageAllocations() == numAllocations);
+
+    VerifyException([&]() { model->Prepare(std::vector<std::unordered_map<Variable, NDShape>>{ {} }); }, "Was able to prepare a Function without the shapes of its arguments.");
+}
+
+void TestBeamSearchDecoder(const DeviceDescriptor& device)
+{
+    // The step function depends on the previous token and on a state that counts down the tokens already fed,
+    // so that the scores are only right if the states follow the beams they were selected from.
+    const size_t V = 3, endToken = 0, startToken = 2, maxLength = 3, numSentences = 2;
+    auto token = InputVariable({ 1 }, DataType::Float, L"token", { Axis::DefaultBatchAxis() });
+    auto state = InputVariable({ V }, DataType::Float, L"state", { Axis::DefaultBatchAxis() });
+    std::vector<float> table = { 0.1f, -0.3f, 0.7f,  1.2f, 0.0f, -0.4f,  -0.8f, 0.6f, 0.2f }; // column: previous token
+    std::vector<float> tokenIndices = { 0, 1, 2 };
+    auto oneHot = Equal(Constant(MakeSharedObject<NDArrayView>(NDShape({ V }), tokenIndices, false)->DeepClone(device)), token);
+    auto logProbabilities = LogSoftmax(Plus(Times(Constant(MakeSharedObject<NDArrayView>(NDShape({ V, V }), table, false)->DeepClone(device)), oneHot), state));
+    auto nextState = Minus(state, oneHot);
+    auto stepFunction = Combine({ logProbabilities, nextState });
+
+    std::vector<float> initialStates = { 0.0f, 0.5f, -0.5f,  -1.0f, 0.0f, 1.0f };
+    auto referenceScore = [&](const std::vector<size_t>& tokens, size_t sentence)
+    {
+        std::vector<double> h(initialStates.begin() + sentence * V, initialStates.begin() + (sentence + 1) * V);
+        size_t previous = startToken;
+        double score = 0;
+        for (auto next : tokens)
+        {
+            double sum = 0;
+            for (size_t v = 0; v < V; v++)
+                sum += exp(table[previous * V + v] + h[v]);
+            score += table[previous * V + next] + h[next] - log(sum);
+            h[previous] -= 1;
+            previous = next;
+        }
+        return score;
+    };
+
+    // with more beams than hypotheses, beam search is exhaustive
+    std::vector<std::vector<size_t>> allHypotheses, partial = { {} };
+    for (size_t length = 1; length <= maxLength; length++)
+    {
+        std::vector<std::vector<size_t>> extended;
+        for (const auto& prefix : partial)
+        {
+            for (size_t v = 0; v < V; v++)
+            {
+                auto tokens = prefix;
+                tokens.push_back(v);
+                if (v == endToken || length == maxLength)
+                    allHypotheses.push_back(tokens);
+                else
+                    extended.push_back(tokens);
+            }
+        }
+        partial = extended;
+    }
+
+    for (double exponent : { 0.0, 1.0 })
+    {
+        BeamSearchOptions options;
+        options.beamWidth = 16;
+        options.maxLength = maxLength;
+        options.lengthNormalizationExponent = exponent;
+        auto decoder = CreateBeamSearchDecoder(stepFunction, token, logProbabilities->Output(), { { state, nextState->Output() } }, startToken, endToken, device, options);
+        auto result = decoder->Decode({ { state, Value::CreateBatch({ V }, initialStates, device, /*readOnly =*/ true) } });
+        BOOST_TEST(result.size() == numSentences);
+
+        for (size_t n = 0; n < numSentences; n++)
+        {
+            std::vector<std::pair<double, std::vector<size_t>>> expected;
+            for (const auto& tokens : allHypotheses)
+                expected.push_back({ referenceScore(tokens, n) / pow((double)tokens.size(), exponent), tokens });
+            std::stable_sort(expected.begin(), expected.end(), [](const std::pair<double, std::vector<size_t>>& a, const std::pair<double, std::vector<size_t>>& b) { return a.first > b.first; });
+
+            if (result[n].size() != expected.size())
+                ReportFailure("TestBeamSearchDecoder: Expected %d hypotheses, got %d.", (int)expected.size(), (int)result[n].size());
+            for (size_t i = 0; i < expected.size(); i++)
+            {
+                BOOST_TEST(result[n][i].tokens == expected[i].second);
+                FloatingPointCompare((float)result[n][i].score, (float)expected[i].first, "TestBeamSearchDecoder: The score of a hypothesis does not match the expected.");
+            }
+        }
+    }
+
+    // a narrow beam keeps the best hypotheses it has found
+    BeamSearchOptions options;
+    options.beamWidth = 2;
+    options.maxLength = maxLength;
+    auto decoder = CreateBeamSearchDecoder(stepFunction, token, logProbabilities->Output(), { { state, nextState->Output() } }, startToken, endToken, device, options);
+    auto result = decoder->Decode({ { state, Value::CreateBatch({ V }, initialStates, device, /*readOnly =*/ true) } });
+    for (size_t n = 0; n < numSentences; n++)
+    {
+        BOOST_TEST(result[n].size() == options.beamWidth);
+        for (const auto& hypothesis : result[n])
+            FloatingPointCompare((float)hypothesis.score, (float)referenceScore(hypothesis.tokens, n), "TestBeamSearchDecoder: The score of a hypothesis does not match its tokens.");
+    }
+
+    VerifyException([&]() { CreateBeamSearchDecoder(stepFunction, state, logProbabilities->Output(), {}, startToken, endToken, device, options); }, "Was able to create a decoder with a token input of more than one element.");
+    VerifyException([&]() { decoder->Decode({}); }, "Was able to decode without the initial states.");
+}
+
 void TestMatMul(const DeviceDescriptor& device)
 {
     srand(1);
@@ -1271,6 +1842,24 @@ BOOST_AUTO_TEST_CASE(ReduceSumInGPU)
         TestReduceSum(2, DeviceDescriptor::GPUDevice(0));
 }
 
+BOOST_AUTO_TEST_CASE(UnpackSequenceInCPU)
+{
+    if (ShouldRunOnCpu())
+    {
+        TestUnpackSequence(1, DeviceDescriptor::CPUDevice());
+        TestUnpackSequence(7, DeviceDescriptor::CPUDevice());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(UnpackSequenceInGPU)
+{
+    if (ShouldRunOnGpu())
+    {
+        TestUnpackSequence(1, DeviceDescriptor::GPUDevice(0));
+        TestUnpackSequence(7, DeviceDescriptor::GPUDevice(0));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(RecurrentFunctionCloning)
 {
     if (ShouldRunOnCpu())
@@ -1334,6 +1923,74 @@ BOOST_AUTO_TEST_CASE(MatMul)
         TestMatMul(DeviceDescriptor::GPUDevice(0));
 }
 
+BOOST_AUTO_TEST_CASE(InferenceGraphOptimization)
+{
+    if (ShouldRunOnCpu())
+        TestInferenceGraphOptimization(DeviceDescriptor::CPUDevice());
+    if (ShouldRunOnGpu())
+        TestInferenceGraphOptimization(DeviceDescriptor::GPUDevice(0));
+}
+
+BOOST_AUTO_TEST_CASE(BatchingEvaluator)
+{
+    if (ShouldRunOnCpu())
+        TestBatchingEvaluator(DeviceDescriptor::CPUDevice());
+    if (ShouldRunOnGpu())
+        TestBatchingEvaluator(DeviceDescriptor::GPUDevice(0));
+}
+
+BOOST_AUTO_TEST_CASE(StreamingEvaluator)
+{
+    if (ShouldRunOnCpu())
+        TestStreamingEvaluator(DeviceDescriptor::CPUDevice());
+    if (ShouldRunOnGpu())
+        TestStreamingEvaluator(DeviceDescriptor::GPUDevice(0));
+}
+
+BOOST_AUTO_TEST_CASE(EvaluatorPool)
+{
+    if (ShouldRunOnCpu())
+        TestEvaluatorPool(DeviceDescriptor::CPUDevice());
+    if (ShouldRunOnGpu())
+    {
+        TestEvaluatorPool(DeviceDescriptor::GPUDevice(0));
+        TestEvaluatorPool(DeviceDescriptor::GPUDevice(0), EvaluationStreamPriority::High);
+        TestEvaluatorPool(DeviceDescriptor::GPUDevice(0), EvaluationStreamPriority::Low);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(EvaluationWithoutAllocations)
+{
+    if (ShouldRunOnCpu())
+        TestEvaluationWithoutAllocations(DeviceDescriptor::CPUDevice());
+    if (ShouldRunOnGpu())
+        TestEvaluationWithoutAllocations(DeviceDescriptor::GPUDevice(0));
+}
+
+BOOST_AUTO_TEST_CASE(CompiledNetworkVariants)
+{
+    if (ShouldRunOnCpu())
+        TestCompiledNetworkVariants(DeviceDescriptor::CPUDevice());
+    if (ShouldRunOnGpu())
+        TestCompiledNetworkVariants(DeviceDescriptor::GPUDevice(0));
+}
+
+BOOST_AUTO_TEST_CASE(Prepare)
+{
+    if (ShouldRunOnCpu())
+        TestPrepare(DeviceDescriptor::CPUDevice());
+    if (ShouldRunOnGpu())
+        TestPrepare(DeviceDescriptor::GPUDevice(0));
+}
+
+BOOST_AUTO_TEST_CASE(BeamSearchDecoder)
+{
+    if (ShouldRunOnCpu())
+        TestBeamSearchDecoder(DeviceDescriptor::CPUDevice());
+    if (ShouldRunOnGpu())
+        TestBeamSearchDecoder(DeviceDescriptor::GPUDevice(0));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }}
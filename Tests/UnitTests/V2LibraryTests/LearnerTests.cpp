@@ -350,6 +350,350 @@ void TestSweepBasedSchedule()
     }
 }
 
+// Updates the same parameters with the learners that support multi-tensor updates, once with the parameters updated together
+// and once one by one. More parameters than a GPU launch takes, and one larger than a chunk of a thread block.
+template <typename ElementType>
+void TestMultiTensorLearnerUpdate(const DeviceDescriptor& device)
+{
+    vector<NDShape> shapes(50, NDShape({ 3, 4 }));
+    shapes.push_back({ 200, 100 });
+    shapes.push_back({ 7 });
+
+    AdditionalLearningOptions options;
+    options.l2RegularizationWeight = 0.01;
+    vector<function<LearnerPtr(const vector<Parameter>&)>> createLearners = {
+        [&](const vector<Parameter>& parameters) { return MomentumSGDLearner(parameters, TrainingParameterPerSampleSchedule(0.1), MomentumAsTimeConstantSchedule(10.0), true, options); },
+        [&](const vector<Parameter>& parameters) { return MomentumSGDLearner(parameters, LearningRateSchedule(0.5, 10), MomentumSchedule(0.9, 10), false); },
+        [&](const vector<Parameter>& parameters) { return AdaGradLearner(parameters, TrainingParameterPerSampleSchedule(0.1), false, options); },
+        [&](const vector<Parameter>& parameters) { return FSAdaGradLearner(parameters, TrainingParameterPerSampleSchedule(0.1), MomentumAsTimeConstantSchedule(10.0), true, MomentumSchedule(0.99, 1), options); },
+        [&](const vector<Parameter>& parameters) { return AdamLearner(parameters, TrainingParameterPerSampleSchedule(0.1), MomentumAsTimeConstantSchedule(10.0), true, MomentumSchedule(0.99, 1), 1e-8, false, options); },
+        [&](const vector<Parameter>& parameters) { return AdamLearner(parameters, TrainingParameterPerSampleSchedule(0.1), MomentumAsTimeConstantSchedule(10.0), false, MomentumSchedule(0.99, 1), 1e-8, true); },
+    };
+
+    auto train = [&](const function<LearnerPtr(const vector<Parameter>&)>& createLearner)
+    {
+        vector<Parameter> parameters;
+        for (size_t i = 0; i < shapes.size(); i++)
+            parameters.push_back(Parameter(NDArrayView::RandomUniform<ElementType>(shapes[i], -1.0, 1.0, i, device), L"parameter_" + to_wstring(i)));
+
+        auto learner = createLearner(parameters);
+        for (size_t minibatch = 0; minibatch < 3; minibatch++)
+        {
+            unordered_map<Parameter, NDArrayViewPtr> gradientValues;
+            for (size_t i = 0; i < parameters.size(); i++)
+                gradientValues[parameters[i]] = NDArrayView::RandomUniform<ElementType>(shapes[i], -1.0, 1.0, 100 * minibatch + i, device);
+            learner->Update(gradientValues, 16, false);
+        }
+
+        vector<ElementType> values;
+        for (const auto& parameter : parameters)
+        {
+            auto value = parameter.Value()->DeepClone(DeviceDescriptor::CPUDevice());
+            values.insert(values.end(), value->DataBuffer<ElementType>(), value->DataBuffer<ElementType>() + value->Shape().TotalSize());
+        }
+        return values;
+    };
+
+    for (const auto& createLearner : createLearners)
+    {
+        Internal::DisableMultiTensorLearnerUpdates();
+        auto expected = train(createLearner);
+        Internal::EnableMultiTensorLearnerUpdates();
+        auto actual = train(createLearner);
+        FloatingPointVectorCompare(actual, expected, "Parameters updated together differ from the parameters updated one by one");
+    }
+}
+
+// Clips the global norm of the gradients of a minibatch, and compares with the update with gradients scaled down beforehand,
+// once with the parameters updated together and once one by one.
+template <typename ElementType>
+void TestGlobalNormGradientClipping(const DeviceDescriptor& device)
+{
+    vector<NDShape> shapes(10, NDShape({ 3, 4 }));
+    shapes.push_back({ 200, 100 });
+    const size_t minibatchSize = 16;
+    const double thresholdPerSample = 0.5;
+
+    vector<vector<ElementType>> gradients;
+    double sumOfSquares = 0;
+    for (size_t i = 0; i < shapes.size(); i++)
+    {
+        auto gradient = NDArrayView::RandomUniform<ElementType>(shapes[i], -1.0, 1.0, 100 + i, DeviceDescriptor::CPUDevice());
+        gradients.push_back(vector<ElementType>(gradient->template DataBuffer<ElementType>(), gradient->template DataBuffer<ElementType>() + shapes[i].TotalSize()));
+        for (auto value : gradients.back())
+            sumOfSquares += (double)value * value;
+    }
+    const double scale = thresholdPerSample * minibatchSize / sqrt(sumOfSquares);
+    BOOST_TEST(scale < 1);
+
+    auto train = [&](double gradientScale, const AdditionalLearningOptions& options)
+    {
+        vector<Parameter> parameters;
+        unordered_map<Parameter, NDArrayViewPtr> gradientValues;
+        for (size_t i = 0; i < shapes.size(); i++)
+        {
+            parameters.push_back(Parameter(NDArrayView::RandomUniform<ElementType>(shapes[i], -1.0, 1.0, i, device), L"parameter_" + to_wstring(i)));
+            vector<ElementType> gradient(gradients[i]);
+            for (auto& value : gradient)
+                value = ElementType(value * gradientScale);
+            gradientValues[parameters.back()] = MakeSharedObject<NDArrayView>(shapes[i], gradient, false)->DeepClone(device);
+        }
+
+        auto learner = MomentumSGDLearner(parameters, TrainingParameterPerSampleSchedule(0.1), MomentumAsTimeConstantSchedule(10.0), true, options);
+        learner->Update(gradientValues, minibatchSize, false);
+
+        vector<ElementType> values;
+        for (const auto& parameter : parameters)
+        {
+            auto value = parameter.Value()->DeepClone(DeviceDescriptor::CPUDevice());
+            values.insert(values.end(), value->DataBuffer<ElementType>(), value->DataBuffer<ElementType>() + value->Shape().TotalSize());
+        }
+        return values;
+    };
+
+    AdditionalLearningOptions clipping;
+    clipping.gradientClippingGlobalNormThresholdPerSample = thresholdPerSample;
+    auto expected = train(scale, AdditionalLearningOptions());
+    for (bool multiTensor : { false, true })
+    {
+        if (multiTensor)
+            Internal::EnableMultiTensorLearnerUpdates();
+        else
+            Internal::DisableMultiTensorLearnerUpdates();
+        auto actual = train(1, clipping);
+        FloatingPointVectorCompare(actual, expected, "Parameters updated with the gradients clipped by their global norm differ from the expected ones");
+    }
+    Internal::EnableMultiTensorLearnerUpdates();
+}
+
+// Compares LARS and LAMB with momentum SGD and Adam after one minibatch, with the trust ratios computed from host copies.
+template <typename ElementType>
+void TestLayerwiseAdaptiveLearners(const DeviceDescriptor& device)
+{
+    vector<NDShape> shapes = { { 3, 4 }, { 200, 100 }, { 7 } };
+    const size_t minibatchSize = 16;
+    const double learningRate = 0.1;
+
+    auto toVector = [](const NDArrayViewPtr& value)
+    {
+        auto cpuValue = value->DeepClone(DeviceDescriptor::CPUDevice());
+        return vector<ElementType>(cpuValue->template DataBuffer<ElementType>(), cpuValue->template DataBuffer<ElementType>() + cpuValue->Shape().TotalSize());
+    };
+    auto norm = [](const vector<ElementType>& values)
+    {
+        double sumOfSquares = 0;
+        for (auto value : values)
+            sumOfSquares += (double)value * value;
+        return sqrt(sumOfSquares);
+    };
+
+    // returns the parameters after one update by the learners created for the learning rate of each parameter
+    auto train = [&](const function<LearnerPtr(const Parameter&, double)>& createLearner, const vector<double>& learningRates)
+    {
+        vector<vector<ElementType>> values;
+        for (size_t i = 0; i < shapes.size(); i++)
+        {
+            auto parameter = Parameter(NDArrayView::RandomUniform<ElementType>(shapes[i], -1.0, 1.0, i, device), L"parameter");
+            auto gradient = NDArrayView::RandomUniform<ElementType>(shapes[i], -1.0, 1.0, 100 + i, device);
+            unordered_map<Parameter, NDArrayViewPtr> gradientValues = { { parameter, gradient } };
+            createLearner(parameter, learningRates[i])->Update(gradientValues, minibatchSize, false);
+            values.push_back(toVector(parameter.Value()));
+        }
+        return values;
+    };
+    auto trainAll = [&](const function<LearnerPtr(const vector<Parameter>&)>& createLearner)
+    {
+        vector<Parameter> parameters;
+        unordered_map<Parameter, NDArrayViewPtr> gradientValues;
+        for (size_t i = 0; i < shapes.size(); i++)
+        {
+            parameters.push_back(Parameter(NDArrayView::RandomUniform<ElementType>(shapes[i], -1.0, 1.0, i, device), L"parameter_" + to_wstring(i)));
+            gradientValues[parameters.back()] = NDArrayView::RandomUniform<ElementType>(shapes[i], -1.0, 1.0, 100 + i, device);
+        }
+        createLearner(parameters)->Update(gradientValues, minibatchSize, false);
+
+        vector<vector<ElementType>> values;
+        for (const auto& parameter : parameters)
+            values.push_back(toVector(parameter.Value()));
+        return values;
+    };
+
+    const double trustCoefficient = 0.01;
+    vector<double> larsLearningRates, lambLearningRates, unitLearningRates(shapes.size(), 1.0);
+    for (size_t i = 0; i < shapes.size(); i++)
+    {
+        const double parameterNorm = norm(toVector(NDArrayView::RandomUniform<ElementType>(shapes[i], -1.0, 1.0, i, device)));
+        const double gradientNorm = norm(toVector(NDArrayView::RandomUniform<ElementType>(shapes[i], -1.0, 1.0, 100 + i, device)));
+        larsLearningRates.push_back(learningRate * trustCoefficient * parameterNorm / (gradientNorm + 1e-8));
+    }
+
+    auto momentumSGD = [&](const Parameter& parameter, double rate) { return MomentumSGDLearner({ parameter }, TrainingParameterPerSampleSchedule(rate), MomentumSchedule(0.9), true); };
+    auto adam = [&](const Parameter& parameter, double rate) { return AdamLearner({ parameter }, TrainingParameterPerSampleSchedule(rate), MomentumSchedule(0.9), true, MomentumSchedule(0.999), 1e-6); };
+
+    auto expected = train(momentumSGD, larsLearningRates);
+    auto actual = trainAll([&](const vector<Parameter>& parameters) { return LARSLearner(parameters, TrainingParameterPerSampleSchedule(learningRate), MomentumSchedule(0.9), true, trustCoefficient); });
+    for (size_t i = 0; i < shapes.size(); i++)
+        FloatingPointVectorCompare(actual[i], expected[i], "LARS differs from momentum SGD with the learning rates scaled by the trust ratios");
+
+    // the updates of Adam for a learning rate of 1, scaled by the trust ratios
+    auto adamUpdated = train(adam, unitLearningRates);
+    expected.clear();
+    for (size_t i = 0; i < shapes.size(); i++)
+    {
+        auto parameter = toVector(NDArrayView::RandomUniform<ElementType>(shapes[i], -1.0, 1.0, i, device));
+        vector<ElementType> update(parameter.size());
+        for (size_t j = 0; j < parameter.size(); j++)
+            update[j] = parameter[j] - adamUpdated[i][j];
+        const double trustRatio = norm(parameter) / norm(update);
+        for (size_t j = 0; j < parameter.size(); j++)
+            parameter[j] = ElementType(parameter[j] - learningRate * trustRatio * update[j]);
+        expected.push_back(parameter);
+    }
+    actual = trainAll([&](const vector<Parameter>& parameters) { return LAMBLearner(parameters, TrainingParameterPerSampleSchedule(learningRate), MomentumSchedule(0.9), true, MomentumSchedule(0.999), 1e-6); });
+    for (size_t i = 0; i < shapes.size(); i++)
+        FloatingPointVectorCompare(actual[i], expected[i], "LAMB differs from Adam with the updates scaled by the trust ratios");
+}
+
+template <typename ElementType>
+void TestLazySparseUpdates(const DeviceDescriptor& device)
+{
+    const size_t dim = 4, vocabularySize = 10;
+    const NDShape shape = { dim, vocabularySize };
+    // word 3 is in all the minibatches, word 1 misses the second one, and most words are never seen
+    const vector<vector<size_t>> minibatches = { { 1, 3 }, { 3, 5 }, { 1, 3 } };
+    const vector<size_t> unseenWords = { 0, 2, 4, 6, 7, 8, 9 };
+
+    auto toVector = [](const NDArrayViewPtr& value)
+    {
+        auto cpuValue = value->DeepClone(DeviceDescriptor::CPUDevice());
+        return vector<ElementType>(cpuValue->template DataBuffer<ElementType>(), cpuValue->template DataBuffer<ElementType>() + cpuValue->Shape().TotalSize());
+    };
+    auto column = [&](const vector<ElementType>& values, size_t word)
+    {
+        return vector<ElementType>(values.begin() + word * dim, values.begin() + (word + 1) * dim);
+    };
+
+    // the gradient of the embedding of the words, as computed by Times() with a sparse input, or the equivalent dense one
+    auto sparseGradient = [&](const Parameter& embedding, const vector<size_t>& words)
+    {
+        auto input = InputVariable({ vocabularySize }, /*isSparse =*/ true, AsDataType<ElementType>());
+        auto times = Times(embedding, input);
+        unordered_map<Variable, ValuePtr> outputs = { { times->Output(), nullptr } };
+        auto backState = times->Forward({ { input, Value::CreateBatch<ElementType>(vocabularySize, words, device) } }, outputs, device, { times->Output() });
+
+        auto outputShape = outputs[times->Output()]->Shape();
+        vector<ElementType> ones(outputShape.TotalSize(), 1);
+        auto rootGradient = MakeSharedObject<NDArrayView>(outputShape, ones, false)->DeepClone(device);
+        unordered_map<Variable, ValuePtr> gradients = { { embedding, nullptr } };
+        times->Backward(backState, { { times->Output(), MakeSharedObject<Value>(rootGradient) } }, gradients);
+        BOOST_TEST(gradients[embedding]->IsSparse(), "The gradient of the embedding is expected to be sparse.");
+        return gradients[embedding]->Data();
+    };
+    auto denseGradient = [&](const vector<size_t>& words)
+    {
+        vector<ElementType> gradient(shape.TotalSize(), 0);
+        for (auto word : words)
+            for (size_t i = 0; i < dim; i++)
+                gradient[word * dim + i] += 1;
+        return MakeSharedObject<NDArrayView>(shape, gradient, false)->DeepClone(device);
+    };
+
+    // returns the embedding and the smoothed gradients of the checkpoint after training on the minibatches
+    auto train = [&](const function<LearnerPtr(const Parameter&)>& createLearner, bool sparse)
+    {
+        auto embedding = Parameter(NDArrayView::RandomUniform<ElementType>(shape, -1.0, 1.0, 1, device), L"embedding");
+        auto learner = createLearner(embedding);
+        for (const auto& words : minibatches)
+        {
+            unordered_map<Parameter, NDArrayViewPtr> gradientValues = { { embedding, sparse ? sparseGradient(embedding, words) : denseGradient(words) } };
+            learner->Update(gradientValues, words.size(), false);
+        }
+        auto checkpoint = learner->CreateCheckpoint();
+        const auto& smoothedGradient = checkpoint[L"smoothed_gradients"].Value<vector<DictionaryValue>>()[0].Value<NDArrayView>();
+        return make_pair(toVector(embedding.Value()), toVector(smoothedGradient.DeepClone()));
+    };
+
+    AdditionalLearningOptions lazyOptions;
+    lazyOptions.lazySparseUpdates = true;
+    lazyOptions.lazySparseUpdateDecayCatchUp = true;
+    auto initialValue = toVector(NDArrayView::RandomUniform<ElementType>(shape, -1.0, 1.0, 1, device));
+
+    // With the catch-up, the smoothed gradients of momentum SGD (which are not scaled by the learning rate of 1 in the sparse update) match the dense ones.
+    auto momentumSGD = [&](const AdditionalLearningOptions& options)
+    {
+        return [=](const Parameter& parameter) { return MomentumSGDLearner({ parameter }, TrainingParameterPerSampleSchedule(1.0), MomentumSchedule(0.9), true, options); };
+    };
+    auto lazy = train(momentumSGD(lazyOptions), true);
+    auto dense = train(momentumSGD(AdditionalLearningOptions()), false);
+    FloatingPointVectorCompare(lazy.second, dense.second, "The smoothed gradients of the lazy momentum SGD updates differ from the dense ones");
+    FloatingPointVectorCompare(column(lazy.first, 3), column(dense.first, 3), "The lazy momentum SGD update of a word of all minibatches differs from the dense one");
+
+    // Lazy Adam leaves the words that were never seen as they are, and matches dense Adam for the words of all minibatches.
+    auto adam = [&](const AdditionalLearningOptions& options)
+    {
+        return [=](const Parameter& parameter) { return AdamLearner({ parameter }, TrainingParameterPerSampleSchedule(0.1), MomentumSchedule(0.9), true, MomentumSchedule(0.999), 1e-6, false, options); };
+    };
+    lazy = train(adam(lazyOptions), true);
+    dense = train(adam(AdditionalLearningOptions()), false);
+    FloatingPointVectorCompare(lazy.second, dense.second, "The moments of the lazy Adam updates differ from the dense ones");
+    FloatingPointVectorCompare(column(lazy.first, 3), column(dense.first, 3), "The lazy Adam update of a word of all minibatches differs from the dense one");
+    for (auto word : unseenWords)
+        FloatingPointVectorCompare(column(lazy.first, word), column(initialValue, word), "Lazy Adam updated the embedding of a word that was never seen");
+}
+
+// Trains on two minibatches with gradient accumulation, and on their union in one minibatch, which must give the same update.
+// The parameter under the Reshape shares its gradient matrix with the Reshape, so its sum is kept aside during backprop.
+void TestGradientAccumulation(const DeviceDescriptor& device)
+{
+    const size_t inputDim = 3;
+    const size_t numClasses = 2;
+    const size_t numSamples = 4;
+    std::vector<float> features = { 1, 0, 2, -1, 1, 0, 0, 3, 1, 2, 2, -2 };
+    std::vector<float> labels = { 1, 0, 0, 1, 0, 1, 1, 0 };
+    std::vector<float> initialWeights = { 0.1f, -0.2f, 0.3f, 0.4f, -0.5f, 0.6f };
+    std::vector<float> initialBias = { 0.5f, -0.5f };
+
+    auto train = [&](size_t numMinibatchesPerUpdate, std::vector<float>& weightValues, std::vector<float>& biasValues)
+    {
+        auto input = InputVariable({ inputDim }, DataType::Float, L"features");
+        auto labelsVar = InputVariable({ numClasses }, DataType::Float, L"labels");
+        auto weights = Parameter(MakeSharedObject<NDArrayView>(NDShape({ numClasses, inputDim }), initialWeights.data(), initialWeights.size(), device, true)->DeepClone(), L"weights");
+        auto bias = Parameter(MakeSharedObject<NDArrayView>(NDShape({ 1, numClasses }), initialBias.data(), initialBias.size(), device, true)->DeepClone(), L"bias");
+        auto output = Plus(Times(weights, input), Reshape(bias, { numClasses }));
+        auto loss = CrossEntropyWithSoftmax(output, labelsVar);
+        auto trainer = CreateTrainer(output, loss, ClassificationError(output, labelsVar), { SGDLearner({ weights, bias }, TrainingParameterPerSampleSchedule(0.1)) });
+        trainer->SetGradientAccumulation(numMinibatchesPerUpdate);
+
+        const size_t minibatchSize = numSamples / numMinibatchesPerUpdate;
+        for (size_t i = 0; i < numMinibatchesPerUpdate; i++)
+        {
+            std::vector<float> minibatchFeatures(features.begin() + i * minibatchSize * inputDim, features.begin() + (i + 1) * minibatchSize * inputDim);
+            std::vector<float> minibatchLabels(labels.begin() + i * minibatchSize * numClasses, labels.begin() + (i + 1) * minibatchSize * numClasses);
+            trainer->TrainMinibatch({ { input, Value::CreateBatch(input.Shape(), minibatchFeatures, device) }, { labelsVar, Value::CreateBatch(labelsVar.Shape(), minibatchLabels, device) } }, false, device);
+
+            auto weightValue = weights.Value()->DeepClone(DeviceDescriptor::CPUDevice());
+            if ((i + 1 < numMinibatchesPerUpdate) && !std::equal(initialWeights.begin(), initialWeights.end(), weightValue->DataBuffer<float>()))
+                ReportFailure("The parameters were updated before all minibatches of the update were accumulated");
+        }
+
+        BOOST_TEST(trainer->PreviousMinibatchSampleCount() == numSamples);
+        double lossAverage = trainer->PreviousMinibatchLossAverage();
+
+        auto weightValue = weights.Value()->DeepClone(DeviceDescriptor::CPUDevice());
+        auto biasValue = bias.Value()->DeepClone(DeviceDescriptor::CPUDevice());
+        weightValues.assign(weightValue->DataBuffer<float>(), weightValue->DataBuffer<float>() + initialWeights.size());
+        biasValues.assign(biasValue->DataBuffer<float>(), biasValue->DataBuffer<float>() + initialBias.size());
+        return lossAverage;
+    };
+
+    std::vector<float> weights, bias, accumulatedWeights, accumulatedBias;
+    double lossAverage = train(1, weights, bias);
+    double accumulatedLossAverage = train(2, accumulatedWeights, accumulatedBias);
+    FloatingPointCompare(accumulatedLossAverage, lossAverage, "The loss of the accumulated minibatches differs from that of one minibatch");
+    FloatingPointVectorCompare(accumulatedWeights, weights, "The update with the accumulated gradients differs from that of one minibatch");
+    FloatingPointVectorCompare(accumulatedBias, bias, "The update of the reshaped parameter with the accumulated gradients differs from that of one minibatch");
+}
+
 struct LearnerSuiteFixture
 {
     LearnerSuiteFixture()
@@ -477,6 +821,42 @@ BOOST_AUTO_TEST_CASE(CreateAndUpdateAdamaxLearner)
     }
 }
 
+BOOST_AUTO_TEST_CASE(MultiTensorLearnerUpdate)
+{
+    for (auto& device : devices)
+    {
+        TestMultiTensorLearnerUpdate<float>(device);
+        TestMultiTensorLearnerUpdate<double>(device);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(GlobalNormGradientClipping)
+{
+    for (auto& device : devices)
+    {
+        TestGlobalNormGradientClipping<float>(device);
+        TestGlobalNormGradientClipping<double>(device);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(LayerwiseAdaptiveLearners)
+{
+    for (auto& device : devices)
+    {
+        TestLayerwiseAdaptiveLearners<float>(device);
+        TestLayerwiseAdaptiveLearners<double>(device);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(LazySparseUpdates)
+{
+    for (auto& device : devices)
+    {
+        TestLazySparseUpdates<float>(device);
+        TestLazySparseUpdates<double>(device);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(TestResettingLearningRate)
 {
     NDShape shape = { 1 };
@@ -500,6 +880,53 @@ BOOST_AUTO_TEST_CASE(TestResettingLearningRate)
     }
 }
 
+BOOST_AUTO_TEST_CASE(TestUpdateWithLossScaling)
+{
+    NDShape shape = { 3 };
+    DeviceDescriptor device = DeviceDescriptor::CPUDevice();
+    std::vector<float> initialValues = { 1.0f, 2.0f, 3.0f }, gradients = { 0.5f, -1.0f, 2.0f };
+    auto createLearner = [&](Parameter& parameter)
+    {
+        parameter = Parameter(MakeSharedObject<NDArrayView>(shape, initialValues.data(), initialValues.size(), device, true)->DeepClone(), L"parameter");
+        return SGDLearner({ parameter }, TrainingParameterPerSampleSchedule(0.5));
+    };
+    Parameter parameter(NDShape({}), DataType::Float, 0.0, device), scaledParameter(NDShape({}), DataType::Float, 0.0, device);
+    auto learner = createLearner(parameter);
+    auto scaledLearner = createLearner(scaledParameter);
+    BOOST_TEST(scaledLearner->SupportsLossScaling());
+
+    const double lossScale = 4;
+    scaledLearner->SetLossScale(lossScale);
+    BOOST_TEST(scaledLearner->GetLossScale() == lossScale);
+
+    std::vector<float> scaledGradients(gradients);
+    for (auto& g : scaledGradients)
+        g *= (float) lossScale;
+    unordered_map<Parameter, NDArrayViewPtr> gradientValues = { { parameter, MakeSharedObject<NDArrayView>(shape, gradients.data(), gradients.size(), device, true) } };
+    unordered_map<Parameter, NDArrayViewPtr> scaledGradientValues = { { scaledParameter, MakeSharedObject<NDArrayView>(shape, scaledGradients.data(), scaledGradients.size(), device)->DeepClone() } };
+    learner->Update(gradientValues, 1, false);
+    scaledLearner->Update(scaledGradientValues, 1, false);
+    BOOST_TEST(!scaledLearner->HasGradientOverflow());
+    for (size_t i = 0; i < initialValues.size(); i++)
+        BOOST_TEST(scaledParameter.Value()->DataBuffer<float>()[i] == parameter.Value()->DataBuffer<float>()[i]);
+
+    // an overflowing gradient is reported and skipped
+    std::vector<float> expectedValues(scaledParameter.Value()->DataBuffer<float>(), scaledParameter.Value()->DataBuffer<float>() + shape.TotalSize());
+    scaledGradients[1] = std::numeric_limits<float>::infinity();
+    scaledGradientValues[scaledParameter] = MakeSharedObject<NDArrayView>(shape, scaledGradients.data(), scaledGradients.size(), device)->DeepClone();
+    scaledLearner->Update(scaledGradientValues, 1, false);
+    BOOST_TEST(scaledLearner->HasGradientOverflow());
+    BOOST_TEST(scaledLearner->TotalNumberOfSamplesSeen() == 1);
+    for (size_t i = 0; i < expectedValues.size(); i++)
+        BOOST_TEST(scaledParameter.Value()->DataBuffer<float>()[i] == expectedValues[i]);
+}
+
+BOOST_AUTO_TEST_CASE(GradientAccumulation)
+{
+    for (auto& device : devices)
+        TestGradientAccumulation(device);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }}
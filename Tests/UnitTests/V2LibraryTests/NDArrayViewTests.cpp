@@ -308,6 +308,55 @@ void TestDataBuffer(size_t numAxes, const DeviceDescriptor& device)
     }
 }
 
+template <typename ElementType>
+void TestStridedSliceView(const DeviceDescriptor& device)
+{
+    NDShape viewShape = { 4, 3, 2 };
+    std::vector<ElementType> data(viewShape.TotalSize());
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = (ElementType)i;
+
+    auto cpuDataView = MakeSharedObject<NDArrayView>(viewShape, data.data(), data.size(), DeviceDescriptor::CPUDevice());
+    auto dataView = cpuDataView->DeepClone(device);
+
+    // Every other row of the second matrix, which is not contiguous in memory
+    auto sliceView = dataView->SliceView({ 1, 0, 1 }, { 2, 3 }, std::vector<size_t>({ 2 }));
+    BOOST_TEST((sliceView->Shape() == NDShape({ 2, 3 })), "The shape of the strided slice is invalid.");
+    BOOST_TEST(!sliceView->IsContiguous(), "The strided slice is expected to be non-contiguous.");
+    BOOST_TEST(dataView->IsContiguous(), "The sliced NDArrayView is expected to be contiguous.");
+
+    std::vector<ElementType> expectedSlice(sliceView->Shape().TotalSize());
+    for (size_t j = 0; j < 3; ++j)
+        for (size_t i = 0; i < 2; ++i)
+            expectedSlice[(j * 2) + i] = data[(1 + (2 * i)) + (4 * j) + 12];
+
+    auto clonedSlice = sliceView->DeepClone(DeviceDescriptor::CPUDevice());
+    BOOST_TEST(clonedSlice->IsContiguous(), "The clone of a strided slice is expected to be contiguous.");
+    std::vector<ElementType> sliceData(clonedSlice->template DataBuffer<ElementType>(), clonedSlice->template DataBuffer<ElementType>() + clonedSlice->Shape().TotalSize());
+    BOOST_TEST(sliceData == expectedSlice, "The data of the strided slice does not match the sliced NDArrayView.");
+
+    // Writing the strided slice writes the data of the sliced NDArrayView
+    std::vector<ElementType> newSliceData(expectedSlice.size());
+    for (size_t i = 0; i < newSliceData.size(); ++i)
+        newSliceData[i] = (ElementType)(100 + i);
+
+    auto newSliceView = MakeSharedObject<NDArrayView>(sliceView->Shape(), newSliceData.data(), newSliceData.size(), DeviceDescriptor::CPUDevice());
+    sliceView->CopyFrom(*newSliceView);
+
+    std::vector<ElementType> expectedData = data;
+    for (size_t j = 0; j < 3; ++j)
+        for (size_t i = 0; i < 2; ++i)
+            expectedData[(1 + (2 * i)) + (4 * j) + 12] = newSliceData[(j * 2) + i];
+
+    auto clonedData = dataView->DeepClone(DeviceDescriptor::CPUDevice());
+    std::vector<ElementType> newData(clonedData->template DataBuffer<ElementType>(), clonedData->template DataBuffer<ElementType>() + clonedData->Shape().TotalSize());
+    BOOST_TEST(newData == expectedData, "Writing the strided slice did not write the data of the sliced NDArrayView.");
+
+    VerifyException([&sliceView]() {
+        sliceView->template DataBuffer<ElementType>();
+    }, "Was incorrectly able to get a data buffer of a strided NDArrayView.");
+}
+
 struct NDArrayViewFixture
 {
     NDArrayViewFixture()
@@ -384,6 +433,18 @@ BOOST_AUTO_TEST_CASE(CheckDataBufferInGpu)
     }
 }
 
+BOOST_AUTO_TEST_CASE(CheckStridedSliceViewInCpu)
+{
+    if (ShouldRunOnCpu())
+        TestStridedSliceView<float>(DeviceDescriptor::CPUDevice());
+}
+
+BOOST_AUTO_TEST_CASE(CheckStridedSliceViewInGpu)
+{
+    if (ShouldRunOnGpu())
+        TestStridedSliceView<double>(DeviceDescriptor::GPUDevice(0));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }}
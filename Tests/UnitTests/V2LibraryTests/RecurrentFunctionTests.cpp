@@ -569,6 +569,14 @@ void ParityCandCppLSTMModel(DeviceDescriptor device, CNTK_DeviceDescriptor cdevi
         outputShape = NDShape(std::vector<size_t>(outputValues[0].shape.value, outputValues[0].shape.value + outputValues[0].shape.size));
         std::vector<float> cresult1(outputValues[0].data, outputValues[0].data + outputShape.TotalSize());
 
+        // With reset, into a caller-owned buffer; this leaves the same state as the call above.
+        std::vector<float> preallocated(outputShape.TotalSize());
+        CNTK_Value preallocatedOutput{ outputValues[0].shape, preallocated.data() };
+        rc = CNTK_EvaluateSequenceOnDevice(model, argumentInfos, &threeFrames, sequenceFlags, numArguments,
+            outputInfos, numOutputs, nullptr, &preallocatedOutput);
+        BOOST_REQUIRE_EQUAL(rc.value, CNTK_SUCCESS);
+        BOOST_REQUIRE_EQUAL_COLLECTIONS(preallocated.begin(), preallocated.end(), cresult1.begin(), cresult1.end());
+
         // Without reset.
         sequenceFlags[0] = false;
         rc = CNTK_EvaluateSequence(model, argumentInfos, &threeFrames, sequenceFlags, numArguments,
@@ -357,7 +357,9 @@ void CheckEnumValuesNotModified() {
                   static_cast<size_t>(PrimitiveOpType::StraightThrough) == 94 &&
                   static_cast<size_t>(PrimitiveOpType::Tan) == 95 &&
                   static_cast<size_t>(PrimitiveOpType::Atan) == 96 &&
-                  static_cast<size_t>(PrimitiveOpType::ConvolutionSequenceShape) == 97,
+                  static_cast<size_t>(PrimitiveOpType::ConvolutionSequenceShape) == 97 &&
+                  static_cast<size_t>(PrimitiveOpType::LayerNormalization) == 98 &&
+                  static_cast<size_t>(PrimitiveOpType::QuantizedLookupTable) == 99,
                   "PrimitiveOpType enum value was modified.");
 }
 
@@ -462,6 +464,99 @@ void TestFunctionSerialization(const DeviceDescriptor& device)
     TestFunctionSaveAndLoad(BuildLSTMClassifierNet(inputVar, 5, device), device);
 }
 
+void TestMemoryMappedModelSaveAndLoad(const DeviceDescriptor& device)
+{
+    const size_t inputDim = 20;
+    auto inputVar = InputVariable({ inputDim }, DataType::Float, L"features");
+    auto function = BuildFFClassifierNet(inputVar, 5, device);
+
+    auto file = L"TestMemoryMappedModelSaveAndLoad.out";
+    function->Save(file, ModelFormat::CNTKv2MemoryMapped);
+    auto reloadedFunction = Function::Load(file, device);
+
+    if (!AreEqual(function, reloadedFunction))
+        BOOST_ERROR("TestMemoryMappedModelSaveAndLoad: original and reloaded functions are not identical.");
+
+    // On the CPU the parameters are views over the mapping of the file; on a GPU they are copies.
+    for (const auto& parameter : reloadedFunction->Parameters())
+    {
+        if (parameter.Value()->IsReadOnly() != (device.Type() == DeviceKind::CPU))
+            BOOST_ERROR("TestMemoryMappedModelSaveAndLoad: unexpected kind of parameter storage after reload.");
+    }
+
+    std::vector<float> inputData(inputDim * 3);
+    for (size_t i = 0; i < inputData.size(); ++i)
+        inputData[i] = (float)(i % 7) / 7.0f;
+    auto inputValue = Value::CreateBatch(inputVar.Shape(), inputData, device, /*readOnly =*/ true);
+
+    std::unordered_map<Variable, ValuePtr> outputs = { { function->Output(), nullptr } };
+    function->Evaluate({ { inputVar, inputValue } }, outputs, device);
+    auto reloadedInputVar = reloadedFunction->Arguments()[0];
+    std::unordered_map<Variable, ValuePtr> reloadedOutputs = { { reloadedFunction->Output(), nullptr } };
+    reloadedFunction->Evaluate({ { reloadedInputVar, inputValue } }, reloadedOutputs, device);
+
+    if (!Internal::AreEqual(*outputs[function->Output()], *reloadedOutputs[reloadedFunction->Output()]))
+        BOOST_ERROR("TestMemoryMappedModelSaveAndLoad: original and reloaded functions evaluate differently.");
+
+    // Parameters are only placed on the device when first used; on the CPU, that does not allocate any storage.
+    auto lazilyLoadedFunction = Function::Load(file, device);
+    auto numAllocations = Internal::GetNumStorageAllocations();
+    for (const auto& parameter : lazilyLoadedFunction->Parameters())
+        UNUSED(parameter.Value());
+    if (device.Type() == DeviceKind::CPU && Internal::GetNumStorageAllocations() != numAllocations)
+        BOOST_ERROR("TestMemoryMappedModelSaveAndLoad: placing the parameters on the CPU allocated storage.");
+
+    // Saving again over a file that is still mapped must not affect the loaded model.
+    reloadedFunction->Save(file, ModelFormat::CNTKv2MemoryMapped);
+    if (!AreEqual(function, Function::Load(file, device)))
+        BOOST_ERROR("TestMemoryMappedModelSaveAndLoad: model saved over its mapped file is not identical.");
+}
+
+void TestSharedParameters(const DeviceDescriptor& device)
+{
+    const size_t inputDim = 20;
+    auto inputVar = InputVariable({ inputDim }, DataType::Float, L"features");
+    auto function = BuildFFClassifierNet(inputVar, 5, device);
+
+    auto file = L"TestSharedParameters.out";
+    auto descriptor = L"TestSharedParameters.shared";
+    function->Save(file);
+    auto consumer = Function::Load(file, device);
+
+    auto version = Internal::PublishSharedParameters(function, descriptor);
+    if (Internal::GetSharedParametersVersion(descriptor) != version)
+        BOOST_ERROR("TestSharedParameters: unexpected published version.");
+
+    // Within the publishing process, the consumer's values are views over the owner's buffer.
+    auto numMapped = Internal::MapSharedParameters(consumer, descriptor, device);
+    if (numMapped != function->Parameters().size() + function->Constants().size())
+        BOOST_ERROR("TestSharedParameters: not all parameters were mapped.");
+    std::unordered_map<std::wstring, Parameter> ownerParameters;
+    for (const auto& parameter : function->Parameters())
+        ownerParameters.insert({ parameter.Uid(), parameter });
+    for (const auto& parameter : consumer->Parameters())
+    {
+        if (!parameter.Value()->IsReadOnly() || parameter.Value()->DataBuffer<float>() != ownerParameters.at(parameter.Uid()).Value()->DataBuffer<float>())
+            BOOST_ERROR("TestSharedParameters: a mapped parameter does not share the storage of the owner.");
+    }
+
+    std::vector<float> inputData(inputDim * 3);
+    for (size_t i = 0; i < inputData.size(); ++i)
+        inputData[i] = (float)(i % 7) / 7.0f;
+    auto inputValue = Value::CreateBatch(inputVar.Shape(), inputData, device, /*readOnly =*/ true);
+
+    std::unordered_map<Variable, ValuePtr> outputs = { { function->Output(), nullptr } };
+    function->Evaluate({ { inputVar, inputValue } }, outputs, device);
+    std::unordered_map<Variable, ValuePtr> consumerOutputs = { { consumer->Output(), nullptr } };
+    consumer->Evaluate({ { consumer->Arguments()[0], inputValue } }, consumerOutputs, device);
+    if (!Internal::AreEqual(*outputs[function->Output()], *consumerOutputs[consumer->Output()]))
+        BOOST_ERROR("TestSharedParameters: the owner and the consumer evaluate differently.");
+
+    Internal::ReleaseSharedParameters(descriptor);
+    if (Internal::GetSharedParametersVersion(descriptor) != 0)
+        BOOST_ERROR("TestSharedParameters: the descriptor was not removed.");
+}
+
 TrainerPtr BuildTrainer(const FunctionPtr& function, const Variable& labels,
                      LearningRateSchedule lr = LearningRateSchedule(0.005, 1),
                      MomentumSchedule m = MomentumAsTimeConstantSchedule(0.0))
@@ -669,6 +764,54 @@ void TestCheckpointing(const DeviceDescriptor& device)
 }
 
 
+void TestCheckpointingInBackground(const DeviceDescriptor& device)
+{
+    auto featureStreamName = L"features";
+    auto labelsStreamName = L"labels";
+
+    const size_t inputDim = 784;
+    const size_t numOutputClasses = 10;
+    auto features = InputVariable({ inputDim }, false /*isSparse*/, DataType::Float, featureStreamName);
+    auto labels = InputVariable({ numOutputClasses }, DataType::Float, labelsStreamName);
+    auto net = BuildFFClassifierNet(features, numOutputClasses, device, 1);
+
+    auto minibatchSource = TextFormatMinibatchSource(L"Train-28x28_cntk_text.txt", { { featureStreamName, inputDim }, { labelsStreamName, numOutputClasses } }, 1000, false);
+    auto featureStreamInfo = minibatchSource->StreamInfo(features);
+    auto labelStreamInfo = minibatchSource->StreamInfo(labels);
+    auto minibatchData = minibatchSource->GetNextMinibatch(50, device);
+
+    auto trainer = BuildTrainer(net, labels);
+    auto trainMinibatch = [&]() { trainer->TrainMinibatch({ { features, minibatchData[featureStreamInfo] }, { labels, minibatchData[labelStreamInfo] } }, device); };
+
+    for (int i = 0; i < 3; ++i)
+    {
+        trainMinibatch();
+        trainer->SaveCheckpoint(L"trainer.v2.sync.checkpoint");
+        trainer->SaveCheckpoint(L"trainer.v2.background.checkpoint", Dictionary(), /*inBackground =*/ true);
+
+        // The background checkpoint holds the state from when it was taken, not the one after further training.
+        trainMinibatch();
+        trainMinibatch();
+        trainer->WaitForCheckpoint();
+        trainer->SaveCheckpoint(L"trainer.v2.later.checkpoint");
+
+        auto synchronous = Function::Load(L"trainer.v2.sync.checkpoint", device);
+        auto background = Function::Load(L"trainer.v2.background.checkpoint", device);
+        if (!AreEqual(synchronous, background))
+            BOOST_ERROR("TestCheckpointingInBackground: the checkpoint written in the background differs from the one written synchronously.");
+        if (AreEqual(background, Function::Load(L"trainer.v2.later.checkpoint", device)))
+            BOOST_ERROR("TestCheckpointingInBackground: the checkpoint written in the background followed the training after it was taken.");
+    }
+
+    // restoring waits for a checkpoint still being written
+    trainer->SaveCheckpoint(L"trainer.v2.background.checkpoint", Dictionary(), /*inBackground =*/ true);
+    auto expected = trainer->Model()->Clone();
+    trainMinibatch();
+    trainer->RestoreFromCheckpoint(L"trainer.v2.background.checkpoint");
+    if (!AreEqual(expected, trainer->Model()))
+        BOOST_ERROR("TestCheckpointingInBackground: restoring from the checkpoint written in the background did not restore the parameters.");
+}
+
 void TestLegacyModelSaving(const DeviceDescriptor& device)
 {
     const size_t inputDim = 2000;
@@ -1024,6 +1167,19 @@ BOOST_AUTO_TEST_CASE(FunctionSerializationInCPU)
     TestFunctionSerialization(DeviceDescriptor::CPUDevice());
 }
 
+BOOST_AUTO_TEST_CASE(MemoryMappedModelSaveAndLoad)
+{
+    TestMemoryMappedModelSaveAndLoad(DeviceDescriptor::CPUDevice());
+    if (ShouldRunOnGpu())
+        TestMemoryMappedModelSaveAndLoad(DeviceDescriptor::GPUDevice(0));
+}
+
+BOOST_AUTO_TEST_CASE(SharedParametersInGPU)
+{
+    if (ShouldRunOnGpu())
+        TestSharedParameters(DeviceDescriptor::GPUDevice(0));
+}
+
 BOOST_AUTO_TEST_CASE(ModelSerializationDuringTrainingInCPU)
 {
     TestModelSerializationDuringTraining(DeviceDescriptor::CPUDevice());
@@ -1034,6 +1190,11 @@ BOOST_AUTO_TEST_CASE(CheckpointingInCPU)
     TestCheckpointing(DeviceDescriptor::CPUDevice());
 }
 
+BOOST_AUTO_TEST_CASE(CheckpointingInBackgroundInCPU)
+{
+    TestCheckpointingInBackground(DeviceDescriptor::CPUDevice());
+}
+
 BOOST_AUTO_TEST_CASE(LegacyModelSavingInCPU)
 {
     TestLegacyModelSaving(DeviceDescriptor::CPUDevice());
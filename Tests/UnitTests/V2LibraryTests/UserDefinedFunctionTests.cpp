@@ -153,6 +153,75 @@ private:
     std::unordered_map<Variable, Variable> m_timesOrPlusFuncArgumentMap;
 };
 
+// Scales its input by 2, computed on the CPU buffers of its node in the network
+class UserDefinedDeviceBufferScaleFunction final : public Function, public DeviceBufferUserFunction
+{
+    template <typename T, typename ...CtorArgTypes>
+    friend inline std::shared_ptr<T> CNTK::MakeSharedObject(CtorArgTypes&& ...ctorArgs);
+
+public:
+    static FunctionPtr Create(const Variable& operand, const std::wstring& name = L"")
+    {
+        auto scaleFunc = MakeSharedObject<UserDefinedDeviceBufferScaleFunction>(operand, name);
+        return Combine({ scaleFunc->Output() });
+    }
+
+    void ForwardOnDevice(const std::vector<NDArrayViewPtr>& inputs, const std::vector<NDArrayViewPtr>& outputs, void* computeStream, bool /*isTraining*/) override
+    {
+        BOOST_TEST(computeStream == nullptr, "There is no compute stream on the CPU.");
+        BOOST_TEST((outputs[0]->Shape() == inputs[0]->Shape()), "The buffers of the input and the output have different shapes.");
+
+        auto input = inputs[0]->DataBuffer<float>();
+        auto output = outputs[0]->WritableDataBuffer<float>();
+        for (size_t i = 0; i < inputs[0]->Shape().TotalSize(); ++i)
+            output[i] = 2 * input[i];
+    }
+
+    void BackwardOnDevice(const std::vector<NDArrayViewPtr>& inputs, const std::vector<NDArrayViewPtr>& outputs,
+                          const std::vector<NDArrayViewPtr>& outputGradients, const std::vector<NDArrayViewPtr>& inputGradients,
+                          const std::vector<bool>& overwriteInputGradients, void* /*computeStream*/) override
+    {
+        BOOST_TEST((!inputs[0] && !outputs[0]), "The values declared as unused in the backward pass are passed to it.");
+
+        auto outputGradient = outputGradients[0]->DataBuffer<float>();
+        auto inputGradient = inputGradients[0]->WritableDataBuffer<float>();
+        for (size_t i = 0; i < inputGradients[0]->Shape().TotalSize(); ++i)
+            inputGradient[i] = (overwriteInputGradients[0] ? 0 : inputGradient[i]) + (2 * outputGradient[i]);
+    }
+
+    bool OutputsUsedInBackward() const override { return false; }
+    bool InputUsedInBackward(size_t /*inputIndex*/) const override { return false; }
+
+    BackPropStatePtr Forward(const std::vector<ValuePtr>& /*inputValues*/,
+                             std::unordered_map<Variable, ValuePtr>& /*outputs*/,
+                             const DeviceDescriptor& /*computeDevice*/,
+                             const std::unordered_set<Variable>& /*outputsToRetainBackwardStateFor*/) override
+    {
+        NOT_IMPLEMENTED;
+    }
+
+    const std::wstring& OpName() const override
+    {
+        static std::wstring opName = L"UserDefinedDeviceBufferScaleOp";
+        return opName;
+    }
+
+    Dictionary Serialize() const override { NOT_IMPLEMENTED; }
+    size_t CurrentVersion() const override { NOT_IMPLEMENTED; }
+
+private:
+    void InferOutputs(std::vector<Variable>& outputs) override
+    {
+        auto operand = Inputs()[0];
+        outputs.push_back(OutputVariable(operand.Shape(), operand.GetDataType(), operand.DynamicAxes()));
+    }
+
+    UserDefinedDeviceBufferScaleFunction(const Variable& operand, const std::wstring& name)
+        : Function({ operand }, Dictionary(), name)
+    {
+    }
+};
+
 namespace CNTK { namespace Test {
 
 template <typename ElementType>
@@ -372,6 +441,47 @@ void TestDuplicateVariablesInInputs(size_t dim, const DeviceDescriptor& device)
             BOOST_ERROR("TestTimesAndPlus: Backprop prop results do not match expected results for Plus params gradients");
 }
 
+void TestDeviceBufferUserFunction(size_t dim)
+{
+    auto device = DeviceDescriptor::CPUDevice();
+    auto inputVar = InputVariable({ dim }, DataType::Float, /* needsGradient = */ true, L"input");
+    auto scaleFunc = UserDefinedDeviceBufferScaleFunction::Create(inputVar);
+
+    srand(1);
+    size_t numSamples = 5;
+    std::vector<float> inputData(dim * numSamples);
+    for (size_t i = 0; i < inputData.size(); ++i)
+        inputData[i] = ((float)rand()) / RAND_MAX;
+
+    NDShape inputShape = inputVar.Shape().AppendShape({ 1, numSamples });
+    ValuePtr inputValue = MakeSharedObject<Value>(MakeSharedObject<NDArrayView>(inputShape, inputData.data(), inputData.size(), device, true));
+
+    std::unordered_map<Variable, ValuePtr> outputs = { { scaleFunc->Output(), nullptr } };
+    auto backpropState = scaleFunc->Forward({ { inputVar, inputValue } }, outputs, device, { scaleFunc->Output() });
+
+    NDShape outputShape = scaleFunc->Output().Shape().AppendShape({ 1, numSamples });
+    std::vector<float> outputData(outputShape.TotalSize());
+    NDArrayViewPtr outputView = MakeSharedObject<NDArrayView>(outputShape, outputData.data(), outputData.size(), device, false);
+    outputView->CopyFrom(*outputs[scaleFunc->Output()]->Data());
+
+    std::vector<float> expectedOutputData(inputData.size());
+    for (size_t i = 0; i < inputData.size(); ++i)
+        expectedOutputData[i] = 2 * inputData[i];
+
+    FloatingPointVectorCompare(outputData, expectedOutputData, "TestDeviceBufferUserFunction: Forward prop results do not match expected results");
+
+    std::vector<float> rootGradientData(outputShape.TotalSize(), 1);
+    ValuePtr rootGradientValue = MakeSharedObject<Value>(MakeSharedObject<NDArrayView>(outputShape, rootGradientData.data(), rootGradientData.size(), device, true));
+    std::unordered_map<Variable, ValuePtr> inputGradients = { { inputVar, nullptr } };
+    scaleFunc->Backward(backpropState, { { scaleFunc->Output(), rootGradientValue } }, inputGradients);
+
+    std::vector<float> inputGradientData(inputShape.TotalSize());
+    NDArrayViewPtr inputGradientView = MakeSharedObject<NDArrayView>(inputShape, inputGradientData.data(), inputGradientData.size(), device, false);
+    inputGradientView->CopyFrom(*inputGradients[inputVar]->Data());
+
+    FloatingPointVectorCompare(inputGradientData, std::vector<float>(inputGradientData.size(), 2), "TestDeviceBufferUserFunction: Backprop results do not match expected results");
+}
+
 BOOST_AUTO_TEST_SUITE(UserDefinedFunctionSuite)
 
 BOOST_AUTO_TEST_CASE(DuplicateVariablesInCPU)
@@ -401,6 +511,12 @@ BOOST_AUTO_TEST_CASE(TimesAndPlusInGPU)
     }
 }
 
+BOOST_AUTO_TEST_CASE(DeviceBufferUserFunctionInCPU)
+{
+    if (ShouldRunOnCpu())
+        TestDeviceBufferUserFunction(7);
+}
+
 BOOST_AUTO_TEST_CASE(UserTimesFunctionExample)
 {
     UserTimesFunctionExample();
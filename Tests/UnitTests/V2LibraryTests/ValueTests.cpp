@@ -1169,6 +1169,37 @@ void CreateBatchOfSequencesTestDense(const DeviceDescriptor device, bool readOnl
 }
 
 
+// Sequences that all begin in the batch are packed when the Value is created, and unpacked when they are read.
+template <typename ElementType>
+void ValueCreationPackedSequencesTest(const DeviceDescriptor device)
+{
+    NDShape sampleShape({ 2, 3 });
+    vector<size_t> seqLenList = { 3, 1, 5, 2 };
+    auto data = GenerateSequences<ElementType>(seqLenList, sampleShape);
+
+    // the data of a Value created from sequences can be read even if automatic unpacking is disabled
+    Internal::SetAutomaticUnpackingOfPackedValues(/*disable =*/ true);
+    auto testValue = Value::Create(sampleShape, data, device, /*readOnly =*/ true);
+    auto aliasValue = testValue->Alias(/*readOnly =*/ true);
+    CheckValue(testValue, sampleShape, data, seqLenList);
+    CheckValue(aliasValue, sampleShape, data, seqLenList);
+    Internal::SetAutomaticUnpackingOfPackedValues(/*disable =*/ false);
+
+    // the packed sequences are fed to the network as such
+    auto input = InputVariable(sampleShape, AsDataType<ElementType>(), L"features");
+    auto model = Plus(input, input);
+    testValue = Value::Create(sampleShape, data, device, /*readOnly =*/ true);
+    std::unordered_map<Variable, ValuePtr> outputs = { { model->Output(), nullptr } };
+    model->Evaluate({ { input, testValue } }, outputs, device);
+
+    vector<vector<ElementType>> expected(data.size()), actual;
+    for (size_t i = 0; i < data.size(); i++)
+        for (auto x : data[i])
+            expected[i].push_back(x + x);
+    outputs.at(model->Output())->CopyVariableValueTo(model->Output(), actual);
+    CheckCopyToOutput(expected, actual);
+}
+
 template <typename ElementType>
 void CreateBatchTestOneHot(const DeviceDescriptor device, bool readOnly)
 {
@@ -1520,6 +1551,24 @@ BOOST_AUTO_TEST_CASE(CreateBatchOfSequencesDenseInGPU)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ValueCreationPackedSequencesInCPU)
+{
+    if (!ShouldRunOnCpu())
+        return;
+
+    ValueCreationPackedSequencesTest<float>(DeviceDescriptor::CPUDevice());
+    ValueCreationPackedSequencesTest<double>(DeviceDescriptor::CPUDevice());
+}
+
+BOOST_AUTO_TEST_CASE(ValueCreationPackedSequencesInGPU)
+{
+    if (ShouldRunOnGpu())
+    {
+        ValueCreationPackedSequencesTest<float>(DeviceDescriptor::GPUDevice(0));
+        ValueCreationPackedSequencesTest<double>(DeviceDescriptor::GPUDevice(0));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(CreateBatchOneHotInCPU)
 {
     if (!ShouldRunOnCpu())